@@ -0,0 +1,79 @@
+/// @file arena.h
+/// @brief Region allocator, for programs which free everything at once.
+/// @details
+/// The arena hands out memory by bumping a pointer inside large chunks,
+/// mapped with mmap(), and never frees single allocations: arena_reset()
+/// gives back all of them at once, and arena_destroy() unmaps the chunks.
+/// Allocations larger than a chunk get a chunk of their own.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+/// The size of the chunks, when arena_create() is given 0.
+#define ARENA_CHUNK_SIZE (64 * 1024)
+/// The alignment of the allocations.
+#define ARENA_ALIGNMENT  8U
+
+/// @brief A chunk of memory of an arena, followed by the memory it holds.
+typedef struct arena_chunk {
+    /// The chunk which was mapped before this one.
+    struct arena_chunk *prev;
+    /// The size of the mapping, including this header.
+    size_t size;
+} arena_chunk_t;
+
+/// @brief A region allocator, which lives inside its first chunk.
+typedef struct arena {
+    /// The last chunk mapped, linked to the previous ones.
+    arena_chunk_t *chunks;
+    /// Where the next allocation starts, inside the current chunk.
+    uintptr_t next;
+    /// The end of the current chunk.
+    uintptr_t end;
+    /// The size of the chunks.
+    size_t chunk_size;
+} arena_t;
+
+/// @brief Creates an arena, mapping its first chunk.
+/// @param chunk_size The size of the chunks, or 0 for ARENA_CHUNK_SIZE.
+/// @return The arena, or NULL on failure.
+arena_t *arena_create(size_t chunk_size);
+
+/// @brief Allocates the memory which does not fit inside the current chunk.
+/// @param arena The arena.
+/// @param size The size of the allocation.
+/// @return The memory, or NULL on failure.
+void *__arena_alloc_slow(arena_t *arena, size_t size);
+
+/// @brief Allocates memory from the arena.
+/// @param arena The arena.
+/// @param size The size of the allocation.
+/// @return The memory, aligned to ARENA_ALIGNMENT, or NULL on failure.
+static inline void *arena_alloc(arena_t *arena, size_t size)
+{
+    uintptr_t start = arena->next;
+    if (size > (arena->end - start)) {
+        return __arena_alloc_slow(arena, size);
+    }
+    // The end of a chunk is aligned, so the rounded size still fits.
+    arena->next = start + ((size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1));
+    return (void *)start;
+}
+
+/// @brief Allocates zeroed memory from the arena.
+/// @param arena The arena.
+/// @param size The size of the allocation.
+/// @return The memory, aligned to ARENA_ALIGNMENT, or NULL on failure.
+void *arena_calloc(arena_t *arena, size_t size);
+
+/// @brief Frees all the allocations at once, keeping the first chunk.
+/// @param arena The arena.
+void arena_reset(arena_t *arena);
+
+/// @brief Unmaps all the chunks, the arena included.
+/// @param arena The arena.
+void arena_destroy(arena_t *arena);
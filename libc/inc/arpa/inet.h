@@ -0,0 +1,27 @@
+/// @file inet.h
+/// @brief Conversions between IPv4 addresses and their dotted notation.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "netinet/in.h"
+
+/// @brief The value returned by inet_addr() for invalid addresses.
+#define INADDR_NONE ((in_addr_t)0xFFFFFFFF)
+
+/// @brief Converts an address from the dotted notation (e.g., "10.0.2.15").
+/// @param cp The address.
+/// @param inp Where the address is stored, in network byte order.
+/// @return 1 if the address is valid, 0 otherwise.
+int inet_aton(const char *cp, struct in_addr *inp);
+
+/// @brief Converts an address from the dotted notation.
+/// @param cp The address.
+/// @return The address in network byte order, INADDR_NONE if it is not valid.
+in_addr_t inet_addr(const char *cp);
+
+/// @brief Converts an address to the dotted notation.
+/// @param in The address.
+/// @return The address, in a static buffer overwritten by each call.
+char *inet_ntoa(struct in_addr in);
@@ -0,0 +1,42 @@
+/// @file clone.h
+/// @brief Flags of clone(), and the descriptor of the thread-local storage.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @name Flags of clone()
+/// @{
+#define CSIGNAL              0x000000FFU ///< The signal sent to the parent once the child terminates.
+#define CLONE_VM             0x00000100U ///< The child shares the memory of the parent.
+#define CLONE_FILES          0x00000400U ///< The child shares the file descriptors of the parent.
+#define CLONE_SIGHAND        0x00000800U ///< The child shares the signal handlers of the parent (needs CLONE_VM).
+#define CLONE_THREAD         0x00010000U ///< The child joins the thread group of the parent (needs CLONE_SIGHAND).
+#define CLONE_SETTLS         0x00080000U ///< The child starts with the thread-local storage described by `tls`.
+#define CLONE_PARENT_SETTID  0x00100000U ///< The id of the child is written at `ptid`, inside the parent.
+#define CLONE_CHILD_CLEARTID 0x00200000U ///< Once the child exits, `ctid` is cleared, and a futex waiter woken up.
+#define CLONE_CHILD_SETTID   0x01000000U ///< The id of the child is written at `ctid`, inside the child.
+/// @}
+
+/// @brief Describes the segment of the thread-local storage, the `%gs`
+///        register of the thread selects it.
+struct user_desc {
+    /// The entry of the GDT holding the segment, -1 to let the kernel choose.
+    unsigned int entry_number;
+    /// Where the thread-local storage starts.
+    unsigned int base_addr;
+    /// The limit of the segment (the kernel always uses the whole memory).
+    unsigned int limit;
+    /// If the segment is a 32-bit one.
+    unsigned int seg_32bit : 1;
+    /// The type of the segment, 0 for data.
+    unsigned int contents : 2;
+    /// If the segment cannot be written.
+    unsigned int read_exec_only : 1;
+    /// If the limit is expressed in pages.
+    unsigned int limit_in_pages : 1;
+    /// If the segment is not present.
+    unsigned int seg_not_present : 1;
+    /// If the segment can be used.
+    unsigned int useable : 1;
+};
@@ -0,0 +1,52 @@
+/// @file vdso.h
+/// @brief The page the kernel shares, read-only, with every process.
+/// @details
+/// The page holds the parameters of the clocks, and the identifiers of the
+/// running process, so that the C library reads the time and the pid
+/// without system calls. The kernel updates the clocks inside a seqlock:
+/// a reader retries while `seq` is odd, or if it changed meanwhile. The page
+/// also holds the trampoline the C library calls to enter the system calls.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+#include "sys/types.h"
+
+/// Where the page is mapped, right below the lowest address of the programs.
+#define VDSO_ADDR 0x0FFFF000U
+
+/// Where the trampoline entering the system calls starts, inside the page.
+#define VDSO_SYSCALL_OFFSET 0x800U
+/// Where the programs call the trampoline, with sysenter when the CPU has it,
+/// `int 0x80` otherwise. Without suffix, the assembly uses it (see `sysenter.S`).
+#define VDSO_SYSCALL_ADDR 0x0FFFF800
+
+/// @name Sources of the monotonic clock
+/// @{
+#define VDSO_CLOCK_TICK 0 ///< The clock advances with the tick, `mono_ns` holds it.
+#define VDSO_CLOCK_TSC  1 ///< The clock is `((tsc - tsc_base) * tsc_mult) >> tsc_shift`.
+/// @}
+
+/// @brief The content of the shared page.
+typedef struct vdso_data {
+    /// Odd while the kernel updates the clocks, it changes at each update.
+    volatile uint32_t seq;
+    /// The source of the monotonic clock (VDSO_CLOCK_*).
+    uint32_t clock_mode;
+    /// The value of the TSC when the monotonic clock was zero.
+    uint64_t tsc_base;
+    /// The nanoseconds of a cycle of the TSC, with `tsc_shift` bits of fraction.
+    uint32_t tsc_mult;
+    /// The number of bits of the fraction of `tsc_mult`.
+    uint32_t tsc_shift;
+    /// The nanoseconds of the monotonic clock at the last tick (VDSO_CLOCK_TICK).
+    uint64_t mono_ns;
+    /// The nanoseconds between the Unix epoch and the start of the monotonic clock, 0 until known.
+    uint64_t realtime_offset;
+    /// The id of the process running, shared by its threads.
+    volatile pid_t pid;
+    /// The id of the thread running.
+    volatile pid_t tid;
+} vdso_data_t;
@@ -31,6 +31,8 @@ typedef struct {
 void sha256_init(SHA256_ctx_t *ctx);
 
 /// @brief Adds data to the SHA-256 context for hashing.
+/// @details The data can be given in pieces of any size, through consecutive
+/// calls; the whole blocks are hashed straight from it, without being copied.
 /// @param ctx Pointer to the SHA-256 context.
 /// @param data Pointer to the data to be hashed.
 /// @param len Length of the data to hash, in bytes.
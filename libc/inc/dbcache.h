@@ -0,0 +1,65 @@
+/// @file dbcache.h
+/// @brief In-process cache of the line-oriented databases (e.g., `/etc/passwd`).
+/// @details
+/// The file is read and split into lines once, and its entries are indexed
+/// by their first field, the name, and optionally by a numeric field, the id.
+/// The file is read again as soon as its modification time, size or inode
+/// change, which costs a stat() per lookup.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "time.h"
+
+/// @brief A cached database.
+typedef struct dbcache {
+    /// The path of the file.
+    const char *path;
+    /// The field which holds the id (counting from 0), or -1 if there is none.
+    int id_field;
+    /// The modification time of the file, when it was read.
+    time_t mtime;
+    /// The size of the file, when it was read.
+    off_t size;
+    /// The inode of the file, when it was read.
+    ino_t ino;
+    /// The content of the file, each line terminated by a null character.
+    char *content;
+    /// The lines of the file, without the empty ones.
+    char **lines;
+    /// The number of lines.
+    size_t count;
+    /// The number of buckets of the indexes, a power of two.
+    size_t buckets;
+    /// The index by name, each bucket holds a line number plus one, 0 if empty.
+    size_t *by_name;
+    /// The index by id, or NULL if there is no id.
+    size_t *by_id;
+} dbcache_t;
+
+/// @brief Initializes a cache, as a static variable.
+/// @param path The path of the file.
+/// @param id_field The field which holds the id, or -1 if there is none.
+#define DBCACHE_INIT(path, id_field) {(path), (id_field), 0, 0, 0, NULL, NULL, 0, 0, NULL, NULL}
+
+/// @brief Finds the line of the entry with the given name.
+/// @param db The cache.
+/// @param name The name.
+/// @return The line, which must not be changed, or NULL if it does not exist.
+const char *dbcache_find_name(dbcache_t *db, const char *name);
+
+/// @brief Finds the first line of the entry with the given id.
+/// @param db The cache.
+/// @param id The id.
+/// @return The line, which must not be changed, or NULL if it does not exist.
+const char *dbcache_find_id(dbcache_t *db, unsigned long id);
+
+/// @brief Copies a line, so that it can be parsed in place.
+/// @param line The line, if NULL errno is set to ENOENT.
+/// @param buf The buffer.
+/// @param buflen The size of the buffer.
+/// @return The buffer on success, NULL on failure (errno is set to ERANGE if
+///         the line does not fit).
+char *dbcache_copy(const char *line, char *buf, size_t buflen);
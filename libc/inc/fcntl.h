@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "stddef.h"
+
 /// @name File Access Modes
 /// @brief Defines file access modes for opening files.
 /// @{
@@ -23,9 +25,17 @@
 #define O_TRUNC     00001000U ///< Truncate file to zero length.
 #define O_APPEND    00002000U ///< Set append mode.
 #define O_NONBLOCK  00004000U ///< Enable non-blocking mode.
+#define O_DIRECT    00040000U ///< Transfer straight between the device and the buffer.
 #define O_DIRECTORY 00200000U ///< Open only if it is a directory.
 /// @}
 
+/// @name Directory-Relative Lookups
+/// @brief Arguments of the functions which take a directory, like openat() and fstatat().
+/// @{
+#define AT_FDCWD            (-100)  ///< The lookups start from the current working directory.
+#define AT_SYMLINK_NOFOLLOW 0x0100U ///< Do not follow the symbolic link found at the end of the path.
+/// @}
+
 /// @name fcntl Commands
 /// @brief Commands for the fcntl() function, used for managing file descriptors.
 /// @{
@@ -39,6 +49,9 @@
 #define F_GETLK  7 ///< Get record locking information.
 #define F_SETLK  8 ///< Set record locking information.
 #define F_SETLKW 9 ///< Set record locking info; wait if blocked.
+
+#define F_SETPIPE_SZ 1031 ///< Set the capacity of a pipe.
+#define F_GETPIPE_SZ 1032 ///< Get the capacity of a pipe.
 /// @}
 
 /// @name Lock Operation Flags
@@ -49,9 +62,71 @@
 #define F_UNLCK 3 ///< Unlock.
 /// @}
 
+/// @name Splice Flags
+/// @brief Flags for splice(), tee() and vmsplice().
+/// @{
+#define SPLICE_F_MOVE     0x01 ///< Move the pages instead of copying them (only a hint).
+#define SPLICE_F_NONBLOCK 0x02 ///< Do not block on the pipes.
+#define SPLICE_F_MORE     0x04 ///< More data will be coming (only a hint).
+#define SPLICE_F_GIFT     0x08 ///< The user pages are a gift to the kernel (only a hint).
+/// @}
+
+/// @name File Access Advice
+/// @brief The access patterns announced through posix_fadvise().
+/// @{
+#define POSIX_FADV_NORMAL     0 ///< No particular pattern, the default.
+#define POSIX_FADV_RANDOM     1 ///< The data is accessed randomly, do not read ahead.
+#define POSIX_FADV_SEQUENTIAL 2 ///< The data is accessed sequentially, read ahead as much as possible.
+#define POSIX_FADV_WILLNEED   3 ///< The data will be accessed soon, read it now.
+#define POSIX_FADV_DONTNEED   4 ///< The data will not be accessed soon, drop it from the caches.
+#define POSIX_FADV_NOREUSE    5 ///< The data is accessed only once.
+/// @}
+
 /// @brief Provides control operations on an open file descriptor.
 /// @param fd The file descriptor on which to perform the operation.
 /// @param request The `fcntl` command, defining the operation (e.g., `F_GETFL`, `F_SETFL`).
 /// @param data Additional data required by certain `fcntl` commands (e.g., flags or pointer).
 /// @return Returns 0 on success; on error, returns a negative error code.
 long fcntl(int fd, unsigned int request, unsigned long data);
+
+/// @brief Announces how a range of an open file is going to be accessed, so
+///        that the kernel can read it ahead, or drop it from its caches.
+/// @param fd The file descriptor.
+/// @param offset The start of the range.
+/// @param len The length of the range, 0 to reach the end of the file.
+/// @param advice One of the POSIX_FADV_* values.
+/// @return 0 on success, the error number on failure (errno is not set).
+int posix_fadvise(int fd, off_t offset, off_t len, int advice);
+
+struct iovec;
+
+/// @brief Moves data between a pipe and a file, or between two pipes, without
+/// passing through a user-space buffer. Pages are moved from pipe to pipe.
+/// @param fd_in   The file descriptor we read from.
+/// @param off_in  If not NULL, the offset we read from, which is updated
+///                instead of the offset of `fd_in` (must be NULL for pipes).
+/// @param fd_out  The file descriptor we write to.
+/// @param off_out If not NULL, the offset we write to, which is updated
+///                instead of the offset of `fd_out` (must be NULL for pipes).
+/// @param len     The number of bytes to move.
+/// @param flags   The splice flags, SPLICE_F_NONBLOCK is not supported: use
+///                a pipe in non-blocking mode instead.
+/// @return The number of moved bytes, -1 on failure and errno is set to indicate the error.
+ssize_t splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned int flags);
+
+/// @brief Duplicates the data of a pipe into another pipe, without consuming
+/// it. The two pipes share the pages holding the data.
+/// @param fd_in  The read end of the source pipe.
+/// @param fd_out The write end of the destination pipe.
+/// @param len    The number of bytes to duplicate.
+/// @param flags  The splice flags.
+/// @return The number of duplicated bytes, -1 on failure and errno is set to indicate the error.
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+
+/// @brief Writes a set of user buffers into a pipe.
+/// @param fd      The write end of the pipe.
+/// @param iov     The buffers, written in order.
+/// @param nr_segs The number of buffers.
+/// @param flags   The splice flags.
+/// @return The number of written bytes, -1 on failure and errno is set to indicate the error.
+ssize_t vmsplice(int fd, const struct iovec *iov, unsigned long nr_segs, unsigned int flags);
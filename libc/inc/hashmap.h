@@ -1,63 +1,108 @@
 /// @file hashmap.h
-/// @brief Header file for a hashmap implementation with `char *` keys.
+/// @brief Header file for a hashmap implementation with `char *`, or integer keys.
+/// @details
+/// The map uses open addressing with Robin Hood hashing: the entries, holding
+/// the hash and the key along with the value, are stored inline inside one
+/// array, and an entry which is farther than another from its home slot takes
+/// its place. Lookups compare the hashes first, and then the keys. The array
+/// doubles once it is three quarters full. String keys are not copied, they
+/// must live as long as their entry.
 
 #pragma once
 
 #include <stddef.h>
 
-/// Define the size of the hashmap.
-#define HASHMAP_SIZE 1024
+/// The number of slots of an empty map, the first time an entry is inserted.
+#define HASHMAP_MIN_CAPACITY 16
+
+/// @brief The kind of keys of a map.
+typedef enum hashmap_key_type {
+    HASHMAP_KEY_STRING, ///< The keys are null-terminated strings.
+    HASHMAP_KEY_INT,    ///< The keys are integers.
+} hashmap_key_type_t;
 
 /// @brief Structure representing a hashmap entry.
 typedef struct hashmap_entry {
-    /// The precomputed hash of the key.
+    /// The precomputed hash of the key, 0 if the slot is empty.
     size_t hash;
+    /// The key, either an integer or a pointer to the string.
+    unsigned long key;
     /// The value associated with the key.
     void *value;
-    /// Pointer to the next entry (for handling collisions).
-    struct hashmap_entry *next;
 } hashmap_entry_t;
 
 /// @brief Structure representing the hashmap.
-typedef struct {
-    /// Array of linked lists for separate chaining.
-    hashmap_entry_t *buckets[HASHMAP_SIZE];
-    /// Function to allocate an entry.
-    hashmap_entry_t *(*alloc_entry)(void);
-    /// Function to deallocate an entry.
-    void (*dealloc_entry)(hashmap_entry_t *);
+typedef struct hashmap {
+    /// The slots, NULL until the first entry is inserted.
+    hashmap_entry_t *entries;
+    /// The number of slots, a power of two.
+    size_t capacity;
+    /// The number of entries.
+    size_t count;
+    /// The kind of keys.
+    hashmap_key_type_t key_type;
+    /// Function to allocate the slots.
+    void *(*alloc)(size_t);
+    /// Function to deallocate the slots.
+    void (*dealloc)(void *);
 } hashmap_t;
 
-/// @brief Hash function for generating an index from a key.
+/// @brief Hash function for generating a hash from a string.
 /// @param key The key to hash.
-/// @return The hash index for the key.
+/// @return The hash of the key, never 0.
 size_t hash(const char *key);
 
-/// @brief Initializes the hashmap with custom alloc and dealloc functions for
-/// entries.
+/// @brief Initializes the hashmap, with the functions allocating its slots.
 /// @param map Pointer to the hashmap to initialize.
-/// @param alloc_fn Function to allocate entries, or NULL to use the default.
-/// @param dealloc_fn Function to deallocate entries, or NULL to use the
-/// default.
-void hashmap_init(hashmap_t *map, hashmap_entry_t *(*alloc_fn)(void), void (*dealloc_fn)(hashmap_entry_t *));
+/// @param key_type The kind of keys.
+/// @param alloc_fn Function to allocate the slots (e.g., malloc).
+/// @param dealloc_fn Function to deallocate the slots (e.g., free).
+void hashmap_init(hashmap_t *map, hashmap_key_type_t key_type, void *(*alloc_fn)(size_t), void (*dealloc_fn)(void *));
 
-/// @brief Inserts a key-value pair into the hashmap.
-/// @param map Pointer to the hashmap.
+/// @brief Inserts a key-value pair into the hashmap, or changes the value of the key.
+/// @param map Pointer to the hashmap, with string keys.
 /// @param key The key for the value.
 /// @param value The value to store associated with the key.
-void hashmap_insert(hashmap_t *map, const char *key, void *value);
+/// @return 0 on success, -1 if the map could not grow.
+int hashmap_insert(hashmap_t *map, const char *key, void *value);
 
 /// @brief Retrieves the value associated with a given key.
-/// @param map Pointer to the hashmap.
+/// @param map Pointer to the hashmap, with string keys.
 /// @param key The key to search for.
 /// @return The value associated with the key, or NULL if the key is not found.
 void *hashmap_get(hashmap_t *map, const char *key);
 
 /// @brief Removes a key-value pair from the hashmap.
-/// @param map Pointer to the hashmap.
+/// @param map Pointer to the hashmap, with string keys.
+/// @param key The key to remove.
+/// @return The value which was associated with the key, or NULL if the key is not found.
+void *hashmap_remove(hashmap_t *map, const char *key);
+
+/// @brief Inserts a key-value pair into the hashmap, or changes the value of the key.
+/// @param map Pointer to the hashmap, with integer keys.
+/// @param key The key for the value.
+/// @param value The value to store associated with the key.
+/// @return 0 on success, -1 if the map could not grow.
+int hashmap_insert_int(hashmap_t *map, unsigned long key, void *value);
+
+/// @brief Retrieves the value associated with a given key.
+/// @param map Pointer to the hashmap, with integer keys.
+/// @param key The key to search for.
+/// @return The value associated with the key, or NULL if the key is not found.
+void *hashmap_get_int(hashmap_t *map, unsigned long key);
+
+/// @brief Removes a key-value pair from the hashmap.
+/// @param map Pointer to the hashmap, with integer keys.
 /// @param key The key to remove.
-void hashmap_remove(hashmap_t *map, const char *key);
+/// @return The value which was associated with the key, or NULL if the key is not found.
+void *hashmap_remove_int(hashmap_t *map, unsigned long key);
+
+/// @brief Iterates over the entries of the hashmap, in no particular order.
+/// @param map Pointer to the hashmap, which must not change while iterating.
+/// @param index The position of the iteration, which must start from 0.
+/// @return The next entry, or NULL when there is none left.
+hashmap_entry_t *hashmap_next(hashmap_t *map, size_t *index);
 
 /// @brief Destroys the hashmap and frees all allocated memory.
-/// @param map Pointer to the hashmap to destroy.
+/// @param map Pointer to the hashmap to destroy, which is left empty.
 void hashmap_destroy(hashmap_t *map);
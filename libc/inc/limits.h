@@ -56,8 +56,12 @@
 /// Maximum number of characters in a path name.
 #define PATH_MAX 4096
 
-/// Maximum length of arguments provided to exec function.
-#define ARG_MAX 256
+/// Maximum bytes of the arguments and of the environment provided to exec
+/// functions, strings and pointers included, half of the smallest stack.
+#define ARG_MAX (32 * 1024)
+
+/// Free space a pipe needs before it is reported as writable, and its writers are woken up.
+#define PIPE_BUF 4096
 
 /// Maximum pid number.
 #define PID_MAX_LIMIT 32768
@@ -18,12 +18,15 @@ typedef struct listnode {
     void *value;      ///< Pointer to node's value.
 } listnode_t;
 
+struct arena;
+
 /// @brief Represents the list.
 typedef struct list {
     list_head_t head;              ///< Head of the list.
     unsigned int size;             ///< Size of the list.
     listnode_t *(*alloc)(void);    ///< Node allocation function.
     void (*dealloc)(listnode_t *); ///< Node deallocation function.
+    struct arena *arena;           ///< Arena of the nodes, used instead of the functions if not NULL.
 } list_t;
 
 /// @brief Initializes the list with custom alloc and dealloc functions.
@@ -32,6 +35,13 @@ typedef struct list {
 /// @param dealloc_fn Function to deallocate nodes.
 void list_init(list_t *list, listnode_t *(*alloc_fn)(void), void (*dealloc_fn)(listnode_t *));
 
+#ifndef __KERNEL__
+/// @brief Initializes the list, whose nodes are allocated from an arena.
+/// @param list The list to initialize.
+/// @param arena The arena, the nodes are freed when it is reset.
+void list_init_arena(list_t *list, struct arena *arena);
+#endif
+
 /// @brief Returns the size of the list.
 /// @param list The list to get the size of.
 /// @return The number of elements in the list.
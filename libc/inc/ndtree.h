@@ -34,6 +34,8 @@ typedef ndtree_node_t *(*ndtree_alloc_node_f)(void *value);
 /// @param node The node to deallocate.
 typedef void (*ndtree_free_node_f)(ndtree_node_t *node);
 
+struct arena;
+
 /// @brief Stores data about an NDTree.
 typedef struct ndtree {
     unsigned size;                      ///< Size of the tree.
@@ -42,6 +44,7 @@ typedef struct ndtree {
     ndtree_tree_compare_f compare_node; ///< Custom node comparison.
     ndtree_alloc_node_f alloc_node;     ///< Custom allocator for nodes.
     ndtree_free_node_f free_node;       ///< Custom deallocator for nodes.
+    struct arena *arena;                ///< Arena of the nodes, used instead of the functions if not NULL.
 } ndtree_t;
 
 /// @brief Initializes a tree with comparison, allocation, and deallocation functions.
@@ -55,6 +58,14 @@ void ndtree_tree_init(
     ndtree_alloc_node_f alloc_node,
     ndtree_free_node_f free_node);
 
+#ifndef __KERNEL__
+/// @brief Initializes a tree, whose nodes are allocated from an arena.
+/// @param tree The tree to initialize (already allocated by the user).
+/// @param compare_node Comparison function for nodes.
+/// @param arena The arena, the nodes are freed when it is reset.
+void ndtree_tree_init_arena(ndtree_t *tree, ndtree_tree_compare_f compare_node, struct arena *arena);
+#endif
+
 /// @brief Initializes a tree node with a given value.
 /// @param node The node to initialize.
 /// @param value The value to store in the node.
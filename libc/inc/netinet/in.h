@@ -0,0 +1,63 @@
+/// @file in.h
+/// @brief Names of the Internet (AF_INET) sockets, and the byte order of the network.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+#include "sys/socket.h"
+
+/// @brief An IPv4 address, in network byte order.
+typedef uint32_t in_addr_t;
+
+/// @brief A port, in network byte order.
+typedef uint16_t in_port_t;
+
+/// @name Protocols
+/// @{
+#define IPPROTO_IP   0  ///< The default protocol of the type of the socket.
+#define IPPROTO_ICMP 1  ///< Internet Control Message Protocol.
+#define IPPROTO_TCP  6  ///< Transmission Control Protocol.
+#define IPPROTO_UDP  17 ///< User Datagram Protocol.
+/// @}
+
+/// @name Special addresses, in host byte order
+/// @{
+#define INADDR_ANY       ((in_addr_t)0x00000000) ///< Any local address.
+#define INADDR_BROADCAST ((in_addr_t)0xFFFFFFFF) ///< The broadcast address of the local network.
+#define INADDR_LOOPBACK  ((in_addr_t)0x7F000001) ///< The loopback address, 127.0.0.1.
+/// @}
+
+/// @brief An IPv4 address.
+struct in_addr {
+    in_addr_t s_addr; ///< The address, in network byte order.
+};
+
+/// @brief The name of an Internet socket.
+struct sockaddr_in {
+    sa_family_t sin_family;    ///< The address family (AF_INET).
+    in_port_t sin_port;        ///< The port, in network byte order.
+    struct in_addr sin_addr;   ///< The address.
+    unsigned char sin_zero[8]; ///< Padding, up to the size of a `struct sockaddr`.
+};
+
+/// @brief Converts a 16-bit value from host to network byte order.
+/// @param value the value.
+/// @return the converted value.
+static inline uint16_t htons(uint16_t value) { return (uint16_t)((value << 8U) | (value >> 8U)); }
+
+/// @brief Converts a 16-bit value from network to host byte order.
+/// @param value the value.
+/// @return the converted value.
+static inline uint16_t ntohs(uint16_t value) { return htons(value); }
+
+/// @brief Converts a 32-bit value from host to network byte order.
+/// @param value the value.
+/// @return the converted value.
+static inline uint32_t htonl(uint32_t value) { return __builtin_bswap32(value); }
+
+/// @brief Converts a 32-bit value from network to host byte order.
+/// @param value the value.
+/// @return the converted value.
+static inline uint32_t ntohl(uint32_t value) { return htonl(value); }
@@ -0,0 +1,154 @@
+/// @file pthread.h
+/// @brief POSIX threads.
+/// @details
+/// The threads are created with clone(), and share the memory, the file
+/// descriptors and the signal handlers of their process. The descriptor of
+/// each thread is the start of its thread-local storage, which the `%gs`
+/// segment register selects. Joining a thread, and waiting for a mutex,
+/// sleep on a futex.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "sys/types.h"
+
+/// The smallest stack a thread can have.
+#define PTHREAD_STACK_MIN (16 * 1024)
+
+/// Initializes a mutex, which is unlocked.
+#define PTHREAD_MUTEX_INITIALIZER { 0 }
+
+/// @name Mutex protocols
+/// @{
+#define PTHREAD_PRIO_NONE    0 ///< The owner keeps its own priority.
+#define PTHREAD_PRIO_INHERIT 1 ///< The owner inherits the priority of the threads waiting for it.
+/// @}
+
+/// @brief A thread, it points at the descriptor of the thread.
+typedef struct pthread *pthread_t;
+
+/// @brief The attributes of a new thread.
+typedef struct pthread_attr {
+    /// The size of the stack of the thread.
+    size_t stack_size;
+} pthread_attr_t;
+
+/// @brief A mutex, which can be used by the threads of a process.
+typedef struct pthread_mutex {
+    /// 0 if unlocked, 1 if locked, 2 if locked and some threads might be
+    /// waiting. With PTHREAD_PRIO_INHERIT, the id of the owner, and
+    /// FUTEX_WAITERS if some threads might be waiting.
+    int state;
+    /// The protocol of the mutex.
+    int protocol;
+} pthread_mutex_t;
+
+/// @brief The attributes of a mutex, only the default (normal) type exists.
+typedef struct pthread_mutexattr {
+    /// The type of the mutex.
+    int type;
+    /// The protocol of the mutex, PTHREAD_PRIO_NONE or PTHREAD_PRIO_INHERIT.
+    int protocol;
+} pthread_mutexattr_t;
+
+/// @brief Initializes the attributes of a thread with the default ones.
+/// @param attr the attributes.
+/// @return 0 on success, an error number on failure.
+int pthread_attr_init(pthread_attr_t *attr);
+
+/// @brief Destroys the attributes of a thread.
+/// @param attr the attributes.
+/// @return 0 on success, an error number on failure.
+int pthread_attr_destroy(pthread_attr_t *attr);
+
+/// @brief Sets the size of the stack of a thread.
+/// @param attr the attributes.
+/// @param stacksize the size, at least PTHREAD_STACK_MIN.
+/// @return 0 on success, EINVAL if the size is too small.
+int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize);
+
+/// @brief Gets the size of the stack of a thread.
+/// @param attr the attributes.
+/// @param stacksize where the size is stored.
+/// @return 0 on success, an error number on failure.
+int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize);
+
+/// @brief Creates a thread, which runs `start_routine(arg)`.
+/// @param thread where the new thread is stored.
+/// @param attr the attributes of the thread, NULL for the default ones.
+/// @param start_routine the function run by the thread, the thread exits
+/// once it returns, with its return value.
+/// @param arg the argument of the function.
+/// @return 0 on success, an error number on failure.
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg);
+
+/// @brief Waits for a thread to exit, and frees it.
+/// @param thread the thread.
+/// @param retval where the value the thread exited with is stored, if not NULL.
+/// @return 0 on success, an error number on failure.
+int pthread_join(pthread_t thread, void **retval);
+
+/// @brief Terminates the calling thread, the process exits with its last thread.
+/// @param retval the value returned to the thread joining it.
+void pthread_exit(void *retval);
+
+/// @brief Returns the calling thread.
+/// @return the thread.
+pthread_t pthread_self(void);
+
+/// @brief Compares two threads.
+/// @param t1 the first thread.
+/// @param t2 the second thread.
+/// @return non-zero if they are the same thread, 0 otherwise.
+int pthread_equal(pthread_t t1, pthread_t t2);
+
+/// @brief Initializes the attributes of a mutex with the default ones.
+/// @param attr the attributes.
+/// @return 0 on success, an error number on failure.
+int pthread_mutexattr_init(pthread_mutexattr_t *attr);
+
+/// @brief Destroys the attributes of a mutex.
+/// @param attr the attributes.
+/// @return 0 on success, an error number on failure.
+int pthread_mutexattr_destroy(pthread_mutexattr_t *attr);
+
+/// @brief Sets the protocol of a mutex.
+/// @param attr the attributes.
+/// @param protocol PTHREAD_PRIO_NONE, or PTHREAD_PRIO_INHERIT for the owner
+/// to run with the priority of the threads waiting for it, if higher.
+/// @return 0 on success, EINVAL if the protocol is not supported.
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
+
+/// @brief Gets the protocol of a mutex.
+/// @param attr the attributes.
+/// @param protocol where the protocol is stored.
+/// @return 0 on success, an error number on failure.
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol);
+
+/// @brief Initializes a mutex, which is unlocked.
+/// @param mutex the mutex.
+/// @param attr the attributes of the mutex, NULL for the default ones.
+/// @return 0 on success, an error number on failure.
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+
+/// @brief Destroys a mutex, which must be unlocked.
+/// @param mutex the mutex.
+/// @return 0 on success, EBUSY if it is locked.
+int pthread_mutex_destroy(pthread_mutex_t *mutex);
+
+/// @brief Locks a mutex, sleeping while another thread holds it.
+/// @param mutex the mutex.
+/// @return 0 on success, an error number on failure.
+int pthread_mutex_lock(pthread_mutex_t *mutex);
+
+/// @brief Locks a mutex, if no other thread holds it.
+/// @param mutex the mutex.
+/// @return 0 on success, EBUSY if it is already locked.
+int pthread_mutex_trylock(pthread_mutex_t *mutex);
+
+/// @brief Unlocks a mutex, and wakes up a thread waiting for it.
+/// @param mutex the mutex.
+/// @return 0 on success, an error number on failure.
+int pthread_mutex_unlock(pthread_mutex_t *mutex);
@@ -1,11 +1,16 @@
 /// @file readline.h
-/// @brief
+/// @brief Reading of the lines of a file descriptor.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
+#pragma once
+
 #include "stddef.h"
 
 /// @brief Reads a line from the given file descriptor into the buffer.
+/// @details The bytes read past the newline are kept for the next call, the
+/// newline itself is not stored. A line longer than the buffer is returned in
+/// pieces.
 /// @param fd The file descriptor to read from.
 /// @param buffer The buffer where the read line will be stored. Must not be NULL.
 /// @param buflen The size of the buffer.
@@ -14,3 +19,7 @@
 ///         0 if the end of the file was reached,
 ///        -1 if no newline was found and partial data was read.
 int readline(int fd, char *buffer, size_t buflen, ssize_t *read_len);
+
+/// @brief Drops what was read ahead from the file descriptor, once it is closed.
+/// @param fd The file descriptor.
+void readline_release(int fd);
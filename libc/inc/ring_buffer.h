@@ -425,3 +425,57 @@
             callback(&item);                                                                                           \
         }                                                                                                              \
     }
+
+/// @brief Declares a fixed-size ring buffer, shared by a single producer and
+/// a single consumer without any lock: only the producer moves the head, by
+/// pushing, and only the consumer moves the tail, by popping or peeking the
+/// oldest element. A push fails, rather than overwriting, when the buffer is
+/// full. The length must be a power of two.
+#define DECLARE_SPSC_RING_BUFFER(type, name, length, init)                                                             \
+    typedef struct {                                                                                                   \
+        type buffer[length];                                                                                           \
+        unsigned head;                                                                                                 \
+        unsigned tail;                                                                                                 \
+    } rb_##name##_t;                                                                                                   \
+                                                                                                                       \
+    static inline void rb_##name##_init(rb_##name##_t *rb)                                                             \
+    {                                                                                                                  \
+        rb->head = 0;                                                                                                  \
+        rb->tail = 0;                                                                                                  \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline unsigned rb_##name##_is_empty(rb_##name##_t *rb)                                                     \
+    {                                                                                                                  \
+        return __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);           \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline int rb_##name##_push(rb_##name##_t *rb, type item)                                                   \
+    {                                                                                                                  \
+        unsigned head = rb->head;                                                                                      \
+        if ((head - __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE)) == (length)) {                                       \
+            return 0;                                                                                                  \
+        }                                                                                                              \
+        rb->buffer[head & ((length) - 1)] = item;                                                                      \
+        __atomic_store_n(&rb->head, head + 1, __ATOMIC_RELEASE);                                                       \
+        return 1;                                                                                                      \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline type rb_##name##_pop(rb_##name##_t *rb)                                                              \
+    {                                                                                                                  \
+        unsigned tail = rb->tail;                                                                                      \
+        if (__atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) == tail) {                                                    \
+            return init;                                                                                               \
+        }                                                                                                              \
+        type item = rb->buffer[tail & ((length) - 1)];                                                                 \
+        __atomic_store_n(&rb->tail, tail + 1, __ATOMIC_RELEASE);                                                       \
+        return item;                                                                                                   \
+    }                                                                                                                  \
+                                                                                                                       \
+    static inline type rb_##name##_peek(rb_##name##_t *rb)                                                             \
+    {                                                                                                                  \
+        unsigned tail = rb->tail;                                                                                      \
+        if (__atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) == tail) {                                                    \
+            return init;                                                                                               \
+        }                                                                                                              \
+        return rb->buffer[tail & ((length) - 1)];                                                                      \
+    }
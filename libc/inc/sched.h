@@ -3,10 +3,20 @@
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
+#include "bits/clone.h"
 #include "stdbool.h"
 #include "sys/types.h"
 #include "time.h"
 
+/// @brief The scheduling policies, each one handled by a scheduling class.
+/// The classes are ordered: a process runs only when no process of the
+/// classes before its own can run.
+#define SCHED_OTHER    0 ///< The default class, handled by the algorithm chosen at build time.
+#define SCHED_FIFO     1 ///< Real-time class, runs until it stops or a higher priority process wakes up.
+#define SCHED_RR       2 ///< Real-time class, takes turns with the processes of the same priority.
+#define SCHED_IDLE     5 ///< Runs only when no other process can run.
+#define SCHED_DEADLINE 6 ///< Periodic processes, the one with the earliest deadline runs first.
+
 /// @brief Structure that describes scheduling parameters.
 typedef struct sched_param {
     /// Static execution priority.
@@ -37,7 +47,44 @@ int sched_setparam(pid_t pid, const sched_param_t *param);
 /// @return 0 on success, -1 on failure and errno is set to indicate the error.
 int sched_getparam(pid_t pid, sched_param_t *param);
 
+/// @brief Sets the scheduling policy and parameters of a process.
+/// @param pid pid of the process, if zero the calling process.
+/// @param policy the policy (SCHED_OTHER, SCHED_FIFO, SCHED_RR, SCHED_IDLE or
+/// SCHED_DEADLINE). Real-time policies take a sched_priority below 100, the
+/// others one between 100 and 139. SCHED_DEADLINE needs a period.
+/// @param param the parameters of the process.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int sched_setscheduler(pid_t pid, int policy, const sched_param_t *param);
+
+/// @brief Gets the scheduling policy of a process.
+/// @param pid pid of the process, if zero the calling process.
+/// @return the policy on success, -1 on failure and errno is set to indicate the error.
+int sched_getscheduler(pid_t pid);
+
+/// @brief Gives the CPU to the other processes.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int sched_yield(void);
+
 /// @brief Placed at the end of an infinite while loop, stops the process until,
 /// its next period starts. The calling process must be a periodic one.
 /// @return 0 on success, -1 on failure and errno is set to indicate the error.
 int waitperiod(void);
+
+/// @brief Creates a new process, or a new thread, which runs `fn(arg)` on
+/// the given stack, and exits once the function returns.
+/// @param fn the function run by the child, its return value is the exit status.
+/// @param stack the top of the stack of the child.
+/// @param flags what the child shares with the caller (CLONE_*), and the
+/// signal sent to the caller once the child terminates (CSIGNAL).
+/// @param arg the argument of the function.
+/// @param ... `pid_t *ptid, struct user_desc *tls, pid_t *ctid`, used when the
+/// flags ask for them (CLONE_PARENT_SETTID, CLONE_SETTLS, CLONE_CHILD_SETTID
+/// and CLONE_CHILD_CLEARTID).
+/// @return the id of the child on success, -1 on failure and errno is set to indicate the error.
+int clone(int (*fn)(void *), void *stack, int flags, void *arg, ...);
+
+/// @brief Sets the segment of the thread-local storage of the calling thread.
+/// @param u_info the segment, the entry of the GDT chosen by the kernel is
+/// written back inside `entry_number`.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int set_thread_area(struct user_desc *u_info);
@@ -8,6 +8,8 @@
 #include "stddef.h"
 #include "sys/types.h"
 
+struct timespec;
+
 /// @brief List of signals.
 typedef enum {
     SIGHUP  = 1, ///< Hang up detected on controlling terminal or death of controlling process.
@@ -42,7 +44,9 @@ typedef enum {
     SIGPROF   = 29, ///< Profiling timer expired.
     SIGXCPU   = 30, ///< CPU time limit exceeded.
     SIGXFSZ   = 31, ///< File size limit exceeded.
-    NSIG      = 32
+    SIGRTMIN  = 32, ///< The first real-time signal, real-time signals are queued.
+    SIGRTMAX  = 63, ///< The last real-time signal.
+    NSIG      = 64
 } signal_type_t;
 
 /// @brief Codes that indentify the sender of a signal.
@@ -209,8 +213,9 @@ typedef struct siginfo {
     int si_band;
 } siginfo_t;
 
-/// @brief Send signal to a process.
-/// @param pid The pid of the process to which we send the signal.
+/// @brief Send signal to a process, or to a process group.
+/// @param pid The pid of the process to which we send the signal, 0 for the
+///            group of the caller, or minus the group.
 /// @param sig The type of signal to send.
 /// @return On success 0, on error -1 and errno is set appropriately.
 int kill(pid_t pid, int sig);
@@ -239,6 +244,34 @@ int sigaction(int signum, const sigaction_t *act, sigaction_t *oldact);
 ///  nevertheless returned in oldset (if it is not NULL).
 int sigprocmask(int how, const sigset_t *set, sigset_t *oldset);
 
+/// @brief Queues a signal, along with a value, to a process.
+/// @param pid   The process.
+/// @param sig   The signal, real-time signals are queued even if already pending.
+/// @param value The value, received inside the si_value of the signal information.
+/// @return 0 on success, -1 on error and errno is set (EAGAIN if the queue of
+///         the process is full).
+int sigqueue(pid_t pid, int sig, const union sigval value);
+
+/// @brief Waits for one of the given signals, and takes it without running its handler.
+/// @param set     The signals to wait for, which should be blocked by sigprocmask().
+/// @param info    If non-NULL, where the information of the signal is stored.
+/// @param timeout The maximum time to wait, NULL to wait forever.
+/// @return The signal on success, -1 on error and errno is set (EAGAIN if the
+///         timeout expired, EINTR if another signal interrupted the wait).
+int sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout);
+
+/// @brief Waits for one of the given signals, and takes it without running its handler.
+/// @param set  The signals to wait for, which should be blocked by sigprocmask().
+/// @param info If non-NULL, where the information of the signal is stored.
+/// @return The signal on success, -1 on error and errno is set to indicate the error.
+int sigwaitinfo(const sigset_t *set, siginfo_t *info);
+
+/// @brief Waits for one of the given signals, and takes it without running its handler.
+/// @param set The signals to wait for, which should be blocked by sigprocmask().
+/// @param sig Where the signal is stored.
+/// @return 0 on success, a positive error number on failure.
+int sigwait(const sigset_t *set, int *sig);
+
 /// @brief Returns the string describing the given signal.
 /// @param sig The signal to inquire.
 /// @return String representing the signal.
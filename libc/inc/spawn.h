@@ -0,0 +1,160 @@
+/// @file spawn.h
+/// @brief Creation of processes running a new program.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "sys/types.h"
+
+#ifdef __KERNEL__
+#include "system/signal.h"
+#else
+#include "signal.h"
+#endif
+
+/// @name Spawn attribute flags
+/// @{
+#define POSIX_SPAWN_SETPGROUP  0x01 ///< Places the process inside the process group of the attributes.
+#define POSIX_SPAWN_SETSIGDEF  0x04 ///< Resets the signals of the attributes to their default action.
+#define POSIX_SPAWN_SETSIGMASK 0x08 ///< Sets the signal mask of the process to the one of the attributes.
+/// @}
+
+/// @name Spawn file action types
+/// @{
+#define POSIX_SPAWN_OPEN  1 ///< Opens a file on a file descriptor.
+#define POSIX_SPAWN_CLOSE 2 ///< Closes a file descriptor.
+#define POSIX_SPAWN_DUP2  3 ///< Duplicates a file descriptor on another one.
+/// @}
+
+/// @brief An action performed on the file descriptors of the new process.
+typedef struct posix_spawn_file_action {
+    /// The type of action (POSIX_SPAWN_OPEN, POSIX_SPAWN_CLOSE, POSIX_SPAWN_DUP2).
+    int type;
+    /// The file descriptor which is opened, closed, or duplicated.
+    int fd;
+    /// The file descriptor the duplicate is placed on.
+    int newfd;
+    /// The flags used to open the file.
+    int oflag;
+    /// The mode used to create the file.
+    mode_t mode;
+    /// The path of the file.
+    char *path;
+} posix_spawn_file_action_t;
+
+/// @brief The actions performed, in order, on the file descriptors of the new process.
+typedef struct posix_spawn_file_actions {
+    /// The number of actions.
+    int count;
+    /// The number of actions the list can hold.
+    int capacity;
+    /// The list of actions.
+    posix_spawn_file_action_t *actions;
+} posix_spawn_file_actions_t;
+
+/// @brief The attributes of the new process.
+typedef struct posix_spawnattr {
+    /// The attributes which are used (POSIX_SPAWN_*).
+    short flags;
+    /// The process group, 0 to create a new one lead by the process.
+    pid_t pgroup;
+    /// The signal mask.
+    sigset_t sigmask;
+    /// The signals reset to their default action.
+    sigset_t sigdefault;
+} posix_spawnattr_t;
+
+/// @brief Creates a new process running the given program, without copying
+///        the address space of the caller.
+/// @param pid          Where the process ID of the new process is stored, if not NULL.
+/// @param path         The path of the program.
+/// @param file_actions The actions performed on the file descriptors, if not NULL.
+/// @param attrp        The attributes of the new process, if not NULL.
+/// @param argv         The arguments of the program.
+/// @param envp         The environment of the program.
+/// @return 0 on success, the error number on failure.
+int posix_spawn(
+    pid_t *pid, const char *path, const posix_spawn_file_actions_t *file_actions, const posix_spawnattr_t *attrp,
+    char *const argv[], char *const envp[]);
+
+/// @brief Like posix_spawn(), but searches the program inside the PATH
+///        environmental variable, when its name does not contain a slash.
+/// @param pid          Where the process ID of the new process is stored, if not NULL.
+/// @param file         The name of the program.
+/// @param file_actions The actions performed on the file descriptors, if not NULL.
+/// @param attrp        The attributes of the new process, if not NULL.
+/// @param argv         The arguments of the program.
+/// @param envp         The environment of the program.
+/// @return 0 on success, the error number on failure.
+int posix_spawnp(
+    pid_t *pid, const char *file, const posix_spawn_file_actions_t *file_actions, const posix_spawnattr_t *attrp,
+    char *const argv[], char *const envp[]);
+
+/// @brief Initializes an empty list of file actions.
+/// @param file_actions The list.
+/// @return 0 on success, the error number on failure.
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *file_actions);
+
+/// @brief Frees a list of file actions.
+/// @param file_actions The list.
+/// @return 0 on success, the error number on failure.
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *file_actions);
+
+/// @brief Adds the opening of a file to a list of file actions.
+/// @param file_actions The list.
+/// @param fd           The file descriptor the file is opened on.
+/// @param path         The path of the file, which is copied.
+/// @param oflag        The flags used to open the file.
+/// @param mode         The mode used to create the file.
+/// @return 0 on success, the error number on failure.
+int posix_spawn_file_actions_addopen(
+    posix_spawn_file_actions_t *file_actions, int fd, const char *path, int oflag, mode_t mode);
+
+/// @brief Adds the closing of a file descriptor to a list of file actions.
+/// @param file_actions The list.
+/// @param fd           The file descriptor.
+/// @return 0 on success, the error number on failure.
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *file_actions, int fd);
+
+/// @brief Adds the duplication of a file descriptor to a list of file actions.
+/// @param file_actions The list.
+/// @param fd           The file descriptor to duplicate.
+/// @param newfd        The file descriptor the duplicate is placed on.
+/// @return 0 on success, the error number on failure.
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *file_actions, int fd, int newfd);
+
+/// @brief Initializes the attributes of a new process, none of which is used.
+/// @param attr The attributes.
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_init(posix_spawnattr_t *attr);
+
+/// @brief Frees the attributes of a new process.
+/// @param attr The attributes.
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_destroy(posix_spawnattr_t *attr);
+
+/// @brief Sets the attributes which are used.
+/// @param attr  The attributes.
+/// @param flags The flags of the used attributes (POSIX_SPAWN_*).
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_setflags(posix_spawnattr_t *attr, short flags);
+
+/// @brief Sets the process group of the new process.
+/// @param attr   The attributes.
+/// @param pgroup The process group, 0 to create a new one.
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_setpgroup(posix_spawnattr_t *attr, pid_t pgroup);
+
+/// @brief Sets the signal mask of the new process.
+/// @param attr    The attributes.
+/// @param sigmask The signal mask.
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_setsigmask(posix_spawnattr_t *attr, const sigset_t *sigmask);
+
+/// @brief Sets the signals whose action is reset to the default one.
+/// @param attr       The attributes.
+/// @param sigdefault The signals.
+/// @return 0 on success, the error number on failure.
+int posix_spawnattr_setsigdefault(posix_spawnattr_t *attr, const sigset_t *sigdefault);
@@ -6,10 +6,10 @@
 #pragma once
 
 /// @brief Define the signed 64-bit integer.
-typedef int int64_t;
+typedef long long int64_t;
 
 /// @brief Define the unsigned 64-bit integer.
-typedef unsigned int uint64_t;
+typedef unsigned long long uint64_t;
 
 /// @brief Define the signed 32-bit integer.
 typedef int int32_t;
@@ -23,12 +23,108 @@
 #define SEEK_END 2 ///< The file offset is set to the size of the file plus offset bytes.
 
 #ifndef __KERNEL__
+#define _IOFBF 0 ///< Fully buffered, the buffer is written once full.
+#define _IOLBF 1 ///< Line buffered, the buffer is also written at each newline.
+#define _IONBF 2 ///< Unbuffered, each write goes to the file at once.
+
+/// @brief The number of streams which can be opened at once, stdin, stdout and stderr included.
+#define FOPEN_MAX 16
+
+/// @brief A buffered stream, on top of a file descriptor.
+typedef struct __stdio_file FILE;
+
+extern FILE *stdin;  ///< The standard input, line buffered.
+extern FILE *stdout; ///< The standard output, line buffered.
+extern FILE *stderr; ///< The standard error, unbuffered.
+
+/// @brief Opens the file and associates a stream with it.
+/// @param path The path of the file.
+/// @param mode "r", "w" or "a", followed by an optional "+" (and "b", which is ignored).
+/// @return The stream, or NULL on failure, with errno set.
+FILE *fopen(const char *path, const char *mode);
+
+/// @brief Associates a stream with an open file descriptor.
+/// @param fd The file descriptor.
+/// @param mode The mode, as for fopen(), which must be allowed by the file descriptor.
+/// @return The stream, or NULL on failure, with errno set.
+FILE *fdopen(int fd, const char *mode);
+
+/// @brief Flushes the stream, and closes its file descriptor.
+/// @param stream The stream.
+/// @return 0 on success, EOF on failure.
+int fclose(FILE *stream);
+
+/// @brief Reads nmemb elements of the given size from the stream.
+/// @param ptr Where the elements are stored.
+/// @param size The size of an element.
+/// @param nmemb The number of elements.
+/// @param stream The stream.
+/// @return The number of elements read, less than nmemb on end-of-file or error.
+size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream);
+
+/// @brief Writes nmemb elements of the given size to the stream.
+/// @param ptr The elements.
+/// @param size The size of an element.
+/// @param nmemb The number of elements.
+/// @param stream The stream.
+/// @return The number of elements written, less than nmemb on error.
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
+
+/// @brief Writes the data buffered by the stream to its file.
+/// @param stream The stream, or NULL to flush all the open streams.
+/// @return 0 on success, EOF on failure.
+int fflush(FILE *stream);
+
+/// @brief Changes the buffering of the stream, before any other operation on it.
+/// @param stream The stream.
+/// @param buf The buffer, or NULL to allocate one.
+/// @param mode _IOFBF, _IOLBF or _IONBF.
+/// @param size The size of the buffer.
+/// @return 0 on success, non-zero on failure.
+int setvbuf(FILE *stream, char *buf, int mode, size_t size);
+
+/// @brief Same as setvbuf, with a buffer of BUFSIZ bytes, or unbuffered if buf is NULL.
+/// @param stream The stream.
+/// @param buf The buffer.
+void setbuf(FILE *stream, char *buf);
+
+/// @brief Returns the file descriptor of the stream.
+/// @param stream The stream.
+/// @return The file descriptor.
+int fileno(FILE *stream);
+
+/// @brief Checks if the end of the file was reached while reading the stream.
+/// @param stream The stream.
+/// @return Non-zero if so, 0 otherwise.
+int feof(FILE *stream);
+
+/// @brief Checks if an error happened on the stream.
+/// @param stream The stream.
+/// @return Non-zero if so, 0 otherwise.
+int ferror(FILE *stream);
+
+/// @brief Clears the end-of-file and the error indicators of the stream.
+/// @param stream The stream.
+void clearerr(FILE *stream);
+
+/// @brief Writes a character to the stream.
+/// @param c The character.
+/// @param stream The stream.
+/// @return The character written, or EOF on failure.
+int fputc(int c, FILE *stream);
+
+/// @brief Writes a string to the stream, without its terminator.
+/// @param str The string.
+/// @param stream The stream.
+/// @return A non-negative number on success, or EOF on failure.
+int fputs(const char *str, FILE *stream);
+
 /// @brief Writes the given character to the standard output (stdout).
 /// @param character The character to send to stdout.
 void putchar(int character);
 
-/// @brief Writes the string pointed by str to the standard output (stdout)
-///        and appends a newline character.
+/// @brief Writes the string pointed by str to the standard output (stdout),
+///        without appending a newline character.
 /// @param str The string to send to stdout.
 void puts(const char *str);
 
@@ -41,17 +137,32 @@ int getchar(void);
 /// @return The string received from standard input.
 char *gets(char *str);
 
-/// @brief Same as getchar but reads from the given file descriptor.
-/// @param fd The file descriptor from which it reads.
-/// @return The read character.
-int fgetc(int fd);
+/// @brief Reads the next character from the stream.
+/// @param stream The stream.
+/// @return The character, as an unsigned char, or EOF on end-of-file or error.
+int fgetc(FILE *stream);
 
-/// @brief Same as gets but reads from the given file descriptor.
+/// @brief Reads a line from the stream, newline included.
 /// @param buf The buffer where the string should be placed.
-/// @param n   The amount of characters to read.
-/// @param fd  The file descriptor from which it reads.
-/// @return The read string.
-char *fgets(char *buf, int n, int fd);
+/// @param n   The size of the buffer, terminator included.
+/// @param stream The stream.
+/// @return The read string, or NULL if nothing was read.
+char *fgets(char *buf, int n, FILE *stream);
+
+/// @brief Reads from the stream up to the delimiter, which is included.
+/// @param lineptr Where the line is stored, grown with realloc() as needed.
+/// @param n The size of the buffer of the line, updated along with it.
+/// @param delim The delimiter.
+/// @param stream The stream.
+/// @return The number of bytes read, -1 on end-of-file or error.
+ssize_t getdelim(char **lineptr, size_t *n, int delim, FILE *stream);
+
+/// @brief Reads a line from the stream, newline included.
+/// @param lineptr Where the line is stored, grown with realloc() as needed.
+/// @param n The size of the buffer of the line, updated along with it.
+/// @param stream The stream.
+/// @return The number of bytes read, -1 on end-of-file or error.
+ssize_t getline(char **lineptr, size_t *n, FILE *stream);
 #endif
 
 /// @brief Convert the given string to an integer.
@@ -92,23 +203,61 @@ int sprintf(char *str, const char *format, ...);
 int snprintf(char *str, size_t size, const char *format, ...);
 
 #ifndef __KERNEL__
-/// @brief Write formatted output to a file.
+/// @brief Write formatted output to a stream.
+/// @param stream The stream.
+/// @param format  Format string, following the same specifications as printf.
+/// @param ... The list of arguments.
+/// @return On success, the total number of characters written is returned.
+///         On failure, a negative number is returned.
+int fprintf(FILE *stream, const char *format, ...);
+
+/// @brief Write formatted data from variable argument list to a stream.
+/// @param stream The stream.
+/// @param format  Format string, following the same specifications as printf.
+/// @param args A variable arguments list.
+/// @return On success, the total number of characters written is returned.
+///         On failure, a negative number is returned.
+int vfprintf(FILE *stream, const char *format, va_list args);
+
+/// @brief Write formatted output to a file, without buffering.
 /// @param fd  The file descriptor associated with the file.
 /// @param format  Format string, following the same specifications as printf.
 /// @param ... The list of arguments.
 /// @return On success, the total number of characters written is returned.
 ///         On failure, a negative number is returned.
-int fprintf(int fd, const char *format, ...);
+int dprintf(int fd, const char *format, ...);
 
-/// @brief Write formatted data from variable argument list to a file.
+/// @brief Write formatted data from variable argument list to a file, without buffering.
 /// @param fd  The file descriptor associated with the file.
 /// @param format  Format string, following the same specifications as printf.
 /// @param args A variable arguments list.
 /// @return On success, the total number of characters written is returned.
 ///         On failure, a negative number is returned.
-int vfprintf(int fd, const char *format, va_list args);
+int vdprintf(int fd, const char *format, va_list args);
 #endif
 
+/// @brief Where the formatted characters go: they are gathered inside a
+/// buffer, which is handed to a function each time it fills up, and at the end.
+typedef struct printf_sink {
+    char *buffer;  ///< Where the characters are gathered.
+    size_t size;   ///< The size of the buffer.
+    size_t length; ///< The number of characters inside the buffer.
+    size_t count;  ///< The number of characters formatted so far.
+    int error;     ///< Set when the function fails to take the characters.
+    /// Takes the characters inside the buffer, returning 0 on success and -1
+    /// on failure. Without it, the characters which do not fit are dropped.
+    int (*flush)(struct printf_sink *sink);
+    /// The data of the function (e.g., the stream).
+    void *data;
+} printf_sink_t;
+
+/// @brief Formats the arguments into the sink, which all printf functions use.
+/// @param sink Where the characters go.
+/// @param format The format string.
+/// @param args The argument list for the format specifiers.
+/// @return The number of characters formatted, or -1 if the sink failed to take them.
+int vprintf_sink(printf_sink_t *sink, const char *format, va_list args);
+
 /// @brief Formats a string and ensures buffer boundaries are respected.
 /// @param str The output buffer where the formatted string will be stored.
 /// @param size The maximum size of the output buffer.
@@ -143,13 +292,13 @@ int scanf(const char *format, ...);
 ///         argument list successfully filled. EOF otherwise.
 int sscanf(const char *str, const char *format, ...);
 
-/// @brief The same as sscanf but the source is a file.
-/// @param fd  The file descriptor associated with the file.
+/// @brief The same as sscanf but the source is a line of the stream.
+/// @param stream The stream.
 /// @param format  Format string, following the same specifications as printf.
 /// @param ... The list of arguments where the values are stored.
 /// @return On success, the function returns the number of items of the
 ///         argument list successfully filled. EOF otherwise.
-int fscanf(int fd, const char *format, ...);
+int fscanf(FILE *stream, const char *format, ...);
 #endif
 
 /// @brief Prints a system error message.
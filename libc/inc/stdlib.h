@@ -21,7 +21,7 @@ size_t malloc_usable_size(void *ptr);
 /// @brief Provides dynamically allocated memory.
 /// @param size The amount of memory to allocate.
 /// @return A pointer to the allocated memory.
-void *malloc(unsigned int size);
+void *malloc(size_t size);
 
 /// @brief Allocates a block of memory for an array of num elements.
 /// @param num  The number of elements.
@@ -0,0 +1,40 @@
+/// @file auxv.h
+/// @brief The auxiliary vector, what the kernel tells a program when it starts.
+/// @details
+/// The kernel places the vector on the stack of the new image, right after
+/// the NULL which terminates the environment. Each entry is a pair made of a
+/// type (AT_*) and of a value, and the vector ends with an AT_NULL entry.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @name Types of the entries of the auxiliary vector
+/// @{
+#define AT_NULL         0  ///< The end of the vector.
+#define AT_PHDR         3  ///< The address of the program headers of the executable.
+#define AT_PHENT        4  ///< The size of a program header.
+#define AT_PHNUM        5  ///< The number of program headers.
+#define AT_PAGESZ       6  ///< The size of a page.
+#define AT_ENTRY        9  ///< The entry point of the executable.
+#define AT_UID          11 ///< The real user id.
+#define AT_EUID         12 ///< The effective user id.
+#define AT_GID          13 ///< The real group id.
+#define AT_EGID         14 ///< The effective group id.
+#define AT_RANDOM       25 ///< The address of 16 random bytes.
+#define AT_SYSINFO      32 ///< The address of the trampoline entering the system calls.
+#define AT_SYSINFO_EHDR 33 ///< The address of the page shared by the kernel (see bits/vdso.h).
+/// @}
+
+/// @brief An entry of the auxiliary vector.
+typedef struct auxv {
+    uint32_t a_type; ///< The type of the entry (AT_*).
+    uint32_t a_val;  ///< The value of the entry.
+} auxv_t;
+
+/// @brief Returns an entry of the auxiliary vector of the program.
+/// @param type the type of the entry (AT_*).
+/// @return the value of the entry, 0 if there is none, and errno is set to ENOENT.
+unsigned long getauxval(unsigned long type);
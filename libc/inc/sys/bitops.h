@@ -30,12 +30,7 @@
 /// @return the position of the first zero bit.
 static inline int find_first_zero(unsigned long value)
 {
-    for (int i = 0; i < 32; ++i) {
-        if (!bit_check(value, i)) {
-            return i;
-        }
-    }
-    return 0;
+    return (~value) ? __builtin_ctzl(~value) : 0;
 }
 
 /// @brief Finds the first bit not zero, starting from the less significative bit.
@@ -0,0 +1,66 @@
+/// @file epoll.h
+/// @brief I/O event notification.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @name Epoll events
+/// @{
+#define EPOLLIN     0x0001 ///< There is data to read.
+#define EPOLLPRI    0x0002 ///< There is urgent data to read.
+#define EPOLLOUT    0x0004 ///< Writing is now possible.
+#define EPOLLERR    0x0008 ///< Error condition (always reported).
+#define EPOLLHUP    0x0010 ///< Hang up (always reported).
+#define EPOLLRDNORM 0x0040 ///< Normal data may be read.
+#define EPOLLRDBAND 0x0080 ///< Priority data may be read.
+#define EPOLLWRNORM 0x0100 ///< Writing normal data is possible.
+#define EPOLLWRBAND 0x0200 ///< Writing priority data is possible.
+/// @}
+
+/// @name Epoll control operations
+/// @{
+#define EPOLL_CTL_ADD 1 ///< Adds a descriptor to the interest list.
+#define EPOLL_CTL_DEL 2 ///< Removes a descriptor from the interest list.
+#define EPOLL_CTL_MOD 3 ///< Changes the events of a descriptor.
+/// @}
+
+/// @brief The data associated with a descriptor, returned with its events.
+typedef union epoll_data {
+    void *ptr;    ///< A pointer.
+    int fd;       ///< A file descriptor.
+    uint32_t u32; ///< A 32-bit value.
+    uint64_t u64; ///< A 64-bit value.
+} epoll_data_t;
+
+/// @brief The events of a descriptor, and its associated data.
+struct epoll_event {
+    uint32_t events;   ///< The events.
+    epoll_data_t data; ///< The user data.
+};
+
+/// @brief Opens an epoll instance, with an empty interest list.
+/// @param size Ignored, but must be greater than zero.
+/// @return The file descriptor of the instance, -1 on failure and errno is set
+///         to indicate the error.
+int epoll_create(int size);
+
+/// @brief Modifies the interest list of an epoll instance.
+/// @param epfd  The epoll instance.
+/// @param op    The operation (EPOLL_CTL_ADD, EPOLL_CTL_DEL or EPOLL_CTL_MOD).
+/// @param fd    The target descriptor.
+/// @param event The events we are interested in, ignored by EPOLL_CTL_DEL.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+
+/// @brief Waits for the descriptors of the interest list to become ready.
+/// @param epfd      The epoll instance.
+/// @param events    Where the ready descriptors are stored.
+/// @param maxevents The maximum number of events to return.
+/// @param timeout   The maximum time to wait, in milliseconds. A negative
+///                  value waits forever, while zero returns immediately.
+/// @return The number of returned events, 0 if the timeout expired, -1 on
+///         failure and errno is set to indicate the error.
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
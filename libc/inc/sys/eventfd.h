@@ -0,0 +1,36 @@
+/// @file eventfd.h
+/// @brief Event notification through a file descriptor.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @name Eventfd flags
+/// @{
+#define EFD_SEMAPHORE 00000001  ///< Each read decrements the counter by one.
+#define EFD_NONBLOCK  00004000U ///< Reads and writes do not block.
+/// @}
+
+/// @brief The type of the counter of an eventfd.
+typedef uint64_t eventfd_t;
+
+/// @brief Creates an eventfd, a counter which can be read and written.
+/// @param initval The initial value of the counter.
+/// @param flags   The flags (EFD_SEMAPHORE, EFD_NONBLOCK).
+/// @return The file descriptor of the eventfd, -1 on failure and errno is
+///         set to indicate the error.
+int eventfd(unsigned int initval, int flags);
+
+/// @brief Reads the counter of an eventfd, waiting until it is not zero.
+/// @param fd    The file descriptor of the eventfd.
+/// @param value Where the value is stored.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int eventfd_read(int fd, eventfd_t *value);
+
+/// @brief Adds a value to the counter of an eventfd.
+/// @param fd    The file descriptor of the eventfd.
+/// @param value The value to add.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int eventfd_write(int fd, eventfd_t value);
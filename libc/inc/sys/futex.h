@@ -0,0 +1,46 @@
+/// @file futex.h
+/// @brief Fast user-space locking.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "time.h"
+
+/// @name Futex operations
+/// @{
+#define FUTEX_WAIT         0   ///< Sleeps while the word holds the expected value.
+#define FUTEX_WAKE         1   ///< Wakes up the tasks sleeping on the word.
+#define FUTEX_LOCK_PI      6   ///< Locks a priority-inheritance word, sleeping while it is busy.
+#define FUTEX_UNLOCK_PI    7   ///< Unlocks a priority-inheritance word, handing it over to a waiter.
+#define FUTEX_PRIVATE_FLAG 128 ///< The word is not shared with other processes (accepted, and ignored).
+
+#define FUTEX_WAIT_PRIVATE (FUTEX_WAIT | FUTEX_PRIVATE_FLAG) ///< FUTEX_WAIT on a private word.
+#define FUTEX_WAKE_PRIVATE (FUTEX_WAKE | FUTEX_PRIVATE_FLAG) ///< FUTEX_WAKE on a private word.
+
+#define FUTEX_LOCK_PI_PRIVATE   (FUTEX_LOCK_PI | FUTEX_PRIVATE_FLAG)   ///< FUTEX_LOCK_PI on a private word.
+#define FUTEX_UNLOCK_PI_PRIVATE (FUTEX_UNLOCK_PI | FUTEX_PRIVATE_FLAG) ///< FUTEX_UNLOCK_PI on a private word.
+/// @}
+
+/// @name Priority-inheritance words
+/// @{
+#define FUTEX_WAITERS  0x80000000U ///< Set while some tasks wait, unlocking must enter the kernel.
+#define FUTEX_TID_MASK 0x3fffffffU ///< The thread id of the owner, 0 if the word is unlocked.
+/// @}
+
+/// @brief Waits on, or wakes up the tasks waiting on, a word of memory.
+/// @param uaddr    The word, aligned to four bytes. Words are identified by
+///                 their physical address, so a word inside shared memory is
+///                 the same for all the processes which attach it.
+/// @param futex_op The operation (FUTEX_WAIT, FUTEX_WAKE, FUTEX_LOCK_PI or
+///                 FUTEX_UNLOCK_PI).
+/// @param val      FUTEX_WAIT: the value the word must hold for the task to
+///                 sleep. FUTEX_WAKE: the maximum number of tasks to wake up.
+/// @param timeout  FUTEX_WAIT, FUTEX_LOCK_PI: if not NULL, the maximum time
+///                 to sleep.
+/// @return FUTEX_WAIT: 0 once woken up. FUTEX_WAKE: the number of woken up
+///         tasks. FUTEX_LOCK_PI, FUTEX_UNLOCK_PI: 0 once the word has been
+///         locked, or unlocked. On failure -1, and errno is set to indicate
+///         the error (EAGAIN if the word does not hold `val`, ETIMEDOUT,
+///         EINTR, EDEADLK if the caller owns the word, EPERM if it does not).
+long futex(int *uaddr, int futex_op, int val, const struct timespec *timeout);
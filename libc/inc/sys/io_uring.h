@@ -0,0 +1,260 @@
+/// @file io_uring.h
+/// @brief Batched submission of system calls, through rings shared with the kernel.
+/// @details
+/// The rings live inside the memory of the process, which registers them with
+/// io_uring_setup(). The process fills the entries of the submission queue and
+/// moves its tail, then a single io_uring_enter() runs all of them; the kernel
+/// moves the head of the submission queue, and posts one completion for each
+/// entry at the tail of the completion queue, whose head the process moves
+/// once it has read them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// The largest number of entries of the submission queue.
+#define IORING_MAX_ENTRIES 256
+
+/// @name Operations of the submission entries.
+/// @{
+#define IORING_OP_NOP   0 ///< Does nothing, completes with 0.
+#define IORING_OP_READ  1 ///< Reads `len` bytes from `fd` into `addr`, at `off`.
+#define IORING_OP_WRITE 2 ///< Writes `len` bytes from `addr` into `fd`, at `off`.
+#define IORING_OP_OPEN  3 ///< Opens the path `addr` with the flags `open_flags` and the mode `len`.
+#define IORING_OP_CLOSE 4 ///< Closes `fd`.
+#define IORING_OP_FSYNC 5 ///< Flushes `fd` to its device.
+#define IORING_OP_STAT  6 ///< Stores the status of the path `addr` inside `addr2`.
+#define IORING_OP_LAST  7 ///< The number of operations.
+/// @}
+
+/// @name Flags of io_uring_enter().
+/// @{
+#define IORING_ENTER_GETEVENTS 1U ///< Waits for `min_complete` completions.
+/// @}
+
+/// @brief An entry of the submission queue.
+struct io_uring_sqe {
+    /// The operation (IORING_OP_*).
+    uint8_t opcode;
+    /// Reserved, must be zero.
+    uint8_t flags;
+    /// Reserved, must be zero.
+    uint16_t reserved;
+    /// The file descriptor.
+    int32_t fd;
+    /// The offset inside the file, -1 to use, and move, the position of the file.
+    int64_t off;
+    /// The buffer, or the path.
+    uint32_t addr;
+    /// The buffer of the status.
+    uint32_t addr2;
+    /// The size of the buffer, or the mode of the created file.
+    uint32_t len;
+    /// The flags of the opened file.
+    uint32_t open_flags;
+    /// Copied, untouched, inside the completion.
+    uint64_t user_data;
+};
+
+/// @brief An entry of the completion queue.
+struct io_uring_cqe {
+    /// The `user_data` of the submission entry.
+    uint64_t user_data;
+    /// The result of the operation, as the system call would return it: a
+    /// negative value is the error code.
+    int32_t res;
+    /// Reserved.
+    uint32_t flags;
+};
+
+/// @brief The submission queue.
+struct io_uring_sq {
+    /// The next entry the kernel runs, moved by the kernel.
+    volatile uint32_t head;
+    /// The entry after the last one submitted, moved by the process.
+    volatile uint32_t tail;
+    /// The entries minus one, set by io_uring_setup().
+    uint32_t ring_mask;
+    /// The number of entries, set by io_uring_setup().
+    uint32_t ring_entries;
+    /// The entries, indexed by the free-running head and tail masked by `ring_mask`.
+    struct io_uring_sqe sqes[];
+};
+
+/// @brief The completion queue.
+struct io_uring_cq {
+    /// The next completion the process reads, moved by the process.
+    volatile uint32_t head;
+    /// The entry after the last completion, moved by the kernel.
+    volatile uint32_t tail;
+    /// The entries minus one, set by io_uring_setup().
+    uint32_t ring_mask;
+    /// The number of entries, set by io_uring_setup().
+    uint32_t ring_entries;
+    /// The completions, indexed by the free-running head and tail masked by `ring_mask`.
+    struct io_uring_cqe cqes[];
+};
+
+/// @brief The parameters of io_uring_setup().
+struct io_uring_params {
+    /// The number of entries of the submission queue, set by io_uring_setup().
+    uint32_t sq_entries;
+    /// The number of entries of the completion queue, set by io_uring_setup().
+    uint32_t cq_entries;
+    /// Reserved, must be zero.
+    uint32_t flags;
+    /// The submission queue, with room for `sq_entries` entries.
+    struct io_uring_sq *sq;
+    /// The completion queue, with room for `cq_entries` entries.
+    struct io_uring_cq *cq;
+};
+
+/// @brief The size of the submission queue with the given entries.
+#define IORING_SQ_SIZE(entries) (sizeof(struct io_uring_sq) + ((entries) * sizeof(struct io_uring_sqe)))
+/// @brief The size of the completion queue with the given entries.
+#define IORING_CQ_SIZE(entries) (sizeof(struct io_uring_cq) + ((entries) * sizeof(struct io_uring_cqe)))
+
+/// @brief A ring, as it is seen by the process.
+struct io_uring {
+    /// The file descriptor of the ring.
+    int ring_fd;
+    /// The submission queue.
+    struct io_uring_sq *sq;
+    /// The completion queue.
+    struct io_uring_cq *cq;
+    /// The tail of the entries prepared but not yet submitted.
+    uint32_t sqe_tail;
+};
+
+/// @brief Registers the rings with the kernel.
+/// @param entries The entries of the submission queue, rounded up to a power
+///                of two; the completion queue has twice as many.
+/// @param params  The rings, which io_uring_setup() initializes, large enough
+///                for the rounded number of entries (see IORING_SQ_SIZE and
+///                IORING_CQ_SIZE).
+/// @return The file descriptor of the ring, -1 on failure and errno is set to
+///         indicate the error.
+int io_uring_setup(unsigned int entries, struct io_uring_params *params);
+
+/// @brief Runs the submitted entries, and waits for their completions.
+/// @param fd           The file descriptor of the ring.
+/// @param to_submit    The largest number of entries to run.
+/// @param min_complete With IORING_ENTER_GETEVENTS, the completions to wait for.
+/// @param flags        The flags (IORING_ENTER_*).
+/// @return The number of entries consumed, -1 on failure and errno is set to
+///         indicate the error.
+int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+
+/// @brief Allocates the rings, and registers them with the kernel.
+/// @param entries The entries of the submission queue.
+/// @param ring    The ring to initialize.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int io_uring_queue_init(unsigned int entries, struct io_uring *ring);
+
+/// @brief Closes the ring, and frees its queues.
+/// @param ring The ring.
+void io_uring_queue_exit(struct io_uring *ring);
+
+/// @brief Returns the next free entry of the submission queue.
+/// @param ring The ring.
+/// @return The entry, zeroed, or NULL if the queue is full.
+struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring);
+
+/// @brief Submits the prepared entries.
+/// @param ring The ring.
+/// @return The number of entries consumed, -1 on failure and errno is set to
+///         indicate the error.
+int io_uring_submit(struct io_uring *ring);
+
+/// @brief Returns the next completion, without waiting.
+/// @param ring The ring.
+/// @param cqe  Where the completion is stored.
+/// @return 0 on success, -1 if there is none and errno is set to EAGAIN.
+int io_uring_peek_cqe(struct io_uring *ring, struct io_uring_cqe **cqe);
+
+/// @brief Returns the next completion, waiting for it.
+/// @param ring The ring.
+/// @param cqe  Where the completion is stored.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int io_uring_wait_cqe(struct io_uring *ring, struct io_uring_cqe **cqe);
+
+/// @brief Gives the completion returned by the last peek back to the ring.
+/// @param ring The ring.
+/// @param cqe  The completion.
+void io_uring_cqe_seen(struct io_uring *ring, struct io_uring_cqe *cqe);
+
+/// @brief Prepares a read.
+/// @param sqe    The entry.
+/// @param fd     The file descriptor.
+/// @param buffer Where the bytes are stored.
+/// @param nbytes The number of bytes.
+/// @param offset The offset inside the file, -1 to use the position of the file.
+static inline void
+io_uring_prep_read(struct io_uring_sqe *sqe, int fd, void *buffer, unsigned int nbytes, int64_t offset)
+{
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd     = fd;
+    sqe->addr   = (uint32_t)buffer;
+    sqe->len    = nbytes;
+    sqe->off    = offset;
+}
+
+/// @brief Prepares a write.
+/// @param sqe    The entry.
+/// @param fd     The file descriptor.
+/// @param buffer The bytes.
+/// @param nbytes The number of bytes.
+/// @param offset The offset inside the file, -1 to use the position of the file.
+static inline void
+io_uring_prep_write(struct io_uring_sqe *sqe, int fd, const void *buffer, unsigned int nbytes, int64_t offset)
+{
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd     = fd;
+    sqe->addr   = (uint32_t)buffer;
+    sqe->len    = nbytes;
+    sqe->off    = offset;
+}
+
+/// @brief Prepares an open.
+/// @param sqe   The entry.
+/// @param path  The path of the file.
+/// @param flags The flags of the file.
+/// @param mode  The mode of the file, if it is created.
+static inline void io_uring_prep_open(struct io_uring_sqe *sqe, const char *path, int flags, unsigned int mode)
+{
+    sqe->opcode     = IORING_OP_OPEN;
+    sqe->addr       = (uint32_t)path;
+    sqe->open_flags = (uint32_t)flags;
+    sqe->len        = mode;
+}
+
+/// @brief Prepares a close.
+/// @param sqe The entry.
+/// @param fd  The file descriptor.
+static inline void io_uring_prep_close(struct io_uring_sqe *sqe, int fd)
+{
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd     = fd;
+}
+
+/// @brief Prepares a flush.
+/// @param sqe The entry.
+/// @param fd  The file descriptor.
+static inline void io_uring_prep_fsync(struct io_uring_sqe *sqe, int fd)
+{
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd     = fd;
+}
+
+/// @brief Prepares a stat.
+/// @param sqe  The entry.
+/// @param path The path of the file.
+/// @param buf  Where the status is stored, a `struct stat`.
+static inline void io_uring_prep_stat(struct io_uring_sqe *sqe, const char *path, void *buf)
+{
+    sqe->opcode = IORING_OP_STAT;
+    sqe->addr   = (uint32_t)path;
+    sqe->addr2  = (uint32_t)buf;
+}
@@ -6,15 +6,49 @@
 #pragma once
 
 #include "stddef.h"
+#include "sys/types.h"
 
+#define PROT_NONE  0x0 ///< Page can not be accessed.
 #define PROT_READ  0x1 ///< Page can be read.
 #define PROT_WRITE 0x2 ///< Page can be written.
 #define PROT_EXEC  0x4 ///< Page can be executed.
 
-#define MAP_SHARED  0x01 ///< The memory is shared.
-#define MAP_PRIVATE 0x02 ///< The memory is private.
+#define MAP_SHARED    0x01    ///< The memory is shared.
+#define MAP_PRIVATE   0x02    ///< The memory is private.
+#define MAP_ANONYMOUS 0x20    ///< The memory is not backed by a file.
+#define MAP_HUGETLB   0x40000 ///< The anonymous memory uses large pages (4 MB), allocated at once.
 
-#if 0
+#define MS_ASYNC      0x1 ///< Schedules the write back of the pages.
+#define MS_INVALIDATE 0x2 ///< Invalidates the other mappings of the file.
+#define MS_SYNC       0x4 ///< Writes back the pages, and waits for them to reach the disk.
+
+#define MADV_NORMAL      0  ///< No particular pattern, the default.
+#define MADV_RANDOM      1  ///< The pages are accessed randomly.
+#define MADV_SEQUENTIAL  2  ///< The pages are accessed sequentially, fault them in ahead.
+#define MADV_WILLNEED    3  ///< The pages will be accessed soon, fault them in now.
+#define MADV_DONTNEED    4  ///< The pages will not be accessed soon, release them.
+#define MADV_MERGEABLE   12 ///< Merge the identical pages of the range with those of other processes.
+#define MADV_UNMERGEABLE 13 ///< Undoes MADV_MERGEABLE, the pages already merged stay so until written.
+#define MADV_HUGEPAGE    14 ///< The pages should stay in memory, like large pages.
+#define MADV_NOHUGEPAGE  15 ///< Undoes MADV_HUGEPAGE.
+
+#define MAP_FAILED ((void *)-1) ///< Returned by mmap() on failure.
+
+/// @brief The arguments of mmap(), which the kernel takes through a single pointer.
+typedef struct mmap_arg_struct {
+    /// The starting address for the new mapping.
+    unsigned long addr;
+    /// The length of the mapping.
+    unsigned long len;
+    /// The memory protection of the mapping.
+    unsigned long prot;
+    /// The flags of the mapping.
+    unsigned long flags;
+    /// The file descriptor of the mapped file.
+    unsigned long fd;
+    /// The offset inside the file.
+    unsigned long offset;
+} mmap_arg_struct_t;
 
 /// @brief creates a new mapping in the virtual address space of the calling process.
 /// @param addr the starting address for the new mapping.
@@ -23,7 +57,7 @@
 /// @param flags determines whether updates to the mapping are visible to other processes mapping the same region.
 /// @param fd in case of file mapping, the file descriptor to use.
 /// @param offset offset in the file, which must be a multiple of the page size PAGE_SIZE.
-/// @return returns a pointer to the mapped area, -1 and errno is set.
+/// @return returns a pointer to the mapped area, MAP_FAILED and errno is set.
 void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset);
 
 /// @brief deletes the mappings for the specified address range.
@@ -32,4 +66,32 @@ void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 /// @return 0 on success, -1 on falure and errno is set.
 int munmap(void *addr, size_t length);
 
-#endif
+/// @brief Writes back to the file the changes made to a shared mapping.
+/// @param addr the starting address, which must be a multiple of the page size.
+/// @param length the length of the range.
+/// @param flags either MS_ASYNC or MS_SYNC, and optionally MS_INVALIDATE.
+/// @return 0 on success, -1 on failure and errno is set.
+int msync(void *addr, size_t length, int flags);
+
+/// @brief Announces how a range of the address space is going to be accessed.
+/// @details The access patterns, MADV_MERGEABLE, and MADV_HUGEPAGE, apply to whole mappings;
+/// MADV_DONTNEED releases the private pages of the range, which are then
+/// zero-filled, or read again from the mapped file, on the next access.
+/// @param addr the starting address, which must be a multiple of the page size.
+/// @param length the length of the range.
+/// @param advice one of the MADV_* values.
+/// @return 0 on success, -1 on failure and errno is set.
+int madvise(void *addr, size_t length, int advice);
+
+/// @brief Opens a shared memory object, a file inside the memory filesystem
+/// mounted at `/dev/shm`, whose pages are shared by its shared mappings.
+/// @param name the name of the object, a single `/` followed by at most NAME_MAX characters.
+/// @param oflag the flags of open(), O_RDONLY or O_RDWR, with O_CREAT, O_EXCL, O_TRUNC.
+/// @param mode the permissions of the object, if it is created.
+/// @return the file descriptor of the object, -1 on failure and errno is set.
+int shm_open(const char *name, int oflag, mode_t mode);
+
+/// @brief Removes a shared memory object, which lives on while it is open or mapped.
+/// @param name the name of the object, as given to shm_open().
+/// @return 0 on success, -1 on failure and errno is set.
+int shm_unlink(const char *name);
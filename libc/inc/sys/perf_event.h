@@ -0,0 +1,63 @@
+/// @file perf_event.h
+/// @brief Counting of hardware events, through a file descriptor.
+/// @details
+/// A performance event counts the occurrences of a hardware event (e.g., the
+/// cycles, or the retired instructions) while a given process runs, with one
+/// of the general-purpose counters of the CPU. Reading its file descriptor
+/// returns the count, as a 64-bit value.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+#include "sys/types.h"
+
+/// @name Types of events
+/// @{
+#define PERF_TYPE_HARDWARE 0 ///< One of the generic events (PERF_COUNT_HW_*).
+#define PERF_TYPE_RAW      4 ///< An event of the CPU, as `event | (umask << 8)`.
+/// @}
+
+/// @brief The generic hardware events, the architectural events of the CPU.
+enum perf_hw_id {
+    PERF_COUNT_HW_CPU_CYCLES          = 0, ///< The core cycles.
+    PERF_COUNT_HW_INSTRUCTIONS        = 1, ///< The retired instructions.
+    PERF_COUNT_HW_CACHE_REFERENCES    = 2, ///< The references to the last level cache.
+    PERF_COUNT_HW_CACHE_MISSES        = 3, ///< The misses of the last level cache.
+    PERF_COUNT_HW_BRANCH_INSTRUCTIONS = 4, ///< The retired branches.
+    PERF_COUNT_HW_BRANCH_MISSES       = 5, ///< The mispredicted retired branches.
+    PERF_COUNT_HW_MAX,                     ///< The number of generic events.
+};
+
+/// @name Flags of an event
+/// @{
+#define PERF_FLAG_DISABLED       (1U << 0U) ///< The event starts disabled (see PERF_EVENT_IOC_ENABLE).
+#define PERF_FLAG_EXCLUDE_USER   (1U << 1U) ///< The event is not counted in user mode.
+#define PERF_FLAG_EXCLUDE_KERNEL (1U << 2U) ///< The event is not counted inside the kernel.
+/// @}
+
+/// @name Requests of ioctl() on an event
+/// @{
+#define PERF_EVENT_IOC_ENABLE  0x2400U ///< Starts counting.
+#define PERF_EVENT_IOC_DISABLE 0x2401U ///< Stops counting, the count is kept.
+#define PERF_EVENT_IOC_RESET   0x2403U ///< Sets the count back to zero.
+/// @}
+
+/// @brief The description of an event.
+typedef struct perf_event_attr {
+    uint32_t type;   ///< The type of the event (PERF_TYPE_*).
+    uint32_t size;   ///< The size of this structure.
+    uint64_t config; ///< The event, whose meaning depends on the type.
+    uint32_t flags;  ///< The flags of the event (PERF_FLAG_*).
+} perf_event_attr_t;
+
+/// @brief Starts counting an event, while a process runs.
+/// @param attr     The description of the event.
+/// @param pid      The process, 0 for the calling one.
+/// @param cpu      The CPU, only -1 (any CPU) is supported.
+/// @param group_fd The leader of a group of events, only -1 (none) is supported.
+/// @param flags    Not used, must be 0.
+/// @return The file descriptor of the event, -1 on failure and errno is
+///         set to indicate the error.
+int perf_event_open(perf_event_attr_t *attr, pid_t pid, int cpu, int group_fd, unsigned long flags);
@@ -0,0 +1,39 @@
+/// @file poll.h
+/// @brief Wait for some event on a set of file descriptors.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @name Poll events
+/// @{
+#define POLLIN     0x0001 ///< There is data to read.
+#define POLLPRI    0x0002 ///< There is urgent data to read.
+#define POLLOUT    0x0004 ///< Writing is now possible.
+#define POLLERR    0x0008 ///< Error condition (output only).
+#define POLLHUP    0x0010 ///< Hang up, the other end has been closed (output only).
+#define POLLNVAL   0x0020 ///< Invalid request, the descriptor is not open (output only).
+#define POLLRDNORM 0x0040 ///< Normal data may be read.
+#define POLLRDBAND 0x0080 ///< Priority data may be read.
+#define POLLWRNORM 0x0100 ///< Writing normal data is possible.
+#define POLLWRBAND 0x0200 ///< Writing priority data is possible.
+/// @}
+
+/// @brief The type used for the number of file descriptors.
+typedef unsigned int nfds_t;
+
+/// @brief A file descriptor, and the events we are interested in.
+struct pollfd {
+    int fd;        ///< The file descriptor, negative values are ignored.
+    short events;  ///< The events we are interested in.
+    short revents; ///< The events which occurred, set by the kernel.
+};
+
+/// @brief Waits for one of a set of file descriptors to become ready.
+/// @param fds     The file descriptors, and the events we are interested in.
+/// @param nfds    The number of entries of `fds`.
+/// @param timeout The maximum time to wait, in milliseconds. A negative value
+///                waits forever, while zero returns immediately.
+/// @return The number of descriptors with a non-zero `revents`, 0 if the
+///         timeout expired, -1 on failure and errno is set to indicate the error.
+int poll(struct pollfd *fds, nfds_t nfds, int timeout);
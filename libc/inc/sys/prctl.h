@@ -0,0 +1,22 @@
+/// @file prctl.h
+/// @brief Operations on the attributes of a process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @name Operations of prctl()
+/// @{
+#define PR_SET_TIMERSLACK 29 ///< Sets the slack of the timers of the process, in nanoseconds, 0 for the default one.
+#define PR_GET_TIMERSLACK 30 ///< Returns the slack of the timers of the process, in nanoseconds.
+/// @}
+
+/// @brief Operates on the attributes of the calling process.
+/// @param option the operation (PR_*).
+/// @param arg2 the first argument of the operation.
+/// @param arg3 the second argument of the operation.
+/// @param arg4 the third argument of the operation.
+/// @param arg5 the fourth argument of the operation.
+/// @return a non-negative value on success, which depends on the operation,
+///         -1 on failure and errno is set to indicate the error.
+int prctl(int option, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5);
@@ -0,0 +1,83 @@
+/// @file resource.h
+/// @brief Resource usage of the processes.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "time.h"
+
+/// @name Resources limited by setrlimit()
+/// @{
+#define RLIMIT_CPU        0  ///< CPU time of the process, in seconds.
+#define RLIMIT_FSIZE      1  ///< Size of the files the process creates (not enforced).
+#define RLIMIT_DATA       2  ///< Size of the data segment of the process, its heap included.
+#define RLIMIT_STACK      3  ///< Size of the stack of the process, applied by exec().
+#define RLIMIT_CORE       4  ///< Size of the core dumps (not enforced).
+#define RLIMIT_RSS        5  ///< Resident set size (not enforced).
+#define RLIMIT_NPROC      6  ///< Number of processes of the user (not enforced).
+#define RLIMIT_NOFILE     7  ///< One more than the highest file descriptor the process can open.
+#define RLIMIT_MEMLOCK    8  ///< Memory locked in RAM (not enforced).
+#define RLIMIT_AS         9  ///< Size of the address space of the process.
+#define RLIMIT_SIGPENDING 10 ///< Number of real-time signals queued to the process.
+#define RLIM_NLIMITS      11 ///< The number of resources.
+/// @}
+
+/// The value of a limit which does not limit anything.
+#define RLIM_INFINITY (~0UL)
+
+/// Tells getrusage() to return the resources used by all the threads of the process.
+#define RUSAGE_SELF     0
+/// Tells getrusage() to return the resources used by the children the process waited for.
+#define RUSAGE_CHILDREN (-1)
+/// Tells getrusage() to return the resources used by the calling thread.
+#define RUSAGE_THREAD   1
+
+/// @brief The type of the values of the limits.
+typedef unsigned long rlim_t;
+
+/// @brief The limits of a resource.
+struct rlimit {
+    rlim_t rlim_cur; ///< The soft limit, the one enforced.
+    rlim_t rlim_max; ///< The hard limit, the ceiling of the soft one.
+};
+
+/// @brief The resources used by a process, only the CPU times and the context
+///        switches are accounted, the other fields are zero.
+struct rusage {
+    struct timeval ru_utime; ///< Time spent running in user mode.
+    struct timeval ru_stime; ///< Time spent running inside the kernel.
+    long ru_maxrss;          ///< Maximum resident set size.
+    long ru_ixrss;           ///< Integral shared memory size.
+    long ru_idrss;           ///< Integral unshared data size.
+    long ru_isrss;           ///< Integral unshared stack size.
+    long ru_minflt;          ///< Page faults served without any I/O.
+    long ru_majflt;          ///< Page faults served with I/O.
+    long ru_nswap;           ///< Times the process was swapped out.
+    long ru_inblock;         ///< Block input operations.
+    long ru_oublock;         ///< Block output operations.
+    long ru_msgsnd;          ///< Messages sent.
+    long ru_msgrcv;          ///< Messages received.
+    long ru_nsignals;        ///< Signals received.
+    long ru_nvcsw;           ///< Voluntary context switches.
+    long ru_nivcsw;          ///< Involuntary context switches.
+};
+
+/// @brief Returns the limits of a resource of the calling process.
+/// @param resource the resource (RLIMIT_*).
+/// @param rlim where the limits are stored.
+/// @return 0 on success, -1 on failure and errno is set.
+int getrlimit(int resource, struct rlimit *rlim);
+
+/// @brief Changes the limits of a resource of the calling process. Only a
+///        privileged process can raise the hard limit.
+/// @param resource the resource (RLIMIT_*).
+/// @param rlim the new limits, the soft one cannot exceed the hard one.
+/// @return 0 on success, -1 on failure and errno is set.
+int setrlimit(int resource, const struct rlimit *rlim);
+
+/// @brief Returns the resources used by the process, its children, or the thread.
+/// @param who RUSAGE_SELF, RUSAGE_CHILDREN or RUSAGE_THREAD.
+/// @param usage where the resources are stored.
+/// @return 0 on success, -1 on failure and errno is set.
+int getrusage(int who, struct rusage *usage);
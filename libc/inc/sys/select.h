@@ -0,0 +1,42 @@
+/// @file select.h
+/// @brief Synchronous I/O multiplexing.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+#include "time.h"
+
+/// The maximum number of file descriptors in a set.
+#define FD_SETSIZE 1024
+/// The number of bits of each word of a set.
+#define NFDBITS    (8 * sizeof(uint32_t))
+
+/// @brief A set of file descriptors.
+typedef struct fd_set {
+    /// The bitmap of the descriptors.
+    uint32_t fds_bits[FD_SETSIZE / NFDBITS];
+} fd_set;
+
+/// @brief Removes all the descriptors from the set.
+#define FD_ZERO(set) memset((set), 0, sizeof(fd_set))
+/// @brief Adds a descriptor to the set.
+#define FD_SET(fd, set) ((set)->fds_bits[(fd) / NFDBITS] |= (1U << ((fd) % NFDBITS)))
+/// @brief Removes a descriptor from the set.
+#define FD_CLR(fd, set) ((set)->fds_bits[(fd) / NFDBITS] &= ~(1U << ((fd) % NFDBITS)))
+/// @brief Checks if a descriptor is inside the set.
+#define FD_ISSET(fd, set) (((set)->fds_bits[(fd) / NFDBITS] & (1U << ((fd) % NFDBITS))) != 0)
+
+/// @brief Waits for one of a set of file descriptors to become ready.
+/// @param nfds      The highest descriptor inside the sets, plus one.
+/// @param readfds   The descriptors checked for reading (can be NULL).
+/// @param writefds  The descriptors checked for writing (can be NULL).
+/// @param exceptfds The descriptors checked for exceptional conditions (can be NULL).
+/// @param timeout   The maximum time to wait, NULL waits forever.
+/// @return The number of ready descriptors inside the sets, which are modified
+///         to contain only them, 0 if the timeout expired, -1 on failure and
+///         errno is set to indicate the error.
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
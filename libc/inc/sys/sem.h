@@ -31,6 +31,12 @@
 /// @brief Defines the maximum number of semaphores in a semaphore set.
 #define SEM_SET_MAX 256
 
+/// @brief Defines the maximum number of operations of a single semop().
+#define SEMOPM 256
+
+/// @brief Defines the maximum value of a semaphore.
+#define SEMVMX 32767
+
 /// @brief Optional argument for semctl() function
 union semun {
     /// @brief Value for SETVAL.
@@ -91,8 +97,20 @@ long semget(key_t key, int nsems, int semflg);
 /// @param sops specifies operations to be performed on single semaphores.
 /// @param nsops number of operations.
 /// @return 0 on success, -1 on failure and errno is set to indicate the error.
+/// @details The operations are performed atomically: either all of them, or
+/// none of them, waiting until all of them can be performed.
 long semop(int semid, struct sembuf *sops, unsigned nsops);
 
+/// @brief Performs operations on selected semaphores in the set, waiting at
+/// most the given time for them to be possible.
+/// @param semid the semaphore set identifier.
+/// @param sops specifies operations to be performed on single semaphores.
+/// @param nsops number of operations.
+/// @param timeout the maximum time to wait, NULL to wait as semop() does.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error,
+/// EAGAIN if the time has expired.
+long semtimedop(int semid, struct sembuf *sops, unsigned nsops, const struct timespec *timeout);
+
 /// @brief Performs control operations on a semaphore set.
 /// @param semid the semaphore set identifier.
 /// @param semnum the n-th semaphore of the set on which we perform the operations.
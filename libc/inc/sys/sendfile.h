@@ -0,0 +1,18 @@
+/// @file sendfile.h
+/// @brief Transfer of data between file descriptors inside the kernel.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+
+/// @brief Copies data from a file descriptor to another, without passing
+/// through a user-space buffer.
+/// @param out_fd The file descriptor we write to.
+/// @param in_fd  The file descriptor we read from.
+/// @param offset If not NULL, the offset we read from, which is updated
+///               instead of the offset of `in_fd`.
+/// @param count  The number of bytes to copy.
+/// @return The number of copied bytes, -1 on failure and errno is set to indicate the error.
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
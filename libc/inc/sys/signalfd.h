@@ -0,0 +1,46 @@
+/// @file signalfd.h
+/// @brief Reception of signals through a file descriptor.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+#ifdef __KERNEL__
+#include "system/signal.h"
+#else
+#include "signal.h"
+#endif
+
+/// @name Signalfd flags
+/// @{
+#define SFD_NONBLOCK 00004000U ///< Reads do not block.
+/// @}
+
+/// @brief The information of a signal, as read from a signalfd.
+typedef struct signalfd_siginfo {
+    uint32_t ssi_signo;  ///< The signal number.
+    int32_t ssi_errno;   ///< The error number (unused).
+    int32_t ssi_code;    ///< The code identifying who raised the signal.
+    uint32_t ssi_pid;    ///< The process ID of the sender.
+    uint32_t ssi_uid;    ///< The real user ID of the sender.
+    int32_t ssi_fd;      ///< The file descriptor (SIGIO).
+    uint32_t ssi_tid;    ///< The timer ID (unused).
+    uint32_t ssi_band;   ///< The band event (SIGIO).
+    uint32_t ssi_status; ///< The exit status or signal (SIGCHLD).
+    int32_t ssi_int;     ///< The integer value sent with the signal.
+    uint64_t ssi_ptr;    ///< The pointer value sent with the signal.
+    uint64_t ssi_addr;   ///< The address which caused the signal.
+    /// Padding, up to 128 bytes.
+    uint8_t __pad[72];
+} signalfd_siginfo_t;
+
+/// @brief Creates a signalfd, from which the given signals are read, or
+/// changes the signals of an existing one.
+/// @param fd    -1 to create a new signalfd, or the one to change.
+/// @param mask  The signals to read, which should be blocked by sigprocmask().
+/// @param flags The flags (SFD_NONBLOCK).
+/// @return The file descriptor of the signalfd, -1 on failure and errno is
+///         set to indicate the error.
+int signalfd(int fd, const sigset_t *mask, int flags);
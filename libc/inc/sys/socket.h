@@ -0,0 +1,212 @@
+/// @file socket.h
+/// @brief Sockets, of the local (AF_UNIX) and Internet (AF_INET) domains.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+
+struct iovec;
+
+/// @brief The length of a socket address.
+typedef unsigned int socklen_t;
+
+/// @brief The address family of a socket address.
+typedef unsigned short sa_family_t;
+
+/// @name Address families
+/// @{
+#define AF_UNSPEC 0         ///< Unspecified.
+#define AF_UNIX   1         ///< Local communication.
+#define AF_LOCAL  AF_UNIX   ///< Synonym of AF_UNIX.
+#define AF_INET   2         ///< IPv4 Internet protocols.
+#define PF_UNSPEC AF_UNSPEC ///< Protocol family, same as the address family.
+#define PF_UNIX   AF_UNIX   ///< Protocol family, same as the address family.
+#define PF_LOCAL  AF_LOCAL  ///< Protocol family, same as the address family.
+#define PF_INET   AF_INET   ///< Protocol family, same as the address family.
+/// @}
+
+/// @name Socket types
+/// @{
+#define SOCK_STREAM   1         ///< Reliable, connection-based byte streams.
+#define SOCK_DGRAM    2         ///< Connectionless messages of a fixed maximum length.
+#define SOCK_NONBLOCK 00004000U ///< Opens the socket in non-blocking mode (O_NONBLOCK).
+/// @}
+
+/// @name Message flags
+/// @{
+#define MSG_CTRUNC   0x0008 ///< The ancillary data has been truncated.
+#define MSG_TRUNC    0x0020 ///< The datagram has been truncated.
+#define MSG_DONTWAIT 0x0040 ///< Do not block, for this call only.
+/// @}
+
+/// @name Shutdown modes
+/// @{
+#define SHUT_RD   0 ///< No more receptions.
+#define SHUT_WR   1 ///< No more transmissions.
+#define SHUT_RDWR 2 ///< No more receptions or transmissions.
+/// @}
+
+#define SOL_SOCKET 1   ///< The level of the socket options, and of the ancillary data.
+#define SCM_RIGHTS 1   ///< Ancillary data carrying file descriptors.
+#define SOMAXCONN  128 ///< The maximum length of the queue of pending connections.
+
+/// @brief A generic socket address.
+struct sockaddr {
+    sa_family_t sa_family; ///< The address family.
+    char sa_data[14];      ///< The address.
+};
+
+/// @brief The description of a message, see sendmsg() and recvmsg().
+struct msghdr {
+    void *msg_name;        ///< The address of the peer.
+    socklen_t msg_namelen; ///< The size of the address.
+    struct iovec *msg_iov; ///< The buffers of the data.
+    size_t msg_iovlen;     ///< The number of buffers.
+    void *msg_control;     ///< The ancillary data.
+    size_t msg_controllen; ///< The size of the ancillary data.
+    int msg_flags;         ///< The flags of the received message.
+};
+
+/// @brief The header of an item of ancillary data, followed by its data.
+struct cmsghdr {
+    size_t cmsg_len; ///< The length of the item, header included.
+    int cmsg_level;  ///< The originating protocol.
+    int cmsg_type;   ///< The protocol-specific type.
+};
+
+/// @brief Aligns a length of ancillary data.
+#define CMSG_ALIGN(len) (((len) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+/// @brief The data following an ancillary data header.
+#define CMSG_DATA(cmsg) ((unsigned char *)((struct cmsghdr *)(cmsg) + 1))
+/// @brief The space taken by an item carrying `len` bytes of data.
+#define CMSG_SPACE(len) (sizeof(struct cmsghdr) + CMSG_ALIGN(len))
+/// @brief The value of `cmsg_len`, for an item carrying `len` bytes of data.
+#define CMSG_LEN(len)   (sizeof(struct cmsghdr) + (len))
+/// @brief The first item of ancillary data of a message.
+#define CMSG_FIRSTHDR(mhdr)                                                                                            \
+    (((mhdr)->msg_controllen >= sizeof(struct cmsghdr)) ? (struct cmsghdr *)(mhdr)->msg_control : (struct cmsghdr *)0)
+/// @brief The item of ancillary data following `cmsg`.
+#define CMSG_NXTHDR(mhdr, cmsg) __cmsg_nxthdr(mhdr, cmsg)
+
+/// @brief Returns the item of ancillary data following `cmsg`.
+/// @param mhdr the message.
+/// @param cmsg the current item.
+/// @return the next item, NULL if there are no more items.
+static inline struct cmsghdr *__cmsg_nxthdr(const struct msghdr *mhdr, const struct cmsghdr *cmsg)
+{
+    char *next = (char *)cmsg + CMSG_ALIGN(cmsg->cmsg_len);
+    char *end  = (char *)mhdr->msg_control + mhdr->msg_controllen;
+    if ((cmsg->cmsg_len < sizeof(struct cmsghdr)) || ((next + sizeof(struct cmsghdr)) > end)) {
+        return (struct cmsghdr *)0;
+    }
+    return (struct cmsghdr *)next;
+}
+
+/// @brief Creates an endpoint for communication.
+/// @param domain The communication domain (AF_UNIX or AF_INET).
+/// @param type The type of the socket (SOCK_STREAM or SOCK_DGRAM), possibly with SOCK_NONBLOCK.
+/// @param protocol The protocol, 0 for the default one of the type (IPPROTO_TCP or IPPROTO_UDP on AF_INET).
+/// @return The file descriptor of the socket, -1 on failure and errno is set to indicate the error.
+int socket(int domain, int type, int protocol);
+
+/// @brief Creates a pair of connected sockets.
+/// @param domain The communication domain, only AF_UNIX is supported.
+/// @param type The type of the sockets, possibly with SOCK_NONBLOCK.
+/// @param protocol The protocol, must be 0.
+/// @param sv Where the file descriptors of the sockets are stored.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int socketpair(int domain, int type, int protocol, int sv[2]);
+
+/// @brief Assigns a name to a socket.
+/// @param sockfd The socket.
+/// @param addr The name (a `struct sockaddr_un`, or a `struct sockaddr_in`).
+/// @param addrlen The size of the name.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Marks a stream socket as accepting connections.
+/// @param sockfd The socket, which must be bound.
+/// @param backlog The maximum number of pending connections.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int listen(int sockfd, int backlog);
+
+/// @brief Accepts a pending connection.
+/// @param sockfd The listening socket.
+/// @param addr Where the name of the peer is stored (can be NULL).
+/// @param addrlen The size of `addr`, updated with the size of the name.
+/// @return The file descriptor of the connection, -1 on failure and errno is set to indicate the error.
+int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+
+/// @brief Same as accept(), SOCK_NONBLOCK can be set on the new connection.
+/// @param sockfd The listening socket.
+/// @param addr Where the name of the peer is stored (can be NULL).
+/// @param addrlen The size of `addr`, updated with the size of the name.
+/// @param flags The flags of the new connection.
+/// @return The file descriptor of the connection, -1 on failure and errno is set to indicate the error.
+int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);
+
+/// @brief Connects a socket to a listening socket, or sets the default
+///        destination of a datagram socket.
+/// @param sockfd The socket.
+/// @param addr The name of the other socket.
+/// @param addrlen The size of the name.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Sends a message, with its ancillary data.
+/// @param sockfd The socket.
+/// @param msg The message.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @return The number of bytes sent, -1 on failure and errno is set to indicate the error.
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags);
+
+/// @brief Receives a message, with its ancillary data.
+/// @param sockfd The socket.
+/// @param msg The message, its flags are set on return.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @return The number of bytes received, -1 on failure and errno is set to indicate the error.
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags);
+
+/// @brief Sends data through a socket.
+/// @param sockfd The socket.
+/// @param buf The data.
+/// @param len The size of the data.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @return The number of bytes sent, -1 on failure and errno is set to indicate the error.
+ssize_t send(int sockfd, const void *buf, size_t len, int flags);
+
+/// @brief Receives data from a socket.
+/// @param sockfd The socket.
+/// @param buf Where the data is stored.
+/// @param len The size of the buffer.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @return The number of bytes received, -1 on failure and errno is set to indicate the error.
+ssize_t recv(int sockfd, void *buf, size_t len, int flags);
+
+/// @brief Sends data through a socket, to the given destination.
+/// @param sockfd The socket.
+/// @param buf The data.
+/// @param len The size of the data.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @param dest_addr The destination, NULL for the connected one.
+/// @param addrlen The size of the destination.
+/// @return The number of bytes sent, -1 on failure and errno is set to indicate the error.
+ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen);
+
+/// @brief Receives data from a socket, and the name of the sender.
+/// @param sockfd The socket.
+/// @param buf Where the data is stored.
+/// @param len The size of the buffer.
+/// @param flags The flags (MSG_DONTWAIT).
+/// @param src_addr Where the name of the sender is stored (can be NULL).
+/// @param addrlen The size of `src_addr`, updated with the size of the name.
+/// @return The number of bytes received, -1 on failure and errno is set to indicate the error.
+ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen);
+
+/// @brief Shuts down part of a connection.
+/// @param sockfd The socket.
+/// @param how What to shut down (SHUT_RD, SHUT_WR or SHUT_RDWR).
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int shutdown(int sockfd, int how);
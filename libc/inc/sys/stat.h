@@ -64,6 +64,15 @@
 /// @return Returns a negative value on failure.
 int stat(const char *path, stat_t *buf);
 
+/// @brief Retrieves information about the file at the given location,
+/// whose relative path starts from an open directory.
+/// @param dirfd The directory, or AT_FDCWD for the current working directory.
+/// @param path  The path to the file that is being inquired.
+/// @param buf   A structure where data about the file will be stored.
+/// @param flags AT_SYMLINK_NOFOLLOW, which is what stat() does anyway.
+/// @return Returns a negative value on failure.
+int fstatat(int dirfd, const char *path, stat_t *buf, int flags);
+
 /// @brief Retrieves information about the file at the given location.
 /// @param fd  The file descriptor of the file that is being inquired.
 /// @param buf A structure where data about the file will be stored.
@@ -76,6 +85,19 @@ int fstat(int fd, stat_t *buf);
 /// @return Returns a negative value on failure.
 int mkdir(const char *path, mode_t mode);
 
+/// @brief Creates a special file at the given path.
+/// @param path The path of the new file.
+/// @param mode The type (S_IFIFO or S_IFREG) and the permission of the new file.
+/// @param dev The device number, for device special files.
+/// @return Returns a negative value on failure.
+int mknod(const char *path, mode_t mode, dev_t dev);
+
+/// @brief Creates a named pipe at the given path.
+/// @param path The path of the new named pipe.
+/// @param mode The permission of the new named pipe.
+/// @return Returns a negative value on failure.
+int mkfifo(const char *path, mode_t mode);
+
 /// @brief Removes the given directory.
 /// @param path The path to the directory to remove.
 /// @return Returns a negative value on failure.
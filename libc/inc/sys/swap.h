@@ -0,0 +1,22 @@
+/// @file swap.h
+/// @brief Management of the swap area.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @brief Starts swapping the pages of the processes to a block device.
+/// @param path      The path of the block device, which must have been
+///                  prepared by mkswap. A single swap area is supported.
+/// @param swapflags The flags of the swap area (ignored).
+/// @return 0 on success. On failure -1, and errno is set to indicate the error
+///         (EPERM if the caller is not root, EBUSY if a swap area is in use,
+///         EINVAL if the path is not a block device prepared by mkswap).
+int swapon(const char *path, int swapflags);
+
+/// @brief Stops swapping to a block device, reading back all the pages it holds.
+/// @param path The path of the block device.
+/// @return 0 on success. On failure -1, and errno is set to indicate the error
+///         (EPERM if the caller is not root, EINVAL if swapping is not on the
+///         device, ENOMEM if the pages do not fit in memory).
+int swapoff(const char *path);
@@ -0,0 +1,25 @@
+/// @file times.h
+/// @brief The CPU times of the processes.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "sys/types.h"
+
+/// The clock ticks of times() in a second, whatever the frequency of the timer.
+#define CLK_TCK 100
+
+/// @brief The CPU times of a process, in clock ticks (see CLK_TCK).
+struct tms {
+    clock_t tms_utime;  ///< Time spent running in user mode, by all the threads.
+    clock_t tms_stime;  ///< Time spent running inside the kernel, by all the threads.
+    clock_t tms_cutime; ///< User time of the children waited for, and of their own.
+    clock_t tms_cstime; ///< System time of the children waited for, and of their own.
+};
+
+/// @brief Returns the CPU times of the calling process, and of its children.
+/// @param buf where the times are stored.
+/// @return the clock ticks elapsed since the system started, -1 on failure
+///         and errno is set.
+clock_t times(struct tms *buf);
@@ -19,6 +19,8 @@ typedef unsigned int nlink_t;
 typedef long blksize_t;
 /// @brief Represents the number of 512B blocks allocated to a file.
 typedef long blkcnt_t;
+/// @brief Represents a CPU time, in clock ticks (see CLK_TCK).
+typedef long clock_t;
 
 /// Defines the list of flags of a process.
 typedef enum eflags_list {
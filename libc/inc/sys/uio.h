@@ -0,0 +1,51 @@
+/// @file uio.h
+/// @brief Vectored I/O operations.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+
+/// Maximum number of segments of a single vectored I/O operation.
+#define IOV_MAX 1024
+
+/// @brief A segment of a vectored I/O operation.
+typedef struct iovec {
+    /// The start of the segment.
+    void *iov_base;
+    /// The size of the segment.
+    size_t iov_len;
+} iovec_t;
+
+/// @brief Reads data from a file descriptor into multiple buffers.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @return The number of read bytes, -1 on failure and errno is set to indicate the error.
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+
+/// @brief Writes data into a file descriptor from multiple buffers.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @return The number of written bytes, -1 on failure and errno is set to indicate the error.
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+
+/// @brief Reads data from the given offset of a file into multiple buffers,
+/// without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset inside the file.
+/// @return The number of read bytes, -1 on failure and errno is set to indicate the error.
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+/// @brief Writes data at the given offset of a file from multiple buffers,
+/// without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset inside the file.
+/// @return The number of written bytes, -1 on failure and errno is set to indicate the error.
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
@@ -0,0 +1,17 @@
+/// @file un.h
+/// @brief Names of the local (AF_UNIX) sockets.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "sys/socket.h"
+
+/// @brief The maximum length of the name of a local socket.
+#define UNIX_PATH_MAX 108
+
+/// @brief The name of a local socket.
+struct sockaddr_un {
+    sa_family_t sun_family;       ///< The address family (AF_UNIX).
+    char sun_path[UNIX_PATH_MAX]; ///< The name, a NUL-terminated path.
+};
@@ -7,6 +7,8 @@
 
 #include "types.h"
 
+struct rusage;
+
 /// @brief Return immediately if no child is there to be waited for.
 #define WNOHANG 0x00000001
 
@@ -76,3 +78,13 @@ extern pid_t wait(int *status);
 ///        > 0    meaning wait for the child whose process ID is equal to the
 ///               value of pid.
 extern pid_t waitpid(pid_t pid, int *status, int options);
+
+/// @brief The same as waitpid(), it also returns the resources used by the
+///        child, and by the children it waited for.
+/// @param pid     The child to wait for, see waitpid().
+/// @param status  Variable where the new status of the child is stored.
+/// @param options Waitpid options.
+/// @param rusage  Where the resources used by the child are stored, if not NULL.
+/// @return On error, -1 is returned, otherwise it returns the pid of the
+///         child that has unlocked the wait.
+extern pid_t wait4(pid_t pid, int *status, int options, struct rusage *rusage);
@@ -4,6 +4,9 @@
 /// See LICENSE.md for details.
 
 #pragma once
+
+#include "bits/vdso.h"
+
 #define __NR_exit                   1   ///< System-call number for `exit`
 #define __NR_fork                   2   ///< System-call number for `fork`
 #define __NR_read                   3   ///< System-call number for `read`
@@ -374,7 +377,11 @@
 #define __NR_shmctl                 396 ///<  System-call number for `shmctl`
 #define __NR_shmdt                  397 ///<  System-call number for `shmdt`
 #define __NR_shmget                 398 ///<  System-call number for `shmget`
-#define SYSCALL_NUMBER              399 ///< The total number of system-calls.
+#define __NR_posix_spawn            399 ///< System-call number for `posix_spawn`
+#define __NR_semtimedop             400 ///< System-call number for `semtimedop`
+#define __NR_io_uring_setup         425 ///< System-call number for `io_uring_setup`
+#define __NR_io_uring_enter         426 ///< System-call number for `io_uring_enter`
+#define SYSCALL_NUMBER              427 ///< The total number of system-calls.
 
 /// @brief Adjust the result of a system call and set errno if needed.
 /// @param value The variable where the result of the system call is stored.
@@ -406,33 +413,41 @@
 //
 //
 
+/// @brief Stringifies the value of a macro.
+#define __syscall_str(x)  #x
+/// @brief Stringifies a macro.
+#define __syscall_xstr(x) __syscall_str(x)
+/// @brief Enters the system call, through the trampoline inside the shared page,
+///        which uses sysenter when the CPU has it, `int $0x80` otherwise.
+#define __SYSCALL_ENTRY   "call " __syscall_xstr(VDSO_SYSCALL_ADDR)
+
 /// @brief Heart of the code that calls a system call with 0 parameters.
-#define __inline_syscall_0(res, name) __asm__ __volatile__("int $0x80" : "=a"(res) : "0"(__NR_##name))
+#define __inline_syscall_0(res, name) __asm__ __volatile__(__SYSCALL_ENTRY : "=a"(res) : "0"(__NR_##name))
 
 /// @brief Heart of the code that calls a system call with 1 parameter.
 #define __inline_syscall_1(res, name, arg1)                                                                            \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; " __SYSCALL_ENTRY "; pop %%ebx"                                   \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1)                                                                \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 2 parameters.
 #define __inline_syscall_2(res, name, arg1, arg2)                                                                      \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; " __SYSCALL_ENTRY "; pop %%ebx"                                   \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2)                                                     \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 3 parameters.
 #define __inline_syscall_3(res, name, arg1, arg2, arg3)                                                                \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; " __SYSCALL_ENTRY "; pop %%ebx"                                   \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3)                                          \
                          : "memory");
 
 /// @brief Heart of the code that calls a system call with 4 parameters.
 #define __inline_syscall_4(res, name, arg1, arg2, arg3, arg4)                                                          \
-    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; pop %%ebx"                                             \
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; " __SYSCALL_ENTRY "; pop %%ebx"                                   \
                          : "=a"(res)                                                                                   \
                          : "0"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3), "S"(arg4)                               \
                          : "memory");
@@ -440,7 +455,7 @@
 /// @brief Heart of the code that calls a system call with 5 parameters.
 #define __inline_syscall_5(res, name, arg1, arg2, arg3, arg4, arg5)                                                    \
     __asm__ __volatile__("push %%ebx; movl %2,%%ebx; movl %1,%%eax; "                                                  \
-                         "int $0x80; pop %%ebx"                                                                        \
+                         __SYSCALL_ENTRY "; pop %%ebx"                                                                 \
                          : "=a"(res)                                                                                   \
                          : "i"(__NR_##name), "ri"(arg1), "c"(arg2), "d"(arg3), "S"(arg4), "D"(arg5)                    \
                          : "memory");
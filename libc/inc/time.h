@@ -18,9 +18,17 @@
 /// generated.
 #define ITIMER_PROF    2
 
+/// The wall-clock time, which follows the Real Time Clock.
+#define CLOCK_REALTIME  0
+/// The time elapsed since the clock was calibrated, which never goes backwards.
+#define CLOCK_MONOTONIC 1
+
 /// Used to store time values.
 typedef unsigned int time_t;
 
+/// Identifies a clock.
+typedef int clockid_t;
+
 /// Used to get information about the current time.
 typedef struct tm {
     /// Seconds [0 to 59]
@@ -109,6 +117,19 @@ size_t strftime(char *str, size_t maxsize, const char *format, const tm_t *timep
 /// the process.
 int nanosleep(const struct timespec *req, struct timespec *rem);
 
+/// @brief Reads a clock, with the precision of a nanosecond when the CPU has a
+///        Time Stamp Counter.
+/// @param clk_id the clock, CLOCK_REALTIME or CLOCK_MONOTONIC.
+/// @param tp where the time is stored.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int clock_gettime(clockid_t clk_id, struct timespec *tp);
+
+/// @brief Returns the resolution of a clock.
+/// @param clk_id the clock, CLOCK_REALTIME or CLOCK_MONOTONIC.
+/// @param res where the resolution is stored, if not NULL.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int clock_getres(clockid_t clk_id, struct timespec *res);
+
 /// @brief Fills the structure pointed to by curr_value with the current setting
 /// for the timer specified by which.
 /// @param which which timer.
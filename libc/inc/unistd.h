@@ -7,16 +7,13 @@
 
 #include "dirent.h"
 #include "stddef.h"
+#include "stdint.h"
 #include "sys/types.h"
 
 #define STDIN_FILENO  0 ///< Standard input file descriptor.
 #define STDOUT_FILENO 1 ///< Standard output file descriptor.
 #define STDERR_FILENO 2 ///< Standard error file descriptor.
 
-#define stdin  STDIN_FILENO  ///< Standard input file descriptor.
-#define stdout STDOUT_FILENO ///< Standard output file descriptor.
-#define stderr STDERR_FILENO ///< Standard error file descriptor.
-
 /// @brief        Read data from a file descriptor.
 /// @param fd     The file descriptor.
 /// @param buf    The buffer.
@@ -31,6 +28,36 @@ ssize_t read(int fd, void *buf, size_t nbytes);
 /// @return       The number of written bytes.
 ssize_t write(int fd, const void *buf, size_t nbytes);
 
+/// @brief        Read data from the given offset of a file, without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param buf    The buffer.
+/// @param nbytes The number of bytes to read.
+/// @param offset The offset inside the file.
+/// @return       The number of read characters.
+ssize_t pread(int fd, void *buf, size_t nbytes, off_t offset);
+
+/// @brief        Write data at the given offset of a file, without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param buf    The buffer collecting data to written.
+/// @param nbytes The number of bytes to write.
+/// @param offset The offset inside the file.
+/// @return       The number of written bytes.
+ssize_t pwrite(int fd, const void *buf, size_t nbytes, off_t offset);
+
+/// @brief Copies a range of data from a file to another, without passing
+/// through a user-space buffer.
+/// @param fd_in   The file descriptor we read from.
+/// @param off_in  If not NULL, the offset we read from, which is updated
+///                instead of the offset of `fd_in`.
+/// @param fd_out  The file descriptor we write to.
+/// @param off_out If not NULL, the offset we write to, which is updated
+///                instead of the offset of `fd_out`.
+/// @param len     The number of bytes to copy.
+/// @param flags   Must be 0.
+/// @return The number of copied bytes, 0 at the end of the input, -1 on
+/// failure and errno is set to indicate the error.
+ssize_t copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned int flags);
+
 /// @brief Opens the file specified by pathname.
 /// @param pathname A pathname for a file.
 /// @param flags file status flags and file access modes of the open file description.
@@ -38,6 +65,14 @@ ssize_t write(int fd, const void *buf, size_t nbytes);
 /// @return file descriptor number, -1 otherwise and errno is set to indicate the error.
 int open(const char *pathname, int flags, mode_t mode);
 
+/// @brief Opens the file specified by pathname, whose relative path starts from an open directory.
+/// @param dirfd the directory, or AT_FDCWD for the current working directory.
+/// @param pathname A pathname for a file.
+/// @param flags file status flags and file access modes of the open file description.
+/// @param mode the file mode bits be applied when a new file is created.
+/// @return file descriptor number, -1 otherwise and errno is set to indicate the error.
+int openat(int dirfd, const char *pathname, int flags, mode_t mode);
+
 /// @brief Close a file descriptor.
 /// @param fd The file descriptor.
 /// @return The result of the operation.
@@ -53,14 +88,28 @@ int close(int fd);
 /// indicate the error.
 off_t lseek(int fd, off_t offset, int whence);
 
+/// @brief Commits the buffered data of all the filesystems to the disks.
+void sync(void);
+
+/// @brief Commits the buffered data of a file to the disk.
+/// @param fd The file descriptor of the file.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int fsync(int fd);
+
+/// @brief Changes the size of a file, the bytes it gains read as zero.
+/// @param fd     The file descriptor of the file, open for writing.
+/// @param length The new size.
+/// @return 0 on success, -1 on failure and errno is set to indicate the error.
+int ftruncate(int fd, off_t length);
+
 /// @brief Delete a name and possibly the file it refers to.
 /// @param path The path to the file.
 /// @return 0 on success, -errno on failure.
 int unlink(const char *path);
 
 /// @brief Creates a symbolic link.
-/// @param linkname the name of the link.
-/// @param path the entity it is linking to.
+/// @param linkname the target of the link, the entity it is linking to.
+/// @param path the path of the new link.
 /// @return 0 on success, a negative number if fails and errno is set.
 int symlink(const char *linkname, const char *path);
 
@@ -75,6 +124,10 @@ int readlink(const char *path, char *buffer, size_t bufsize);
 /// @return pid_t process identifier.
 pid_t getpid(void);
 
+/// @brief Returns the thread ID (TID) of the calling thread.
+/// @return pid_t thread identifier, the PID for the first thread of a process.
+pid_t gettid(void);
+
 /// @brief  Return session id of the given process.
 ///        If pid == 0 return the SID of the calling process
 ///        If pid != 0 return the SID corresponding to the process having identifier == pid
@@ -151,12 +204,18 @@ int setreuid(uid_t ruid, uid_t euid);
 /// @return pid_t parent process identifier.
 pid_t getppid(void);
 
+/// @brief Clone the calling process, its address space is shared copy-on-write.
+/// @return Return -1 for errors, 0 to the new process, and the process ID of
+///         the new process to the old process.
+pid_t fork(void);
+
 /// @brief Clone the calling process, but without copying the whole address space.
 ///        The calling process is suspended until the new process exits or is
-///        replaced by a call to `execve'.
+///        replaced by a call to `execve'. Until then, the new process must
+///        only call `execve' or `exit'.
 /// @return Return -1 for errors, 0 to the new process, and the process ID of
 ///         the new process to the old process.
-pid_t fork(void);
+pid_t vfork(void);
 
 /// @brief Replaces the current process image with a new process image (argument list).
 /// @param path The absolute path to the binary file to execute.
@@ -236,6 +295,16 @@ int execvpe(const char *file, char *const argv[], char *const envp[]);
 ///         returned, and errno is set appropriately.
 int nice(int inc);
 
+/// @brief Sets the end of the heap (the program break) of the calling process.
+/// @param addr The new end of the heap.
+/// @return 0 on success, -1 on failure, and errno is set to ENOMEM.
+int brk(void *addr);
+
+/// @brief Moves the end of the heap (the program break) of the calling process.
+/// @param increment The number of bytes added to the heap, removed if negative.
+/// @return The previous end of the heap, (void *)-1 on failure, and errno is set to ENOMEM.
+void *sbrk(intptr_t increment);
+
 /// @brief Get current working directory.
 /// @param buf  The array where the CWD will be copied.
 /// @param size The size of the array.
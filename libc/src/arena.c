@@ -0,0 +1,114 @@
+/// @file arena.c
+/// @brief Region allocator, for programs which free everything at once.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "arena.h"
+
+#include "string.h"
+#include "sys/mman.h"
+
+/// The size of a page, the chunks span whole pages.
+#define ARENA_PAGE_SIZE 4096U
+
+/// The offset of the memory of a chunk, past its header.
+#define ARENA_CHUNK_HEADER ((sizeof(arena_chunk_t) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+/// @brief Maps a chunk.
+/// @param size The size of the memory it must hold at least.
+/// @return The chunk, or NULL on failure.
+static arena_chunk_t *__arena_map_chunk(size_t size)
+{
+    if (size > (SIZE_MAX - ARENA_CHUNK_HEADER - ARENA_PAGE_SIZE)) {
+        return NULL;
+    }
+    size                 = (size + ARENA_CHUNK_HEADER + ARENA_PAGE_SIZE - 1) & ~(ARENA_PAGE_SIZE - 1);
+    arena_chunk_t *chunk = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (chunk == MAP_FAILED) {
+        return NULL;
+    }
+    chunk->prev = NULL;
+    chunk->size = size;
+    return chunk;
+}
+
+arena_t *arena_create(size_t chunk_size)
+{
+    if (chunk_size == 0) {
+        chunk_size = ARENA_CHUNK_SIZE;
+    }
+    arena_chunk_t *chunk = __arena_map_chunk(chunk_size);
+    if (!chunk) {
+        return NULL;
+    }
+    // The arena is the first allocation of its first chunk.
+    arena_t *arena    = (arena_t *)((uintptr_t)chunk + ARENA_CHUNK_HEADER);
+    arena->chunks     = chunk;
+    arena->next       = (uintptr_t)arena + ((sizeof(arena_t) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1));
+    arena->end        = (uintptr_t)chunk + chunk->size;
+    arena->chunk_size = chunk_size;
+    return arena;
+}
+
+void *__arena_alloc_slow(arena_t *arena, size_t size)
+{
+    arena_chunk_t *chunk;
+    if (size > (SIZE_MAX - ARENA_ALIGNMENT)) {
+        return NULL;
+    }
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    // A large allocation gets a chunk of its own, placed behind the current
+    // one, so that the room left inside the current one is not lost.
+    if (size > (arena->chunk_size / 4)) {
+        if (!(chunk = __arena_map_chunk(size))) {
+            return NULL;
+        }
+        chunk->prev         = arena->chunks->prev;
+        arena->chunks->prev = chunk;
+        return (void *)((uintptr_t)chunk + ARENA_CHUNK_HEADER);
+    }
+    if (!(chunk = __arena_map_chunk(arena->chunk_size))) {
+        return NULL;
+    }
+    chunk->prev   = arena->chunks;
+    arena->chunks = chunk;
+    arena->next   = (uintptr_t)chunk + ARENA_CHUNK_HEADER + size;
+    arena->end    = (uintptr_t)chunk + chunk->size;
+    return (void *)((uintptr_t)chunk + ARENA_CHUNK_HEADER);
+}
+
+void *arena_calloc(arena_t *arena, size_t size)
+{
+    void *memory = arena_alloc(arena, size);
+    // The chunks are mapped zeroed, but they are reused after a reset.
+    if (memory) {
+        memset(memory, 0, size);
+    }
+    return memory;
+}
+
+void arena_reset(arena_t *arena)
+{
+    // The first chunk, which holds the arena, is the last of the list.
+    arena_chunk_t *first = (arena_chunk_t *)((uintptr_t)arena - ARENA_CHUNK_HEADER);
+    for (arena_chunk_t *chunk = arena->chunks, *prev; chunk != first; chunk = prev) {
+        prev = chunk->prev;
+        munmap(chunk, chunk->size);
+    }
+    // The chunks of large allocations may also hang behind the first one.
+    for (arena_chunk_t *chunk = first->prev, *prev; chunk; chunk = prev) {
+        prev = chunk->prev;
+        munmap(chunk, chunk->size);
+    }
+    first->prev   = NULL;
+    arena->chunks = first;
+    arena->next   = (uintptr_t)arena + ((sizeof(arena_t) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1));
+    arena->end    = (uintptr_t)first + first->size;
+}
+
+void arena_destroy(arena_t *arena)
+{
+    arena_reset(arena);
+    arena_chunk_t *first = arena->chunks;
+    munmap(first, first->size);
+}
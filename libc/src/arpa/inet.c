@@ -0,0 +1,46 @@
+/// @file inet.c
+/// @brief Conversions between IPv4 addresses and their dotted notation.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "arpa/inet.h"
+#include "stdio.h"
+
+int inet_aton(const char *cp, struct in_addr *inp)
+{
+    uint32_t address = 0;
+    for (int part = 0; part < 4; ++part) {
+        uint32_t value = 0;
+        int digits     = 0;
+        for (; (*cp >= '0') && (*cp <= '9') && (digits < 3); ++cp, ++digits) {
+            value = value * 10 + (*cp - '0');
+        }
+        if (!digits || (value > 255) || (*cp != ((part < 3) ? '.' : '\0'))) {
+            return 0;
+        }
+        address = (address << 8U) | value;
+        if (part < 3) {
+            ++cp;
+        }
+    }
+    if (inp) {
+        inp->s_addr = htonl(address);
+    }
+    return 1;
+}
+
+in_addr_t inet_addr(const char *cp)
+{
+    struct in_addr in;
+    return inet_aton(cp, &in) ? in.s_addr : INADDR_NONE;
+}
+
+char *inet_ntoa(struct in_addr in)
+{
+    static char buffer[16];
+    uint32_t address = ntohl(in.s_addr);
+    sprintf(
+        buffer, "%u.%u.%u.%u", (address >> 24U) & 0xFF, (address >> 16U) & 0xFF, (address >> 8U) & 0xFF,
+        address & 0xFF);
+    return buffer;
+}
@@ -9,6 +9,8 @@
 /// Algorithm specification can be found here:
 ///     http://csrc.nist.gov/publications/fips/fips180-2/fips180-2withchangenotice.pdf
 /// This implementation uses little endian byte order.
+/// The blocks are hashed through the SHA extensions of the CPU when it has
+/// them, and otherwise with the rounds unrolled.
 
 #include "crypt/sha256.h"
 
@@ -31,12 +33,12 @@
 /// @brief Chooses bits from y if x is set, otherwise from z.
 /// @param x, y, z Input values.
 /// @return Result of CH function.
-#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
 
 /// @brief Majority function used in SHA-256.
 /// @param x, y, z Input values.
 /// @return Result of the majority function.
-#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
 
 /// @brief First expansion function for the working variables.
 /// @param x Input value.
@@ -74,87 +76,187 @@ static const uint32_t k[SHA256_MAX_DATA_LENGTH] = {
     0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
     0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
-/// @brief Transforms the state of the SHA-256 context based on a block of input data.
-/// @param ctx Pointer to the SHA-256 context. Must not be NULL.
-/// @param data Input data block to process (64 bytes). Must not be NULL.
-static inline void __sha256_transform(SHA256_ctx_t *ctx, const uint8_t data[])
+/// @brief Performs one round, the working variables being rotated by the
+/// caller, through the order of the arguments.
+/// @param a, b, c, d, e, f, g, h The working variables, d and h are updated.
+/// @param i The index of the round.
+#define ROUND(a, b, c, d, e, f, g, h, i)                                                                               \
+    do {                                                                                                               \
+        uint32_t t1 = (h) + EP1(e) + CH(e, f, g) + k[i] + m[i];                                                        \
+        (d) += t1;                                                                                                     \
+        (h)  = t1 + EP0(a) + MAJ(a, b, c);                                                                             \
+    } while (0)
+
+/// @brief Transforms the state with consecutive blocks of input data, one round at a time.
+/// @param state The hash state.
+/// @param data The blocks (64 bytes each).
+/// @param blocks The number of blocks.
+static void __sha256_transform_scalar(uint32_t state[8], const uint8_t *data, size_t blocks)
 {
-    // Error checks: Ensure the input parameters are not NULL.
-    if (!ctx) {
-        perror("SHA256 context is NULL.\n");
-        return;
-    }
-    if (!data) {
-        perror("Input data is NULL.\n");
-        return;
-    }
-
-    uint32_t a;
-    uint32_t b;
-    uint32_t c;
-    uint32_t d;
-    uint32_t e;
-    uint32_t f;
-    uint32_t g;
-    uint32_t h;
-    uint32_t i;
-    uint32_t j;
-    uint32_t t1;
-    uint32_t t2;
     uint32_t m[SHA256_MAX_DATA_LENGTH]; // Message schedule array.
+    for (; blocks; --blocks, data += SHA256_MAX_DATA_LENGTH) {
+        // The first 16 words are directly from the input data, in big-endian
+        // order, the remaining 48 are computed from the previous ones.
+        for (uint32_t i = 0, j = 0; i < 16; ++i, j += 4) {
+            m[i] = ((uint32_t)data[j] << 24) | ((uint32_t)data[j + 1] << 16) | ((uint32_t)data[j + 2] << 8) |
+                   (uint32_t)data[j + 3];
+        }
+        for (uint32_t i = 16; i < SHA256_MAX_DATA_LENGTH; ++i) {
+            m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        uint32_t f = state[5];
+        uint32_t g = state[6];
+        uint32_t h = state[7];
+
+        // The rounds are unrolled eight at a time, after which the working
+        // variables are back in their places, so that they are never moved.
+        for (uint32_t i = 0; i < SHA256_MAX_DATA_LENGTH; i += 8) {
+            ROUND(a, b, c, d, e, f, g, h, i);
+            ROUND(h, a, b, c, d, e, f, g, i + 1);
+            ROUND(g, h, a, b, c, d, e, f, i + 2);
+            ROUND(f, g, h, a, b, c, d, e, i + 3);
+            ROUND(e, f, g, h, a, b, c, d, i + 4);
+            ROUND(d, e, f, g, h, a, b, c, i + 5);
+            ROUND(c, d, e, f, g, h, a, b, i + 6);
+            ROUND(b, c, d, e, f, g, h, a, i + 7);
+        }
 
-    // Step 1: Prepare the message schedule (first 16 words are directly from
-    // the input data).
-    for (i = 0, j = 0; i < 16; ++i, j += 4) {
-        // Each 32-bit word is constructed from 4 consecutive 8-bit bytes from
-        // the input data.
-        m[i] = (uint32_t)(data[j] << 24) | (uint32_t)(data[j + 1] << 16) | (uint32_t)(data[j + 2] << 8) |
-               (uint32_t)(data[j + 3]);
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
     }
+}
 
-    // Step 2: Extend the first 16 words into the remaining 48 words of the
-    // message schedule. Each word is computed based on the previous words using
-    // the SIG1 and SIG0 functions.
-    for (; i < SHA256_MAX_DATA_LENGTH; ++i) {
-        m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+/// @brief Four 32-bit integers, inside an SSE register.
+typedef int sha256_v4si_t __attribute__((vector_size(16)));
+/// @brief Eight 16-bit integers, inside an SSE register.
+typedef short sha256_v8hi_t __attribute__((vector_size(16)));
+/// @brief Sixteen bytes, inside an SSE register.
+typedef char sha256_v16qi_t __attribute__((vector_size(16)));
+/// @brief Two 64-bit integers, inside an SSE register.
+typedef long long sha256_v2di_t __attribute__((vector_size(16)));
+
+/// @brief Concatenates two registers, and extracts the 16 bytes starting at the given offset.
+/// @param hi The high half.
+/// @param lo The low half.
+/// @param n The offset, in bytes.
+/// @return The extracted bytes.
+#define SHA256_ALIGNR(hi, lo, n)                                                                                       \
+    ((sha256_v4si_t)__builtin_ia32_palignr128((sha256_v2di_t)(hi), (sha256_v2di_t)(lo), (n) * 8))
+
+/// @brief Takes the low half of a register, and the high half of another.
+/// @param lo The register giving the low half.
+/// @param hi The register giving the high half.
+/// @return The blended register.
+#define SHA256_BLEND(lo, hi)                                                                                           \
+    ((sha256_v4si_t)__builtin_ia32_pblendw128((sha256_v8hi_t)(lo), (sha256_v8hi_t)(hi), 0xF0))
+
+/// @brief Transforms the state with consecutive blocks of input data, through the SHA extensions.
+/// @details The state is kept as the ABEF and CDGH halves, the layout used by
+/// sha256rnds2, each instruction performing two rounds; the message schedule is
+/// a window of four registers, of four words each, extended by sha256msg1 and
+/// sha256msg2 as the rounds consume it.
+/// @param state The hash state.
+/// @param data The blocks (64 bytes each).
+/// @param blocks The number of blocks.
+__attribute__((target("sha,sse4.1"))) static void
+__sha256_transform_shani(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    // Swaps the bytes of each word, which are read in big-endian order.
+    const sha256_v16qi_t swap = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+    sha256_v4si_t state0, state1, tmp, msg, w[4];
+
+    memcpy(&tmp, &state[0], sizeof(tmp));
+    memcpy(&state1, &state[4], sizeof(state1));
+    tmp    = __builtin_ia32_pshufd(tmp, 0xB1);    // CDAB
+    state1 = __builtin_ia32_pshufd(state1, 0x1B); // EFGH
+    state0 = SHA256_ALIGNR(tmp, state1, 8);       // ABEF
+    state1 = SHA256_BLEND(state1, tmp);           // CDGH
+
+    for (; blocks; --blocks, data += SHA256_MAX_DATA_LENGTH) {
+        sha256_v4si_t abef = state0;
+        sha256_v4si_t cdgh = state1;
+        // Each group of four rounds consumes a register of the window, computes
+        // the next one, and starts the computation of the one after.
+        for (unsigned g = 0; g < 16; ++g) {
+            sha256_v4si_t *cur  = &w[g % 4];
+            sha256_v4si_t *prev = &w[(g + 3) % 4];
+            sha256_v4si_t *next = &w[(g + 1) % 4];
+            if (g < 4) {
+                memcpy(cur, data + g * 16, sizeof(*cur));
+                *cur = (sha256_v4si_t)__builtin_ia32_pshufb128((sha256_v16qi_t)*cur, swap);
+            }
+            memcpy(&tmp, &k[g * 4], sizeof(tmp));
+            msg    = *cur + tmp;
+            state1 = __builtin_ia32_sha256rnds2(state1, state0, msg);
+            if ((g >= 3) && (g < 15)) {
+                *next = __builtin_ia32_sha256msg2(*next + SHA256_ALIGNR(*cur, *prev, 4), *cur);
+            }
+            msg    = __builtin_ia32_pshufd(msg, 0x0E);
+            state0 = __builtin_ia32_sha256rnds2(state0, state1, msg);
+            if ((g >= 1) && (g < 13)) {
+                *prev = __builtin_ia32_sha256msg1(*prev, *cur);
+            }
+        }
+        state0 += abef;
+        state1 += cdgh;
     }
 
-    // Step 3: Initialize the working variables with the current state values.
-    a = ctx->state[0];
-    b = ctx->state[1];
-    c = ctx->state[2];
-    d = ctx->state[3];
-    e = ctx->state[4];
-    f = ctx->state[5];
-    g = ctx->state[6];
-    h = ctx->state[7];
-
-    // Step 4: Perform the main hash computation (64 rounds).
-    for (i = 0; i < SHA256_MAX_DATA_LENGTH; ++i) {
-        // Calculate the temporary values.
-        t1 = h + EP1(e) + CH(e, f, g) + k[i] + m[i];
-        t2 = EP0(a) + MAJ(a, b, c);
-
-        // Rotate the working variables for the next round.
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
+    tmp    = __builtin_ia32_pshufd(state0, 0x1B); // FEBA
+    state1 = __builtin_ia32_pshufd(state1, 0xB1); // DCHG
+    state0 = SHA256_BLEND(tmp, state1);           // DCBA
+    state1 = SHA256_ALIGNR(state1, tmp, 8);       // HGFE
+    memcpy(&state[0], &state0, sizeof(state0));
+    memcpy(&state[4], &state1, sizeof(state1));
+}
+
+/// @brief Tells if the CPU has the SHA extensions, along with the SSSE3 and
+/// SSE4.1 instructions used around them, checking it the first time.
+/// @return 1 if it has them, 0 otherwise.
+static inline int __sha256_has_shani(void)
+{
+    // Checked once, -1 until then.
+    static int shani = -1;
+    if (shani < 0) {
+        uint32_t eax = 0, ebx, ecx = 0, edx;
+        __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+        shani = 0;
+        if (eax >= 7) {
+            eax = 1;
+            ecx = 0;
+            __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+            uint32_t features = ecx;
+            eax               = 7;
+            ecx               = 0;
+            __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+            shani = ((features >> 9U) & 1U) && ((features >> 19U) & 1U) && ((ebx >> 29U) & 1U);
+        }
     }
+    return shani;
+}
 
-    // Step 5: Add the resulting values back into the current state.
-    ctx->state[0] += a;
-    ctx->state[1] += b;
-    ctx->state[2] += c;
-    ctx->state[3] += d;
-    ctx->state[4] += e;
-    ctx->state[5] += f;
-    ctx->state[6] += g;
-    ctx->state[7] += h;
+/// @brief Transforms the state with consecutive blocks of input data.
+/// @param state The hash state.
+/// @param data The blocks (64 bytes each).
+/// @param blocks The number of blocks.
+static inline void __sha256_transform(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    if (__sha256_has_shani()) {
+        __sha256_transform_shani(state, data, blocks);
+    } else {
+        __sha256_transform_scalar(state, data, blocks);
+    }
 }
 
 void sha256_bytes_to_hex(uint8_t *src, size_t src_length, char *out, size_t out_length)
@@ -215,24 +317,36 @@ void sha256_update(SHA256_ctx_t *ctx, const uint8_t data[], size_t len)
         return; // Return early if the data is NULL to prevent errors.
     }
 
-    // Iterate over the input data, processing it in chunks.
-    for (uint32_t i = 0; i < len; ++i) {
-        // Add data to the context's buffer.
-        ctx->data[ctx->datalen] = data[i];
-        ctx->datalen++;
-
-        // If the buffer is full, process the data and reset the buffer.
-        if (ctx->datalen == SHA256_MAX_DATA_LENGTH) {
-            // Perform the SHA-256 transformation on the full data block.
-            __sha256_transform(ctx, ctx->data);
-
-            // Update the total length of the data processed so far in bits.
-            ctx->bitlen += 512;
-
-            // Reset the buffer length to 0 for the next chunk of data.
-            ctx->datalen = 0;
+    // Complete the block left in the buffer by the previous call.
+    if (ctx->datalen) {
+        size_t fill = SHA256_MAX_DATA_LENGTH - ctx->datalen;
+        if (fill > len) {
+            fill = len;
+        }
+        memcpy(ctx->data + ctx->datalen, data, fill);
+        ctx->datalen += fill;
+        data += fill;
+        len -= fill;
+        if (ctx->datalen < SHA256_MAX_DATA_LENGTH) {
+            return;
         }
+        __sha256_transform(ctx->state, ctx->data, 1);
+        ctx->bitlen += 512;
+        ctx->datalen = 0;
     }
+
+    // The whole blocks are processed straight from the input data.
+    size_t blocks = len / SHA256_MAX_DATA_LENGTH;
+    if (blocks) {
+        __sha256_transform(ctx->state, data, blocks);
+        ctx->bitlen += 512ULL * blocks;
+        data += blocks * SHA256_MAX_DATA_LENGTH;
+        len -= blocks * SHA256_MAX_DATA_LENGTH;
+    }
+
+    // Keep the rest for the next call.
+    memcpy(ctx->data, data, len);
+    ctx->datalen = len;
 }
 
 void sha256_final(SHA256_ctx_t *ctx, uint8_t hash[])
@@ -274,7 +388,7 @@ void sha256_final(SHA256_ctx_t *ctx, uint8_t hash[])
         }
 
         // Process the full buffer.
-        __sha256_transform(ctx, ctx->data);
+        __sha256_transform(ctx->state, ctx->data, 1);
 
         // Reset the buffer for the next padding.
         memset(ctx->data, 0, 56);
@@ -296,7 +410,7 @@ void sha256_final(SHA256_ctx_t *ctx, uint8_t hash[])
     ctx->data[56] = ctx->bitlen >> 56;
 
     // Process the final block.
-    __sha256_transform(ctx, ctx->data);
+    __sha256_transform(ctx->state, ctx->data, 1);
 
     // Step 3: Copy the final state (hash) to the output buffer.
 
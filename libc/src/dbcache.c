@@ -0,0 +1,237 @@
+/// @file dbcache.c
+/// @brief In-process cache of the line-oriented databases.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "dbcache.h"
+
+#include "ctype.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "unistd.h"
+
+/// @brief Hashes the name of an entry, which ends at the first colon.
+/// @param name the name.
+/// @return the hash.
+static inline size_t __dbcache_hash_name(const char *name)
+{
+    size_t hash = 5381;
+    for (; *name && (*name != ':'); ++name) {
+        hash = ((hash << 5) + hash) + (unsigned char)*name;
+    }
+    return hash;
+}
+
+/// @brief Hashes an id.
+/// @param id the id.
+/// @return the hash.
+static inline size_t __dbcache_hash_id(unsigned long id) { return id * 2654435761U; }
+
+/// @brief Checks if the entry has the given name.
+/// @param line the line of the entry.
+/// @param name the name, which ends at the first colon, or null character.
+/// @return 1 if it has, 0 otherwise.
+static inline int __dbcache_same_name(const char *line, const char *name)
+{
+    for (; *name && (*name != ':'); ++name, ++line) {
+        if (*line != *name) {
+            return 0;
+        }
+    }
+    return (*line == ':') || (*line == '\0');
+}
+
+/// @brief Parses the id of an entry.
+/// @param line the line of the entry.
+/// @param field the field holding the id.
+/// @param id where the id is stored.
+/// @return 0 on success, -1 if the entry has no id.
+static inline int __dbcache_parse_id(const char *line, int field, unsigned long *id)
+{
+    for (int i = 0; i < field; ++i) {
+        if (!(line = strchr(line, ':'))) {
+            return -1;
+        }
+        ++line;
+    }
+    if (!isdigit(*line)) {
+        return -1;
+    }
+    for (*id = 0; isdigit(*line); ++line) {
+        *id = (*id * 10) + (*line - '0');
+    }
+    return 0;
+}
+
+/// @brief Frees the cached content.
+/// @param db the cache.
+static void __dbcache_clear(dbcache_t *db)
+{
+    free(db->content);
+    free(db->lines);
+    free(db->by_name);
+    free(db->by_id);
+    db->content = NULL;
+    db->lines   = NULL;
+    db->by_name = NULL;
+    db->by_id   = NULL;
+    db->count   = 0;
+    db->buckets = 0;
+}
+
+/// @brief Reads the whole file.
+/// @param db the cache.
+/// @param size the size of the file.
+/// @return 0 on success, -1 on failure.
+static int __dbcache_read(dbcache_t *db, size_t size)
+{
+    int fd = open(db->path, O_RDONLY, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    db->content   = malloc(size + 1);
+    size_t length = 0;
+    ssize_t count = 0;
+    while (db->content && (length < size) && ((count = read(fd, db->content + length, size - length)) > 0)) {
+        length += count;
+    }
+    close(fd);
+    if (!db->content || (count < 0)) {
+        return -1;
+    }
+    db->content[length] = '\0';
+    return 0;
+}
+
+/// @brief Splits the content into lines, and indexes them.
+/// @param db the cache.
+/// @return 0 on success, -1 on failure.
+static int __dbcache_index(dbcache_t *db)
+{
+    size_t count = 1;
+    for (const char *it = db->content; (it = strchr(it, '\n')); ++it) {
+        ++count;
+    }
+    db->buckets = 8;
+    while (db->buckets < (count * 2)) {
+        db->buckets <<= 1;
+    }
+    db->lines   = malloc(count * sizeof(char *));
+    db->by_name = calloc(db->buckets, sizeof(size_t));
+    db->by_id   = (db->id_field >= 0) ? calloc(db->buckets, sizeof(size_t)) : NULL;
+    if (!db->lines || !db->by_name || ((db->id_field >= 0) && !db->by_id)) {
+        return -1;
+    }
+    size_t mask = db->buckets - 1;
+    char *next;
+    for (char *line = db->content; line; line = next) {
+        // Terminate the line, without the carriage return.
+        if ((next = strchr(line, '\n'))) {
+            *next++ = '\0';
+        }
+        size_t length = strlen(line);
+        if ((length > 0) && (line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0) {
+            continue;
+        }
+        db->lines[db->count++] = line;
+        // The first entry with a given name, or id, is the one found.
+        size_t i;
+        for (i = __dbcache_hash_name(line) & mask; db->by_name[i]; i = (i + 1) & mask) {
+            if (__dbcache_same_name(db->lines[db->by_name[i] - 1], line)) {
+                break;
+            }
+        }
+        if (!db->by_name[i]) {
+            db->by_name[i] = db->count;
+        }
+        unsigned long id, other;
+        if (!db->by_id || (__dbcache_parse_id(line, db->id_field, &id) < 0)) {
+            continue;
+        }
+        for (i = __dbcache_hash_id(id) & mask; db->by_id[i]; i = (i + 1) & mask) {
+            // Only lines with an id are inside the table.
+            if ((__dbcache_parse_id(db->lines[db->by_id[i] - 1], db->id_field, &other) == 0) && (other == id)) {
+                break;
+            }
+        }
+        if (!db->by_id[i]) {
+            db->by_id[i] = db->count;
+        }
+    }
+    return 0;
+}
+
+/// @brief Reads the file again, if it changed since it was cached.
+/// @param db the cache.
+/// @return 0 on success, -1 on failure.
+static int __dbcache_update(dbcache_t *db)
+{
+    stat_t st;
+    if (stat(db->path, &st) < 0) {
+        __dbcache_clear(db);
+        return -1;
+    }
+    if (db->content && (st.st_mtime == db->mtime) && (st.st_size == db->size) && (st.st_ino == db->ino)) {
+        return 0;
+    }
+    __dbcache_clear(db);
+    if ((__dbcache_read(db, st.st_size) < 0) || (__dbcache_index(db) < 0)) {
+        __dbcache_clear(db);
+        return -1;
+    }
+    db->mtime = st.st_mtime;
+    db->size  = st.st_size;
+    db->ino   = st.st_ino;
+    return 0;
+}
+
+const char *dbcache_find_name(dbcache_t *db, const char *name)
+{
+    if (!name || (__dbcache_update(db) < 0)) {
+        return NULL;
+    }
+    size_t mask = db->buckets - 1;
+    for (size_t i = __dbcache_hash_name(name) & mask; db->by_name[i]; i = (i + 1) & mask) {
+        const char *line = db->lines[db->by_name[i] - 1];
+        if (!strchr(name, ':') && __dbcache_same_name(line, name)) {
+            return line;
+        }
+    }
+    return NULL;
+}
+
+const char *dbcache_find_id(dbcache_t *db, unsigned long id)
+{
+    if ((db->id_field < 0) || (__dbcache_update(db) < 0)) {
+        return NULL;
+    }
+    size_t mask = db->buckets - 1;
+    unsigned long other;
+    for (size_t i = __dbcache_hash_id(id) & mask; db->by_id[i]; i = (i + 1) & mask) {
+        const char *line = db->lines[db->by_id[i] - 1];
+        if ((__dbcache_parse_id(line, db->id_field, &other) == 0) && (other == id)) {
+            return line;
+        }
+    }
+    return NULL;
+}
+
+char *dbcache_copy(const char *line, char *buf, size_t buflen)
+{
+    if (!line) {
+        errno = ENOENT;
+        return NULL;
+    }
+    size_t length = strlen(line);
+    if (length >= buflen) {
+        errno = ERANGE;
+        return NULL;
+    }
+    return memcpy(buf, line, length + 1);
+}
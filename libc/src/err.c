@@ -12,8 +12,8 @@
 void verr(int status, const char *format, va_list args)
 {
     if (format) {
-        vfprintf(STDERR_FILENO, format, args);
-        fprintf(STDERR_FILENO, ": ");
+        vfprintf(stderr, format, args);
+        fprintf(stderr, ": ");
     }
     perror(0);
     exit(status);
@@ -22,9 +22,9 @@ void verr(int status, const char *format, va_list args)
 void verrx(int status, const char *format, va_list args)
 {
     if (format) {
-        vfprintf(STDERR_FILENO, format, args);
+        vfprintf(stderr, format, args);
     }
-    fprintf(STDERR_FILENO, "\n");
+    fprintf(stderr, "\n");
     exit(status);
 }
 
@@ -5,8 +5,10 @@
 
 #include "grp.h"
 #include "assert.h"
+#include "dbcache.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "readline.h"
 #include "stdio.h"
 #include "string.h"
 #include "unistd.h"
@@ -14,6 +16,9 @@
 /// Holds the file descriptor while we are working with `/etc/group`.
 static int __fd = -1;
 
+/// The cache of `/etc/group`, indexed by name and by gid.
+static dbcache_t group_db = DBCACHE_INIT("/etc/group", 2);
+
 /// @brief It parses the line (as string) and saves its content inside the
 /// group_t structure.
 /// @param grp the struct where we store the information.
@@ -46,68 +51,48 @@ static inline void __parse_line(group_t *grp, char *buf)
     grp->gr_mem[found_users] = "\0";
 }
 
-/// @brief Searches an entry in `/etc/group`.
+/// @brief Reads the next line of `/etc/group`, without the carriage return.
 /// @param fd the file descriptor pointing to `/etc/group`.
-/// @param buf the buffer we are going to use to search the entry.
+/// @param buf the buffer where the line is stored.
 /// @param buflen the length of the buffer.
-/// @param name the name we are looking for.
-/// @param gid the group id we must match.
-/// @return 1 on success, 0 on failure.
-static inline int __search_entry(int fd, char *buf, size_t buflen, const char *name, gid_t gid)
+/// @return 1 on success, 0 at the end of the file, -1 if the line does not
+/// fit the buffer (errno is set to ERANGE), or if the file cannot be read.
+static inline int __next_line(int fd, char *buf, size_t buflen)
 {
-    int ret;
-    char c;
-    int pos = 0;
-    while ((ret = read(fd, &c, 1U))) {
-        // Skip carriage return.
-        if (c == '\r') {
-            continue;
-        }
-        if (pos >= buflen) {
+    ssize_t length = 0;
+    int ret        = readline(fd, buf, buflen, &length);
+    if (ret == 0) {
+        return 0;
+    }
+    // The last line might not end with a newline, without being cut.
+    if ((ret < 0) && ((length == 0) || (length == (ssize_t)(buflen - 1)))) {
+        if (length > 0) {
             errno = ERANGE;
-            return 0;
-        }
-        // If we have found a newline or the EOF, parse the entry.
-        if ((c == '\n') || (ret == EOF)) {
-            // Close the buffer.
-            buf[pos] = 0;
-            // Check the entry.
-            if (name) {
-                if (strncmp(buf, name, strlen(name)) == 0 && buf[strlen(name)] == ':') {
-                    return 1;
-                }
-            } else {
-                int gid_start = -1;
-                int col_count = 0;
-                for (int i = 0; i < pos; ++i) {
-                    if (buf[i] == ':') {
-                        if (++col_count == 2) {
-                            gid_start = i + 1;
-                            break;
-                        }
-                    }
-                }
-                if ((gid_start != -1) && (gid_start < pos)) {
-                    // Parse the gid.
-                    int found_gid = atoi(&buf[gid_start]);
-                    // Check the gid.
-                    if (found_gid == gid) {
-                        return 1;
-                    }
-                }
-            }
-            // Reset the index.
-            pos = 0;
-            // If we have reached the EOF stop.
-            if (ret == EOF) {
-                break;
-            }
-        } else {
-            buf[pos++] = c;
         }
+        return -1;
     }
-    errno = ENOENT;
-    return 0;
+    if ((length > 0) && (buf[length - 1] == '\r')) {
+        buf[length - 1] = '\0';
+    }
+    return 1;
+}
+
+/// @brief Fills the group with the entry, copied inside the buffer.
+/// @param line the line of the entry, NULL if it was not found.
+/// @param group the structure we need to fill.
+/// @param buf the buffer where the entry is copied.
+/// @param buflen the length of the buffer.
+/// @param result where the group is stored on success, NULL on failure.
+/// @return 1 on success, 0 on failure.
+static inline int __fill_entry(const char *line, group_t *group, char *buf, size_t buflen, group_t **result)
+{
+    *result = NULL;
+    if (!dbcache_copy(line, buf, buflen)) {
+        return 0;
+    }
+    __parse_line(group, buf);
+    *result = group;
+    return 1;
 }
 
 group_t *getgrgid(gid_t gid)
@@ -142,50 +127,16 @@ group_t *getgrnam(const char *name)
 
 int getgrgid_r(gid_t gid, group_t *group, char *buf, size_t buflen, group_t **result)
 {
-    int fd = open("/etc/group", O_RDONLY, 0);
-    if (fd == -1) {
-        errno   = ENOENT;
-        *result = NULL;
-        return 0;
-    }
-
-    if (__search_entry(fd, buf, buflen, NULL, gid)) {
-        // Close the file.
-        close(fd);
-        // Parse the line.
-        __parse_line(group, buf);
-        // Return success.
-        return 1;
-    }
-
-    // Close the file.
-    close(fd);
-    // Return fail.
-    return 0;
+    return __fill_entry(dbcache_find_id(&group_db, gid), group, buf, buflen, result);
 }
 
 int getgrnam_r(const char *name, group_t *group, char *buf, size_t buflen, group_t **result)
 {
-    int fd = open("/etc/group", O_RDONLY, 0);
-    if (fd == -1) {
-        errno   = ENOENT;
+    if (name == NULL) {
         *result = NULL;
         return 0;
     }
-
-    if (__search_entry(fd, buf, buflen, name, 0)) {
-        // Close the file.
-        close(fd);
-        // Parse the line.
-        __parse_line(group, buf);
-        // Return success.
-        return 1;
-    }
-
-    // Close the file.
-    close(fd);
-    // Return fail.
-    return 0;
+    return __fill_entry(dbcache_find_name(&group_db, name), group, buf, buflen, result);
 }
 
 group_t *getgrent(void)
@@ -201,45 +152,20 @@ group_t *getgrent(void)
         }
     }
 
-    int ret;
-    char c;
-    int pos = 0;
-
     static char buffer[BUFSIZ];
-    while ((ret = read(__fd, &c, 1U))) {
-        // Skip carriage return.
-        if (c == '\r') {
-            continue;
-        }
-
-        if (pos >= BUFSIZ) {
-            errno = ERANGE;
-            return NULL;
-        }
-
-        // If we have found a newline or the EOF, parse the entry.
-        if ((c == '\n') || (ret == EOF)) {
-            // Close the buffer.
-            buffer[pos] = 0;
-
-            // Check the entry.
-            if (strlen(buffer) != 0) {
-                //pr_debug("Found entry in group file: %s\n", buffer);
-                __parse_line(&result, buffer);
-                return &result;
-            }
-
-            // If we have reached the EOF stop.
-            if (ret == EOF) {
-                break;
-            }
-
-        } else {
-            buffer[pos++] = c;
+    int ret;
+    while ((ret = __next_line(__fd, buffer, BUFSIZ)) > 0) {
+        // Check the entry.
+        if (strlen(buffer) != 0) {
+            //pr_debug("Found entry in group file: %s\n", buffer);
+            __parse_line(&result, buffer);
+            return &result;
         }
     }
 
-    errno = ENOENT;
+    if (ret == 0) {
+        errno = ENOENT;
+    }
     return NULL;
 }
 
@@ -254,4 +180,6 @@ void setgrent(void)
 {
     //pr_debug("Resetting pointer to beginning of group file\n");
     lseek(__fd, 0, SEEK_SET);
+    // What was read ahead belongs to the old position.
+    readline_release(__fd);
 }
@@ -1,5 +1,5 @@
 /// @file hashmap.c
-/// @brief Source file for a hashmap implementation with `char *` keys.
+/// @brief Source file for a hashmap implementation with `char *`, or integer keys.
 
 #include "hashmap.h"
 
@@ -7,6 +7,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+/// @brief Mixes the bits of a hash, so that its low bits depend on all of them.
+/// @param h The hash.
+/// @return The mixed hash, never 0, which marks the empty slots.
+static inline size_t __hashmap_mix(size_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35U;
+    h ^= h >> 16;
+    return h ? h : 1;
+}
+
 size_t hash(const char *key)
 {
     size_t hash = 5381;
@@ -14,87 +27,234 @@ size_t hash(const char *key)
     while ((c = (int)*key++)) {
         hash = ((hash << 5) + hash) + c; // hash * 33 + c
     }
-    return hash % HASHMAP_SIZE;
+    return __hashmap_mix(hash);
 }
 
-void hashmap_init(hashmap_t *map, hashmap_entry_t *(*alloc_fn)(void), void (*dealloc_fn)(hashmap_entry_t *))
+/// @brief Computes the hash of a key of the map.
+/// @param map The hashmap.
+/// @param key The key.
+/// @return The hash.
+static inline size_t __hashmap_hash(hashmap_t *map, unsigned long key)
 {
-    assert(map && "Hashmap is NULL.");
-    memset((void *)map->buckets, 0, sizeof(map->buckets));
-    map->alloc_entry   = alloc_fn;
-    map->dealloc_entry = dealloc_fn;
+    return (map->key_type == HASHMAP_KEY_STRING) ? hash((const char *)key) : __hashmap_mix(key);
 }
 
-void hashmap_insert(hashmap_t *map, const char *key, void *value)
+/// @brief Checks if the entry holds the given key.
+/// @param map The hashmap.
+/// @param entry The entry.
+/// @param h The hash of the key.
+/// @param key The key.
+/// @return 1 if it does, 0 otherwise.
+static inline int __hashmap_match(hashmap_t *map, hashmap_entry_t *entry, size_t h, unsigned long key)
 {
-    assert(map && "Hashmap is NULL.");
-    assert(key && "Key is NULL.");
+    if (entry->hash != h) {
+        return 0;
+    }
+    if (map->key_type == HASHMAP_KEY_STRING) {
+        return strcmp((const char *)entry->key, (const char *)key) == 0;
+    }
+    return entry->key == key;
+}
 
-    size_t hashed_key          = hash(key);
-    size_t index               = hashed_key % HASHMAP_SIZE;
-    hashmap_entry_t *new_entry = map->alloc_entry();
-    assert(new_entry && "Failed to allocate memory for hashmap entry.");
+/// @brief Computes how far the entry in the slot is from its home slot.
+/// @param map The hashmap.
+/// @param index The slot.
+/// @return The distance.
+static inline size_t __hashmap_distance(hashmap_t *map, size_t index)
+{
+    return (index - map->entries[index].hash) & (map->capacity - 1);
+}
 
-    new_entry->hash     = hashed_key;
-    new_entry->value    = value;
-    new_entry->next     = map->buckets[index];
-    map->buckets[index] = new_entry;
+/// @brief Places an entry whose key is not in the map, into a map which has room for it.
+/// @param map The hashmap.
+/// @param entry The entry.
+static void __hashmap_place(hashmap_t *map, hashmap_entry_t entry)
+{
+    size_t mask = map->capacity - 1, distance = 0;
+    for (size_t index = entry.hash & mask;; index = (index + 1) & mask, ++distance) {
+        hashmap_entry_t *slot = &map->entries[index];
+        if (!slot->hash) {
+            *slot = entry;
+            map->count++;
+            return;
+        }
+        // The entry takes the place of one nearer to its home, which moves on.
+        size_t slot_distance = __hashmap_distance(map, index);
+        if (slot_distance < distance) {
+            hashmap_entry_t displaced = *slot;
+            *slot                     = entry;
+            entry                     = displaced;
+            distance                  = slot_distance;
+        }
+    }
 }
 
-void *hashmap_get(hashmap_t *map, const char *key)
+/// @brief Changes the number of slots, placing the entries again.
+/// @param map The hashmap.
+/// @param capacity The new number of slots, a power of two.
+/// @return 0 on success, -1 on failure.
+static int __hashmap_resize(hashmap_t *map, size_t capacity)
 {
-    assert(map && "Hashmap is NULL.");
-    assert(key && "Key is NULL.");
+    hashmap_entry_t *entries = map->alloc(capacity * sizeof(hashmap_entry_t));
+    if (!entries) {
+        return -1;
+    }
+    memset(entries, 0, capacity * sizeof(hashmap_entry_t));
+    hashmap_entry_t *old = map->entries;
+    size_t old_capacity  = map->capacity;
+    map->entries         = entries;
+    map->capacity        = capacity;
+    map->count           = 0;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i].hash) {
+            __hashmap_place(map, old[i]);
+        }
+    }
+    if (old) {
+        map->dealloc(old);
+    }
+    return 0;
+}
 
-    size_t hashed_key      = hash(key);
-    size_t index           = hashed_key % HASHMAP_SIZE;
-    hashmap_entry_t *entry = map->buckets[index];
+/// @brief Finds the slot of a key.
+/// @param map The hashmap.
+/// @param h The hash of the key.
+/// @param key The key.
+/// @return The index of the slot, or -1 if the key is not found.
+static long __hashmap_find(hashmap_t *map, size_t h, unsigned long key)
+{
+    if (!map->count) {
+        return -1;
+    }
+    size_t mask = map->capacity - 1, distance = 0;
+    // Past an entry nearer to its home than the key would be, the key is not there.
+    for (size_t index = h & mask; map->entries[index].hash; index = (index + 1) & mask, ++distance) {
+        if (__hashmap_distance(map, index) < distance) {
+            break;
+        }
+        if (__hashmap_match(map, &map->entries[index], h, key)) {
+            return (long)index;
+        }
+    }
+    return -1;
+}
 
-    while (entry != NULL) {
-        if (entry->hash == hashed_key) {
-            return entry->value;
+/// @brief Inserts a key-value pair, or changes the value of the key.
+/// @param map The hashmap.
+/// @param key The key.
+/// @param value The value.
+/// @return 0 on success, -1 on failure.
+static int __hashmap_insert(hashmap_t *map, unsigned long key, void *value)
+{
+    size_t h   = __hashmap_hash(map, key);
+    long found = __hashmap_find(map, h, key);
+    if (found >= 0) {
+        map->entries[found].value = value;
+        return 0;
+    }
+    // Keep the load below three quarters.
+    if (((map->count + 1) * 4) > (map->capacity * 3)) {
+        size_t capacity = map->capacity ? (map->capacity * 2) : HASHMAP_MIN_CAPACITY;
+        if (__hashmap_resize(map, capacity) < 0) {
+            return -1;
         }
-        entry = entry->next;
     }
-    return NULL; // Key not found
+    __hashmap_place(map, (hashmap_entry_t){h, key, value});
+    return 0;
 }
 
-void hashmap_remove(hashmap_t *map, const char *key)
+/// @brief Removes a key, shifting back the entries which follow it.
+/// @param map The hashmap.
+/// @param key The key.
+/// @return The value of the key, or NULL if it is not found.
+static void *__hashmap_remove(hashmap_t *map, unsigned long key)
+{
+    long found = __hashmap_find(map, __hashmap_hash(map, key), key);
+    if (found < 0) {
+        return NULL;
+    }
+    size_t mask = map->capacity - 1, index = (size_t)found;
+    void *value = map->entries[index].value;
+    for (size_t next = (index + 1) & mask; map->entries[next].hash && __hashmap_distance(map, next);
+         index = next, next = (next + 1) & mask) {
+        map->entries[index] = map->entries[next];
+    }
+    memset(&map->entries[index], 0, sizeof(hashmap_entry_t));
+    map->count--;
+    return value;
+}
+
+void hashmap_init(hashmap_t *map, hashmap_key_type_t key_type, void *(*alloc_fn)(size_t), void (*dealloc_fn)(void *))
 {
     assert(map && "Hashmap is NULL.");
+    assert(alloc_fn && dealloc_fn && "Hashmap allocation functions are NULL.");
+    map->entries  = NULL;
+    map->capacity = 0;
+    map->count    = 0;
+    map->key_type = key_type;
+    map->alloc    = alloc_fn;
+    map->dealloc  = dealloc_fn;
+}
+
+int hashmap_insert(hashmap_t *map, const char *key, void *value)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_STRING) && "Hashmap is NULL, or without string keys.");
     assert(key && "Key is NULL.");
+    return __hashmap_insert(map, (unsigned long)key, value);
+}
 
-    size_t hashed_key      = hash(key);
-    size_t index           = hashed_key % HASHMAP_SIZE;
-    hashmap_entry_t *entry = map->buckets[index];
-    hashmap_entry_t *prev  = NULL;
-
-    while (entry != NULL) {
-        if (entry->hash == hashed_key) {
-            if (prev == NULL) {
-                map->buckets[index] = entry->next;
-            } else {
-                prev->next = entry->next;
-            }
-            map->dealloc_entry(entry);
-            return;
+void *hashmap_get(hashmap_t *map, const char *key)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_STRING) && "Hashmap is NULL, or without string keys.");
+    assert(key && "Key is NULL.");
+    long found = __hashmap_find(map, hash(key), (unsigned long)key);
+    return (found >= 0) ? map->entries[found].value : NULL;
+}
+
+void *hashmap_remove(hashmap_t *map, const char *key)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_STRING) && "Hashmap is NULL, or without string keys.");
+    assert(key && "Key is NULL.");
+    return __hashmap_remove(map, (unsigned long)key);
+}
+
+int hashmap_insert_int(hashmap_t *map, unsigned long key, void *value)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_INT) && "Hashmap is NULL, or without integer keys.");
+    return __hashmap_insert(map, key, value);
+}
+
+void *hashmap_get_int(hashmap_t *map, unsigned long key)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_INT) && "Hashmap is NULL, or without integer keys.");
+    long found = __hashmap_find(map, __hashmap_mix(key), key);
+    return (found >= 0) ? map->entries[found].value : NULL;
+}
+
+void *hashmap_remove_int(hashmap_t *map, unsigned long key)
+{
+    assert(map && (map->key_type == HASHMAP_KEY_INT) && "Hashmap is NULL, or without integer keys.");
+    return __hashmap_remove(map, key);
+}
+
+hashmap_entry_t *hashmap_next(hashmap_t *map, size_t *index)
+{
+    assert(map && index && "Hashmap or index is NULL.");
+    for (; *index < map->capacity; ++(*index)) {
+        if (map->entries[*index].hash) {
+            return &map->entries[(*index)++];
         }
-        prev  = entry;
-        entry = entry->next;
     }
+    return NULL;
 }
 
 void hashmap_destroy(hashmap_t *map)
 {
     assert(map && "Hashmap is NULL.");
-
-    for (int i = 0; i < HASHMAP_SIZE; i++) {
-        hashmap_entry_t *entry = map->buckets[i];
-        while (entry != NULL) {
-            hashmap_entry_t *next_entry = entry->next;
-            map->dealloc_entry(entry);
-            entry = next_entry;
-        }
-        map->buckets[i] = NULL;
+    if (map->entries) {
+        map->dealloc(map->entries);
     }
+    map->entries  = NULL;
+    map->capacity = 0;
+    map->count    = 0;
 }
@@ -5,14 +5,30 @@
 
 #include "assert.h"
 #include "errno.h"
+#include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "sys/auxv.h"
 #include "system/syscall_types.h"
 #include "unistd.h"
 
 /// @brief Reference to the `environ` variable in `setenv.c`.
 extern char **environ;
 
+/// The auxiliary vector, which follows the environment placed by the kernel.
+static const auxv_t *__auxv = NULL;
+
+unsigned long getauxval(unsigned long type)
+{
+    for (const auxv_t *entry = __auxv; entry && (entry->a_type != AT_NULL); ++entry) {
+        if (entry->a_type == type) {
+            return entry->a_val;
+        }
+    }
+    errno = ENOENT;
+    return 0;
+}
+
 /// @brief The entry point to every program.
 /// @param main Pointer to the main function.
 /// @param argc The number of arguments.
@@ -27,10 +43,18 @@ int __libc_start_main(int (*main)(int, char **, char **), int argc, char *argv[]
     assert(argv && "There is no `argv` array.");
     assert(envp && "There is no `envp` array.");
     //dbg_print("environ  : %p\n", environ);
+    // The auxiliary vector starts after the end of the environment.
+    char **env = envp;
+    while (*env) {
+        ++env;
+    }
+    __auxv     = (const auxv_t *)(env + 1);
     // Copy the environ.
     environ    = envp;
     // Call the main function.
     int result = main(argc, argv, envp);
+    // Write the buffered output.
+    fflush(NULL);
     // Free the environ.
     //dbg_print("== END   %-30s =======================================\n", argv[0]);
     return result;
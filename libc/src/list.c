@@ -3,6 +3,26 @@
 
 #include "list.h"
 
+#include "arena.h"
+
+/// @brief Allocates a node, from the arena of the list if it has one.
+/// @param list The list.
+/// @return The node, or NULL on failure.
+static inline listnode_t *__list_alloc_node(list_t *list)
+{
+    return list->arena ? arena_alloc(list->arena, sizeof(listnode_t)) : list->alloc();
+}
+
+/// @brief Deallocates a node, unless it belongs to an arena, which frees it on reset.
+/// @param list The list.
+/// @param node The node.
+static inline void __list_dealloc_node(list_t *list, listnode_t *node)
+{
+    if (!list->arena) {
+        list->dealloc(node);
+    }
+}
+
 void list_init(list_t *list, listnode_t *(*alloc_fn)(void), void (*dealloc_fn)(listnode_t *))
 {
     assert(list && "List is null.");
@@ -10,13 +30,25 @@ void list_init(list_t *list, listnode_t *(*alloc_fn)(void), void (*dealloc_fn)(l
     list->size    = 0;
     list->alloc   = alloc_fn;
     list->dealloc = dealloc_fn;
+    list->arena   = NULL;
+}
+
+void list_init_arena(list_t *list, struct arena *arena)
+{
+    assert(list && "List is null.");
+    assert(arena && "Arena is null.");
+    list_head_init(&list->head);
+    list->size    = 0;
+    list->alloc   = NULL;
+    list->dealloc = NULL;
+    list->arena   = arena;
 }
 
 listnode_t *list_insert_front(list_t *list, void *value)
 {
     assert(list && "List is null.");
     assert(value && "Value is null.");
-    listnode_t *node = list->alloc();
+    listnode_t *node = __list_alloc_node(list);
     assert(node && "Failed to allocate node.");
     node->value = value;
     list_head_insert_after(&node->list, &list->head);
@@ -28,7 +60,7 @@ listnode_t *list_insert_back(list_t *list, void *value)
 {
     assert(list && "List is null.");
     assert(value && "Value is null.");
-    listnode_t *node = list->alloc();
+    listnode_t *node = __list_alloc_node(list);
     assert(node && "Failed to allocate node.");
     node->value = value;
     list_head_insert_before(&node->list, &list->head);
@@ -42,7 +74,7 @@ void *list_remove_node(list_t *list, listnode_t *node)
     assert(node && "Node is null.");
     void *value = node->value;
     list_head_remove(&node->list);
-    list->dealloc(node);
+    __list_dealloc_node(list, node);
     list->size--;
     return value;
 }
@@ -73,7 +105,7 @@ void list_destroy(list_t *list)
     list_for_each_safe_decl(entry, store, &list->head)
     {
         listnode_t *it = list_entry(entry, listnode_t, list);
-        list->dealloc(it);
+        __list_dealloc_node(list, it);
     }
     list_head_init(&list->head);
     list->size = 0;
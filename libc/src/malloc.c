@@ -0,0 +1,472 @@
+/// @file malloc.c
+/// @brief Dynamic memory allocation.
+/// @details
+/// The blocks are carved out of the heap, which is grown with sbrk(), and
+/// are managed as a two-level segregated fit (TLSF) allocator: the free
+/// blocks are kept inside lists, one for each size range, whose first level
+/// splits the sizes by powers of two, and whose second level splits each
+/// power of two in linear steps. Two bitmaps tell which lists hold blocks,
+/// so both malloc() and free() take constant time, and the blocks next to
+/// each other in memory are merged once free, which bounds fragmentation.
+/// The kernel is entered only when the heap has to grow. The blocks larger
+/// than MALLOC_MMAP_THRESHOLD are mapped, and unmapped, on their own with
+/// mmap(). The lists live inside an arena, so that a cache private to each
+/// thread can be placed in front of it.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "stdlib.h"
+#include "pthread.h"
+#include "stddef.h"
+#include "stdint.h"
+#include "string.h"
+#include "sys/mman.h"
+#include "unistd.h"
+
+/// @brief Number which identifies a memory area allocated through a call to
+/// malloc(), calloc() or realloc().
+#define MALLOC_MAGIC_NUMBER 0x600DC0DE
+/// @brief Number which identifies a block waiting inside a free list.
+#define MALLOC_FREE_NUMBER  0xDEADC0DE
+/// @brief Flag of the size of the blocks mapped on their own.
+#define MALLOC_MAPPED       1U
+
+/// The logarithm of the alignment of the blocks, and of their sizes.
+#define MALLOC_ALIGN_LOG2     3
+/// The alignment of the blocks, and of their sizes.
+#define MALLOC_ALIGNMENT      (1U << MALLOC_ALIGN_LOG2)
+/// The size of a page, blocks mapped on their own span whole pages.
+#define MALLOC_PAGE_SIZE      4096
+/// The minimum amount of memory the heap grows by.
+#define MALLOC_HEAP_INCREMENT (64 * 1024)
+/// The size past which blocks are mapped on their own.
+#define MALLOC_MMAP_THRESHOLD (128 * 1024)
+
+/// The logarithm of the number of second level lists, for each power of two.
+#define MALLOC_SL_LOG2  4
+/// The number of second level lists, for each power of two.
+#define MALLOC_SL_COUNT (1U << MALLOC_SL_LOG2)
+/// The sizes below 2^MALLOC_FL_SHIFT share the first list of the first level, linearly split.
+#define MALLOC_FL_SHIFT (MALLOC_SL_LOG2 + MALLOC_ALIGN_LOG2)
+/// The logarithm of the largest free block.
+#define MALLOC_FL_MAX   30
+/// The number of first level lists.
+#define MALLOC_FL_COUNT (MALLOC_FL_MAX - MALLOC_FL_SHIFT + 1)
+
+/// @brief The header of a block, followed by the memory it holds.
+typedef struct malloc_block {
+    /// The previous block in memory, NULL for the first one of a region.
+    struct malloc_block *prev_phys;
+    /// The amount of memory the block holds, and the MALLOC_MAPPED flag.
+    size_t size;
+    /// @brief A magic number that is used to check if the passed pointer is
+    /// actually a malloc allocated memory.
+    unsigned magic;
+    /// The size requested for the block, useful when doing a realloc.
+    size_t requested;
+    /// The next block of the same free list, only while free.
+    struct malloc_block *next_free;
+    /// The previous block of the same free list, only while free.
+    struct malloc_block *prev_free;
+} malloc_block_t;
+
+/// The size of the header of a block.
+#define MALLOC_HEADER_SIZE offsetof(malloc_block_t, next_free)
+/// The minimum amount of memory of a block, which holds the links of the free lists.
+#define MALLOC_MIN_SIZE    (sizeof(malloc_block_t) - MALLOC_HEADER_SIZE)
+
+/// @brief The free blocks, and the end of the heap.
+typedef struct malloc_arena {
+    /// The first level lists which hold blocks.
+    uint32_t fl_bitmap;
+    /// The second level lists which hold blocks, for each first level.
+    uint32_t sl_bitmap[MALLOC_FL_COUNT];
+    /// The free lists.
+    malloc_block_t *blocks[MALLOC_FL_COUNT][MALLOC_SL_COUNT];
+    /// The end of the last region of memory obtained for the heap.
+    char *end;
+    /// Serializes the threads of the process.
+    pthread_mutex_t lock;
+} malloc_arena_t;
+
+/// The arena shared by the whole process.
+static malloc_arena_t main_arena;
+
+/// @brief Returns the index of the most significant bit which is set.
+/// @param value the value, not zero.
+/// @return the index of the bit.
+static inline unsigned __malloc_fls(size_t value) { return 31 - __builtin_clz(value); }
+
+/// @brief Returns the memory held by a block.
+/// @param block the block.
+/// @return a pointer to the memory.
+static inline void *__malloc_block_to_ptr(malloc_block_t *block) { return (char *)block + MALLOC_HEADER_SIZE; }
+
+/// @brief Returns the block holding the given memory.
+/// @param ptr the memory.
+/// @return the block.
+static inline malloc_block_t *__malloc_ptr_to_block(void *ptr)
+{
+    return (malloc_block_t *)((char *)ptr - MALLOC_HEADER_SIZE);
+}
+
+/// @brief Returns the next block in memory.
+/// @param block the block, not mapped on its own.
+/// @return the next block.
+static inline malloc_block_t *__malloc_next_phys(malloc_block_t *block)
+{
+    return (malloc_block_t *)((char *)__malloc_block_to_ptr(block) + block->size);
+}
+
+/// @brief Computes the lists holding the blocks of the given size.
+/// @param size the size.
+/// @param fl where the first level is stored.
+/// @param sl where the second level is stored.
+static inline void __malloc_mapping_insert(size_t size, unsigned *fl, unsigned *sl)
+{
+    if (size < (1U << MALLOC_FL_SHIFT)) {
+        *fl = 0;
+        *sl = size / ((1U << MALLOC_FL_SHIFT) / MALLOC_SL_COUNT);
+    } else {
+        unsigned order = __malloc_fls(size);
+        *sl            = (size >> (order - MALLOC_SL_LOG2)) ^ MALLOC_SL_COUNT;
+        *fl            = order - (MALLOC_FL_SHIFT - 1);
+    }
+}
+
+/// @brief Computes the first lists whose blocks are all at least of the given size.
+/// @param size the size.
+/// @param fl where the first level is stored.
+/// @param sl where the second level is stored.
+static inline void __malloc_mapping_search(size_t size, unsigned *fl, unsigned *sl)
+{
+    if (size >= (1U << MALLOC_FL_SHIFT)) {
+        size += (1U << (__malloc_fls(size) - MALLOC_SL_LOG2)) - 1;
+    }
+    __malloc_mapping_insert(size, fl, sl);
+}
+
+/// @brief Inserts a free block inside its list.
+/// @param arena the arena.
+/// @param block the block.
+static void __malloc_insert(malloc_arena_t *arena, malloc_block_t *block)
+{
+    unsigned fl, sl;
+    __malloc_mapping_insert(block->size, &fl, &sl);
+    malloc_block_t *head = arena->blocks[fl][sl];
+    block->magic         = MALLOC_FREE_NUMBER;
+    block->next_free     = head;
+    block->prev_free     = NULL;
+    if (head) {
+        head->prev_free = block;
+    }
+    arena->blocks[fl][sl] = block;
+    arena->fl_bitmap |= 1U << fl;
+    arena->sl_bitmap[fl] |= 1U << sl;
+}
+
+/// @brief Removes a free block from its list.
+/// @param arena the arena.
+/// @param block the block.
+static void __malloc_remove(malloc_arena_t *arena, malloc_block_t *block)
+{
+    unsigned fl, sl;
+    __malloc_mapping_insert(block->size, &fl, &sl);
+    if (block->next_free) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free) {
+        block->prev_free->next_free = block->next_free;
+    } else {
+        arena->blocks[fl][sl] = block->next_free;
+        // Clear the bits of the lists which are now empty.
+        if (!block->next_free) {
+            arena->sl_bitmap[fl] &= ~(1U << sl);
+            if (!arena->sl_bitmap[fl]) {
+                arena->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    block->magic = MALLOC_MAGIC_NUMBER;
+}
+
+/// @brief Finds a free block of at least the given size, without removing it.
+/// @param arena the arena.
+/// @param size the size.
+/// @return the block, NULL if there is none.
+static malloc_block_t *__malloc_find(malloc_arena_t *arena, size_t size)
+{
+    unsigned fl, sl;
+    __malloc_mapping_search(size, &fl, &sl);
+    if (fl >= MALLOC_FL_COUNT) {
+        return NULL;
+    }
+    // Look inside the lists of the same power of two first, then inside the
+    // first larger power of two which holds blocks.
+    uint32_t sl_map = arena->sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        uint32_t fl_map = arena->fl_bitmap & (~0U << (fl + 1));
+        if (!fl_map) {
+            return NULL;
+        }
+        fl     = __builtin_ctz(fl_map);
+        sl_map = arena->sl_bitmap[fl];
+    }
+    return arena->blocks[fl][__builtin_ctz(sl_map)];
+}
+
+/// @brief Gives a block back to the arena, merging it with the free blocks next to it.
+/// @param arena the arena.
+/// @param block the block.
+static void __malloc_release(malloc_arena_t *arena, malloc_block_t *block)
+{
+    malloc_block_t *prev = block->prev_phys;
+    if (prev && (prev->magic == MALLOC_FREE_NUMBER)) {
+        __malloc_remove(arena, prev);
+        prev->size += MALLOC_HEADER_SIZE + block->size;
+        block = prev;
+    }
+    malloc_block_t *next = __malloc_next_phys(block);
+    if (next->magic == MALLOC_FREE_NUMBER) {
+        __malloc_remove(arena, next);
+        block->size += MALLOC_HEADER_SIZE + next->size;
+    }
+    __malloc_next_phys(block)->prev_phys = block;
+    __malloc_insert(arena, block);
+}
+
+/// @brief Gives back to the arena the memory of a block past the given size, if large enough.
+/// @param arena the arena.
+/// @param block the block.
+/// @param size the size the block keeps.
+static void __malloc_trim(malloc_arena_t *arena, malloc_block_t *block, size_t size)
+{
+    if (block->size < (size + MALLOC_HEADER_SIZE + MALLOC_MIN_SIZE)) {
+        return;
+    }
+    malloc_block_t *rest = (malloc_block_t *)((char *)__malloc_block_to_ptr(block) + size);
+    rest->prev_phys      = block;
+    rest->size           = block->size - size - MALLOC_HEADER_SIZE;
+    block->size          = size;
+    __malloc_release(arena, rest);
+}
+
+/// @brief Grows the heap, with at least a free block of the given size.
+/// @param arena the arena.
+/// @param size the size.
+/// @return 0 on success, -1 if no memory is left.
+static int __malloc_grow(malloc_arena_t *arena, size_t size)
+{
+    // The free lists are searched from the first one whose blocks are all
+    // large enough, the new block must belong to it.
+    if (size >= (1U << MALLOC_FL_SHIFT)) {
+        size += 1U << (__malloc_fls(size) - MALLOC_SL_LOG2);
+    }
+    size_t increment = size + 2 * MALLOC_HEADER_SIZE;
+    if (increment < MALLOC_HEAP_INCREMENT) {
+        increment = MALLOC_HEAP_INCREMENT;
+    }
+    increment    = (increment + MALLOC_PAGE_SIZE - 1) & ~(MALLOC_PAGE_SIZE - 1);
+    // Once the heap is full, the memory is mapped instead.
+    char *memory = sbrk(increment);
+    if (memory == (char *)-1) {
+        memory = mmap(NULL, increment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            return -1;
+        }
+    }
+    malloc_block_t *block;
+    if (arena->end && (memory == arena->end)) {
+        // The new memory follows the previous one: the block which marked
+        // its end becomes the new free block.
+        block       = (malloc_block_t *)(arena->end - MALLOC_HEADER_SIZE);
+        block->size = increment - MALLOC_HEADER_SIZE;
+    } else {
+        block            = (malloc_block_t *)memory;
+        block->prev_phys = NULL;
+        block->size      = increment - 2 * MALLOC_HEADER_SIZE;
+    }
+    // An empty block, which is never free, marks the end of the memory.
+    malloc_block_t *last = __malloc_next_phys(block);
+    last->prev_phys      = block;
+    last->size           = 0;
+    last->magic          = MALLOC_MAGIC_NUMBER;
+    last->requested      = 0;
+    arena->end           = memory + increment;
+    __malloc_release(arena, block);
+    return 0;
+}
+
+void *malloc(size_t size)
+{
+    // Return NULL if size is zero, as no memory needs to be allocated.
+    if (size == 0) {
+        return NULL;
+    }
+    malloc_block_t *block;
+    if (size >= MALLOC_MMAP_THRESHOLD) {
+        // Large blocks are mapped on their own, and given back on free().
+        if (size > (SIZE_MAX - MALLOC_HEADER_SIZE - MALLOC_PAGE_SIZE)) {
+            return NULL;
+        }
+        size_t length = (size + MALLOC_HEADER_SIZE + MALLOC_PAGE_SIZE - 1) & ~(MALLOC_PAGE_SIZE - 1);
+        block         = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            return NULL;
+        }
+        block->prev_phys = NULL;
+        block->size      = (length - MALLOC_HEADER_SIZE) | MALLOC_MAPPED;
+    } else {
+        size_t adjusted = (size + MALLOC_ALIGNMENT - 1) & ~(MALLOC_ALIGNMENT - 1);
+        if (adjusted < MALLOC_MIN_SIZE) {
+            adjusted = MALLOC_MIN_SIZE;
+        }
+        // Take a free block, growing the heap if there is none.
+        pthread_mutex_lock(&main_arena.lock);
+        block = __malloc_find(&main_arena, adjusted);
+        if (!block && (__malloc_grow(&main_arena, adjusted) == 0)) {
+            block = __malloc_find(&main_arena, adjusted);
+        }
+        if (!block) {
+            pthread_mutex_unlock(&main_arena.lock);
+            return NULL;
+        }
+        __malloc_remove(&main_arena, block);
+        // Give back what the block holds in excess.
+        __malloc_trim(&main_arena, block, adjusted);
+        pthread_mutex_unlock(&main_arena.lock);
+    }
+    // Set the magic number to verify validity.
+    block->magic     = MALLOC_MAGIC_NUMBER;
+    // Store the requested size.
+    block->requested = size;
+    // Return a pointer to the memory block after the header.
+    return __malloc_block_to_ptr(block);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    // Check for overflow in multiplication (num * size)
+    if ((num != 0) && (size > (SIZE_MAX / num))) {
+        return NULL;
+    }
+    // Allocate memory.
+    void *ptr = malloc(num * size);
+    if (ptr) {
+        // Zero-initialize the allocated memory, blocks are recycled.
+        memset(ptr, 0, num * size);
+    }
+    // Return the allocated and initialized memory.
+    return ptr;
+}
+
+/// @brief Resizes a block without moving it, if possible.
+/// @param arena the arena.
+/// @param block the block.
+/// @param size the new size.
+/// @return 1 if the block has been resized, 0 otherwise.
+static int __malloc_resize(malloc_arena_t *arena, malloc_block_t *block, size_t size)
+{
+    // A block mapped on its own is resized only while it keeps the same mapping.
+    if (block->size & MALLOC_MAPPED) {
+        size_t length = (size + MALLOC_HEADER_SIZE + MALLOC_PAGE_SIZE - 1) & ~(MALLOC_PAGE_SIZE - 1);
+        return (size >= MALLOC_MMAP_THRESHOLD) && (length == ((block->size & ~MALLOC_MAPPED) + MALLOC_HEADER_SIZE));
+    }
+    if (size >= MALLOC_MMAP_THRESHOLD) {
+        return 0;
+    }
+    size_t adjusted = (size + MALLOC_ALIGNMENT - 1) & ~(MALLOC_ALIGNMENT - 1);
+    if (adjusted < MALLOC_MIN_SIZE) {
+        adjusted = MALLOC_MIN_SIZE;
+    }
+    // Take the free block which follows, if the block is too small.
+    if (adjusted > block->size) {
+        malloc_block_t *next = __malloc_next_phys(block);
+        if ((next->magic != MALLOC_FREE_NUMBER) || ((block->size + MALLOC_HEADER_SIZE + next->size) < adjusted)) {
+            return 0;
+        }
+        __malloc_remove(arena, next);
+        block->size += MALLOC_HEADER_SIZE + next->size;
+        __malloc_next_phys(block)->prev_phys = block;
+    }
+    __malloc_trim(arena, block, adjusted);
+    return 1;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    // C standard implementation: When NULL is passed to realloc, simply malloc
+    // the requested size and return a pointer to that.
+    if (__builtin_expect(ptr == NULL, 0)) {
+        return malloc(size);
+    }
+    // C standard implementation: For a size of zero, free the pointer and
+    // return NULL, allocating no new memory.
+    if (__builtin_expect(size == 0, 0)) {
+        free(ptr);
+        return NULL;
+    }
+    // Get the header of the block.
+    malloc_block_t *block = __malloc_ptr_to_block(ptr);
+    // Validate the header.
+    if (block->magic != MALLOC_MAGIC_NUMBER) {
+        return NULL;
+    }
+    // Get the old size from the header.
+    size_t old_size = block->requested;
+    // The memory past the old size is zero-filled, whether the block moves or not.
+    pthread_mutex_lock(&main_arena.lock);
+    int resized = __malloc_resize(&main_arena, block, size);
+    pthread_mutex_unlock(&main_arena.lock);
+    if (resized) {
+        if (size > old_size) {
+            memset((char *)ptr + old_size, 0, size - old_size);
+        }
+        block->requested = size;
+        return ptr;
+    }
+    // Allocate new memory for the resized block.
+    void *newp = malloc(size);
+    if (newp) {
+        // Copy the contents from the old memory block to the new one.
+        memcpy(newp, ptr, old_size < size ? old_size : size);
+        if (size > old_size) {
+            memset((char *)newp + old_size, 0, size - old_size);
+        }
+        // Free the old memory block.
+        free(ptr);
+    }
+    // Return the pointer to the new memory block.
+    return newp;
+}
+
+void free(void *ptr)
+{
+    if (ptr) {
+        // Get the header of the block.
+        malloc_block_t *block = __malloc_ptr_to_block(ptr);
+        // Validate the header, which also catches double frees.
+        if (block->magic != MALLOC_MAGIC_NUMBER) {
+            return;
+        }
+        if (block->size & MALLOC_MAPPED) {
+            munmap(block, (block->size & ~MALLOC_MAPPED) + MALLOC_HEADER_SIZE);
+        } else {
+            pthread_mutex_lock(&main_arena.lock);
+            __malloc_release(&main_arena, block);
+            pthread_mutex_unlock(&main_arena.lock);
+        }
+    }
+}
+
+size_t malloc_usable_size(void *ptr)
+{
+    if (!ptr) {
+        return 0;
+    }
+    malloc_block_t *block = __malloc_ptr_to_block(ptr);
+    if (block->magic != MALLOC_MAGIC_NUMBER) {
+        return 0;
+    }
+    return block->size & ~MALLOC_MAPPED;
+}
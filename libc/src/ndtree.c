@@ -5,8 +5,28 @@
 
 #include "ndtree.h"
 
+#include "arena.h"
 #include "assert.h"
 
+/// @brief Allocates a node, from the arena of the tree if it has one.
+/// @param tree The tree.
+/// @param value The value to store in the node.
+/// @return The node, or NULL on failure.
+static inline ndtree_node_t *__ndtree_alloc_node(ndtree_t *tree, void *value)
+{
+    return tree->arena ? arena_alloc(tree->arena, sizeof(ndtree_node_t)) : tree->alloc_node(value);
+}
+
+/// @brief Deallocates a node, unless it belongs to an arena, which frees it on reset.
+/// @param tree The tree.
+/// @param node The node.
+static inline void __ndtree_free_node(ndtree_t *tree, ndtree_node_t *node)
+{
+    if (!tree->arena) {
+        tree->free_node(node);
+    }
+}
+
 // ============================================================================
 // Init functions.
 
@@ -28,6 +48,26 @@ void ndtree_tree_init(
     tree->compare_node = compare_node;
     tree->alloc_node   = alloc_node;
     tree->free_node    = free_node;
+    tree->arena        = NULL;
+
+    // Initialize the orphan list head.
+    list_head_init(&tree->orphans);
+}
+
+void ndtree_tree_init_arena(ndtree_t *tree, ndtree_tree_compare_f compare_node, struct arena *arena)
+{
+    // Validate that the tree, the function pointer, and the arena are not NULL.
+    assert(tree && "ndtree_tree_init_arena: Variable tree is NULL.");
+    assert(compare_node && "ndtree_tree_init_arena: Function pointer compare_node is NULL.");
+    assert(arena && "ndtree_tree_init_arena: Variable arena is NULL.");
+
+    // Initialize tree properties to default values.
+    tree->size         = 0;
+    tree->root         = NULL;
+    tree->compare_node = compare_node;
+    tree->alloc_node   = NULL;
+    tree->free_node    = NULL;
+    tree->arena        = arena;
 
     // Initialize the orphan list head.
     list_head_init(&tree->orphans);
@@ -58,7 +98,7 @@ ndtree_node_t *ndtree_create_root(ndtree_t *tree, void *value)
     assert(value && "ndtree_create_root: Variable value is NULL.");
 
     // Allocate a new node for the root using the custom allocator.
-    ndtree_node_t *node = tree->alloc_node(value);
+    ndtree_node_t *node = __ndtree_alloc_node(tree, value);
     if (node) {
         // Initialize the node with the provided value.
         ndtree_node_init(node, value);
@@ -97,7 +137,7 @@ ndtree_node_t *ndtree_create_child_of_node(ndtree_t *tree, ndtree_node_t *parent
     assert(value && "ndtree_create_child_of_node: Variable value is NULL.");
 
     // Allocate a new node for the child using the custom allocator.
-    ndtree_node_t *child = tree->alloc_node(value);
+    ndtree_node_t *child = __ndtree_alloc_node(tree, value);
     if (child) {
         // Initialize the child node with the provided value.
         ndtree_node_init(child, value);
@@ -145,7 +185,7 @@ static void __ndtree_tree_dealloc_rec(ndtree_t *tree, ndtree_node_t *node, ndtre
     }
 
     // Deallocate the current node using the custom free function.
-    tree->free_node(node);
+    __ndtree_free_node(tree, node);
 }
 
 void ndtree_tree_dealloc(ndtree_t *tree, ndtree_tree_node_f node_cb)
@@ -242,7 +282,7 @@ int ndtree_tree_remove_node(ndtree_t *tree, ndtree_node_t *node, ndtree_tree_nod
     }
 
     // Free the node using the custom deallocator.
-    tree->free_node(node);
+    __ndtree_free_node(tree, node);
 
     // Decrement the tree size to reflect the removal.
     --tree->size;
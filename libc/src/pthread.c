@@ -0,0 +1,298 @@
+/// @file pthread.c
+/// @brief POSIX threads.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "pthread.h"
+#include "errno.h"
+#include "sched.h"
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sys/futex.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+/// The size of the stack of a thread, unless the attributes say otherwise.
+#define PTHREAD_STACK_DEFAULT (256 * 1024)
+
+/// @brief The descriptor of a thread, at the start of its thread-local storage.
+struct pthread {
+    /// Points at the descriptor itself, pthread_self() reads it through `%gs:0`.
+    struct pthread *self;
+    /// The id of the thread, cleared by the kernel once the thread exits.
+    volatile pid_t tid;
+    /// The function run by the thread.
+    void *(*start_routine)(void *);
+    /// The argument of the function.
+    void *arg;
+    /// The value the thread exited with.
+    void *retval;
+    /// The stack of the thread.
+    void *stack;
+};
+
+/// The descriptor of the first thread of the process.
+static struct pthread main_thread;
+/// The entry of the GDT holding the thread-local storage, -1 until the first
+/// thread is created.
+static int tls_entry = -1;
+
+/// @brief Describes the thread-local storage of a thread, a data segment
+///        spanning the whole memory, which starts at its descriptor.
+/// @param desc the segment.
+/// @param thread the thread.
+static inline void __pthread_tls_desc(struct user_desc *desc, struct pthread *thread)
+{
+    memset(desc, 0, sizeof(struct user_desc));
+    desc->entry_number   = (unsigned int)tls_entry;
+    desc->base_addr      = (unsigned int)(uintptr_t)thread;
+    desc->limit          = 0xFFFFF;
+    desc->seg_32bit      = 1;
+    desc->limit_in_pages = 1;
+    desc->useable        = 1;
+}
+
+/// @brief Gives the first thread its thread-local storage, the first time a
+///        thread is created.
+/// @return 0 on success, an error number on failure.
+static int __pthread_init(void)
+{
+    if (tls_entry >= 0) {
+        return 0;
+    }
+    main_thread.self = &main_thread;
+    main_thread.tid  = gettid();
+    struct user_desc desc;
+    __pthread_tls_desc(&desc, &main_thread);
+    if (set_thread_area(&desc) < 0) {
+        return errno;
+    }
+    tls_entry = (int)desc.entry_number;
+    // Select the segment, with the privilege of user mode, the new threads
+    // inherit the selector.
+    unsigned int selector = ((unsigned int)tls_entry << 3) | 3U;
+    __asm__ __volatile__("movw %w0, %%gs" : : "r"(selector) : "memory");
+    return 0;
+}
+
+/// @brief The function run by the new threads.
+/// @param arg the descriptor of the thread.
+/// @return the exit status of the thread, always 0.
+static int __pthread_start(void *arg)
+{
+    struct pthread *thread = (struct pthread *)arg;
+    thread->retval         = thread->start_routine(thread->arg);
+    return 0;
+}
+
+int pthread_attr_init(pthread_attr_t *attr)
+{
+    attr->stack_size = PTHREAD_STACK_DEFAULT;
+    return 0;
+}
+
+int pthread_attr_destroy(pthread_attr_t *attr)
+{
+    (void)attr;
+    return 0;
+}
+
+int pthread_attr_setstacksize(pthread_attr_t *attr, size_t stacksize)
+{
+    if (stacksize < PTHREAD_STACK_MIN) {
+        return EINVAL;
+    }
+    attr->stack_size = stacksize;
+    return 0;
+}
+
+int pthread_attr_getstacksize(const pthread_attr_t *attr, size_t *stacksize)
+{
+    *stacksize = attr->stack_size;
+    return 0;
+}
+
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg)
+{
+    int ret = __pthread_init();
+    if (ret) {
+        return ret;
+    }
+    size_t stack_size  = attr ? attr->stack_size : PTHREAD_STACK_DEFAULT;
+    struct pthread *td = malloc(sizeof(struct pthread));
+    void *stack        = malloc(stack_size);
+    if (!td || !stack) {
+        free(td);
+        free(stack);
+        return EAGAIN;
+    }
+    memset(td, 0, sizeof(struct pthread));
+    td->self          = td;
+    td->start_routine = start_routine;
+    td->arg           = arg;
+    td->stack         = stack;
+    // The kernel stores the id of the thread before it runs, and clears it
+    // once the thread exits, waking up the thread joining it.
+    struct user_desc desc;
+    __pthread_tls_desc(&desc, td);
+    int flags = CLONE_VM | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SETTLS | CLONE_PARENT_SETTID |
+                CLONE_CHILD_CLEARTID;
+    if (clone(__pthread_start, (char *)stack + stack_size, flags, td, &td->tid, &desc, &td->tid) < 0) {
+        ret = errno;
+        free(td);
+        free(stack);
+        return ret;
+    }
+    *thread = td;
+    return 0;
+}
+
+int pthread_join(pthread_t thread, void **retval)
+{
+    if (thread == pthread_self()) {
+        return EDEADLK;
+    }
+    // The first thread is never cleared, it cannot be joined.
+    if (thread == &main_thread) {
+        return EINVAL;
+    }
+    pid_t tid;
+    while ((tid = thread->tid) != 0) {
+        futex((int *)&thread->tid, FUTEX_WAIT, tid, NULL);
+    }
+    if (retval) {
+        *retval = thread->retval;
+    }
+    free(thread->stack);
+    free(thread);
+    return 0;
+}
+
+void pthread_exit(void *retval)
+{
+    pthread_self()->retval = retval;
+    // Only the calling thread terminates.
+    long __res;
+    __inline_syscall_1(__res, exit, 0);
+    // The thread never returns from this system call!
+}
+
+pthread_t pthread_self(void)
+{
+    // Before the first thread is created, there is only the first one.
+    if (tls_entry < 0) {
+        main_thread.self = &main_thread;
+        return &main_thread;
+    }
+    pthread_t self;
+    __asm__ __volatile__("movl %%gs:0, %0" : "=r"(self));
+    return self;
+}
+
+int pthread_equal(pthread_t t1, pthread_t t2) { return t1 == t2; }
+
+/// @brief Returns the id of the calling thread, the one its
+///        priority-inheritance mutexes hold while it owns them.
+/// @return the id of the thread.
+static inline pid_t __pthread_tid(void)
+{
+    pthread_t self = pthread_self();
+    // The id of the first thread is known only once it is asked for.
+    if (!self->tid) {
+        self->tid = gettid();
+    }
+    return self->tid;
+}
+
+int pthread_mutexattr_init(pthread_mutexattr_t *attr)
+{
+    attr->type     = 0;
+    attr->protocol = PTHREAD_PRIO_NONE;
+    return 0;
+}
+
+int pthread_mutexattr_destroy(pthread_mutexattr_t *attr)
+{
+    (void)attr;
+    return 0;
+}
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol)
+{
+    if ((protocol != PTHREAD_PRIO_NONE) && (protocol != PTHREAD_PRIO_INHERIT)) {
+        return EINVAL;
+    }
+    attr->protocol = protocol;
+    return 0;
+}
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol)
+{
+    *protocol = attr->protocol;
+    return 0;
+}
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
+{
+    mutex->state    = 0;
+    mutex->protocol = attr ? attr->protocol : PTHREAD_PRIO_NONE;
+    return 0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t *mutex) { return mutex->state ? EBUSY : 0; }
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+        // Without contention, the mutex takes our id without entering the
+        // kernel, otherwise the kernel hands it over to us.
+        if (__sync_val_compare_and_swap(&mutex->state, 0, __pthread_tid()) == 0) {
+            return 0;
+        }
+        while (futex(&mutex->state, FUTEX_LOCK_PI_PRIVATE, 0, NULL) < 0) {
+            if (errno != EINTR) {
+                return errno;
+            }
+        }
+        return 0;
+    }
+    // Without contention, the lock is taken without entering the kernel.
+    int state = __sync_val_compare_and_swap(&mutex->state, 0, 1);
+    if (state != 0) {
+        // Tell the owner that somebody waits, then sleep until it is unlocked.
+        if (state != 2) {
+            state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+        }
+        while (state != 0) {
+            futex(&mutex->state, FUTEX_WAIT_PRIVATE, 2, NULL);
+            state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+        }
+    }
+    return 0;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex)
+{
+    int state = (mutex->protocol == PTHREAD_PRIO_INHERIT) ? __pthread_tid() : 1;
+    return (__sync_val_compare_and_swap(&mutex->state, 0, state) == 0) ? 0 : EBUSY;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+        // The kernel hands the mutex over to the waiter coming first.
+        pid_t tid = __pthread_tid();
+        if ((__sync_val_compare_and_swap(&mutex->state, tid, 0) != tid) &&
+            (futex(&mutex->state, FUTEX_UNLOCK_PI_PRIVATE, 0, NULL) < 0)) {
+            return errno;
+        }
+        return 0;
+    }
+    // Enter the kernel only if somebody might be waiting.
+    if (__atomic_fetch_sub(&mutex->state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&mutex->state, 0, __ATOMIC_RELEASE);
+        futex(&mutex->state, FUTEX_WAKE_PRIVATE, 1, NULL);
+    }
+    return 0;
+}
@@ -5,9 +5,8 @@
 
 #include "pwd.h"
 #include "assert.h"
+#include "dbcache.h"
 #include "errno.h"
-#include "fcntl.h"
-#include "readline.h"
 #include "stdio.h"
 #include "string.h"
 #include "unistd.h"
@@ -58,53 +57,25 @@ static inline void __parse_line(passwd_t *pwd, char *buf)
     }
 }
 
-/// @brief Searches for the given entry inside the buffer.
-/// @param fd the file descriptor of the file.
-/// @param buffer the support buffer we use to read the file.
-/// @param buflen the length of the support buffer.
-/// @param name the username we are looking for.
-/// @param uid the user-id of the user we are looking for.
-/// @return the buffer itself if we have found the entry, NULL otherwise.
-static inline char *__search_entry(int fd, char *buffer, int buflen, const char *name, uid_t uid)
+/// The cache of `/etc/passwd`, indexed by name and by uid.
+static dbcache_t passwd_db = DBCACHE_INIT("/etc/passwd", 2);
+
+/// @brief Fills pwd with the entry, copied inside the buffer.
+/// @param line the line of the entry, NULL if it was not found.
+/// @param pwd the structure we need to fill.
+/// @param buf the buffer where the entry is copied.
+/// @param buflen the length of the buffer.
+/// @param result where pwd is stored on success, NULL on failure.
+/// @return 1 on success, 0 on failure.
+static inline int __fill_entry(const char *line, passwd_t *pwd, char *buf, size_t buflen, passwd_t **result)
 {
-    while (readline(fd, buffer, buflen, NULL) != 0) {
-        if (name != NULL) {
-            char *name_end = strchr(buffer, ':');
-            if (name_end) {
-                *name_end = '\0';
-                if (strlen(name) == strlen(buffer) && strncmp(buffer, name, strlen(name)) == 0) {
-                    *name_end = ':';
-                    return buffer;
-                }
-            }
-        } else {
-            // Name
-            char *ptr = strchr(buffer, ':');
-            if (ptr == NULL) {
-                continue;
-            }
-            // Password
-            ++ptr;
-            char *uid_start = strchr(ptr, ':');
-            if (uid_start == NULL) {
-                continue;
-            }
-            ++uid_start;
-            ptr = strchr(uid_start, ':');
-            if (ptr == NULL) {
-                continue;
-            }
-            *ptr          = '\0';
-            // Parse the uid.
-            int found_uid = atoi(uid_start);
-            // Check the uid.
-            if (found_uid == uid) {
-                *ptr = ':';
-                return buffer;
-            }
-        }
+    *result = NULL;
+    if (!dbcache_copy(line, buf, buflen)) {
+        return 0;
     }
-    return NULL;
+    __parse_line(pwd, buf);
+    *result = pwd;
+    return 1;
 }
 
 passwd_t *getpwnam(const char *name)
@@ -137,48 +108,10 @@ int getpwnam_r(const char *name, passwd_t *pwd, char *buf, size_t buflen, passwd
     if (name == NULL) {
         return 0;
     }
-    int fd = open("/etc/passwd", O_RDONLY, 0);
-    if (fd == -1) {
-        perror("Cannot open `/etc/passwd`\n");
-        errno   = ENOENT;
-        *result = NULL;
-        return 0;
-    }
-    char *entry = __search_entry(fd, buf, buflen, name, 0);
-    if (entry != NULL) {
-        // Close the file.
-        close(fd);
-        // Parse the line.
-        __parse_line(pwd, entry);
-        // Return success.
-        return 1;
-    }
-    errno = ENOENT;
-    // Close the file.
-    close(fd);
-    // Return fail.
-    return 0;
+    return __fill_entry(dbcache_find_name(&passwd_db, name), pwd, buf, buflen, result);
 }
 
 int getpwuid_r(uid_t uid, passwd_t *pwd, char *buf, size_t buflen, passwd_t **result)
 {
-    int fd = open("/etc/passwd", O_RDONLY, 0);
-    if (fd == -1) {
-        errno   = ENOENT;
-        *result = NULL;
-        return 0;
-    }
-    char *entry = __search_entry(fd, buf, buflen, NULL, uid);
-    if (entry != NULL) {
-        // Close the file.
-        close(fd);
-        // Parse the line.
-        __parse_line(pwd, entry);
-        // Return success.
-        return 1;
-    }
-    // Close the file.
-    close(fd);
-    // Return fail.
-    return 0;
+    return __fill_entry(dbcache_find_id(&passwd_db, uid), pwd, buf, buflen, result);
 }
@@ -1,14 +1,81 @@
 /// @file readline.c
 /// @brief Implementation of a function that reads a line from a file descriptor.
+/// @details
+/// The bytes read past the end of a line are kept, inside a buffer of the
+/// file descriptor, and returned by the next call: a file is read one buffer
+/// at a time, and pipes can be read too, since the offset is never moved
+/// back. The buffer of a file descriptor is dropped when it is closed.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #include "readline.h"
 
+#include "math.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
 #include "unistd.h"
 
+/// The number of file descriptors which can be read at once, the others are
+/// read without buffer.
+#define READLINE_MAX_FDS 8
+
+/// @brief The bytes read ahead from a file descriptor.
+typedef struct readline_buffer {
+    int fd;       ///< The file descriptor.
+    char *data;   ///< The buffer, of BUFSIZ bytes, NULL if the slot is free.
+    size_t start; ///< The next byte to be returned.
+    size_t end;   ///< The end of the bytes read.
+} readline_buffer_t;
+
+/// The buffers of the file descriptors.
+static readline_buffer_t buffers[READLINE_MAX_FDS];
+
+/// @brief Finds the buffer of the file descriptor, or sets up a free one.
+/// @param fd the file descriptor.
+/// @return the buffer, NULL if there is none left.
+static inline readline_buffer_t *__readline_buffer(int fd)
+{
+    readline_buffer_t *free_slot = NULL;
+    for (int i = 0; i < READLINE_MAX_FDS; ++i) {
+        if (buffers[i].data && (buffers[i].fd == fd)) {
+            return &buffers[i];
+        }
+        if (!buffers[i].data && !free_slot) {
+            free_slot = &buffers[i];
+        }
+    }
+    if (free_slot && (free_slot->data = malloc(BUFSIZ))) {
+        free_slot->fd    = fd;
+        free_slot->start = free_slot->end = 0;
+        return free_slot;
+    }
+    return NULL;
+}
+
+/// @brief Reads the next byte, through the buffer if there is one.
+/// @param fd the file descriptor.
+/// @param rb the buffer of the file descriptor, or NULL.
+/// @return the byte, EOF at the end of the file, -2 if read() fails.
+static inline int __readline_getc(int fd, readline_buffer_t *rb)
+{
+    unsigned char c;
+    ssize_t count;
+    if (!rb) {
+        count = read(fd, &c, 1U);
+        return (count > 0) ? c : (count == 0) ? EOF : -2;
+    }
+    if (rb->start >= rb->end) {
+        count = read(fd, rb->data, BUFSIZ);
+        if (count <= 0) {
+            return (count == 0) ? EOF : -2;
+        }
+        rb->start = 0;
+        rb->end   = count;
+    }
+    return (unsigned char)rb->data[rb->start++];
+}
+
 int readline(int fd, char *buffer, size_t buflen, ssize_t *read_len)
 {
     // Error check: Ensure the buffer is not NULL and has sufficient length.
@@ -17,69 +84,67 @@ int readline(int fd, char *buffer, size_t buflen, ssize_t *read_len)
         return 0; // Invalid input, cannot proceed.
     }
 
-    ssize_t length;
-    ssize_t rollback;
-    ssize_t num_read;
-    unsigned char found_newline = 1;
+    readline_buffer_t *rb = __readline_buffer(fd);
+    size_t length         = 0;
+    int c                 = EOF;
 
-    // Initialize the buffer to ensure it starts empty.
-    memset(buffer, 0, buflen);
+    // Copy up to the newline, or as much as the buffer can hold; with a
+    // buffer, the line is searched as a whole.
+    while (length < (buflen - 1)) {
+        if (rb && (rb->start < rb->end)) {
+            const char *from = rb->data + rb->start;
+            size_t chunk     = min(rb->end - rb->start, buflen - 1 - length);
+            const char *eol  = memchr(from, '\n', chunk);
+            if (eol) {
+                chunk = eol - from;
+            }
+            memcpy(buffer + length, from, chunk);
+            rb->start += chunk + (eol ? 1 : 0);
+            length += chunk;
+            if (eol) {
+                c = '\n';
+                break;
+            }
+            continue;
+        }
+        if ((c = __readline_getc(fd, rb)) < 0) {
+            break;
+        }
+        if (c == '\n') {
+            break;
+        }
+        buffer[length++] = (char)c;
+    }
 
-    // Read from the file descriptor into the buffer.
-    num_read = read(fd, buffer, buflen);
+    // Close the string by adding a null terminator.
+    buffer[length] = '\0';
 
     // Error check: If read() fails, return -1 to indicate an error.
-    if (num_read < 0) {
+    if (c == -2) {
         perror("Failed to read from file descriptor.\n");
         return -1;
     }
 
     // If nothing was read, return 0 to indicate the end of the file.
-    if (num_read == 0) {
+    if ((c == EOF) && (length == 0)) {
         return 0;
     }
 
-    // Search for newline or termination character.
-    char *newline = strchr(buffer, '\n');
-    if (newline == NULL) {
-        found_newline = 0;
-        // Search for EOF.
-        newline       = strchr(buffer, EOF);
-        if (newline == NULL) {
-            // Search for null terminator.
-            newline = strchr(buffer, '\0');
-            if (newline == NULL) {
-                // No termination character found.
-                return 0;
-            }
-        }
-    }
-
-    // Compute the length of the string up to the newline or termination
-    // character.
-    length = (newline - buffer);
-    if (length <= 0) {
-        return 0;
-    }
-
-    // Close the string by adding a null terminator.
-    buffer[length] = '\0';
-
-    // Compute how much we need to rollback the file position after reading.
-    rollback = length - num_read + 1;
-    if (rollback > 1) {
-        return 0; // Rollback value seems invalid.
-    }
-
-    // Adjust the file's read position using lseek to undo the extra read
-    // characters.
-    lseek(fd, rollback, SEEK_CUR);
-
     // Set the number of bytes read if the caller provided a pointer.
     if (read_len) {
         *read_len = length;
     }
 
     // Return 1 if a newline was found, -1 otherwise (partial data read).
-    return (found_newline) ? 1 : -1;
+    return (c == '\n') ? 1 : -1;
+}
+
+void readline_release(int fd)
+{
+    for (int i = 0; i < READLINE_MAX_FDS; ++i) {
+        if (buffers[i].data && (buffers[i].fd == fd)) {
+            free(buffers[i].data);
+            buffers[i].data = NULL;
+        }
+    }
 }
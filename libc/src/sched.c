@@ -5,6 +5,8 @@
 
 #include "sched.h"
 #include "errno.h"
+#include "stdarg.h"
+#include "stdint.h"
 #include "system/syscall_types.h"
 
 // _syscall2(int, sched_setparam, pid_t, pid, const sched_param_t *, param)
@@ -23,6 +25,30 @@ int sched_getparam(pid_t pid, sched_param_t *param)
     __syscall_return(int, __res);
 }
 
+// _syscall3(int, sched_setscheduler, pid_t, pid, int, policy, const sched_param_t *, param)
+int sched_setscheduler(pid_t pid, int policy, const sched_param_t *param)
+{
+    long __res;
+    __inline_syscall_3(__res, sched_setscheduler, pid, policy, param);
+    __syscall_return(int, __res);
+}
+
+// _syscall1(int, sched_getscheduler, pid_t, pid)
+int sched_getscheduler(pid_t pid)
+{
+    long __res;
+    __inline_syscall_1(__res, sched_getscheduler, pid);
+    __syscall_return(int, __res);
+}
+
+// _syscall0(int, sched_yield)
+int sched_yield(void)
+{
+    long __res;
+    __inline_syscall_0(__res, sched_yield);
+    __syscall_return(int, __res);
+}
+
 // _syscall0(int, waitperiod)
 int waitperiod(void)
 {
@@ -30,3 +56,52 @@ int waitperiod(void)
     __inline_syscall_0(__res, waitperiod);
     __syscall_return(int, __res);
 }
+
+int clone(int (*fn)(void *), void *stack, int flags, void *arg, ...)
+{
+    // The child cannot return from here, it has nothing on its stack.
+    if (!fn || !stack) {
+        errno = EINVAL;
+        return -1;
+    }
+    // The optional arguments come in order (ptid, tls, ctid), each one is
+    // passed when the next one is needed.
+    void *optional[3] = { NULL, NULL, NULL };
+    if (flags & (CLONE_PARENT_SETTID | CLONE_SETTLS | CLONE_CHILD_SETTID | CLONE_CHILD_CLEARTID)) {
+        va_list ap;
+        va_start(ap, arg);
+        // The compiler only sees `arg`, hide where the pointer comes from, or
+        // it would warn about reading past it.
+        __asm__("" : "+r"(ap));
+        for (int i = 0; i < 3; ++i) {
+            optional[i] = va_arg(ap, void *);
+        }
+        va_end(ap);
+    }
+    pid_t *ptid           = (pid_t *)optional[0];
+    struct user_desc *tls = (struct user_desc *)optional[1];
+    pid_t *ctid           = (pid_t *)optional[2];
+    // Place the function, and its argument, on the stack of the child.
+    uintptr_t *sp = (uintptr_t *)((uintptr_t)stack & ~(uintptr_t)15U);
+    *(--sp)       = (uintptr_t)arg;
+    *(--sp)       = (uintptr_t)fn;
+    // The child starts right after the system call, on its own stack: it
+    // calls the function, and exits with its return value.
+    long __res;
+    __asm__ __volatile__("push %%ebx; movl %2,%%ebx; int $0x80; testl %%eax,%%eax; jnz 1f;"
+                         "xorl %%ebp,%%ebp; popl %%eax; call *%%eax;"
+                         "movl %%eax,%%ebx; movl %3,%%eax; int $0x80;"
+                         "1: pop %%ebx"
+                         : "=a"(__res)
+                         : "0"(__NR_clone), "ri"(flags), "i"(__NR_exit), "c"(sp), "d"(ptid), "S"(tls), "D"(ctid)
+                         : "memory");
+    __syscall_return(int, __res);
+}
+
+// _syscall1(int, set_thread_area, struct user_desc *, u_info)
+int set_thread_area(struct user_desc *u_info)
+{
+    long __res;
+    __inline_syscall_1(__res, set_thread_area, u_info);
+    __syscall_return(int, __res);
+}
@@ -15,19 +15,109 @@ static char **__environ      = NULL;
 /// @brief Size of the global environ list.
 static size_t __environ_size = 0;
 
+/// @brief Hashed index over the environ, each bucket holds an entry number plus one, 0 if empty.
+static size_t *__index        = NULL;
+/// @brief Number of buckets of the index, a power of two.
+static size_t __index_buckets = 0;
+/// @brief Number of entries in the index.
+static size_t __index_count   = 0;
+/// @brief The environ which the index was built for. Whenever `environ` is
+/// assigned (e.g., by the startup code after an execve), it differs, and the
+/// index is built again on the next lookup.
+static char **__index_environ = NULL;
+
+/// @brief Hashes the name of a variable.
+/// @param name the name.
+/// @param name_len the length of the name.
+/// @return the hash.
+static inline size_t __hash_name(const char *name, size_t name_len)
+{
+    size_t hash = 5381;
+    for (size_t i = 0; i < name_len; ++i) {
+        hash = ((hash << 5) + hash) + (unsigned char)name[i];
+    }
+    return hash;
+}
+
+/// @brief Checks if the entry is the variable with the given name.
+/// @param entry the entry of the environ, in the form `name=value`.
+/// @param name the name.
+/// @param name_len the length of the name.
+/// @return 1 if it is, 0 otherwise.
+static inline int __same_name(const char *entry, const char *name, size_t name_len)
+{
+    return !strncmp(entry, name, name_len) && (entry[name_len] == '=');
+}
+
+/// @brief Adds an entry of the environ to the index, unless a previous entry has the same name.
+/// @param index the number of the entry.
+static void __index_add(size_t index)
+{
+    const char *entry = environ[index];
+    const char *equal = strchr(entry, '=');
+    if (!equal) {
+        return;
+    }
+    size_t name_len = equal - entry, mask = __index_buckets - 1, i;
+    for (i = __hash_name(entry, name_len) & mask; __index[i]; i = (i + 1) & mask) {
+        if (__same_name(environ[__index[i] - 1], entry, name_len)) {
+            return;
+        }
+    }
+    __index[i] = index + 1;
+    __index_count++;
+}
+
+/// @brief Builds the index over the current environ.
+/// @return 0 on success, -1 on failure.
+static int __index_build(void)
+{
+    size_t count = 0, buckets = 16;
+    for (char **ptr = environ; *ptr; ++ptr) {
+        ++count;
+    }
+    // Keep the index at most half full, leaving room for the variables which are added.
+    while (buckets < (count * 2 + 2)) {
+        buckets <<= 1;
+    }
+    free(__index);
+    __index_environ = NULL;
+    __index_count   = 0;
+    if (!(__index = calloc(buckets, sizeof(size_t)))) {
+        return -1;
+    }
+    __index_buckets = buckets;
+    for (size_t index = 0; index < count; ++index) {
+        __index_add(index);
+    }
+    __index_environ = environ;
+    return 0;
+}
+
 /// @brief Finds the entry in the environ.
 /// @param name the name of the entry we are looking for.
 /// @param name_len the length of the name we received.
 /// @return the index of the entry, or -1 if we did not find it.
 static inline int __find_entry(const char *name, const size_t name_len)
 {
-    if (environ) {
+    if (!environ) {
+        return -1;
+    }
+    if ((__index_environ != environ) && (__index_build() < 0)) {
+        // Without memory for the index, compare all the entries.
         int index = 0;
         for (char **ptr = environ; *ptr; ++ptr, ++index) {
-            if (!strncmp((*ptr), name, name_len) && (*ptr)[name_len] == '=') {
+            if (__same_name(*ptr, name, name_len)) {
                 return index;
             }
         }
+        return -1;
+    }
+    size_t mask = __index_buckets - 1;
+    for (size_t i = __hash_name(name, name_len) & mask; __index[i]; i = (i + 1) & mask) {
+        if (__same_name(environ[__index[i] - 1], name, name_len)) {
+            return (int)(__index[i] - 1);
+        }
     }
     return -1;
 }
@@ -51,7 +141,10 @@ static void __clone_environ(void)
         __environ[__environ_size]     = (char *)NULL;
         __environ[__environ_size + 1] = (char *)NULL;
         __environ_size += 2;
-        // Set the new environ.
+        // Set the new environ, whose entries are in the same places.
+        if (__index_environ == environ) {
+            __index_environ = __environ;
+        }
         environ = __environ;
     }
 }
@@ -77,7 +170,7 @@ int setenv(const char *name, const char *value, int overwrite)
         return -1;
     }
     // Find the entry.
-    int index = __find_entry(name, name_len);
+    int index = __find_entry(name, name_len), added = 0;
     if (index >= 0) {
         if (!overwrite) {
             //UNLOCK;
@@ -98,8 +191,12 @@ int setenv(const char *name, const char *value, int overwrite)
         // Close the environment.
         new_environ[__environ_size - 2] = NULL;
         new_environ[__environ_size - 1] = NULL;
-        // Update all the variables.
+        // Update all the variables, the index does not change since the entries are in the same places.
+        if (__index_environ == environ) {
+            __index_environ = new_environ;
+        }
         environ = __environ = new_environ;
+        added   = 1;
     }
     // Free the previous entry.
     if (environ[index]) {
@@ -113,6 +210,14 @@ int setenv(const char *name, const char *value, int overwrite)
     environ[index][name_len] = '=';
     // Add the value.
     memcpy(&environ[index][name_len + 1], value, value_len);
+    // Index the new variable, building the index again once it is half full.
+    if (added && (__index_environ == environ)) {
+        if (((__index_count + 1) * 2) > __index_buckets) {
+            __index_build();
+        } else {
+            __index_add(index);
+        }
+    }
     //UNLOCK;
     return 0;
 }
@@ -128,20 +233,28 @@ int unsetenv(const char *name)
         environ = __environ;
     }
     size_t len = strlen(name);
+    if (__find_entry(name, len) < 0) {
+        return 0;
+    }
     //LOCK;
     char **ep  = environ;
     while (*ep != NULL) {
         if (!strncmp(*ep, name, len) && (*ep)[len] == '=') {
             /* Found it.  Remove this pointer by moving later ones back.  */
+            free(*ep);
             char **dp = ep;
             do {
                 dp[0] = dp[1];
             } while (*dp++);
+            // Keep the place where setenv() appends right after the last entry.
+            --__environ_size;
             /* Continue the loop in case NAME appears again.  */
         } else {
             ++ep;
         }
     }
+    // The entries which follow moved back, the index is built again on the next lookup.
+    __index_environ = NULL;
     //UNLOCK;
     return 0;
 }
@@ -5,6 +5,7 @@
 
 #include "shadow.h"
 #include "ctype.h"
+#include "dbcache.h"
 #include "errno.h"
 #include "fcntl.h"
 #include "limits.h"
@@ -14,17 +15,20 @@
 #include "sys/stat.h"
 #include "unistd.h"
 
+/// The cache of the shadow password file, indexed by name.
+static dbcache_t shadow_db = DBCACHE_INIT(SHADOW, -1);
+
 /// @brief Converts a string to a long integer.
 ///
 /// @details Parses a string into a long integer and advances the string pointer.
-/// If the string starts with a colon or newline, returns -1.
+/// If the string starts with a colon, a newline, or ends, returns -1.
 ///
 /// @param s Pointer to the string to convert.
 /// @return The parsed long integer.
 static long xatol(char **s)
 {
     long x;
-    if (**s == ':' || **s == '\n') {
+    if (**s == ':' || **s == '\n' || **s == '\0') {
         return -1;
     }
     for (x = 0; **s - '0' < 10U; ++*s) {
@@ -93,7 +97,7 @@ int __parsespent(char *s, struct spwd *sp)
 
     s++;
     sp->sp_flag = xatol(&s);
-    if (*s != '\n') {
+    if (*s != '\n' && *s != '\0') {
         return -1;
     }
     return 0;
@@ -102,8 +106,8 @@ int __parsespent(char *s, struct spwd *sp)
 struct spwd *getspnam(const char *name)
 {
     static struct spwd spwd_buf;
+    static char buffer[BUFSIZ];
     struct spwd *result;
-    char buffer[BUFSIZ];
     int e;
     int orig_errno = errno;
 
@@ -118,11 +122,8 @@ struct spwd *getspnam(const char *name)
 
 int getspnam_r(const char *name, struct spwd *spwd_buf, char *buf, size_t buflen, struct spwd **result)
 {
-    int rv = 0;                    // Return value to track errors (e.g., ERANGE).
-    int fd;                        // File descriptor for the shadow file.
-    size_t k;                      // Length of the current line read from the file.
+    int rv         = 0;            // Return value to track errors (e.g., ERANGE).
     size_t l       = strlen(name); // Length of the username to search for.
-    int skip       = 0;            // Flag to indicate whether the current line should be skipped.
     int orig_errno = errno;        // Preserve the original errno value for later restoration.
 
     if (!spwd_buf) {
@@ -149,42 +150,16 @@ int getspnam_r(const char *name, struct spwd *spwd_buf, char *buf, size_t buflen
         return errno = ERANGE;
     }
 
-    // Open the shadow file for reading.
-    fd = open(SHADOW, O_RDONLY, 0);
-    if (fd < 0) {
-        return errno;
-    }
-
-    // Read lines from the shadow file.
-    while (fgets(buf, buflen, fd) && (k = strlen(buf)) > 0) {
-        // If skipping the line (due to being too long), or if the line does not match the user name:
-        if (skip || strncmp(name, buf, l) != 0 || buf[l] != ':') {
-            // Set skip if the line does not end with a newline.
-            skip = buf[k - 1] != '\n';
-            continue;
-        }
-
-        // If the line does not end with a newline, the buffer is too small.
-        if (buf[k - 1] != '\n') {
-            // Buffer overflow risk; set return value to ERANGE.
-            rv = ERANGE;
-            break;
-        }
-
-        // Parse the shadow entry from the line.
-        // If parsing fails, continue to the next line.
-        if (__parsespent(buf, spwd_buf) < 0) {
-            continue;
+    // Copy the entry from the cache, and parse it.
+    if (dbcache_copy(dbcache_find_name(&shadow_db, name), buf, buflen)) {
+        if (__parsespent(buf, spwd_buf) == 0) {
+            *result = spwd_buf;
         }
-
-        // Set the result to the parsed shadow entry.
-        *result = spwd_buf;
-        // Exit the loop after finding the match.
-        break;
+    } else if (errno == ERANGE) {
+        // The buffer is not large enough to hold the entry.
+        rv = ERANGE;
     }
 
-    // Close the file descriptor.
-    close(fd);
     // Restore errno to its original value unless an error occurred.
     errno = rv ? rv : orig_errno;
     // Return 0 on success or an error code.
@@ -0,0 +1,178 @@
+/// @file spawn.c
+/// @brief Creation of processes running a new program.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "spawn.h"
+#include "errno.h"
+#include "limits.h"
+#include "stdlib.h"
+#include "string.h"
+#include "system/syscall_types.h"
+
+/// @brief Default `PATH`.
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+int posix_spawn(
+    pid_t *pid, const char *path, const posix_spawn_file_actions_t *file_actions, const posix_spawnattr_t *attrp,
+    char *const argv[], char *const envp[])
+{
+    long __res;
+    __inline_syscall_5(__res, posix_spawn, path, file_actions, attrp, argv, envp);
+    // The error is returned, instead of being stored inside errno.
+    if ((unsigned int)__res >= (unsigned int)(-125)) {
+        return -__res;
+    }
+    if (pid) {
+        *pid = __res;
+    }
+    return 0;
+}
+
+int posix_spawnp(
+    pid_t *pid, const char *file, const posix_spawn_file_actions_t *file_actions, const posix_spawnattr_t *attrp,
+    char *const argv[], char *const envp[])
+{
+    if (!file) {
+        return ENOENT;
+    }
+    if (strchr(file, '/')) {
+        return posix_spawn(pid, file, file_actions, attrp, argv, envp);
+    }
+    // Determine the search path.
+    char *PATH_VAR = getenv("PATH");
+    if (PATH_VAR == NULL) {
+        PATH_VAR = DEFAULT_PATH;
+    }
+    char *path = strdup(PATH_VAR);
+    if (!path) {
+        return ENOMEM;
+    }
+    // Try the entries in order, until the program is found.
+    char absolute_path[PATH_MAX];
+    int ret     = ENOENT;
+    char *token = strtok(path, ":");
+    while ((token != NULL) && (ret == ENOENT)) {
+        strcpy(absolute_path, token);
+        strcat(absolute_path, "/");
+        strcat(absolute_path, file);
+        ret   = posix_spawn(pid, absolute_path, file_actions, attrp, argv, envp);
+        token = strtok(NULL, ":");
+    }
+    free(path);
+    return ret;
+}
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *file_actions)
+{
+    file_actions->count    = 0;
+    file_actions->capacity = 0;
+    file_actions->actions  = NULL;
+    return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *file_actions)
+{
+    for (int i = 0; i < file_actions->count; ++i) {
+        if (file_actions->actions[i].path) {
+            free(file_actions->actions[i].path);
+        }
+    }
+    if (file_actions->actions) {
+        free(file_actions->actions);
+    }
+    return posix_spawn_file_actions_init(file_actions);
+}
+
+/// @brief Appends an action to a list of file actions, growing the list if needed.
+/// @param file_actions The list.
+/// @param action       The action.
+/// @return 0 on success, the error number on failure.
+static int __file_actions_add(posix_spawn_file_actions_t *file_actions, const posix_spawn_file_action_t *action)
+{
+    if ((action->fd < 0) || (action->newfd < 0)) {
+        return EBADF;
+    }
+    if (file_actions->count == file_actions->capacity) {
+        int capacity                       = file_actions->capacity ? (file_actions->capacity * 2) : 4;
+        posix_spawn_file_action_t *actions = realloc(file_actions->actions, capacity * sizeof(*actions));
+        if (!actions) {
+            return ENOMEM;
+        }
+        file_actions->actions  = actions;
+        file_actions->capacity = capacity;
+    }
+    file_actions->actions[file_actions->count++] = *action;
+    return 0;
+}
+
+int posix_spawn_file_actions_addopen(
+    posix_spawn_file_actions_t *file_actions, int fd, const char *path, int oflag, mode_t mode)
+{
+    posix_spawn_file_action_t action = {
+        .type  = POSIX_SPAWN_OPEN,
+        .fd    = fd,
+        .newfd = 0,
+        .oflag = oflag,
+        .mode  = mode,
+        .path  = strdup(path),
+    };
+    if (!action.path) {
+        return ENOMEM;
+    }
+    int ret = __file_actions_add(file_actions, &action);
+    if (ret) {
+        free(action.path);
+    }
+    return ret;
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *file_actions, int fd)
+{
+    posix_spawn_file_action_t action = { .type = POSIX_SPAWN_CLOSE, .fd = fd };
+    return __file_actions_add(file_actions, &action);
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *file_actions, int fd, int newfd)
+{
+    posix_spawn_file_action_t action = { .type = POSIX_SPAWN_DUP2, .fd = fd, .newfd = newfd };
+    return __file_actions_add(file_actions, &action);
+}
+
+int posix_spawnattr_init(posix_spawnattr_t *attr)
+{
+    attr->flags  = 0;
+    attr->pgroup = 0;
+    sigemptyset(&attr->sigmask);
+    sigemptyset(&attr->sigdefault);
+    return 0;
+}
+
+int posix_spawnattr_destroy(posix_spawnattr_t *attr) { return 0; }
+
+int posix_spawnattr_setflags(posix_spawnattr_t *attr, short flags)
+{
+    if (flags & ~(POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK)) {
+        return EINVAL;
+    }
+    attr->flags = flags;
+    return 0;
+}
+
+int posix_spawnattr_setpgroup(posix_spawnattr_t *attr, pid_t pgroup)
+{
+    attr->pgroup = pgroup;
+    return 0;
+}
+
+int posix_spawnattr_setsigmask(posix_spawnattr_t *attr, const sigset_t *sigmask)
+{
+    attr->sigmask = *sigmask;
+    return 0;
+}
+
+int posix_spawnattr_setsigdefault(posix_spawnattr_t *attr, const sigset_t *sigdefault)
+{
+    attr->sigdefault = *sigdefault;
+    return 0;
+}
@@ -6,20 +6,364 @@
 #include "stdio.h"
 #include "ctype.h"
 #include "errno.h"
+#include "fcntl.h"
 #include "limits.h"
+#include "math.h"
 #include "stdbool.h"
+#include "stdlib.h"
 #include "strerror.h"
 #include "string.h"
 #include "unistd.h"
 
-void putchar(int character) { write(STDOUT_FILENO, &character, 1U); }
+/// @name Flags of a stream
+/// @{
+#define STREAM_USED    0x01U ///< The stream is open.
+#define STREAM_READ    0x02U ///< The stream can be read.
+#define STREAM_WRITE   0x04U ///< The stream can be written.
+#define STREAM_WRITING 0x08U ///< The buffer holds bytes to be written, rather than bytes read.
+#define STREAM_EOF     0x10U ///< The end of the file was reached.
+#define STREAM_ERROR   0x20U ///< An error happened.
+#define STREAM_MALLOC  0x40U ///< The buffer was allocated by the stream.
+/// @}
 
-void puts(const char *str) { write(STDOUT_FILENO, str, strlen(str)); }
+/// @brief A buffered stream, on top of a file descriptor.
+struct __stdio_file {
+    int fd;         ///< The file descriptor.
+    unsigned flags; ///< The flags of the stream (STREAM_*).
+    int mode;       ///< The buffering mode (_IOFBF, _IOLBF or _IONBF).
+    char *buffer;   ///< The buffer, set up by the first operation.
+    size_t size;    ///< The size of the buffer.
+    size_t start;   ///< While reading, the next byte of the buffer to be returned.
+    size_t end;     ///< The end of the bytes read, or the number of bytes to be written.
+    char single;    ///< The buffer of the unbuffered streams, for reading.
+};
+
+/// The buffer of the standard input.
+static char stdin_buffer[BUFSIZ];
+/// The buffer of the standard output.
+static char stdout_buffer[BUFSIZ];
+
+/// The streams, the first three being stdin, stdout and stderr.
+static FILE streams[FOPEN_MAX] = {
+    {STDIN_FILENO, STREAM_USED | STREAM_READ, _IOLBF, stdin_buffer, BUFSIZ, 0, 0, 0},
+    {STDOUT_FILENO, STREAM_USED | STREAM_WRITE, _IOLBF, stdout_buffer, BUFSIZ, 0, 0, 0},
+    {STDERR_FILENO, STREAM_USED | STREAM_WRITE, _IONBF, NULL, 0, 0, 0, 0},
+};
+
+FILE *stdin  = &streams[0];
+FILE *stdout = &streams[1];
+FILE *stderr = &streams[2];
+
+/// @brief Sets up the buffer of the stream, before its first operation.
+/// @param stream The stream.
+static inline void __stream_setup(FILE *stream)
+{
+    if (stream->buffer) {
+        return;
+    }
+    if (stream->mode != _IONBF) {
+        stream->buffer = malloc(BUFSIZ);
+        stream->size   = BUFSIZ;
+        stream->flags |= STREAM_MALLOC;
+    }
+    // Without memory, the stream is unbuffered.
+    if (!stream->buffer) {
+        stream->mode   = _IONBF;
+        stream->buffer = &stream->single;
+        stream->size   = 1;
+        stream->flags &= ~STREAM_MALLOC;
+    }
+}
+
+/// @brief Writes all the given bytes to the file of the stream.
+/// @param stream The stream.
+/// @param data The bytes.
+/// @param size How many bytes.
+/// @return 0 on success, EOF on failure.
+static int __stream_write_all(FILE *stream, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = write(stream->fd, data, size);
+        if (written <= 0) {
+            stream->flags |= STREAM_ERROR;
+            return EOF;
+        }
+        data += written;
+        size -= written;
+    }
+    return 0;
+}
+
+/// @brief Writes the bytes buffered by the stream, or gives back those read
+/// ahead, so that the file offset is the one seen by the user.
+/// @param stream The stream.
+/// @return 0 on success, EOF on failure.
+static int __stream_flush(FILE *stream)
+{
+    if (stream->flags & STREAM_WRITING) {
+        size_t count = stream->end;
+        stream->end  = 0;
+        stream->flags &= ~STREAM_WRITING;
+        return __stream_write_all(stream, stream->buffer, count);
+    }
+    // The offset of pipes and terminals cannot be moved, what was read is kept.
+    if ((stream->start < stream->end) && (lseek(stream->fd, -(off_t)(stream->end - stream->start), SEEK_CUR) >= 0)) {
+        stream->start = stream->end = 0;
+    }
+    return 0;
+}
+
+/// @brief Writes to the stream, through its buffer.
+/// @param stream The stream.
+/// @param data The bytes.
+/// @param size How many bytes.
+/// @return The number of bytes written.
+static size_t __stream_write(FILE *stream, const char *data, size_t size)
+{
+    if (!(stream->flags & STREAM_WRITE)) {
+        stream->flags |= STREAM_ERROR;
+        errno = EBADF;
+        return 0;
+    }
+    __stream_setup(stream);
+    // Switch from reading to writing.
+    if (!(stream->flags & STREAM_WRITING)) {
+        __stream_flush(stream);
+        stream->start = stream->end = 0;
+    }
+    // What does not fit the buffer is written after what is buffered, and at
+    // once if it would fill the buffer anyway.
+    if ((stream->mode == _IONBF) || (size > (stream->size - stream->end))) {
+        if (__stream_flush(stream) < 0) {
+            return 0;
+        }
+        if ((stream->mode == _IONBF) || (size >= stream->size)) {
+            return (__stream_write_all(stream, data, size) < 0) ? 0 : size;
+        }
+    }
+    memcpy(stream->buffer + stream->end, data, size);
+    stream->end += size;
+    stream->flags |= STREAM_WRITING;
+    if ((stream->mode == _IOLBF) && memchr(data, '\n', size) && (__stream_flush(stream) < 0)) {
+        return 0;
+    }
+    return size;
+}
+
+/// @brief Reads the file of the stream into its buffer, once it is empty.
+/// @param stream The stream.
+/// @return The number of bytes read, 0 on end-of-file, EOF on failure.
+static int __stream_fill(FILE *stream)
+{
+    if (!(stream->flags & STREAM_READ)) {
+        stream->flags |= STREAM_ERROR;
+        errno = EBADF;
+        return EOF;
+    }
+    __stream_setup(stream);
+    if ((stream->flags & STREAM_WRITING) && (__stream_flush(stream) < 0)) {
+        return EOF;
+    }
+    // What is waiting for an answer must be seen first (e.g., a prompt).
+    for (int i = 0; i < FOPEN_MAX; ++i) {
+        if ((streams[i].flags & STREAM_WRITING) && (streams[i].mode == _IOLBF)) {
+            __stream_flush(&streams[i]);
+        }
+    }
+    ssize_t count = read(stream->fd, stream->buffer, stream->size);
+    if (count < 0) {
+        stream->flags |= STREAM_ERROR;
+        return EOF;
+    }
+    if (count == 0) {
+        stream->flags |= STREAM_EOF;
+    }
+    stream->start = 0;
+    stream->end   = count;
+    return count;
+}
+
+/// @brief Parses the mode of fopen().
+/// @param mode The mode.
+/// @param oflags Where the flags of open() are stored.
+/// @return The flags of the stream, 0 if the mode is not valid.
+static unsigned __stream_parse_mode(const char *mode, int *oflags)
+{
+    int plus = (strchr(mode, '+') != NULL);
+    switch (mode[0]) {
+    case 'r':
+        *oflags = plus ? O_RDWR : O_RDONLY;
+        return STREAM_USED | STREAM_READ | (plus ? STREAM_WRITE : 0);
+    case 'w':
+        *oflags = (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+        return STREAM_USED | STREAM_WRITE | (plus ? STREAM_READ : 0);
+    case 'a':
+        *oflags = (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+        return STREAM_USED | STREAM_WRITE | (plus ? STREAM_READ : 0);
+    default:
+        return 0;
+    }
+}
+
+/// @brief Finds a free stream, and associates it with the file descriptor.
+/// @param fd The file descriptor.
+/// @param flags The flags of the stream.
+/// @return The stream, or NULL if all of them are open.
+static FILE *__stream_open(int fd, unsigned flags)
+{
+    for (int i = 0; i < FOPEN_MAX; ++i) {
+        if (!(streams[i].flags & STREAM_USED)) {
+            memset(&streams[i], 0, sizeof(FILE));
+            streams[i].fd    = fd;
+            streams[i].flags = flags;
+            streams[i].mode  = _IOFBF;
+            return &streams[i];
+        }
+    }
+    errno = EMFILE;
+    return NULL;
+}
+
+FILE *fopen(const char *path, const char *mode)
+{
+    int oflags;
+    unsigned flags = __stream_parse_mode(mode, &oflags);
+    if (!flags) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = open(path, oflags, 0666);
+    if (fd < 0) {
+        return NULL;
+    }
+    FILE *stream = __stream_open(fd, flags);
+    if (!stream) {
+        close(fd);
+    }
+    return stream;
+}
+
+FILE *fdopen(int fd, const char *mode)
+{
+    int oflags;
+    unsigned flags = __stream_parse_mode(mode, &oflags);
+    if (!flags) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return __stream_open(fd, flags);
+}
+
+int fclose(FILE *stream)
+{
+    int ret = fflush(stream);
+    if (close(stream->fd) < 0) {
+        ret = EOF;
+    }
+    if (stream->flags & STREAM_MALLOC) {
+        free(stream->buffer);
+    }
+    memset(stream, 0, sizeof(FILE));
+    return ret;
+}
+
+int fflush(FILE *stream)
+{
+    if (stream) {
+        return __stream_flush(stream);
+    }
+    int ret = 0;
+    for (int i = 0; i < FOPEN_MAX; ++i) {
+        if ((streams[i].flags & STREAM_USED) && (__stream_flush(&streams[i]) < 0)) {
+            ret = EOF;
+        }
+    }
+    return ret;
+}
+
+int setvbuf(FILE *stream, char *buf, int mode, size_t size)
+{
+    if ((mode != _IOFBF) && (mode != _IOLBF) && (mode != _IONBF)) {
+        return -1;
+    }
+    if ((__stream_flush(stream) < 0) || (stream->start < stream->end)) {
+        return -1;
+    }
+    if (stream->flags & STREAM_MALLOC) {
+        free(stream->buffer);
+        stream->flags &= ~STREAM_MALLOC;
+    }
+    stream->mode   = mode;
+    stream->buffer = NULL;
+    stream->size   = 0;
+    stream->start = stream->end = 0;
+    // Otherwise, the buffer is set up by the next operation.
+    if (buf && size && (mode != _IONBF)) {
+        stream->buffer = buf;
+        stream->size   = size;
+    }
+    return 0;
+}
+
+void setbuf(FILE *stream, char *buf) { setvbuf(stream, buf, buf ? _IOFBF : _IONBF, BUFSIZ); }
+
+int fileno(FILE *stream) { return stream->fd; }
+
+int feof(FILE *stream) { return (stream->flags & STREAM_EOF) != 0; }
+
+int ferror(FILE *stream) { return (stream->flags & STREAM_ERROR) != 0; }
+
+void clearerr(FILE *stream) { stream->flags &= ~(STREAM_EOF | STREAM_ERROR); }
+
+size_t fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    if ((size == 0) || (nmemb == 0)) {
+        return 0;
+    }
+    return __stream_write(stream, ptr, size * nmemb) / size;
+}
+
+size_t fread(void *ptr, size_t size, size_t nmemb, FILE *stream)
+{
+    char *dst    = (char *)ptr;
+    size_t total = size * nmemb, count = 0;
+    if (total == 0) {
+        return 0;
+    }
+    while (count < total) {
+        if ((stream->start >= stream->end) && (__stream_fill(stream) <= 0)) {
+            break;
+        }
+        size_t chunk = min(stream->end - stream->start, total - count);
+        memcpy(dst + count, stream->buffer + stream->start, chunk);
+        stream->start += chunk;
+        count += chunk;
+    }
+    return count / size;
+}
+
+int fputc(int c, FILE *stream)
+{
+    char character = (char)c;
+    return (__stream_write(stream, &character, 1) == 1) ? (unsigned char)character : EOF;
+}
+
+int fputs(const char *str, FILE *stream)
+{
+    size_t length = strlen(str);
+    return (__stream_write(stream, str, length) == length) ? 0 : EOF;
+}
+
+void putchar(int character) { fputc(character, stdout); }
+
+void puts(const char *str) { fputs(str, stdout); }
 
 int getchar(void)
 {
-    char c = 0;
-    while (read(STDIN_FILENO, &c, 1) == 0) {
+    int c;
+    // The terminal is waited for, even if a read returns nothing.
+    while (((c = fgetc(stdin)) == EOF) && feof(stdin)) {
+        clearerr(stdin);
     }
     return c;
 }
@@ -68,21 +412,40 @@ char *gets(char *str)
     return str;
 }
 
+/// @brief Gives the value of a digit, in any base up to 36.
+/// @param c the character.
+/// @return the value, or 36 if it is not a digit.
+static inline int __digit_value(int c)
+{
+    if ((unsigned)(c - '0') < 10U) {
+        return c - '0';
+    }
+    // Setting the lowercase bit maps the uppercase letters onto the lowercase ones.
+    if ((unsigned)((c | 0x20) - 'a') < 26U) {
+        return (c | 0x20) - 'a' + 10;
+    }
+    return 36;
+}
+
 int atoi(const char *str)
 {
     // Check the input string.
     if (str == NULL) {
         return 0;
     }
-    // Initialize sign, the result variable, and two indices.
-    int sign   = (str[0] == '-') ? -1 : +1;
-    int result = 0;
-    int i;
-    // Find where the number ends.
-    for (i = (sign == -1) ? 1 : 0; (str[i] != '\0') && isdigit(str[i]); ++i) {
-        result = (result * 10) + str[i] - '0';
+    while (isspace(*str)) {
+        ++str;
+    }
+    int negative = (*str == '-');
+    if (negative || (*str == '+')) {
+        ++str;
     }
-    return sign * result;
+    // Accumulate in an unsigned, so that the most negative value does not overflow.
+    unsigned result = 0, digit;
+    while ((digit = (unsigned)(*str++ - '0')) < 10U) {
+        result = (result * 10U) + digit;
+    }
+    return negative ? (int)(0U - result) : (int)result;
 }
 
 long strtol(const char *str, char **endptr, int base)
@@ -144,14 +507,7 @@ long strtol(const char *str, char **endptr, int base)
         cutlim = -cutlim;
     }
     for (acc = 0, any = 0;; c = (unsigned char)*s++) {
-        if (isdigit(c)) {
-            c -= '0';
-        } else if (isalpha(c)) {
-            c -= isupper(c) ? 'A' - 10 : 'a' - 10;
-        } else {
-            break;
-        }
-        if (c >= base) {
+        if ((c = __digit_value(c)) >= base) {
             break;
         }
         if (any < 0) {
@@ -185,56 +541,88 @@ long strtol(const char *str, char **endptr, int base)
     return (acc);
 }
 
-int fgetc(int fd)
+int fgetc(FILE *stream)
 {
-    char c;
-    ssize_t bytes_read;
-
-    // Read a single character from the file descriptor.
-    bytes_read = read(fd, &c, 1);
+    if ((stream->start >= stream->end) && (__stream_fill(stream) <= 0)) {
+        return EOF;
+    }
+    return (unsigned char)stream->buffer[stream->start++];
+}
 
-    // Check for errors or EOF.
-    if (bytes_read == -1) {
-        perror("Error reading from file descriptor");
-        return EOF; // Return EOF on error.
+char *fgets(char *buf, int n, FILE *stream)
+{
+    // Leave space for null terminator.
+    size_t count = 0, room = (n > 0) ? (n - 1) : 0;
+    while (count < room) {
+        if ((stream->start >= stream->end) && (__stream_fill(stream) <= 0)) {
+            break;
+        }
+        // Copy up to the end of the line, or of the buffer.
+        const char *from = stream->buffer + stream->start;
+        size_t chunk     = min(stream->end - stream->start, room - count);
+        const char *eol  = memchr(from, '\n', chunk);
+        if (eol) {
+            chunk = (eol - from) + 1;
+        }
+        memcpy(buf + count, from, chunk);
+        stream->start += chunk;
+        count += chunk;
+        if (eol) {
+            break;
+        }
     }
-    if (bytes_read == 0) {
-        return EOF; // Return EOF if no bytes were read (end of file).
+    if ((count == 0) || ferror(stream)) {
+        return NULL;
     }
-
-    // Return the character as an unsigned char.
-    return (unsigned char)c;
+    buf[count] = '\0';
+    return buf;
 }
 
-char *fgets(char *buf, int n, int fd)
+ssize_t getdelim(char **lineptr, size_t *n, int delim, FILE *stream)
 {
-    char *p   = buf;
-    int count = n - 1; // Leave space for null terminator
-
-    while (count > 0) {
-        char ch;
-        ssize_t bytes_read = read(fd, &ch, 1);
-
-        if (bytes_read < 0) {
-            return NULL; // Read error
+    if (!lineptr || !n) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t count = 0;
+    while (1) {
+        if ((stream->start >= stream->end) && (__stream_fill(stream) <= 0)) {
+            break;
         }
-        if (bytes_read == 0) {
-            break; // EOF
+        // Take up to the delimiter, or the whole buffer.
+        const char *from = stream->buffer + stream->start;
+        size_t chunk     = stream->end - stream->start;
+        const char *eol  = memchr(from, delim, chunk);
+        if (eol) {
+            chunk = (eol - from) + 1;
         }
-
-        *p++ = ch;
-
-        if (ch == '\n') {
-            break; // Line complete
+        // Grow the line, terminator included.
+        if ((count + chunk + 1) > *n) {
+            size_t size = max(*n * 2, count + chunk + 1);
+            char *line  = realloc(*lineptr, size);
+            if (!line) {
+                errno = ENOMEM;
+                return -1;
+            }
+            *lineptr = line;
+            *n       = size;
+        }
+        memcpy(*lineptr + count, from, chunk);
+        stream->start += chunk;
+        count += chunk;
+        if (eol) {
+            break;
         }
-
-        count--;
     }
-
-    *p = '\0';
-    return (p == buf) ? NULL : buf;
+    if ((count == 0) || ferror(stream)) {
+        return -1;
+    }
+    (*lineptr)[count] = '\0';
+    return count;
 }
 
+ssize_t getline(char **lineptr, size_t *n, FILE *stream) { return getdelim(lineptr, n, '\n', stream); }
+
 void perror(const char *s)
 {
     if (s) {
@@ -5,10 +5,186 @@
 
 #include "string.h"
 #include "ctype.h"
+#include "math.h"
+#include "stdint.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "sys/stat.h"
 
+/// A word, which may alias the bytes of a string.
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+/// Ones in the lowest bit of each byte of a word.
+#define ONES  0x01010101U
+/// Ones in the highest bit of each byte of a word.
+#define HIGHS 0x80808080U
+/// Tells if one of the bytes of the word is zero.
+#define HAS_ZERO(word) ((((word) - ONES) & ~(word) & HIGHS) != 0)
+
+/// @brief Copies bytes forward: the bytes up to the first aligned word of the
+/// destination, the aligned words, and the remaining bytes.
+/// @param dst where the bytes are copied.
+/// @param src the bytes to copy.
+/// @param num the number of bytes.
+static inline void __copy_forward(void *dst, const void *src, size_t num)
+{
+    size_t head = (-(uintptr_t)dst) & 3U;
+    if (head > num) {
+        head = num;
+    }
+    size_t words = (num - head) / 4;
+    size_t tail  = (num - head) & 3U;
+    __asm__ __volatile__("rep movsb\n\t"
+                         "mov %[words], %%ecx\n\t"
+                         "rep movsl\n\t"
+                         "mov %[tail], %%ecx\n\t"
+                         "rep movsb"
+                         : "+D"(dst), "+S"(src), "+c"(head)
+                         : [words] "rm"(words), [tail] "rm"(tail)
+                         : "memory");
+}
+
+/// @brief Fills bytes: those up to the first aligned word, the aligned words,
+/// and the remaining bytes.
+/// @param dst the bytes to fill.
+/// @param value the value of each byte.
+/// @param num the number of bytes.
+static inline void __fill(void *dst, unsigned char value, size_t num)
+{
+    size_t head = (-(uintptr_t)dst) & 3U;
+    if (head > num) {
+        head = num;
+    }
+    size_t words = (num - head) / 4;
+    size_t tail  = (num - head) & 3U;
+    __asm__ __volatile__("rep stosb\n\t"
+                         "mov %[words], %%ecx\n\t"
+                         "rep stosl\n\t"
+                         "mov %[tail], %%ecx\n\t"
+                         "rep stosb"
+                         : "+D"(dst), "+c"(head)
+                         : "a"(value * ONES), [words] "rm"(words), [tail] "rm"(tail)
+                         : "memory");
+}
+
+/// The size from which the copies and fills use the SSE2 registers.
+#define SSE2_THRESHOLD 512
+
+/// @brief Tells if the CPU supports SSE2, checking it the first time.
+/// @return 1 if it is supported, 0 otherwise.
+static inline int __has_sse2(void)
+{
+    // Checked once, -1 until then.
+    static int sse2 = -1;
+    if (sse2 < 0) {
+        uint32_t eax = 1, ebx, ecx = 0, edx;
+        __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+        sse2 = (edx >> 26U) & 1U;
+    }
+    return sse2;
+}
+
+/// @brief Copies bytes forward, 64 at a time through the SSE2 registers,
+/// once the destination is aligned to 16 bytes.
+/// @param dst where the bytes are copied.
+/// @param src the bytes to copy.
+/// @param num the number of bytes, at least 64.
+__attribute__((target("sse2"))) static void __copy_forward_sse2(void *dst, const void *src, size_t num)
+{
+    size_t head = (-(uintptr_t)dst) & 15U;
+    __copy_forward(dst, src, head);
+    char *d       = (char *)dst + head;
+    const char *s = (const char *)src + head;
+    size_t blocks = (num - head) / 64;
+    __asm__ __volatile__("1:\n\t"
+                         "movdqu (%[s]), %%xmm0\n\t"
+                         "movdqu 16(%[s]), %%xmm1\n\t"
+                         "movdqu 32(%[s]), %%xmm2\n\t"
+                         "movdqu 48(%[s]), %%xmm3\n\t"
+                         "movdqa %%xmm0, (%[d])\n\t"
+                         "movdqa %%xmm1, 16(%[d])\n\t"
+                         "movdqa %%xmm2, 32(%[d])\n\t"
+                         "movdqa %%xmm3, 48(%[d])\n\t"
+                         "add $64, %[s]\n\t"
+                         "add $64, %[d]\n\t"
+                         "dec %[blocks]\n\t"
+                         "jnz 1b"
+                         : [d] "+r"(d), [s] "+r"(s), [blocks] "+r"(blocks)
+                         :
+                         : "memory", "cc", "xmm0", "xmm1", "xmm2", "xmm3");
+    __copy_forward(d, s, (num - head) & 63U);
+}
+
+/// @brief Fills bytes, 64 at a time through the SSE2 registers, once the
+/// destination is aligned to 16 bytes.
+/// @param dst the bytes to fill.
+/// @param value the value of each byte.
+/// @param num the number of bytes, at least 64.
+__attribute__((target("sse2"))) static void __fill_sse2(void *dst, unsigned char value, size_t num)
+{
+    size_t head = (-(uintptr_t)dst) & 15U;
+    __fill(dst, value, head);
+    char *d       = (char *)dst + head;
+    size_t blocks = (num - head) / 64;
+    __asm__ __volatile__("movd %[pattern], %%xmm0\n\t"
+                         "pshufd $0, %%xmm0, %%xmm0\n\t"
+                         "1:\n\t"
+                         "movdqa %%xmm0, (%[d])\n\t"
+                         "movdqa %%xmm0, 16(%[d])\n\t"
+                         "movdqa %%xmm0, 32(%[d])\n\t"
+                         "movdqa %%xmm0, 48(%[d])\n\t"
+                         "add $64, %[d]\n\t"
+                         "dec %[blocks]\n\t"
+                         "jnz 1b"
+                         : [d] "+r"(d), [blocks] "+r"(blocks)
+                         : [pattern] "r"(value * ONES)
+                         : "memory", "cc", "xmm0");
+    __fill(d, value, (num - head) & 63U);
+}
+
+/// The size from which memchr() looks for the character through the SSE2 registers.
+#define SSE2_SEARCH_THRESHOLD 32
+
+/// @brief Compares 16 aligned bytes with a byte, which never reads across a page.
+/// @param block the bytes, aligned to 16.
+/// @param pattern the byte, repeated in each byte of the word.
+/// @return a mask with a bit set for each byte which is equal to it.
+__attribute__((target("sse2"))) static inline unsigned __match16_sse2(const void *block, uint32_t pattern)
+{
+    unsigned mask;
+    __asm__("movd %[pattern], %%xmm1\n\t"
+            "pshufd $0, %%xmm1, %%xmm1\n\t"
+            "movdqa %[block], %%xmm0\n\t"
+            "pcmpeqb %%xmm1, %%xmm0\n\t"
+            "pmovmskb %%xmm0, %[mask]"
+            : [mask] "=r"(mask)
+            : [block] "m"(*(const char(*)[16])block), [pattern] "r"(pattern)
+            : "xmm0", "xmm1");
+    return mask;
+}
+
+/// @brief Looks for a byte, 16 bytes at a time through the SSE2 registers.
+/// @param ptr where the search starts.
+/// @param value the byte.
+/// @param end where the search stops, or NULL to look until the byte is found.
+/// @return the first occurrence of the byte, or NULL.
+__attribute__((target("sse2"))) static const char *__find_sse2(const char *ptr, unsigned char value, const char *end)
+{
+    uint32_t pattern  = value * ONES;
+    const char *block = (const char *)((uintptr_t)ptr & ~15U);
+    // The bytes of the first block which come before the start are ignored.
+    unsigned mask     = __match16_sse2(block, pattern) & (~0U << ((uintptr_t)ptr & 15U));
+    while (!mask) {
+        block += 16;
+        if (end && (block >= end)) {
+            return NULL;
+        }
+        mask = __match16_sse2(block, pattern);
+    }
+    const char *found = block + __builtin_ctz(mask);
+    return (!end || (found < end)) ? found : NULL;
+}
+
 char *strncpy(char *destination, const char *source, size_t num)
 {
     // Check if we have a valid number.
@@ -71,58 +247,160 @@ int strnicmp(const char *str1, const char *str2, size_t n)
 
 char *strchr(const char *s, int ch)
 {
-    while (*s && *s != (char)ch) {
-        s++;
+    // Reach the first aligned word, reading a word never crosses a page then.
+    for (; (uintptr_t)s & 3U; ++s) {
+        if (*s == (char)ch) {
+            return (char *)s;
+        }
+        if (!*s) {
+            return NULL;
+        }
     }
-    if (*s == (char)ch) {
-        return (char *)s;
+    // Look for the character, or the terminator, a word at a time.
+    uint32_t pattern   = (unsigned char)ch * ONES;
+    const word_t *word = (const word_t *)s;
+    while (!HAS_ZERO(*word) && !HAS_ZERO(*word ^ pattern)) {
+        ++word;
     }
-    {
-        return NULL;
+    for (s = (const char *)word; *s != (char)ch; ++s) {
+        if (!*s) {
+            return NULL;
+        }
     }
+    return (char *)s;
 }
 
 char *strrchr(const char *s, int ch)
 {
-    char *start = (char *)s;
-
-    while (*s++) {
+    if (!(char)ch) {
+        return (char *)s + strlen(s);
     }
+    const char *last = NULL;
+    while ((s = strchr(s, ch))) {
+        last = s++;
+    }
+    return (char *)last;
+}
 
-    while (--s != start && *s != (char)ch) {
+/// @brief Finds the critical factorization of the needle, used by strstr():
+/// the longer of its maximal suffixes, for the order and for the reverse order.
+/// @param needle the needle.
+/// @param length the length of the needle, at least 2.
+/// @param period where the period of the chosen suffix is stored.
+/// @return the position where the right part of the needle starts.
+static size_t __critical_factorization(const unsigned char *needle, size_t length, size_t *period)
+{
+    size_t suffix[2], periods[2];
+    for (int reverse = 0; reverse < 2; ++reverse) {
+        // The suffix starts after `start`, which is -1 for the whole needle.
+        size_t start = (size_t)-1, j = 0, k = 1, p = 1;
+        while ((j + k) < length) {
+            unsigned char a = needle[j + k], b = needle[start + k];
+            if (reverse ? (a > b) : (a < b)) {
+                // The suffix is smaller, the period is the prefix so far.
+                j += k;
+                k = 1;
+                p = j - start;
+            } else if (a == b) {
+                // Advance through the repetition of the period.
+                if (k != p) {
+                    ++k;
+                } else {
+                    j += p;
+                    k = 1;
+                }
+            } else {
+                // The suffix is larger, start over from here.
+                start = j++;
+                k = p = 1;
+            }
+        }
+        suffix[reverse]  = start + 1;
+        periods[reverse] = p;
     }
+    int longer = (suffix[1] >= suffix[0]) ? 1 : 0;
+    *period    = periods[longer];
+    return suffix[longer];
+}
 
-    if (*s == (char)ch) {
-        return (char *)s;
+/// @brief Tells if the haystack holds at least `needed` characters, looking
+/// for its terminator only as far as needed, a chunk at a time.
+/// @param haystack the haystack.
+/// @param length the number of characters known to be there, updated.
+/// @param needed the number of characters needed.
+/// @return 1 if they are there, 0 otherwise.
+static inline int __available(const char *haystack, size_t *length, size_t needed)
+{
+    if (needed > *length) {
+        *length += strnlen(haystack + *length, (needed - *length) + 256);
     }
+    return needed <= *length;
+}
 
+/// @brief Finds the needle with the Two-Way algorithm, in linear time and
+/// constant space.
+/// @param haystack the haystack.
+/// @param needle the needle.
+/// @param length the length of the needle, at least 2.
+/// @return the first occurrence, or NULL.
+static char *__two_way(const char *haystack, const char *needle, size_t length)
+{
+    const unsigned char *h = (const unsigned char *)haystack;
+    const unsigned char *n = (const unsigned char *)needle;
+    size_t period, available = 0, i, j = 0;
+    size_t suffix = __critical_factorization(n, length, &period);
+    if (memcmp(n, n + period, suffix) == 0) {
+        // The needle is periodic, what matched of the last period is remembered.
+        size_t memory = 0;
+        while (__available(haystack, &available, j + length)) {
+            // Match the right part, then the left one.
+            for (i = max(suffix, memory); (i < length) && (n[i] == h[i + j]); ++i) {
+            }
+            if (i < length) {
+                j += i - suffix + 1;
+                memory = 0;
+                continue;
+            }
+            for (i = suffix; (i > memory) && (n[i - 1] == h[i - 1 + j]); --i) {
+            }
+            if (i <= memory) {
+                return (char *)h + j;
+            }
+            j += period;
+            memory = length - period;
+        }
+        return NULL;
+    }
+    // Otherwise, the shift after a mismatch of the left part is at least this.
+    period = max(suffix, length - suffix) + 1;
+    while (__available(haystack, &available, j + length)) {
+        for (i = suffix; (i < length) && (n[i] == h[i + j]); ++i) {
+        }
+        if (i < length) {
+            j += i - suffix + 1;
+            continue;
+        }
+        for (i = suffix; (i > 0) && (n[i - 1] == h[i - 1 + j]); --i) {
+        }
+        if (i == 0) {
+            return (char *)h + j;
+        }
+        j += period;
+    }
     return NULL;
 }
 
 char *strstr(const char *str1, const char *str2)
 {
-    char *cp = (char *)str1;
-    char *tmp1;
-    char *tmp2;
-
     if (!*str2) {
         return (char *)str1;
     }
-
-    while (*cp) {
-        tmp1 = cp;
-        tmp2 = (char *)str2;
-
-        while (*tmp1 && *tmp2 && !(*tmp1 - *tmp2)) {
-            tmp1++, tmp2++;
-        }
-        if (!*tmp2) {
-            return cp;
-        }
-        cp++;
+    // Skip to the first occurrence of the first character.
+    const char *start = strchr(str1, *str2);
+    if (!start || !str2[1]) {
+        return (char *)start;
     }
-
-    return NULL;
+    return __two_way(start, str2, strlen(str2));
 }
 
 size_t strspn(const char *string, const char *control)
@@ -256,40 +534,50 @@ int tokenize(const char *string, const char *separators, size_t *offset, char *b
 
 void *memmove(void *dst, const void *src, size_t n)
 {
-    void *ret = dst;
-
     if (dst <= src || (char *)dst >= ((char *)src + n)) {
-        /* Non-overlapping buffers; copy from lower addresses to higher
-         * addresses.
-         */
-        while (n--) {
-            *(char *)dst = *(char *)src;
-            dst          = (char *)dst + 1;
-            src          = (char *)src + 1;
-        }
-    } else {
-        // Overlapping buffers; copy from higher addresses to lower addresses.
-        dst = (char *)dst + n - 1;
-        src = (char *)src + n - 1;
-
-        while (n--) {
-            *(char *)dst = *(char *)src;
-            dst          = (char *)dst - 1;
-            src          = (char *)src - 1;
-        }
-    }
-
-    return ret;
+        // Copying forward never overwrites a byte before it is read.
+        return memcpy(dst, src, n);
+    }
+    // Overlapping buffers; copy from higher addresses to lower addresses, the
+    // last bytes one at a time, and then the words.
+    void *d       = (char *)dst + n - 1;
+    const void *s = (const char *)src + n - 1;
+    size_t tail   = n & 3U;
+    __asm__ __volatile__("std\n\t"
+                         "rep movsb\n\t"
+                         "sub $3, %%esi\n\t"
+                         "sub $3, %%edi\n\t"
+                         "mov %[words], %%ecx\n\t"
+                         "rep movsl\n\t"
+                         "cld"
+                         : "+D"(d), "+S"(s), "+c"(tail)
+                         : [words] "rm"(n / 4)
+                         : "memory", "cc");
+    return dst;
 }
 
 void *memchr(const void *ptr, int ch, size_t n)
 {
-    while (n && (*(unsigned char *)ptr != (unsigned char)ch)) {
-        ptr = (unsigned char *)ptr + 1;
-        n--;
+    if ((n >= SSE2_SEARCH_THRESHOLD) && __has_sse2()) {
+        return (void *)__find_sse2((const char *)ptr, (unsigned char)ch, (const char *)ptr + n);
+    }
+    const unsigned char *it = (const unsigned char *)ptr;
+    // Reach the first aligned word, reading a word never crosses a page then.
+    for (; n && ((uintptr_t)it & 3U); --n, ++it) {
+        if (*it == (unsigned char)ch) {
+            return (void *)it;
+        }
     }
-
-    return (n ? (void *)ptr : NULL);
+    // Look for the character a word at a time.
+    uint32_t pattern = (unsigned char)ch * ONES;
+    for (; (n >= 4) && !HAS_ZERO(*(const word_t *)it ^ pattern); n -= 4, it += 4) {
+    }
+    for (; n; --n, ++it) {
+        if (*it == (unsigned char)ch) {
+            return (void *)it;
+        }
+    }
+    return NULL;
 }
 
 char *strlwr(char *s)
@@ -442,15 +730,11 @@ char *strtok_r(char *str, const char *delim, char **saveptr)
 
 void *memset(void *ptr, int value, size_t num)
 {
-    // Turn the pointer into a char * pointer. Here, we use the volatile keyword
-    // to prevent the compiler from optimizing away the operations involving the
-    // pointer.
-    unsigned char volatile *dst = (unsigned char volatile *)ptr;
-    // Initialize the content of the memory.
-    while (num--) {
-        *dst++ = (unsigned char)value;
+    if ((num >= SSE2_THRESHOLD) && __has_sse2()) {
+        __fill_sse2(ptr, (unsigned char)value, num);
+    } else {
+        __fill(ptr, (unsigned char)value, num);
     }
-    // Return the pointer.
     return ptr;
 }
 
@@ -470,16 +754,11 @@ int memcmp(const void *ptr1, const void *ptr2, size_t n)
 
 void *memcpy(void *dst, const void *src, size_t num)
 {
-    // Turn the pointer into a char * pointer. Here, we use the volatile keyword
-    // to prevent the compiler from optimizing away the operations involving the
-    // pointer.
-    unsigned char volatile *_dst       = (unsigned char volatile *)dst;
-    const unsigned char volatile *_src = (const unsigned char volatile *)src;
-    // Initialize the content of the memory.
-    while (num--) {
-        *_dst++ = *_src++;
+    if ((num >= SSE2_THRESHOLD) && __has_sse2()) {
+        __copy_forward_sse2(dst, src, num);
+    } else {
+        __copy_forward(dst, src, num);
     }
-    // Return the pointer.
     return dst;
 }
 
@@ -502,9 +781,22 @@ char *strcpy(char *dst, const char *src)
 
 size_t strlen(const char *s)
 {
+    if (__has_sse2()) {
+        return (size_t)(__find_sse2(s, 0, NULL) - s);
+    }
     const char *it = s;
-    for (; *it; it++) {
-        ;
+    // Reach the first aligned word, reading a word never crosses a page then.
+    for (; (uintptr_t)it & 3U; it++) {
+        if (!*it) {
+            return (size_t)(it - s);
+        }
+    }
+    // Look for the terminator a word at a time.
+    const word_t *word = (const word_t *)it;
+    while (!HAS_ZERO(*word)) {
+        ++word;
+    }
+    for (it = (const char *)word; *it; it++) {
     }
     return (size_t)(it - s);
 }
@@ -517,6 +809,20 @@ size_t strnlen(const char *str, size_t maxlen)
 
 int strcmp(const char *str1, const char *str2)
 {
+    // Compare a word at a time, when both strings are aligned alike.
+    if ((((uintptr_t)str1 ^ (uintptr_t)str2) & 3U) == 0) {
+        for (; ((uintptr_t)str1 & 3U) && *str1 && (*str1 == *str2); str1++, str2++) {
+        }
+        if (((uintptr_t)str1 & 3U) == 0) {
+            const word_t *word1 = (const word_t *)str1;
+            const word_t *word2 = (const word_t *)str2;
+            while ((*word1 == *word2) && !HAS_ZERO(*word1)) {
+                ++word1, ++word2;
+            }
+            str1 = (const char *)word1;
+            str2 = (const char *)word2;
+        }
+    }
     while (*str1 && *str2) {
         if (*str1 < *str2) {
             break;
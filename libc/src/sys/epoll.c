@@ -0,0 +1,29 @@
+/// @file epoll.c
+/// @brief I/O event notification.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/epoll.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int epoll_create(int size)
+{
+    long __res;
+    __inline_syscall_1(__res, epoll_create, size);
+    __syscall_return(int, __res);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    long __res;
+    __inline_syscall_4(__res, epoll_ctl, epfd, op, fd, event);
+    __syscall_return(int, __res);
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    long __res;
+    __inline_syscall_4(__res, epoll_wait, epfd, events, maxevents, timeout);
+    __syscall_return(int, __res);
+}
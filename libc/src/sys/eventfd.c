@@ -0,0 +1,26 @@
+/// @file eventfd.c
+/// @brief Event notification through a file descriptor.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/eventfd.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+int eventfd(unsigned int initval, int flags)
+{
+    long __res;
+    __inline_syscall_2(__res, eventfd2, initval, flags);
+    __syscall_return(int, __res);
+}
+
+int eventfd_read(int fd, eventfd_t *value)
+{
+    return (read(fd, value, sizeof(eventfd_t)) == sizeof(eventfd_t)) ? 0 : -1;
+}
+
+int eventfd_write(int fd, eventfd_t value)
+{
+    return (write(fd, &value, sizeof(eventfd_t)) == sizeof(eventfd_t)) ? 0 : -1;
+}
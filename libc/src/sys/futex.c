@@ -0,0 +1,15 @@
+/// @file futex.c
+/// @brief Fast user-space locking.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/futex.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+long futex(int *uaddr, int futex_op, int val, const struct timespec *timeout)
+{
+    long __res;
+    __inline_syscall_4(__res, futex, uaddr, futex_op, val, timeout);
+    __syscall_return(long, __res);
+}
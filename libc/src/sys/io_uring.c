@@ -0,0 +1,117 @@
+/// @file io_uring.c
+/// @brief Batched submission of system calls, through rings shared with the kernel.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/io_uring.h"
+#include "errno.h"
+#include "string.h"
+#include "sys/mman.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+/// @brief The size of the mapping which holds both queues.
+/// @param entries the entries of the submission queue, a power of two.
+/// @return the size of the mapping.
+static inline size_t __io_uring_size(unsigned int entries)
+{
+    return IORING_SQ_SIZE(entries) + IORING_CQ_SIZE(2U * entries);
+}
+
+int io_uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+    long __res;
+    __inline_syscall_2(__res, io_uring_setup, entries, params);
+    __syscall_return(int, __res);
+}
+
+int io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, io_uring_enter, fd, to_submit, min_complete, flags);
+    __syscall_return(int, __res);
+}
+
+int io_uring_queue_init(unsigned int entries, struct io_uring *ring)
+{
+    if (!entries || (entries > IORING_MAX_ENTRIES)) {
+        errno = EINVAL;
+        return -1;
+    }
+    unsigned int rounded = 1;
+    while (rounded < entries) {
+        rounded <<= 1U;
+    }
+    // Both queues share a single mapping, the completions follow the entries.
+    char *memory = mmap(NULL, __io_uring_size(rounded), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return -1;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.sq = (struct io_uring_sq *)memory;
+    params.cq = (struct io_uring_cq *)(memory + IORING_SQ_SIZE(rounded));
+    int fd    = io_uring_setup(entries, &params);
+    if (fd < 0) {
+        munmap(memory, __io_uring_size(rounded));
+        return -1;
+    }
+    ring->ring_fd  = fd;
+    ring->sq       = params.sq;
+    ring->cq       = params.cq;
+    ring->sqe_tail = 0;
+    return 0;
+}
+
+void io_uring_queue_exit(struct io_uring *ring)
+{
+    close(ring->ring_fd);
+    munmap(ring->sq, __io_uring_size(ring->sq->ring_entries));
+    ring->ring_fd = -1;
+}
+
+struct io_uring_sqe *io_uring_get_sqe(struct io_uring *ring)
+{
+    struct io_uring_sq *sq = ring->sq;
+    if ((ring->sqe_tail - sq->head) >= sq->ring_entries) {
+        return NULL;
+    }
+    struct io_uring_sqe *sqe = &sq->sqes[ring->sqe_tail++ & sq->ring_mask];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+int io_uring_submit(struct io_uring *ring)
+{
+    // The entries are written before the tail which makes them visible.
+    __asm__ __volatile__("" : : : "memory");
+    ring->sq->tail = ring->sqe_tail;
+    return io_uring_enter(ring->ring_fd, ring->sqe_tail - ring->sq->head, 0, 0);
+}
+
+int io_uring_peek_cqe(struct io_uring *ring, struct io_uring_cqe **cqe)
+{
+    struct io_uring_cq *cq = ring->cq;
+    if (cq->head == cq->tail) {
+        errno = EAGAIN;
+        return -1;
+    }
+    *cqe = &cq->cqes[cq->head & cq->ring_mask];
+    return 0;
+}
+
+int io_uring_wait_cqe(struct io_uring *ring, struct io_uring_cqe **cqe)
+{
+    // The entries complete once submitted, so only the ones still queued
+    // can bring a completion.
+    if ((io_uring_peek_cqe(ring, cqe) < 0) && (io_uring_submit(ring) < 0)) {
+        return -1;
+    }
+    return io_uring_peek_cqe(ring, cqe);
+}
+
+void io_uring_cqe_seen(struct io_uring *ring, struct io_uring_cqe *cqe)
+{
+    (void)cqe;
+    ring->cq->head = ring->cq->head + 1U;
+}
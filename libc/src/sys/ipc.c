@@ -80,74 +80,30 @@ int msgctl(int msqid, int cmd, struct msqid_ds *buf)
 int msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
 {
     long __res;
-    do {
-        __inline_syscall_4(__res, msgsnd, msqid, msgp, msgsz, msgflg);
-        if (!(msgflg & IPC_NOWAIT) && (__res == -EAGAIN)) {
-            continue;
-        }
-        break;
-    } while (1);
+    __inline_syscall_4(__res, msgsnd, msqid, msgp, msgsz, msgflg);
     __syscall_return(int, __res);
 }
 
 ssize_t msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
 {
     long __res;
-    do {
-        __inline_syscall_5(__res, msgrcv, msqid, msgp, msgsz, msgtyp, msgflg);
-        if (!(msgflg & IPC_NOWAIT) && ((__res == -EAGAIN) || (__res == -ENOMSG))) {
-            continue;
-        }
-        break;
-    } while (1);
+    __inline_syscall_5(__res, msgrcv, msqid, msgp, msgsz, msgtyp, msgflg);
     __syscall_return(int, __res);
 }
 
 long semop(int semid, struct sembuf *sops, unsigned nsops)
 {
-    struct sembuf *op;
     long __res;
+    // The kernel performs all the operations at once, sleeping until they
+    // can be performed, unless IPC_NOWAIT is set.
+    __inline_syscall_3(__res, semop, semid, sops, nsops);
+    __syscall_return(long, __res);
+}
 
-    // The pointer to the operation is NULL.
-    if (!sops) {
-        perror("The pointer to the operation is NULL.\n");
-        errno = EINVAL;
-        return -1;
-    }
-
-    // The value of nsops is negative.
-    if (nsops <= 0) {
-        perror("The value of nsops is negative.\n");
-        errno = EINVAL;
-        return -1;
-    }
-
-    // This should be performed for each sops.
-    for (size_t i = 0; i < nsops; i++) {
-        // Get the operation.
-        op = &sops[i];
-        // The process continues to try to perform the operation until it completes
-        // or receives an error.
-        while (1) {
-            // Calling the kernel-side function.
-            __inline_syscall_3(__res, semop, semid, op, 1);
-
-            // If we get an error, the operation has been taken care of we stop
-            // the loop. We also stop the loop if the operation is not allowed
-            // and the IPC_NOWAIT flag is 1
-            if ((__res != -EAGAIN) || (op->sem_flg & IPC_NOWAIT)) {
-                break;
-            }
-        }
-        // If the operation couldn't be performed and we had the IPC_NOWAIT set
-        // to 1 then we return.
-        if ((__res == -EAGAIN) && (op->sem_flg & IPC_NOWAIT)) {
-            errno = EAGAIN;
-            return -1;
-        }
-    }
-
-    // Now, we can return the value.
+long semtimedop(int semid, struct sembuf *sops, unsigned nsops, const struct timespec *timeout)
+{
+    long __res;
+    __inline_syscall_4(__res, semtimedop, semid, sops, nsops, timeout);
     __syscall_return(long, __res);
 }
 
@@ -5,16 +5,49 @@
 
 #include "sys/mman.h"
 #include "errno.h"
+#include "fcntl.h"
+#include "limits.h"
+#include "string.h"
 #include "system/syscall_types.h"
 #include "unistd.h"
 
-#if 0
+/// The directory where the shared memory objects live.
+#define SHM_DIRECTORY "/dev/shm"
+
+/// @brief Builds the path of a shared memory object.
+/// @param name the name of the object.
+/// @param path where the path is stored, PATH_MAX bytes long.
+/// @return 0 on success, -1 if the name is not valid and errno is set.
+static int __shm_path(const char *name, char *path)
+{
+    size_t length = name ? strlen(name) : 0;
+    // The name is a single component, after its leading slash.
+    if ((length < 2) || (name[0] != '/') || strchr(name + 1, '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((length - 1 > NAME_MAX) || (sizeof(SHM_DIRECTORY) + length > PATH_MAX)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(path, SHM_DIRECTORY);
+    strcat(path, name);
+    return 0;
+}
 
-// _syscall6(void *, mmap, void *, addr, size_t, length, int, prot, int, flags, int, fd, off_t, offset)
 void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
+    // The six arguments do not fit inside the registers.
+    mmap_arg_struct_t args = {
+        .addr   = (unsigned long)addr,
+        .len    = length,
+        .prot   = prot,
+        .flags  = flags,
+        .fd     = fd,
+        .offset = offset,
+    };
     long __res;
-    __inline_syscall_6(__res, mmap, addr, length, prot, flags, fd, offset);
+    __inline_syscall_1(__res, mmap, &args);
     __syscall_return(void *, __res);
 }
 
@@ -26,4 +59,36 @@ int munmap(void *addr, size_t length)
     __syscall_return(int, __res);
 }
 
-#endif
+// _syscall3(int, msync, void *, addr, size_t, length, int, flags)
+int msync(void *addr, size_t length, int flags)
+{
+    long __res;
+    __inline_syscall_3(__res, msync, addr, length, flags);
+    __syscall_return(int, __res);
+}
+
+// _syscall3(int, madvise, void *, addr, size_t, length, int, advice)
+int madvise(void *addr, size_t length, int advice)
+{
+    long __res;
+    __inline_syscall_3(__res, madvise, addr, length, advice);
+    __syscall_return(int, __res);
+}
+
+int shm_open(const char *name, int oflag, mode_t mode)
+{
+    char path[PATH_MAX];
+    if (__shm_path(name, path) < 0) {
+        return -1;
+    }
+    return open(path, oflag, mode);
+}
+
+int shm_unlink(const char *name)
+{
+    char path[PATH_MAX];
+    if (__shm_path(name, path) < 0) {
+        return -1;
+    }
+    return unlink(path);
+}
@@ -0,0 +1,15 @@
+/// @file perf_event.c
+/// @brief Counting of hardware events, through a file descriptor.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/perf_event.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int perf_event_open(perf_event_attr_t *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+    long __res;
+    __inline_syscall_5(__res, perf_event_open, attr, pid, cpu, group_fd, flags);
+    __syscall_return(int, __res);
+}
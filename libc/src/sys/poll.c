@@ -0,0 +1,15 @@
+/// @file poll.c
+/// @brief Wait for some event on a set of file descriptors.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/poll.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    long __res;
+    __inline_syscall_3(__res, poll, fds, nfds, timeout);
+    __syscall_return(int, __res);
+}
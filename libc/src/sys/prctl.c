@@ -0,0 +1,15 @@
+/// @file prctl.c
+/// @brief Operations on the attributes of a process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/prctl.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int prctl(int option, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5)
+{
+    long __res;
+    __inline_syscall_5(__res, prctl, option, arg2, arg3, arg4, arg5);
+    __syscall_return(int, __res);
+}
@@ -0,0 +1,36 @@
+/// @file resource.c
+/// @brief Functions used to get, and set, the limits of the resources.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/resource.h"
+#include "errno.h"
+#include "stddef.h"
+#include "system/syscall_types.h"
+
+// _syscall2(int, getrlimit, int, resource, struct rlimit *, rlim)
+
+int getrlimit(int resource, struct rlimit *rlim)
+{
+    long __res;
+    __inline_syscall_2(__res, getrlimit, resource, rlim);
+    __syscall_return(int, __res);
+}
+
+// _syscall2(int, setrlimit, int, resource, const struct rlimit *, rlim)
+
+int setrlimit(int resource, const struct rlimit *rlim)
+{
+    long __res;
+    __inline_syscall_2(__res, setrlimit, resource, rlim);
+    __syscall_return(int, __res);
+}
+
+// _syscall2(int, getrusage, int, who, struct rusage *, usage)
+
+int getrusage(int who, struct rusage *usage)
+{
+    long __res;
+    __inline_syscall_2(__res, getrusage, who, usage);
+    __syscall_return(int, __res);
+}
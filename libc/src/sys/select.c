@@ -0,0 +1,15 @@
+/// @file select.c
+/// @brief Synchronous I/O multiplexing.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/select.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    long __res;
+    __inline_syscall_5(__res, select, nfds, readfds, writefds, exceptfds, timeout);
+    __syscall_return(int, __res);
+}
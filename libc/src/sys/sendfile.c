@@ -0,0 +1,57 @@
+/// @file sendfile.c
+/// @brief Transfer of data between file descriptors inside the kernel.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/sendfile.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "sys/uio.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    long __res;
+    __inline_syscall_4(__res, sendfile, out_fd, in_fd, offset, count);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned int flags)
+{
+    // No flags are defined, and the system call takes only five arguments.
+    if (flags != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    long __res;
+    __inline_syscall_5(__res, copy_file_range, fd_in, off_in, fd_out, off_out, len);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned int flags)
+{
+    // The system call takes only five arguments, the hints do not need to
+    // reach the kernel, and the pipes are only non-blocking through O_NONBLOCK.
+    if (flags & ~(SPLICE_F_MOVE | SPLICE_F_MORE | SPLICE_F_GIFT)) {
+        errno = EINVAL;
+        return -1;
+    }
+    long __res;
+    __inline_syscall_5(__res, splice, fd_in, off_in, fd_out, off_out, len);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, tee, fd_in, fd_out, len, flags);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t vmsplice(int fd, const struct iovec *iov, unsigned long nr_segs, unsigned int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, vmsplice, fd, iov, nr_segs, flags);
+    __syscall_return(ssize_t, __res);
+}
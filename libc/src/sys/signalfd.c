@@ -0,0 +1,15 @@
+/// @file signalfd.c
+/// @brief Reception of signals through a file descriptor.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/signalfd.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int signalfd(int fd, const sigset_t *mask, int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, signalfd4, fd, mask, sizeof(sigset_t), flags);
+    __syscall_return(int, __res);
+}
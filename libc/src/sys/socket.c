@@ -0,0 +1,109 @@
+/// @file socket.c
+/// @brief Sockets, of the local (AF_UNIX) and Internet (AF_INET) domains.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/socket.h"
+#include "errno.h"
+#include "string.h"
+#include "sys/uio.h"
+#include "system/syscall_types.h"
+
+int socket(int domain, int type, int protocol)
+{
+    long __res;
+    __inline_syscall_3(__res, socket, domain, type, protocol);
+    __syscall_return(int, __res);
+}
+
+int socketpair(int domain, int type, int protocol, int sv[2])
+{
+    long __res;
+    __inline_syscall_4(__res, socketpair, domain, type, protocol, sv);
+    __syscall_return(int, __res);
+}
+
+int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    long __res;
+    __inline_syscall_3(__res, bind, sockfd, addr, addrlen);
+    __syscall_return(int, __res);
+}
+
+int listen(int sockfd, int backlog)
+{
+    long __res;
+    __inline_syscall_2(__res, listen, sockfd, backlog);
+    __syscall_return(int, __res);
+}
+
+int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, accept4, sockfd, addr, addrlen, flags);
+    __syscall_return(int, __res);
+}
+
+int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen) { return accept4(sockfd, addr, addrlen, 0); }
+
+int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    long __res;
+    __inline_syscall_3(__res, connect, sockfd, addr, addrlen);
+    __syscall_return(int, __res);
+}
+
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags)
+{
+    long __res;
+    __inline_syscall_3(__res, sendmsg, sockfd, msg, flags);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
+{
+    long __res;
+    __inline_syscall_3(__res, recvmsg, sockfd, msg, flags);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t sendto(int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen)
+{
+    // The system call would take six arguments, we go through sendmsg().
+    struct iovec iov = { .iov_base = (void *)buf, .iov_len = len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_name    = (void *)dest_addr;
+    msg.msg_namelen = dest_addr ? addrlen : 0;
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    return sendmsg(sockfd, &msg, flags);
+}
+
+ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen)
+{
+    // The system call would take six arguments, we go through recvmsg().
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_name    = src_addr;
+    msg.msg_namelen = (src_addr && addrlen) ? *addrlen : 0;
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    ssize_t ret     = recvmsg(sockfd, &msg, flags);
+    if ((ret >= 0) && src_addr && addrlen) {
+        *addrlen = msg.msg_namelen;
+    }
+    return ret;
+}
+
+ssize_t send(int sockfd, const void *buf, size_t len, int flags) { return sendto(sockfd, buf, len, flags, NULL, 0); }
+
+ssize_t recv(int sockfd, void *buf, size_t len, int flags) { return recvfrom(sockfd, buf, len, flags, NULL, NULL); }
+
+int shutdown(int sockfd, int how)
+{
+    long __res;
+    __inline_syscall_2(__res, shutdown, sockfd, how);
+    __syscall_return(int, __res);
+}
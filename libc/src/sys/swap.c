@@ -0,0 +1,22 @@
+/// @file swap.c
+/// @brief Management of the swap area.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/swap.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+int swapon(const char *path, int swapflags)
+{
+    long __res;
+    __inline_syscall_2(__res, swapon, path, swapflags);
+    __syscall_return(int, __res);
+}
+
+int swapoff(const char *path)
+{
+    long __res;
+    __inline_syscall_1(__res, swapoff, path);
+    __syscall_return(int, __res);
+}
@@ -0,0 +1,18 @@
+/// @file times.c
+/// @brief Function used to get the CPU times of the process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/times.h"
+#include "errno.h"
+#include "stddef.h"
+#include "system/syscall_types.h"
+
+// _syscall1(clock_t, times, struct tms *, buf)
+
+clock_t times(struct tms *buf)
+{
+    long __res;
+    __inline_syscall_1(__res, times, buf);
+    __syscall_return(clock_t, __res);
+}
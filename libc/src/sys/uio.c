@@ -0,0 +1,36 @@
+/// @file uio.c
+/// @brief Vectored I/O operations.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "sys/uio.h"
+#include "errno.h"
+#include "system/syscall_types.h"
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    long __res;
+    __inline_syscall_3(__res, readv, fd, iov, iovcnt);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    long __res;
+    __inline_syscall_3(__res, writev, fd, iov, iovcnt);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    long __res;
+    __inline_syscall_4(__res, preadv, fd, iov, iovcnt, offset);
+    __syscall_return(ssize_t, __res);
+}
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    long __res;
+    __inline_syscall_4(__res, pwritev, fd, iov, iovcnt, offset);
+    __syscall_return(ssize_t, __res);
+}
@@ -4,11 +4,16 @@
 /// See LICENSE.md for details.
 
 #include "time.h"
+#include "bits/vdso.h"
 #include "errno.h"
+#include "stdint.h"
 #include "stdio.h"
 #include "string.h"
 #include "system/syscall_types.h"
 
+/// The nanoseconds of a second.
+#define NSEC_PER_SEC 1000000000U
+
 /// @brief List of week days name.
 static const char *weekdays[] = {
     "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday",
@@ -30,13 +35,65 @@ static const char *months_short[] = {
     "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
 };
 
-// _syscall1(time_t, time, time_t *, t)
+/// @brief Divides the nanoseconds of a clock by a second, without libgcc.
+/// @param ns the nanoseconds, less than 2^32 seconds.
+/// @param nsec where the nanoseconds of the last second are stored.
+/// @return the seconds.
+static inline uint32_t __ns_to_sec(uint64_t ns, uint32_t *nsec)
+{
+    uint32_t sec;
+    __asm__("divl %4" : "=a"(sec), "=d"(*nsec) : "a"((uint32_t)ns), "d"((uint32_t)(ns >> 32U)), "rm"(NSEC_PER_SEC));
+    return sec;
+}
+
+/// @brief Reads a clock from the page shared with the kernel.
+/// @param clk_id the clock.
+/// @param ns where the nanoseconds are stored.
+/// @return 0 on success, -1 if the clock needs a system call.
+static inline int __vdso_clock_ns(clockid_t clk_id, uint64_t *ns)
+{
+    const vdso_data_t *vdso = (const vdso_data_t *)VDSO_ADDR;
+    uint32_t seq;
+    uint64_t offset;
+    do {
+        // Wait for the kernel to finish updating the clocks.
+        while ((seq = vdso->seq) & 1U) {}
+        __asm__ __volatile__("" ::: "memory");
+        if (vdso->clock_mode == VDSO_CLOCK_TSC) {
+            uint32_t low, high;
+            __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+            uint64_t cycles = (((uint64_t)high << 32U) | low) - vdso->tsc_base;
+            // The product of 64 and 32 bits, split so that each half fits 64 bits.
+            *ns = (((cycles >> 32U) * vdso->tsc_mult) << (32U - vdso->tsc_shift)) +
+                  (((cycles & 0xFFFFFFFFU) * vdso->tsc_mult) >> vdso->tsc_shift);
+        } else {
+            *ns = vdso->mono_ns;
+        }
+        offset = vdso->realtime_offset;
+        __asm__ __volatile__("" ::: "memory");
+    } while (seq != vdso->seq);
+    if (clk_id == CLOCK_REALTIME) {
+        // The kernel reads the offset from the Real Time Clock the first time.
+        if (offset == 0) {
+            return -1;
+        }
+        *ns += offset;
+    } else if (clk_id != CLOCK_MONOTONIC) {
+        return -1;
+    }
+    return 0;
+}
 
 time_t time(time_t *t)
 {
-    long __res;
-    __inline_syscall_1(__res, time, t);
-    __syscall_return(time_t, __res);
+    struct timespec ts;
+    if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
+        return (time_t)-1;
+    }
+    if (t) {
+        *t = ts.tv_sec;
+    }
+    return ts.tv_sec;
 }
 
 time_t difftime(time_t time1, time_t time2) { return time1 - time2; }
@@ -463,6 +520,27 @@ unsigned int sleep(unsigned int seconds)
 }
 
 // _syscall2(int, getitimer, int, which, struct itimerval *, curr_value)
+int clock_gettime(clockid_t clk_id, struct timespec *tp)
+{
+    uint64_t ns;
+    if (__vdso_clock_ns(clk_id, &ns) == 0) {
+        uint32_t nsec;
+        tp->tv_sec  = __ns_to_sec(ns, &nsec);
+        tp->tv_nsec = (long)nsec;
+        return 0;
+    }
+    long __res;
+    __inline_syscall_2(__res, clock_gettime, clk_id, tp);
+    __syscall_return(int, __res);
+}
+
+int clock_getres(clockid_t clk_id, struct timespec *res)
+{
+    long __res;
+    __inline_syscall_2(__res, clock_getres, clk_id, res);
+    __syscall_return(int, __res);
+}
+
 int getitimer(int which, struct itimerval *curr_value)
 {
     long __res;
@@ -0,0 +1,42 @@
+/// @file brk.c
+/// @brief Changes the end of the heap.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "stdint.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+int brk(void *addr)
+{
+    void *__res;
+    // The kernel returns the end of the heap, which moves only on success.
+    __inline_syscall_1(__res, brk, addr);
+    if (__res != addr) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void *sbrk(intptr_t increment)
+{
+    char *old_end;
+    char *new_end;
+    // The current end of the heap is returned for a NULL address.
+    __inline_syscall_1(old_end, brk, NULL);
+    if (!old_end) {
+        errno = ENOMEM;
+        return (void *)-1;
+    }
+    if (increment == 0) {
+        return old_end;
+    }
+    __inline_syscall_1(new_end, brk, old_end + increment);
+    if (new_end != (old_end + increment)) {
+        errno = ENOMEM;
+        return (void *)-1;
+    }
+    return old_end;
+}
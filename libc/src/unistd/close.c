@@ -4,6 +4,7 @@
 /// See LICENSE.md for details.
 
 #include "errno.h"
+#include "readline.h"
 #include "system/syscall_types.h"
 #include "unistd.h"
 
@@ -12,5 +13,7 @@ int close(int fd)
 {
     long __res;
     __inline_syscall_1(__res, close, fd);
+    // The descriptor might be reused by another file.
+    readline_release(fd);
     __syscall_return(int, __res);
 }
@@ -3,12 +3,16 @@
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
+#include "stdio.h"
 #include "system/syscall_types.h"
 #include "unistd.h"
 
 void exit(int status)
 {
     long __res;
-    __inline_syscall_1(__res, exit, status);
+    // The buffered output is written first.
+    fflush(NULL);
+    // All the threads of the process terminate.
+    __inline_syscall_1(__res, exit_group, status);
     // The process never returns from this system call!
 }
@@ -14,3 +14,12 @@ long fcntl(int fd, unsigned int request, unsigned long data)
     __inline_syscall_3(__res, fcntl, fd, request, data);
     __syscall_return(long, __res);
 }
+
+// _syscall4(int, fadvise64, int, fd, off_t, offset, off_t, len, int, advice)
+int posix_fadvise(int fd, off_t offset, off_t len, int advice)
+{
+    long __res;
+    __inline_syscall_4(__res, fadvise64, fd, offset, len, advice);
+    // The error is returned, instead of being stored inside errno.
+    return (__res < 0) ? -__res : 0;
+}
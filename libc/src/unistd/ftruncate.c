@@ -0,0 +1,15 @@
+/// @file ftruncate.c
+/// @brief
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+int ftruncate(int fd, off_t length)
+{
+    long __res;
+    __inline_syscall_2(__res, ftruncate, fd, length);
+    __syscall_return(int, __res);
+}
@@ -3,14 +3,14 @@
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
+#include "bits/vdso.h"
 #include "errno.h"
 #include "system/syscall_types.h"
 #include "unistd.h"
 
-// _syscall0(pid_t, getpid)
-pid_t getpid(void)
-{
-    long __res;
-    __inline_syscall_0(__res, getpid);
-    __syscall_return(pid_t, __res);
-}
+// The kernel keeps the identifiers of the running process inside the shared
+// page, no system call is needed.
+
+pid_t getpid(void) { return ((const vdso_data_t *)VDSO_ADDR)->pid; }
+
+pid_t gettid(void) { return ((const vdso_data_t *)VDSO_ADDR)->tid; }
@@ -0,0 +1,19 @@
+/// @file mknod.c
+/// @brief Make special file functions.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "sys/stat.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+// _syscall3(int, mknod, const char *, path, mode_t, mode, dev_t, dev)
+int mknod(const char *path, mode_t mode, dev_t dev)
+{
+    long __res;
+    __inline_syscall_3(__res, mknod, path, mode, dev);
+    __syscall_return(int, __res);
+}
+
+int mkfifo(const char *path, mode_t mode) { return mknod(path, S_IFIFO | (mode & 0xFFF), 0); }
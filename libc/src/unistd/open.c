@@ -14,3 +14,11 @@ int open(const char *pathname, int flags, mode_t mode)
     __inline_syscall_3(__res, open, pathname, flags, mode);
     __syscall_return(int, __res);
 }
+
+// _syscall4(int, openat, int, dirfd, const char *, pathname, int, flags, mode_t, mode)
+int openat(int dirfd, const char *pathname, int flags, mode_t mode)
+{
+    long __res;
+    __inline_syscall_4(__res, openat, dirfd, pathname, flags, mode);
+    __syscall_return(int, __res);
+}
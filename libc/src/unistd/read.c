@@ -14,3 +14,10 @@ ssize_t read(int fd, void *buf, size_t nbytes)
     __inline_syscall_3(__res, read, fd, buf, nbytes);
     __syscall_return(ssize_t, __res);
 }
+
+ssize_t pread(int fd, void *buf, size_t nbytes, off_t offset)
+{
+    long __res;
+    __inline_syscall_4(__res, pread64, fd, buf, nbytes, offset);
+    __syscall_return(ssize_t, __res);
+}
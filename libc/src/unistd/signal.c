@@ -8,6 +8,7 @@
 #include "unistd.h"
 
 #include "signal.h"
+#include "string.h"
 #include "sys/bitops.h"
 
 // _syscall0(int, sigreturn)
@@ -33,6 +34,39 @@ int sigprocmask(int how, const sigset_t *set, sigset_t *oldset)
     __syscall_return(int, __res);
 }
 
+int sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout)
+{
+    long __res;
+    __inline_syscall_3(__res, rt_sigtimedwait, set, info, timeout);
+    __syscall_return(int, __res);
+}
+
+int sigqueue(pid_t pid, int sig, const union sigval value)
+{
+    siginfo_t info;
+    memset(&info, 0, sizeof(siginfo_t));
+    info.si_signo = sig;
+    info.si_code  = SI_QUEUE;
+    info.si_pid   = getpid();
+    info.si_uid   = getuid();
+    info.si_value = value;
+    long __res;
+    __inline_syscall_3(__res, rt_sigqueueinfo, pid, sig, &info);
+    __syscall_return(int, __res);
+}
+
+int sigwaitinfo(const sigset_t *set, siginfo_t *info) { return sigtimedwait(set, info, NULL); }
+
+int sigwait(const sigset_t *set, int *sig)
+{
+    int ret = sigtimedwait(set, NULL, NULL);
+    if (ret < 0) {
+        return errno;
+    }
+    *sig = ret;
+    return 0;
+}
+
 /// @brief List of signals names.
 static const char *sys_siglist[] = {
     "HUP",  "INT",  "QUIT", "ILL",  "TRAP", "ABRT",   "EMT",  "FPE",  "KILL",  "BUS", "SEGV",
@@ -56,9 +90,12 @@ int sigaction(int signum, const sigaction_t *act, sigaction_t *oldact)
 
 const char *strsignal(int sig)
 {
-    if ((sig >= SIGHUP) && (sig < NSIG)) {
+    if ((sig >= SIGHUP) && (sig < SIGRTMIN)) {
         return sys_siglist[sig - 1];
     }
+    if ((sig >= SIGRTMIN) && (sig <= SIGRTMAX)) {
+        return "RT";
+    }
     return NULL;
 }
 
@@ -66,6 +103,7 @@ int sigemptyset(sigset_t *set)
 {
     if (set) {
         set->sig[0] = 0;
+        set->sig[1] = 0;
         return 0;
     }
     return -1;
@@ -75,6 +113,7 @@ int sigfillset(sigset_t *set)
 {
     if (set) {
         set->sig[0] = ~0UL;
+        set->sig[1] = ~0UL;
         return 0;
     }
     return -1;
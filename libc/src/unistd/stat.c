@@ -17,6 +17,14 @@ int stat(const char *path, stat_t *buf)
     __syscall_return(int, __res);
 }
 
+// _syscall4(int, fstatat64, int, dirfd, const char *, path, stat_t *, buf, int, flags)
+int fstatat(int dirfd, const char *path, stat_t *buf, int flags)
+{
+    long __res;
+    __inline_syscall_4(__res, fstatat64, dirfd, path, buf, flags);
+    __syscall_return(int, __res);
+}
+
 // _syscall2(int, fstat, int, fd, stat_t *, buf)
 int fstat(int fd, stat_t *buf)
 {
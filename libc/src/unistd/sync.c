@@ -0,0 +1,21 @@
+/// @file sync.c
+/// @brief
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+void sync(void)
+{
+    long __res;
+    __inline_syscall_0(__res, sync);
+}
+
+int fsync(int fd)
+{
+    long __res;
+    __inline_syscall_1(__res, fsync, fd);
+    __syscall_return(int, __res);
+}
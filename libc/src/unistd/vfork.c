@@ -0,0 +1,38 @@
+/// @file vfork.c
+/// @brief
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "errno.h"
+#include "system/syscall_types.h"
+#include "unistd.h"
+
+/// @brief Turns the error returned by vfork() into errno.
+/// @param value The value returned by the system call.
+/// @return The value returned by vfork().
+static __attribute__((used)) pid_t __vfork_return(long value)
+{
+    __syscall_set_errno(value);
+    return (pid_t)value;
+}
+
+/// @brief Stringifies the value of a macro.
+#define __VFORK_STR(x)  #x
+/// @brief Expands, and stringifies, the value of a macro.
+#define __VFORK_XSTR(x) __VFORK_STR(x)
+
+// The child runs on the stack of the parent until it calls execve() or
+// exit(), overwriting the frame of this function. So, the return address is
+// taken off the stack and kept inside ecx, which the kernel restores for both
+// processes, and pushed back once the system call returns.
+__asm__(".globl vfork\n"
+        ".type vfork, @function\n"
+        "vfork:\n"
+        "    popl %ecx\n"
+        "    movl $" __VFORK_XSTR(__NR_vfork) ", %eax\n"
+        "    int $0x80\n"
+        "    pushl %ecx\n"
+        "    pushl %eax\n"
+        "    call __vfork_return\n"
+        "    addl $4, %esp\n"
+        "    ret\n");
@@ -13,61 +13,16 @@
 
 pid_t waitpid(pid_t pid, int *status, int options)
 {
-#if 1
     pid_t __res;
-    int __status = 0;
-    do {
-        __inline_syscall_3(__res, waitpid, pid, &__status, options);
-        if (__res != 0) {
-            break;
-        }
-        if (options && WNOHANG) {
-            break;
-        }
-    } while (1);
-
-    if (status) {
-        *status = __status;
-    }
+    __inline_syscall_3(__res, waitpid, pid, status, options);
     __syscall_return(pid_t, __res);
-#else
-
-    pid_t ret;
-
-    while (1) {
-        __inline_syscall_3(ret, waitpid, pid, status, options);
-
-        // Success: A child process state has changed.
-        if (ret > 0) {
-            break;
-        }
-
-        if (ret < 0) {
-            __syscall_set_errno(ret);
-
-            // Interrupted by a signal: Retry the syscall.
-            if (errno == EINTR) {
-                continue;
-            }
-
-            // No children to wait for, but WNOHANG allows non-blocking behavior.
-            if (errno == ECHILD) {
-                if (options & WNOHANG) {
-                    // Return 0 to indicate no state change.
-                    ret = 0;
-                    break;
-                }
-                continue;
-            }
-
-            // Unrecoverable error: Return -1 and let the caller handle `errno`.
-            break;
-        }
-    }
-
-    // Return the PID of the child whose state has changed (or 0 for WNOHANG).
-    return ret;
-#endif
 }
 
 pid_t wait(int *status) { return waitpid(-1, status, 0); }
+
+pid_t wait4(pid_t pid, int *status, int options, struct rusage *rusage)
+{
+    pid_t __res;
+    __inline_syscall_4(__res, wait4, pid, status, options, rusage);
+    __syscall_return(pid_t, __res);
+}
@@ -14,3 +14,10 @@ ssize_t write(int fd, const void *buf, size_t nbytes)
     __inline_syscall_3(__res, write, fd, buf, nbytes);
     __syscall_return(ssize_t, __res);
 }
+
+ssize_t pwrite(int fd, const void *buf, size_t nbytes, off_t offset)
+{
+    long __res;
+    __inline_syscall_4(__res, pwrite64, fd, buf, nbytes, offset);
+    __syscall_return(ssize_t, __res);
+}
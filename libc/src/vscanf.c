@@ -140,34 +140,34 @@ static int __vsscanf(const char *str, const char *s, va_list ap)
     return count;
 }
 
-/// @brief Read formatted data from file.
-/// @param fd the file descriptor associated with the file.
+/// @brief Read formatted data from a line of the stream.
+/// @param stream the stream.
 /// @param format format string, following the same specifications as printf.
 /// @param ap the list of arguments where the values are stored.
 /// @param blocking if 0, the function will return immediately if no data is
 /// @return On success, the function returns the number of items of the
 ///         argument list successfully filled. EOF otherwise.
-static int __vfscanf(int fd, const char *format, va_list ap, int blocking)
+static int __vfscanf(FILE *stream, const char *format, va_list ap, int blocking)
 {
-    if (fd < 0 || format == NULL) {
+    if (stream == NULL || format == NULL) {
         return -1;
     }
     char str[BUFSIZ + 1] = {0};
     ssize_t idx          = 0;
     while (idx < BUFSIZ) {
-        char c;
-        ssize_t res = read(fd, &c, 1);
-        if (res == 0) {
+        int c = fgetc(stream);
+        if (c == EOF) {
+            if (ferror(stream)) {
+                return -1;
+            }
             // Wait for data.
             if (blocking) {
+                clearerr(stream);
                 continue;
             }
             // Return what we have so far.
             break;
         }
-        if (res < 0) {
-            return -1;
-        }
         if (c == '\n') {
             break;
         }
@@ -182,18 +182,18 @@ int scanf(const char *format, ...)
     int count;
     va_list ap;
     va_start(ap, format);
-    count = __vfscanf(STDIN_FILENO, format, ap, 1);
+    count = __vfscanf(stdin, format, ap, 1);
     va_end(ap);
     return (count);
 }
 
-int fscanf(int fd, const char *format, ...)
+int fscanf(FILE *stream, const char *format, ...)
 {
     int count;
     va_list ap;
 
     va_start(ap, format);
-    count = __vfscanf(fd, format, ap, 0);
+    count = __vfscanf(stream, format, ap, 0);
     va_end(ap);
     return (count);
 }
@@ -103,6 +103,14 @@ enum gdt_bits {
 /// @brief Used in IDT for padding.
 #define IDT_PADDING 14U // `0b00001110U
 
+/// @brief The entry of the user data segment holding the thread-local storage
+///        of the running thread, user mode selects it with `(6 << 3) | 3`.
+#define GDT_TLS_ENTRY 6
+
+/// @brief The entry of the kernel data segment holding the data of the CPU
+///        (see cpu_local_t), the kernel selects it with `7 << 3` inside %fs.
+#define GDT_PERCPU_ENTRY 7
+
 /// @brief Data structure representing a GDT descriptor.
 typedef struct gdt_descriptor {
     /// The lower 16 bits of the limit.
@@ -143,5 +151,16 @@ void init_gdt(void);
 /// @param granul  SegLimit_hi(4 bit) AVL(1 bit) L(1 bit) D/B(1 bit) G(1bit).
 void gdt_set_gate(uint8_t index, uint32_t base, uint32_t limit, uint8_t access, uint8_t granul);
 
+/// @brief Moves the segment of the thread-local storage, it takes effect
+///        once the segment register selecting it is loaded again (e.g., when
+///        returning to user mode).
+/// @param base where the thread-local storage of the running thread starts.
+void gdt_set_tls(uint32_t base);
+
+/// @brief Moves the segment of the data of the CPU, it takes effect once %fs
+///        is loaded again (e.g., when entering the kernel).
+/// @param base the offset of the data of the CPU (see smp_percpu_offset()).
+void gdt_set_percpu(uint32_t base);
+
 /// @}
 /// @}
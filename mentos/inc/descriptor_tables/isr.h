@@ -60,6 +60,30 @@ int irq_install_handler(unsigned i, interrupt_handler_t handler, char *descripti
 /// @return 0 on success, -1 otherwise.
 int irq_uninstall_handler(unsigned i, interrupt_handler_t handler);
 
+/// @brief Lets an IRQ interrupt the CPU, through the controller delivering the IRQs.
+/// @param i interrupt identifier.
+/// @return 0 on success, -1 otherwise.
+int irq_unmask(unsigned i);
+
+/// @brief Stops an IRQ from interrupting the CPU.
+/// @param i interrupt identifier.
+/// @return 0 on success, -1 otherwise.
+int irq_mask(unsigned i);
+
+/// @brief Makes a PCI device signal its interrupts through MSI, with its
+///        own vector, and installs the handler of the vector.
+/// @param device the PCI device identifier.
+/// @param handler interrupt handler.
+/// @param description interrupt description.
+/// @return the vector on success, -1 if the device keeps using its IRQ line.
+int irq_install_msi(uint32_t device, interrupt_handler_t handler, char *description);
+
+/// @brief Returns the number of interrupts a CPU received from an IRQ line, since boot.
+/// @param cpu the index of the CPU.
+/// @param i the IRQ line.
+/// @return the number of interrupts, 0 if the CPU or the line do not exist.
+unsigned long irq_get_count(unsigned int cpu, unsigned i);
+
 /// @brief Method called by CPU to handle interrupts.
 /// @param f The interrupt stack frame.
 extern void irq_handler(pt_regs_t *f);
@@ -59,5 +59,10 @@ void tss_init(uint8_t idx, uint32_t ss0);
 /// @param kesp Kernel stack address.
 void tss_set_stack(uint32_t kss, uint32_t kesp);
 
+/// @brief Returns where the TSS keeps the stack pointer of the kernel, the
+///        `sysenter` entry loads the stack from there.
+/// @return the address of the `esp0` field.
+uint32_t *tss_get_stack_pointer(void);
+
 /// @}
 /// @}
@@ -12,6 +12,8 @@
 
 #include "stdint.h"
 
+struct task_struct;
+
 /// @brief Environment information of floating point unit.
 typedef struct env87 {
     /// Control word (16bits).
@@ -117,13 +119,21 @@ typedef union savefpu {
     savexmm sv_xmm;
 } savefpu;
 
-/// @brief Called during a context switch to save the FPU registers status
-/// of the currently running thread.
-void switch_fpu(void);
+/// @brief Called during a context switch. The FPU registers are not moved,
+/// the FPU traps the first time the next thread uses it, unless they are
+/// already the ones of the next thread.
+/// @param next the thread which is going to run.
+void switch_fpu(struct task_struct *next);
+
+/// @brief Stores the FPU registers of a thread inside its thread structure,
+/// if they are still inside the FPU, e.g., before copying them.
+/// @param task the thread.
+void fpu_save(struct task_struct *task);
 
-/// @brief Called during a context switch to load the FPU registers status
-/// of the currently running thread inside the FPU.
-void unswitch_fpu(void);
+/// @brief Drops the FPU registers of a thread, which starts from initialized
+/// registers the next time it uses the FPU, e.g., after an exec or an exit.
+/// @param task the thread.
+void fpu_release(struct task_struct *task);
 
 /// @brief Enable the FPU context handling.
 /// @return 0 if fails, 1 if succeed.
@@ -233,17 +233,82 @@ typedef enum {
 
 /// @brief PCI device type for SATA controllers.
 #define PCI_TYPE_SATA 0x010600 ///< Device type code for SATA controllers.
+/// @brief PCI device type for SATA controllers implementing the AHCI interface.
+#define PCI_TYPE_AHCI 0x010601 ///< Device type code for AHCI controllers.
+/// @brief PCI device type for VGA compatible video cards.
+#define PCI_TYPE_VGA  0x030000 ///< Device type code for VGA compatible controllers.
 
 /// @brief PCI I/O port addresses for configuration space access.
 #define PCI_ADDRESS_PORT 0xCF8 ///< I/O port for addressing PCI configuration space.
 #define PCI_VALUE_PORT   0xCFC ///< I/O port for reading/writing PCI configuration data.
 
+/// @name PCI capabilities
+/// @brief The capabilities are a list, starting from PCI_CAPABILITY_LIST.
+/// @{
+#define PCI_CAP_ID_MSI  0x05 ///< Capability ID of the Message Signaled Interrupts.
+#define PCI_CAP_ID_VNDR 0x09 ///< Capability ID of the vendor specific capabilities.
+#define PCI_CAP_ID      0x00 ///< Offset of the capability ID.
+#define PCI_CAP_NEXT    0x01 ///< Offset of the pointer to the next capability.
+/// @}
+
+/// @name MSI capability
+/// @brief Registers of the MSI capability, relative to its offset.
+/// @{
+#define PCI_MSI_FLAGS        0x02   ///< Message control (16 bits).
+#define PCI_MSI_ADDRESS_LO   0x04   ///< Lower 32 bits of the message address.
+#define PCI_MSI_ADDRESS_HI   0x08   ///< Upper 32 bits of the message address, for 64-bit devices.
+#define PCI_MSI_DATA_32      0x08   ///< Message data (16 bits), for 32-bit devices.
+#define PCI_MSI_DATA_64      0x0c   ///< Message data (16 bits), for 64-bit devices.
+#define PCI_MSI_FLAGS_ENABLE 0x0001 ///< The device signals its interrupts through MSI.
+#define PCI_MSI_FLAGS_QSIZE  0x0070 ///< The number of messages enabled.
+#define PCI_MSI_FLAGS_64BIT  0x0080 ///< The device has a 64-bit message address.
+/// @}
+
+/// @brief The address the MSI messages are written to, for the local APIC
+/// with the given identifier.
+#define PCI_MSI_ADDRESS(apic_id) (0xFEE00000U | ((uint32_t)(apic_id) << 12U))
+
 /// @brief Constant used when no PCI device is found.
 #define PCI_NONE 0xFFFF ///< No PCI device present.
 
 /// @brief PIC scan function.
 typedef int (*pci_scan_func_t)(uint32_t device, uint16_t vendor_id, uint16_t device_id, void *extra);
 
+#define PCI_MAX_DEVICES 64          ///< The maximum number of functions inside the table of the devices.
+#define PCI_ANY_ID      0xFFFFFFFFU ///< Matches any vendor, device, or type, inside a pci_device_id_t.
+
+/// @brief A function found while enumerating the buses at boot.
+typedef struct pci_dev {
+    /// The PCI device identifier (bus, slot, and function).
+    uint32_t device;
+    /// The vendor ID of the device.
+    uint16_t vendor_id;
+    /// The device ID of the device.
+    uint16_t device_id;
+    /// The type of the device (class, subclass, and programming interface).
+    uint32_t type;
+    /// The revision of the device.
+    uint8_t revision;
+    /// The header type, without the multi-function bit.
+    uint8_t header_type;
+    /// The interrupt line, as assigned by the firmware.
+    uint8_t irq_line;
+    /// The interrupt pin, 0 if the device uses none.
+    uint8_t irq_pin;
+    /// The base address registers, as programmed by the firmware.
+    uint32_t bar[6];
+    /// The virtual address of the configuration space, if mapped through ECAM.
+    uint32_t config;
+} pci_dev_t;
+
+/// @brief An entry of the table of the devices supported by a driver, the
+/// table ends with an entry whose vendor is 0.
+typedef struct pci_device_id {
+    uint32_t vendor_id; ///< The vendor ID, or PCI_ANY_ID.
+    uint32_t device_id; ///< The device ID, or PCI_ANY_ID.
+    uint32_t type;      ///< The type of the device, or PCI_ANY_ID.
+} pci_device_id_t;
+
 /// @brief Writes an 8-bit value to a PCI configuration register.
 /// @param device The 32-bit PCI device identifier (bus, slot, and function).
 /// @param field The PCI configuration register field to write to.
@@ -286,7 +351,31 @@ int pci_read_16(uint32_t device, uint32_t field, uint16_t *value);
 /// @return 0 on success, non-zero on error.
 int pci_read_32(uint32_t device, uint32_t field, uint32_t *value);
 
-/// @brief Scans for the given type of device.
+/// @brief Searches the table of the devices for one supported by a driver.
+/// @details The buses are enumerated only once, the first time the table is
+/// needed, all the searches after that never touch the configuration space.
+/// @param ids the devices supported by the driver.
+/// @param from the device to start after, NULL to start from the first one.
+/// @return the device, NULL if there are no more matching devices.
+const pci_dev_t *pci_find_device(const pci_device_id_t *ids, const pci_dev_t *from);
+
+/// @brief Returns the entry of the table of the devices for a function.
+/// @param device The PCI device identifier.
+/// @return the entry, NULL if the function was not found while enumerating.
+const pci_dev_t *pci_get_device(uint32_t device);
+
+/// @brief Accesses the configuration space through memory (ECAM), instead
+/// of the I/O ports, for the devices on the given buses.
+/// @details The base comes from the MCFG table of ACPI, and the configuration
+/// page of each device found while enumerating is mapped.
+/// @param base The physical address of the configuration space of bus start_bus.
+/// @param start_bus The first bus decoded by the region.
+/// @param end_bus The last bus decoded by the region.
+/// @return the number of devices now accessed through memory.
+int pci_enable_ecam(uint32_t base, uint8_t start_bus, uint8_t end_bus);
+
+/// @brief Calls a function for each device of the given type.
+/// @details It visits the table of the devices, see pci_find_device.
 /// @param f the function to call once we have found the device.
 /// @param type the type of device we are searching for.
 /// @param extra the extra arguemnts.
@@ -303,5 +392,30 @@ int pci_dump_device_data(uint32_t device, uint16_t vendor_id, uint16_t device_id
 /// @brief Prints all the devices connected to the PCI interfance.
 void pci_debug_scan(void);
 
+/// @brief Searches the capabilities of a PCI device.
+/// @param device The PCI device identifier.
+/// @param cap_id The ID of the capability (PCI_CAP_ID_*).
+/// @param[out] offset Where the offset of the capability is stored.
+/// @return 0 if the device has the capability, non-zero otherwise.
+int pci_find_capability(uint32_t device, uint8_t cap_id, uint8_t *offset);
+
+/// @brief Searches the capabilities of a PCI device, after the given one.
+/// @details A device can have more than one capability with the same ID
+/// (e.g., the vendor specific ones), this visits them in order.
+/// @param device The PCI device identifier.
+/// @param cap_id The ID of the capability (PCI_CAP_ID_*).
+/// @param start The offset of the capability to start after, 0 to start from the first one.
+/// @param[out] offset Where the offset of the capability is stored.
+/// @return 0 if the device has another such capability, non-zero otherwise.
+int pci_find_next_capability(uint32_t device, uint8_t cap_id, uint8_t start, uint8_t *offset);
+
+/// @brief Makes a PCI device signal its interrupts through MSI, with a
+/// single message, instead of its interrupt pin.
+/// @param device The PCI device identifier.
+/// @param vector The vector of the interrupt.
+/// @param apic_id The identifier of the local APIC receiving it.
+/// @return 0 on success, non-zero if the device has no MSI capability.
+int pci_enable_msi(uint32_t device, uint8_t vector, uint8_t apic_id);
+
 /// @}
 /// @}
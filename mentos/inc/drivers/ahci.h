@@ -0,0 +1,28 @@
+/// @file ahci.h
+/// @brief Driver for the Advanced Host Controller Interface (AHCI).
+/// @details
+/// AHCI is the native interface of SATA controllers. Unlike the legacy IDE
+///  interface, each port has its own list of up to 32 command slots, which the
+///  controller processes on its own, and drives supporting Native Command
+///  Queuing (NCQ) can have all of them in flight at the same time, serving
+///  them in the order which minimizes the movement of the heads.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+/// @addtogroup ahci Advanced Host Controller Interface (AHCI)
+/// @brief Driver for the Advanced Host Controller Interface (AHCI).
+/// @{
+
+#pragma once
+
+/// @brief Initializes the AHCI driver.
+/// @return 0 on success (even if there is no AHCI controller), 1 on error.
+int ahci_initialize(void);
+
+/// @brief De-initializes the AHCI driver.
+/// @return 0 on success, 1 on error.
+int ahci_finalize(void);
+
+/// @}
+/// @}
@@ -63,6 +63,8 @@ typedef enum {
     ata_dma_command_read_no_retry  = 0xC9, ///< Read DMA without retries (28 bit LBA).
     ata_dma_command_write          = 0xCA, ///< Write DMA with retries (28 bit LBA).
     ata_dma_command_write_no_retry = 0xCB, ///< Write DMA without retries (28 bit LBA).
+    ata_dma_command_read_ext       = 0x25, ///< Read DMA (48 bit LBA).
+    ata_dma_command_write_ext      = 0x35, ///< Write DMA (48 bit LBA).
 } ata_dma_command_t;
 
 /// @brief ATA identity commands.
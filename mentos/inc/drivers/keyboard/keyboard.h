@@ -11,6 +11,7 @@
 #pragma once
 
 #include "kernel.h"
+#include "process/wait.h"
 #include "ring_buffer.h"
 
 DECLARE_FIXED_SIZE_RING_BUFFER(int, keybuffer, 256, -1)
@@ -28,17 +29,17 @@ void keyboard_disable(void);
 /// @brief Leds handler.
 void keyboard_update_leds(void);
 
-/// @brief Gets and removes a char from the back of the buffer.
-/// @return The extracted character.
+/// @brief Gets and removes the oldest char of the buffer.
+/// @return The extracted character, -1 if the buffer is empty.
 int keyboard_pop_back(void);
 
-/// @brief Gets a char from the back of the buffer.
-/// @return The read character.
+/// @brief Gets the oldest char of the buffer.
+/// @return The read character, -1 if the buffer is empty.
 int keyboard_peek_back(void);
 
-/// @brief Gets a char from the front of the buffer.
-/// @return The read character.
-int keyboard_peek_front(void);
+/// @brief Returns the wait queue woken up each time a key is pressed.
+/// @return Pointer to the wait queue.
+wait_queue_head_t *keyboard_get_wait_queue(void);
 
 /// @brief Initializes the keyboard drivers.
 /// @return 0 on success, 1 on error.
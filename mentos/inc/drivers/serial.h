@@ -0,0 +1,28 @@
+/// @file serial.h
+/// @brief Driver of the 16550 UART of the first serial port.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+/// @addtogroup serial Serial port
+/// @brief Buffered, interrupt-driven, access to the first serial port.
+/// @{
+
+#pragma once
+
+#include "stddef.h"
+
+/// @brief Writes the given bytes to the serial port. They are queued, and
+/// sent by the interrupts of the port; before the driver is initialized,
+/// or with the interrupts disabled, they are written right away.
+/// @param buffer the bytes.
+/// @param size the amount of bytes.
+void serial_write(const char *buffer, size_t size);
+
+/// @brief Initializes the serial port, with its FIFOs and interrupts, and
+/// exposes it as `/dev/ttyS0`.
+/// @return 0 on success, 1 on error.
+int serial_initialize(void);
+
+/// @}
+/// @}
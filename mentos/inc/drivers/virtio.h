@@ -0,0 +1,115 @@
+/// @file virtio.h
+/// @brief The PCI interfaces, and the split virtqueues, shared by the virtio drivers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+
+#pragma once
+
+#include "mem/paging.h"
+#include "stdint.h"
+
+#define VIRTIO_PCI_VENDOR_ID 0x1AF4 ///< The vendor of the virtio devices.
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01 ///< The guest has noticed the device.
+#define VIRTIO_STATUS_DRIVER      0x02 ///< The guest knows how to drive the device.
+#define VIRTIO_STATUS_DRIVER_OK   0x04 ///< The driver is ready.
+#define VIRTIO_STATUS_FEATURES_OK 0x08 ///< The driver has acknowledged the features it understands.
+
+#define VIRTIO_F_VERSION_1 (1U << 0) ///< The device complies with virtio 1.0 (second word of the features).
+
+#define VIRTIO_PCI_HOST_FEATURES  0x00 ///< Legacy, features of the device (32 bits).
+#define VIRTIO_PCI_GUEST_FEATURES 0x04 ///< Legacy, features accepted by the driver (32 bits).
+#define VIRTIO_PCI_QUEUE_PFN      0x08 ///< Legacy, page frame of the selected queue (32 bits).
+#define VIRTIO_PCI_QUEUE_NUM      0x0C ///< Legacy, size of the selected queue (16 bits).
+#define VIRTIO_PCI_QUEUE_SEL      0x0E ///< Legacy, selects a queue (16 bits).
+#define VIRTIO_PCI_QUEUE_NOTIFY   0x10 ///< Legacy, notifies a queue (16 bits).
+#define VIRTIO_PCI_STATUS         0x12 ///< Legacy, device status (8 bits).
+#define VIRTIO_PCI_ISR            0x13 ///< Legacy, interrupt status, cleared when read (8 bits).
+#define VIRTIO_PCI_CONFIG         0x14 ///< Legacy, device specific configuration, without MSI-X.
+
+#define VIRTIO_PCI_CAP_COMMON_CFG 1 ///< Modern, the common configuration.
+#define VIRTIO_PCI_CAP_NOTIFY_CFG 2 ///< Modern, the notifications.
+#define VIRTIO_PCI_CAP_ISR_CFG    3 ///< Modern, the interrupt status.
+#define VIRTIO_PCI_CAP_DEVICE_CFG 4 ///< Modern, the device specific configuration.
+
+#define VIRTIO_PCI_CAP_CFG_TYPE    0x03 ///< Offset of the type of a capability (8 bits).
+#define VIRTIO_PCI_CAP_BAR         0x04 ///< Offset of the BAR of the region (8 bits).
+#define VIRTIO_PCI_CAP_OFFSET      0x08 ///< Offset of the offset of the region inside the BAR (32 bits).
+#define VIRTIO_PCI_CAP_LENGTH      0x0C ///< Offset of the length of the region (32 bits).
+#define VIRTIO_PCI_CAP_NOTIFY_MULT 0x10 ///< Offset of the notify offset multiplier (32 bits).
+
+#define VIRTQ_DESC_F_NEXT  1 ///< The buffer continues in the next descriptor.
+#define VIRTQ_DESC_F_WRITE 2 ///< The buffer is written by the device.
+
+/// @brief A descriptor of the virtqueue, a buffer the device reads or writes.
+typedef struct virtq_desc {
+    uint64_t addr;  ///< The physical address of the buffer.
+    uint32_t len;   ///< The length of the buffer.
+    uint16_t flags; ///< VIRTQ_DESC_F_* flags.
+    uint16_t next;  ///< The next descriptor of the chain, if VIRTQ_DESC_F_NEXT.
+} __attribute__((packed)) virtq_desc_t;
+
+/// @brief The available ring, where the driver places the chains for the device.
+typedef volatile struct virtq_avail {
+    uint16_t flags;  ///< Flags of the ring (we never suppress interrupts).
+    uint16_t idx;    ///< Where the driver places the next entry, modulo the size.
+    uint16_t ring[]; ///< The heads of the chains.
+} __attribute__((packed)) virtq_avail_t;
+
+/// @brief An entry of the used ring.
+typedef struct virtq_used_elem {
+    uint32_t id;  ///< The head of the chain which has been used.
+    uint32_t len; ///< The bytes written by the device.
+} __attribute__((packed)) virtq_used_elem_t;
+
+/// @brief The used ring, where the device places the chains it is done with.
+typedef volatile struct virtq_used {
+    uint16_t flags;           ///< Flags of the ring (notifications are never suppressed).
+    uint16_t idx;             ///< Where the device places the next entry, modulo the size.
+    virtq_used_elem_t ring[]; ///< The chains which have been used.
+} __attribute__((packed)) virtq_used_t;
+
+/// @brief The common configuration of the modern interface.
+typedef volatile struct virtio_pci_common_cfg {
+    uint32_t device_feature_select; ///< 0x00, selects a word of the features of the device.
+    uint32_t device_feature;        ///< 0x04, the selected word of the features of the device.
+    uint32_t driver_feature_select; ///< 0x08, selects a word of the features of the driver.
+    uint32_t driver_feature;        ///< 0x0C, the selected word of the features of the driver.
+    uint16_t msix_config;           ///< 0x10, MSI-X vector of the configuration changes.
+    uint16_t num_queues;            ///< 0x12, number of queues.
+    uint8_t device_status;          ///< 0x14, device status.
+    uint8_t config_generation;      ///< 0x15, changes when the configuration does.
+    uint16_t queue_select;          ///< 0x16, selects a queue.
+    uint16_t queue_size;            ///< 0x18, size of the selected queue.
+    uint16_t queue_msix_vector;     ///< 0x1A, MSI-X vector of the selected queue.
+    uint16_t queue_enable;          ///< 0x1C, enables the selected queue.
+    uint16_t queue_notify_off;      ///< 0x1E, notify offset of the selected queue.
+    uint32_t queue_desc_lo;         ///< 0x20, descriptor table, lower 32 bits.
+    uint32_t queue_desc_hi;         ///< 0x24, descriptor table, upper 32 bits.
+    uint32_t queue_driver_lo;       ///< 0x28, available ring, lower 32 bits.
+    uint32_t queue_driver_hi;       ///< 0x2C, available ring, upper 32 bits.
+    uint32_t queue_device_lo;       ///< 0x30, used ring, lower 32 bits.
+    uint32_t queue_device_hi;       ///< 0x34, used ring, upper 32 bits.
+} __attribute__((packed)) virtio_pci_common_cfg_t;
+
+/// @brief Returns the offset of the used ring of a virtqueue, which starts on
+/// the page following the descriptors and the available ring (as the legacy
+/// interface requires).
+/// @param size the size of the virtqueue.
+/// @return the offset from the descriptors.
+static inline uint32_t virtq_used_offset(uint16_t size)
+{
+    return (size * sizeof(virtq_desc_t) + sizeof(uint16_t) * (3 + size) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+}
+
+/// @brief Returns the memory taken by a virtqueue.
+/// @param size the size of the virtqueue.
+/// @return the size in bytes.
+static inline uint32_t virtq_total_size(uint16_t size)
+{
+    return virtq_used_offset(size) + sizeof(uint16_t) * 3 + size * sizeof(virtq_used_elem_t);
+}
+
+/// @}
@@ -0,0 +1,30 @@
+/// @file virtio_blk.h
+/// @brief Driver for the virtio block devices.
+/// @details
+/// A virtio block device is a paravirtualized disk: instead of emulating the
+///  registers of a real controller, which costs the hypervisor a trap for each
+///  access, the driver places its requests inside a ring in memory (the split
+///  virtqueue), and notifies the device once for a whole batch of them. The
+///  device serves them on its own, and raises an interrupt once they are done,
+///  so that many requests can be in flight at the same time. Both the legacy
+///  (I/O ports) and the modern (memory-mapped) PCI interfaces are supported.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+/// @addtogroup virtio_blk Virtio Block Devices
+/// @brief Driver for the virtio block devices.
+/// @{
+
+#pragma once
+
+/// @brief Initializes the virtio block driver.
+/// @return 0 on success (even if there is no virtio block device), 1 on error.
+int virtio_blk_initialize(void);
+
+/// @brief De-initializes the virtio block driver.
+/// @return 0 on success, 1 on error.
+int virtio_blk_finalize(void);
+
+/// @}
+/// @}
@@ -0,0 +1,29 @@
+/// @file virtio_net.h
+/// @brief Driver for the virtio network devices.
+/// @details
+/// The device has a receive and a transmit virtqueue. The receive one is kept
+///  full of page-sized buffers of the network stack: once the device has
+///  written a frame inside one of them, the page itself is handed over to the
+///  stack, and a fresh one takes its place in the ring, so that received data
+///  is never copied by the driver. Both the legacy (I/O ports) and the modern
+///  (memory-mapped) PCI interfaces are supported.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+/// @addtogroup virtio_net Virtio Network Devices
+/// @brief Driver for the virtio network devices.
+/// @{
+
+#pragma once
+
+/// @brief Initializes the virtio network driver, and registers the first device with the network stack.
+/// @return 0 on success (even if there is no virtio network device), 1 on error.
+int virtio_net_initialize(void);
+
+/// @brief De-initializes the virtio network driver.
+/// @return 0 on success, 1 on error.
+int virtio_net_finalize(void);
+
+/// @}
+/// @}
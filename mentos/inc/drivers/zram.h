@@ -0,0 +1,43 @@
+/// @file zram.h
+/// @brief Block device keeping its pages compressed in memory.
+/// @details
+/// The device is a RAM disk, /dev/zram0, whose pages are compressed with LZ4
+/// when they are written, and decompressed when they are read. Each page is
+/// held inside a slot: a page filled with a single repeated word is only
+/// recorded by its value, a page which compresses well is stored inside an
+/// object of the smallest fitting size class, each class being a slab cache
+/// of its own, and a page which does not is kept whole inside a page of its
+/// own. The device is created already formatted as a swap area, so that the
+/// cold pages of the processes can be swapped to it with `swapon /dev/zram0`,
+/// costing a fraction of their size and none of the latency of a disk; the
+/// slots given back by the swap are discarded, and their memory freed. The
+/// statistics of the device are found inside `/proc/zramstat`.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup drivers Device Drivers
+/// @{
+/// @addtogroup zram Compressed RAM Disk
+/// @brief Block device keeping its pages compressed in memory.
+/// @{
+
+#pragma once
+
+#include "stddef.h"
+#include "sys/types.h"
+
+/// @brief Initializes the compressed RAM disk.
+/// @return 0 on success, 1 on error.
+int zram_initialize(void);
+
+/// @brief Writes the statistics of the device, in the style of the
+/// `mm_stat` of Linux, with the following fields:
+///  name, size of the stored pages, size of their compressed data, memory
+///  used, pages filled with a single word, pages stored uncompressed, number
+///  of pages which could not be stored.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of written characters.
+ssize_t zram_stats_dump(char *buffer, size_t bufsize);
+
+/// @}
+/// @}
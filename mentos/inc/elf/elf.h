@@ -62,6 +62,13 @@
 
 /// @}
 
+/// @name Segment Flags
+/// @{
+#define PF_X 0x1 ///< The segment is executable.
+#define PF_W 0x2 ///< The segment is writable.
+#define PF_R 0x4 ///< The segment is readable.
+/// @}
+
 /// Elf header ident size.
 #define EI_NIDENT 16
 
@@ -0,0 +1,225 @@
+/// @file blkdev.h
+/// @brief Block I/O layer, with request queues and an elevator.
+/// @details
+/// Filesystems describe the transfers they need as bio_t structures, each one
+/// covering a run of consecutive sectors, and submit them to the request queue
+/// of the block device. Submitted bios are kept sorted by sector, and are
+/// dispatched in batches following a C-LOOK elevator: starting from the
+/// position of the last dispatched request, the queue is visited by increasing
+/// sector number, wrapping around to the lowest one. Bios which are adjacent
+/// on disk, and go in the same direction, are merged into a single request, so
+/// that the driver can serve them with a single command. Drivers of devices
+/// which can queue commands (e.g., with NCQ) can raise the depth of the queue,
+/// in which case up to `depth` requests are issued before waiting for them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/vfs_types.h"
+#include "klib/spinlock.h"
+#include "list_head.h"
+#include "stdbool.h"
+#include "stdint.h"
+
+/// The size of a sector, which is the unit of transfer of the block I/O layer.
+#define BLK_SECTOR_SIZE 512
+/// The maximum number of requests which can be in flight on a queue.
+#define BLK_MAX_DEPTH   32
+
+/// @brief A single block I/O operation.
+typedef struct bio {
+    /// The first sector of the transfer.
+    uint32_t sector;
+    /// The number of sectors to transfer.
+    uint32_t count;
+    /// The buffer we read into, or we write from.
+    uint8_t *buffer;
+    /// If the operation is a write (1) or a read (0).
+    int write;
+    /// The outcome of the operation, 0 on success, a negative errno otherwise.
+    int status;
+    /// Set when the operation has been completed.
+    bool_t done;
+    /// Optional callback called upon completion.
+    void (*end_io)(struct bio *bio);
+    /// Data for the completion callback.
+    void *private;
+    /// When the bio has been submitted, in timer ticks.
+    unsigned long submitted;
+    /// Used to place the bio inside the queue, or inside a request.
+    list_head_t list;
+} bio_t;
+
+/// @brief A set of adjacent bios, dispatched to the driver as a single command.
+typedef struct blk_request {
+    /// The first sector of the request.
+    uint32_t sector;
+    /// The total number of sectors of the request.
+    uint32_t count;
+    /// If the request is a write (1) or a read (0).
+    int write;
+    /// The outcome of the request, set by the driver upon completion.
+    int status;
+    /// When the request has been issued to the driver, in timer ticks.
+    unsigned long issued;
+    /// The list of bios, sorted by sector.
+    list_head_t bios;
+} blk_request_t;
+
+/// @brief Function used by the driver to serve a request.
+/// @param device the driver specific device.
+/// @param request the request, its bios are adjacent and go in the same direction.
+/// @return 0 on success, a negative errno on failure.
+typedef int (*blk_request_fn_t)(void *device, blk_request_t *request);
+
+/// @brief Function used by the driver to wait for the requests it has issued.
+/// @details Upon return, the driver has set the status of all the requests.
+/// @param device the driver specific device.
+typedef void (*blk_sync_fn_t)(void *device);
+
+/// @brief Function used by the driver to drop the content of sectors which
+/// are no longer in use, so that a device backed by memory can give it back.
+/// @param device the driver specific device.
+/// @param sector the first sector.
+/// @param count the number of sectors.
+typedef void (*blk_discard_fn_t)(void *device, uint32_t sector, uint32_t count);
+
+/// @brief The I/O statistics of a block device, indexed by direction (0 for
+/// reads, 1 for writes).
+typedef struct blk_stats {
+    /// Number of completed requests.
+    uint32_t ios[2];
+    /// Number of bios merged into other ones.
+    uint32_t merges[2];
+    /// Number of transferred sectors.
+    uint64_t sectors[2];
+    /// Time spent by the bios waiting inside the queue, in timer ticks.
+    unsigned long queue_ticks[2];
+    /// Time spent by the device serving the requests, in timer ticks.
+    unsigned long service_ticks[2];
+    /// Number of requests currently in flight.
+    uint32_t in_flight;
+} blk_stats_t;
+
+/// @brief The request queue of a block device.
+typedef struct request_queue {
+    /// The VFS file of the block device.
+    vfs_file_t *file;
+    /// The driver specific device.
+    void *device;
+    /// The function used to serve the requests.
+    blk_request_fn_t request_fn;
+    /// The function used to wait for the issued requests (NULL if the
+    /// request function serves the request before returning).
+    blk_sync_fn_t sync_fn;
+    /// The function used to discard sectors, NULL if the device keeps them.
+    blk_discard_fn_t discard_fn;
+    /// Maximum number of requests issued before waiting for them.
+    uint32_t depth;
+    /// Maximum number of sectors of a single request.
+    uint32_t max_sectors;
+    /// The sector following the last dispatched request (the head position).
+    uint32_t head_sector;
+    /// Pending bios, sorted by sector.
+    list_head_t pending;
+    /// Number of pending bios.
+    size_t num_pending;
+    /// Lock for the queue.
+    spinlock_t lock;
+    /// The I/O statistics of the device.
+    blk_stats_t stats;
+    /// Used to place the queue inside the list of queues.
+    list_head_t siblings;
+} request_queue_t;
+
+/// @brief Initializes the block I/O layer.
+/// @return 0 on success, 1 on error.
+int blkdev_initialize(void);
+
+/// @brief Initializes a request queue, and associates it with a block device.
+/// @param queue the queue to initialize.
+/// @param file the VFS file of the block device.
+/// @param device the driver specific device.
+/// @param request_fn the function used to serve the requests.
+/// @param max_sectors maximum number of sectors of a single request.
+/// @return 0 on success, -errno on failure.
+int blk_queue_init(
+    request_queue_t *queue,
+    vfs_file_t *file,
+    void *device,
+    blk_request_fn_t request_fn,
+    uint32_t max_sectors);
+
+/// @brief Allows the driver to have more than one request in flight.
+/// @param queue the queue.
+/// @param depth maximum number of requests in flight (at most BLK_MAX_DEPTH).
+/// @param sync_fn the function used to wait for the issued requests.
+/// @return 0 on success, -errno on failure.
+int blk_queue_set_depth(request_queue_t *queue, uint32_t depth, blk_sync_fn_t sync_fn);
+
+/// @brief Lets the users of the device tell the driver which sectors they no longer use.
+/// @param queue the queue.
+/// @param discard_fn the function used to discard sectors.
+/// @return 0 on success, -errno on failure.
+int blk_queue_set_discard(request_queue_t *queue, blk_discard_fn_t discard_fn);
+
+/// @brief Returns the request queue associated with a block device.
+/// @param file the VFS file of the block device.
+/// @return a pointer to the queue, NULL if the device has no queue.
+request_queue_t *blk_get_queue(vfs_file_t *file);
+
+/// @brief Allocates a bio.
+/// @param sector the first sector of the transfer.
+/// @param count the number of sectors to transfer.
+/// @param buffer the buffer we read into, or we write from.
+/// @param write if the operation is a write (1) or a read (0).
+/// @return a pointer to the bio, NULL on failure.
+bio_t *bio_alloc(uint32_t sector, uint32_t count, uint8_t *buffer, int write);
+
+/// @brief Frees a bio.
+/// @param bio the bio to free.
+void bio_free(bio_t *bio);
+
+/// @brief Adds a bio to the queue, without dispatching it.
+/// @param queue the queue.
+/// @param bio the bio to add.
+/// @return 0 on success, -errno on failure.
+int blk_submit_bio(request_queue_t *queue, bio_t *bio);
+
+/// @brief Dispatches all the pending bios of the queue.
+/// @param queue the queue.
+/// @return the number of requests sent to the driver.
+int blk_run_queue(request_queue_t *queue);
+
+/// @brief Tells the driver that the content of the sectors is no longer
+/// needed, the following reads of them return unspecified data. It does
+/// nothing if the driver cannot discard sectors.
+/// @param queue the queue.
+/// @param sector the first sector.
+/// @param count the number of sectors.
+void blk_discard(request_queue_t *queue, uint32_t sector, uint32_t count);
+
+/// @brief Accounts the start of a transfer which does not go through the
+/// queue (e.g., a plain read on the device file).
+/// @param queue the queue of the device.
+/// @return the current time, to be passed to blk_stats_done().
+unsigned long blk_stats_start(request_queue_t *queue);
+
+/// @brief Accounts the completion of a transfer started with blk_stats_start().
+/// @param queue the queue of the device.
+/// @param write if the transfer was a write (1) or a read (0).
+/// @param sectors the number of transferred sectors.
+/// @param start the value returned by blk_stats_start().
+void blk_stats_done(request_queue_t *queue, int write, uint32_t sectors, unsigned long start);
+
+/// @brief Writes the statistics of all the block devices, one line per device
+/// in the style of `/proc/diskstats`, with the following fields:
+///  name, reads completed, reads merged, sectors read, time spent reading (ms),
+///  writes completed, writes merged, sectors written, time spent writing (ms),
+///  requests in flight, time spent in service (ms), time spent in queue (ms).
+/// Reading and writing times include both the queue and the service time.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of characters written.
+ssize_t blk_stats_dump(char *buffer, size_t bufsize);
@@ -0,0 +1,22 @@
+/// @file initramfs.h
+/// @brief Unpacks a cpio archive, loaded by the bootloader as a module, into the filesystem.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "multiboot.h"
+
+/// @brief Searches the modules loaded by the bootloader for a cpio archive in
+///        the `newc` format, the one built by `cpio -H newc`.
+/// @return the module, NULL if there is none.
+multiboot_module_t *initramfs_find(void);
+
+/// @brief Unpacks the archive inside the given directory, which must exist.
+/// @details Directories, and regular files, are created with the permissions
+///          they have in the archive. Symbolic links are created only if the
+///          filesystem supports them, the other entries are skipped.
+/// @param module the module holding the archive, whose data follows the relocation.
+/// @param root the directory where the archive is unpacked.
+/// @return 0 on success, -errno on failure.
+int initramfs_unpack(multiboot_module_t *module, const char *root);
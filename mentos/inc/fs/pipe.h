@@ -5,35 +5,49 @@
 
 #pragma once
 
+#include "fs/vfs_types.h"
 #include "klib/mutex.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/wait.h"
 
-/// @brief This constant specifies the size of the buffer allocated for each
-/// pipe, and its value can affect the performance and capacity of pipes.
-// #define PIPE_BUFFER_SIZE PAGE_SIZE
-#define PIPE_BUFFER_SIZE 64
+/// @brief This constant specifies the size of each buffer of a pipe, which is
+/// backed by a whole page.
+#define PIPE_BUFFER_SIZE PAGE_SIZE
 
-/// @brief The number of buffers.
-#define PIPE_NUM_BUFFERS 5
+/// @brief The number of buffers of a new pipe (64 KiB), always a power of two.
+#define PIPE_DEF_BUFFERS 16
+
+/// @brief The maximum number of buffers of a pipe (1 MiB), see F_SETPIPE_SZ.
+#define PIPE_MAX_BUFFERS 256
+
+/// @brief The buffer does not accept more data, because its page is shared
+/// with another pipe, or because a page has been spliced after it.
+#define PIPE_BUF_FLAG_SEALED 0x01
 
 /// @brief Represents a single buffer within a pipe. This structure manages the
 /// data stored in the buffer, including its memory location, size, usage count,
 /// and associated operations.
 typedef struct pipe_buffer {
-    /// @brief The buffer's data.
-    char data[PIPE_BUFFER_SIZE];
+    /// @brief The page holding the buffer's data, allocated on the first write.
+    page_t *page;
+
+    /// @brief The buffer's data, which is the address of the page.
+    char *data;
 
-    /// @brief Offset within the memory page where the buffer's data begins.
-    /// This allows for partial usage of the page if the buffer does not occupy
-    /// the entire page.
+    /// @brief Offset within the memory page where the unread data begins. It
+    /// is only advanced by the reader.
     size_t offset;
 
-    /// @brief Length of the data currently stored in the buffer. This indicates
-    /// the amount of data that the buffer holds and can be used during read and
-    /// write operations.
+    /// @brief Length of the data written into the page so far, the unread data
+    /// lies between `offset` and `len`. It is only advanced by the writer.
     size_t len;
 
+    /// @brief Flags of the buffer (PIPE_BUF_FLAG_*), set by the writer. A
+    /// page is shared by incrementing its counter, see tee() and splice().
+    unsigned int flags;
+
     /// @brief Pointer to a set of operations that can be performed on the
     /// buffer. These operations include functions for getting, releasing, and
     /// mapping the buffer, tailored to the specific needs of the buffer's data
@@ -46,19 +60,23 @@ typedef struct pipe_buffer {
 /// information about the buffer used for the pipe, the readers and writers, and
 /// synchronization details.
 typedef struct pipe_inode_info {
-    /// @brief Array of pipe buffers. Each buffer holds a portion of data for
-    /// the pipe. For the time beeing I'm setting a fixed number of buffers.
-    pipe_buffer_t bufs[PIPE_NUM_BUFFERS];
+    /// @brief Ring of pipe buffers. Each buffer holds a portion of data for
+    /// the pipe.
+    pipe_buffer_t *bufs;
 
     /// @brief Number of buffers allocated for the pipe. This value determines
-    /// the size of the `bufs` array and how many buffers are available for use.
+    /// the size of the `bufs` array, and can be changed through F_SETPIPE_SZ.
+    /// It is a power of two, so that the ring indices can wrap around.
     size_t numbuf;
 
-    /// @brief Index for reading.
-    size_t read_index;
+    /// @brief Ring index past the last buffer in use, only advanced by the
+    /// writer. It writes into the last buffer, or into the next one once it is
+    /// full.
+    size_t head;
 
-    /// @brief Index for writing.
-    size_t write_index;
+    /// @brief Ring index of the first buffer in use, only advanced by the
+    /// reader, once the buffer has been filled and drained.
+    size_t tail;
 
     /// @brief The number of processes currently reading from the pipe.
     size_t readers;
@@ -66,6 +84,13 @@ typedef struct pipe_inode_info {
     /// @brief The number of processes currently writing to the pipe.
     size_t writers;
 
+    /// @brief The number of times the read end has been opened, so that a
+    /// writer waiting inside open() notices a reader which came and went.
+    size_t r_counter;
+
+    /// @brief The number of times the write end has been opened, see `r_counter`.
+    size_t w_counter;
+
     /// @brief Wait queue for processes that are blocked waiting to read from
     /// the pipe. This queue helps manage process scheduling and
     /// synchronization.
@@ -77,11 +102,18 @@ typedef struct pipe_inode_info {
     wait_queue_head_t write_wait;
 
     /// @brief Mutex for protecting access to the pipe structure and ensuring
-    /// thread-safe operations. This prevents race conditions when multiple
-    /// processes or threads interact with the pipe.
+    /// thread-safe operations. The ring is safe with a single reader and a
+    /// single writer, so it is only taken when there are several of them.
     mutex_t mutex;
 
-    /// @brief List node for tracking this pipe in a process’s list of opened
+    /// @brief The filesystem of the named pipe this pipe belongs to, NULL for
+    /// anonymous pipes.
+    void *fifo_device;
+
+    /// @brief The inode of the named pipe this pipe belongs to.
+    ino_t fifo_ino;
+
+    /// @brief List node for tracking this pipe in the list of opened named
     /// pipes.
     list_head_t list_node;
 } pipe_inode_info_t;
@@ -108,6 +140,22 @@ typedef struct pipe_buf_operations {
 
 } pipe_buf_operations_t;
 
+/// @brief Creates an anonymous pipe, without installing its ends on file
+/// descriptors, so that other kernel objects can be built on top of it.
+/// @param files Where the read end, and the write end, are stored.
+/// @return 0 on success, -ENOMEM on failure.
+int pipe_create_files(vfs_file_t *files[2]);
+
+/// @brief Opens a named pipe, the inode of a filesystem only gives it a name,
+/// while the data flows through a pipe shared by all the tasks opening it.
+/// @param device The filesystem of the inode.
+/// @param ino The inode of the named pipe.
+/// @param flags The open flags, a blocking open waits for the other end.
+/// @param mode The permissions of the named pipe.
+/// @return The file of the requested end, NULL on failure and errno is set
+/// (ENXIO when opening the write end in non-blocking mode without readers).
+vfs_file_t *pipe_open_fifo(void *device, ino_t ino, int flags, mode_t mode);
+
 /// @brief Updates readers and writers counts for pipes.
 /// @param task Pointer to the new task's `task_struct`.
 /// @param old_task Pointer to the old task's `task_struct`.
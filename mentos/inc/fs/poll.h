@@ -0,0 +1,68 @@
+/// @file poll.h
+/// @brief Readiness multiplexing over VFS files (poll, select and epoll).
+/// @details
+/// The task is placed on the wait queues of all the files it is polling, and
+/// it sleeps inside the kernel until one of them, or the timeout, wakes it up;
+/// then, the files are checked again. The wait queues and the timeout are kept
+/// in a poll table owned by the task, so that the timeout keeps running across
+/// the checks, and it is released as soon as the call returns.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "hardware/timer.h"
+#include "list_head.h"
+#include "sys/poll.h"
+#include "process/wait.h"
+#include "stdbool.h"
+
+struct task_struct;
+
+/// @brief The wait queues a task is polling on, and its timeout.
+typedef struct poll_table {
+    /// The task which is polling.
+    struct task_struct *task;
+    /// The wait queues the task has been added to (poll_entry_t).
+    list_head_t entries;
+    /// The timer which wakes up the task when the timeout expires.
+    struct timer_list *timer;
+    /// If the task went to sleep, and we are waiting for it to be woken up.
+    bool_t armed;
+    /// If the timeout has expired.
+    bool_t timed_out;
+    /// If poll_wait() must add the task to the wait queues.
+    bool_t registering;
+} poll_table_t;
+
+/// @brief Called by the poll function of a file, for each of its wait queues
+/// which might report the events of the file.
+/// @param head the wait queue.
+/// @param table the poll table received by the poll function (can be NULL).
+void poll_wait(wait_queue_head_t *head, poll_table_t *table);
+
+/// @brief Wakes up all the tasks polling on a wait queue, without removing
+/// them from it.
+/// @param head the wait queue.
+void poll_wake_up(wait_queue_head_t *head);
+
+/// @brief Prepares the poll table of the current task, at the beginning of a
+/// poll-like system call.
+/// @param timeout the timeout of the call, in milliseconds (negative waits forever).
+/// @return the poll table, to be passed to the poll functions of the files, or
+/// NULL on failure.
+poll_table_t *poll_table_begin(int timeout);
+
+/// @brief Ends a poll-like system call, putting the task to sleep if nothing is ready.
+/// @param table the poll table returned by poll_table_begin().
+/// @param ready the number of ready files.
+/// @param timeout the timeout of the call, in milliseconds (negative waits forever).
+/// @return `ready` if the call must return, -EINTR if a signal interrupted the
+/// sleep, -EAGAIN if the task has been woken up, and the files must be checked
+/// again, starting from poll_table_begin().
+int poll_table_end(poll_table_t *table, int ready, int timeout);
+
+/// @brief Removes the task from all the wait queues it is polling on, and
+/// frees its poll table.
+/// @param task the task.
+void poll_table_release(struct task_struct *task);
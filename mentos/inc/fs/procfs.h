@@ -68,7 +68,17 @@ int proc_entry_set_mask(proc_dir_entry_t *entry, mode_t mask);
 /// @return 0 if succeed, or -errno in case of error.
 int procr_create_entry_pid(task_struct *entry);
 
-/// @brief Destroy the entire procfs entry tree for the give process.
+/// @brief Destroy the entire procfs entry tree for the give process, if it was created.
 /// @param entry Pointer to the task_struct of the process.
 /// @return 0 if succeed, or -errno in case of error.
 int procr_destroy_entry_pid(task_struct *entry);
+
+/// @brief Creates on demand the procfs entry tree of the process which owns
+///        the given path (e.g., `/proc/<PID>/stat`), when it is looked up.
+/// @param path The absolute path.
+/// @return 0 if the tree was created, or -errno if there was nothing to create.
+int procr_create_entry_path(const char *path);
+
+/// @brief Creates on demand the procfs entry trees of all the processes, when
+///        `/proc` is listed.
+void procr_create_entries(void);
@@ -0,0 +1,102 @@
+/// @file seq_file.h
+/// @brief Streaming of the content of virtual files, one record at a time.
+/// @details
+/// The content of a file is produced by an iterator over its records (e.g.,
+/// the lines of a table): `start` returns the record at a position, `show`
+/// formats it, `next` moves to the following one, and `stop` ends the
+/// iteration. The records are formatted into a buffer which belongs to the
+/// open file, and which starts as a page and doubles whenever a single record
+/// does not fit. Consecutive reads are served from the buffer, and only the
+/// records which have not been formatted yet are visited; a read at another
+/// offset starts again from the first record.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/vfs_types.h"
+
+/// @brief The streaming state of an open file.
+typedef struct seq_file seq_file_t;
+
+/// @brief The iterator over the records of a file.
+typedef struct seq_operations {
+    /// Returns the record at the given position, or NULL past the last one.
+    void *(*start)(seq_file_t *m, off_t *pos);
+    /// Stops the iteration, with the record it stopped at (or NULL).
+    void (*stop)(seq_file_t *m, void *v);
+    /// Returns the record which follows the given one, and advances the position.
+    void *(*next)(seq_file_t *m, void *v, off_t *pos);
+    /// Formats the record, with seq_printf(); returns 0 on success, -errno on failure.
+    int (*show)(seq_file_t *m, void *v);
+} seq_operations_t;
+
+/// @brief The streaming state of an open file.
+struct seq_file {
+    /// The buffer of the formatted records.
+    char *buf;
+    /// The size of the buffer.
+    size_t size;
+    /// The number of formatted bytes inside the buffer.
+    size_t count;
+    /// The first byte of the buffer which has not been read yet.
+    size_t from;
+    /// The position of the next record to format.
+    off_t index;
+    /// The offset in the file of the first byte which has not been read yet.
+    off_t read_pos;
+    /// The iterator over the records.
+    const seq_operations_t *op;
+    /// The function formatting the content, for the files made of a single record.
+    int (*single_show)(seq_file_t *m, void *v);
+    /// The open file.
+    vfs_file_t *file;
+};
+
+/// @brief Reads the content of a file, formatted by the given iterator.
+/// @param file The open file, which owns the streaming state.
+/// @param op The iterator over the records.
+/// @param buf The buffer where the content is placed.
+/// @param offset The offset from which we start reading.
+/// @param nbyte The number of bytes to read.
+/// @return The number of bytes read, or -errno on failure.
+ssize_t seq_read(vfs_file_t *file, const seq_operations_t *op, char *buf, off_t offset, size_t nbyte);
+
+/// @brief Reads the content of a file which is made of a single record.
+/// @param file The open file, which owns the streaming state.
+/// @param show The function formatting the whole content, which receives NULL as record.
+/// @param buf The buffer where the content is placed.
+/// @param offset The offset from which we start reading.
+/// @param nbyte The number of bytes to read.
+/// @return The number of bytes read, or -errno on failure.
+ssize_t seq_read_single(vfs_file_t *file, int (*show)(seq_file_t *, void *), char *buf, off_t offset, size_t nbyte);
+
+/// @brief Releases the streaming state of a file, when it is closed.
+/// @param file The open file.
+/// @return 0.
+int seq_release(vfs_file_t *file);
+
+/// @brief Appends formatted text to the buffer of the file.
+/// @param m The streaming state.
+/// @param format The format string.
+/// @param ... The arguments of the format.
+/// @return 0 on success, -1 if the text does not fit (the record is formatted
+///         again once the buffer has grown).
+int seq_printf(seq_file_t *m, const char *format, ...);
+
+/// @brief Appends a string to the buffer of the file.
+/// @param m The streaming state.
+/// @param s The string.
+/// @return 0 on success, -1 if the string does not fit.
+int seq_puts(seq_file_t *m, const char *s);
+
+/// @brief Returns the free space of the buffer, to format a record in place.
+/// @param m The streaming state.
+/// @param size Where the size of the free space is stored.
+/// @return The first free byte of the buffer.
+char *seq_get_buf(seq_file_t *m, size_t *size);
+
+/// @brief Accounts the bytes formatted in place, after seq_get_buf().
+/// @param m The streaming state.
+/// @param length The number of bytes, a negative value if they did not fit.
+void seq_commit(seq_file_t *m, int length);
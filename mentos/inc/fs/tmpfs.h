@@ -0,0 +1,14 @@
+/// @file tmpfs.h
+/// @brief Temporary file system, which keeps its files inside memory pages.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @brief Initialize the tmpfs filesystem.
+/// @return 0 on success, 1 on failure.
+int tmpfs_module_init(void);
+
+/// @brief Clean up the tmpfs filesystem.
+/// @return 0 on success, 1 on failure.
+int tmpfs_cleanup_module(void);
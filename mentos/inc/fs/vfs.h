@@ -9,8 +9,10 @@
 #include "mem/alloc/slab.h"
 #include "os_root_path.h"
 
-/// Maximum number of opened file.
+/// Initial number of file descriptors of a process.
 #define MAX_OPEN_FD 16
+/// Maximum number of file descriptors of a process.
+#define MAX_TASK_FD 1024
 
 /// @brief Forward declaration of task_struct.
 /// Used for task management in the VFS.
@@ -65,6 +67,8 @@ int vfs_register_superblock(const char *name, const char *path, file_system_type
 int vfs_unregister_superblock(super_block_t *sb);
 
 /// @brief Searches for the mountpoint of the given path.
+/// @details Paths are matched component by component, the deepest mount point
+/// wins, and among superblocks mounted on the same path the most recent one.
 /// @param absolute_path Path for which we want to search the mountpoint.
 /// @return Pointer to the super_block_t of the mountpoint, or NULL if not found.
 super_block_t *vfs_get_superblock(const char *absolute_path);
@@ -73,6 +77,14 @@ super_block_t *vfs_get_superblock(const char *absolute_path);
 /// @param log_level Logging level to use for the output.
 void vfs_dump_superblocks(int log_level);
 
+/// @brief Writes the registered superblocks, in the style of `/proc/mounts`:
+///  one line for each of them, with its name, its path, the name of its
+///  filesystem, the mount options, and two zeros for dump and fsck.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of characters written.
+ssize_t vfs_mounts_dump(char *buffer, size_t bufsize);
+
 /// @brief Open a file given its absolute path.
 /// @param absolute_path An absolute path to the file.
 /// @param flags Used to set the file status flags and access modes.
@@ -109,6 +121,46 @@ ssize_t vfs_read(vfs_file_t *file, void *buf, size_t offset, size_t nbytes);
 /// @return The number of written characters.
 ssize_t vfs_write(vfs_file_t *file, const void *buf, size_t offset, size_t nbytes);
 
+/// @brief        Read data from a file into multiple buffers.
+/// @param file   The file structure used to reference a file.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset from which the function starts to read.
+/// @return The number of read characters, -errno on failure.
+ssize_t vfs_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset);
+
+/// @brief        Write data to a file from multiple buffers.
+/// @param file   The file structure used to reference a file.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset from which the function starts to write.
+/// @return The number of written characters, -errno on failure.
+ssize_t vfs_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset);
+
+/// @brief        Read data from a file into multiple buffers, for a descriptor
+///               opened with O_DIRECT, bypassing the caches if the filesystem can.
+/// @param file   The file structure used to reference a file.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset from which the function starts to read.
+/// @return The number of read characters, -errno on failure.
+ssize_t vfs_readv_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset);
+
+/// @brief        Write data to a file from multiple buffers, for a descriptor
+///               opened with O_DIRECT, bypassing the caches if the filesystem can.
+/// @param file   The file structure used to reference a file.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset from which the function starts to write.
+/// @return The number of written characters, -errno on failure.
+ssize_t vfs_writev_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset);
+
+/// @brief       Checks which I/O operations can be performed without blocking.
+/// @param file  The file structure used to reference a file.
+/// @param table The poll table, used to wait for the file (can be NULL).
+/// @return A mask of POLL* events, files without a poll function are always ready.
+unsigned int vfs_poll(vfs_file_t *file, struct poll_table *table);
+
 /// @brief Repositions the file offset inside a file.
 /// @param file   The file for which we reposition the offest.
 /// @param offset The offest to use for the operation.
@@ -119,6 +171,31 @@ ssize_t vfs_write(vfs_file_t *file, const void *buf, size_t offset, size_t nbyte
 /// indicate the error.
 off_t vfs_lseek(vfs_file_t *file, off_t offset, int whence);
 
+/// @brief Flushes the buffered data of a file to the underlying device.
+/// @param file The file we want to synchronize.
+/// @return 0 on success, -errno on failure.
+int vfs_fsync(vfs_file_t *file);
+
+/// @brief Announces how a range of a file is going to be accessed: the access
+///        pattern steers the read-ahead of the file, and the filesystem reads
+///        the range ahead, or drops it from its caches.
+/// @param file The file.
+/// @param offset The start of the range.
+/// @param len The length of the range, 0 to reach the end of the file.
+/// @param advice One of the POSIX_FADV_* values.
+/// @return 0 on success, -errno on failure.
+int vfs_fadvise(vfs_file_t *file, off_t offset, off_t len, int advice);
+
+/// @brief Changes the size of a file.
+/// @param file The file.
+/// @param length The new size, the bytes the file gains read as zero.
+/// @return 0 on success, -errno on failure.
+int vfs_truncate(vfs_file_t *file, off_t length);
+
+/// @brief Flushes the buffered data of all the mounted filesystems.
+/// @return 0 on success, -errno on failure.
+int vfs_sync(void);
+
 /// Provide access to the directory entries.
 /// @param file  The directory for which we accessing the entries.
 /// @param dirp  The buffer where de data should be placed.
@@ -155,6 +232,13 @@ int vfs_unlink(const char *path);
 /// @return Returns a negative value on failure.
 int vfs_mkdir(const char *path, mode_t mode);
 
+/// @brief Creates a special file at the given path.
+/// @param path The path of the new file.
+/// @param mode The type and the permission of the new file.
+/// @param dev The device number, for device special files.
+/// @return Returns a negative value on failure.
+int vfs_mknod(const char *path, mode_t mode, dev_t dev);
+
 /// @brief Removes the given directory.
 /// @param path The path to the directory to remove.
 /// @return Returns a negative value on failure.
@@ -176,8 +260,8 @@ vfs_file_t *vfs_creat(const char *path, mode_t mode);
 ssize_t vfs_readlink(const char *path, char *buffer, size_t bufsize);
 
 /// @brief Creates a symbolic link.
-/// @param linkname the name of the link.
-/// @param path the entity it is linking to.
+/// @param linkname the target of the link, the entity it is linking to.
+/// @param path the path of the new link.
 /// @return 0 on success, a negative number if fails and errno is set.
 int vfs_symlink(const char *linkname, const char *path);
 
@@ -187,6 +271,21 @@ int vfs_symlink(const char *linkname, const char *path);
 /// @return 0 on success, -errno on failure.
 int vfs_stat(const char *path, stat_t *buf);
 
+/// @brief Builds the absolute path of an entry, relative to an open directory.
+/// @param directory The directory, which relative paths start from.
+/// @param path The path of the entry, if absolute the directory is ignored.
+/// @param buffer The buffer where the absolute path is stored.
+/// @param buflen The size of the buffer.
+/// @return 0 on success, -errno on failure.
+int vfs_path_at(vfs_file_t *directory, const char *path, char *buffer, size_t buflen);
+
+/// @brief Stat the file at the given path, relative to an open directory.
+/// @param directory The directory, which relative paths start from.
+/// @param path Path to the file for which we are retrieving the statistics.
+/// @param buf  Buffer where we are storing the statistics.
+/// @return 0 on success, -errno on failure.
+int vfs_fstatat(vfs_file_t *directory, const char *path, stat_t *buf);
+
 /// @brief Stat the given file.
 /// @param file Pointer to the file for which we are retrieving the statistics.
 /// @param buf  Buffer where we are storing the statistics.
@@ -197,8 +296,9 @@ int vfs_fstat(vfs_file_t *file, stat_t *buf);
 /// @param type The type of filesystem
 /// @param path The path to where it should be mounter.
 /// @param args The arguments passed to the filesystem mount callback.
+/// @param options The mount options, separated by commas (e.g., `noatime,lazytime`), NULL for the defaults.
 /// @return 0 on success, a negative number if fails and errno is set.
-int vfs_mount(const char *type, const char *path, const char *args);
+int vfs_mount(const char *type, const char *path, const char *args, const char *options);
 
 /// @brief Locks the access to the given file.
 /// @param file The file to lock.
@@ -220,15 +320,35 @@ int vfs_init_task(struct task_struct *task);
 /// @return 0 on fail, 1 on success.
 int vfs_dup_task(struct task_struct *new_task, struct task_struct *old_task);
 
-/// @brief Destroy the file descriptor list for the given task.
+/// @brief Makes new_task share the file descriptor list of old_task (see CLONE_FILES).
+/// @param new_task The task which shares the file descriptor list.
+/// @param old_task The task owning the file descriptor list.
+/// @return 0 on fail, 1 on success.
+int vfs_share_task(struct task_struct *new_task, struct task_struct *old_task);
+
+/// @brief Destroy the file descriptor list for the given task, once the
+///        last task sharing it is destroyed.
 /// @param task The task for which we destroy the file descriptor list.
 /// @return 0 on fail, 1 on success.
 int vfs_destroy_task(struct task_struct *task);
 
 /// @brief Find the smallest available fd.
+/// @details The fd is not reserved, until a file is installed with fd_install().
 /// @return -errno on fail, fd on success.
 int get_unused_fd(void);
 
+/// @brief Installs a file on a file descriptor of the given task.
+/// @param task The task.
+/// @param fd The file descriptor, usually returned by get_unused_fd().
+/// @param file The file.
+/// @param flags The flags of the file descriptor.
+void fd_install(struct task_struct *task, int fd, vfs_file_t *file, int flags);
+
+/// @brief Removes the file from a file descriptor of the given task, without closing it.
+/// @param task The task.
+/// @param fd The file descriptor.
+void fd_release(struct task_struct *task, int fd);
+
 /// @brief Return new smallest available file desriptor.
 /// @param fd the descriptor of the file we want to duplicate.
 /// @return -errno on fail, fd on success.
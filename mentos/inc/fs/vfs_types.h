@@ -7,14 +7,21 @@
 
 #include "bits/stat.h"
 #include "dirent.h"
+#include "klib/rcu.h"
 #include "list_head.h"
 #include "stdint.h"
+#include "sys/uio.h"
 
 #define PATH_SEPARATOR        '/'  ///< The character used as path separator.
 #define PATH_SEPARATOR_STRING "/"  ///< The string used as path separator.
 #define PATH_UP               ".." ///< The path to the parent.
 #define PATH_DOT              "."  ///< The path to the current directory.
 
+/// @brief Forward declaration of the poll table, defined in fs/poll.h.
+struct poll_table;
+/// @brief Forward declaration of the page descriptor, defined in mem/mm/page.h.
+struct page;
+
 /// @brief Data structure containing attributes of a file.
 struct iattr {
     /// Validity check on iattr struct.
@@ -39,8 +46,8 @@ typedef struct file_system_type {
     const char *name;
     /// Flags of the filesystem.
     int fs_flags;
-    /// Mount function.
-    struct vfs_file *(*mount)(const char *, const char *);
+    /// Mount function, it receives the path, the device and the options.
+    struct vfs_file *(*mount)(const char *, const char *, const char *);
     /// List head for linking filesystem types.
     struct list_head list;
 } file_system_type_t;
@@ -59,6 +66,8 @@ typedef struct vfs_sys_operations {
     int (*symlink_f)(const char *, const char *);
     /// Modifies the attributes of a filesystem entry.
     int (*setattr_f)(const char *, struct iattr *);
+    /// Creates a special file, e.g., a named pipe.
+    int (*mknod_f)(const char *, mode_t, dev_t);
 } vfs_sys_operations_t;
 
 /// @brief Set of functions used to perform operations on files.
@@ -77,6 +86,9 @@ typedef struct vfs_file_operations {
     off_t (*lseek_f)(struct vfs_file *, off_t, int);
     /// Retrieves status information of an open file.
     int (*stat_f)(struct vfs_file *, stat_t *);
+    /// Retrieves status information of an entry of an open directory, found by
+    /// its name starting from the directory (optional).
+    int (*statat_f)(struct vfs_file *, const char *, stat_t *);
     /// Performs an ioctl operation on a file.
     long (*ioctl_f)(struct vfs_file *, unsigned int, unsigned long);
     /// Performs a fcntl operation on a file.
@@ -87,12 +99,72 @@ typedef struct vfs_file_operations {
     ssize_t (*readlink_f)(const char *, char *, size_t);
     /// Modifies the attributes of an open file.
     int (*setattr_f)(struct vfs_file *, struct iattr *);
+    /// Flushes the buffered data of a file to the underlying device.
+    int (*fsync_f)(struct vfs_file *);
+    /// Reads data from a file into multiple buffers (optional, read_f is used otherwise).
+    ssize_t (*readv_f)(struct vfs_file *, const struct iovec *, int, off_t);
+    /// Writes data to a file from multiple buffers (optional, write_f is used otherwise).
+    ssize_t (*writev_f)(struct vfs_file *, const struct iovec *, int, off_t);
+    /// Reports the readiness of a file, and registers the caller on its wait queues (optional).
+    unsigned int (*poll_f)(struct vfs_file *, struct poll_table *);
+    /// Changes the size of a file, zero-filling the bytes it gains (optional).
+    int (*truncate_f)(struct vfs_file *, off_t);
+    /// Returns the page holding the content of a file at the given offset, with
+    /// a reference taken for the caller, which the shared mappings of the file
+    /// use in place of the page cache (optional).
+    struct page *(*get_page_f)(struct vfs_file *, uint32_t);
+    /// Reads a range of a file ahead, or drops it from the caches, following
+    /// the advice given through posix_fadvise() (optional).
+    int (*fadvise_f)(struct vfs_file *, off_t, off_t, int);
+    /// Reads data from a file into multiple buffers, bypassing the caches, for
+    /// the descriptors opened with O_DIRECT (optional, readv_f is used otherwise).
+    ssize_t (*readv_direct_f)(struct vfs_file *, const struct iovec *, int, off_t);
+    /// Writes data to a file from multiple buffers, bypassing the caches, for
+    /// the descriptors opened with O_DIRECT (optional, writev_f is used otherwise).
+    ssize_t (*writev_direct_f)(struct vfs_file *, const struct iovec *, int, off_t);
 } vfs_file_operations_t;
 
+/// @brief Read-ahead state of an open file.
+typedef struct vfs_file_ra {
+    /// The offset we expect for the next sequential read.
+    off_t next;
+    /// The size of the read-ahead window, in blocks (0 after a random access).
+    uint32_t window;
+    /// The offset of the data held by the buffer.
+    off_t start;
+    /// The amount of valid data inside the buffer.
+    size_t size;
+    /// The buffer holding the data we read ahead (owned by the file).
+    char *buffer;
+    /// The access pattern announced through posix_fadvise() (POSIX_FADV_NORMAL by default).
+    int advice;
+} vfs_file_ra_t;
+
+/// @brief Preallocation window of an open file, a run of consecutive blocks
+/// already reserved on the device, which the file takes as it grows.
+typedef struct vfs_file_prealloc {
+    /// The first block of the window.
+    uint32_t start;
+    /// The number of blocks left inside the window.
+    uint32_t count;
+} vfs_file_prealloc_t;
+
+/// @brief Read position of an open directory, which lets getdents resume
+/// from where the previous call stopped.
+typedef struct vfs_file_dirpos {
+    /// The getdents offset the position refers to.
+    off_t doff;
+    /// The offset of the next entry inside the directory.
+    uint32_t offset;
+} vfs_file_dirpos_t;
+
 /// @brief Data structure that contains information about the mounted filesystems.
 typedef struct vfs_file {
     /// The filename.
     char name[NAME_MAX];
+    /// The absolute path the file was first opened with, NULL if it was not
+    /// opened through a path (e.g., a pipe).
+    char *path;
     /// Device object (optional).
     void *device;
     /// The permissions mask.
@@ -131,6 +203,14 @@ typedef struct vfs_file {
     list_head_t siblings;
     /// Reference count for this file.
     int32_t refcount;
+    /// Read-ahead state, used by filesystems on top of block devices.
+    vfs_file_ra_t ra;
+    /// Preallocation window, used by filesystems on top of block devices.
+    vfs_file_prealloc_t prealloc;
+    /// Directory read position, used by filesystems to resume getdents.
+    vfs_file_dirpos_t dirpos;
+    /// The streaming state of a virtual file (see seq_file.h), NULL until it is read.
+    struct seq_file *seq;
 } vfs_file_t;
 
 /// @brief A structure that represents an instance of a filesystem, i.e., a mounted filesystem.
@@ -145,6 +225,12 @@ typedef struct super_block {
     file_system_type_t *type;
     /// List to hold all active mounting points.
     list_head_t mounts;
+    /// The node of the mount tree the superblock is mounted on.
+    struct vfs_mount_node *mountpoint;
+    /// Used to stack the superblocks mounted on the same path, the most recent first.
+    list_head_t stacked;
+    /// Frees the superblock, once the lookups which might see it have finished.
+    rcu_head_t rcu;
 } super_block_t;
 
 /// @brief Data structure containing information about an open file.
@@ -155,6 +241,20 @@ typedef struct vfs_file_descriptor {
     int flags_mask;
 } vfs_file_descriptor_t;
 
+/// @brief The file descriptors of a task, shared by the threads created with CLONE_FILES.
+typedef struct files_struct {
+    /// The number of tasks sharing the file descriptors.
+    int count;
+    /// The current opened file descriptors
+    vfs_file_descriptor_t *fd_list;
+    /// The maximum supported number of file descriptors
+    int max_fd;
+    /// Bitmap of the open file descriptors, one bit for each entry of `fd_list`.
+    uint32_t *fd_bitmap;
+    /// All the file descriptors below this one are open.
+    int fd_next;
+} files_struct_t;
+
 #define ATTR_MODE  (1 << 0) ///< Flag set to specify the validity of MODE.
 #define ATTR_UID   (1 << 1) ///< Flag set to specify the validity of UID.
 #define ATTR_GID   (1 << 2) ///< Flag set to specify the validity of GID.
@@ -0,0 +1,50 @@
+/// @file acpi.h
+/// @brief Discovery of the interrupt controllers through the ACPI tables.
+/// @details
+/// The Multiple APIC Description Table (MADT) tells where the local APICs
+/// and the I/O APIC are, and how the ISA IRQs are wired to the pins of the
+/// I/O APIC (the interrupt source overrides). Only the MADT is parsed, there
+/// is no interpreter for the AML code of the firmware.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @name Flags of the interrupt source overrides (MPS INTI flags).
+/// @{
+#define ACPI_MPS_POLARITY_MASK 0x03U ///< The bits of the polarity.
+#define ACPI_MPS_ACTIVE_HIGH   0x01U ///< The line is active high.
+#define ACPI_MPS_ACTIVE_LOW    0x03U ///< The line is active low.
+#define ACPI_MPS_TRIGGER_MASK  0x0CU ///< The bits of the trigger mode.
+#define ACPI_MPS_EDGE          0x04U ///< The line is edge triggered.
+#define ACPI_MPS_LEVEL         0x0CU ///< The line is level triggered.
+/// @}
+
+/// @brief Searches the firmware for the ACPI tables, and parses the MADT.
+/// @return 0 on success, -1 if there is no usable MADT.
+int acpi_initialize(void);
+
+/// @brief Returns the number of enabled CPUs described by the MADT.
+/// @return the number of CPUs, 0 if there is no MADT.
+unsigned int acpi_num_cpus(void);
+
+/// @brief Returns the physical address of the local APICs.
+/// @return the address, 0 if there is no MADT.
+uint32_t acpi_lapic_address(void);
+
+/// @brief Returns the physical address of the first I/O APIC.
+/// @return the address, 0 if there is none.
+uint32_t acpi_ioapic_address(void);
+
+/// @brief Returns the first Global System Interrupt of the first I/O APIC.
+/// @return the interrupt wired to its first pin.
+uint32_t acpi_ioapic_gsi_base(void);
+
+/// @brief Returns the Global System Interrupt an ISA IRQ is wired to.
+/// @param irq the ISA IRQ.
+/// @param flags where the flags of the line (ACPI_MPS_*) are stored, 0 when
+/// the line follows the conventions of the ISA bus (edge triggered, active high).
+/// @return the interrupt, the IRQ itself unless an override says otherwise.
+uint32_t acpi_irq_to_gsi(unsigned int irq, uint16_t *flags);
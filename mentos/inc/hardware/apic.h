@@ -0,0 +1,48 @@
+/// @file apic.h
+/// @brief Local APIC, used for its timer and to receive the external interrupts.
+/// @details
+/// The IRQs go through the PIC, which the local APIC forwards in virtual
+/// wire mode, until the I/O APIC takes over. The PCI devices with MSI write
+/// their interrupts straight to the local APIC, at the vectors starting
+/// from MSI_VECTOR_BASE. The timer of the local APIC counts down in
+/// one-shot mode, and interrupts at LAPIC_TIMER_VECTOR once it reaches zero.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// The vector of the interrupt of the timer of the local APIC.
+#define LAPIC_TIMER_VECTOR    48
+/// The first vector of the Message Signaled Interrupts.
+#define MSI_VECTOR_BASE       49
+/// The number of vectors of the Message Signaled Interrupts.
+#define MSI_VECTOR_COUNT      8
+/// The vector of the spurious interrupts of the local APIC.
+#define LAPIC_SPURIOUS_VECTOR 63
+
+/// @brief Maps and enables the local APIC, and measures the frequency of its
+///        timer against the PIT.
+/// @return 0 on success, -1 if there is no usable local APIC.
+int lapic_initialize(void);
+
+/// @brief Arms the timer of the local APIC, the previous expiration is lost.
+/// @param ns the nanoseconds before the interrupt, 0 stops the timer.
+void lapic_timer_oneshot(uint32_t ns);
+
+/// @brief Sends the end-of-interrupt to the local APIC.
+void lapic_send_eoi(void);
+
+/// @brief Checks if the local APIC is enabled.
+/// @return 1 if it is enabled, 0 otherwise.
+int lapic_is_enabled(void);
+
+/// @brief Returns the identifier of the local APIC, the destination of the
+///        interrupts sent to this CPU.
+/// @return the identifier, 0 if the local APIC is not enabled.
+uint8_t lapic_get_id(void);
+
+/// @brief Stops forwarding the interrupts of the PIC (virtual wire mode),
+///        once the I/O APIC delivers the IRQs.
+void lapic_disable_extint(void);
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "kernel.h"
+#include "stddef.h"
 #include "stdint.h"
 
 /// Dimension of the exc flags.
@@ -18,6 +19,29 @@
 /// Dimension of the edx flags.
 #define EDX_FLAGS_SIZE 32
 
+/// @name Features reported inside EDX, by CPUID with EAX=1
+/// @{
+#define CPUID_EDX_PSE  3  ///< Page Size Extensions (4 MB pages).
+#define CPUID_EDX_TSC  4  ///< Time Stamp Counter (rdtsc).
+#define CPUID_EDX_MSR  5  ///< Model Specific Registers (rdmsr, wrmsr).
+#define CPUID_EDX_APIC 9  ///< Local APIC.
+#define CPUID_EDX_SEP  11 ///< Fast system calls (sysenter, sysexit).
+#define CPUID_EDX_PGE  13 ///< Page Global Enable (TLB entries kept across cr3 reloads).
+#define CPUID_EDX_PAT  16 ///< Page Attribute Table (memory types selected by the pages).
+/// @}
+
+/// @name Extended leaves of CPUID
+/// @{
+#define CPUID_EXT_MAX_LEAF          0x80000000U ///< Returns the highest extended leaf inside EAX.
+#define CPUID_EXT_BRAND_FIRST_LEAF  0x80000002U ///< The first of the three leaves holding the brand string.
+#define CPUID_EXT_BRAND_LAST_LEAF   0x80000004U ///< The last of the three leaves holding the brand string.
+#define CPUID_EXT_POWER_LEAF        0x80000007U ///< Advanced power management information.
+#define CPUID_EXT_EDX_INVARIANT_TSC 8           ///< The TSC runs at a constant rate, in every C-state and P-state.
+/// @}
+
+/// The size of the brand string, with its terminator.
+#define CPUID_BRAND_STRING_SIZE 49
+
 /// @brief Contains the information concerning the CPU.
 typedef struct cpuinfo {
     /// The name of the vendor.
@@ -48,6 +72,39 @@ cpuinfo_t sinfo;
 /// @param cpuinfo Structure to fill with CPUID information.
 void get_cpuid(cpuinfo_t *cpuinfo);
 
+/// @brief Checks if the processor reports one of the features inside EDX.
+/// @param bit the bit of the feature (CPUID_EDX_*).
+/// @return 1 if the feature is supported, 0 otherwise.
+int cpuid_has_feature_edx(uint32_t bit);
+
+/// @brief Checks if the Time Stamp Counter is invariant, i.e., if it counts at
+///        the same rate whatever the frequency and the power state of the CPU.
+/// @return 1 if the TSC is invariant, 0 otherwise.
+int cpuid_has_invariant_tsc(void);
+
+/// @brief Checks if the processor supports sysenter and sysexit.
+/// @return 1 if they are supported, 0 otherwise.
+int cpuid_has_sysenter(void);
+
+/// @brief Returns the signature of the processor, with the extended family and model folded in.
+/// @param family where the family is stored.
+/// @param model where the model is stored.
+/// @param stepping where the stepping is stored.
+void cpuid_get_signature(uint32_t *family, uint32_t *model, uint32_t *stepping);
+
+/// @brief Reads the brand string of the processor, without its leading spaces.
+/// @param brand where the string is stored.
+/// @param size the size of the buffer, at least CPUID_BRAND_STRING_SIZE.
+/// @return 0 on success, -1 if the processor has no brand string.
+int cpuid_get_brand_string(char *brand, size_t size);
+
+/// @brief Writes the names of the features reported by CPUID with EAX=1,
+///        separated by spaces, in the style of the flags of `/proc/cpuinfo`.
+/// @param buffer the buffer.
+/// @param bufsize the size of the buffer.
+/// @return the number of characters which the names take, as snprintf().
+int cpuid_write_flags(char *buffer, size_t bufsize);
+
 /// @brief Actual CPUID call.
 /// @param registers The registers to fill with the result of the call.
 void call_cpuid(pt_regs_t *registers);
@@ -0,0 +1,107 @@
+/// @file hrtimer.h
+/// @brief High-resolution timers.
+/// @details
+/// The high-resolution timers expire at a time in nanoseconds, read from the
+/// Time Stamp Counter. They are kept sorted inside a red/black tree, and the
+/// timer of the local APIC is armed in one-shot mode for the first one, so
+/// that they do not depend on the period of the tick. Without a local APIC,
+/// they expire on the first tick following their expiration.
+///
+/// A timer can have some slack: it can expire at any time between its soft
+/// and its hard expiration. The CPU is interrupted for the hard expiration,
+/// which is rounded so that timers with the same slack share it, and every
+/// timer whose soft expiration has passed expires along with it.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "klib/div64.h"
+#include "stdbool.h"
+#include "stdint.h"
+#include "time.h"
+
+/// The nanoseconds in a second.
+#define NSEC_PER_SEC  1000000000U
+/// The nanoseconds in a microsecond.
+#define NSEC_PER_USEC 1000U
+
+/// @brief A high-resolution timer.
+typedef struct hrtimer {
+    /// The time, in nanoseconds, when the timer expires at the latest (its
+    /// hard expiration), the timers are sorted by it.
+    uint64_t expires;
+    /// The time, in nanoseconds, before which the timer does not expire (its
+    /// soft expiration).
+    uint64_t soft_expires;
+    /// The function executed once the timer expires, which can start it again.
+    void (*function)(unsigned long);
+    /// Custom data passed to the function.
+    unsigned long data;
+    /// If the timer is waiting to expire.
+    bool_t queued;
+} hrtimer_t;
+
+/// @brief Measures the clocks, and sets up the timer of the local APIC.
+void hrtimer_install(void);
+
+/// @brief Returns the time of the high-resolution timers.
+/// @return the nanoseconds since the clocks were measured.
+uint64_t hrtimer_get_ns(void);
+
+/// @brief Returns the resolution of the clock of the high-resolution timers.
+/// @return the nanoseconds between two distinct readings of the clock.
+uint32_t hrtimer_get_resolution(void);
+
+/// @brief Starts a timer, which is stopped first if it is waiting to expire.
+/// @param timer the timer, with its function and its data.
+/// @param expires the time, in nanoseconds, when it expires.
+void hrtimer_start(hrtimer_t *timer, uint64_t expires);
+
+/// @brief Starts a timer with some slack, which is stopped first if it is
+///        waiting to expire.
+/// @param timer the timer, with its function and its data.
+/// @param expires the time, in nanoseconds, before which it does not expire.
+/// @param slack the nanoseconds it can be delayed by, to expire along with
+/// other timers.
+void hrtimer_start_range_ns(hrtimer_t *timer, uint64_t expires, uint32_t slack);
+
+/// @brief Stops a timer, if it is waiting to expire.
+/// @param timer the timer.
+void hrtimer_cancel(hrtimer_t *timer);
+
+/// @brief Called by the tick, which makes the timers expire when there is no
+///        local APIC: it raises the softirq running the expired ones.
+void hrtimer_run(void);
+
+/// @brief Bounds the ticks the periodic tick can be stopped for, when the
+///        tick is what makes the high-resolution timers expire.
+/// @param next the ticks until the first dynamic timer expires.
+/// @return the ticks until the first timer, of either kind, expires.
+unsigned long hrtimer_nohz_next(unsigned long next);
+
+/// @brief Converts a timespec to nanoseconds.
+/// @param ts the timespec.
+/// @return the nanoseconds.
+static inline uint64_t timespec_to_ns(const struct timespec *ts)
+{
+    return ((uint64_t)ts->tv_sec * NSEC_PER_SEC) + (uint64_t)ts->tv_nsec;
+}
+
+/// @brief Converts a timeval to nanoseconds.
+/// @param tv the timeval.
+/// @return the nanoseconds.
+static inline uint64_t timeval_to_ns(const struct timeval *tv)
+{
+    return ((uint64_t)tv->tv_sec * NSEC_PER_SEC) + ((uint64_t)tv->tv_usec * NSEC_PER_USEC);
+}
+
+/// @brief Converts nanoseconds to a timeval.
+/// @param ns the nanoseconds.
+/// @param tv where the timeval is stored.
+static inline void ns_to_timeval(uint64_t ns, struct timeval *tv)
+{
+    uint32_t nsec;
+    tv->tv_sec  = (time_t)div64_32(ns, NSEC_PER_SEC, &nsec);
+    tv->tv_usec = (time_t)(nsec / NSEC_PER_USEC);
+}
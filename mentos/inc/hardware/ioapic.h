@@ -0,0 +1,30 @@
+/// @file ioapic.h
+/// @brief I/O APIC, which delivers the IRQs to the local APIC.
+/// @details
+/// Once the local APIC is enabled, the I/O APIC takes over the IRQs from the
+/// PIC, which is masked. Each ISA IRQ keeps its vector (32 + IRQ), and goes
+/// through the pin the interrupt source overrides of the ACPI tables tell,
+/// so its handlers do not change; its end-of-interrupt is a write to the
+/// registers of the local APIC.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// @brief Maps the I/O APIC, routes the ISA IRQs through it, and masks the PIC.
+/// @return 0 on success, -1 if the IRQs keep going through the PIC.
+int ioapic_initialize(void);
+
+/// @brief Checks if the I/O APIC delivers the IRQs.
+/// @return 1 if it does, 0 if the PIC does.
+int ioapic_is_enabled(void);
+
+/// @brief Lets an IRQ interrupt the CPU.
+/// @param irq the ISA IRQ.
+/// @return 0 on success, -1 if the IRQ is not wired to the I/O APIC.
+int ioapic_irq_enable(unsigned int irq);
+
+/// @brief Stops an IRQ from interrupting the CPU.
+/// @param irq the ISA IRQ.
+/// @return 0 on success, -1 if the IRQ is not wired to the I/O APIC.
+int ioapic_irq_disable(unsigned int irq);
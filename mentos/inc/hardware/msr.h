@@ -0,0 +1,38 @@
+/// @file msr.h
+/// @brief Access to the Model Specific Registers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @name Model Specific Registers
+/// @{
+#define MSR_APIC_BASE        0x01BU ///< Physical address of the local APIC.
+#define MSR_PMC0             0x0C1U ///< First general-purpose performance counter, the others follow.
+#define MSR_SYSENTER_CS      0x174U ///< Code segment of the kernel, entered by sysenter.
+#define MSR_SYSENTER_ESP     0x175U ///< Stack pointer loaded by sysenter.
+#define MSR_SYSENTER_EIP     0x176U ///< Instruction pointer loaded by sysenter.
+#define MSR_PERFEVTSEL0      0x186U ///< Event select register of the first counter, the others follow.
+#define MSR_PAT              0x277U ///< Page Attribute Table, the memory types of the eight entries.
+#define MSR_PERF_GLOBAL_CTRL 0x38FU ///< Enables each performance counter (version 2 onwards).
+/// @}
+
+/// @brief Reads a Model Specific Register.
+/// @param msr the register.
+/// @return its value.
+static inline uint64_t rdmsr(uint32_t msr)
+{
+    uint32_t low, high;
+    __asm__ __volatile__("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32U) | low;
+}
+
+/// @brief Writes a Model Specific Register.
+/// @param msr the register.
+/// @param value its new value.
+static inline void wrmsr(uint32_t msr, uint64_t value)
+{
+    __asm__ __volatile__("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32U)));
+}
@@ -99,6 +99,13 @@ int pic8259_irq_disable(uint32_t irq);
 /// @param irq The interrupt number.
 void pic8259_send_eoi(uint32_t irq);
 
+/// @brief Returns the IRQs masked on the PIC.
+/// @return the mask of the master in the low byte, and of the slave in the high one.
+uint16_t pic8259_get_mask(void);
+
+/// @brief Masks all the IRQs, once another controller delivers them.
+void pic8259_disable(void);
+
 /// @brief  This Function return the number of current IRQ Request.
 /// @return Number of IRQ + 1 currently serving. If 0 there are no IRQ.
 //int pic8259_irq_get_current(void);
@@ -0,0 +1,29 @@
+/// @file pmu.h
+/// @brief The Performance Monitoring Unit, counting hardware events for each process.
+/// @details
+/// The architectural performance monitoring of the CPU (reported by CPUID
+/// with EAX=0xA) provides a few general-purpose counters, each programmed with
+/// an event through its event select register. An event opened by
+/// perf_event_open() owns one of them for the process it watches: the
+/// counters are programmed when the process is switched in, and what they
+/// counted is added to the events when it is switched out, so that each
+/// process sees the counters as its own.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+struct task_struct;
+
+/// @brief Detects the counters of the CPU, and leaves them stopped.
+/// @return 0 on success, -1 if the CPU has no architectural performance monitoring.
+int pmu_initialize(void);
+
+/// @brief Moves the counters from the process giving up the CPU to the next one.
+/// @param prev the process giving up the CPU, which is still the current one.
+/// @param next the process about to run.
+void pmu_switch(struct task_struct *prev, struct task_struct *next);
+
+/// @brief Detaches the events from a process which is exiting, they keep their counts.
+/// @param task the process.
+void pmu_exit_task(struct task_struct *task);
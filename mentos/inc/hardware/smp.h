@@ -0,0 +1,97 @@
+/// @file smp.h
+/// @brief Discovery of the CPUs, and data kept for each one of them.
+/// @details
+/// The CPUs are described by the MultiProcessor Specification tables the
+/// firmware leaves in the first megabyte of memory. The kernel runs on the
+/// CPU which booted it, the others are only discovered, so that the data
+/// kept for each CPU is already laid out for them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdbool.h"
+#include "stdint.h"
+#include "sys/cache.h"
+
+/// The maximum number of CPUs the kernel keeps data for.
+#define NR_CPUS 8
+
+/// @brief Defines a variable with one instance for each CPU. The types written
+///        often are aligned to the lines of the cache (see sys/cache.h), so
+///        that the instances of two CPUs never share one.
+/// @param type the type of the variable.
+/// @param name the name of the variable.
+#define DEFINE_PER_CPU(type, name) type name[NR_CPUS]
+
+/// @brief Returns the instance of a variable, defined by DEFINE_PER_CPU, of a CPU.
+/// @param name the name of the variable.
+/// @param cpu the index of the CPU.
+#define per_cpu(name, cpu) ((name)[(cpu)])
+
+/// @brief Returns the instance of a variable, defined by DEFINE_PER_CPU, of
+///        the CPU running the caller.
+/// @param name the name of the variable.
+#define this_cpu(name) per_cpu(name, smp_processor_id())
+
+/// @brief A CPU described by the firmware.
+typedef struct cpu {
+    /// The identifier of the local APIC of the CPU.
+    uint8_t apic_id;
+    /// The version of the local APIC of the CPU.
+    uint8_t apic_version;
+    /// If the CPU booted the system.
+    bool_t bsp;
+} cpu_t;
+
+/// @brief The data of a CPU, which the CPU reaches through its %fs segment.
+/// @details The base of the segment of each CPU is the offset of its instance
+/// from the one of the first CPU, so that the instance of the first CPU is
+/// read at its own address. The flat segment the kernel boots with reads it
+/// too, before the segment is loaded.
+typedef struct cpu_local {
+    /// The index of the CPU.
+    unsigned int cpu;
+} __cacheline_aligned cpu_local_t;
+
+/// The data of each CPU, to be reached through smp_processor_id() and this_cpu().
+extern cpu_local_t cpu_locals[NR_CPUS];
+
+/// @brief Returns the index of the CPU running the caller.
+/// @return the index of the CPU, read through the %fs segment of the CPU.
+static inline unsigned int smp_processor_id(void)
+{
+    unsigned int cpu;
+    __asm__("movl %%fs:%1, %0" : "=r"(cpu) : "m"(cpu_locals[0].cpu));
+    return cpu;
+}
+
+/// @brief Returns the base of the %fs segment of a CPU.
+/// @param cpu the index of the CPU.
+/// @return the offset of the data of the CPU from the data of the first one.
+static inline uint32_t smp_percpu_offset(unsigned int cpu)
+{
+    return (uint32_t)&cpu_locals[cpu] - (uint32_t)&cpu_locals[0];
+}
+
+/// @brief Searches the tables of the firmware for the CPUs, and the
+///        interrupt controllers. Without tables, only the CPU which booted
+///        the system is known.
+void smp_initialize(void);
+
+/// @brief Returns the number of CPUs described by the firmware.
+/// @return the number of CPUs, at least one.
+unsigned int smp_num_cpus(void);
+
+/// @brief Returns a CPU described by the firmware.
+/// @param cpu the index of the CPU.
+/// @return the CPU, NULL if there is no such CPU.
+const cpu_t *smp_get_cpu(unsigned int cpu);
+
+/// @brief Returns the physical address of the local APICs.
+/// @return the address, 0 if there are no tables.
+uint32_t smp_lapic_address(void);
+
+/// @brief Returns the physical address of the first I/O APIC.
+/// @return the address, 0 if there is none.
+uint32_t smp_ioapic_address(void);
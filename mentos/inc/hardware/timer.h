@@ -10,17 +10,22 @@
 #include "list_head.h"
 #include "process/process.h"
 #include "stdint.h"
+#include "sys/cache.h"
 #include "time.h"
 
-/// This enables the dynamic timer system use an hierarchical timing wheel,
-/// an optimized data structure that allows O(1) insertion, O(1) deletion and
-/// ammortized O(1) tick update.
-#define ENABLE_REAL_TIMER_SYSTEM
+// The dynamic timers use an hierarchical timing wheel, which allows O(1)
+// insertion, O(1) deletion and ammortized O(1) tick update, unless the
+// ENABLE_REAL_TIMER_SYSTEM option of CMake is turned off, which keeps them
+// inside a single list, checked at every tick.
 
 /// This enables the system dump tvec_base timer vectors content on
 /// the console.
 //#define ENABLE_REAL_TIMER_SYSTEM_DUMP
 
+/// This stops the periodic tick while the CPU is idle, programming a one-shot
+/// interrupt for the next dynamic timer instead.
+#define ENABLE_TICKLESS_IDLE
+
 /// Counts down in real (i.e., wall clock) time.
 #define ITIMER_REAL    0
 /// Counts down against the user-mode CPU time consumed by the process.
@@ -32,6 +37,10 @@
 /// Number of ticks per seconds.
 #define TICKS_PER_SECOND 1193
 
+/// The nanoseconds the sleeps of a process can be delayed by, unless it sets
+/// its own slack with prctl(PR_SET_TIMERSLACK).
+#define TIMER_SLACK_NS 50000U
+
 /// @brief Handles the timer.
 /// @param reg The interrupt stack frame.
 /// @details
@@ -56,6 +65,22 @@ unsigned long timer_get_ticks(void);
 /// @param hz The frequency to set.
 void timer_phase(uint32_t hz);
 
+/// @brief Busy-waits, counting with the channel 2 of the PIT, to measure the
+///        frequency of the other clocks against it.
+/// @param us the microseconds to wait, at most 54925.
+/// @return the nanoseconds actually waited, a whole number of PIT cycles.
+uint32_t timer_pit_delay(uint32_t us);
+
+/// @brief Stops the periodic tick before halting the CPU, replacing it with a
+///        one-shot interrupt for the first dynamic timer to expire. To be
+///        called with the interrupts disabled.
+void timer_nohz_enter(void);
+
+/// @brief Accounts the ticks elapsed while the periodic tick was stopped, and
+///        starts it again. To be called with the interrupts disabled, once the
+///        CPU is woken up.
+void timer_nohz_exit(void);
+
 // ===============================================================================
 // Per-CPU timer vectors
 
@@ -88,6 +113,8 @@ typedef struct tvec_base_s {
     spinlock_t lock;
     /// Points to the dynamic timer that is currently handled by the CPU.
     struct timer_list *running_timer;
+    /// The number of timers queued inside the base.
+    unsigned long nr_timers;
 #ifdef ENABLE_REAL_TIMER_SYSTEM
     /// The earliest expiration time of the dynamic timers yet to be checked
     unsigned long timer_ticks;
@@ -103,10 +130,10 @@ typedef struct tvec_base_s {
 
 #else
     /// List of all the timers
-    struct list_head_t list;
+    list_head_t list;
 #endif
 
-} tvec_base_t;
+} __cacheline_aligned tvec_base_t;
 
 /// @brief Represents the request to execute a function in the future, also
 ///        known as timer.
@@ -143,6 +170,13 @@ void add_timer(struct timer_list *timer);
 /// @param timer The timer to remove.
 void remove_timer(struct timer_list *timer);
 
+/// @brief Wakes up a process, if it is still sleeping, once the given time has
+///        passed, with the slack of its sleeps. Cancelling its `sleep_timer`
+///        stops the wake-up.
+/// @param task The process.
+/// @param expires The time, in nanoseconds (see hrtimer_get_ns()).
+void timer_wake_up_at(task_struct *task, uint64_t expires);
+
 /// @brief Suspends the execution of the calling thread.
 /// @param req The amount of time we want to sleep.
 /// @param rem The remaining time we did not sleep.
@@ -181,6 +215,9 @@ int sys_getitimer(int which, struct itimerval *curr_value);
 /// @return Zero on success, or a negative value indicating the error.
 int sys_setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value);
 
-/// @brief Update the profiling timer and generate SIGPROF if it has expired.
-/// @param proc The process for which we must update the profiling.
-void update_process_profiling_timer(task_struct *proc);
+/// @brief Counts down the virtual and the profiling timers of the running
+///        process, and sends SIGVTALRM or SIGPROF once they expire.
+/// @param proc The running process.
+/// @param user If the ticks elapsed while the process was running in user mode.
+/// @param ticks The ticks elapsed.
+void update_process_itimers(task_struct *proc, bool_t user, unsigned long ticks);
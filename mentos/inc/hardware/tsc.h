@@ -0,0 +1,42 @@
+/// @file tsc.h
+/// @brief Time Stamp Counter (TSC), calibrated against the PIT.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdbool.h"
+#include "stdint.h"
+
+/// The number of bits of the fraction of the nanoseconds of a cycle.
+#define TSC_SHIFT 24
+
+/// @brief Reads the Time Stamp Counter.
+/// @return the number of cycles since the CPU was reset.
+static inline uint64_t tsc_read(void)
+{
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32U) | low;
+}
+
+/// @brief Measures the frequency of the TSC against the PIT.
+/// @return 0 on success, -1 if the CPU has no usable TSC.
+int tsc_initialize(void);
+
+/// @brief Tells if the TSC counts at a constant rate, whatever the frequency
+///        and the power state of the CPU.
+/// @return true if the TSC is invariant, false otherwise.
+bool_t tsc_is_invariant(void);
+
+/// @brief Returns the nanoseconds of a cycle, with TSC_SHIFT bits of fraction.
+/// @return the nanoseconds, 0 if tsc_initialize() failed.
+uint32_t tsc_get_mult(void);
+
+/// @brief Returns the value of the TSC when it was calibrated.
+/// @return the cycles, where tsc_get_ns() starts counting from.
+uint64_t tsc_get_base(void);
+
+/// @brief Returns the nanoseconds elapsed since the TSC was calibrated.
+/// @return the nanoseconds, always 0 if tsc_initialize() failed.
+uint64_t tsc_get_ns(void);
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "os_root_path.h"
+#include "stddef.h"
 #include "sys/kernel_levels.h"
 
 #ifndef __DEBUG_LEVEL__
@@ -55,6 +56,61 @@ void dbg_puts(const char *s);
 /// @param ... the list of arguments.
 void dbg_printf(const char *file, const char *fun, int line, char *header, short log_level, const char *format, ...);
 
+/// @brief Has the kernel log drained to the serial port by a work, from now
+/// on, rather than by whoever logs a message. Requires the workqueues.
+void dbg_start_drain(void);
+
+/// @brief Reads the latest messages of the kernel log, those of each CPU
+/// following those of the previous CPU.
+/// @param buffer where the messages are copied.
+/// @param offset the offset, inside the messages, from which the read starts.
+/// @param size the size of the buffer.
+/// @return the amount of bytes read.
+ssize_t dbg_read_log(char *buffer, off_t offset, size_t size);
+
+/// @brief A debug point, a call site of pr_debug() left out by the log level
+/// of its file, which can be enabled while the kernel runs. The points are
+/// laid out one after the other, by the linker, inside `.dbg_points`.
+typedef struct dbg_point {
+    /// The file of the call site.
+    const char *file;
+    /// The function of the call site.
+    const char *function;
+    /// The header of the messages.
+    char *header;
+    /// The line of the call site.
+    unsigned short line;
+    /// If the messages are printed.
+    unsigned char enabled;
+} __attribute__((aligned(16))) dbg_point_t;
+
+/// @brief Prints a debug message, only if its debug point is enabled. When
+/// it is not, the arguments are not evaluated, and the cost is a test.
+#define pr_dyndbg(...)                                                                                                 \
+    do {                                                                                                               \
+        static dbg_point_t __dbg_point __attribute__((section(".dbg_points"), used)) = {                               \
+            __RELATIVE_PATH__, __func__, __DEBUG_HEADER__, __LINE__, 0};                                               \
+        if (__builtin_expect(__dbg_point.enabled, 0)) {                                                                \
+            dbg_printf(__dbg_point.file, __func__, __LINE__, __DEBUG_HEADER__, LOGLEVEL_DEBUG, __VA_ARGS__);           \
+        }                                                                                                              \
+    } while (0)
+
+/// @brief Reads the list of the debug points, one per line, as
+/// `file:line [function] =p` when enabled, `=_` otherwise.
+/// @param buffer where the list is copied.
+/// @param offset the offset, inside the list, from which the read starts.
+/// @param size the size of the buffer.
+/// @return the amount of bytes read.
+ssize_t dbg_points_read(char *buffer, off_t offset, size_t size);
+
+/// @brief Enables, or disables, the debug points matching a command, like
+/// `file mem/alloc/slab.c line 120 +p` or `func pipe_read -p`. The terms
+/// are optional, without any of them every point matches.
+/// @param command the command.
+/// @param size the length of the command.
+/// @return the amount of points matched, or -EINVAL if the command is not valid.
+int dbg_points_control(const char *command, size_t size);
+
 /// General logging macro that logs a message at the specified log level.
 /// Only logs messages if the specified log level is less than or equal to __DEBUG_LEVEL__.
 #define pr_log(level, ...)                                                                                             \
@@ -118,9 +174,12 @@ void dbg_printf(const char *file, const char *fun, int line, char *header, short
 #define pr_info(...)
 #endif
 
-/// Prints a debug message.
+/// Prints a debug message, or leaves it to a debug point when the log level
+/// of the file leaves it out, and the debug points are enabled.
 #if __DEBUG_LEVEL__ >= LOGLEVEL_DEBUG
 #define pr_debug(...) dbg_printf(__RELATIVE_PATH__, __func__, __LINE__, __DEBUG_HEADER__, LOGLEVEL_DEBUG, __VA_ARGS__)
+#elif defined(ENABLE_DYNAMIC_DEBUG)
+#define pr_debug(...) pr_dyndbg(__VA_ARGS__)
 #else
 #define pr_debug(...)
 #endif
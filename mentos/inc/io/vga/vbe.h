@@ -0,0 +1,28 @@
+/// @file vbe.h
+/// @brief Linear frame buffer of the Bochs VBE extensions (QEMU -vga std).
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @brief The linear frame buffer, as set up by the video card.
+typedef struct vbe_framebuffer {
+    unsigned width;  ///< Width of the screen, in pixels.
+    unsigned height; ///< Height of the screen, in pixels.
+    unsigned bpp;    ///< Bits per pixel.
+    unsigned pitch;  ///< Bytes between the beginning of two rows.
+    char *address;   ///< Virtual address of the first pixel.
+} vbe_framebuffer_t;
+
+/// @brief Finds the Bochs VBE video card, sets the resolution through its
+/// dispi registers, and maps its frame buffer.
+/// @param width the width of the screen.
+/// @param height the height of the screen.
+/// @param fb where the details of the frame buffer are stored.
+/// @return 0 on success, -1 if there is no such card, or the resolution is refused.
+int vbe_initialize(unsigned width, unsigned height, vbe_framebuffer_t *fb);
+
+/// @brief Disables the VBE extensions, going back to the legacy VGA.
+void vbe_finalize(void);
@@ -8,12 +8,21 @@
 /// @brief Initializes the VGA.
 void vga_initialize(void);
 
+/// @brief Switches to the linear frame buffer of the Bochs VBE extensions,
+/// once the memory can be mapped, when VGA_MODE_BOCHS_VBE is selected.
+/// @return 0 on success, -1 if the console stays in text mode.
+int vga_initialize_vbe(void);
+
 /// @brief Finalizes the VGA.
 void vga_finalize(void);
 
-/// @brief Updates the graphic elements.
+/// @brief Updates the graphic elements, and copies the changes to the screen.
 void vga_update(void);
 
+/// @brief Copies the part of the screen changed since the last flush to the
+///        video memory.
+void vga_flush(void);
+
 /// @brief Checks if the VGA is enabled.
 /// @return 1 if enabled, 0 otherwise.
 int vga_is_enabled(void);
@@ -71,6 +80,14 @@ void vga_draw_line(int x0, int y0, int x1, int y1, unsigned char color);
 /// @param color color of the rectangle.
 void vga_draw_rectangle(int sx, int sy, int w, int h, unsigned char color);
 
+/// @brief Fills a rectangle, one row at a time.
+/// @param sx top-left corner x-axis position.
+/// @param sy top-left corner y-axis position.
+/// @param w width.
+/// @param h height.
+/// @param color color of the rectangle.
+void vga_fill_rectangle(int sx, int sy, int w, int h, unsigned char color);
+
 /// @brief Draws a circle provided the position of the center and the radius.
 /// @param xc x-axis position.
 /// @param yc y-axis position.
@@ -6,14 +6,23 @@
 #pragma once
 
 #include "io/ansi_colors.h"
+#include "stddef.h"
 #include "stdint.h"
 
 /// @brief Initialize the video.
 void video_init(void);
 
-/// @brief Updates the video.
+/// @brief Updates the video, copying the changes to the screen.
 void video_update(void);
 
+/// @brief Copies the changes to the screen at once, without waiting for the
+///        next refresh (e.g., before halting).
+void video_flush(void);
+
+/// @brief Starts refreshing the video from the workqueue of the system, once
+///        per frame while the screen changes, rather than at each write.
+void video_start_refresh(void);
+
 /// @brief Print the given character on the screen.
 /// @param c The character to print.
 void video_putc(int c);
@@ -22,6 +31,12 @@ void video_putc(int c);
 /// @param str The string to print.
 void video_puts(const char *str);
 
+/// @brief Prints the given characters on the screen, drawing the runs of
+///        printable characters at once.
+/// @param buf The characters to print.
+/// @param size How many characters.
+void video_write(const char *buf, size_t size);
+
 /// @brief When something is written in another position, update the cursor.
 void video_update_cursor_position(void);
 
@@ -5,12 +5,80 @@
 
 #pragma once
 
+#include "list_head.h"
+#include "stdint.h"
 #include "sys/ipc.h"
 
 #ifndef __KERNEL__
 #error "How did you include this file... include `libc/inc/sys/ipc.h` instead!"
 #endif
 
+/// The largest number of objects of each kind: sets of semaphores, shared
+/// memories, and message queues.
+#define IPC_MAX_OBJECTS 256
+/// The number of buckets of the hash table of the keys of a namespace.
+#define IPC_KEY_BUCKETS 64
+/// The record of the header of the listing of a namespace, in `/proc/ipc`.
+#define IPC_SEQ_HEADER  ((void *)1)
+/// The record of the empty line which ends the listing of a namespace.
+#define IPC_SEQ_TRAILER ((void *)2)
+
+/// @brief The part of an IPC object known to its namespace.
+typedef struct ipc_object {
+    /// The id of the object, whose low part is its slot inside the namespace.
+    int id;
+    /// The key of the object.
+    key_t key;
+    /// Reference inside the bucket of the hash table of the keys.
+    list_head_t key_bucket;
+} ipc_object_t;
+
+/// @brief The objects of a kind, indexed by id and hashed by key.
+typedef struct ipc_namespace {
+    /// The objects, indexed by the slot inside their id.
+    ipc_object_t *objects[IPC_MAX_OBJECTS];
+    /// The objects, hashed by key.
+    list_head_t keys[IPC_KEY_BUCKETS];
+    /// Changes each time a slot is given, so the ids of the removed objects
+    /// are not reused at once.
+    int sequence;
+} ipc_namespace_t;
+
+/// @brief Initializes an empty namespace.
+/// @param ns The namespace.
+void ipc_namespace_init(ipc_namespace_t *ns);
+
+/// @brief Adds an object to a namespace, and gives it an id.
+/// @param ns The namespace.
+/// @param object The object.
+/// @param key The key of the object.
+/// @return The id of the object, or -ENOSPC if the namespace is full.
+int ipc_namespace_add(ipc_namespace_t *ns, ipc_object_t *object, key_t key);
+
+/// @brief Removes an object from its namespace.
+/// @param ns The namespace.
+/// @param object The object.
+void ipc_namespace_remove(ipc_namespace_t *ns, ipc_object_t *object);
+
+/// @brief Searches for the object with the given id.
+/// @param ns The namespace.
+/// @param id The id.
+/// @return The object, or NULL if there is none.
+ipc_object_t *ipc_find_by_id(ipc_namespace_t *ns, int id);
+
+/// @brief Searches for the object with the given key.
+/// @param ns The namespace.
+/// @param key The key.
+/// @return The object, or NULL if there is none.
+ipc_object_t *ipc_find_by_key(ipc_namespace_t *ns, key_t key);
+
+/// @brief Returns the record of the listing of a namespace at the given
+///        position: the header, then the objects by slot, then the trailer.
+/// @param ns The namespace.
+/// @param pos The position, moved past the free slots.
+/// @return The object, IPC_SEQ_HEADER, IPC_SEQ_TRAILER, or NULL past the end.
+void *ipc_seq_find(ipc_namespace_t *ns, off_t *pos);
+
 /// @brief Validate IPC permissions based on flags and the given permission structure.
 /// @param flags Flags that control the validation behavior.
 /// @param perm Pointer to the IPC permission structure to validate.
@@ -31,6 +99,26 @@ int sem_init(void);
 /// @return 0 on success, 1 on failure.
 int shm_init(void);
 
+struct page;
+struct shm_info;
+
+/// @brief Returns a page of a shared memory, which is allocated, zero-filled,
+/// the first time it is touched.
+/// @param shm The shared memory.
+/// @param offset The offset inside the shared memory, aligned to a page.
+/// @return The page, with a reference taken for the caller, or NULL if it
+/// lies beyond the shared memory or cannot be allocated.
+struct page *shm_get_page(struct shm_info *shm, uint32_t offset);
+
+/// @brief Counts one more area attached to a shared memory, made by fork().
+/// @param shm The shared memory.
+void shm_attach(struct shm_info *shm);
+
+/// @brief Counts one less area attached to a shared memory, which is freed
+/// along with the last one, once removed.
+/// @param shm The shared memory.
+void shm_detach(struct shm_info *shm);
+
 /// @brief Initializes the message queue system.
 /// @return 0 on success, 1 on failure.
 int msq_init(void);
@@ -46,3 +46,7 @@
 
 /// @brief Read the value from the given variable.
 #define READ_ONCE(var) (*((__volatile__ __typeof__(var) *)(&(var))))
+
+/// @brief Hides the value of the given variable from the optimizer, which can
+/// no longer fold it (e.g., a pointer built from a constant address).
+#define OPTIMIZER_HIDE_VAR(var) __asm__("" : "=r"(var) : "0"(var))
@@ -0,0 +1,30 @@
+/// @file div64.h
+/// @brief Division of 64-bit numbers.
+/// @details
+/// The kernel is not linked against libgcc, hence a division with a 64-bit
+/// dividend, which GCC turns into a call to `__udivdi3` on i686, must go
+/// through the `divl` instruction instead.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @brief Divides a 64-bit number by a 32-bit one.
+/// @param dividend the dividend.
+/// @param divisor the divisor, which must be greater than the upper 32 bits
+/// of the dividend, so that the quotient fits 32 bits.
+/// @param remainder where the remainder is stored, if not NULL.
+/// @return the quotient.
+static inline uint32_t div64_32(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
+{
+    uint32_t quotient, rest;
+    __asm__("divl %4"
+            : "=a"(quotient), "=d"(rest)
+            : "a"((uint32_t)dividend), "d"((uint32_t)(dividend >> 32U)), "rm"(divisor));
+    if (remainder) {
+        *remainder = rest;
+    }
+    return quotient;
+}
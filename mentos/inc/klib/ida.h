@@ -0,0 +1,52 @@
+/// @file ida.h
+/// @brief Allocator of small integer identifiers, backed by a bitmap which
+/// is searched one word at a time.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @brief The number of words of the bitmap of an allocator of size identifiers.
+#define IDA_WORDS(size) (((size) + 31U) / 32U)
+
+/// @brief Allocator of the identifiers from 0 to size - 1.
+typedef struct ida {
+    /// The bitmap, the bit of an identifier is set while it is in use.
+    uint32_t *bitmap;
+    /// The number of identifiers.
+    unsigned int size;
+    /// The number of identifiers in use.
+    unsigned int used;
+    /// The words below this one have no free identifier.
+    unsigned int hint;
+} ida_t;
+
+/// @brief Initializes an allocator, with all the identifiers free.
+/// @param ida the allocator.
+/// @param bitmap the bitmap, of IDA_WORDS(size) words.
+/// @param size the number of identifiers.
+void ida_init(ida_t *ida, uint32_t *bitmap, unsigned int size);
+
+/// @brief Allocates the lowest free identifier.
+/// @param ida the allocator.
+/// @return the identifier, -1 if all of them are in use.
+int ida_alloc(ida_t *ida);
+
+/// @brief Allocates the first free identifier starting from the given one,
+///        and wrapping around, so that freed identifiers are not reused at once.
+/// @param ida the allocator.
+/// @param start the identifier the search starts from.
+/// @return the identifier, -1 if all of them are in use.
+int ida_alloc_cyclic(ida_t *ida, unsigned int start);
+
+/// @brief Marks an identifier as used.
+/// @param ida the allocator.
+/// @param id the identifier.
+void ida_mark_used(ida_t *ida, unsigned int id);
+
+/// @brief Frees an identifier.
+/// @param ida the allocator.
+/// @param id the identifier.
+void ida_free(ida_t *ida, unsigned int id);
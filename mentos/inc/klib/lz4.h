@@ -0,0 +1,48 @@
+/// @file lz4.h
+/// @brief Compressor and decompressor of the LZ4 block format, fast enough
+/// to be used on each page written to a compressed RAM disk.
+/// @details
+/// A block is a list of sequences, each one made of a token, whose high four
+/// bits are the number of literals and whose low four bits are the length of
+/// the match minus four, then of the literals, then of the little-endian
+/// offset of the match, counted backwards from the current position. Lengths
+/// which do not fit inside the token continue with bytes of 255, ended by a
+/// smaller one. The last sequence has only literals, and the last five bytes
+/// of a block are always literals. The compressor is the greedy one of the
+/// reference implementation, searching a single candidate per position
+/// through a hash table of the positions last seen.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+/// The logarithm of the number of entries of the hash table.
+#define LZ4_HASH_BITS  11
+/// The number of entries of the hash table.
+#define LZ4_HASH_SIZE  (1U << LZ4_HASH_BITS)
+/// The largest input, the positions inside the hash table are 16 bits wide.
+#define LZ4_MAX_INPUT  65535U
+/// The size of the output which can hold any input of the given size.
+#define LZ4_BOUND(size) ((size) + ((size) / 255) + 16)
+
+/// @brief Compresses a block.
+/// @param src the data.
+/// @param size the size of the data, at most LZ4_MAX_INPUT.
+/// @param dst where the compressed block is written.
+/// @param capacity the size of the output.
+/// @param table the hash table, of LZ4_HASH_SIZE entries, provided by the
+///        caller so that it is not placed on the stack.
+/// @return the size of the compressed block, 0 if it does not fit inside the output.
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity, uint16_t *table);
+
+/// @brief Decompresses a block, checking that it never reads or writes out
+///        of the buffers, or refers to data before the start of the output.
+/// @param src the compressed block.
+/// @param size the size of the compressed block.
+/// @param dst where the data is written.
+/// @param capacity the size of the output.
+/// @return the size of the data, -1 if the block is malformed or does not fit inside the output.
+int lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
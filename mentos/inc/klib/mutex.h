@@ -1,25 +1,48 @@
 /// @file mutex.h
-/// @brief
+/// @brief Sleeping mutexes, the contenders wait on a queue until the lock is
+/// handed over to them, while the owner inherits their priority.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #pragma once
 
+#include "process/wait.h"
 #include "stdint.h"
 
 /// @brief Structure of a mutex.
 typedef struct mutex {
-    /// The state of the mutex.
+    /// The state of the mutex, 1 if it is locked.
     uint8_t state;
-    /// The owner of the mutex.
-    uint32_t owner;
+    /// The task holding the mutex, NULL if it is not locked or if it was
+    /// locked before the first process started.
+    struct task_struct *owner;
+    /// The tasks waiting for the mutex, in arrival order, the one coming
+    /// first according to the scheduler gets it.
+    wait_queue_head_t wait;
 } mutex_t;
 
-/// @brief       Allows to lock a mutex.
+/// @brief Initializer of statically allocated mutexes.
+/// @param name The name of the mutex.
+#define MUTEX_INIT(name)                                                                                               \
+    {                                                                                                                  \
+        .state = 0,                                                                                                    \
+        .owner = NULL,                                                                                                 \
+        .wait  = { .lock = SPINLOCK_INIT, .task_list = { &(name).wait.task_list, &(name).wait.task_list } },           \
+    }
+
+/// @brief       Initializes a mutex, unlocked.
+/// @param mutex The mutex to initialize.
+void mutex_init(mutex_t *mutex);
+
+/// @brief       Locks a mutex, sleeping until it is handed over to us if it is busy.
+/// @param mutex The mutex to lock.
+void mutex_lock(mutex_t *mutex);
+
+/// @brief       Locks a mutex, only if it is free.
 /// @param mutex The mutex to lock.
-/// @param owner The one who request the lock.
-void mutex_lock(mutex_t *mutex, uint32_t owner);
+/// @return 1 if the mutex has been locked, 0 if it is busy.
+int mutex_trylock(mutex_t *mutex);
 
-/// @brief       Unlocks the mutex.
+/// @brief       Unlocks the mutex, handing it over to the waiter coming first, if any.
 /// @param mutex The mutex to unlock.
 void mutex_unlock(mutex_t *mutex);
@@ -0,0 +1,36 @@
+/// @file preempt.h
+/// @brief The counter of the sections during which the current task cannot
+/// give up the CPU.
+/// @details
+/// The kernel is not preempted, the long operations offer the CPU to the other
+/// processes through cond_resched(), which does nothing while the counter is
+/// not zero: while holding a spinlock, inside an RCU read-side critical
+/// section, and while running interrupt handlers or softirqs. The counter
+/// belongs to the task, it is saved and restored by the context switch.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "klib/stdatomic.h"
+
+/// The number of nested sections of the current task which cannot give up the CPU.
+extern volatile unsigned int __preempt_count;
+
+/// @brief Returns the number of nested sections which cannot give up the CPU.
+/// @return 0 if the current task can be switched out.
+static inline unsigned int preempt_count(void) { return __preempt_count; }
+
+/// @brief Starts a section which cannot give up the CPU, they can be nested.
+static inline void preempt_disable(void)
+{
+    ++__preempt_count;
+    barrier();
+}
+
+/// @brief Ends a section started with preempt_disable().
+static inline void preempt_enable(void)
+{
+    barrier();
+    --__preempt_count;
+}
@@ -52,6 +52,12 @@ rbtree_node_t *rbtree_node_init(rbtree_node_t *node, void *value);
 /// @return The value associated to the node.
 void *rbtree_node_get_value(rbtree_node_t *node);
 
+/// @brief Provides access to the children of a node.
+/// @param node The node itself.
+/// @param dir  The child (0: left, 1: right).
+/// @return The child, or NULL if there is none.
+rbtree_node_t *rbtree_node_get_child(rbtree_node_t *node, int dir);
+
 /// @brief Deallocate a node.
 /// @param node The node to destroy.
 void rbtree_node_dealloc(rbtree_node_t *node);
@@ -74,6 +80,17 @@ rbtree_t *rbtree_tree_create(rbtree_tree_node_cmp_f node_cb);
 /// @return Pointer to tree itself.
 rbtree_t *rbtree_tree_init(rbtree_t *tree, rbtree_tree_node_cmp_f node_cb);
 
+/// @brief Sets the function which recomputes the data a node keeps about
+///        its subtree, called whenever the children of the node change.
+/// @param tree       The tree.
+/// @param augment_cb The function, called on a node after its children.
+void rbtree_tree_set_augment_cb(rbtree_t *tree, rbtree_tree_node_f augment_cb);
+
+/// @brief Provides access to the root of the tree.
+/// @param tree The tree.
+/// @return The root, or NULL if the tree is empty.
+rbtree_node_t *rbtree_tree_get_root(rbtree_t *tree);
+
 /// @brief Deallocate a node.
 /// @param tree    The tree to destroy.
 /// @param node_cb The function called on each element of the tree before destroying the tree.
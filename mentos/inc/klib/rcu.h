@@ -0,0 +1,117 @@
+/// @file rcu.h
+/// @brief Read-copy-update, for the lists which are read far more often than
+/// they change, whose readers never wait for the writers.
+/// @details
+/// The kernel runs on a single CPU, and a task inside the kernel gives up the
+/// CPU only through schedule(), thus a reader which neither sleeps nor
+/// returns to user mode inside its critical section cannot be interrupted by
+/// another reader of the same section, other than by an interrupt handler,
+/// which ends before the reader resumes. Every context switch, every pass of
+/// the idle loop, and every interrupt of user mode, is therefore a quiescent
+/// state: once one of them happens, no reader can still see what was removed
+/// before it. The writers keep serializing with each other through their own
+/// lock, publish new entries with rcu_assign_pointer(), and free the removed
+/// ones through call_rcu(), once the next quiescent state has been reached.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "klib/compiler.h"
+#include "klib/preempt.h"
+#include "klib/stdatomic.h"
+#include "list_head.h"
+
+/// @brief A callback, queued by call_rcu() inside the structure it frees.
+typedef struct rcu_head {
+    /// The next queued callback.
+    struct rcu_head *next;
+    /// The function, which receives the head it was queued with.
+    void (*func)(struct rcu_head *head);
+} rcu_head_t;
+
+/// The number of nested read-side critical sections, checked at each quiescent state.
+extern volatile unsigned rcu_read_nesting;
+
+/// @brief Starts a read-side critical section, which must neither sleep nor
+///        return to user mode. Sections can be nested.
+static inline void rcu_read_lock(void)
+{
+    ++rcu_read_nesting;
+    preempt_disable();
+}
+
+/// @brief Ends a read-side critical section.
+static inline void rcu_read_unlock(void)
+{
+    preempt_enable();
+    --rcu_read_nesting;
+}
+
+/// @brief Reads a pointer published with rcu_assign_pointer(), only once.
+#define rcu_dereference(ptr) READ_ONCE(ptr)
+
+/// @brief Publishes a pointer, once the structure it points to has been initialized.
+#define rcu_assign_pointer(ptr, val)                                                                                   \
+    do {                                                                                                               \
+        barrier();                                                                                                     \
+        WRITE_ONCE(ptr, val);                                                                                          \
+    } while (0)
+
+/// @brief Queues a function, which runs once every reader which might still
+///        see the structure holding the head has finished.
+/// @details The functions run from the tasklet softirq, they can free memory but cannot sleep.
+/// @param head the head, inside the structure removed from the list.
+/// @param func the function, usually the one freeing the structure.
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+/// @brief Waits until every reader which started before the call has finished.
+/// @details It must be called from a task which can sleep, thus outside of any
+///          read-side critical section, and on a single CPU the readers of the
+///          other tasks have already finished by the time it runs.
+void synchronize_rcu(void);
+
+/// @brief Notes that no reader is inside a critical section, it is called at
+///        each context switch, by the idle loop, and when an interrupt comes
+///        from user mode.
+void rcu_note_quiescent_state(void);
+
+/// @brief Iterates the list, from a read-side critical section.
+#define list_for_each_rcu(pos, head)                                                                                   \
+    for (list_head_t * (pos) = rcu_dereference((head)->next); (pos) != (head); (pos) = rcu_dereference((pos)->next))
+
+/// @brief Inserts the new entry after the given location, the readers see
+///        either the old list, or the new one with the entry fully linked.
+/// @param entry the new element we want to insert.
+/// @param location the element after which we insert.
+static inline void list_head_insert_after_rcu(list_head_t *entry, list_head_t *location)
+{
+    list_head_t *old_next = location->next;
+    entry->prev           = location;
+    entry->next           = old_next;
+    rcu_assign_pointer(location->next, entry);
+    old_next->prev = entry;
+}
+
+/// @brief Inserts the new entry before the given location, the readers see
+///        either the old list, or the new one with the entry fully linked.
+/// @param entry the new element we want to insert.
+/// @param location the element before which we insert.
+static inline void list_head_insert_before_rcu(list_head_t *entry, list_head_t *location)
+{
+    list_head_t *old_prev = location->prev;
+    entry->prev           = old_prev;
+    entry->next           = location;
+    rcu_assign_pointer(old_prev->next, entry);
+    location->prev = entry;
+}
+
+/// @brief Removes the entry from its list, leaving its own links untouched,
+///        for the readers still standing on it. The entry can be reused, or
+///        freed, only after a grace period.
+/// @param entry the entry we want to remove.
+static inline void list_head_remove_rcu(list_head_t *entry)
+{
+    WRITE_ONCE(entry->prev->next, entry->next);
+    entry->next->prev = entry->prev;
+}
@@ -0,0 +1,41 @@
+/// @file rwlock.h
+/// @brief Sleeping reader-writer locks, readers share the lock while writers
+/// hold it alone.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "process/wait.h"
+#include "stdint.h"
+
+/// @brief Structure of a reader-writer lock.
+typedef struct rwlock {
+    /// The number of readers holding the lock.
+    uint32_t readers;
+    /// 1 if a writer holds the lock.
+    uint8_t writer;
+    /// The tasks waiting for the lock, in arrival order: writers are
+    /// exclusive waiters, readers are not.
+    wait_queue_head_t wait;
+} rwlock_t;
+
+/// @brief        Initializes a reader-writer lock, unlocked.
+/// @param rwlock The lock to initialize.
+void rwlock_init(rwlock_t *rwlock);
+
+/// @brief        Locks for reading, sleeping while a writer holds the lock or waits for it.
+/// @param rwlock The lock.
+void rwlock_read_lock(rwlock_t *rwlock);
+
+/// @brief        Releases a lock taken for reading.
+/// @param rwlock The lock.
+void rwlock_read_unlock(rwlock_t *rwlock);
+
+/// @brief        Locks for writing, sleeping while somebody else holds the lock.
+/// @param rwlock The lock.
+void rwlock_write_lock(rwlock_t *rwlock);
+
+/// @brief        Releases a lock taken for writing.
+/// @param rwlock The lock.
+void rwlock_write_unlock(rwlock_t *rwlock);
@@ -0,0 +1,41 @@
+/// @file seqlock.h
+/// @brief Sequence locks, writers serialize on a spinlock while readers never
+/// block, and retry when a writer got in the way.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "klib/spinlock.h"
+#include "stdint.h"
+
+/// @brief Structure of a sequence lock.
+typedef struct seqlock {
+    /// The sequence number, odd while a writer is updating the data.
+    volatile uint32_t sequence;
+    /// Serializes the writers.
+    spinlock_t lock;
+} seqlock_t;
+
+/// @brief         Initializes a sequence lock.
+/// @param seqlock The lock to initialize.
+void seqlock_init(seqlock_t *seqlock);
+
+/// @brief         Starts an update of the data protected by the lock.
+/// @param seqlock The lock.
+void seqlock_write_lock(seqlock_t *seqlock);
+
+/// @brief         Ends an update of the data protected by the lock.
+/// @param seqlock The lock.
+void seqlock_write_unlock(seqlock_t *seqlock);
+
+/// @brief         Starts reading the data protected by the lock.
+/// @param seqlock The lock.
+/// @return The sequence number, to pass to seqlock_read_retry().
+uint32_t seqlock_read_begin(const seqlock_t *seqlock);
+
+/// @brief         Checks if the data changed while we were reading it.
+/// @param seqlock The lock.
+/// @param start   The value returned by seqlock_read_begin().
+/// @return 1 if the data must be read again, 0 otherwise.
+int seqlock_read_retry(const seqlock_t *seqlock, uint32_t start);
@@ -1,33 +1,68 @@
 /// @file spinlock.h
-/// @brief
+/// @brief Ticket spinlocks, which are acquired in the order they are asked for.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #pragma once
 
+#include "klib/irqflags.h"
 #include "klib/stdatomic.h"
-
-/// Determines if the spinlock is free.
-#define SPINLOCK_FREE 0
-/// Determines if the spinlock is busy.
-#define SPINLOCK_BUSY 1
+#include "stdint.h"
 
 /// @brief Spinlock structure.
-typedef atomic_t spinlock_t;
+typedef struct spinlock {
+    /// The next ticket to hand out.
+    atomic_t next;
+    /// The ticket which holds the lock, the lock is free when it is equal to next.
+    atomic_t owner;
+#ifdef ENABLE_SPINLOCK_STATS
+    /// The number of times the lock has been acquired.
+    uint32_t acquisitions;
+    /// The number of acquisitions which had to wait for another holder.
+    uint32_t contentions;
+    /// The total number of iterations spent waiting for the lock.
+    uint32_t spins;
+#endif
+} spinlock_t;
+
+/// @brief Static initializer of a free spinlock.
+#define SPINLOCK_INIT { .next = 0, .owner = 0 }
 
 /// @brief Initialize the spinlock.
 /// @param spinlock The spinlock we initialize.
 void spinlock_init(spinlock_t *spinlock);
 
-/// @brief Try to lock the spinlock.
+/// @brief Lock the spinlock, waiting for the holders which asked before us.
 /// @param spinlock The spinlock we lock.
 void spinlock_lock(spinlock_t *spinlock);
 
-/// @brief Try to unlock the spinlock.
+/// @brief Unlock the spinlock, handing it to the next waiter.
 /// @param spinlock The spinlock we unlock.
 void spinlock_unlock(spinlock_t *spinlock);
 
-/// @brief Try to unlock the spinlock.
-/// @param spinlock The spinlock we try to block.
+/// @brief Try to lock the spinlock, without waiting.
+/// @param spinlock The spinlock we try to lock.
 /// @return 1 if succeeded, 0 otherwise.
 int spinlock_trylock(spinlock_t *spinlock);
+
+/// @brief Disables the IRQs, and locks the spinlock. Used for the locks which
+/// are also taken by interrupt handlers, that would otherwise spin forever on
+/// a lock held by the code they interrupted.
+/// @param spinlock The spinlock we lock.
+/// @return the IRQ flags, to pass to spinlock_unlock_irqrestore().
+static inline uint8_t spinlock_lock_irqsave(spinlock_t *spinlock)
+{
+    uint8_t flags = irq_disable();
+    spinlock_lock(spinlock);
+    return flags;
+}
+
+/// @brief Unlocks a spinlock locked with spinlock_lock_irqsave(), and
+/// restores the IRQs.
+/// @param spinlock The spinlock we unlock.
+/// @param flags The value returned by spinlock_lock_irqsave().
+static inline void spinlock_unlock_irqrestore(spinlock_t *spinlock, uint8_t flags)
+{
+    spinlock_unlock(spinlock);
+    irq_enable(flags);
+}
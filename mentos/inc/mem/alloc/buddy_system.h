@@ -75,6 +75,14 @@ bb_page_t *bb_alloc_pages(bb_instance_t *instance, unsigned int order);
 /// @param page     The address of the first page descriptor of the block.
 void bb_free_pages(bb_instance_t *instance, bb_page_t *page);
 
+/// @brief Splits an allocated block into blocks of a single page, so that its
+/// pages can be freed one at a time.
+/// @param instance A buddy system instance.
+/// @param page     The address of the first page descriptor of the block.
+/// @return 1 if the block has been split, 0 if the page is not the first one
+/// of an allocated block.
+int bb_split_pages(bb_instance_t *instance, bb_page_t *page);
+
 /// @brief Alloc a page using bb cache.
 /// @param instance Buddy system instance.
 /// @return An allocated page.
@@ -85,6 +93,12 @@ bb_page_t *bb_alloc_page_cached(bb_instance_t *instance);
 /// @param page     The address of the first page descriptor of the block.
 void bb_free_page_cached(bb_instance_t *instance, bb_page_t *page);
 
+/// @brief Free a list of pages allocated with bb_alloc_page_cached, shrinking
+/// the cache once, after all of them.
+/// @param instance Buddy system instance.
+/// @param pages    The list of pages, linked through their cache list, which is emptied.
+void bb_free_page_list_cached(bb_instance_t *instance, list_head_t *pages);
+
 /// @brief Initialize Buddy System.
 /// @param instance      A buddysystem instance.
 /// @param name          The name of the current instance (for debug purposes)
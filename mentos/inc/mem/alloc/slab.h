@@ -9,6 +9,7 @@
 #include "mem/gfp.h"
 #include "os_root_path.h"
 #include "stddef.h"
+#include "sys/cache.h"
 
 /// @brief Type for slab flags.
 typedef unsigned int slab_flags_t;
@@ -23,8 +24,28 @@ typedef void (*kmem_fun_t)(void *);
 #define KMEM_CREATE_CTOR(objtype, ctor)                                                                                \
     kmem_cache_create(#objtype, sizeof(objtype), alignof(objtype), GFP_KERNEL, (kmem_fun_t)(ctor), NULL)
 
+/// @brief Number of objects a magazine can hold.
+#define KMEM_MAGAZINE_SIZE 16
+
+/// @brief A small stack of free objects, kept in front of the slabs of a cache.
+typedef struct kmem_magazine {
+    /// Number of objects inside the magazine.
+    unsigned int rounds;
+    /// The objects, the last one freed is the first one allocated.
+    void *objects[KMEM_MAGAZINE_SIZE];
+} kmem_magazine_t;
+
 /// @brief Stores the information of a cache.
 typedef struct kmem_cache {
+    // The fields used by the allocations served from the magazines come
+    // first, inside the first line of the cache.
+
+    /// The magazine objects are allocated from, and freed to, first.
+    kmem_magazine_t *loaded;
+    /// The magazine swapped with the loaded one, when it is empty or full.
+    kmem_magazine_t *previous;
+    /// Number of objects allocated since the cache was created.
+    unsigned long nr_allocs;
     /// Link to place this cache in a global list of caches.
     list_head_t cache_list;
     /// Name of the cache.
@@ -39,10 +60,16 @@ typedef struct kmem_cache {
     unsigned int total_num;
     /// Number of free objects available across all slabs.
     unsigned int free_num;
+    /// Number of allocations which failed.
+    unsigned long nr_failures;
     /// Flags for page allocation behavior.
     slab_flags_t flags;
     /// Page allocation order (power of 2 pages) used for slab allocation.
     unsigned int gfp_order;
+    /// Number of different offsets the objects of a slab can start at.
+    unsigned int colour_count;
+    /// Colour of the next slab, its objects start colour_next cache lines later.
+    unsigned int colour_next;
     /// Constructor function for initializing objects.
     kmem_fun_t ctor;
     /// Destructor function for cleaning up objects.
@@ -53,7 +80,9 @@ typedef struct kmem_cache {
     list_head_t slabs_partial;
     /// List of completely free slabs.
     list_head_t slabs_free;
-} kmem_cache_t;
+    /// The magazines of the CPU, the kernel runs on a single one.
+    kmem_magazine_t magazines[2];
+} __cacheline_aligned kmem_cache_t;
 
 /// @brief Initializes the kernel memory cache system.
 /// @details This function initializes the global cache list and creates the
@@ -91,6 +120,16 @@ kmem_cache_t *kmem_cache_create(
 /// @return Returns 0 on success, or -1 if an error occurs.
 int kmem_cache_destroy(kmem_cache_t *cachep);
 
+/// @brief Writes the statistics of the caches inside the buffer, one line
+/// per cache in the style of `/proc/slabinfo`, with the following fields:
+///  name, active objects, total objects, object size, objects per slab,
+///  pages per slab, active slabs, total slabs, allocations, failures.
+/// Objects inside the magazines are not active.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of characters written.
+ssize_t kmem_cache_stats_dump(char *buffer, size_t bufsize);
+
 /// @brief Allocs a new object using the provided cache.
 /// @param file   File where the object is allocated.
 /// @param fun    Function where the object is allocated.
@@ -7,6 +7,7 @@
 
 #include "boot.h"
 #include "mem/mm/page.h"
+#include "sys/cache.h"
 
 /// @brief Enumeration for zone_t.
 enum zone_type {
@@ -46,7 +47,15 @@ typedef struct zone {
     size_t total_size;
     /// Buddy system managing this zone
     bb_instance_t buddy_system;
-} zone_t;
+    /// Zero-filled pages, taken out of the buddy system while the CPU is idle.
+    list_head_t zero_pages;
+    /// Number of pages inside the zero-filled pool.
+    size_t nr_zero_pages;
+    /// Number of blocks allocated from the zone, for each order.
+    unsigned long nr_allocs[MAX_BUDDYSYSTEM_GFP_ORDER];
+    /// Number of allocations which failed, for each order.
+    unsigned long nr_failures[MAX_BUDDYSYSTEM_GFP_ORDER];
+} __cacheline_aligned zone_t;
 
 /// @brief Data structure to rapresent a memory node. In Uniform memory access
 /// (UMA) architectures there is only one node called contig_page_data.
@@ -69,6 +78,13 @@ typedef struct pg_data {
     struct pg_data_t *node_next;
 } pg_data_t;
 
+/// @brief Blocks of pages gathered to be freed together, one list for each
+/// zone, linked through the cache list of their buddy system page.
+typedef struct page_batch {
+    list_head_t zones[__MAX_NR_ZONES]; ///< The blocks gathered, for each zone.
+    unsigned int count;                ///< The number of blocks gathered.
+} page_batch_t;
+
 /// @brief Structure to represent a memory zone (LowMem or HighMem).
 typedef struct memory_zone {
     uint32_t start_addr; ///< Start address of the zone (physical).
@@ -132,6 +148,39 @@ page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_m
 /// @return Returns 0 on success, or -1 if an error occurs.
 int pr_free_pages(const char *file, const char *func, int line, page_t *page);
 
+/// @brief Initializes an empty batch of pages to free.
+/// @param batch The batch.
+void page_batch_init(page_batch_t *batch);
+
+/// @brief Adds a block of page frames, whose last reference is being dropped,
+/// to a batch. The block counts as free from now on, even if it is given back
+/// to its zone only once the batch is released.
+/// @param batch The batch.
+/// @param page The first page of the block.
+void page_batch_add(page_batch_t *batch, page_t *page);
+
+/// @brief Gives back to their zones all the blocks of a batch, the single
+/// pages going back to the cache of their zone in a single pass, and empties the batch.
+/// @param batch The batch.
+void page_batch_release(page_batch_t *batch);
+
+/// @brief Splits an allocated block of page frames into blocks of a single
+/// page frame, which can then be freed one at a time.
+/// @param page The first page of the block.
+/// @return 1 if the block has been split, 0 if it was a single page, or if
+/// the page is not the first one of a block.
+int split_pages(page_t *page);
+
+/// @brief Zeroes a free page into the pool of its zone, which serves the
+/// allocations asking for __GFP_ZERO. Meant to be called while the CPU is idle.
+/// @return 1 if a page has been zeroed, 0 if the pools are full.
+int zone_zero_idle_page(void);
+
+/// @brief Asks the caches for pages, once a zone fell below its low watermark,
+/// until every zone is above its high watermark. Meant to be called while the CPU is idle.
+/// @return 1 if pages have been freed, 0 if there is nothing to reclaim.
+int zone_reclaim_idle(void);
+
 /// Wrapper that provides the filename, the function and line where the alloc is happening.
 #define alloc_pages(...) pr_alloc_pages(__RELATIVE_PATH__, __func__, __LINE__, __VA_ARGS__)
 
@@ -173,6 +222,21 @@ unsigned long get_zone_cached_space(gfp_t gfp_mask);
 /// @return The number of characters written to the buffer, or a negative value if an error occurs.
 int get_zone_buddy_system_status(gfp_t gfp_mask, char *buffer, size_t bufsize);
 
+/// @brief Retrieves the allocation counters of the zone corresponding to the given GFP mask.
+/// @param gfp_mask The GFP mask specifying the allocation constraints.
+/// @param allocs Where the number of blocks allocated from the zone is stored.
+/// @param failures Where the number of failed allocations is stored.
+/// @return 0 on success, -1 if the zone cannot be retrieved.
+int get_zone_alloc_stats(gfp_t gfp_mask, unsigned long *allocs, unsigned long *failures);
+
+/// @brief Writes the free blocks of each zone inside the buffer, one line per
+/// zone in the style of `/proc/buddyinfo`, followed by the blocks allocated
+/// and the allocations failed for each order.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of characters written.
+ssize_t zone_buddyinfo_dump(char *buffer, size_t bufsize);
+
 /// @brief Checks if the specified address points to a page_t (or field) that
 /// belongs to lowmem.
 /// @param addr The address to check.
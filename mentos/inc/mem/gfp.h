@@ -92,6 +92,16 @@ typedef unsigned int gfp_t;
 
 /// @}
 
+/// @defgroup ActionModifiers Action Modifiers
+/// @brief Change the content of the allocated pages.
+/// @{
+
+/// @brief Returns zero-filled pages. Single pages are taken from a pool of
+/// pages zeroed while the CPU is idle, when possible.
+#define __GFP_ZERO ___GFP_ZERO
+
+/// @}
+
 /// @defgroup gfp_flag_combinations Flag Combinations
 /// @brief Useful GFP flag combinations.
 /// @details
@@ -0,0 +1,35 @@
+/// @file ksm.h
+/// @brief Merging of the identical private pages of the processes.
+/// @details
+/// A kernel thread, `ksmd`, walks the page tables of the processes a few
+/// pages at a time, and merges the private pages holding the same content
+/// into a single page, shared read-only and copy-on-write, so that the first
+/// write to it gives the writer a private copy again, through the usual
+/// copy-on-write fault. The pages are compared by a checksum first, then
+/// byte by byte. The merging is opt-in: writing `1` to `/proc/ksm` merges the
+/// areas advised with MADV_MERGEABLE, `2` merges all the private writable
+/// areas, and `0` stops the thread.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stddef.h"
+#include "sys/types.h"
+
+#define KSM_RUN_STOP  0 ///< The pages are not merged.
+#define KSM_RUN_MERGE 1 ///< The pages of the areas advised with MADV_MERGEABLE are merged.
+#define KSM_RUN_ALL   2 ///< The pages of all the private writable areas are merged.
+
+/// @brief Sets how the pages are merged, starting the thread the first time.
+/// @param command the command, one of the KSM_RUN_* values, as a digit.
+/// @param size the length of the command.
+/// @return 0 on success, -EINVAL if the command is not valid, -ENOMEM if the thread cannot be started.
+int ksm_control(const char *command, size_t size);
+
+/// @brief Writes the state of the merging, in the style of the files of
+/// `/sys/kernel/mm/ksm` of Linux: run, pages_shared, pages_sharing, full_scans.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of written characters.
+ssize_t ksm_stats_dump(char *buffer, size_t bufsize);
@@ -12,13 +12,15 @@
 typedef struct mm_struct {
     /// List of memory areas (vm_area_struct references).
     list_head_t mmap_list;
+    /// Index of the memory areas, sorted by address.
+    struct rbtree *mm_rb;
     /// Pointer to the last used memory area.
     struct vm_area_struct *mmap_cache;
     /// Pointer to the process's page directory.
     struct page_directory *pgd;
     /// Number of memory areas.
     int map_count;
-    /// List of mm_structs.
+    /// Used to place the mm_struct inside the list of the processes.
     list_head_t mm_list;
     /// Start address of the code segment.
     uint32_t start_code;
@@ -42,8 +44,14 @@ typedef struct mm_struct {
     uint32_t env_start;
     /// End address of the environment variables.
     uint32_t env_end;
+    /// Address of the program headers of the executable, 0 if they are not loaded.
+    uint32_t phdr;
+    /// Number of program headers of the executable.
+    uint32_t phnum;
     /// Total number of mapped pages.
     unsigned int total_vm;
+    /// The number of tasks using the memory, the threads share it.
+    int users;
 } mm_struct_t;
 
 /// @brief Initializes the memory management system.
@@ -54,6 +62,11 @@ int mm_init(void);
 /// @return the main memory descriptor.
 mm_struct_t *mm_get_main(void);
 
+/// @brief Returns the list of the memory descriptors of the processes, linked
+/// through their mm_list field.
+/// @return the list.
+list_head_t *mm_get_list(void);
+
 /// @brief Creates the main memory descriptor.
 /// @param stack_size The size of the stack in byte.
 /// @return The Memory Descriptor created.
@@ -68,3 +81,9 @@ mm_struct_t *mm_clone(mm_struct_t *mmp);
 /// @param mm The Memory Descriptor to free.
 /// @return Returns -1 on error, otherwise 0.
 int mm_destroy(mm_struct_t *mm);
+
+/// @brief Drops a reference to a Memory Descriptor, and frees it once no
+///        task uses it anymore.
+/// @param mm The Memory Descriptor.
+/// @return Returns -1 on error, otherwise 0.
+int mm_put(mm_struct_t *mm);
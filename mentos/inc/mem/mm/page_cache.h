@@ -0,0 +1,27 @@
+/// @file page_cache.h
+/// @brief Pages of files shared by the processes mapping them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/vfs_types.h"
+#include "mem/mm/page.h"
+#include "stdbool.h"
+
+/// @brief Returns the page holding the content of a file at the given offset,
+///        reading it from the file the first time it is requested.
+/// @param file the file.
+/// @param offset the offset inside the file, aligned to the page size.
+/// @param read if not NULL, set to whether the page had to be read from the file.
+/// @return the page, with a reference taken for the caller, or NULL on failure.
+page_t *page_cache_get(vfs_file_t *file, uint32_t offset, bool_t *read);
+
+/// @brief Drops a reference to a page, freeing it with the last one.
+/// @param page the page.
+void page_cache_put(page_t *page);
+
+/// @brief Removes from the cache the pages of a file, whose content is
+///        changing. The processes mapping them keep their reference.
+/// @param file the file.
+void page_cache_invalidate(vfs_file_t *file);
@@ -0,0 +1,46 @@
+/// @file shrinker.h
+/// @brief Caches giving their memory back when it runs low.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "list_head.h"
+
+/// @brief The shrinker enters a filesystem, so it does not run while memory
+/// is being allocated, which may happen inside the filesystem itself.
+#define SHRINKER_FS 0x01U
+
+/// @brief The shrinker writes to a block device, and waits for it on behalf
+/// of the current task, so it runs only while an allocation is failing.
+#define SHRINKER_IO 0x02U
+
+/// @brief A cache which can give its memory back.
+typedef struct shrinker {
+    /// The name of the cache.
+    const char *name;
+    /// @brief Frees up to the given number of pages, starting from the least
+    /// recently used content.
+    /// @param shrinker the shrinker, placed inside the cache it belongs to.
+    /// @param nr_pages the number of pages to free.
+    /// @return the number of pages freed.
+    unsigned long (*scan)(struct shrinker *shrinker, unsigned long nr_pages);
+    /// The flags of the shrinker (SHRINKER_FS, SHRINKER_IO).
+    unsigned int flags;
+    /// Used to place the shrinker inside the list of the registered ones.
+    list_head_t list;
+} shrinker_t;
+
+/// @brief Registers a shrinker, which is asked for pages once memory runs low.
+/// @param shrinker the shrinker.
+void register_shrinker(shrinker_t *shrinker);
+
+/// @brief Unregisters a shrinker.
+/// @param shrinker the shrinker.
+void unregister_shrinker(shrinker_t *shrinker);
+
+/// @brief Asks the registered shrinkers for pages, until enough are freed.
+/// @param nr_pages the number of pages to free.
+/// @param flags the shrinkers which may run (SHRINKER_FS, SHRINKER_IO), the others always do.
+/// @return the number of pages freed.
+unsigned long shrink_caches(unsigned long nr_pages, unsigned int flags);
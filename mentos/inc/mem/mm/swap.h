@@ -0,0 +1,53 @@
+/// @file swap.h
+/// @brief Eviction of the pages of the processes to a swap area.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "mem/paging.h"
+
+/// @brief The value of the available bits, inside a page table entry which
+/// is not present, telling that its page is inside the swap area. The frame
+/// of the entry is then the slot of the page.
+#define SWAP_ENTRY_MARK 2U
+
+/// The signature written by mkswap at the end of the first page.
+#define SWAP_SIGNATURE      "SWAPSPACE2"
+/// The offset of the header inside the first page, the space before it is left to the boot sectors.
+#define SWAP_HEADER_OFFSET  1024
+/// The version of the header.
+#define SWAP_HEADER_VERSION 1
+
+/// @brief The header written by mkswap, 1 KiB inside the first page.
+typedef struct swap_header {
+    /// The version of the header.
+    uint32_t version;
+    /// The last usable page of the area.
+    uint32_t last_page;
+    /// The number of bad pages, they are listed right after the header.
+    uint32_t nr_badpages;
+} swap_header_t;
+
+/// @brief Checks if a page table entry refers to a page inside the swap area.
+/// @param entry the page table entry.
+/// @return 1 if the page has been swapped out, 0 otherwise.
+static inline int is_swap_entry(const page_table_entry_t *entry)
+{
+    return !entry->present && (entry->available == SWAP_ENTRY_MARK);
+}
+
+/// @brief Reads a page back from the swap area, and maps it on the entry.
+/// @param entry the page table entry of the swapped out page.
+/// @return 0 on success, -1 on failure.
+int swap_in(page_table_entry_t *entry);
+
+/// @brief Takes a reference to the slot of a swapped out page, whose entry
+/// has been copied into another page table.
+/// @param entry the page table entry of the swapped out page.
+void swap_duplicate(const page_table_entry_t *entry);
+
+/// @brief Drops the reference of an entry to the slot of a swapped out page,
+/// the slot is free once no entry refers to it.
+/// @param entry the page table entry of the swapped out page.
+void swap_free(const page_table_entry_t *entry);
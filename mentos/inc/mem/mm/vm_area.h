@@ -6,8 +6,13 @@
 #pragma once
 
 #include "list_head.h"
+#include "mem/mm/page.h"
+#include "stdbool.h"
 #include "stdint.h"
 
+struct vfs_file;
+struct shm_info;
+
 /// @brief Flags associated with virtual memory areas.
 enum MEMMAP_FLAGS {
     MM_USER    = 0x01, ///< Area belongs to user mode.
@@ -20,9 +25,20 @@ enum MEMMAP_FLAGS {
     MM_UPDADDR       = 0x20, ///< Allocate and assign physical page.
     MM_USER_ACCESS   = 0x40, ///< User-accessible (user = 1).
     MM_CACHE_DISABLE = 0x80, ///< Disable CPU caching.
-    MM_WRITE_THROUGH = 0x100 ///< Enable write-through caching.
+    MM_WRITE_THROUGH = 0x100, ///< Enable write-through caching.
+    MM_HUGE          = 0x200, ///< Map with large pages, allocated at once.
+    MM_WRITE_COMBINE = 0x400  ///< Combine the writes, as for frame buffers (uncached without PAT).
 };
 
+/// @name Area Advice
+/// @brief The advice given through madvise(), kept inside vm_flags above the flags of mmap().
+/// @{
+#define VM_SEQ_READ  0x01000000U ///< Accessed sequentially, the pages of the file are faulted in ahead.
+#define VM_RAND_READ 0x02000000U ///< Accessed randomly, the pages are faulted in one at a time.
+#define VM_HUGEPAGE  0x04000000U ///< Kept in memory, like the areas made of large pages.
+#define VM_MERGEABLE 0x08000000U ///< Its identical pages are merged with others, by the ksmd thread.
+/// @}
+
 /// @brief Virtual Memory Area, used to store details of a process segment.
 typedef struct vm_area_struct {
     /// Pointer to the memory descriptor associated with this area.
@@ -31,18 +47,39 @@ typedef struct vm_area_struct {
     uint32_t vm_start;
     /// End address of the segment, exclusive.
     uint32_t vm_end;
-    /// Linked list of memory areas.
+    /// Linked list of memory areas, sorted by address.
     list_head_t vm_list;
-    /// Page protection flags (permissions).
+    /// The lowest start address of the areas inside the subtree of the area, in the index of the areas.
+    uint32_t vm_subtree_start;
+    /// The highest end address of the areas inside the subtree of the area.
+    uint32_t vm_subtree_end;
+    /// The largest gap between two areas inside the subtree of the area.
+    uint32_t vm_subtree_gap;
+    /// Page protection flags (MM_USER, MM_RW, MM_HUGE).
     pgprot_t vm_page_prot;
     /// Flags indicating attributes of the memory area.
-    unsigned short vm_flags;
+    uint32_t vm_flags;
+    /// The file mapped by the area, NULL for anonymous memory.
+    struct vfs_file *vm_file;
+    /// The offset inside the file of the content mapped at the start of the area.
+    uint32_t vm_file_offset;
+    /// The number of bytes mapped from the file, the rest of the area is zero-filled.
+    uint32_t vm_file_size;
+    /// The shared memory attached at the area, NULL otherwise.
+    struct shm_info *vm_shm;
 } vm_area_struct_t;
 
 /// @brief Initialize the virtual memory area subsystem.
 /// @return 0 on success, -1 on error.
 int vm_area_init(void);
 
+/// @brief Creates the empty index of the areas of a memory descriptor, a
+///        red-black tree sorted by address, which also keeps the largest
+///        gap between the areas of each subtree.
+/// @param mm the memory descriptor.
+/// @return 0 on success, -1 on error.
+int vm_area_index_init(struct mm_struct *mm);
+
 /// @brief Create a virtual memory area.
 /// @param mm The memory descriptor which will contain the new segment.
 /// @param vm_start The virtual address to map to.
@@ -67,6 +104,67 @@ uint32_t vm_area_clone(struct mm_struct *mm, vm_area_struct_t *area, int cow, ui
 /// @return 0 if the area was destroyed, or -1 if the operation failed.
 int vm_area_destroy(struct mm_struct *mm, vm_area_struct_t *area);
 
+/// @brief Destroys all the areas of a memory descriptor which is going away,
+///        and whose page directory is not in use anymore. The page table
+///        entries are left as they are, for the caller frees the page tables
+///        whole, and the pages are given back to their zones in bulk, at the end.
+/// @param mm the memory descriptor.
+void vm_area_destroy_all(struct mm_struct *mm);
+
+/// @brief Maps the content of a file on a copy-on-write area, whose pages
+///        are then read from the file the first time they are accessed.
+/// @param area the area, created with MM_COW.
+/// @param file the file, which is kept open until the area is destroyed.
+/// @param offset the offset inside the file of the content mapped at the start of the area.
+/// @param size the number of bytes mapped from the file.
+/// @return 0 on success, or -1 if the content does not fit inside the area.
+int vm_area_map_file(vm_area_struct_t *area, struct vfs_file *file, uint32_t offset, size_t size);
+
+/// @brief Reads the content of the files mapped on the page at the given address.
+/// @param mm the memory descriptor containing the areas.
+/// @param addr an address inside the page.
+/// @param page the zero-filled page where the content is read.
+/// @return 1 if some content has been read, 0 if no file is mapped on the
+///         page, or -1 if a file could not be read.
+int vm_area_read_page(struct mm_struct *mm, uint32_t addr, page_t *page);
+
+/// @brief Returns the page of the file to share at the given address: the
+///        read-only pages which hold only the content of a file are shared
+///        by all the processes mapping them.
+/// @param mm the memory descriptor containing the areas.
+/// @param addr an address inside the page.
+/// @param read if not NULL, set to whether the page had to be read from the file.
+/// @return the page, with a reference taken for the caller, or NULL if the page is not shared.
+page_t *vm_area_get_shared_page(struct mm_struct *mm, uint32_t addr, bool_t *read);
+
+/// @brief Writes back to the file the pages of a shared mapping which have
+///        been written, inside the given range.
+/// @param mm the memory descriptor containing the area.
+/// @param area the area.
+/// @param start the starting address of the range.
+/// @param end the ending address of the range, exclusive.
+/// @return 0 on success, or a negative error code.
+int vm_area_sync(struct mm_struct *mm, vm_area_struct_t *area, uint32_t start, uint32_t end);
+
+/// @brief Faults in the pages of the range which would have to be read, from
+///        the swap area or from the mapped file, the others stay on demand.
+/// @param mm the memory descriptor containing the area, which must be the current one.
+/// @param area the area.
+/// @param start the starting address of the range.
+/// @param end the ending address of the range, exclusive.
+void vm_area_willneed(struct mm_struct *mm, vm_area_struct_t *area, uint32_t start, uint32_t end);
+
+/// @brief Releases the pages of the range, which are then zero-filled, or
+///        read again from the mapped file, on the next access. The changes of
+///        a shared mapping are written back first, and shared memory, whose
+///        pages hold the only copy of their content, is left untouched.
+/// @param mm the memory descriptor containing the area.
+/// @param area the area.
+/// @param start the starting address of the range.
+/// @param end the ending address of the range, exclusive.
+/// @return 0 on success, or a negative error code.
+int vm_area_dontneed(struct mm_struct *mm, vm_area_struct_t *area, uint32_t start, uint32_t end);
+
 /// @brief Checks if the given virtual memory area range is valid.
 /// @param mm the memory descriptor which we use to check the range.
 /// @param vm_start the starting address of the area.
@@ -80,15 +178,16 @@ int vm_area_is_valid(struct mm_struct *mm, uintptr_t vm_start, uintptr_t vm_end)
 /// @return a pointer to the area if we found it, NULL otherwise.
 vm_area_struct_t *vm_area_find(struct mm_struct *mm, uint32_t vm_start);
 
-/// @brief Searches for an empty spot for a new virtual memory area.
+/// @brief Searches for the first virtual memory area which ends after the given address.
+/// @param mm the memory descriptor which should contain the area.
+/// @param addr the address.
+/// @return the area, which contains the address only if it starts before it, or NULL.
+vm_area_struct_t *vm_area_lookup(struct mm_struct *mm, uint32_t addr);
+
+/// @brief Searches for an empty spot for a new virtual memory area, placed at
+///        the top of the highest gap between two areas which is large enough.
 /// @param mm the memory descriptor which should contain the new area.
 /// @param length the size of the empty spot.
 /// @param vm_start where we save the starting address for the new area.
 /// @return 0 on success, -1 on error, or 1 if no free area is found.
 int vm_area_search_free_area(struct mm_struct *mm, size_t length, uintptr_t *vm_start);
-
-/// @brief Comparison function between virtual memory areas.
-/// @param vma0 Pointer to the first vm_area_struct's list_head_t.
-/// @param vma1 Pointer to the second vm_area_struct's list_head_t.
-/// @return 1 if vma0 starts after vma1 ends, 0 otherwise.
-int vm_area_compare(const list_head_t *vma0, const list_head_t *vma1);
@@ -9,6 +9,15 @@
 #include "mem/alloc/zone_allocator.h"
 #include "mem/paging.h"
 
+/// Size of the virtual memory.
+#define VIRTUAL_MEMORY_SIZE (128 * M)
+
+/// Base address for virtual memory mapping.
+#define VIRTUAL_MAPPING_BASE (PROCAREA_END_ADDR + 0x28000000UL)
+
+/// The number of slots of kmap_atomic(), how deep its mappings can nest.
+#define KMAP_ATOMIC_SLOTS 4
+
 /// @brief Virtual mapping manager.
 typedef struct virt_map_page_manager {
     /// The buddy system used to manage the pages.
@@ -26,11 +35,43 @@ typedef struct virt_map_page {
 int vmem_init(void);
 
 /// @brief Maps physical pages to virtual memory.
+/// @details Low memory is mapped by the kernel all the time, its address is
+/// returned without building a new mapping.
 /// @param page Pointer to the physical page.
 /// @param pfn_count The number of page frames to map.
 /// @return The virtual address of the mapped pages, or 0 on failure.
 uint32_t vmem_map_physical_pages(page_t *page, int pfn_count);
 
+/// @brief Maps a page for a short while, e.g., to copy it.
+/// @details Low memory is returned as it is mapped by the kernel, the other
+/// pages take one of the slots reserved at boot, whose page table entry is
+/// just rewritten. The interrupts stay disabled until kunmap_atomic(), so
+/// the caller must not sleep, nor fault on user memory, in between; the
+/// mappings are released in the reverse order.
+/// @param page the page.
+/// @return the virtual address of the page, NULL if all the slots are taken.
+void *kmap_atomic(page_t *page);
+
+/// @brief Releases the last mapping given by kmap_atomic().
+/// @param addr the address returned by kmap_atomic().
+void kunmap_atomic(void *addr);
+
+/// @brief Maps the memory-mapped registers of a device to virtual memory.
+/// @details The mapping is not cached, since registers can change without the
+/// CPU noticing.
+/// @param phy_address The physical address of the registers.
+/// @param size The size of the register space.
+/// @return The virtual address of the registers, or 0 on failure.
+uint32_t vmem_map_io(uint32_t phy_address, uint32_t size);
+
+/// @brief Maps the frame buffer of a video card to virtual memory.
+/// @details The mapping is write-combining, if the processor supports the
+/// Page Attribute Table, and not cached otherwise.
+/// @param phy_address The physical address of the frame buffer.
+/// @param size The size of the frame buffer.
+/// @return The virtual address of the frame buffer, or 0 on failure.
+uint32_t vmem_map_framebuffer(uint32_t phy_address, uint32_t size);
+
 /// @brief Allocates virtual pages for a given size.
 /// @param size The size in bytes to allocate.
 /// @return Pointer to the allocated virtual pages, or NULL on failure.
@@ -55,6 +96,8 @@ int vmem_unmap_virtual_address(uint32_t addr);
 int vmem_unmap_virtual_address_page(virt_map_page_t *page);
 
 /// @brief Memcpy from different processes virtual addresses
+/// @details The copy goes one page at a time, through kmap_atomic(), and the
+/// pages never touched in the source are zero-filled.
 /// @param dst_mm The destination memory struct
 /// @param dst_vaddr The destination memory address
 /// @param src_mm The source memory struct
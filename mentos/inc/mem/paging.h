@@ -23,6 +23,13 @@
 /// Maximum number of physical page frame numbers (PFNs).
 #define MAX_PHY_PFN (1UL << (32UL - PAGE_SHIFT))
 
+/// 4MB large pages (2^22 bytes), each one mapped by a page directory entry.
+#define HPAGE_SHIFT 22UL
+/// Size of a large page (4194304 bytes).
+#define HPAGE_SIZE  (1UL << HPAGE_SHIFT)
+/// The order of the blocks of the buddy system holding a large page.
+#define HPAGE_ORDER (HPAGE_SHIFT - PAGE_SHIFT)
+
 /// The start of the process area.
 #define PROCAREA_START_ADDR 0x00000000UL
 /// The end of the process area (and start of the kernel area).
@@ -33,6 +40,10 @@
 /// For a page directory with 1024 entries.
 #define MAX_PAGE_DIR_ENTRIES   1024
 
+/// The number of pages a TLB gather invalidates one by one, past which it
+/// flushes the whole TLB instead.
+#define TLB_GATHER_MAX_PAGES 32
+
 /// @brief An entry of a page directory.
 typedef struct page_dir_entry {
     unsigned int present : 1;   ///< Page is present in memory.
@@ -57,7 +68,7 @@ typedef struct page_table_entry {
     unsigned int cache : 1;      ///< Cache disabled.
     unsigned int accessed : 1;   ///< Page has been accessed.
     unsigned int dirty : 1;      ///< Page has been written to.
-    unsigned int zero : 1;       ///< Reserved (set to 0).
+    unsigned int pat : 1;        ///< Page Attribute Table, selects the write-combining entry.
     unsigned int global : 1;     ///< Global page (not flushed by TLB).
     unsigned int kernel_cow : 1; ///< Kernel copy-on-write.
     unsigned int available : 2;  ///< Available for system use.
@@ -82,6 +93,21 @@ typedef struct page_directory {
     page_dir_entry_t entries[MAX_PAGE_DIR_ENTRIES];
 } __attribute__((aligned(PAGE_SIZE))) page_directory_t;
 
+/// @brief Collects the pages whose mappings change during an update of a
+/// range, so that their TLB entries are invalidated once, at the end.
+typedef struct tlb_gather {
+    /// The page directory whose entries change.
+    page_directory_t *pgd;
+    /// If the page directory is the current one, otherwise its user pages are not inside the TLB.
+    int current;
+    /// If kernel pages, whose entries are global, have been collected.
+    int global;
+    /// The number of collected pages, past TLB_GATHER_MAX_PAGES the whole TLB is flushed.
+    unsigned int count;
+    /// The addresses of the collected pages.
+    uint32_t pages[TLB_GATHER_MAX_PAGES];
+} tlb_gather_t;
+
 /// Cache for storing page directories.
 extern kmem_cache_t *pgdir_cache;
 /// Cache for storing page tables.
@@ -101,6 +127,10 @@ void paging_enable(void);
 /// @return 1 if paging is enables, 0 otherwise.
 int paging_is_enabled(void);
 
+/// @brief Returns if large pages (PSE) are supported by the processor, and used.
+/// @return 1 if large pages are used, 0 otherwise.
+int paging_has_huge_pages(void);
+
 /// @brief Provide access to the main page directory.
 /// @return A pointer to the main page directory, or NULL if main_mm is not initialized.
 page_directory_t *paging_get_main_pgd(void);
@@ -123,6 +153,25 @@ int is_current_pgd(page_directory_t *pgd);
 /// @param addr The address of the page table.
 void paging_flush_tlb_single(unsigned long addr);
 
+/// @brief Flushes the whole TLB.
+/// @param global If the global entries, those of the kernel, are flushed too.
+void paging_flush_tlb_all(int global);
+
+/// @brief Starts collecting the pages whose mappings change.
+/// @param tlb The gather.
+/// @param pgd The page directory whose entries change.
+void tlb_gather_init(tlb_gather_t *tlb, page_directory_t *pgd);
+
+/// @brief Collects a page whose mapping changed.
+/// @param tlb The gather.
+/// @param addr The virtual address of the page.
+void tlb_gather_add(tlb_gather_t *tlb, uint32_t addr);
+
+/// @brief Invalidates the TLB entries of the collected pages, one by one or
+///        with a single flush of the whole TLB, and empties the gather.
+/// @param tlb The gather.
+void tlb_gather_flush(tlb_gather_t *tlb);
+
 /// @brief Maps a virtual address to a corresponding physical page.
 /// @param pgdir The page directory.
 /// @param virt_start The starting virtual address to map.
@@ -130,6 +179,35 @@ void paging_flush_tlb_single(unsigned long addr);
 /// @return A pointer to the physical page corresponding to the virtual address, or NULL on error.
 page_t *mem_virtual_to_page(page_directory_t *pgdir, uint32_t virt_start, size_t *size);
 
+/// @brief Returns the page table entry which maps a virtual address.
+/// @param pgd The page directory.
+/// @param virt_addr The virtual address.
+/// @return A pointer to the entry, or NULL if the address has no page table, or lies inside a large page.
+page_table_entry_t *mem_virtual_to_entry(page_directory_t *pgd, uint32_t virt_addr);
+
+/// @brief Maps a range with large pages, one for each page directory entry.
+/// @param pgd The page directory to update.
+/// @param virt_start The starting virtual address, aligned to a large page.
+/// @param phy_start The starting physical address, aligned to a large page.
+/// @param size The size of the range, a multiple of the size of a large page.
+/// @param flags Flags to set for the page directory entries (MM_RW, MM_USER, MM_GLOBAL).
+/// @return 0 on success, or -1 on failure.
+int mem_map_huge_pages(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_start, size_t size, uint32_t flags);
+
+/// @brief Removes the mappings of the pages overlapping a range, the large
+///        pages are removed whole. The page tables themselves are kept.
+/// @param pgd The page directory to update.
+/// @param virt_start The starting virtual address.
+/// @param size The size of the range.
+void mem_clear_vm_area(page_directory_t *pgd, uint32_t virt_start, size_t size);
+
+/// @brief Frees the page tables whose whole 4 MB region lies inside a range,
+///        dropping the mappings they hold, which must not refer to pages in use.
+/// @param pgd The page directory to update.
+/// @param virt_start The starting virtual address.
+/// @param size The size of the range.
+void mem_free_page_tables(page_directory_t *pgd, uint32_t virt_start, size_t size);
+
 /// @brief Updates the virtual memory area in a page directory.
 /// @param pgd The page directory to update.
 /// @param virt_start The starting virtual address to update.
@@ -154,3 +232,29 @@ int mem_clone_vm_area(
     uint32_t dst_start,
     size_t size,
     uint32_t flags);
+
+/// @brief Shares a range of user pages between two page directories, at the
+/// same virtual addresses. The pages gain a reference and, if copy-on-write,
+/// become read-only in both until one of the two writes them.
+/// @param src_pgd The source page directory.
+/// @param dst_pgd The destination page directory.
+/// @param start   The virtual address of the range.
+/// @param size    The size of the range.
+/// @param cow     If the pages become copy-on-write, otherwise writes are seen by both.
+/// @return 0 on success, -1 on failure.
+int mem_share_vm_area(page_directory_t *src_pgd, page_directory_t *dst_pgd, uint32_t start, size_t size, int cow);
+
+/// @brief Takes a reference to a user page of the current page directory,
+/// which becomes copy-on-write, so the owner does not see it change.
+/// @param pgd  The current page directory.
+/// @param addr The address of the page, aligned to a page.
+/// @return The page, or NULL if it cannot be brought in.
+page_t *mem_get_user_page(page_directory_t *pgd, uint32_t addr);
+
+/// @brief Installs a page, copy-on-write, at a user address of the current
+/// page directory, in place of the page there, whose reference is dropped.
+/// @param pgd  The current page directory.
+/// @param addr The address of the page, aligned to a page.
+/// @param page The page, which gains a reference for the entry.
+/// @return 0 on success, -1 on failure.
+int mem_put_user_page(page_directory_t *pgd, uint32_t addr, page_t *page);
@@ -0,0 +1,246 @@
+/// @file inet.h
+/// @brief Internet (AF_INET) sockets, over UDP and TCP.
+/// @details
+/// The received packets are queued on the sockets as they are, inside the
+/// pages of their buffers, and the data is copied only once, when it is read.
+/// TCP keeps the data it sends inside a ring, until it is acknowledged.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/poll.h"
+#include "fs/vfs_types.h"
+#include "net/net.h"
+#include "process/wait.h"
+#include "stdbool.h"
+#include "sys/socket.h"
+
+#define TCP_SNDBUF 16384 ///< The size of the ring holding the data of a connection which is not acknowledged.
+
+/// @brief The state of a TCP connection.
+typedef enum tcp_state {
+    TCP_CLOSED,       ///< No connection, or a bound socket.
+    TCP_LISTEN,       ///< Waiting for connections.
+    TCP_SYN_SENT,     ///< Our SYN has been sent, waiting for the one of the peer.
+    TCP_SYN_RECEIVED, ///< The SYN of the peer has been received, and our SYN sent.
+    TCP_ESTABLISHED,  ///< Data flows both ways.
+    TCP_FIN_WAIT_1,   ///< We are done sending, our FIN has not been acknowledged.
+    TCP_FIN_WAIT_2,   ///< We are done sending, waiting for the FIN of the peer.
+    TCP_CLOSE_WAIT,   ///< The peer is done sending.
+    TCP_CLOSING,      ///< Both sides are done, our FIN has not been acknowledged.
+    TCP_LAST_ACK,     ///< The peer is done, and so are we, waiting for the last acknowledgment.
+} tcp_state_t;
+
+/// @brief An Internet socket, the addresses and ports are in network byte order.
+typedef struct inet_sock {
+    /// The type of the socket (SOCK_STREAM or SOCK_DGRAM).
+    int type;
+    /// The protocol of the socket (IPPROTO_TCP or IPPROTO_UDP).
+    uint8_t protocol;
+    /// The file of the socket, NULL before accept(), and after close().
+    vfs_file_t *file;
+    /// Used to place the socket inside the list of its protocol, once it has a port.
+    list_head_t list;
+    /// The local address, INADDR_ANY for all of them.
+    uint32_t laddr;
+    /// The local port, 0 if the socket is not bound.
+    uint16_t lport;
+    /// The address of the peer, INADDR_ANY if the socket is not connected.
+    uint32_t raddr;
+    /// The port of the peer.
+    uint16_t rport;
+    /// The received buffers (net_buf_t), whose data is the payload.
+    list_head_t rx_queue;
+    /// The number of bytes queued.
+    size_t rx_bytes;
+    /// The number of buffers queued.
+    size_t rx_bufs;
+    /// The error to report (an errno value), 0 if there is none.
+    int error;
+    /// If the socket has been shut down for reading.
+    bool_t shut_rd;
+    /// If the socket has been shut down for writing.
+    bool_t shut_wr;
+    /// Woken up when there is something to read, or to accept.
+    wait_queue_head_t read_wait;
+    /// Woken up when there is room for writing, or when a connection is done.
+    wait_queue_head_t write_wait;
+    /// TCP: the state of the connection.
+    tcp_state_t state;
+    /// TCP: the listening socket of a connection not accepted yet.
+    struct inet_sock *parent;
+    /// TCP, listening: the connections established, waiting to be accepted.
+    list_head_t accept_queue;
+    /// TCP: used to place the connection inside the queue of its listening socket.
+    list_head_t accept_list;
+    /// TCP, listening: the connections which have not been accepted.
+    size_t backlog_len;
+    /// TCP, listening: the maximum number of connections which have not been accepted.
+    size_t max_backlog;
+    /// TCP: our initial sequence number.
+    uint32_t iss;
+    /// TCP: the oldest sequence number not acknowledged.
+    uint32_t snd_una;
+    /// TCP: the next sequence number to send.
+    uint32_t snd_nxt;
+    /// TCP: the highest sequence number sent, snd_nxt goes back to snd_una on a retransmission.
+    uint32_t snd_max;
+    /// TCP: the window of the peer.
+    uint32_t snd_wnd;
+    /// TCP: the largest segment the peer accepts.
+    uint16_t mss;
+    /// TCP: the next sequence number we expect.
+    uint32_t rcv_nxt;
+    /// TCP: the end of the window we advertised last.
+    uint32_t rcv_adv;
+    /// TCP: the data which has not been acknowledged, starting at snd_una.
+    uint8_t *snd_buf;
+    /// TCP: the position of snd_una inside the ring.
+    size_t snd_head;
+    /// TCP: the number of bytes inside the ring.
+    size_t snd_len;
+    /// TCP: if a FIN has to follow the data.
+    bool_t fin_pending;
+    /// TCP: if the FIN of the peer has been received.
+    bool_t fin_received;
+    /// TCP: when the oldest segment not acknowledged is sent again (or an orphan in
+    /// FIN_WAIT_2 gives up), 0 if nothing is in flight.
+    unsigned long rto_expires;
+    /// TCP: the current retransmission timeout, in ticks.
+    unsigned long rto;
+    /// TCP: the number of retransmissions of the oldest segment.
+    unsigned retries;
+} inet_sock_t;
+
+/// @brief Creates an Internet socket, and installs it on a file descriptor.
+/// @param type the type of the socket (SOCK_STREAM or SOCK_DGRAM), possibly with SOCK_NONBLOCK.
+/// @param protocol the protocol, 0 for the default one of the type.
+/// @return the file descriptor, or a negative error code.
+int inet_socket(int type, int protocol);
+
+/// @brief Returns the Internet socket of a file.
+/// @param file the file.
+/// @return the socket, NULL if the file is not an Internet socket.
+inet_sock_t *inet_get(vfs_file_t *file);
+
+/// @brief Assigns a local address, and a port, to a socket.
+/// @param sock the socket.
+/// @param addr the name (a `struct sockaddr_in`).
+/// @param addrlen the size of the name.
+/// @return 0 on success, or a negative error code.
+int inet_bind(inet_sock_t *sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Marks a TCP socket as accepting connections.
+/// @param sock the socket.
+/// @param backlog the maximum number of pending connections.
+/// @return 0 on success, or a negative error code.
+int inet_listen(inet_sock_t *sock, int backlog);
+
+/// @brief Accepts a TCP connection, and installs it on a file descriptor.
+/// @param sock the listening socket.
+/// @param addr where the name of the peer is stored (can be NULL).
+/// @param addrlen the size of `addr`, updated with the size of the name.
+/// @param flags the flags of the new connection (SOCK_NONBLOCK).
+/// @return the file descriptor, or a negative error code.
+int inet_accept(inet_sock_t *sock, struct sockaddr *addr, socklen_t *addrlen, int flags);
+
+/// @brief Connects a TCP socket, or sets the destination of a UDP socket.
+/// @param sock the socket.
+/// @param addr the name of the peer.
+/// @param addrlen the size of the name.
+/// @return 0 on success, or a negative error code.
+int inet_connect(inet_sock_t *sock, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Sends a message.
+/// @param sock the socket.
+/// @param msg the message, the destination of a datagram can be set.
+/// @param flags the flags of the call (MSG_DONTWAIT).
+/// @return the number of bytes sent, or a negative error code.
+ssize_t inet_sendmsg(inet_sock_t *sock, const struct msghdr *msg, int flags);
+
+/// @brief Receives a message.
+/// @param sock the socket.
+/// @param msg the message, the sender of a datagram is reported.
+/// @param flags the flags of the call (MSG_DONTWAIT).
+/// @return the number of bytes received, 0 at the end of a stream, or a negative error code.
+ssize_t inet_recvmsg(inet_sock_t *sock, struct msghdr *msg, int flags);
+
+/// @brief Shuts down part of a TCP connection.
+/// @param sock the socket.
+/// @param how what to shut down (SHUT_RD, SHUT_WR or SHUT_RDWR).
+/// @return 0 on success, or a negative error code.
+int inet_shutdown(inet_sock_t *sock, int how);
+
+// == INSIDE THE STACK ========================================================
+
+/// @brief Allocates a socket, without a file.
+/// @param type the type of the socket.
+/// @param protocol the protocol.
+/// @return the socket, NULL if there is no memory.
+inet_sock_t *inet_sock_alloc(int type, uint8_t protocol);
+
+/// @brief Frees a socket, with the buffers it has queued.
+/// @param sock the socket, which must not have a file.
+void inet_sock_free(inet_sock_t *sock);
+
+/// @brief Returns the sockets of a protocol which have a port.
+/// @param protocol the protocol (IPPROTO_TCP or IPPROTO_UDP).
+/// @return the list of the sockets (inet_sock_t).
+list_head_t *inet_socks(uint8_t protocol);
+
+/// @brief Places a socket inside the list of its protocol, so that it receives packets.
+/// @param sock the socket, whose local port is set.
+void inet_hash(inet_sock_t *sock);
+
+/// @brief Finds the socket receiving a packet.
+/// @details A connected socket only receives from its peer, and is preferred
+/// to the unconnected ones bound to the same port.
+/// @param protocol the protocol of the packet.
+/// @param daddr the destination address.
+/// @param dport the destination port.
+/// @param saddr the source address.
+/// @param sport the source port.
+/// @return the socket, NULL if there is none.
+inet_sock_t *inet_lookup(uint8_t protocol, uint32_t daddr, uint16_t dport, uint32_t saddr, uint16_t sport);
+
+/// @brief Checks if a call on a socket must not block.
+/// @param sock the socket.
+/// @param flags the flags of the call (MSG_DONTWAIT).
+/// @return true if the call must not block.
+bool_t inet_nonblock(inet_sock_t *sock, int flags);
+
+/// @brief Handles a UDP datagram.
+/// @param buf the buffer, whose data starts at the UDP header.
+/// @param ip the IPv4 header of the datagram.
+void udp_receive(net_buf_t *buf, iphdr_t *ip);
+
+/// @brief Handles a TCP segment.
+/// @param buf the buffer, whose data starts at the TCP header.
+/// @param ip the IPv4 header of the segment.
+void tcp_receive(net_buf_t *buf, iphdr_t *ip);
+
+/// @brief Starts the connection of a socket, and waits for it.
+/// @param sock the socket, which is bound, and whose peer is set.
+/// @return 0 on success, or a negative error code.
+int tcp_connect(inet_sock_t *sock);
+
+/// @brief Sends data through a connection.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @return the number of bytes sent, or a negative error code.
+ssize_t tcp_sendmsg(inet_sock_t *sock, const struct msghdr *msg, int flags);
+
+/// @brief Tells the peer about the room made by a read, if it was waiting for it.
+/// @param sock the socket.
+void tcp_read_done(inet_sock_t *sock);
+
+/// @brief Sends a FIN, once the data queued has been sent.
+/// @param sock the socket.
+void tcp_shutdown_write(inet_sock_t *sock);
+
+/// @brief Closes the connection of a socket whose file has been closed, and
+/// frees the socket once the connection is done.
+/// @param sock the socket.
+void tcp_close(inet_sock_t *sock);
@@ -0,0 +1,199 @@
+/// @file net.h
+/// @brief The core of the network stack: buffers, devices, Ethernet, ARP and IPv4.
+/// @details
+/// A packet lives inside a single page, whose first bytes hold its net_buf_t:
+/// the network drivers fill the receive rings with such pages, and hand them
+/// over to the stack once the device has written a frame inside them. The
+/// protocols then only move the start of the data past their headers, and the
+/// sockets queue the very same page, which is copied once, by read(), into the
+/// buffer of the user. Outgoing packets are built the other way around: the
+/// payload is placed after some headroom, and each layer pushes its header in
+/// front of it.
+///
+/// The stack runs with the interrupts disabled: the system calls do, while
+/// the bottom halves (of the drivers, of the loopback, and the timer of TCP)
+/// disable them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "list_head.h"
+#include "mem/mm/page.h"
+#include "mem/paging.h"
+#include "netinet/in.h"
+#include "stddef.h"
+#include "stdint.h"
+
+#define ETH_ALEN     6      ///< The size of an Ethernet address.
+#define ETH_HLEN     14     ///< The size of the Ethernet header.
+#define ETH_MTU      1500   ///< The largest payload of an Ethernet frame.
+#define ETH_P_IP     0x0800 ///< The Ethernet type of IPv4.
+#define ETH_P_ARP    0x0806 ///< The Ethernet type of ARP.
+#define IP_HLEN      20     ///< The size of an IPv4 header without options.
+#define IP_TTL       64     ///< The time to live of the packets we send.
+#define NET_HEADROOM 128    ///< The room kept in front of the data, for the headers.
+
+/// @brief An Ethernet header.
+typedef struct ethhdr {
+    uint8_t dest[ETH_ALEN];   ///< The destination address.
+    uint8_t source[ETH_ALEN]; ///< The source address.
+    uint16_t proto;           ///< The type of the payload, in network byte order.
+} __attribute__((packed)) ethhdr_t;
+
+/// @brief An IPv4 header, the multi-byte fields are in network byte order.
+typedef struct iphdr {
+    uint8_t version_ihl; ///< The version (4), and the length of the header in words.
+    uint8_t tos;         ///< The type of service.
+    uint16_t tot_len;    ///< The length of the packet, header included.
+    uint16_t id;         ///< The identification, for fragments.
+    uint16_t frag_off;   ///< The flags, and the offset of a fragment.
+    uint8_t ttl;         ///< The time to live.
+    uint8_t protocol;    ///< The protocol of the payload (IPPROTO_*).
+    uint16_t check;      ///< The checksum of the header.
+    uint32_t saddr;      ///< The source address.
+    uint32_t daddr;      ///< The destination address.
+} __attribute__((packed)) iphdr_t;
+
+struct netdev;
+
+/// @brief A packet, stored at the start of the page holding its data.
+typedef struct net_buf {
+    /// Used to place the buffer inside a queue.
+    list_head_t list;
+    /// The page of the buffer.
+    page_t *page;
+    /// The physical address of the page.
+    uintptr_t phys;
+    /// The device the packet has been received from, NULL for the loopback.
+    struct netdev *dev;
+    /// The start of the data.
+    uint8_t *data;
+    /// The size of the data.
+    size_t len;
+    /// The source address of a received packet, in network byte order.
+    uint32_t saddr;
+    /// The source port of a received datagram, in network byte order.
+    uint16_t sport;
+} net_buf_t;
+
+/// The offset of the room for the data, inside the page of a buffer.
+#define NET_BUF_OFFSET ((sizeof(net_buf_t) + 15U) & ~15U)
+/// The room for the data, headers included.
+#define NET_BUF_SIZE   (PAGE_SIZE - NET_BUF_OFFSET)
+
+/// @brief A network device.
+typedef struct netdev {
+    /// The name of the device (e.g., eth0).
+    char name[16];
+    /// The Ethernet address of the device.
+    uint8_t mac[ETH_ALEN];
+    /// The address of the device, in network byte order.
+    uint32_t addr;
+    /// The netmask of the local network, in network byte order.
+    uint32_t netmask;
+    /// The default gateway, in network byte order.
+    uint32_t gateway;
+    /// Sends a frame, which starts at the data of the buffer, and takes ownership of the buffer.
+    int (*xmit)(struct netdev *dev, net_buf_t *buf);
+    /// The driver of the device.
+    void *priv;
+} netdev_t;
+
+/// @brief Allocates a buffer, with the data at the end of the headroom.
+/// @return the buffer, NULL if there is no memory.
+net_buf_t *net_buf_alloc(void);
+
+/// @brief Frees a buffer, and its page.
+/// @param buf the buffer.
+void net_buf_free(net_buf_t *buf);
+
+/// @brief Returns the start of the room for the data of a buffer.
+/// @param buf the buffer.
+/// @return the first byte after the buffer, inside its page.
+static inline uint8_t *net_buf_room(net_buf_t *buf) { return (uint8_t *)buf + NET_BUF_OFFSET; }
+
+/// @brief Returns the physical address of a byte of a buffer, for the devices.
+/// @param buf the buffer.
+/// @param ptr the byte, inside the page of the buffer.
+/// @return the physical address.
+static inline uintptr_t net_buf_phys(net_buf_t *buf, void *ptr)
+{
+    return buf->phys + ((uintptr_t)ptr - (uintptr_t)buf);
+}
+
+/// @brief Places a header in front of the data.
+/// @param buf the buffer.
+/// @param size the size of the header.
+/// @return the header, NULL if there is no room left.
+static inline void *net_buf_push(net_buf_t *buf, size_t size)
+{
+    if ((size_t)(buf->data - net_buf_room(buf)) < size) {
+        return NULL;
+    }
+    buf->data -= size;
+    buf->len += size;
+    return buf->data;
+}
+
+/// @brief Removes a header from the front of the data.
+/// @param buf the buffer.
+/// @param size the size of the header.
+/// @return the header, NULL if the data is shorter.
+static inline void *net_buf_pull(net_buf_t *buf, size_t size)
+{
+    if (buf->len < size) {
+        return NULL;
+    }
+    buf->data += size;
+    buf->len -= size;
+    return buf->data - size;
+}
+
+/// @brief Computes the Internet checksum.
+/// @param data the data.
+/// @param len the size of the data.
+/// @param sum the partial sum to start from (e.g., of a pseudo-header).
+/// @return the checksum, in network byte order.
+uint16_t net_checksum(const void *data, size_t len, uint32_t sum);
+
+/// @brief Computes the partial sum of the pseudo-header of TCP and UDP.
+/// @param saddr the source address.
+/// @param daddr the destination address.
+/// @param protocol the protocol.
+/// @param len the size of the segment, header included.
+/// @return the partial sum, to pass to net_checksum().
+uint32_t net_pseudo_sum(uint32_t saddr, uint32_t daddr, uint8_t protocol, uint16_t len);
+
+/// @brief Registers a network device, which gets the static configuration of
+/// the user networking of QEMU (10.0.2.15/24, through 10.0.2.2).
+/// @param dev the device, its address and its functions are set.
+/// @return 0 on success, -EBUSY if a device is already registered.
+int net_register_device(netdev_t *dev);
+
+/// @brief Hands a received frame to the stack, which takes ownership of the buffer.
+/// @param dev the device.
+/// @param buf the buffer, whose data starts at the Ethernet header.
+void net_receive(netdev_t *dev, net_buf_t *buf);
+
+/// @brief Checks if an address belongs to this host.
+/// @param addr the address, in network byte order.
+/// @return 1 if it does (the loopback network, or the address of the device), 0 otherwise.
+int net_is_local(uint32_t addr);
+
+/// @brief Returns the source address of the packets sent to a destination.
+/// @param daddr the destination, in network byte order.
+/// @return the source address, INADDR_ANY if the destination cannot be reached.
+uint32_t net_source_address(uint32_t daddr);
+
+/// @brief Sends a packet, placing the IPv4 header in front of its data.
+/// @param buf the buffer, which is always consumed.
+/// @param saddr the source address, in network byte order.
+/// @param daddr the destination address, in network byte order.
+/// @param protocol the protocol of the payload.
+/// @return 0 on success, -ENETUNREACH if the destination cannot be reached.
+int ip_send(net_buf_t *buf, uint32_t saddr, uint32_t daddr, uint8_t protocol);
+
+/// @brief Initializes the network stack.
+/// @return 0 on success.
+int net_initialize(void);
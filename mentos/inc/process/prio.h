@@ -63,8 +63,23 @@ static const int prio_to_weight[NICE_WIDTH] = {
     /* 130 */ 110,   87,    70,    56,    45,
     /* 135 */ 36,    29,    23,    18,    15};
 
+/// @brief Table of the inverses of the weights, 2^32 / weight, so that a
+///        division by a weight becomes a multiplication and a shift.
+static const unsigned int prio_to_wmult[NICE_WIDTH] = {
+    /* 100 */     48388,     59856,     76040,     92818,    118348,
+    /* 105 */    147320,    184698,    229616,    287308,    360437,
+    /* 110 */    449829,    563644,    704093,    875809,   1099582,
+    /* 115 */   1376151,   1717300,   2157191,   2708050,   3363326,
+    /* 120 */   4194304,   5237765,   6557202,   8165337,  10153587,
+    /* 125 */  12820798,  15790321,  19976592,  24970740,  31350126,
+    /* 130 */  39045157,  49367440,  61356676,  76695844,  95443717,
+    /* 135 */ 119304647, 148102320, 186737708, 238609294, 286331153};
+
 /// @brief Transforms the priority to weight.
 #define GET_WEIGHT(prio) prio_to_weight[USER_PRIO((prio))]
 
+/// @brief Transforms the priority to the inverse of its weight.
+#define GET_WMULT(prio) prio_to_wmult[USER_PRIO((prio))]
+
 /// @brief Weight of a default priority.
 #define NICE_0_LOAD GET_WEIGHT(DEFAULT_PRIO)
@@ -8,16 +8,70 @@
 #include "bits/termios-struct.h"
 #include "devices/fpu.h"
 #include "drivers/keyboard/keyboard.h"
+#include "hardware/hrtimer.h"
 #include "mem/paging.h"
+#include "process/wait.h"
 #include "stdbool.h"
+#include "sys/cache.h"
+#include "sys/resource.h"
 #include "system/signal.h"
 
 /// The maximum length of a name for a task_struct.
 #define TASK_NAME_MAX_LENGTH 100
 
-/// The default dimension of the stack of a process (1 MByte).
+/// The default dimension of the stack of a process (1 MByte), the default
+/// soft limit of RLIMIT_STACK.
 #define DEFAULT_STACK_SIZE (1 * M)
 
+/// The smallest stack a process gets, whatever its RLIMIT_STACK (64 KByte).
+#define MIN_STACK_SIZE (64 * K)
+
+/// The largest stack a process gets, whatever its RLIMIT_STACK (64 MByte).
+#define MAX_STACK_SIZE (64 * M)
+
+/// The dimension of the kernel stack of a process (64 KByte).
+#define KERNEL_THREAD_STACK_SIZE (64 * K)
+
+/// @brief The identifiers the processes are hashed by (see scheduler.c).
+typedef enum pid_type {
+    PIDTYPE_PID,  ///< The process identifier.
+    PIDTYPE_PGID, ///< The process group identifier.
+    PIDTYPE_SID,  ///< The session identifier.
+    PIDTYPE_MAX,  ///< The number of identifiers.
+} pid_type_t;
+
+/// The number of buckets of the histogram of the wake-up latencies: bucket 0
+/// counts the wake-ups followed by running within the same tick, bucket i
+/// those waiting from 2^(i-1) to 2^i - 1 ticks, the last one also the longer ones.
+#define SCHED_LATENCY_BUCKETS 8
+
+/// @brief The statistics of the scheduling of a task (see `/proc/<pid>/schedstat`),
+///        all the times are in ticks.
+typedef struct sched_statistics {
+    /// When the task last entered the queue of the runnable processes.
+    unsigned long last_queued;
+    /// When the task last started running.
+    unsigned long last_arrival;
+    /// Overall time the task spent waiting to run, once runnable.
+    unsigned long run_delay;
+    /// Overall time the task spent running.
+    unsigned long cpu_time;
+    /// How many times the task started running.
+    unsigned long pcount;
+    /// How many times the task gave up the CPU, to wait for something.
+    unsigned long nvcsw;
+    /// How many times the task was preempted, or yielded the CPU.
+    unsigned long nivcsw;
+    /// If the task has been woken up, and has not run since then.
+    bool_t woken;
+    /// When the task was last woken up, in nanoseconds.
+    uint64_t woken_ns;
+    /// The histogram of the delays between waking up and running.
+    unsigned long wakeup_latency[SCHED_LATENCY_BUCKETS];
+    /// The longest delay between waking up and running, in microseconds.
+    unsigned long wakeup_max;
+} sched_statistics_t;
+
 /// @brief This structure is used to track the statistics of a process.
 /// @details
 /// While the other variables also play a role in
@@ -30,11 +84,16 @@
 /// The nice value range is -20 to +19 where -20 is highest, 0 default and +19
 /// is lowest. relation between nice value and priority is : PR = 20 + NI.
 typedef struct sched_entity {
+    // The fields used to pick the next task, and to account the time it
+    // runs, come first.
+
     /// Static execution priority.
     int prio;
-
-    /// Start execution time.
-    time_t start_runtime;
+    /// Scheduling policy, which tells the scheduling class of the task.
+    int policy;
+    /// Used to place the task inside the queue of its scheduling class, or of
+    /// its priority (see SCHEDULER_O1).
+    list_head_t prio_list;
     /// Last context switch time.
     time_t exec_start;
     /// Last execution time.
@@ -44,6 +103,15 @@ typedef struct sched_entity {
     /// Weighted execution time.
     time_t vruntime;
 
+    /// The priority set through the system calls, prio differs from it while
+    /// the task inherits the one of a task waiting for one of its locks.
+    int normal_prio;
+    /// The policy set through the system calls, policy differs from it while
+    /// the task inherits the one of a task waiting for one of its locks.
+    int normal_policy;
+    /// Start execution time.
+    time_t start_runtime;
+
     /// Expected period of the task
     time_t period;
     /// Absolute deadline
@@ -62,16 +130,43 @@ typedef struct sched_entity {
     time_t worst_case_exec;
     /// Processor utilization factor
     double utilization_factor;
+    /// Used to place the task inside the list of the periodic ones, sorted by period.
+    list_head_t periodic_list;
+
+    /// The task whose policy, priority and deadline are inherited, the one
+    /// coming first among those waiting, even through other owners, for the
+    /// priority-inheritance locks held by this one. NULL if none comes before it.
+    struct task_struct *pi_donor;
+    /// The tasks waiting for the priority-inheritance locks held by this one.
+    list_head_t pi_waiters;
+    /// Used to place the task inside the pi_waiters of the owner of its lock.
+    list_head_t pi_list;
+    /// The owner of the lock the task waits for, NULL if it is not waiting.
+    struct task_struct *pi_owner;
+    /// Identifies the lock the task waits for.
+    uint32_t pi_key;
+
+    /// The statistics of the scheduling of the task, kept by the scheduler.
+    sched_statistics_t stats;
 } sched_entity_t;
 
 /// @brief Stores the status of CPU and FPU registers.
 typedef struct thread_struct {
+    /// The kernel stack pointer saved when the task has been suspended inside
+    /// the kernel, 0 if the task resumes from the registers stored in `regs`.
+    uintptr_t kernel_esp;
+    /// The stack used by the task while it is running inside the kernel.
+    void *kernel_stack;
+    /// Where the thread-local storage starts, the base of the TLS segment of the GDT.
+    uintptr_t tls_base;
+    /// The counter of the sections which cannot give up the CPU (see preempt.h), while switched out.
+    unsigned int preempt_count;
+    /// Determines if the FPU is enabled.
+    bool_t fpu_enabled;
     /// Stored status of registers.
     pt_regs_t regs;
     /// Stored status of registers befor jumping into a signal handler.
     pt_regs_t signal_regs;
-    /// Determines if the FPU is enabled.
-    bool_t fpu_enabled;
     /// Data structure used to save FPU registers.
     savefpu fpu_register;
 } thread_struct_t;
@@ -80,8 +175,29 @@ typedef struct thread_struct {
 /// it holds a lot of information. It’ll hold mm information, it’s name,
 /// statistics, etc..
 typedef struct task_struct {
-    /// The pid of the process.
+    // The fields used on every tick, and on every context switch, come first,
+    // so that they share the first lines of the cache.
+
+    // -1 unrunnable, 0 runnable, >0 stopped.
+    /// The current state of the process:
+    __volatile__ long state;
+    /// The pid of the process, the id of the thread for the threads.
     pid_t pid;
+    /// Used to place the task inside the queue of the runnable processes.
+    list_head_t run_list;
+    /// Task's segments.
+    mm_struct_t *mm;
+    /// Ticks spent running in user mode, those of the released threads included.
+    unsigned long utime;
+    /// Ticks spent running inside the kernel, those of the released threads included.
+    unsigned long stime;
+    /// For scheduling algorithms.
+    sched_entity_t se;
+    /// The context of the processors.
+    thread_struct_t thread;
+
+    /// The id of the thread group, the pid of its first thread (see CLONE_THREAD).
+    pid_t tgid;
     /// The session id of the process
     pid_t sid;
     /// The Process Group Id of the process
@@ -94,31 +210,54 @@ typedef struct task_struct {
     uid_t ruid;
     /// The effective User ID (UID) of the process.
     uid_t uid;
-    // -1 unrunnable, 0 runnable, >0 stopped.
-    /// The current state of the process:
-    __volatile__ long state;
-    /// The current opened file descriptors
-    vfs_file_descriptor_t *fd_list;
-    /// The maximum supported number of file descriptors
-    int max_fd;
+    /// The file descriptors, shared by the threads created with CLONE_FILES.
+    files_struct_t *files;
+    /// The wait queues the task is polling on (see fs/poll.h), allocated on the first poll.
+    struct poll_table *poll_table;
+    /// The hardware events counted while the task runs (see hardware/pmu.h), allocated on the first one.
+    struct perf_context *perf;
     /// Pointer to process's parent.
     struct task_struct *parent;
-    /// List head for scheduling purposes.
-    list_head_t run_list;
+    /// Used to place the task inside the list of all the processes.
+    list_head_t tasks;
+    /// Used to place the task inside the hash tables of the processes, one
+    /// for each identifier (see pid_type_t).
+    list_head_t pid_links[PIDTYPE_MAX];
     /// List of children traced by the process.
     list_head_t children;
-    /// List of siblings, namely processes created by parent process.
+    /// List of siblings, namely processes created by parent process. The
+    /// threads are not on it, it links them to the terminated ones instead.
     list_head_t sibling;
-    /// The context of the processors.
-    thread_struct_t thread;
-    /// For scheduling algorithms.
-    sched_entity_t se;
+    /// The first thread of the thread group.
+    struct task_struct *group_leader;
+    /// Used to place the task inside the ring of the threads of its group.
+    list_head_t thread_group;
+    /// Where the process sleeps while waiting for its children to terminate.
+    wait_queue_head_t wait_chldexit;
     /// Exit code of the process. (parameter of _exit() system call).
     int exit_code;
+    /// The signal sent to the parent once the task terminates, 0 for the threads.
+    int exit_signal;
+    /// Cleared, and woken up as a futex, once the task terminates (see CLONE_CHILD_CLEARTID).
+    int *clear_child_tid;
+    /// Ticks spent in user mode by the children the process waited for, and by their own.
+    unsigned long cutime;
+    /// Ticks spent inside the kernel by the children the process waited for, and by their own.
+    unsigned long cstime;
+    /// Page faults handled without reading from a file or the swap area, those of the released threads included.
+    unsigned long min_flt;
+    /// Page faults which had to read from a file or the swap area, those of the released threads included.
+    unsigned long maj_flt;
+    /// Minor page faults of the children the process waited for, and of their own.
+    unsigned long cmin_flt;
+    /// Major page faults of the children the process waited for, and of their own.
+    unsigned long cmaj_flt;
+    /// The limits of the resources of the process (see setrlimit()), inherited by its children.
+    struct rlimit rlim[RLIM_NLIMITS];
     /// The name of the task (Added for debug purpose).
     char name[TASK_NAME_MAX_LENGTH];
-    /// Task's segments.
-    mm_struct_t *mm;
+    /// The parent sleeping inside vfork(), while the task borrows its segments.
+    struct task_struct *vfork_parent;
     /// Task's specific error number.
     int error_no;
     /// The current working directory.
@@ -126,8 +265,9 @@ typedef struct task_struct {
 
     /// Address of the LIBC sigreturn function.
     uint32_t sigreturn_addr;
-    /// Pointer to the process’s signal handler descriptor
-    sighand_t sighand;
+    /// Pointer to the process’s signal handler descriptor, shared by the threads
+    /// created with CLONE_SIGHAND.
+    sighand_t *sighand;
     /// Mask of blocked signals.
     sigset_t blocked;
     /// Temporary mask of blocked signals (used by the rt_sigtimedwait() system call)
@@ -136,14 +276,26 @@ typedef struct task_struct {
     sigset_t saved_sigmask;
     /// Data structure storing the private pending signals
     sigpending_t pending;
+    /// The signals sent to the whole thread group, those of the group leader
+    /// are shared by its threads.
+    sigpending_t shared_pending;
+    /// The queued signals preallocated for the task.
+    sigqueue_t sigqueue_pool[SIGQUEUE_POOL_SIZE];
+    /// The entries of the pool which are not queued (sigqueue_t).
+    list_head_t sigqueue_free;
+    /// The number of signals queued to the task, limited by RLIMIT_SIGPENDING.
+    unsigned long sigqueue_count;
 
-    /// Timer for alarm syscall.
-    struct timer_list *real_timer;
+    /// High-resolution timer of the alarm syscall, and of ITIMER_REAL.
+    hrtimer_t real_timer;
+    /// High-resolution timer which wakes up the process from nanosleep().
+    hrtimer_t sleep_timer;
+    /// Nanoseconds the sleeps of the process can be delayed by, so that they
+    /// expire along with other timers (see prctl(PR_SET_TIMERSLACK)).
+    uint32_t timer_slack_ns;
 
-    /// Next value for the real timer (ITIMER_REAL).
-    unsigned long it_real_incr;
-    /// Current value for the real timer (ITIMER_REAL).
-    unsigned long it_real_value;
+    /// Nanoseconds between two expirations of the real timer (ITIMER_REAL).
+    uint64_t it_real_incr;
     /// Next value for the virtual timer (ITIMER_VIRTUAL).
     unsigned long it_virt_incr;
     /// Current value for the virtual timer (ITIMER_VIRTUAL).
@@ -162,10 +314,9 @@ typedef struct task_struct {
     // - task's attributes:
     // struct task_struct __rcu	*real_parent;
     // int exit_state;
-    // int exit_signal;
     // struct thread_info thread_info;
     //==========================================================================
-} task_struct;
+} __cacheline_aligned task_struct;
 
 /// @brief Initialize the task management.
 /// @return 1 success, 0 failure.
@@ -176,9 +327,36 @@ int init_tasking(void);
 /// @return 0 on success, 1 on failure.
 int process_create_init(const char *path);
 
+/// @brief Creates a kernel thread, a task without segments which runs only
+///        inside the kernel, and makes it runnable. The thread exits once the
+///        function returns, with its return value as exit status.
+/// @details Kernel threads are children of init, which reaps them, and they
+/// ignore the signals. They are never preempted, they should call
+/// scheduler_yield() once scheduler_need_resched() tells them to.
+/// @param threadfn the function run by the thread.
+/// @param data the argument of the function.
+/// @param name the name of the thread.
+/// @return the thread, NULL on failure.
+task_struct *kthread_create(int (*threadfn)(void *data), void *data, const char *name);
+
+/// @brief Sends a SIGKILL to the other threads of the group of a task.
+/// @param task the task.
+void zap_other_threads(task_struct *task);
+
+/// @brief Frees a task which is not running anymore, and which nobody waits
+///        for: its pid, its file descriptors, its signal handlers, and its
+///        kernel stack. The memory is released by the task itself, once it exits.
+/// @param task the task.
+void process_release(task_struct *task);
+
 /// @brief Get a file structure from a file descriptor.
 /// @param fd the file descriptor.
 /// @return Returns the file structure corresponding to the given file
 /// descriptor or NULL if the file descriptor is invalid or the file has been
 /// closed.
 vfs_file_descriptor_t *fget(int fd);
+
+/// @brief Gives the segments borrowed by a task created with vfork() back to
+///        its parent, and wakes the parent up.
+/// @param task the task, which is either replacing its image or exiting.
+void process_vfork_release(task_struct *task);
@@ -8,21 +8,63 @@
 #include "list_head.h"
 #include "process/process.h"
 #include "stddef.h"
+#include "sys/cache.h"
 
 /// @brief Define the maximum number of processes your OS will support.
 #define MAX_PROCESSES 256
 
+/// @brief The scheduling policies, each one handled by a scheduling class.
+/// The classes are ordered: a process runs only when no process of the
+/// classes before its own can run.
+#define SCHED_OTHER    0 ///< The default class, handled by the algorithm chosen at build time.
+#define SCHED_FIFO     1 ///< Real-time class, runs until it stops or a higher priority process wakes up.
+#define SCHED_RR       2 ///< Real-time class, takes turns with the processes of the same priority.
+#define SCHED_IDLE     5 ///< Runs only when no other process can run.
+#define SCHED_DEADLINE 6 ///< Periodic processes, the one with the earliest deadline runs first.
+
+/// @brief The activity of a CPU since boot, shown by `/proc/stat`.
+typedef struct cpu_stat {
+    /// Ticks spent by the CPU running processes in user mode.
+    unsigned long user_ticks;
+    /// Ticks spent by the CPU running processes in kernel mode.
+    unsigned long system_ticks;
+    /// Ticks spent by the CPU inside the idle task.
+    unsigned long idle_ticks;
+    /// Ticks spent inside the idle task, while processes waited uninterruptibly (e.g., for I/O).
+    unsigned long iowait_ticks;
+    /// Number of context switches.
+    unsigned long switches;
+    /// Number of processes, and threads, created.
+    unsigned long forks;
+} cpu_stat_t;
+
 /// @brief Structure that contains information about live processes.
 typedef struct runqueue {
-    /// Number of queued processes.
-    size_t num_active;
-    /// Number of queued periodic processes.
-    size_t num_periodic;
-    /// Queue of processes.
-    list_head_t queue;
+    // The fields read on every tick, and on every return to user mode, share
+    // the first line of the cache.
+
     /// The current running process.
     task_struct *curr;
-} runqueue_t;
+    /// If the next process must be picked before returning to user mode.
+    bool_t need_resched;
+    /// Number of processes inside the queue of the runnable ones.
+    size_t num_running;
+    /// Queue of the runnable processes. The current process leaves it only
+    /// once another one is picked, it might be sleeping meanwhile.
+    list_head_t queue;
+    /// Number of processes.
+    size_t num_active;
+    /// Number of periodic processes.
+    size_t num_periodic;
+    /// List of all the processes.
+    list_head_t tasks;
+    /// List of the periodic processes, sorted by increasing period.
+    list_head_t periodic;
+    /// Sum of the utilization factors of the periodic processes.
+    double utilization;
+    /// The activity of the CPU since boot.
+    cpu_stat_t stat;
+} __cacheline_aligned runqueue_t;
 
 /// @brief Structure that describes scheduling parameters.
 typedef struct sched_param {
@@ -69,10 +111,97 @@ void scheduler_enqueue_task(task_struct *process);
 /// @param process Process that has to be activated.
 void scheduler_dequeue_task(task_struct *process);
 
+/// @brief Sets the state of a sleeping process, and places it back on the
+///        queue of the runnable processes, if the state is TASK_RUNNING.
+/// @param process The process.
+/// @param state The new state of the process.
+void scheduler_wake_up_task(task_struct *process, unsigned state);
+
+/// @brief Makes a task wait for a priority-inheritance lock: its owner, and
+///        the owners of the locks it waits for in turn, run with the policy
+///        and the priority (or the deadline) of the task if they come first.
+/// @param task The task, about to sleep.
+/// @param owner The owner of the lock.
+/// @param key Identifies the lock, among those held by the owner.
+void scheduler_pi_wait(task_struct *task, task_struct *owner, uint32_t key);
+
+/// @brief Stops a task from waiting for its priority-inheritance lock, e.g.,
+///        because of a signal, the owner loses what it inherited from it.
+/// @param task The task.
+void scheduler_pi_cancel(task_struct *task);
+
+/// @brief Hands a priority-inheritance lock over to one of its waiters,
+///        which stops waiting, while the others now wait for it.
+/// @param owner The owner of the lock.
+/// @param next The new owner, NULL if the lock is released.
+/// @param key Identifies the lock.
+void scheduler_pi_handover(task_struct *owner, task_struct *next, uint32_t key);
+
+/// @brief Checks if a task comes before another one, including what both
+///        of them inherit, used to pick the waiter a lock is handed over to.
+/// @param task The task.
+/// @param other The other task.
+/// @return true if the task runs first, false otherwise.
+bool_t scheduler_pi_precedes(task_struct *task, task_struct *other);
+
+/// @brief Accounts ticks to the time spent by the CPU in user mode, in kernel
+///        mode, or idle, when the idle task is running.
+/// @param user If the ticks interrupted the CPU in user mode.
+/// @param ticks The number of ticks.
+void scheduler_account_ticks(bool_t user, unsigned long ticks);
+
+/// @brief Returns the ticks spent by the CPU since boot.
+/// @param user Where the ticks spent in user mode are stored.
+/// @param system Where the ticks spent in kernel mode are stored.
+/// @param idle Where the ticks spent idle are stored.
+void scheduler_get_cpu_ticks(unsigned long *user, unsigned long *system, unsigned long *idle);
+
+/// @brief Returns the activity of a CPU since boot.
+/// @param cpu The index of the CPU.
+/// @param stat Where the activity is stored.
+/// @return 0 on success, -1 if the CPU does not exist.
+int scheduler_get_cpu_stat(unsigned int cpu, cpu_stat_t *stat);
+
+/// @brief Counts the processes which are runnable, and those waiting uninterruptibly.
+/// @param running Where the number of runnable processes is stored.
+/// @param blocked Where the number of processes waiting uninterruptibly is stored.
+void scheduler_get_task_counts(size_t *running, size_t *blocked);
+
+/// @brief Accounts the creation of a process, or a thread, to the current CPU.
+void scheduler_account_fork(void);
+
+/// @brief Asks to pick the next process before returning to user mode.
+void scheduler_set_need_resched(void);
+
+/// @brief Checks if scheduler_run has something to do before returning to
+///        user mode: picking the next process, because the current one
+///        stopped running or was asked to, or handling its pending signals.
+/// @return true if scheduler_run must be called, false otherwise.
+bool_t scheduler_need_resched(void);
+
 /// @brief The RR implementation of the scheduler.
 /// @param f The context of the process.
 void scheduler_run(pt_regs_t *f);
 
+/// @brief Gives the CPU to the other processes, until the current one is
+///        woken up. The caller sets the state of the process to a sleeping
+///        one, and the process resumes from here, inside the kernel, once its
+///        state is back to TASK_RUNNING.
+void schedule(void);
+
+/// @brief Gives the CPU to the next process, from inside the kernel, while
+///        the current one stays runnable. Kernel threads are never preempted,
+///        they call it once scheduler_need_resched() tells them to.
+void scheduler_yield(void);
+
+/// @brief Gives the CPU to the next process if the current one should be
+///        rescheduled, and can be: it is the point where the long operations
+///        of the kernel let the others run, since the kernel is not preempted.
+/// @details It does nothing while preemption is disabled (see preempt.h), and
+///          from the idle task. The caller must be able to sleep.
+/// @return 1 if the CPU has been given to another process, 0 otherwise.
+int cond_resched(void);
+
 /// @brief Values from pt_regs to task_struct process.
 /// @param f       The set of registers we are saving.
 /// @param process The process for which we are saving the CPU registers status.
@@ -83,11 +212,42 @@ void scheduler_store_context(pt_regs_t *f, task_struct *process);
 /// @param f       The set of registers we are restoring.
 void scheduler_restore_context(task_struct *process, pt_regs_t *f);
 
+/// @brief Returns the registers a process had in user mode, when it last
+///        entered the kernel.
+/// @param process The process.
+/// @return The registers.
+pt_regs_t *scheduler_get_user_regs(task_struct *process);
+
 /// @brief Switch CPU to user mode and start running that given process.
 /// @param location The instruction pointer of the process we are starting.
 /// @param stack    Address of the stack of that process.
 void scheduler_enter_user_jmp(uintptr_t location, uintptr_t stack);
 
+/// @brief Places a process, which entered the queue of the runnable ones,
+///        inside the structures of the scheduling algorithm (in scheduler_algorithm.c).
+/// @param process The process.
+void scheduler_algorithm_enqueue(task_struct *process);
+
+/// @brief Removes a process, which left the queue of the runnable ones, from
+///        the structures of the scheduling algorithm (in scheduler_algorithm.c).
+/// @param process The process.
+void scheduler_algorithm_dequeue(task_struct *process);
+
+/// @brief Checks if a process which entered the queue of the runnable ones
+///        should preempt the current one (in scheduler_algorithm.c).
+/// @param curr The current process.
+/// @param woken The process which entered the queue.
+/// @return true if the woken process should run first, false otherwise.
+bool_t scheduler_algorithm_check_preempt(task_struct *curr, task_struct *woken);
+
+/// @brief Checks if a process comes before another one, according to the
+///        policies and priorities set through the system calls (in
+///        scheduler_algorithm.c).
+/// @param process The process.
+/// @param other The other process.
+/// @return true if the process runs first, false otherwise.
+bool_t scheduler_algorithm_precedes(task_struct *process, task_struct *other);
+
 /// @brief Picks the next task (in scheduler_algorithm.c).
 /// @param runqueue   Pointer to the runqueue.
 /// @return The next task to execute.
@@ -105,10 +265,32 @@ int sys_sched_setparam(pid_t pid, const sched_param_t *param);
 /// @return 1 on success, -1 on error.
 int sys_sched_getparam(pid_t pid, sched_param_t *param);
 
+/// @brief Sets the scheduling policy and parameters of the given process.
+/// @param pid    ID of the process we are manipulating, 0 for the current one.
+/// @param policy The new policy.
+/// @param param  New parameters.
+/// @return 0 on success, a negative value on failure.
+int sys_sched_setscheduler(pid_t pid, int policy, const sched_param_t *param);
+
+/// @brief Gets the scheduling policy of the given process.
+/// @param pid ID of the process we are manipulating, 0 for the current one.
+/// @return The policy on success, a negative value on failure.
+int sys_sched_getscheduler(pid_t pid);
+
+/// @brief Gives the CPU to the other processes, on the way back to user mode.
+/// @return 0 on success.
+int sys_sched_yield(void);
+
 /// @brief Puts the process on wait until its next period starts.
 /// @return 0 on success, a negative value on failure.
 int sys_waitperiod(void);
 
+/// @brief Returns the processes of a process group, one after the other.
+/// @param pgid The process group.
+/// @param prev The process returned by the previous call, NULL for the first one.
+/// @return The next process of the group, NULL if there are no more processes.
+task_struct *scheduler_get_pgrp_process(pid_t pgid, task_struct *prev);
+
 /// @brief Returns 1 if the given group is orphaned, the session leader of the group
 /// is no longer alive.
 /// @param gid ID of the group
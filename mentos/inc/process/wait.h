@@ -49,8 +49,8 @@
 /// @defgroup WaitQueueFlags Wait Queue Flags
 /// @{
 
-/// @brief When an entry has this flag is added to the end of the wait queue.
-///        Entries without that flag are, instead, added to the beginning.
+/// @brief The entry is an exclusive waiter, wake_up_nr() wakes up only a
+///        limited number of them, while the others are all woken up.
 #define WQ_FLAG_EXCLUSIVE 0x01
 //#define WQ_FLAG_WOKEN     0x02
 //#define WQ_FLAG_BOOKMARK  0x04
@@ -104,6 +104,11 @@ void wait_queue_entry_init(wait_queue_entry_t *entry, struct task_struct *task);
 /// @param entry The entry we insert inside the waiting queue.
 void add_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *entry);
 
+/// @brief Adds the element to the waiting queue, as an exclusive waiter.
+/// @param head The head of the waiting queue.
+/// @param entry The entry we insert inside the waiting queue.
+void add_wait_queue_exclusive(wait_queue_head_t *head, wait_queue_entry_t *entry);
+
 /// @brief Removes the element from the waiting queue.
 /// @param head The head of the waiting queue.
 /// @param entry The entry we remove from the waiting queue.
@@ -123,3 +128,30 @@ int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync);
 /// @return Pointer to the entry inside the wq representing the
 ///         sleeping process.
 wait_queue_entry_t *sleep_on(wait_queue_head_t *head);
+
+/// @brief Puts the current process to sleep on the specified wait queue, and
+///        gives the CPU to the other processes until it is woken up, or a
+///        signal interrupts the sleep.
+/// @param head Waitqueue where to sleep.
+/// @return 0 once woken up, -EINTR if a signal is pending.
+int interruptible_sleep_on(wait_queue_head_t *head);
+
+/// @brief Same as interruptible_sleep_on(), but the process sleeps as an
+///        exclusive waiter, see wake_up_nr().
+/// @param head Waitqueue where to sleep.
+/// @return 0 once woken up, -EINTR if a signal is pending.
+int interruptible_sleep_on_exclusive(wait_queue_head_t *head);
+
+/// @brief Wakes up the processes sleeping on the specified wait queue: all
+///        the non-exclusive waiters, and at most `nr_exclusive` exclusive
+///        ones. A woken up exclusive waiter which cannot make progress must
+///        pass the wake-up on.
+/// @param head Waitqueue to wake up.
+/// @param nr_exclusive The number of exclusive waiters to wake up, 0 for all.
+void wake_up_nr(wait_queue_head_t *head, unsigned int nr_exclusive);
+
+/// @brief Wakes up all the processes sleeping on the specified wait queue,
+///        exclusive waiters included. The entries whose wake function
+///        succeeds are removed from the queue, and freed.
+/// @param head Waitqueue to wake up.
+void wake_up(wait_queue_head_t *head);
@@ -0,0 +1,82 @@
+/// @file workqueue.h
+/// @brief Work deferred to kernel threads.
+/// @details
+/// Interrupt handlers and timers queue the work which is too long to run in
+/// interrupt context, or which has to sleep, on a workqueue. Each workqueue
+/// has a list of work, and a kernel thread running it, for each CPU; the work
+/// runs on the CPU which queued it.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "hardware/smp.h"
+#include "list_head.h"
+#include "process/wait.h"
+
+struct work_struct;
+struct task_struct;
+
+/// @brief The function run by a work.
+/// @param work the work, usually embedded inside the data it works on.
+typedef void (*work_func_t)(struct work_struct *work);
+
+/// @brief A function to run from a kernel thread.
+typedef struct work_struct {
+    /// Used to place the work inside the list of its workqueue.
+    list_head_t entry;
+    /// The function to run.
+    work_func_t func;
+    /// If the work is queued, and has not started yet.
+    bool_t pending;
+} work_struct_t;
+
+/// @brief The work queued on a CPU, and the kernel thread running it.
+typedef struct cpu_workqueue {
+    /// The work waiting to run, in the order it has been queued.
+    list_head_t worklist;
+    /// Where the worker sleeps while there is no work.
+    wait_queue_head_t more_work;
+    /// The kernel thread running the work.
+    struct task_struct *worker;
+} cpu_workqueue_t;
+
+/// @brief A workqueue, with a worker for each CPU.
+typedef struct workqueue {
+    /// The name of the workqueue, the workers are called `<name>/<cpu>`.
+    const char *name;
+    /// The work and the worker of each CPU.
+    DEFINE_PER_CPU(cpu_workqueue_t, cpu_wq);
+} workqueue_t;
+
+/// @brief Prepares a work, which can then be queued.
+/// @param work the work.
+/// @param func the function run by the work.
+static inline void init_work(work_struct_t *work, work_func_t func)
+{
+    list_head_init(&work->entry);
+    work->func    = func;
+    work->pending = false;
+}
+
+/// @brief Initializes the workqueues, and creates the one of the system.
+/// @return 0 on success, -1 on failure.
+int workqueue_initialize(void);
+
+/// @brief Creates a workqueue, and starts its workers.
+/// @param name the name of the workqueue, which must outlive it.
+/// @return the workqueue, NULL on failure.
+workqueue_t *create_workqueue(const char *name);
+
+/// @brief Queues a work on the CPU of the caller, it can be called from
+///        interrupt context.
+/// @param wq the workqueue.
+/// @param work the work.
+/// @return true if the work has been queued, false if it was already pending.
+bool_t queue_work(workqueue_t *wq, work_struct_t *work);
+
+/// @brief Queues a work on the workqueue of the system.
+/// @param work the work.
+/// @return true if the work has been queued, false if it was already pending,
+///         or if the workqueues are not initialized yet.
+bool_t schedule_work(work_struct_t *work);
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include "stddef.h"
+
 /// @brief Initializes the resource registry and tracker.
 void resource_register_init(void);
 
@@ -23,18 +25,22 @@ const char *get_resource_name(int id);
 /// @return 0 on success, or -1 if the resource ID was not found.
 int unregister_resource(int id);
 
-/// @brief Prints the current registry of resources.
+/// @brief Prints the current registry of resources, with the objects each
+///        one has allocated (live, peak and bytes).
 void print_resource_registry(void);
 
 /// @brief Adds a resource to the tracking system.
+/// @details The resources are hashed by their pointer, so that tracking
+/// them costs the same regardless of how many are allocated.
 /// @param resource_id The ID of the resource associated with the resource allocation.
 /// @param file The file where the resource was allocated.
 /// @param line The line number where the resource was allocated.
 /// @param ptr The pointer or handle to the resource.
-void store_resource_info(int resource_id, const char *file, int line, void *ptr);
+/// @param size The size of the resource, in bytes.
+void store_resource_info(int resource_id, const char *file, int line, void *ptr, size_t size);
 
 /// @brief Removes a resource from the tracking system.
-/// @param ptr The pointer or handle to the resource to remove.
+/// @param ptr The pointer or handle to the resource to remove, ignored if it is not tracked.
 void clear_resource_info(void *ptr);
 
 /// @brief Checks and prints resource usage for a specific resource ID.
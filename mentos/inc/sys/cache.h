@@ -0,0 +1,18 @@
+/// @file cache.h
+/// @brief The size of the lines of the cache, and the alignment to them.
+/// @details
+/// Data written often, such as the state kept for each CPU, is aligned to a
+/// line of the cache, so that writing it does not evict from the cache of the
+/// other CPUs the unrelated data which would otherwise share its line, and so
+/// that the most accessed fields of a structure placed at its beginning are
+/// read with a single miss.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+/// The size of a line of the L1 data cache.
+#define L1_CACHE_BYTES 64U
+
+/// @brief Aligns a variable, or each instance of a type, to a line of the cache.
+#define __cacheline_aligned __attribute__((aligned(L1_CACHE_BYTES)))
@@ -0,0 +1,76 @@
+/// @file initcall.h
+/// @brief Initialization functions registered by the subsystems, and run by
+///        the kernel at the right moment of the boot.
+/// @details
+/// A subsystem registers its initialization function with one of the macros
+/// below, placing it inside the `.initcalls` section, instead of having kmain
+/// call it. The functions of a level run one after the other, in link order,
+/// when kmain reaches that level; a function can also depend on another one,
+/// by name, and then runs only once the other has succeeded. The deferred
+/// functions run once init has started, each one inside a kernel thread of
+/// its own, which is where the slow probing of the devices belongs. The time
+/// taken by each function is logged.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdint.h"
+
+/// @brief The levels of the initialization functions, in the order they run.
+typedef enum initcall_level {
+    INITCALL_FS,       ///< Once the root, procfs and tmpfs are mounted.
+    INITCALL_DEVICE,   ///< Right after, still before init is created.
+    INITCALL_DEFERRED, ///< Inside kernel threads, once init has started.
+} initcall_level_t;
+
+/// @brief The state of an initialization function.
+typedef enum initcall_state {
+    INITCALL_PENDING, ///< It has not run yet.
+    INITCALL_RUNNING, ///< It is running, or its thread has been created.
+    INITCALL_DONE,    ///< It has succeeded.
+    INITCALL_FAILED,  ///< It has failed, or one of its dependencies has.
+} initcall_state_t;
+
+/// @brief An initialization function, laid out by the linker inside `.initcalls`.
+typedef struct initcall {
+    /// The name of the function.
+    const char *name;
+    /// The function, it returns 0 on success.
+    int (*fn)(void);
+    /// The name of the function which must succeed first, NULL if none.
+    const char *depends;
+    /// The level of the function.
+    initcall_level_t level;
+    /// The state of the function.
+    initcall_state_t state;
+    /// The time the function took, in microseconds.
+    uint32_t duration;
+} __attribute__((aligned(16))) initcall_t;
+
+/// @brief Registers an initialization function.
+/// @param function the function, `int function(void)`.
+/// @param lvl the level of the function.
+/// @param dependency the name of the function which must succeed first, NULL if none.
+#define initcall(function, lvl, dependency)                                                                            \
+    static initcall_t __initcall_##function __attribute__((section(".initcalls"), used)) = {                           \
+        #function, function, dependency, lvl, INITCALL_PENDING, 0}
+
+/// Registers a function run once the core filesystems are mounted.
+#define fs_initcall(function, dependency)       initcall(function, INITCALL_FS, dependency)
+/// Registers a function run before init is created.
+#define device_initcall(function, dependency)   initcall(function, INITCALL_DEVICE, dependency)
+/// Registers a function run inside a kernel thread, once init has started.
+#define deferred_initcall(function, dependency) initcall(function, INITCALL_DEFERRED, dependency)
+
+/// @brief Runs the functions of a level, those which cannot run because of
+///        a dependency are marked as failed.
+/// @param level the level, either INITCALL_FS or INITCALL_DEVICE.
+/// @return the number of functions which failed.
+int initcall_run_level(initcall_level_t level);
+
+/// @brief Starts a kernel thread for each deferred function whose
+///        dependencies are satisfied, the others are started by the thread of
+///        their dependency, once it succeeds.
+/// @return the number of threads which could not be created.
+int initcall_run_deferred(void);
@@ -0,0 +1,39 @@
+/// @file profile.h
+/// @brief Sampling profiler, driven by the timer interrupt.
+/// @details
+/// While the profiler is enabled, each tick records where it interrupted the
+/// CPU (the instruction pointer, the privilege level and the current process)
+/// inside a ring of the CPU, which keeps the most recent samples. The file
+/// `/proc/profile` lists them, one per line, as `cpu cpl eip pid`, with the
+/// instruction pointer in hexadecimal; writing `1` to it clears the rings and
+/// starts the sampling, writing `0` stops it. The samples are symbolized in
+/// user space, against the symbol table of the kernel (see `kprof`).
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/vfs_types.h"
+#include "kernel.h"
+
+/// The number of samples kept for each CPU, the oldest ones are overwritten.
+#define PROFILE_RING_SIZE 8192U
+
+/// @brief Records where the tick interrupted the CPU, if the profiler is enabled.
+/// @param f the interrupt stack frame.
+void profile_tick(pt_regs_t *f);
+
+/// @brief Reads the samples, one per line.
+/// @param file the open file, which owns the streaming state.
+/// @param buf the buffer where the samples are placed.
+/// @param offset the offset from which we start reading.
+/// @param nbyte the number of bytes to read.
+/// @return the number of bytes read, or -errno on failure.
+ssize_t profile_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte);
+
+/// @brief Starts (`1`), or stops (`0`), the sampling.
+/// @param command the command.
+/// @param size the length of the command.
+/// @return 0 on success, -EINVAL if the command is not valid, -ENOMEM if the
+///         rings cannot be allocated.
+int profile_control(const char *command, size_t size);
@@ -8,8 +8,11 @@
 #include "klib/spinlock.h"
 #include "klib/stdatomic.h"
 #include "list_head.h"
+#include "process/wait.h"
 #include "system/syscall.h"
 
+struct task_struct;
+
 /// @brief Signal codes.
 typedef enum {
     SIGHUP  = 1, ///< Hang up detected on controlling terminal or death of controlling process.
@@ -44,7 +47,9 @@ typedef enum {
     SIGPROF   = 29, ///< Profiling timer expired.
     SIGXCPU   = 30, ///< CPU time limit exceeded.
     SIGXFSZ   = 31, ///< File size limit exceeded.
-    NSIG      = 32
+    SIGRTMIN  = 32, ///< The first real-time signal, real-time signals are queued.
+    SIGRTMAX  = 63, ///< The last real-time signal.
+    NSIG      = 64
 } signal_type_t;
 
 /// @brief Codes that indentify the sender of a signal.
@@ -191,6 +196,8 @@ typedef struct sighand {
     sigaction_t action[NSIG];
     /// Spinlock protecting both the signal descriptor and the signal handler descriptor.
     spinlock_t siglock;
+    /// The tasks waiting for a signal to arrive, inside sigtimedwait() or on a signalfd.
+    wait_queue_head_t signal_wait;
 } sighand_t;
 
 /// @brief Data passed with signal info.
@@ -221,24 +228,35 @@ typedef struct siginfo {
     int si_band;
 } siginfo_t;
 
+/// The number of queued signals each task keeps preallocated.
+#define SIGQUEUE_POOL_SIZE 8
+/// The default limit of the signals queued to a task (RLIMIT_SIGPENDING).
+#define SIGQUEUE_MAX       1024
+
+/// The entry belongs to the pool of its task, and it is not freed.
+#define SIGQUEUE_PREALLOC 1
+
 /// @brief An entry of the signal queue.
 typedef struct sigqueue {
-    /// Links for the pending signal queue’s list.
+    /// Links for the pending signal queue's list, or for the pool of the task.
     list_head_t list;
-    /// Flags associated with the queued signal.
+    /// Flags associated with the queued signal (SIGQUEUE_PREALLOC).
     int flags;
     /// Describes the event that raised the signal.
     siginfo_t info;
-    // Pointer to the user data structure of the process’s owner.
-    //struct user_struct *user;
 } sigqueue_t;
 
-/// @brief Keeps information of pending signals.
+/// @brief Keeps information of pending signals. A standard signal sent while
+/// it is still pending is merged with it, and keeps the information of its
+/// first occurrence; real-time signals are queued, each with its own
+/// information, and are delivered in the order they were sent.
 typedef struct sigpending {
-    /// Head of the list of pending signals.
-    list_head_t list;
     /// The mask which can be queried to know which signals are pending.
     sigset_t signal;
+    /// The information of each pending standard signal, indexed by the signal minus one.
+    siginfo_t info[SIGRTMIN - 1];
+    /// The queued real-time signals (sigqueue_t).
+    list_head_t queue;
 } sigpending_t;
 
 /// These can be the second arg to send_sig_info/send_group_sig_info.
@@ -255,12 +273,49 @@ long sys_sigreturn(struct pt_regs *f);
 /// otherwise, 0.
 int do_signal(struct pt_regs *f);
 
+/// @brief Checks if the process has a pending signal which interrupts its
+/// sleep, namely one which is not blocked, and which is not ignored.
+/// @param t The process.
+/// @return 1 if such a signal is pending, 0 otherwise.
+int signal_pending(struct task_struct *t);
+
+/// @brief Checks if the process has a pending signal which is not blocked,
+/// whatever its handler, looking only at the masks.
+/// @param t The process.
+/// @return 1 if such a signal is pending, 0 otherwise.
+int signal_unblocked(struct task_struct *t);
+
+/// @brief Checks if one of the given signals is pending for the process,
+/// privately or for its thread group, whether it is blocked or not.
+/// @param t The process.
+/// @param set The signals.
+/// @return 1 if one of them is pending, 0 otherwise.
+int signal_pending_in(struct task_struct *t, const sigset_t *set);
+
+/// @brief Takes one of the given signals, if pending, without handling it:
+/// the lowest-numbered one, private signals first.
+/// @param t The process.
+/// @param set The signals, SIGKILL and SIGSTOP are never taken.
+/// @param info Where the information of the signal is stored.
+/// @return The signal, 0 if none of them is pending.
+int signal_dequeue(struct task_struct *t, const sigset_t *set, siginfo_t *info);
+
+/// @brief Initializes the signals of a process, with none pending, and the
+/// pool of its queued signals.
+/// @param t The process.
+void signal_init_task(struct task_struct *t);
+
+/// @brief Discards the pending signals of a process, freeing its queued ones.
+/// @param t The process.
+void signal_flush_task(struct task_struct *t);
+
 /// @brief Initialize the signals.
 /// @return 1 on success, 0 on failure.
 int signals_init(void);
 
-/// @brief Send signal to one specific process.
-/// @param pid The PID of the process.
+/// @brief Send signal to one specific process, or to a process group.
+/// @param pid The PID of the process, 0 for the group of the caller, or minus
+///            the group.
 /// @param sig The signal to be sent.
 /// @return
 int sys_kill(pid_t pid, int sig);
@@ -295,6 +350,39 @@ int sys_sigprocmask(int how, const sigset_t *set, sigset_t *oldset);
 /// @return 0 on success, -1 on failure and errno is set to indicate the error.
 int sys_sigpending(sigset_t *set);
 
+/// @brief Queues a signal, with the given information, to a process.
+/// @param pid The process.
+/// @param sig The signal.
+/// @param info The information, whose code must be SI_QUEUE when the signal
+/// is sent to another process.
+/// @return 0 on success, -EAGAIN if the queue of the process is full.
+int sys_rt_sigqueueinfo(pid_t pid, int sig, siginfo_t *info);
+
+/// @brief Waits for one of the given signals, and takes it without running
+/// its handler.
+/// @param set The signals to wait for, which should be blocked.
+/// @param info If non-NULL, where the information of the signal is stored.
+/// @param timeout The maximum time to wait, NULL to wait forever.
+/// @return The signal, -EAGAIN if the timeout expired, -EINTR if another
+/// signal interrupted the wait.
+int sys_rt_sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout);
+
+/// @brief Creates a signalfd, from which the given signals are read, or
+/// changes the signals of an existing one.
+/// @param fd -1 to create a new signalfd, or the one to change.
+/// @param mask The signals to read, which should be blocked.
+/// @param sizemask The size of the mask.
+/// @param flags The flags (SFD_NONBLOCK).
+/// @return The file descriptor of the signalfd, a negative errno on failure.
+int sys_signalfd4(int fd, const sigset_t *mask, size_t sizemask, int flags);
+
+/// @brief Same as sys_signalfd4(), without flags.
+/// @param fd -1 to create a new signalfd, or the one to change.
+/// @param mask The signals to read, which should be blocked.
+/// @param sizemask The size of the mask.
+/// @return The file descriptor of the signalfd, a negative errno on failure.
+int sys_signalfd(int fd, const sigset_t *mask, size_t sizemask);
+
 /// @brief Returns the string describing the given signal.
 /// @param sig The signal to inquire.
 /// @return String representing the signal.
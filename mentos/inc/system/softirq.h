@@ -0,0 +1,76 @@
+/// @file softirq.h
+/// @brief The bottom halves of the interrupt handlers.
+/// @details
+/// The interrupt handlers (top halves) only talk to the hardware, then raise
+/// a softirq for the rest of the work. The pending softirqs run when the
+/// interrupt handler returns, with the interrupts enabled, so that the work
+/// of an interrupt does not delay the others. A softirq never interrupts
+/// another one: the interrupts raised meanwhile only mark their softirq as
+/// pending, and it runs before returning to the interrupted code. Tasklets
+/// are functions queued on the tasklet softirq, for the drivers which do not
+/// need a softirq of their own.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "stdbool.h"
+#include "stddef.h"
+
+/// @brief The softirqs, the lower the number the higher the priority.
+enum {
+    TIMER_SOFTIRQ,   ///< The dynamic timers, and the accounting of the ticks.
+    HRTIMER_SOFTIRQ, ///< The high-resolution timers.
+    TASKLET_SOFTIRQ, ///< The tasklets, queued by the drivers.
+    NR_SOFTIRQS      ///< The number of softirqs.
+};
+
+/// @brief The function run by a softirq.
+typedef void (*softirq_action_t)(void);
+
+/// @brief A function which an interrupt handler defers to the tasklet softirq.
+typedef struct tasklet {
+    /// The next queued tasklet.
+    struct tasklet *next;
+    /// If the tasklet is queued, and has not started yet.
+    bool_t scheduled;
+    /// The function to run.
+    void (*func)(unsigned long);
+    /// The argument of the function.
+    unsigned long data;
+} tasklet_t;
+
+/// @brief Prepares a tasklet, which can then be scheduled.
+/// @param tasklet the tasklet.
+/// @param func the function run by the tasklet.
+/// @param data the argument of the function.
+static inline void tasklet_init(tasklet_t *tasklet, void (*func)(unsigned long), unsigned long data)
+{
+    tasklet->next      = NULL;
+    tasklet->scheduled = false;
+    tasklet->func      = func;
+    tasklet->data      = data;
+}
+
+/// @brief Initializes the softirqs.
+void softirq_initialize(void);
+
+/// @brief Sets the function run by a softirq.
+/// @param nr the softirq.
+/// @param action the function.
+void open_softirq(unsigned int nr, softirq_action_t action);
+
+/// @brief Marks a softirq as pending, it can be called from interrupt context.
+/// @param nr the softirq.
+void raise_softirq(unsigned int nr);
+
+/// @brief Runs the pending softirqs, called when an interrupt handler returns.
+/// @details The softirqs run with the interrupts enabled. If the interrupts
+/// keep raising them, after a few rounds the rest is left to the workqueue of
+/// the system, so that the interrupted code makes progress.
+void do_softirq(void);
+
+/// @brief Queues a tasklet, it can be called from interrupt context.
+/// @param tasklet the tasklet.
+/// @return true if the tasklet has been queued, false if it was already.
+bool_t tasklet_schedule(tasklet_t *tasklet);
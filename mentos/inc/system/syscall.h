@@ -8,12 +8,29 @@
 #include "dirent.h"
 #include "fs/vfs_types.h"
 #include "kernel.h"
+#include "sys/epoll.h"
+#include "sys/io_uring.h"
+#include "sys/mman.h"
 #include "sys/msg.h"
+#include "sys/perf_event.h"
+#include "sys/poll.h"
+#include "sys/resource.h"
+#include "sys/select.h"
 #include "sys/sem.h"
 #include "sys/shm.h"
+#include "sys/socket.h"
+#include "sys/times.h"
 #include "sys/types.h"
+#include "sys/uio.h"
 #include "sys/utsname.h"
 #include "system/syscall_types.h"
+#include "time.h"
+
+// Declared by spawn.h, which needs system/signal.h, which includes this header.
+struct posix_spawn_file_actions;
+struct posix_spawnattr;
+// Declared by bits/clone.h.
+struct user_desc;
 
 /// @brief Initialize the system calls.
 void syscall_init(void);
@@ -22,10 +39,18 @@ void syscall_init(void);
 /// @param f The interrupt stack frame.
 void syscall_handler(pt_regs_t *f);
 
+/// @brief Checks if the system calls can enter through sysenter.
+/// @return 1 if syscall_init() set up sysenter, 0 if they use `int 0x80`.
+int syscall_has_sysenter(void);
+
 /// The exit() function causes normal process termination.
 /// @param exit_code The exit code.
 void sys_exit(int exit_code);
 
+/// @brief Terminates all the threads of the calling process.
+/// @param exit_code The exit code.
+void sys_exit_group(int exit_code);
+
 /// @brief Read data from a file descriptor.
 /// @param fd     The file descriptor.
 /// @param buf    The buffer.
@@ -50,6 +75,273 @@ ssize_t sys_write(int fd, const void *buf, size_t nbytes);
 /// indicate the error.
 off_t sys_lseek(int fd, off_t offset, int whence);
 
+/// @brief Commits the buffered data of all the filesystems to the disks.
+/// @return Always 0.
+int sys_sync(void);
+
+/// @brief Commits the buffered data of a file to the disk.
+/// @param fd The file descriptor of the file.
+/// @return 0 on success, a negative errno on failure.
+int sys_fsync(int fd);
+
+/// @brief Changes the size of a file.
+/// @param fd     The file descriptor of the file, open for writing.
+/// @param length The new size, the bytes the file gains read as zero.
+/// @return 0 on success, a negative errno on failure.
+int sys_ftruncate(int fd, off_t length);
+
+/// @brief Announces how a range of a file is going to be accessed.
+/// @param fd     The file descriptor of the file.
+/// @param offset The start of the range.
+/// @param len    The length of the range, 0 to reach the end of the file.
+/// @param advice One of the POSIX_FADV_* values.
+/// @return 0 on success, a negative errno on failure.
+int sys_fadvise64(int fd, off_t offset, off_t len, int advice);
+
+/// @brief Read data from a file descriptor into multiple buffers.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @return The number of read characters, a negative errno on failure.
+ssize_t sys_readv(int fd, const struct iovec *iov, int iovcnt);
+
+/// @brief Write data into a file descriptor from multiple buffers.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @return The number of written bytes, a negative errno on failure.
+ssize_t sys_writev(int fd, const struct iovec *iov, int iovcnt);
+
+/// @brief Read data from the given offset of a file, without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param buf    The buffer.
+/// @param nbytes The number of bytes to read.
+/// @param offset The offset inside the file.
+/// @return The number of read characters, a negative errno on failure.
+ssize_t sys_pread(int fd, void *buf, size_t nbytes, off_t offset);
+
+/// @brief Write data at the given offset of a file, without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param buf    The buffer collecting data to written.
+/// @param nbytes The number of bytes to write.
+/// @param offset The offset inside the file.
+/// @return The number of written bytes, a negative errno on failure.
+ssize_t sys_pwrite(int fd, const void *buf, size_t nbytes, off_t offset);
+
+/// @brief Read data from the given offset of a file into multiple buffers,
+/// without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset inside the file.
+/// @return The number of read characters, a negative errno on failure.
+ssize_t sys_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+/// @brief Write data at the given offset of a file from multiple buffers,
+/// without changing the file offset.
+/// @param fd     The file descriptor.
+/// @param iov    The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset The offset inside the file.
+/// @return The number of written bytes, a negative errno on failure.
+ssize_t sys_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+/// @brief Copies data from a file descriptor to another, inside the kernel.
+/// @param out_fd The file descriptor we write to.
+/// @param in_fd  The file descriptor we read from.
+/// @param offset If not NULL, the offset we read from, which is updated
+///               instead of the offset of `in_fd`.
+/// @param count  The number of bytes to copy.
+/// @return The number of copied bytes, a negative errno on failure.
+ssize_t sys_sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+
+/// @brief Copies a range of data from a file to another, inside the kernel.
+/// @param fd_in   The file descriptor we read from.
+/// @param off_in  If not NULL, the offset we read from, which is updated
+///                instead of the offset of `fd_in`.
+/// @param fd_out  The file descriptor we write to.
+/// @param off_out If not NULL, the offset we write to, which is updated
+///                instead of the offset of `fd_out`.
+/// @param len     The number of bytes to copy.
+/// @return The number of copied bytes, a negative errno on failure.
+ssize_t sys_copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len);
+
+/// @brief Moves data between a pipe and a file, or between two pipes, inside the kernel.
+/// @param fd_in   The file descriptor we read from.
+/// @param off_in  If not NULL, the offset we read from, which is updated
+///                instead of the offset of `fd_in` (must be NULL for pipes).
+/// @param fd_out  The file descriptor we write to.
+/// @param off_out If not NULL, the offset we write to, which is updated
+///                instead of the offset of `fd_out` (must be NULL for pipes).
+/// @param len     The number of bytes to move.
+/// @return The number of moved bytes, a negative errno on failure.
+ssize_t sys_splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len);
+
+/// @brief Duplicates the data of a pipe into another pipe, without consuming it.
+/// @param fd_in  The read end of the source pipe.
+/// @param fd_out The write end of the destination pipe.
+/// @param len    The number of bytes to duplicate.
+/// @param flags  The splice flags (SPLICE_F_NONBLOCK).
+/// @return The number of duplicated bytes, a negative errno on failure.
+ssize_t sys_tee(int fd_in, int fd_out, size_t len, unsigned int flags);
+
+/// @brief Writes a set of user buffers into a pipe.
+/// @param fd      The write end of the pipe.
+/// @param iov     The buffers, written in order.
+/// @param nr_segs The number of buffers.
+/// @param flags   The splice flags (SPLICE_F_NONBLOCK).
+/// @return The number of written bytes, a negative errno on failure.
+ssize_t sys_vmsplice(int fd, const struct iovec *iov, unsigned long nr_segs, unsigned int flags);
+
+/// @brief Creates a local socket.
+/// @param domain   The communication domain (AF_UNIX).
+/// @param type     The type of the socket (SOCK_STREAM or SOCK_DGRAM), possibly with SOCK_NONBLOCK.
+/// @param protocol The protocol (0).
+/// @return The file descriptor of the socket, a negative errno on failure.
+int sys_socket(int domain, int type, int protocol);
+
+/// @brief Creates a pair of connected local sockets.
+/// @param domain   The communication domain (AF_UNIX).
+/// @param type     The type of the sockets, possibly with SOCK_NONBLOCK.
+/// @param protocol The protocol (0).
+/// @param sv       Where the file descriptors of the sockets are stored.
+/// @return 0 on success, a negative errno on failure.
+int sys_socketpair(int domain, int type, int protocol, int sv[2]);
+
+/// @brief Gives a name to a socket.
+/// @param sockfd  The file descriptor of the socket.
+/// @param addr    The name (struct sockaddr_un).
+/// @param addrlen The size of the name.
+/// @return 0 on success, a negative errno on failure.
+int sys_bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Makes a bound stream socket accept connections.
+/// @param sockfd  The file descriptor of the socket.
+/// @param backlog The maximum number of connections waiting to be accepted.
+/// @return 0 on success, a negative errno on failure.
+int sys_listen(int sockfd, int backlog);
+
+/// @brief Accepts a connection on a listening socket.
+/// @param sockfd  The file descriptor of the socket.
+/// @param addr    If not NULL, where the name of the other end is stored.
+/// @param addrlen The size of `addr`, updated with the size of the name.
+/// @param flags   The flags of the new socket (SOCK_NONBLOCK).
+/// @return The file descriptor of the connection, a negative errno on failure.
+int sys_accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);
+
+/// @brief Connects a stream socket, or sets the destination of a datagram socket.
+/// @param sockfd  The file descriptor of the socket.
+/// @param addr    The name of the other socket.
+/// @param addrlen The size of the name.
+/// @return 0 on success, a negative errno on failure.
+int sys_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+/// @brief Sends a message, and possibly some descriptors, through a socket.
+/// @param sockfd The file descriptor of the socket.
+/// @param msg    The message.
+/// @param flags  The flags of the call (MSG_DONTWAIT).
+/// @return The number of sent bytes, a negative errno on failure.
+ssize_t sys_sendmsg(int sockfd, const struct msghdr *msg, int flags);
+
+/// @brief Receives a message, and possibly some descriptors, from a socket.
+/// @param sockfd The file descriptor of the socket.
+/// @param msg    The message.
+/// @param flags  The flags of the call (MSG_DONTWAIT).
+/// @return The number of received bytes, a negative errno on failure.
+ssize_t sys_recvmsg(int sockfd, struct msghdr *msg, int flags);
+
+/// @brief Shuts down part of a connection.
+/// @param sockfd The file descriptor of the socket.
+/// @param how    The part to shut down (SHUT_RD, SHUT_WR or SHUT_RDWR).
+/// @return 0 on success, a negative errno on failure.
+int sys_shutdown(int sockfd, int how);
+
+/// @brief Waits for one of a set of file descriptors to become ready.
+/// @param fds     The file descriptors, and the events we are interested in.
+/// @param nfds    The number of entries of `fds`.
+/// @param timeout The maximum time to wait, in milliseconds (negative waits forever).
+/// @return The number of ready descriptors, 0 on timeout, a negative errno on failure.
+int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
+/// @brief Waits for one of a set of file descriptors to become ready.
+/// @param nfds      The highest descriptor inside the sets, plus one.
+/// @param readfds   The descriptors checked for reading (can be NULL).
+/// @param writefds  The descriptors checked for writing (can be NULL).
+/// @param exceptfds The descriptors checked for exceptional conditions (can be NULL).
+/// @param timeout   The maximum time to wait, NULL waits forever.
+/// @return The number of ready descriptors, 0 on timeout, a negative errno on failure.
+int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+
+/// @brief Opens an epoll instance, with an empty interest list.
+/// @param size Ignored, but must be greater than zero.
+/// @return The file descriptor of the instance, a negative errno on failure.
+int sys_epoll_create(int size);
+
+/// @brief Modifies the interest list of an epoll instance.
+/// @param epfd  The epoll instance.
+/// @param op    The operation (EPOLL_CTL_ADD, EPOLL_CTL_DEL or EPOLL_CTL_MOD).
+/// @param fd    The target descriptor.
+/// @param event The events we are interested in, ignored by EPOLL_CTL_DEL.
+/// @return 0 on success, a negative errno on failure.
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+
+/// @brief Waits for the descriptors of the interest list to become ready.
+/// @param epfd      The epoll instance.
+/// @param events    Where the ready descriptors are stored.
+/// @param maxevents The maximum number of events to return.
+/// @param timeout   The maximum time to wait, in milliseconds (negative waits forever).
+/// @return The number of returned events, 0 on timeout, a negative errno on failure.
+int sys_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+
+/// @brief Waits on, or wakes up the tasks waiting on, a word of memory.
+/// @param uaddr    The word, identified by its physical address.
+/// @param futex_op The operation (FUTEX_WAIT, FUTEX_WAKE, FUTEX_LOCK_PI or
+///                 FUTEX_UNLOCK_PI).
+/// @param val      FUTEX_WAIT: the value the word must hold for the task to
+///                 sleep. FUTEX_WAKE: the maximum number of tasks to wake up.
+/// @param timeout  FUTEX_WAIT, FUTEX_LOCK_PI: if not NULL, the maximum time
+///                 to sleep.
+/// @return FUTEX_WAIT: 0 once woken up. FUTEX_WAKE: the number of woken up
+///         tasks. FUTEX_LOCK_PI, FUTEX_UNLOCK_PI: 0 once the word has been
+///         locked, or unlocked. A negative errno on failure.
+long sys_futex(int *uaddr, int futex_op, int val, const struct timespec *timeout);
+
+/// @brief Creates an eventfd, a counter which can be read and written.
+/// @param initval The initial value of the counter.
+/// @return The file descriptor of the eventfd, a negative errno on failure.
+int sys_eventfd(unsigned int initval);
+
+/// @brief Creates an eventfd, a counter which can be read and written.
+/// @param initval The initial value of the counter.
+/// @param flags   The flags (EFD_SEMAPHORE, EFD_NONBLOCK).
+/// @return The file descriptor of the eventfd, a negative errno on failure.
+int sys_eventfd2(unsigned int initval, int flags);
+
+/// @brief Registers the rings of batched system calls, which live inside the
+///        memory of the process.
+/// @param entries The entries of the submission queue, at most IORING_MAX_ENTRIES.
+/// @param params  The rings, and where their sizes are stored.
+/// @return The file descriptor of the ring, a negative errno on failure.
+int sys_io_uring_setup(unsigned int entries, struct io_uring_params *params);
+
+/// @brief Runs the entries submitted to a ring, posting their completions.
+/// @param fd           The file descriptor of the ring.
+/// @param to_submit    The largest number of entries to run.
+/// @param min_complete The completions to wait for, which all the entries
+///                     have once they are submitted.
+/// @param flags        The flags (IORING_ENTER_GETEVENTS).
+/// @return The number of entries consumed, a negative errno on failure.
+int sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags);
+
+/// @brief Starts counting a hardware event, while a process runs.
+/// @param attr     The description of the event.
+/// @param pid      The process, 0 for the calling one.
+/// @param cpu      The CPU, only -1 (any CPU) is supported.
+/// @param group_fd The leader of a group of events, only -1 (none) is supported.
+/// @param flags    Not used, must be 0.
+/// @return The file descriptor of the event, a negative errno on failure.
+int sys_perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags);
+
 /// @brief          Given a pathname for a file, open() returns a file
 ///                 descriptor, a small, nonnegative integer for use in
 ///                 subsequent system calls.
@@ -62,6 +354,14 @@ off_t sys_lseek(int fd, off_t offset, int whence);
 ///                 for use in subsequent system calls.
 int sys_open(const char *pathname, int flags, mode_t mode);
 
+/// @brief Opens a file, whose relative path starts from an open directory.
+/// @param dirfd    The directory, or AT_FDCWD for the current working directory.
+/// @param pathname A pathname for a file.
+/// @param flags    The file status flags and file access modes.
+/// @param mode     The file mode bits applied when a new file is created.
+/// @return A file descriptor on success, a negative errno on failure.
+int sys_openat(int dirfd, const char *pathname, int flags, mode_t mode);
+
 /// @brief
 /// @param fd
 /// @return
@@ -81,11 +381,34 @@ int sys_unlink(const char *path);
 ///         child; on error, -1 is returned.
 pid_t sys_waitpid(pid_t pid, int *status, int options);
 
+/// @brief Suspends the calling process until a child changes state, as
+///        sys_waitpid does, and returns the resources it used.
+/// @param pid The child to wait for.
+/// @param status Where the status of the child is stored.
+/// @param options Determines the wait behaviour.
+/// @param rusage Where the resources used by the child, and by the children
+///        it waited for, are stored, if not NULL.
+/// @return on success, returns the process ID of the terminated
+///         child; on error, -1 is returned.
+pid_t sys_wait4(pid_t pid, int *status, int options, struct rusage *rusage);
+
 /// @brief Replaces the current process image with a new process image.
 /// @param f CPU registers whe calling this function.
 /// @return 0 on success, -1 on error.
 int sys_execve(pt_regs_t *f);
 
+/// @brief Creates a new process running the given program, without copying
+///        the address space of the calling process.
+/// @param path         The path of the program.
+/// @param file_actions The actions performed on the file descriptors, if not NULL.
+/// @param attrp        The attributes of the new process, if not NULL.
+/// @param argv         The arguments of the program.
+/// @param envp         The environment of the program.
+/// @return The process ID of the new process, a negative errno on failure.
+pid_t sys_posix_spawn(
+    const char *path, const struct posix_spawn_file_actions *file_actions, const struct posix_spawnattr *attrp,
+    char *const argv[], char *const envp[]);
+
 /// @brief Changes the working directory.
 /// @param path The new working directory.
 /// @return On success 0. On error -1, and errno indicates the error.
@@ -97,9 +420,13 @@ int sys_chdir(char const *path);
 int sys_fchdir(int fd);
 
 /// @brief Returns the process ID (PID) of the calling process.
-/// @return The process ID.
+/// @return The process ID, shared by all its threads.
 pid_t sys_getpid(void);
 
+/// @brief Returns the thread ID (TID) of the calling thread.
+/// @return The thread ID, the process ID for the first thread of a process.
+pid_t sys_gettid(void);
+
 ///@brief  Return session id of the given process.
 ///        If pid == 0 return the SID of the calling process
 ///        If pid != 0 return the SID corresponding to the process having identifier == pid
@@ -152,6 +479,30 @@ gid_t sys_getegid(void);
 ///        Otherwise returns -1 with errno set to EPERM.
 int sys_setregid(gid_t rgid, gid_t egid);
 
+/// @brief Returns the limits of a resource of the calling process.
+/// @param resource the resource (RLIMIT_*).
+/// @param rlim where the limits are stored.
+/// @return 0 on success, a negative error number otherwise.
+int sys_getrlimit(int resource, struct rlimit *rlim);
+
+/// @brief Changes the limits of a resource of the calling process.
+/// @param resource the resource (RLIMIT_*).
+/// @param rlim the new limits.
+/// @return 0 on success, -EINVAL if the soft limit exceeds the hard one,
+///         -EPERM if an unprivileged process raises the hard limit.
+int sys_setrlimit(int resource, const struct rlimit *rlim);
+
+/// @brief Returns the CPU times of the calling process, and of its children.
+/// @param buf where the times are stored, if not NULL.
+/// @return the clock ticks elapsed since the system started.
+clock_t sys_times(struct tms *buf);
+
+/// @brief Returns the resources used by the calling process, its children, or thread.
+/// @param who RUSAGE_SELF, RUSAGE_CHILDREN or RUSAGE_THREAD.
+/// @param usage where the resources are stored.
+/// @return 0 on success, a negative error number otherwise.
+int sys_getrusage(int who, struct rusage *usage);
+
 /// @brief Returns the parent process ID (PPID) of the calling process.
 /// @return The parent process ID.
 pid_t sys_getppid(void);
@@ -193,6 +544,16 @@ int sys_nice(int increment);
 ///         returned on failure, and errno is set appropriately.
 int sys_reboot(int magic1, int magic2, unsigned int cmd, void *arg);
 
+/// @brief Operates on the attributes of the calling process.
+/// @param option the operation (PR_*).
+/// @param arg2 the first argument of the operation.
+/// @param arg3 the second argument of the operation.
+/// @param arg4 the third argument of the operation.
+/// @param arg5 the fourth argument of the operation.
+/// @return a non-negative value on success, which depends on the operation,
+///         a negative errno on failure.
+int sys_prctl(int option, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5);
+
 /// @brief Get current working directory.
 /// @param buf  The array where the CWD will be copied.
 /// @param size The size of the array.
@@ -200,13 +561,35 @@ int sys_reboot(int magic1, int magic2, unsigned int cmd, void *arg);
 ///         On failure, returnr NULL, and errno is set to indicate the error.
 char *sys_getcwd(char *buf, size_t size);
 
+/// @brief Clone the calling process, its address space is shared copy-on-write.
+/// @param f CPU registers whe calling this function.
+/// @return Return -1 for errors, 0 to the new process, and the process ID of
+///         the new process to the old process.
+pid_t sys_fork(pt_regs_t *f);
+
 /// @brief Clone the calling process, but without copying the whole address space.
 ///        The calling process is suspended until the new process exits or is
 ///        replaced by a call to `execve'.
 /// @param f CPU registers whe calling this function.
 /// @return Return -1 for errors, 0 to the new process, and the process ID of
 ///         the new process to the old process.
-pid_t sys_fork(pt_regs_t *f);
+pid_t sys_vfork(pt_regs_t *f);
+
+/// @brief Creates a new process, or a new thread, sharing with the calling
+///        process what the flags ask: its memory (CLONE_VM), its file
+///        descriptors (CLONE_FILES), its signal handlers (CLONE_SIGHAND).
+/// @param f CPU registers when calling this function: the flags (ebx), the
+///        stack of the child (ecx), where the parent stores the id of the child
+///        (edx), the thread-local storage of the child (esi), and where the
+///        child stores its id (edi).
+/// @return 0 to the new process, its id to the calling process, a negative
+///         errno on failure.
+pid_t sys_clone(pt_regs_t *f);
+
+/// @brief Sets the segment of the thread-local storage of the calling thread.
+/// @param u_info the segment, where the chosen entry of the GDT is written back.
+/// @return 0 on success, a negative errno on failure.
+int sys_set_thread_area(struct user_desc *u_info);
 
 /// @brief Stat the file at the given path.
 /// @param path Path to the file for which we are retrieving the statistics.
@@ -214,6 +597,14 @@ pid_t sys_fork(pt_regs_t *f);
 /// @return 0 on success, a negative number if fails and errno is set.
 int sys_stat(const char *path, stat_t *buf);
 
+/// @brief Stat the file at the given path, whose relative path starts from an open directory.
+/// @param dirfd The directory, or AT_FDCWD for the current working directory.
+/// @param path  Path to the file for which we are retrieving the statistics.
+/// @param buf   Buffer where we are storing the statistics.
+/// @param flags AT_SYMLINK_NOFOLLOW, which is what stat() does anyway.
+/// @return 0 on success, a negative errno on failure.
+int sys_fstatat(int dirfd, const char *path, stat_t *buf, int flags);
+
 /// @brief Retrieves information about the file at the given location.
 /// @param fd  The file descriptor of the file that is being inquired.
 /// @param buf A structure where data about the file will be stored.
@@ -226,6 +617,13 @@ int sys_fstat(int fd, stat_t *buf);
 /// @return Returns a negative value on failure.
 int sys_mkdir(const char *path, mode_t mode);
 
+/// @brief Creates a special file, e.g., a named pipe.
+/// @param path The path of the new file.
+/// @param mode The type and the permission of the new file.
+/// @param dev The device number, for device special files.
+/// @return Returns a negative value on failure.
+int sys_mknod(const char *path, mode_t mode, dev_t dev);
+
 /// @brief Removes the given directory.
 /// @param path The path to the directory to remove.
 /// @return Returns a negative value on failure.
@@ -247,8 +645,8 @@ int sys_creat(const char *path, mode_t mode);
 int sys_readlink(const char *path, char *buffer, size_t bufsize);
 
 /// @brief Creates a symbolic link.
-/// @param linkname the name of the link.
-/// @param path the entity it is linking to.
+/// @param linkname the target of the link, the entity it is linking to.
+/// @param path the path of the new link.
 /// @return 0 on success, a negative number if fails and errno is set.
 int sys_symlink(const char *linkname, const char *path);
 
@@ -267,6 +665,18 @@ ssize_t sys_getdents(int fd, dirent_t *dirp, unsigned int count);
 /// @return The current time.
 time_t sys_time(time_t *time);
 
+/// @brief Reads a clock.
+/// @param clk_id the clock, CLOCK_REALTIME or CLOCK_MONOTONIC.
+/// @param tp where the time is stored.
+/// @return 0 on success, -EINVAL if the clock does not exist.
+int sys_clock_gettime(clockid_t clk_id, struct timespec *tp);
+
+/// @brief Returns the resolution of a clock.
+/// @param clk_id the clock, CLOCK_REALTIME or CLOCK_MONOTONIC.
+/// @param res where the resolution is stored, if not NULL.
+/// @return 0 on success, -EINVAL if the clock does not exist.
+int sys_clock_getres(clockid_t clk_id, struct timespec *res);
+
 /// @brief Get a System V semaphore set identifier.
 /// @param key can be used either to obtain the identifier of a previously
 /// created semaphore set, or to create a new set.
@@ -283,6 +693,16 @@ long sys_semget(key_t key, int nsems, int semflg);
 /// @return 0 on success, -1 on failure and errno is set to indicate the error.
 long sys_semop(int semid, struct sembuf *sops, unsigned nsops);
 
+/// @brief Performs operations on selected semaphores in the set, waiting at
+///        most the given time for them to be possible.
+/// @param semid the semaphore set identifier.
+/// @param sops specifies operations to be performed on single semaphores.
+/// @param nsops number of operations.
+/// @param timeout the maximum time to wait, NULL to wait until possible.
+/// @return 0 on success, a negative errno on failure, -EAGAIN once the time
+///         has expired.
+long sys_semtimedop(int semid, struct sembuf *sops, unsigned nsops, const struct timespec *timeout);
+
 /// @brief Performs control operations on a semaphore set.
 /// @param semid the semaphore set identifier.
 /// @param semnum the n-th semaphore of the set on which we perform the operations.
@@ -377,6 +797,37 @@ void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t off
 /// @return 0 on success, -1 on falure and errno is set.
 int sys_munmap(void *addr, size_t length);
 
+/// @brief Creates a new mapping, taking the arguments of sys_mmap() through a single pointer.
+/// @param arg the arguments.
+/// @return returns a pointer to the mapped area, or a negative error code.
+void *sys_old_mmap(mmap_arg_struct_t *arg);
+
+/// @brief Writes back to the file the changes made to a shared mapping.
+/// @param addr the starting address, which must be a multiple of the page size.
+/// @param length the length of the range.
+/// @param flags either MS_ASYNC or MS_SYNC, and optionally MS_INVALIDATE.
+/// @return 0 on success, or a negative error code.
+int sys_msync(void *addr, size_t length, int flags);
+
+/// @brief Announces how a range of the address space is going to be accessed.
+/// @param addr the starting address, which must be a multiple of the page size.
+/// @param length the length of the range.
+/// @param advice one of the MADV_* values.
+/// @return 0 on success, or a negative error code.
+int sys_madvise(void *addr, size_t length, int advice);
+
+/// @brief Starts swapping the pages of the processes to a block device, which
+///        must have been prepared by mkswap. A single swap area is supported.
+/// @param path the path of the block device.
+/// @param flags the flags of the swap area (ignored).
+/// @return 0 on success, or a negative error code.
+int sys_swapon(const char *path, int flags);
+
+/// @brief Stops swapping to a block device, reading back all the pages it holds.
+/// @param path the path of the block device.
+/// @return 0 on success, or a negative error code.
+int sys_swapoff(const char *path);
+
 /// @brief Returns system information in the structure pointed to by buf.
 /// @param buf Buffer where the info will be placed.
 /// @return 0 on success, a negative value on failure.
@@ -401,12 +852,9 @@ long sys_ioctl(int fd, unsigned int request, unsigned long data);
 /// @return Returns 0 on success; on error, returns a negative error code.
 long sys_fcntl(int fd, unsigned int request, unsigned long data);
 
-/// @brief User malloc.
-/// @param addr This argument is treated as an address of a dynamically
-///             allocated memory if falls inside the process heap area.
-///             Otherwise, it is treated as an amount of memory that
-///             should be allocated.
-/// @return NULL if there is no more memory available or we were freeing
-///         a previously allocated memory area, the address of the
-///         allocated space otherwise.
+/// @brief Sets the end of the heap (the program break).
+/// @param addr The new end of the heap, which must lie inside the area
+///             reserved for it, NULL to just retrieve the current one.
+/// @return The end of the heap, which is left unchanged on failure, or NULL
+///         if the heap could not be reserved.
 void *sys_brk(void *addr);
@@ -0,0 +1,80 @@
+/// @file trace.h
+/// @brief Static tracepoints, recording binary events inside per-CPU rings.
+/// @details
+/// The tracepoints are placed inside the scheduler, the system calls, the page
+/// fault handler, the block layer and the allocator. Each one records, while
+/// its event is enabled, a fixed-size binary record (the time, the CPU, the
+/// current process and up to three arguments) inside the ring of the CPU, which
+/// keeps the most recent ones. A disabled tracepoint costs a test of
+/// `trace_events_mask`, which is predicted not taken.
+///
+/// The file `/proc/trace_events` lists the events, and whether they are
+/// enabled; writing `+name` or `-name` to it (with `all` for every event)
+/// enables or disables them, and `clear` empties the rings. The file
+/// `/proc/trace` lists the records, oldest first, one per line as
+/// `cpu seconds pid event arguments`.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "fs/vfs_types.h"
+#include "stdint.h"
+
+/// The number of records kept for each CPU, the oldest ones are overwritten.
+#define TRACE_RING_SIZE 4096U
+
+/// @brief The events recorded by the tracepoints.
+typedef enum trace_event_id {
+    TRACE_SCHED_SWITCH,   ///< A process gives up the CPU (prev, prev state, next).
+    TRACE_SCHED_WAKEUP,   ///< A process is woken up (pid, state).
+    TRACE_SCHED_LATENCY,  ///< A woken up process runs (pid, microseconds since the wake-up, worst so far).
+    TRACE_SYS_ENTER,      ///< A system call starts (number, first two arguments).
+    TRACE_SYS_EXIT,       ///< A system call returns (number, result).
+    TRACE_PAGE_FAULT,     ///< A page fault is handled (address, error code, instruction).
+    TRACE_BLOCK_ISSUE,    ///< A request is issued to a block device (sector, count, write).
+    TRACE_BLOCK_COMPLETE, ///< A request of a block device completes (sector, count, status).
+    TRACE_KMALLOC,        ///< Memory is allocated (address, size).
+    TRACE_KFREE,          ///< Memory is freed (address).
+    TRACE_EVENT_MAX,      ///< The number of events.
+} trace_event_id_t;
+
+/// The enabled events, one bit each.
+extern volatile uint32_t trace_events_mask;
+
+/// @brief Records an event inside the ring of the CPU.
+/// @param event the event.
+/// @param arg0 the first argument.
+/// @param arg1 the second argument.
+/// @param arg2 the third argument.
+void __trace_record(trace_event_id_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+/// @brief Records an event, if it is enabled.
+#define trace_point(event, arg0, arg1, arg2)                                                                           \
+    do {                                                                                                               \
+        if (__builtin_expect(trace_events_mask & (1U << (event)), 0)) {                                                \
+            __trace_record((event), (uint32_t)(arg0), (uint32_t)(arg1), (uint32_t)(arg2));                             \
+        }                                                                                                              \
+    } while (0)
+
+/// @brief Reads the records, one per line.
+/// @param file the open file, which owns the streaming state.
+/// @param buf the buffer where the records are placed.
+/// @param offset the offset from which we start reading.
+/// @param nbyte the number of bytes to read.
+/// @return the number of bytes read, or -errno on failure.
+ssize_t trace_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte);
+
+/// @brief Reads the list of the events, one per line as `name 0|1`.
+/// @param buffer the buffer where the list is placed.
+/// @param offset the offset from which we start reading.
+/// @param size the number of bytes to read.
+/// @return the number of bytes read.
+ssize_t trace_events_read(char *buffer, off_t offset, size_t size);
+
+/// @brief Enables (`+name`), or disables (`-name`), events, or empties the rings (`clear`).
+/// @param command the commands, separated by spaces.
+/// @param size the length of the command.
+/// @return 0 on success, -EINVAL if a command is not valid, -ENOMEM if the
+///         rings cannot be allocated.
+int trace_events_control(const char *command, size_t size);
@@ -0,0 +1,31 @@
+/// @file vdso.h
+/// @brief The page shared, read-only, with every process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include "bits/vdso.h"
+
+struct mm_struct;
+struct task_struct;
+
+/// @brief Allocates the shared page, and fills it with the parameters of the clocks.
+/// @return 0 on success, -1 on failure.
+int vdso_initialize(void);
+
+/// @brief Maps the shared page inside the memory of a process.
+/// @param mm the memory descriptor of the process.
+/// @return 0 on success, -1 on failure.
+int vdso_map(struct mm_struct *mm);
+
+/// @brief Publishes the monotonic clock, when it follows the tick.
+void vdso_update_clock(void);
+
+/// @brief Publishes the offset between the Unix epoch and the monotonic clock.
+/// @param offset the nanoseconds.
+void vdso_set_realtime(uint64_t offset);
+
+/// @brief Publishes the identifiers of the process about to run.
+/// @param next the process.
+void vdso_switch(struct task_struct *next);
@@ -22,6 +22,10 @@ extern void boot_kernel(uint32_t stack_pointer, uint32_t entry, boot_info_t *boo
 /// @brief Size of the kernel's stack.
 #define KERNEL_STACK_SIZE 0x100000
 
+/// @brief Size of a large page, the kernel keeps the same offset inside its
+/// virtual and physical large pages, so that it can map itself with them.
+#define KERNEL_LARGE_PAGE_SIZE 0x400000
+
 /// Serial port for QEMU.
 #define SERIAL_COM1 (0x03F8)
 
@@ -258,6 +262,9 @@ void boot_main(uint32_t magic, multiboot_info_t *header, uint32_t esp)
     uint32_t kernel_phy_page_start  = __align_rup(boot_info.module_end, PAGE_SIZE);
     // Get the starting address of the virtual pages.
     uint32_t kernel_virt_page_start = __align_rdown(kernel_virt_low, PAGE_SIZE);
+    // Move the physical pages forward, until they have the same offset of the
+    // virtual ones inside a large page.
+    kernel_phy_page_start += (kernel_virt_page_start - kernel_phy_page_start) % KERNEL_LARGE_PAGE_SIZE;
 
     // Compute the absolute offset of the first virtual page, by subtracting
     // the starting address of the virtual pages and the lowest virtual address
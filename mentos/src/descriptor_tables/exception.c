@@ -11,6 +11,8 @@
 
 #include "descriptor_tables/idt.h"
 #include "descriptor_tables/isr.h"
+#include "hardware/apic.h"
+#include "mem/page_fault.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "system/panic.h"
@@ -103,12 +105,13 @@ void handle_gp_fault(pt_regs_t *frame)
 void isr_handler(pt_regs_t *f)
 {
     uint32_t isr_number = f->int_no;
-    if (isr_number != 80) {
-        //		pr_default("calling ISR %d\n", isr_number);
+    // Page faults are by far the most frequent exceptions, they are handled
+    // without going through the table.
+    if (isr_number == PAGE_FAULT) {
+        page_fault_handler(f);
+        return;
     }
-    //    pr_default("calling ISR %d\n", isr_number);
     isr_routines[isr_number](f);
-    //    pr_default("end calling ISR %d\n", isr_number);
 }
 
 void isrs_init(void)
@@ -120,10 +123,19 @@ void isrs_init(void)
     isr_routines[13] = handle_gp_fault;
 }
 
+/// @brief Checks if an ISR can have its own handler.
+/// @param i the ISR.
+/// @return 1 for the exceptions, the system call, the local APIC and MSI, 0 otherwise.
+static inline int __isr_is_valid(unsigned i)
+{
+    return (i <= 31) || (i == 80) || (i == LAPIC_TIMER_VECTOR) || (i == LAPIC_SPURIOUS_VECTOR) ||
+           ((i >= MSI_VECTOR_BASE) && (i < (MSI_VECTOR_BASE + MSI_VECTOR_COUNT)));
+}
+
 int isr_install_handler(unsigned i, interrupt_handler_t handler, char *description)
 {
     // Sanity check.
-    if (i > 31 && i != 80) {
+    if (!__isr_is_valid(i)) {
         return -1;
     }
     isr_routines[i]             = handler;
@@ -133,7 +145,7 @@ int isr_install_handler(unsigned i, interrupt_handler_t handler, char *descripti
 
 int isr_uninstall_handler(unsigned i)
 {
-    if (i > 31 && i != 80) {
+    if (!__isr_is_valid(i)) {
         return -1;
     }
     isr_routines[i]             = default_isr_handler;
@@ -11,6 +11,7 @@
 
 #include "descriptor_tables/gdt.h"
 #include "descriptor_tables/tss.h"
+#include "hardware/smp.h"
 
 /// The maximum dimension of the GDT.
 #define GDT_SIZE 10
@@ -41,14 +42,16 @@ void init_gdt(void)
     }
 
     // Setup the GDT pointer and limit.
-    // We have six entries in the GDT:
+    // We have eight entries in the GDT:
     //  - Two for kernel mode.
     //  - Two for user mode.
     //  - The NULL descriptor.
-    //  - And one for the TSS (task state segment).
+    //  - One for the TSS (task state segment).
+    //  - One for the thread-local storage of the running thread.
+    //  - And one for the data of the CPU.
     // The limit is the last valid byte from the start of the GDT.
     // i.e. the size of the GDT - 1.
-    gdt_pointer.limit = sizeof(gdt_descriptor_t) * 6 - 1;
+    gdt_pointer.limit = sizeof(gdt_descriptor_t) * (GDT_PERCPU_ENTRY + 1) - 1;
     gdt_pointer.base  = (uint32_t)&gdt;
 
     // ------------------------------------------------------------------------
@@ -83,6 +86,18 @@ void init_gdt(void)
     // Initialize the TSS
     tss_init(5, 0x10);
 
+    // ------------------------------------------------------------------------
+    // THREAD-LOCAL STORAGE
+    // ------------------------------------------------------------------------
+    // A user data segment, moved to the storage of each thread it runs.
+    gdt_set_tls(0);
+
+    // ------------------------------------------------------------------------
+    // PER-CPU DATA
+    // ------------------------------------------------------------------------
+    // A kernel data segment, offset to the data of the CPU which booted.
+    gdt_set_percpu(smp_percpu_offset(0));
+
     // Inform the CPU about the changes on the GDT.
     gdt_flush((uint32_t)&gdt_pointer);
 
@@ -111,6 +126,18 @@ void gdt_set_gate(uint8_t index, uint32_t base, uint32_t limit, uint8_t access,
         gdt[index].granularity);
 }
 
+void gdt_set_tls(uint32_t base)
+{
+    gdt_set_gate(
+        GDT_TLS_ENTRY, base, 0xFFFFFFFF, GDT_PRESENT | GDT_USER | GDT_DATA, GDT_GRANULARITY | GDT_OPERAND_SIZE);
+}
+
+void gdt_set_percpu(uint32_t base)
+{
+    gdt_set_gate(
+        GDT_PERCPU_ENTRY, base, 0xFFFFFFFF, GDT_PRESENT | GDT_KERNEL | GDT_DATA, GDT_GRANULARITY | GDT_OPERAND_SIZE);
+}
+
 //
 // == VIRTUAL MEMORY SCHEMES ==================================================
 // x86 supports two virtual memory schemes:
@@ -77,6 +77,26 @@ extern void INT_29(pt_regs_t *);
 extern void INT_30(pt_regs_t *);
 /// @brief Interrupt Service Routine (ISR) for exception handling.
 extern void INT_31(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the local APIC timer.
+extern void INT_48(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_49(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_50(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_51(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_52(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_53(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_54(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_55(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the Message Signaled Interrupts.
+extern void INT_56(pt_regs_t *);
+/// @brief Interrupt Service Routine (ISR) for the spurious interrupts of the local APIC.
+extern void INT_63(pt_regs_t *);
 /// @brief Interrupt Service Routine (ISR) for exception handling.
 extern void INT_80(pt_regs_t *);
 /// @brief Interrupt Request (IRQ) coming from the PIC.
@@ -219,6 +239,18 @@ void init_idt(void)
     __idt_set_gate(46, IRQ_14, GDT_PRESENT | GDT_KERNEL, 0x8);
     __idt_set_gate(47, IRQ_15, GDT_PRESENT | GDT_KERNEL, 0x8);
 
+    // Interrupts generated by, or delivered through, the local APIC, managed by isr_handler.
+    __idt_set_gate(48, INT_48, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(49, INT_49, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(50, INT_50, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(51, INT_51, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(52, INT_52, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(53, INT_53, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(54, INT_54, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(55, INT_55, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(56, INT_56, GDT_PRESENT | GDT_KERNEL, 0x8);
+    __idt_set_gate(63, INT_63, GDT_PRESENT | GDT_KERNEL, 0x8);
+
     // System call!
     __idt_set_gate(128, INT_80, GDT_PRESENT | GDT_USER, 0x8);
 
@@ -12,10 +12,18 @@
 #include "assert.h"
 #include "descriptor_tables/idt.h"
 #include "descriptor_tables/isr.h"
+#include "devices/pci.h"
+#include "hardware/apic.h"
+#include "hardware/ioapic.h"
 #include "hardware/pic8259.h"
+#include "hardware/smp.h"
+#include "klib/irqflags.h"
+#include "klib/preempt.h"
+#include "klib/rcu.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "system/printk.h"
+#include "system/softirq.h"
 
 /// @brief Shared interrupt handlers, stored into a double-linked list.
 typedef struct irq_struct {
@@ -25,12 +33,26 @@ typedef struct irq_struct {
     char *description;
     /// List handler.
     list_head_t siblings;
+    /// Frees the structure, once the interrupts which might be calling the handler have finished.
+    rcu_head_t rcu;
 } irq_struct_t;
 
-/// For each IRQ, a chain of handlers.
+/// For each IRQ, a chain of handlers, walked under RCU by irq_handler(), the
+/// writers disable the interrupts.
 static list_head_t shared_interrupt_handlers[IRQ_NUM];
 /// Cache where we will store the data regarding an irq service.
 static kmem_cache_t *irq_cache;
+/// The handlers of the MSI vectors, NULL for the free ones.
+static interrupt_handler_t msi_handlers[MSI_VECTOR_COUNT];
+
+/// @brief The number of interrupts received by a CPU, for each IRQ line.
+typedef struct irq_stat {
+    /// The counters, one for each IRQ line.
+    unsigned long count[IRQ_NUM];
+} __cacheline_aligned irq_stat_t;
+
+/// The interrupts received by each CPU.
+static DEFINE_PER_CPU(irq_stat_t, irq_stats);
 
 /// @brief Creates a new irq structure.
 /// @return a pointer to the newly created irq structure.
@@ -46,13 +68,9 @@ static inline irq_struct_t *__irq_struct_alloc(void)
     return irq_struct;
 }
 
-/// @brief Destroys an irq struct.
-/// @param irq_struct the structure we need to destroy.
-static inline void __irq_struct_dealloc(irq_struct_t *irq_struct)
-{
-    list_head_remove(&irq_struct->siblings);
-    kmem_cache_free(irq_struct);
-}
+/// @brief Destroys an irq struct, once nobody can be calling its handler.
+/// @param head the head inside the structure.
+static void __irq_struct_dealloc(rcu_head_t *head) { kmem_cache_free(container_of(head, irq_struct_t, rcu)); }
 
 void irq_init(void)
 {
@@ -80,7 +98,9 @@ int irq_install_handler(unsigned i, interrupt_handler_t handler, char *descripti
     irq_struct->description = description;
     irq_struct->handler     = handler;
     // Add the handler to the list of his siblings.
-    list_head_insert_before(&irq_struct->siblings, &shared_interrupt_handlers[i]);
+    uint8_t flags = irq_disable();
+    list_head_insert_before_rcu(&irq_struct->siblings, &shared_interrupt_handlers[i]);
+    irq_enable(flags);
     return 0;
 }
 
@@ -95,24 +115,103 @@ int irq_uninstall_handler(unsigned i, interrupt_handler_t handler)
         pr_err("There are no handler for IRQ `%d`\n", i);
         return -1;
     }
-    list_for_each_decl (it, &shared_interrupt_handlers[i]) {
+    uint8_t flags = irq_disable();
+    list_for_each_safe_decl (it, store, &shared_interrupt_handlers[i]) {
         // Get the interrupt structure.
         irq_struct_t *irq_struct = list_entry(it, irq_struct_t, siblings);
         assert(irq_struct && "Something went wrong.");
         if (irq_struct->handler == handler) {
-            list_head_remove(&irq_struct->siblings);
+            list_head_remove_rcu(&irq_struct->siblings);
+            call_rcu(&irq_struct->rcu, __irq_struct_dealloc);
         }
-        __irq_struct_dealloc(irq_struct);
     }
+    irq_enable(flags);
     return 0;
 }
 
+int irq_unmask(unsigned i)
+{
+    if (ioapic_is_enabled()) {
+        return ioapic_irq_enable(i);
+    }
+    return pic8259_irq_enable(i);
+}
+
+int irq_mask(unsigned i)
+{
+    if (ioapic_is_enabled()) {
+        return ioapic_irq_disable(i);
+    }
+    return pic8259_irq_disable(i);
+}
+
+/// @brief Runs the bottom halves, and switches to a process woken up by the
+///        handlers if it should preempt the current one.
+/// @param f the interrupt stack frame.
+static inline void __irq_exit(pt_regs_t *f)
+{
+    // Run the bottom halves, with the interrupts enabled.
+    do_softirq();
+    // Switch to a process woken up by the handlers, e.g., on keyboard input,
+    // if it should preempt the current one.
+    if (scheduler_need_resched()) {
+        scheduler_run(f);
+    }
+}
+
+/// @brief Handles the MSI vectors, which are never shared.
+/// @param f the interrupt stack frame.
+static void __msi_handler(pt_regs_t *f)
+{
+    interrupt_handler_t handler = msi_handlers[f->int_no - MSI_VECTOR_BASE];
+    if (handler) {
+        preempt_disable();
+        handler(f);
+        preempt_enable();
+    }
+    lapic_send_eoi();
+    __irq_exit(f);
+}
+
+int irq_install_msi(uint32_t device, interrupt_handler_t handler, char *description)
+{
+    // The messages are written to the local APIC.
+    if (!lapic_is_enabled()) {
+        return -1;
+    }
+    for (unsigned i = 0; i < MSI_VECTOR_COUNT; ++i) {
+        if (msi_handlers[i]) {
+            continue;
+        }
+        unsigned vector = MSI_VECTOR_BASE + i;
+        msi_handlers[i] = handler;
+        isr_install_handler(vector, __msi_handler, description);
+        if (pci_enable_msi(device, vector, lapic_get_id())) {
+            isr_uninstall_handler(vector);
+            msi_handlers[i] = NULL;
+            return -1;
+        }
+        return (int)vector;
+    }
+    pr_err("There are no free MSI vectors for `%s`.\n", description);
+    return -1;
+}
+
+unsigned long irq_get_count(unsigned int cpu, unsigned i)
+{
+    if ((cpu >= smp_num_cpus()) || (i >= IRQ_NUM)) {
+        return 0;
+    }
+    return per_cpu(irq_stats, cpu).count[i];
+}
+
 void irq_handler(pt_regs_t *f)
 {
     // Keep in mind,
     // because of irq mapping, the first PIC's irq line is shifted by 32.
     unsigned irq_line = f->int_no - 32;
     assert((irq_line < IRQ_NUM) && "Unidentified IRQ number.");
+    ++this_cpu(irq_stats).count[irq_line];
     // Actually, we may have several handlers for a same irq line.
     // The Kernel should provide the dev_id to each handler in order to
     // let it know if its own device generated the interrupt.
@@ -120,14 +219,22 @@ void irq_handler(pt_regs_t *f)
     if (list_head_empty(&shared_interrupt_handlers[irq_line])) {
         pr_err("Thre are no handler for IRQ `%d`\n", irq_line);
     } else {
-        list_for_each_decl (it, &shared_interrupt_handlers[irq_line]) {
+        // The handlers cannot give up the CPU, the read-side section says so.
+        rcu_read_lock();
+        list_for_each_rcu (it, &shared_interrupt_handlers[irq_line]) {
             // Get the interrupt structure.
             irq_struct_t *irq_struct = list_entry(it, irq_struct_t, siblings);
             assert(irq_struct && "Something went wrong.");
             // Call the interrupt function.
             irq_struct->handler(f);
         }
+        rcu_read_unlock();
+    }
+    // Send the end-of-interrupt to the controller which delivered the IRQ.
+    if (ioapic_is_enabled()) {
+        lapic_send_eoi();
+    } else {
+        pic8259_send_eoi(irq_line);
     }
-    // Send the end-of-interrupt to PIC.
-    pic8259_send_eoi(irq_line);
+    __irq_exit(f);
 }
@@ -50,6 +50,8 @@ void tss_init(uint8_t idx, uint32_t ss0)
     kernel_tss.iomap = sizeof(tss_entry_t);
 }
 
+uint32_t *tss_get_stack_pointer(void) { return &kernel_tss.esp0; }
+
 void tss_set_stack(uint32_t kss, uint32_t kesp)
 {
     // Kernel data segment.
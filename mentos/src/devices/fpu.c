@@ -113,9 +113,8 @@ static inline void __sigfpe_handler(pt_regs_t *f)
 {
     pr_debug("__sigfpe_handler(%p)\n", f);
 
-    // Notifies current process
-    thread_using_fpu = scheduler_get_current_process();
-    sys_kill(thread_using_fpu->pid, SIGFPE);
+    // Notifies current process, the FPU keeps belonging to its owner.
+    sys_kill(scheduler_get_current_process()->pid, SIGFPE);
 }
 
 /// @brief Ensure basic FPU functionality works.
@@ -148,15 +147,48 @@ static int __fpu_test(void)
     return (a == 60957114488184560000000000000000000000000000000000000.0);
 }
 
-void switch_fpu(void) { __save_fpu(scheduler_get_current_process()); }
+void switch_fpu(task_struct *next)
+{
+    if (thread_using_fpu == next) {
+        // The registers inside the FPU are still the ones of the next process.
+        __asm__ __volatile__("clts");
+    } else {
+        // They are moved by __invalid_op, the first time the next process uses the FPU.
+        __disable_fpu();
+    }
+}
+
+void fpu_save(task_struct *task)
+{
+    if (thread_using_fpu == task) {
+        // The FPU must be on, the owner might not have used it since its last switch.
+        __asm__ __volatile__("clts");
+        __save_fpu(task);
+        if (task != scheduler_get_current_process()) {
+            __disable_fpu();
+        }
+    }
+}
 
-void unswitch_fpu(void) { __restore_fpu(scheduler_get_current_process()); }
+void fpu_release(task_struct *task)
+{
+    if (thread_using_fpu == task) {
+        thread_using_fpu = NULL;
+        // Trap on the next use, there is no one to restore the registers for.
+        __disable_fpu();
+    }
+    task->thread.fpu_enabled = false;
+}
 
 int fpu_install(void)
 {
     __enable_fpu();
     __init_fpu();
-    __save_fpu(scheduler_get_current_process());
+    // The initialized registers belong to the current process.
+    thread_using_fpu = scheduler_get_current_process();
+    if (thread_using_fpu) {
+        thread_using_fpu->thread.fpu_enabled = true;
+    }
 
     // Install the handler for device missing
     isr_install_handler(DEV_NOT_AVL, &__invalid_op, "fpu: device missing");
@@ -12,6 +12,8 @@
 
 #include "devices/pci.h"
 #include "io/port_io.h"
+#include "mem/mm/vmem.h"
+#include "mem/paging.h"
 #include "string.h"
 
 struct {
@@ -271,6 +273,42 @@ struct {
 /// address.
 #define PCI_GET_FUNC(dev) (((dev) >> 8U) & 0x07)
 
+/// The functions found while enumerating the buses.
+static pci_dev_t pci_devices[PCI_MAX_DEVICES];
+/// The number of entries of pci_devices.
+static unsigned int pci_num_devices = 0;
+/// If the buses have been enumerated.
+static int pci_enumerated           = 0;
+/// If some of the devices are accessed through ECAM.
+static int pci_ecam_enabled         = 0;
+
+/// @brief Searches the table of the devices, without enumerating the buses.
+/// @param device The PCI device identifier.
+/// @return the entry, NULL if there is none.
+static inline pci_dev_t *__pci_lookup(uint32_t device)
+{
+    for (unsigned int i = 0; i < pci_num_devices; ++i) {
+        if (pci_devices[i].device == device) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL;
+}
+
+/// @brief Returns the address of a register, if the configuration space of
+/// the device is mapped through ECAM.
+/// @param device The PCI device identifier.
+/// @param field The register field.
+/// @return the virtual address of the register, 0 if it must go through the I/O ports.
+static inline uint32_t __pci_ecam_addr(uint32_t device, uint32_t field)
+{
+    if (!pci_ecam_enabled || (field >= PAGE_SIZE)) {
+        return 0;
+    }
+    const pci_dev_t *dev = __pci_lookup(device);
+    return (dev && dev->config) ? (dev->config + field) : 0;
+}
+
 /// @brief Constructs the PCI configuration address for a given device and register field.
 ///
 /// @param device The 32-bit value representing the PCI device (includes bus, slot, and function).
@@ -319,6 +357,11 @@ static inline int pci_get_addr(uint32_t device, uint32_t field, uint32_t *addr)
 
 int pci_write_8(uint32_t device, uint32_t field, uint8_t value)
 {
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *(volatile uint8_t *)mmio = value;
+        return 0;
+    }
     // Get the PCI configuration address
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -333,6 +376,11 @@ int pci_write_8(uint32_t device, uint32_t field, uint8_t value)
 
 int pci_write_16(uint32_t device, uint32_t field, uint16_t value)
 {
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *(volatile uint16_t *)(mmio & ~1U) = value;
+        return 0;
+    }
     // Get the PCI configuration address
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -347,6 +395,11 @@ int pci_write_16(uint32_t device, uint32_t field, uint16_t value)
 
 int pci_write_32(uint32_t device, uint32_t field, uint32_t value)
 {
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *(volatile uint32_t *)(mmio & ~3U) = value;
+        return 0;
+    }
     // Get the PCI configuration address
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -366,6 +419,11 @@ int pci_read_8(uint32_t device, uint32_t field, uint8_t *value)
         pr_err("Output parameter 'value' is NULL.\n");
         return 1;
     }
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *value = *(volatile uint8_t *)mmio;
+        return 0;
+    }
     // Get the PCI configuration address.
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -385,6 +443,11 @@ int pci_read_16(uint32_t device, uint32_t field, uint16_t *value)
         pr_err("Output parameter 'value' is NULL.\n");
         return 1;
     }
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *value = *(volatile uint16_t *)(mmio & ~1U);
+        return 0;
+    }
     // Get the PCI configuration address.
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -404,6 +467,11 @@ int pci_read_32(uint32_t device, uint32_t field, uint32_t *value)
         pr_err("Output parameter 'value' is NULL.\n");
         return 1;
     }
+    uint32_t mmio = __pci_ecam_addr(device, field);
+    if (mmio) {
+        *value = *(volatile uint32_t *)(mmio & ~3U);
+        return 0;
+    }
     // Get the PCI configuration address.
     uint32_t addr;
     if (pci_get_addr(device, field, &addr)) {
@@ -416,6 +484,76 @@ int pci_read_32(uint32_t device, uint32_t field, uint32_t *value)
     return 0;
 }
 
+int pci_find_capability(uint32_t device, uint8_t cap_id, uint8_t *offset)
+{
+    return pci_find_next_capability(device, cap_id, 0, offset);
+}
+
+int pci_find_next_capability(uint32_t device, uint8_t cap_id, uint8_t start, uint8_t *offset)
+{
+    // Check if the output pointer is valid.
+    if (offset == NULL) {
+        pr_err("Output parameter 'offset' is NULL.\n");
+        return 1;
+    }
+    uint16_t status;
+    uint8_t pos;
+    if (pci_read_16(device, PCI_STATUS, &status) || !(status & (1U << pci_status_capabilities_list))) {
+        return 1;
+    }
+    // Start from the head of the list, or from the capability after the given one.
+    if (pci_read_8(device, start ? (start + PCI_CAP_NEXT) : PCI_CAPABILITY_LIST, &pos)) {
+        return 1;
+    }
+    // Follow the list, a broken one cannot hold more than 48 capabilities.
+    for (int ttl = 48; (ttl > 0) && (pos >= 0x40); --ttl) {
+        uint8_t id;
+        pos &= 0xFC;
+        if (pci_read_8(device, pos + PCI_CAP_ID, &id)) {
+            return 1;
+        }
+        if (id == cap_id) {
+            *offset = pos;
+            return 0;
+        }
+        if (pci_read_8(device, pos + PCI_CAP_NEXT, &pos)) {
+            return 1;
+        }
+    }
+    return 1;
+}
+
+int pci_enable_msi(uint32_t device, uint8_t vector, uint8_t apic_id)
+{
+    uint8_t msi;
+    uint16_t flags;
+    if (pci_find_capability(device, PCI_CAP_ID_MSI, &msi) || pci_read_16(device, msi + PCI_MSI_FLAGS, &flags)) {
+        return 1;
+    }
+    // Program the message, a single one, then switch from the interrupt pin.
+    uint32_t data = (flags & PCI_MSI_FLAGS_64BIT) ? PCI_MSI_DATA_64 : PCI_MSI_DATA_32;
+    if (pci_write_32(device, msi + PCI_MSI_ADDRESS_LO, PCI_MSI_ADDRESS(apic_id))) {
+        return 1;
+    }
+    if ((flags & PCI_MSI_FLAGS_64BIT) && pci_write_32(device, msi + PCI_MSI_ADDRESS_HI, 0)) {
+        return 1;
+    }
+    if (pci_write_16(device, msi + data, vector)) {
+        return 1;
+    }
+    flags = (flags & ~PCI_MSI_FLAGS_QSIZE) | PCI_MSI_FLAGS_ENABLE;
+    if (pci_write_16(device, msi + PCI_MSI_FLAGS, flags)) {
+        return 1;
+    }
+    uint16_t command;
+    if (pci_read_16(device, PCI_COMMAND, &command) ||
+        pci_write_16(device, PCI_COMMAND, command | (1U << pci_command_interrupt_disable))) {
+        return 1;
+    }
+    pr_debug("Device 0x%08x signals its interrupts at vector %u, through MSI.\n", device, vector);
+    return 0;
+}
+
 /// @brief Searches for the vendor name from the vendor ID.
 /// @param vendor_id The vendor ID to search for.
 /// @return The vendor name if found; otherwise, "Unknown".
@@ -490,7 +628,7 @@ static inline int pci_box_device(uint8_t bus, uint8_t slot, uint8_t func, uint32
         return 1;
     }
     // Pack the bus, slot, and function numbers into a single 32-bit value.
-    *device = (uint32_t)((bus << 16U) | (slot << 8U) | func);
+    *device = PCI_ADDR_BUS(bus) | PCI_ADDR_DEV(slot) | PCI_ADDR_FUNC(func);
     return 0;
 }
 
@@ -699,14 +837,12 @@ int pci_scan_bus(pci_scan_func_t f, int type, uint8_t bus, void *extra)
     return 0;
 }
 
-int pci_scan(pci_scan_func_t f, int type, void *extra)
+/// @brief Walks all the buses, reading the configuration space of each slot.
+/// @param f The function to call for each function found.
+/// @param extra Extra arguments.
+/// @return 0 on success, 1 on failure.
+static int __pci_walk(pci_scan_func_t f, void *extra)
 {
-    // Check if the function pointer f is valid.
-    if (f == NULL) {
-        pr_err("Function pointer is NULL.\n");
-        return 1;
-    }
-
     uint32_t device;
     uint16_t vendor_id;
     uint8_t header_type;
@@ -720,7 +856,7 @@ int pci_scan(pci_scan_func_t f, int type, void *extra)
     // Check if it is a single PCI host controller.
     if ((header_type & 0x80) == 0) {
         // Single PCI host controller; scan bus 0
-        if (pci_scan_bus(f, type, 0, extra)) {
+        if (pci_scan_bus(f, -1, 0, extra)) {
             return 1;
         }
     } else {
@@ -743,13 +879,140 @@ int pci_scan(pci_scan_func_t f, int type, void *extra)
             // Check if the device exists.
             if (vendor_id != PCI_NONE) {
                 // Scan this bus.
-                pci_scan_bus(f, type, bus, extra);
+                pci_scan_bus(f, -1, bus, extra);
             }
         }
     }
     return 0;
 }
 
+/// @brief Adds a function to the table of the devices.
+/// @param device The PCI device identifier.
+/// @param vendor_id The vendor ID of the device.
+/// @param device_id The device ID of the device.
+/// @param extra Unused parameter.
+/// @return 0 on success, 1 if the function cannot be added.
+static int __pci_record(uint32_t device, uint16_t vendor_id, uint16_t device_id, void *extra)
+{
+    (void)extra;
+    // Empty slots read as all ones, and bridges can lead to a bus twice.
+    if ((vendor_id == PCI_NONE) || __pci_lookup(device)) {
+        return 0;
+    }
+    if (pci_num_devices == PCI_MAX_DEVICES) {
+        pr_warning("Too many PCI functions, ignoring %04x:%04x.\n", vendor_id, device_id);
+        return 1;
+    }
+    pci_dev_t *dev = &pci_devices[pci_num_devices];
+    memset(dev, 0, sizeof(pci_dev_t));
+    dev->device    = device;
+    dev->vendor_id = vendor_id;
+    dev->device_id = device_id;
+    if (pci_find_type(device, &dev->type) || pci_read_8(device, PCI_REVISION_ID, &dev->revision) ||
+        pci_read_8(device, PCI_HEADER_TYPE, &dev->header_type) ||
+        pci_read_8(device, PCI_INTERRUPT_LINE, &dev->irq_line) ||
+        pci_read_8(device, PCI_INTERRUPT_PIN, &dev->irq_pin)) {
+        pr_err("Failed to read the configuration of %04x:%04x.\n", vendor_id, device_id);
+        return 1;
+    }
+    dev->header_type &= 0x7F;
+    // Bridges only have two base address registers, CardBus bridges none.
+    unsigned int bars = (dev->header_type == PCI_HEADER_TYPE_NORMAL) ? 6 :
+                        (dev->header_type == PCI_HEADER_TYPE_BRIDGE) ? 2 :
+                                                                       0;
+    for (unsigned int i = 0; i < bars; ++i) {
+        pci_read_32(device, PCI_BASE_ADDRESS_0 + (i * 4), &dev->bar[i]);
+    }
+    ++pci_num_devices;
+    return 0;
+}
+
+/// @brief Fills the table of the devices, the first time it is needed.
+static inline void __pci_enumerate(void)
+{
+    if (pci_enumerated) {
+        return;
+    }
+    pci_enumerated = 1;
+    if (__pci_walk(__pci_record, NULL)) {
+        pr_err("Failed to enumerate the PCI buses.\n");
+    }
+    pr_notice("Found %u PCI functions.\n", pci_num_devices);
+}
+
+int pci_scan(pci_scan_func_t f, int type, void *extra)
+{
+    // Check if the function pointer f is valid.
+    if (f == NULL) {
+        pr_err("Function pointer is NULL.\n");
+        return 1;
+    }
+    __pci_enumerate();
+    for (unsigned int i = 0; i < pci_num_devices; ++i) {
+        pci_dev_t *dev = &pci_devices[i];
+        if ((type == -1) || (type == (int)dev->type)) {
+            f(dev->device, dev->vendor_id, dev->device_id, extra);
+        }
+    }
+    return 0;
+}
+
+const pci_dev_t *pci_find_device(const pci_device_id_t *ids, const pci_dev_t *from)
+{
+    __pci_enumerate();
+    const pci_dev_t *dev = from ? (from + 1) : pci_devices;
+    for (; dev < (pci_devices + pci_num_devices); ++dev) {
+        for (const pci_device_id_t *id = ids; id->vendor_id; ++id) {
+            if (((id->vendor_id == PCI_ANY_ID) || (id->vendor_id == dev->vendor_id)) &&
+                ((id->device_id == PCI_ANY_ID) || (id->device_id == dev->device_id)) &&
+                ((id->type == PCI_ANY_ID) || (id->type == dev->type))) {
+                return dev;
+            }
+        }
+    }
+    return NULL;
+}
+
+const pci_dev_t *pci_get_device(uint32_t device)
+{
+    __pci_enumerate();
+    return __pci_lookup(device);
+}
+
+int pci_enable_ecam(uint32_t base, uint8_t start_bus, uint8_t end_bus)
+{
+    // The devices are still found through the I/O ports, so that only their
+    // pages are mapped, and not the whole region.
+    __pci_enumerate();
+    int mapped = 0;
+    for (unsigned int i = 0; i < pci_num_devices; ++i) {
+        pci_dev_t *dev = &pci_devices[i];
+        uint32_t bus   = PCI_GET_BUS(dev->device);
+        if ((bus < start_bus) || (bus > end_bus) || dev->config) {
+            continue;
+        }
+        uint32_t phys = base + ((bus - start_bus) << 20U) + (PCI_GET_SLOT(dev->device) << 15U) +
+                        (PCI_GET_FUNC(dev->device) << 12U);
+        uint32_t config = vmem_map_io(phys, PAGE_SIZE);
+        if (!config) {
+            continue;
+        }
+        // Do not trust a region which does not hold the device we know of.
+        if (*(volatile uint16_t *)config != dev->vendor_id) {
+            pr_warning("The ECAM page at 0x%08x does not match %04x:%04x.\n", phys, dev->vendor_id, dev->device_id);
+            vmem_unmap_virtual_address(config);
+            continue;
+        }
+        dev->config = config;
+        ++mapped;
+    }
+    if (mapped) {
+        pci_ecam_enabled = 1;
+    }
+    pr_notice("Accessing %d PCI functions through ECAM at 0x%08x.\n", mapped, base);
+    return mapped;
+}
+
 /// @brief Callback function to find an ISA bridge device.
 /// @param device The PCI device identifier.
 /// @param vendor_id The vendor ID of the device.
@@ -1047,27 +1310,6 @@ int pci_dump_device_data(uint32_t device, uint16_t vendor_id, uint16_t device_id
     return 0;
 }
 
-/// @brief Callback function to count PCI devices during scanning.
-/// @param device The PCI device identifier.
-/// @param vendor_id The vendor ID of the device.
-/// @param device_id The device ID of the device.
-/// @param extra Pointer to a size_t variable to store the count.
-/// @return 0 on success, non-zero on failure.
-static int __scan_count(uint32_t device, uint16_t vendor_id, uint16_t device_id, void *extra)
-{
-    (void)device;
-    (void)vendor_id;
-    (void)device_id;
-    // Check if the output pointer 'extra' is valid
-    if (extra == NULL) {
-        pr_err("Output parameter 'extra' is NULL.\n");
-        return -1;
-    }
-    // Increment the count
-    ++(*(size_t *)extra);
-    return 0;
-}
-
 /// @brief Callback function to process and display PCI device data during scanning.
 /// @param device The PCI device identifier.
 /// @param vendor_id The vendor ID of the device.
@@ -1089,10 +1331,8 @@ static int __scan_hit_list(uint32_t device, uint16_t vendor_id, uint16_t device_
 void pci_debug_scan(void)
 {
     pr_default("\n--------------------------------------------------\n");
-    pr_default("Counting PCI entities...\n");
-    size_t count = 0;
-    pci_scan(&__scan_count, -1, &count);
-    pr_default("Total PCI entities: %d\n", count);
+    __pci_enumerate();
+    pr_default("Total PCI entities: %u\n", pci_num_devices);
 
     pr_default("Scanning PCI entities...\n");
     pci_scan(&__scan_hit_list, -1, NULL);
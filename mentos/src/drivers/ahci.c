@@ -0,0 +1,1066 @@
+/// @file ahci.c
+/// @brief Driver for the Advanced Host Controller Interface (AHCI).
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup ahci
+/// @{
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[AHCI  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "drivers/ahci.h"
+
+#include "descriptor_tables/isr.h"
+#include "devices/pci.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/blkdev.h"
+#include "fs/vfs.h"
+#include "klib/irqflags.h"
+#include "klib/spinlock.h"
+#include "math.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page.h"
+#include "mem/mm/vmem.h"
+#include "process/scheduler.h"
+#include "proc_access.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "string.h"
+#include "sys/initcall.h"
+#include "system/syscall.h"
+
+#define AHCI_MAX_PORTS      32     ///< Maximum number of ports of a controller.
+#define AHCI_MAX_SLOTS      32     ///< Maximum number of command slots of a port.
+#define AHCI_SECTOR_SIZE    512    ///< The sector size.
+#define AHCI_PRDT_ENTRIES   8      ///< Number of PRDT entries of each command table.
+#define AHCI_ABAR_SIZE      0x1100 ///< Size of the register space.
+#define AHCI_BOUNCE_SECTORS 128    ///< Sectors of the bounce buffer.
+#define AHCI_BOUNCE_SIZE    (AHCI_SECTOR_SIZE * AHCI_BOUNCE_SECTORS) ///< Size of the bounce buffer.
+#define AHCI_CMD_LIST_SIZE  1024   ///< Size of the command list.
+#define AHCI_FIS_SIZE       256    ///< Size of the received FIS area.
+#define AHCI_CMD_TABLE_SIZE (128 + (AHCI_PRDT_ENTRIES * sizeof(ahci_prdt_entry_t))) ///< Size of a command table.
+#define AHCI_PORT_MEM_SIZE  (AHCI_CMD_LIST_SIZE + AHCI_FIS_SIZE + (AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE)) ///< Per-port memory.
+
+#define AHCI_CAP_SNCQ     (1U << 30)                     ///< Supports Native Command Queuing.
+#define AHCI_CAP_NCS(cap) ((((cap) >> 8U) & 0x1F) + 1) ///< Number of command slots.
+#define AHCI_GHC_IE       (1U << 1)                      ///< Interrupt enable.
+#define AHCI_GHC_AE       (1U << 31)                     ///< AHCI enable.
+
+#define AHCI_PxCMD_ST  (1U << 0)  ///< Start processing the command list.
+#define AHCI_PxCMD_FRE (1U << 4)  ///< FIS receive enable.
+#define AHCI_PxCMD_FR  (1U << 14) ///< FIS receive running.
+#define AHCI_PxCMD_CR  (1U << 15) ///< Command list running.
+
+#define AHCI_PxIS_ERR 0x7C000010U ///< All the error bits of the port interrupt status.
+#define AHCI_PxIE_ALL 0x7DC000FFU ///< All the supported port interrupts.
+
+#define AHCI_SSTS_DET_PRESENT 3          ///< Device present and communication established.
+#define AHCI_SSTS_IPM_ACTIVE  1          ///< Interface in active state.
+#define AHCI_SIG_ATA          0x00000101 ///< Signature of a SATA drive.
+
+#define AHCI_FIS_TYPE_REG_H2D 0x27 ///< Register FIS, from host to device.
+
+#define AHCI_CMD_IDENTIFY      0xEC ///< IDENTIFY DEVICE.
+#define AHCI_CMD_READ_DMA      0xC8 ///< READ DMA (LBA28).
+#define AHCI_CMD_WRITE_DMA     0xCA ///< WRITE DMA (LBA28).
+#define AHCI_CMD_READ_DMA_EXT  0x25 ///< READ DMA EXT (LBA48).
+#define AHCI_CMD_WRITE_DMA_EXT 0x35 ///< WRITE DMA EXT (LBA48).
+#define AHCI_CMD_READ_FPDMA    0x60 ///< READ FPDMA QUEUED (NCQ).
+#define AHCI_CMD_WRITE_FPDMA   0x61 ///< WRITE FPDMA QUEUED (NCQ).
+
+/// @brief The registers of a port.
+typedef volatile struct ahci_hba_port {
+    uint32_t clb;         ///< 0x00, command list base address, 1K-byte aligned.
+    uint32_t clbu;        ///< 0x04, command list base address upper 32 bits.
+    uint32_t fb;          ///< 0x08, FIS base address, 256-byte aligned.
+    uint32_t fbu;         ///< 0x0C, FIS base address upper 32 bits.
+    uint32_t is;          ///< 0x10, interrupt status.
+    uint32_t ie;          ///< 0x14, interrupt enable.
+    uint32_t cmd;         ///< 0x18, command and status.
+    uint32_t rsv0;        ///< 0x1C, reserved.
+    uint32_t tfd;         ///< 0x20, task file data.
+    uint32_t sig;         ///< 0x24, signature.
+    uint32_t ssts;        ///< 0x28, SATA status (SCR0:SStatus).
+    uint32_t sctl;        ///< 0x2C, SATA control (SCR2:SControl).
+    uint32_t serr;        ///< 0x30, SATA error (SCR1:SError).
+    uint32_t sact;        ///< 0x34, SATA active (SCR3:SActive).
+    uint32_t ci;          ///< 0x38, command issue.
+    uint32_t sntf;        ///< 0x3C, SATA notification (SCR4:SNotification).
+    uint32_t fbs;         ///< 0x40, FIS-based switch control.
+    uint32_t rsv1[11];    ///< 0x44 ~ 0x6F, reserved.
+    uint32_t vendor[4];   ///< 0x70 ~ 0x7F, vendor specific.
+} ahci_hba_port_t;
+
+/// @brief The memory-mapped registers of the controller.
+typedef volatile struct ahci_hba_mem {
+    uint32_t cap;                           ///< 0x00, host capability.
+    uint32_t ghc;                           ///< 0x04, global host control.
+    uint32_t is;                            ///< 0x08, interrupt status.
+    uint32_t pi;                            ///< 0x0C, ports implemented.
+    uint32_t vs;                            ///< 0x10, version.
+    uint32_t ccc_ctl;                       ///< 0x14, command completion coalescing control.
+    uint32_t ccc_pts;                       ///< 0x18, command completion coalescing ports.
+    uint32_t em_loc;                        ///< 0x1C, enclosure management location.
+    uint32_t em_ctl;                        ///< 0x20, enclosure management control.
+    uint32_t cap2;                          ///< 0x24, host capabilities extended.
+    uint32_t bohc;                          ///< 0x28, BIOS/OS handoff control and status.
+    uint8_t rsv[0xA0 - 0x2C];               ///< 0x2C - 0x9F, reserved.
+    uint8_t vendor[0x100 - 0xA0];           ///< 0xA0 - 0xFF, vendor specific registers.
+    ahci_hba_port_t ports[AHCI_MAX_PORTS]; ///< 0x100 - 0x10FF, port control registers.
+} ahci_hba_mem_t;
+
+/// @brief An entry of the command list.
+typedef struct ahci_cmd_header {
+    uint8_t cfl : 5;   ///< Command FIS length in DWORDS.
+    uint8_t a : 1;     ///< ATAPI.
+    uint8_t w : 1;     ///< Write, 1: H2D, 0: D2H.
+    uint8_t p : 1;     ///< Prefetchable.
+    uint8_t r : 1;     ///< Reset.
+    uint8_t b : 1;     ///< BIST.
+    uint8_t c : 1;     ///< Clear busy upon R_OK.
+    uint8_t rsv0 : 1;  ///< Reserved.
+    uint8_t pmp : 4;   ///< Port multiplier port.
+    uint16_t prdtl;    ///< Physical region descriptor table length in entries.
+    uint32_t prdbc;    ///< Physical region descriptor byte count transferred.
+    uint32_t ctba;     ///< Command table descriptor base address, 128-byte aligned.
+    uint32_t ctbau;    ///< Command table descriptor base address upper 32 bits.
+    uint32_t rsv1[4];  ///< Reserved.
+} __attribute__((packed)) ahci_cmd_header_t;
+
+/// @brief An entry of the physical region descriptor table.
+typedef struct ahci_prdt_entry {
+    uint32_t dba;       ///< Data base address, word aligned.
+    uint32_t dbau;      ///< Data base address upper 32 bits.
+    uint32_t rsv0;      ///< Reserved.
+    uint32_t dbc : 22;  ///< Byte count minus one, 4M max.
+    uint32_t rsv1 : 9;  ///< Reserved.
+    uint32_t i : 1;     ///< Interrupt on completion.
+} __attribute__((packed)) ahci_prdt_entry_t;
+
+/// @brief A register FIS, from host to device.
+typedef struct ahci_fis_reg_h2d {
+    uint8_t fis_type;   ///< AHCI_FIS_TYPE_REG_H2D.
+    uint8_t pmport : 4; ///< Port multiplier.
+    uint8_t rsv0 : 3;   ///< Reserved.
+    uint8_t c : 1;      ///< 1: command, 0: control.
+    uint8_t command;    ///< Command register.
+    uint8_t featurel;   ///< Feature register, 7:0.
+    uint8_t lba0;       ///< LBA low register, 7:0.
+    uint8_t lba1;       ///< LBA mid register, 15:8.
+    uint8_t lba2;       ///< LBA high register, 23:16.
+    uint8_t device;     ///< Device register.
+    uint8_t lba3;       ///< LBA register, 31:24.
+    uint8_t lba4;       ///< LBA register, 39:32.
+    uint8_t lba5;       ///< LBA register, 47:40.
+    uint8_t featureh;   ///< Feature register, 15:8.
+    uint8_t countl;     ///< Count register, 7:0.
+    uint8_t counth;     ///< Count register, 15:8.
+    uint8_t icc;        ///< Isochronous command completion.
+    uint8_t control;    ///< Control register.
+    uint8_t rsv1[4];    ///< Reserved.
+} __attribute__((packed)) ahci_fis_reg_h2d_t;
+
+/// @brief A command table, pointed by an entry of the command list.
+typedef struct ahci_cmd_table {
+    uint8_t cfis[64];                             ///< Command FIS.
+    uint8_t acmd[16];                             ///< ATAPI command, 12 or 16 bytes.
+    uint8_t rsv[48];                              ///< Reserved.
+    ahci_prdt_entry_t prdt[AHCI_PRDT_ENTRIES];    ///< Physical region descriptor table.
+} __attribute__((packed)) ahci_cmd_table_t;
+
+/// @brief A SATA drive attached to a port of the controller.
+typedef struct ahci_port {
+    /// The registers of the port.
+    ahci_hba_port_t *regs;
+    /// The index of the port.
+    uint32_t index;
+    /// Device name.
+    char name[NAME_MAX];
+    /// Device path.
+    char path[PATH_MAX];
+    /// The command list.
+    ahci_cmd_header_t *cmd_list;
+    /// The command tables, one for each slot.
+    ahci_cmd_table_t *cmd_tables[AHCI_MAX_SLOTS];
+    /// The bounce buffer, used when the caller buffer cannot be mapped.
+    uint8_t *bounce;
+    /// The physical address of the bounce buffer.
+    uintptr_t bounce_phys;
+    /// Number of sectors of the drive.
+    uint64_t sectors;
+    /// If the drive supports 48-bit addressing.
+    bool_t lba48;
+    /// If both the drive and the controller support NCQ.
+    bool_t ncq;
+    /// Number of usable command slots.
+    uint32_t num_slots;
+    /// Mask of the slots with a command in flight.
+    volatile uint32_t issued;
+    /// Mask of the slots whose command has failed.
+    volatile uint32_t failed;
+    /// The request served by each slot, if any.
+    blk_request_t *requests[AHCI_MAX_SLOTS];
+    /// Lock for the port.
+    spinlock_t lock;
+    /// The filesystem root of the drive.
+    vfs_file_t *fs_root;
+    /// The request queue of the drive.
+    request_queue_t queue;
+} ahci_port_t;
+
+/// The PCI identifier of the controller.
+static uint32_t ahci_pci = 0x00000000;
+/// The registers of the controller.
+static ahci_hba_mem_t *ahci_hba = NULL;
+/// The capabilities of the controller.
+static uint32_t ahci_cap = 0;
+/// The drives attached to the controller.
+static ahci_port_t ahci_ports[AHCI_MAX_PORTS];
+/// Mask of the ports with a drive attached.
+static uint32_t ahci_active_ports = 0;
+/// Keeps track of the drive letters.
+static char ahci_drive_char = 'a';
+
+// == SUPPORT FUNCTIONS =======================================================
+
+/// @brief Allocates physically contiguous low memory for the controller.
+/// @param size the size of the memory area.
+/// @param physical the physical address of the memory area.
+/// @return the logical address of the memory area, or 0 on failure.
+static inline uintptr_t ahci_dma_alloc(size_t size, uintptr_t *physical)
+{
+    // Get the page order to accommodate the requested size.
+    uint32_t order = find_nearest_order_greater(0, size);
+    // Allocate a contiguous block of memory pages.
+    page_t *page   = alloc_pages(GFP_KERNEL, order);
+    if (!page) {
+        pr_crit("Failed to allocate pages for DMA memory (order = %d).\n", order);
+        return 0;
+    }
+    *physical                = get_physical_address_from_page(page);
+    uintptr_t lowmem_address = get_virtual_address_from_page(page);
+    if (!*physical || !lowmem_address) {
+        pr_crit("Failed to retrieve the addresses of the DMA memory.\n");
+        free_pages(page);
+        return 0;
+    }
+    // The controller reads the reserved fields too, clear everything.
+    memset((void *)lowmem_address, 0, size);
+    return lowmem_address;
+}
+
+/// @brief Checks if the controller can transfer data directly to/from the buffer.
+/// @details A PRDT entry needs physically contiguous, word-aligned memory,
+/// which is the case for buffers inside the low memory.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+/// @param physical where we store the physical address of the buffer.
+/// @return 1 if the buffer can be used directly, 0 otherwise.
+static inline int ahci_dma_map_buffer(uint8_t *buffer, size_t size, uintptr_t *physical)
+{
+    uintptr_t vaddr = (uintptr_t)buffer;
+    // Data base addresses must be word-aligned.
+    if (vaddr & 0x1) {
+        return 0;
+    }
+    // The buffer must reside entirely inside the low memory.
+    if ((vaddr < memory.low_mem.virt_start) || (vaddr + size < vaddr) || (vaddr + size > memory.low_mem.virt_end)) {
+        return 0;
+    }
+    page_t *page = get_page_from_virtual_address(vaddr);
+    if (!page) {
+        return 0;
+    }
+    *physical = get_physical_address_from_page(page) + (vaddr & (PAGE_SIZE - 1));
+    return *physical != 0;
+}
+
+/// @brief Returns the maximum offset of the drive.
+/// @param port the drive.
+/// @return the size of the drive in bytes.
+static inline uint64_t ahci_max_offset(ahci_port_t *port) { return port->sectors * AHCI_SECTOR_SIZE; }
+
+/// @brief Stops the command engine of the port.
+/// @param regs the registers of the port.
+/// @return 0 on success, 1 if the engine did not stop.
+static inline int ahci_port_stop(ahci_hba_port_t *regs)
+{
+    regs->cmd &= ~AHCI_PxCMD_ST;
+    regs->cmd &= ~AHCI_PxCMD_FRE;
+    // Wait until the FIS receive and the command list engines stop.
+    for (long timeout = 1000000; timeout > 0; --timeout) {
+        if (!(regs->cmd & (AHCI_PxCMD_FR | AHCI_PxCMD_CR))) {
+            return 0;
+        }
+        pause();
+    }
+    return 1;
+}
+
+/// @brief Starts the command engine of the port.
+/// @param regs the registers of the port.
+static inline void ahci_port_start(ahci_hba_port_t *regs)
+{
+    // Wait until the command list engine is not running.
+    while (regs->cmd & AHCI_PxCMD_CR) {
+        pause();
+    }
+    regs->cmd |= AHCI_PxCMD_FRE;
+    regs->cmd |= AHCI_PxCMD_ST;
+}
+
+/// @brief Completes the commands of the port which are no longer in flight.
+/// @details Called both from the IRQ handler, and by the tasks waiting for
+/// their commands, so that a lost interrupt cannot stall them.
+/// @param port the drive.
+static void ahci_port_complete(ahci_port_t *port)
+{
+    uint32_t is = port->regs->is;
+    // Acknowledge the interrupts of the port.
+    port->regs->is = is;
+    // The command of a slot is done when it has been cleared from both the
+    // issued and the active masks.
+    uint32_t done  = port->issued & ~(port->regs->ci | port->regs->sact);
+    if (is & AHCI_PxIS_ERR) {
+        pr_err(
+            "[%s] Port error (is: 0x%08x, tfd: 0x%08x, serr: 0x%08x).\n", port->name, is, port->regs->tfd,
+            port->regs->serr);
+        // A command has failed, and the controller stopped processing the
+        // list: fail everything in flight, then restart the port, which also
+        // clears the issued and active masks.
+        port->failed |= port->issued;
+        done = port->issued;
+        ahci_port_stop(port->regs);
+        port->regs->serr = port->regs->serr;
+        port->regs->is   = port->regs->is;
+        ahci_port_start(port->regs);
+    }
+    for (uint32_t slot = 0; done && (slot < AHCI_MAX_SLOTS); ++slot) {
+        if (!(done & (1U << slot))) {
+            continue;
+        }
+        if (port->requests[slot]) {
+            port->requests[slot]->status = (port->failed & (1U << slot)) ? -EIO : 0;
+            port->requests[slot]         = NULL;
+        }
+        port->issued &= ~(1U << slot);
+    }
+}
+
+/// @brief Waits until the commands in the given slots are completed.
+/// @param port the drive.
+/// @param mask the mask of slots.
+static void ahci_port_wait(ahci_port_t *port, uint32_t mask)
+{
+    uint8_t flags = irq_disable();
+    ahci_port_complete(port);
+    while (port->issued & mask) {
+        // During boot there are no tasks, and interrupts are disabled, so we
+        // simply poll the port.
+        if (scheduler_get_current_process() == NULL) {
+            pause();
+        } else {
+            // The `sti` takes effect after `hlt`, so the IRQ cannot be lost.
+            __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+        }
+        ahci_port_complete(port);
+    }
+    irq_enable(flags);
+}
+
+/// @brief Returns a free command slot, waiting for one if they are all busy.
+/// @param port the drive.
+/// @return the index of the slot.
+static uint32_t ahci_port_get_slot(ahci_port_t *port)
+{
+    while (1) {
+        uint32_t busy = port->issued | port->regs->ci | port->regs->sact;
+        for (uint32_t slot = 0; slot < port->num_slots; ++slot) {
+            if (!(busy & (1U << slot))) {
+                return slot;
+            }
+        }
+        ahci_port_wait(port, port->issued);
+    }
+}
+
+/// @brief Prepares the command FIS of a read or write command.
+/// @param port the drive.
+/// @param slot the slot of the command.
+/// @param lba the first sector.
+/// @param count the number of sectors.
+/// @param write if the command is a write (1) or a read (0).
+static inline void
+ahci_port_setup_fis(ahci_port_t *port, uint32_t slot, uint64_t lba, uint32_t count, int write)
+{
+    ahci_fis_reg_h2d_t *fis = (ahci_fis_reg_h2d_t *)port->cmd_tables[slot]->cfis;
+    memset(fis, 0, sizeof(ahci_fis_reg_h2d_t));
+    fis->fis_type = AHCI_FIS_TYPE_REG_H2D;
+    fis->c        = 1;
+    fis->lba0     = (uint8_t)(lba & 0xFF);
+    fis->lba1     = (uint8_t)((lba >> 8U) & 0xFF);
+    fis->lba2     = (uint8_t)((lba >> 16U) & 0xFF);
+    fis->device   = 0x40;
+    if (port->ncq) {
+        // With NCQ the count goes in the feature register, and the count
+        // register holds the tag of the command.
+        fis->command  = write ? AHCI_CMD_WRITE_FPDMA : AHCI_CMD_READ_FPDMA;
+        fis->featurel = (uint8_t)(count & 0xFF);
+        fis->featureh = (uint8_t)((count >> 8U) & 0xFF);
+        fis->countl   = (uint8_t)(slot << 3U);
+        fis->lba3     = (uint8_t)((lba >> 24U) & 0xFF);
+        fis->lba4     = (uint8_t)((lba >> 32U) & 0xFF);
+        fis->lba5     = (uint8_t)((lba >> 40U) & 0xFF);
+    } else if (port->lba48) {
+        fis->command = write ? AHCI_CMD_WRITE_DMA_EXT : AHCI_CMD_READ_DMA_EXT;
+        fis->countl  = (uint8_t)(count & 0xFF);
+        fis->counth  = (uint8_t)((count >> 8U) & 0xFF);
+        fis->lba3    = (uint8_t)((lba >> 24U) & 0xFF);
+        fis->lba4    = (uint8_t)((lba >> 32U) & 0xFF);
+        fis->lba5    = (uint8_t)((lba >> 40U) & 0xFF);
+    } else {
+        fis->command = write ? AHCI_CMD_WRITE_DMA : AHCI_CMD_READ_DMA;
+        fis->countl  = (uint8_t)(count & 0xFF);
+        fis->device |= (uint8_t)((lba >> 24U) & 0x0F);
+    }
+}
+
+/// @brief Issues the command prepared in the given slot.
+/// @param port the drive.
+/// @param slot the slot of the command.
+/// @param prdt_count the number of PRDT entries used by the command.
+/// @param write if the command writes to the device.
+/// @param request the block request served by the command, if any.
+static inline void
+ahci_port_issue(ahci_port_t *port, uint32_t slot, uint32_t prdt_count, int write, blk_request_t *request)
+{
+    ahci_cmd_header_t *header = &port->cmd_list[slot];
+    header->cfl               = sizeof(ahci_fis_reg_h2d_t) / sizeof(uint32_t);
+    header->w                 = write ? 1 : 0;
+    header->prdtl             = prdt_count;
+    header->prdbc             = 0;
+    // Keep interrupts disabled, so that the IRQ handler does not see the slot
+    // half-issued.
+    uint8_t flags        = irq_disable();
+    port->requests[slot] = request;
+    port->failed &= ~(1U << slot);
+    port->issued |= (1U << slot);
+    // Queued commands must be marked as active before being issued.
+    if (port->ncq) {
+        port->regs->sact = (1U << slot);
+    }
+    port->regs->ci = (1U << slot);
+    irq_enable(flags);
+}
+
+/// @brief Sets an entry of the PRDT of a slot.
+/// @param port the drive.
+/// @param slot the slot of the command.
+/// @param index the index of the entry.
+/// @param physical the physical address of the memory region.
+/// @param size the size of the memory region.
+static inline void ahci_port_set_prdt(ahci_port_t *port, uint32_t slot, uint32_t index, uintptr_t physical, size_t size)
+{
+    ahci_prdt_entry_t *entry = &port->cmd_tables[slot]->prdt[index];
+    entry->dba               = physical;
+    entry->dbau              = 0;
+    entry->rsv0              = 0;
+    entry->dbc               = size - 1;
+    entry->rsv1              = 0;
+    entry->i                 = 0;
+}
+
+/// @brief Transfers consecutive sectors through a single memory region, and
+/// waits for the transfer to complete.
+/// @param port the drive.
+/// @param lba the first sector.
+/// @param count the number of sectors (at most AHCI_BOUNCE_SECTORS).
+/// @param physical the physical address of the memory region.
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return 0 on success, -errno on failure.
+static int ahci_port_transfer(ahci_port_t *port, uint64_t lba, uint32_t count, uintptr_t physical, int write)
+{
+    if ((lba + count) > port->sectors) {
+        pr_err("[%s] Transfer beyond the end of the drive (lba: %llu, count: %u).\n", port->name, lba, count);
+        return -EINVAL;
+    }
+    uint32_t slot = ahci_port_get_slot(port);
+    ahci_port_setup_fis(port, slot, lba, count, write);
+    ahci_port_set_prdt(port, slot, 0, physical, count * AHCI_SECTOR_SIZE);
+    ahci_port_issue(port, slot, 1, write, NULL);
+    ahci_port_wait(port, 1U << slot);
+    if (port->failed & (1U << slot)) {
+        pr_err("[%s] Failed to %s %u sectors at %llu.\n", port->name, write ? "write" : "read", count, lba);
+        return -EIO;
+    }
+    return 0;
+}
+
+/// @brief Transfers consecutive sectors through the bounce buffer of the
+/// drive. The caller holds the lock of the port.
+/// @param port the drive.
+/// @param lba the first sector.
+/// @param count the number of sectors (at most AHCI_BOUNCE_SECTORS).
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return 0 on success, -errno on failure.
+static inline int ahci_port_bounce(ahci_port_t *port, uint64_t lba, uint32_t count, int write)
+{
+    return ahci_port_transfer(port, lba, count, port->bounce_phys, write);
+}
+
+/// @brief Serves a request coming from the block I/O layer.
+/// @details When all the bios can be mapped, the request is issued with one
+/// PRDT entry per bio, and the function returns without waiting for it, so
+/// that the drive can have up to a full queue of requests in flight.
+/// Otherwise, the request is served synchronously through the bounce buffer.
+/// @param device the AHCI port.
+/// @param request the request.
+/// @return 0 on success, -errno on failure.
+static int ahci_request_fn(void *device, blk_request_t *request)
+{
+    ahci_port_t *port = (ahci_port_t *)device;
+    uintptr_t physical[AHCI_PRDT_ENTRIES];
+    uint32_t entries = 0;
+    int ret;
+    if ((request->sector + request->count) > port->sectors) {
+        return -EINVAL;
+    }
+    // Acquire the lock for thread safety.
+    spinlock_lock(&port->lock);
+    // Try to map all the bios of the request.
+    list_for_each_decl (it, &request->bios) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        if ((entries == AHCI_PRDT_ENTRIES) ||
+            !ahci_dma_map_buffer(bio->buffer, bio->count * AHCI_SECTOR_SIZE, &physical[entries])) {
+            entries = 0;
+            break;
+        }
+        ++entries;
+    }
+    if (entries) {
+        uint32_t slot = ahci_port_get_slot(port);
+        uint32_t i    = 0;
+        ahci_port_setup_fis(port, slot, request->sector, request->count, request->write);
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            ahci_port_set_prdt(port, slot, i, physical[i], bio->count * AHCI_SECTOR_SIZE);
+            ++i;
+        }
+        ahci_port_issue(port, slot, entries, request->write, request);
+        // Release the lock, the completion is handled by ahci_sync_fn.
+        spinlock_unlock(&port->lock);
+        return 0;
+    }
+    if (request->write) {
+        // Gather the bios inside the bounce buffer.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                port->bounce + (bio->sector - request->sector) * AHCI_SECTOR_SIZE, bio->buffer,
+                bio->count * AHCI_SECTOR_SIZE);
+        }
+    }
+    // Perform the transfer.
+    ret = ahci_port_bounce(port, request->sector, request->count, request->write);
+    if ((ret == 0) && !request->write) {
+        // Scatter the bounce buffer to the bios.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                bio->buffer, port->bounce + (bio->sector - request->sector) * AHCI_SECTOR_SIZE,
+                bio->count * AHCI_SECTOR_SIZE);
+        }
+    }
+    // Release the lock after the operation.
+    spinlock_unlock(&port->lock);
+    return ret;
+}
+
+/// @brief Waits for all the requests in flight on the drive.
+/// @param device the AHCI port.
+static void ahci_sync_fn(void *device)
+{
+    ahci_port_t *port = (ahci_port_t *)device;
+    ahci_port_wait(port, port->issued);
+}
+
+// == VFS CALLBACKS ===========================================================
+
+/// @brief Implements the open function for an AHCI drive.
+/// @param path the path to the drive we want to open.
+/// @param flags we ignore these.
+/// @param mode we currently ignore this.
+/// @return the VFS file associated with the drive.
+static vfs_file_t *ahci_open(const char *path, int flags, mode_t mode)
+{
+    pr_debug("ahci_open(%s, %d, %d)\n", path, flags, mode);
+    for (uint32_t i = 0; i < AHCI_MAX_PORTS; ++i) {
+        ahci_port_t *port = &ahci_ports[i];
+        if ((ahci_active_ports & (1U << i)) && port->fs_root && (strcmp(path, port->path) == 0)) {
+            // Increment reference count for the file.
+            ++port->fs_root->count;
+            return port->fs_root;
+        }
+    }
+    pr_crit("Device not found for path: %s\n", path);
+    return NULL;
+}
+
+/// @brief Closes an AHCI drive.
+/// @param file the VFS file associated with the drive.
+/// @return 0 on success, -errno on failure.
+static int ahci_close(vfs_file_t *file)
+{
+    // Validate the file pointer.
+    if (file == NULL) {
+        pr_err("ahci_close: Invalid file pointer (NULL).\n");
+        return -EINVAL;
+    }
+    if (file->device == NULL) {
+        pr_crit("ahci_close: Device not set for file `%s`.\n", file->name);
+        return -ENODEV;
+    }
+    // Decrement the reference count for the file.
+    if (--file->count == 0) {
+        // Remove the file from the list of opened files.
+        list_head_remove(&file->siblings);
+        // Free the file from cache.
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Reads from an AHCI drive.
+/// @param file the VFS file associated with the drive.
+/// @param buffer the buffer where we store what we read.
+/// @param offset the offset where we want to read.
+/// @param size the size of the buffer.
+/// @return the number of read characters, -errno on failure.
+static ssize_t ahci_read(vfs_file_t *file, char *buffer, off_t offset, size_t size)
+{
+    ahci_port_t *port   = (ahci_port_t *)file->device;
+    uint64_t max_offset = ahci_max_offset(port);
+    size_t done         = 0;
+    // Check the boundaries of the read.
+    if ((offset < 0) || ((uint64_t)offset >= max_offset)) {
+        return 0;
+    }
+    size = min(size, max_offset - offset);
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&port->queue);
+    uint32_t sectors         = ((offset + size - 1) / AHCI_SECTOR_SIZE) - (offset / AHCI_SECTOR_SIZE) + 1;
+    while (done < size) {
+        uint64_t position = (uint64_t)offset + done;
+        uint32_t start    = position % AHCI_SECTOR_SIZE;
+        uint32_t count    = min((start + (size - done) + AHCI_SECTOR_SIZE - 1) / AHCI_SECTOR_SIZE, AHCI_BOUNCE_SECTORS);
+        uint32_t length   = min(count * AHCI_SECTOR_SIZE - start, size - done);
+        spinlock_lock(&port->lock);
+        int ret = ahci_port_bounce(port, position / AHCI_SECTOR_SIZE, count, 0);
+        if (ret == 0) {
+            memcpy(buffer + done, port->bounce + start, length);
+        }
+        spinlock_unlock(&port->lock);
+        if (ret < 0) {
+            blk_stats_done(&port->queue, 0, sectors, start_time);
+            return ret;
+        }
+        done += length;
+    }
+    blk_stats_done(&port->queue, 0, sectors, start_time);
+    return done;
+}
+
+/// @brief Writes on an AHCI drive.
+/// @details Partial sectors are read first, and the whole update happens under
+/// the lock of the port, so that concurrent writers do not clobber each other.
+/// @param file the VFS file associated with the drive.
+/// @param buffer the buffer we write.
+/// @param offset the offset where we want to write.
+/// @param size the size of the buffer.
+/// @return the number of written characters, -errno on failure.
+static ssize_t ahci_write(vfs_file_t *file, const void *buffer, off_t offset, size_t size)
+{
+    ahci_port_t *port   = (ahci_port_t *)file->device;
+    uint64_t max_offset = ahci_max_offset(port);
+    size_t done         = 0;
+    // Check the boundaries of the write.
+    if ((offset < 0) || ((uint64_t)offset >= max_offset)) {
+        return 0;
+    }
+    size = min(size, max_offset - offset);
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&port->queue);
+    uint32_t sectors         = ((offset + size - 1) / AHCI_SECTOR_SIZE) - (offset / AHCI_SECTOR_SIZE) + 1;
+    while (done < size) {
+        uint64_t position = (uint64_t)offset + done;
+        uint32_t start    = position % AHCI_SECTOR_SIZE;
+        uint32_t count    = min((start + (size - done) + AHCI_SECTOR_SIZE - 1) / AHCI_SECTOR_SIZE, AHCI_BOUNCE_SECTORS);
+        uint32_t length   = min(count * AHCI_SECTOR_SIZE - start, size - done);
+        int ret           = 0;
+        spinlock_lock(&port->lock);
+        // Read the sectors we only partially overwrite.
+        if ((start != 0) || (length != count * AHCI_SECTOR_SIZE)) {
+            ret = ahci_port_bounce(port, position / AHCI_SECTOR_SIZE, count, 0);
+        }
+        if (ret == 0) {
+            memcpy(port->bounce + start, (const char *)buffer + done, length);
+            ret = ahci_port_bounce(port, position / AHCI_SECTOR_SIZE, count, 1);
+        }
+        spinlock_unlock(&port->lock);
+        if (ret < 0) {
+            blk_stats_done(&port->queue, 1, sectors, start_time);
+            return ret;
+        }
+        done += length;
+    }
+    blk_stats_done(&port->queue, 1, sectors, start_time);
+    return done;
+}
+
+/// @brief Retrieves information concerning the AHCI drive.
+/// @param port the drive.
+/// @param stat the stat buffer.
+/// @return 0 on success.
+static int _ahci_stat(const ahci_port_t *port, stat_t *stat)
+{
+    if (port && port->fs_root) {
+        stat->st_dev   = 0;
+        stat->st_ino   = 0;
+        stat->st_mode  = port->fs_root->mask;
+        stat->st_uid   = port->fs_root->uid;
+        stat->st_gid   = port->fs_root->gid;
+        stat->st_atime = port->fs_root->atime;
+        stat->st_mtime = port->fs_root->mtime;
+        stat->st_ctime = port->fs_root->ctime;
+        stat->st_size  = port->fs_root->length;
+    }
+    return 0;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param file the file.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int ahci_fstat(vfs_file_t *file, stat_t *stat) { return _ahci_stat(file->device, stat); }
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param path the path where the file resides.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int ahci_stat(const char *path, stat_t *stat)
+{
+    super_block_t *sb = vfs_get_superblock(path);
+    if (sb && sb->root) {
+        return _ahci_stat(sb->root->device, stat);
+    }
+    return -1;
+}
+
+// == VFS ENTRY GENERATION ====================================================
+
+/// @brief The mount call-back, AHCI drives are registered when detected.
+/// @param path the path where the filesystem should be mounted.
+/// @param device the device we mount.
+/// @param options the mount options, unused.
+/// @return the VFS file of the filesystem.
+static vfs_file_t *ahci_mount_callback(const char *path, const char *device, const char *options)
+{
+    pr_err("mount_callback(%s, %s): AHCI has no mount callback!\n", path, device);
+    return NULL;
+}
+
+/// Filesystem information.
+static file_system_type_t ahci_file_system_type = {.name = "ahci", .fs_flags = 0, .mount = ahci_mount_callback};
+
+/// Filesystem general operations.
+static vfs_sys_operations_t ahci_sys_operations = {
+    .mkdir_f   = NULL,
+    .rmdir_f   = NULL,
+    .stat_f    = ahci_stat,
+    .creat_f   = NULL,
+    .symlink_f = NULL,
+};
+
+/// AHCI filesystem file operations.
+static vfs_file_operations_t ahci_fs_operations = {
+    .open_f     = ahci_open,
+    .unlink_f   = NULL,
+    .close_f    = ahci_close,
+    .read_f     = ahci_read,
+    .write_f    = ahci_write,
+    .lseek_f    = NULL,
+    .stat_f     = ahci_fstat,
+    .ioctl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+};
+
+/// @brief Creates a VFS file, starting from an AHCI drive.
+/// @param port the drive.
+/// @return a pointer to the VFS file on success, NULL on failure.
+static vfs_file_t *ahci_device_create(ahci_port_t *port)
+{
+    // Create the file.
+    vfs_file_t *file = vfs_alloc_file();
+    if (file == NULL) {
+        pr_err("Failed to create AHCI device.\n");
+        return NULL;
+    }
+    // Set the device name.
+    memcpy(file->name, port->name, NAME_MAX);
+    file->uid            = 0;
+    file->gid            = 0;
+    file->mask           = 0x2000 | 0600;
+    file->atime          = sys_time(NULL);
+    file->mtime          = sys_time(NULL);
+    file->ctime          = sys_time(NULL);
+    file->length         = min(ahci_max_offset(port), UINT32_MAX);
+    // Set the device.
+    file->device         = port;
+    // Re-set the flags.
+    file->flags          = DT_BLK;
+    // Change the operations.
+    file->sys_operations = &ahci_sys_operations;
+    file->fs_operations  = &ahci_fs_operations;
+    return file;
+}
+
+// == PORT INITIALIZATION =====================================================
+
+/// @brief Sets up the command list, the FIS area and the command tables of a port.
+/// @param port the drive.
+/// @return 0 on success, 1 on failure.
+static int ahci_port_rebase(ahci_port_t *port)
+{
+    uintptr_t physical;
+    // Stop the command engine before changing its memory.
+    if (ahci_port_stop(port->regs)) {
+        pr_err("[port %u] The command engine did not stop.\n", port->index);
+        return 1;
+    }
+    // Allocate the command list, the FIS area and the command tables.
+    uintptr_t base = ahci_dma_alloc(AHCI_PORT_MEM_SIZE, &physical);
+    if (!base) {
+        return 1;
+    }
+    // Allocate the bounce buffer.
+    port->bounce = (uint8_t *)ahci_dma_alloc(AHCI_BOUNCE_SIZE, &port->bounce_phys);
+    if (!port->bounce) {
+        free_pages(get_page_from_virtual_address(base));
+        return 1;
+    }
+    port->cmd_list   = (ahci_cmd_header_t *)base;
+    port->regs->clb  = physical;
+    port->regs->clbu = 0;
+    port->regs->fb   = physical + AHCI_CMD_LIST_SIZE;
+    port->regs->fbu  = 0;
+    for (uint32_t slot = 0; slot < AHCI_MAX_SLOTS; ++slot) {
+        uint32_t offset             = AHCI_CMD_LIST_SIZE + AHCI_FIS_SIZE + (slot * AHCI_CMD_TABLE_SIZE);
+        port->cmd_tables[slot]      = (ahci_cmd_table_t *)(base + offset);
+        port->cmd_list[slot].ctba   = physical + offset;
+        port->cmd_list[slot].ctbau  = 0;
+        port->requests[slot]        = NULL;
+    }
+    // Clear the errors and the pending interrupts, then restart the engine.
+    port->regs->serr = port->regs->serr;
+    port->regs->is   = port->regs->is;
+    ahci_port_start(port->regs);
+    return 0;
+}
+
+/// @brief Identifies the drive attached to the port.
+/// @param port the drive.
+/// @return 0 on success, 1 on failure.
+static int ahci_port_identify(ahci_port_t *port)
+{
+    uint16_t *identity = (uint16_t *)port->bounce;
+    uint32_t slot      = ahci_port_get_slot(port);
+    // Prepare the IDENTIFY DEVICE command.
+    ahci_fis_reg_h2d_t *fis = (ahci_fis_reg_h2d_t *)port->cmd_tables[slot]->cfis;
+    memset(fis, 0, sizeof(ahci_fis_reg_h2d_t));
+    fis->fis_type = AHCI_FIS_TYPE_REG_H2D;
+    fis->c        = 1;
+    fis->command  = AHCI_CMD_IDENTIFY;
+    ahci_port_set_prdt(port, slot, 0, port->bounce_phys, AHCI_SECTOR_SIZE);
+    // IDENTIFY is not a queued command, NCQ is enabled only afterwards.
+    ahci_port_issue(port, slot, 1, 0, NULL);
+    ahci_port_wait(port, 1U << slot);
+    if (port->failed & (1U << slot)) {
+        return 1;
+    }
+    // Word 83, bit 10: the 48-bit address feature set is supported.
+    port->lba48 = (identity[83] & (1U << 10)) != 0;
+    if (port->lba48) {
+        port->sectors = ((uint64_t)identity[103] << 48U) | ((uint64_t)identity[102] << 32U) |
+                        ((uint64_t)identity[101] << 16U) | identity[100];
+    } else {
+        port->sectors = ((uint32_t)identity[61] << 16U) | identity[60];
+    }
+    // Word 76, bit 8: NCQ is supported, word 75 holds the queue depth minus one.
+    port->ncq       = port->lba48 && (ahci_cap & AHCI_CAP_SNCQ) && (identity[76] & (1U << 8));
+    port->num_slots = AHCI_CAP_NCS(ahci_cap);
+    if (port->ncq) {
+        port->num_slots = min(port->num_slots, (uint32_t)(identity[75] & 0x1F) + 1);
+    }
+    return port->sectors == 0;
+}
+
+/// @brief Detects and registers the drive attached to a port.
+/// @param index the index of the port.
+static void ahci_port_detect(uint32_t index)
+{
+    ahci_port_t *port = &ahci_ports[index];
+    memset(port, 0, sizeof(ahci_port_t));
+    port->index = index;
+    port->regs  = &ahci_hba->ports[index];
+    // Check that the device is present, and the link is active.
+    uint32_t ssts = port->regs->ssts;
+    if (((ssts & 0x0F) != AHCI_SSTS_DET_PRESENT) || (((ssts >> 8U) & 0x0F) != AHCI_SSTS_IPM_ACTIVE)) {
+        return;
+    }
+    // We only support drives, no ATAPI or port multipliers.
+    if (port->regs->sig != AHCI_SIG_ATA) {
+        pr_debug("[port %u] Skipping device with signature 0x%08x.\n", index, port->regs->sig);
+        return;
+    }
+    spinlock_init(&port->lock);
+    port->num_slots = 1;
+    if (ahci_port_rebase(port)) {
+        pr_err("[port %u] Failed to set up the port.\n", index);
+        return;
+    }
+    // Enable the interrupts of the port.
+    port->regs->ie = AHCI_PxIE_ALL;
+    // Set the device name and path.
+    sprintf(port->name, "sd%c", ahci_drive_char);
+    sprintf(port->path, "/dev/sd%c", ahci_drive_char);
+    if (ahci_port_identify(port)) {
+        pr_err("[port %u] Failed to identify the drive.\n", index);
+        return;
+    }
+    // Create the filesystem entry for the drive.
+    port->fs_root = ahci_device_create(port);
+    if (!port->fs_root) {
+        pr_alert("Failed to create ahci device!\n");
+        return;
+    }
+    if (!vfs_register_superblock(port->fs_root->name, port->path, &ahci_file_system_type, port->fs_root)) {
+        pr_alert("Failed to mount ahci device!\n");
+        vfs_dealloc_file(port->fs_root);
+        port->fs_root = NULL;
+        return;
+    }
+    ahci_active_ports |= (1U << index);
+    // Initialize the request queue of the drive, with NCQ it can keep all the
+    // slots busy.
+    if (blk_queue_init(&port->queue, port->fs_root, port, ahci_request_fn, AHCI_BOUNCE_SECTORS) < 0) {
+        pr_warning("[%s] Failed to initialize the request queue.\n", port->name);
+    } else if (port->ncq && (blk_queue_set_depth(&port->queue, port->num_slots, ahci_sync_fn) < 0)) {
+        pr_warning("[%s] Failed to set the depth of the request queue.\n", port->name);
+    }
+    // Increment the drive letter.
+    ++ahci_drive_char;
+    pr_notice(
+        "Initialized %s on port %u (%llu sectors, %s, queue depth %u).\n", port->name, index, port->sectors,
+        port->ncq ? "NCQ" : (port->lba48 ? "LBA48" : "LBA28"), port->ncq ? port->num_slots : 1);
+}
+
+// == IRQ HANDLER =============================================================
+
+/// @brief Handles the IRQ of the controller.
+/// @param f The interrupt stack frame.
+static void ahci_irq_handler(pt_regs_t *f)
+{
+    uint32_t is = ahci_hba->is;
+    for (uint32_t i = 0; i < AHCI_MAX_PORTS; ++i) {
+        if ((is & (1U << i)) && (ahci_active_ports & (1U << i))) {
+            ahci_port_complete(&ahci_ports[i]);
+        }
+    }
+    // Acknowledge the interrupts, after clearing the ones of the ports.
+    ahci_hba->is = is;
+}
+
+// == PCI FUNCTIONS ===========================================================
+
+/// The AHCI controllers, whoever their vendor.
+static const pci_device_id_t ahci_pci_ids[] = {
+    {PCI_ANY_ID, PCI_ANY_ID, PCI_TYPE_AHCI},
+    {0, 0, 0},
+};
+
+// == INITIALIZE/FINALIZE AHCI ================================================
+
+int ahci_initialize(void)
+{
+    uint32_t abar;
+    uint16_t command;
+    uint8_t irq;
+    // Search for the AHCI controller, we only drive the first one.
+    const pci_dev_t *pci = pci_find_device(ahci_pci_ids, NULL);
+    if (pci == NULL) {
+        pr_notice("No AHCI controller found.\n");
+        return 0;
+    }
+    ahci_pci = pci->device;
+    pci_dump_device_data(pci->device, pci->vendor_id, pci->device_id);
+    // Read the base address of the registers, and the IRQ line.
+    if (pci_read_32(ahci_pci, PCI_BASE_ADDRESS_5, &abar) || pci_read_8(ahci_pci, PCI_INTERRUPT_LINE, &irq) ||
+        pci_read_16(ahci_pci, PCI_COMMAND, &command)) {
+        pr_err("Failed to read the configuration of the AHCI controller.\n");
+        return 1;
+    }
+    // Enable memory space access and bus mastering.
+    if (pci_write_16(ahci_pci, PCI_COMMAND, command | 0x06)) {
+        pr_err("Failed to enable bus mastering for the AHCI controller.\n");
+        return 1;
+    }
+    // Map the registers.
+    ahci_hba = (ahci_hba_mem_t *)vmem_map_io(abar & ~0xFU, AHCI_ABAR_SIZE);
+    if (!ahci_hba) {
+        pr_err("Failed to map the registers of the AHCI controller.\n");
+        return 1;
+    }
+    // Switch the controller to AHCI mode.
+    ahci_hba->ghc |= AHCI_GHC_AE;
+    ahci_cap = ahci_hba->cap;
+    pr_debug("AHCI version 0x%08x, capabilities 0x%08x.\n", ahci_hba->vs, ahci_cap);
+
+    // Register the filesystem.
+    vfs_register_filesystem(&ahci_file_system_type);
+
+    // Detect the drives, interrupts are still masked, so we poll.
+    uint32_t implemented = ahci_hba->pi;
+    for (uint32_t i = 0; i < AHCI_MAX_PORTS; ++i) {
+        if (implemented & (1U << i)) {
+            ahci_port_detect(i);
+        }
+    }
+
+    // Install the IRQ handler, and enable the interrupts, with a vector of
+    // its own through MSI if possible, so that no other device shares it.
+    int vector = irq_install_msi(ahci_pci, ahci_irq_handler, "AHCI");
+    if (vector >= 0) {
+        pr_debug("The AHCI controller interrupts through MSI, at vector %d.\n", vector);
+        ahci_hba->is = ahci_hba->is;
+        ahci_hba->ghc |= AHCI_GHC_IE;
+    } else if (irq < 16) {
+        irq_install_handler(irq, ahci_irq_handler, "AHCI");
+        irq_unmask(irq);
+        ahci_hba->is = ahci_hba->is;
+        ahci_hba->ghc |= AHCI_GHC_IE;
+    } else {
+        pr_warning("The AHCI controller has no IRQ line, falling back to polling.\n");
+    }
+    return 0;
+}
+
+deferred_initcall(ahci_initialize, NULL);
+
+int ahci_finalize(void) { return 0; }
+
+/// @}
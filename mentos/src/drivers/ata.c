@@ -18,19 +18,23 @@
 #include "devices/pci.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/blkdev.h"
 #include "fs/vfs.h"
 #include "hardware/pic8259.h"
 #include "io/port_io.h"
-#include "klib/spinlock.h"
+#include "klib/irqflags.h"
+#include "klib/mutex.h"
 #include "math.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/mm/page.h"
+#include "process/scheduler.h"
 #include "process/wait.h"
 #include "stdbool.h"
 #include "stdio.h"
 #include "string.h"
 #include "sys/bitops.h"
 #include "system/panic.h"
+#include "system/softirq.h"
 #include "system/syscall.h"
 
 /// @brief IDENTIFY device data (response to 0xEC).
@@ -123,12 +127,16 @@ typedef struct ata_identity {
     uint8_t block_erase_ext_command_supported : 1;
     /// Word  60-61 : Contains the total number of 28 bit LBA addressable sectors on the drive.
     uint32_t sectors_28;
-    /// Word  62-99 : We do not care for these right now.
-    uint16_t unused6[38];
+    /// Word  62-82 : We do not care for these right now.
+    uint16_t unused6[21];
+    /// Word     83 : Command sets supported, bit 10 is set if the 48-bit address feature set is supported.
+    uint16_t command_set_supported_83;
+    /// Word  84-99 : We do not care for these right now.
+    uint16_t unused7[16];
     /// Word 100-103: Contains the total number of 48 bit addressable sectors on the drive.
     uint64_t sectors_48;
     /// Word 104-256: We do not care for these right now.
-    uint16_t unused7[152];
+    uint16_t unused8[152];
 } ata_identity_t;
 
 /// @brief Physical Region Descriptor Table (PRDT) entry.
@@ -243,12 +251,31 @@ typedef struct ata_device {
     } dma;
     /// Device root file.
     vfs_file_t *fs_root;
-    /// For device lock.
-    spinlock_t lock;
+    /// Serializes the requests, which own the registers and the DMA area
+    /// until they complete, while their task sleeps.
+    mutex_t lock;
+    /// Tasks waiting for the completion of the DMA request in flight.
+    wait_queue_head_t wait_queue;
+    /// Set while a DMA request is in flight, and cleared by the IRQ handler.
+    volatile bool_t dma_pending;
+    /// The bus master status read by the IRQ handler upon completion.
+    volatile uint8_t dma_status;
+    /// Wakes up the tasks waiting for the request, after the IRQ handler.
+    tasklet_t wakeup;
+    /// The request queue of the device.
+    request_queue_t queue;
+    /// If the device supports the 48-bit address feature set.
+    bool_t lba48;
 } ata_device_t;
 
-#define ATA_SECTOR_SIZE 512 ///< The sector size.
-#define ATA_DMA_SIZE    512 ///< The size of the DMA area.
+#define ATA_SECTOR_SIZE      512                                         ///< The sector size.
+#define ATA_DMA_MAX_SECTORS  128                                         ///< Maximum number of sectors per DMA command.
+#define ATA_DMA_SIZE         (ATA_SECTOR_SIZE * ATA_DMA_MAX_SECTORS)     ///< The size of the DMA area.
+#define ATA_PRDT_REGION_SIZE 0x10000                                     ///< A PRDT region cannot cross a 64K boundary.
+#define ATA_LBA28_MAX_SECTORS 256                                        ///< Maximum number of sectors per LBA28 command.
+#define ATA_LBA28_MAX_LBA     0x0FFFFFFF                                 ///< Maximum sector addressable with LBA28.
+#define ATA_LBA48_MAX_SECTORS 65536                                      ///< Maximum number of sectors per LBA48 command.
+#define ATA_PRDT_MAX_ENTRIES  (((ATA_SECTOR_SIZE * ATA_LBA48_MAX_SECTORS) / ATA_PRDT_REGION_SIZE) + 1) ///< Maximum number of PRDT entries.
 
 /// @brief Keeps track of the incremental letters for the ATA drives.
 static char ata_drive_char = 'a';
@@ -505,7 +532,8 @@ static inline void ata_dump_device(ata_device_t *dev)
     pr_debug("        overwrite_ext_command_supported       : %u\n", dev->identity.overwrite_ext_command_supported);
     pr_debug("        block_erase_ext_command_supported     : %u\n", dev->identity.block_erase_ext_command_supported);
     pr_debug("        sectors_28                            : %u\n", dev->identity.sectors_28);
-    pr_debug("        sectors_48                            : %u\n", dev->identity.sectors_48);
+    pr_debug("        sectors_48                            : %llu\n", dev->identity.sectors_48);
+    pr_debug("        lba48                                 : %u\n", dev->lba48);
     pr_debug("    }\n");
     pr_debug("    bmr {\n");
     pr_debug("        command : %6u, status : %6u, prdt : %6u\n", dev->bmr.command, dev->bmr.status, dev->bmr.prdt);
@@ -907,6 +935,42 @@ static inline int ata_dma_initialize_bus_mastering_address(ata_device_t *dev)
     return 0;
 }
 
+/// @brief Fills the PRDT so that it describes the given physical memory area.
+/// @details Each entry can describe at most 64K bytes, and cannot cross a 64K
+/// boundary, so the area is split into as many entries as needed.
+/// @param dev the device whose PRDT we are filling.
+/// @param physical the physical address of the memory area.
+/// @param size the size of the memory area, in bytes.
+/// @return the number of PRDT entries used, 0 on failure.
+static inline unsigned ata_dma_setup_prdt(ata_device_t *dev, uintptr_t physical, size_t size)
+{
+    unsigned entry = 0;
+    while (size > 0) {
+        // We ran out of entries.
+        if (entry == ATA_PRDT_MAX_ENTRIES) {
+            pr_crit("[%s] The DMA area does not fit inside the PRDT.\n", ata_get_device_settings_str(dev));
+            return 0;
+        }
+        // Compute how many bytes we can transfer before hitting a 64K boundary.
+        size_t chunk = ATA_PRDT_REGION_SIZE - (physical & (ATA_PRDT_REGION_SIZE - 1));
+        if (chunk > size) {
+            chunk = size;
+        }
+        dev->dma.prdt[entry].physical_address = physical;
+        // A byte count of zero means 64K.
+        dev->dma.prdt[entry].byte_count       = (unsigned short)(chunk & 0xFFFF);
+        dev->dma.prdt[entry].end_of_table     = 0;
+        physical += chunk;
+        size -= chunk;
+        ++entry;
+    }
+    // Set the End of Table (EOT) flag on the last entry.
+    if (entry > 0) {
+        dev->dma.prdt[entry - 1].end_of_table = 0x8000;
+    }
+    return entry;
+}
+
 // == ATA DEVICE MANAGEMENT ===================================================
 
 /// @brief Detects the type of device.
@@ -968,6 +1032,9 @@ static inline ata_device_type_t ata_detect_device_type(ata_device_t *dev)
     ata_fix_string((char *)&dev->identity.firmware_revision, count_of(dev->identity.firmware_revision) - 1);
     ata_fix_string((char *)&dev->identity.model_number, count_of(dev->identity.model_number) - 1);
 
+    // Check if the device supports 48-bit addressing.
+    dev->lba48 = (dev->identity.command_set_supported_83 & (1 << 10)) && (dev->identity.sectors_48 != 0);
+
     // Get the "signature bytes" by reading low and high cylinder registers.
     uint8_t lba_lo  = inportb(dev->io_reg.lba_lo);
     uint8_t lba_mid = inportb(dev->io_reg.lba_mid);
@@ -1031,7 +1098,7 @@ static bool_t ata_device_init(ata_device_t *dev)
     }
 
     // Allocate the memory for the Physical Region Descriptor Table (PRDT).
-    dev->dma.prdt = (prdt_t *)ata_dma_alloc(sizeof(prdt_t), &dev->dma.prdt_phys);
+    dev->dma.prdt = (prdt_t *)ata_dma_alloc(sizeof(prdt_t) * ATA_PRDT_MAX_ENTRIES, &dev->dma.prdt_phys);
     if (dev->dma.prdt == NULL) {
         pr_crit(
             "[%-16s, %-9s] Failed to allocate memory for PRDT.\n", ata_get_device_settings_str(dev),
@@ -1050,14 +1117,8 @@ static bool_t ata_device_init(ata_device_t *dev)
         return 1;
     }
 
-    // Initialize the PRDT with the physical address of the DMA.
-    dev->dma.prdt->physical_address = dev->dma.start_phys;
-
-    // Set the size of the DMA transfer.
-    dev->dma.prdt->byte_count = ATA_DMA_SIZE;
-
-    // Set the End of Table (EOT) flag.
-    dev->dma.prdt->end_of_table = 0x8000;
+    // Initialize the PRDT so that it covers a single sector of the DMA area.
+    ata_dma_setup_prdt(dev, dev->dma.start_phys, ATA_SECTOR_SIZE);
 
     // Print the device data for debugging purposes.
     ata_dump_device(dev);
@@ -1067,26 +1128,129 @@ static bool_t ata_device_init(ata_device_t *dev)
 
 // == ATA SECTOR READ/WRITE FUNCTIONS =========================================
 
-/// @brief Reads an ATA sector.
-/// @param dev the device on which we perform the read.
-/// @param lba_sector the sector where we write.
-/// @param buffer the buffer we are writing.
-static void ata_device_read_sector(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+/// @brief Completes the DMA request in flight on the given device.
+/// @details Called either by the IRQ handler of the channel, or by the polling
+/// loop when interrupts cannot be used. It stops the bus master, acknowledges
+/// the interrupt, and schedules the wake-up of the tasks waiting for the request.
+/// @param dev the device whose request has completed.
+/// @return 1 if a request was completed, 0 otherwise.
+static inline int ata_dma_complete(ata_device_t *dev)
 {
-    // Check if we are trying to perform the read on a valid device type.
-    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
-        pr_crit("[%s] Unsupported device type for read operation.\n", ata_get_device_settings_str(dev));
+    // Check if there is a request in flight on this device.
+    if (!dev->dma_pending) {
+        return 0;
+    }
+    uint8_t status = inportb(dev->bmr.status);
+    // Check if the interrupt was generated by this device.
+    if (!(status & 0x04)) {
+        return 0;
+    }
+    // Check if the device is no longer busy, reading the status register also
+    // acknowledges the interrupt on the device side.
+    if (inportb(dev->io_reg.status) & ata_status_bsy) {
+        return 0;
+    }
+    // Stop the bus master.
+    outportb(dev->bmr.command, ata_bm_stop_bus_master);
+    // Clear the interrupt and error bits of the bus master status.
+    outportb(dev->bmr.status, status | 0x04 | 0x02);
+    // Store the status, and mark the request as completed.
+    dev->dma_status  = status;
+    dev->dma_pending = false;
+    // Wake up the tasks waiting for the request, once the IRQ is handled.
+    tasklet_schedule(&dev->wakeup);
+    return 1;
+}
+
+/// @brief Wakes up the tasks waiting for the DMA request just completed.
+/// @param data the device.
+static void ata_dma_wakeup(unsigned long data)
+{
+    ata_device_t *dev = (ata_device_t *)data;
+    wake_up(&dev->wait_queue);
+}
+
+/// @brief Waits for the completion of the DMA request in flight.
+/// @details When there is a running task, the task sleeps on the device wait
+/// queue, and the other tasks run until the IRQ handler completes the request
+/// and wakes it up. The device stays locked by its mutex meanwhile. During
+/// boot, when there is no task yet and interrupts are disabled, we poll the
+/// bus master status instead.
+/// @param dev the device we are waiting for.
+static inline void ata_dma_wait(ata_device_t *dev)
+{
+    if (scheduler_get_current_process() == NULL) {
+        while (!ata_dma_complete(dev)) {
+            pause();
+        }
         return;
     }
+    // Disable interrupts, so that the request cannot complete between the
+    // check and the moment we are inside the queue.
+    uint8_t flags = irq_disable();
+    while (dev->dma_pending) {
+        // Give the CPU to the other tasks, until we are woken up.
+        sleep_on(&dev->wait_queue);
+        schedule();
+    }
+    irq_enable(flags);
+}
 
-    // Acquire the lock for thread safety.
-    spinlock_lock(&dev->lock);
+/// @brief Returns the maximum number of sectors of a single DMA command.
+/// @param dev the device.
+/// @return the maximum number of sectors.
+static inline uint32_t ata_max_transfer_sectors(ata_device_t *dev)
+{
+    return dev->lba48 ? ATA_LBA48_MAX_SECTORS : ATA_LBA28_MAX_SECTORS;
+}
+
+/// @brief Transfers consecutive sectors between the device and a physically
+/// contiguous memory area, with a single DMA command.
+/// @details The caller must hold the device lock.
+/// The transfer uses 48-bit addressing only when the sector range or the
+/// number of sectors cannot be expressed with 28-bit addressing.
+/// @param dev the device on which we perform the transfer.
+/// @param lba_sector the first sector of the transfer.
+/// @param count the number of sectors (at most ata_max_transfer_sectors()).
+/// @param physical the physical address of the memory area.
+/// @param write if we are writing (1) or reading (0).
+/// @return 0 on success, -errno on failure.
+static int
+__ata_device_dma_transfer(ata_device_t *dev, uint64_t lba_sector, uint32_t count, uintptr_t physical, int write)
+{
+    // The bus master direction bit, set when reading from the device.
+    uint8_t direction = write ? 0x00 : 0x08;
+
+    // Check if we are trying to perform the transfer on a valid device type.
+    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
+        pr_crit("[%s] Unsupported device type for DMA transfer.\n", ata_get_device_settings_str(dev));
+        return -EPERM;
+    }
+
+    // Check the number of sectors.
+    if ((count == 0) || (count > ata_max_transfer_sectors(dev))) {
+        pr_crit("[%s] Invalid number of sectors for DMA transfer (%u).\n", ata_get_device_settings_str(dev), count);
+        return -EINVAL;
+    }
+
+    // Check if we need 48-bit addressing.
+    bool_t lba48 = ((lba_sector + count - 1) > ATA_LBA28_MAX_LBA) || (count > ATA_LBA28_MAX_SECTORS);
+    if (lba48 && !dev->lba48) {
+        pr_crit(
+            "[%s] The sector range %llu+%u requires 48-bit addressing.\n", ata_get_device_settings_str(dev), lba_sector,
+            count);
+        return -EINVAL;
+    }
 
     // Wait for the device to be ready (BSY flag should be clear).
     if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
         ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+        return -EIO;
+    }
+
+    // Describe the memory area we are going to use.
+    if (!ata_dma_setup_prdt(dev, physical, count * ATA_SECTOR_SIZE)) {
+        return -EINVAL;
     }
 
     // Reset the bus master register's command register.
@@ -1098,161 +1262,266 @@ static void ata_device_read_sector(ata_device_t *dev, uint32_t lba_sector, uint8
     // Enable error and IRQ status in the bus master register.
     outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
 
-    // Set the command to read data (0x08).
-    outportb(dev->bmr.command, 0x08);
-
-    // Wait for the device to be ready again (BSY should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
-    }
+    // Set the direction of the transfer.
+    outportb(dev->bmr.command, direction);
 
-    // Disable IRQs to prevent interrupts during setup.
-    outportb(dev->io_control, 0x00);
+    // Clear the nIEN bit, so that the device raises an IRQ upon completion.
+    outportb(dev->io_control, ata_control_zero);
 
-    // Select the drive (set head and device).
-    outportb(dev->io_reg.hddevsel, 0xe0 | (dev->slave << 4));
+    // Select the drive, with LBA28 the device register holds the highest bits.
+    if (lba48) {
+        outportb(dev->io_reg.hddevsel, 0x40 | (dev->slave << 4));
+    } else {
+        outportb(dev->io_reg.hddevsel, 0xe0 | (dev->slave << 4) | ((lba_sector & 0x0F000000) >> 24));
+    }
     ata_io_wait(dev); // Wait for the device to process the selection.
 
-    // Clear the features register.
-    outportb(dev->io_reg.feature, 0x00);
+    // Wait for the device to be ready again (BSY flag should be clear).
+    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
+        ata_print_status_error(dev);
+        return -EIO;
+    }
 
-    // Prepare the LBA sector address.
-    outportb(dev->io_reg.sector_count, 0);
-    outportb(dev->io_reg.lba_lo, (lba_sector & 0xff000000) >> 24);
-    outportb(dev->io_reg.lba_mid, (lba_sector & 0xff00000000) >> 32);
-    outportb(dev->io_reg.lba_hi, (lba_sector & 0xff0000000000) >> 40);
+    // With LBA48, the registers are FIFOs: write the high order bytes first.
+    if (lba48) {
+        outportb(dev->io_reg.feature, 0x00);                                     // No features for this operation.
+        outportb(dev->io_reg.sector_count, (count >> 8) & 0xFF);                 // Sector count high byte.
+        outportb(dev->io_reg.lba_lo, (uint8_t)((lba_sector >> 24) & 0xFF));  // LBA byte 3.
+        outportb(dev->io_reg.lba_mid, (uint8_t)((lba_sector >> 32) & 0xFF)); // LBA byte 4.
+        outportb(dev->io_reg.lba_hi, (uint8_t)((lba_sector >> 40) & 0xFF));  // LBA byte 5.
+    }
 
-    // Set the sector count to 1 and the remaining LBA address.
-    outportb(dev->io_reg.sector_count, 1);
-    outportb(dev->io_reg.lba_lo, (lba_sector & 0x000000ff) >> 0);
-    outportb(dev->io_reg.lba_mid, (lba_sector & 0x0000ff00) >> 8);
-    outportb(dev->io_reg.lba_hi, (lba_sector & 0x00ff0000) >> 16);
+    // Set the features, sector count, and LBA for the operation (a count of 0
+    // means the maximum number of sectors).
+    outportb(dev->io_reg.feature, 0x00);                                   // No features for this operation.
+    outportb(dev->io_reg.sector_count, count & 0xFF);                      // Number of sectors to transfer.
+    outportb(dev->io_reg.lba_lo, (uint8_t)((lba_sector >> 0) & 0xFF));  // LBA low byte.
+    outportb(dev->io_reg.lba_mid, (uint8_t)((lba_sector >> 8) & 0xFF)); // LBA mid byte.
+    outportb(dev->io_reg.lba_hi, (uint8_t)((lba_sector >> 16) & 0xFF)); // LBA high byte.
 
     // Wait for the device to be ready for data transfer (BSY should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy & ~ata_status_rdy, 100000)) {
+    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
         ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+        return -EIO;
     }
 
-    // Write the READ_DMA command (0xC8) to the command register.
-    outportb(dev->io_reg.command, ata_dma_command_read);
+    // Write the READ DMA (EXT) or WRITE DMA (EXT) command.
+    if (lba48) {
+        outportb(dev->io_reg.command, write ? ata_dma_command_write_ext : ata_dma_command_read_ext);
+    } else {
+        outportb(dev->io_reg.command, write ? ata_dma_command_write : ata_dma_command_read);
+    }
 
     // Wait for the device to process the command.
     ata_io_wait(dev);
 
-    // Set the bus master register to start the read operation.
-    outportb(dev->bmr.command, 0x08 | 0x01); // Start the DMA read operation.
+    // Mark the request as in flight, so that the IRQ handler completes it.
+    dev->dma_pending = true;
 
-    // Wait for the DMA transfer to complete.
-    while (1) {
-        int status  = inportb(dev->bmr.status);
-        int dstatus = inportb(dev->io_reg.status);
-        // Wait for the DMA transfer to complete.
-        if (!(status & 0x04)) {
-            continue;
-        }
-        // Check if the device is no longer busy.
-        if (!(dstatus & ata_status_bsy)) {
-            break;
-        }
-    }
+    // Start the DMA transfer.
+    outportb(dev->bmr.command, direction | ata_bm_start_bus_master);
 
-    // Copy data from the DMA buffer to the output buffer.
-    memcpy(buffer, dev->dma.start, ATA_DMA_SIZE);
+    // Wait for the DMA transfer to complete.
+    ata_dma_wait(dev);
 
-    // Inform the device that we are done with the data transfer.
-    outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
+    // Check if the bus master reported an error.
+    if (dev->dma_status & 0x02) {
+        ata_print_status_error(dev);
+        return -EIO;
+    }
+    return 0;
+}
 
-    // Release the lock after the operation.
-    spinlock_unlock(&dev->lock);
+/// @brief Checks if the device can transfer data directly to/from the buffer.
+/// @details The bus master needs physically contiguous, word-aligned memory,
+/// which is the case for buffers inside the low memory (e.g., page cache pages
+/// and slab buffers), since it is linearly mapped.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+/// @param physical where we store the physical address of the buffer.
+/// @return 1 if the buffer can be used directly, 0 otherwise.
+static inline int ata_dma_map_buffer(uint8_t *buffer, size_t size, uintptr_t *physical)
+{
+    uintptr_t vaddr = (uintptr_t)buffer;
+    // The bus master requires the memory regions to be word-aligned.
+    if (vaddr & 0x3) {
+        return 0;
+    }
+    // The buffer must reside entirely inside the low memory.
+    if ((vaddr < memory.low_mem.virt_start) || (vaddr + size < vaddr) || (vaddr + size > memory.low_mem.virt_end)) {
+        return 0;
+    }
+    page_t *page = get_page_from_virtual_address(vaddr);
+    if (!page) {
+        return 0;
+    }
+    *physical = get_physical_address_from_page(page) + (vaddr & (PAGE_SIZE - 1));
+    return *physical != 0;
 }
 
-/// @brief Writs an ATA sector.
-/// @param dev the device on which we perform the write.
-/// @param lba_sector the sector where we read.
+/// @brief Reads consecutive ATA sectors.
+/// @details If possible, the data is transferred straight into the buffer with
+/// a single DMA command, otherwise it goes through the DMA area of the device,
+/// ATA_DMA_MAX_SECTORS at a time.
+/// @param dev the device on which we perform the read.
+/// @param lba_sector the first sector we read.
+/// @param count the number of sectors to read (at most ata_max_transfer_sectors()).
 /// @param buffer the buffer where we store what we read.
-static void ata_device_write_sector(ata_device_t *dev, uint32_t lba_sector, uint8_t *buffer)
+/// @return 0 on success, -errno on failure.
+static int ata_device_read_sectors(ata_device_t *dev, uint64_t lba_sector, uint32_t count, uint8_t *buffer)
 {
-    // Check if we are trying to perform the read on a valid device type.
-    if ((dev->type != ata_dev_type_pata) && (dev->type != ata_dev_type_sata)) {
-        pr_crit("[%s] Unsupported device type for read operation.\n", ata_get_device_settings_str(dev));
-        return;
+    uintptr_t physical;
+    int ret = 0;
+    // Acquire the lock for thread safety.
+    mutex_lock(&dev->lock);
+    if (ata_dma_map_buffer(buffer, count * ATA_SECTOR_SIZE, &physical)) {
+        // Transfer the sectors straight into the buffer.
+        ret = __ata_device_dma_transfer(dev, lba_sector, count, physical, 0);
+    } else {
+        for (uint32_t done = 0, chunk; (ret == 0) && (done < count); done += chunk) {
+            chunk = min(count - done, ATA_DMA_MAX_SECTORS);
+            // Transfer the sectors inside the DMA area.
+            ret   = __ata_device_dma_transfer(dev, lba_sector + done, chunk, dev->dma.start_phys, 0);
+            if (ret == 0) {
+                // Copy data from the DMA buffer to the output buffer.
+                memcpy(buffer + done * ATA_SECTOR_SIZE, dev->dma.start, chunk * ATA_SECTOR_SIZE);
+            }
+        }
     }
+    // Release the lock after the operation.
+    mutex_unlock(&dev->lock);
+    return ret;
+}
 
+/// @brief Writes consecutive ATA sectors.
+/// @details If possible, the data is transferred straight from the buffer with
+/// a single DMA command, otherwise it goes through the DMA area of the device,
+/// ATA_DMA_MAX_SECTORS at a time.
+/// @param dev the device on which we perform the write.
+/// @param lba_sector the first sector we write.
+/// @param count the number of sectors to write (at most ata_max_transfer_sectors()).
+/// @param buffer the buffer we are writing.
+/// @return 0 on success, -errno on failure.
+static int ata_device_write_sectors(ata_device_t *dev, uint64_t lba_sector, uint32_t count, uint8_t *buffer)
+{
+    uintptr_t physical;
+    int ret = 0;
     // Acquire the lock for thread safety.
-    spinlock_lock(&dev->lock);
-
-    // Copy the buffer over to the DMA area.
-    memcpy(dev->dma.start, buffer, ATA_DMA_SIZE);
-
-    // Reset the bus master register's command register.
-    outportb(dev->bmr.command, 0);
-
-    // Set the Physical Region Descriptor Table (PRDT).
-    outportl(dev->bmr.prdt, dev->dma.prdt_phys);
-
-    // Enable error and IRQ status in the bus master register.
-    outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
-
-    // Wait for the device to be ready (BSY flag should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+    mutex_lock(&dev->lock);
+    if (ata_dma_map_buffer(buffer, count * ATA_SECTOR_SIZE, &physical)) {
+        // Transfer the sectors straight from the buffer.
+        ret = __ata_device_dma_transfer(dev, lba_sector, count, physical, 1);
+    } else {
+        for (uint32_t done = 0, chunk; (ret == 0) && (done < count); done += chunk) {
+            chunk = min(count - done, ATA_DMA_MAX_SECTORS);
+            // Copy the buffer over to the DMA area.
+            memcpy(dev->dma.start, buffer + done * ATA_SECTOR_SIZE, chunk * ATA_SECTOR_SIZE);
+            // Transfer the sectors from the DMA area.
+            ret = __ata_device_dma_transfer(dev, lba_sector + done, chunk, dev->dma.start_phys, 1);
+        }
     }
+    // Release the lock after the operation is complete.
+    mutex_unlock(&dev->lock);
+    return ret;
+}
 
-    // Select the drive (set head and device).
-    outportb(dev->io_reg.hddevsel, 0xe0 | (dev->slave << 4) | ((lba_sector & 0x0F000000) >> 24));
-
-    // Wait for the device to be ready again (BSY flag should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+/// @brief Reads part of an ATA sector, using the DMA area of the device as
+/// bounce buffer.
+/// @param dev the device on which we perform the read.
+/// @param lba_sector the sector we read.
+/// @param offset the offset inside the sector.
+/// @param size the amount of data we read.
+/// @param buffer the buffer where we store what we read.
+/// @return 0 on success, -errno on failure.
+static int ata_device_read_partial(ata_device_t *dev, uint64_t lba_sector, uint32_t offset, uint32_t size, void *buffer)
+{
+    // Acquire the lock, the DMA area belongs to the device.
+    mutex_lock(&dev->lock);
+    // Transfer the sector inside the DMA area.
+    int ret = __ata_device_dma_transfer(dev, lba_sector, 1, dev->dma.start_phys, 0);
+    if (ret == 0) {
+        // Copy the requested part to the output buffer.
+        memcpy(buffer, dev->dma.start + offset, size);
     }
+    // Release the lock after the operation.
+    mutex_unlock(&dev->lock);
+    return ret;
+}
 
-    // Set the features, sector count, and LBA for the write operation.
-    outportb(dev->io_reg.feature, 0x00);                           // No features for this write operation.
-    outportb(dev->io_reg.sector_count, 1);                         // Write one sector.
-    outportb(dev->io_reg.lba_lo, (lba_sector & 0x000000FF) >> 0);  // LBA low byte.
-    outportb(dev->io_reg.lba_mid, (lba_sector & 0x0000FF00) >> 8); // LBA mid byte.
-    outportb(dev->io_reg.lba_hi, (lba_sector & 0x00FF0000) >> 16); // LBA high byte.
-
-    // Wait for the device to be ready for data transfer (BSY should be clear).
-    if (ata_status_wait_not(dev, ata_status_bsy, 100000)) {
-        ata_print_status_error(dev);
-        spinlock_unlock(&dev->lock);
-        return;
+/// @brief Writes part of an ATA sector, using the DMA area of the device as
+/// bounce buffer.
+/// @details The read-modify-write cycle is performed while holding the device
+/// lock, so that concurrent partial writes on the same sector do not race.
+/// @param dev the device on which we perform the write.
+/// @param lba_sector the sector we write.
+/// @param offset the offset inside the sector.
+/// @param size the amount of data we write.
+/// @param buffer the buffer we are writing.
+/// @return 0 on success, -errno on failure.
+static int
+ata_device_write_partial(ata_device_t *dev, uint64_t lba_sector, uint32_t offset, uint32_t size, const void *buffer)
+{
+    // Acquire the lock, the DMA area belongs to the device.
+    mutex_lock(&dev->lock);
+    // Transfer the sector inside the DMA area.
+    int ret = __ata_device_dma_transfer(dev, lba_sector, 1, dev->dma.start_phys, 0);
+    if (ret == 0) {
+        // Update the requested part.
+        memcpy(dev->dma.start + offset, buffer, size);
+        // Write the sector back.
+        ret = __ata_device_dma_transfer(dev, lba_sector, 1, dev->dma.start_phys, 1);
     }
+    // Release the lock after the operation.
+    mutex_unlock(&dev->lock);
+    return ret;
+}
 
-    // Notify that we are starting the DMA writing operation.
-    outportb(dev->io_reg.command, ata_dma_command_write);
-
-    // Start the DMA writing process.
-    outportb(dev->bmr.command, 0x01); // Start the DMA transfer.
-
-    // Wait for the DMA write to complete.
-    while (1) {
-        int status  = inportb(dev->bmr.status);
-        int dstatus = inportb(dev->io_reg.status);
-        // Wait for DMA transfer to complete.
-        if (!(status & 0x04)) {
-            continue;
+/// @brief Serves a request coming from the block I/O layer.
+/// @details The bios of the request are adjacent, so we serve all of them
+/// with a single DMA command, gathering (or scattering) their buffers from (or
+/// into) the DMA area.
+/// @param device the ATA device.
+/// @param request the request.
+/// @return 0 on success, -errno on failure.
+static int ata_request_fn(void *device, blk_request_t *request)
+{
+    ata_device_t *dev = (ata_device_t *)device;
+    uintptr_t physical;
+    int ret;
+    // Acquire the lock for thread safety.
+    mutex_lock(&dev->lock);
+    // A request made of a single bio might not need the DMA area at all.
+    if (request->bios.next == request->bios.prev) {
+        bio_t *bio = list_entry(request->bios.next, bio_t, list);
+        if (ata_dma_map_buffer(bio->buffer, request->count * ATA_SECTOR_SIZE, &physical)) {
+            ret = __ata_device_dma_transfer(dev, request->sector, request->count, physical, request->write);
+            mutex_unlock(&dev->lock);
+            return ret;
         }
-        // Exit when device is no longer busy.
-        if (!(dstatus & ata_status_bsy)) {
-            break;
+    }
+    if (request->write) {
+        // Gather the bios inside the DMA area.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                dev->dma.start + (bio->sector - request->sector) * ATA_SECTOR_SIZE, bio->buffer,
+                bio->count * ATA_SECTOR_SIZE);
         }
     }
-
-    // Inform the device that we are done with the write operation.
-    outportb(dev->bmr.status, inportb(dev->bmr.status) | 0x04 | 0x02);
-
-    // Release the lock after the operation is complete.
-    spinlock_unlock(&dev->lock);
+    // Perform the transfer.
+    ret = __ata_device_dma_transfer(dev, request->sector, request->count, dev->dma.start_phys, request->write);
+    if ((ret == 0) && !request->write) {
+        // Scatter the DMA area to the bios.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                bio->buffer, dev->dma.start + (bio->sector - request->sector) * ATA_SECTOR_SIZE,
+                bio->count * ATA_SECTOR_SIZE);
+        }
+    }
+    // Release the lock after the operation.
+    mutex_unlock(&dev->lock);
+    return ret;
 }
 
 // == VFS CALLBACKS ===========================================================
@@ -1340,14 +1609,11 @@ static int ata_close(vfs_file_t *file)
 /// @param buffer the buffer where we store what we read.
 /// @param offset the offset where we want to read.
 /// @param size the size of the buffer.
-/// @return the number of read characters.
+/// @return the number of read characters, -errno if the transfer failed at once.
 static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t size)
 {
     // pr_debug("ata_read(file: 0x%p, buffer: 0x%p, offest: %8d, size: %8d)\n", file, buffer, offset, size);
 
-    // Prepare a static support buffer.
-    static char support_buffer[ATA_SECTOR_SIZE];
-
     // Get the device from the VFS file.
     ata_device_t *dev = (ata_device_t *)file->device;
 
@@ -1363,11 +1629,11 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t siz
         return -EPERM; // Return error for unsupported device types.
     }
 
-    uint32_t max_offset = ata_max_offset(dev);
+    uint64_t max_offset = ata_max_offset(dev);
 
     // Check if the offset exceeds the disk size.
     if (offset > max_offset) {
-        pr_warning("The offset is exceeding the disk size (%d > %d)\n", offset, max_offset);
+        pr_warning("The offset is exceeding the disk size (%d > %llu)\n", offset, max_offset);
         ata_dump_device(dev);
         // Get the error and status information of the device.
         uint8_t error  = inportb(dev->io_reg.error);
@@ -1382,36 +1648,66 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t siz
         size = max_offset - offset;
     }
 
+    // Check if there is nothing to read.
+    if (size == 0) {
+        return 0;
+    }
+
     uint32_t start_block  = offset / ATA_SECTOR_SIZE;
     uint32_t start_offset = offset % ATA_SECTOR_SIZE;
     uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
+    uint32_t prefix_size  = min(ATA_SECTOR_SIZE - start_offset, size);
     uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
     uint32_t x_offset     = 0;
+    uint32_t sectors      = end_block + 1 - start_block;
+
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&dev->queue);
+
+    // The parts are read in order, so that a failure leaves the bytes read so
+    // far at the start of the buffer.
+    int ret = 0;
 
+    // Read the prefix if needed.
     if (start_offset) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-        // Copy the prefix from the support buffer to the output buffer.
-        memcpy(buffer, (void *)((uintptr_t)support_buffer + start_offset), prefix_size);
-        x_offset += prefix_size;
+        ret = ata_device_read_partial(dev, start_block, start_offset, prefix_size, buffer);
+        if (ret == 0) {
+            x_offset += prefix_size;
+        }
         ++start_block;
     }
 
-    // Read postfix if needed.
-    if (postfix_size && (start_block <= end_block)) {
-        ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-        // Copy the postfix from the support buffer to the output buffer.
-        memcpy((void *)((uintptr_t)buffer + size - postfix_size), support_buffer, postfix_size);
+    // The postfix is read last.
+    bool_t postfix = postfix_size && (start_block <= end_block);
+    if (postfix) {
         --end_block;
     }
 
-    // Read full sectors in between.
-    for (; start_block <= end_block; ++start_block) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
-        x_offset += ATA_SECTOR_SIZE;
+    // Read full sectors in between, as many as possible per DMA command.
+    for (uint32_t remaining = end_block + 1 - start_block; (ret == 0) && (remaining > 0);) {
+        uint32_t count = min(remaining, ata_max_transfer_sectors(dev));
+        ret            = ata_device_read_sectors(dev, start_block, count, (uint8_t *)((uintptr_t)buffer + x_offset));
+        if (ret == 0) {
+            x_offset += count * ATA_SECTOR_SIZE;
+        }
+        start_block += count;
+        remaining -= count;
     }
 
+    // Read postfix if needed.
+    if ((ret == 0) && postfix) {
+        ret = ata_device_read_partial(dev, end_block + 1, 0, postfix_size, buffer + size - postfix_size);
+        if (ret == 0) {
+            x_offset += postfix_size;
+        }
+    }
+
+    blk_stats_done(&dev->queue, 0, sectors, start_time);
+
+    if (ret < 0) {
+        pr_err("Failed to read from the device, after %u bytes: %d\n", x_offset, ret);
+        return x_offset ? (ssize_t)x_offset : ret;
+    }
     // Return the number of bytes read.
     return size;
 }
@@ -1421,14 +1717,11 @@ static ssize_t ata_read(vfs_file_t *file, char *buffer, off_t offset, size_t siz
 /// @param buffer the buffer we use to write.
 /// @param offset the offset where we want to write.
 /// @param size the size of the buffer.
-/// @return the number of written characters.
+/// @return the number of written characters, -errno if the transfer failed at once.
 static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset, size_t size)
 {
     pr_debug("ata_write(%p, %p, %d, %d)\n", file, buffer, offset, size);
 
-    // Prepare a static support buffer.
-    static char support_buffer[ATA_SECTOR_SIZE];
-
     // Get the device from the VFS file.
     ata_device_t *dev = (ata_device_t *)file->device;
 
@@ -1444,48 +1737,79 @@ static ssize_t ata_write(vfs_file_t *file, const void *buffer, off_t offset, siz
         return -EPERM; // Return error for unsupported device types.
     }
 
-    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
-    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
-    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
-    uint32_t end_offset   = (offset + size - 1) % ATA_SECTOR_SIZE;
-    uint32_t prefix_size  = (ATA_SECTOR_SIZE - start_offset);
-    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
-    uint32_t max_offset   = ata_max_offset(dev);
-    uint32_t x_offset     = 0;
+    uint64_t max_offset = ata_max_offset(dev);
 
     // Check if with the offset we are exceeding the size.
     if (offset > max_offset) {
         return 0;
     }
 
-    // Check if we are going to readoing over the size.
+    // Check if we are going to write over the size.
     if (offset + size > max_offset) {
         size = max_offset - offset;
     }
 
+    // Check if there is nothing to write.
+    if (size == 0) {
+        return 0;
+    }
+
+    uint32_t start_block  = offset / ATA_SECTOR_SIZE;
+    uint32_t start_offset = offset % ATA_SECTOR_SIZE;
+    uint32_t end_block    = (offset + size - 1) / ATA_SECTOR_SIZE;
+    uint32_t prefix_size  = min(ATA_SECTOR_SIZE - start_offset, size);
+    uint32_t postfix_size = (offset + size) % ATA_SECTOR_SIZE;
+    uint32_t x_offset     = 0;
+    uint32_t sectors      = end_block + 1 - start_block;
+
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&dev->queue);
+
+    // The parts are written in order, so that a failure leaves the bytes
+    // written so far at the start of the buffer.
+    int ret = 0;
+
     // Handle the prefix if needed.
     if (start_offset) {
-        ata_device_read_sector(dev, start_block, (uint8_t *)support_buffer);
-        memcpy((void *)((uintptr_t)support_buffer + (start_offset)), buffer, prefix_size);
-        ata_device_write_sector(dev, start_block, (uint8_t *)support_buffer);
-        x_offset += prefix_size;
+        ret = ata_device_write_partial(dev, start_block, start_offset, prefix_size, buffer);
+        if (ret == 0) {
+            x_offset += prefix_size;
+        }
         ++start_block;
     }
 
-    // Handle the postfix if needed.
-    if (postfix_size && (start_block <= end_block)) {
-        ata_device_read_sector(dev, end_block, (uint8_t *)support_buffer);
-        memcpy(support_buffer, (void *)((uintptr_t)buffer + size - postfix_size), postfix_size);
-        ata_device_write_sector(dev, end_block, (uint8_t *)support_buffer);
+    // The postfix is written last.
+    bool_t postfix = postfix_size && (start_block <= end_block);
+    if (postfix) {
         --end_block;
     }
 
-    // Write full sectors in between.
-    for (; start_block <= end_block; ++start_block) {
-        ata_device_write_sector(dev, start_block, (uint8_t *)((uintptr_t)buffer + x_offset));
-        x_offset += ATA_SECTOR_SIZE;
+    // Write full sectors in between, as many as possible per DMA command.
+    for (uint32_t remaining = end_block + 1 - start_block; (ret == 0) && (remaining > 0);) {
+        uint32_t count = min(remaining, ata_max_transfer_sectors(dev));
+        ret            = ata_device_write_sectors(dev, start_block, count, (uint8_t *)((uintptr_t)buffer + x_offset));
+        if (ret == 0) {
+            x_offset += count * ATA_SECTOR_SIZE;
+        }
+        start_block += count;
+        remaining -= count;
+    }
+
+    // Handle the postfix if needed.
+    if ((ret == 0) && postfix) {
+        ret = ata_device_write_partial(
+            dev, end_block + 1, 0, postfix_size, (const void *)((uintptr_t)buffer + size - postfix_size));
+        if (ret == 0) {
+            x_offset += postfix_size;
+        }
     }
 
+    blk_stats_done(&dev->queue, 1, sectors, start_time);
+
+    if (ret < 0) {
+        pr_err("Failed to write on the device, after %u bytes: %d\n", x_offset, ret);
+        return x_offset ? (ssize_t)x_offset : ret;
+    }
     return size;
 }
 
@@ -1535,8 +1859,9 @@ static int ata_stat(const char *path, stat_t *stat)
 /// ATA mount function.
 /// @param path the path where the filesystem should be mounted.
 /// @param device the device we mount.
+/// @param options the mount options, unused.
 /// @return the VFS file of the filesystem.
-static vfs_file_t *ata_mount_callback(const char *path, const char *device)
+static vfs_file_t *ata_mount_callback(const char *path, const char *device, const char *options)
 {
     pr_err("mount_callback(%s, %s): ATA has no mount callback!\n", path, device);
     return NULL;
@@ -1611,8 +1936,10 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev)
         pr_debug("[%s] Found %s device...\n", ata_get_device_settings_str(dev), ata_get_device_type_str(type));
         // Device type supported, set it.
         dev->type = type;
-        // Initialize the spinlock.
-        spinlock_init(&dev->lock);
+        // Initialize the mutex.
+        mutex_init(&dev->lock);
+        // Initialize the queue of tasks waiting for DMA completion.
+        wait_queue_head_init(&dev->wait_queue);
         // Set the device name.
         sprintf(dev->name, "hd%c", ata_drive_char);
         // Set the device path.
@@ -1630,7 +1957,7 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev)
             return ata_dev_type_unknown;
         }
         // Update the filesystem entry with the length of the device.
-        dev->fs_root->length = ata_max_offset(dev);
+        dev->fs_root->length = min(ata_max_offset(dev), UINT32_MAX);
         // Try to mount the drive.
         if (!vfs_register_superblock(dev->fs_root->name, dev->path, &ata_file_system_type, dev->fs_root)) {
             pr_alert("Failed to mount ata device!\n");
@@ -1638,6 +1965,11 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev)
             vfs_dealloc_file(dev->fs_root);
             return ata_dev_type_unknown;
         }
+        // Initialize the request queue of the drive, filesystems on top of it
+        // will fall back to plain reads if this fails.
+        if (blk_queue_init(&dev->queue, dev->fs_root, dev, ata_request_fn, ATA_DMA_MAX_SECTORS) < 0) {
+            pr_warning("[%s] Failed to initialize the request queue.\n", ata_get_device_settings_str(dev));
+        }
         // Increment the drive letter.
         ++ata_drive_char;
 
@@ -1654,68 +1986,59 @@ static ata_device_type_t ata_device_detect(ata_device_t *dev)
 }
 
 // == IRQ HANDLERS ============================================================
+/// @brief Handles the IRQ of the primary channel.
 /// @param f The interrupt stack frame.
 static void ata_irq_handler_master(pt_regs_t *f)
 {
-    pr_warning("ata_irq_handler_master\n");
-    inportb(ata_primary_master.io_reg.status);
-    inportb(ata_primary_master.bmr.status);
-    //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
-    pic8259_send_eoi(IRQ_FIRST_HD);
+    if (!ata_dma_complete(&ata_primary_master)) {
+        ata_dma_complete(&ata_primary_slave);
+    }
 }
 
+/// @brief Handles the IRQ of the secondary channel.
 /// @param f The interrupt stack frame.
 static void ata_irq_handler_slave(pt_regs_t *f)
 {
-    pr_warning("ata_irq_handler_slave\n");
-    inportb(ata_secondary_master.io_reg.status);
-    inportb(ata_primary_master.bmr.status);
-    //outportb(ata_primary_master.bmr.command, ata_bm_stop_bus_master);
-    pic8259_send_eoi(IRQ_SECOND_HD);
+    if (!ata_dma_complete(&ata_secondary_master)) {
+        ata_dma_complete(&ata_secondary_slave);
+    }
 }
 
 // == PCI FUNCTIONS ===========================================================
 
-/// @brief Callback function used while scanning the PCI interface to find ATA devices.
-/// @param device The PCI device identifier.
-/// @param vendor_id The vendor ID of the device.
-/// @param device_id The device ID of the device.
-/// @param extra Pointer to store the device identifier once found.
-/// @return 1 if a matching device is found, 0 if not, -1 on error.
-static int pci_find_ata(uint32_t device, uint16_t vendor_id, uint16_t device_id, void *extra)
-{
-    // Check if the output pointer 'extra' is valid.
-    if (extra == NULL) {
-        pr_err("Output parameter 'extra' is NULL.\n");
-        return 1;
-    }
-    // Intel Corporation AND (IDE Interface OR PIIX4 IDE).
-    if ((vendor_id == 0x8086) && (device_id == 0x7010 || device_id == 0x7111)) {
-        // Store the device identifier in the location pointed to by 'extra'.
-        *((uint32_t *)extra) = device;
-        // Call pci_dump_device_data to display device information
-        pci_dump_device_data(device, vendor_id, device_id);
-        return 0; // Matching device found.
-    }
-    return 1; // No matching device found.
-}
+/// The IDE controllers we drive: Intel Corporation AND (IDE Interface OR PIIX4 IDE).
+static const pci_device_id_t ata_pci_ids[] = {
+    {0x8086, 0x7010, PCI_ANY_ID},
+    {0x8086, 0x7111, PCI_ANY_ID},
+    {0, 0, 0},
+};
 
 // == INITIALIZE/FINALIZE ATA =================================================
 
 int ata_initialize(void)
 {
     // Search for ATA devices.
-    if (pci_scan(pci_find_ata, -1, &ata_pci) != 0) {
-        pr_err("Failed to scan for ATA devices.\n");
-        return 1;
+    const pci_dev_t *pci = pci_find_device(ata_pci_ids, NULL);
+    if (pci) {
+        ata_pci = pci->device;
+        pci_dump_device_data(pci->device, pci->vendor_id, pci->device_id);
     }
 
     // Register the filesystem.
     vfs_register_filesystem(&ata_file_system_type);
 
+    // Prepare the wake-ups done after the IRQ handlers.
+    tasklet_init(&ata_primary_master.wakeup, ata_dma_wakeup, (unsigned long)&ata_primary_master);
+    tasklet_init(&ata_primary_slave.wakeup, ata_dma_wakeup, (unsigned long)&ata_primary_slave);
+    tasklet_init(&ata_secondary_master.wakeup, ata_dma_wakeup, (unsigned long)&ata_secondary_master);
+    tasklet_init(&ata_secondary_slave.wakeup, ata_dma_wakeup, (unsigned long)&ata_secondary_slave);
+
     // Install the IRQ handlers.
     irq_install_handler(IRQ_FIRST_HD, ata_irq_handler_master, "IDE Master");
     irq_install_handler(IRQ_SECOND_HD, ata_irq_handler_slave, "IDE Slave");
+    // Enable the IRQs of both channels.
+    irq_unmask(IRQ_FIRST_HD);
+    irq_unmask(IRQ_SECOND_HD);
 
     // Enable bus mastering.
     ata_dma_enable_bus_mastering();
@@ -16,6 +16,7 @@
 #include "drivers/keyboard/keyboard.h"
 #include "drivers/keyboard/keymap.h"
 #include "drivers/ps2.h"
+#include "fs/poll.h"
 #include "hardware/pic8259.h"
 #include "io/port_io.h"
 #include "io/video.h"
@@ -23,15 +24,25 @@
 #include "ring_buffer.h"
 #include "string.h"
 #include "sys/bitops.h"
+#include "system/softirq.h"
 
 /// Tracks the state of the leds.
 static uint8_t ledstate = 0;
 /// The flags concerning the keyboard.
 static uint32_t kflags  = 0;
+/// The buffer of the characters, filled by the bottom half and emptied by the readers.
+DECLARE_SPSC_RING_BUFFER(int, keycode, 256, -1)
 /// Where we store the keypress.
-rb_keybuffer_t scancodes;
-/// Spinlock to protect access to the scancode buffer.
-spinlock_t scancodes_lock;
+static rb_keycode_t scancodes;
+/// The tasks reading, or polling, the keyboard.
+static wait_queue_head_t keyboard_wait;
+
+/// The buffer of the scancodes read by the interrupt handler, not translated yet.
+DECLARE_SPSC_RING_BUFFER(unsigned int, rawcode, 64, 0)
+/// The scancodes not translated yet.
+static rb_rawcode_t rawcodes;
+/// Translates the scancodes, outside of the interrupt handler.
+static tasklet_t keyboard_tasklet;
 
 #define KBD_LEFT_SHIFT    (1 << 0) ///< Flag which identifies the left shift.
 #define KBD_RIGHT_SHIFT   (1 << 1) ///< Flag which identifies the right shift.
@@ -79,107 +90,44 @@ spinlock_t scancodes_lock;
 #define SEQ_END  "\033[F" ///< Escape sequence for the End key.
 #endif
 
-/// @brief Pushes a character into the scancode ring buffer.
-/// @param c The character to push into the ring buffer.
-static inline void keyboard_push_back(unsigned int c)
-{
-    // Lock the scancode buffer to ensure thread safety during push operation.
-    spinlock_lock(&scancodes_lock);
-
-    // Push the character into the front of the scancode buffer.
-    rb_keybuffer_push_back(&scancodes, (int)c);
-
-    // Unlock the buffer after the push operation is complete.
-    spinlock_unlock(&scancodes_lock);
-}
-
-/// @brief Pushes a character into the scancode ring buffer.
+/// @brief Pushes a character into the scancode ring buffer. Only the bottom
+/// half pushes, so the buffer needs no lock; the character is dropped when the
+/// buffer is full.
 /// @param c The character to push into the ring buffer.
 static inline void keyboard_push_front(unsigned int c)
 {
-    // Lock the scancode buffer to ensure thread safety during push operation.
-    spinlock_lock(&scancodes_lock);
-
-    // Push the character into the front of the scancode buffer.
-    rb_keybuffer_push_front(&scancodes, (int)c);
-
-    // Unlock the buffer after the push operation is complete.
-    spinlock_unlock(&scancodes_lock);
-}
-
-/// @brief Pushes a sequence of characters (scancodes) into the keyboard buffer.
-/// @param sequence A null-terminated string representing the sequence to push.
-static inline void keyboard_push_back_sequence(char *sequence)
-{
-    // Lock the scancodes ring buffer to ensure thread safety.
-    spinlock_lock(&scancodes_lock);
-
-    // Iterate through each character in the sequence and push it to the buffer.
-    for (size_t i = 0; i < strlen(sequence); ++i) {
-        rb_keybuffer_push_back(&scancodes, (int)sequence[i]);
-    }
+    rb_keycode_push(&scancodes, (int)c);
 
-    // Unlock the buffer after the operation is complete.
-    spinlock_unlock(&scancodes_lock);
+    // Wake up the tasks reading, or polling, the keyboard.
+    wake_up(&keyboard_wait);
 }
 
 /// @brief Pushes a sequence of characters (scancodes) into the keyboard buffer.
 /// @param sequence A null-terminated string representing the sequence to push.
 static inline void keyboard_push_front_sequence(char *sequence)
 {
-    // Lock the scancodes ring buffer to ensure thread safety.
-    spinlock_lock(&scancodes_lock);
-
     // Iterate through each character in the sequence and push it to the buffer.
     for (size_t i = 0; i < strlen(sequence); ++i) {
-        rb_keybuffer_push_front(&scancodes, (int)sequence[i]);
+        rb_keycode_push(&scancodes, (int)sequence[i]);
     }
 
-    // Unlock the buffer after the operation is complete.
-    spinlock_unlock(&scancodes_lock);
+    // Wake up the tasks reading, or polling, the keyboard.
+    wake_up(&keyboard_wait);
 }
 
-/// @brief Pops a value from the ring buffer.
+/// @brief Pops a value from the ring buffer. Only the readers pop, one at a
+/// time, so the buffer needs no lock.
 /// @return the value we removed from the ring buffer.
-int keyboard_pop_back(void)
-{
-    spinlock_lock(&scancodes_lock);
-    int c = rb_keybuffer_pop_back(&scancodes);
-    spinlock_unlock(&scancodes_lock);
-    return c;
-}
+int keyboard_pop_back(void) { return rb_keycode_pop(&scancodes); }
 
-int keyboard_peek_back(void)
-{
-    spinlock_lock(&scancodes_lock);
-    int c = rb_keybuffer_peek_back(&scancodes);
-    spinlock_unlock(&scancodes_lock);
-    return c;
-}
+int keyboard_peek_back(void) { return rb_keycode_peek(&scancodes); }
 
-int keyboard_peek_front(void)
-{
-    spinlock_lock(&scancodes_lock);
-    int c = rb_keybuffer_peek_front(&scancodes);
-    spinlock_unlock(&scancodes_lock);
-    return c;
-}
+wait_queue_head_t *keyboard_get_wait_queue(void) { return &keyboard_wait; }
 
-void keyboard_isr(pt_regs_t *f)
+/// @brief Translates a scancode into the characters read by the tasks.
+/// @param scancode the scancode.
+static void __keyboard_translate(unsigned int scancode)
 {
-    unsigned int scancode;
-    (void)f;
-
-    if (!(inportb(0x64U) & 1U)) {
-        return;
-    }
-
-    // Take scancode from the port.
-    scancode = ps2_read_data();
-    if (scancode == 0xE0) {
-        scancode = (scancode << 8U) | ps2_read_data();
-    }
-
     // Get the keypad number, of num-lock is disabled.
     int keypad_code = !bitmask_check(kflags, KBD_NUM_LOCK) ? scancode : 0;
 
@@ -386,7 +334,36 @@ void keyboard_isr(pt_regs_t *f)
             keyboard_push_front(keymap->normal);
         }
     }
-    pic8259_send_eoi(IRQ_KEYBOARD);
+}
+
+/// @brief The bottom half of the keyboard, it translates the scancodes read
+/// by the interrupt handler.
+/// @param data unused.
+static void __keyboard_tasklet(unsigned long data)
+{
+    // The interrupt handler keeps filling the buffer meanwhile, without locks.
+    while (!rb_rawcode_is_empty(&rawcodes)) {
+        __keyboard_translate(rb_rawcode_pop(&rawcodes));
+    }
+}
+
+void keyboard_isr(pt_regs_t *f)
+{
+    unsigned int scancode;
+    (void)f;
+
+    if (!(inportb(0x64U) & 1U)) {
+        return;
+    }
+
+    // Take scancode from the port.
+    scancode = ps2_read_data();
+    if (scancode == 0xE0) {
+        scancode = (scancode << 8U) | ps2_read_data();
+    }
+    // The translation runs later, with the interrupts enabled.
+    rb_rawcode_push(&rawcodes, scancode);
+    tasklet_schedule(&keyboard_tasklet);
 }
 
 void keyboard_update_leds(void)
@@ -408,15 +385,17 @@ void keyboard_disable(void) { outportb(0x60, 0xF5); }
 int keyboard_initialize(void)
 {
     // Initialize the ring-buffer for the scancodes.
-    rb_keybuffer_init(&scancodes);
-    // Initialize the spinlock.
-    spinlock_init(&scancodes_lock);
+    rb_keycode_init(&scancodes);
+    rb_rawcode_init(&rawcodes);
+    tasklet_init(&keyboard_tasklet, __keyboard_tasklet, 0);
+    // Initialize the queue of the tasks reading, or polling, the keyboard.
+    wait_queue_head_init(&keyboard_wait);
     // Initialize the keymaps.
     init_keymaps();
     // Install the IRQ.
     irq_install_handler(IRQ_KEYBOARD, keyboard_isr, "keyboard");
     // Enable the IRQ.
-    pic8259_irq_enable(IRQ_KEYBOARD);
+    irq_unmask(IRQ_KEYBOARD);
     return 0;
 }
 
@@ -425,7 +404,7 @@ int keyboard_finalize(void)
     // Install the IRQ.
     irq_uninstall_handler(IRQ_KEYBOARD, keyboard_isr);
     // Enable the IRQ.
-    pic8259_irq_disable(IRQ_KEYBOARD);
+    irq_mask(IRQ_KEYBOARD);
     return 0;
 }
 
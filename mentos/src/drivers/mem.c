@@ -91,7 +91,7 @@ static vfs_sys_operations_t mem_sys_operations = {
     .stat_f  = mem_stat,
 };
 
-static vfs_file_t *null_mount_callback(const char *path, const char *device);
+static vfs_file_t *null_mount_callback(const char *path, const char *device, const char *options);
 static vfs_file_t *null_open(const char *path, int flags, mode_t mode);
 static int null_close(vfs_file_t *file);
 static ssize_t null_write(vfs_file_t *file, const void *buffer, off_t offset, size_t size);
@@ -152,8 +152,9 @@ static int mem_stat(const char *path, stat_t *stat)
 ///
 /// @param path The path where the filesystem should be mounted.
 /// @param device The device to be mounted (unused in this case as NULL has no mount functionality).
+/// @param options The mount options, unused.
 /// @return Always returns NULL as mounting is not supported for NULL devices.
-static vfs_file_t *null_mount_callback(const char *path, const char *device)
+static vfs_file_t *null_mount_callback(const char *path, const char *device, const char *options)
 {
     // Log an error indicating that NULL devices do not support mounting.
     pr_err("null_mount_callback(%s, %s): NULL device does not support mounting!\n", path, device);
@@ -147,14 +147,13 @@ static void __mouse_isr(pt_regs_t *f)
             // pr_default(LNG_MOUSE_LEFT);
         }
     }
-    pic8259_send_eoi(IRQ_MOUSE);
 }
 
 /// @brief Enable the mouse driver.
 static void __mouse_enable(void)
 {
     // Enable the mouse interrupts.
-    pic8259_irq_enable(IRQ_MOUSE);
+    irq_unmask(IRQ_MOUSE);
     // Disable the mouse.
     __mouse_write(MOUSE_ENABLE_PACKET);
     // Acknowledge.
@@ -165,7 +164,7 @@ static void __mouse_enable(void)
 static void __mouse_disable(void)
 {
     // Disable the mouse interrupts.
-    pic8259_irq_disable(IRQ_MOUSE);
+    irq_mask(IRQ_MOUSE);
     // Disable the mouse.
     __mouse_write(MOUSE_DISABLE_PACKET);
     // Acknowledge.
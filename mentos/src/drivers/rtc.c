@@ -164,7 +164,7 @@ int rtc_initialize(void)
     // Install the IRQ.
     irq_install_handler(IRQ_REAL_TIME_CLOCK, rtc_handler_isr, "Real Time Clock (RTC)");
     // Enable the IRQ.
-    pic8259_irq_enable(IRQ_REAL_TIME_CLOCK);
+    irq_unmask(IRQ_REAL_TIME_CLOCK);
     // Wait until rtc is ready.
     rtc_update_datetime();
     return 0;
@@ -175,7 +175,7 @@ int rtc_finalize(void)
     // Uninstall the IRQ.
     irq_uninstall_handler(IRQ_REAL_TIME_CLOCK, rtc_handler_isr);
     // Disable the IRQ.
-    pic8259_irq_disable(IRQ_REAL_TIME_CLOCK);
+    irq_mask(IRQ_REAL_TIME_CLOCK);
     return 0;
 }
 
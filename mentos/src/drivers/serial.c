@@ -0,0 +1,373 @@
+/// @file serial.c
+/// @brief Driver of the 16550 UART of the first serial port.
+/// @details
+/// The bytes written are queued inside a ring, and the UART raises an
+/// interrupt whenever its transmit FIFO empties, which is refilled from the
+/// ring, up to the size of the FIFO at a time. The bytes received are moved,
+/// by the interrupts, to another ring, which `/dev/ttyS0` is read from.
+/// Nothing should be logged from here, since the kernel log is drained
+/// through this driver.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SERIAL]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "drivers/serial.h"
+
+#include "bits/ioctls.h"
+#include "bits/termios-struct.h"
+#include "descriptor_tables/isr.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/poll.h"
+#include "fs/vfs.h"
+#include "hardware/pic8259.h"
+#include "io/port_io.h"
+#include "klib/irqflags.h"
+#include "klib/stdatomic.h"
+#include "process/scheduler.h"
+#include "process/wait.h"
+#include "string.h"
+#include "sys/bitops.h"
+#include "sys/stat.h"
+#include "system/syscall.h"
+
+/// The I/O port of the first serial port.
+#define SERIAL_COM1 0x03F8
+
+/// The registers of the UART, as offsets from its port.
+#define UART_DATA 0 ///< Received, or transmitted, byte (the low byte of the divisor, with DLAB).
+#define UART_IER  1 ///< Interrupt enable (the high byte of the divisor, with DLAB).
+#define UART_IIR  2 ///< Interrupt identification, when read.
+#define UART_FCR  2 ///< FIFO control, when written.
+#define UART_LCR  3 ///< Line control.
+#define UART_MCR  4 ///< Modem control.
+#define UART_LSR  5 ///< Line status.
+
+#define UART_IER_RDI  0x01 ///< Interrupt when data is received.
+#define UART_IER_THRI 0x02 ///< Interrupt when the transmit FIFO is empty.
+#define UART_IIR_NONE 0x01 ///< No interrupt is pending.
+#define UART_FCR_INIT 0xC7 ///< Enable and clear the FIFOs, interrupt with 14 received bytes.
+#define UART_LCR_DLAB 0x80 ///< Accesses the divisor of the baud rate.
+#define UART_LCR_8N1  0x03 ///< 8 data bits, no parity, one stop bit.
+#define UART_MCR_INIT 0x0B ///< DTR, RTS, and OUT2 which routes the interrupts to the PIC.
+#define UART_LSR_DR   0x01 ///< A received byte is ready.
+#define UART_LSR_THRE 0x20 ///< The transmit FIFO is empty.
+
+/// The size of the FIFOs of the 16550.
+#define UART_FIFO_SIZE 16
+/// The size of the transmit ring, a power of two.
+#define SERIAL_TX_SIZE 4096
+/// The size of the receive ring, a power of two.
+#define SERIAL_RX_SIZE 1024
+
+/// @brief A ring of bytes, written at head and read at tail, which only grow.
+typedef struct serial_ring {
+    /// The bytes.
+    char *buffer;
+    /// The size of the ring, a power of two.
+    unsigned int size;
+    /// The amount of bytes ever written.
+    unsigned int head;
+    /// The amount of bytes ever read.
+    unsigned int tail;
+} serial_ring_t;
+
+/// The bytes of the transmit ring.
+static char tx_buffer[SERIAL_TX_SIZE];
+/// The bytes of the receive ring.
+static char rx_buffer[SERIAL_RX_SIZE];
+/// The bytes waiting to be sent.
+static serial_ring_t tx_ring = {tx_buffer, SERIAL_TX_SIZE, 0, 0};
+/// The bytes received, and not read yet.
+static serial_ring_t rx_ring = {rx_buffer, SERIAL_RX_SIZE, 0, 0};
+/// The interrupts enabled on the UART.
+static uint8_t uart_ier = 0;
+/// If the UART is driven by its interrupts.
+static int serial_ready = 0;
+/// The tasks waiting for received bytes.
+static wait_queue_head_t serial_rx_wait;
+/// The settings of the terminal.
+static termios_t serial_termios;
+/// The file of `/dev/ttyS0`.
+static vfs_file_t *serial_file;
+
+/// @brief Returns the amount of bytes inside a ring.
+/// @param ring the ring.
+/// @return the amount of bytes.
+static inline unsigned int __ring_count(serial_ring_t *ring) { return ring->head - ring->tail; }
+
+/// @brief Writes a byte with the UART, once its transmit FIFO is empty.
+/// @param c the byte.
+static inline void __serial_putc_polled(char c)
+{
+    while (!(inportb(SERIAL_COM1 + UART_LSR) & UART_LSR_THRE)) {
+        cpu_relax();
+    }
+    outportb(SERIAL_COM1 + UART_DATA, (uint8_t)c);
+}
+
+/// @brief Refills the transmit FIFO from the ring, if the FIFO is empty, and
+/// has the UART interrupt when it empties, as long as the ring has bytes.
+/// Called with the interrupts disabled.
+static void __serial_tx_start(void)
+{
+    if (inportb(SERIAL_COM1 + UART_LSR) & UART_LSR_THRE) {
+        for (unsigned int i = 0; (i < UART_FIFO_SIZE) && __ring_count(&tx_ring); ++i) {
+            outportb(SERIAL_COM1 + UART_DATA, (uint8_t)tx_ring.buffer[(tx_ring.tail++) & (tx_ring.size - 1)]);
+        }
+    }
+    uint8_t ier = __ring_count(&tx_ring) ? (uart_ier | UART_IER_THRI) : (uart_ier & ~UART_IER_THRI);
+    if (ier != uart_ier) {
+        uart_ier = ier;
+        outportb(SERIAL_COM1 + UART_IER, uart_ier);
+    }
+}
+
+/// @brief Writes the bytes which are queued right away. Called with the
+/// interrupts disabled.
+static inline void __serial_tx_flush(void)
+{
+    while (__ring_count(&tx_ring)) {
+        __serial_putc_polled(tx_ring.buffer[(tx_ring.tail++) & (tx_ring.size - 1)]);
+    }
+}
+
+/// @brief Handles the interrupts of the UART.
+/// @param f the registers of the interrupted code.
+static void serial_isr(pt_regs_t *f)
+{
+    int received = 0;
+    while (!(inportb(SERIAL_COM1 + UART_IIR) & UART_IIR_NONE)) {
+        // Move the received bytes, dropping them when nobody reads them.
+        while (inportb(SERIAL_COM1 + UART_LSR) & UART_LSR_DR) {
+            char c = (char)inportb(SERIAL_COM1 + UART_DATA);
+            if (__ring_count(&rx_ring) < rx_ring.size) {
+                rx_ring.buffer[(rx_ring.head++) & (rx_ring.size - 1)] = c;
+            }
+            received = 1;
+        }
+        __serial_tx_start();
+    }
+    if (received) {
+        wake_up(&serial_rx_wait);
+    }
+}
+
+void serial_write(const char *buffer, size_t size)
+{
+    uint8_t flags = irq_disable();
+    // Without the interrupts, the queued bytes would never be sent.
+    if (!serial_ready || !flags) {
+        __serial_tx_flush();
+        for (size_t i = 0; i < size; ++i) {
+            __serial_putc_polled(buffer[i]);
+        }
+        irq_enable(flags);
+        return;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        // Make room by sending the oldest byte, when the ring is full.
+        if (__ring_count(&tx_ring) == tx_ring.size) {
+            __serial_putc_polled(tx_ring.buffer[(tx_ring.tail++) & (tx_ring.size - 1)]);
+        }
+        tx_ring.buffer[(tx_ring.head++) & (tx_ring.size - 1)] = buffer[i];
+    }
+    __serial_tx_start();
+    irq_enable(flags);
+}
+
+/// @brief Opens `/dev/ttyS0`.
+/// @param path the path of the device.
+/// @param flags the flags of the open.
+/// @param mode not used.
+/// @return the file of the device.
+static vfs_file_t *serial_open(const char *path, int flags, mode_t mode) { return serial_file; }
+
+/// @brief Closes `/dev/ttyS0`, whose file is never freed.
+/// @param file the file of the device.
+/// @return 0 on success.
+static int serial_close(vfs_file_t *file)
+{
+    --file->count;
+    return 0;
+}
+
+/// @brief Reads the received bytes, waiting until there is at least one.
+/// @param file the file of the device.
+/// @param buffer where the bytes are copied.
+/// @param offset not used.
+/// @param nbyte the size of the buffer.
+/// @return the amount of bytes read, or a negative error code.
+static ssize_t serial_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    while (__ring_count(&rx_ring) == 0) {
+        if (bitmask_check(file->flags, O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&serial_rx_wait) < 0) {
+            return -EINTR;
+        }
+    }
+    uint8_t flags = irq_disable();
+    size_t count  = 0;
+    while ((count < nbyte) && __ring_count(&rx_ring)) {
+        buffer[count++] = rx_ring.buffer[(rx_ring.tail++) & (rx_ring.size - 1)];
+    }
+    irq_enable(flags);
+    return count;
+}
+
+/// @brief Writes the given bytes to the serial port.
+/// @param file the file of the device.
+/// @param buffer the bytes.
+/// @param offset not used.
+/// @param nbyte the amount of bytes.
+/// @return the amount of bytes written.
+static ssize_t serial_file_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    serial_write(buffer, nbyte);
+    return nbyte;
+}
+
+/// @brief Retrieves the status of `/dev/ttyS0`.
+/// @param file the file of the device.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int serial_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = file->mask;
+    stat->st_uid   = file->uid;
+    stat->st_gid   = file->gid;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Retrieves the status of `/dev/ttyS0`, by path.
+/// @param path the path of the device.
+/// @param stat where the status is stored.
+/// @return 0 on success, -ENOENT if the path is not the device.
+static int serial_stat(const char *path, stat_t *stat)
+{
+    if (strcmp(path, serial_file->name) != 0) {
+        return -ENOENT;
+    }
+    return serial_fstat(serial_file, stat);
+}
+
+/// @brief Gets, or sets, the settings of the terminal.
+/// @param file the file of the device.
+/// @param request the request (TCGETS or TCSETS).
+/// @param data the settings.
+/// @return 0 on success, -EINVAL for other requests.
+static long serial_ioctl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    switch (request) {
+    case TCGETS:
+        *((termios_t *)data) = serial_termios;
+        return 0;
+    case TCSETS:
+        serial_termios = *((termios_t *)data);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief Reports the readiness of `/dev/ttyS0`.
+/// @param file the file of the device.
+/// @param table the poll table.
+/// @return POLLIN if there are received bytes, the device is always writable.
+static unsigned int serial_poll(vfs_file_t *file, poll_table_t *table)
+{
+    poll_wait(&serial_rx_wait, table);
+    return (POLLOUT | POLLWRNORM) | (__ring_count(&rx_ring) ? (POLLIN | POLLRDNORM) : 0);
+}
+
+/// @brief The mount callback, the serial port cannot be mounted.
+/// @param path the path of the mount.
+/// @param device the device.
+/// @param options the mount options.
+/// @return NULL.
+static vfs_file_t *serial_mount_callback(const char *path, const char *device, const char *options) { return NULL; }
+
+/// System operations of the serial port.
+static vfs_sys_operations_t serial_sys_operations = {
+    .mkdir_f = NULL,
+    .rmdir_f = NULL,
+    .stat_f  = serial_stat,
+};
+
+/// File operations of the serial port.
+static vfs_file_operations_t serial_fs_operations = {
+    .open_f     = serial_open,
+    .unlink_f   = NULL,
+    .close_f    = serial_close,
+    .read_f     = serial_read,
+    .write_f    = serial_file_write,
+    .lseek_f    = NULL,
+    .stat_f     = serial_fstat,
+    .ioctl_f    = serial_ioctl,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = serial_poll,
+};
+
+/// Filesystem type of the serial port.
+static file_system_type_t serial_file_system_type = {.name = "ttyS", .fs_flags = 0, .mount = serial_mount_callback};
+
+int serial_initialize(void)
+{
+    serial_file = vfs_alloc_file();
+    if (!serial_file) {
+        pr_err("Failed to allocate the file of `/dev/ttyS0`.\n");
+        return 1;
+    }
+    memset(serial_file, 0, sizeof(vfs_file_t));
+    strcpy(serial_file->name, "/dev/ttyS0");
+    serial_file->mask           = S_IFCHR | 0666;
+    serial_file->atime          = sys_time(NULL);
+    serial_file->mtime          = serial_file->atime;
+    serial_file->ctime          = serial_file->atime;
+    serial_file->sys_operations = &serial_sys_operations;
+    serial_file->fs_operations  = &serial_fs_operations;
+    list_head_init(&serial_file->siblings);
+    wait_queue_head_init(&serial_rx_wait);
+    if (!vfs_register_filesystem(&serial_file_system_type)) {
+        pr_err("Failed to register the filesystem of `/dev/ttyS0`.\n");
+        return 1;
+    }
+    if (!vfs_register_superblock("ttyS", "/dev/ttyS0", &serial_file_system_type, serial_file)) {
+        pr_err("Failed to mount `/dev/ttyS0`.\n");
+        return 1;
+    }
+    uint8_t flags = irq_disable();
+    // Send what is still queued, before programming the UART.
+    __serial_tx_flush();
+    // 115200 baud, 8N1.
+    outportb(SERIAL_COM1 + UART_IER, 0);
+    outportb(SERIAL_COM1 + UART_LCR, UART_LCR_DLAB);
+    outportb(SERIAL_COM1 + UART_DATA, 1);
+    outportb(SERIAL_COM1 + UART_IER, 0);
+    outportb(SERIAL_COM1 + UART_LCR, UART_LCR_8N1);
+    outportb(SERIAL_COM1 + UART_FCR, UART_FCR_INIT);
+    outportb(SERIAL_COM1 + UART_MCR, UART_MCR_INIT);
+    // Discard what was received, and have the UART interrupt.
+    while (inportb(SERIAL_COM1 + UART_LSR) & UART_LSR_DR) {
+        inportb(SERIAL_COM1 + UART_DATA);
+    }
+    uart_ier = UART_IER_RDI;
+    outportb(SERIAL_COM1 + UART_IER, uart_ier);
+    irq_install_handler(IRQ_COM1_3, serial_isr, "serial");
+    irq_unmask(IRQ_COM1_3);
+    serial_ready = 1;
+    irq_enable(flags);
+    return 0;
+}
@@ -0,0 +1,1053 @@
+/// @file virtio_blk.c
+/// @brief Driver for the virtio block devices.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup virtio_blk
+/// @{
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[VIRTIO]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "drivers/virtio_blk.h"
+
+#include "descriptor_tables/isr.h"
+#include "devices/pci.h"
+#include "drivers/virtio.h"
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/blkdev.h"
+#include "fs/vfs.h"
+#include "io/port_io.h"
+#include "klib/irqflags.h"
+#include "klib/spinlock.h"
+#include "math.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page.h"
+#include "mem/mm/vmem.h"
+#include "process/scheduler.h"
+#include "proc_access.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdio.h"
+#include "string.h"
+#include "system/syscall.h"
+
+#define VIRTIO_PCI_DEVICE_BLK      0x1001 ///< A transitional block device (legacy and modern).
+#define VIRTIO_PCI_DEVICE_BLK_V1   0x1042 ///< A modern-only block device.
+#define VIRTIO_BLK_MAX_DEVICES     4      ///< Maximum number of devices we drive.
+#define VIRTIO_BLK_SECTOR_SIZE     512    ///< The sector size, which virtio always uses for addressing.
+#define VIRTIO_BLK_MAX_SEGMENTS    8      ///< Maximum number of data buffers of a request.
+#define VIRTIO_BLK_SLOT_DESCS      (VIRTIO_BLK_MAX_SEGMENTS + 2) ///< Descriptors of a request (header, data, status).
+#define VIRTIO_BLK_MAX_QUEUE_SIZE  256    ///< Size of the virtqueue, when the device lets us choose.
+#define VIRTIO_BLK_BOUNCE_SECTORS  128    ///< Sectors of the bounce buffer.
+#define VIRTIO_BLK_BOUNCE_SIZE     (VIRTIO_BLK_SECTOR_SIZE * VIRTIO_BLK_BOUNCE_SECTORS) ///< Size of the bounce buffer.
+#define VIRTIO_BLK_MMIO_MAX_LENGTH 0x1000 ///< Maximum size of a region of the modern interface we map.
+
+#define VIRTIO_BLK_F_RO (1U << 5) ///< The device is read-only (first word of the features).
+
+#define VIRTIO_BLK_T_IN  0  ///< Read request.
+#define VIRTIO_BLK_T_OUT 1  ///< Write request.
+#define VIRTIO_BLK_S_OK  0  ///< The request succeeded.
+
+/// @brief The header of a request, read by the device.
+typedef struct virtio_blk_req {
+    uint32_t type;     ///< VIRTIO_BLK_T_IN or VIRTIO_BLK_T_OUT.
+    uint32_t reserved; ///< Reserved.
+    uint64_t sector;   ///< The first sector.
+} __attribute__((packed)) virtio_blk_req_t;
+
+/// @brief The memory shared with the device by a request slot.
+typedef volatile struct virtio_blk_slot {
+    virtio_blk_req_t header; ///< The header of the request.
+    uint8_t status;          ///< The outcome of the request, written by the device.
+    uint8_t padding[7];      ///< Keeps the slots aligned.
+} __attribute__((packed)) virtio_blk_slot_t;
+
+/// @brief A virtio block device.
+typedef struct virtio_blk {
+    /// The PCI identifier of the device.
+    uint32_t pci;
+    /// If the device is driven through the modern interface.
+    bool_t modern;
+    /// The I/O ports of the legacy interface.
+    uint16_t iobase;
+    /// The common configuration of the modern interface.
+    virtio_pci_common_cfg_t *common;
+    /// The notification register of the queue, for the modern interface.
+    volatile uint16_t *notify;
+    /// The interrupt status, for the modern interface.
+    volatile uint8_t *isr;
+    /// The device specific configuration, for the modern interface.
+    volatile uint8_t *config;
+    /// Device name.
+    char name[NAME_MAX];
+    /// Device path.
+    char path[PATH_MAX];
+    /// Number of sectors of the device.
+    uint64_t sectors;
+    /// If the device is read-only.
+    bool_t read_only;
+    /// The size of the virtqueue.
+    uint16_t queue_size;
+    /// The descriptors of the virtqueue.
+    virtq_desc_t *desc;
+    /// The available ring of the virtqueue.
+    virtq_avail_t *avail;
+    /// The used ring of the virtqueue.
+    virtq_used_t *used;
+    /// The next entry of the used ring we have to process.
+    uint16_t last_used;
+    /// The headers and the statuses of the slots.
+    virtio_blk_slot_t *slots;
+    /// The physical address of the slots.
+    uintptr_t slots_phys;
+    /// Number of usable request slots.
+    uint32_t num_slots;
+    /// Mask of the slots with a request in flight.
+    volatile uint32_t issued;
+    /// Mask of the slots whose request has failed.
+    volatile uint32_t failed;
+    /// The request served by each slot, if any.
+    blk_request_t *requests[BLK_MAX_DEPTH];
+    /// The bounce buffer, used when the caller buffer cannot be mapped.
+    uint8_t *bounce;
+    /// The physical address of the bounce buffer.
+    uintptr_t bounce_phys;
+    /// Lock for the device.
+    spinlock_t lock;
+    /// The filesystem root of the device.
+    vfs_file_t *fs_root;
+    /// The request queue of the device.
+    request_queue_t queue;
+} virtio_blk_t;
+
+/// The PCI identifiers of the devices found while scanning.
+static uint32_t virtio_blk_pci[VIRTIO_BLK_MAX_DEVICES];
+/// The devices.
+static virtio_blk_t virtio_blk_devices[VIRTIO_BLK_MAX_DEVICES];
+/// Number of devices which have been set up.
+static uint32_t virtio_blk_count = 0;
+/// Mask of the IRQ lines our handler is installed on.
+static uint32_t virtio_blk_irqs = 0;
+/// Keeps track of the drive letters.
+static char virtio_blk_drive_char = 'a';
+
+// == SUPPORT FUNCTIONS =======================================================
+
+/// @brief Allocates physically contiguous low memory for the device.
+/// @param size the size of the memory area.
+/// @param physical the physical address of the memory area.
+/// @return the logical address of the memory area, or 0 on failure.
+static inline uintptr_t virtio_blk_dma_alloc(size_t size, uintptr_t *physical)
+{
+    // Get the page order to accommodate the requested size.
+    uint32_t order = find_nearest_order_greater(0, size);
+    // Allocate a contiguous block of memory pages.
+    page_t *page   = alloc_pages(GFP_KERNEL, order);
+    if (!page) {
+        pr_crit("Failed to allocate pages for DMA memory (order = %d).\n", order);
+        return 0;
+    }
+    *physical                = get_physical_address_from_page(page);
+    uintptr_t lowmem_address = get_virtual_address_from_page(page);
+    if (!*physical || !lowmem_address) {
+        pr_crit("Failed to retrieve the addresses of the DMA memory.\n");
+        free_pages(page);
+        return 0;
+    }
+    // The rings start out empty.
+    memset((void *)lowmem_address, 0, size);
+    return lowmem_address;
+}
+
+/// @brief Checks if the device can transfer data directly to/from the buffer.
+/// @details A descriptor needs physically contiguous memory, which is the case
+/// for buffers inside the low memory.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+/// @param physical where we store the physical address of the buffer.
+/// @return 1 if the buffer can be used directly, 0 otherwise.
+static inline int virtio_blk_dma_map_buffer(uint8_t *buffer, size_t size, uintptr_t *physical)
+{
+    uintptr_t vaddr = (uintptr_t)buffer;
+    // The buffer must reside entirely inside the low memory.
+    if ((vaddr < memory.low_mem.virt_start) || (vaddr + size < vaddr) || (vaddr + size > memory.low_mem.virt_end)) {
+        return 0;
+    }
+    page_t *page = get_page_from_virtual_address(vaddr);
+    if (!page) {
+        return 0;
+    }
+    *physical = get_physical_address_from_page(page) + (vaddr & (PAGE_SIZE - 1));
+    return *physical != 0;
+}
+
+/// @brief Returns the maximum offset of the device.
+/// @param dev the device.
+/// @return the size of the device in bytes.
+static inline uint64_t virtio_blk_max_offset(virtio_blk_t *dev) { return dev->sectors * VIRTIO_BLK_SECTOR_SIZE; }
+
+/// @brief Reads the status of the device.
+/// @param dev the device.
+/// @return the VIRTIO_STATUS_* bits.
+static inline uint8_t virtio_blk_get_status(virtio_blk_t *dev)
+{
+    return dev->modern ? dev->common->device_status : inportb(dev->iobase + VIRTIO_PCI_STATUS);
+}
+
+/// @brief Writes the status of the device, writing 0 resets it.
+/// @param dev the device.
+/// @param status the VIRTIO_STATUS_* bits.
+static inline void virtio_blk_set_status(virtio_blk_t *dev, uint8_t status)
+{
+    if (dev->modern) {
+        dev->common->device_status = status;
+    } else {
+        outportb(dev->iobase + VIRTIO_PCI_STATUS, status);
+    }
+}
+
+/// @brief Reads, and clears, the interrupt status of the device.
+/// @param dev the device.
+/// @return the interrupt status, bit 0 is set when the queue has been used.
+static inline uint8_t virtio_blk_read_isr(virtio_blk_t *dev)
+{
+    return dev->modern ? *dev->isr : inportb(dev->iobase + VIRTIO_PCI_ISR);
+}
+
+/// @brief Reads 32 bits from the device specific configuration.
+/// @param dev the device.
+/// @param offset the offset inside the configuration.
+/// @return the value.
+static inline uint32_t virtio_blk_config_read_32(virtio_blk_t *dev, uint32_t offset)
+{
+    if (dev->modern) {
+        return *(volatile uint32_t *)(dev->config + offset);
+    }
+    return inportl(dev->iobase + VIRTIO_PCI_CONFIG + offset);
+}
+
+/// @brief Tells the device that there are new chains in the available ring.
+/// @param dev the device.
+static inline void virtio_blk_notify(virtio_blk_t *dev)
+{
+    if (dev->modern) {
+        *dev->notify = 0;
+    } else {
+        outports(dev->iobase + VIRTIO_PCI_QUEUE_NOTIFY, 0);
+    }
+}
+
+// == VIRTQUEUE ===============================================================
+
+/// @brief Processes the chains the device has placed in the used ring.
+/// @details Called both from the IRQ handler, and by the tasks waiting for
+/// their requests, so that a lost interrupt cannot stall them.
+/// @param dev the device.
+static void virtio_blk_complete(virtio_blk_t *dev)
+{
+    while (dev->last_used != dev->used->idx) {
+        // Read the entry only after its index.
+        __asm__ __volatile__("" ::: "memory");
+        uint32_t slot = dev->used->ring[dev->last_used % dev->queue_size].id / VIRTIO_BLK_SLOT_DESCS;
+        ++dev->last_used;
+        if ((slot >= dev->num_slots) || !(dev->issued & (1U << slot))) {
+            continue;
+        }
+        if (dev->slots[slot].status != VIRTIO_BLK_S_OK) {
+            dev->failed |= (1U << slot);
+        }
+        if (dev->requests[slot]) {
+            dev->requests[slot]->status = (dev->failed & (1U << slot)) ? -EIO : 0;
+            dev->requests[slot]         = NULL;
+        }
+        dev->issued &= ~(1U << slot);
+    }
+}
+
+/// @brief Waits until the requests in the given slots are completed.
+/// @param dev the device.
+/// @param mask the mask of slots.
+static void virtio_blk_wait(virtio_blk_t *dev, uint32_t mask)
+{
+    uint8_t flags = irq_disable();
+    virtio_blk_complete(dev);
+    while (dev->issued & mask) {
+        // During boot there are no tasks, and interrupts are disabled, so we
+        // simply poll the used ring.
+        if (scheduler_get_current_process() == NULL) {
+            pause();
+        } else {
+            // The `sti` takes effect after `hlt`, so the IRQ cannot be lost.
+            __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+        }
+        virtio_blk_complete(dev);
+    }
+    irq_enable(flags);
+}
+
+/// @brief Returns a free request slot, waiting for one if they are all busy.
+/// @param dev the device.
+/// @return the index of the slot.
+static uint32_t virtio_blk_get_slot(virtio_blk_t *dev)
+{
+    while (1) {
+        for (uint32_t slot = 0; slot < dev->num_slots; ++slot) {
+            if (!(dev->issued & (1U << slot))) {
+                return slot;
+            }
+        }
+        virtio_blk_wait(dev, dev->issued);
+    }
+}
+
+/// @brief Sets a descriptor of the chain of a slot.
+/// @param dev the device.
+/// @param slot the slot of the request.
+/// @param index the index of the descriptor inside the chain.
+/// @param physical the physical address of the buffer.
+/// @param size the size of the buffer.
+/// @param flags the VIRTQ_DESC_F_* flags.
+static inline void
+virtio_blk_set_desc(virtio_blk_t *dev, uint32_t slot, uint32_t index, uintptr_t physical, size_t size, uint16_t flags)
+{
+    uint16_t head      = slot * VIRTIO_BLK_SLOT_DESCS;
+    virtq_desc_t *desc = &dev->desc[head + index];
+    desc->addr         = physical;
+    desc->len          = size;
+    desc->flags        = flags;
+    desc->next         = head + index + 1;
+}
+
+/// @brief Issues a request, whose data descriptors have already been set.
+/// @param dev the device.
+/// @param slot the slot of the request.
+/// @param sector the first sector.
+/// @param segments the number of data descriptors.
+/// @param write if the request writes to the device.
+/// @param request the block request served by the slot, if any.
+static inline void virtio_blk_issue(
+    virtio_blk_t *dev,
+    uint32_t slot,
+    uint64_t sector,
+    uint32_t segments,
+    int write,
+    blk_request_t *request)
+{
+    uintptr_t slot_phys              = dev->slots_phys + slot * sizeof(virtio_blk_slot_t);
+    dev->slots[slot].header.type     = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+    dev->slots[slot].header.reserved = 0;
+    dev->slots[slot].header.sector   = sector;
+    dev->slots[slot].status          = 0xFF;
+    // The header comes first, the status last, with the data in between.
+    virtio_blk_set_desc(dev, slot, 0, slot_phys, sizeof(virtio_blk_req_t), VIRTQ_DESC_F_NEXT);
+    virtio_blk_set_desc(
+        dev, slot, segments + 1, slot_phys + offsetof(virtio_blk_slot_t, status), 1, VIRTQ_DESC_F_WRITE);
+    // Keep interrupts disabled, so that the IRQ handler does not see the slot
+    // half-issued.
+    uint8_t flags       = irq_disable();
+    dev->requests[slot] = request;
+    dev->failed &= ~(1U << slot);
+    dev->issued |= (1U << slot);
+    dev->avail->ring[dev->avail->idx % dev->queue_size] = slot * VIRTIO_BLK_SLOT_DESCS;
+    // The device must see the entry before the index.
+    __asm__ __volatile__("" ::: "memory");
+    ++dev->avail->idx;
+    __asm__ __volatile__("" ::: "memory");
+    virtio_blk_notify(dev);
+    irq_enable(flags);
+}
+
+/// @brief Sets a data descriptor of the chain of a slot.
+/// @param dev the device.
+/// @param slot the slot of the request.
+/// @param index the index of the data descriptor.
+/// @param physical the physical address of the buffer.
+/// @param size the size of the buffer.
+/// @param write if the request writes to the device (the device reads the buffer).
+static inline void
+virtio_blk_set_segment(virtio_blk_t *dev, uint32_t slot, uint32_t index, uintptr_t physical, size_t size, int write)
+{
+    virtio_blk_set_desc(dev, slot, index + 1, physical, size, VIRTQ_DESC_F_NEXT | (write ? 0 : VIRTQ_DESC_F_WRITE));
+}
+
+/// @brief Transfers consecutive sectors through a single memory region, and
+/// waits for the transfer to complete.
+/// @param dev the device.
+/// @param sector the first sector.
+/// @param count the number of sectors (at most VIRTIO_BLK_BOUNCE_SECTORS).
+/// @param physical the physical address of the memory region.
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return 0 on success, -errno on failure.
+static int virtio_blk_transfer(virtio_blk_t *dev, uint64_t sector, uint32_t count, uintptr_t physical, int write)
+{
+    if ((sector + count) > dev->sectors) {
+        pr_err("[%s] Transfer beyond the end of the device (sector: %llu, count: %u).\n", dev->name, sector, count);
+        return -EINVAL;
+    }
+    if (write && dev->read_only) {
+        return -EROFS;
+    }
+    uint32_t slot = virtio_blk_get_slot(dev);
+    virtio_blk_set_segment(dev, slot, 0, physical, count * VIRTIO_BLK_SECTOR_SIZE, write);
+    virtio_blk_issue(dev, slot, sector, 1, write, NULL);
+    virtio_blk_wait(dev, 1U << slot);
+    if (dev->failed & (1U << slot)) {
+        pr_err("[%s] Failed to %s %u sectors at %llu.\n", dev->name, write ? "write" : "read", count, sector);
+        return -EIO;
+    }
+    return 0;
+}
+
+/// @brief Transfers consecutive sectors through the bounce buffer of the
+/// device. The caller holds the lock of the device.
+/// @param dev the device.
+/// @param sector the first sector.
+/// @param count the number of sectors (at most VIRTIO_BLK_BOUNCE_SECTORS).
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return 0 on success, -errno on failure.
+static inline int virtio_blk_bounce(virtio_blk_t *dev, uint64_t sector, uint32_t count, int write)
+{
+    return virtio_blk_transfer(dev, sector, count, dev->bounce_phys, write);
+}
+
+/// @brief Serves a request coming from the block I/O layer.
+/// @details When all the bios can be mapped, the request is issued with one
+/// data descriptor per bio, and the function returns without waiting for it,
+/// so that the device can have up to a full queue of requests in flight.
+/// Otherwise, the request is served synchronously through the bounce buffer.
+/// @param device the virtio block device.
+/// @param request the request.
+/// @return 0 on success, -errno on failure.
+static int virtio_blk_request_fn(void *device, blk_request_t *request)
+{
+    virtio_blk_t *dev = (virtio_blk_t *)device;
+    uintptr_t physical[VIRTIO_BLK_MAX_SEGMENTS];
+    uint32_t segments = 0;
+    int ret;
+    if ((request->sector + request->count) > dev->sectors) {
+        return -EINVAL;
+    }
+    if (request->write && dev->read_only) {
+        return -EROFS;
+    }
+    // Acquire the lock for thread safety.
+    spinlock_lock(&dev->lock);
+    // Try to map all the bios of the request.
+    list_for_each_decl (it, &request->bios) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        if ((segments == VIRTIO_BLK_MAX_SEGMENTS) ||
+            !virtio_blk_dma_map_buffer(bio->buffer, bio->count * VIRTIO_BLK_SECTOR_SIZE, &physical[segments])) {
+            segments = 0;
+            break;
+        }
+        ++segments;
+    }
+    if (segments) {
+        uint32_t slot = virtio_blk_get_slot(dev);
+        uint32_t i    = 0;
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            virtio_blk_set_segment(dev, slot, i, physical[i], bio->count * VIRTIO_BLK_SECTOR_SIZE, request->write);
+            ++i;
+        }
+        virtio_blk_issue(dev, slot, request->sector, segments, request->write, request);
+        // Release the lock, the completion is handled by virtio_blk_sync_fn.
+        spinlock_unlock(&dev->lock);
+        return 0;
+    }
+    if (request->write) {
+        // Gather the bios inside the bounce buffer.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                dev->bounce + (bio->sector - request->sector) * VIRTIO_BLK_SECTOR_SIZE, bio->buffer,
+                bio->count * VIRTIO_BLK_SECTOR_SIZE);
+        }
+    }
+    // Perform the transfer.
+    ret = virtio_blk_bounce(dev, request->sector, request->count, request->write);
+    if ((ret == 0) && !request->write) {
+        // Scatter the bounce buffer to the bios.
+        list_for_each_decl (it, &request->bios) {
+            bio_t *bio = list_entry(it, bio_t, list);
+            memcpy(
+                bio->buffer, dev->bounce + (bio->sector - request->sector) * VIRTIO_BLK_SECTOR_SIZE,
+                bio->count * VIRTIO_BLK_SECTOR_SIZE);
+        }
+    }
+    // Release the lock after the operation.
+    spinlock_unlock(&dev->lock);
+    return ret;
+}
+
+/// @brief Waits for all the requests in flight on the device.
+/// @param device the virtio block device.
+static void virtio_blk_sync_fn(void *device)
+{
+    virtio_blk_t *dev = (virtio_blk_t *)device;
+    virtio_blk_wait(dev, dev->issued);
+}
+
+// == VFS CALLBACKS ===========================================================
+
+/// @brief Implements the open function for a virtio block device.
+/// @param path the path to the device we want to open.
+/// @param flags we ignore these.
+/// @param mode we currently ignore this.
+/// @return the VFS file associated with the device.
+static vfs_file_t *virtio_blk_open(const char *path, int flags, mode_t mode)
+{
+    pr_debug("virtio_blk_open(%s, %d, %d)\n", path, flags, mode);
+    for (uint32_t i = 0; i < virtio_blk_count; ++i) {
+        virtio_blk_t *dev = &virtio_blk_devices[i];
+        if (dev->fs_root && (strcmp(path, dev->path) == 0)) {
+            // Increment reference count for the file.
+            ++dev->fs_root->count;
+            return dev->fs_root;
+        }
+    }
+    pr_crit("Device not found for path: %s\n", path);
+    return NULL;
+}
+
+/// @brief Closes a virtio block device.
+/// @param file the VFS file associated with the device.
+/// @return 0 on success, -errno on failure.
+static int virtio_blk_close(vfs_file_t *file)
+{
+    // Validate the file pointer.
+    if (file == NULL) {
+        pr_err("virtio_blk_close: Invalid file pointer (NULL).\n");
+        return -EINVAL;
+    }
+    if (file->device == NULL) {
+        pr_crit("virtio_blk_close: Device not set for file `%s`.\n", file->name);
+        return -ENODEV;
+    }
+    // Decrement the reference count for the file.
+    if (--file->count == 0) {
+        // Remove the file from the list of opened files.
+        list_head_remove(&file->siblings);
+        // Free the file from cache.
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Reads from a virtio block device.
+/// @param file the VFS file associated with the device.
+/// @param buffer the buffer where we store what we read.
+/// @param offset the offset where we want to read.
+/// @param size the size of the buffer.
+/// @return the number of read characters, -errno on failure.
+static ssize_t virtio_blk_read(vfs_file_t *file, char *buffer, off_t offset, size_t size)
+{
+    virtio_blk_t *dev   = (virtio_blk_t *)file->device;
+    uint64_t max_offset = virtio_blk_max_offset(dev);
+    size_t done         = 0;
+    // Check the boundaries of the read.
+    if ((offset < 0) || ((uint64_t)offset >= max_offset)) {
+        return 0;
+    }
+    size = min(size, max_offset - offset);
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&dev->queue);
+    uint32_t sectors = ((offset + size - 1) / VIRTIO_BLK_SECTOR_SIZE) - (offset / VIRTIO_BLK_SECTOR_SIZE) + 1;
+    while (done < size) {
+        uint64_t position = (uint64_t)offset + done;
+        uint32_t start    = position % VIRTIO_BLK_SECTOR_SIZE;
+        uint32_t count    = min(
+            (start + (size - done) + VIRTIO_BLK_SECTOR_SIZE - 1) / VIRTIO_BLK_SECTOR_SIZE, VIRTIO_BLK_BOUNCE_SECTORS);
+        uint32_t length = min(count * VIRTIO_BLK_SECTOR_SIZE - start, size - done);
+        spinlock_lock(&dev->lock);
+        int ret = virtio_blk_bounce(dev, position / VIRTIO_BLK_SECTOR_SIZE, count, 0);
+        if (ret == 0) {
+            memcpy(buffer + done, dev->bounce + start, length);
+        }
+        spinlock_unlock(&dev->lock);
+        if (ret < 0) {
+            blk_stats_done(&dev->queue, 0, sectors, start_time);
+            return ret;
+        }
+        done += length;
+    }
+    blk_stats_done(&dev->queue, 0, sectors, start_time);
+    return done;
+}
+
+/// @brief Writes on a virtio block device.
+/// @details Partial sectors are read first, and the whole update happens under
+/// the lock of the device, so that concurrent writers do not clobber each other.
+/// @param file the VFS file associated with the device.
+/// @param buffer the buffer we write.
+/// @param offset the offset where we want to write.
+/// @param size the size of the buffer.
+/// @return the number of written characters, -errno on failure.
+static ssize_t virtio_blk_write(vfs_file_t *file, const void *buffer, off_t offset, size_t size)
+{
+    virtio_blk_t *dev   = (virtio_blk_t *)file->device;
+    uint64_t max_offset = virtio_blk_max_offset(dev);
+    size_t done         = 0;
+    // Check the boundaries of the write.
+    if ((offset < 0) || ((uint64_t)offset >= max_offset)) {
+        return 0;
+    }
+    if (dev->read_only) {
+        return -EROFS;
+    }
+    size = min(size, max_offset - offset);
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&dev->queue);
+    uint32_t sectors = ((offset + size - 1) / VIRTIO_BLK_SECTOR_SIZE) - (offset / VIRTIO_BLK_SECTOR_SIZE) + 1;
+    while (done < size) {
+        uint64_t position = (uint64_t)offset + done;
+        uint32_t start    = position % VIRTIO_BLK_SECTOR_SIZE;
+        uint32_t count    = min(
+            (start + (size - done) + VIRTIO_BLK_SECTOR_SIZE - 1) / VIRTIO_BLK_SECTOR_SIZE, VIRTIO_BLK_BOUNCE_SECTORS);
+        uint32_t length = min(count * VIRTIO_BLK_SECTOR_SIZE - start, size - done);
+        int ret         = 0;
+        spinlock_lock(&dev->lock);
+        // Read the sectors we only partially overwrite.
+        if ((start != 0) || (length != count * VIRTIO_BLK_SECTOR_SIZE)) {
+            ret = virtio_blk_bounce(dev, position / VIRTIO_BLK_SECTOR_SIZE, count, 0);
+        }
+        if (ret == 0) {
+            memcpy(dev->bounce + start, (const char *)buffer + done, length);
+            ret = virtio_blk_bounce(dev, position / VIRTIO_BLK_SECTOR_SIZE, count, 1);
+        }
+        spinlock_unlock(&dev->lock);
+        if (ret < 0) {
+            blk_stats_done(&dev->queue, 1, sectors, start_time);
+            return ret;
+        }
+        done += length;
+    }
+    blk_stats_done(&dev->queue, 1, sectors, start_time);
+    return done;
+}
+
+/// @brief Retrieves information concerning the virtio block device.
+/// @param dev the device.
+/// @param stat the stat buffer.
+/// @return 0 on success.
+static int _virtio_blk_stat(const virtio_blk_t *dev, stat_t *stat)
+{
+    if (dev && dev->fs_root) {
+        stat->st_dev   = 0;
+        stat->st_ino   = 0;
+        stat->st_mode  = dev->fs_root->mask;
+        stat->st_uid   = dev->fs_root->uid;
+        stat->st_gid   = dev->fs_root->gid;
+        stat->st_atime = dev->fs_root->atime;
+        stat->st_mtime = dev->fs_root->mtime;
+        stat->st_ctime = dev->fs_root->ctime;
+        stat->st_size  = dev->fs_root->length;
+    }
+    return 0;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param file the file.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int virtio_blk_fstat(vfs_file_t *file, stat_t *stat) { return _virtio_blk_stat(file->device, stat); }
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param path the path where the file resides.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int virtio_blk_stat(const char *path, stat_t *stat)
+{
+    super_block_t *sb = vfs_get_superblock(path);
+    if (sb && sb->root) {
+        return _virtio_blk_stat(sb->root->device, stat);
+    }
+    return -1;
+}
+
+// == VFS ENTRY GENERATION ====================================================
+
+/// @brief The mount call-back, virtio block devices are registered when detected.
+/// @param path the path where the filesystem should be mounted.
+/// @param device the device we mount.
+/// @param options the mount options, unused.
+/// @return the VFS file of the filesystem.
+static vfs_file_t *virtio_blk_mount_callback(const char *path, const char *device, const char *options)
+{
+    pr_err("mount_callback(%s, %s): virtio_blk has no mount callback!\n", path, device);
+    return NULL;
+}
+
+/// Filesystem information.
+static file_system_type_t virtio_blk_file_system_type = {
+    .name     = "virtio_blk",
+    .fs_flags = 0,
+    .mount    = virtio_blk_mount_callback,
+};
+
+/// Filesystem general operations.
+static vfs_sys_operations_t virtio_blk_sys_operations = {
+    .mkdir_f   = NULL,
+    .rmdir_f   = NULL,
+    .stat_f    = virtio_blk_stat,
+    .creat_f   = NULL,
+    .symlink_f = NULL,
+};
+
+/// Virtio block filesystem file operations.
+static vfs_file_operations_t virtio_blk_fs_operations = {
+    .open_f     = virtio_blk_open,
+    .unlink_f   = NULL,
+    .close_f    = virtio_blk_close,
+    .read_f     = virtio_blk_read,
+    .write_f    = virtio_blk_write,
+    .lseek_f    = NULL,
+    .stat_f     = virtio_blk_fstat,
+    .ioctl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+};
+
+/// @brief Creates a VFS file, starting from a virtio block device.
+/// @param dev the device.
+/// @return a pointer to the VFS file on success, NULL on failure.
+static vfs_file_t *virtio_blk_device_create(virtio_blk_t *dev)
+{
+    // Create the file.
+    vfs_file_t *file = vfs_alloc_file();
+    if (file == NULL) {
+        pr_err("Failed to create virtio block device.\n");
+        return NULL;
+    }
+    // Set the device name.
+    memcpy(file->name, dev->name, NAME_MAX);
+    file->uid            = 0;
+    file->gid            = 0;
+    file->mask           = 0x2000 | (dev->read_only ? 0400 : 0600);
+    file->atime          = sys_time(NULL);
+    file->mtime          = sys_time(NULL);
+    file->ctime          = sys_time(NULL);
+    file->length         = min(virtio_blk_max_offset(dev), UINT32_MAX);
+    // Set the device.
+    file->device         = dev;
+    // Re-set the flags.
+    file->flags          = DT_BLK;
+    // Change the operations.
+    file->sys_operations = &virtio_blk_sys_operations;
+    file->fs_operations  = &virtio_blk_fs_operations;
+    return file;
+}
+
+// == DEVICE INITIALIZATION ===================================================
+
+/// @brief Maps the region described by a capability of the modern interface.
+/// @param dev the device.
+/// @param cap the offset of the capability.
+/// @return the logical address of the region, NULL if it cannot be mapped.
+static volatile uint8_t *virtio_blk_map_cap(virtio_blk_t *dev, uint8_t cap)
+{
+    uint32_t offset, length, address, high = 0;
+    uint8_t bar;
+    if (pci_read_8(dev->pci, cap + VIRTIO_PCI_CAP_BAR, &bar) ||
+        pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_OFFSET, &offset) ||
+        pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_LENGTH, &length) || (bar > 5) ||
+        pci_read_32(dev->pci, PCI_BASE_ADDRESS_0 + bar * 4, &address)) {
+        return NULL;
+    }
+    // We only map memory regions, below 4 GiB.
+    if (address & 0x1) {
+        return NULL;
+    }
+    if ((((address >> 1U) & 0x3) == 0x2) &&
+        ((bar == 5) || pci_read_32(dev->pci, PCI_BASE_ADDRESS_0 + (bar + 1) * 4, &high) || high)) {
+        return NULL;
+    }
+    return (volatile uint8_t *)vmem_map_io((address & ~0xFU) + offset, min(length, VIRTIO_BLK_MMIO_MAX_LENGTH));
+}
+
+/// @brief Finds the regions of the modern interface.
+/// @param dev the device.
+/// @return 0 if the device can be driven through the modern interface, 1 otherwise.
+static int virtio_blk_find_modern(virtio_blk_t *dev)
+{
+    volatile uint8_t *notify = NULL;
+    uint32_t multiplier      = 0;
+    uint8_t cap = 0, type;
+    while (!pci_find_next_capability(dev->pci, PCI_CAP_ID_VNDR, cap, &cap)) {
+        if (pci_read_8(dev->pci, cap + VIRTIO_PCI_CAP_CFG_TYPE, &type)) {
+            return 1;
+        }
+        // Take the first capability of each type, the preferred one.
+        if ((type == VIRTIO_PCI_CAP_COMMON_CFG) && !dev->common) {
+            dev->common = (virtio_pci_common_cfg_t *)virtio_blk_map_cap(dev, cap);
+        } else if ((type == VIRTIO_PCI_CAP_NOTIFY_CFG) && !notify) {
+            if (!pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_NOTIFY_MULT, &multiplier)) {
+                notify = virtio_blk_map_cap(dev, cap);
+            }
+        } else if ((type == VIRTIO_PCI_CAP_ISR_CFG) && !dev->isr) {
+            dev->isr = virtio_blk_map_cap(dev, cap);
+        } else if ((type == VIRTIO_PCI_CAP_DEVICE_CFG) && !dev->config) {
+            dev->config = virtio_blk_map_cap(dev, cap);
+        }
+    }
+    if (!dev->common || !notify || !dev->isr || !dev->config) {
+        return 1;
+    }
+    // The notification register of the queue depends on the queue.
+    dev->common->queue_select = 0;
+    uint32_t offset           = dev->common->queue_notify_off * multiplier;
+    if (offset + sizeof(uint16_t) > VIRTIO_BLK_MMIO_MAX_LENGTH) {
+        return 1;
+    }
+    dev->notify = (volatile uint16_t *)(notify + offset);
+    return 0;
+}
+
+/// @brief Allocates the virtqueue, and the slots of the requests.
+/// @param dev the device.
+/// @param size the size of the virtqueue.
+/// @param physical where we store the physical address of the virtqueue.
+/// @return 0 on success, 1 on failure.
+static int virtio_blk_alloc_queue(virtio_blk_t *dev, uint16_t size, uintptr_t *physical)
+{
+    // The descriptors and the available ring come first, the used ring
+    // starts on the following page (as the legacy interface requires).
+    uint32_t used_offset = virtq_used_offset(size);
+    uintptr_t base       = virtio_blk_dma_alloc(virtq_total_size(size), physical);
+    if (!base) {
+        return 1;
+    }
+    dev->slots = (virtio_blk_slot_t *)virtio_blk_dma_alloc(BLK_MAX_DEPTH * sizeof(virtio_blk_slot_t), &dev->slots_phys);
+    if (!dev->slots) {
+        free_pages(get_page_from_virtual_address(base));
+        return 1;
+    }
+    dev->bounce = (uint8_t *)virtio_blk_dma_alloc(VIRTIO_BLK_BOUNCE_SIZE, &dev->bounce_phys);
+    if (!dev->bounce) {
+        free_pages(get_page_from_virtual_address((uintptr_t)dev->slots));
+        free_pages(get_page_from_virtual_address(base));
+        return 1;
+    }
+    dev->queue_size = size;
+    dev->desc       = (virtq_desc_t *)base;
+    dev->avail      = (virtq_avail_t *)(base + size * sizeof(virtq_desc_t));
+    dev->used       = (virtq_used_t *)(base + used_offset);
+    dev->last_used  = 0;
+    // Each slot owns a fixed chain of descriptors.
+    dev->num_slots  = min((uint32_t)BLK_MAX_DEPTH, (uint32_t)size / VIRTIO_BLK_SLOT_DESCS);
+    return dev->num_slots == 0;
+}
+
+/// @brief Sets up the device through the modern interface.
+/// @param dev the device.
+/// @return 0 on success, 1 on failure.
+static int virtio_blk_setup_modern(virtio_blk_t *dev)
+{
+    uintptr_t physical;
+    // Read the features, the device must comply with virtio 1.0.
+    dev->common->device_feature_select = 0;
+    uint32_t features                  = dev->common->device_feature;
+    dev->common->device_feature_select = 1;
+    if (!(dev->common->device_feature & VIRTIO_F_VERSION_1)) {
+        pr_err("[%s] The device does not support virtio 1.0.\n", dev->name);
+        return 1;
+    }
+    dev->read_only                     = (features & VIRTIO_BLK_F_RO) != 0;
+    dev->common->driver_feature_select = 0;
+    dev->common->driver_feature        = features & VIRTIO_BLK_F_RO;
+    dev->common->driver_feature_select = 1;
+    dev->common->driver_feature        = VIRTIO_F_VERSION_1;
+    virtio_blk_set_status(dev, virtio_blk_get_status(dev) | VIRTIO_STATUS_FEATURES_OK);
+    if (!(virtio_blk_get_status(dev) & VIRTIO_STATUS_FEATURES_OK)) {
+        pr_err("[%s] The device did not accept the features.\n", dev->name);
+        return 1;
+    }
+    // Set up the queue, the device lets us choose a smaller size.
+    dev->common->queue_select = 0;
+    uint16_t size             = dev->common->queue_size;
+    if (!size || virtio_blk_alloc_queue(dev, min(size, VIRTIO_BLK_MAX_QUEUE_SIZE), &physical)) {
+        return 1;
+    }
+    dev->common->queue_size      = dev->queue_size;
+    dev->common->queue_desc_lo   = physical;
+    dev->common->queue_desc_hi   = 0;
+    dev->common->queue_driver_lo = physical + ((uintptr_t)dev->avail - (uintptr_t)dev->desc);
+    dev->common->queue_driver_hi = 0;
+    dev->common->queue_device_lo = physical + ((uintptr_t)dev->used - (uintptr_t)dev->desc);
+    dev->common->queue_device_hi = 0;
+    dev->common->queue_enable    = 1;
+    return 0;
+}
+
+/// @brief Sets up the device through the legacy interface.
+/// @param dev the device.
+/// @return 0 on success, 1 on failure.
+static int virtio_blk_setup_legacy(virtio_blk_t *dev)
+{
+    uintptr_t physical;
+    uint32_t features = inportl(dev->iobase + VIRTIO_PCI_HOST_FEATURES);
+    dev->read_only    = (features & VIRTIO_BLK_F_RO) != 0;
+    outportl(dev->iobase + VIRTIO_PCI_GUEST_FEATURES, features & VIRTIO_BLK_F_RO);
+    // Set up the queue, whose size is chosen by the device.
+    outports(dev->iobase + VIRTIO_PCI_QUEUE_SEL, 0);
+    uint16_t size = inports(dev->iobase + VIRTIO_PCI_QUEUE_NUM);
+    if (!size || virtio_blk_alloc_queue(dev, size, &physical)) {
+        return 1;
+    }
+    outportl(dev->iobase + VIRTIO_PCI_QUEUE_PFN, physical / PAGE_SIZE);
+    return 0;
+}
+
+/// @brief Detects and registers a virtio block device.
+/// @param dev the device, whose PCI identifier is set.
+/// @return 0 on success, 1 on failure.
+static int virtio_blk_probe(virtio_blk_t *dev)
+{
+    uint32_t bar0;
+    uint16_t command, device_id;
+    spinlock_init(&dev->lock);
+    // Set the device name and path.
+    sprintf(dev->name, "vd%c", virtio_blk_drive_char);
+    sprintf(dev->path, "/dev/vd%c", virtio_blk_drive_char);
+    if (pci_read_16(dev->pci, PCI_DEVICE_ID, &device_id) || pci_read_32(dev->pci, PCI_BASE_ADDRESS_0, &bar0) ||
+        pci_read_16(dev->pci, PCI_COMMAND, &command)) {
+        pr_err("[%s] Failed to read the configuration of the device.\n", dev->name);
+        return 1;
+    }
+    // Enable I/O and memory space access, and bus mastering.
+    if (pci_write_16(dev->pci, PCI_COMMAND, command | 0x07)) {
+        pr_err("[%s] Failed to enable bus mastering.\n", dev->name);
+        return 1;
+    }
+    // Prefer the modern interface, the legacy one lives in the I/O ports of BAR0.
+    dev->modern = !virtio_blk_find_modern(dev);
+    if (!dev->modern) {
+        if ((device_id != VIRTIO_PCI_DEVICE_BLK) || !(bar0 & 0x1)) {
+            pr_err("[%s] The device has no usable interface.\n", dev->name);
+            return 1;
+        }
+        dev->iobase = bar0 & ~0x3U;
+    }
+    // Reset the device, then tell it that we have found it, and can drive it.
+    virtio_blk_set_status(dev, 0);
+    while (virtio_blk_get_status(dev)) {
+        pause();
+    }
+    virtio_blk_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_blk_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    if (dev->modern ? virtio_blk_setup_modern(dev) : virtio_blk_setup_legacy(dev)) {
+        pr_err("[%s] Failed to set up the device.\n", dev->name);
+        return 1;
+    }
+    // The capacity is the first field of the configuration, in sectors.
+    dev->sectors = ((uint64_t)virtio_blk_config_read_32(dev, 4) << 32U) | virtio_blk_config_read_32(dev, 0);
+    virtio_blk_set_status(dev, virtio_blk_get_status(dev) | VIRTIO_STATUS_DRIVER_OK);
+    if (!dev->sectors) {
+        pr_err("[%s] The device is empty.\n", dev->name);
+        return 1;
+    }
+    // Create the filesystem entry for the device.
+    dev->fs_root = virtio_blk_device_create(dev);
+    if (!dev->fs_root) {
+        pr_alert("Failed to create virtio block device!\n");
+        return 1;
+    }
+    if (!vfs_register_superblock(dev->fs_root->name, dev->path, &virtio_blk_file_system_type, dev->fs_root)) {
+        pr_alert("Failed to mount virtio block device!\n");
+        vfs_dealloc_file(dev->fs_root);
+        dev->fs_root = NULL;
+        return 1;
+    }
+    // Initialize the request queue of the device, which can keep all the
+    // slots busy.
+    if (blk_queue_init(&dev->queue, dev->fs_root, dev, virtio_blk_request_fn, VIRTIO_BLK_BOUNCE_SECTORS) < 0) {
+        pr_warning("[%s] Failed to initialize the request queue.\n", dev->name);
+    } else if ((dev->num_slots > 1) && (blk_queue_set_depth(&dev->queue, dev->num_slots, virtio_blk_sync_fn) < 0)) {
+        pr_warning("[%s] Failed to set the depth of the request queue.\n", dev->name);
+    }
+    // Increment the drive letter.
+    ++virtio_blk_drive_char;
+    pr_notice(
+        "Initialized %s (%llu sectors, %s%s, queue size %u, queue depth %u).\n", dev->name, dev->sectors,
+        dev->modern ? "modern" : "legacy", dev->read_only ? ", read-only" : "", dev->queue_size, dev->num_slots);
+    return 0;
+}
+
+// == IRQ HANDLER =============================================================
+
+/// @brief Handles the IRQ of the devices, which can share the line.
+/// @param f The interrupt stack frame.
+static void virtio_blk_irq_handler(pt_regs_t *f)
+{
+    for (uint32_t i = 0; i < virtio_blk_count; ++i) {
+        // Reading the status acknowledges the interrupt.
+        if (virtio_blk_read_isr(&virtio_blk_devices[i]) & 0x1) {
+            virtio_blk_complete(&virtio_blk_devices[i]);
+        }
+    }
+}
+
+// == PCI FUNCTIONS ===========================================================
+
+/// The virtio block devices, legacy and modern, whatever their class.
+static const pci_device_id_t virtio_blk_pci_ids[] = {
+    {VIRTIO_PCI_VENDOR_ID, VIRTIO_PCI_DEVICE_BLK, PCI_ANY_ID},
+    {VIRTIO_PCI_VENDOR_ID, VIRTIO_PCI_DEVICE_BLK_V1, PCI_ANY_ID},
+    {0, 0, 0},
+};
+
+// == INITIALIZE/FINALIZE VIRTIO BLOCK ========================================
+
+int virtio_blk_initialize(void)
+{
+    // Search for the devices.
+    const pci_dev_t *pci = NULL;
+    for (uint32_t i = 0; i < VIRTIO_BLK_MAX_DEVICES; ++i) {
+        if ((pci = pci_find_device(virtio_blk_pci_ids, pci)) == NULL) {
+            break;
+        }
+        virtio_blk_pci[i] = pci->device;
+        pci_dump_device_data(pci->device, pci->vendor_id, pci->device_id);
+    }
+    if (virtio_blk_pci[0] == 0) {
+        pr_notice("No virtio block device found.\n");
+        return 0;
+    }
+
+    // Register the filesystem.
+    vfs_register_filesystem(&virtio_blk_file_system_type);
+
+    // Set up the devices, interrupts are still masked, so we poll.
+    for (uint32_t i = 0; (i < VIRTIO_BLK_MAX_DEVICES) && virtio_blk_pci[i]; ++i) {
+        virtio_blk_t *dev = &virtio_blk_devices[virtio_blk_count];
+        memset(dev, 0, sizeof(virtio_blk_t));
+        dev->pci = virtio_blk_pci[i];
+        if (virtio_blk_probe(dev)) {
+            // Leave the device alone.
+            if (dev->modern || dev->iobase) {
+                virtio_blk_set_status(dev, 0);
+            }
+            continue;
+        }
+        ++virtio_blk_count;
+        // Install the IRQ handler, once for each line. The devices only have
+        // MSI-X, so they interrupt through their legacy line.
+        uint8_t irq;
+        if (pci_read_8(dev->pci, PCI_INTERRUPT_LINE, &irq) || (irq >= 16)) {
+            pr_warning("[%s] The device has no IRQ line, falling back to polling.\n", dev->name);
+        } else if (!(virtio_blk_irqs & (1U << irq))) {
+            irq_install_handler(irq, virtio_blk_irq_handler, "virtio-blk");
+            irq_unmask(irq);
+            virtio_blk_irqs |= (1U << irq);
+        }
+    }
+    return 0;
+}
+
+int virtio_blk_finalize(void) { return 0; }
+
+/// @}
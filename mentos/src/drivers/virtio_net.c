@@ -0,0 +1,631 @@
+/// @file virtio_net.c
+/// @brief Driver for the virtio network devices.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup virtio_net
+/// @{
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[VIONET]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "drivers/virtio_net.h"
+
+#include "descriptor_tables/isr.h"
+#include "devices/pci.h"
+#include "drivers/virtio.h"
+#include "errno.h"
+#include "hardware/timer.h"
+#include "io/port_io.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page.h"
+#include "mem/mm/vmem.h"
+#include "net/net.h"
+#include "stdbool.h"
+#include "string.h"
+#include "sys/initcall.h"
+#include "system/softirq.h"
+
+#define VIRTIO_PCI_DEVICE_NET      0x1000 ///< A transitional network device (legacy and modern).
+#define VIRTIO_PCI_DEVICE_NET_V1   0x1041 ///< A modern-only network device.
+#define VIRTIO_NET_RX_QUEUE        0      ///< The index of the receive queue.
+#define VIRTIO_NET_TX_QUEUE        1      ///< The index of the transmit queue.
+#define VIRTIO_NET_MAX_QUEUE_SIZE  256    ///< Size of the virtqueues, when the device lets us choose.
+#define VIRTIO_NET_RX_BUFFERS      64     ///< Buffers posted on the receive queue.
+#define VIRTIO_NET_TX_SLOTS        32     ///< Frames in flight on the transmit queue.
+#define VIRTIO_NET_SLOT_DESCS      2      ///< Descriptors of a frame (header, data).
+#define VIRTIO_NET_HDR_LEGACY      10     ///< The size of the header, for the legacy interface.
+#define VIRTIO_NET_HDR_MODERN      12     ///< The size of the header, for the modern interface.
+#define VIRTIO_NET_MMIO_MAX_LENGTH 0x1000 ///< Maximum size of a region of the modern interface we map.
+
+#define VIRTIO_NET_F_MAC (1U << 5) ///< The device has an address (first word of the features).
+
+/// @brief The header in front of each frame (the legacy interface has no num_buffers).
+typedef struct virtio_net_hdr {
+    uint8_t flags;        ///< Flags, we ask for no offload.
+    uint8_t gso_type;     ///< The segmentation offload, none.
+    uint16_t hdr_len;     ///< The size of the headers, for the offloads.
+    uint16_t gso_size;    ///< The size of the segments, for the offloads.
+    uint16_t csum_start;  ///< Where the checksum starts, for the offloads.
+    uint16_t csum_offset; ///< Where the checksum is stored, for the offloads.
+    uint16_t num_buffers; ///< The buffers of a merged frame, modern interface only.
+} __attribute__((packed)) virtio_net_hdr_t;
+
+/// @brief A virtqueue of the device.
+typedef struct virtio_net_queue {
+    /// The size of the virtqueue.
+    uint16_t size;
+    /// The descriptors of the virtqueue.
+    virtq_desc_t *desc;
+    /// The available ring of the virtqueue.
+    virtq_avail_t *avail;
+    /// The used ring of the virtqueue.
+    virtq_used_t *used;
+    /// The next entry of the used ring we have to process.
+    uint16_t last_used;
+    /// The notification register of the queue, for the modern interface.
+    volatile uint16_t *notify;
+    /// Number of usable slots, each one owns a chain of VIRTIO_NET_SLOT_DESCS descriptors.
+    uint32_t num_slots;
+    /// The buffer of each slot, NULL if the slot is free.
+    net_buf_t *bufs[VIRTIO_NET_RX_BUFFERS];
+} virtio_net_queue_t;
+
+/// @brief A virtio network device.
+typedef struct virtio_net {
+    /// The PCI identifier of the device.
+    uint32_t pci;
+    /// If the device is driven through the modern interface.
+    bool_t modern;
+    /// The I/O ports of the legacy interface.
+    uint16_t iobase;
+    /// The common configuration of the modern interface.
+    virtio_pci_common_cfg_t *common;
+    /// The notification region, for the modern interface.
+    volatile uint8_t *notify;
+    /// The notify offset multiplier, for the modern interface.
+    uint32_t notify_multiplier;
+    /// The interrupt status, for the modern interface.
+    volatile uint8_t *isr;
+    /// The device specific configuration, for the modern interface.
+    volatile uint8_t *config;
+    /// The size of the header in front of each frame.
+    size_t hdr_len;
+    /// The receive queue.
+    virtio_net_queue_t rx;
+    /// The transmit queue.
+    virtio_net_queue_t tx;
+    /// The headers of the frames we transmit, one for each slot, never changed.
+    virtio_net_hdr_t *tx_hdrs;
+    /// The physical address of the headers.
+    uintptr_t tx_hdrs_phys;
+    /// Defers the work of the IRQ.
+    tasklet_t tasklet;
+    /// The device of the network stack.
+    netdev_t netdev;
+} virtio_net_t;
+
+/// The device we drive.
+static virtio_net_t virtio_net;
+
+// == SUPPORT FUNCTIONS =======================================================
+
+/// @brief Allocates physically contiguous low memory for the device.
+/// @param size the size of the memory area.
+/// @param physical the physical address of the memory area.
+/// @return the logical address of the memory area, or 0 on failure.
+static inline uintptr_t virtio_net_dma_alloc(size_t size, uintptr_t *physical)
+{
+    uint32_t order = find_nearest_order_greater(0, size);
+    page_t *page   = alloc_pages(GFP_KERNEL, order);
+    if (!page) {
+        pr_crit("Failed to allocate pages for DMA memory (order = %d).\n", order);
+        return 0;
+    }
+    *physical                = get_physical_address_from_page(page);
+    uintptr_t lowmem_address = get_virtual_address_from_page(page);
+    if (!*physical || !lowmem_address) {
+        pr_crit("Failed to retrieve the addresses of the DMA memory.\n");
+        free_pages(page);
+        return 0;
+    }
+    memset((void *)lowmem_address, 0, size);
+    return lowmem_address;
+}
+
+/// @brief Reads the status of the device.
+/// @param dev the device.
+/// @return the VIRTIO_STATUS_* bits.
+static inline uint8_t virtio_net_get_status(virtio_net_t *dev)
+{
+    return dev->modern ? dev->common->device_status : inportb(dev->iobase + VIRTIO_PCI_STATUS);
+}
+
+/// @brief Writes the status of the device, writing 0 resets it.
+/// @param dev the device.
+/// @param status the VIRTIO_STATUS_* bits.
+static inline void virtio_net_set_status(virtio_net_t *dev, uint8_t status)
+{
+    if (dev->modern) {
+        dev->common->device_status = status;
+    } else {
+        outportb(dev->iobase + VIRTIO_PCI_STATUS, status);
+    }
+}
+
+/// @brief Reads, and clears, the interrupt status of the device.
+/// @param dev the device.
+/// @return the interrupt status, bit 0 is set when a queue has been used.
+static inline uint8_t virtio_net_read_isr(virtio_net_t *dev)
+{
+    return dev->modern ? *dev->isr : inportb(dev->iobase + VIRTIO_PCI_ISR);
+}
+
+/// @brief Reads a byte from the device specific configuration.
+/// @param dev the device.
+/// @param offset the offset inside the configuration.
+/// @return the value.
+static inline uint8_t virtio_net_config_read_8(virtio_net_t *dev, uint32_t offset)
+{
+    return dev->modern ? dev->config[offset] : inportb(dev->iobase + VIRTIO_PCI_CONFIG + offset);
+}
+
+/// @brief Tells the device that there are new chains in the available ring of a queue.
+/// @param dev the device.
+/// @param queue the queue.
+/// @param index the index of the queue.
+static inline void virtio_net_notify(virtio_net_t *dev, virtio_net_queue_t *queue, uint16_t index)
+{
+    // The device must see the index before the notification.
+    __asm__ __volatile__("" ::: "memory");
+    if (dev->modern) {
+        *queue->notify = index;
+    } else {
+        outports(dev->iobase + VIRTIO_PCI_QUEUE_NOTIFY, index);
+    }
+}
+
+/// @brief Places the chain of a slot inside the available ring.
+/// @param queue the queue.
+/// @param slot the slot.
+/// @param hdr the physical address of the header.
+/// @param hdr_len the size of the header.
+/// @param data the physical address of the frame.
+/// @param len the size of the frame, or of the room for it.
+/// @param flags VIRTQ_DESC_F_WRITE if the device writes the buffers.
+static inline void virtio_net_post(
+    virtio_net_queue_t *queue,
+    uint32_t slot,
+    uintptr_t hdr,
+    size_t hdr_len,
+    uintptr_t data,
+    size_t len,
+    uint16_t flags)
+{
+    uint16_t head      = slot * VIRTIO_NET_SLOT_DESCS;
+    virtq_desc_t *desc = &queue->desc[head];
+    desc[0].addr       = hdr;
+    desc[0].len        = hdr_len;
+    desc[0].flags      = flags | VIRTQ_DESC_F_NEXT;
+    desc[0].next       = head + 1;
+    desc[1].addr       = data;
+    desc[1].len        = len;
+    desc[1].flags      = flags;
+    desc[1].next       = 0;
+    // The chain is complete, make it available.
+    queue->avail->ring[queue->avail->idx % queue->size] = head;
+    // The device must see the entry before the index.
+    __asm__ __volatile__("" ::: "memory");
+    ++queue->avail->idx;
+}
+
+/// @brief Posts a buffer on the receive queue, the device writes the header
+/// right in front of the frame, inside the headroom of the buffer.
+/// @param dev the device.
+/// @param slot the slot.
+/// @param buf the buffer.
+static inline void virtio_net_post_rx(virtio_net_t *dev, uint32_t slot, net_buf_t *buf)
+{
+    buf->data          = net_buf_room(buf) + NET_HEADROOM;
+    buf->len           = 0;
+    dev->rx.bufs[slot] = buf;
+    virtio_net_post(
+        &dev->rx, slot, net_buf_phys(buf, buf->data - dev->hdr_len), dev->hdr_len, net_buf_phys(buf, buf->data),
+        NET_BUF_SIZE - NET_HEADROOM, VIRTQ_DESC_F_WRITE);
+}
+
+// == RECEIVE AND TRANSMIT ====================================================
+
+/// @brief Frees the buffers the device has transmitted.
+/// @param dev the device.
+static void virtio_net_tx_complete(virtio_net_t *dev)
+{
+    while (dev->tx.last_used != dev->tx.used->idx) {
+        // Read the entry only after its index.
+        __asm__ __volatile__("" ::: "memory");
+        uint32_t slot = dev->tx.used->ring[dev->tx.last_used % dev->tx.size].id / VIRTIO_NET_SLOT_DESCS;
+        ++dev->tx.last_used;
+        if ((slot < dev->tx.num_slots) && dev->tx.bufs[slot]) {
+            net_buf_free(dev->tx.bufs[slot]);
+            dev->tx.bufs[slot] = NULL;
+        }
+    }
+}
+
+/// @brief Hands the frames the device has received to the network stack, and
+/// fills their slots with fresh buffers.
+/// @param dev the device.
+static void virtio_net_rx_complete(virtio_net_t *dev)
+{
+    bool_t posted = false;
+    while (dev->rx.last_used != dev->rx.used->idx) {
+        // Read the entry only after its index.
+        __asm__ __volatile__("" ::: "memory");
+        virtq_used_elem_t *elem = (virtq_used_elem_t *)&dev->rx.used->ring[dev->rx.last_used % dev->rx.size];
+        uint32_t slot           = elem->id / VIRTIO_NET_SLOT_DESCS;
+        uint32_t len            = elem->len;
+        ++dev->rx.last_used;
+        if ((slot >= dev->rx.num_slots) || !dev->rx.bufs[slot]) {
+            continue;
+        }
+        net_buf_t *buf   = dev->rx.bufs[slot];
+        net_buf_t *fresh = NULL;
+        // Without a fresh buffer the frame is dropped, and its buffer posted again.
+        if ((len >= dev->hdr_len + ETH_HLEN) && (fresh = net_buf_alloc())) {
+            buf->len = len - dev->hdr_len;
+            buf->dev = &dev->netdev;
+        } else {
+            fresh = buf;
+            buf   = NULL;
+        }
+        virtio_net_post_rx(dev, slot, fresh);
+        posted = true;
+        if (buf) {
+            net_receive(&dev->netdev, buf);
+        }
+    }
+    if (posted) {
+        virtio_net_notify(dev, &dev->rx, VIRTIO_NET_RX_QUEUE);
+    }
+}
+
+/// @brief Transmits a frame.
+/// @param netdev the device of the network stack.
+/// @param buf the buffer, whose data starts at the Ethernet header.
+/// @return 0 on success, -ENOBUFS if the transmit queue is full (the frame is dropped).
+static int virtio_net_xmit(netdev_t *netdev, net_buf_t *buf)
+{
+    virtio_net_t *dev = (virtio_net_t *)netdev->priv;
+    uint8_t flags     = irq_disable();
+    virtio_net_tx_complete(dev);
+    for (uint32_t slot = 0; slot < dev->tx.num_slots; ++slot) {
+        if (!dev->tx.bufs[slot]) {
+            dev->tx.bufs[slot] = buf;
+            virtio_net_post(
+                &dev->tx, slot, dev->tx_hdrs_phys + slot * sizeof(virtio_net_hdr_t), dev->hdr_len,
+                net_buf_phys(buf, buf->data), buf->len, 0);
+            virtio_net_notify(dev, &dev->tx, VIRTIO_NET_TX_QUEUE);
+            irq_enable(flags);
+            return 0;
+        }
+    }
+    irq_enable(flags);
+    net_buf_free(buf);
+    return -ENOBUFS;
+}
+
+/// @brief Handles the work of the IRQ, with the interrupts enabled.
+/// @param data the device.
+static void virtio_net_tasklet(unsigned long data)
+{
+    virtio_net_t *dev = (virtio_net_t *)data;
+    uint8_t flags     = irq_disable();
+    virtio_net_tx_complete(dev);
+    virtio_net_rx_complete(dev);
+    irq_enable(flags);
+}
+
+/// @brief Handles the IRQ of the device, which can share the line.
+/// @param f The interrupt stack frame.
+static void virtio_net_irq_handler(pt_regs_t *f)
+{
+    // Reading the status acknowledges the interrupt.
+    if (virtio_net_read_isr(&virtio_net) & 0x1) {
+        tasklet_schedule(&virtio_net.tasklet);
+    }
+}
+
+// == DEVICE INITIALIZATION ===================================================
+
+/// @brief Maps the region described by a capability of the modern interface.
+/// @param dev the device.
+/// @param cap the offset of the capability.
+/// @return the logical address of the region, NULL if it cannot be mapped.
+static volatile uint8_t *virtio_net_map_cap(virtio_net_t *dev, uint8_t cap)
+{
+    uint32_t offset, length, address, high = 0;
+    uint8_t bar;
+    if (pci_read_8(dev->pci, cap + VIRTIO_PCI_CAP_BAR, &bar) ||
+        pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_OFFSET, &offset) ||
+        pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_LENGTH, &length) || (bar > 5) ||
+        pci_read_32(dev->pci, PCI_BASE_ADDRESS_0 + bar * 4, &address)) {
+        return NULL;
+    }
+    // We only map memory regions, below 4 GiB.
+    if (address & 0x1) {
+        return NULL;
+    }
+    if ((((address >> 1U) & 0x3) == 0x2) &&
+        ((bar == 5) || pci_read_32(dev->pci, PCI_BASE_ADDRESS_0 + (bar + 1) * 4, &high) || high)) {
+        return NULL;
+    }
+    return (volatile uint8_t *)vmem_map_io((address & ~0xFU) + offset, min(length, VIRTIO_NET_MMIO_MAX_LENGTH));
+}
+
+/// @brief Finds the regions of the modern interface.
+/// @param dev the device.
+/// @return 0 if the device can be driven through the modern interface, 1 otherwise.
+static int virtio_net_find_modern(virtio_net_t *dev)
+{
+    uint8_t cap = 0, type;
+    while (!pci_find_next_capability(dev->pci, PCI_CAP_ID_VNDR, cap, &cap)) {
+        if (pci_read_8(dev->pci, cap + VIRTIO_PCI_CAP_CFG_TYPE, &type)) {
+            return 1;
+        }
+        // Take the first capability of each type, the preferred one.
+        if ((type == VIRTIO_PCI_CAP_COMMON_CFG) && !dev->common) {
+            dev->common = (virtio_pci_common_cfg_t *)virtio_net_map_cap(dev, cap);
+        } else if ((type == VIRTIO_PCI_CAP_NOTIFY_CFG) && !dev->notify) {
+            if (!pci_read_32(dev->pci, cap + VIRTIO_PCI_CAP_NOTIFY_MULT, &dev->notify_multiplier)) {
+                dev->notify = virtio_net_map_cap(dev, cap);
+            }
+        } else if ((type == VIRTIO_PCI_CAP_ISR_CFG) && !dev->isr) {
+            dev->isr = virtio_net_map_cap(dev, cap);
+        } else if ((type == VIRTIO_PCI_CAP_DEVICE_CFG) && !dev->config) {
+            dev->config = virtio_net_map_cap(dev, cap);
+        }
+    }
+    return !dev->common || !dev->notify || !dev->isr || !dev->config;
+}
+
+/// @brief Allocates a virtqueue.
+/// @param queue the queue.
+/// @param size the size of the virtqueue.
+/// @param slots the maximum number of slots.
+/// @param physical where we store the physical address of the virtqueue.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_alloc_queue(virtio_net_queue_t *queue, uint16_t size, uint32_t slots, uintptr_t *physical)
+{
+    uintptr_t base = virtio_net_dma_alloc(virtq_total_size(size), physical);
+    if (!base) {
+        return 1;
+    }
+    queue->size      = size;
+    queue->desc      = (virtq_desc_t *)base;
+    queue->avail     = (virtq_avail_t *)(base + size * sizeof(virtq_desc_t));
+    queue->used      = (virtq_used_t *)(base + virtq_used_offset(size));
+    queue->last_used = 0;
+    queue->num_slots = min(slots, (uint32_t)size / VIRTIO_NET_SLOT_DESCS);
+    return queue->num_slots == 0;
+}
+
+/// @brief Sets up a virtqueue through the modern interface.
+/// @param dev the device.
+/// @param queue the queue.
+/// @param index the index of the queue.
+/// @param slots the maximum number of slots.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_setup_queue_modern(virtio_net_t *dev, virtio_net_queue_t *queue, uint16_t index, uint32_t slots)
+{
+    uintptr_t physical;
+    dev->common->queue_select = index;
+    uint16_t size             = dev->common->queue_size;
+    if (!size || virtio_net_alloc_queue(queue, min(size, VIRTIO_NET_MAX_QUEUE_SIZE), slots, &physical)) {
+        return 1;
+    }
+    // The notification register depends on the queue.
+    uint32_t offset = dev->common->queue_notify_off * dev->notify_multiplier;
+    if (offset + sizeof(uint16_t) > VIRTIO_NET_MMIO_MAX_LENGTH) {
+        return 1;
+    }
+    queue->notify                = (volatile uint16_t *)(dev->notify + offset);
+    dev->common->queue_size      = queue->size;
+    dev->common->queue_desc_lo   = physical;
+    dev->common->queue_desc_hi   = 0;
+    dev->common->queue_driver_lo = physical + ((uintptr_t)queue->avail - (uintptr_t)queue->desc);
+    dev->common->queue_driver_hi = 0;
+    dev->common->queue_device_lo = physical + ((uintptr_t)queue->used - (uintptr_t)queue->desc);
+    dev->common->queue_device_hi = 0;
+    dev->common->queue_enable    = 1;
+    return 0;
+}
+
+/// @brief Sets up the device through the modern interface.
+/// @param dev the device.
+/// @param features where we store the features we accepted.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_setup_modern(virtio_net_t *dev, uint32_t *features)
+{
+    // Read the features, the device must comply with virtio 1.0.
+    dev->common->device_feature_select = 0;
+    *features                          = dev->common->device_feature & VIRTIO_NET_F_MAC;
+    dev->common->device_feature_select = 1;
+    if (!(dev->common->device_feature & VIRTIO_F_VERSION_1)) {
+        pr_err("The device does not support virtio 1.0.\n");
+        return 1;
+    }
+    dev->common->driver_feature_select = 0;
+    dev->common->driver_feature        = *features;
+    dev->common->driver_feature_select = 1;
+    dev->common->driver_feature        = VIRTIO_F_VERSION_1;
+    virtio_net_set_status(dev, virtio_net_get_status(dev) | VIRTIO_STATUS_FEATURES_OK);
+    if (!(virtio_net_get_status(dev) & VIRTIO_STATUS_FEATURES_OK)) {
+        pr_err("The device did not accept the features.\n");
+        return 1;
+    }
+    dev->hdr_len = VIRTIO_NET_HDR_MODERN;
+    return virtio_net_setup_queue_modern(dev, &dev->rx, VIRTIO_NET_RX_QUEUE, VIRTIO_NET_RX_BUFFERS) ||
+           virtio_net_setup_queue_modern(dev, &dev->tx, VIRTIO_NET_TX_QUEUE, VIRTIO_NET_TX_SLOTS);
+}
+
+/// @brief Sets up a virtqueue through the legacy interface.
+/// @param dev the device.
+/// @param queue the queue.
+/// @param index the index of the queue.
+/// @param slots the maximum number of slots.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_setup_queue_legacy(virtio_net_t *dev, virtio_net_queue_t *queue, uint16_t index, uint32_t slots)
+{
+    uintptr_t physical;
+    // The size is chosen by the device.
+    outports(dev->iobase + VIRTIO_PCI_QUEUE_SEL, index);
+    uint16_t size = inports(dev->iobase + VIRTIO_PCI_QUEUE_NUM);
+    if (!size || virtio_net_alloc_queue(queue, size, slots, &physical)) {
+        return 1;
+    }
+    outportl(dev->iobase + VIRTIO_PCI_QUEUE_PFN, physical / PAGE_SIZE);
+    return 0;
+}
+
+/// @brief Sets up the device through the legacy interface.
+/// @param dev the device.
+/// @param features where we store the features we accepted.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_setup_legacy(virtio_net_t *dev, uint32_t *features)
+{
+    *features = inportl(dev->iobase + VIRTIO_PCI_HOST_FEATURES) & VIRTIO_NET_F_MAC;
+    outportl(dev->iobase + VIRTIO_PCI_GUEST_FEATURES, *features);
+    dev->hdr_len = VIRTIO_NET_HDR_LEGACY;
+    return virtio_net_setup_queue_legacy(dev, &dev->rx, VIRTIO_NET_RX_QUEUE, VIRTIO_NET_RX_BUFFERS) ||
+           virtio_net_setup_queue_legacy(dev, &dev->tx, VIRTIO_NET_TX_QUEUE, VIRTIO_NET_TX_SLOTS);
+}
+
+/// @brief Detects and sets up the device.
+/// @param dev the device, whose PCI identifier is set.
+/// @return 0 on success, 1 on failure.
+static int virtio_net_probe(virtio_net_t *dev)
+{
+    uint32_t bar0, features;
+    uint16_t command, device_id;
+    if (pci_read_16(dev->pci, PCI_DEVICE_ID, &device_id) || pci_read_32(dev->pci, PCI_BASE_ADDRESS_0, &bar0) ||
+        pci_read_16(dev->pci, PCI_COMMAND, &command)) {
+        pr_err("Failed to read the configuration of the device.\n");
+        return 1;
+    }
+    // Enable I/O and memory space access, and bus mastering.
+    if (pci_write_16(dev->pci, PCI_COMMAND, command | 0x07)) {
+        pr_err("Failed to enable bus mastering.\n");
+        return 1;
+    }
+    // Prefer the modern interface, the legacy one lives in the I/O ports of BAR0.
+    dev->modern = !virtio_net_find_modern(dev);
+    if (!dev->modern) {
+        if ((device_id != VIRTIO_PCI_DEVICE_NET) || !(bar0 & 0x1)) {
+            pr_err("The device has no usable interface.\n");
+            return 1;
+        }
+        dev->iobase = bar0 & ~0x3U;
+    }
+    // Reset the device, then tell it that we have found it, and can drive it.
+    virtio_net_set_status(dev, 0);
+    while (virtio_net_get_status(dev)) {
+        pause();
+    }
+    virtio_net_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_net_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+    if (dev->modern ? virtio_net_setup_modern(dev, &features) : virtio_net_setup_legacy(dev, &features)) {
+        pr_err("Failed to set up the device.\n");
+        return 1;
+    }
+    // The headers of the frames we send stay zero: no offload, a single buffer.
+    dev->tx_hdrs = (virtio_net_hdr_t *)virtio_net_dma_alloc(
+        VIRTIO_NET_TX_SLOTS * sizeof(virtio_net_hdr_t), &dev->tx_hdrs_phys);
+    if (!dev->tx_hdrs) {
+        return 1;
+    }
+    // The address is the first field of the configuration, without it we
+    // make up a locally administered one.
+    for (uint32_t i = 0; i < ETH_ALEN; ++i) {
+        dev->netdev.mac[i] = (features & VIRTIO_NET_F_MAC) ? virtio_net_config_read_8(dev, i) : 0;
+    }
+    if (!(features & VIRTIO_NET_F_MAC)) {
+        uint32_t seed      = timer_get_ticks() ^ dev->pci;
+        dev->netdev.mac[0] = 0x02;
+        memcpy(&dev->netdev.mac[2], &seed, sizeof(uint32_t));
+    }
+    // Fill the receive queue, the device can use it once we are ready.
+    for (uint32_t slot = 0; slot < dev->rx.num_slots; ++slot) {
+        net_buf_t *buf = net_buf_alloc();
+        if (!buf) {
+            pr_err("Failed to allocate the receive buffers.\n");
+            return 1;
+        }
+        virtio_net_post_rx(dev, slot, buf);
+    }
+    virtio_net_set_status(dev, virtio_net_get_status(dev) | VIRTIO_STATUS_DRIVER_OK);
+    virtio_net_notify(dev, &dev->rx, VIRTIO_NET_RX_QUEUE);
+    pr_notice(
+        "Initialized the device (%s, %u receive buffers, %u transmit slots).\n", dev->modern ? "modern" : "legacy",
+        dev->rx.num_slots, dev->tx.num_slots);
+    return 0;
+}
+
+// == PCI FUNCTIONS ===========================================================
+
+/// The virtio network devices, legacy and modern, whatever their class.
+static const pci_device_id_t virtio_net_pci_ids[] = {
+    {VIRTIO_PCI_VENDOR_ID, VIRTIO_PCI_DEVICE_NET, PCI_ANY_ID},
+    {VIRTIO_PCI_VENDOR_ID, VIRTIO_PCI_DEVICE_NET_V1, PCI_ANY_ID},
+    {0, 0, 0},
+};
+
+// == INITIALIZE/FINALIZE VIRTIO NETWORK ======================================
+
+int virtio_net_initialize(void)
+{
+    virtio_net_t *dev = &virtio_net;
+    memset(dev, 0, sizeof(virtio_net_t));
+    // Search for the device, we only drive the first one.
+    const pci_dev_t *pci = pci_find_device(virtio_net_pci_ids, NULL);
+    if (pci == NULL) {
+        pr_notice("No virtio network device found.\n");
+        return 0;
+    }
+    dev->pci = pci->device;
+    pci_dump_device_data(pci->device, pci->vendor_id, pci->device_id);
+    if (virtio_net_probe(dev)) {
+        // Leave the device alone.
+        if (dev->modern || dev->iobase) {
+            virtio_net_set_status(dev, 0);
+        }
+        return 1;
+    }
+    tasklet_init(&dev->tasklet, virtio_net_tasklet, (unsigned long)dev);
+    dev->netdev.xmit = virtio_net_xmit;
+    dev->netdev.priv = dev;
+    if (net_register_device(&dev->netdev) < 0) {
+        pr_err("Failed to register the device with the network stack.\n");
+        virtio_net_set_status(dev, 0);
+        return 1;
+    }
+    // The device only has MSI-X, so it interrupts through its legacy line.
+    uint8_t irq;
+    if (pci_read_8(dev->pci, PCI_INTERRUPT_LINE, &irq) || (irq >= 16)) {
+        pr_err("The device has no IRQ line.\n");
+        virtio_net_set_status(dev, 0);
+        return 1;
+    }
+    irq_install_handler(irq, virtio_net_irq_handler, "virtio-net");
+    irq_unmask(irq);
+    return 0;
+}
+
+deferred_initcall(virtio_net_initialize, "net_initialize");
+
+int virtio_net_finalize(void) { return 0; }
+
+/// @}
@@ -0,0 +1,581 @@
+/// @file zram.c
+/// @brief Block device keeping its pages compressed in memory.
+/// @details
+/// Every transfer is served at once, under the lock of the device, page by
+/// page. The memory holding the pages is allocated with GFP_NOIO, since the
+/// device is usually written by the swap, while memory is running out: the
+/// allocations can then shrink the caches, but never write to a block device,
+/// which could be this one.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+/// @addtogroup zram
+/// @{
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[ZRAM  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "drivers/zram.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/blkdev.h"
+#include "fs/vfs.h"
+#include "klib/lz4.h"
+#include "klib/spinlock.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/swap.h"
+#include "stdio.h"
+#include "string.h"
+#include "sys/initcall.h"
+#include "system/syscall.h"
+
+#define ZRAM_PAGE_SECTORS   (PAGE_SIZE / BLK_SECTOR_SIZE) ///< The number of sectors of a page.
+#define ZRAM_MAX_PAGES      65536 ///< The largest device, which is also the largest swap area.
+#define ZRAM_MAX_SECTORS    128   ///< Maximum number of sectors of a single request.
+#define ZRAM_CLASS_SIZE     256   ///< The step between the sizes of the classes of the objects.
+#define ZRAM_NUM_CLASSES    12    ///< The number of classes of the objects.
+#define ZRAM_MAX_COMPRESSED (ZRAM_CLASS_SIZE * ZRAM_NUM_CLASSES) ///< Larger pages are stored uncompressed.
+
+#define ZRAM_SLOT_SAME 0x01 ///< The page is filled with the value of the slot.
+#define ZRAM_SLOT_RAW  0x02 ///< The page is stored uncompressed, inside a page of its own.
+
+/// @brief The content of a page of the device.
+typedef struct zram_slot {
+    /// The address of the compressed page, or of the uncompressed one, or
+    /// the word repeated over the page for ZRAM_SLOT_SAME, 0 if the page has
+    /// never been written.
+    uintptr_t handle;
+    /// The size of the data, PAGE_SIZE for ZRAM_SLOT_RAW.
+    uint16_t size;
+    /// The class of the object holding the compressed page.
+    uint8_t class;
+    /// The ZRAM_SLOT_* flags.
+    uint8_t flags;
+} zram_slot_t;
+
+/// @brief The compressed RAM disk.
+typedef struct zram {
+    /// Device name.
+    char name[NAME_MAX];
+    /// Device path.
+    char path[PATH_MAX];
+    /// The number of pages of the device.
+    uint32_t npages;
+    /// The slots of the pages.
+    zram_slot_t *slots;
+    /// The caches of the objects, one for each class.
+    kmem_cache_t *classes[ZRAM_NUM_CLASSES];
+    /// The names of the caches.
+    char class_names[ZRAM_NUM_CLASSES][16];
+    /// The hash table of the compressor.
+    uint16_t table[LZ4_HASH_SIZE];
+    /// The compressed page, before it is copied inside its object.
+    uint8_t buffer[ZRAM_MAX_COMPRESSED];
+    /// The page which is only partially transferred.
+    uint8_t page[PAGE_SIZE];
+    /// The number of pages which have been written.
+    uint32_t stored_pages;
+    /// The total size of their data.
+    uint32_t compr_size;
+    /// The number of pages filled with a single word.
+    uint32_t same_pages;
+    /// The number of pages stored uncompressed.
+    uint32_t huge_pages;
+    /// The number of pages which could not be stored, for lack of memory.
+    uint32_t failed_writes;
+    /// Lock for the device.
+    spinlock_t lock;
+    /// The filesystem root of the device.
+    vfs_file_t *fs_root;
+    /// The request queue of the device.
+    request_queue_t queue;
+} zram_t;
+
+/// The device.
+static zram_t zram;
+
+// == SLOTS ===================================================================
+
+/// @brief Frees the memory of a page, which then reads as zeroes.
+/// @param dev the device.
+/// @param index the index of the page.
+static void __zram_free_slot(zram_t *dev, uint32_t index)
+{
+    zram_slot_t *slot = &dev->slots[index];
+    if (slot->flags & ZRAM_SLOT_SAME) {
+        --dev->same_pages;
+    } else if (slot->handle == 0) {
+        return;
+    } else if (slot->flags & ZRAM_SLOT_RAW) {
+        free_pages_lowmem(slot->handle);
+        --dev->huge_pages;
+    } else {
+        kmem_cache_free((void *)slot->handle);
+    }
+    dev->compr_size -= slot->size;
+    --dev->stored_pages;
+    memset(slot, 0, sizeof(zram_slot_t));
+}
+
+/// @brief Checks if a page is filled with a single repeated word.
+/// @param data the page.
+/// @param value where the word is stored.
+/// @return 1 if it is, 0 otherwise.
+static inline int __zram_same_filled(const uint8_t *data, uintptr_t *value)
+{
+    const uint32_t *words = (const uint32_t *)data;
+    if ((uintptr_t)data & (sizeof(uint32_t) - 1)) {
+        return 0;
+    }
+    for (uint32_t i = 1; i < PAGE_SIZE / sizeof(uint32_t); ++i) {
+        if (words[i] != words[0]) {
+            return 0;
+        }
+    }
+    *value = words[0];
+    return 1;
+}
+
+/// @brief Stores a page, replacing its previous content.
+/// @param dev the device.
+/// @param index the index of the page.
+/// @param data the content of the page.
+/// @return 0 on success, -ENOMEM if there is no memory to store it, in
+///         which case the previous content is left untouched.
+static int __zram_write_page(zram_t *dev, uint32_t index, const uint8_t *data)
+{
+    zram_slot_t slot;
+    memset(&slot, 0, sizeof(zram_slot_t));
+    if (__zram_same_filled(data, &slot.handle)) {
+        slot.flags = ZRAM_SLOT_SAME;
+    } else {
+        size_t size = lz4_compress(data, PAGE_SIZE, dev->buffer, ZRAM_MAX_COMPRESSED, dev->table);
+        if (size) {
+            slot.class  = (size - 1) / ZRAM_CLASS_SIZE;
+            slot.handle = (uintptr_t)kmem_cache_alloc(dev->classes[slot.class], GFP_NOIO);
+            data        = dev->buffer;
+        } else {
+            size        = PAGE_SIZE;
+            slot.flags  = ZRAM_SLOT_RAW;
+            slot.handle = alloc_pages_lowmem(GFP_NOIO, 0);
+        }
+        if (slot.handle == 0) {
+            ++dev->failed_writes;
+            return -ENOMEM;
+        }
+        slot.size = size;
+        memcpy((void *)slot.handle, data, size);
+    }
+    __zram_free_slot(dev, index);
+    dev->slots[index] = slot;
+    dev->compr_size += slot.size;
+    dev->same_pages += (slot.flags & ZRAM_SLOT_SAME) != 0;
+    dev->huge_pages += (slot.flags & ZRAM_SLOT_RAW) != 0;
+    ++dev->stored_pages;
+    return 0;
+}
+
+/// @brief Reads a page.
+/// @param dev the device.
+/// @param index the index of the page.
+/// @param data where the content of the page is stored.
+/// @return 0 on success, -EIO if its compressed data is corrupted.
+static int __zram_read_page(zram_t *dev, uint32_t index, uint8_t *data)
+{
+    zram_slot_t *slot = &dev->slots[index];
+    if (slot->flags & ZRAM_SLOT_SAME) {
+        uint32_t value = slot->handle;
+        for (uint32_t i = 0; i < PAGE_SIZE; i += sizeof(uint32_t)) {
+            memcpy(data + i, &value, sizeof(uint32_t));
+        }
+    } else if (slot->handle == 0) {
+        memset(data, 0, PAGE_SIZE);
+    } else if (slot->flags & ZRAM_SLOT_RAW) {
+        memcpy(data, (const void *)slot->handle, PAGE_SIZE);
+    } else if (lz4_decompress((const uint8_t *)slot->handle, slot->size, data, PAGE_SIZE) != PAGE_SIZE) {
+        pr_err("The page %u is corrupted.\n", index);
+        return -EIO;
+    }
+    return 0;
+}
+
+/// @brief Transfers a range of the device, the pages which are only
+///        partially written are read first. The lock must be held.
+/// @param dev the device.
+/// @param position the offset of the range, in bytes.
+/// @param buffer the buffer we read into, or we write from.
+/// @param size the size of the range.
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return 0 on success, -errno on failure.
+static int __zram_transfer(zram_t *dev, uint64_t position, uint8_t *buffer, size_t size, int write)
+{
+    while (size) {
+        uint32_t index  = position / PAGE_SIZE;
+        uint32_t start  = position % PAGE_SIZE;
+        uint32_t length = min(size, PAGE_SIZE - start);
+        int ret;
+        if (length == PAGE_SIZE) {
+            ret = write ? __zram_write_page(dev, index, buffer) : __zram_read_page(dev, index, buffer);
+        } else if ((ret = __zram_read_page(dev, index, dev->page)) == 0) {
+            if (write) {
+                memcpy(dev->page + start, buffer, length);
+                ret = __zram_write_page(dev, index, dev->page);
+            } else {
+                memcpy(buffer, dev->page + start, length);
+            }
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        position += length;
+        buffer += length;
+        size -= length;
+    }
+    return 0;
+}
+
+// == BLOCK LAYER CALLBACKS ===================================================
+
+/// @brief Serves a request of the block I/O layer, before returning.
+/// @param device the device.
+/// @param request the request.
+/// @return 0 on success, a negative errno on failure.
+static int zram_request_fn(void *device, blk_request_t *request)
+{
+    zram_t *dev = (zram_t *)device;
+    int ret     = 0;
+    if ((request->sector + request->count) > (dev->npages * ZRAM_PAGE_SECTORS)) {
+        return -EINVAL;
+    }
+    spinlock_lock(&dev->lock);
+    list_for_each_decl (it, &request->bios) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        ret        = __zram_transfer(
+            dev, (uint64_t)bio->sector * BLK_SECTOR_SIZE, bio->buffer, bio->count * BLK_SECTOR_SIZE, request->write);
+        if (ret < 0) {
+            break;
+        }
+    }
+    spinlock_unlock(&dev->lock);
+    return ret;
+}
+
+/// @brief Frees the pages entirely covered by the discarded sectors.
+/// @param device the device.
+/// @param sector the first sector.
+/// @param count the number of sectors.
+static void zram_discard_fn(void *device, uint32_t sector, uint32_t count)
+{
+    zram_t *dev    = (zram_t *)device;
+    uint32_t first = (sector + ZRAM_PAGE_SECTORS - 1) / ZRAM_PAGE_SECTORS;
+    uint32_t last  = min((sector + count) / ZRAM_PAGE_SECTORS, dev->npages);
+    spinlock_lock(&dev->lock);
+    for (uint32_t index = first; index < last; ++index) {
+        __zram_free_slot(dev, index);
+    }
+    spinlock_unlock(&dev->lock);
+}
+
+// == VFS CALLBACKS ===========================================================
+
+/// @brief Implements the open function for the device.
+/// @param path the path to the device we want to open.
+/// @param flags we ignore these.
+/// @param mode we currently ignore this.
+/// @return the VFS file associated with the device.
+static vfs_file_t *zram_open(const char *path, int flags, mode_t mode)
+{
+    pr_debug("zram_open(%s, %d, %d)\n", path, flags, mode);
+    if (zram.fs_root && (strcmp(path, zram.path) == 0)) {
+        // Increment reference count for the file.
+        ++zram.fs_root->count;
+        return zram.fs_root;
+    }
+    pr_crit("Device not found for path: %s\n", path);
+    return NULL;
+}
+
+/// @brief Closes the device.
+/// @param file the VFS file associated with the device.
+/// @return 0 on success, -errno on failure.
+static int zram_close(vfs_file_t *file)
+{
+    // Validate the file pointer.
+    if (file == NULL) {
+        pr_err("zram_close: Invalid file pointer (NULL).\n");
+        return -EINVAL;
+    }
+    if (file->device == NULL) {
+        pr_crit("zram_close: Device not set for file `%s`.\n", file->name);
+        return -ENODEV;
+    }
+    // Decrement the reference count for the file.
+    if (--file->count == 0) {
+        // Remove the file from the list of opened files.
+        list_head_remove(&file->siblings);
+        // Free the file from cache.
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Reads from, or writes to, the device.
+/// @param file the VFS file associated with the device.
+/// @param buffer the buffer.
+/// @param offset the offset of the transfer.
+/// @param size the size of the buffer.
+/// @param write if the transfer is a write (1) or a read (0).
+/// @return the number of transferred characters, -errno on failure.
+static ssize_t __zram_rw(vfs_file_t *file, uint8_t *buffer, off_t offset, size_t size, int write)
+{
+    zram_t *dev         = (zram_t *)file->device;
+    uint64_t max_offset = (uint64_t)dev->npages * PAGE_SIZE;
+    // Check the boundaries of the transfer.
+    if ((offset < 0) || ((uint64_t)offset >= max_offset) || (size == 0)) {
+        return 0;
+    }
+    size = min(size, max_offset - offset);
+    // Account the transfer in the statistics of the device.
+    unsigned long start_time = blk_stats_start(&dev->queue);
+    uint32_t sectors         = ((offset + size - 1) / BLK_SECTOR_SIZE) - (offset / BLK_SECTOR_SIZE) + 1;
+    spinlock_lock(&dev->lock);
+    int ret = __zram_transfer(dev, offset, buffer, size, write);
+    spinlock_unlock(&dev->lock);
+    blk_stats_done(&dev->queue, write, sectors, start_time);
+    return (ret < 0) ? ret : (ssize_t)size;
+}
+
+/// @brief Reads from the device.
+/// @param file the VFS file associated with the device.
+/// @param buffer the buffer where we store what we read.
+/// @param offset the offset where we want to read.
+/// @param size the size of the buffer.
+/// @return the number of read characters, -errno on failure.
+static ssize_t zram_read(vfs_file_t *file, char *buffer, off_t offset, size_t size)
+{
+    return __zram_rw(file, (uint8_t *)buffer, offset, size, 0);
+}
+
+/// @brief Writes on the device.
+/// @param file the VFS file associated with the device.
+/// @param buffer the buffer we write.
+/// @param offset the offset where we want to write.
+/// @param size the size of the buffer.
+/// @return the number of written characters, -errno on failure.
+static ssize_t zram_write(vfs_file_t *file, const void *buffer, off_t offset, size_t size)
+{
+    return __zram_rw(file, (uint8_t *)buffer, offset, size, 1);
+}
+
+/// @brief Retrieves information concerning the device.
+/// @param dev the device.
+/// @param stat the stat buffer.
+/// @return 0 on success.
+static int _zram_stat(const zram_t *dev, stat_t *stat)
+{
+    if (dev && dev->fs_root) {
+        stat->st_dev   = 0;
+        stat->st_ino   = 0;
+        stat->st_mode  = dev->fs_root->mask;
+        stat->st_uid   = dev->fs_root->uid;
+        stat->st_gid   = dev->fs_root->gid;
+        stat->st_atime = dev->fs_root->atime;
+        stat->st_mtime = dev->fs_root->mtime;
+        stat->st_ctime = dev->fs_root->ctime;
+        stat->st_size  = dev->fs_root->length;
+    }
+    return 0;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param file the file.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int zram_fstat(vfs_file_t *file, stat_t *stat) { return _zram_stat(file->device, stat); }
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param path the path where the file resides.
+/// @param stat the structure where the information are stored.
+/// @return 0 if success.
+static int zram_stat(const char *path, stat_t *stat)
+{
+    super_block_t *sb = vfs_get_superblock(path);
+    if (sb && sb->root) {
+        return _zram_stat(sb->root->device, stat);
+    }
+    return -1;
+}
+
+// == VFS ENTRY GENERATION ====================================================
+
+/// @brief The mount call-back, the device is registered when it is created.
+/// @param path the path where the filesystem should be mounted.
+/// @param device the device we mount.
+/// @param options the mount options, unused.
+/// @return the VFS file of the filesystem.
+static vfs_file_t *zram_mount_callback(const char *path, const char *device, const char *options)
+{
+    pr_err("mount_callback(%s, %s): zram has no mount callback!\n", path, device);
+    return NULL;
+}
+
+/// Filesystem information.
+static file_system_type_t zram_file_system_type = {
+    .name     = "zram",
+    .fs_flags = 0,
+    .mount    = zram_mount_callback,
+};
+
+/// Filesystem general operations.
+static vfs_sys_operations_t zram_sys_operations = {
+    .mkdir_f   = NULL,
+    .rmdir_f   = NULL,
+    .stat_f    = zram_stat,
+    .creat_f   = NULL,
+    .symlink_f = NULL,
+};
+
+/// Compressed RAM disk file operations.
+static vfs_file_operations_t zram_fs_operations = {
+    .open_f     = zram_open,
+    .unlink_f   = NULL,
+    .close_f    = zram_close,
+    .read_f     = zram_read,
+    .write_f    = zram_write,
+    .lseek_f    = NULL,
+    .stat_f     = zram_fstat,
+    .ioctl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+};
+
+/// @brief Creates a VFS file, starting from the device.
+/// @param dev the device.
+/// @return a pointer to the VFS file on success, NULL on failure.
+static vfs_file_t *zram_device_create(zram_t *dev)
+{
+    // Create the file.
+    vfs_file_t *file = vfs_alloc_file();
+    if (file == NULL) {
+        pr_err("Failed to create the zram device.\n");
+        return NULL;
+    }
+    // Set the device name.
+    memcpy(file->name, dev->name, NAME_MAX);
+    file->uid            = 0;
+    file->gid            = 0;
+    file->mask           = 0x2000 | 0600;
+    file->atime          = sys_time(NULL);
+    file->mtime          = sys_time(NULL);
+    file->ctime          = sys_time(NULL);
+    file->length         = dev->npages * PAGE_SIZE;
+    // Set the device.
+    file->device         = dev;
+    // Re-set the flags.
+    file->flags          = DT_BLK;
+    // Change the operations.
+    file->sys_operations = &zram_sys_operations;
+    file->fs_operations  = &zram_fs_operations;
+    return file;
+}
+
+// == INITIALIZE ==============================================================
+
+/// @brief Writes the header of a swap area on the first page, as mkswap would.
+/// @param dev the device.
+/// @return 0 on success, -errno on failure.
+static int zram_mkswap(zram_t *dev)
+{
+    memset(dev->page, 0, PAGE_SIZE);
+    swap_header_t *header = (swap_header_t *)(dev->page + SWAP_HEADER_OFFSET);
+    header->version       = SWAP_HEADER_VERSION;
+    header->last_page     = dev->npages - 1;
+    header->nr_badpages   = 0;
+    memcpy(dev->page + PAGE_SIZE - strlen(SWAP_SIGNATURE), SWAP_SIGNATURE, strlen(SWAP_SIGNATURE));
+    return __zram_write_page(dev, 0, dev->page);
+}
+
+ssize_t zram_stats_dump(char *buffer, size_t bufsize)
+{
+    if (!zram.fs_root) {
+        return 0;
+    }
+    spinlock_lock(&zram.lock);
+    // The memory used counts the objects of the caches, whether they are in use or not.
+    uint64_t mem_used = (uint64_t)zram.huge_pages * PAGE_SIZE;
+    for (uint32_t i = 0; i < ZRAM_NUM_CLASSES; ++i) {
+        mem_used += zram.classes[i]->total_num * zram.classes[i]->aligned_object_size;
+    }
+    ssize_t written = snprintf(
+        buffer, bufsize, "%8s %llu %u %llu %u %u %u\n", zram.name, (uint64_t)zram.stored_pages * PAGE_SIZE,
+        zram.compr_size, mem_used, zram.same_pages, zram.huge_pages, zram.failed_writes);
+    spinlock_unlock(&zram.lock);
+    return min(written, bufsize);
+}
+
+int zram_initialize(void)
+{
+    zram_t *dev = &zram;
+    // Half of the memory, once compressed, usually takes a fraction of the other half.
+    uint64_t total = (uint64_t)get_zone_total_space(GFP_KERNEL) + get_zone_total_space(GFP_HIGHUSER);
+    dev->npages    = min(total / 2 / PAGE_SIZE, ZRAM_MAX_PAGES);
+    if (dev->npages < 2) {
+        pr_err("There is not enough memory for the device.\n");
+        return 1;
+    }
+    strcpy(dev->name, "zram0");
+    strcpy(dev->path, "/dev/zram0");
+    spinlock_init(&dev->lock);
+    dev->slots = kmalloc(dev->npages * sizeof(zram_slot_t));
+    if (!dev->slots) {
+        pr_err("Failed to allocate the slots of %u pages.\n", dev->npages);
+        return 1;
+    }
+    memset(dev->slots, 0, dev->npages * sizeof(zram_slot_t));
+    // The caches are created beforehand, creating one allocates with GFP_KERNEL.
+    for (uint32_t i = 0; i < ZRAM_NUM_CLASSES; ++i) {
+        snprintf(dev->class_names[i], sizeof(dev->class_names[i]), "zram-%u", (i + 1) * ZRAM_CLASS_SIZE);
+        dev->classes[i] =
+            kmem_cache_create(dev->class_names[i], (i + 1) * ZRAM_CLASS_SIZE, sizeof(uint32_t), GFP_NOIO, NULL, NULL);
+        if (!dev->classes[i]) {
+            pr_err("Failed to create the cache `%s`.\n", dev->class_names[i]);
+            while (i--) {
+                kmem_cache_destroy(dev->classes[i]);
+            }
+            kfree(dev->slots);
+            return 1;
+        }
+    }
+    if (zram_mkswap(dev) < 0) {
+        pr_err("Failed to write the header of the swap area.\n");
+        return 1;
+    }
+    // Register the filesystem, and create the filesystem entry for the device.
+    vfs_register_filesystem(&zram_file_system_type);
+    dev->fs_root = zram_device_create(dev);
+    if (!dev->fs_root) {
+        pr_alert("Failed to create the zram device!\n");
+        return 1;
+    }
+    if (!vfs_register_superblock(dev->fs_root->name, dev->path, &zram_file_system_type, dev->fs_root)) {
+        pr_alert("Failed to mount the zram device!\n");
+        vfs_dealloc_file(dev->fs_root);
+        dev->fs_root = NULL;
+        return 1;
+    }
+    if ((blk_queue_init(&dev->queue, dev->fs_root, dev, zram_request_fn, ZRAM_MAX_SECTORS) < 0) ||
+        (blk_queue_set_discard(&dev->queue, zram_discard_fn) < 0)) {
+        pr_warning("[%s] Failed to initialize the request queue.\n", dev->name);
+    }
+    pr_notice("Initialized %s (%u KiB).\n", dev->name, dev->npages * (PAGE_SIZE / 1024));
+    return 0;
+}
+
+device_initcall(zram_initialize, NULL);
+
+/// @}
@@ -14,7 +14,6 @@
 #include "fs/vfs.h"
 #include "mem/paging.h"
 #include "mem/alloc/slab.h"
-#include "mem/mm/vmem.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "stddef.h"
@@ -33,14 +32,6 @@ static inline elf_section_header_t *elf_get_section_header_table(elf_header_t *h
     return (elf_section_header_t *)((uintptr_t)header + header->shoff);
 }
 
-/// @brief Returns the pointer to where the program headers reside.
-/// @param header a pointer to the ELF header.
-/// @return a pointer to the program headers table.
-static inline elf_program_header_t *elf_get_program_header_table(elf_header_t *header)
-{
-    return (elf_program_header_t *)((uintptr_t)header + header->phoff);
-}
-
 // ============================================================================
 // GET ELF OBJECTS
 // ============================================================================
@@ -54,15 +45,6 @@ static inline elf_section_header_t *elf_get_section_header(elf_header_t *header,
     return &elf_get_section_header_table(header)[idx];
 }
 
-/// @brief Returns a pointer to the desired program header.
-/// @param header a pointer to the ELF header.
-/// @param idx the index of the program header.
-/// @return a pointer to the desired section header.
-static inline elf_program_header_t *elf_get_program_header(elf_header_t *header, unsigned idx)
-{
-    return &elf_get_program_header_table(header)[idx];
-}
-
 // ============================================================================
 // GET STRING TABLES
 // ============================================================================
@@ -241,41 +223,62 @@ static inline void elf_dump_symbol_table(elf_header_t *header)
 // EXEC-RELATED FUNCTIONS
 // ============================================================================
 
-/// @brief Loads an ELF executable.
-/// @param header  The header of the ELF file.
+/// @brief Loads an ELF executable, mapping its segments on areas whose
+///        pages are read from the file the first time they are accessed.
+/// @param header The header of the ELF file.
+/// @param program_headers The program headers of the ELF file.
+/// @param file The ELF file.
 /// @param task The task for which we load the ELF.
-/// @return The ELF entry.
-static inline int elf_load_exec(elf_header_t *header, task_struct *task)
+/// @return true on success, false on failure.
+static inline int elf_load_exec(
+    elf_header_t *header, elf_program_header_t *program_headers, vfs_file_t *file, task_struct *task)
 {
     elf_program_header_t *program_header;
     vm_area_struct_t *segment;
-    virt_map_page_t *vpage;
-    uint32_t dst_addr;
-    uint32_t zmem_sz;
 
+    // The program tells where its headers are, through PT_PHDR, or they are
+    // found inside the first segment which loads them.
+    task->mm->phdr  = 0;
+    task->mm->phnum = header->phnum;
     pr_debug(" Type      | Mem. Size | File Size | VADDR\n");
     for (unsigned i = 0; i < header->phnum; ++i) {
         // Get the header.
-        program_header = elf_get_program_header(header, i);
+        program_header = &program_headers[i];
         // Dump the information about the header.
         pr_debug(
             " %-9s | %9s | %9s | 0x%08x - 0x%08x\n", elf_type_to_string(program_header->type),
             to_human_size(program_header->memsz), to_human_size(program_header->filesz), program_header->vaddr,
             program_header->vaddr + program_header->memsz);
+        if (program_header->type == PT_PHDR) {
+            task->mm->phdr = program_header->vaddr;
+        } else if ((program_header->type == PT_LOAD) && !task->mm->phdr && (header->phoff >= program_header->offset) &&
+                   ((header->phoff + (header->phnum * sizeof(elf_program_header_t))) <=
+                    (program_header->offset + program_header->filesz))) {
+            task->mm->phdr = program_header->vaddr + (header->phoff - program_header->offset);
+        }
         if (program_header->type == PT_LOAD) {
-            segment = vm_area_create(
-                task->mm, program_header->vaddr, program_header->memsz, MM_USER | MM_RW | MM_COW, GFP_KERNEL);
-            vpage    = vmem_map_alloc_virtual(program_header->memsz);
-            dst_addr = vmem_map_virtual_address(task->mm, vpage, segment->vm_start, program_header->memsz);
-
-            // Load the memory area.
-            memcpy((void *)dst_addr, (void *)((uintptr_t)header + program_header->offset), program_header->filesz);
-
-            if (program_header->memsz > program_header->filesz) {
-                zmem_sz = program_header->memsz - program_header->filesz;
-                memset((void *)(dst_addr + program_header->filesz), 0, zmem_sz);
+            if (program_header->filesz > program_header->memsz) {
+                pr_err("Segment %u is larger inside the file than in memory.\n", i);
+                return false;
+            }
+            // The pages are allocated on demand, and the ones past the end of
+            // the content inside the file (the BSS) are just zero-filled. The
+            // pages of read-only segments, like the text, are shared by all
+            // the processes running the executable.
+            uint32_t pgflags = MM_USER | MM_COW;
+            if (program_header->flags & PF_W) {
+                pgflags |= MM_RW;
+            }
+            segment = vm_area_create(task->mm, program_header->vaddr, program_header->memsz, pgflags, GFP_KERNEL);
+            if (!segment) {
+                pr_err("Failed to create the area of segment %u.\n", i);
+                return false;
+            }
+            if (program_header->filesz &&
+                (vm_area_map_file(segment, file, program_header->offset, program_header->filesz) < 0)) {
+                pr_err("Failed to map segment %u on its file.\n", i);
+                return false;
             }
-            vmem_unmap_virtual_address_page(vpage);
         }
     }
     return true;
@@ -287,59 +290,51 @@ int elf_load_file(task_struct *task, vfs_file_t *file, uint32_t *entry)
     if (file == NULL) {
         return false;
     }
-    // Get the size of the file.
-    stat_t stat_buf;
-    if (vfs_fstat(file, &stat_buf) < 0) {
-        pr_err("Failed to stat the file `%s`.\n", file->name);
-        return false;
-    }
-    // Allocate the memory for the file.
-    char *buffer = kmalloc(stat_buf.st_size);
-    if (buffer == NULL) {
-        pr_err(
-            "Failed to allocate %d bytes of memory for reading the file "
-            "`%s`.\n",
-            stat_buf.st_size, file->name);
+    // The first thing inside the file is the ELF header, the rest is read on demand.
+    elf_header_t header;
+    if (vfs_read(file, &header, 0, sizeof(elf_header_t)) != sizeof(elf_header_t)) {
+        pr_err("Failed to read the ELF header of the file `%s`.\n", file->name);
         return false;
     }
-    // Clean the memory.
-    memset(buffer, 0, stat_buf.st_size);
-    // Read the file.
-    if (vfs_read(file, buffer, 0, stat_buf.st_size) != stat_buf.st_size) {
-        pr_err("Failed to read %d bytes from the file `%s`.\n", stat_buf.st_size, file->name);
-        goto return_error_free_buffer;
-    }
-    // The first thing inside the file is the ELF header.
-    elf_header_t *header = (elf_header_t *)buffer;
     // Print header info.
-    pr_debug("Type           : %s\n", elf_type_to_string(header->type));
-    pr_debug("Version        : 0x%x\n", header->version);
-    pr_debug("Entry          : 0x%x\n", header->entry);
-    pr_debug("Headers offset : 0x%x\n", header->phoff);
-    pr_debug("Headers count  : %d\n", header->phnum);
+    pr_debug("Type           : %s\n", elf_type_to_string(header.type));
+    pr_debug("Version        : 0x%x\n", header.version);
+    pr_debug("Entry          : 0x%x\n", header.entry);
+    pr_debug("Headers offset : 0x%x\n", header.phoff);
+    pr_debug("Headers count  : %d\n", header.phnum);
     // Check the elf header.
-    if (!elf_check_file_header(header)) {
-        pr_err("File %s is not a valid ELF file.\n", stat_buf.st_size, file->name);
-        goto return_error_free_buffer;
+    if (!elf_check_file_header(&header)) {
+        pr_err("File %s is not a valid ELF file.\n", file->name);
+        return false;
     }
     // Check if the elf file is an executable.
-    if (header->type != ET_EXEC) {
+    if (header.type != ET_EXEC) {
         pr_err("Elf file is not an executable.\n");
-        goto return_error_free_buffer;
+        return false;
     }
-    if (!elf_load_exec(header, task)) {
+    if (header.phentsize != sizeof(elf_program_header_t)) {
+        pr_err("Elf file has program headers of unsupported size %d.\n", header.phentsize);
+        return false;
+    }
+    // Read the program headers.
+    size_t size                           = header.phnum * sizeof(elf_program_header_t);
+    elf_program_header_t *program_headers = kmalloc(size);
+    if (program_headers == NULL) {
+        pr_err("Failed to allocate %d bytes of memory for the program headers of `%s`.\n", size, file->name);
+        return false;
+    }
+    int ret = false;
+    if (vfs_read(file, program_headers, header.phoff, size) != size) {
+        pr_err("Failed to read the program headers of the file `%s`.\n", file->name);
+    } else if (!elf_load_exec(&header, program_headers, file, task)) {
         pr_err("Failed to load the executable.\n");
-        goto return_error_free_buffer;
+    } else {
+        // Set the entry.
+        (*entry) = header.entry;
+        ret      = true;
     }
-
-    // Set the entry.
-    (*entry) = header->entry;
-
-    kfree(buffer);
-    return true;
-return_error_free_buffer:
-    kfree(buffer);
-    return false;
+    kfree(program_headers);
+    return ret;
 }
 
 int elf_check_file_type(vfs_file_t *file, Elf_Type type)
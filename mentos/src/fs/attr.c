@@ -92,12 +92,12 @@ int sys_fchown(int fd, uid_t owner, gid_t group)
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EBADF;
     }
 
     // Get the file.
-    vfs_file_t *file = task->fd_list[fd].file_struct;
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
     if (file == NULL) {
         return -EBADF;
     }
@@ -134,12 +134,12 @@ int sys_fchmod(int fd, mode_t mode)
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EBADF;
     }
 
     // Get the file.
-    vfs_file_t *file = task->fd_list[fd].file_struct;
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
     if (file == NULL) {
         return -EBADF;
     }
@@ -0,0 +1,350 @@
+/// @file blkdev.c
+/// @brief Block I/O layer, with request queues and an elevator.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[BLKDEV]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/blkdev.h"
+
+#include "assert.h"
+#include "errno.h"
+#include "hardware/timer.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "stdio.h"
+#include "string.h"
+#include "system/trace.h"
+
+/// @brief Converts timer ticks to milliseconds, without overflowing.
+#define TICKS_TO_MS(ticks) \
+    ((((ticks) / TICKS_PER_SECOND) * 1000UL) + ((((ticks) % TICKS_PER_SECOND) * 1000UL) / TICKS_PER_SECOND))
+
+/// The list of request queues.
+static list_head_t blk_queues;
+/// Cache for the bio structures.
+static kmem_cache_t *bio_cache;
+
+int blkdev_initialize(void)
+{
+    // Initialize the list of queues.
+    list_head_init(&blk_queues);
+    // Create the cache for the bios.
+    bio_cache = KMEM_CREATE(bio_t);
+    if (!bio_cache) {
+        pr_crit("Failed to create the cache for the bios.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int blk_queue_init(
+    request_queue_t *queue,
+    vfs_file_t *file,
+    void *device,
+    blk_request_fn_t request_fn,
+    uint32_t max_sectors)
+{
+    // Validate the input.
+    if (!queue || !file || !request_fn || !max_sectors) {
+        pr_err("Invalid arguments for the request queue.\n");
+        return -EINVAL;
+    }
+    queue->file        = file;
+    queue->device      = device;
+    queue->request_fn  = request_fn;
+    queue->sync_fn     = NULL;
+    queue->discard_fn  = NULL;
+    queue->depth       = 1;
+    queue->max_sectors = max_sectors;
+    queue->head_sector = 0;
+    queue->num_pending = 0;
+    memset(&queue->stats, 0, sizeof(blk_stats_t));
+    list_head_init(&queue->pending);
+    spinlock_init(&queue->lock);
+    // Add the queue to the list of queues.
+    list_head_insert_before(&queue->siblings, &blk_queues);
+    return 0;
+}
+
+int blk_queue_set_depth(request_queue_t *queue, uint32_t depth, blk_sync_fn_t sync_fn)
+{
+    // Validate the input, a deeper queue needs a way to wait for the requests.
+    if (!queue || (depth == 0) || (depth > BLK_MAX_DEPTH) || ((depth > 1) && !sync_fn)) {
+        pr_err("Invalid depth for the request queue.\n");
+        return -EINVAL;
+    }
+    spinlock_lock(&queue->lock);
+    queue->depth   = depth;
+    queue->sync_fn = sync_fn;
+    spinlock_unlock(&queue->lock);
+    return 0;
+}
+
+int blk_queue_set_discard(request_queue_t *queue, blk_discard_fn_t discard_fn)
+{
+    if (!queue || !discard_fn) {
+        pr_err("Invalid discard function for the request queue.\n");
+        return -EINVAL;
+    }
+    queue->discard_fn = discard_fn;
+    return 0;
+}
+
+request_queue_t *blk_get_queue(vfs_file_t *file)
+{
+    list_for_each_decl (it, &blk_queues) {
+        request_queue_t *queue = list_entry(it, request_queue_t, siblings);
+        if (queue->file == file) {
+            return queue;
+        }
+    }
+    return NULL;
+}
+
+bio_t *bio_alloc(uint32_t sector, uint32_t count, uint8_t *buffer, int write)
+{
+    bio_t *bio = kmem_cache_alloc(bio_cache, GFP_KERNEL);
+    if (!bio) {
+        pr_err("Failed to allocate a bio.\n");
+        return NULL;
+    }
+    memset(bio, 0, sizeof(bio_t));
+    bio->sector = sector;
+    bio->count  = count;
+    bio->buffer = buffer;
+    bio->write  = write;
+    bio->done   = false;
+    list_head_init(&bio->list);
+    return bio;
+}
+
+void bio_free(bio_t *bio)
+{
+    assert(bio && "Received a NULL pointer.");
+    list_head_remove(&bio->list);
+    kmem_cache_free(bio);
+}
+
+int blk_submit_bio(request_queue_t *queue, bio_t *bio)
+{
+    // Validate the input.
+    if (!queue || !bio || !bio->buffer) {
+        return -EINVAL;
+    }
+    if ((bio->count == 0) || (bio->count > queue->max_sectors)) {
+        pr_err("Invalid number of sectors for a bio (%u).\n", bio->count);
+        return -EINVAL;
+    }
+    bio->done      = false;
+    bio->status    = 0;
+    bio->submitted = timer_get_ticks();
+    spinlock_lock(&queue->lock);
+    // Find the first bio which starts after the new one, and insert the new
+    // one before it, so that the queue remains sorted by sector.
+    list_head_t *location = &queue->pending;
+    list_for_each_decl (it, &queue->pending) {
+        if (list_entry(it, bio_t, list)->sector > bio->sector) {
+            location = it;
+            break;
+        }
+    }
+    list_head_insert_before(&bio->list, location);
+    ++queue->num_pending;
+    spinlock_unlock(&queue->lock);
+    return 0;
+}
+
+/// @brief Selects the next bio to dispatch, following the C-LOOK policy.
+/// @param queue the queue.
+/// @return the first pending bio at or after the head position, or the lowest
+/// pending bio if there are none.
+static inline bio_t *__blk_elevator_next(request_queue_t *queue)
+{
+    list_for_each_decl (it, &queue->pending) {
+        bio_t *bio = list_entry(it, bio_t, list);
+        if (bio->sector >= queue->head_sector) {
+            return bio;
+        }
+    }
+    // Wrap around to the lowest sector.
+    return list_entry(queue->pending.next, bio_t, list);
+}
+
+/// @brief Builds a request, starting from the given bio, and merging all the
+/// adjacent bios which go in the same direction.
+/// @param queue the queue.
+/// @param first the first bio of the request.
+/// @param request the request to fill.
+static inline void __blk_build_request(request_queue_t *queue, bio_t *first, blk_request_t *request)
+{
+    request->sector = first->sector;
+    request->count  = 0;
+    request->write  = first->write;
+    request->status = 0;
+    list_head_init(&request->bios);
+    // Since the queue is sorted, adjacent bios follow each other.
+    list_head_t *it = &first->list;
+    while (it != &queue->pending) {
+        bio_t *bio        = list_entry(it, bio_t, list);
+        list_head_t *next = it->next;
+        // Stop at the first bio which cannot be merged.
+        if ((bio->write != request->write) || (bio->sector != request->sector + request->count) ||
+            (request->count + bio->count > queue->max_sectors)) {
+            break;
+        }
+        // Move the bio from the queue to the request.
+        list_head_remove(&bio->list);
+        list_head_insert_before(&bio->list, &request->bios);
+        --queue->num_pending;
+        if (request->count) {
+            ++queue->stats.merges[request->write != 0];
+        }
+        request->count += bio->count;
+        it = next;
+    }
+}
+
+/// @brief Accounts the dispatch of a request to the driver.
+/// @param queue the queue, whose lock is held.
+/// @param request the request.
+static inline void __blk_stats_issue(request_queue_t *queue, blk_request_t *request)
+{
+    request->issued = timer_get_ticks();
+    list_for_each_decl (it, &request->bios) {
+        queue->stats.queue_ticks[request->write != 0] += request->issued - list_entry(it, bio_t, list)->submitted;
+    }
+    ++queue->stats.in_flight;
+}
+
+/// @brief Accounts the completion of a request.
+/// @param queue the queue, whose lock is held.
+/// @param write if the request was a write (1) or a read (0).
+/// @param sectors the number of transferred sectors.
+/// @param issued when the request has been issued.
+static inline void __blk_stats_complete(request_queue_t *queue, int write, uint32_t sectors, unsigned long issued)
+{
+    ++queue->stats.ios[write != 0];
+    queue->stats.sectors[write != 0] += sectors;
+    queue->stats.service_ticks[write != 0] += timer_get_ticks() - issued;
+    if (queue->stats.in_flight) {
+        --queue->stats.in_flight;
+    }
+}
+
+/// @brief Completes all the bios of a request.
+/// @param request the request.
+/// @param status the outcome of the request.
+static inline void __blk_end_request(blk_request_t *request, int status)
+{
+    list_for_each_safe_decl(it, store, &request->bios)
+    {
+        bio_t *bio = list_entry(it, bio_t, list);
+        list_head_remove(&bio->list);
+        bio->status = status;
+        bio->done   = true;
+        if (bio->end_io) {
+            bio->end_io(bio);
+        }
+    }
+}
+
+int blk_run_queue(request_queue_t *queue)
+{
+    blk_request_t requests[BLK_MAX_DEPTH];
+    int dispatched = 0;
+    if (!queue) {
+        return 0;
+    }
+    spinlock_lock(&queue->lock);
+    while (!list_head_empty(&queue->pending)) {
+        uint32_t issued = 0;
+        // Issue up to depth requests, following the elevator.
+        while (!list_head_empty(&queue->pending) && (issued < queue->depth)) {
+            blk_request_t *request = &requests[issued++];
+            // Build the next request.
+            __blk_build_request(queue, __blk_elevator_next(queue), request);
+            // Move the head after the request.
+            queue->head_sector = request->sector + request->count;
+            __blk_stats_issue(queue, request);
+            trace_point(TRACE_BLOCK_ISSUE, request->sector, request->count, request->write);
+            // Issue the request without holding the lock, so that new bios
+            // can be submitted in the meanwhile.
+            spinlock_unlock(&queue->lock);
+            int status = queue->request_fn(queue->device, request);
+            if (status < 0) {
+                request->status = status;
+            }
+            spinlock_lock(&queue->lock);
+        }
+        spinlock_unlock(&queue->lock);
+        // Wait for the requests still in flight.
+        if (queue->sync_fn) {
+            queue->sync_fn(queue->device);
+        }
+        spinlock_lock(&queue->lock);
+        for (uint32_t i = 0; i < issued; ++i) {
+            __blk_stats_complete(queue, requests[i].write, requests[i].count, requests[i].issued);
+        }
+        spinlock_unlock(&queue->lock);
+        for (uint32_t i = 0; i < issued; ++i) {
+            if (requests[i].status < 0) {
+                pr_err(
+                    "Failed to serve request (sector: %u, count: %u, write: %d).\n", requests[i].sector,
+                    requests[i].count, requests[i].write);
+            }
+            trace_point(TRACE_BLOCK_COMPLETE, requests[i].sector, requests[i].count, requests[i].status);
+            __blk_end_request(&requests[i], requests[i].status);
+        }
+        dispatched += issued;
+        spinlock_lock(&queue->lock);
+    }
+    spinlock_unlock(&queue->lock);
+    return dispatched;
+}
+
+void blk_discard(request_queue_t *queue, uint32_t sector, uint32_t count)
+{
+    if (queue && queue->discard_fn && count) {
+        queue->discard_fn(queue->device, sector, count);
+    }
+}
+
+unsigned long blk_stats_start(request_queue_t *queue)
+{
+    spinlock_lock(&queue->lock);
+    ++queue->stats.in_flight;
+    spinlock_unlock(&queue->lock);
+    return timer_get_ticks();
+}
+
+void blk_stats_done(request_queue_t *queue, int write, uint32_t sectors, unsigned long start)
+{
+    spinlock_lock(&queue->lock);
+    __blk_stats_complete(queue, write, sectors, start);
+    spinlock_unlock(&queue->lock);
+}
+
+ssize_t blk_stats_dump(char *buffer, size_t bufsize)
+{
+    size_t written = 0;
+    list_for_each_decl (it, &blk_queues) {
+        request_queue_t *queue = list_entry(it, request_queue_t, siblings);
+        blk_stats_t *stats     = &queue->stats;
+        if (written >= bufsize) {
+            break;
+        }
+        written += snprintf(
+            buffer + written, bufsize - written, "%8s %u %u %llu %lu %u %u %llu %lu %u %lu %lu\n",
+            queue->file->name, stats->ios[0], stats->merges[0], stats->sectors[0],
+            TICKS_TO_MS(stats->queue_ticks[0] + stats->service_ticks[0]), stats->ios[1], stats->merges[1],
+            stats->sectors[1], TICKS_TO_MS(stats->queue_ticks[1] + stats->service_ticks[1]), stats->in_flight,
+            TICKS_TO_MS(stats->service_ticks[0] + stats->service_ticks[1]),
+            TICKS_TO_MS(stats->queue_ticks[0] + stats->queue_ticks[1]));
+    }
+    return min(written, bufsize);
+}
@@ -0,0 +1,227 @@
+/// @file eventfd.c
+/// @brief Event notification through a file descriptor.
+/// @details
+/// An eventfd is a file, whose device holds a 64-bit counter: writes add to
+/// it, and reads take it back, waiting until it is not zero. Readers and
+/// writers sleep on the same wait queue, which is woken up whenever the
+/// counter changes, and which is also the one the file is polled on.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[EVNTFD]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "sys/eventfd.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/poll.h"
+#include "fs/vfs.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "system/syscall.h"
+#include "time.h"
+
+/// The largest value the counter can hold.
+#define EVENTFD_MAX ((eventfd_t)0xFFFFFFFFFFFFFFFEULL)
+
+/// @brief An eventfd.
+typedef struct eventfd_ctx {
+    /// The counter.
+    eventfd_t count;
+    /// The flags of the eventfd (EFD_SEMAPHORE).
+    int flags;
+    /// The tasks waiting for the counter to change.
+    wait_queue_head_t wait;
+} eventfd_ctx_t;
+
+static int eventfd_file_close(vfs_file_t *file);
+static ssize_t eventfd_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static ssize_t eventfd_file_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static int eventfd_file_fstat(vfs_file_t *file, stat_t *stat);
+static long eventfd_file_fcntl(vfs_file_t *file, unsigned int request, unsigned long data);
+static unsigned int eventfd_file_poll(vfs_file_t *file, poll_table_t *table);
+
+/// Eventfd file operations.
+static vfs_file_operations_t eventfd_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = eventfd_file_close,
+    .read_f     = eventfd_file_read,
+    .write_f    = eventfd_file_write,
+    .lseek_f    = NULL,
+    .stat_f     = eventfd_file_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = eventfd_file_fcntl,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = eventfd_file_poll,
+};
+
+/// @brief Closes an eventfd, freeing it with the last reference.
+/// @param file the file of the eventfd.
+/// @return 0 on success.
+static int eventfd_file_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        kfree(file->device);
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Takes the counter back, waiting until it is not zero.
+/// @param file the file of the eventfd.
+/// @param buffer where the value is stored.
+/// @param offset not used.
+/// @param nbyte the size of the buffer, at least the size of the counter.
+/// @return the size of the counter, or a negative error code.
+static ssize_t eventfd_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    eventfd_ctx_t *ctx = (eventfd_ctx_t *)file->device;
+    if (nbyte < sizeof(eventfd_t)) {
+        return -EINVAL;
+    }
+    while (ctx->count == 0) {
+        if (bitmask_check(file->flags, O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&ctx->wait) < 0) {
+            return -EINTR;
+        }
+    }
+    // A semaphore is taken one unit at a time.
+    eventfd_t value = bitmask_check(ctx->flags, EFD_SEMAPHORE) ? 1 : ctx->count;
+    ctx->count -= value;
+    memcpy(buffer, &value, sizeof(eventfd_t));
+    wake_up(&ctx->wait);
+    return sizeof(eventfd_t);
+}
+
+/// @brief Adds to the counter, waiting until it has room for the value.
+/// @param file the file of the eventfd.
+/// @param buffer the value.
+/// @param offset not used.
+/// @param nbyte the size of the buffer, at least the size of the counter.
+/// @return the size of the counter, or a negative error code.
+static ssize_t eventfd_file_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    eventfd_ctx_t *ctx = (eventfd_ctx_t *)file->device;
+    eventfd_t value;
+    if (nbyte < sizeof(eventfd_t)) {
+        return -EINVAL;
+    }
+    memcpy(&value, buffer, sizeof(eventfd_t));
+    if (value > EVENTFD_MAX) {
+        return -EINVAL;
+    }
+    while ((EVENTFD_MAX - ctx->count) < value) {
+        if (bitmask_check(file->flags, O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&ctx->wait) < 0) {
+            return -EINTR;
+        }
+    }
+    ctx->count += value;
+    if (value > 0) {
+        wake_up(&ctx->wait);
+    }
+    return sizeof(eventfd_t);
+}
+
+/// @brief Retrieves the status of an eventfd.
+/// @param file the file of the eventfd.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int eventfd_file_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = 0600;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Gets, or sets, the flags of an eventfd.
+/// @param file the file of the eventfd.
+/// @param request the request (F_GETFL or F_SETFL).
+/// @param data the new flags, only O_NONBLOCK can be changed.
+/// @return the flags for F_GETFL, 0 for F_SETFL, -EINVAL for other requests.
+static long eventfd_file_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    switch (request) {
+    case F_GETFL:
+        return file->flags;
+    case F_SETFL:
+        file->flags = (file->flags & ~O_NONBLOCK) | (data & O_NONBLOCK);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief Reports the readiness of an eventfd.
+/// @param file the file of the eventfd.
+/// @param table the poll table.
+/// @return POLLIN if the counter is not zero, POLLOUT if it has room for at least one.
+static unsigned int eventfd_file_poll(vfs_file_t *file, poll_table_t *table)
+{
+    eventfd_ctx_t *ctx = (eventfd_ctx_t *)file->device;
+    unsigned int mask  = 0;
+    poll_wait(&ctx->wait, table);
+    if (ctx->count > 0) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if (ctx->count < EVENTFD_MAX) {
+        mask |= POLLOUT | POLLWRNORM;
+    }
+    return mask;
+}
+
+int sys_eventfd2(unsigned int initval, int flags)
+{
+    if (flags & ~(EFD_SEMAPHORE | EFD_NONBLOCK)) {
+        return -EINVAL;
+    }
+    task_struct *task = scheduler_get_current_process();
+    int fd            = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    eventfd_ctx_t *ctx = kmalloc(sizeof(eventfd_ctx_t));
+    if (!ctx) {
+        return -ENOMEM;
+    }
+    ctx->count = initval;
+    ctx->flags = flags & EFD_SEMAPHORE;
+    wait_queue_head_init(&ctx->wait);
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        kfree(ctx);
+        return -ENOMEM;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[eventfd]");
+    file->flags         = O_RDWR | (flags & EFD_NONBLOCK);
+    file->fs_operations = &eventfd_fs_operations;
+    file->device        = ctx;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+int sys_eventfd(unsigned int initval) { return sys_eventfd2(initval, 0); }
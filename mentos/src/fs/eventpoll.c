@@ -0,0 +1,326 @@
+/// @file eventpoll.c
+/// @brief Epoll instances, interest lists built on top of the poll functions of the files.
+/// @details
+/// Each instance is a file, whose device keeps the list of the descriptors we
+/// are interested in. Items are level-triggered: each call to epoll_wait()
+/// checks the files of the interest list, and waits on their queues through
+/// the poll table of the task, as poll() does. An item is bound to both the
+/// descriptor and the file it referred to, once the descriptor is closed the
+/// item is dropped the next time it is visited.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[EPOLL ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/poll.h"
+#include "fs/vfs.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "system/syscall.h"
+#include "time.h"
+
+/// The maximum depth of nested epoll instances.
+#define EPOLL_MAX_NESTS 4
+
+/// @brief An entry of the interest list.
+typedef struct epoll_item {
+    /// The file descriptor.
+    int fd;
+    /// The file the descriptor referred to, when the item was added.
+    vfs_file_t *file;
+    /// The events we are interested in, and the user data.
+    struct epoll_event event;
+    /// Used to place the item inside the interest list.
+    list_head_t list;
+} epoll_item_t;
+
+/// @brief An epoll instance.
+typedef struct eventpoll {
+    /// The interest list (epoll_item_t).
+    list_head_t items;
+} eventpoll_t;
+
+static int eventpoll_close(vfs_file_t *file);
+static unsigned int eventpoll_poll(vfs_file_t *file, poll_table_t *table);
+
+/// Epoll file operations.
+static vfs_file_operations_t eventpoll_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = eventpoll_close,
+    .read_f     = NULL,
+    .write_f    = NULL,
+    .lseek_f    = NULL,
+    .stat_f     = NULL,
+    .ioctl_f    = NULL,
+    .fcntl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = eventpoll_poll,
+};
+
+/// @brief Checks if the descriptor of an item still refers to its file.
+/// @param task the current task.
+/// @param item the item.
+/// @return true if the item is still valid, false if the descriptor has been closed.
+static inline bool_t __epoll_item_valid(task_struct *task, epoll_item_t *item)
+{
+    return (item->fd < task->files->max_fd) && (task->files->fd_list[item->fd].file_struct == item->file);
+}
+
+/// @brief Removes an item from the interest list, and frees it.
+/// @param item the item.
+static inline void __epoll_item_free(epoll_item_t *item)
+{
+    list_head_remove(&item->list);
+    kfree(item);
+}
+
+/// @brief Checks the events of an item.
+/// @param item the item.
+/// @param table the poll table.
+/// @return the events which occurred, among the requested ones and the ones always reported.
+static inline unsigned int __epoll_item_poll(epoll_item_t *item, poll_table_t *table)
+{
+    return vfs_poll(item->file, table) & (item->event.events | EPOLLERR | EPOLLHUP);
+}
+
+/// @brief Returns the epoll instance associated with a file descriptor.
+/// @param task the current task.
+/// @param epfd the file descriptor.
+/// @param ep where the instance is stored.
+/// @return 0 on success, -EBADF if the descriptor is not open, -EINVAL if it is not an epoll instance.
+static inline int __epoll_get(task_struct *task, int epfd, eventpoll_t **ep)
+{
+    if ((epfd < 0) || (epfd >= task->files->max_fd) || !task->files->fd_list[epfd].file_struct) {
+        return -EBADF;
+    }
+    vfs_file_t *file = task->files->fd_list[epfd].file_struct;
+    if (file->fs_operations != &eventpoll_fs_operations) {
+        return -EINVAL;
+    }
+    *ep = (eventpoll_t *)file->device;
+    return 0;
+}
+
+/// @brief Finds the item of a descriptor, dropping the ones which are no longer valid.
+/// @param task the current task.
+/// @param ep the epoll instance.
+/// @param fd the file descriptor.
+/// @return the item, NULL if the descriptor is not inside the interest list.
+static epoll_item_t *__epoll_find(task_struct *task, eventpoll_t *ep, int fd)
+{
+    list_for_each_safe_decl(it, store, &ep->items)
+    {
+        epoll_item_t *item = list_entry(it, epoll_item_t, list);
+        if (!__epoll_item_valid(task, item)) {
+            __epoll_item_free(item);
+        } else if (item->fd == fd) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Checks if an epoll instance can be reached from another one, through
+/// the instances nested inside it.
+/// @param task the current task.
+/// @param from the instance we start from.
+/// @param to the instance we are looking for.
+/// @param depth the current nesting depth.
+/// @return true if `to` is reachable, or if the nesting is too deep.
+static bool_t __epoll_reaches(task_struct *task, eventpoll_t *from, eventpoll_t *to, int depth)
+{
+    if (from == to) {
+        return true;
+    }
+    if (depth >= EPOLL_MAX_NESTS) {
+        return true;
+    }
+    list_for_each_decl (it, &from->items) {
+        epoll_item_t *item = list_entry(it, epoll_item_t, list);
+        if (__epoll_item_valid(task, item) && (item->file->fs_operations == &eventpoll_fs_operations) &&
+            __epoll_reaches(task, (eventpoll_t *)item->file->device, to, depth + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Closes an epoll instance, freeing its interest list with the last reference.
+/// @param file the file of the instance.
+/// @return 0 on success.
+static int eventpoll_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        eventpoll_t *ep = (eventpoll_t *)file->device;
+        list_for_each_safe_decl(it, store, &ep->items)
+        {
+            __epoll_item_free(list_entry(it, epoll_item_t, list));
+        }
+        kfree(ep);
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Makes an epoll instance readable when one of its items is ready,
+/// so that instances can be polled, or nested inside other instances.
+/// @param file the file of the instance.
+/// @param table the poll table.
+/// @return POLLIN if one of the items is ready, 0 otherwise.
+static unsigned int eventpoll_poll(vfs_file_t *file, poll_table_t *table)
+{
+    task_struct *task  = scheduler_get_current_process();
+    eventpoll_t *ep    = (eventpoll_t *)file->device;
+    unsigned int ready = 0;
+    list_for_each_decl (it, &ep->items) {
+        epoll_item_t *item = list_entry(it, epoll_item_t, list);
+        if (__epoll_item_valid(task, item) && __epoll_item_poll(item, table)) {
+            ready = POLLIN | POLLRDNORM;
+        }
+    }
+    return ready;
+}
+
+int sys_epoll_create(int size)
+{
+    if (size <= 0) {
+        return -EINVAL;
+    }
+    task_struct *task = scheduler_get_current_process();
+    int fd            = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    eventpoll_t *ep = kmalloc(sizeof(eventpoll_t));
+    if (!ep) {
+        return -ENOMEM;
+    }
+    list_head_init(&ep->items);
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        kfree(ep);
+        return -ENOMEM;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[eventpoll]");
+    file->flags         = O_RDWR;
+    file->fs_operations = &eventpoll_fs_operations;
+    file->device        = ep;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+    task_struct *task = scheduler_get_current_process();
+    eventpoll_t *ep;
+    int ret = __epoll_get(task, epfd, &ep);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+        return -EBADF;
+    }
+    vfs_file_t *target = task->files->fd_list[fd].file_struct;
+    // An instance cannot watch itself.
+    if (target == task->files->fd_list[epfd].file_struct) {
+        return -EINVAL;
+    }
+    if ((op != EPOLL_CTL_DEL) && !event) {
+        return -EFAULT;
+    }
+    epoll_item_t *item = __epoll_find(task, ep, fd);
+    switch (op) {
+    case EPOLL_CTL_ADD:
+        if (item) {
+            return -EEXIST;
+        }
+        // Nested instances must not form a cycle.
+        if ((target->fs_operations == &eventpoll_fs_operations) &&
+            __epoll_reaches(task, (eventpoll_t *)target->device, ep, 1)) {
+            return -ELOOP;
+        }
+        item = kmalloc(sizeof(epoll_item_t));
+        if (!item) {
+            return -ENOMEM;
+        }
+        item->fd    = fd;
+        item->file  = target;
+        item->event = *event;
+        list_head_insert_before(&item->list, &ep->items);
+        return 0;
+    case EPOLL_CTL_MOD:
+        if (!item) {
+            return -ENOENT;
+        }
+        item->event = *event;
+        return 0;
+    case EPOLL_CTL_DEL:
+        if (!item) {
+            return -ENOENT;
+        }
+        __epoll_item_free(item);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+int sys_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+    if (maxevents <= 0) {
+        return -EINVAL;
+    }
+    if (!events) {
+        return -EFAULT;
+    }
+    task_struct *task = scheduler_get_current_process();
+    eventpoll_t *ep;
+    int ret = __epoll_get(task, epfd, &ep);
+    if (ret < 0) {
+        return ret;
+    }
+    // Check the items, until one of them is ready, or the timeout expires.
+    do {
+        poll_table_t *table = poll_table_begin(timeout);
+        if (!table) {
+            return -ENOMEM;
+        }
+        int ready = 0;
+        list_for_each_safe_decl(it, store, &ep->items)
+        {
+            epoll_item_t *item = list_entry(it, epoll_item_t, list);
+            // Drop the items whose descriptor has been closed.
+            if (!__epoll_item_valid(task, item)) {
+                __epoll_item_free(item);
+                continue;
+            }
+            unsigned int revents = __epoll_item_poll(item, table);
+            if (revents) {
+                events[ready].events = revents;
+                events[ready].data   = item->event.data;
+                if (++ready == maxevents) {
+                    break;
+                }
+            }
+        }
+        ret = poll_table_end(table, ready, timeout);
+    } while (ret == -EAGAIN);
+    return ret;
+}
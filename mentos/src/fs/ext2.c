@@ -10,6 +10,10 @@
 #include "io/debug.h"                    // Include debugging functions.
 // If defined, ETX2 will debug everything.
 // #define EXT2_FULL_DEBUG
+// If defined, new regular files are mapped by extents, on the filesystems
+// supporting them. The images are plain ext2, so the growth of the extent
+// trees is not tested yet.
+// #define EXT2_EXTENT_ALLOC
 
 #ifdef ENABLE_EXT2_TRACE
 #include "resource_tracing.h"
@@ -20,13 +24,22 @@ static int resource_id = -1;
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/blkdev.h"
 #include "fs/ext2.h"
+#include "fs/pipe.h"
 #include "fs/vfs.h"
 #include "fs/vfs_types.h"
+#include "hardware/timer.h"
+#include "klib/rwlock.h"
+#include "klib/seqlock.h"
 #include "klib/spinlock.h"
 #include "libgen.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/shrinker.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/scheduler.h"
+#include "process/workqueue.h"
 #include "stdio.h"
 #include "string.h"
 #include "sys/stat.h"
@@ -36,6 +49,31 @@ static int resource_id = -1;
 #define EXT2_PATH_MAX          4096   ///< Maximum length of a pathname.
 #define EXT2_MAX_SYMLINK_COUNT 8      ///< Maximum nesting of symlinks, used to prevent a loop.
 #define EXT2_NAME_LEN          255    ///< The lenght of names inside directory entries.
+#define EXT2_BIO_BATCH_SIZE    32     ///< Maximum number of block reads submitted at once to the request queue.
+#define EXT2_READ_RUN_MAX      32     ///< Maximum number of blocks read at once from a device without queue.
+#define EXT2_READAHEAD_MIN     4      ///< Initial read-ahead window, in blocks.
+#define EXT2_READAHEAD_MAX     16     ///< Maximum read-ahead window, in blocks.
+#define EXT2_WRITEBACK_MAX     64     ///< Maximum number of dirty blocks kept in memory.
+#define EXT2_WRITEBACK_SECONDS 5      ///< Interval between two periodic flushes of the dirty blocks.
+#define EXT2_BUFFER_CACHE_MAX  256    ///< Maximum number of blocks kept inside the buffer cache.
+#define EXT2_BUFFER_HASH_SIZE  64     ///< Number of buckets of the buffer cache hash table.
+#define EXT2_INODE_CACHE_MAX   128    ///< Maximum number of inodes kept inside the inode cache.
+#define EXT2_INODE_HASH_SIZE   32     ///< Number of buckets of the inode cache hash table.
+#define EXT2_DCACHE_MAX        256    ///< Maximum number of lookups kept inside the dentry cache.
+#define EXT2_DCACHE_HASH_SIZE  64     ///< Number of buckets of the dentry cache hash table.
+#define EXT2_ACTIVE_GROUPS_MAX 16     ///< Maximum number of groups whose bitmaps are kept resident.
+#define EXT2_PREALLOC_MIN      8      ///< Default preallocation window, in blocks.
+#define EXT2_PREALLOC_MAX      64     ///< Maximum preallocation window, in blocks.
+#define EXT2_BMAP_CACHE_SIZE   32     ///< Number of indirect blocks kept inside the block map cache.
+#define EXT2_PAGE_CACHE_MAX    256    ///< Maximum number of pages kept inside the page cache.
+#define EXT2_PAGE_HASH_SIZE    64     ///< Number of buckets of the page cache hash table.
+#define EXT2_INODE_LOCKS       64     ///< Number of locks the inodes are hashed on.
+#define EXT2_RELATIME_SECONDS  86400  ///< With relatime, the age past which the access time is updated anyway.
+
+// Mount options.
+#define EXT2_MOUNT_NOATIME  0x01 ///< The access times are never updated.
+#define EXT2_MOUNT_RELATIME 0x02 ///< The access time is updated only if older than the changes, or than a day.
+#define EXT2_MOUNT_LAZYTIME 0x04 ///< The timestamps reach the inode table only with the other changes, or upon sync.
 
 // Permissions bit.
 #define EXT2_S_ISUID 0x0800 ///< SUID
@@ -54,6 +92,35 @@ static int resource_id = -1;
 #define EXT2_S_IWOTH 0x0002 ///< --------w- : Others can write
 #define EXT2_S_IXOTH 0x0001 ///< ---------x : Others can execute
 
+#define EXT2_FEATURE_COMPAT_DIR_INDEX 0x0020     ///< Directories can be indexed with an HTree.
+#define EXT2_INDEX_FL                 0x00001000 ///< The directory is indexed with an HTree.
+#define EXT2_DX_HASH_LEGACY           0          ///< Legacy hash of the HTree.
+#define EXT2_DX_HASH_HALF_MD4         1          ///< Half MD4 hash of the HTree.
+#define EXT2_DX_HASH_TEA              2          ///< TEA hash of the HTree.
+#define EXT2_DX_HASH_UNSIGNED         3          ///< Offset of the variants hashing names as unsigned chars.
+#define EXT2_DX_MAX_LEVELS            2          ///< Maximum number of index levels (root included).
+#define EXT2_DX_ROOT_OFFSET           24         ///< Offset of the HTree root, after the `.` and `..` entries.
+
+#define EXT4_FEATURE_INCOMPAT_EXTENTS 0x0040     ///< The files can map their blocks with an extent tree.
+#define EXT4_EXTENTS_FL               0x00080000 ///< The inode maps its blocks with an extent tree.
+#define EXT4_EXTENT_MAGIC             0xF30A     ///< Magic number of the nodes of an extent tree.
+#define EXT4_EXTENT_MAX_LEN           32768      ///< Longest initialized extent, longer ones are uninitialized.
+#define EXT4_EXTENT_MAX_DEPTH         5          ///< Maximum depth of an extent tree.
+#define EXT4_EXTENT_ROOT_ENTRIES      4          ///< Entries of the root of an extent tree, inside the inode.
+
+#define EXT2_FEATURE_COMPAT_HAS_JOURNAL   0x0004     ///< The filesystem has a journal (ext3).
+#define EXT2_FEATURE_INCOMPAT_RECOVER     0x0004     ///< The journal must be checked before using the filesystem.
+#define EXT2_JOURNAL_MAGIC                0xC03B3998 ///< Magic number of the blocks of the journal.
+#define EXT2_JOURNAL_DESCRIPTOR_BLOCK     1          ///< Block listing where the following blocks belong.
+#define EXT2_JOURNAL_COMMIT_BLOCK         2          ///< Block closing a complete transaction.
+#define EXT2_JOURNAL_SUPERBLOCK_V1        3          ///< Superblock of the journal, version 1.
+#define EXT2_JOURNAL_SUPERBLOCK_V2        4          ///< Superblock of the journal, version 2.
+#define EXT2_JOURNAL_REVOKE_BLOCK         5          ///< Block listing blocks which must not be replayed.
+#define EXT2_JOURNAL_FLAG_ESCAPE          0x1        ///< The block started with the magic number, which was cleared.
+#define EXT2_JOURNAL_FLAG_SAME_UUID       0x2        ///< The tag is not followed by the UUID.
+#define EXT2_JOURNAL_FLAG_LAST_TAG        0x8        ///< Last tag of the descriptor.
+#define EXT2_JOURNAL_INCOMPAT_REVOKE      0x1        ///< The journal can contain revoke blocks.
+
 // ============================================================================
 // Data Structures
 // ============================================================================
@@ -222,6 +289,31 @@ typedef struct ext2_group_descriptor {
     uint32_t reserved[3];
 } ext2_group_descriptor_t;
 
+/// @brief The header of a node of an extent tree, followed by its entries.
+typedef struct ext2_extent_header {
+    uint16_t magic;      ///< The magic number (EXT4_EXTENT_MAGIC).
+    uint16_t entries;    ///< The number of valid entries.
+    uint16_t max;        ///< The capacity of the node, in entries.
+    uint16_t depth;      ///< The number of levels below the node, 0 for a leaf.
+    uint32_t generation; ///< The generation of the tree, unused.
+} ext2_extent_header_t;
+
+/// @brief An entry of an internal node of an extent tree.
+typedef struct ext2_extent_idx {
+    uint32_t block;   ///< The first block of the file covered by the node below.
+    uint32_t leaf_lo; ///< The low 32 bits of the node below.
+    uint16_t leaf_hi; ///< The high 16 bits of the node below.
+    uint16_t unused;  ///< Unused.
+} ext2_extent_idx_t;
+
+/// @brief An entry of a leaf of an extent tree, mapping a run of consecutive blocks.
+typedef struct ext2_extent {
+    uint32_t block;    ///< The first block of the file.
+    uint16_t len;      ///< The number of blocks, above EXT4_EXTENT_MAX_LEN the extent is uninitialized.
+    uint16_t start_hi; ///< The high 16 bits of the first block on disk.
+    uint32_t start_lo; ///< The low 32 bits of the first block on disk.
+} ext2_extent_t;
+
 /// @brief The ext2 inode.
 typedef struct ext2_inode {
     /// @brief File mode
@@ -261,6 +353,13 @@ typedef struct ext2_inode {
             /// [ 4 byte]
             uint32_t trebly_indir_block;
         } blocks;
+        /// [60 byte] The root of the extent tree, for EXT4_EXTENTS_FL.
+        struct {
+            /// [12 byte]
+            ext2_extent_header_t header;
+            /// [48 byte]
+            ext2_extent_t entries[EXT4_EXTENT_ROOT_ENTRIES];
+        } extents;
         /// [60 byte]
         char symlink[60];
     } data;
@@ -290,14 +389,114 @@ typedef struct ext2_dirent {
     char name[];
 } ext2_dirent_t;
 
+/// @brief The header of the root of an HTree, which follows the `.` and `..`
+/// entries inside the first block of an indexed directory.
+typedef struct ext2_dx_root_info {
+    /// Always zero.
+    uint32_t reserved_zero;
+    /// The hash function used for the names.
+    uint8_t hash_version;
+    /// The length of this structure (8).
+    uint8_t info_length;
+    /// Number of index levels below the root.
+    uint8_t indirect_levels;
+    /// Unused flags.
+    uint8_t unused_flags;
+} ext2_dx_root_info_t;
+
+/// @brief An entry of an HTree node, the names whose hash is between this
+/// entry and the following one are inside `block`. The first entry of a node
+/// has no hash, and stores the count/limit pair of the node in its place.
+typedef struct ext2_dx_entry {
+    /// The lowest hash of the names inside the block.
+    uint32_t hash;
+    /// The index of the block within the directory.
+    uint32_t block;
+} ext2_dx_entry_t;
+
+/// @brief The count/limit pair stored inside the first entry of an HTree node.
+typedef struct ext2_dx_countlimit {
+    /// Maximum number of entries of the node.
+    uint16_t limit;
+    /// Number of entries of the node.
+    uint16_t count;
+} ext2_dx_countlimit_t;
+
+/// @brief An entry of the block map cache, which remembers the indirect block
+/// holding the pointers to the data blocks, below a doubly or trebly indirect
+/// block, so that consecutive lookups do not walk the upper levels again.
+typedef struct ext2_bmap_entry {
+    /// The doubly or trebly indirect block of the inode.
+    uint32_t root;
+    /// The number of the indirect block, below the root.
+    uint32_t index;
+    /// The indirect block, 0 if the entry is empty.
+    uint32_t block;
+} ext2_bmap_entry_t;
+
+/// @brief The header of the blocks of the journal. Like all the fields of the
+/// journal, its fields are stored in big-endian order.
+typedef struct ext2_journal_header {
+    uint32_t magic;     ///< The magic number (EXT2_JOURNAL_MAGIC).
+    uint32_t blocktype; ///< The type of the block.
+    uint32_t sequence;  ///< The transaction the block belongs to.
+} ext2_journal_header_t;
+
+/// @brief The superblock of the journal, stored inside its first block.
+typedef struct ext2_journal_superblock {
+    ext2_journal_header_t header; ///< The header of the block.
+    uint32_t blocksize;           ///< The size of the blocks of the journal.
+    uint32_t maxlen;              ///< The number of blocks of the journal.
+    uint32_t first;               ///< The first block of the log.
+    uint32_t sequence;            ///< The first transaction expected inside the log.
+    uint32_t start;               ///< The block where the log starts, 0 if the log is empty.
+    uint32_t error;               ///< The error number, set upon failures.
+    uint32_t feature_compat;      ///< Compatible features (version 2).
+    uint32_t feature_incompat;    ///< Incompatible features (version 2).
+    uint32_t feature_ro_compat;   ///< Read-only compatible features (version 2).
+    uint8_t uuid[16];             ///< The UUID of the journal.
+} ext2_journal_superblock_t;
+
+/// @brief A tag of a descriptor block, which tells where a logged block belongs.
+typedef struct ext2_journal_tag {
+    uint32_t blocknr; ///< The block of the filesystem.
+    uint32_t flags;   ///< The EXT2_JOURNAL_FLAG_* flags.
+} ext2_journal_tag_t;
+
+/// @brief The in-memory state of the journal of an ext3 filesystem.
+typedef struct ext2_journal {
+    /// If the dirty blocks are written through the journal.
+    bool_t active;
+    /// The inode of the journal.
+    ext2_inode_t inode;
+    /// The superblock of the journal.
+    uint8_t *sb;
+    /// The first block of the log.
+    uint32_t first;
+    /// The number of blocks of the journal.
+    uint32_t maxlen;
+    /// The block where the next transaction is written.
+    uint32_t head;
+    /// The number of the next transaction.
+    uint32_t sequence;
+} ext2_journal_t;
+
 /// @brief The details regarding the filesystem.
 typedef struct ext2_filesystem {
     /// Pointer to the block device.
     vfs_file_t *block_device;
+    /// The request queue of the block device, NULL if it has none.
+    request_queue_t *queue;
     /// Device superblock, contains important information.
     ext2_superblock_t superblock;
     /// Block Group Descriptor / Block groups.
     ext2_group_descriptor_t *block_groups;
+    /// The in-memory state of the block groups.
+    struct ext2_group_info *group_info;
+    /// The groups whose bitmaps are resident, from the least to the most recently used.
+    list_head_t active_groups;
+    /// Number of active groups.
+    uint32_t active_count;
     /// EXT2 memory cache for buffers.
     kmem_cache_t *ext2_buffer_cache;
     /// Root FS node (attached to mountpoint).
@@ -323,10 +522,132 @@ typedef struct ext2_filesystem {
     /// The number of blocks containing the BGDT
     uint32_t bgdt_length;
 
-    /// Spinlock for protecting filesystem operations.
-    spinlock_t spinlock;
+    /// The buffer cache, hashed by block index.
+    list_head_t buffer_hash[EXT2_BUFFER_HASH_SIZE];
+    /// The cached blocks, from the least to the most recently used.
+    list_head_t buffer_lru;
+    /// Number of cached blocks.
+    uint32_t buffer_count;
+    /// The inode cache, hashed by inode number.
+    list_head_t inode_hash[EXT2_INODE_HASH_SIZE];
+    /// The cached inodes, from the least to the most recently used.
+    list_head_t inode_lru;
+    /// Number of cached inodes.
+    uint32_t inode_count;
+    /// Number of cached inodes which are newer than the inode table.
+    uint32_t inode_dirty_count;
+    /// Number of cached inodes whose timestamps only are newer, with lazytime.
+    uint32_t inode_lazy_count;
+    /// The mount options (see EXT2_MOUNT_NOATIME and the others).
+    uint32_t mount_flags;
+    /// The dentry cache, hashed by parent inode and name.
+    list_head_t dentry_hash[EXT2_DCACHE_HASH_SIZE];
+    /// The cached lookups, from the least to the most recently used.
+    list_head_t dentry_lru;
+    /// Number of cached lookups.
+    uint32_t dentry_count;
+    /// The block map cache, indexed by root block and indirect block number.
+    ext2_bmap_entry_t bmap[EXT2_BMAP_CACHE_SIZE];
+    /// The page cache, hashed by inode and page index.
+    list_head_t page_hash[EXT2_PAGE_HASH_SIZE];
+    /// The cached pages, from the least to the most recently used.
+    list_head_t page_lru;
+    /// Number of cached pages.
+    uint32_t page_count;
+    /// Gives the cached pages back once memory runs low.
+    shrinker_t page_shrinker;
+    /// Dirty blocks waiting to be written back, sorted by block index.
+    list_head_t dirty_blocks;
+    /// Number of dirty blocks.
+    uint32_t dirty_count;
+    /// If the superblock and the BGDT in memory are newer than the ones on disk.
+    bool_t metadata_dirty;
+    /// The timer which periodically asks for the dirty blocks to be flushed.
+    struct timer_list *flush_timer;
+    /// Queued by the timer, it flushes the dirty blocks from a worker.
+    work_struct_t flush_work;
+    /// The journal, used when the filesystem has one.
+    ext2_journal_t journal;
+
+    /// Protects the free counters of the superblock, which are read far more
+    /// often than they change.
+    seqlock_t sb_lock;
+    /// Serialize the updates to the data and the entries of an inode, while
+    /// letting its readers share it, an inode uses the lock selected by its
+    /// index. They are sleeping locks, since they are held across disk I/O.
+    rwlock_t inode_locks[EXT2_INODE_LOCKS];
 } ext2_filesystem_t;
 
+/// @brief A block kept inside the buffer cache of the filesystem. Since each
+/// filesystem has its own cache, the block index identifies the block on the
+/// device.
+typedef struct ext2_buffer {
+    /// The index of the block.
+    uint32_t block_index;
+    /// The content of the block.
+    uint8_t *data;
+    /// Number of users of the buffer, buffers in use are never evicted.
+    uint32_t count;
+    /// If the content in memory is newer than the one on disk.
+    bool_t dirty;
+    /// The bio used to write back the block.
+    bio_t *bio;
+    /// Used to place the buffer inside its hash bucket.
+    list_head_t hash;
+    /// Used to place the buffer inside the LRU list.
+    list_head_t lru;
+    /// Used to place the buffer inside the list of dirty blocks.
+    list_head_t list;
+} ext2_buffer_t;
+
+/// @brief The in-memory state of a block group, used by the allocator.
+typedef struct ext2_group_info {
+    /// The block bitmap, pinned inside the buffer cache while the group is active.
+    ext2_buffer_t *block_bitmap;
+    /// The inode bitmap, pinned inside the buffer cache while the group is active.
+    ext2_buffer_t *inode_bitmap;
+    /// All the blocks before this offset are known to be used.
+    uint32_t block_hint;
+    /// All the inodes before this offset are known to be used.
+    uint32_t inode_hint;
+    /// Protects the bitmaps, the hints, and the counters of the group descriptor.
+    spinlock_t lock;
+    /// Used to place the group inside the list of active groups.
+    list_head_t active;
+} ext2_group_info_t;
+
+/// @brief A page of a regular file, kept inside the page cache of the
+/// filesystem. The page holds the data of the file starting from `index *
+/// PAGE_SIZE`, the part past the end of the file is zero.
+typedef struct ext2_page {
+    /// The number of the inode.
+    uint32_t inode_index;
+    /// The index of the page inside the file.
+    uint32_t index;
+    /// The content of the page.
+    uint8_t *data;
+    /// Used to place the page inside its hash bucket.
+    list_head_t hash;
+    /// Used to place the page inside the LRU list.
+    list_head_t lru;
+} ext2_page_t;
+
+/// @brief An inode kept inside the inode cache of the filesystem.
+typedef struct ext2_icache_entry {
+    /// The number of the inode.
+    uint32_t inode_index;
+    /// The content of the inode.
+    ext2_inode_t inode;
+    /// If the content in memory is newer than the one inside the inode table.
+    bool_t dirty;
+    /// If the timestamps in memory are newer, which the periodic writeback ignores.
+    bool_t lazy;
+    /// Used to place the entry inside its hash bucket.
+    list_head_t hash;
+    /// Used to place the entry inside the LRU list.
+    list_head_t lru;
+} ext2_icache_entry_t;
+
 /// @brief Structure used when searching for a directory entry.
 typedef struct ext2_direntry_search {
     /// The inode of the parent directory.
@@ -350,6 +671,22 @@ typedef struct ext2_direntry_search {
     } direntry;
 } ext2_direntry_search_t;
 
+/// @brief The result of a lookup, kept inside the dentry cache.
+typedef struct ext2_dcache_entry {
+    /// The hash of the (parent inode, name) pair.
+    uint32_t hash_value;
+    /// The name we looked for.
+    char name[EXT2_NAME_LEN + 1];
+    /// If the entry does not exist (negative entry).
+    bool_t negative;
+    /// The result of the search, valid for positive entries.
+    ext2_direntry_search_t search;
+    /// Used to place the entry inside its hash bucket.
+    list_head_t hash;
+    /// Used to place the entry inside the LRU list.
+    list_head_t lru;
+} ext2_dcache_entry_t;
+
 // ============================================================================
 // Forward Declaration of Functions
 // ============================================================================
@@ -372,21 +709,36 @@ static int ext2_unlink(const char *path);
 static int ext2_close(vfs_file_t *file);
 static ssize_t ext2_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
 static ssize_t ext2_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static ssize_t ext2_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t ext2_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t ext2_readv_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t ext2_writev_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
 static off_t ext2_lseek(vfs_file_t *file, off_t offset, int whence);
 static int ext2_fstat(vfs_file_t *file, stat_t *stat);
+static int ext2_statat(vfs_file_t *directory, const char *name, stat_t *stat);
 static long ext2_ioctl(vfs_file_t *file, unsigned int request, unsigned long data);
 static ssize_t ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_t count);
 static ssize_t ext2_readlink(const char *path, char *buffer, size_t bufsize);
+static int ext2_symlink(const char *linkname, const char *path);
 static int ext2_fsetattr(vfs_file_t *file, struct iattr *attr);
+static int ext2_fsync(vfs_file_t *file);
+static int ext2_fadvise(vfs_file_t *file, off_t offset, off_t len, int advice);
 
 static int ext2_mkdir(const char *path, mode_t mode);
+static int ext2_mknod(const char *path, mode_t mode, dev_t dev);
 static int ext2_rmdir(const char *path);
 static int ext2_stat(const char *path, stat_t *stat);
 static int ext2_setattr(const char *path, struct iattr *attr);
 static vfs_file_t *ext2_creat(const char *path, mode_t mode);
-static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path);
+static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path, const char *options);
 
 static uint32_t ext2_get_real_block_index(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t block_index);
+static vfs_file_t *ext2_find_vfs_file_with_inode(ext2_filesystem_t *fs, ino_t inode);
+static inline void ext2_bmap_invalidate(ext2_filesystem_t *fs);
+static void ext2_page_invalidate(ext2_filesystem_t *fs, uint32_t inode_index);
+static inline void ext2_readahead_invalidate(ext2_filesystem_t *fs, ino_t inode);
+static int ext2_journal_commit(ext2_filesystem_t *fs);
+static int ext2_journal_checkpoint(ext2_filesystem_t *fs);
 
 // ============================================================================
 // Virtual FileSystem (VFS) Operaions
@@ -398,23 +750,31 @@ static vfs_sys_operations_t ext2_sys_operations = {
     .rmdir_f   = ext2_rmdir,
     .stat_f    = ext2_stat,
     .creat_f   = ext2_creat,
-    .symlink_f = NULL,
+    .symlink_f = ext2_symlink,
     .setattr_f = ext2_setattr,
+    .mknod_f   = ext2_mknod,
 };
 
 /// Filesystem file operations.
 static vfs_file_operations_t ext2_fs_operations = {
-    .open_f     = ext2_open,
-    .unlink_f   = ext2_unlink,
-    .close_f    = ext2_close,
-    .read_f     = ext2_read,
-    .write_f    = ext2_write,
-    .lseek_f    = ext2_lseek,
-    .stat_f     = ext2_fstat,
-    .ioctl_f    = ext2_ioctl,
-    .getdents_f = ext2_getdents,
-    .readlink_f = ext2_readlink,
-    .setattr_f  = ext2_fsetattr,
+    .open_f          = ext2_open,
+    .unlink_f        = ext2_unlink,
+    .close_f         = ext2_close,
+    .read_f          = ext2_read,
+    .write_f         = ext2_write,
+    .lseek_f         = ext2_lseek,
+    .stat_f          = ext2_fstat,
+    .statat_f        = ext2_statat,
+    .ioctl_f         = ext2_ioctl,
+    .getdents_f      = ext2_getdents,
+    .readlink_f      = ext2_readlink,
+    .setattr_f       = ext2_fsetattr,
+    .fsync_f         = ext2_fsync,
+    .readv_f         = ext2_readv,
+    .writev_f        = ext2_writev,
+    .fadvise_f       = ext2_fadvise,
+    .readv_direct_f  = ext2_readv_direct,
+    .writev_direct_f = ext2_writev_direct,
 };
 
 // ============================================================================
@@ -523,7 +883,7 @@ static inline uint8_t *ext2_alloc_cache(ext2_filesystem_t *fs)
     }
 
 #ifdef ENABLE_EXT2_TRACE
-    store_resource_info(resource_id, __RELATIVE_PATH__, 0, cache);
+    store_resource_info(resource_id, __RELATIVE_PATH__, 0, cache, fs->block_size);
 #endif
 
     // Clean the cache.
@@ -877,134 +1237,262 @@ static int __valid_x_permission(task_struct *task, ext2_inode_t *inode)
     return inode->mode & S_IXOTH;
 }
 
-/// @brief Searches for a free inode inside the group data loaded inside the cache.
+/// @brief Reads the superblock from the block device associated with this filesystem.
 /// @param fs the ext2 filesystem structure.
-/// @param cache the cache from which we read the bgdt data.
-/// @param group_offset the output variable where we store the linear indes to the free inode.
-/// @param skip_reserved should we skip reserved inodes.
-/// @return 1 if we found a free inode, 0 otherwise.
-static inline int
-ext2_find_free_inode_in_group(ext2_filesystem_t *fs, uint8_t *cache, uint32_t *group_offset, int skip_reserved)
+/// @return the amount of data we read, or negative value for an error.
+static int ext2_read_superblock(ext2_filesystem_t *fs)
 {
-    for ((*group_offset) = 0; (*group_offset) < fs->superblock.inodes_per_group; ++(*group_offset)) {
-        // If we need to skip the reserved inodes, we skip the round if the
-        // index is that of a reserved inode (superblock.first_ino).
-        if (skip_reserved && ((*group_offset) < fs->superblock.first_ino)) {
-            continue;
-        }
-        // Check if the entry is free.
-        if (!ext2_bitmap_check(cache, *group_offset)) {
-            return 1;
+    pr_debug("Read superblock for EXT2 filesystem (0x%x)\n", fs);
+    return vfs_read(fs->block_device, &fs->superblock, 1024, sizeof(ext2_superblock_t));
+}
+
+/// @brief Writes the superblock on the block device associated with this filesystem.
+/// @param fs the ext2 filesystem structure.
+/// @return the amount of data we wrote, or negative value for an error.
+static int ext2_write_superblock(ext2_filesystem_t *fs)
+{
+    pr_debug("Write superblock for EXT2 filesystem (0x%x)\n", fs);
+    return vfs_write(fs->block_device, &fs->superblock, 1024, sizeof(ext2_superblock_t));
+}
+
+/// @brief Searches for a block inside the buffer cache.
+/// @param fs the ext2 filesystem structure.
+/// @param block_index the index of the block.
+/// @return a pointer to the buffer, NULL if the block is not cached.
+static inline ext2_buffer_t *ext2_buffer_find(ext2_filesystem_t *fs, uint32_t block_index)
+{
+    list_for_each_decl (it, &fs->buffer_hash[block_index % EXT2_BUFFER_HASH_SIZE]) {
+        ext2_buffer_t *buffer = list_entry(it, ext2_buffer_t, hash);
+        if (buffer->block_index == block_index) {
+            return buffer;
         }
     }
-    return 0;
+    return NULL;
 }
 
-/// @brief Searches for a free inode inside the Block Group Descriptor Table (BGDT).
+/// @brief Marks a cached block as dirty, keeping the dirty list sorted.
 /// @param fs the ext2 filesystem structure.
-/// @param cache the cache from which we read the bgdt data.
-/// @param group_index the output variable where we store the group index.
-/// @param group_offset the output variable where we store the linear indes to the free inode.
-/// @param preferred_group we accept a preferred group, but only if available.
-/// @return 1 if we found a free inode, 0 otherwise.
-static inline int ext2_find_free_inode(
-    ext2_filesystem_t *fs,
-    uint8_t *cache,
-    uint32_t *group_index,
-    uint32_t *group_offset,
-    uint32_t preferred_group)
+/// @param buffer the buffer.
+static inline void ext2_buffer_mark_dirty(ext2_filesystem_t *fs, ext2_buffer_t *buffer)
 {
-    // If we received a preference, try to find a free inode in that specific group.
-    if (preferred_group != 0) {
-        // Set the group index to the preferred group.
-        (*group_index) = preferred_group;
-        // Find the first free inode. We need to ask to skip reserved inodes,
-        // only if we are in group 0.
-        if (ext2_find_free_inode_in_group(fs, cache, group_offset, (*group_index) == 0)) {
-            return 1;
-        }
+    if (buffer->dirty) {
+        return;
     }
-    // Get the group and bit index of the first free block.
-    for ((*group_index) = 0; (*group_index) < fs->block_groups_count; ++(*group_index)) {
-        // Check if there are free inodes in this block group.
-        if (fs->block_groups[(*group_index)].free_inodes_count > 0) {
-            // Read the block bitmap.
-            if (ext2_read_block(fs, fs->block_groups[(*group_index)].inode_bitmap, cache) < 0) {
-                pr_err("Failed to read the inode bitmap for group `%d`.\n", (*group_index));
-                return 0;
-            }
-            // Find the first free inode. We need to ask to skip reserved
-            // inodes, only if we are in group 0.
-            if (ext2_find_free_inode_in_group(fs, cache, group_offset, (*group_index) == 0)) {
-                return 1;
-            }
+    list_head_t *location = &fs->dirty_blocks;
+    list_for_each_decl (it, &fs->dirty_blocks) {
+        if (list_entry(it, ext2_buffer_t, list)->block_index > buffer->block_index) {
+            location = it;
+            break;
         }
     }
-    return 0;
+    list_head_insert_before(&buffer->list, location);
+    buffer->dirty = true;
+    ++fs->dirty_count;
+}
+
+/// @brief Removes a buffer from the cache, and frees it.
+/// @param fs the ext2 filesystem structure.
+/// @param buffer the buffer, which must be clean and unused.
+static inline void ext2_buffer_free(ext2_filesystem_t *fs, ext2_buffer_t *buffer)
+{
+    list_head_remove(&buffer->hash);
+    list_head_remove(&buffer->lru);
+    --fs->buffer_count;
+    ext2_dealloc_cache(buffer->data);
+    kfree(buffer);
 }
 
-/// @brief Searches for a free block inside the group data loaded inside the cache.
+static int ext2_writeback_flush(ext2_filesystem_t *fs);
+
+/// @brief Evicts the least recently used block which is clean and unused.
 /// @param fs the ext2 filesystem structure.
-/// @param cache the cache from which we read the bgdt data.
-/// @param block_offset the output variable where we store the linear indes to the free block.
-/// @return 1 if we found a free block, 0 otherwise.
-static inline int ext2_find_free_block_in_group(ext2_filesystem_t *fs, uint8_t *cache, uint32_t *block_offset)
-{
-    for ((*block_offset) = 0; (*block_offset) < fs->superblock.blocks_per_group; ++(*block_offset)) {
-        // Check if the entry is free.
-        if (!ext2_bitmap_check(cache, *block_offset)) {
+/// @return 1 if a block was evicted, 0 otherwise.
+static inline int ext2_buffer_evict(ext2_filesystem_t *fs)
+{
+    list_for_each_decl (it, &fs->buffer_lru) {
+        ext2_buffer_t *buffer = list_entry(it, ext2_buffer_t, lru);
+        if ((buffer->count == 0) && !buffer->dirty) {
+            ext2_buffer_free(fs, buffer);
             return 1;
         }
     }
     return 0;
 }
 
-/// @brief Searches for a free block.
+/// @brief Returns the buffer of a block, taking a reference on it.
+/// @details If the block is not cached, a new buffer is created, and the block
+/// is read from disk, unless the caller is going to overwrite it entirely.
 /// @param fs the ext2 filesystem structure.
-/// @param cache the cache from which we read the bgdt data.
-/// @param group_index the output variable where we store the group index.
-/// @param block_offset the output variable where we store the linear indes to the free block.
-/// @return 1 if we found a free block, 0 otherwise.
-static inline int
-ext2_find_free_block(ext2_filesystem_t *fs, uint8_t *cache, uint32_t *group_index, uint32_t *block_offset)
+/// @param block_index the index of the block.
+/// @param read if the content must be read from disk on a miss.
+/// @return a pointer to the buffer, NULL on failure.
+static ext2_buffer_t *ext2_buffer_get(ext2_filesystem_t *fs, uint32_t block_index, int read)
 {
-    // Get the group and bit index of the first free block.
-    for ((*group_index) = 0; (*group_index) < fs->block_groups_count; ++(*group_index)) {
-        // Check if there are free blocks in this block group.
-        if (fs->block_groups[(*group_index)].free_blocks_count > 0) {
-            // Read the block bitmap.
-            if (ext2_read_block(fs, fs->block_groups[(*group_index)].block_bitmap, cache) < 0) {
-                pr_err("Failed to read the block bitmap for group `%d`.\n", (*group_index));
-                return 0;
+    ext2_buffer_t *buffer = ext2_buffer_find(fs, block_index);
+    if (buffer) {
+        // Move the buffer at the end of the LRU list.
+        list_head_remove(&buffer->lru);
+        list_head_insert_before(&buffer->lru, &fs->buffer_lru);
+        ++buffer->count;
+        return buffer;
+    }
+    // Make room for the new buffer, writing back the dirty ones if needed.
+    if ((fs->buffer_count >= EXT2_BUFFER_CACHE_MAX) && !ext2_buffer_evict(fs)) {
+        ext2_writeback_flush(fs);
+        if (!ext2_buffer_evict(fs)) {
+            return NULL;
+        }
+    }
+    buffer = kmalloc(sizeof(ext2_buffer_t));
+    if (!buffer) {
+        return NULL;
+    }
+    if ((buffer->data = ext2_alloc_cache(fs)) == NULL) {
+        kfree(buffer);
+        return NULL;
+    }
+    if (read && (vfs_read(fs->block_device, buffer->data, block_index * fs->block_size, fs->block_size) < 0)) {
+        ext2_dealloc_cache(buffer->data);
+        kfree(buffer);
+        return NULL;
+    }
+    buffer->block_index = block_index;
+    buffer->count       = 1;
+    buffer->dirty       = false;
+    buffer->bio         = NULL;
+    list_head_init(&buffer->list);
+    list_head_insert_before(&buffer->hash, &fs->buffer_hash[block_index % EXT2_BUFFER_HASH_SIZE]);
+    list_head_insert_before(&buffer->lru, &fs->buffer_lru);
+    ++fs->buffer_count;
+    return buffer;
+}
+
+/// @brief Releases a reference taken with ext2_buffer_get().
+/// @param buffer the buffer.
+static inline void ext2_buffer_put(ext2_buffer_t *buffer)
+{
+    assert(buffer->count && "Releasing a buffer which is not in use.");
+    --buffer->count;
+}
+
+/// @brief Writes back all the dirty blocks, which stay inside the cache.
+/// @details When the device has a request queue, all the blocks are submitted
+/// at once, so that the elevator can merge the adjacent ones. When the
+/// filesystem has a journal, the dirty blocks, which carry the changes of all
+/// the operations since the last flush, are first committed to the journal as
+/// a single transaction.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success, -1 if at least one block failed to be written.
+static int ext2_writeback_flush(ext2_filesystem_t *fs)
+{
+    uint32_t sectors_per_block = fs->block_size / BLK_SECTOR_SIZE;
+    int ret                    = 0;
+    if (list_head_empty(&fs->dirty_blocks)) {
+        return 0;
+    }
+    // Commit the blocks to the journal, before writing them in place.
+    int journaled = fs->journal.active && (ext2_journal_commit(fs) == 0);
+    // Submit all the blocks, the ones we fail to submit are written directly.
+    list_for_each_decl (it, &fs->dirty_blocks) {
+        ext2_buffer_t *dirty = list_entry(it, ext2_buffer_t, list);
+        dirty->bio           = NULL;
+        // Keep the buffer in use while it is being written.
+        ++dirty->count;
+        if (fs->queue) {
+            dirty->bio = bio_alloc(dirty->block_index * sectors_per_block, sectors_per_block, dirty->data, 1);
+            if (dirty->bio && (blk_submit_bio(fs->queue, dirty->bio) < 0)) {
+                bio_free(dirty->bio);
+                dirty->bio = NULL;
             }
-            // Find the first free block.
-            if (ext2_find_free_block_in_group(fs, cache, block_offset)) {
-                return 1;
+        }
+        if (!dirty->bio &&
+            (vfs_write(fs->block_device, dirty->data, dirty->block_index * fs->block_size, fs->block_size) < 0)) {
+            pr_err("Failed to write back block %u.\n", dirty->block_index);
+            ret = -1;
+        }
+    }
+    // Dispatch the writes.
+    blk_run_queue(fs->queue);
+    // Mark the blocks as clean.
+    list_for_each_safe_decl(it, store, &fs->dirty_blocks)
+    {
+        ext2_buffer_t *dirty = list_entry(it, ext2_buffer_t, list);
+        if (dirty->bio) {
+            if (dirty->bio->status < 0) {
+                pr_err("Failed to write back block %u.\n", dirty->block_index);
+                ret = -1;
             }
+            bio_free(dirty->bio);
+            dirty->bio = NULL;
         }
+        list_head_remove(&dirty->list);
+        dirty->dirty = false;
+        ext2_buffer_put(dirty);
+    }
+    fs->dirty_count = 0;
+    // The blocks are in place, the transaction is not needed anymore.
+    if (journaled && (ext2_journal_checkpoint(fs) < 0)) {
+        pr_err("Failed to checkpoint the journal.\n");
+        ret = -1;
     }
-    return 0;
+    return ret;
 }
 
-/// @brief Reads the superblock from the block device associated with this filesystem.
-/// @param fs the ext2 filesystem structure.
-/// @return the amount of data we read, or negative value for an error.
-static int ext2_read_superblock(ext2_filesystem_t *fs)
+static void ext2_icache_sync(ext2_filesystem_t *fs, int lazy);
+static int ext2_metadata_sync(ext2_filesystem_t *fs);
+
+/// @brief Flushes the dirty inodes and blocks, from the worker the timer
+/// queued the work on.
+/// @param work the work embedded inside the filesystem.
+static void ext2_writeback_work(work_struct_t *work)
 {
-    pr_debug("Read superblock for EXT2 filesystem (0x%x)\n", fs);
-    return vfs_read(fs->block_device, &fs->superblock, 1024, sizeof(ext2_superblock_t));
+    ext2_filesystem_t *fs = list_entry(work, ext2_filesystem_t, flush_work);
+    // With lazytime, the timestamps wait for a sync, or for the inode to be evicted.
+    ext2_icache_sync(fs, 0);
+    ext2_metadata_sync(fs);
+    ext2_writeback_flush(fs);
 }
 
-/// @brief Writes the superblock on the block device associated with this filesystem.
+static void ext2_writeback_arm(ext2_filesystem_t *fs);
+
+/// @brief Called periodically by the timer, it asks for the dirty blocks to be
+/// flushed.
+/// @details Timers run in interrupt context, where the flush cannot sleep
+/// waiting for the disk, so the flush itself runs from a worker.
+/// @param data a pointer to the filesystem.
+static void ext2_writeback_timeout(unsigned long data)
+{
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)data;
+    // Ask for a flush, if there is something to flush.
+    if (fs->dirty_count || fs->inode_dirty_count || fs->metadata_dirty) {
+        schedule_work(&fs->flush_work);
+    }
+    // Restart the timer, the old one is going to be deleted.
+    ext2_writeback_arm(fs);
+}
+
+/// @brief Starts the timer which periodically asks for a flush.
 /// @param fs the ext2 filesystem structure.
-/// @return the amount of data we wrote, or negative value for an error.
-static int ext2_write_superblock(ext2_filesystem_t *fs)
+static void ext2_writeback_arm(ext2_filesystem_t *fs)
 {
-    pr_debug("Write superblock for EXT2 filesystem (0x%x)\n", fs);
-    return vfs_write(fs->block_device, &fs->superblock, 1024, sizeof(ext2_superblock_t));
+    struct timer_list *timer = kmalloc(sizeof(struct timer_list));
+    if (!timer) {
+        pr_err("Failed to allocate the write-back timer.\n");
+        fs->flush_timer = NULL;
+        return;
+    }
+    memset(timer, 0, sizeof(struct timer_list));
+    init_timer(timer);
+    timer->expires  = timer_get_ticks() + EXT2_WRITEBACK_SECONDS * TICKS_PER_SECOND;
+    timer->function = &ext2_writeback_timeout;
+    timer->data     = (unsigned long)fs;
+    add_timer(timer);
+    fs->flush_timer = timer;
 }
 
 /// @brief Read a block from the block device associated with this filesystem.
+/// @details The block goes through the buffer cache, so that the metadata
+/// blocks which are read over and over are served from memory.
 /// @param fs the ext2 filesystem structure.
 /// @param block_index the index of the block we want to read.
 /// @param buffer the buffer where the content will be placed.
@@ -1019,10 +1507,20 @@ static int ext2_read_block(ext2_filesystem_t *fs, uint32_t block_index, uint8_t
         pr_err("You are trying to read with a NULL buffer.\n");
         return -1;
     }
+    // Go through the buffer cache.
+    ext2_buffer_t *cached = ext2_buffer_get(fs, block_index, 1);
+    if (cached) {
+        memcpy(buffer, cached->data, fs->block_size);
+        ext2_buffer_put(cached);
+        return fs->block_size;
+    }
+    // If we cannot cache the block, read it directly.
     return vfs_read(fs->block_device, buffer, block_index * fs->block_size, fs->block_size);
 }
 
 /// @brief Writes a block on the block device associated with this filesystem.
+/// @details The block is kept inside the buffer cache, and written back later
+/// on, either periodically, when there are too many dirty blocks, or upon sync.
 /// @param fs the ext2 filesystem structure.
 /// @param block_index the index of the block we want to read.
 /// @param buffer the buffer where the content will be placed.
@@ -1037,7 +1535,20 @@ static int ext2_write_block(ext2_filesystem_t *fs, uint32_t block_index, uint8_t
         pr_err("You are trying to write with a NULL buffer.\n");
         return -1;
     }
-    return vfs_write(fs->block_device, buffer, block_index * fs->block_size, fs->block_size);
+    // The whole block is overwritten, there is no need to read it.
+    ext2_buffer_t *cached = ext2_buffer_get(fs, block_index, 0);
+    if (!cached) {
+        // If we cannot buffer the block, write it directly.
+        return vfs_write(fs->block_device, buffer, block_index * fs->block_size, fs->block_size);
+    }
+    // Make room for the new dirty block.
+    if (!cached->dirty && (fs->dirty_count >= EXT2_WRITEBACK_MAX)) {
+        ext2_writeback_flush(fs);
+    }
+    memcpy(cached->data, buffer, fs->block_size);
+    ext2_buffer_mark_dirty(fs, cached);
+    ext2_buffer_put(cached);
+    return fs->block_size;
 }
 
 /// @brief Reads the Block Group Descriptor Table (BGDT) from the block device associated with this filesystem.
@@ -1072,12 +1583,350 @@ static int ext2_write_bgdt(ext2_filesystem_t *fs)
     return 0;
 }
 
-/// @brief Reads an inode.
+/// @brief Marks the superblock and the BGDT as changed, they are written back
+/// together with the dirty blocks, instead of upon every change.
+/// @param fs the ext2 filesystem structure.
+static inline void ext2_metadata_mark_dirty(ext2_filesystem_t *fs) { fs->metadata_dirty = true; }
+
+/// @brief Writes back the superblock and the BGDT, if they changed.
+/// @details The BGDT goes through the buffer cache, so it reaches the disk
+/// with the next flush of the dirty blocks.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success, -1 on failure.
+static int ext2_metadata_sync(ext2_filesystem_t *fs)
+{
+    if (!fs->metadata_dirty) {
+        return 0;
+    }
+    fs->metadata_dirty = false;
+    if (ext2_write_bgdt(fs) < 0) {
+        pr_warning("Failed to write BGDT.\n");
+        return -1;
+    }
+    if (ext2_write_superblock(fs) < 0) {
+        pr_warning("Failed to write superblock.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Returns a bitmap of a group, keeping it resident inside the buffer
+/// cache while the group is active.
+/// @details When too many groups are active, the bitmaps of the least recently
+/// used one are released, and can be evicted from the buffer cache.
+/// @param fs the ext2 filesystem structure.
+/// @param group_index the index of the group.
+/// @param inode if we want the inode bitmap (1) or the block bitmap (0).
+/// @return a pointer to the buffer containing the bitmap, NULL on failure.
+static ext2_buffer_t *ext2_group_bitmap(ext2_filesystem_t *fs, uint32_t group_index, int inode)
+{
+    ext2_group_info_t *info = &fs->group_info[group_index];
+    ext2_buffer_t **bitmap  = inode ? &info->inode_bitmap : &info->block_bitmap;
+    if (info->block_bitmap || info->inode_bitmap) {
+        // Move the group at the end of the list of active groups.
+        list_head_remove(&info->active);
+        list_head_insert_before(&info->active, &fs->active_groups);
+    } else {
+        // Deactivate the least recently used group.
+        if (fs->active_count >= EXT2_ACTIVE_GROUPS_MAX) {
+            ext2_group_info_t *victim = list_entry(fs->active_groups.next, ext2_group_info_t, active);
+            if (victim->block_bitmap) {
+                ext2_buffer_put(victim->block_bitmap);
+                victim->block_bitmap = NULL;
+            }
+            if (victim->inode_bitmap) {
+                ext2_buffer_put(victim->inode_bitmap);
+                victim->inode_bitmap = NULL;
+            }
+            list_head_remove(&victim->active);
+            --fs->active_count;
+        }
+        list_head_insert_before(&info->active, &fs->active_groups);
+        ++fs->active_count;
+    }
+    if (*bitmap == NULL) {
+        // The reference we take is released when the group is deactivated.
+        *bitmap = ext2_buffer_get(
+            fs, inode ? fs->block_groups[group_index].inode_bitmap : fs->block_groups[group_index].block_bitmap, 1);
+        if (*bitmap == NULL) {
+            pr_err("Failed to read the %s bitmap for group `%u`.\n", inode ? "inode" : "block", group_index);
+            if (!info->block_bitmap && !info->inode_bitmap) {
+                list_head_remove(&info->active);
+                --fs->active_count;
+            }
+        }
+    }
+    return *bitmap;
+}
+
+/// @brief Searches for a bit at zero inside a range of a bitmap, checking 32
+/// bits at a time.
+/// @param bitmap the bitmap.
+/// @param from the first bit of the range.
+/// @param to the bit following the last one of the range.
+/// @return the index of the bit, or `to` if all the bits are set.
+static inline uint32_t ext2_bitmap_find_zero(uint8_t *bitmap, uint32_t from, uint32_t to)
+{
+    const uint32_t *words = (const uint32_t *)bitmap;
+    for (uint32_t offset = from; offset < to; offset = (offset & ~31U) + 32) {
+        // Consider the bits before the offset as set.
+        uint32_t word = words[offset / 32] | ((1U << (offset % 32)) - 1);
+        if (word != 0xFFFFFFFFU) {
+            return min((offset & ~31U) + find_first_zero(word), to);
+        }
+    }
+    return to;
+}
+
+/// @brief Updates the free counters of the superblock.
+/// @param fs the ext2 filesystem structure.
+/// @param blocks the change in the number of free blocks.
+/// @param inodes the change in the number of free inodes.
+static inline void ext2_superblock_add_free(ext2_filesystem_t *fs, int32_t blocks, int32_t inodes)
+{
+    seqlock_write_lock(&fs->sb_lock);
+    fs->superblock.free_blocks_count += blocks;
+    fs->superblock.free_inodes_count += inodes;
+    seqlock_write_unlock(&fs->sb_lock);
+}
+
+/// @brief Returns the lock of an inode.
+/// @param fs the ext2 filesystem structure.
+/// @param inode_index the index of the inode.
+/// @return a pointer to the lock.
+static inline rwlock_t *ext2_inode_lock_of(ext2_filesystem_t *fs, uint32_t inode_index)
+{
+    return &fs->inode_locks[inode_index % EXT2_INODE_LOCKS];
+}
+
+/// @brief Locks two inodes for writing, they might share the same lock.
+/// @details Locks are always taken in the same order, so that two operations
+/// locking the same inodes cannot wait for each other.
+/// @param fs the ext2 filesystem structure.
+/// @param first the index of the first inode.
+/// @param second the index of the second inode, it can be equal to the first one.
+static inline void ext2_inode_lock_pair(ext2_filesystem_t *fs, uint32_t first, uint32_t second)
+{
+    rwlock_t *a = ext2_inode_lock_of(fs, first);
+    rwlock_t *b = ext2_inode_lock_of(fs, second);
+    if (a > b) {
+        rwlock_t *tmp = a;
+        a = b, b = tmp;
+    }
+    rwlock_write_lock(a);
+    if (b != a) {
+        rwlock_write_lock(b);
+    }
+}
+
+/// @brief Unlocks two inodes locked with ext2_inode_lock_pair().
+/// @param fs the ext2 filesystem structure.
+/// @param first the index of the first inode.
+/// @param second the index of the second inode.
+static inline void ext2_inode_unlock_pair(ext2_filesystem_t *fs, uint32_t first, uint32_t second)
+{
+    rwlock_t *a = ext2_inode_lock_of(fs, first);
+    rwlock_t *b = ext2_inode_lock_of(fs, second);
+    if (b != a) {
+        rwlock_write_unlock(b);
+    }
+    rwlock_write_unlock(a);
+}
+
+/// @brief Searches for a free inode inside a group.
+/// @details The bitmap is read before taking the lock of the group, so that
+/// the lock is never held while waiting for the device.
+/// @param fs the ext2 filesystem structure.
+/// @param group_index the index of the group.
+/// @param group_offset the output variable where we store the offset of the inode inside the group.
+/// @return 1 if we found a free inode, in which case the lock of the group is
+/// held, 0 otherwise.
+static inline int ext2_find_free_inode_in_group(ext2_filesystem_t *fs, uint32_t group_index, uint32_t *group_offset)
+{
+    ext2_group_info_t *info = &fs->group_info[group_index];
+    if (fs->block_groups[group_index].free_inodes_count == 0) {
+        return 0;
+    }
+    ext2_buffer_t *bitmap = ext2_group_bitmap(fs, group_index, 1);
+    if (!bitmap) {
+        return 0;
+    }
+    spinlock_lock(&info->lock);
+    // Skip the inodes reserved by the filesystem, which are in group 0.
+    uint32_t first   = max(info->inode_hint, (group_index == 0) ? fs->superblock.first_ino : 0);
+    *group_offset    = ext2_bitmap_find_zero(bitmap->data, first, fs->superblock.inodes_per_group);
+    // All the inodes before the free one are used.
+    info->inode_hint = *group_offset;
+    if (*group_offset < fs->superblock.inodes_per_group) {
+        return 1;
+    }
+    spinlock_unlock(&info->lock);
+    return 0;
+}
+
+/// @brief Searches for a free inode.
+/// @param fs the ext2 filesystem structure.
+/// @param group_index the output variable where we store the group index.
+/// @param group_offset the output variable where we store the offset of the inode inside the group.
+/// @param preferred_group we accept a preferred group, but only if available.
+/// @return 1 if we found a free inode, in which case the lock of the group is
+/// held, 0 otherwise.
+static inline int
+ext2_find_free_inode(ext2_filesystem_t *fs, uint32_t *group_index, uint32_t *group_offset, uint32_t preferred_group)
+{
+    // If we received a preference, try to find a free inode in that specific group.
+    if (preferred_group < fs->block_groups_count) {
+        (*group_index) = preferred_group;
+        if (ext2_find_free_inode_in_group(fs, *group_index, group_offset)) {
+            return 1;
+        }
+    }
+    for ((*group_index) = 0; (*group_index) < fs->block_groups_count; ++(*group_index)) {
+        if (ext2_find_free_inode_in_group(fs, *group_index, group_offset)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Chooses the group of a new inode, following the Orlov policy.
+/// @details
+///  - directories created inside the root are spread across the groups: among
+///    the groups with more free inodes and blocks than the average, the one
+///    with the fewest directories is chosen, so that unrelated trees do not
+///    share groups.
+///  - other directories stay close to their parent: the first group, starting
+///    from the one of the parent, which is not crowded with directories and
+///    is not short of free inodes and blocks is chosen.
+///  - files go in the group of their parent directory, if it has free inodes
+///    and blocks, otherwise in the first suitable group found with a
+///    quadratic probe starting from it.
+/// @param fs the ext2 filesystem structure.
+/// @param parent_index the inode of the parent directory.
+/// @param directory if the new inode is a directory.
+/// @return the index of the group we prefer for the new inode.
+static uint32_t ext2_find_inode_group(ext2_filesystem_t *fs, uint32_t parent_index, int directory)
+{
+    ext2_group_descriptor_t *gd = fs->block_groups;
+    uint32_t groups             = fs->block_groups_count;
+    uint32_t parent_group       = ext2_inode_index_to_group_index(fs, parent_index);
+    uint32_t avg_free_inodes, avg_free_blocks, sequence;
+    // Read the two counters of the same update.
+    do {
+        sequence        = seqlock_read_begin(&fs->sb_lock);
+        avg_free_inodes = fs->superblock.free_inodes_count / groups;
+        avg_free_blocks = fs->superblock.free_blocks_count / groups;
+    } while (seqlock_read_retry(&fs->sb_lock, sequence));
+    if (!directory) {
+        for (uint32_t step = 0; step < groups; step = step ? (step << 1) : 1) {
+            uint32_t group_index = (parent_group + step) % groups;
+            if (gd[group_index].free_inodes_count && gd[group_index].free_blocks_count) {
+                return group_index;
+            }
+        }
+        return parent_group;
+    }
+    if (fs->root && (parent_index == fs->root->ino)) {
+        // Start from a different group every time, to spread the ties.
+        uint32_t start = timer_get_ticks() % groups;
+        uint32_t best  = groups;
+        for (uint32_t i = 0; i < groups; ++i) {
+            uint32_t group_index = (start + i) % groups;
+            if (!gd[group_index].free_inodes_count || (gd[group_index].free_inodes_count < avg_free_inodes) ||
+                (gd[group_index].free_blocks_count < avg_free_blocks)) {
+                continue;
+            }
+            if ((best == groups) || (gd[group_index].used_dirs_count < gd[best].used_dirs_count)) {
+                best = group_index;
+            }
+        }
+        if (best < groups) {
+            return best;
+        }
+    } else {
+        uint32_t total_dirs = 0;
+        for (uint32_t i = 0; i < groups; ++i) {
+            total_dirs += gd[i].used_dirs_count;
+        }
+        // Accept groups with a few more directories than the average, and a
+        // quarter of a group less free inodes and blocks (at least one).
+        uint32_t max_dirs   = (total_dirs / groups) + (fs->superblock.inodes_per_group / 16);
+        uint32_t min_inodes = max(avg_free_inodes, fs->superblock.inodes_per_group / 4 + 1) -
+                              fs->superblock.inodes_per_group / 4;
+        uint32_t min_blocks = max(avg_free_blocks, fs->superblock.blocks_per_group / 4 + 1) -
+                              fs->superblock.blocks_per_group / 4;
+        for (uint32_t i = 0; i < groups; ++i) {
+            uint32_t group_index = (parent_group + i) % groups;
+            if ((gd[group_index].used_dirs_count < max_dirs) && (gd[group_index].free_inodes_count >= min_inodes) &&
+                (gd[group_index].free_blocks_count >= min_blocks)) {
+                return group_index;
+            }
+        }
+    }
+    // Fall back to the first group with an average number of free inodes.
+    for (uint32_t i = 0; i < groups; ++i) {
+        uint32_t group_index = (parent_group + i) % groups;
+        if (gd[group_index].free_inodes_count && (gd[group_index].free_inodes_count >= avg_free_inodes)) {
+            return group_index;
+        }
+    }
+    return parent_group;
+}
+
+/// @brief Searches for a free block, as close as possible to the goal.
+/// @param fs the ext2 filesystem structure.
+/// @param goal the block we would like to get, its group is searched first.
+/// @param group_index the output variable where we store the group index.
+/// @param block_offset the output variable where we store the offset of the block inside the group.
+/// @return 1 if we found a free block, in which case the lock of the group is
+/// held, 0 otherwise.
+static inline int
+ext2_find_free_block(ext2_filesystem_t *fs, uint32_t goal, uint32_t *group_index, uint32_t *block_offset)
+{
+    uint32_t goal_group  = ext2_block_index_to_group_index(fs, goal);
+    uint32_t goal_offset = ext2_block_index_to_group_offset(fs, goal);
+    if (goal_group >= fs->block_groups_count) {
+        goal_group = goal_offset = 0;
+    }
+    for (uint32_t i = 0; i < fs->block_groups_count; ++i) {
+        // Scanning the bitmaps of a large filesystem takes a while.
+        cond_resched();
+        (*group_index)          = (goal_group + i) % fs->block_groups_count;
+        ext2_group_info_t *info = &fs->group_info[*group_index];
+        // Check if there are free blocks in this block group.
+        if (fs->block_groups[*group_index].free_blocks_count == 0) {
+            continue;
+        }
+        // Read the bitmap before taking the lock, it might need the device.
+        ext2_buffer_t *bitmap = ext2_group_bitmap(fs, *group_index, 0);
+        if (!bitmap) {
+            return 0;
+        }
+        spinlock_lock(&info->lock);
+        // Inside the group of the goal, look after the goal first.
+        if ((i == 0) && (goal_offset > info->block_hint)) {
+            *block_offset = ext2_bitmap_find_zero(bitmap->data, goal_offset, fs->superblock.blocks_per_group);
+            if (*block_offset < fs->superblock.blocks_per_group) {
+                return 1;
+            }
+        }
+        *block_offset    = ext2_bitmap_find_zero(bitmap->data, info->block_hint, fs->superblock.blocks_per_group);
+        // All the blocks before the free one are used.
+        info->block_hint = *block_offset;
+        if (*block_offset < fs->superblock.blocks_per_group) {
+            return 1;
+        }
+        spinlock_unlock(&info->lock);
+    }
+    return 0;
+}
+
+/// @brief Reads an inode from the inode table.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
 /// @param inode_index The index of the inode.
 /// @return 0 on success, -1 on failure.
-static int ext2_read_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+static int ext2_load_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
 {
     uint32_t group_index;
     uint32_t block_index;
@@ -1117,12 +1966,12 @@ static int ext2_read_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t
     return 0;
 }
 
-/// @brief Writes the inode.
+/// @brief Writes an inode inside the inode table.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
 /// @param inode_index The index of the inode.
 /// @return 0 on success, -1 on failure.
-static int ext2_write_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+static int ext2_store_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
 {
     uint32_t group_index;
     uint32_t block_index;
@@ -1163,121 +2012,342 @@ static int ext2_write_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t
     return 0;
 }
 
-/// @brief Allocate a new inode.
+/// @brief Searches for an inode inside the inode cache.
 /// @param fs the filesystem.
-/// @param preferred_group the preferred group.
-/// @return index of the inode.
-/// @details
-/// Here are the rules used to allocate new inodes:
-///  - the inode for a new file is allocated in the same group of the inode of
-///    its parent directory.
-///  - inodes are allocated equally between groups.
-static int ext2_allocate_inode(ext2_filesystem_t *fs, unsigned preferred_group)
+/// @param inode_index the number of the inode.
+/// @return a pointer to the entry, NULL if the inode is not cached.
+static inline ext2_icache_entry_t *ext2_icache_find(ext2_filesystem_t *fs, uint32_t inode_index)
 {
-    uint32_t group_index  = 0;
-    uint32_t group_offset = 0;
-    uint32_t inode_index  = 0;
-    // Lock the filesystem.
-    spinlock_lock(&fs->spinlock);
-    // Allocate the cache.
-    uint8_t *cache = ext2_alloc_cache(fs);
-    // Search for a free inode.
-    if (!ext2_find_free_inode(fs, cache, &group_index, &group_offset, preferred_group)) {
-        pr_err("Failed to find a free inode.\n");
-        // Unlock the filesystem.
-        spinlock_unlock(&fs->spinlock);
-        // Free the cache.
-        ext2_dealloc_cache(cache);
-        return 0;
+    list_for_each_decl (it, &fs->inode_hash[inode_index % EXT2_INODE_HASH_SIZE]) {
+        ext2_icache_entry_t *entry = list_entry(it, ext2_icache_entry_t, hash);
+        if (entry->inode_index == inode_index) {
+            return entry;
+        }
     }
-    // Compute the inode index.
-    inode_index = (group_index * fs->superblock.inodes_per_group) + group_offset + 1U;
+    return NULL;
+}
+
+/// @brief Writes a cached inode back inside the inode table, if it is dirty.
+/// @param fs the filesystem.
+/// @param entry the entry.
+/// @return 0 on success, -1 on failure.
+static inline int ext2_icache_writeback(ext2_filesystem_t *fs, ext2_icache_entry_t *entry)
+{
+    if (!entry->dirty && !entry->lazy) {
+        return 0;
+    }
+    if (ext2_store_inode(fs, &entry->inode, entry->inode_index) < 0) {
+        pr_err("Failed to write back inode %u.\n", entry->inode_index);
+        return -1;
+    }
+    fs->inode_dirty_count -= entry->dirty;
+    fs->inode_lazy_count -= entry->lazy;
+    entry->dirty = false;
+    entry->lazy  = false;
+    return 0;
+}
+
+/// @brief Returns the cache entry of an inode, creating it if needed.
+/// @param fs the filesystem.
+/// @param inode_index the number of the inode.
+/// @param read if the inode must be read from the inode table on a miss.
+/// @return a pointer to the entry, NULL on failure.
+static ext2_icache_entry_t *ext2_icache_get(ext2_filesystem_t *fs, uint32_t inode_index, int read)
+{
+    ext2_icache_entry_t *entry = ext2_icache_find(fs, inode_index);
+    if (entry) {
+        // Move the entry at the end of the LRU list.
+        list_head_remove(&entry->lru);
+        list_head_insert_before(&entry->lru, &fs->inode_lru);
+        return entry;
+    }
+    if (fs->inode_count >= EXT2_INODE_CACHE_MAX) {
+        // Recycle the least recently used entry, after writing it back.
+        entry = list_entry(fs->inode_lru.next, ext2_icache_entry_t, lru);
+        if (ext2_icache_writeback(fs, entry) < 0) {
+            return NULL;
+        }
+        list_head_remove(&entry->hash);
+        list_head_remove(&entry->lru);
+        --fs->inode_count;
+    } else if ((entry = kmalloc(sizeof(ext2_icache_entry_t))) == NULL) {
+        return NULL;
+    }
+    if (read && (ext2_load_inode(fs, &entry->inode, inode_index) < 0)) {
+        kfree(entry);
+        return NULL;
+    }
+    entry->inode_index = inode_index;
+    entry->dirty       = false;
+    entry->lazy        = false;
+    list_head_insert_before(&entry->hash, &fs->inode_hash[inode_index % EXT2_INODE_HASH_SIZE]);
+    list_head_insert_before(&entry->lru, &fs->inode_lru);
+    ++fs->inode_count;
+    return entry;
+}
+
+/// @brief Writes all the dirty inodes back inside the inode table.
+/// @param fs the filesystem.
+/// @param lazy if the inodes whose timestamps only changed are written too.
+static void ext2_icache_sync(ext2_filesystem_t *fs, int lazy)
+{
+    if ((fs->inode_dirty_count == 0) && (!lazy || (fs->inode_lazy_count == 0))) {
+        return;
+    }
+    list_for_each_decl (it, &fs->inode_lru) {
+        ext2_icache_entry_t *entry = list_entry(it, ext2_icache_entry_t, lru);
+        if (entry->dirty || lazy) {
+            ext2_icache_writeback(fs, entry);
+        }
+    }
+}
+
+/// @brief Reads an inode.
+/// @details The inode is served by the inode cache, and read from the inode
+/// table only the first time.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @return 0 on success, -1 on failure.
+static int ext2_read_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+{
+    if (inode_index == 0) {
+        pr_err("You are trying to read an invalid inode index (%d).\n", inode_index);
+        return -1;
+    }
+    ext2_icache_entry_t *entry = ext2_icache_get(fs, inode_index, 1);
+    if (!entry) {
+        // If we cannot cache the inode, read it directly.
+        return ext2_load_inode(fs, inode, inode_index);
+    }
+    memcpy(inode, &entry->inode, sizeof(ext2_inode_t));
+    return 0;
+}
+
+/// @brief Writes the inode.
+/// @details The inode is updated inside the inode cache, and written back to
+/// the inode table when evicted, periodically, or upon sync.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @return 0 on success, -1 on failure.
+static int ext2_write_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+{
+    if (inode_index == 0) {
+        pr_err("You are trying to write an invalid inode index (%d).\n", inode_index);
+        return -1;
+    }
+    // The whole inode is overwritten, there is no need to read it.
+    ext2_icache_entry_t *entry = ext2_icache_get(fs, inode_index, 0);
+    if (!entry) {
+        // If we cannot cache the inode, write it directly.
+        return ext2_store_inode(fs, inode, inode_index);
+    }
+    memcpy(&entry->inode, inode, sizeof(ext2_inode_t));
+    if (!entry->dirty) {
+        entry->dirty = true;
+        ++fs->inode_dirty_count;
+    }
+    return 0;
+}
+
+/// @brief Updates the timestamps of an inode after a read, or a write, as the
+/// mount options say, inside the inode cache only.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+/// @param modified if the content has been modified, otherwise it has been accessed.
+static void ext2_touch_inode(ext2_filesystem_t *fs, uint32_t inode_index, int modified)
+{
+    if (!modified && (fs->mount_flags & EXT2_MOUNT_NOATIME)) {
+        return;
+    }
+    ext2_icache_entry_t *entry = ext2_icache_get(fs, inode_index, 1);
+    if (!entry) {
+        return;
+    }
+    ext2_inode_t *inode = &entry->inode;
+    uint32_t now        = sys_time(NULL);
+    if (modified) {
+        inode->mtime = inode->ctime = now;
+    } else if (fs->mount_flags & EXT2_MOUNT_RELATIME) {
+        // Tell whether the file has been read since it last changed, at least once a day.
+        if ((inode->atime > inode->mtime) && (inode->atime > inode->ctime) &&
+            (now - inode->atime < EXT2_RELATIME_SECONDS)) {
+            return;
+        }
+        inode->atime = now;
+    } else {
+        inode->atime = now;
+    }
+    if (entry->dirty || entry->lazy) {
+        return;
+    }
+    if (fs->mount_flags & EXT2_MOUNT_LAZYTIME) {
+        entry->lazy = true;
+        ++fs->inode_lazy_count;
+    } else {
+        entry->dirty = true;
+        ++fs->inode_dirty_count;
+    }
+}
+
+/// @brief Checks if an option, which is not terminated, has the given name.
+/// @param option the option.
+/// @param length the length of the option.
+/// @param name the name.
+/// @return 1 if it has, 0 otherwise.
+static inline int ext2_option_is(const char *option, size_t length, const char *name)
+{
+    return (strlen(name) == length) && !strncmp(option, name, length);
+}
+
+/// @brief Parses the mount options.
+/// @param options the options, separated by commas, NULL for the defaults.
+/// @param flags the output variable where we store the options.
+/// @return 0 on success, -1 if an option is not valid.
+static int ext2_parse_options(const char *options, uint32_t *flags)
+{
+    // As Linux does, the access time is relative by default.
+    *flags = EXT2_MOUNT_RELATIME;
+    while (options && *options) {
+        const char *end = strchr(options, ',');
+        size_t length   = end ? (size_t)(end - options) : strlen(options);
+        if (ext2_option_is(options, length, "noatime")) {
+            *flags = (*flags & ~EXT2_MOUNT_RELATIME) | EXT2_MOUNT_NOATIME;
+        } else if (ext2_option_is(options, length, "relatime")) {
+            *flags = (*flags & ~EXT2_MOUNT_NOATIME) | EXT2_MOUNT_RELATIME;
+        } else if (ext2_option_is(options, length, "strictatime")) {
+            *flags &= ~(EXT2_MOUNT_NOATIME | EXT2_MOUNT_RELATIME);
+        } else if (ext2_option_is(options, length, "lazytime")) {
+            *flags |= EXT2_MOUNT_LAZYTIME;
+        } else if (ext2_option_is(options, length, "nolazytime")) {
+            *flags &= ~EXT2_MOUNT_LAZYTIME;
+        } else if (length && !ext2_option_is(options, length, "rw") && !ext2_option_is(options, length, "defaults")) {
+            pr_err("Unknown mount option `%.*s`.\n", (int)length, options);
+            return -1;
+        }
+        options += length + (end != NULL);
+    }
+    return 0;
+}
+
+/// @brief Allocate a new inode.
+/// @param fs the filesystem.
+/// @param preferred_group the preferred group.
+/// @return index of the inode.
+/// @details
+/// Here are the rules used to allocate new inodes:
+///  - the inode for a new file is allocated in the same group of the inode of
+///    its parent directory.
+///  - inodes are allocated equally between groups.
+static int ext2_allocate_inode(ext2_filesystem_t *fs, unsigned preferred_group)
+{
+    uint32_t group_index  = 0;
+    uint32_t group_offset = 0;
+    uint32_t inode_index  = 0;
+    // Search for a free inode, and lock its group.
+    if (!ext2_find_free_inode(fs, &group_index, &group_offset, preferred_group)) {
+        pr_err("Failed to find a free inode.\n");
+        return 0;
+    }
+    // Compute the inode index.
+    inode_index = (group_index * fs->superblock.inodes_per_group) + group_offset + 1U;
     // Log the allocation of the inode.
     pr_debug(
         "ext2_allocate_inode(inode: %4u, group_index: %4u, group_offset: %4u\n", inode_index, group_index,
         group_offset);
-    // Set the inode as occupied.
-    ext2_bitmap_set(cache, group_offset);
-    // Write back the inode bitmap.
-    if (ext2_write_block(fs, fs->block_groups[group_index].inode_bitmap, cache) < 0) {
-        pr_err("We failed to write back the block_bitmap.\n");
-    }
-    // Free the cache.
-    ext2_dealloc_cache(cache);
+    // Set the inode as occupied, the bitmap is written back later on.
+    ext2_buffer_t *bitmap = fs->group_info[group_index].inode_bitmap;
+    ext2_bitmap_set(bitmap->data, group_offset);
+    ext2_buffer_mark_dirty(fs, bitmap);
     // Reduce the number of free inodes.
     fs->block_groups[group_index].free_inodes_count--;
+    // Unlock the group.
+    spinlock_unlock(&fs->group_info[group_index].lock);
     // Reduce the number of inodes inside the superblock.
-    fs->superblock.free_inodes_count--;
-    // Update the bgdt.
-    if (ext2_write_bgdt(fs) < 0) {
-        pr_warning("Failed to write BGDT.\n");
-    }
-    // Update the superblock.
-    if (ext2_write_superblock(fs) < 0) {
-        pr_warning("Failed to write superblock.\n");
-    }
-    // Unlock the filesystem.
-    spinlock_unlock(&fs->spinlock);
+    ext2_superblock_add_free(fs, 0, -1);
+    // The BGDT and the superblock are written back later on.
+    ext2_metadata_mark_dirty(fs);
     // Return the inode.
     return inode_index;
 }
 
-/// @brief Allocates a new block.
+/// @brief Allocates a run of consecutive blocks, as close as possible to the goal.
+/// @details The run starts from the first free block found, and it is
+/// extended over the free blocks which follow it inside the same group. The
+/// content of the blocks is left untouched.
 /// @param fs the filesystem.
-/// @return 0 on failure, or the index of the new block on success.
-static uint32_t ext2_allocate_block(ext2_filesystem_t *fs)
+/// @param goal the block we would like the run to start from, 0 if we have no preference.
+/// @param count the maximum length of the run, upon return the length of the run we allocated.
+/// @return 0 on failure, or the index of the first block of the run on success.
+static uint32_t ext2_allocate_blocks(ext2_filesystem_t *fs, uint32_t goal, uint32_t *count)
 {
     uint32_t group_index  = 0;
     uint32_t group_offset = 0;
     uint32_t block_index  = 0;
-    // Lock the filesystem.
-    spinlock_lock(&fs->spinlock);
-    // Allocate the cache.
-    uint8_t *cache = ext2_alloc_cache(fs);
-    // Search for a free block.
-    if (!ext2_find_free_block(fs, cache, &group_index, &group_offset)) {
+    uint32_t length       = 0;
+    // Search for a free block, and lock its group.
+    if (!ext2_find_free_block(fs, goal, &group_index, &group_offset)) {
         pr_err("Failed to find a free block.\n");
-        // Unlock the filesystem.
-        spinlock_unlock(&fs->spinlock);
-        // Free the cache.
-        ext2_dealloc_cache(cache);
+        *count = 0;
         return 0;
     }
     // Compute the block index.
     block_index = (group_index * fs->superblock.blocks_per_group) + group_offset;
-    // Log the allocation of the inode.
+    // Set the blocks of the run as occupied, the bitmap is written back later on.
+    ext2_group_info_t *info = &fs->group_info[group_index];
+    ext2_buffer_t *bitmap   = info->block_bitmap;
+    while ((length < *count) && (group_offset + length < fs->superblock.blocks_per_group) &&
+           !ext2_bitmap_check(bitmap->data, group_offset + length)) {
+        ext2_bitmap_set(bitmap->data, group_offset + length);
+        ++length;
+    }
+    ext2_buffer_mark_dirty(fs, bitmap);
+    // If the run starts from the first free block, the search now starts after it.
+    if (info->block_hint == group_offset) {
+        info->block_hint = group_offset + length;
+    }
+    // Log the allocation of the blocks.
     pr_debug(
-        "ext2_allocate_block(block: %4u, group_index: %4u, group_offset: "
-        "%4u)\n",
-        block_index, group_index, group_offset);
-    // Set the block as occupied.
-    ext2_bitmap_set(cache, group_offset);
-    // Update the bitmap.
-    if (ext2_write_block(fs, fs->block_groups[group_index].block_bitmap, cache) < 0) {
-        pr_err("We failed to write back the block_bitmap.\n");
-    }
+        "ext2_allocate_blocks(block: %4u, count: %4u, group_index: %4u, group_offset: %4u)\n", block_index, length,
+        group_index, group_offset);
     // Decrease the number of free blocks inside the BGDT entry.
-    fs->block_groups[group_index].free_blocks_count--;
+    fs->block_groups[group_index].free_blocks_count -= length;
+    // Unlock the group.
+    spinlock_unlock(&info->lock);
     // Decrease the number of free blocks inside the superblock.
-    fs->superblock.free_blocks_count--;
-    // Update the BGDT.
-    if (ext2_write_bgdt(fs) < 0) {
-        pr_warning("Failed to write BGDT.\n");
-    }
-    // Update the superblock.
-    if (ext2_write_superblock(fs) < 0) {
-        pr_warning("Failed to write superblock.\n");
-    }
-    // Empty out the new block content.
-    memset(cache, 0, fs->block_size);
+    ext2_superblock_add_free(fs, -(int32_t)length, 0);
+    // The BGDT and the superblock are written back later on.
+    ext2_metadata_mark_dirty(fs);
+    *count = length;
+    return block_index;
+}
+
+/// @brief Empties out the content of a newly allocated block.
+/// @param fs the filesystem.
+/// @param block_index the index of the block.
+static void ext2_clear_block(ext2_filesystem_t *fs, uint32_t block_index)
+{
+    // Allocate the cache.
+    uint8_t *cache = ext2_alloc_cache(fs);
     // Write the empty content of the new block.
     if (ext2_write_block(fs, block_index, cache) < 0) {
         pr_err("We failed to clean the content of the newly allocated block.\n");
     }
     // Free the cache.
     ext2_dealloc_cache(cache);
-    // Unlock the spinlock.
-    spinlock_unlock(&fs->spinlock);
+}
+
+/// @brief Allocates a new block.
+/// @param fs the filesystem.
+/// @return 0 on failure, or the index of the new block on success.
+static uint32_t ext2_allocate_block(ext2_filesystem_t *fs)
+{
+    uint32_t count       = 1;
+    uint32_t block_index = ext2_allocate_blocks(fs, 0, &count);
+    if (block_index) {
+        ext2_clear_block(fs, block_index);
+    }
     return block_index;
 }
 
@@ -1288,129 +2358,554 @@ static void ext2_free_block(ext2_filesystem_t *fs, uint32_t block_index)
 {
     uint32_t group_index  = ext2_block_index_to_group_index(fs, block_index);
     uint32_t group_offset = ext2_block_index_to_group_offset(fs, block_index);
-    uint32_t block_bitmap = fs->block_groups[group_index].block_bitmap;
 
     // Log the allocation of the inode.
     pr_debug(
         "ext2_free_block(block: %4u, group_index: %4u, group_offset: %4u)\n", block_index, group_index, group_offset);
 
-    // Allocate the cache.
-    uint8_t *cache = ext2_alloc_cache(fs);
-    // Read the bitmap.
-    ext2_read_block(fs, block_bitmap, cache);
-    // Set it as free.
-    ext2_bitmap_clear(cache, group_offset);
-    // Write back the inode bitmap.
-    if (ext2_write_block(fs, block_bitmap, cache) < 0) {
-        pr_err("We failed to write back the block_bitmap.\n");
+    // Set it as free, the bitmap is written back later on.
+    ext2_buffer_t *bitmap = ext2_group_bitmap(fs, group_index, 0);
+    if (!bitmap) {
+        pr_err("Failed to free block `%u`.\n", block_index);
+        return;
     }
-    // Free the cache.
-    ext2_dealloc_cache(cache);
-
-    // Increase the number of free blocks inside the superblock.
-    fs->superblock.free_blocks_count++;
+    ext2_group_info_t *info = &fs->group_info[group_index];
+    spinlock_lock(&info->lock);
+    ext2_bitmap_clear(bitmap->data, group_offset);
+    ext2_buffer_mark_dirty(fs, bitmap);
+    // The search for a free block now starts from here.
+    info->block_hint = min(info->block_hint, group_offset);
     // Increase the number of free blocks inside the BGDT entry.
     fs->block_groups[group_index].free_blocks_count++;
-    // Update the BGDT.
-    if (ext2_write_bgdt(fs) < 0) {
-        pr_warning("Failed to write BGDT.\n");
-    }
-    // Update the superblock.
-    if (ext2_write_superblock(fs) < 0) {
-        pr_warning("Failed to write superblock.\n");
-    }
+    spinlock_unlock(&info->lock);
+
+    // Increase the number of free blocks inside the superblock.
+    ext2_superblock_add_free(fs, 1, 0);
+    // The BGDT and the superblock are written back later on.
+    ext2_metadata_mark_dirty(fs);
 }
 
-/// @brief Frees the given inode.
-/// @param fs a pointer to the filesystem.
-/// @param inode the inode we free.
-/// @param inode_index its index.
-/// @return 0 on success, otherwise it is a failure.
-static int ext2_free_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+/// @brief Returns the entries of a node of an extent tree, which follow its header.
+/// @param header the header of the node.
+/// @return the leaf entries, for a leaf.
+static inline ext2_extent_t *ext2_extent_entries(ext2_extent_header_t *header)
 {
-    // Retrieve the group index.
-    uint32_t group_index  = ext2_inode_index_to_group_index(fs, inode_index);
-    // Get the index of the inode inside the group.
-    uint32_t group_offset = ext2_inode_index_to_group_offset(fs, inode_index);
-    // Get the block bitmap index.
-    uint32_t inode_bitmap = fs->block_groups[group_index].inode_bitmap;
-    // Get the number of blocks we need to free.
-    uint32_t block_number = (inode->size / fs->block_size) + ((inode->size % fs->block_size) != 0);
+    return (ext2_extent_t *)(header + 1);
+}
 
-    // Log the allocation of the inode.
-    pr_debug(
-        "ext2_free_inode(group: %4u, inode_index: %4u, group_offset: %4u)\n", group_index, inode_index, group_offset);
+/// @brief Returns the entries of an internal node of an extent tree.
+/// @param header the header of the node.
+/// @return the index entries.
+static inline ext2_extent_idx_t *ext2_extent_indices(ext2_extent_header_t *header)
+{
+    return (ext2_extent_idx_t *)(header + 1);
+}
 
-    // Free its blocks.
-    for (uint32_t block_index = 0; block_index < block_number; ++block_index) {
-        // Get the real index.
-        uint32_t real_index = ext2_get_real_block_index(fs, inode, block_index);
-        if (real_index == 0) {
-            continue;
-        }
-        ext2_free_block(fs, real_index);
+/// @brief Returns the number of entries fitting inside a node of an extent tree, stored inside a block.
+/// @param fs the filesystem.
+/// @return the number of entries.
+static inline uint16_t ext2_extent_node_max(ext2_filesystem_t *fs)
+{
+    return (fs->block_size - sizeof(ext2_extent_header_t)) / sizeof(ext2_extent_t);
+}
+
+/// @brief Returns the number of blocks of an extent, which might be uninitialized.
+/// @param extent the extent.
+/// @return the number of blocks.
+static inline uint32_t ext2_extent_length(ext2_extent_t *extent)
+{
+    return (extent->len > EXT4_EXTENT_MAX_LEN) ? (extent->len - EXT4_EXTENT_MAX_LEN) : extent->len;
+}
+
+/// @brief Checks the header of a node of an extent tree.
+/// @param header the header of the node.
+/// @param max the largest capacity the node can have.
+/// @param depth the depth the node must have.
+/// @return 1 if the node is valid, 0 otherwise.
+static inline int ext2_extent_check(ext2_extent_header_t *header, uint32_t max, uint32_t depth)
+{
+    if ((header->magic != EXT4_EXTENT_MAGIC) || (header->max > max) || (header->entries > header->max) ||
+        (header->depth != depth)) {
+        pr_err(
+            "Corrupted extent tree node (magic: 0x%x, entries: %u, max: %u, depth: %u).\n", header->magic,
+            header->entries, header->max, header->depth);
+        return 0;
     }
+    return 1;
+}
 
-    // Allocate the cache.
-    uint8_t *cache = ext2_alloc_cache(fs);
-    // Read the bitmap.
-    ext2_read_block(fs, inode_bitmap, cache);
-    // Set it as free.
-    ext2_bitmap_clear(cache, group_offset);
-    // Write back the inode bitmap.
-    if (ext2_write_block(fs, inode_bitmap, cache) < 0) {
-        pr_err("We failed to write back the inode_bitmap.\n");
+/// @brief Searches a node of an extent tree for the last entry starting at,
+/// or before, the given block of the file.
+/// @details Entries are sorted by their first block, and both the leaf and
+/// index ones are 12 bytes long and start with it, so the same binary search
+/// serves both kinds of nodes.
+/// @param header the header of the node.
+/// @param block_index the block of the file.
+/// @return the position of the entry, -1 if all the entries start after the block.
+static inline int ext2_extent_search(ext2_extent_header_t *header, uint32_t block_index)
+{
+    ext2_extent_t *entries = ext2_extent_entries(header);
+    int low                = 0;
+    int high               = (int)header->entries - 1;
+    int found              = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (entries[middle].block <= block_index) {
+            found = middle;
+            low   = middle + 1;
+        } else {
+            high = middle - 1;
+        }
     }
-    // Free the cache.
-    ext2_dealloc_cache(cache);
+    return found;
+}
 
-    // Increase the number of inodes inside the superblock.
-    fs->superblock.free_inodes_count++;
-    // Increase the number of free inodes.
-    fs->block_groups[group_index].free_inodes_count++;
-    // Update the bgdt.
-    if (ext2_write_bgdt(fs) < 0) {
-        pr_warning("Failed to write BGDT.\n");
+/// @brief Reads the node of an extent tree pointed by an index entry.
+/// @param fs the filesystem.
+/// @param index the index entry.
+/// @param depth the depth the node must have.
+/// @return the buffer holding the node, NULL on failure.
+static ext2_buffer_t *ext2_extent_read_node(ext2_filesystem_t *fs, ext2_extent_idx_t *index, uint32_t depth)
+{
+    // Blocks beyond the first 2^32 cannot be addressed.
+    if (index->leaf_hi || !index->leaf_lo) {
+        pr_err("Invalid extent tree node (%u:%u).\n", index->leaf_hi, index->leaf_lo);
+        return NULL;
     }
-    // Update the superblock.
-    if (ext2_write_superblock(fs) < 0) {
-        pr_warning("Failed to write superblock.\n");
+    ext2_buffer_t *buffer = ext2_buffer_get(fs, index->leaf_lo, 1);
+    if (!buffer) {
+        pr_err("Failed to read the extent tree node `%u`.\n", index->leaf_lo);
+        return NULL;
     }
-    // Return the error code.
-    return 0;
+    if (!ext2_extent_check((ext2_extent_header_t *)buffer->data, ext2_extent_node_max(fs), depth)) {
+        ext2_buffer_put(buffer);
+        return NULL;
+    }
+    return buffer;
 }
 
-/// @brief Allocates a new block for storing block indices, for an inode.
+/// @brief Returns the real block mapped by the extent tree of an inode.
+/// @details Uninitialized extents are preallocated space whose content was
+/// never written, they read as zeros exactly like holes.
 /// @param fs the filesystem.
-/// @param current_index the current index, or if 0, where we store the new one.
-/// @return 0 on success, -1 on failure.
-static int __ext2_allocate_indexing_block_for_inode(ext2_filesystem_t *fs, uint32_t *current_index)
+/// @param inode the inode which we are working with.
+/// @param block_index the block index inside the inode.
+/// @return the real block number, 0 for holes and on failure.
+static uint32_t ext2_extent_get_block(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t block_index)
 {
-    if (!(*current_index)) {
-        // Allocate a new block.
-        uint32_t block_index = ext2_allocate_block(fs);
-        if (block_index == 0) {
-            pr_err("We failed to allocate a new block for inode block "
-                   "indexing.\n");
-            return -1;
+    ext2_extent_header_t *header = &inode->data.extents.header;
+    ext2_buffer_t *buffer        = NULL;
+    uint32_t real_index          = 0;
+    if (!ext2_extent_check(header, EXT4_EXTENT_ROOT_ENTRIES, header->depth) ||
+        (header->depth > EXT4_EXTENT_MAX_DEPTH)) {
+        return 0;
+    }
+    // Walk down the tree, keeping only the node we are visiting.
+    while (header) {
+        int position = ext2_extent_search(header, block_index);
+        if (position < 0) {
+            break;
         }
-        // Update the index.
-        *current_index = block_index;
+        if (header->depth == 0) {
+            ext2_extent_t *extent = ext2_extent_entries(header) + position;
+            if (((block_index - extent->block) < extent->len) && (extent->len <= EXT4_EXTENT_MAX_LEN) &&
+                !extent->start_hi) {
+                real_index = extent->start_lo + (block_index - extent->block);
+            }
+            break;
+        }
+        ext2_buffer_t *child = ext2_extent_read_node(fs, ext2_extent_indices(header) + position, header->depth - 1);
+        if (buffer) {
+            ext2_buffer_put(buffer);
+        }
+        buffer = child;
+        header = buffer ? (ext2_extent_header_t *)buffer->data : NULL;
     }
-    return 0;
+    if (buffer) {
+        ext2_buffer_put(buffer);
+    }
+    return real_index;
 }
 
-/// @brief Allocates a new block for storing block indices, for a block containing block indices.
+/// @brief Returns the number of blocks of a file mapped by its extent tree,
+/// up to the end of its last extent.
 /// @param fs the filesystem.
-/// @param indexing_block the index of block that contains the indices.
-/// @param cache the cache were we load the block content.
-/// @param index the index inside the list of indices.
-/// @return 0 on success, -1 on failure.
-static int
-__ext2_read_and_allocate_indexing_block(ext2_filesystem_t *fs, uint32_t indexing_block, uint8_t *cache, uint32_t index)
+/// @param inode the inode which we are working with.
+/// @return the number of blocks.
+static uint32_t ext2_extent_last_block(ext2_filesystem_t *fs, ext2_inode_t *inode)
 {
-    // Read the doubly-indirect block (which contains pointers to indirect blocks).
-    ext2_read_block(fs, indexing_block, cache);
+    ext2_extent_header_t *header = &inode->data.extents.header;
+    ext2_buffer_t *buffer        = NULL;
+    uint32_t last                = 0;
+    if (!ext2_extent_check(header, EXT4_EXTENT_ROOT_ENTRIES, header->depth) ||
+        (header->depth > EXT4_EXTENT_MAX_DEPTH)) {
+        return 0;
+    }
+    // Follow the rightmost branch of the tree.
+    while (header && header->entries) {
+        if (header->depth == 0) {
+            ext2_extent_t *extent = ext2_extent_entries(header) + (header->entries - 1);
+            last                  = extent->block + ext2_extent_length(extent);
+            break;
+        }
+        ext2_buffer_t *child =
+            ext2_extent_read_node(fs, ext2_extent_indices(header) + (header->entries - 1), header->depth - 1);
+        if (buffer) {
+            ext2_buffer_put(buffer);
+        }
+        buffer = child;
+        header = buffer ? (ext2_extent_header_t *)buffer->data : NULL;
+    }
+    if (buffer) {
+        ext2_buffer_put(buffer);
+    }
+    return last;
+}
+
+/// @brief Allocates and writes a new node of an extent tree, holding a single entry.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param goal the block we would like the node to be.
+/// @param depth the depth of the node.
+/// @param entry the entry, either a leaf or an index one.
+/// @return the block of the node, 0 on failure.
+static uint32_t
+ext2_extent_new_node(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t goal, uint32_t depth, void *entry)
+{
+    uint32_t count = 1;
+    uint32_t block = ext2_allocate_blocks(fs, goal, &count);
+    if (!block) {
+        return 0;
+    }
+    uint8_t *cache               = ext2_alloc_cache(fs);
+    if (!cache) {
+        ext2_free_block(fs, block);
+        return 0;
+    }
+    ext2_extent_header_t *header = (ext2_extent_header_t *)cache;
+    header->magic                = EXT4_EXTENT_MAGIC;
+    header->entries              = 1;
+    header->max                  = ext2_extent_node_max(fs);
+    header->depth                = depth;
+    memcpy(header + 1, entry, sizeof(ext2_extent_t));
+    if (ext2_write_block(fs, block, cache) < 0) {
+        ext2_dealloc_cache(cache);
+        ext2_free_block(fs, block);
+        return 0;
+    }
+    ext2_dealloc_cache(cache);
+    // The nodes of the tree are accounted among the blocks of the inode.
+    inode->blocks_count += fs->blocks_per_block_count;
+    return block;
+}
+
+/// @brief Makes the extent tree of an inode one level deeper, moving the
+/// entries of its root inside a new node.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param goal the block we would like the new node to be.
+/// @return 0 on success, -1 on failure.
+static int ext2_extent_grow(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t goal)
+{
+    ext2_extent_header_t *root = &inode->data.extents.header;
+    uint32_t count             = 1;
+    uint32_t block             = ext2_allocate_blocks(fs, goal, &count);
+    if (!block) {
+        return -1;
+    }
+    uint8_t *cache               = ext2_alloc_cache(fs);
+    if (!cache) {
+        ext2_free_block(fs, block);
+        return -1;
+    }
+    ext2_extent_header_t *header = (ext2_extent_header_t *)cache;
+    memcpy(header, root, sizeof(inode->data.extents));
+    header->max = ext2_extent_node_max(fs);
+    if (ext2_write_block(fs, block, cache) < 0) {
+        ext2_dealloc_cache(cache);
+        ext2_free_block(fs, block);
+        return -1;
+    }
+    ext2_dealloc_cache(cache);
+    inode->blocks_count += fs->blocks_per_block_count;
+    // The root is left with a single entry, pointing to the new node.
+    ext2_extent_idx_t *index = ext2_extent_indices(root);
+    index->block             = ext2_extent_entries(root)->block;
+    index->leaf_lo           = block;
+    index->leaf_hi           = 0;
+    index->unused            = 0;
+    root->entries            = 1;
+    root->depth++;
+    return 0;
+}
+
+/// @brief Maps a new block at the end of a file mapped by an extent tree.
+/// @details The block extends the last extent if it follows it both inside
+/// the file and on disk, otherwise it starts a new extent. When the last leaf
+/// is full, a new branch is added below the deepest node of the rightmost
+/// path which has room left, and when none has, the tree grows by one level.
+/// The root, which lives inside the inode, is written back by the caller.
+/// Blocks can only be mapped after the end of the last extent, which is how
+/// the files grow, one block after the other.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param block_index the block index inside the inode.
+/// @param real_index the real block number.
+/// @return 0 on success, a negative value on failure.
+static int ext2_extent_append(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t block_index, uint32_t real_index)
+{
+    ext2_buffer_t *path[EXT4_EXTENT_MAX_DEPTH + 1]        = { NULL };
+    ext2_extent_header_t *nodes[EXT4_EXTENT_MAX_DEPTH + 1] = { NULL };
+    ext2_extent_header_t *root                             = &inode->data.extents.header;
+    uint32_t depth                                         = root->depth;
+    int ret                                                = -1;
+    if (!ext2_extent_check(root, EXT4_EXTENT_ROOT_ENTRIES, depth) || (depth > EXT4_EXTENT_MAX_DEPTH)) {
+        return -1;
+    }
+    // Collect the rightmost path, from the root down to the last leaf.
+    nodes[0] = root;
+    for (uint32_t level = 0; level < depth; ++level) {
+        if (nodes[level]->entries == 0) {
+            pr_err("Empty internal node inside the extent tree.\n");
+            goto early_exit;
+        }
+        ext2_extent_idx_t *index = ext2_extent_indices(nodes[level]) + (nodes[level]->entries - 1);
+        if ((path[level + 1] = ext2_extent_read_node(fs, index, depth - level - 1)) == NULL) {
+            goto early_exit;
+        }
+        nodes[level + 1] = (ext2_extent_header_t *)path[level + 1]->data;
+    }
+    ext2_extent_header_t *leaf = nodes[depth];
+    ext2_extent_t extent       = { .block = block_index, .len = 1, .start_hi = 0, .start_lo = real_index };
+    if (leaf->entries) {
+        ext2_extent_t *last = ext2_extent_entries(leaf) + (leaf->entries - 1);
+        uint32_t length     = ext2_extent_length(last);
+        if (block_index < last->block + length) {
+            pr_err("Block `%u` is not past the last extent, ending at `%u`.\n", block_index, last->block + length);
+            goto early_exit;
+        }
+        // Extend the last extent, if the block follows it.
+        if ((last->len < EXT4_EXTENT_MAX_LEN) && (block_index == last->block + length) &&
+            (real_index == last->start_lo + length) && !last->start_hi) {
+            last->len++;
+            ret = 0;
+            goto mark_dirty;
+        }
+    }
+    // Add a new extent to the leaf.
+    if (leaf->entries < leaf->max) {
+        ext2_extent_entries(leaf)[leaf->entries++] = extent;
+        ret                                        = 0;
+        goto mark_dirty;
+    }
+    // Find the deepest node above the leaf with room for a new branch.
+    int level = (int)depth - 1;
+    while ((level >= 0) && (nodes[level]->entries == nodes[level]->max)) {
+        --level;
+    }
+    if (level < 0) {
+        // Every node is full, grow the tree and try again.
+        if (depth == EXT4_EXTENT_MAX_DEPTH) {
+            pr_err("The extent tree has reached its maximum depth.\n");
+            goto early_exit;
+        }
+        for (uint32_t it = 1; it <= depth; ++it) {
+            ext2_buffer_put(path[it]);
+        }
+        if (ext2_extent_grow(fs, inode, real_index) < 0) {
+            return -1;
+        }
+        return ext2_extent_append(fs, inode, block_index, real_index);
+    }
+    // Build the new branch bottom-up, from its leaf, holding the new extent.
+    ext2_extent_idx_t index = { .block = block_index, .leaf_lo = 0, .leaf_hi = 0, .unused = 0 };
+    index.leaf_lo           = ext2_extent_new_node(fs, inode, real_index, 0, &extent);
+    for (uint32_t node_depth = 1; index.leaf_lo && (node_depth < depth - level); ++node_depth) {
+        index.leaf_lo = ext2_extent_new_node(fs, inode, real_index, node_depth, &index);
+    }
+    if (!index.leaf_lo) {
+        pr_err("Failed to allocate a new branch of the extent tree.\n");
+        goto early_exit;
+    }
+    ext2_extent_indices(nodes[level])[nodes[level]->entries++] = index;
+    leaf                                                       = nodes[level];
+    ret                                                        = 0;
+mark_dirty:
+    // The root is written back along with the inode.
+    if (leaf != root) {
+        for (uint32_t it = 1; it <= depth; ++it) {
+            if (nodes[it] == leaf) {
+                ext2_buffer_mark_dirty(fs, path[it]);
+            }
+        }
+    }
+early_exit:
+    for (uint32_t it = 1; it <= depth; ++it) {
+        if (path[it]) {
+            ext2_buffer_put(path[it]);
+        }
+    }
+    return ret;
+}
+
+/// @brief Frees the blocks mapped by a node of an extent tree, and the nodes below it.
+/// @param fs the filesystem.
+/// @param header the header of the node.
+static void ext2_extent_free_node(ext2_filesystem_t *fs, ext2_extent_header_t *header)
+{
+    for (uint32_t it = 0; it < header->entries; ++it) {
+        if (header->depth == 0) {
+            ext2_extent_t *extent = ext2_extent_entries(header) + it;
+            if (extent->start_hi) {
+                continue;
+            }
+            // Uninitialized extents hold blocks too.
+            for (uint32_t block = 0; block < ext2_extent_length(extent); ++block) {
+                ext2_free_block(fs, extent->start_lo + block);
+            }
+            continue;
+        }
+        ext2_extent_idx_t *index = ext2_extent_indices(header) + it;
+        ext2_buffer_t *buffer    = ext2_extent_read_node(fs, index, header->depth - 1);
+        if (buffer) {
+            ext2_extent_free_node(fs, (ext2_extent_header_t *)buffer->data);
+            ext2_buffer_put(buffer);
+            ext2_free_block(fs, index->leaf_lo);
+        }
+    }
+}
+
+/// @brief Frees all the blocks of an inode mapped by an extent tree, and the tree itself.
+/// @param fs the filesystem.
+/// @param inode the inode.
+static void ext2_extent_free(ext2_filesystem_t *fs, ext2_inode_t *inode)
+{
+    ext2_extent_header_t *root = &inode->data.extents.header;
+    if (ext2_extent_check(root, EXT4_EXTENT_ROOT_ENTRIES, root->depth) && (root->depth <= EXT4_EXTENT_MAX_DEPTH)) {
+        ext2_extent_free_node(fs, root);
+    }
+}
+
+/// @brief Returns the number of blocks allocated for the data of the inode,
+/// which are the first ones of the file, since files never have holes.
+/// @param fs the filesystem.
+/// @param inode the inode.
+/// @return the number of blocks.
+static inline uint32_t ext2_inode_block_count(ext2_filesystem_t *fs, ext2_inode_t *inode)
+{
+    if (bitmask_check(inode->flags, EXT4_EXTENTS_FL)) {
+        return ext2_extent_last_block(fs, inode);
+    }
+    return inode->blocks_count / fs->blocks_per_block_count;
+}
+
+/// @brief Checks if the inode is a fast symlink, whose target is stored inside
+/// the inode itself, in place of the block pointers.
+/// @param fs the filesystem.
+/// @param inode the inode.
+/// @return 1 if it is a fast symlink, 0 otherwise.
+static inline int ext2_is_fast_symlink(ext2_filesystem_t *fs, ext2_inode_t *inode)
+{
+    // The block holding the extended attributes, if any, is not part of the data.
+    uint32_t acl_blocks = inode->file_acl ? fs->blocks_per_block_count : 0;
+    return S_ISLNK(inode->mode) && (inode->blocks_count == acl_blocks);
+}
+
+/// @brief Frees the given inode.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode we free.
+/// @param inode_index its index.
+/// @return 0 on success, otherwise it is a failure.
+static int ext2_free_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
+{
+    // Retrieve the group index.
+    uint32_t group_index  = ext2_inode_index_to_group_index(fs, inode_index);
+    // Get the index of the inode inside the group.
+    uint32_t group_offset = ext2_inode_index_to_group_offset(fs, inode_index);
+    // Get the number of blocks we need to free, fast symlinks have none.
+    uint32_t block_number = (inode->size / fs->block_size) + ((inode->size % fs->block_size) != 0);
+    if (ext2_is_fast_symlink(fs, inode)) {
+        block_number = 0;
+    }
+
+    // Log the allocation of the inode.
+    pr_debug(
+        "ext2_free_inode(group: %4u, inode_index: %4u, group_offset: %4u)\n", group_index, inode_index, group_offset);
+
+    // Free its blocks, along with the extent tree mapping them.
+    if (bitmask_check(inode->flags, EXT4_EXTENTS_FL)) {
+        ext2_extent_free(fs, inode);
+        block_number = 0;
+    }
+    for (uint32_t block_index = 0; block_index < block_number; ++block_index) {
+        // Get the real index.
+        uint32_t real_index = ext2_get_real_block_index(fs, inode, block_index);
+        if (real_index == 0) {
+            continue;
+        }
+        ext2_free_block(fs, real_index);
+    }
+
+    // The indexing blocks of the inode can be reused by other inodes.
+    ext2_bmap_invalidate(fs);
+    // The inode itself can be reused, drop its pages.
+    ext2_page_invalidate(fs, inode_index);
+
+    // Set it as free, the bitmap is written back later on.
+    ext2_buffer_t *bitmap = ext2_group_bitmap(fs, group_index, 1);
+    if (!bitmap) {
+        pr_err("Failed to free inode `%u`.\n", inode_index);
+        return -1;
+    }
+    ext2_group_info_t *info = &fs->group_info[group_index];
+    spinlock_lock(&info->lock);
+    ext2_bitmap_clear(bitmap->data, group_offset);
+    ext2_buffer_mark_dirty(fs, bitmap);
+    // The search for a free inode now starts from here.
+    info->inode_hint = min(info->inode_hint, group_offset);
+    // Increase the number of free inodes.
+    fs->block_groups[group_index].free_inodes_count++;
+    spinlock_unlock(&info->lock);
+
+    // Increase the number of inodes inside the superblock.
+    ext2_superblock_add_free(fs, 0, 1);
+    // The BGDT and the superblock are written back later on.
+    ext2_metadata_mark_dirty(fs);
+    // Return the error code.
+    return 0;
+}
+
+/// @brief Allocates a new block for storing block indices, for an inode.
+/// @param fs the filesystem.
+/// @param current_index the current index, or if 0, where we store the new one.
+/// @return 0 on success, -1 on failure.
+static int __ext2_allocate_indexing_block_for_inode(ext2_filesystem_t *fs, uint32_t *current_index)
+{
+    if (!(*current_index)) {
+        // Allocate a new block.
+        uint32_t block_index = ext2_allocate_block(fs);
+        if (block_index == 0) {
+            pr_err("We failed to allocate a new block for inode block "
+                   "indexing.\n");
+            return -1;
+        }
+        // Update the index.
+        *current_index = block_index;
+    }
+    return 0;
+}
+
+/// @brief Allocates a new block for storing block indices, for a block containing block indices.
+/// @param fs the filesystem.
+/// @param indexing_block the index of block that contains the indices.
+/// @param cache the cache were we load the block content.
+/// @param index the index inside the list of indices.
+/// @return 0 on success, -1 on failure.
+static int
+__ext2_read_and_allocate_indexing_block(ext2_filesystem_t *fs, uint32_t indexing_block, uint8_t *cache, uint32_t index)
+{
+    // Read the doubly-indirect block (which contains pointers to indirect blocks).
+    ext2_read_block(fs, indexing_block, cache);
     // Check if we need to allocate a new block.
     if (!((uint32_t *)cache)[index]) {
         // Allocate a new block.
@@ -1461,16 +2956,21 @@ static int ext2_set_real_block_index(
     // Result of the operation.
     int ret = 0;
 
+    // Check if the blocks are mapped by an extent tree.
+    if (bitmask_check(inode->flags, EXT4_EXTENTS_FL)) {
+        return ext2_extent_append(fs, inode, block_index, real_index);
+    }
+
     // Are we setting a DIRECT block pointer.
     a = ((int)block_index) - EXT2_DIRECT_BLOCKS;
-    if (a <= 0) {
+    if (a < 0) {
         inode->data.blocks.dir_blocks[block_index] = real_index;
     } else {
         // Allocate the cache.
         uint8_t *cache = ext2_alloc_cache(fs);
         // Are we setting an INDIRECT block pointer.
         b              = a - p;
-        if (b <= 0) {
+        if (b < 0) {
             // Check that the indirect block points to a valid block.
             if (__ext2_allocate_indexing_block_for_inode(fs, &inode->data.blocks.indir_block)) {
                 ret = -1;
@@ -1486,7 +2986,7 @@ static int ext2_set_real_block_index(
         } else {
             // Are we setting a DOUBLY-INDIRECT block.
             c = b - p * p;
-            if (c <= 0) {
+            if (c < 0) {
                 c = b / p;
                 d = b - c * p;
                 // Check that the indirect block points to a valid block.
@@ -1510,7 +3010,7 @@ static int ext2_set_real_block_index(
 
             } else {
                 d = c - p * p * p;
-                if (d <= 0) {
+                if (d < 0) {
                     e = c / (p * p);
                     f = (c - e * p * p) / p;
                     g = (c - e * p * p - f * p);
@@ -1557,7 +3057,67 @@ static int ext2_set_real_block_index(
     return ret;
 }
 
+/// @brief Reads a block pointer from an indexing block, through the buffer cache.
+/// @param fs the filesystem.
+/// @param block the indexing block.
+/// @param index the index of the pointer inside the block.
+/// @return the pointer, 0 if it is not set or if the block cannot be read.
+static inline uint32_t ext2_read_block_pointer(ext2_filesystem_t *fs, uint32_t block, uint32_t index)
+{
+    if (block == 0) {
+        return 0;
+    }
+    ext2_buffer_t *buffer = ext2_buffer_get(fs, block, 1);
+    if (!buffer) {
+        pr_err("Failed to read the indexing block `%u`.\n", block);
+        return 0;
+    }
+    uint32_t pointer = ((uint32_t *)buffer->data)[index];
+    ext2_buffer_put(buffer);
+    return pointer;
+}
+
+/// @brief Drops all the entries of the block map cache.
+/// @param fs the filesystem.
+static inline void ext2_bmap_invalidate(ext2_filesystem_t *fs) { memset(fs->bmap, 0, sizeof(fs->bmap)); }
+
+/// @brief Returns the indirect block holding the pointers to the data blocks,
+/// below a doubly or trebly indirect block, going through the block map cache.
+/// @param fs the filesystem.
+/// @param root the doubly or trebly indirect block.
+/// @param index the number of the indirect block, below the root.
+/// @param levels the number of levels between the root and the indirect block (1 or 2).
+/// @return the indirect block, 0 if it is not allocated.
+static inline uint32_t ext2_bmap_leaf(ext2_filesystem_t *fs, uint32_t root, uint32_t index, int levels)
+{
+    if (root == 0) {
+        return 0;
+    }
+    ext2_bmap_entry_t *entry = &fs->bmap[(root + index) % EXT2_BMAP_CACHE_SIZE];
+    if ((entry->block != 0) && (entry->root == root) && (entry->index == index)) {
+        return entry->block;
+    }
+    uint32_t block;
+    if (levels == 1) {
+        block = ext2_read_block_pointer(fs, root, index);
+    } else {
+        block = ext2_read_block_pointer(
+            fs, ext2_read_block_pointer(fs, root, index / fs->pointers_per_block), index % fs->pointers_per_block);
+    }
+    // Unallocated blocks are not cached, since they can be allocated later on.
+    if (block != 0) {
+        entry->root  = root;
+        entry->index = index;
+        entry->block = block;
+    }
+    return block;
+}
+
 /// @brief Returns the real block index starting from a block index inside an inode.
+/// @details Indexing blocks are read in place from the buffer cache, and the
+/// indirect blocks found below the doubly and trebly indirect blocks are kept
+/// inside the block map cache, so that streaming through a large file costs a
+/// single metadata lookup per data block.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
 /// @param block_index the block index inside the inode.
@@ -1565,99 +3125,181 @@ static int ext2_set_real_block_index(
 static uint32_t ext2_get_real_block_index(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t block_index)
 {
     // Get the number of pointers per block.
-    unsigned int p = fs->pointers_per_block;
-    // Help compute the indices.
-    int a;
-    int b;
-    int c;
-    int d;
-    int e;
-    int f;
-    int g;
-    // The real index.
-    uint32_t real_index = 0;
+    uint32_t p     = fs->pointers_per_block;
+    // The index, relative to the first block reached by the current level.
+    uint32_t index = block_index;
 
+    // Check if the blocks are mapped by an extent tree.
+    if (bitmask_check(inode->flags, EXT4_EXTENTS_FL)) {
+        return ext2_extent_get_block(fs, inode, block_index);
+    }
     // Check if the index is among the DIRECT blocks.
-    a = block_index - EXT2_DIRECT_BLOCKS;
-    if (a < 0) {
-        real_index = inode->data.blocks.dir_blocks[block_index];
-    } else {
-        // Allocate the cache.
-        uint8_t *cache = ext2_alloc_cache(fs);
-        // Check if the index is among the INDIRECT blocks.
-        b              = a - p;
-        if (b < 0) {
-            // Read the indirect block (which contains pointers to the next set of blocks).
-            ext2_read_block(fs, inode->data.blocks.indir_block, cache);
-            // Compute the index inside the final block.
-            real_index = ((uint32_t *)cache)[a];
-
-        } else {
-            // Check if the index is among the DOUBLY-INDIRECT blocks.
-            c = b - p * p;
-            if (c < 0) {
-                // Compute the indirect indices.
-                c = b / p;
-                d = b - c * p;
-                // Read the doubly-indirect block (which contains pointers to indirect blocks).
-                ext2_read_block(fs, inode->data.blocks.doubly_indir_block, cache);
-                // Compute the index inside the indirect block.
-                ext2_read_block(fs, cache[c], cache);
-                // Compute the index inside the final block.
-                real_index = cache[d];
-
-            } else {
-                // Check if the index is among the TREBLY-INDIRECT blocks.
-                d = c - p * p * p;
-                if (d < 0) {
-                    e = c / (p * p);
-                    f = (c - e * p * p) / p;
-                    g = (c - e * p * p - f * p);
-                    // Read the trebly-indirect block (which contains pointers to doubly-indirect blocks).
-                    ext2_read_block(fs, inode->data.blocks.trebly_indir_block, cache);
-                    // Read the doubly-indirect block (which contains pointers to indirect blocks).
-                    ext2_read_block(fs, cache[e], cache);
-                    // Read the indirect block (which contains pointers to the next set of blocks).
-                    ext2_read_block(fs, cache[f], cache);
-                    // Compute the index inside the final block.
-                    real_index = cache[g];
+    if (index < EXT2_DIRECT_BLOCKS) {
+        return inode->data.blocks.dir_blocks[index];
+    }
+    index -= EXT2_DIRECT_BLOCKS;
+    // Check if the index is among the INDIRECT blocks.
+    if (index < p) {
+        return ext2_read_block_pointer(fs, inode->data.blocks.indir_block, index);
+    }
+    index -= p;
+    // Check if the index is among the DOUBLY-INDIRECT blocks.
+    if (index < p * p) {
+        uint32_t leaf = ext2_bmap_leaf(fs, inode->data.blocks.doubly_indir_block, index / p, 1);
+        return ext2_read_block_pointer(fs, leaf, index % p);
+    }
+    index -= p * p;
+    // Check if the index is among the TREBLY-INDIRECT blocks.
+    if (index < p * p * p) {
+        uint32_t leaf = ext2_bmap_leaf(fs, inode->data.blocks.trebly_indir_block, index / p, 2);
+        return ext2_read_block_pointer(fs, leaf, index % p);
+    }
+    pr_err("We failed to retrieve the real block number of the block with index `%d`\n", block_index);
+    return 0;
+}
 
-                } else {
-                    pr_err(
-                        "We failed to retrieve the real block number of the "
-                        "block with index `%d`\n",
-                        block_index);
-                }
-            }
+/// @brief Computes where we would like the given block of an inode to be.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @param block_index The index of the block within the inode.
+/// @return the block following the previous one of the inode, or the first
+/// block of the group of the inode.
+static inline uint32_t
+ext2_block_goal(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t block_index)
+{
+    if (block_index > 0) {
+        uint32_t previous = ext2_get_real_block_index(fs, inode, block_index - 1);
+        if (previous) {
+            return previous + 1;
         }
-        // Free the cache.
-        ext2_dealloc_cache(cache);
     }
-    return real_index;
+    return ext2_inode_index_to_group_index(fs, inode_index) * fs->superblock.blocks_per_group;
 }
 
-/// @brief Allocate a new block for an inode.
+/// @brief Returns the open file whose preallocation window serves the inode.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
 /// @param inode_index The index of the inode.
-/// @param block_index The index of the block within the inode.
-/// @return 0 on success, -1 on failure.
-static int
-ext2_allocate_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t block_index)
+/// @return the file, NULL if the inode is not an open regular file.
+static inline vfs_file_t *ext2_prealloc_file(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index)
 {
-    // Allocate the block.
-    int real_index = ext2_allocate_block(fs);
-    if (real_index == -1) {
-        return -1;
+    if (!bitmask_exact(inode->mode, S_IFREG)) {
+        return NULL;
     }
-    // Associate the real index and the index inside the inode.
+    return ext2_find_vfs_file_with_inode(fs, inode_index);
+}
+
+/// @brief Releases the blocks left inside the preallocation window of a file.
+/// @param fs the filesystem.
+/// @param file the file.
+static void ext2_prealloc_discard(ext2_filesystem_t *fs, vfs_file_t *file)
+{
+    for (; file->prealloc.count; --file->prealloc.count) {
+        ext2_free_block(fs, file->prealloc.start++);
+    }
+}
+
+/// @brief Makes the preallocation window of a file start at the goal, and
+/// hold at least the given number of blocks.
+/// @details Blocks are reserved in runs of at least the preallocation size of
+/// the filesystem, and at most EXT2_PREALLOC_MAX. A window which does not
+/// start at the goal is useless, since the file is not growing where it left
+/// it, and is released. If the goal is not free, the window is placed on the
+/// first free run which follows it.
+/// @param fs the filesystem.
+/// @param file the file.
+/// @param goal the block we would like the window to start from.
+/// @param count the number of blocks the file is going to need.
+static void ext2_prealloc_fill(ext2_filesystem_t *fs, vfs_file_t *file, uint32_t goal, uint32_t count)
+{
+    vfs_file_prealloc_t *prealloc = &file->prealloc;
+    if (prealloc->count && (prealloc->start != goal)) {
+        ext2_prealloc_discard(fs, file);
+    }
+    if (prealloc->count >= count) {
+        return;
+    }
+    uint32_t length = fs->superblock.prealloc_blocks ? fs->superblock.prealloc_blocks : EXT2_PREALLOC_MIN;
+    length          = min(max(length, count), EXT2_PREALLOC_MAX);
+    if (length <= prealloc->count) {
+        return;
+    }
+    length -= prealloc->count;
+    // Try to extend the current window, if any.
+    uint32_t start = ext2_allocate_blocks(fs, prealloc->count ? (prealloc->start + prealloc->count) : goal, &length);
+    if (!start) {
+        return;
+    }
+    // Keep the current window only if the new blocks follow it.
+    if (prealloc->count && (start != prealloc->start + prealloc->count)) {
+        ext2_prealloc_discard(fs, file);
+    }
+    if (prealloc->count == 0) {
+        prealloc->start = start;
+    }
+    prealloc->count += length;
+}
+
+/// @brief Reserves, in one pass, the blocks a regular file needs to reach the
+/// given number of blocks.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @param blocks the number of blocks the file is going to have.
+static inline void
+ext2_prealloc_reserve(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t blocks)
+{
+    uint32_t allocated = ext2_inode_block_count(fs, inode);
+    if (blocks <= allocated) {
+        return;
+    }
+    vfs_file_t *file = ext2_prealloc_file(fs, inode, inode_index);
+    if (file) {
+        ext2_prealloc_fill(fs, file, ext2_block_goal(fs, inode, inode_index, allocated), blocks - allocated);
+    }
+}
+
+/// @brief Allocate a new block for an inode.
+/// @details Regular files which are open take their blocks from their
+/// preallocation window, so that they are laid out contiguously even when
+/// several files grow at the same time.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @param block_index The index of the block within the inode.
+/// @return 0 on success, -1 on failure.
+static int
+ext2_allocate_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t block_index)
+{
+    uint32_t goal       = ext2_block_goal(fs, inode, inode_index, block_index);
+    uint32_t real_index = 0;
+    uint32_t count      = 1;
+    // Allocate the block.
+    vfs_file_t *file    = ext2_prealloc_file(fs, inode, inode_index);
+    if (file) {
+        ext2_prealloc_fill(fs, file, goal, 1);
+        if (file->prealloc.count) {
+            real_index = file->prealloc.start++;
+            --file->prealloc.count;
+        }
+    } else {
+        real_index = ext2_allocate_blocks(fs, goal, &count);
+    }
+    if (real_index == 0) {
+        return -1;
+    }
+    ext2_clear_block(fs, real_index);
+    // Associate the real index and the index inside the inode.
     if (ext2_set_real_block_index(fs, inode, inode_index, block_index, real_index) == -1) {
         return -1;
     }
     pr_debug("ext2_allocate_inode_block(inode: %4u, block: %4u, real: %4u)\n", inode_index, block_index, real_index);
-    // Compute the new blocks count.
+    // Compute the new blocks count, the one of extent-mapped inodes also counts the nodes of the tree.
     uint32_t blocks_count = (block_index + 1) * fs->blocks_per_block_count;
-    if (inode->blocks_count < blocks_count) {
+    if (bitmask_check(inode->flags, EXT4_EXTENTS_FL)) {
+        inode->blocks_count += fs->blocks_per_block_count;
+    } else if (inode->blocks_count < blocks_count) {
         // Set the blocks count.
         inode->blocks_count = blocks_count;
         pr_debug("The new block count for inode %d is %d blocks.\n", inode_index, inode->blocks_count);
@@ -1684,7 +3326,7 @@ static ssize_t ext2_read_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode,
     }
 
     // Check if block index is out of range.
-    if (block_index >= (inode->blocks_count / fs->blocks_per_block_count)) {
+    if (block_index >= ext2_inode_block_count(fs, inode)) {
         pr_err(
             "Invalid block index: %u (inode blocks count: %u, blocks per block "
             "count: %u)\n",
@@ -1708,30 +3350,24 @@ static ssize_t ext2_read_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode,
     return ext2_read_block(fs, real_index, buffer);
 }
 
-/// @brief Writes the real block starting from an inode and the block index inside the inode.
+/// @brief Returns the real block of an inode, allocating the blocks up to it.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
 /// @param inode_index The index of the inode.
 /// @param block_index the index of the block within the inode.
-/// @param buffer the buffer where to put the data.
-/// @return the amount of data we wrote, or negative value for an error.
-static ssize_t ext2_write_inode_block(
-    ext2_filesystem_t *fs,
-    ext2_inode_t *inode,
-    uint32_t inode_index,
-    uint32_t block_index,
-    uint8_t *buffer)
+/// @return the real index of the block, 0 on failure.
+static uint32_t
+ext2_map_inode_block(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t block_index)
 {
     uint32_t total_blocks_needed;
     uint32_t allocated_blocks;
     uint32_t blocks_to_allocate;
-    uint32_t real_index;
 
     // Calculate total blocks needed.
     total_blocks_needed = block_index + 1;
 
     // Calculate currently allocated blocks.
-    allocated_blocks = inode->blocks_count / fs->blocks_per_block_count;
+    allocated_blocks = ext2_inode_block_count(fs, inode);
 
     // Determine additional blocks to allocate.
     blocks_to_allocate = 0;
@@ -1739,17 +3375,36 @@ static ssize_t ext2_write_inode_block(
         blocks_to_allocate = total_blocks_needed - allocated_blocks;
     }
 
-    // Allocate necessary blocks
+    // Reserve all the blocks at once, then allocate them.
+    ext2_prealloc_reserve(fs, inode, inode_index, total_blocks_needed);
     while (blocks_to_allocate > 0) {
         if (ext2_allocate_inode_block(fs, inode, inode_index, allocated_blocks++) < 0) {
             pr_crit("Failed to allocate inode block\n");
-            return -1;
+            return 0;
         }
         blocks_to_allocate--;
     }
 
     // Get the real index.
-    real_index = ext2_get_real_block_index(fs, inode, block_index);
+    return ext2_get_real_block_index(fs, inode, block_index);
+}
+
+/// @brief Writes the real block starting from an inode and the block index inside the inode.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index The index of the inode.
+/// @param block_index the index of the block within the inode.
+/// @param buffer the buffer where to put the data.
+/// @return the amount of data we wrote, or negative value for an error.
+static ssize_t ext2_write_inode_block(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    uint32_t inode_index,
+    uint32_t block_index,
+    uint8_t *buffer)
+{
+    // Get the real index, allocating the block if needed.
+    uint32_t real_index = ext2_map_inode_block(fs, inode, inode_index, block_index);
     if (real_index == 0) {
         return -1;
     }
@@ -1763,6 +3418,354 @@ static ssize_t ext2_write_inode_block(
     return ext2_write_block(fs, real_index, buffer);
 }
 
+/// @brief A slot of a batch of reads sent to the request queue, covering
+/// either a run of consecutive blocks, or a partially read block.
+typedef struct ext2_bio_slot {
+    /// The bio, NULL if the blocks have been read without the queue.
+    bio_t *bio;
+    /// The cache used for partially read blocks, NULL for runs of full blocks.
+    uint8_t *cache;
+    /// Where the data goes inside the output buffer.
+    char *dest;
+    /// The offset of the data inside the first block.
+    uint32_t left;
+    /// The amount of data we take from the blocks.
+    uint32_t length;
+} ext2_bio_slot_t;
+
+/// @brief Reads the data from the given inode, a run of blocks at a time.
+/// @details Consecutive blocks of the inode which are also consecutive on
+/// disk, and fully covered by the read, are read with a single transfer,
+/// straight into the output buffer. When the device has a request queue, the
+/// runs are submitted in batches, so that the elevator can sort them and merge
+/// the ones which are adjacent on disk.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index the index of the inode.
+/// @param offset the offset from which we start reading the data.
+/// @param end_offset the offset at which we stop reading the data.
+/// @param buffer the buffer containing the data.
+/// @return the amount we read.
+static ssize_t ext2_read_inode_runs(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    uint32_t inode_index,
+    uint32_t offset,
+    uint32_t end_offset,
+    char *buffer)
+{
+    ext2_bio_slot_t slots[EXT2_BIO_BATCH_SIZE];
+    // The number of sectors of a block.
+    uint32_t sectors_per_block = fs->block_size / BLK_SECTOR_SIZE;
+    // The number of blocks allocated for the inode.
+    uint32_t blocks_count      = ext2_inode_block_count(fs, inode);
+    // The maximum number of blocks of a run.
+    uint32_t run_max           = fs->queue ? max(fs->queue->max_sectors / sectors_per_block, 1) : EXT2_READ_RUN_MAX;
+    // The current position inside the inode.
+    uint32_t position          = offset;
+    // The outcome of the read.
+    ssize_t result             = end_offset - offset;
+    while (position < end_offset) {
+        unsigned int count = 0;
+        // Prepare a batch of reads.
+        for (; (count < EXT2_BIO_BATCH_SIZE) && (position < end_offset); ++count) {
+            ext2_bio_slot_t *slot = &slots[count];
+            uint32_t block_index  = position / fs->block_size;
+            uint32_t run_length   = 1;
+            slot->bio             = NULL;
+            slot->cache           = NULL;
+            slot->dest            = buffer + (position - offset);
+            slot->left            = position % fs->block_size;
+            slot->length          = min(fs->block_size - slot->left, end_offset - position);
+            position += slot->length;
+            // Get the real block index, holes read as zeros.
+            uint32_t real_index = (block_index < blocks_count) ? ext2_get_real_block_index(fs, inode, block_index) : 0;
+            if (real_index == 0) {
+                memset(slot->dest, 0, slot->length);
+                continue;
+            }
+            // Cached blocks are served from memory, their content might also
+            // be newer than the one on disk.
+            ext2_buffer_t *cached = ext2_buffer_find(fs, real_index);
+            if (cached) {
+                memcpy(slot->dest, cached->data + slot->left, slot->length);
+                continue;
+            }
+            // Partially read blocks go through the cache.
+            uint8_t *block_buffer = (uint8_t *)slot->dest;
+            if (slot->length != fs->block_size) {
+                if ((slot->cache = ext2_alloc_cache(fs)) == NULL) {
+                    memset(slot->dest, 0, slot->length);
+                    continue;
+                }
+                block_buffer = slot->cache;
+            } else {
+                // Extend the run over the following blocks, as long as they
+                // are fully read, adjacent on disk, and not cached.
+                while ((run_length < run_max) && (end_offset - position >= fs->block_size) &&
+                       (block_index + run_length < blocks_count) &&
+                       (ext2_get_real_block_index(fs, inode, block_index + run_length) == real_index + run_length) &&
+                       !ext2_buffer_find(fs, real_index + run_length)) {
+                    slot->length += fs->block_size;
+                    position += fs->block_size;
+                    ++run_length;
+                }
+            }
+            // Submit the read, if we fail, we read the blocks directly.
+            if (fs->queue) {
+                slot->bio = bio_alloc(real_index * sectors_per_block, run_length * sectors_per_block, block_buffer, 0);
+                if (slot->bio && (blk_submit_bio(fs->queue, slot->bio) < 0)) {
+                    bio_free(slot->bio);
+                    slot->bio = NULL;
+                }
+            }
+            if (!slot->bio) {
+                ssize_t ret;
+                if (slot->cache) {
+                    ret = ext2_read_block(fs, real_index, block_buffer);
+                } else {
+                    ret = vfs_read(
+                        fs->block_device, block_buffer, real_index * fs->block_size, run_length * fs->block_size);
+                }
+                if (ret < 0) {
+                    pr_warning("Failed to read the inode block %4u of inode %4u\n", block_index, inode_index);
+                    result = -1;
+                }
+            }
+        }
+        // Dispatch the batch.
+        blk_run_queue(fs->queue);
+        // Complete the batch.
+        for (unsigned int i = 0; i < count; ++i) {
+            ext2_bio_slot_t *slot = &slots[i];
+            if (slot->bio) {
+                if (slot->bio->status < 0) {
+                    pr_warning("Failed to read sector %u of inode %4u\n", slot->bio->sector, inode_index);
+                    result = -1;
+                }
+                bio_free(slot->bio);
+            }
+            if (slot->cache) {
+                memcpy(slot->dest, slot->cache + slot->left, slot->length);
+                ext2_dealloc_cache(slot->cache);
+            }
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// Page Cache Functions
+// ============================================================================
+
+/// @brief Returns the hash bucket of a page.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+/// @param index the index of the page inside the file.
+/// @return the bucket.
+static inline list_head_t *ext2_page_bucket(ext2_filesystem_t *fs, uint32_t inode_index, uint32_t index)
+{
+    return &fs->page_hash[(inode_index * 31U + index) % EXT2_PAGE_HASH_SIZE];
+}
+
+/// @brief Searches for a page inside the page cache.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+/// @param index the index of the page inside the file.
+/// @return a pointer to the page, NULL if it is not cached.
+static inline ext2_page_t *ext2_page_find(ext2_filesystem_t *fs, uint32_t inode_index, uint32_t index)
+{
+    list_for_each_decl (it, ext2_page_bucket(fs, inode_index, index)) {
+        ext2_page_t *page = list_entry(it, ext2_page_t, hash);
+        if ((page->inode_index == inode_index) && (page->index == index)) {
+            return page;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Removes a page from the cache, and frees it.
+/// @param fs the filesystem.
+/// @param page the page.
+static inline void ext2_page_free(ext2_filesystem_t *fs, ext2_page_t *page)
+{
+    list_head_remove(&page->hash);
+    list_head_remove(&page->lru);
+    --fs->page_count;
+    free_pages_lowmem((uint32_t)page->data);
+    kfree(page);
+}
+
+/// @brief Drops all the cached pages of an inode.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+static void ext2_page_invalidate(ext2_filesystem_t *fs, uint32_t inode_index)
+{
+    list_for_each_safe_decl(it, store, &fs->page_lru)
+    {
+        ext2_page_t *page = list_entry(it, ext2_page_t, lru);
+        if (page->inode_index == inode_index) {
+            ext2_page_free(fs, page);
+        }
+    }
+}
+
+/// @brief Frees the least recently used pages, once memory runs low.
+/// @param shrinker the shrinker of the page cache of the filesystem.
+/// @param nr_pages the number of pages to free.
+/// @return the number of pages freed.
+static unsigned long ext2_page_scan(shrinker_t *shrinker, unsigned long nr_pages)
+{
+    ext2_filesystem_t *fs = list_entry(shrinker, ext2_filesystem_t, page_shrinker);
+    unsigned long freed   = 0;
+    list_for_each_safe_decl(it, store, &fs->page_lru)
+    {
+        if (freed >= nr_pages) {
+            break;
+        }
+        ext2_page_t *page = list_entry(it, ext2_page_t, lru);
+        // The pages are written through, but the ones of a locked inode might
+        // be in use by a task sleeping inside the filesystem.
+        rwlock_t *lock = ext2_inode_lock_of(fs, page->inode_index);
+        if (!lock->readers && !lock->writer) {
+            ext2_page_free(fs, page);
+            ++freed;
+        }
+    }
+    return freed;
+}
+
+/// @brief Adds a new page to the cache, evicting the least recently used one
+/// if the cache is full.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+/// @param index the index of the page inside the file.
+/// @return a pointer to the page, whose content is undefined, NULL on failure.
+static ext2_page_t *ext2_page_add(ext2_filesystem_t *fs, uint32_t inode_index, uint32_t index)
+{
+    if (fs->page_count >= EXT2_PAGE_CACHE_MAX) {
+        ext2_page_free(fs, list_entry(fs->page_lru.next, ext2_page_t, lru));
+    }
+    ext2_page_t *page = kmalloc(sizeof(ext2_page_t));
+    if (!page) {
+        return NULL;
+    }
+    if ((page->data = (uint8_t *)alloc_pages_lowmem(GFP_KERNEL, 0)) == NULL) {
+        kfree(page);
+        return NULL;
+    }
+    page->inode_index = inode_index;
+    page->index       = index;
+    list_head_insert_before(&page->hash, ext2_page_bucket(fs, inode_index, index));
+    list_head_insert_before(&page->lru, &fs->page_lru);
+    ++fs->page_count;
+    return page;
+}
+
+/// @brief Returns a page of a regular file, reading it on a miss.
+/// @param fs the filesystem.
+/// @param inode the inode of the file.
+/// @param inode_index the index of the inode.
+/// @param index the index of the page inside the file.
+/// @return a pointer to the page, NULL on failure.
+static ext2_page_t *ext2_page_get(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint32_t index)
+{
+    ext2_page_t *page = ext2_page_find(fs, inode_index, index);
+    if (page) {
+        // Move the page at the end of the LRU list.
+        list_head_remove(&page->lru);
+        list_head_insert_before(&page->lru, &fs->page_lru);
+        return page;
+    }
+    if ((page = ext2_page_add(fs, inode_index, index)) == NULL) {
+        return NULL;
+    }
+    // Read the data of the page, the part past the end of the file is zero.
+    uint32_t start = index * PAGE_SIZE;
+    uint32_t end   = min(start + PAGE_SIZE, inode->size);
+    memset(page->data, 0, PAGE_SIZE);
+    if ((end > start) && (ext2_read_inode_runs(fs, inode, inode_index, start, end, (char *)page->data) < 0)) {
+        ext2_page_free(fs, page);
+        return NULL;
+    }
+    return page;
+}
+
+/// @brief Copies the data written on a regular file inside its cached pages.
+/// @param fs the filesystem.
+/// @param inode_index the index of the inode.
+/// @param offset the offset from which the data has been written.
+/// @param nbyte the number of bytes written.
+/// @param buffer the buffer containing the data.
+static void
+ext2_page_update(ext2_filesystem_t *fs, uint32_t inode_index, uint32_t offset, size_t nbyte, const char *buffer)
+{
+    uint32_t end_offset = offset + nbyte;
+    for (uint32_t index = offset / PAGE_SIZE; index * PAGE_SIZE < end_offset; ++index) {
+        ext2_page_t *page = ext2_page_find(fs, inode_index, index);
+        if (page) {
+            uint32_t start = max(offset, index * PAGE_SIZE);
+            uint32_t end   = min(end_offset, (index + 1) * PAGE_SIZE);
+            memcpy(page->data + (start - index * PAGE_SIZE), buffer + (start - offset), end - start);
+        }
+    }
+}
+
+/// @brief Reads the data of a regular file, through the page cache.
+/// @details Consecutive missing pages which are fully covered by the read are
+/// read with a single batch, straight into the output buffer, and then copied
+/// inside the cache.
+/// @param fs the filesystem.
+/// @param inode the inode of the file.
+/// @param inode_index the index of the inode.
+/// @param offset the offset from which we start reading the data.
+/// @param end_offset the offset at which we stop reading the data.
+/// @param buffer the buffer where we store the data.
+/// @return the amount we read, or -1 on failure.
+static ssize_t ext2_read_inode_pages(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    uint32_t inode_index,
+    uint32_t offset,
+    uint32_t end_offset,
+    char *buffer)
+{
+    for (uint32_t position = offset; position < end_offset;) {
+        uint32_t left     = position % PAGE_SIZE;
+        uint32_t length   = min(PAGE_SIZE - left, end_offset - position);
+        char *dest        = buffer + (position - offset);
+        uint32_t index    = position / PAGE_SIZE;
+        ext2_page_t *page = ext2_page_find(fs, inode_index, index);
+        if (!page && (length == PAGE_SIZE)) {
+            // Find the run of missing pages which are fully covered by the read.
+            uint32_t count = 1;
+            while ((position + (count + 1) * PAGE_SIZE <= end_offset) && (count < EXT2_PAGE_CACHE_MAX) &&
+                   !ext2_page_find(fs, inode_index, index + count)) {
+                ++count;
+            }
+            if (ext2_read_inode_runs(fs, inode, inode_index, position, position + count * PAGE_SIZE, dest) < 0) {
+                return -1;
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                if ((page = ext2_page_add(fs, inode_index, index + i)) != NULL) {
+                    memcpy(page->data, dest + i * PAGE_SIZE, PAGE_SIZE);
+                }
+            }
+            position += count * PAGE_SIZE;
+            continue;
+        }
+        page = ext2_page_get(fs, inode, inode_index, index);
+        if (page) {
+            memcpy(dest, page->data + left, length);
+        } else if (ext2_read_inode_runs(fs, inode, inode_index, position, position + length, dest) < 0) {
+            // If we cannot cache the page, we read the data directly.
+            return -1;
+        }
+        position += length;
+    }
+    return end_offset - offset;
+}
+
 /// @brief Reads the data from the given inode.
 /// @param fs the filesystem.
 /// @param inode the inode which we are working with.
@@ -1780,49 +3783,21 @@ static ssize_t ext2_read_inode_data(
     char *buffer)
 {
     // Get the offset to the end of the portion we are reading.
-    uint32_t end_offset  = (inode->size >= offset + nbyte) ? (offset + nbyte) : (inode->size);
-    // Convert the offset/size to some starting/end iblock numbers.
-    uint32_t start_block = offset / fs->block_size;
-    uint32_t end_block   = end_offset / fs->block_size;
-    // What's the offset into the start block.
-    uint32_t start_off   = offset % fs->block_size;
-    // How much bytes to read for the end block.
-    uint32_t end_size    = end_offset - (end_block * fs->block_size);
+    uint32_t end_offset = (inode->size >= offset + nbyte) ? (offset + nbyte) : (inode->size);
 
 #ifdef EXT2_FULL_DEBUG
     pr_debug("ext2_read_inode_data(inode: %4u, offset: %4u, nbyte: %4u)\n", inode_index, offset, nbyte);
 #endif
 
-    // Allocate the cache.
-    uint8_t *cache = ext2_alloc_cache(fs);
-
-    uint32_t curr_off = 0;
-    uint32_t left;
-    uint32_t right;
-    uint32_t ret = end_offset - offset;
-    for (uint32_t block_index = start_block; block_index <= end_block; ++block_index) {
-        left = 0, right = fs->block_size - 1;
-        // Read the real block.
-        if (ext2_read_inode_block(fs, inode, block_index, cache) == -1) {
-            // TODO: Understand why sometimes it fails.
-            pr_warning("Failed to read the inode block %4u of inode %4u\n", block_index, inode_index);
-            // ret = -1;
-            // break;
-        }
-        if (block_index == start_block) {
-            left = start_off;
-        }
-        if (block_index == end_block) {
-            right = end_size - 1;
-        }
-        // Copy the content back to the buffer.
-        memcpy(buffer + curr_off, cache + left, (right - left + 1));
-        // Move the offset.
-        curr_off += (right - left + 1);
+    // There is nothing to read past the end of the file.
+    if (end_offset <= offset) {
+        return 0;
     }
-    // Free the cache.
-    ext2_dealloc_cache(cache);
-    return ret;
+    // Regular files go through the page cache.
+    if (S_ISREG(inode->mode)) {
+        return ext2_read_inode_pages(fs, inode, inode_index, offset, end_offset, buffer);
+    }
+    return ext2_read_inode_runs(fs, inode, inode_index, offset, end_offset, buffer);
 }
 
 /// @brief Writes the data on the given inode.
@@ -1841,6 +3816,8 @@ static ssize_t ext2_write_inode_data(
     size_t nbyte,
     char *buffer)
 {
+    // Drop the data we read ahead, it is going to be stale.
+    ext2_readahead_invalidate(fs, inode_index);
     if ((offset + nbyte) > inode->size) {
         inode->size = offset + nbyte;
         if (ext2_write_inode(fs, inode, inode_index) == -1) {
@@ -1862,6 +3839,9 @@ static ssize_t ext2_write_inode_data(
     pr_debug("ext2_write_inode_data(inode: %4u, offset: %4u, nbyte: %4u)\n", inode_index, offset, nbyte);
 #endif
 
+    // Reserve the blocks the write adds to the file in one pass.
+    ext2_prealloc_reserve(fs, inode, inode_index, end_block + 1);
+
     // Allocate the cache.
     uint8_t *cache = ext2_alloc_cache(fs);
 
@@ -1886,7 +3866,7 @@ static ssize_t ext2_write_inode_data(
         // Move the offset.
         curr_off += (right - left + 1);
         // Write the block back.
-        if (!ext2_write_inode_block(fs, inode, inode_index, block_index, cache)) {
+        if (ext2_write_inode_block(fs, inode, inode_index, block_index, cache) < 0) {
             pr_err("Failed to write the inode block %u of inode %u\n", block_index, inode_index);
             ret = -1;
             break;
@@ -1894,44 +3874,170 @@ static ssize_t ext2_write_inode_data(
     }
     // Free the cache.
     ext2_dealloc_cache(cache);
+    // Keep the cached pages in sync with the blocks.
+    if (S_ISREG(inode->mode)) {
+        if (ret == (uint32_t)-1) {
+            ext2_page_invalidate(fs, inode_index);
+        } else {
+            ext2_page_update(fs, inode_index, offset, end_offset - offset, buffer);
+        }
+    }
     return ret;
 }
 
-// ============================================================================
-// Directory Entry Iteration Functions
-// ============================================================================
-
-/// @brief Iterator for visiting the directory entries.
-typedef struct ext2_direntry_iterator {
-    ext2_filesystem_t *fs;   ///< A pointer to the filesystem.
-    uint8_t *cache;          ///< Cache used for reading.
-    ext2_inode_t *inode;     ///< A pointer to the directory inode.
-    uint32_t block_index;    ///< The current block we are reading.
-    uint32_t total_offset;   ///< The total amount of bytes we have read.
-    uint32_t block_offset;   ///< The total amount of bytes we have read inside the current block.
-    ext2_dirent_t *direntry; ///< Pointer to the directory entry.
-} ext2_direntry_iterator_t;
-
-/// @brief Returns the ext2_dirent_t pointed by the iterator.
-/// @param it the iterator.
-/// @return pointer to the ext2_dirent_t
-ext2_dirent_t *ext2_direntry_iterator_get(ext2_direntry_iterator_t *it)
+/// @brief Checks if a transfer of an O_DIRECT file is aligned: the offset and
+/// the size on the blocks of the filesystem, the buffer on the sectors.
+/// @param fs the filesystem.
+/// @param offset the offset of the transfer.
+/// @param nbyte the size of the transfer.
+/// @param buffer the buffer of the transfer.
+/// @return 1 if it is aligned, 0 otherwise.
+static inline int ext2_direct_aligned(ext2_filesystem_t *fs, off_t offset, size_t nbyte, const void *buffer)
 {
-    return (ext2_dirent_t *)((uintptr_t)it->cache + it->block_offset);
+    return !(offset % fs->block_size) && !(nbyte % fs->block_size) && !((uintptr_t)buffer % BLK_SECTOR_SIZE);
 }
 
-/// @brief Check if the iterator is valid.
-/// @param it the iterator to check.
-/// @return 1 if valid, 0 otherwise.
-int ext2_direntry_iterator_valid(ext2_direntry_iterator_t *it) { return it->direntry != NULL; }
-
-/// @brief Initializes the iterator and reads the first block.
-/// @param fs pointer to the filesystem.
-/// @param cache used for reading.
-/// @param inode pointer to the directory inode.
-/// @return The initialized directory iterator.
-ext2_direntry_iterator_t ext2_direntry_iterator_begin(ext2_filesystem_t *fs, uint8_t *cache, ext2_inode_t *inode)
-{
+/// @brief Writes whole blocks of a regular file straight from the buffer to
+/// the device, bypassing the buffer cache.
+/// @details Runs of blocks which are consecutive on disk are written with a
+/// single bio, in batches, like the reads. The blocks which are already inside
+/// the buffer cache are updated there instead, so that the cache never holds
+/// stale data, and the cached pages are updated as for any other write.
+/// @param fs the filesystem.
+/// @param inode the inode which we are working with.
+/// @param inode_index the index of the inode.
+/// @param offset the offset from which we start writing, aligned on a block.
+/// @param nbyte the number of bytes to write, a multiple of the block size.
+/// @param buffer the buffer containing the data.
+/// @return the amount written, or -1 on failure.
+static ssize_t ext2_write_inode_direct(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    uint32_t inode_index,
+    off_t offset,
+    size_t nbyte,
+    const char *buffer)
+{
+    bio_t *bios[EXT2_BIO_BATCH_SIZE];
+    // The number of sectors of a block.
+    uint32_t sectors_per_block = fs->block_size / BLK_SECTOR_SIZE;
+    // The maximum number of blocks of a run.
+    uint32_t run_max     = fs->queue ? max(fs->queue->max_sectors / sectors_per_block, 1) : EXT2_READ_RUN_MAX;
+    uint32_t start_block = offset / fs->block_size;
+    uint32_t end_block   = (offset + nbyte) / fs->block_size;
+    ssize_t result       = nbyte;
+    // Drop the data we read ahead, it is going to be stale.
+    ext2_readahead_invalidate(fs, inode_index);
+    if ((offset + nbyte) > inode->size) {
+        inode->size = offset + nbyte;
+        if (ext2_write_inode(fs, inode, inode_index) == -1) {
+            pr_err("Failed to write the inode `%d`\n", inode_index);
+            return -1;
+        }
+    }
+    // Reserve the blocks the write adds to the file in one pass.
+    ext2_prealloc_reserve(fs, inode, inode_index, end_block);
+    for (uint32_t block_index = start_block; (block_index < end_block) && (result >= 0);) {
+        unsigned int count = 0;
+        // Prepare a batch of writes.
+        for (; (count < EXT2_BIO_BATCH_SIZE) && (block_index < end_block) && (result >= 0); ++count) {
+            const char *source  = buffer + (block_index - start_block) * fs->block_size;
+            uint32_t real_index = ext2_map_inode_block(fs, inode, inode_index, block_index);
+            uint32_t run_length = 1;
+            bios[count]         = NULL;
+            if (real_index == 0) {
+                result = -1;
+                break;
+            }
+            // Cached blocks are updated inside the cache.
+            if (ext2_buffer_find(fs, real_index)) {
+                if (ext2_write_block(fs, real_index, (uint8_t *)source) < 0) {
+                    result = -1;
+                }
+                ++block_index;
+                continue;
+            }
+            // Extend the run over the following blocks, as long as they are
+            // adjacent on disk, and not cached.
+            while ((run_length < run_max) && (block_index + run_length < end_block)) {
+                uint32_t next = ext2_map_inode_block(fs, inode, inode_index, block_index + run_length);
+                if ((next != real_index + run_length) || ext2_buffer_find(fs, next)) {
+                    break;
+                }
+                ++run_length;
+            }
+            block_index += run_length;
+            // Submit the write, if we fail, we write the blocks directly.
+            if (fs->queue) {
+                bios[count] = bio_alloc(
+                    real_index * sectors_per_block, run_length * sectors_per_block, (uint8_t *)source, 1);
+                if (bios[count] && (blk_submit_bio(fs->queue, bios[count]) < 0)) {
+                    bio_free(bios[count]);
+                    bios[count] = NULL;
+                }
+            }
+            if (!bios[count] &&
+                (vfs_write(fs->block_device, source, real_index * fs->block_size, run_length * fs->block_size) < 0)) {
+                pr_warning("Failed to write the inode block %4u of inode %4u\n", block_index, inode_index);
+                result = -1;
+            }
+        }
+        // Dispatch, and complete, the batch.
+        blk_run_queue(fs->queue);
+        for (unsigned int i = 0; i < count; ++i) {
+            if (bios[i]) {
+                if (bios[i]->status < 0) {
+                    pr_warning("Failed to write sector %u of inode %4u\n", bios[i]->sector, inode_index);
+                    result = -1;
+                }
+                bio_free(bios[i]);
+            }
+        }
+    }
+    // Keep the cached pages in sync with the blocks.
+    if (result < 0) {
+        ext2_page_invalidate(fs, inode_index);
+    } else {
+        ext2_page_update(fs, inode_index, offset, nbyte, buffer);
+    }
+    return result;
+}
+
+// ============================================================================
+// Directory Entry Iteration Functions
+// ============================================================================
+
+/// @brief Iterator for visiting the directory entries.
+typedef struct ext2_direntry_iterator {
+    ext2_filesystem_t *fs;   ///< A pointer to the filesystem.
+    uint8_t *cache;          ///< Cache used for reading.
+    ext2_inode_t *inode;     ///< A pointer to the directory inode.
+    uint32_t block_index;    ///< The current block we are reading.
+    uint32_t total_offset;   ///< The total amount of bytes we have read.
+    uint32_t block_offset;   ///< The total amount of bytes we have read inside the current block.
+    ext2_dirent_t *direntry; ///< Pointer to the directory entry.
+} ext2_direntry_iterator_t;
+
+/// @brief Returns the ext2_dirent_t pointed by the iterator.
+/// @param it the iterator.
+/// @return pointer to the ext2_dirent_t
+ext2_dirent_t *ext2_direntry_iterator_get(ext2_direntry_iterator_t *it)
+{
+    return (ext2_dirent_t *)((uintptr_t)it->cache + it->block_offset);
+}
+
+/// @brief Check if the iterator is valid.
+/// @param it the iterator to check.
+/// @return 1 if valid, 0 otherwise.
+int ext2_direntry_iterator_valid(ext2_direntry_iterator_t *it) { return it->direntry != NULL; }
+
+/// @brief Initializes the iterator and reads the first block.
+/// @param fs pointer to the filesystem.
+/// @param cache used for reading.
+/// @param inode pointer to the directory inode.
+/// @return The initialized directory iterator.
+ext2_direntry_iterator_t ext2_direntry_iterator_begin(ext2_filesystem_t *fs, uint8_t *cache, ext2_inode_t *inode)
+{
     ext2_direntry_iterator_t it = {
         .fs           = fs,
         .cache        = cache,
@@ -1979,6 +4085,44 @@ void ext2_direntry_iterator_next(ext2_direntry_iterator_t *it)
     it->direntry = ext2_direntry_iterator_get(it);
 }
 
+/// @brief Initializes the iterator at the given offset inside the directory.
+/// @details The block is walked from its beginning, so that the iterator lands
+/// on an entry boundary. If the offset does not point to an entry anymore
+/// (e.g., the directory changed), the iterator moves to the following one.
+/// @param fs pointer to the filesystem.
+/// @param cache used for reading.
+/// @param inode pointer to the directory inode.
+/// @param offset the offset inside the directory.
+/// @return The initialized directory iterator.
+ext2_direntry_iterator_t
+ext2_direntry_iterator_seek(ext2_filesystem_t *fs, uint8_t *cache, ext2_inode_t *inode, uint32_t offset)
+{
+    uint32_t block_offset       = offset % fs->block_size;
+    ext2_direntry_iterator_t it = {
+        .fs           = fs,
+        .cache        = cache,
+        .inode        = inode,
+        .block_index  = offset / fs->block_size,
+        .total_offset = offset - block_offset,
+        .block_offset = 0,
+        .direntry     = NULL};
+    // If we are past the end of the directory, the iterator is not valid.
+    if (offset >= inode->size) {
+        return it;
+    }
+    // Read the block containing the offset.
+    if (ext2_read_inode_block(fs, inode, it.block_index, cache) == -1) {
+        pr_err("Failed to read the inode block `%d`\n", it.block_index);
+        return it;
+    }
+    it.direntry = ext2_direntry_iterator_get(&it);
+    // Skip the entries which start before the offset.
+    while (ext2_direntry_iterator_valid(&it) && (it.total_offset < offset)) {
+        ext2_direntry_iterator_next(&it);
+    }
+    return it;
+}
+
 /// @brief Checks if the directory is empty.
 /// @param fs a pointer to the filesystem.
 /// @param cache used for reading.
@@ -2011,6 +4155,8 @@ static int ext2_clean_inode_content(ext2_filesystem_t *fs, ext2_inode_t *inode,
         pr_alert("Trying to clean the content of a non-regular file.\n");
         return 1;
     }
+    // Drop the data we read ahead, it is going to be stale.
+    ext2_readahead_invalidate(fs, inode_index);
     // Allocate the cache.
     uint8_t *cache    = ext2_alloc_cache(fs);
     // Get the cache size.
@@ -2319,19 +4465,996 @@ static inline int ext2_create_new_direntry(
         pr_err("Failed to update the block of the father directory.\n");
         return 0;
     }
-    pr_debug("Created new directory entry:\n");
-    ext2_dump_dirent(it.direntry);
-    return 1;
+    pr_debug("Created new directory entry:\n");
+    ext2_dump_dirent(it.direntry);
+    return 1;
+}
+
+/// @brief Computes the hash of a (parent inode, name) pair.
+/// @param ino the inode of the parent directory.
+/// @param name the name of the entry.
+/// @return the hash value.
+static inline uint32_t ext2_dcache_hash(ino_t ino, const char *name)
+{
+    uint32_t hash = 5381U ^ (uint32_t)ino;
+    while (*name) {
+        hash = ((hash << 5U) + hash) + (uint8_t)(*name++);
+    }
+    return hash;
+}
+
+/// @brief Searches for a lookup inside the dentry cache.
+/// @param fs the filesystem.
+/// @param ino the inode of the parent directory.
+/// @param name the name of the entry.
+/// @return a pointer to the cached lookup, NULL if there is none.
+static inline ext2_dcache_entry_t *ext2_dcache_find(ext2_filesystem_t *fs, ino_t ino, const char *name)
+{
+    uint32_t hash_value = ext2_dcache_hash(ino, name);
+    list_for_each_decl (it, &fs->dentry_hash[hash_value % EXT2_DCACHE_HASH_SIZE]) {
+        ext2_dcache_entry_t *entry = list_entry(it, ext2_dcache_entry_t, hash);
+        if ((entry->hash_value == hash_value) && (entry->search.parent_inode == ino) && !strcmp(entry->name, name)) {
+            // Move the entry at the end of the LRU list.
+            list_head_remove(&entry->lru);
+            list_head_insert_before(&entry->lru, &fs->dentry_lru);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Adds the result of a lookup to the dentry cache.
+/// @param fs the filesystem.
+/// @param ino the inode of the parent directory.
+/// @param name the name of the entry.
+/// @param search the result of the search, NULL if the entry does not exist.
+static inline void ext2_dcache_insert(ext2_filesystem_t *fs, ino_t ino, const char *name, ext2_direntry_search_t *search)
+{
+    ext2_dcache_entry_t *entry;
+    if (strlen(name) > EXT2_NAME_LEN) {
+        return;
+    }
+    if (fs->dentry_count >= EXT2_DCACHE_MAX) {
+        // Recycle the least recently used entry.
+        entry = list_entry(fs->dentry_lru.next, ext2_dcache_entry_t, lru);
+        list_head_remove(&entry->hash);
+        list_head_remove(&entry->lru);
+        --fs->dentry_count;
+    } else if ((entry = kmalloc(sizeof(ext2_dcache_entry_t))) == NULL) {
+        return;
+    }
+    entry->hash_value = ext2_dcache_hash(ino, name);
+    entry->negative   = (search == NULL);
+    strcpy(entry->name, name);
+    if (search) {
+        memcpy(&entry->search, search, sizeof(ext2_direntry_search_t));
+    }
+    entry->search.parent_inode = ino;
+    list_head_insert_before(&entry->hash, &fs->dentry_hash[entry->hash_value % EXT2_DCACHE_HASH_SIZE]);
+    list_head_insert_before(&entry->lru, &fs->dentry_lru);
+    ++fs->dentry_count;
+}
+
+/// @brief Drops all the cached lookups inside the given directory, it must be
+/// called whenever the entries of the directory change.
+/// @param fs the filesystem.
+/// @param ino the inode of the directory.
+static inline void ext2_dcache_invalidate(ext2_filesystem_t *fs, ino_t ino)
+{
+    list_for_each_safe_decl(it, store, &fs->dentry_lru)
+    {
+        ext2_dcache_entry_t *entry = list_entry(it, ext2_dcache_entry_t, lru);
+        if (entry->search.parent_inode == ino) {
+            list_head_remove(&entry->hash);
+            list_head_remove(&entry->lru);
+            --fs->dentry_count;
+            kfree(entry);
+        }
+    }
+}
+
+// ============================================================================
+// HTree Directory Index Functions
+// ============================================================================
+
+/// @brief A level of a walk through an HTree, from the root to the leaves.
+typedef struct ext2_dx_frame {
+    /// The content of the index block.
+    uint8_t *cache;
+    /// The index of the block within the directory.
+    uint32_t block_index;
+    /// The entries of the node.
+    ext2_dx_entry_t *entries;
+    /// The entry we followed.
+    ext2_dx_entry_t *at;
+} ext2_dx_frame_t;
+
+/// @brief The walk through an HTree which leads to a name.
+typedef struct ext2_dx_path {
+    /// The levels of the walk, the first one is the root.
+    ext2_dx_frame_t frames[EXT2_DX_MAX_LEVELS];
+    /// Number of levels of the walk.
+    uint32_t levels;
+    /// The hash function used by the tree.
+    uint8_t hash_version;
+    /// The hash of the name.
+    uint32_t hash;
+} ext2_dx_path_t;
+
+/// @brief A live entry of a leaf, used when splitting the leaf.
+typedef struct ext2_dx_map {
+    /// The hash of the name of the entry.
+    uint32_t hash;
+    /// The offset of the entry inside the leaf.
+    uint32_t offset;
+} ext2_dx_map_t;
+
+/// @brief Rotates a 32-bit value to the left.
+#define EXT2_DX_ROL(x, s)                    (((x) << (s)) | ((x) >> (32 - (s))))
+/// @brief Round of the half MD4 transform.
+#define EXT2_DX_MD4_ROUND(f, a, b, c, d, x, s) ((a) += f(b, c, d) + (x), (a) = EXT2_DX_ROL(a, s))
+/// @brief First function of the half MD4 transform.
+#define EXT2_DX_MD4_F(x, y, z)               ((z) ^ ((x) & ((y) ^ (z))))
+/// @brief Second function of the half MD4 transform.
+#define EXT2_DX_MD4_G(x, y, z)               (((x) & (y)) + (((x) ^ (y)) & (z)))
+/// @brief Third function of the half MD4 transform.
+#define EXT2_DX_MD4_H(x, y, z)               ((x) ^ (y) ^ (z))
+
+/// @brief Returns the value of a character of a name, as seen by the hash.
+/// @param c the character.
+/// @param unsigned_char if characters are hashed as unsigned.
+/// @return the value of the character.
+static inline int ext2_dx_char(char c, int unsigned_char)
+{
+    return unsigned_char ? (int)(unsigned char)c : (int)(signed char)c;
+}
+
+/// @brief The legacy hash of the HTree.
+/// @param name the name.
+/// @param len the length of the name.
+/// @param unsigned_char if characters are hashed as unsigned.
+/// @return the hash of the name.
+static inline uint32_t ext2_dx_hack_hash(const char *name, uint32_t len, int unsigned_char)
+{
+    uint32_t hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+    for (uint32_t i = 0; i < len; ++i) {
+        hash = hash1 + (hash0 ^ ((uint32_t)ext2_dx_char(name[i], unsigned_char) * 7152373U));
+        if (hash & 0x80000000) {
+            hash -= 0x7fffffff;
+        }
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+/// @brief Packs a name into the input of the TEA and half MD4 transforms.
+/// @param name the name.
+/// @param len the remaining length of the name.
+/// @param buffer the output buffer.
+/// @param num the number of words of the buffer.
+/// @param unsigned_char if characters are hashed as unsigned.
+static inline void ext2_dx_str2hashbuf(const char *name, uint32_t len, uint32_t *buffer, int num, int unsigned_char)
+{
+    uint32_t pad = len | (len << 8), val;
+    pad |= pad << 16;
+    val = pad;
+    len = min(len, (uint32_t)num * 4);
+    for (uint32_t i = 0; i < len; ++i) {
+        val = (uint32_t)ext2_dx_char(name[i], unsigned_char) + (val << 8);
+        if ((i % 4) == 3) {
+            *buffer++ = val;
+            val       = pad;
+            --num;
+        }
+    }
+    if (--num >= 0) {
+        *buffer++ = val;
+    }
+    while (--num >= 0) {
+        *buffer++ = pad;
+    }
+}
+
+/// @brief The TEA transform.
+/// @param buffer the state of the hash.
+/// @param in the input words.
+static inline void ext2_dx_tea_transform(uint32_t *buffer, const uint32_t *in)
+{
+    uint32_t sum = 0, b0 = buffer[0], b1 = buffer[1];
+    for (int n = 0; n < 16; ++n) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+        b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+    }
+    buffer[0] += b0;
+    buffer[1] += b1;
+}
+
+/// @brief The half MD4 transform.
+/// @param buffer the state of the hash.
+/// @param in the input words.
+static inline void ext2_dx_half_md4_transform(uint32_t *buffer, const uint32_t *in)
+{
+    const uint32_t k2 = 013240474631UL, k3 = 015666365641UL;
+    uint32_t a = buffer[0], b = buffer[1], c = buffer[2], d = buffer[3];
+    // Round 1.
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, a, b, c, d, in[0], 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, d, a, b, c, in[1], 7);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, c, d, a, b, in[2], 11);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, b, c, d, a, in[3], 19);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, a, b, c, d, in[4], 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, d, a, b, c, in[5], 7);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, c, d, a, b, in[6], 11);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_F, b, c, d, a, in[7], 19);
+    // Round 2.
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, a, b, c, d, in[1] + k2, 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, d, a, b, c, in[3] + k2, 5);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, c, d, a, b, in[5] + k2, 9);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, b, c, d, a, in[7] + k2, 13);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, a, b, c, d, in[0] + k2, 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, d, a, b, c, in[2] + k2, 5);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, c, d, a, b, in[4] + k2, 9);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_G, b, c, d, a, in[6] + k2, 13);
+    // Round 3.
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, a, b, c, d, in[3] + k3, 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, d, a, b, c, in[7] + k3, 9);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, c, d, a, b, in[2] + k3, 11);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, b, c, d, a, in[6] + k3, 15);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, a, b, c, d, in[1] + k3, 3);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, d, a, b, c, in[5] + k3, 9);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, c, d, a, b, in[0] + k3, 11);
+    EXT2_DX_MD4_ROUND(EXT2_DX_MD4_H, b, c, d, a, in[4] + k3, 15);
+    buffer[0] += a;
+    buffer[1] += b;
+    buffer[2] += c;
+    buffer[3] += d;
+}
+
+/// @brief Computes the hash of a name, as done by the HTree.
+/// @param fs a pointer to the filesystem, which provides the seed.
+/// @param name the name.
+/// @param len the length of the name.
+/// @param hash_version the hash function.
+/// @return the hash of the name, whose lowest bit is always zero.
+static uint32_t ext2_dx_hash(ext2_filesystem_t *fs, const char *name, uint32_t len, uint8_t hash_version)
+{
+    uint32_t buffer[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    uint32_t in[8], hash = 0;
+    // The seed is used only if it has been set.
+    for (int i = 0; i < 4; ++i) {
+        if (fs->superblock.hash_seed[i]) {
+            memcpy(buffer, fs->superblock.hash_seed, sizeof(buffer));
+            break;
+        }
+    }
+    int unsigned_char = hash_version >= EXT2_DX_HASH_UNSIGNED;
+    if (unsigned_char) {
+        hash_version -= EXT2_DX_HASH_UNSIGNED;
+    }
+    if (hash_version == EXT2_DX_HASH_LEGACY) {
+        hash = ext2_dx_hack_hash(name, len, unsigned_char);
+    } else if (hash_version == EXT2_DX_HASH_HALF_MD4) {
+        for (int remaining = len; remaining > 0; remaining -= 32, name += 32) {
+            ext2_dx_str2hashbuf(name, remaining, in, 8, unsigned_char);
+            ext2_dx_half_md4_transform(buffer, in);
+        }
+        hash = buffer[1];
+    } else if (hash_version == EXT2_DX_HASH_TEA) {
+        for (int remaining = len; remaining > 0; remaining -= 16, name += 16) {
+            ext2_dx_str2hashbuf(name, remaining, in, 4, unsigned_char);
+            ext2_dx_tea_transform(buffer, in);
+        }
+        hash = buffer[0];
+    }
+    // The lowest bit is reserved to mark hash collisions between leaves, and
+    // the highest value is reserved as well.
+    hash &= ~1U;
+    if (hash == (0x7fffffffU << 1)) {
+        hash = (0x7fffffffU - 1) << 1;
+    }
+    return hash;
+}
+
+/// @brief Checks if the directory is indexed with an HTree.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @return 1 if indexed, 0 otherwise.
+static inline int ext2_dx_is_indexed(ext2_filesystem_t *fs, ext2_inode_t *inode)
+{
+    return bitmask_check(fs->superblock.feature_compat, EXT2_FEATURE_COMPAT_DIR_INDEX) &&
+           bitmask_check(inode->flags, EXT2_INDEX_FL);
+}
+
+/// @brief Returns the count/limit pair of a node.
+/// @param entries the entries of the node.
+/// @return a pointer to the count/limit pair.
+static inline ext2_dx_countlimit_t *ext2_dx_countlimit(ext2_dx_entry_t *entries)
+{
+    return (ext2_dx_countlimit_t *)entries;
+}
+
+/// @brief Returns the block pointed by an entry, without the unused high bits.
+/// @param entry the entry.
+/// @return the index of the block within the directory.
+static inline uint32_t ext2_dx_get_block(ext2_dx_entry_t *entry) { return entry->block & 0x0fffffff; }
+
+/// @brief Returns the header of the root, which follows the `.` and `..` entries.
+/// @param cache the content of the first block of the directory.
+/// @return a pointer to the header.
+static inline ext2_dx_root_info_t *ext2_dx_root_info(uint8_t *cache)
+{
+    return (ext2_dx_root_info_t *)((uintptr_t)cache + EXT2_DX_ROOT_OFFSET);
+}
+
+/// @brief Returns the entries of the root.
+/// @param cache the content of the first block of the directory.
+/// @return a pointer to the entries.
+static inline ext2_dx_entry_t *ext2_dx_root_entries(uint8_t *cache)
+{
+    ext2_dx_root_info_t *info = ext2_dx_root_info(cache);
+    return (ext2_dx_entry_t *)((uintptr_t)info + info->info_length);
+}
+
+/// @brief Returns the entries of an internal node, which follow an empty directory entry.
+/// @param cache the content of the block of the node.
+/// @return a pointer to the entries.
+static inline ext2_dx_entry_t *ext2_dx_node_entries(uint8_t *cache)
+{
+    return (ext2_dx_entry_t *)((uintptr_t)cache + sizeof(ext2_dirent_t));
+}
+
+/// @brief Returns the maximum number of entries of the root.
+/// @param fs a pointer to the filesystem.
+/// @return the maximum number of entries.
+static inline uint32_t ext2_dx_root_limit(ext2_filesystem_t *fs)
+{
+    return (fs->block_size - EXT2_DX_ROOT_OFFSET - sizeof(ext2_dx_root_info_t)) / sizeof(ext2_dx_entry_t);
+}
+
+/// @brief Returns the maximum number of entries of an internal node.
+/// @param fs a pointer to the filesystem.
+/// @return the maximum number of entries.
+static inline uint32_t ext2_dx_node_limit(ext2_filesystem_t *fs)
+{
+    return (fs->block_size - sizeof(ext2_dirent_t)) / sizeof(ext2_dx_entry_t);
+}
+
+/// @brief Initializes the block of an internal node.
+/// @param fs a pointer to the filesystem.
+/// @param cache the content of the block.
+/// @return the entries of the node.
+static inline ext2_dx_entry_t *ext2_dx_init_node(ext2_filesystem_t *fs, uint8_t *cache)
+{
+    memset(cache, 0, fs->block_size);
+    // The node is hidden inside a free directory entry, which covers the whole block.
+    ((ext2_dirent_t *)cache)->rec_len = fs->block_size;
+    return ext2_dx_node_entries(cache);
+}
+
+/// @brief Frees the buffers of a walk.
+/// @param path the walk.
+static inline void ext2_dx_release(ext2_dx_path_t *path)
+{
+    for (uint32_t level = 0; level < EXT2_DX_MAX_LEVELS; ++level) {
+        if (path->frames[level].cache) {
+            ext2_dealloc_cache(path->frames[level].cache);
+            path->frames[level].cache = NULL;
+        }
+    }
+}
+
+/// @brief Reads an index block, and sets its entries as the ones of the frame.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param frame the frame.
+/// @param block_index the index of the block within the directory.
+/// @return 0 on success, -1 on failure.
+static int ext2_dx_read_frame(ext2_filesystem_t *fs, ext2_inode_t *inode, ext2_dx_frame_t *frame, uint32_t block_index)
+{
+    if (!frame->cache) {
+        frame->cache = ext2_alloc_cache(fs);
+    }
+    frame->block_index = block_index;
+    if (ext2_read_inode_block(fs, inode, block_index, frame->cache) < 0) {
+        pr_err("Failed to read the index block `%u`.\n", block_index);
+        return -1;
+    }
+    frame->entries = block_index ? ext2_dx_node_entries(frame->cache) : ext2_dx_root_entries(frame->cache);
+    frame->at      = frame->entries;
+    uint32_t limit = block_index ? ext2_dx_node_limit(fs) : ext2_dx_root_limit(fs);
+    ext2_dx_countlimit_t *countlimit = ext2_dx_countlimit(frame->entries);
+    if ((countlimit->limit != limit) || (countlimit->count == 0) || (countlimit->count > limit)) {
+        pr_err(
+            "Corrupted index block `%u` (count: %u, limit: %u).\n", block_index, countlimit->count,
+            countlimit->limit);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Walks the HTree of a directory, down to the leaf which may contain the given name.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param name the name.
+/// @param path the output walk, to be released with ext2_dx_release().
+/// @return 0 on success, -1 if the index cannot be used.
+static int ext2_dx_probe(ext2_filesystem_t *fs, ext2_inode_t *inode, const char *name, ext2_dx_path_t *path)
+{
+    memset(path, 0, sizeof(ext2_dx_path_t));
+    // Read the root.
+    if (ext2_dx_read_frame(fs, inode, &path->frames[0], 0) < 0) {
+        return -1;
+    }
+    ext2_dx_root_info_t *info = ext2_dx_root_info(path->frames[0].cache);
+    if (info->reserved_zero || (info->info_length != sizeof(ext2_dx_root_info_t)) ||
+        (info->indirect_levels >= EXT2_DX_MAX_LEVELS) ||
+        (info->hash_version > EXT2_DX_HASH_TEA + EXT2_DX_HASH_UNSIGNED)) {
+        pr_err("Unsupported index (hash: %u, levels: %u).\n", info->hash_version, info->indirect_levels);
+        return -1;
+    }
+    path->levels       = info->indirect_levels + 1;
+    path->hash_version = info->hash_version;
+    path->hash         = ext2_dx_hash(fs, name, strlen(name), info->hash_version);
+    for (uint32_t level = 0; level < path->levels; ++level) {
+        ext2_dx_frame_t *frame = &path->frames[level];
+        if ((level > 0) && (ext2_dx_read_frame(fs, inode, frame, ext2_dx_get_block(path->frames[level - 1].at)) < 0)) {
+            return -1;
+        }
+        // Find the last entry whose hash is not greater than the one of the
+        // name, the first entry has no hash and covers the lowest ones.
+        ext2_dx_entry_t *low  = frame->entries + 1;
+        ext2_dx_entry_t *high = frame->entries + ext2_dx_countlimit(frame->entries)->count - 1;
+        while (low <= high) {
+            ext2_dx_entry_t *middle = low + (high - low) / 2;
+            if (middle->hash > path->hash) {
+                high = middle - 1;
+            } else {
+                low = middle + 1;
+            }
+        }
+        frame->at = low - 1;
+    }
+    return 0;
+}
+
+/// @brief Moves the walk to the following leaf, if names with the same hash
+/// of the one we are looking for continue inside it.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param path the walk.
+/// @return 1 if we moved to the next leaf, 0 if there is no need, -1 on failure.
+static int ext2_dx_next_leaf(ext2_filesystem_t *fs, ext2_inode_t *inode, ext2_dx_path_t *path)
+{
+    int level = path->levels - 1;
+    // Find the deepest level which has a following entry.
+    for (; level >= 0; --level) {
+        ext2_dx_frame_t *frame = &path->frames[level];
+        if ((frame->at + 1) < (frame->entries + ext2_dx_countlimit(frame->entries)->count)) {
+            break;
+        }
+    }
+    if (level < 0) {
+        return 0;
+    }
+    // The lowest bit of the hash marks that the previous leaf ends with the same hash.
+    uint32_t hash = (++path->frames[level].at)->hash;
+    if (!(hash & 1) || ((hash & ~1U) != path->hash)) {
+        return 0;
+    }
+    // Go down to the first leaf of the entry.
+    for (++level; level < (int)path->levels; ++level) {
+        if (ext2_dx_read_frame(fs, inode, &path->frames[level], ext2_dx_get_block(path->frames[level - 1].at)) < 0) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+/// @brief Fills the search results with the given directory entry.
+/// @param search the search results.
+/// @param direntry the directory entry.
+/// @param block_index the index of the block containing the entry.
+/// @param block_offset the offset of the entry inside the block.
+static inline void ext2_direntry_search_fill(
+    ext2_direntry_search_t *search,
+    ext2_dirent_t *direntry,
+    uint32_t block_index,
+    uint32_t block_offset)
+{
+    // Copy the direntry.
+    search->direntry.inode     = direntry->inode;
+    search->direntry.rec_len   = direntry->rec_len;
+    search->direntry.name_len  = direntry->name_len;
+    search->direntry.file_type = direntry->file_type;
+    strncpy(search->direntry.name, direntry->name, direntry->name_len);
+    search->direntry.name[direntry->name_len] = 0;
+    // Copy the index of the block containing the direntry.
+    search->block_index                       = block_index;
+    // Copy the offset of the direntry inside the block.
+    search->block_offset                      = block_offset;
+}
+
+/// @brief Looks for a name inside a leaf of an indexed directory.
+/// @param fs a pointer to the filesystem.
+/// @param cache the content of the leaf.
+/// @param block_index the index of the leaf within the directory.
+/// @param name the name we are looking for.
+/// @param search the output variable where we save the info about the entry.
+/// @return 1 if found, 0 if not found, -1 if the leaf is corrupted.
+static int ext2_dx_search_leaf(
+    ext2_filesystem_t *fs,
+    uint8_t *cache,
+    uint32_t block_index,
+    const char *name,
+    ext2_direntry_search_t *search)
+{
+    uint32_t name_len = strlen(name);
+    for (uint32_t offset = 0; offset < fs->block_size;) {
+        ext2_dirent_t *direntry = (ext2_dirent_t *)((uintptr_t)cache + offset);
+        if ((direntry->rec_len < sizeof(ext2_dirent_t)) || ((offset + direntry->rec_len) > fs->block_size)) {
+            pr_err("Corrupted directory entry in leaf `%u` (offset: %u).\n", block_index, offset);
+            return -1;
+        }
+        if (direntry->inode && (direntry->name_len == name_len) && !strncmp(direntry->name, name, name_len)) {
+            ext2_direntry_search_fill(search, direntry, block_index, offset);
+            return 1;
+        }
+        offset += direntry->rec_len;
+    }
+    return 0;
+}
+
+/// @brief Looks for a name inside an indexed directory.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param name the name we are looking for.
+/// @param search the output variable where we save the info about the entry.
+/// @return 1 if found, 0 if not found, -1 if the index cannot be used.
+static int
+ext2_dx_find_direntry(ext2_filesystem_t *fs, ext2_inode_t *inode, const char *name, ext2_direntry_search_t *search)
+{
+    ext2_dx_path_t path;
+    uint8_t *cache = ext2_alloc_cache(fs);
+    int result     = ext2_dx_probe(fs, inode, name, &path);
+    while (result == 0) {
+        uint32_t block_index = ext2_dx_get_block(path.frames[path.levels - 1].at);
+        if (ext2_read_inode_block(fs, inode, block_index, cache) < 0) {
+            pr_err("Failed to read the leaf `%u`.\n", block_index);
+            result = -1;
+            break;
+        }
+        if ((result = ext2_dx_search_leaf(fs, cache, block_index, name, search)) != 0) {
+            break;
+        }
+        // Names with the same hash might continue inside the next leaf.
+        if ((result = ext2_dx_next_leaf(fs, inode, &path)) <= 0) {
+            break;
+        }
+        result = 0;
+    }
+    ext2_dealloc_cache(cache);
+    ext2_dx_release(&path);
+    return result;
+}
+
+/// @brief Places a new directory entry inside a block, if there is enough space.
+/// @param fs a pointer to the filesystem.
+/// @param cache the content of the block.
+/// @param name the name of the new entry.
+/// @param inode_index its inode index.
+/// @param file_type its file type.
+/// @return 1 on success, 0 if there is no space.
+static int ext2_dx_insert_into_block(
+    ext2_filesystem_t *fs,
+    uint8_t *cache,
+    const char *name,
+    ino_t inode_index,
+    uint8_t file_type)
+{
+    uint32_t rec_len = ext2_get_rec_len_from_name(name);
+    for (uint32_t offset = 0; offset < fs->block_size;) {
+        ext2_dirent_t *direntry = (ext2_dirent_t *)((uintptr_t)cache + offset);
+        if ((direntry->rec_len < sizeof(ext2_dirent_t)) || ((offset + direntry->rec_len) > fs->block_size)) {
+            return 0;
+        }
+        // Reuse a free entry.
+        if ((direntry->inode == 0) && (direntry->rec_len >= rec_len)) {
+            ext2_initialize_direntry(direntry, name, inode_index, direntry->rec_len, file_type);
+            return 1;
+        }
+        // Use the space left after an entry.
+        uint32_t used = ext2_get_rec_len_from_direntry(direntry);
+        if (direntry->inode && (direntry->rec_len >= (used + rec_len))) {
+            uint32_t free_len = direntry->rec_len - used;
+            direntry->rec_len = used;
+            ext2_initialize_direntry(
+                (ext2_dirent_t *)((uintptr_t)direntry + used), name, inode_index, free_len, file_type);
+            return 1;
+        }
+        offset += direntry->rec_len;
+    }
+    return 0;
+}
+
+/// @brief Copies the given entries, one after the other, inside a block.
+/// @param fs a pointer to the filesystem.
+/// @param source the content of the block containing the entries.
+/// @param map the entries to copy.
+/// @param count the number of entries.
+/// @param destination the block we fill.
+static void ext2_dx_pack_entries(
+    ext2_filesystem_t *fs,
+    uint8_t *source,
+    ext2_dx_map_t *map,
+    uint32_t count,
+    uint8_t *destination)
+{
+    ext2_dirent_t *direntry = (ext2_dirent_t *)destination;
+    uint32_t offset         = 0;
+    memset(destination, 0, fs->block_size);
+    for (uint32_t i = 0; i < count; ++i) {
+        ext2_dirent_t *entry = (ext2_dirent_t *)((uintptr_t)source + map[i].offset);
+        uint32_t rec_len     = ext2_get_rec_len_from_direntry(entry);
+        direntry             = (ext2_dirent_t *)((uintptr_t)destination + offset);
+        memcpy(direntry, entry, rec_len);
+        direntry->rec_len = rec_len;
+        offset += rec_len;
+    }
+    // The last entry covers the rest of the block.
+    direntry->rec_len += fs->block_size - offset;
+}
+
+/// @brief Appends a new block to a directory.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param inode_index the inode index of the directory.
+/// @param cache the content of the new block.
+/// @return the index of the block within the directory, -1 on failure.
+static int ext2_dx_append_block(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, uint8_t *cache)
+{
+    uint32_t block_index = inode->size / fs->block_size;
+    // Allocate and write the block.
+    if (ext2_write_inode_block(fs, inode, inode_index, block_index, cache) < 0) {
+        pr_err("Failed to append a block to directory `%u`.\n", inode_index);
+        return -1;
+    }
+    // Update the size of the directory.
+    inode->size = (block_index + 1) * fs->block_size;
+    if (ext2_write_inode(fs, inode, inode_index) == -1) {
+        pr_err("Failed to update the inode of directory `%u`.\n", inode_index);
+        return -1;
+    }
+    return block_index;
+}
+
+/// @brief Inserts an entry inside a node, after the entry followed by the walk.
+/// @param frame the level of the walk, whose node is not full.
+/// @param hash the hash of the new entry.
+/// @param block_index the block of the new entry.
+static inline void ext2_dx_insert_entry(ext2_dx_frame_t *frame, uint32_t hash, uint32_t block_index)
+{
+    ext2_dx_countlimit_t *countlimit = ext2_dx_countlimit(frame->entries);
+    ext2_dx_entry_t *entry           = frame->at + 1;
+    memmove(entry + 1, entry, (frame->entries + countlimit->count - entry) * sizeof(ext2_dx_entry_t));
+    entry->hash  = hash;
+    entry->block = block_index;
+    ++countlimit->count;
+}
+
+/// @brief Makes space for a new entry inside the deepest node of the walk,
+/// either by adding a level to the tree, or by splitting the node.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param inode_index the inode index of the directory.
+/// @param path the walk, which is updated to follow the same leaf.
+/// @return 1 on success, 0 if the index is full or on failure.
+static int ext2_dx_make_space(ext2_filesystem_t *fs, ext2_inode_t *inode, uint32_t inode_index, ext2_dx_path_t *path)
+{
+    ext2_dx_frame_t *frame           = &path->frames[path->levels - 1];
+    ext2_dx_countlimit_t *countlimit = ext2_dx_countlimit(frame->entries);
+    if (countlimit->count < countlimit->limit) {
+        return 1;
+    }
+    uint8_t *cache           = ext2_alloc_cache(fs);
+    ext2_dx_entry_t *entries = ext2_dx_init_node(fs, cache);
+    int block_index;
+    if (path->levels == 1) {
+        // The root is full, move its entries to a new node below it.
+        memcpy(entries, frame->entries, countlimit->count * sizeof(ext2_dx_entry_t));
+        ext2_dx_countlimit(entries)->limit = ext2_dx_node_limit(fs);
+        if ((block_index = ext2_dx_append_block(fs, inode, inode_index, cache)) < 0) {
+            goto dealloc_return_error;
+        }
+        // The root now points only to the new node.
+        countlimit->count       = 1;
+        frame->entries[0].block = block_index;
+        ext2_dx_root_info(frame->cache)->indirect_levels = 1;
+        if (ext2_write_inode_block(fs, inode, inode_index, 0, frame->cache) < 0) {
+            goto dealloc_return_error;
+        }
+        // The new node becomes the deepest level of the walk.
+        path->frames[1].cache       = cache;
+        path->frames[1].block_index = block_index;
+        path->frames[1].entries     = entries;
+        path->frames[1].at          = entries + (frame->at - frame->entries);
+        frame->at                   = frame->entries;
+        path->levels                = 2;
+        return 1;
+    }
+    // The node is full, move half of its entries to a new node.
+    ext2_dx_frame_t *parent = &path->frames[0];
+    if (ext2_dx_countlimit(parent->entries)->count >= ext2_dx_countlimit(parent->entries)->limit) {
+        pr_warning("The index of directory `%u` is full.\n", inode_index);
+        goto dealloc_return_error;
+    }
+    uint32_t half  = countlimit->count / 2;
+    uint32_t moved = countlimit->count - half;
+    uint32_t hash  = frame->entries[half].hash;
+    memcpy(entries, frame->entries + half, moved * sizeof(ext2_dx_entry_t));
+    ext2_dx_countlimit(entries)->limit = ext2_dx_node_limit(fs);
+    ext2_dx_countlimit(entries)->count = moved;
+    if ((block_index = ext2_dx_append_block(fs, inode, inode_index, cache)) < 0) {
+        goto dealloc_return_error;
+    }
+    countlimit->count = half;
+    ext2_dx_insert_entry(parent, hash, block_index);
+    if ((ext2_write_inode_block(fs, inode, inode_index, frame->block_index, frame->cache) < 0) ||
+        (ext2_write_inode_block(fs, inode, inode_index, parent->block_index, parent->cache) < 0)) {
+        goto dealloc_return_error;
+    }
+    // Keep following the same entry, which might have been moved.
+    if (frame->at >= (frame->entries + half)) {
+        uint32_t position = (frame->at - frame->entries) - half;
+        ext2_dealloc_cache(frame->cache);
+        frame->cache       = cache;
+        frame->block_index = block_index;
+        frame->entries     = entries;
+        frame->at          = entries + position;
+        parent->at += 1;
+    } else {
+        ext2_dealloc_cache(cache);
+    }
+    return 1;
+dealloc_return_error:
+    ext2_dealloc_cache(cache);
+    return 0;
+}
+
+/// @brief Splits a full leaf in two, by moving the entries with the highest
+/// hashes to a new leaf, and then places the new entry.
+/// @param fs a pointer to the filesystem.
+/// @param inode the inode of the directory.
+/// @param inode_index the inode index of the directory.
+/// @param path the walk leading to the leaf, whose deepest node is not full.
+/// @param leaf the content of the leaf.
+/// @param name the name of the new entry.
+/// @param direntry_inode_index its inode index.
+/// @param file_type its file type.
+/// @return 1 on success, 0 on failure.
+static int ext2_dx_split_leaf(
+    ext2_filesystem_t *fs,
+    ext2_inode_t *inode,
+    uint32_t inode_index,
+    ext2_dx_path_t *path,
+    uint8_t *leaf,
+    const char *name,
+    ino_t direntry_inode_index,
+    uint8_t file_type)
+{
+    ext2_dx_frame_t *frame = &path->frames[path->levels - 1];
+    uint32_t leaf_index    = ext2_dx_get_block(frame->at);
+    ext2_dx_map_t *map     = kmalloc((fs->block_size / round_up(sizeof(ext2_dirent_t) + 1, 4)) * sizeof(ext2_dx_map_t));
+    uint32_t count         = 0;
+    int result             = 0;
+    if (!map) {
+        return 0;
+    }
+    // Collect the live entries, sorted by hash.
+    for (uint32_t offset = 0; offset < fs->block_size;) {
+        ext2_dirent_t *direntry = (ext2_dirent_t *)((uintptr_t)leaf + offset);
+        if (direntry->rec_len < sizeof(ext2_dirent_t)) {
+            break;
+        }
+        if (direntry->inode) {
+            ext2_dx_map_t entry = { ext2_dx_hash(fs, direntry->name, direntry->name_len, path->hash_version), offset };
+            uint32_t i          = count++;
+            for (; (i > 0) && (map[i - 1].hash > entry.hash); --i) {
+                map[i] = map[i - 1];
+            }
+            map[i] = entry;
+        }
+        offset += direntry->rec_len;
+    }
+    if (count < 2) {
+        pr_err("Cannot split leaf `%u` of directory `%u`.\n", leaf_index, inode_index);
+        goto free_return;
+    }
+    // If the two halves share a hash, the lowest bit of the new index entry
+    // tells lookups to continue inside the new leaf.
+    uint32_t split     = count / 2;
+    uint32_t hash      = map[split].hash;
+    uint32_t continued = hash == map[split - 1].hash;
+    // Move the upper half to a new leaf, and pack the lower half.
+    uint8_t *high = ext2_alloc_cache(fs);
+    uint8_t *low  = ext2_alloc_cache(fs);
+    ext2_dx_pack_entries(fs, leaf, map + split, count - split, high);
+    ext2_dx_pack_entries(fs, leaf, map, split, low);
+    int high_index = ext2_dx_append_block(fs, inode, inode_index, high);
+    if (high_index < 0) {
+        goto dealloc_return;
+    }
+    ext2_dx_insert_entry(frame, hash | continued, high_index);
+    if (ext2_write_inode_block(fs, inode, inode_index, frame->block_index, frame->cache) < 0) {
+        goto dealloc_return;
+    }
+    // Place the new entry inside the half covering its hash.
+    uint8_t *target       = (path->hash >= hash) ? high : low;
+    uint32_t target_index = (path->hash >= hash) ? (uint32_t)high_index : leaf_index;
+    result                = ext2_dx_insert_into_block(fs, target, name, direntry_inode_index, file_type);
+    if ((ext2_write_inode_block(fs, inode, inode_index, leaf_index, low) < 0) ||
+        (result && (ext2_write_inode_block(fs, inode, inode_index, target_index, target) < 0))) {
+        result = 0;
+    }
+dealloc_return:
+    ext2_dealloc_cache(high);
+    ext2_dealloc_cache(low);
+free_return:
+    kfree(map);
+    return result;
+}
+
+/// @brief Places a new directory entry inside an indexed directory.
+/// @param fs a pointer to the filesystem.
+/// @param parent_inode_index the inode index of the directory.
+/// @param name the name of the new entry.
+/// @param inode_index its inode index.
+/// @param file_type its file type.
+/// @return 1 on success, 0 if the index cannot take the entry.
+static int ext2_dx_add_direntry(
+    ext2_filesystem_t *fs,
+    uint32_t parent_inode_index,
+    const char *name,
+    ino_t inode_index,
+    uint8_t file_type)
+{
+    ext2_inode_t parent_inode;
+    ext2_dx_path_t path;
+    int result = 0;
+    if (ext2_read_inode(fs, &parent_inode, parent_inode_index) == -1) {
+        pr_err("Failed to read the parent inode `%u`.\n", parent_inode_index);
+        return 0;
+    }
+    uint8_t *leaf = ext2_alloc_cache(fs);
+    if (ext2_dx_probe(fs, &parent_inode, name, &path) < 0) {
+        goto release_return;
+    }
+    uint32_t leaf_index = ext2_dx_get_block(path.frames[path.levels - 1].at);
+    if (ext2_read_inode_block(fs, &parent_inode, leaf_index, leaf) < 0) {
+        pr_err("Failed to read the leaf `%u`.\n", leaf_index);
+        goto release_return;
+    }
+    // Place the entry inside its leaf, if there is space.
+    if (ext2_dx_insert_into_block(fs, leaf, name, inode_index, file_type)) {
+        result = ext2_write_inode_block(fs, &parent_inode, parent_inode_index, leaf_index, leaf) >= 0;
+        goto release_return;
+    }
+    // Otherwise, split the leaf, after making space for the new one inside the index.
+    if (ext2_dx_make_space(fs, &parent_inode, parent_inode_index, &path)) {
+        result = ext2_dx_split_leaf(fs, &parent_inode, parent_inode_index, &path, leaf, name, inode_index, file_type);
+    }
+release_return:
+    ext2_dealloc_cache(leaf);
+    ext2_dx_release(&path);
+    return result;
+}
+
+/// @brief Drops the index of a directory, which is allowed since the blocks of
+/// an indexed directory are also valid for a linear scan.
+/// @param fs a pointer to the filesystem.
+/// @param inode_index the inode index of the directory.
+/// @return 0 on success, -1 on failure.
+static int ext2_dx_drop_index(ext2_filesystem_t *fs, uint32_t inode_index)
+{
+    ext2_inode_t inode;
+    if (ext2_read_inode(fs, &inode, inode_index) == -1) {
+        pr_err("Failed to read the inode `%u`.\n", inode_index);
+        return -1;
+    }
+    bitmask_clear_assign(inode.flags, EXT2_INDEX_FL);
+    if (ext2_write_inode(fs, &inode, inode_index) == -1) {
+        pr_err("Failed to update the inode `%u`.\n", inode_index);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Turns a directory made of a single full block into an indexed one,
+/// by moving its entries to a new leaf, and placing the root of the index in
+/// the first block, after the `.` and `..` entries.
+/// @param fs a pointer to the filesystem.
+/// @param inode_index the inode index of the directory.
+/// @return 1 on success, 0 on failure.
+static int ext2_dx_make_indexed(ext2_filesystem_t *fs, uint32_t inode_index)
+{
+    ext2_inode_t inode;
+    int result = 0;
+    if (ext2_read_inode(fs, &inode, inode_index) == -1) {
+        pr_err("Failed to read the inode `%u`.\n", inode_index);
+        return 0;
+    }
+    uint8_t *cache = ext2_alloc_cache(fs);
+    uint8_t *root  = ext2_alloc_cache(fs);
+    uint8_t *leaf  = ext2_alloc_cache(fs);
+    if (ext2_read_inode_block(fs, &inode, 0, cache) < 0) {
+        goto dealloc_return;
+    }
+    // The directory must start with `.` and `..`.
+    ext2_dirent_t *dot    = (ext2_dirent_t *)cache;
+    ext2_dirent_t *dotdot = (ext2_dirent_t *)((uintptr_t)cache + dot->rec_len);
+    if ((dot->name_len != 1) || strncmp(dot->name, ".", 1) || (dot->rec_len > (fs->block_size / 2)) ||
+        (dotdot->name_len != 2) || strncmp(dotdot->name, "..", 2)) {
+        pr_warning("Directory `%u` does not start with `.` and `..`.\n", inode_index);
+        goto dealloc_return;
+    }
+    // Build the root.
+    memset(root, 0, fs->block_size);
+    ext2_initialize_direntry((ext2_dirent_t *)root, ".", dot->inode, EXT2_DX_ROOT_OFFSET / 2, dot->file_type);
+    ext2_initialize_direntry(
+        (ext2_dirent_t *)((uintptr_t)root + EXT2_DX_ROOT_OFFSET / 2), "..", dotdot->inode,
+        fs->block_size - EXT2_DX_ROOT_OFFSET / 2, dotdot->file_type);
+    ext2_dx_root_info_t *info = ext2_dx_root_info(root);
+    info->hash_version        = fs->superblock.def_hash_version;
+    info->info_length         = sizeof(ext2_dx_root_info_t);
+    ext2_dx_entry_t *entries  = ext2_dx_root_entries(root);
+    ext2_dx_countlimit(entries)->limit = ext2_dx_root_limit(fs);
+    ext2_dx_countlimit(entries)->count = 1;
+    // Move the other entries to the first leaf.
+    ext2_dx_map_t *map = kmalloc((fs->block_size / round_up(sizeof(ext2_dirent_t) + 1, 4)) * sizeof(ext2_dx_map_t));
+    uint32_t count     = 0;
+    if (!map) {
+        goto dealloc_return;
+    }
+    for (uint32_t offset = dot->rec_len + dotdot->rec_len; offset < fs->block_size;) {
+        ext2_dirent_t *direntry = (ext2_dirent_t *)((uintptr_t)cache + offset);
+        if (direntry->rec_len < sizeof(ext2_dirent_t)) {
+            break;
+        }
+        if (direntry->inode) {
+            map[count].hash     = 0;
+            map[count++].offset = offset;
+        }
+        offset += direntry->rec_len;
+    }
+    ext2_dx_pack_entries(fs, cache, map, count, leaf);
+    kfree(map);
+    int block_index = ext2_dx_append_block(fs, &inode, inode_index, leaf);
+    if (block_index < 0) {
+        goto dealloc_return;
+    }
+    entries[0].block = block_index;
+    if (ext2_write_inode_block(fs, &inode, inode_index, 0, root) < 0) {
+        goto dealloc_return;
+    }
+    // Mark the directory as indexed.
+    inode.flags |= EXT2_INDEX_FL;
+    result = ext2_write_inode(fs, &inode, inode_index) != -1;
+dealloc_return:
+    ext2_dealloc_cache(leaf);
+    ext2_dealloc_cache(root);
+    ext2_dealloc_cache(cache);
+    return result;
 }
 
-/// @brief Allocates a directory entry.
+/// @brief Allocates a directory entry, the caller holds the locks of the
+/// parent and of the new entry.
 /// @param fs a pointer to the filesystem.
 /// @param parent_inode_index the inode index of the parent.
 /// @param direntry_inode_index the inode index of the new entry.
 /// @param name the name of the new entry.
 /// @param file_type the type of file.
 /// @return 0 on success, a negative value on failure.
-static int ext2_allocate_direntry(
+static int __ext2_allocate_direntry(
     ext2_filesystem_t *fs,
     uint32_t parent_inode_index,
     uint32_t direntry_inode_index,
@@ -2369,10 +5492,40 @@ static int ext2_allocate_direntry(
     // ext2_dump_direntries(fs, cache, &parent_inode);
     // pr_debug("\n");
 
+    // The entries of the parent are going to change.
+    ext2_dcache_invalidate(fs, parent_inode_index);
+
+    // Indexed directories place the entry inside the leaf covering its hash.
+    if (ext2_dx_is_indexed(fs, &parent_inode)) {
+        if (ext2_dx_add_direntry(fs, parent_inode_index, name, direntry_inode_index, file_type)) {
+            // Free the cache.
+            ext2_dealloc_cache(cache);
+            return 0;
+        }
+        pr_warning("Failed to place the entry using the index of `%u`, dropping the index.\n", parent_inode_index);
+    }
+    // Placing the entry linearly would overwrite the index, so drop it.
+    if (bitmask_check(parent_inode.flags, EXT2_INDEX_FL) && (ext2_dx_drop_index(fs, parent_inode_index) < 0)) {
+        ext2_dealloc_cache(cache);
+        return -1;
+    }
+
     // Get free directory entry.
     if (!ext2_get_free_direntry(fs, cache, parent_inode_index, name, direntry_inode_index, file_type)) {
         if (!ext2_append_new_direntry(fs, cache, parent_inode_index, name, direntry_inode_index, file_type)) {
-            if (!ext2_create_new_direntry(fs, cache, parent_inode_index, name, direntry_inode_index, file_type)) {
+            // When a directory outgrows its first block, index it instead of
+            // adding a second block to scan.
+            int indexed = 0;
+            if (bitmask_check(fs->superblock.feature_compat, EXT2_FEATURE_COMPAT_DIR_INDEX) &&
+                (parent_inode.size == fs->block_size) && ext2_dx_make_indexed(fs, parent_inode_index)) {
+                indexed = ext2_dx_add_direntry(fs, parent_inode_index, name, direntry_inode_index, file_type);
+                if (!indexed && (ext2_dx_drop_index(fs, parent_inode_index) < 0)) {
+                    ext2_dealloc_cache(cache);
+                    return -1;
+                }
+            }
+            if (!indexed &&
+                !ext2_create_new_direntry(fs, cache, parent_inode_index, name, direntry_inode_index, file_type)) {
                 pr_err("Failed to place directory entry.\n");
                 // Free the cache.
                 ext2_dealloc_cache(cache);
@@ -2390,6 +5543,27 @@ static int ext2_allocate_direntry(
     return 0;
 }
 
+/// @brief Allocates a directory entry.
+/// @param fs a pointer to the filesystem.
+/// @param parent_inode_index the inode index of the parent.
+/// @param direntry_inode_index the inode index of the new entry.
+/// @param name the name of the new entry.
+/// @param file_type the type of file.
+/// @return 0 on success, a negative value on failure.
+static int ext2_allocate_direntry(
+    ext2_filesystem_t *fs,
+    uint32_t parent_inode_index,
+    uint32_t direntry_inode_index,
+    const char *name,
+    uint8_t file_type)
+{
+    // The entries of the parent and the links of the new entry change.
+    ext2_inode_lock_pair(fs, parent_inode_index, direntry_inode_index);
+    int ret = __ext2_allocate_direntry(fs, parent_inode_index, direntry_inode_index, name, file_type);
+    ext2_inode_unlock_pair(fs, parent_inode_index, direntry_inode_index);
+    return ret;
+}
+
 /// @brief Destroys a directory entry in the parent directory.
 /// @param fs A pointer to the filesystem structure.
 /// @param parent The inode of the parent directory.
@@ -2432,16 +5606,20 @@ static int ext2_destroy_direntry(
         return -ENOTEMPTY;
     }
 
-    // Get the group index of the parent
-    uint32_t group_index = ext2_inode_index_to_group_index(fs, parent_index);
+    // Get the group index of the directory.
+    uint32_t group_index = ext2_inode_index_to_group_index(fs, inode_index);
 
     // Decrease the number of directories in the group
+    spinlock_lock(&fs->group_info[group_index].lock);
     if (fs->block_groups[group_index].used_dirs_count == 0) {
+        spinlock_unlock(&fs->group_info[group_index].lock);
         pr_err("Directory count underflow in block group `%u`.\n", group_index);
         ext2_dealloc_cache(cache);
         return -EINVAL;
     }
     fs->block_groups[group_index].used_dirs_count--;
+    spinlock_unlock(&fs->group_info[group_index].lock);
+    ext2_metadata_mark_dirty(fs);
 
     // Reduce the number of links to the parent directory.
     parent.links_count--;
@@ -2487,6 +5665,9 @@ static int ext2_destroy_direntry(
 
     // Set the inode to zero.
     dirent->inode = 0;
+    // The entries of the parent changed, and the directory is gone.
+    ext2_dcache_invalidate(fs, parent_index);
+    ext2_dcache_invalidate(fs, inode_index);
 
     // Write back the parent directory block.
     if (!ext2_write_inode_block(fs, &parent, parent_index, block_index, cache)) {
@@ -2544,6 +5725,30 @@ static int ext2_find_direntry(ext2_filesystem_t *fs, ino_t ino, const char *name
         return -EPERM;
     }
 
+    // Check if we have already looked for the entry.
+    ext2_dcache_entry_t *cached = ext2_dcache_find(fs, ino, name);
+    if (cached) {
+        search->parent_inode = ino;
+        if (cached->negative) {
+            return -1;
+        }
+        memcpy(search, &cached->search, sizeof(ext2_direntry_search_t));
+        return 0;
+    }
+
+    // Indexed directories are searched only inside the leaf covering the hash
+    // of the name, while `.` and `..` are always at the beginning.
+    if (ext2_dx_is_indexed(fs, &inode) && strcmp(name, ".") && strcmp(name, "..") && strcmp(name, "/")) {
+        int found = ext2_dx_find_direntry(fs, &inode, name, search);
+        if (found >= 0) {
+            search->parent_inode = ino;
+            // Remember the lookup.
+            ext2_dcache_insert(fs, ino, name, found ? search : NULL);
+            return found ? 0 : -1;
+        }
+        // Fall back to a linear scan, which works even if the index is broken.
+    }
+
     // Allocate the cache.
     uint8_t *cache = ext2_alloc_cache(fs);
 
@@ -2571,21 +5776,16 @@ static int ext2_find_direntry(ext2_filesystem_t *fs, ino_t ino, const char *name
     if (it.direntry == NULL) {
         goto free_cache_return_error;
     }
-    // Copy the direntry.
-    search->direntry.inode     = it.direntry->inode;
-    search->direntry.rec_len   = it.direntry->rec_len;
-    search->direntry.name_len  = it.direntry->name_len;
-    search->direntry.file_type = it.direntry->file_type;
-    strncpy(search->direntry.name, it.direntry->name, it.direntry->name_len);
-    search->direntry.name[it.direntry->name_len] = 0;
-    // Copy the index of the block containing the direntry.
-    search->block_index                          = it.block_index;
-    // Copy the offset of the direntry inside the block.
-    search->block_offset                         = it.block_offset;
+    // Copy the direntry, and where it resides.
+    ext2_direntry_search_fill(search, it.direntry, it.block_index, it.block_offset);
+    // Remember the lookup.
+    ext2_dcache_insert(fs, ino, name, search);
     // Free the cache.
     ext2_dealloc_cache(cache);
     return 0;
 free_cache_return_error:
+    // Remember that the entry does not exist.
+    ext2_dcache_insert(fs, ino, name, NULL);
     // Free the cache.
     ext2_dealloc_cache(cache);
     return -1;
@@ -2764,6 +5964,581 @@ static vfs_file_t *ext2_find_vfs_file_with_inode(ext2_filesystem_t *fs, ino_t in
     return NULL;
 }
 
+/// @brief Drops the data read ahead for the given inode, if it is open.
+/// @param fs a pointer to the fileystem.
+/// @param inode the inode index.
+static inline void ext2_readahead_invalidate(ext2_filesystem_t *fs, ino_t inode)
+{
+    vfs_file_t *file = ext2_find_vfs_file_with_inode(fs, inode);
+    if (file) {
+        file->ra.size = 0;
+    }
+}
+
+/// @brief Reads the data of a file, reading ahead when the access is sequential.
+/// @details Every open file keeps a window of blocks which grows (up to
+/// EXT2_READAHEAD_MAX) as long as the reads are sequential, and collapses as
+/// soon as a read lands somewhere else. While the window is open, small reads
+/// are served from a buffer holding the following window of blocks, which is
+/// read with a single batch through the request queue. A file advised as
+/// random never reads ahead, one advised as sequential always uses the
+/// largest window.
+/// @param fs the filesystem.
+/// @param file the file we are reading.
+/// @param inode the inode of the file.
+/// @param offset the offset from which we start reading the data.
+/// @param nbyte the number of bytes to read.
+/// @param buffer the buffer where we store the data.
+/// @return the amount we read, or a negative value if the first read failed.
+static ssize_t
+ext2_readahead_file(ext2_filesystem_t *fs, vfs_file_t *file, ext2_inode_t *inode, off_t offset, size_t nbyte, char *buffer)
+{
+    vfs_file_ra_t *ra = &file->ra;
+    // Get the offset to the end of the portion we are reading.
+    off_t end         = min(offset + nbyte, inode->size);
+    if (end <= offset) {
+        return 0;
+    }
+    // Update the window, based on the access pattern.
+    if (ra->advice == POSIX_FADV_RANDOM) {
+        ra->window = 0;
+    } else if (ra->advice == POSIX_FADV_SEQUENTIAL) {
+        ra->window = EXT2_READAHEAD_MAX;
+    } else if (offset == ra->next) {
+        ra->window = ra->window ? min(ra->window * 2, EXT2_READAHEAD_MAX) : EXT2_READAHEAD_MIN;
+    } else {
+        ra->window = 0;
+    }
+    ra->next = end;
+    // Allocate the buffer the first time we need it.
+    if (ra->window && !ra->buffer) {
+        if ((ra->buffer = kmalloc(EXT2_READAHEAD_MAX * fs->block_size)) == NULL) {
+            ra->window = 0;
+        }
+        ra->size = 0;
+    }
+    off_t position = offset;
+    while (position < end) {
+        // Serve what we can from the buffer.
+        if (ra->size && (position >= ra->start) && (position < ra->start + (off_t)ra->size)) {
+            size_t amount = min(end, ra->start + (off_t)ra->size) - position;
+            memcpy(buffer + (position - offset), ra->buffer + (position - ra->start), amount);
+            position += amount;
+            continue;
+        }
+        // Reads larger than the window go straight to the disk.
+        if (!ra->window || ((end - position) >= (off_t)(ra->window * fs->block_size))) {
+            ssize_t ret =
+                ext2_read_inode_data(fs, inode, file->ino, position, end - position, buffer + (position - offset));
+            if (ret < 0) {
+                return (position > offset) ? (position - offset) : ret;
+            }
+            return (position - offset) + ret;
+        }
+        // Fill the buffer with the next window, which is cached only once read.
+        ra->start   = position - (position % fs->block_size);
+        ra->size    = 0;
+        ssize_t ret = ext2_read_inode_data(
+            fs, inode, file->ino, ra->start, min(ra->window * fs->block_size, inode->size - ra->start), ra->buffer);
+        if (ret <= (position - ra->start)) {
+            if ((ret < 0) && (position == offset)) {
+                return ret;
+            }
+            break;
+        }
+        ra->size = ret;
+    }
+    return position - offset;
+}
+
+// ============================================================================
+// Journal Functions
+// ============================================================================
+
+/// @brief Converts a 32-bit value between the big-endian order used by the
+/// journal, and the order of the CPU.
+/// @param value the value to convert.
+/// @return the converted value.
+static inline uint32_t ext2_journal_be32(uint32_t value)
+{
+    return ((value & 0xFFU) << 24) | ((value & 0xFF00U) << 8) | ((value >> 8) & 0xFF00U) | (value >> 24);
+}
+
+/// @brief Initializes the header of a block of the journal.
+/// @param block the block.
+/// @param blocktype the type of the block.
+/// @param sequence the transaction the block belongs to.
+static inline void ext2_journal_set_header(uint8_t *block, uint32_t blocktype, uint32_t sequence)
+{
+    ext2_journal_header_t *header = (ext2_journal_header_t *)block;
+    header->magic                 = ext2_journal_be32(EXT2_JOURNAL_MAGIC);
+    header->blocktype             = ext2_journal_be32(blocktype);
+    header->sequence              = ext2_journal_be32(sequence);
+}
+
+/// @brief Returns the type of a block of the journal.
+/// @param block the block.
+/// @param sequence the transaction we expect the block to belong to.
+/// @return the type of the block, 0 if it is not part of the transaction.
+static inline uint32_t ext2_journal_get_type(uint8_t *block, uint32_t sequence)
+{
+    ext2_journal_header_t *header = (ext2_journal_header_t *)block;
+    if ((ext2_journal_be32(header->magic) != EXT2_JOURNAL_MAGIC) ||
+        (ext2_journal_be32(header->sequence) != sequence)) {
+        return 0;
+    }
+    return ext2_journal_be32(header->blocktype);
+}
+
+/// @brief Returns the block following the given one inside the log.
+/// @param journal the journal.
+/// @param block the block of the journal.
+/// @return the next block, the log wraps around its end.
+static inline uint32_t ext2_journal_next(ext2_journal_t *journal, uint32_t block)
+{
+    return ((block + 1) < journal->maxlen) ? (block + 1) : journal->first;
+}
+
+/// @brief Reads or writes a block of the journal, bypassing the buffer cache.
+/// @param fs the ext2 filesystem structure.
+/// @param block the block of the journal.
+/// @param buffer the buffer we read into, or we write from.
+/// @param write if we are writing (1) or reading (0).
+/// @return 0 on success, -1 on failure.
+static int ext2_journal_io(ext2_filesystem_t *fs, uint32_t block, uint8_t *buffer, int write)
+{
+    uint32_t real_index = ext2_get_real_block_index(fs, &fs->journal.inode, block);
+    if ((block >= fs->journal.maxlen) || (real_index == 0)) {
+        pr_err("Block `%u` of the journal is not mapped.\n", block);
+        return -1;
+    }
+    ssize_t ret = write ? vfs_write(fs->block_device, buffer, real_index * fs->block_size, fs->block_size)
+                        : vfs_read(fs->block_device, buffer, real_index * fs->block_size, fs->block_size);
+    return (ret < 0) ? -1 : 0;
+}
+
+/// @brief Writes a run of consecutive blocks inside the log.
+/// @details When the device has a request queue, the blocks are submitted at
+/// once, so that they reach the device as a few large sequential writes.
+/// @param fs the ext2 filesystem structure.
+/// @param block the first block of the run, the run must not wrap around.
+/// @param buffers the content of the blocks.
+/// @param count the number of blocks.
+/// @return 0 on success, -1 on failure.
+static int ext2_journal_write_run(ext2_filesystem_t *fs, uint32_t block, uint8_t **buffers, uint32_t count)
+{
+    uint32_t sectors_per_block = fs->block_size / BLK_SECTOR_SIZE;
+    bio_t **bios               = fs->queue ? kmalloc(sizeof(bio_t *) * count) : NULL;
+    int ret                    = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        bio_t *bio = NULL;
+        if (bios) {
+            uint32_t real_index = ext2_get_real_block_index(fs, &fs->journal.inode, block + i);
+            if (real_index) {
+                bio = bio_alloc(real_index * sectors_per_block, sectors_per_block, buffers[i], 1);
+            }
+            if (bio && (blk_submit_bio(fs->queue, bio) < 0)) {
+                bio_free(bio);
+                bio = NULL;
+            }
+            bios[i] = bio;
+        }
+        if (!bio && (ext2_journal_io(fs, block + i, buffers[i], 1) < 0)) {
+            ret = -1;
+        }
+    }
+    if (bios) {
+        // Dispatch the writes, and wait for them.
+        blk_run_queue(fs->queue);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (bios[i]) {
+                if (bios[i]->status < 0) {
+                    ret = -1;
+                }
+                bio_free(bios[i]);
+            }
+        }
+        kfree(bios);
+    }
+    return ret;
+}
+
+/// @brief Updates the superblock of the journal, with the start of the log.
+/// @param fs the ext2 filesystem structure.
+/// @param start the first block of the oldest transaction which might need to be replayed.
+/// @param sequence the number of that transaction.
+/// @return 0 on success, -1 on failure.
+static int ext2_journal_write_super(ext2_filesystem_t *fs, uint32_t start, uint32_t sequence)
+{
+    ext2_journal_superblock_t *sb = (ext2_journal_superblock_t *)fs->journal.sb;
+    sb->start                     = ext2_journal_be32(start);
+    sb->sequence                  = ext2_journal_be32(sequence);
+    return ext2_journal_io(fs, 0, fs->journal.sb, 1);
+}
+
+/// @brief Writes all the dirty blocks inside the journal, as a single transaction.
+/// @details The descriptor blocks, telling where each block belongs, are
+/// written together with the blocks, as a sequential run. The commit block is
+/// written only after them, so that the transaction is complete on the device
+/// once the commit block is there. From then on the blocks can be written in
+/// place, since a crash can be repaired by replaying the transaction.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success, -1 if the blocks must be written without the journal.
+static int ext2_journal_commit(ext2_filesystem_t *fs)
+{
+    ext2_journal_t *journal = &fs->journal;
+    uint32_t dirty_count    = 0;
+    list_for_each_decl (it, &fs->dirty_blocks) {
+        ++dirty_count;
+    }
+    // Each descriptor holds the UUID of the journal, and the tags of the blocks.
+    uint32_t tags_per_block = (fs->block_size - sizeof(ext2_journal_header_t) - 16) / sizeof(ext2_journal_tag_t);
+    uint32_t descriptors    = (dirty_count + tags_per_block - 1) / tags_per_block;
+    // The blocks of the transaction, apart from the commit block.
+    uint32_t length         = descriptors + dirty_count;
+    int ret                 = 0;
+    if ((length + 1) > (journal->maxlen - journal->first)) {
+        pr_warning("A transaction of %u blocks does not fit inside the journal.\n", length + 1);
+        return -1;
+    }
+    // A transaction does not wrap around the end of the log. Since the
+    // previous transactions have been written in place, we restart from the
+    // beginning, after telling where the log starts now.
+    if ((journal->head + length + 1) > journal->maxlen) {
+        if (ext2_journal_write_super(fs, journal->first, journal->sequence) < 0) {
+            pr_err("Failed to update the superblock of the journal.\n");
+            return -1;
+        }
+        journal->head = journal->first;
+    }
+    // The content of the blocks of the log, and the buffers we allocated.
+    uint8_t **buffers = kmalloc(sizeof(uint8_t *) * length * 2);
+    if (!buffers) {
+        return -1;
+    }
+    uint8_t **owned         = buffers + length;
+    uint8_t *descriptor     = NULL;
+    ext2_journal_tag_t *tag = NULL;
+    uint32_t offset = 0, tags = 0, count = 0;
+    list_for_each_decl (it, &fs->dirty_blocks) {
+        ext2_buffer_t *dirty = list_entry(it, ext2_buffer_t, list);
+        // Start a new descriptor, when the current one is full.
+        if (!descriptor || (tags == tags_per_block)) {
+            if (tag) {
+                tag->flags |= ext2_journal_be32(EXT2_JOURNAL_FLAG_LAST_TAG);
+            }
+            descriptor = ext2_alloc_cache(fs);
+            ext2_journal_set_header(descriptor, EXT2_JOURNAL_DESCRIPTOR_BLOCK, journal->sequence);
+            buffers[count] = owned[count] = descriptor;
+            ++count;
+            offset = sizeof(ext2_journal_header_t), tags = 0;
+        }
+        uint32_t flags = tags ? EXT2_JOURNAL_FLAG_SAME_UUID : 0;
+        tag            = (ext2_journal_tag_t *)(descriptor + offset);
+        tag->blocknr   = ext2_journal_be32(dirty->block_index);
+        offset += sizeof(ext2_journal_tag_t);
+        // Only the first tag is followed by the UUID.
+        if (tags++ == 0) {
+            memcpy(descriptor + offset, ((ext2_journal_superblock_t *)journal->sb)->uuid, 16);
+            offset += 16;
+        }
+        buffers[count] = dirty->data;
+        owned[count]   = NULL;
+        // A block starting with the magic number would look like a block of
+        // the journal, so the copy inside the log has it cleared.
+        if (ext2_journal_be32(*(uint32_t *)dirty->data) == EXT2_JOURNAL_MAGIC) {
+            buffers[count] = owned[count] = ext2_alloc_cache(fs);
+            memcpy(buffers[count], dirty->data, fs->block_size);
+            *(uint32_t *)buffers[count] = 0;
+            flags |= EXT2_JOURNAL_FLAG_ESCAPE;
+        }
+        tag->flags = ext2_journal_be32(flags);
+        ++count;
+    }
+    if (tag) {
+        tag->flags |= ext2_journal_be32(EXT2_JOURNAL_FLAG_LAST_TAG);
+    }
+    // Write the descriptors and the blocks, then the commit block.
+    if (ext2_journal_write_run(fs, journal->head, buffers, length) < 0) {
+        pr_err("Failed to write transaction %u inside the journal.\n", journal->sequence);
+        ret = -1;
+    } else {
+        uint8_t *commit = ext2_alloc_cache(fs);
+        ext2_journal_set_header(commit, EXT2_JOURNAL_COMMIT_BLOCK, journal->sequence);
+        if (ext2_journal_io(fs, journal->head + length, commit, 1) < 0) {
+            pr_err("Failed to commit transaction %u.\n", journal->sequence);
+            ret = -1;
+        } else {
+            journal->head += length + 1;
+            journal->sequence += 1;
+        }
+        ext2_dealloc_cache(commit);
+    }
+    for (uint32_t i = 0; i < length; ++i) {
+        if (owned[i]) {
+            ext2_dealloc_cache(owned[i]);
+        }
+    }
+    kfree(buffers);
+    return ret;
+}
+
+/// @brief Drops the transactions which have been written in place, by moving
+/// the start of the log after them.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success, -1 on failure.
+static int ext2_journal_checkpoint(ext2_filesystem_t *fs)
+{
+    ext2_journal_t *journal = &fs->journal;
+    if (journal->head >= journal->maxlen) {
+        journal->head = journal->first;
+    }
+    return ext2_journal_write_super(fs, journal->head, journal->sequence);
+}
+
+/// @brief A block revoked by a transaction, which must not be replayed from
+/// the transactions preceding it.
+typedef struct ext2_journal_revoke {
+    uint32_t block;    ///< The revoked block.
+    uint32_t sequence; ///< The most recent transaction revoking it.
+    list_head_t list;  ///< Used to place the entry inside the list of revoked blocks.
+} ext2_journal_revoke_t;
+
+/// @brief The passes of the recovery of the journal.
+typedef enum ext2_journal_pass {
+    ext2_journal_pass_scan,   ///< Finds the last committed transaction.
+    ext2_journal_pass_revoke, ///< Collects the revoked blocks.
+    ext2_journal_pass_replay, ///< Writes the blocks in place.
+} ext2_journal_pass_t;
+
+/// @brief Records that a transaction revoked a block, keeping the most recent one.
+/// @param revoked the list of revoked blocks.
+/// @param block the revoked block.
+/// @param sequence the transaction revoking it.
+static void ext2_journal_revoke(list_head_t *revoked, uint32_t block, uint32_t sequence)
+{
+    list_for_each_decl (it, revoked) {
+        ext2_journal_revoke_t *entry = list_entry(it, ext2_journal_revoke_t, list);
+        if (entry->block == block) {
+            entry->sequence = max(entry->sequence, sequence);
+            return;
+        }
+    }
+    ext2_journal_revoke_t *entry = kmalloc(sizeof(ext2_journal_revoke_t));
+    if (entry) {
+        entry->block    = block;
+        entry->sequence = sequence;
+        list_head_insert_before(&entry->list, revoked);
+    }
+}
+
+/// @brief Checks if a block must not be replayed from a transaction.
+/// @param revoked the list of revoked blocks.
+/// @param block the block.
+/// @param sequence the transaction holding the block.
+/// @return 1 if the block has been revoked by this transaction or a later one, 0 otherwise.
+static int ext2_journal_is_revoked(list_head_t *revoked, uint32_t block, uint32_t sequence)
+{
+    list_for_each_decl (it, revoked) {
+        ext2_journal_revoke_t *entry = list_entry(it, ext2_journal_revoke_t, list);
+        if (entry->block == block) {
+            return entry->sequence >= sequence;
+        }
+    }
+    return 0;
+}
+
+/// @brief Walks the log, from its start, performing one of the passes of the recovery.
+/// @details
+///  - the scan pass finds the last transaction which has been committed.
+///  - the revoke pass collects the blocks revoked by the committed transactions.
+///  - the replay pass writes the blocks of the committed transactions in
+///    place, skipping the revoked ones.
+/// @param fs the ext2 filesystem structure.
+/// @param pass the pass.
+/// @param end the transaction following the last committed one, set by the scan pass.
+/// @param revoked the list of revoked blocks.
+/// @return 0 on success, -1 on failure.
+static int
+ext2_journal_recovery_pass(ext2_filesystem_t *fs, ext2_journal_pass_t pass, uint32_t *end, list_head_t *revoked)
+{
+    ext2_journal_t *journal       = &fs->journal;
+    ext2_journal_superblock_t *sb = (ext2_journal_superblock_t *)journal->sb;
+    uint32_t block                = ext2_journal_be32(sb->start);
+    uint32_t sequence             = ext2_journal_be32(sb->sequence);
+    uint8_t *cache                = ext2_alloc_cache(fs);
+    uint8_t *data                 = ext2_alloc_cache(fs);
+    int ret                       = 0;
+    // During the scan pass we do not know yet where the log ends.
+    while ((pass == ext2_journal_pass_scan) || (sequence != *end)) {
+        if (ext2_journal_io(fs, block, cache, 0) < 0) {
+            ret = (pass == ext2_journal_pass_scan) ? 0 : -1;
+            break;
+        }
+        uint32_t type = ext2_journal_get_type(cache, sequence);
+        if (type == EXT2_JOURNAL_DESCRIPTOR_BLOCK) {
+            uint32_t offset = sizeof(ext2_journal_header_t);
+            // Each tag is followed by the block it describes.
+            while ((offset + sizeof(ext2_journal_tag_t)) <= fs->block_size) {
+                ext2_journal_tag_t *tag = (ext2_journal_tag_t *)(cache + offset);
+                uint32_t blocknr        = ext2_journal_be32(tag->blocknr);
+                uint32_t flags          = ext2_journal_be32(tag->flags);
+                offset += sizeof(ext2_journal_tag_t) + (bitmask_check(flags, EXT2_JOURNAL_FLAG_SAME_UUID) ? 0 : 16);
+                block = ext2_journal_next(journal, block);
+                if ((pass == ext2_journal_pass_replay) && !ext2_journal_is_revoked(revoked, blocknr, sequence)) {
+                    if (ext2_journal_io(fs, block, data, 0) < 0) {
+                        ret = -1;
+                        break;
+                    }
+                    if (bitmask_check(flags, EXT2_JOURNAL_FLAG_ESCAPE)) {
+                        *(uint32_t *)data = ext2_journal_be32(EXT2_JOURNAL_MAGIC);
+                    }
+                    if (ext2_write_block(fs, blocknr, data) < 0) {
+                        ret = -1;
+                        break;
+                    }
+                }
+                if (bitmask_check(flags, EXT2_JOURNAL_FLAG_LAST_TAG)) {
+                    break;
+                }
+            }
+            if (ret < 0) {
+                break;
+            }
+        } else if (type == EXT2_JOURNAL_COMMIT_BLOCK) {
+            if (pass == ext2_journal_pass_scan) {
+                *end = sequence + 1;
+            }
+            ++sequence;
+        } else if (type == EXT2_JOURNAL_REVOKE_BLOCK) {
+            if (pass == ext2_journal_pass_revoke) {
+                // The header is followed by the size of the used part of the block.
+                uint32_t size = ext2_journal_be32(*(uint32_t *)(cache + sizeof(ext2_journal_header_t)));
+                size          = min(size, fs->block_size);
+                for (uint32_t offset = sizeof(ext2_journal_header_t) + 4; (offset + 4) <= size; offset += 4) {
+                    ext2_journal_revoke(revoked, ext2_journal_be32(*(uint32_t *)(cache + offset)), sequence);
+                }
+            }
+        } else {
+            // We reached the end of the log.
+            break;
+        }
+        block = ext2_journal_next(journal, block);
+    }
+    ext2_dealloc_cache(data);
+    ext2_dealloc_cache(cache);
+    return ret;
+}
+
+/// @brief Replays the committed transactions found inside the log.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success, -1 on failure.
+static int ext2_journal_recover(ext2_filesystem_t *fs)
+{
+    ext2_journal_superblock_t *sb = (ext2_journal_superblock_t *)fs->journal.sb;
+    uint32_t end                  = ext2_journal_be32(sb->sequence);
+    list_head_t revoked;
+    list_head_init(&revoked);
+    int ret = ext2_journal_recovery_pass(fs, ext2_journal_pass_scan, &end, &revoked);
+    if (!ret) {
+        ret = ext2_journal_recovery_pass(fs, ext2_journal_pass_revoke, &end, &revoked);
+    }
+    if (!ret) {
+        ret = ext2_journal_recovery_pass(fs, ext2_journal_pass_replay, &end, &revoked);
+    }
+    list_for_each_safe_decl(it, store, &revoked)
+    {
+        ext2_journal_revoke_t *entry = list_entry(it, ext2_journal_revoke_t, list);
+        list_head_remove(&entry->list);
+        kfree(entry);
+    }
+    if (ret < 0) {
+        return -1;
+    }
+    pr_notice("Replayed %u transactions from the journal.\n", end - ext2_journal_be32(sb->sequence));
+    // Write the replayed blocks in place, the journal is not active yet.
+    if (ext2_writeback_flush(fs) < 0) {
+        return -1;
+    }
+    // The BGDT might have been replayed, and the superblock is not journaled,
+    // so its counters are computed again from the groups.
+    if (ext2_read_bgdt(fs) < 0) {
+        return -1;
+    }
+    fs->superblock.free_blocks_count = 0;
+    fs->superblock.free_inodes_count = 0;
+    for (uint32_t i = 0; i < fs->block_groups_count; ++i) {
+        fs->superblock.free_blocks_count += fs->block_groups[i].free_blocks_count;
+        fs->superblock.free_inodes_count += fs->block_groups[i].free_inodes_count;
+    }
+    fs->journal.sequence = end;
+    return 0;
+}
+
+/// @brief Opens the journal of an ext3 filesystem, replaying it if needed,
+/// and starts writing the metadata through it.
+/// @param fs the ext2 filesystem structure.
+/// @return 0 on success (also when the filesystem has no journal), -1 on failure.
+static int ext2_journal_initialize(ext2_filesystem_t *fs)
+{
+    ext2_journal_t *journal = &fs->journal;
+    if (!bitmask_check(fs->superblock.feature_compat, EXT2_FEATURE_COMPAT_HAS_JOURNAL) ||
+        (fs->superblock.journal_inum == 0)) {
+        return 0;
+    }
+    if (ext2_read_inode(fs, &journal->inode, fs->superblock.journal_inum) == -1) {
+        pr_err("Failed to read the inode of the journal (%u).\n", fs->superblock.journal_inum);
+        return -1;
+    }
+    // Read the superblock of the journal, which is its first block.
+    journal->maxlen = 1;
+    journal->sb     = ext2_alloc_cache(fs);
+    if (ext2_journal_io(fs, 0, journal->sb, 0) < 0) {
+        goto fail;
+    }
+    ext2_journal_superblock_t *sb = (ext2_journal_superblock_t *)journal->sb;
+    uint32_t blocktype            = ext2_journal_be32(sb->header.blocktype);
+    if ((ext2_journal_be32(sb->header.magic) != EXT2_JOURNAL_MAGIC) ||
+        ((blocktype != EXT2_JOURNAL_SUPERBLOCK_V1) && (blocktype != EXT2_JOURNAL_SUPERBLOCK_V2))) {
+        pr_err("The journal has an invalid superblock.\n");
+        goto fail;
+    }
+    journal->maxlen = ext2_journal_be32(sb->maxlen);
+    journal->first  = ext2_journal_be32(sb->first);
+    if ((ext2_journal_be32(sb->blocksize) != fs->block_size) || (journal->first == 0) ||
+        (journal->first >= journal->maxlen) || (journal->maxlen > (journal->inode.size / fs->block_size))) {
+        pr_err("The journal has an invalid geometry.\n");
+        goto fail;
+    }
+    // Blocks with 64-bit numbers, checksums, and asynchronous commits are not supported.
+    if ((blocktype == EXT2_JOURNAL_SUPERBLOCK_V2) &&
+        (ext2_journal_be32(sb->feature_incompat) & ~EXT2_JOURNAL_INCOMPAT_REVOKE)) {
+        pr_err("The journal uses unsupported features (0x%x).\n", ext2_journal_be32(sb->feature_incompat));
+        goto fail;
+    }
+    journal->sequence = ext2_journal_be32(sb->sequence);
+    // A log which does not start from 0 might hold committed transactions.
+    if (sb->start && (ext2_journal_recover(fs) < 0)) {
+        pr_err("Failed to replay the journal.\n");
+        goto fail;
+    }
+    // Start the log from its beginning.
+    journal->head = journal->first;
+    if (ext2_journal_write_super(fs, journal->head, journal->sequence) < 0) {
+        goto fail;
+    }
+    // Until the filesystem is unmounted, the journal must be checked.
+    fs->superblock.feature_incompat |= EXT2_FEATURE_INCOMPAT_RECOVER;
+    ext2_metadata_mark_dirty(fs);
+    journal->active = true;
+    pr_notice("Using the journal (inode: %u, blocks: %u).\n", fs->superblock.journal_inum, journal->maxlen);
+    return 0;
+fail:
+    ext2_dealloc_cache(journal->sb);
+    journal->sb = NULL;
+    return -1;
+}
+
 // ============================================================================
 // Virtual FileSystem (VFS) Functions
 // ============================================================================
@@ -2834,6 +6609,14 @@ static int ext2_create_inode(ext2_filesystem_t *fs, ext2_inode_t *inode, mode_t
     inode->osd1         = 0;
     // Set the blocks data.
     memset(&inode->data, 0, sizeof(inode->data));
+#ifdef EXT2_EXTENT_ALLOC
+    // On filesystems supporting them, new regular files are mapped by an empty extent tree.
+    if (bitmask_check(fs->superblock.feature_incompat, EXT4_FEATURE_INCOMPAT_EXTENTS) && S_ISREG(mode)) {
+        inode->flags                     = EXT4_EXTENTS_FL;
+        inode->data.extents.header.magic = EXT4_EXTENT_MAGIC;
+        inode->data.extents.header.max   = EXT4_EXTENT_ROOT_ENTRIES;
+    }
+#endif
     // Set the value used to indicate the file version (used by NFS).
     inode->generation    = 0;
     // TODO: The value indicating the block number containing the extended attributes.
@@ -2909,8 +6692,8 @@ static vfs_file_t *ext2_creat(const char *path, mode_t mode)
     }
     // Set the inode mode.
     mode                 = S_IFREG | (0xFFF & mode);
-    // Get the group index of the parent.
-    uint32_t group_index = ext2_inode_index_to_group_index(fs, parent->ino);
+    // Choose the group of the new inode.
+    uint32_t group_index = ext2_find_inode_group(fs, parent->ino, 0);
     // Create and initialize the new inode.
     int inode_index      = ext2_create_inode(fs, &inode, mode, group_index);
     if (inode_index == -1) {
@@ -3033,6 +6816,12 @@ static vfs_file_t *ext2_open(const char *path, int flags, mode_t mode)
         }
     }
 
+    // A named pipe keeps its data inside a pipe shared by its openers, the
+    // inode only gives it a name.
+    if (S_ISFIFO(inode.mode)) {
+        return pipe_open_fifo(fs, search.direntry.inode, flags, inode.mode);
+    }
+
     vfs_file_t *file = ext2_find_vfs_file_with_inode(fs, search.direntry.inode);
     if (file == NULL) {
         // Allocate the memory for the file.
@@ -3055,6 +6844,8 @@ static vfs_file_t *ext2_open(const char *path, int flags, mode_t mode)
         // Add the vfs_file to the list of associated files.
         list_head_insert_before(&file->siblings, &fs->opened_files);
     }
+    // The openers of an inode share its file, O_DIRECT is kept by each
+    // descriptor, and reaches the direct operations below.
     return file;
 }
 
@@ -3084,10 +6875,13 @@ static int ext2_unlink(const char *path)
     if (ext2_resolve_path(fs->root, path, &search)) {
         return -ENOENT;
     }
+    // Both the entries of the parent and the links of the inode change.
+    ext2_inode_lock_pair(fs, search.parent_inode, search.direntry.inode);
     // Get the inode associated with the parent directory entry.
     ext2_inode_t parent_inode;
     if (ext2_read_inode(fs, &parent_inode, search.parent_inode) == -1) {
         pr_err("ext2_unlink(%s): Failed to read the inode of parent (%d).\n", path, search.parent_inode);
+        ext2_inode_unlock_pair(fs, search.parent_inode, search.direntry.inode);
         return -ENOENT;
     }
     // Allocate the cache.
@@ -3112,6 +6906,8 @@ static int ext2_unlink(const char *path)
     memset(actual_dirent->name, 0, actual_dirent->name_len);
     actual_dirent->name_len  = 0;
     actual_dirent->file_type = ext2_file_type_unknown;
+    // The entries of the parent changed.
+    ext2_dcache_invalidate(fs, search.parent_inode);
     // Write back the parent directory block.
     if (!ext2_write_inode_block(fs, &parent_inode, search.parent_inode, search.block_index, cache)) {
         pr_err("ext2_unlink(%s): Failed to write the inode block (%d).\n", path, search.block_index);
@@ -3140,6 +6936,7 @@ static int ext2_unlink(const char *path)
         }
     }
 early_exit:
+    ext2_inode_unlock_pair(fs, search.parent_inode, search.direntry.inode);
     // Free the cache.
     ext2_dealloc_cache(cache);
     return ret;
@@ -3175,19 +6972,86 @@ static int ext2_close(vfs_file_t *file)
             pr_warning("ext2_close: Attempted to close the root file `%s`.\n", file->name);
             return -EPERM;
         }
-
-        pr_debug("ext2_close: Closing file `%s` (ino: %d).\n", file->name, file->ino);
-
-        // Remove the file from the list of opened files.
-        list_head_remove(&file->siblings);
-        pr_debug("ext2_close: Removed file `%s` from the opened file list.\n", file->name);
-
-        // Free the file from cache.
-        pr_debug("ext2_close: Freeing memory for file `%s`.\n", file->name);
-        vfs_dealloc_file(file);
+
+        pr_debug("ext2_close: Closing file `%s` (ino: %d).\n", file->name, file->ino);
+
+        // Release the blocks we reserved for the file, but it did not use.
+        ext2_prealloc_discard(fs, file);
+
+        // Remove the file from the list of opened files.
+        list_head_remove(&file->siblings);
+        pr_debug("ext2_close: Removed file `%s` from the opened file list.\n", file->name);
+
+        // Free the file from cache.
+        pr_debug("ext2_close: Freeing memory for file `%s`.\n", file->name);
+        vfs_dealloc_file(file);
+    }
+
+    return 0;
+}
+
+/// @brief Reads the data of a regular file, or of another inode, following
+/// the flags of the descriptor it is read through.
+/// @param fs the filesystem.
+/// @param file the file.
+/// @param inode the inode of the file.
+/// @param offset the offset from which we start reading the data.
+/// @param nbyte the number of bytes to read.
+/// @param buffer the buffer where we store the data.
+/// @param direct if the descriptor has been opened with O_DIRECT.
+/// @return the amount we read, or a negative value on failure.
+static ssize_t ext2_read_file_data(
+    ext2_filesystem_t *fs,
+    vfs_file_t *file,
+    ext2_inode_t *inode,
+    off_t offset,
+    size_t nbyte,
+    char *buffer,
+    bool_t direct)
+{
+    if (!S_ISREG(inode->mode)) {
+        return ext2_read_inode_data(fs, inode, file->ino, offset, nbyte, buffer);
+    }
+    // Direct reads go straight to the buffer, without touching the caches.
+    if (direct) {
+        if (!ext2_direct_aligned(fs, offset, nbyte, buffer)) {
+            return -EINVAL;
+        }
+        if (offset >= inode->size) {
+            return 0;
+        }
+        return ext2_read_inode_runs(fs, inode, file->ino, offset, min(offset + nbyte, inode->size), buffer);
     }
+    // Regular files read ahead when accessed sequentially.
+    return ext2_readahead_file(fs, file, inode, offset, nbyte, buffer);
+}
 
-    return 0;
+/// @brief Writes the data of a file, following the flags of the descriptor it
+/// is written through.
+/// @param fs the filesystem.
+/// @param file the file.
+/// @param inode the inode of the file.
+/// @param offset the offset from which we start writing the data.
+/// @param nbyte the number of bytes to write.
+/// @param buffer the buffer containing the data.
+/// @param direct if the descriptor has been opened with O_DIRECT.
+/// @return the amount written, or a negative value on failure.
+static ssize_t ext2_write_file_data(
+    ext2_filesystem_t *fs,
+    vfs_file_t *file,
+    ext2_inode_t *inode,
+    off_t offset,
+    size_t nbyte,
+    const char *buffer,
+    bool_t direct)
+{
+    if (S_ISREG(inode->mode) && direct) {
+        if (!ext2_direct_aligned(fs, offset, nbyte, buffer)) {
+            return -EINVAL;
+        }
+        return ext2_write_inode_direct(fs, inode, file->ino, offset, nbyte, buffer);
+    }
+    return ext2_write_inode_data(fs, inode, file->ino, offset, nbyte, (char *)buffer);
 }
 
 /// @brief Reads from the file identified by the file descriptor.
@@ -3207,18 +7071,27 @@ static ssize_t ext2_read(vfs_file_t *file, char *buffer, off_t offset, size_t nb
         pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
         return -1;
     }
+    // Readers of the same file share its lock, and only wait for the writers.
+    rwlock_read_lock(ext2_inode_lock_of(fs, file->ino));
     // Get the inode associated with the file.
     ext2_inode_t inode;
     if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
         pr_err("Failed to read the inode `%s`.\n", file->name);
         return -1;
     }
     // Disallow reading directories using read
     if ((inode.mode & S_IFDIR) == S_IFDIR) {
+        rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
         pr_err("Reading a directory `%s` is not allowed.\n", file->name);
         return -EISDIR;
     }
-    return ext2_read_inode_data(fs, &inode, file->ino, offset, nbyte, buffer);
+    ssize_t ret = ext2_read_file_data(fs, file, &inode, offset, nbyte, buffer, false);
+    if (ret >= 0) {
+        ext2_touch_inode(fs, file->ino, 0);
+    }
+    rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
+    return ret;
 }
 
 /// @brief Writes the given content inside the file.
@@ -3238,13 +7111,21 @@ static ssize_t ext2_write(vfs_file_t *file, const void *buffer, off_t offset, si
         pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
         return -1;
     }
+    // Writers of the same file are serialized, so that they do not overwrite
+    // each other's changes to the inode.
+    rwlock_write_lock(ext2_inode_lock_of(fs, file->ino));
     // Get the inode associated with the file.
     ext2_inode_t inode;
     if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        rwlock_write_unlock(ext2_inode_lock_of(fs, file->ino));
         pr_err("Failed to read the inode `%s`.\n", file->name);
         return -1;
     }
-    ssize_t written = ext2_write_inode_data(fs, &inode, file->ino, offset, nbyte, (char *)buffer);
+    ssize_t written = ext2_write_file_data(fs, file, &inode, offset, nbyte, buffer, false);
+    if (written > 0) {
+        ext2_touch_inode(fs, file->ino, 1);
+    }
+    rwlock_write_unlock(ext2_inode_lock_of(fs, file->ino));
     if (written < 0) {
         pr_err("Failed to write on file %s.\n", file->name);
     } else {
@@ -3254,6 +7135,260 @@ static ssize_t ext2_write(vfs_file_t *file, const void *buffer, off_t offset, si
     return written;
 }
 
+/// @brief Reads from the file into multiple buffers, reading the inode once.
+/// @param file The file.
+/// @param iov The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start reading from the file.
+/// @param direct If the descriptor has been opened with O_DIRECT.
+/// @return The number of red bytes, -errno on failure.
+static ssize_t __ext2_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset, bool_t direct)
+{
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
+        return -1;
+    }
+    // Readers of the same file share its lock, and only wait for the writers.
+    rwlock_read_lock(ext2_inode_lock_of(fs, file->ino));
+    // Get the inode associated with the file.
+    ext2_inode_t inode;
+    if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
+        pr_err("Failed to read the inode `%s`.\n", file->name);
+        return -1;
+    }
+    // Disallow reading directories using read
+    if ((inode.mode & S_IFDIR) == S_IFDIR) {
+        rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
+        pr_err("Reading a directory `%s` is not allowed.\n", file->name);
+        return -EISDIR;
+    }
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        // Regular files read ahead when accessed sequentially, which is the
+        // case for the segments of the same vector.
+        ssize_t ret = ext2_read_file_data(fs, file, &inode, offset + total, iov[i].iov_len, iov[i].iov_base, direct);
+        if (ret < 0) {
+            if (total == 0) {
+                total = ret;
+            }
+            break;
+        }
+        total += ret;
+        // Stop at the end of the file.
+        if ((size_t)ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    if (total >= 0) {
+        ext2_touch_inode(fs, file->ino, 0);
+    }
+    rwlock_read_unlock(ext2_inode_lock_of(fs, file->ino));
+    return total;
+}
+
+/// @brief Writes the content of multiple buffers inside the file, as a single
+/// update of the inode.
+/// @param file The file descriptor of the file.
+/// @param iov The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start writing in the file.
+/// @param direct If the descriptor has been opened with O_DIRECT.
+/// @return The number of written bytes, -1 on failure.
+static ssize_t __ext2_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset, bool_t direct)
+{
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
+        return -1;
+    }
+    // Compute the total size of the write.
+    size_t nbyte = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        nbyte += iov[i].iov_len;
+    }
+    if (nbyte == 0) {
+        return 0;
+    }
+    rwlock_write_lock(ext2_inode_lock_of(fs, file->ino));
+    // Get the inode associated with the file.
+    ext2_inode_t inode;
+    if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        rwlock_write_unlock(ext2_inode_lock_of(fs, file->ino));
+        pr_err("Failed to read the inode `%s`.\n", file->name);
+        return -1;
+    }
+    // Grow the file, and reserve its blocks, once for the whole vector, so
+    // that the segments do not update the inode one after the other.
+    if ((offset + nbyte) > inode.size) {
+        inode.size = offset + nbyte;
+        if (ext2_write_inode(fs, &inode, file->ino) == -1) {
+            rwlock_write_unlock(ext2_inode_lock_of(fs, file->ino));
+            pr_err("Failed to write the inode `%s`.\n", file->name);
+            return -1;
+        }
+    }
+    ext2_prealloc_reserve(fs, &inode, file->ino, ((offset + nbyte) / fs->block_size) + 1);
+    ssize_t written = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret =
+            ext2_write_file_data(fs, file, &inode, offset + written, iov[i].iov_len, iov[i].iov_base, direct);
+        if (ret < 0) {
+            pr_err("Failed to write on file %s.\n", file->name);
+            if (written == 0) {
+                written = -1;
+            }
+            break;
+        }
+        written += ret;
+    }
+    if (written > 0) {
+        ext2_touch_inode(fs, file->ino, 1);
+    }
+    rwlock_write_unlock(ext2_inode_lock_of(fs, file->ino));
+    // Update the file length.
+    file->length = inode.size;
+    return written;
+}
+
+/// @brief Reads from the file into multiple buffers.
+/// @param file The file.
+/// @param iov The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start reading from the file.
+/// @return The number of red bytes, -errno on failure.
+static ssize_t ext2_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return __ext2_readv(file, iov, iovcnt, offset, false);
+}
+
+/// @brief Writes the content of multiple buffers inside the file.
+/// @param file The file descriptor of the file.
+/// @param iov The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start writing in the file.
+/// @return The number of written bytes, -1 on failure.
+static ssize_t ext2_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return __ext2_writev(file, iov, iovcnt, offset, false);
+}
+
+/// @brief Reads from the file into multiple buffers, straight from the device,
+/// for a descriptor opened with O_DIRECT.
+/// @param file The file.
+/// @param iov The buffers, filled in order, aligned like the transfers.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start reading from the file.
+/// @return The number of red bytes, -errno on failure.
+static ssize_t ext2_readv_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return __ext2_readv(file, iov, iovcnt, offset, true);
+}
+
+/// @brief Writes the content of multiple buffers straight to the device, for a
+/// descriptor opened with O_DIRECT.
+/// @param file The file descriptor of the file.
+/// @param iov The buffers, written in order, aligned like the transfers.
+/// @param iovcnt The number of buffers.
+/// @param offset Offset from which we start writing in the file.
+/// @return The number of written bytes, -1 on failure.
+static ssize_t ext2_writev_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return __ext2_writev(file, iov, iovcnt, offset, true);
+}
+
+/// @brief Flushes the dirty blocks of the filesystem the file belongs to.
+/// @param file the file.
+/// @return 0 on success, -errno on failure.
+static int ext2_fsync(vfs_file_t *file)
+{
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
+        return -EINVAL;
+    }
+    // Dirty inodes and blocks are not tracked per file, flush them all.
+    ext2_icache_sync(fs, 1);
+    int ret = ext2_metadata_sync(fs);
+    if ((ext2_writeback_flush(fs) < 0) || (ret < 0)) {
+        return -EIO;
+    }
+    return 0;
+}
+
+/// @brief Reads a range of a regular file inside the page cache, or drops it
+/// from the caches.
+/// @param file the file.
+/// @param offset the start of the range.
+/// @param len the length of the range, 0 to reach the end of the file.
+/// @param advice one of the POSIX_FADV_* values, the others are left to the read-ahead.
+/// @return 0 on success, -errno on failure.
+static int ext2_fadvise(vfs_file_t *file, off_t offset, off_t len, int advice)
+{
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)file->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", file->name);
+        return -EINVAL;
+    }
+    if ((advice != POSIX_FADV_WILLNEED) && (advice != POSIX_FADV_DONTNEED)) {
+        return 0;
+    }
+    rwlock_t *lock = ext2_inode_lock_of(fs, file->ino);
+    // Reading the pages only needs the readers' side, dropping them waits for
+    // the readers which might be using them.
+    if (advice == POSIX_FADV_WILLNEED) {
+        rwlock_read_lock(lock);
+    } else {
+        rwlock_write_lock(lock);
+    }
+    ext2_inode_t inode;
+    int ret = 0;
+    if (ext2_read_inode(fs, &inode, file->ino) == -1) {
+        pr_err("Failed to read the inode `%s`.\n", file->name);
+        ret = -EIO;
+    } else if (S_ISREG(inode.mode)) {
+        uint32_t end   = (len && (offset + len < inode.size)) ? (uint32_t)(offset + len) : inode.size;
+        uint32_t first = offset / PAGE_SIZE;
+        uint32_t last  = (end + PAGE_SIZE - 1) / PAGE_SIZE;
+        if (advice == POSIX_FADV_WILLNEED) {
+            // Reading more than the cache holds would only evict the first pages.
+            last = min(last, first + EXT2_PAGE_CACHE_MAX);
+            for (uint32_t index = first; index < last; ++index) {
+                if (!ext2_page_get(fs, &inode, file->ino, index)) {
+                    break;
+                }
+            }
+        } else {
+            // The cache is smaller than most files, walk it instead of the range.
+            list_for_each_safe_decl(it, store, &fs->page_lru)
+            {
+                ext2_page_t *page = list_entry(it, ext2_page_t, lru);
+                if ((page->inode_index == file->ino) && (page->index >= first) && (page->index < last)) {
+                    ext2_page_free(fs, page);
+                }
+            }
+            file->ra.size = 0;
+        }
+    }
+    if (advice == POSIX_FADV_WILLNEED) {
+        rwlock_read_unlock(lock);
+    } else {
+        rwlock_write_unlock(lock);
+    }
+    return ret;
+}
+
 /// @brief Repositions the file offset inside a file.
 /// @param file the file we are working with.
 /// @param offset the offest to use for the operation.
@@ -3357,6 +7492,37 @@ static int ext2_fstat(vfs_file_t *file, stat_t *stat)
     return __ext2_stat(fs, &inode, file->ino, stat);
 }
 
+/// @brief Retrieves information concerning an entry of an open directory.
+/// @param directory The directory, where the lookup starts.
+/// @param name The name of the entry.
+/// @param stat The structure where the information are stored.
+/// @return 0 if success.
+static int ext2_statat(vfs_file_t *directory, const char *name, stat_t *stat)
+{
+    pr_debug("ext2_statat(directory: %s, name: %s)\n", directory->name, name);
+    // Get the filesystem.
+    ext2_filesystem_t *fs = (ext2_filesystem_t *)directory->device;
+    if (fs == NULL) {
+        pr_err("The file does not belong to an EXT2 filesystem `%s`.\n", directory->name);
+        return -EPERM;
+    }
+    // Prepare the structure for the search.
+    ext2_direntry_search_t search;
+    memset(&search, 0, sizeof(ext2_direntry_search_t));
+    // Resolve the name, starting from the directory.
+    if (ext2_resolve_path(directory, name, &search)) {
+        return -ENOENT;
+    }
+    // Get the inode associated with the directory entry.
+    ext2_inode_t inode;
+    if (ext2_read_inode(fs, &inode, search.direntry.inode) == -1) {
+        pr_err("ext2_statat(name: %s): Failed to read the inode of `%s`.\n", name, search.direntry.name);
+        return -ENOENT;
+    }
+    // Set the rest of the structure.
+    return __ext2_stat(fs, &inode, search.direntry.inode, stat);
+}
+
 /// @brief Retrieves information concerning the file at the given position.
 /// @param path The path where the file resides.
 /// @param stat The structure where the information are stored.
@@ -3418,14 +7584,24 @@ static ssize_t ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_
         pr_err("Failed to read the inode (%d).\n", file->ino);
         return -ENOENT;
     }
-    uint32_t current = 0;
-    ssize_t written  = 0;
+    vfs_file_dirpos_t *pos = &file->dirpos;
+    uint32_t current       = 0;
+    ssize_t written        = 0;
     // Allocate the cache.
-    uint8_t *cache   = ext2_alloc_cache(fs);
-
-    // Initialize the iterator.
-    ext2_direntry_iterator_t it = ext2_direntry_iterator_begin(fs, cache, &inode);
-    for (; ext2_direntry_iterator_valid(&it) && (written < count); ext2_direntry_iterator_next(&it)) {
+    uint8_t *cache         = ext2_alloc_cache(fs);
+
+    // Initialize the iterator. If the caller continues from where the previous
+    // call stopped, resume from the saved position, instead of scanning the
+    // directory from the beginning and skipping the entries already provided.
+    ext2_direntry_iterator_t it;
+    if (doff && (pos->doff == doff)) {
+        it      = ext2_direntry_iterator_seek(fs, cache, &inode, pos->offset);
+        current = doff;
+    } else {
+        it = ext2_direntry_iterator_begin(fs, cache, &inode);
+    }
+    for (; ext2_direntry_iterator_valid(&it) && ((written + sizeof(dirent_t)) <= count);
+         ext2_direntry_iterator_next(&it)) {
         // Skip unused inode.
         if (it.direntry->inode == 0) {
             continue;
@@ -3447,6 +7623,9 @@ static ssize_t ext2_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_
         // Move to next writing position.
         ++dirp;
     }
+    // Save the position of the first entry we did not provide.
+    pos->doff   = doff + written;
+    pos->offset = ext2_direntry_iterator_valid(&it) ? it.total_offset : inode.size;
     // Free the cache.
     ext2_dealloc_cache(cache);
     return written;
@@ -3499,10 +7678,16 @@ static ssize_t ext2_readlink(const char *path, char *buffer, size_t bufsize)
 
     // Determine the number of characters to read (symlink length or buffer
     // size, whichever is smaller).
-    ssize_t ret = min(strlen(inode.data.symlink), bufsize);
+    ssize_t ret = min(inode.size, bufsize);
 
-    // Copy the symbolic link content to the buffer.
-    strncpy(buffer, inode.data.symlink, ret);
+    // Fast symlinks keep the target inside the inode, the other ones inside
+    // their data blocks.
+    if (ext2_is_fast_symlink(fs, &inode)) {
+        memcpy(buffer, inode.data.symlink, ret);
+    } else if (ext2_read_inode_data(fs, &inode, search.direntry.inode, 0, ret, buffer) != ret) {
+        pr_err("ext2_readlink(path: %s): Failed to read the target of the link.\n", path);
+        return -EIO;
+    }
 
     // Null-terminate the buffer if there's space.
     if (ret < bufsize) {
@@ -3513,6 +7698,67 @@ static ssize_t ext2_readlink(const char *path, char *buffer, size_t bufsize)
     return ret;
 }
 
+/// @brief Creates a symbolic link.
+/// @details Targets shorter than the block pointers of the inode are stored in
+/// their place (fast symlinks), so that reading them requires no data block.
+/// @param linkname the target of the link, stored as it is.
+/// @param path the path of the new link.
+/// @return 0 on success, a negative errno on failure.
+static int ext2_symlink(const char *linkname, const char *path)
+{
+    pr_debug("ext2_symlink(linkname: %s, path: %s)\n", linkname, path);
+    // Get the EXT2 filesystem.
+    ext2_filesystem_t *fs = get_ext2_filesystem(path);
+    if (fs == NULL) {
+        pr_err("ext2_symlink(path: %s): Failed to get the EXT2 filesystem.\n", path);
+        return -ENOENT;
+    }
+    // Check the length of the target.
+    size_t length = strlen(linkname);
+    if (length == 0) {
+        return -ENOENT;
+    }
+    if (length >= fs->block_size) {
+        return -ENAMETOOLONG;
+    }
+    // Prepare the structure for the search.
+    ext2_direntry_search_t search;
+    memset(&search, 0, sizeof(ext2_direntry_search_t));
+    // Search if the entry already exists.
+    if (!ext2_resolve_path(fs->root, path, &search)) {
+        pr_err("ext2_symlink(path: %s): File already exists.\n", path);
+        return -EEXIST;
+    }
+    // Choose the group of the new inode.
+    uint32_t group_index = ext2_find_inode_group(fs, search.parent_inode, 0);
+    // Create and initialize the new inode.
+    ext2_inode_t inode;
+    int inode_index = ext2_create_inode(fs, &inode, S_IFLNK | 0777, group_index);
+    if (inode_index == -1) {
+        pr_err("ext2_symlink(path: %s): Failed to create a new inode (group index: %d).\n", path, group_index);
+        return -ENOSPC;
+    }
+    if (length < sizeof(inode.data.symlink)) {
+        // Store the target in place of the block pointers.
+        memcpy(inode.data.symlink, linkname, length);
+        inode.size = length;
+        if (ext2_write_inode(fs, &inode, inode_index) == -1) {
+            pr_err("ext2_symlink(path: %s): Failed to write the newly created inode.\n", path);
+            return -EIO;
+        }
+    } else if (ext2_write_inode_data(fs, &inode, inode_index, 0, length, (char *)linkname) < 0) {
+        pr_err("ext2_symlink(path: %s): Failed to write the target of the link.\n", path);
+        return -EIO;
+    }
+    // Create the directory entry for the link.
+    const char *name = basename(path);
+    if (ext2_allocate_direntry(fs, search.parent_inode, inode_index, name, ext2_file_type_symbolic_link) == -1) {
+        pr_err("ext2_symlink(path: %s): Failed to allocate the new direntry for the inode.\n", path);
+        return -ENOENT;
+    }
+    return 0;
+}
+
 /// @brief Creates a new directory at the given path.
 /// @param path The path of the new directory.
 /// @param mode The mode with which we create the directory.
@@ -3549,8 +7795,8 @@ static int ext2_mkdir(const char *path, mode_t mode)
     // Set the inode mode.
     mode = S_IFDIR | (0xFFF & mode);
 
-    // Get the group index of the parent.
-    uint32_t group_index = ext2_inode_index_to_group_index(fs, search.parent_inode);
+    // Choose the group of the new directory.
+    uint32_t group_index = ext2_find_inode_group(fs, search.parent_inode, 1);
     // Prepare an inode, it will come in handy either way.
     ext2_inode_t inode;
     // Create and initialize the new inode.
@@ -3562,8 +7808,13 @@ static int ext2_mkdir(const char *path, mode_t mode)
             path, group_index);
         return -ENOENT;
     }
-    // Increase the number of directories inside the group.
+    // Increase the number of directories inside the group, which might not be
+    // the preferred one.
+    group_index = ext2_inode_index_to_group_index(fs, inode_index);
+    spinlock_lock(&fs->group_info[group_index].lock);
     fs->block_groups[group_index].used_dirs_count += 1;
+    spinlock_unlock(&fs->group_info[group_index].lock);
+    ext2_metadata_mark_dirty(fs);
     // Write the inode.
     if (ext2_write_inode(fs, &inode, inode_index) == -1) {
         pr_err("Failed to write the newly created inode.\n");
@@ -3606,6 +7857,62 @@ static int ext2_mkdir(const char *path, mode_t mode)
     return 0;
 }
 
+/// @brief Creates a special file, only named pipes and regular files are
+/// supported, since the filesystem has no device nodes.
+/// @param path The path of the new file.
+/// @param mode The type and the permission of the new file.
+/// @param dev The device number, not used.
+/// @return Returns a negative value on failure.
+static int ext2_mknod(const char *path, mode_t mode, dev_t dev)
+{
+    pr_debug("ext2_mknod(path: %s, mode: %u, dev: %u)\n", path, mode, dev);
+    // Get the type of the directory entry, a missing type means a regular file.
+    ext2_file_type_t file_type;
+    if (S_ISFIFO(mode)) {
+        file_type = ext2_file_type_named_pipe;
+    } else if (S_ISREG(mode) || ((mode & S_IFMT) == 0)) {
+        file_type = ext2_file_type_regular_file;
+        mode      = S_IFREG | (mode & 0xFFF);
+    } else {
+        pr_err("ext2_mknod(path: %s): Unsupported file type %u.\n", path, mode & S_IFMT);
+        return -EPERM;
+    }
+    // Get the EXT2 filesystem.
+    ext2_filesystem_t *fs = get_ext2_filesystem(path);
+    if (fs == NULL) {
+        pr_err("ext2_mknod(path: %s): Failed to get the EXT2 filesystem.\n", path);
+        return -ENOENT;
+    }
+    // Prepare the structure for the search.
+    ext2_direntry_search_t search;
+    memset(&search, 0, sizeof(ext2_direntry_search_t));
+    // Search if the entry already exists.
+    if (!ext2_resolve_path(fs->root, path, &search)) {
+        pr_err("ext2_mknod(path: %s): The file already exists.\n", path);
+        return -EEXIST;
+    }
+    // Choose the group of the new inode.
+    uint32_t group_index = ext2_find_inode_group(fs, search.parent_inode, 0);
+    // Create and initialize the new inode, it has no content.
+    ext2_inode_t inode;
+    int inode_index = ext2_create_inode(fs, &inode, mode, group_index);
+    if (inode_index == -1) {
+        pr_err("ext2_mknod(path: %s): Failed to create a new inode (group index: %d).\n", path, group_index);
+        return -ENOSPC;
+    }
+    // Write the inode.
+    if (ext2_write_inode(fs, &inode, inode_index) == -1) {
+        pr_err("ext2_mknod(path: %s): Failed to write the newly created inode.\n", path);
+        return -EIO;
+    }
+    // Create the directory entry for the new file.
+    if (ext2_allocate_direntry(fs, search.parent_inode, inode_index, basename(path), file_type) == -1) {
+        pr_err("ext2_mknod(path: %s): Failed to allocate a new direntry for the inode.\n", path);
+        return -ENOSPC;
+    }
+    return 0;
+}
+
 /// @brief Removes the given directory.
 /// @param path The path to the directory to remove.
 /// @return Returns a negative value on failure.
@@ -3632,23 +7939,27 @@ static int ext2_rmdir(const char *path)
         return -ENOENT;
     }
 
+    // Both the parent and the directory change.
+    ext2_inode_lock_pair(fs, search.parent_inode, search.direntry.inode);
+    int ret = -ENOENT;
     // Get the inode associated with the parent directory entry.
     ext2_inode_t parent;
+    ext2_inode_t inode;
     if (ext2_read_inode(fs, &parent, search.parent_inode) == -1) {
         pr_err(
             "ext2_rmdir(path: %s): Failed to read the inode of parent of "
             "`%s`.\n",
             path, search.direntry.name);
-        return -ENOENT;
     }
     // Read the inode of the direntry we want to unlink.
-    ext2_inode_t inode;
-    if (ext2_read_inode(fs, &inode, search.direntry.inode) == -1) {
+    else if (ext2_read_inode(fs, &inode, search.direntry.inode) == -1) {
         pr_err("ext2_rmdir(path: %s): Failed to read the inode of `%s`.\n", path, search.direntry.name);
-        return -ENOENT;
+    } else {
+        ret = ext2_destroy_direntry(
+            fs, parent, inode, search.parent_inode, search.direntry.inode, search.block_index, search.block_offset);
     }
-    return ext2_destroy_direntry(
-        fs, parent, inode, search.parent_inode, search.direntry.inode, search.block_index, search.block_offset);
+    ext2_inode_unlock_pair(fs, search.parent_inode, search.direntry.inode);
+    return ret;
 }
 
 /// @brief Sets the attributes of an inode and saves it
@@ -3752,20 +8063,52 @@ static int ext2_setattr(const char *path, struct iattr *attr)
 /// @brief Mounts the block device as an EXT2 filesystem.
 /// @param block_device the block device formatted as EXT2.
 /// @param path location where we mount the filesystem.
+/// @param options the mount options, separated by commas, NULL for the defaults.
 /// @return the VFS root node of the EXT2 filesystem.
-static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path)
+static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path, const char *options)
 {
-    pr_debug("ext2_mount(device: %s, path: %s)\n", block_device->name, path);
+    pr_debug("ext2_mount(device: %s, path: %s, options: %s)\n", block_device->name, path, options);
+    uint32_t mount_flags;
+    if (ext2_parse_options(options, &mount_flags) < 0) {
+        return NULL;
+    }
     // Create the ext2 filesystem.
     ext2_filesystem_t *fs = kmalloc(sizeof(ext2_filesystem_t));
     // Clean the memory.
     memset(fs, 0, sizeof(ext2_filesystem_t));
-    // Initialize the filesystem spinlock.
-    spinlock_init(&fs->spinlock);
+    fs->mount_flags = mount_flags;
+    // Initialize the locks of the superblock and of the inodes.
+    seqlock_init(&fs->sb_lock);
+    for (uint32_t i = 0; i < EXT2_INODE_LOCKS; ++i) {
+        rwlock_init(&fs->inode_locks[i]);
+    }
     // Initialize the list of opened files.
     list_head_init(&fs->opened_files);
+    // Initialize the buffer cache, and the list of dirty blocks.
+    for (uint32_t i = 0; i < EXT2_BUFFER_HASH_SIZE; ++i) {
+        list_head_init(&fs->buffer_hash[i]);
+    }
+    list_head_init(&fs->buffer_lru);
+    list_head_init(&fs->dirty_blocks);
+    // Initialize the dentry cache.
+    for (uint32_t i = 0; i < EXT2_DCACHE_HASH_SIZE; ++i) {
+        list_head_init(&fs->dentry_hash[i]);
+    }
+    list_head_init(&fs->dentry_lru);
+    // Initialize the inode cache.
+    for (uint32_t i = 0; i < EXT2_INODE_HASH_SIZE; ++i) {
+        list_head_init(&fs->inode_hash[i]);
+    }
+    list_head_init(&fs->inode_lru);
+    // Initialize the page cache.
+    for (uint32_t i = 0; i < EXT2_PAGE_HASH_SIZE; ++i) {
+        list_head_init(&fs->page_hash[i]);
+    }
+    list_head_init(&fs->page_lru);
     // Set the pointer to the block device.
     fs->block_device = block_device;
+    // Get the request queue of the block device, if it has one.
+    fs->queue        = blk_get_queue(block_device);
     // Read the superblock.
     if (ext2_read_superblock(fs) == -1) {
         pr_err("Failed to read the superblock table at 1024.\n");
@@ -3854,6 +8197,25 @@ static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path)
         goto free_block_groups;
     }
 
+    // Allocate the in-memory state of the groups, no group is active yet.
+    fs->group_info = kmalloc(sizeof(ext2_group_info_t) * fs->block_groups_count);
+    if (fs->group_info == NULL) {
+        pr_err("Failed to allocate memory for the groups.\n");
+        // Free the block_groups and the filesystem.
+        goto free_block_groups;
+    }
+    memset(fs->group_info, 0, sizeof(ext2_group_info_t) * fs->block_groups_count);
+    for (uint32_t i = 0; i < fs->block_groups_count; ++i) {
+        spinlock_init(&fs->group_info[i].lock);
+    }
+    list_head_init(&fs->active_groups);
+
+    // Open the journal, replaying the transactions left by a crash.
+    if (ext2_journal_initialize(fs) < 0) {
+        pr_err("Failed to initialize the journal.\n");
+        goto free_block_buffer;
+    }
+
     // We need the root inode in order to set the root file.
     ext2_inode_t root_inode;
     if (ext2_read_inode(fs, &root_inode, 2U) == -1) {
@@ -3890,6 +8252,16 @@ static vfs_file_t *ext2_mount(vfs_file_t *block_device, const char *path)
     // Dump the block group descriptor table.
     ext2_dump_bgdt(fs);
 
+    // Start flushing the dirty blocks periodically.
+    init_work(&fs->flush_work, ext2_writeback_work);
+    ext2_writeback_arm(fs);
+
+    // Give the cached pages back once memory runs low.
+    fs->page_shrinker.name  = "ext2_pages";
+    fs->page_shrinker.scan  = ext2_page_scan;
+    fs->page_shrinker.flags = SHRINKER_FS;
+    register_shrinker(&fs->page_shrinker);
+
     return fs->root;
 
 free_all:
@@ -3900,6 +8272,9 @@ free_block_buffer:
     kmem_cache_destroy(fs->ext2_buffer_cache);
 free_block_groups:
     // Free the memory occupied by the block groups.
+    if (fs->group_info) {
+        kfree(fs->group_info);
+    }
     kfree(fs->block_groups);
 free_filesystem:
     // Free the memory occupied by the filesystem.
@@ -3915,8 +8290,9 @@ free_filesystem:
 /// EXT2 mount function.
 /// @param path the path where the filesystem should be mounted.
 /// @param device the device we mount.
+/// @param options the mount options, separated by commas, NULL for the defaults.
 /// @return the VFS file of the filesystem.
-static vfs_file_t *ext2_mount_callback(const char *path, const char *device)
+static vfs_file_t *ext2_mount_callback(const char *path, const char *device, const char *options)
 {
     super_block_t *sb = vfs_get_superblock(device);
     if (sb == NULL) {
@@ -3933,7 +8309,7 @@ static vfs_file_t *ext2_mount_callback(const char *path, const char *device)
         pr_err("mount_callback(%s, %s): The device is not a block device.\n", path, device);
         return NULL;
     }
-    return ext2_mount(block_device, path);
+    return ext2_mount(block_device, path, options);
 }
 
 /// Filesystem information.
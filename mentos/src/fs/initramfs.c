@@ -0,0 +1,194 @@
+/// @file initramfs.c
+/// @brief Unpacks a cpio archive, loaded by the bootloader as a module, into the filesystem.
+/// @details
+/// The archive is in the `newc` format: each entry is a header of ASCII
+/// hexadecimal fields, followed by the name and by the content of the entry,
+/// both padded to four bytes, and the archive ends with the `TRAILER!!!`
+/// entry. The entries are recreated through the VFS, usually inside a tmpfs
+/// mounted on the root, so that init and the boot tools run from memory
+/// while the disks are still being scanned.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[INITRD]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/initramfs.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/vfs.h"
+#include "limits.h"
+#include "stdio.h"
+#include "strerror.h"
+#include "string.h"
+#include "sys/module.h"
+#include "sys/stat.h"
+
+/// The magic number of the `newc` format.
+#define CPIO_NEWC_MAGIC     "070701"
+/// The magic number of the `newc` format, with checksums.
+#define CPIO_NEWC_CRC_MAGIC "070702"
+/// The name of the last entry of the archive.
+#define CPIO_TRAILER        "TRAILER!!!"
+
+/// @brief The header of an entry, each field is made of hexadecimal digits.
+typedef struct cpio_newc_header {
+    char c_magic[6];     ///< CPIO_NEWC_MAGIC, or CPIO_NEWC_CRC_MAGIC.
+    char c_ino[8];       ///< The inode.
+    char c_mode[8];      ///< The type and the permissions.
+    char c_uid[8];       ///< The owner.
+    char c_gid[8];       ///< The group.
+    char c_nlink[8];     ///< The number of links.
+    char c_mtime[8];     ///< The time of the last modification.
+    char c_filesize[8];  ///< The size of the content.
+    char c_devmajor[8];  ///< The major number of the device holding the file.
+    char c_devminor[8];  ///< The minor number of the device holding the file.
+    char c_rdevmajor[8]; ///< The major number of a device file.
+    char c_rdevminor[8]; ///< The minor number of a device file.
+    char c_namesize[8];  ///< The length of the name, terminator included.
+    char c_check[8];     ///< The checksum of the content, for CPIO_NEWC_CRC_MAGIC.
+} cpio_newc_header_t;
+
+/// @brief Parses a field of the header.
+/// @param field the field, eight hexadecimal digits.
+/// @param value the output variable where we store the value.
+/// @return 0 on success, -1 if the field is malformed.
+static inline int __cpio_field(const char *field, uint32_t *value)
+{
+    *value = 0;
+    for (int i = 0; i < 8; ++i) {
+        char c = field[i];
+        if ((c >= '0') && (c <= '9')) {
+            *value = (*value << 4) | (c - '0');
+        } else if ((c >= 'a') && (c <= 'f')) {
+            *value = (*value << 4) | (c - 'a' + 10);
+        } else if ((c >= 'A') && (c <= 'F')) {
+            *value = (*value << 4) | (c - 'A' + 10);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Checks if the data starts like an archive in the `newc` format.
+/// @param data the data.
+/// @param size the size of the data.
+/// @return 1 if it does, 0 otherwise.
+static inline int __cpio_is_newc(const char *data, size_t size)
+{
+    return (size >= sizeof(cpio_newc_header_t)) &&
+           (!strncmp(data, CPIO_NEWC_MAGIC, 6) || !strncmp(data, CPIO_NEWC_CRC_MAGIC, 6));
+}
+
+/// @brief Creates a regular file, with the given content.
+/// @param path the absolute path of the file.
+/// @param mode the permissions of the file.
+/// @param data the content.
+/// @param size the size of the content.
+/// @return 0 on success, -errno on failure.
+static int __initramfs_create_file(const char *path, mode_t mode, const char *data, size_t size)
+{
+    vfs_file_t *file = vfs_open(path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (file == NULL) {
+        return -errno;
+    }
+    ssize_t written = size ? vfs_write(file, data, 0, size) : 0;
+    vfs_close(file);
+    if (written < 0) {
+        return written;
+    }
+    return (written == size) ? 0 : -ENOSPC;
+}
+
+multiboot_module_t *initramfs_find(void)
+{
+    for (int i = 0; (i < MAX_MODULES) && modules[i].mod_start; ++i) {
+        if (__cpio_is_newc((const char *)modules[i].mod_start, modules[i].mod_end - modules[i].mod_start)) {
+            return &modules[i];
+        }
+    }
+    return NULL;
+}
+
+int initramfs_unpack(multiboot_module_t *module, const char *root)
+{
+    const char *start = (const char *)module->mod_start;
+    const char *end   = (const char *)module->mod_end;
+    const char *entry = start;
+    char path[PATH_MAX];
+    uint32_t mode, filesize, namesize;
+    unsigned files = 0;
+    while (1) {
+        if (!__cpio_is_newc(entry, end - entry)) {
+            pr_err("Malformed entry at offset %u, the archive is truncated.\n", entry - start);
+            return -EINVAL;
+        }
+        const cpio_newc_header_t *header = (const cpio_newc_header_t *)entry;
+        if (__cpio_field(header->c_mode, &mode) || __cpio_field(header->c_filesize, &filesize) ||
+            __cpio_field(header->c_namesize, &namesize) || (namesize == 0)) {
+            pr_err("Malformed header at offset %u.\n", entry - start);
+            return -EINVAL;
+        }
+        // The name, and the content, both start on a multiple of four bytes.
+        const char *name = entry + sizeof(cpio_newc_header_t);
+        const char *data = start + (((name + namesize - start) + 3) & ~3U);
+        if ((data > end) || (data + filesize > end) || name[namesize - 1]) {
+            pr_err("The entry at offset %u goes past the end of the archive.\n", entry - start);
+            return -EINVAL;
+        }
+        entry = start + (((data + filesize - start) + 3) & ~3U);
+        if (!strcmp(name, CPIO_TRAILER)) {
+            break;
+        }
+        // The names are relative to the root of the archive, usually `./`.
+        while ((name[0] == '.') && (name[1] == '/')) {
+            name += 2;
+        }
+        while (name[0] == '/') {
+            ++name;
+        }
+        if ((name[0] == '\0') || !strcmp(name, ".")) {
+            continue;
+        }
+        if (snprintf(path, PATH_MAX, "%s%s%s", root, strcmp(root, "/") ? "/" : "", name) >= PATH_MAX) {
+            pr_err("The path of `%s` is too long.\n", name);
+            return -ENAMETOOLONG;
+        }
+        int ret = 0;
+        if (S_ISDIR(mode)) {
+            // The directory can also be the mount point of another filesystem.
+            ret = vfs_mkdir(path, mode & 07777);
+            if (ret == -EEXIST) {
+                ret = 0;
+            }
+        } else if (S_ISREG(mode)) {
+            ret = __initramfs_create_file(path, mode & 07777, data, filesize);
+        } else if (S_ISLNK(mode)) {
+            char target[PATH_MAX];
+            if (filesize >= PATH_MAX) {
+                return -ENAMETOOLONG;
+            }
+            memcpy(target, data, filesize);
+            target[filesize] = '\0';
+            if (vfs_symlink(target, path) < 0) {
+                pr_warning("Skipping the symbolic link `%s`, which is not supported.\n", path);
+            }
+            continue;
+        } else {
+            pr_warning("Skipping `%s`, with unsupported type 0x%x.\n", path, mode & S_IFMT);
+            continue;
+        }
+        if (ret < 0) {
+            pr_err("Failed to create `%s`: %s\n", path, strerror(-ret));
+            return ret;
+        }
+        ++files;
+    }
+    pr_notice("Unpacked %u entries (%u bytes) inside `%s`.\n", files, end - start, root);
+    return 0;
+}
@@ -0,0 +1,285 @@
+/// @file io_uring.c
+/// @brief Batched submission of system calls, through rings shared with the process.
+/// @details
+/// The rings live inside the memory of the process, which is checked to be
+/// still mapped, and writable, every time they are entered. The entries run
+/// one after the other, inside io_uring_enter(), through the same functions
+/// as the system calls: a batch costs a single entry into the kernel, and a
+/// single pass through the scheduler on the way out. The completion queue
+/// has twice the entries of the submission queue, and the submissions stop
+/// while it is full, so no completion is ever lost.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[IOURNG]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "sys/io_uring.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/vfs.h"
+#include "klib/stdatomic.h"
+#include "limits.h"
+#include "mem/alloc/slab.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/vm_area.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "system/syscall.h"
+#include "time.h"
+
+/// @brief A ring.
+typedef struct io_ring_ctx {
+    /// The memory of the process which registered the rings.
+    mm_struct_t *mm;
+    /// The submission queue.
+    struct io_uring_sq *sq;
+    /// The completion queue.
+    struct io_uring_cq *cq;
+    /// The entries of the submission queue.
+    uint32_t sq_entries;
+    /// The entries of the completion queue.
+    uint32_t cq_entries;
+} io_ring_ctx_t;
+
+static int io_uring_file_close(vfs_file_t *file);
+static int io_uring_file_fstat(vfs_file_t *file, stat_t *stat);
+
+/// Ring file operations.
+static vfs_file_operations_t io_uring_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = io_uring_file_close,
+    .read_f     = NULL,
+    .write_f    = NULL,
+    .lseek_f    = NULL,
+    .stat_f     = io_uring_file_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = NULL,
+};
+
+/// @brief Closes a ring, freeing it with the last reference.
+/// @param file the file of the ring.
+/// @return 0 on success.
+static int io_uring_file_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        kfree(file->device);
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Retrieves the status of a ring.
+/// @param file the file of the ring.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int io_uring_file_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = 0600;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Checks that a queue lies inside a single writable area of the process.
+/// @param mm the memory of the process.
+/// @param queue the queue.
+/// @param size the size of the queue.
+/// @return 1 if it does, 0 otherwise.
+static inline int __io_uring_queue_valid(mm_struct_t *mm, void *queue, uint32_t size)
+{
+    uint32_t start = (uint32_t)queue;
+    if (!queue || (start & (sizeof(uint64_t) - 1)) || (start + size < start)) {
+        return 0;
+    }
+    vm_area_struct_t *area = vm_area_lookup(mm, start);
+    return area && (area->vm_start <= start) && ((start + size) <= area->vm_end) && (area->vm_page_prot & MM_RW);
+}
+
+/// @brief Returns the ring associated with a file descriptor.
+/// @param task the current task.
+/// @param fd the file descriptor.
+/// @param ctx where the ring is stored.
+/// @return 0 on success, -EBADF if the descriptor is not open, -EINVAL if it
+///         is not a ring, -EFAULT if its queues are no longer mapped.
+static inline int __io_uring_get(task_struct *task, int fd, io_ring_ctx_t **ctx)
+{
+    if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+        return -EBADF;
+    }
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
+    if (file->fs_operations != &io_uring_fs_operations) {
+        return -EINVAL;
+    }
+    io_ring_ctx_t *ring = (io_ring_ctx_t *)file->device;
+    // The queues belong to the memory of the process which registered them.
+    if ((ring->mm != task->mm) || !__io_uring_queue_valid(task->mm, ring->sq, IORING_SQ_SIZE(ring->sq_entries)) ||
+        !__io_uring_queue_valid(task->mm, ring->cq, IORING_CQ_SIZE(ring->cq_entries))) {
+        return -EFAULT;
+    }
+    *ctx = ring;
+    return 0;
+}
+
+/// @brief Runs an entry of the submission queue.
+/// @param sqe the entry, copied out of the queue.
+/// @return the result of the operation.
+static int __io_uring_issue(const struct io_uring_sqe *sqe)
+{
+    if (sqe->flags || sqe->reserved) {
+        return -EINVAL;
+    }
+    // The offsets beyond the 32 bits of the files do not exist.
+    if (((sqe->opcode == IORING_OP_READ) || (sqe->opcode == IORING_OP_WRITE)) &&
+        ((sqe->off < -1) || (sqe->off > LONG_MAX))) {
+        return -EINVAL;
+    }
+    switch (sqe->opcode) {
+    case IORING_OP_NOP:
+        return 0;
+    case IORING_OP_READ:
+        if (sqe->off == -1) {
+            return sys_read(sqe->fd, (void *)sqe->addr, sqe->len);
+        }
+        return sys_pread(sqe->fd, (void *)sqe->addr, sqe->len, (off_t)sqe->off);
+    case IORING_OP_WRITE:
+        if (sqe->off == -1) {
+            return sys_write(sqe->fd, (const void *)sqe->addr, sqe->len);
+        }
+        return sys_pwrite(sqe->fd, (const void *)sqe->addr, sqe->len, (off_t)sqe->off);
+    case IORING_OP_OPEN:
+        return sys_open((const char *)sqe->addr, (int)sqe->open_flags, (mode_t)sqe->len);
+    case IORING_OP_CLOSE:
+        return sys_close(sqe->fd);
+    case IORING_OP_FSYNC:
+        return sys_fsync(sqe->fd);
+    case IORING_OP_STAT:
+        return sys_stat((const char *)sqe->addr, (stat_t *)sqe->addr2);
+    default:
+        return -EINVAL;
+    }
+}
+
+int sys_io_uring_setup(unsigned int entries, struct io_uring_params *params)
+{
+    if (!entries || (entries > IORING_MAX_ENTRIES) || !params || params->flags) {
+        return -EINVAL;
+    }
+    task_struct *task = scheduler_get_current_process();
+    // The indices are masked, so the queues have a power of two entries.
+    uint32_t sq_entries = 1;
+    while (sq_entries < entries) {
+        sq_entries <<= 1U;
+    }
+    uint32_t cq_entries = 2U * sq_entries;
+    if (!__io_uring_queue_valid(task->mm, params->sq, IORING_SQ_SIZE(sq_entries)) ||
+        !__io_uring_queue_valid(task->mm, params->cq, IORING_CQ_SIZE(cq_entries))) {
+        return -EFAULT;
+    }
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    io_ring_ctx_t *ctx = kmalloc(sizeof(io_ring_ctx_t));
+    if (!ctx) {
+        return -ENOMEM;
+    }
+    ctx->mm         = task->mm;
+    ctx->sq         = params->sq;
+    ctx->cq         = params->cq;
+    ctx->sq_entries = sq_entries;
+    ctx->cq_entries = cq_entries;
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        kfree(ctx);
+        return -ENOMEM;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[io_uring]");
+    file->flags         = O_RDWR;
+    file->fs_operations = &io_uring_fs_operations;
+    file->device        = ctx;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    // Both queues start empty.
+    ctx->sq->head         = 0;
+    ctx->sq->tail         = 0;
+    ctx->sq->ring_mask    = sq_entries - 1U;
+    ctx->sq->ring_entries = sq_entries;
+    ctx->cq->head         = 0;
+    ctx->cq->tail         = 0;
+    ctx->cq->ring_mask    = cq_entries - 1U;
+    ctx->cq->ring_entries = cq_entries;
+    params->sq_entries    = sq_entries;
+    params->cq_entries    = cq_entries;
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+int sys_io_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    if (flags & ~IORING_ENTER_GETEVENTS) {
+        return -EINVAL;
+    }
+    task_struct *task = scheduler_get_current_process();
+    io_ring_ctx_t *ctx;
+    int ret = __io_uring_get(task, fd, &ctx);
+    if (ret < 0) {
+        return ret;
+    }
+    // An entry can close the ring itself, so nothing is read from it later.
+    struct io_uring_sq *sq = ctx->sq;
+    struct io_uring_cq *cq = ctx->cq;
+    uint32_t sq_mask       = ctx->sq_entries - 1U;
+    uint32_t cq_entries    = ctx->cq_entries;
+    // The process may have submitted fewer entries than it asked, but never
+    // more than fit inside the queue.
+    uint32_t head = sq->head, tail = sq->tail;
+    if ((tail - head) > ctx->sq_entries) {
+        return -EINVAL;
+    }
+    unsigned int submitted = 0;
+    while ((submitted < to_submit) && (head != tail)) {
+        // Stop while the completion queue is full, until the process reads it.
+        uint32_t cq_tail = cq->tail;
+        if ((cq_tail - cq->head) >= cq_entries) {
+            if (!submitted) {
+                return -EBUSY;
+            }
+            break;
+        }
+        // Copy the entry, the process could change it while it runs.
+        struct io_uring_sqe sqe = sq->sqes[head & sq_mask];
+        sq->head                = ++head;
+        int res                 = __io_uring_issue(&sqe);
+        // The completion is visible once the tail moves past it.
+        struct io_uring_cqe *cqe = &cq->cqes[cq_tail & (cq_entries - 1U)];
+        cqe->user_data           = sqe.user_data;
+        cqe->res                 = res;
+        cqe->flags               = 0;
+        barrier();
+        cq->tail = cq_tail + 1U;
+        ++submitted;
+    }
+    // The entries complete while they are submitted, so there is nothing
+    // left to wait for: the completions which are not there never come.
+    (void)min_complete;
+    return (int)submitted;
+}
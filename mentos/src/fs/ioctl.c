@@ -15,12 +15,12 @@ long sys_ioctl(int fd, unsigned int request, unsigned long data)
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
 
     // Verify that the file exists.
     vfs_file_t *file = vfd->file_struct;
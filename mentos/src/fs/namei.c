@@ -38,6 +38,8 @@ int sys_unlink(const char *path) { return vfs_unlink(path); }
 
 int sys_mkdir(const char *path, mode_t mode) { return vfs_mkdir(path, mode); }
 
+int sys_mknod(const char *path, mode_t mode, dev_t dev) { return vfs_mknod(path, mode, dev); }
+
 int sys_rmdir(const char *path) { return vfs_rmdir(path); }
 
 int sys_creat(const char *path, mode_t mode)
@@ -58,8 +60,7 @@ int sys_creat(const char *path, mode_t mode)
     }
 
     // Set the file descriptor id.
-    task->fd_list[fd].file_struct = file;
-    task->fd_list[fd].flags_mask  = O_WRONLY | O_CREAT | O_TRUNC;
+    fd_install(task, fd, file, O_WRONLY | O_CREAT | O_TRUNC);
 
     // Return the file descriptor and increment it.
     return fd;
@@ -186,14 +187,16 @@ int __resolve_path(const char *path, char *abspath, size_t buflen, int flags, in
                     }
                     linklen = strlen(linkpath);
 
+                    // Copy the terminator as well, the link can be shorter
+                    // than the component it replaces.
                     if (linkpath[0] == '/') {
-                        memcpy(buffer, linkpath, linklen);
+                        memcpy(buffer, linkpath, linklen + 1);
                         pr_debug("|%-32s|%-32s| (REPLACE)\n", path, buffer);
                     } else {
                         // Find the last occurrence of '/'.
                         char *last_slash = strrchr(buffer, '/');
                         if (last_slash) {
-                            memcpy(++last_slash, linkpath, linklen);
+                            memcpy(++last_slash, linkpath, linklen + 1);
                             pr_debug("|%-32s|%-32s|%-32s| (LINK)\n", path, buffer, linkpath);
                         }
                     }
@@ -5,6 +5,7 @@
 
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/poll.h"
 #include "fs/vfs.h"
 #include "io/debug.h"
 #include "limits.h"
@@ -32,45 +33,66 @@ int sys_open(const char *pathname, int flags, mode_t mode)
         return -errno;
     }
 
-    // Set the file descriptor id.
-    task->fd_list[fd].file_struct = file;
+    // Set the file descriptor id, and the flags.
+    fd_install(task, fd, file, flags);
 
     if (!bitmask_check(flags, O_APPEND)) {
         // Reset the offset.
-        task->fd_list[fd].file_struct->f_pos = 0;
+        task->files->fd_list[fd].file_struct->f_pos = 0;
     } else {
         stat_t stat;
         // Stat the file.
         file->fs_operations->stat_f(file, &stat);
         // Point at the last character
-        task->fd_list[fd].file_struct->f_pos = stat.st_size;
+        task->files->fd_list[fd].file_struct->f_pos = stat.st_size;
     }
 
-    // Set the flags.
-    task->fd_list[fd].flags_mask = flags;
-
     // Return the file descriptor and increment it.
     return fd;
 }
 
+int sys_openat(int dirfd, const char *pathname, int flags, mode_t mode)
+{
+    // Absolute paths, and paths relative to the working directory, are opened as usual.
+    if ((dirfd == AT_FDCWD) || (pathname[0] == '/')) {
+        return sys_open(pathname, flags, mode);
+    }
+    // Get the current task.
+    task_struct *task = scheduler_get_current_process();
+    // Check the directory FD.
+    if ((dirfd < 0) || (dirfd >= task->files->max_fd) || (task->files->fd_list[dirfd].file_struct == NULL)) {
+        return -EBADF;
+    }
+    // Place the path inside the directory.
+    char absolute_path[PATH_MAX];
+    int ret = vfs_path_at(task->files->fd_list[dirfd].file_struct, pathname, absolute_path, PATH_MAX);
+    if (ret < 0) {
+        return ret;
+    }
+    return sys_open(absolute_path, flags, mode);
+}
+
 int sys_close(int fd)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
     // Get the file.
-    vfs_file_t *file = task->fd_list[fd].file_struct;
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
     if (file == NULL) {
         return -1;
     }
 
     // Remove the reference to the file.
-    task->fd_list[fd].file_struct = NULL;
+    fd_release(task, fd);
+
+    // Stop waiting on the file, since closing it might free its wait queues.
+    poll_table_release(task);
 
     // Call the close function.
     return vfs_close(file);
@@ -18,11 +18,15 @@
 
 #include "fs/pipe.h"
 
+#include "klib/stdatomic.h"
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/poll.h"
 #include "fs/vfs.h"
+#include "limits.h"
 #include "list_head.h"
+#include "mem/alloc/zone_allocator.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "stdlib.h"
@@ -50,9 +54,12 @@ static int pipe_unlink(const char *path);
 static int pipe_close(vfs_file_t *file);
 static ssize_t pipe_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
 static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static ssize_t pipe_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
+static ssize_t pipe_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset);
 static off_t pipe_lseek(vfs_file_t *file, off_t offset, int whence);
 static int pipe_fstat(vfs_file_t *file, stat_t *stat);
 static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long data);
+static unsigned int pipe_poll(vfs_file_t *file, poll_table_t *table);
 
 /// @brief Operations for managing pipe buffers in the kernel.
 static struct pipe_buf_operations anonymous_pipe_ops = {
@@ -96,18 +103,23 @@ static vfs_file_operations_t pipe_fs_operations = {
     .fcntl_f    = pipe_fcntl,
     .getdents_f = NULL,
     .readlink_f = NULL,
+    .readv_f    = pipe_readv,
+    .writev_f   = pipe_writev,
+    .poll_f     = pipe_poll,
 };
 
-// static list_head named_pipes;
+/// @brief The list of opened named pipes, the pipe of a named pipe exists
+/// only while one of its ends is open.
+static list_head_t named_pipes = { .prev = &named_pipes, .next = &named_pipes };
 
 // ============================================================================
 // MEMORY MANAGEMENT (Private)
 // ============================================================================
 
-/// @brief Initializes a pipe buffer.
+/// @brief Initializes a pipe buffer, its page is allocated on the first write.
 /// @param pipe_buffer Pointer to the `pipe_buffer_t` structure to initialize.
 /// @param ops Pointer to the `pipe_buf_operations` structure defining buffer operations.
-/// @return 0 on success, -ENOMEM if page allocation fails.
+/// @return 0 on success.
 static inline int __pipe_buffer_init(pipe_buffer_t *pipe_buffer, struct pipe_buf_operations *ops)
 {
     // Check if we received a valid pipe buffer.
@@ -117,13 +129,54 @@ static inline int __pipe_buffer_init(pipe_buffer_t *pipe_buffer, struct pipe_buf
     memset(pipe_buffer, 0, sizeof(pipe_buffer_t));
 
     // Initialize additional fields in the pipe_buffer_t structure.
+    pipe_buffer->page   = NULL;
+    pipe_buffer->data   = NULL;
     pipe_buffer->len    = 0;
     pipe_buffer->offset = 0;
+    pipe_buffer->flags  = 0;
     pipe_buffer->ops    = ops;
 
     return 0;
 }
 
+/// @brief Drops the reference of a pipe buffer to its page, which is freed
+/// once no other pipe shares it.
+/// @param pipe_buffer Pointer to the `pipe_buffer_t` structure.
+static inline void __pipe_buffer_put_page(pipe_buffer_t *pipe_buffer)
+{
+    if (pipe_buffer->page) {
+        if (page_count(pipe_buffer->page) > 1) {
+            page_dec(pipe_buffer->page);
+        } else {
+            free_pages(pipe_buffer->page);
+        }
+    }
+    pipe_buffer->page = NULL;
+    pipe_buffer->data = NULL;
+}
+
+/// @brief Allocates the page of a pipe buffer, if it does not have one yet,
+/// or if its page is still shared with another pipe.
+/// @param pipe_buffer Pointer to the `pipe_buffer_t` structure.
+/// @return 0 on success, -ENOMEM if page allocation fails.
+static inline int __pipe_buffer_get_page(pipe_buffer_t *pipe_buffer)
+{
+    if (pipe_buffer->page) {
+        if (page_count(pipe_buffer->page) == 1) {
+            return 0;
+        }
+        // Another pipe still reads from the page, we cannot overwrite it.
+        __pipe_buffer_put_page(pipe_buffer);
+    }
+    pipe_buffer->page = alloc_pages(GFP_KERNEL, 0);
+    if (!pipe_buffer->page) {
+        pr_err("Failed to allocate the page of a pipe buffer.\n");
+        return -ENOMEM;
+    }
+    pipe_buffer->data = (char *)get_virtual_address_from_page(pipe_buffer->page);
+    return 0;
+}
+
 /// @brief De-initializes a pipe buffer.
 /// @param pipe_buffer Pointer to the `pipe_buffer_t` structure to deinitialize.
 /// This should not be NULL.
@@ -132,9 +185,13 @@ static inline void __pipe_buffer_deinit(pipe_buffer_t *pipe_buffer)
     // Check if we received a valid pipe buffer.
     assert(pipe_buffer && "Received a null pipe buffer.");
 
+    // Release the page, if it has been allocated.
+    __pipe_buffer_put_page(pipe_buffer);
+
     // Reset other fields for safety.
     pipe_buffer->len    = 0;
     pipe_buffer->offset = 0;
+    pipe_buffer->flags  = 0;
     pipe_buffer->ops    = NULL;
 }
 
@@ -159,10 +216,19 @@ static inline pipe_inode_info_t *__pipe_inode_info_alloc(struct pipe_buf_operati
     wait_queue_head_init(&pipe_info->write_wait);
 
     // Initialize the mutex.
-    mutex_unlock(&pipe_info->mutex);
+    mutex_init(&pipe_info->mutex);
+
+    // Initialize the list node, named pipes are added to the list of named pipes.
+    list_head_init(&pipe_info->list_node);
 
-    // Set the number of buffers.
-    pipe_info->numbuf = PIPE_NUM_BUFFERS;
+    // Allocate the buffers.
+    pipe_info->numbuf = PIPE_DEF_BUFFERS;
+    pipe_info->bufs   = (pipe_buffer_t *)kmalloc(sizeof(pipe_buffer_t) * pipe_info->numbuf);
+    if (!pipe_info->bufs) {
+        pr_err("Failed to allocate memory for the pipe buffers.\n");
+        kfree(pipe_info);
+        return NULL;
+    }
 
     // Initialize each buffer in the buffer array.
     for (unsigned int i = 0; i < pipe_info->numbuf; ++i) {
@@ -173,16 +239,17 @@ static inline pipe_inode_info_t *__pipe_inode_info_alloc(struct pipe_buf_operati
             while (i > 0) {
                 __pipe_buffer_deinit(&pipe_info->bufs[--i]);
             }
+            kfree(pipe_info->bufs);
             kfree(pipe_info);
             return NULL;
         }
     }
 
     // Initialize remaining fields.
-    pipe_info->read_index  = 0;
-    pipe_info->write_index = 0;
-    pipe_info->readers     = 0;
-    pipe_info->writers     = 0;
+    pipe_info->head    = 0;
+    pipe_info->tail    = 0;
+    pipe_info->readers = 0;
+    pipe_info->writers = 0;
 
     return pipe_info;
 }
@@ -201,6 +268,10 @@ static inline void __pipe_inode_info_dealloc(pipe_inode_info_t *pipe_info)
     for (unsigned int i = 0; i < pipe_info->numbuf; ++i) {
         __pipe_buffer_deinit(&pipe_info->bufs[i]);
     }
+    kfree(pipe_info->bufs);
+
+    // Remove the pipe from the list of named pipes, if it is there.
+    list_head_remove(&pipe_info->list_node);
 
     // Free the memory used by the pipe_inode_info_t structure itself.
     kfree(pipe_info);
@@ -210,15 +281,64 @@ static inline void __pipe_inode_info_dealloc(pipe_inode_info_t *pipe_info)
 // PIPE INFO AND BUFFER OPERATIONS (Private)
 // ============================================================================
 
-/// @brief Converts a linear index to the corresponding buffer index within the buffer limit.
-/// @param index The linear index.
-/// @return The buffer index within [0, PIPE_NUM_BUFFERS - 1].
-static inline size_t pipe_linear_to_buffer_index(size_t index) { return (index / PIPE_BUFFER_SIZE) % PIPE_NUM_BUFFERS; }
+/// @brief Checks if the specified pipe buffer is empty.
+/// @param pipe_buffer Pointer to the pipe buffer structure to check.
+/// @return 1 if the buffer is empty (length is 0), or 0 if not or if pipe_buffer is NULL.
+static int pipe_buffer_empty(pipe_buffer_t *pipe_buffer)
+{
+    // Validate input parameter.
+    if (!pipe_buffer) {
+        pr_err("pipe_buffer is NULL.\n");
+        return 0; // Return 0 as there's no buffer to check.
+    }
+
+    // Buffer is empty if all the data written into it has been read.
+    return pipe_buffer->offset == READ_ONCE(pipe_buffer->len);
+}
+
+/// @brief Retrieves the number of bytes available (unread) in the specified pipe buffer.
+/// @param pipe_buffer Pointer to the pipe buffer structure to check.
+/// @return The number of bytes available in the buffer, or 0 if pipe_buffer is NULL.
+static size_t pipe_buffer_available(pipe_buffer_t *pipe_buffer)
+{
+    // Validate input parameter.
+    if (!pipe_buffer) {
+        pr_err("pipe_buffer is NULL.\n");
+        return 0; // Return 0 as there’s no buffer to check.
+    }
+
+    // Return the data written into the buffer, which has not been read yet.
+    return READ_ONCE(pipe_buffer->len) - pipe_buffer->offset;
+}
+
+/// @brief Determines the remaining capacity for writing in the specified pipe buffer.
+/// @param pipe_buffer Pointer to the pipe buffer structure to check.
+/// @return The remaining write capacity in bytes, or 0 if pipe_buffer is NULL.
+static inline size_t pipe_buffer_capacity(pipe_buffer_t *pipe_buffer)
+{
+    // Validate input parameter.
+    if (!pipe_buffer) {
+        pr_err("pipe_buffer is NULL.\n");
+        return 0; // Return 0 as there's no buffer to check.
+    }
+
+    // A sealed buffer does not accept more data.
+    if (pipe_buffer->flags & PIPE_BUF_FLAG_SEALED) {
+        return 0;
+    }
 
-/// @brief Calculates the offset within the specified buffer from a linear index.
-/// @param index The linear index.
-/// @return The offset within the buffer.
-static inline size_t pipe_linear_to_offset(size_t index) { return index % PIPE_BUFFER_SIZE; }
+    // Calculate available capacity by subtracting the length from the total buffer size.
+    return PIPE_BUFFER_SIZE - READ_ONCE(pipe_buffer->len);
+}
+
+/// @brief Returns the buffer at the given index of the ring.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param index The index, which wraps around the number of buffers.
+/// @return Pointer to the buffer.
+static inline pipe_buffer_t *pipe_info_buffer(pipe_inode_info_t *pipe_info, size_t index)
+{
+    return &pipe_info->bufs[index & (pipe_info->numbuf - 1)];
+}
 
 /// @brief Checks if the specified pipe has any data available in its buffers.
 /// @param pipe_info Pointer to the pipe information structure.
@@ -231,15 +351,11 @@ static inline int pipe_info_has_data(pipe_inode_info_t *pipe_info)
         return -EINVAL;
     }
 
-    // Check if data is available in at least one buffer.
-    for (unsigned int i = 0; i < pipe_info->numbuf; i++) {
-        if (pipe_info->bufs[i].len > 0) {
-            return 1;
-        }
-    }
-
-    // No data available in any buffer.
-    return 0;
+    size_t tail = pipe_info->tail;
+    size_t head = READ_ONCE(pipe_info->head);
+    // Only the last buffer in use can be drained, the others are retired as
+    // soon as they have been filled and drained.
+    return (head != tail) && (((head - tail) > 1) || !pipe_buffer_empty(pipe_info_buffer(pipe_info, tail)));
 }
 
 /// @brief Checks if the specified pipe has available space in any of its buffers.
@@ -253,60 +369,81 @@ static inline int pipe_info_has_space(pipe_inode_info_t *pipe_info)
         return -EINVAL;
     }
 
-    // Check if at least one buffer has available space.
-    for (unsigned int i = 0; i < pipe_info->numbuf; i++) {
-        if (pipe_info->bufs[i].len < PIPE_BUFFER_SIZE) {
-            return 1;
-        }
+    size_t head = pipe_info->head;
+    size_t tail = READ_ONCE(pipe_info->tail);
+
+    // Check if there is a free buffer.
+    if ((head - tail) < pipe_info->numbuf) {
+        return 1;
     }
 
-    // No space available in any buffer.
-    return 0;
+    // Check if the last buffer in use has some space left.
+    return pipe_buffer_capacity(pipe_info_buffer(pipe_info, head - 1)) > 0;
 }
 
-/// @brief Checks if the specified pipe buffer is empty.
-/// @param pipe_buffer Pointer to the pipe buffer structure to check.
-/// @return 1 if the buffer is empty (length is 0), or 0 if not or if pipe_buffer is NULL.
-static int pipe_buffer_empty(pipe_buffer_t *pipe_buffer)
+/// @brief Computes the number of bytes which can be written into the pipe.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @return The free space, as the free buffers plus what is left inside the last buffer in use.
+static inline size_t pipe_info_free_space(pipe_inode_info_t *pipe_info)
 {
-    // Validate input parameter.
-    if (!pipe_buffer) {
-        pr_err("pipe_buffer is NULL.\n");
-        return 0; // Return 0 as there's no buffer to check.
+    size_t head  = pipe_info->head;
+    size_t tail  = READ_ONCE(pipe_info->tail);
+    size_t space = (pipe_info->numbuf - (head - tail)) * PIPE_BUFFER_SIZE;
+    if (head != tail) {
+        space += pipe_buffer_capacity(pipe_info_buffer(pipe_info, head - 1));
     }
-
-    // Buffer is empty if len is 0.
-    return pipe_buffer->len == 0;
+    return space;
 }
 
-/// @brief Retrieves the number of bytes available (unread) in the specified pipe buffer.
-/// @param pipe_buffer Pointer to the pipe buffer structure to check.
-/// @return The number of bytes available in the buffer, or 0 if pipe_buffer is NULL.
-static size_t pipe_buffer_available(pipe_buffer_t *pipe_buffer)
+/// @brief Returns the buffer where the data written into the pipe goes, namely
+/// the last one in use, or the next free one once it is full.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param pipe_buffer Where the buffer is stored.
+/// @return 0 on success, -EAGAIN if the pipe is full, -ENOMEM if the page of
+/// the buffer cannot be allocated.
+static inline int pipe_info_get_write_buffer(pipe_inode_info_t *pipe_info, pipe_buffer_t **pipe_buffer)
 {
-    // Validate input parameter.
-    if (!pipe_buffer) {
-        pr_err("pipe_buffer is NULL.\n");
-        return 0; // Return 0 as there’s no buffer to check.
+    size_t head = pipe_info->head;
+    size_t tail = READ_ONCE(pipe_info->tail);
+    // Append to the last buffer in use, if it has some space left.
+    if (head != tail) {
+        *pipe_buffer = pipe_info_buffer(pipe_info, head - 1);
+        if (pipe_buffer_capacity(*pipe_buffer) > 0) {
+            return 0;
+        }
     }
-
-    // Return the current length of the buffer, representing unread data.
-    return pipe_buffer->len;
+    // Otherwise, move to the next free buffer.
+    if ((head - tail) == pipe_info->numbuf) {
+        return -EAGAIN;
+    }
+    *pipe_buffer = pipe_info_buffer(pipe_info, head);
+    int ret      = __pipe_buffer_get_page(*pipe_buffer);
+    if (ret < 0) {
+        return ret;
+    }
+    (*pipe_buffer)->offset = 0;
+    (*pipe_buffer)->len    = 0;
+    (*pipe_buffer)->flags  = 0;
+    // Hand the empty buffer to the reader, the data is published through its length.
+    barrier();
+    WRITE_ONCE(pipe_info->head, head + 1);
+    return 0;
 }
 
-/// @brief Determines the remaining capacity for writing in the specified pipe buffer.
-/// @param pipe_buffer Pointer to the pipe buffer structure to check.
-/// @return The remaining write capacity in bytes, or 0 if pipe_buffer is NULL.
-static inline size_t pipe_buffer_capacity(pipe_buffer_t *pipe_buffer)
+/// @brief Hands the first buffer in use back to the writer, once it has been
+/// drained, and nothing else can be written into it.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param pipe_buffer The first buffer in use.
+/// @param tail The ring index of the buffer.
+/// @return 1 if the buffer has been retired, 0 otherwise.
+static inline int pipe_info_retire_buffer(pipe_inode_info_t *pipe_info, pipe_buffer_t *pipe_buffer, size_t tail)
 {
-    // Validate input parameter.
-    if (!pipe_buffer) {
-        pr_err("pipe_buffer is NULL.\n");
-        return 0; // Return 0 as there's no buffer to check.
+    if (!pipe_buffer_empty(pipe_buffer) || (pipe_buffer_capacity(pipe_buffer) > 0)) {
+        return 0;
     }
-
-    // Calculate available capacity by subtracting the offset + length from the total buffer size.
-    return PIPE_BUFFER_SIZE - (pipe_buffer->offset + pipe_buffer->len);
+    barrier();
+    WRITE_ONCE(pipe_info->tail, tail + 1);
+    return 1;
 }
 
 /// @brief Determines the number of bytes that can be read from the pipe buffer.
@@ -332,7 +469,8 @@ static ssize_t pipe_calculate_bytes_to_read(pipe_buffer_t *pipe_buffer, size_t c
     }
 
     // Return the number of bytes to read based on the requested count and available data.
-    return (count < pipe_buffer->len) ? count : pipe_buffer->len;
+    size_t available = pipe_buffer_available(pipe_buffer);
+    return (count < available) ? count : available;
 }
 
 /// @brief Determines the number of bytes that can be safely written to the pipe buffer.
@@ -374,7 +512,7 @@ static int pipe_buffer_confirm(pipe_buffer_t *pipe_buffer)
     }
 
     // Ensure length and offset are within valid bounds.
-    if ((pipe_buffer->len + pipe_buffer->offset) > PIPE_BUFFER_SIZE) {
+    if ((pipe_buffer->len > PIPE_BUFFER_SIZE) || (pipe_buffer->offset > pipe_buffer->len)) {
         pr_err(
             "Buffer length and offset exceed bounds: len = %u, offset = %u, "
             "PIPE_BUFFER_SIZE = %lu.\n",
@@ -414,17 +552,14 @@ static ssize_t pipe_buffer_read(pipe_buffer_t *pipe_buffer, char *dest, size_t c
         return bytes_to_read;
     }
 
+    // The length has been read first, and the data must not be read before it.
+    barrier();
+
     // Copy data from the pipe buffer's data at the specified offset.
     memcpy(dest, pipe_buffer->data + pipe_buffer->offset, bytes_to_read);
 
-    // Adjust buffer's offset and length to reflect the data consumption.
+    // Adjust buffer's offset to reflect the data consumption.
     pipe_buffer->offset += bytes_to_read;
-    pipe_buffer->len -= bytes_to_read;
-
-    // If all data has been read, reset offset to 0 for reusability.
-    if (pipe_buffer->len == 0) {
-        pipe_buffer->offset = 0;
-    }
 
     pr_debug(
         "Read %3ld bytes from buffer (offset: %3u, length: %3u).\n", bytes_to_read, pipe_buffer->offset,
@@ -460,11 +595,13 @@ static ssize_t pipe_buffer_write(pipe_buffer_t *pipe_buffer, const char *src, si
         return bytes_to_write;
     }
 
-    // Write data to the buffer's current write position (offset + length).
-    memcpy(pipe_buffer->data + pipe_buffer->offset + pipe_buffer->len, src, bytes_to_write);
+    // Write data to the buffer's current write position.
+    memcpy(pipe_buffer->data + pipe_buffer->len, src, bytes_to_write);
 
-    // Update the buffer's length to reflect the newly added data.
-    pipe_buffer->len += bytes_to_write;
+    // Update the buffer's length to reflect the newly added data, which
+    // publishes it to the reader once the data has been stored.
+    barrier();
+    WRITE_ONCE(pipe_buffer->len, pipe_buffer->len + bytes_to_write);
 
     pr_debug(
         "pipe_buffer_write: Wrote %3ld bytes to buffer (offset: %3u, length: "
@@ -478,129 +615,96 @@ static ssize_t pipe_buffer_write(pipe_buffer_t *pipe_buffer, const char *src, si
 // Wait Queue Functions
 // ============================================================================
 
-/// @brief Wake-up function for processes waiting to read from a pipe.
-/// @param wait Pointer to the wait queue entry representing the sleeping process.
-/// @param mode The mode to set the task to upon wake-up.
-/// @param sync Synchronization flag (not used in this implementation).
-/// @return 1 if the process is woken up, 0 if it remains in the wait queue.
-int pipe_read_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
+/// @brief Wakes up tasks in the specified wait queue. The tasks blocked on
+/// the pipe are exclusive waiters, while the tasks polling it are all woken up.
+/// @param wait_queue Pointer to the wait queue from which tasks should be woken up.
+/// @param nr_exclusive The number of blocked tasks to wake up, 0 for all of them.
+/// @param debug_msg Debug message describing the wake-up context.
+static void pipe_wake_up_tasks(wait_queue_head_t *wait_queue, unsigned int nr_exclusive, const char *debug_msg)
 {
-    // Retrieve private data associated with this wait queue entry.
-    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)wait->private;
-
-    // Check the private data.
-    if (pipe_info == NULL) {
-        pr_err("The private data is not a pipe_inode_info_t.\n");
-        return -1;
-    }
-
-    // Validate that data is available in the pipe for reading.
-    if ((pipe_info_has_data(pipe_info) > 0) || (pipe_info->writers == 0)) {
-        // Check if the task is in an appropriate sleep state to be woken up.
-        if ((wait->task->state == TASK_UNINTERRUPTIBLE) || (wait->task->state == TASK_STOPPED)) {
-            // Set the task's state to the specified wake-up mode.
-            wait->task->state = mode;
-
-            // Signal that the task has been woken up.
-            pr_debug("Data available or no more writers, waking up reader %d.\n", wait->task->pid);
-            return 1;
-        }
-        pr_debug("Reader %d not in the correct state for wake-up.\n", wait->task->pid);
-
-    } else {
-        pr_debug("No data available, reader %d should continue waiting.\n", wait->task->pid);
+    // Validate input parameters.
+    if (!wait_queue) {
+        pr_err("pipe_wake_up_tasks: wait_queue is NULL.\n");
+        return;
     }
 
-    // No wake-up action taken, continue waiting.
-    return 0;
+    pr_debug("%s: Waking up %u tasks (0 for all).\n", debug_msg, nr_exclusive);
+    wake_up_nr(wait_queue, nr_exclusive);
 }
 
-/// @brief Wake-up function for processes waiting to write to a pipe.
-/// @param wait Pointer to the wait queue entry representing the sleeping process.
-/// @param mode The mode to set the task to upon wake-up.
-/// @param sync Synchronization flag (not used in this implementation).
-/// @return 1 if the process is woken up, 0 if it remains in the wait queue.
-int pipe_write_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
+/// @brief Wakes up a single reader, if there is some data it can read. A
+/// reader which leaves data behind calls it again, passing the wake-up on.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param debug_msg Debug message describing the wake-up context.
+static inline void pipe_wake_up_reader(pipe_inode_info_t *pipe_info, const char *debug_msg)
 {
-    // Retrieve private data associated with this wait queue entry.
-    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)wait->private;
-
-    // Check the private data.
-    if (pipe_info == NULL) {
-        pr_err("The private data is not a pipe_inode_info_t.\n");
-        return -1;
-    }
-
-    // Check if there is available space in the pipe for writing.
-    if (pipe_info_has_space(pipe_info) > 0) {
-        // Only tasks in the state TASK_UNINTERRUPTIBLE or TASK_STOPPED can be woken up.
-        if ((wait->task->state == TASK_UNINTERRUPTIBLE) || (wait->task->state == TASK_STOPPED)) {
-            // Set the wake-up mode for the task.
-            wait->task->state = mode;
-
-            // Signal that the task has been woken up.
-            pr_debug("Space available, waking up writer %d.\n", wait->task->pid);
-            return 1;
-        }
-        pr_debug("Writer %d not in the correct state for wake-up.\n", wait->task->pid);
-
-    } else {
-        pr_debug("No space available, writer %d should continue waiting.\n", wait->task->pid);
+    if (pipe_info_has_data(pipe_info) > 0) {
+        pipe_wake_up_tasks(&pipe_info->read_wait, 1, debug_msg);
     }
-
-    // No wake-up action taken, continue waiting.
-    return 0;
 }
 
-/// @brief Wakes up tasks in the specified wait queue if their wake-up condition is met.
-/// @param wait_queue Pointer to the wait queue from which tasks should be woken up.
+/// @brief Wakes up a single writer, if there are at least PIPE_BUF free bytes.
+/// A writer which leaves room behind calls it again, passing the wake-up on.
+/// @param pipe_info Pointer to the pipe information structure.
 /// @param debug_msg Debug message describing the wake-up context.
-static void pipe_wake_up_tasks(wait_queue_head_t *wait_queue, const char *debug_msg)
+static inline void pipe_wake_up_writer(pipe_inode_info_t *pipe_info, const char *debug_msg)
 {
-    // Validate input parameters.
-    if (!wait_queue) {
-        pr_err("pipe_wake_up_tasks: wait_queue is NULL.\n");
-        return;
+    if (pipe_info_free_space(pipe_info) >= PIPE_BUF) {
+        pipe_wake_up_tasks(&pipe_info->write_wait, 1, debug_msg);
     }
+}
 
-    list_for_each_safe_decl(it, store, &wait_queue->task_list)
-    {
-        wait_queue_entry_t *wait_queue_entry = list_entry(it, wait_queue_entry_t, task_list);
+/// @brief Wakes up a reader and a writer, if they can make progress, once
+/// some data has been moved in or out of the pipe.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param debug_msg Debug message describing the wake-up context.
+static inline void pipe_wake_up(pipe_inode_info_t *pipe_info, const char *debug_msg)
+{
+    pipe_wake_up_reader(pipe_info, debug_msg);
+    pipe_wake_up_writer(pipe_info, debug_msg);
+}
 
-        // Run the wakeup test function for the waiting task.
-        if (wait_queue_entry->func(wait_queue_entry, TASK_RUNNING, 0)) {
-            // Task is ready, remove from the wait queue.
-            remove_wait_queue(wait_queue, wait_queue_entry);
+/// @brief Acquires one end of the pipe. The ring of buffers is safe with a
+/// single reader and a single writer, so the mutex is taken only when several
+/// processes share the end we are using.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param sharers The number of readers, or writers, of the end we are using.
+/// @return 1 if the mutex has been taken, 0 otherwise.
+static inline int pipe_lock(pipe_inode_info_t *pipe_info, size_t sharers)
+{
+    if (sharers <= 1) {
+        return 0;
+    }
+    mutex_lock(&pipe_info->mutex);
+    return 1;
+}
 
-            // Log and free the memory associated with the wait entry.
-            pr_debug("%s: Process %d woken up.\n", debug_msg, wait_queue_entry->task->pid);
-            wait_queue_entry_dealloc(wait_queue_entry);
-        }
+/// @brief Releases the end of the pipe acquired through pipe_lock().
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked The value returned by pipe_lock().
+static inline void pipe_unlock(pipe_inode_info_t *pipe_info, int locked)
+{
+    if (locked) {
+        mutex_unlock(&pipe_info->mutex);
     }
 }
 
-/// @brief Puts the current process to sleep on the specified wait queue if blocking is needed.
+/// @brief Puts the current process to sleep on the specified wait queue,
+/// releasing the pipe mutex while it sleeps.
 /// @param pipe_info Pointer to the pipe information structure.
 /// @param wait_queue Pointer to the wait queue on which to put the process to sleep.
-/// @param wake_function Wake-up function associated with the wait queue entry.
-/// @param debug_msg Debug message describing the block context.
-/// @return 0 after scheduling the blocking behavior.
-static int pipe_put_process_to_sleep(
-    pipe_inode_info_t *pipe_info,
-    wait_queue_head_t *wait_queue,
-    int (*wake_function)(wait_queue_entry_t *, unsigned, int),
-    const char *debug_msg)
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @return 0 once woken up, -EINTR if a signal interrupted the sleep.
+static int pipe_put_process_to_sleep(pipe_inode_info_t *pipe_info, wait_queue_head_t *wait_queue, int locked)
 {
-    // Blocking behavior: Put the process to sleep until the condition is met.
-    wait_queue_entry_t *wait_queue_entry = sleep_on(wait_queue);
-    assert(wait_queue_entry && "Failed to allocate wait_queue_entry_t.");
-
-    // Set the wake-up function and private data for the wait entry.
-    wait_queue_entry->func    = wake_function;
-    wait_queue_entry->private = pipe_info;
-
-    // Indicate blocking behavior was scheduled.
-    return 0;
+    // Let the other processes access the pipe, while we sleep. We are woken
+    // up one at a time, so that only the tasks which can make progress run.
+    pipe_unlock(pipe_info, locked);
+    int ret = interruptible_sleep_on_exclusive(wait_queue);
+    if (locked) {
+        mutex_lock(&pipe_info->mutex);
+    }
+    return ret;
 }
 
 // ============================================================================
@@ -624,6 +728,96 @@ static inline int pipe_is_blocking(vfs_file_t *file)
     return (file->flags & O_NONBLOCK) == 0;
 }
 
+/// @brief Waits until there is data to read from the pipe, or there are no
+/// writers left.
+/// @param file Pointer to the vfs_file_t structure representing the pipe file.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @return 0 if the pipe can be read, -EAGAIN if it is empty and in
+/// non-blocking mode, -EINTR if a signal interrupted the wait.
+static int pipe_wait_for_data(vfs_file_t *file, pipe_inode_info_t *pipe_info, int locked)
+{
+    while (!pipe_info_has_data(pipe_info) && (pipe_info->writers > 0)) {
+        if (!pipe_is_blocking(file)) {
+            return -EAGAIN;
+        }
+        int ret = pipe_put_process_to_sleep(pipe_info, &pipe_info->read_wait, locked);
+        if (ret < 0) {
+            // We might have been woken up for some data, leave it to another reader.
+            pipe_wake_up_reader(pipe_info, "pipe_wait_for_data");
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/// @brief Waits until there is space to write into the pipe.
+/// @param file Pointer to the vfs_file_t structure representing the pipe file.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @return 0 if the pipe can be written, -EAGAIN if it is full and in
+/// non-blocking mode, -EPIPE if there are no readers left, -EINTR if a
+/// signal interrupted the wait.
+static int pipe_wait_for_space(vfs_file_t *file, pipe_inode_info_t *pipe_info, int locked)
+{
+    while (!pipe_info_has_space(pipe_info)) {
+        // Nobody is going to make room inside the pipe.
+        if (pipe_info->readers == 0) {
+            return -EPIPE;
+        }
+        if (!pipe_is_blocking(file)) {
+            return -EAGAIN;
+        }
+        int ret = pipe_put_process_to_sleep(pipe_info, &pipe_info->write_wait, locked);
+        if (ret < 0) {
+            // We might have been woken up for some room, leave it to another writer.
+            pipe_wake_up_writer(pipe_info, "pipe_wait_for_space");
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/// @brief Waits until there is data to read from the pipe, as
+/// pipe_wait_for_data() does, unless the splice flags ask not to block.
+/// @param file Pointer to the vfs_file_t structure representing the pipe file.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @param flags The splice flags, with SPLICE_F_NONBLOCK we do not wait.
+/// @return 0 if the pipe can be read, -EAGAIN if it is empty and we cannot
+/// block, -EINTR if a signal interrupted the wait.
+static int pipe_splice_wait_for_data(
+    vfs_file_t *file,
+    pipe_inode_info_t *pipe_info,
+    int locked,
+    unsigned int flags)
+{
+    if ((flags & SPLICE_F_NONBLOCK) && !pipe_info_has_data(pipe_info) && (pipe_info->writers > 0)) {
+        return -EAGAIN;
+    }
+    return pipe_wait_for_data(file, pipe_info, locked);
+}
+
+/// @brief Waits until there is space to write into the pipe, as
+/// pipe_wait_for_space() does, unless the splice flags ask not to block.
+/// @param file Pointer to the vfs_file_t structure representing the pipe file.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @param flags The splice flags, with SPLICE_F_NONBLOCK we do not wait.
+/// @return 0 if the pipe can be written, -EAGAIN if it is full and we cannot
+/// block, -EPIPE if there are no readers left, -EINTR if a signal interrupted the wait.
+static int pipe_splice_wait_for_space(
+    vfs_file_t *file,
+    pipe_inode_info_t *pipe_info,
+    int locked,
+    unsigned int flags)
+{
+    if ((flags & SPLICE_F_NONBLOCK) && !pipe_info_has_space(pipe_info)) {
+        return (pipe_info->readers == 0) ? -EPIPE : -EAGAIN;
+    }
+    return pipe_wait_for_space(file, pipe_info, locked);
+}
+
 /// @brief Creates a VFS file structure for a pipe.
 /// @param path Path to the file (not used here but may be needed elsewhere).
 /// @param flags Open flags (e.g., O_RDONLY, O_WRONLY).
@@ -720,9 +914,9 @@ static vfs_file_t *pipe_open(const char *path, int flags, mode_t mode)
     assert(task && "Failed to retrieve current task.");
 
     // Iterate through the file descriptors in the task
-    for (int fd = 0; fd < task->max_fd; fd++) {
+    for (int fd = 0; fd < task->files->max_fd; fd++) {
         // Get the file.
-        vfs_file_t *file = task->fd_list[fd].file_struct;
+        vfs_file_t *file = task->files->fd_list[fd].file_struct;
         // Check if the file descriptor is associated with a pipe.
         if (file && S_ISFIFO(file->flags) && (strcmp(file->name, path) == 0)) {
             // Check if the requested flags match existing file access mode.
@@ -794,9 +988,9 @@ static int pipe_unlink(const char *path)
     assert(task && "Failed to retrieve current task.");
 
     // Iterate through the file descriptors in the task
-    for (int fd = 0; fd < task->max_fd; fd++) {
+    for (int fd = 0; fd < task->files->max_fd; fd++) {
         // Get the file.
-        vfs_file_t *file = task->fd_list[fd].file_struct;
+        vfs_file_t *file = task->files->fd_list[fd].file_struct;
 
         // Check if the file name matches the specified path.
         if (file && strcmp(file->name, path) == 0) {
@@ -863,6 +1057,14 @@ static int pipe_close(vfs_file_t *file)
         } else {
             pr_warning("Readers count is already zero.\n");
         }
+    } else if ((file->flags & O_ACCMODE) == O_RDWR) {
+        // A named pipe opened for both reading and writing.
+        if ((pipe_info->readers > 0) && (pipe_info->writers > 0)) {
+            pipe_info->readers--;
+            pipe_info->writers--;
+        } else {
+            pr_warning("Readers or writers count is already zero.\n");
+        }
     } else {
         pr_warning("Unknown pipe file access mode, possibly incorrect flags.\n");
     }
@@ -870,7 +1072,12 @@ static int pipe_close(vfs_file_t *file)
     // If all writers have closed, wake up waiting readers.
     if (pipe_info->writers == 0) {
         pr_debug("All writers have closed the pipe. Waking up readers.\n");
-        pipe_wake_up_tasks(&pipe_info->read_wait, "pipe_close");
+        pipe_wake_up_tasks(&pipe_info->read_wait, 0, "pipe_close");
+    }
+
+    // If all readers have closed, wake up the writers which are polling the pipe.
+    if (pipe_info->readers == 0) {
+        pipe_wake_up_tasks(&pipe_info->write_wait, 0, "pipe_close");
     }
 
     // If both readers and writers are zero, free the pipe resources.
@@ -893,6 +1100,61 @@ static int pipe_close(vfs_file_t *file)
     return 0;
 }
 
+/// @brief Copies data out of the pipe buffers, whose read end must have been
+/// acquired through pipe_lock().
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param buffer Buffer where the data will be stored.
+/// @param nbyte Maximum number of bytes to read.
+/// @return Number of bytes read, which is less than `nbyte` when the pipe runs out of data, or a negative error code.
+static ssize_t __pipe_read_locked(pipe_inode_info_t *pipe_info, char *buffer, size_t nbyte)
+{
+    ssize_t bytes_read = 0;
+    // Loop to read data from the pipe until requested bytes are read, or the pipe runs out of data.
+    while (bytes_read < nbyte) {
+        size_t tail = pipe_info->tail;
+        if (tail == READ_ONCE(pipe_info->head)) {
+            break;
+        }
+        // The buffer must not be read before the writer hands it to us.
+        barrier();
+
+        // Read from the first buffer in use.
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(pipe_info, tail);
+
+        // Confirm that the buffer is ready to be read.
+        if (pipe_buffer_confirm(pipe_buffer) < 0) {
+            pr_err("Failed to confirm readiness of buffer %u for reading.\n", tail);
+            break; // Stop if there’s no data to read.
+        }
+
+        // The last buffer in use might have been drained, while it is still
+        // being written, or sealed once we drained it.
+        if (pipe_buffer_empty(pipe_buffer)) {
+            if (pipe_info_retire_buffer(pipe_info, pipe_buffer, tail)) {
+                continue;
+            }
+            break;
+        }
+
+        // Calculate bytes to read in this iteration, considering the remaining requested bytes.
+        ssize_t bytes_to_read = pipe_buffer_read(pipe_buffer, buffer + bytes_read, nbyte - bytes_read);
+        if (bytes_to_read < 0) {
+            pr_err("Error reading from pipe buffer (error[%2d]: %s).\n", -bytes_to_read, strerror(-bytes_to_read));
+            if (bytes_read == 0) {
+                bytes_read = bytes_to_read;
+            }
+            break;
+        }
+
+        // Update the total bytes read.
+        bytes_read = bytes_read + bytes_to_read;
+
+        // Hand the buffer back to the writer, once it has been filled and drained.
+        pipe_info_retire_buffer(pipe_info, pipe_buffer, tail);
+    }
+    return bytes_read;
+}
+
 /// @brief Reads data from the specified pipe file into the provided buffer.
 /// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
 /// @param buffer Buffer where the data will be stored.
@@ -915,87 +1177,122 @@ static ssize_t pipe_read(vfs_file_t *file, char *buffer, off_t offset, size_t nb
         return -1;
     }
 
-    // Retrieve the current task structure.
-    task_struct *task = scheduler_get_current_process();
-    assert(task && "Failed to retrieve current task.");
-
     // Retrieve the pipe information structure.
     pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
 
-    // Acquire the pipe mutex to ensure safe access.
-    mutex_lock(&pipe_info->mutex, task->pid);
-
-    // Return 0 if there are no writers left.
-    if (pipe_info->writers == 0) {
-        pr_debug("No writers left.\n");
-        return 0;
-    }
-
-    ssize_t bytes_read = 0;
-
-    if (pipe_info_has_data(pipe_info)) {
-        // Loop to read data from the pipe until requested bytes are read or an error occurs.
-        while (bytes_read < nbyte) {
-            // Wrap read_index around when exceeding max buffer capacity.
-            pipe_info->read_index %= (pipe_info->numbuf * PIPE_BUFFER_SIZE);
-
-            // Calculate the buffer index for the current read position.
-            size_t buffer_index        = pipe_linear_to_buffer_index(pipe_info->read_index);
-            pipe_buffer_t *pipe_buffer = &pipe_info->bufs[buffer_index];
+    // Acquire the read end, to ensure safe access.
+    int locked = pipe_lock(pipe_info, pipe_info->readers);
 
-            // Confirm that the buffer is ready to be read.
-            if (pipe_buffer_confirm(pipe_buffer) < 0) {
-                pr_err("Failed to confirm readiness of buffer %u for reading.\n", buffer_index);
-                break; // Stop if there’s no data to read.
-            }
-
-            // Calculate bytes to read in this iteration, considering the remaining requested bytes.
-            ssize_t bytes_to_read = pipe_buffer_read(pipe_buffer, buffer + bytes_read, nbyte - bytes_read);
-            if (bytes_to_read < 0) {
-                pr_err("Error reading from pipe buffer (error[%2d]: %s).\n", -bytes_to_read, strerror(-bytes_to_read));
-                bytes_read = -bytes_to_read;
-                break;
-            }
+    // Wait for some data, we read 0 bytes once there are no writers left.
+    ssize_t bytes_read = pipe_wait_for_data(file, pipe_info, locked);
 
-            // Update the total bytes read and the read index.
-            bytes_read            = bytes_read + bytes_to_read;
-            pipe_info->read_index = pipe_info->read_index + bytes_to_read;
-        }
-    } else {
-        // If in blocking mode, put the process to sleep until data is available.
-        if (pipe_is_blocking(file)) {
-            pipe_put_process_to_sleep(pipe_info, &pipe_info->read_wait, pipe_read_wake_function, "pipe_read");
-        }
-        // TODO: We currently do not save kernel regs status, so we need a
-        // work-around when putting processes to sleep.
-        bytes_read = -EAGAIN;
+    if ((bytes_read == 0) && pipe_info_has_data(pipe_info)) {
+        bytes_read = __pipe_read_locked(pipe_info, buffer, nbyte);
     }
 
-    // Release the mutex after reading.
-    mutex_unlock(&pipe_info->mutex);
+    // Release the read end after reading.
+    pipe_unlock(pipe_info, locked);
 
-    // Wake up tasks that might be waiting to write to the pipe.
+    // Wake up a writer which can use the room we made, and another reader if
+    // we left some data behind.
     if (bytes_read > 0) {
-        pipe_wake_up_tasks(&pipe_info->write_wait, "pipe_read");
+        pipe_wake_up(pipe_info, "pipe_read");
     }
 
     return bytes_read;
 }
 
-/// @brief Writes data to the specified pipe file from the provided buffer.
-/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @brief Copies data into the pipe buffers, whose write end must have been
+/// acquired through pipe_lock().
+/// @param pipe_info Pointer to the pipe information structure.
 /// @param buffer Buffer containing the data to write.
-/// @param offset Unused for pipes, but included for interface compatibility.
-/// @param nbyte Maximum number of bytes to write.
-/// @return Number of bytes written on success, or -1 on error.
-static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+/// @param nbyte Number of bytes to write.
+/// @return Number of bytes written, which is less than `nbyte` when the pipe is full, or a negative error code.
+static ssize_t __pipe_write_locked(pipe_inode_info_t *pipe_info, const void *buffer, size_t nbyte)
 {
-    // Validate input parameters.
-    if (!file) {
-        pr_err("Invalid argument - file is NULL.\n");
-        return -1;
-    }
-    if (!buffer) {
+    ssize_t bytes_written = 0;
+    // Loop to write data to the pipe buffer until the requested number of bytes is written.
+    while (bytes_written < nbyte) {
+        // Get the buffer for the current write position.
+        pipe_buffer_t *pipe_buffer;
+        int ret = pipe_info_get_write_buffer(pipe_info, &pipe_buffer);
+        // The pipe is full, return what we have written so far.
+        if (ret == -EAGAIN) {
+            break;
+        }
+        if (ret < 0) {
+            return bytes_written ? bytes_written : ret;
+        }
+
+        // Confirm the buffer is ready for writing.
+        if (pipe_buffer_confirm(pipe_buffer) < 0) {
+            pr_err("Failed to confirm readiness of a buffer for writing.\n");
+            return -1;
+        }
+
+        // Attempt to write data into the pipe buffer.
+        ssize_t bytes_to_write =
+            pipe_buffer_write(pipe_buffer, (const char *)buffer + bytes_written, nbyte - bytes_written);
+        if (bytes_to_write < 0) {
+            // Other errors: Log and return immediately.
+            pr_err("Error writing to pipe buffer (error[%2d]: %s).\n", -bytes_to_write, strerror(-bytes_to_write));
+            return -1;
+        }
+
+        // Update the total bytes written.
+        bytes_written = bytes_written + bytes_to_write;
+    }
+    return bytes_written;
+}
+
+/// @brief Writes all the data into the pipe, whose write end must have been
+/// acquired through pipe_lock(), waiting for the readers to make room whenever
+/// the pipe is full.
+/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param locked If the pipe mutex is held, see pipe_lock().
+/// @param buffer Buffer containing the data to write.
+/// @param nbyte Number of bytes to write.
+/// @param flags The splice flags, with SPLICE_F_NONBLOCK we do not wait, whatever the mode of the file.
+/// @return Number of bytes written, or a negative value if nothing has been written.
+static ssize_t __pipe_write_wait_locked(
+    vfs_file_t *file,
+    pipe_inode_info_t *pipe_info,
+    int locked,
+    const char *buffer,
+    size_t nbyte,
+    unsigned int flags)
+{
+    ssize_t bytes_written = 0;
+    while (bytes_written < nbyte) {
+        ssize_t ret = pipe_splice_wait_for_space(file, pipe_info, locked, flags);
+        if (ret == 0) {
+            ret = __pipe_write_locked(pipe_info, buffer + bytes_written, nbyte - bytes_written);
+        }
+        if (ret <= 0) {
+            return bytes_written ? bytes_written : ret;
+        }
+        bytes_written += ret;
+        // Wake up a reader, which makes room while we wait.
+        pipe_wake_up_reader(pipe_info, "pipe_write");
+    }
+    return bytes_written;
+}
+
+/// @brief Writes data to the specified pipe file from the provided buffer.
+/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @param buffer Buffer containing the data to write.
+/// @param offset Unused for pipes, but included for interface compatibility.
+/// @param nbyte Maximum number of bytes to write.
+/// @return Number of bytes written on success, or -1 on error.
+static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    // Validate input parameters.
+    if (!file) {
+        pr_err("Invalid argument - file is NULL.\n");
+        return -1;
+    }
+    if (!buffer) {
         pr_err("Invalid argument - buffer is NULL.\n");
         return -1;
     }
@@ -1004,66 +1301,129 @@ static ssize_t pipe_write(vfs_file_t *file, const void *buffer, off_t offset, si
         return -1;
     }
 
-    // Retrieve the current task structure.
-    task_struct *task = scheduler_get_current_process();
-    assert(task && "Failed to retrieve current task.");
+    // Retrieve the pipe information structure.
+    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
+
+    // Acquire the write end, to ensure safe access.
+    int locked = pipe_lock(pipe_info, pipe_info->writers);
+
+    // Write the data, waiting for space whenever the pipe is full.
+    ssize_t bytes_written = __pipe_write_wait_locked(file, pipe_info, locked, buffer, nbyte, 0);
+
+    // Release the write end after the write operation is complete.
+    pipe_unlock(pipe_info, locked);
+
+    // Pass the wake-up on to another writer, if we left some room behind.
+    if (bytes_written > 0) {
+        pipe_wake_up_writer(pipe_info, "pipe_write");
+    }
+
+    return bytes_written;
+}
+
+/// @brief Reads data from the specified pipe file into multiple buffers,
+/// acquiring the read end once for the whole vector.
+/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @param iov The buffers, filled in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Unused for pipes, but included for interface compatibility.
+/// @return Number of bytes read on success, 0 if there are no writers left, or a negative value on error.
+static ssize_t pipe_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    // Validate input parameters.
+    if (!file || !file->device) {
+        pr_err("Invalid argument - file is NULL.\n");
+        return -1;
+    }
 
     // Retrieve the pipe information structure.
     pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
 
-    // Acquire the pipe mutex to ensure safe access.
-    mutex_lock(&pipe_info->mutex, task->pid);
+    // Acquire the read end, to ensure safe access.
+    int locked = pipe_lock(pipe_info, pipe_info->readers);
 
-    ssize_t bytes_written = 0;
+    // Wait for some data, we read 0 bytes once there are no writers left.
+    ssize_t bytes_read = pipe_wait_for_data(file, pipe_info, locked);
 
-    // Check if there is available space in the pipe for writing.
-    if (pipe_info_has_space(pipe_info)) {
-        // Loop to write data to the pipe buffer until the requested number of bytes is written.
-        while (bytes_written < nbyte) {
-            // Wrap around write_index when it exceeds the max buffer capacity.
-            pipe_info->write_index %= (pipe_info->numbuf * PIPE_BUFFER_SIZE);
-
-            // Get the buffer index for the current write position.
-            size_t buffer_index        = pipe_linear_to_buffer_index(pipe_info->write_index);
-            pipe_buffer_t *pipe_buffer = &pipe_info->bufs[buffer_index];
-
-            // Confirm the buffer is ready for writing.
-            if (pipe_buffer_confirm(pipe_buffer) < 0) {
-                pr_err("Failed to confirm readiness of buffer %u for writing.\n", buffer_index);
-                bytes_written = -1;
+    if ((bytes_read == 0) && pipe_info_has_data(pipe_info)) {
+        // Fill the buffers in order, until the pipe runs out of data.
+        for (int i = 0; (i < iovcnt) && pipe_info_has_data(pipe_info); ++i) {
+            if (iov[i].iov_len == 0) {
+                continue;
+            }
+            ssize_t ret = __pipe_read_locked(pipe_info, iov[i].iov_base, iov[i].iov_len);
+            if (ret < 0) {
+                if (bytes_read == 0) {
+                    bytes_read = ret;
+                }
                 break;
             }
-
-            // Attempt to write data into the pipe buffer.
-            ssize_t bytes_to_write =
-                pipe_buffer_write(pipe_buffer, (const char *)buffer + bytes_written, nbyte - bytes_written);
-            if (bytes_to_write < 0) {
-                // Other errors: Log and return immediately.
-                pr_err("Error writing to pipe buffer (error[%2d]: %s).\n", -bytes_to_write, strerror(-bytes_to_write));
-                bytes_written = -1;
+            bytes_read += ret;
+            if ((size_t)ret < iov[i].iov_len) {
                 break;
             }
+        }
+    }
+
+    // Release the read end after reading.
+    pipe_unlock(pipe_info, locked);
 
-            // Update the total bytes written and the write index.
-            bytes_written          = bytes_written + bytes_to_write;
-            pipe_info->write_index = pipe_info->write_index + bytes_to_write;
+    // Wake up a writer which can use the room we made, and another reader if
+    // we left some data behind.
+    if (bytes_read > 0) {
+        pipe_wake_up(pipe_info, "pipe_readv");
+    }
+
+    return bytes_read;
+}
+
+/// @brief Writes data to the specified pipe file from multiple buffers,
+/// acquiring the write end once for the whole vector.
+/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @param iov The buffers, written in order.
+/// @param iovcnt The number of buffers.
+/// @param offset Unused for pipes, but included for interface compatibility.
+/// @return Number of bytes written on success, or a negative value on error.
+static ssize_t pipe_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    // Validate input parameters.
+    if (!file || !file->device) {
+        pr_err("Invalid argument - file is NULL.\n");
+        return -1;
+    }
+
+    // Retrieve the pipe information structure.
+    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
+
+    // Acquire the write end, to ensure safe access.
+    int locked = pipe_lock(pipe_info, pipe_info->writers);
+
+    ssize_t bytes_written = 0;
+
+    // Write the buffers in order, waiting for space whenever the pipe is full.
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
         }
-    } else {
-        // Blocking behavior: Put the process to sleep until space is available.
-        if (pipe_is_blocking(file)) {
-            pipe_put_process_to_sleep(pipe_info, &pipe_info->write_wait, pipe_write_wake_function, "pipe_write");
+        ssize_t ret = __pipe_write_wait_locked(file, pipe_info, locked, iov[i].iov_base, iov[i].iov_len, 0);
+        if (ret < 0) {
+            if (bytes_written == 0) {
+                bytes_written = ret;
+            }
+            break;
+        }
+        bytes_written += ret;
+        if ((size_t)ret < iov[i].iov_len) {
+            break;
         }
-        // TODO: We currently do not save kernel regs status, so we need a
-        // work-around when putting processes to sleep.
-        bytes_written = -EAGAIN;
     }
 
-    // Release the mutex after the write operation is complete.
-    mutex_unlock(&pipe_info->mutex);
+    // Release the write end after the write operation is complete.
+    pipe_unlock(pipe_info, locked);
 
-    // Wake up tasks waiting to read from the pipe.
+    // Pass the wake-up on to another writer, if we left some room behind.
     if (bytes_written > 0) {
-        pipe_wake_up_tasks(&pipe_info->read_wait, "pipe_write");
+        pipe_wake_up_writer(pipe_info, "pipe_writev");
     }
 
     return bytes_written;
@@ -1082,11 +1442,61 @@ static off_t pipe_lseek(vfs_file_t *file, off_t offset, int whence) { return -1;
 /// @return Always returns -1 as pipes do not support file status retrieval.
 static int pipe_fstat(vfs_file_t *file, stat_t *stat) { return -1; }
 
+/// @brief Changes the capacity of a pipe, keeping the data it holds. System
+/// calls are not preempted, so the ends of the pipe which do not take the
+/// mutex cannot be using the ring meanwhile.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param size The new capacity, in bytes, rounded up to a power of two number of buffers.
+/// @return The new capacity on success, -EINVAL if it exceeds the maximum,
+/// -EBUSY if the data inside the pipe does not fit, -ENOMEM on failure.
+static long pipe_set_size(pipe_inode_info_t *pipe_info, unsigned long size)
+{
+    if (size > (PIPE_MAX_BUFFERS * PIPE_BUFFER_SIZE)) {
+        pr_err("The pipe size %lu exceeds the maximum.\n", size);
+        return -EINVAL;
+    }
+    // A pipe holds at least one buffer, and the ring indices need a power of two.
+    size_t numbuf = 1;
+    while ((numbuf * PIPE_BUFFER_SIZE) < size) {
+        numbuf <<= 1;
+    }
+    // The buffers in use must fit inside the new ring.
+    size_t used = pipe_info->head - pipe_info->tail;
+    if (used > numbuf) {
+        return -EBUSY;
+    }
+    pipe_buffer_t *bufs = (pipe_buffer_t *)kmalloc(sizeof(pipe_buffer_t) * numbuf);
+    if (!bufs) {
+        pr_err("Failed to allocate memory for the pipe buffers.\n");
+        return -ENOMEM;
+    }
+    // Move the buffers in order, starting from the first one in use, so that
+    // they keep their pages; the exceeding ones are free, and are released.
+    for (size_t i = 0; i < pipe_info->numbuf; ++i) {
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(pipe_info, pipe_info->tail + i);
+        if (i < numbuf) {
+            bufs[i] = *pipe_buffer;
+        } else {
+            __pipe_buffer_deinit(pipe_buffer);
+        }
+    }
+    for (size_t i = pipe_info->numbuf; i < numbuf; ++i) {
+        __pipe_buffer_init(&bufs[i], (struct pipe_buf_operations *)pipe_info->bufs[0].ops);
+    }
+    kfree(pipe_info->bufs);
+    pipe_info->bufs   = bufs;
+    pipe_info->numbuf = numbuf;
+    pipe_info->head   = used;
+    pipe_info->tail   = 0;
+    return numbuf * PIPE_BUFFER_SIZE;
+}
+
 /// @brief Performs a fcntl operation on a pipe file descriptor
 /// @param file Pointer to the vfs_file_t structure representing the pipe file.
-/// @param request The fcntl command (e.g., F_GETFL, F_SETFL)
-/// @param data Additional argument for setting flags (used with F_SETFL)
-/// @return On success, returns 0 for F_SETFL or current flags for F_GETFL; -1 on error with errno set.
+/// @param request The fcntl command (e.g., F_GETFL, F_SETFL, F_GETPIPE_SZ, F_SETPIPE_SZ)
+/// @param data Additional argument for setting flags (used with F_SETFL), or the size (used with F_SETPIPE_SZ)
+/// @return On success, returns 0 for F_SETFL, current flags for F_GETFL, and
+/// the capacity of the pipe for F_GETPIPE_SZ and F_SETPIPE_SZ; a negative value on error.
 static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
 {
     if (!file) {
@@ -1095,6 +1505,8 @@ static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long dat
         return -1;
     }
 
+    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
+
     switch (request) {
     case F_GETFL:
         pr_debug("Retrieving flags for pipe.\n");
@@ -1112,6 +1524,26 @@ static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long dat
         }
         return 0;
 
+    case F_GETPIPE_SZ:
+        if (!pipe_info) {
+            return -EBADF;
+        }
+        return pipe_info->numbuf * PIPE_BUFFER_SIZE;
+
+    case F_SETPIPE_SZ: {
+        if (!pipe_info) {
+            return -EBADF;
+        }
+        mutex_lock(&pipe_info->mutex);
+        long ret = pipe_set_size(pipe_info, data);
+        mutex_unlock(&pipe_info->mutex);
+        // The writers might have more room now.
+        if (ret > 0) {
+            pipe_wake_up_writer(pipe_info, "pipe_fcntl");
+        }
+        return ret;
+    }
+
     default:
         errno = EINVAL;
         pr_err("Unsupported request %u.\n", request);
@@ -1119,6 +1551,44 @@ static long pipe_fcntl(vfs_file_t *file, unsigned int request, unsigned long dat
     }
 }
 
+/// @brief Reports the readiness of one end of a pipe.
+/// @param file Pointer to the `vfs_file_t` structure representing the pipe file.
+/// @param table The poll table, the caller waits on the queue of this end.
+/// @return POLLIN when there is data, POLLOUT when there are at least
+/// PIPE_BUF free bytes, POLLHUP when the writers are gone, POLLERR when the
+/// readers are gone.
+static unsigned int pipe_poll(vfs_file_t *file, poll_table_t *table)
+{
+    if (!file || !file->device) {
+        return POLLNVAL;
+    }
+
+    pipe_inode_info_t *pipe_info = (pipe_inode_info_t *)file->device;
+
+    unsigned int mask = 0;
+    // A named pipe opened with O_RDWR reports the events of both ends.
+    if ((file->flags & O_ACCMODE) != O_WRONLY) {
+        poll_wait(&pipe_info->read_wait, table);
+        if (pipe_info_has_data(pipe_info)) {
+            mask |= POLLIN | POLLRDNORM;
+        }
+        if (pipe_info->writers == 0) {
+            mask |= POLLHUP;
+        }
+    }
+    if ((file->flags & O_ACCMODE) != O_RDONLY) {
+        poll_wait(&pipe_info->write_wait, table);
+        // The writers are woken up once there are PIPE_BUF free bytes.
+        if (pipe_info_free_space(pipe_info) >= PIPE_BUF) {
+            mask |= POLLOUT | POLLWRNORM;
+        }
+        if (pipe_info->readers == 0) {
+            mask |= POLLERR;
+        }
+    }
+    return mask;
+}
+
 /// @brief Creates a file descriptor for one end of a pipe.
 /// @param pipe_info Pointer to the pipe inode information structure.
 /// @param flags Open mode for the pipe (e.g., O_RDONLY or O_WRONLY).
@@ -1156,8 +1626,7 @@ static inline int create_pipe_fd(pipe_inode_info_t *pipe_info, int flags, mode_t
     }
 
     // Register the file descriptor in the process's file descriptor table.
-    task->fd_list[fd].file_struct = file;
-    task->fd_list[fd].flags_mask  = file->flags;
+    fd_install(task, fd, file, file->flags);
 
     // Return the created file descriptor.
     return fd;
@@ -1166,9 +1635,9 @@ static inline int create_pipe_fd(pipe_inode_info_t *pipe_info, int flags, mode_t
 int vfs_update_pipe_counts(task_struct *task, task_struct *old_task)
 {
     // Iterate through the file descriptors in the task
-    for (int fd = 0; fd < task->max_fd; fd++) {
+    for (int fd = 0; fd < task->files->max_fd; fd++) {
         // Get the file.
-        vfs_file_t *file = task->fd_list[fd].file_struct;
+        vfs_file_t *file = task->files->fd_list[fd].file_struct;
         // Check if the file descriptor is associated with a pipe.
         if (file && S_ISFIFO(file->flags)) {
             // Assume file_struct has a member pipe_info that points to pipe_inode_info_t.
@@ -1191,6 +1660,10 @@ int vfs_update_pipe_counts(task_struct *task, task_struct *old_task)
                         "Increased readers count for pipe associated with fd "
                         "%d. New count: %d\n",
                         fd, pipe_info->readers);
+                } else if ((file->flags & O_ACCMODE) == O_RDWR) {
+                    // A named pipe opened for both reading and writing.
+                    ++pipe_info->readers;
+                    ++pipe_info->writers;
                 } else {
                     pr_warning("Unknown pipe file access mode, possibly "
                                "incorrect flags.\n");
@@ -1258,3 +1731,516 @@ int sys_pipe(int fds[2])
 
     return 0; // Success
 }
+
+int pipe_create_files(vfs_file_t *files[2])
+{
+    pipe_inode_info_t *pipe_info = __pipe_inode_info_alloc(&anonymous_pipe_ops);
+    if (!pipe_info) {
+        return -ENOMEM;
+    }
+    files[0] = pipe_create_file_struct(NULL, O_RDONLY, 0);
+    files[1] = pipe_create_file_struct(NULL, O_WRONLY, 0);
+    if (!files[0] || !files[1]) {
+        for (int i = 0; i < 2; ++i) {
+            if (files[i]) {
+                vfs_dealloc_file(files[i]);
+            }
+        }
+        __pipe_inode_info_dealloc(pipe_info);
+        return -ENOMEM;
+    }
+    files[0]->device   = pipe_info;
+    files[1]->device   = pipe_info;
+    pipe_info->readers = 1;
+    pipe_info->writers = 1;
+    return 0;
+}
+
+// ============================================================================
+// Named Pipes
+// ============================================================================
+
+/// @brief Searches the pipe of an opened named pipe.
+/// @param device The filesystem of the inode.
+/// @param ino The inode of the named pipe.
+/// @return The pipe, NULL if no task has the named pipe open.
+static inline pipe_inode_info_t *pipe_fifo_find(void *device, ino_t ino)
+{
+    list_for_each_decl (it, &named_pipes) {
+        pipe_inode_info_t *pipe_info = list_entry(it, pipe_inode_info_t, list_node);
+        if ((pipe_info->fifo_device == device) && (pipe_info->fifo_ino == ino)) {
+            return pipe_info;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Waits inside open() until the other end of a named pipe is opened.
+/// @param wait_queue The wait queue of the end being opened.
+/// @param partners The number of tasks holding the other end.
+/// @param counter The number of times the other end has been opened.
+/// @return 0 once the other end has been opened, -EINTR if a signal interrupted the wait.
+static int pipe_fifo_wait_for_partner(wait_queue_head_t *wait_queue, size_t *partners, size_t *counter)
+{
+    // The other end might be opened and closed again before we run, the
+    // counter tells us it happened anyway.
+    size_t opened = *counter;
+    while ((*partners == 0) && (*counter == opened)) {
+        if (interruptible_sleep_on(wait_queue) < 0) {
+            return -EINTR;
+        }
+    }
+    return 0;
+}
+
+vfs_file_t *pipe_open_fifo(void *device, ino_t ino, int flags, mode_t mode)
+{
+    int accmode = flags & O_ACCMODE;
+
+    // Attach to the pipe of the named pipe, or create it for the first opener.
+    pipe_inode_info_t *pipe_info = pipe_fifo_find(device, ino);
+    if (!pipe_info) {
+        // Nobody could read what we write.
+        if ((accmode == O_WRONLY) && bitmask_check(flags, O_NONBLOCK)) {
+            errno = ENXIO;
+            return NULL;
+        }
+        pipe_info = __pipe_inode_info_alloc(&named_pipe_ops);
+        if (!pipe_info) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        pipe_info->fifo_device = device;
+        pipe_info->fifo_ino    = ino;
+        list_head_insert_before(&pipe_info->list_node, &named_pipes);
+    } else if ((accmode == O_WRONLY) && bitmask_check(flags, O_NONBLOCK) && (pipe_info->readers == 0)) {
+        errno = ENXIO;
+        return NULL;
+    }
+
+    vfs_file_t *file = pipe_create_file_struct(NULL, flags, mode);
+    if (!file) {
+        if ((pipe_info->readers == 0) && (pipe_info->writers == 0)) {
+            __pipe_inode_info_dealloc(pipe_info);
+        }
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->device = pipe_info;
+    file->ino    = ino;
+    file->flags |= (flags & O_NONBLOCK);
+
+    // Register the new end, and wake up the tasks waiting for it inside open().
+    if (accmode != O_WRONLY) {
+        ++pipe_info->readers;
+        ++pipe_info->r_counter;
+        pipe_wake_up_tasks(&pipe_info->write_wait, 0, "pipe_open_fifo");
+    }
+    if (accmode != O_RDONLY) {
+        ++pipe_info->writers;
+        ++pipe_info->w_counter;
+        pipe_wake_up_tasks(&pipe_info->read_wait, 0, "pipe_open_fifo");
+    }
+
+    // A blocking open of a single end waits for the other one.
+    int ret = 0;
+    if (!bitmask_check(flags, O_NONBLOCK)) {
+        if (accmode == O_RDONLY) {
+            ret = pipe_fifo_wait_for_partner(&pipe_info->read_wait, &pipe_info->writers, &pipe_info->w_counter);
+        } else if (accmode == O_WRONLY) {
+            ret = pipe_fifo_wait_for_partner(&pipe_info->write_wait, &pipe_info->readers, &pipe_info->r_counter);
+        }
+    }
+    if (ret < 0) {
+        pipe_close(file);
+        errno = -ret;
+        return NULL;
+    }
+
+    // The caller takes the reference to the file, see vfs_open_abspath().
+    file->count = 0;
+    return file;
+}
+
+// ============================================================================
+// Splicing
+// ============================================================================
+
+/// @brief Retrieves the file of a descriptor, for splice() and friends.
+/// @param fd The file descriptor.
+/// @param write If the file is going to be written.
+/// @param file Where the file is stored.
+/// @return 0 on success, -EBADF if the descriptor is not open, or cannot be used that way.
+static inline int pipe_splice_get_file(int fd, int write, vfs_file_t **file)
+{
+    task_struct *task = scheduler_get_current_process();
+    if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+        return -EBADF;
+    }
+    if (write && !bitmask_check(task->files->fd_list[fd].flags_mask, O_WRONLY | O_RDWR)) {
+        return -EBADF;
+    }
+    *file = task->files->fd_list[fd].file_struct;
+    // Each end of a pipe can be used only in one direction.
+    if ((*file)->fs_operations == &pipe_fs_operations) {
+        if (!(*file)->device || (((*file)->flags & O_ACCMODE) != (write ? O_WRONLY : O_RDONLY))) {
+            return -EBADF;
+        }
+    }
+    return 0;
+}
+
+/// @brief Returns the pipe behind a file.
+/// @param file The file.
+/// @return The pipe, NULL if the file is not a pipe.
+static inline pipe_inode_info_t *pipe_splice_get_pipe(vfs_file_t *file)
+{
+    return (file->fs_operations == &pipe_fs_operations) ? (pipe_inode_info_t *)file->device : NULL;
+}
+
+/// @brief Appends the unread data of a buffer to a pipe, whose write end must
+/// have been acquired through pipe_lock(), by handing it the page of the
+/// buffer. The pipe must have a free buffer.
+/// @param pipe_info Pointer to the pipe information structure.
+/// @param source The buffer, which must not accept more data.
+/// @param count The number of bytes to append, starting from the offset of the buffer.
+/// @param move If the page leaves the buffer, which takes the free page of the
+/// pipe in exchange; otherwise, the page is shared between the two.
+static inline void pipe_info_push_page(pipe_inode_info_t *pipe_info, pipe_buffer_t *source, size_t count, int move)
+{
+    size_t head = pipe_info->head;
+    // The reader must move past the last buffer in use, to reach the new one.
+    if (head != READ_ONCE(pipe_info->tail)) {
+        pipe_info_buffer(pipe_info, head - 1)->flags |= PIPE_BUF_FLAG_SEALED;
+    }
+    pipe_buffer_t *pipe_buffer = pipe_info_buffer(pipe_info, head);
+    if (move) {
+        // Exchange the pages, so that `source` keeps a page for the next writes.
+        page_t *page      = pipe_buffer->page;
+        char *data        = pipe_buffer->data;
+        pipe_buffer->page = source->page;
+        pipe_buffer->data = source->data;
+        source->page      = page;
+        source->data      = data;
+    } else {
+        __pipe_buffer_put_page(pipe_buffer);
+        page_inc(source->page);
+        pipe_buffer->page = source->page;
+        pipe_buffer->data = source->data;
+    }
+    // The page might be shared, nothing else can be appended to it.
+    pipe_buffer->offset = source->offset;
+    pipe_buffer->len    = source->offset + count;
+    pipe_buffer->flags  = PIPE_BUF_FLAG_SEALED;
+    // Hand the buffer to the reader.
+    barrier();
+    WRITE_ONCE(pipe_info->head, head + 1);
+}
+
+/// @brief Moves, or duplicates, the data of a pipe into another pipe, whose
+/// ends must have been acquired through pipe_lock(). The buffers which do not
+/// accept more data hand their pages over, the others are copied.
+/// @param in Pointer to the pipe we read from.
+/// @param out Pointer to the pipe we write to.
+/// @param len The maximum number of bytes to transfer.
+/// @param consume If the data is removed from `in` (splice), or not (tee).
+/// @return The number of transferred bytes, or a negative error code.
+static ssize_t __pipe_splice_locked(pipe_inode_info_t *in, pipe_inode_info_t *out, size_t len, int consume)
+{
+    ssize_t total = 0;
+    size_t head   = READ_ONCE(in->head);
+    // The buffers must not be read before the writer hands them to us.
+    barrier();
+    for (size_t index = in->tail; (index != head) && ((size_t)total < len); ++index) {
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(in, index);
+        size_t available           = pipe_buffer_available(pipe_buffer);
+        // Skip the drained buffers, which have not been retired yet.
+        if (available == 0) {
+            if (!consume || pipe_info_retire_buffer(in, pipe_buffer, index)) {
+                continue;
+            }
+            break;
+        }
+        size_t count = ((len - total) < available) ? (len - total) : available;
+        ssize_t transferred;
+        if ((pipe_buffer_capacity(pipe_buffer) == 0) && ((out->head - READ_ONCE(out->tail)) < out->numbuf)) {
+            // The writer of `in` is done with the page, hand it over.
+            pipe_info_push_page(out, pipe_buffer, count, consume && (count == available));
+            transferred = count;
+        } else {
+            transferred = __pipe_write_locked(out, pipe_buffer->data + pipe_buffer->offset, count);
+            if (transferred <= 0) {
+                return total ? total : transferred;
+            }
+        }
+        total += transferred;
+        if (consume) {
+            pipe_buffer->offset += transferred;
+            pipe_info_retire_buffer(in, pipe_buffer, index);
+        }
+        // Stop once `out` is full.
+        if ((size_t)transferred < count) {
+            break;
+        }
+    }
+    return total;
+}
+
+/// @brief Moves data from a file into a pipe, whose write end must have been
+/// acquired through pipe_lock(), reading the file straight into the pages of the pipe.
+/// @param in The file we read from.
+/// @param pos The offset we read from, upon return it follows the moved data.
+/// @param out Pointer to the pipe we write to.
+/// @param len The maximum number of bytes to move.
+/// @return The number of moved bytes, or a negative error code.
+static ssize_t __pipe_splice_from_file(vfs_file_t *in, off_t *pos, pipe_inode_info_t *out, size_t len)
+{
+    ssize_t total = 0;
+    while ((size_t)total < len) {
+        pipe_buffer_t *pipe_buffer;
+        int ret = pipe_info_get_write_buffer(out, &pipe_buffer);
+        // The pipe is full, return what we have moved so far.
+        if (ret == -EAGAIN) {
+            break;
+        }
+        if (ret < 0) {
+            return total ? total : ret;
+        }
+        size_t capacity = pipe_buffer_capacity(pipe_buffer);
+        size_t count    = ((len - total) < capacity) ? (len - total) : capacity;
+        ssize_t nread   = vfs_read(in, pipe_buffer->data + pipe_buffer->len, *pos, count);
+        if (nread <= 0) {
+            return total ? total : nread;
+        }
+        // Publish the data to the reader.
+        barrier();
+        WRITE_ONCE(pipe_buffer->len, pipe_buffer->len + nread);
+        *pos += nread;
+        total += nread;
+        // Stop at the end of the file.
+        if ((size_t)nread < count) {
+            break;
+        }
+    }
+    return total;
+}
+
+/// @brief Moves data from a pipe into a file, whose read end must have been
+/// acquired through pipe_lock(), writing the file straight from the pages of the pipe.
+/// @param in Pointer to the pipe we read from.
+/// @param out The file we write to.
+/// @param pos The offset we write to, upon return it follows the moved data.
+/// @param len The maximum number of bytes to move.
+/// @return The number of moved bytes, or a negative error code.
+static ssize_t __pipe_splice_to_file(pipe_inode_info_t *in, vfs_file_t *out, off_t *pos, size_t len)
+{
+    ssize_t total = 0;
+    while ((size_t)total < len) {
+        size_t tail = in->tail;
+        if (tail == READ_ONCE(in->head)) {
+            break;
+        }
+        // The buffer must not be read before the writer hands it to us.
+        barrier();
+        pipe_buffer_t *pipe_buffer = pipe_info_buffer(in, tail);
+        if (pipe_buffer_empty(pipe_buffer)) {
+            if (pipe_info_retire_buffer(in, pipe_buffer, tail)) {
+                continue;
+            }
+            break;
+        }
+        size_t available = pipe_buffer_available(pipe_buffer);
+        size_t count     = ((len - total) < available) ? (len - total) : available;
+        // The length has been read first, and the data must not be read before it.
+        barrier();
+        ssize_t nwritten = vfs_write(out, pipe_buffer->data + pipe_buffer->offset, *pos, count);
+        if (nwritten <= 0) {
+            return total ? total : nwritten;
+        }
+        pipe_buffer->offset += nwritten;
+        *pos += nwritten;
+        total += nwritten;
+        pipe_info_retire_buffer(in, pipe_buffer, tail);
+        // Stop once the file is full.
+        if ((size_t)nwritten < count) {
+            break;
+        }
+    }
+    return total;
+}
+
+/// @brief Moves, or duplicates, the data of a pipe into another pipe.
+/// @param in The read end of the pipe we read from.
+/// @param out The write end of the pipe we write to.
+/// @param len The maximum number of bytes to transfer.
+/// @param flags The splice flags.
+/// @param consume If the data is removed from `in` (splice), or not (tee).
+/// @return The number of transferred bytes, 0 if there are no writers left, or a negative error code.
+static ssize_t pipe_splice_pipes(vfs_file_t *in, vfs_file_t *out, size_t len, unsigned int flags, int consume)
+{
+    pipe_inode_info_t *pipe_in  = (pipe_inode_info_t *)in->device;
+    pipe_inode_info_t *pipe_out = (pipe_inode_info_t *)out->device;
+    if (pipe_in == pipe_out) {
+        return -EINVAL;
+    }
+
+    // Acquire the read end of `in`, and then the write end of `out`.
+    int locked_in  = pipe_lock(pipe_in, pipe_in->readers);
+    int locked_out = pipe_lock(pipe_out, pipe_out->writers);
+
+    // Wait for some data, we transfer 0 bytes once there are no writers left.
+    ssize_t ret = pipe_splice_wait_for_data(in, pipe_in, locked_in, flags);
+    if ((ret == 0) && pipe_info_has_data(pipe_in)) {
+        ret = pipe_splice_wait_for_space(out, pipe_out, locked_out, flags);
+        if (ret == 0) {
+            ret = __pipe_splice_locked(pipe_in, pipe_out, len, consume);
+        }
+    }
+
+    pipe_unlock(pipe_out, locked_out);
+    pipe_unlock(pipe_in, locked_in);
+
+    if (ret > 0) {
+        pipe_wake_up(pipe_in, "pipe_splice");
+        pipe_wake_up(pipe_out, "pipe_splice");
+    }
+    return ret;
+}
+
+ssize_t sys_splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len)
+{
+    vfs_file_t *in, *out;
+    int ret = pipe_splice_get_file(fd_in, 0, &in);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = pipe_splice_get_file(fd_out, 1, &out)) < 0) {
+        return ret;
+    }
+    pipe_inode_info_t *pipe_in  = pipe_splice_get_pipe(in);
+    pipe_inode_info_t *pipe_out = pipe_splice_get_pipe(out);
+    // One of the two ends must be a pipe, which has no offset.
+    if (!pipe_in && !pipe_out) {
+        return -EINVAL;
+    }
+    if ((pipe_in && off_in) || (pipe_out && off_out)) {
+        return -ESPIPE;
+    }
+    if ((off_in && (*off_in < 0)) || (off_out && (*off_out < 0))) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    if (pipe_in && pipe_out) {
+        return pipe_splice_pipes(in, out, len, 0, 1);
+    }
+
+    ssize_t moved;
+    if (pipe_out) {
+        // Use the given offset, or the file offset.
+        off_t pos  = off_in ? *off_in : in->f_pos;
+        int locked = pipe_lock(pipe_out, pipe_out->writers);
+        moved      = pipe_wait_for_space(out, pipe_out, locked);
+        if (moved == 0) {
+            moved = __pipe_splice_from_file(in, &pos, pipe_out, len);
+        }
+        pipe_unlock(pipe_out, locked);
+        if (moved > 0) {
+            if (off_in) {
+                *off_in = pos;
+            } else {
+                in->f_pos = pos;
+            }
+            pipe_wake_up(pipe_out, "pipe_splice");
+        }
+    } else {
+        // Use the given offset, or the file offset.
+        off_t pos  = off_out ? *off_out : out->f_pos;
+        int locked = pipe_lock(pipe_in, pipe_in->readers);
+        moved      = pipe_wait_for_data(in, pipe_in, locked);
+        if (moved == 0) {
+            moved = __pipe_splice_to_file(pipe_in, out, &pos, len);
+        }
+        pipe_unlock(pipe_in, locked);
+        if (moved > 0) {
+            if (off_out) {
+                *off_out = pos;
+            } else {
+                out->f_pos = pos;
+            }
+            pipe_wake_up(pipe_in, "pipe_splice");
+        }
+    }
+    return moved;
+}
+
+ssize_t sys_tee(int fd_in, int fd_out, size_t len, unsigned int flags)
+{
+    vfs_file_t *in, *out;
+    int ret = pipe_splice_get_file(fd_in, 0, &in);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = pipe_splice_get_file(fd_out, 1, &out)) < 0) {
+        return ret;
+    }
+    // Both ends must be pipes.
+    if (!pipe_splice_get_pipe(in) || !pipe_splice_get_pipe(out)) {
+        return -EINVAL;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    return pipe_splice_pipes(in, out, len, flags, 0);
+}
+
+ssize_t sys_vmsplice(int fd, const struct iovec *iov, unsigned long nr_segs, unsigned int flags)
+{
+    vfs_file_t *file;
+    int ret = pipe_splice_get_file(fd, 1, &file);
+    if (ret < 0) {
+        return ret;
+    }
+    pipe_inode_info_t *pipe_info = pipe_splice_get_pipe(file);
+    if (!pipe_info) {
+        return -EBADF;
+    }
+    if ((nr_segs > IOV_MAX) || (nr_segs && !iov)) {
+        return -EINVAL;
+    }
+
+    // Acquire the write end, to ensure safe access.
+    int locked = pipe_lock(pipe_info, pipe_info->writers);
+
+    ssize_t bytes_written = 0;
+
+    // Copy the buffers in order, the pages of the process stay where they are.
+    for (unsigned long i = 0; i < nr_segs; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t written =
+            __pipe_write_wait_locked(file, pipe_info, locked, iov[i].iov_base, iov[i].iov_len, flags);
+        if (written < 0) {
+            if (bytes_written == 0) {
+                bytes_written = written;
+            }
+            break;
+        }
+        bytes_written += written;
+        if ((size_t)written < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    // Release the write end after the write operation is complete.
+    pipe_unlock(pipe_info, locked);
+
+    // Pass the wake-up on to another writer, if we left some room behind.
+    if (bytes_written > 0) {
+        pipe_wake_up_writer(pipe_info, "pipe_vmsplice");
+    }
+
+    return bytes_written;
+}
@@ -0,0 +1,332 @@
+/// @file poll.c
+/// @brief Readiness multiplexing over VFS files (poll and select).
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[POLL  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/poll.h"
+
+#include "assert.h"
+#include "errno.h"
+#include "fs/vfs.h"
+#include "limits.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "system/signal.h"
+#include "system/syscall.h"
+
+/// @brief Links a poll table to one of the wait queues it is waiting on.
+typedef struct poll_entry {
+    /// The wait queue.
+    wait_queue_head_t *head;
+    /// The entry placed inside the wait queue.
+    wait_queue_entry_t wait;
+    /// Used to place the entry inside the list of the poll table.
+    list_head_t list;
+} poll_entry_t;
+
+/// @brief Wakes up the polling task, it is called by whoever wakes up the wait queue.
+/// @param wait the entry of the polling task.
+/// @param mode the state the task is set to.
+/// @param sync not used.
+/// @return always 0, the entry belongs to the poll table, which removes it.
+static int __poll_wake_function(wait_queue_entry_t *wait, unsigned mode, int sync)
+{
+    if ((wait->task->state == TASK_INTERRUPTIBLE) || (wait->task->state == TASK_UNINTERRUPTIBLE)) {
+        scheduler_wake_up_task(wait->task, mode);
+    }
+    return 0;
+}
+
+/// @brief Removes the task from all the wait queues of the table.
+/// @param table the poll table.
+static void __poll_table_remove_entries(poll_table_t *table)
+{
+    list_for_each_safe_decl(it, store, &table->entries)
+    {
+        poll_entry_t *entry = list_entry(it, poll_entry_t, list);
+        remove_wait_queue(entry->head, &entry->wait);
+        list_head_remove(&entry->list);
+        kfree(entry);
+    }
+}
+
+/// @brief Removes the task from all the wait queues, and stops the timer.
+/// @param table the poll table.
+static void __poll_table_clear(poll_table_t *table)
+{
+    __poll_table_remove_entries(table);
+    if (table->timer) {
+        remove_timer(table->timer);
+        kfree(table->timer);
+        table->timer = NULL;
+    }
+    table->armed       = false;
+    table->timed_out   = false;
+    table->registering = false;
+}
+
+/// @brief Called when the timeout of a poll table expires.
+/// @param data the poll table.
+static void __poll_timeout(unsigned long data)
+{
+    poll_table_t *table = (poll_table_t *)data;
+    // The timer is freed by the timer subsystem, once this function returns.
+    table->timer     = NULL;
+    table->timed_out = true;
+    if ((table->task->state == TASK_INTERRUPTIBLE) || (table->task->state == TASK_UNINTERRUPTIBLE)) {
+        scheduler_wake_up_task(table->task, TASK_RUNNING);
+    }
+}
+
+/// @brief Converts a timeout in milliseconds to timer ticks, without overflowing.
+/// @param timeout the timeout, in milliseconds.
+/// @return the number of ticks, at least one.
+static inline unsigned long __poll_ms_to_ticks(int timeout)
+{
+    unsigned long ticks = ((timeout / 1000) * TICKS_PER_SECOND) + (((timeout % 1000) * TICKS_PER_SECOND) / 1000);
+    return ticks ? ticks : 1;
+}
+
+void poll_wait(wait_queue_head_t *head, poll_table_t *table)
+{
+    if (!head || !table || !table->registering) {
+        return;
+    }
+    // Wait only once on each queue, even if several files share it.
+    list_for_each_decl (it, &table->entries) {
+        if (list_entry(it, poll_entry_t, list)->head == head) {
+            return;
+        }
+    }
+    poll_entry_t *entry = kmalloc(sizeof(poll_entry_t));
+    if (!entry) {
+        pr_err("Failed to allocate a poll entry.\n");
+        return;
+    }
+    entry->head = head;
+    wait_queue_entry_init(&entry->wait, table->task);
+    entry->wait.func    = __poll_wake_function;
+    entry->wait.private = table;
+    add_wait_queue(head, &entry->wait);
+    list_head_insert_before(&entry->list, &table->entries);
+}
+
+void poll_wake_up(wait_queue_head_t *head)
+{
+    list_for_each_decl (it, &head->task_list) {
+        wait_queue_entry_t *wait = list_entry(it, wait_queue_entry_t, task_list);
+        wait->func(wait, TASK_RUNNING, 0);
+    }
+}
+
+poll_table_t *poll_table_begin(int timeout)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (!task->poll_table) {
+        task->poll_table = kmalloc(sizeof(poll_table_t));
+        if (!task->poll_table) {
+            return NULL;
+        }
+        memset(task->poll_table, 0, sizeof(poll_table_t));
+        task->poll_table->task = task;
+        list_head_init(&task->poll_table->entries);
+    }
+    poll_table_t *table = task->poll_table;
+    if (!table->armed) {
+        // A new call, forget about the previous one.
+        __poll_table_clear(table);
+    } else {
+        // We have been woken up, the files register again while we check them,
+        // but the timeout keeps running.
+        __poll_table_remove_entries(table);
+    }
+    table->registering = (timeout != 0) && !table->timed_out;
+    return table;
+}
+
+int poll_table_end(poll_table_t *table, int ready, int timeout)
+{
+    // Return if something is ready, or if there is nothing which could wake us up.
+    if ((ready != 0) || (timeout == 0) || table->timed_out || ((timeout < 0) && list_head_empty(&table->entries))) {
+        __poll_table_clear(table);
+        return ready;
+    }
+    if (!table->armed) {
+        table->armed = true;
+        if (timeout > 0) {
+            table->timer = kmalloc(sizeof(struct timer_list));
+            if (!table->timer) {
+                pr_err("Failed to allocate the poll timer.\n");
+                __poll_table_clear(table);
+                return -ENOMEM;
+            }
+            memset(table->timer, 0, sizeof(struct timer_list));
+            init_timer(table->timer);
+            table->timer->expires  = timer_get_ticks() + __poll_ms_to_ticks(timeout);
+            table->timer->function = &__poll_timeout;
+            table->timer->data     = (unsigned long)table;
+            add_timer(table->timer);
+        }
+    }
+    table->registering = false;
+    // Go to sleep, until one of the files or the timer wakes us up.
+    table->task->state = TASK_INTERRUPTIBLE;
+    schedule();
+    if (signal_pending(table->task)) {
+        __poll_table_clear(table);
+        return -EINTR;
+    }
+    return -EAGAIN;
+}
+
+void poll_table_release(task_struct *task)
+{
+    if (task->poll_table) {
+        __poll_table_clear(task->poll_table);
+        kfree(task->poll_table);
+        task->poll_table = NULL;
+    }
+}
+
+/// @brief Checks the events of a single file descriptor.
+/// @param task the current task.
+/// @param fd the file descriptor.
+/// @param events the events we are interested in.
+/// @param table the poll table.
+/// @return the events which occurred, among `events` and the ones always reported.
+static inline unsigned int __poll_fd(task_struct *task, int fd, unsigned int events, poll_table_t *table)
+{
+    if ((fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+        return POLLNVAL;
+    }
+    return vfs_poll(task->files->fd_list[fd].file_struct, table) & (events | POLLERR | POLLHUP);
+}
+
+int sys_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if (nfds > MAX_TASK_FD) {
+        return -EINVAL;
+    }
+    if (!fds && (nfds > 0)) {
+        return -EFAULT;
+    }
+    task_struct *task = scheduler_get_current_process();
+    int ret;
+    // Check the files, until something is ready, or the timeout expires.
+    do {
+        poll_table_t *table = poll_table_begin(timeout);
+        if (!table) {
+            return -ENOMEM;
+        }
+        int ready = 0;
+        for (nfds_t i = 0; i < nfds; ++i) {
+            fds[i].revents = 0;
+            // Negative descriptors are ignored.
+            if (fds[i].fd < 0) {
+                continue;
+            }
+            fds[i].revents = (short)__poll_fd(task, fds[i].fd, (unsigned short)fds[i].events, table);
+            if (fds[i].revents) {
+                ++ready;
+            }
+        }
+        ret = poll_table_end(table, ready, timeout);
+    } while (ret == -EAGAIN);
+    return ret;
+}
+
+/// The events which make a descriptor ready for reading.
+#define SELECT_READ   (POLLIN | POLLRDNORM | POLLHUP | POLLERR)
+/// The events which make a descriptor ready for writing.
+#define SELECT_WRITE  (POLLOUT | POLLWRNORM | POLLERR)
+/// The events which make a descriptor report an exceptional condition.
+#define SELECT_EXCEPT (POLLPRI)
+
+int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    if ((nfds < 0) || (nfds > FD_SETSIZE)) {
+        return -EINVAL;
+    }
+    // Convert the timeout to milliseconds, rounding up.
+    int timeout_ms = -1;
+    if (timeout) {
+        if ((timeout->tv_sec < 0) || (timeout->tv_usec < 0)) {
+            return -EINVAL;
+        }
+        if (timeout->tv_sec < (INT_MAX / 1000) - 1) {
+            timeout_ms = (timeout->tv_sec * 1000) + ((timeout->tv_usec + 999) / 1000);
+        }
+    }
+    task_struct *task = scheduler_get_current_process();
+    // Check that all the descriptors are open.
+    for (int fd = 0; fd < nfds; ++fd) {
+        if ((readfds && FD_ISSET(fd, readfds)) || (writefds && FD_ISSET(fd, writefds)) ||
+            (exceptfds && FD_ISSET(fd, exceptfds))) {
+            if ((fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+                return -EBADF;
+            }
+        }
+    }
+    // Check the files, until something is ready, or the timeout expires.
+    fd_set rset, wset, eset;
+    int ret;
+    do {
+        poll_table_t *table = poll_table_begin(timeout_ms);
+        if (!table) {
+            return -ENOMEM;
+        }
+        // The sets are modified only when the call returns.
+        FD_ZERO(&rset);
+        FD_ZERO(&wset);
+        FD_ZERO(&eset);
+        int ready = 0;
+        for (int fd = 0; fd < nfds; ++fd) {
+            unsigned int events = 0;
+            if (readfds && FD_ISSET(fd, readfds)) {
+                events |= SELECT_READ;
+            }
+            if (writefds && FD_ISSET(fd, writefds)) {
+                events |= SELECT_WRITE;
+            }
+            if (exceptfds && FD_ISSET(fd, exceptfds)) {
+                events |= SELECT_EXCEPT;
+            }
+            if (events == 0) {
+                continue;
+            }
+            unsigned int revents = vfs_poll(task->files->fd_list[fd].file_struct, table) & events;
+            if (revents & SELECT_READ) {
+                FD_SET(fd, &rset);
+                ++ready;
+            }
+            if (revents & SELECT_WRITE) {
+                FD_SET(fd, &wset);
+                ++ready;
+            }
+            if (revents & SELECT_EXCEPT) {
+                FD_SET(fd, &eset);
+                ++ready;
+            }
+        }
+        ret = poll_table_end(table, ready, timeout_ms);
+    } while (ret == -EAGAIN);
+    if (ret >= 0) {
+        if (readfds) {
+            *readfds = rset;
+        }
+        if (writefds) {
+            *writefds = wset;
+        }
+        if (exceptfds) {
+            *exceptfds = eset;
+        }
+    }
+    return ret;
+}
@@ -12,8 +12,10 @@
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/poll.h"
 #include "fs/procfs.h"
 #include "fs/vfs.h"
+#include "klib/ida.h"
 #include "libgen.h"
 #include "stdio.h"
 #include "string.h"
@@ -24,6 +26,8 @@
 #define PROCFS_NAME_MAX     255U
 /// Maximum number of files in PROCFS.
 #define PROCFS_MAX_FILES    1024U
+/// The number of buckets of the hash table of the paths.
+#define PROCFS_PATH_BUCKETS 256U
 /// The magic number used to check if the procfs file is valid.
 #define PROCFS_MAGIC_NUMBER 0xBF
 
@@ -59,6 +63,10 @@ typedef struct procfs_file {
     list_head_t files;
     /// List of procfs siblings.
     list_head_t siblings;
+    /// Reference inside the bucket of the hash table of the paths, walked under RCU.
+    list_head_t path_bucket;
+    /// Frees the file, once the lookups which might see it have finished.
+    rcu_head_t rcu;
 } procfs_file_t;
 
 /// @brief The details regarding the filesystem.
@@ -70,10 +78,18 @@ typedef struct procfs {
     list_head_t files;
     /// Cache for creating new `procfs_file_t`.
     kmem_cache_t *procfs_file_cache;
+    /// Allocates the inodes of the files.
+    ida_t inodes;
+    /// The files, indexed by their inode.
+    struct procfs_file *by_inode[PROCFS_MAX_FILES];
+    /// The hash table of the paths of the files.
+    list_head_t by_path[PROCFS_PATH_BUCKETS];
 } procfs_t;
 
 /// The procfs filesystem.
 procfs_t fs;
+/// The bitmap of the inodes of the files.
+static uint32_t procfs_inodes[IDA_WORDS(PROCFS_MAX_FILES)];
 
 // ============================================================================
 // Forward Declaration of Functions
@@ -92,6 +108,7 @@ static off_t procfs_lseek(vfs_file_t *file, off_t offset, int whence);
 static int procfs_fstat(vfs_file_t *file, stat_t *stat);
 static long procfs_ioctl(vfs_file_t *file, unsigned int request, unsigned long data);
 static ssize_t procfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_t count);
+static unsigned int procfs_poll(vfs_file_t *file, poll_table_t *table);
 
 // ============================================================================
 // Virtual FileSystem (VFS) Operaions
@@ -118,6 +135,7 @@ static vfs_file_operations_t procfs_fs_operations = {
     .ioctl_f    = procfs_ioctl,
     .getdents_f = procfs_getdents,
     .readlink_f = NULL,
+    .poll_f     = procfs_poll,
 };
 
 // ============================================================================
@@ -149,23 +167,35 @@ static inline procfs_file_t *procfs_get_file(list_head_t *entry)
     return NULL;
 }
 
+/// @brief Returns the bucket of the hash table of the paths.
+/// @param path the path.
+/// @return the bucket.
+static inline list_head_t *procfs_path_bucket(const char *path)
+{
+    unsigned int hash = 5381;
+    while (*path) {
+        hash = ((hash << 5) + hash) + (unsigned char)*path++;
+    }
+    return &fs.by_path[hash % PROCFS_PATH_BUCKETS];
+}
+
 /// @brief Finds the PROCFS file at the given path.
 /// @param path the path to the entry.
 /// @return a pointer to the PROCFS file, NULL otherwise.
 static inline procfs_file_t *procfs_find_entry_path(const char *path)
 {
-    procfs_file_t *procfs_file;
-    if (!list_head_empty(&fs.files)) {
-        list_for_each_decl (it, &fs.files) {
-            // Get the file structure.
-            procfs_file = procfs_get_file(it);
-            // Check its name.
-            if (procfs_file && !strcmp(procfs_file->name, path)) {
-                return procfs_file;
-            }
+    list_head_t *bucket  = procfs_path_bucket(path);
+    procfs_file_t *found = NULL;
+    rcu_read_lock();
+    list_for_each_rcu (it, bucket) {
+        procfs_file_t *procfs_file = list_entry(it, procfs_file_t, path_bucket);
+        if (procfs_check_file(procfs_file) && !strcmp(procfs_file->name, path)) {
+            found = procfs_file;
+            break;
         }
     }
-    return NULL;
+    rcu_read_unlock();
+    return found;
 }
 
 /// @brief Finds the PROCFS file with the given inode.
@@ -173,18 +203,23 @@ static inline procfs_file_t *procfs_find_entry_path(const char *path)
 /// @return a pointer to the PROCFS file, NULL otherwise.
 static inline procfs_file_t *procfs_find_entry_inode(uint32_t inode)
 {
-    procfs_file_t *procfs_file;
-    if (!list_head_empty(&fs.files)) {
-        list_for_each_decl (it, &fs.files) {
-            // Get the file structure.
-            procfs_file = procfs_get_file(it);
-            // Check its inode.
-            if (procfs_file && (procfs_file->inode == inode)) {
-                return procfs_file;
-            }
-        }
+    if (inode >= PROCFS_MAX_FILES) {
+        return NULL;
     }
-    return NULL;
+    return fs.by_inode[inode];
+}
+
+/// @brief Finds the PROCFS file at the given path, creating on demand the
+///        entries of the process it belongs to.
+/// @param path the path to the entry.
+/// @return a pointer to the PROCFS file, NULL otherwise.
+static inline procfs_file_t *procfs_lookup_entry_path(const char *path)
+{
+    procfs_file_t *procfs_file = procfs_find_entry_path(path);
+    if (!procfs_file && (procr_create_entry_path(path) == 0)) {
+        procfs_file = procfs_find_entry_path(path);
+    }
+    return procfs_file;
 }
 
 /// @brief Finds the inode associated with a PROCFS file at the given path.
@@ -201,15 +236,7 @@ static inline int procfs_find_inode(const char *path)
 
 /// @brief Finds a free inode.
 /// @return the free inode index, or -1 on failure.
-static inline int procfs_get_free_inode(void)
-{
-    for (int inode = 1; inode < PROCFS_MAX_FILES; ++inode) {
-        if (procfs_find_entry_inode(inode) == NULL) {
-            return inode;
-        }
-    }
-    return -1;
-}
+static inline int procfs_get_free_inode(void) { return ida_alloc(&fs.inodes); }
 
 /// @brief Checks if the PROCFS directory at the given path is empty.
 /// @param path the path to the directory.
@@ -259,6 +286,11 @@ static inline procfs_file_t *procfs_create_file(const char *path, unsigned flags
     procfs_file->magic = PROCFS_MAGIC_NUMBER;
     // Initialize the inode.
     procfs_file->inode = procfs_get_free_inode();
+    if (procfs_file->inode < 0) {
+        pr_err("Failed to get a free inode for `%s`.\n", path);
+        kmem_cache_free(procfs_file);
+        return NULL;
+    }
     // Flags.
     procfs_file->flags = flags;
     // The name of the file.
@@ -269,6 +301,9 @@ static inline procfs_file_t *procfs_create_file(const char *path, unsigned flags
     list_head_init(&procfs_file->siblings);
     // Add the file to the list of opened files.
     list_head_insert_before(&procfs_file->siblings, &fs.files);
+    // Index the file by its path, and by its inode.
+    list_head_insert_before_rcu(&procfs_file->path_bucket, procfs_path_bucket(procfs_file->name));
+    fs.by_inode[procfs_file->inode] = procfs_file;
     // Time of last access.
     procfs_file->atime                    = sys_time(NULL);
     // Time of last data modification.
@@ -286,6 +321,10 @@ static inline procfs_file_t *procfs_create_file(const char *path, unsigned flags
     return procfs_file;
 }
 
+/// @brief Frees a PROCFS file, once the lookups have left it.
+/// @param head the head inside the file.
+static void procfs_free_file(rcu_head_t *head) { kmem_cache_free(container_of(head, procfs_file_t, rcu)); }
+
 /// @brief Destroyes the given PROCFS file.
 /// @param procfs_file pointer to the PROCFS file to destroy.
 /// @return 0 on success, 1 on failure.
@@ -298,8 +337,14 @@ static inline int procfs_destroy_file(procfs_file_t *procfs_file)
     pr_debug("procfs_destroy_file(%p) `%s`\n", procfs_file, procfs_file->name);
     // Remove the file from the list of opened files.
     list_head_remove(&procfs_file->siblings);
-    // Free the cache.
-    kmem_cache_free(procfs_file);
+    // Remove the file from the indexes, and give the inode back.
+    list_head_remove_rcu(&procfs_file->path_bucket);
+    if (procfs_file->inode > 0) {
+        fs.by_inode[procfs_file->inode] = NULL;
+        ida_free(&fs.inodes, procfs_file->inode);
+    }
+    // Free the cache, once the lookups have left the file.
+    call_rcu(&procfs_file->rcu, procfs_free_file);
     // Decrease the number of files.
     --fs.nfiles;
     return 0;
@@ -445,7 +490,7 @@ static vfs_file_t *procfs_open(const char *path, int flags, mode_t mode)
     // Get the parent path.
     // Check if the directories before it exist.
     if ((strcmp(parent_path, ".") != 0) && (strcmp(parent_path, "/") != 0)) {
-        procfs_file_t *parent_file = procfs_find_entry_path(parent_path);
+        procfs_file_t *parent_file = procfs_lookup_entry_path(parent_path);
         if (parent_file == NULL) {
             pr_err("Cannot find parent `%s`.\n", parent_path);
             errno = ENOENT;
@@ -458,7 +503,7 @@ static vfs_file_t *procfs_open(const char *path, int flags, mode_t mode)
         }
     }
     // Find the entry.
-    procfs_file_t *procfs_file = procfs_find_entry_path(path);
+    procfs_file_t *procfs_file = procfs_lookup_entry_path(path);
     if (procfs_file != NULL) {
         // Check if the user wants to create a file.
         if (bitmask_check(flags, O_CREAT | O_EXCL)) {
@@ -620,6 +665,23 @@ static ssize_t procfs_read(vfs_file_t *file, char *buffer, off_t offset, size_t
     return -ENOSYS;
 }
 
+/// @brief Reports the readiness of the file identified by the file descriptor.
+/// @param file The file.
+/// @param table The poll table.
+/// @return The events reported by the entry, entries which cannot be polled are always ready.
+static unsigned int procfs_poll(vfs_file_t *file, poll_table_t *table)
+{
+    if (file) {
+        procfs_file_t *procfs_file = procfs_find_entry_inode(file->ino);
+        if (procfs_file && procfs_file->dir_entry.fs_operations) {
+            if (procfs_file->dir_entry.fs_operations->poll_f) {
+                return procfs_file->dir_entry.fs_operations->poll_f(file, table);
+            }
+        }
+    }
+    return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+}
+
 /// @brief Writes the given content inside the file.
 /// @param file The file descriptor of the file.
 /// @param buffer The content to write.
@@ -726,7 +788,7 @@ static int procfs_fstat(vfs_file_t *file, stat_t *stat)
 static int procfs_stat(const char *path, stat_t *stat)
 {
     if (path && stat) {
-        procfs_file_t *procfs_file = procfs_find_entry_path(path);
+        procfs_file_t *procfs_file = procfs_lookup_entry_path(path);
         if (procfs_file) {
             if (procfs_file->dir_entry.sys_operations && procfs_file->dir_entry.sys_operations->stat_f) {
                 return procfs_file->dir_entry.sys_operations->stat_f(path, stat);
@@ -787,6 +849,10 @@ static inline ssize_t procfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t do
     if ((direntry->flags & DT_DIR) == 0) {
         return -ENOTDIR;
     }
+    // The folders of the processes are created when they are first listed.
+    if ((doff == 0) && !strcmp(direntry->name, "/proc")) {
+        procr_create_entries();
+    }
     // Clear the buffer.
     memset(dirp, 0, count);
     // Initialize, the length of the directory name.
@@ -854,8 +920,9 @@ static vfs_file_t *procfs_mount(vfs_file_t *block_device, const char *path) { re
 /// @brief Mounts the filesystem at the given path.
 /// @param path the path where we want to mount a procfs.
 /// @param device we expect it to be NULL.
+/// @param options the mount options, unused.
 /// @return a pointer to the root VFS file.
-static vfs_file_t *procfs_mount_callback(const char *path, const char *device)
+static vfs_file_t *procfs_mount_callback(const char *path, const char *device, const char *options)
 {
     pr_debug("procfs_mount_callback(%s, %s)\n", path, device);
     // Create the new procfs file.
@@ -881,6 +948,13 @@ int procfs_module_init(void)
     fs.procfs_file_cache = KMEM_CREATE(procfs_file_t);
     // Initialize the list of procfs files.
     list_head_init(&fs.files);
+    // Initialize the hash table of the paths.
+    for (unsigned int i = 0; i < PROCFS_PATH_BUCKETS; ++i) {
+        list_head_init(&fs.by_path[i]);
+    }
+    // Initialize the inodes, starting from 1.
+    ida_init(&fs.inodes, procfs_inodes, PROCFS_MAX_FILES);
+    ida_mark_used(&fs.inodes, 0);
     // Register the filesystem.
     vfs_register_filesystem(&procfs_file_system_type);
     return 0;
@@ -911,7 +985,7 @@ proc_dir_entry_t *proc_dir_entry_get(const char *name, proc_dir_entry_t *parent)
     // Get the procfs entry.
     procfs_file_t *procfs_file = procfs_find_entry_path(entry_path);
     if (procfs_file == NULL) {
-        pr_err("proc_dir_entry_get(%s): Cannot find proc entry.\n", entry_path);
+        pr_debug("proc_dir_entry_get(%s): Cannot find proc entry.\n", entry_path);
         return NULL;
     }
     return &procfs_file->dir_entry;
@@ -7,22 +7,95 @@
 #include "fcntl.h"
 #include "fs/vfs.h"
 #include "fs/vfs_types.h"
+#include "limits.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
 #include "process/scheduler.h"
 #include "stdio.h"
+#include "sys/stat.h"
 #include "system/panic.h"
 
+/// Size of the kernel buffer used to move data between two files.
+#define COPY_CHUNK_SIZE 16384
+
+/// @brief Reads from the file of a descriptor, bypassing the caches if the
+/// descriptor has been opened with O_DIRECT.
+/// @param file the file.
+/// @param flags the flags of the descriptor.
+/// @param buf the buffer where the data is stored.
+/// @param offset the offset from which the data is read.
+/// @param nbytes the number of bytes to read.
+/// @return the number of read bytes, -errno on failure.
+static inline ssize_t __fd_read(vfs_file_t *file, int flags, void *buf, size_t offset, size_t nbytes)
+{
+    if (bitmask_check(flags, O_DIRECT)) {
+        struct iovec iov = { .iov_base = buf, .iov_len = nbytes };
+        return vfs_readv_direct(file, &iov, 1, offset);
+    }
+    return vfs_read(file, buf, offset, nbytes);
+}
+
+/// @brief Writes to the file of a descriptor, bypassing the caches if the
+/// descriptor has been opened with O_DIRECT.
+/// @param file the file.
+/// @param flags the flags of the descriptor.
+/// @param buf the data to write.
+/// @param offset the offset from which the data is written.
+/// @param nbytes the number of bytes to write.
+/// @return the number of written bytes, -errno on failure.
+static inline ssize_t __fd_write(vfs_file_t *file, int flags, const void *buf, size_t offset, size_t nbytes)
+{
+    if (bitmask_check(flags, O_DIRECT)) {
+        struct iovec iov = { .iov_base = (void *)buf, .iov_len = nbytes };
+        return vfs_writev_direct(file, &iov, 1, offset);
+    }
+    return vfs_write(file, buf, offset, nbytes);
+}
+
+/// @brief Reads from the file of a descriptor into multiple buffers, bypassing
+/// the caches if the descriptor has been opened with O_DIRECT.
+/// @param file the file.
+/// @param flags the flags of the descriptor.
+/// @param iov the buffers, filled in order.
+/// @param iovcnt the number of buffers.
+/// @param offset the offset from which the data is read.
+/// @return the number of read bytes, -errno on failure.
+static inline ssize_t __fd_readv(vfs_file_t *file, int flags, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    if (bitmask_check(flags, O_DIRECT)) {
+        return vfs_readv_direct(file, iov, iovcnt, offset);
+    }
+    return vfs_readv(file, iov, iovcnt, offset);
+}
+
+/// @brief Writes to the file of a descriptor from multiple buffers, bypassing
+/// the caches if the descriptor has been opened with O_DIRECT.
+/// @param file the file.
+/// @param flags the flags of the descriptor.
+/// @param iov the buffers, written in order.
+/// @param iovcnt the number of buffers.
+/// @param offset the offset from which the data is written.
+/// @return the number of written bytes, -errno on failure.
+static inline ssize_t __fd_writev(vfs_file_t *file, int flags, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    if (bitmask_check(flags, O_DIRECT)) {
+        return vfs_writev_direct(file, iov, iovcnt, offset);
+    }
+    return vfs_writev(file, iov, iovcnt, offset);
+}
+
 ssize_t sys_read(int fd, void *buf, size_t nbytes)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
 
     // Check the permissions.
 #if 0
@@ -37,7 +110,7 @@ ssize_t sys_read(int fd, void *buf, size_t nbytes)
     }
 
     // Perform the read.
-    int read = vfs_read(vfd->file_struct, buf, vfd->file_struct->f_pos, nbytes);
+    int read = __fd_read(vfd->file_struct, vfd->flags_mask, buf, vfd->file_struct->f_pos, nbytes);
 
     // Update the offset.
     if (read > 0) {
@@ -52,12 +125,12 @@ ssize_t sys_write(int fd, const void *buf, size_t nbytes)
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
 
     // Check the permissions.
     if (!bitmask_check(vfd->flags_mask, O_WRONLY | O_RDWR)) {
@@ -70,7 +143,7 @@ ssize_t sys_write(int fd, const void *buf, size_t nbytes)
     }
 
     // Perform the write.
-    int written = vfs_write(vfd->file_struct, buf, vfd->file_struct->f_pos, nbytes);
+    int written = __fd_write(vfd->file_struct, vfd->flags_mask, buf, vfd->file_struct->f_pos, nbytes);
 
     // Update the offset.
     if (written > 0) {
@@ -79,14 +152,359 @@ ssize_t sys_write(int fd, const void *buf, size_t nbytes)
     return written;
 }
 
+/// @brief Retrieves the file associated with a file descriptor of the current task.
+/// @param fd the file descriptor.
+/// @param write if the file is going to be written (1) or read (0).
+/// @param file the output variable where we store the file.
+/// @param flags the output variable where we store the flags of the descriptor, if not NULL.
+/// @return 0 on success, -errno on failure.
+static inline int __get_fd_file(int fd, int write, vfs_file_t **file, int *flags)
+{
+    // Get the current task.
+    task_struct *task = scheduler_get_current_process();
+    // Check the current FD.
+    if ((fd < 0) || (fd >= task->files->max_fd)) {
+        return -EBADF;
+    }
+    // Get the file descriptor.
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
+    // Check the permissions.
+    if (write && !bitmask_check(vfd->flags_mask, O_WRONLY | O_RDWR)) {
+        return -EROFS;
+    }
+    // Check the file.
+    if (vfd->file_struct == NULL) {
+        return -EBADF;
+    }
+    *file = vfd->file_struct;
+    if (flags) {
+        *flags = vfd->flags_mask;
+    }
+    return 0;
+}
+
+/// @brief Checks the vector of buffers passed to a vectored I/O operation.
+/// @param iov the buffers.
+/// @param iovcnt the number of buffers.
+/// @return 0 if the vector is valid, -errno otherwise.
+static inline int __check_iovec(const struct iovec *iov, int iovcnt)
+{
+    if ((iovcnt < 0) || (iovcnt > IOV_MAX) || (iovcnt && !iov)) {
+        return -EINVAL;
+    }
+    // The total size must be representable by the return value.
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len && !iov[i].iov_base) {
+            return -EFAULT;
+        }
+        if (iov[i].iov_len > (size_t)LONG_MAX - total) {
+            return -EINVAL;
+        }
+        total += iov[i].iov_len;
+    }
+    return 0;
+}
+
+ssize_t sys_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 0, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = __check_iovec(iov, iovcnt)) < 0) {
+        return ret;
+    }
+    // Perform the read.
+    ssize_t read = __fd_readv(file, flags, iov, iovcnt, file->f_pos);
+    // Update the offset.
+    if (read > 0) {
+        file->f_pos += read;
+    }
+    return read;
+}
+
+ssize_t sys_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 1, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = __check_iovec(iov, iovcnt)) < 0) {
+        return ret;
+    }
+    // Perform the write.
+    ssize_t written = __fd_writev(file, flags, iov, iovcnt, file->f_pos);
+    // Update the offset.
+    if (written > 0) {
+        file->f_pos += written;
+    }
+    return written;
+}
+
+ssize_t sys_pread(int fd, void *buf, size_t nbytes, off_t offset)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 0, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    // Pipes have no offset.
+    if (S_ISFIFO(file->flags)) {
+        return -ESPIPE;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    return __fd_read(file, flags, buf, offset, nbytes);
+}
+
+ssize_t sys_pwrite(int fd, const void *buf, size_t nbytes, off_t offset)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 1, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    // Pipes have no offset.
+    if (S_ISFIFO(file->flags)) {
+        return -ESPIPE;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    return __fd_write(file, flags, buf, offset, nbytes);
+}
+
+ssize_t sys_preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 0, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    // Pipes have no offset.
+    if (S_ISFIFO(file->flags)) {
+        return -ESPIPE;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    if ((ret = __check_iovec(iov, iovcnt)) < 0) {
+        return ret;
+    }
+    return __fd_readv(file, flags, iov, iovcnt, offset);
+}
+
+ssize_t sys_pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    vfs_file_t *file;
+    int flags;
+    int ret = __get_fd_file(fd, 1, &file, &flags);
+    if (ret < 0) {
+        return ret;
+    }
+    // Pipes have no offset.
+    if (S_ISFIFO(file->flags)) {
+        return -ESPIPE;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    if ((ret = __check_iovec(iov, iovcnt)) < 0) {
+        return ret;
+    }
+    return __fd_writev(file, flags, iov, iovcnt, offset);
+}
+
+/// @brief Moves data between two files, through a kernel buffer.
+/// @param in the file we read from.
+/// @param in_pos the offset we read from, upon return it follows the copied data.
+/// @param out the file we write to.
+/// @param out_pos the offset we write to, upon return it follows the copied data.
+/// @param count the number of bytes to copy.
+/// @return the number of copied bytes, -errno on failure.
+static ssize_t __copy_file_data(vfs_file_t *in, off_t *in_pos, vfs_file_t *out, off_t *out_pos, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    char *buffer = kmalloc(min(count, COPY_CHUNK_SIZE));
+    if (!buffer) {
+        return -ENOMEM;
+    }
+    ssize_t total = 0;
+    while ((size_t)total < count) {
+        size_t chunk  = min(count - total, COPY_CHUNK_SIZE);
+        ssize_t nread = vfs_read(in, buffer, *in_pos, chunk);
+        if (nread <= 0) {
+            total = (total > 0) ? total : nread;
+            break;
+        }
+        ssize_t nwritten = vfs_write(out, buffer, *out_pos, nread);
+        if (nwritten <= 0) {
+            total = (total > 0) ? total : nwritten;
+            break;
+        }
+        // Only the data which reached the output counts as copied.
+        *in_pos += nwritten;
+        *out_pos += nwritten;
+        total += nwritten;
+        // Stop at the end of the input, or when the output is full.
+        if ((nwritten < nread) || ((size_t)nread < chunk)) {
+            break;
+        }
+    }
+    kfree(buffer);
+    return total;
+}
+
+ssize_t sys_sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+    vfs_file_t *in, *out;
+    int ret = __get_fd_file(in_fd, 0, &in, NULL);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = __get_fd_file(out_fd, 1, &out, NULL)) < 0) {
+        return ret;
+    }
+    if (offset && ((*offset < 0) || S_ISFIFO(in->flags))) {
+        return (*offset < 0) ? -EINVAL : -ESPIPE;
+    }
+    // Read from the given offset, or from the file offset.
+    off_t in_pos   = offset ? *offset : in->f_pos;
+    off_t out_pos  = out->f_pos;
+    ssize_t copied = __copy_file_data(in, &in_pos, out, &out_pos, count);
+    if (copied > 0) {
+        if (offset) {
+            *offset = in_pos;
+        } else {
+            in->f_pos = in_pos;
+        }
+        out->f_pos = out_pos;
+    }
+    return copied;
+}
+
+ssize_t sys_copy_file_range(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len)
+{
+    vfs_file_t *in, *out;
+    int ret = __get_fd_file(fd_in, 0, &in, NULL);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((ret = __get_fd_file(fd_out, 1, &out, NULL)) < 0) {
+        return ret;
+    }
+    // Only files can be copied, not pipes or directories.
+    if (S_ISDIR(in->flags) || S_ISDIR(out->flags)) {
+        return -EISDIR;
+    }
+    if (S_ISFIFO(in->flags) || S_ISFIFO(out->flags)) {
+        return -EINVAL;
+    }
+    if ((off_in && (*off_in < 0)) || (off_out && (*off_out < 0))) {
+        return -EINVAL;
+    }
+    // Use the given offsets, or the file offsets.
+    off_t in_pos  = off_in ? *off_in : in->f_pos;
+    off_t out_pos = off_out ? *off_out : out->f_pos;
+    // The ranges cannot overlap inside the same file.
+    if ((in == out) && (in_pos < out_pos + (off_t)len) && (out_pos < in_pos + (off_t)len)) {
+        return -EINVAL;
+    }
+    ssize_t copied = __copy_file_data(in, &in_pos, out, &out_pos, len);
+    if (copied > 0) {
+        if (off_in) {
+            *off_in = in_pos;
+        } else {
+            in->f_pos = in_pos;
+        }
+        if (off_out) {
+            *off_out = out_pos;
+        } else {
+            out->f_pos = out_pos;
+        }
+    }
+    return copied;
+}
+
+int sys_sync(void)
+{
+    vfs_sync();
+    return 0;
+}
+
+int sys_fsync(int fd)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (fd < 0 || fd >= task->files->max_fd) {
+        return -EBADF;
+    }
+    // Get the file descriptor.
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
+    // Check the file.
+    if (vfd->file_struct == NULL) {
+        return -EBADF;
+    }
+    // Flush the file.
+    return vfs_fsync(vfd->file_struct);
+}
+
+int sys_ftruncate(int fd, off_t length)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (fd < 0 || fd >= task->files->max_fd) {
+        return -EBADF;
+    }
+    // Get the file descriptor.
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
+    // Check the file, which must be open for writing.
+    if (vfd->file_struct == NULL) {
+        return -EBADF;
+    }
+    if ((vfd->flags_mask & O_ACCMODE) == O_RDONLY) {
+        return -EINVAL;
+    }
+    // Change the size of the file.
+    return vfs_truncate(vfd->file_struct, length);
+}
+
+int sys_fadvise64(int fd, off_t offset, off_t len, int advice)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (fd < 0 || fd >= task->files->max_fd) {
+        return -EBADF;
+    }
+    // Get the file descriptor.
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
+    // Check the file.
+    if (vfd->file_struct == NULL) {
+        return -EBADF;
+    }
+    // Pipes have nothing to read ahead.
+    if (S_ISFIFO(vfd->file_struct->flags)) {
+        return -ESPIPE;
+    }
+    return vfs_fadvise(vfd->file_struct, offset, len, advice);
+}
+
 off_t sys_lseek(int fd, off_t offset, int whence)
 {
     task_struct *task = scheduler_get_current_process();
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -1;
     }
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
     // Check the file.
     if (vfd->file_struct == NULL) {
         return -ENOSYS;
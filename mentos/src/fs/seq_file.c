@@ -0,0 +1,254 @@
+/// @file seq_file.c
+/// @brief Streaming of the content of virtual files, one record at a time.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SEQFIL]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/seq_file.h"
+
+#include "errno.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/paging.h"
+#include "stdarg.h"
+#include "stdio.h"
+#include "string.h"
+
+/// The largest buffer of a file, a single record cannot be longer.
+#define SEQ_MAX_BUFSIZE (64U * PAGE_SIZE)
+
+/// @brief Returns the streaming state of the file, allocating it on the first read.
+/// @param file the open file.
+/// @param op the iterator over the records.
+/// @return the streaming state, NULL if it cannot be allocated.
+static seq_file_t *__seq_get(vfs_file_t *file, const seq_operations_t *op)
+{
+    if (file->seq) {
+        return file->seq;
+    }
+    seq_file_t *m = kmalloc(sizeof(seq_file_t));
+    if (!m) {
+        return NULL;
+    }
+    memset(m, 0, sizeof(seq_file_t));
+    if (!(m->buf = kmalloc(PAGE_SIZE))) {
+        kfree(m);
+        return NULL;
+    }
+    m->size   = PAGE_SIZE;
+    m->op     = op;
+    m->file   = file;
+    file->seq = m;
+    return m;
+}
+
+/// @brief Doubles the buffer, dropping its content.
+/// @param m the streaming state.
+/// @return 0 on success, -ENOMEM on failure.
+static int __seq_grow(seq_file_t *m)
+{
+    if ((m->size * 2) > SEQ_MAX_BUFSIZE) {
+        pr_err("A record of `%s` is longer than %u bytes.\n", m->file->name, SEQ_MAX_BUFSIZE);
+        return -ENOMEM;
+    }
+    char *buf = kmalloc(m->size * 2);
+    if (!buf) {
+        return -ENOMEM;
+    }
+    kfree(m->buf);
+    m->buf   = buf;
+    m->size  = m->size * 2;
+    m->count = 0;
+    m->from  = 0;
+    return 0;
+}
+
+/// @brief Checks if the last record did not fit inside the buffer.
+/// @param m the streaming state.
+/// @return 1 if it did not, 0 otherwise.
+static inline int __seq_overflowed(seq_file_t *m) { return m->count == m->size; }
+
+/// @brief Formats the records which follow those already read, until the buffer is full.
+/// @param m the streaming state, whose buffer has been read entirely.
+/// @return 0 on success (the buffer is left empty past the last record), -errno on failure.
+static int __seq_fill(seq_file_t *m)
+{
+    m->count = 0;
+    m->from  = 0;
+    void *v  = m->op->start(m, &m->index);
+    while (v) {
+        size_t count = m->count;
+        int ret      = m->op->show(m, v);
+        if (ret < 0) {
+            m->op->stop(m, v);
+            m->count = count;
+            return ret;
+        }
+        if (__seq_overflowed(m)) {
+            m->count = count;
+            // The record is formatted again by the next fill.
+            if (count) {
+                break;
+            }
+            // The record alone does not fit, start again with a larger buffer.
+            m->op->stop(m, v);
+            if ((ret = __seq_grow(m)) < 0) {
+                return ret;
+            }
+            v = m->op->start(m, &m->index);
+            continue;
+        }
+        v = m->op->next(m, v, &m->index);
+    }
+    m->op->stop(m, v);
+    return 0;
+}
+
+/// @brief Moves the reading position forward, formatting the records when the buffer is empty.
+/// @param m the streaming state.
+/// @param buf where the bytes are copied, NULL if they are skipped.
+/// @param nbyte the number of bytes.
+/// @return the number of bytes, fewer at the end of the file, or -errno on failure.
+static ssize_t __seq_advance(seq_file_t *m, char *buf, size_t nbyte)
+{
+    size_t done = 0;
+    while (done < nbyte) {
+        if (m->from == m->count) {
+            int ret = __seq_fill(m);
+            if (ret < 0) {
+                return done ? (ssize_t)done : ret;
+            }
+            if (m->count == 0) {
+                break;
+            }
+        }
+        size_t length = min(m->count - m->from, nbyte - done);
+        if (buf) {
+            memcpy(buf + done, m->buf + m->from, length);
+        }
+        m->from += length;
+        m->read_pos += length;
+        done += length;
+    }
+    return (ssize_t)done;
+}
+
+ssize_t seq_read(vfs_file_t *file, const seq_operations_t *op, char *buf, off_t offset, size_t nbyte)
+{
+    if (!file || !op || (offset < 0)) {
+        return -EINVAL;
+    }
+    seq_file_t *m = __seq_get(file, op);
+    if (!m) {
+        pr_err("Failed to allocate the buffer of `%s`.\n", file->name);
+        return -ENOMEM;
+    }
+    // A read at another offset starts again from the first record.
+    if (offset != m->read_pos) {
+        m->index    = 0;
+        m->read_pos = 0;
+        m->count    = 0;
+        m->from     = 0;
+        ssize_t ret = __seq_advance(m, NULL, offset);
+        if ((ret < 0) || (ret < offset)) {
+            return (ret < 0) ? ret : 0;
+        }
+    }
+    return __seq_advance(m, buf, nbyte);
+}
+
+/// @brief Returns the only record, at the first position.
+/// @param m the streaming state.
+/// @param pos the position.
+/// @return a token standing for the record, NULL past it.
+static void *__seq_single_start(seq_file_t *m, off_t *pos) { return (*pos == 0) ? m : NULL; }
+
+/// @brief Moves past the only record.
+/// @param m the streaming state.
+/// @param v the record.
+/// @param pos the position.
+/// @return NULL.
+static void *__seq_single_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return NULL;
+}
+
+/// @brief Stops the iteration over the only record.
+/// @param m the streaming state.
+/// @param v the record.
+static void __seq_single_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats the only record.
+/// @param m the streaming state.
+/// @param v the record.
+/// @return 0 on success, -errno on failure.
+static int __seq_single_show(seq_file_t *m, void *v) { return m->single_show(m, NULL); }
+
+/// The iterator of the files made of a single record.
+static const seq_operations_t seq_single_operations = {
+    .start = __seq_single_start,
+    .stop  = __seq_single_stop,
+    .next  = __seq_single_next,
+    .show  = __seq_single_show,
+};
+
+ssize_t seq_read_single(vfs_file_t *file, int (*show)(seq_file_t *, void *), char *buf, off_t offset, size_t nbyte)
+{
+    if (!file || !show) {
+        return -EINVAL;
+    }
+    seq_file_t *m = __seq_get(file, &seq_single_operations);
+    if (!m) {
+        pr_err("Failed to allocate the buffer of `%s`.\n", file->name);
+        return -ENOMEM;
+    }
+    m->single_show = show;
+    return seq_read(file, &seq_single_operations, buf, offset, nbyte);
+}
+
+int seq_release(vfs_file_t *file)
+{
+    if (file && file->seq) {
+        kfree(file->seq->buf);
+        kfree(file->seq);
+        file->seq = NULL;
+    }
+    return 0;
+}
+
+int seq_printf(seq_file_t *m, const char *format, ...)
+{
+    if (__seq_overflowed(m)) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(m->buf + m->count, m->size - m->count, format, args);
+    va_end(args);
+    seq_commit(m, length);
+    return __seq_overflowed(m) ? -1 : 0;
+}
+
+int seq_puts(seq_file_t *m, const char *s) { return seq_printf(m, "%s", s); }
+
+char *seq_get_buf(seq_file_t *m, size_t *size)
+{
+    *size = m->size - m->count;
+    return m->buf + m->count;
+}
+
+void seq_commit(seq_file_t *m, int length)
+{
+    // The text fits only if there is room left for its terminator.
+    if ((length < 0) || ((size_t)length >= (m->size - m->count))) {
+        m->count = m->size;
+    } else {
+        m->count += length;
+    }
+}
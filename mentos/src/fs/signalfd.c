@@ -0,0 +1,216 @@
+/// @file signalfd.c
+/// @brief Reception of signals through a file descriptor.
+/// @details
+/// A signalfd is a file, whose device holds a set of signals: reads take the
+/// pending signals of the set from the reader, as many as fit inside the
+/// buffer, without running their handlers, and wait until one of them is
+/// pending. Readers and pollers sleep on the wait queue of the signal
+/// handlers of the task, which is woken up whenever a signal is sent to it.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SIGNFD]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "sys/signalfd.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/poll.h"
+#include "fs/vfs.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "system/signal.h"
+#include "time.h"
+
+/// @brief A signalfd.
+typedef struct signalfd_ctx {
+    /// The signals which are read.
+    sigset_t mask;
+} signalfd_ctx_t;
+
+static int signalfd_file_close(vfs_file_t *file);
+static ssize_t signalfd_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static int signalfd_file_fstat(vfs_file_t *file, stat_t *stat);
+static long signalfd_file_fcntl(vfs_file_t *file, unsigned int request, unsigned long data);
+static unsigned int signalfd_file_poll(vfs_file_t *file, poll_table_t *table);
+
+/// Signalfd file operations.
+static vfs_file_operations_t signalfd_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = signalfd_file_close,
+    .read_f     = signalfd_file_read,
+    .write_f    = NULL,
+    .lseek_f    = NULL,
+    .stat_f     = signalfd_file_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = signalfd_file_fcntl,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = signalfd_file_poll,
+};
+
+/// @brief Closes a signalfd, freeing it with the last reference.
+/// @param file the file of the signalfd.
+/// @return 0 on success.
+static int signalfd_file_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        kfree(file->device);
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Fills the information read from a signalfd.
+/// @param ssi where the information is stored.
+/// @param info the information of the signal.
+static inline void __signalfd_fill(signalfd_siginfo_t *ssi, const siginfo_t *info)
+{
+    memset(ssi, 0, sizeof(signalfd_siginfo_t));
+    ssi->ssi_signo  = info->si_signo;
+    ssi->ssi_errno  = info->si_errno;
+    ssi->ssi_code   = info->si_code;
+    ssi->ssi_pid    = info->si_pid;
+    ssi->ssi_uid    = info->si_uid;
+    ssi->ssi_band   = info->si_band;
+    ssi->ssi_status = info->si_status;
+    ssi->ssi_int    = info->si_value.sival_int;
+    ssi->ssi_ptr    = (uint32_t)info->si_value.sival_ptr;
+    ssi->ssi_addr   = (uint32_t)info->si_addr;
+}
+
+/// @brief Takes the pending signals of the set, waiting until there is one.
+/// @param file the file of the signalfd.
+/// @param buffer where the information of the signals is stored.
+/// @param offset not used.
+/// @param nbyte the size of the buffer, at least the size of one signal.
+/// @return the size of the signals read, or a negative error code.
+static ssize_t signalfd_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    signalfd_ctx_t *ctx = (signalfd_ctx_t *)file->device;
+    task_struct *task   = scheduler_get_current_process();
+    siginfo_t info;
+    if (nbyte < sizeof(signalfd_siginfo_t)) {
+        return -EINVAL;
+    }
+    while (!signal_pending_in(task, &ctx->mask)) {
+        if (bitmask_check(file->flags, O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&task->sighand->signal_wait) < 0) {
+            return -EINTR;
+        }
+    }
+    // Take as many signals as the buffer can hold.
+    size_t count = 0;
+    while (((count + sizeof(signalfd_siginfo_t)) <= nbyte) && signal_dequeue(task, &ctx->mask, &info)) {
+        __signalfd_fill((signalfd_siginfo_t *)(buffer + count), &info);
+        count += sizeof(signalfd_siginfo_t);
+    }
+    return count;
+}
+
+/// @brief Retrieves the status of a signalfd.
+/// @param file the file of the signalfd.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int signalfd_file_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = 0600;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Gets, or sets, the flags of a signalfd.
+/// @param file the file of the signalfd.
+/// @param request the request (F_GETFL or F_SETFL).
+/// @param data the new flags, only O_NONBLOCK can be changed.
+/// @return the flags for F_GETFL, 0 for F_SETFL, -EINVAL for other requests.
+static long signalfd_file_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    switch (request) {
+    case F_GETFL:
+        return file->flags;
+    case F_SETFL:
+        file->flags = (file->flags & ~O_NONBLOCK) | (data & O_NONBLOCK);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief Reports the readiness of a signalfd, for the task polling it.
+/// @param file the file of the signalfd.
+/// @param table the poll table.
+/// @return POLLIN if one of the signals is pending.
+static unsigned int signalfd_file_poll(vfs_file_t *file, poll_table_t *table)
+{
+    signalfd_ctx_t *ctx = (signalfd_ctx_t *)file->device;
+    task_struct *task   = scheduler_get_current_process();
+    poll_wait(&task->sighand->signal_wait, table);
+    return signal_pending_in(task, &ctx->mask) ? (POLLIN | POLLRDNORM) : 0;
+}
+
+int sys_signalfd4(int fd, const sigset_t *mask, size_t sizemask, int flags)
+{
+    if ((flags & ~SFD_NONBLOCK) || (sizemask != sizeof(sigset_t))) {
+        return -EINVAL;
+    }
+    if (!mask) {
+        return -EFAULT;
+    }
+    task_struct *task = scheduler_get_current_process();
+    // Change the signals of an existing signalfd.
+    if (fd != -1) {
+        if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+            return -EBADF;
+        }
+        vfs_file_t *file = task->files->fd_list[fd].file_struct;
+        if (file->fs_operations != &signalfd_fs_operations) {
+            return -EINVAL;
+        }
+        ((signalfd_ctx_t *)file->device)->mask = *mask;
+        return fd;
+    }
+    fd = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    signalfd_ctx_t *ctx = kmalloc(sizeof(signalfd_ctx_t));
+    if (!ctx) {
+        return -ENOMEM;
+    }
+    ctx->mask        = *mask;
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        kfree(ctx);
+        return -ENOMEM;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[signalfd]");
+    file->flags         = O_RDONLY | (flags & SFD_NONBLOCK);
+    file->fs_operations = &signalfd_fs_operations;
+    file->device        = ctx;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+int sys_signalfd(int fd, const sigset_t *mask, size_t sizemask) { return sys_signalfd4(fd, mask, sizemask, 0); }
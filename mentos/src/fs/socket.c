@@ -0,0 +1,1154 @@
+/// @file socket.c
+/// @brief Local (AF_UNIX) sockets, built on top of pipes, and the system calls of all sockets.
+/// @details
+/// A stream connection is a pair of pipes, one for each direction: each end
+/// reads from one of them and writes into the other one, so it inherits the
+/// buffering, the blocking and the wake-ups of pipes. Datagrams are queued as
+/// whole messages on the receiving socket, woken up through its wait queues.
+/// Names live inside an in-kernel namespace, they do not appear on the
+/// filesystem. Descriptors are passed with SCM_RIGHTS as references to their
+/// files, which are installed by the receiver: on a stream they are delivered
+/// with the first read which returns some data once they have been queued.
+/// The calls on Internet (AF_INET) sockets are handed over to net/inet.c.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SOCKET]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/pipe.h"
+#include "fs/poll.h"
+#include "fs/vfs.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "net/inet.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/socket.h"
+#include "sys/stat.h"
+#include "sys/uio.h"
+#include "sys/un.h"
+#include "system/syscall.h"
+#include "time.h"
+
+/// The maximum number of descriptors passed by a single message.
+#define UNIX_MAX_FDS 16
+/// The maximum number of bytes queued on a datagram socket, as much as a pipe holds.
+#define UNIX_DGRAM_QUEUE (PIPE_DEF_BUFFERS * PIPE_BUFFER_SIZE)
+/// The maximum number of buffers of a message.
+#define UNIX_MAX_IOV 64
+
+/// @brief The state of a socket.
+typedef enum unix_state {
+    UNIX_UNCONNECTED, ///< A new socket, or a datagram socket.
+    UNIX_LISTENING,   ///< A stream socket accepting connections.
+    UNIX_CONNECTED,   ///< One end of a stream connection.
+} unix_state_t;
+
+/// @brief Descriptors in flight, between sendmsg() and recvmsg().
+typedef struct unix_fds {
+    /// The number of files.
+    size_t count;
+    /// The files, we hold a reference to each of them.
+    vfs_file_t *files[UNIX_MAX_FDS];
+    /// The flags of the descriptors they have been sent from.
+    int flags[UNIX_MAX_FDS];
+    /// Used to place the descriptors inside the queue of a stream socket.
+    list_head_t list;
+} unix_fds_t;
+
+/// @brief A datagram, queued on the receiving socket.
+typedef struct unix_msg {
+    /// The name of the sender, empty if it is not bound.
+    struct sockaddr_un from;
+    /// The descriptors passed with the datagram, or NULL.
+    unix_fds_t *fds;
+    /// The size of the data.
+    size_t len;
+    /// Used to place the datagram inside the queue of the socket.
+    list_head_t list;
+    /// The data.
+    char data[];
+} unix_msg_t;
+
+/// @brief A local socket.
+typedef struct unix_sock {
+    /// The type of the socket (SOCK_STREAM or SOCK_DGRAM).
+    int type;
+    /// The state of the socket.
+    unix_state_t state;
+    /// The name of the socket, or of the listening socket it was accepted from.
+    struct sockaddr_un addr;
+    /// Used to place the socket inside the namespace, once it is bound.
+    list_head_t name_list;
+    /// The file of the socket.
+    vfs_file_t *file;
+    /// The other end of a connection, or of a pair of datagram sockets, NULL once it is closed.
+    struct unix_sock *peer;
+    /// Stream: the read end of the pipe we receive from, NULL once shut down.
+    vfs_file_t *rx;
+    /// Stream: the write end of the pipe we send to, NULL once shut down.
+    vfs_file_t *tx;
+    /// Stream: the descriptors in flight towards this socket (unix_fds_t).
+    list_head_t fds;
+    /// Listening: the connections waiting to be accepted (unix_sock_t).
+    list_head_t backlog;
+    /// Used to place the socket inside the backlog of its listening socket.
+    list_head_t backlog_list;
+    /// Listening: the number of connections waiting to be accepted.
+    size_t backlog_len;
+    /// Listening: the maximum number of connections waiting to be accepted.
+    size_t max_backlog;
+    /// Datagram: the queued datagrams (unix_msg_t).
+    list_head_t messages;
+    /// Datagram: the number of queued bytes.
+    size_t queued;
+    /// Datagram: the default destination, set by connect().
+    struct sockaddr_un dest;
+    /// Woken up when there are connections to accept, or datagrams to receive.
+    wait_queue_head_t read_wait;
+    /// Woken up when there is room for new connections, or for new datagrams.
+    wait_queue_head_t write_wait;
+} unix_sock_t;
+
+static int unix_close(vfs_file_t *file);
+static ssize_t unix_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static ssize_t unix_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static int unix_fstat(vfs_file_t *file, stat_t *stat);
+static long unix_fcntl(vfs_file_t *file, unsigned int request, unsigned long data);
+static unsigned int unix_poll(vfs_file_t *file, poll_table_t *table);
+
+/// Socket file operations.
+static vfs_file_operations_t unix_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = unix_close,
+    .read_f     = unix_read,
+    .write_f    = unix_write,
+    .lseek_f    = NULL,
+    .stat_f     = unix_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = unix_fcntl,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = unix_poll,
+};
+
+/// The bound sockets (unix_sock_t).
+static list_head_t unix_names = { .prev = &unix_names, .next = &unix_names };
+
+/// @brief Checks if a socket must not block.
+/// @param sock the socket.
+/// @param flags the flags of the call (MSG_DONTWAIT).
+/// @return true if the call must not block.
+static inline bool_t __unix_nonblock(unix_sock_t *sock, int flags)
+{
+    return bitmask_check(sock->file->flags, O_NONBLOCK) || bitmask_check(flags, MSG_DONTWAIT);
+}
+
+/// @brief Sets the blocking mode of one of the pipe ends of a stream socket.
+/// @param file the pipe end.
+/// @param nonblock if the pipe must not block.
+static inline void __unix_pipe_set_nonblock(vfs_file_t *file, bool_t nonblock)
+{
+    file->flags = nonblock ? (file->flags | O_NONBLOCK) : (file->flags & ~O_NONBLOCK);
+}
+
+/// @brief Returns the socket associated with a file descriptor.
+/// @param task the current task.
+/// @param fd the file descriptor.
+/// @param sock where the socket is stored.
+/// @return 0 on success, -EBADF if the descriptor is not open, -ENOTSOCK if it is not a socket.
+static inline int __unix_get(task_struct *task, int fd, unix_sock_t **sock)
+{
+    if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+        return -EBADF;
+    }
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
+    if (file->fs_operations != &unix_fs_operations) {
+        return -ENOTSOCK;
+    }
+    *sock = (unix_sock_t *)file->device;
+    return 0;
+}
+
+/// @brief Returns the Internet socket associated with a file descriptor.
+/// @param task the current task.
+/// @param fd the file descriptor.
+/// @return the socket, NULL if the descriptor is not open, or it is not an Internet socket.
+static inline inet_sock_t *__inet_get(task_struct *task, int fd)
+{
+    if ((fd < 0) || (fd >= task->files->max_fd)) {
+        return NULL;
+    }
+    return inet_get(task->files->fd_list[fd].file_struct);
+}
+
+/// @brief Copies a name from user space.
+/// @param addr the name.
+/// @param addrlen the size of the name.
+/// @param path where the path of the name is stored.
+/// @return 0 on success, -EFAULT if there is no name, -EINVAL if it is not a local name.
+static inline int __unix_get_path(const struct sockaddr *addr, socklen_t addrlen, char path[UNIX_PATH_MAX])
+{
+    if (!addr) {
+        return -EFAULT;
+    }
+    if ((addrlen <= sizeof(sa_family_t)) || (addrlen > sizeof(struct sockaddr_un)) || (addr->sa_family != AF_UNIX)) {
+        return -EINVAL;
+    }
+    size_t len = addrlen - sizeof(sa_family_t);
+    memcpy(path, ((const struct sockaddr_un *)addr)->sun_path, len);
+    memset(path + len, 0, UNIX_PATH_MAX - len);
+    // The path must be terminated, and not empty.
+    if ((path[0] == 0) || (path[UNIX_PATH_MAX - 1] != 0)) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/// @brief Copies a name to user space.
+/// @param name the name, an empty path for unnamed sockets.
+/// @param addr where the name is stored (can be NULL).
+/// @param addrlen the size of `addr`, updated with the size of the name.
+static inline void __unix_put_name(const struct sockaddr_un *name, struct sockaddr *addr, socklen_t *addrlen)
+{
+    if (!addr || !addrlen) {
+        return;
+    }
+    struct sockaddr_un tmp;
+    memset(&tmp, 0, sizeof(struct sockaddr_un));
+    tmp.sun_family = AF_UNIX;
+    strncpy(tmp.sun_path, name->sun_path, UNIX_PATH_MAX - 1);
+    socklen_t len = sizeof(sa_family_t) + (tmp.sun_path[0] ? strlen(tmp.sun_path) + 1 : 0);
+    memcpy(addr, &tmp, (*addrlen < len) ? *addrlen : len);
+    *addrlen = len;
+}
+
+/// @brief Searches a bound socket.
+/// @param path the name of the socket.
+/// @return the socket, NULL if no socket is bound to the name.
+static inline unix_sock_t *__unix_find(const char *path)
+{
+    list_for_each_decl (it, &unix_names) {
+        unix_sock_t *sock = list_entry(it, unix_sock_t, name_list);
+        if (strcmp(sock->addr.sun_path, path) == 0) {
+            return sock;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Drops the references to descriptors in flight, and frees them.
+/// @param fds the descriptors.
+static void __unix_fds_drop(unix_fds_t *fds)
+{
+    if (fds) {
+        for (size_t i = 0; i < fds->count; ++i) {
+            vfs_close(fds->files[i]);
+        }
+        kfree(fds);
+    }
+}
+
+/// @brief Takes a reference to the descriptors of the SCM_RIGHTS items of a message.
+/// @param task the current task.
+/// @param msg the message.
+/// @param fds where the descriptors are stored, NULL if the message does not carry any.
+/// @return 0 on success, -EINVAL if the ancillary data is not valid, -EBADF if
+/// a descriptor is not open, -ETOOMANYREFS if there are too many descriptors.
+static int __unix_fds_get(task_struct *task, const struct msghdr *msg, unix_fds_t **fds)
+{
+    *fds = NULL;
+    if (!msg->msg_control || (msg->msg_controllen == 0)) {
+        return 0;
+    }
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS) || (cmsg->cmsg_len < CMSG_LEN(0)) ||
+            (cmsg->cmsg_len > msg->msg_controllen)) {
+            __unix_fds_drop(*fds);
+            return -EINVAL;
+        }
+        if (!*fds) {
+            *fds = kmalloc(sizeof(unix_fds_t));
+            if (!*fds) {
+                return -ENOMEM;
+            }
+            memset(*fds, 0, sizeof(unix_fds_t));
+            list_head_init(&(*fds)->list);
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        int *fd_data = (int *)CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; ++i) {
+            int fd = fd_data[i];
+            if ((fd < 0) || (fd >= task->files->max_fd) || !task->files->fd_list[fd].file_struct) {
+                __unix_fds_drop(*fds);
+                return -EBADF;
+            }
+            if ((*fds)->count == UNIX_MAX_FDS) {
+                __unix_fds_drop(*fds);
+                return -ETOOMANYREFS;
+            }
+            // The file stays open while it is in flight, as if it was duplicated.
+            vfs_file_t *file = task->files->fd_list[fd].file_struct;
+            ++file->count;
+            (*fds)->files[(*fds)->count] = file;
+            (*fds)->flags[(*fds)->count] = task->files->fd_list[fd].flags_mask;
+            ++(*fds)->count;
+        }
+    }
+    return 0;
+}
+
+/// @brief Installs the descriptors in flight on the receiving task, and
+/// reports them as an SCM_RIGHTS item. The ones which do not fit are closed.
+/// @param task the current task.
+/// @param fds the descriptors, which are freed.
+/// @param msg the message, whose ancillary data is replaced.
+static void __unix_fds_put(task_struct *task, unix_fds_t *fds, struct msghdr *msg)
+{
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+    size_t room          = cmsg ? (msg->msg_controllen - CMSG_LEN(0)) / sizeof(int) : 0;
+    size_t installed     = 0;
+    for (size_t i = 0; i < fds->count; ++i) {
+        int fd = (installed < room) ? get_unused_fd() : -EMFILE;
+        if (fd < 0) {
+            vfs_close(fds->files[i]);
+            msg->msg_flags |= MSG_CTRUNC;
+            continue;
+        }
+        fd_install(task, fd, fds->files[i], fds->flags[i]);
+        ((int *)CMSG_DATA(cmsg))[installed++] = fd;
+    }
+    msg->msg_controllen = 0;
+    if (installed > 0) {
+        cmsg->cmsg_level    = SOL_SOCKET;
+        cmsg->cmsg_type     = SCM_RIGHTS;
+        cmsg->cmsg_len      = CMSG_LEN(installed * sizeof(int));
+        msg->msg_controllen = CMSG_SPACE(installed * sizeof(int));
+    }
+    kfree(fds);
+}
+
+/// @brief Frees what a socket holds, once its file is closed.
+/// @param sock the socket.
+static void __unix_release(unix_sock_t *sock)
+{
+    // Remove the name.
+    list_head_remove(&sock->name_list);
+    // Detach from the other end, which sees the end of file, or EPIPE.
+    if (sock->peer) {
+        sock->peer->peer = NULL;
+    }
+    if (sock->rx) {
+        vfs_close(sock->rx);
+    }
+    if (sock->tx) {
+        vfs_close(sock->tx);
+    }
+    list_for_each_safe_decl(it, store, &sock->fds)
+    {
+        unix_fds_t *fds = list_entry(it, unix_fds_t, list);
+        list_head_remove(&fds->list);
+        __unix_fds_drop(fds);
+    }
+    // Refuse the connections which have not been accepted.
+    list_for_each_safe_decl(it, store, &sock->backlog)
+    {
+        unix_sock_t *child = list_entry(it, unix_sock_t, backlog_list);
+        list_head_remove(&child->backlog_list);
+        vfs_close(child->file);
+    }
+    list_for_each_safe_decl(it, store, &sock->messages)
+    {
+        unix_msg_t *message = list_entry(it, unix_msg_t, list);
+        list_head_remove(&message->list);
+        __unix_fds_drop(message->fds);
+        kfree(message);
+    }
+    // Wake up the tasks waiting to connect, or to send datagrams.
+    wake_up(&sock->read_wait);
+    wake_up(&sock->write_wait);
+}
+
+/// @brief Creates a socket, and its file.
+/// @param type the type of the socket.
+/// @param flags the flags of the file (O_NONBLOCK).
+/// @return the file of the socket, NULL on failure.
+static vfs_file_t *__unix_alloc(int type, int flags)
+{
+    unix_sock_t *sock = kmalloc(sizeof(unix_sock_t));
+    if (!sock) {
+        return NULL;
+    }
+    memset(sock, 0, sizeof(unix_sock_t));
+    sock->type  = type;
+    sock->state = UNIX_UNCONNECTED;
+    list_head_init(&sock->name_list);
+    list_head_init(&sock->fds);
+    list_head_init(&sock->backlog);
+    list_head_init(&sock->backlog_list);
+    list_head_init(&sock->messages);
+    wait_queue_head_init(&sock->read_wait);
+    wait_queue_head_init(&sock->write_wait);
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        kfree(sock);
+        return NULL;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[unix]");
+    file->flags         = O_RDWR | (flags & O_NONBLOCK);
+    file->fs_operations = &unix_fs_operations;
+    file->device        = sock;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    sock->file = file;
+    return file;
+}
+
+/// @brief Installs the file of a new socket on a file descriptor.
+/// @param task the current task.
+/// @param file the file, which is closed on failure.
+/// @return the file descriptor, or a negative error code.
+static inline int __unix_install(task_struct *task, vfs_file_t *file)
+{
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        vfs_close(file);
+        return fd;
+    }
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+/// @brief Connects two stream sockets, through a pipe for each direction.
+/// @param a the first socket.
+/// @param b the second socket.
+/// @return 0 on success, -ENOMEM on failure.
+static int __unix_stream_link(unix_sock_t *a, unix_sock_t *b)
+{
+    vfs_file_t *a_to_b[2], *b_to_a[2];
+    if (pipe_create_files(a_to_b) < 0) {
+        return -ENOMEM;
+    }
+    if (pipe_create_files(b_to_a) < 0) {
+        vfs_close(a_to_b[0]);
+        vfs_close(a_to_b[1]);
+        return -ENOMEM;
+    }
+    a->tx    = a_to_b[1];
+    b->rx    = a_to_b[0];
+    b->tx    = b_to_a[1];
+    a->rx    = b_to_a[0];
+    a->peer  = b;
+    b->peer  = a;
+    a->state = UNIX_CONNECTED;
+    b->state = UNIX_CONNECTED;
+    return 0;
+}
+
+/// @brief Receives data from a stream socket.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @param fds where the descriptors delivered with the data are stored.
+/// @return the number of bytes received, 0 at the end of file, or a negative error code.
+static ssize_t __unix_stream_recvmsg(unix_sock_t *sock, struct msghdr *msg, int flags, unix_fds_t **fds)
+{
+    if (sock->state != UNIX_CONNECTED) {
+        return -ENOTCONN;
+    }
+    // Shut down for reading.
+    if (!sock->rx) {
+        return 0;
+    }
+    __unix_pipe_set_nonblock(sock->rx, __unix_nonblock(sock, flags));
+    ssize_t ret = vfs_readv(sock->rx, msg->msg_iov, msg->msg_iovlen, 0);
+    // Deliver the descriptors in flight along with the data.
+    if ((ret > 0) && !list_head_empty(&sock->fds)) {
+        *fds = list_entry(sock->fds.next, unix_fds_t, list);
+        list_head_remove(&(*fds)->list);
+    }
+    return ret;
+}
+
+/// @brief Sends data through a stream socket.
+/// @param task the current task.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @return the number of bytes sent, or a negative error code.
+static ssize_t __unix_stream_sendmsg(task_struct *task, unix_sock_t *sock, const struct msghdr *msg, int flags)
+{
+    if (sock->state != UNIX_CONNECTED) {
+        return -ENOTCONN;
+    }
+    // Shut down for writing, or the other end is gone.
+    unix_sock_t *peer = sock->peer;
+    if (!sock->tx || !peer) {
+        return -EPIPE;
+    }
+    unix_fds_t *fds;
+    int ret = __unix_fds_get(task, msg, &fds);
+    if (ret < 0) {
+        return ret;
+    }
+    // The descriptors are queued before the data, so that the reader finds them.
+    if (fds) {
+        list_head_insert_before(&fds->list, &peer->fds);
+    }
+    __unix_pipe_set_nonblock(sock->tx, __unix_nonblock(sock, flags));
+    ssize_t written = vfs_writev(sock->tx, msg->msg_iov, msg->msg_iovlen, 0);
+    // Take the descriptors back, unless the other end has been closed while we
+    // were waiting, which dropped them.
+    if ((written <= 0) && fds && (sock->peer == peer)) {
+        list_head_remove(&fds->list);
+        __unix_fds_drop(fds);
+    }
+    return written;
+}
+
+/// @brief Waits until a datagram socket can queue a datagram.
+/// @param sock the sending socket.
+/// @param path the name of the receiving socket, NULL to send to the peer of the socket.
+/// @param len the size of the datagram.
+/// @param nonblock if the call must not block.
+/// @param target where the receiving socket is stored.
+/// @return 0 on success, or a negative error code.
+static int __unix_dgram_wait_for_room(unix_sock_t *sock, const char *path, size_t len, bool_t nonblock,
+                                      unix_sock_t **target)
+{
+    while (1) {
+        // The receiver might have been closed while we were waiting.
+        *target = path ? __unix_find(path) : sock->peer;
+        if (!*target) {
+            return -ECONNREFUSED;
+        }
+        if ((*target)->type != SOCK_DGRAM) {
+            return -EPROTOTYPE;
+        }
+        if (((*target)->queued + len) <= UNIX_DGRAM_QUEUE) {
+            return 0;
+        }
+        if (nonblock) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&(*target)->write_wait) < 0) {
+            return -EINTR;
+        }
+    }
+}
+
+/// @brief Sends a datagram.
+/// @param task the current task.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @return the number of bytes sent, or a negative error code.
+static ssize_t __unix_dgram_sendmsg(task_struct *task, unix_sock_t *sock, const struct msghdr *msg, int flags)
+{
+    // Get the destination: the given name, the peer, or the default destination.
+    char path[UNIX_PATH_MAX];
+    char *name = path;
+    if (msg->msg_name) {
+        int ret = __unix_get_path(msg->msg_name, msg->msg_namelen, path);
+        if (ret < 0) {
+            return ret;
+        }
+    } else if (sock->peer) {
+        name = NULL;
+    } else if (sock->dest.sun_path[0]) {
+        strcpy(path, sock->dest.sun_path);
+    } else {
+        return -ENOTCONN;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        len += msg->msg_iov[i].iov_len;
+    }
+    if (len > UNIX_DGRAM_QUEUE) {
+        return -EMSGSIZE;
+    }
+    unix_sock_t *target;
+    int ret = __unix_dgram_wait_for_room(sock, name, len, __unix_nonblock(sock, flags), &target);
+    if (ret < 0) {
+        return ret;
+    }
+    unix_msg_t *message = kmalloc(sizeof(unix_msg_t) + len);
+    if (!message) {
+        return -ENOMEM;
+    }
+    memset(message, 0, sizeof(unix_msg_t));
+    ret = __unix_fds_get(task, msg, &message->fds);
+    if (ret < 0) {
+        kfree(message);
+        return ret;
+    }
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        memcpy(message->data + message->len, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+        message->len += msg->msg_iov[i].iov_len;
+    }
+    if (!list_head_empty(&sock->name_list)) {
+        message->from = sock->addr;
+    }
+    list_head_insert_before(&message->list, &target->messages);
+    target->queued += len;
+    wake_up_nr(&target->read_wait, 1);
+    return len;
+}
+
+/// @brief Receives a datagram, the part which does not fit the buffers is discarded.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @param fds where the descriptors passed with the datagram are stored.
+/// @return the number of bytes received, or a negative error code.
+static ssize_t __unix_dgram_recvmsg(unix_sock_t *sock, struct msghdr *msg, int flags, unix_fds_t **fds)
+{
+    while (list_head_empty(&sock->messages)) {
+        if (__unix_nonblock(sock, flags)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on_exclusive(&sock->read_wait) < 0) {
+            // We might have been woken up for a datagram, leave it to another reader.
+            if (!list_head_empty(&sock->messages)) {
+                wake_up_nr(&sock->read_wait, 1);
+            }
+            return -EINTR;
+        }
+    }
+    unix_msg_t *message = list_entry(sock->messages.next, unix_msg_t, list);
+    list_head_remove(&message->list);
+    sock->queued -= message->len;
+    // Copy the data.
+    size_t copied = 0;
+    for (size_t i = 0; (i < msg->msg_iovlen) && (copied < message->len); ++i) {
+        size_t len = min(msg->msg_iov[i].iov_len, message->len - copied);
+        memcpy(msg->msg_iov[i].iov_base, message->data + copied, len);
+        copied += len;
+    }
+    if (copied < message->len) {
+        msg->msg_flags |= MSG_TRUNC;
+    }
+    // Report the sender, and hand over the descriptors.
+    if (msg->msg_name) {
+        __unix_put_name(&message->from, msg->msg_name, &msg->msg_namelen);
+    }
+    *fds = message->fds;
+    kfree(message);
+    // Wake up the senders, which can use the room we made, and pass the
+    // wake-up on to another reader, if we left some datagrams behind.
+    wake_up(&sock->write_wait);
+    if (!list_head_empty(&sock->messages)) {
+        wake_up_nr(&sock->read_wait, 1);
+    }
+    return copied;
+}
+
+/// @brief Sends a message through a socket.
+/// @param task the current task.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @return the number of bytes sent, or a negative error code.
+static inline ssize_t __unix_sendmsg(task_struct *task, unix_sock_t *sock, const struct msghdr *msg, int flags)
+{
+    if ((msg->msg_iovlen > UNIX_MAX_IOV) || (msg->msg_iovlen && !msg->msg_iov)) {
+        return -EINVAL;
+    }
+    if (sock->type == SOCK_STREAM) {
+        return __unix_stream_sendmsg(task, sock, msg, flags);
+    }
+    return __unix_dgram_sendmsg(task, sock, msg, flags);
+}
+
+/// @brief Receives a message from a socket.
+/// @param task the current task.
+/// @param sock the socket.
+/// @param msg the message.
+/// @param flags the flags of the call.
+/// @return the number of bytes received, or a negative error code.
+static inline ssize_t __unix_recvmsg(task_struct *task, unix_sock_t *sock, struct msghdr *msg, int flags)
+{
+    if ((msg->msg_iovlen > UNIX_MAX_IOV) || (msg->msg_iovlen && !msg->msg_iov)) {
+        return -EINVAL;
+    }
+    unix_fds_t *fds = NULL;
+    ssize_t ret;
+    msg->msg_flags = 0;
+    if (sock->type == SOCK_STREAM) {
+        msg->msg_namelen = 0;
+        ret              = __unix_stream_recvmsg(sock, msg, flags, &fds);
+    } else {
+        ret = __unix_dgram_recvmsg(sock, msg, flags, &fds);
+    }
+    // The ancillary data reports the descriptors we received, if any.
+    if (fds) {
+        __unix_fds_put(task, fds, msg);
+    } else {
+        msg->msg_controllen = 0;
+    }
+    return ret;
+}
+
+/// @brief Closes a socket, freeing it with the last reference.
+/// @param file the file of the socket.
+/// @return 0 on success.
+static int unix_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        unix_sock_t *sock = (unix_sock_t *)file->device;
+        __unix_release(sock);
+        kfree(sock);
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+    }
+    return 0;
+}
+
+/// @brief Receives data from a socket, as recv() without flags.
+/// @param file the file of the socket.
+/// @param buffer where the data is stored.
+/// @param offset not used.
+/// @param nbyte the size of the buffer.
+/// @return the number of bytes received, or a negative error code.
+static ssize_t unix_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    struct iovec iov  = { .iov_base = buffer, .iov_len = nbyte };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    return __unix_recvmsg(scheduler_get_current_process(), (unix_sock_t *)file->device, &msg, 0);
+}
+
+/// @brief Sends data through a socket, as send() without flags.
+/// @param file the file of the socket.
+/// @param buffer the data.
+/// @param offset not used.
+/// @param nbyte the size of the data.
+/// @return the number of bytes sent, or a negative error code.
+static ssize_t unix_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    struct iovec iov  = { .iov_base = (void *)buffer, .iov_len = nbyte };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    return __unix_sendmsg(scheduler_get_current_process(), (unix_sock_t *)file->device, &msg, 0);
+}
+
+/// @brief Retrieves the status of a socket.
+/// @param file the file of the socket.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int unix_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = S_IFSOCK | 0777;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Gets, or sets, the flags of a socket.
+/// @param file the file of the socket.
+/// @param request the request (F_GETFL or F_SETFL).
+/// @param data the new flags, only O_NONBLOCK can be changed.
+/// @return the flags for F_GETFL, 0 for F_SETFL, -EINVAL for other requests.
+static long unix_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    switch (request) {
+    case F_GETFL:
+        return file->flags;
+    case F_SETFL:
+        file->flags = (file->flags & ~O_NONBLOCK) | (data & O_NONBLOCK);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief Reports the readiness of a socket.
+/// @param file the file of the socket.
+/// @param table the poll table.
+/// @return the events of the pipes of a connection, POLLIN when there are
+/// connections to accept, or datagrams to receive.
+static unsigned int unix_poll(vfs_file_t *file, poll_table_t *table)
+{
+    unix_sock_t *sock = (unix_sock_t *)file->device;
+    unsigned int mask = 0;
+    if (sock->state == UNIX_CONNECTED) {
+        if (sock->rx) {
+            mask |= vfs_poll(sock->rx, table) & (POLLIN | POLLRDNORM | POLLHUP);
+        }
+        if (sock->tx) {
+            mask |= vfs_poll(sock->tx, table) & (POLLOUT | POLLWRNORM | POLLERR);
+        }
+        if (!sock->rx && !sock->tx) {
+            mask |= POLLHUP;
+        }
+        return mask;
+    }
+    poll_wait(&sock->read_wait, table);
+    if (sock->state == UNIX_LISTENING) {
+        return list_head_empty(&sock->backlog) ? 0 : (POLLIN | POLLRDNORM);
+    }
+    if (sock->type == SOCK_STREAM) {
+        return POLLHUP;
+    }
+    // The room is checked on the receiver, datagrams can always be written.
+    mask = POLLOUT | POLLWRNORM;
+    if (!list_head_empty(&sock->messages)) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    return mask;
+}
+
+/// @brief Checks the arguments of socket() and socketpair().
+/// @param domain the communication domain.
+/// @param type the type of the socket, and its flags.
+/// @param protocol the protocol.
+/// @return 0 on success, -EAFNOSUPPORT, -EINVAL or -EPROTONOSUPPORT on failure.
+static inline int __unix_check_type(int domain, int type, int protocol)
+{
+    if (domain != AF_UNIX) {
+        return -EAFNOSUPPORT;
+    }
+    int kind = type & ~SOCK_NONBLOCK;
+    if ((kind != SOCK_STREAM) && (kind != SOCK_DGRAM)) {
+        return -EINVAL;
+    }
+    if (protocol != 0) {
+        return -EPROTONOSUPPORT;
+    }
+    return 0;
+}
+
+int sys_socket(int domain, int type, int protocol)
+{
+    if (domain == AF_INET) {
+        return inet_socket(type, protocol);
+    }
+    int ret = __unix_check_type(domain, type, protocol);
+    if (ret < 0) {
+        return ret;
+    }
+    vfs_file_t *file = __unix_alloc(type & ~SOCK_NONBLOCK, type & SOCK_NONBLOCK);
+    if (!file) {
+        return -ENOMEM;
+    }
+    return __unix_install(scheduler_get_current_process(), file);
+}
+
+int sys_socketpair(int domain, int type, int protocol, int sv[2])
+{
+    if (domain == AF_INET) {
+        return -EOPNOTSUPP;
+    }
+    int ret = __unix_check_type(domain, type, protocol);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!sv) {
+        return -EFAULT;
+    }
+    task_struct *task = scheduler_get_current_process();
+    int kind          = type & ~SOCK_NONBLOCK;
+    vfs_file_t *a     = __unix_alloc(kind, type & SOCK_NONBLOCK);
+    vfs_file_t *b     = __unix_alloc(kind, type & SOCK_NONBLOCK);
+    if (!a || !b) {
+        ret = -ENOMEM;
+    } else if (kind == SOCK_STREAM) {
+        ret = __unix_stream_link((unix_sock_t *)a->device, (unix_sock_t *)b->device);
+    }
+    if (ret < 0) {
+        if (a) {
+            vfs_close(a);
+        }
+        if (b) {
+            vfs_close(b);
+        }
+        return ret;
+    }
+    // Datagram sockets are paired without a name, each one sends to the other.
+    if (kind == SOCK_DGRAM) {
+        ((unix_sock_t *)a->device)->peer = (unix_sock_t *)b->device;
+        ((unix_sock_t *)b->device)->peer = (unix_sock_t *)a->device;
+    }
+    sv[0] = __unix_install(task, a);
+    if (sv[0] < 0) {
+        vfs_close(b);
+        return sv[0];
+    }
+    sv[1] = __unix_install(task, b);
+    if (sv[1] < 0) {
+        sys_close(sv[0]);
+        return sv[1];
+    }
+    return 0;
+}
+
+int sys_bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    inet_sock_t *inet = __inet_get(scheduler_get_current_process(), sockfd);
+    if (inet) {
+        return inet_bind(inet, addr, addrlen);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(scheduler_get_current_process(), sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    char path[UNIX_PATH_MAX];
+    ret = __unix_get_path(addr, addrlen, path);
+    if (ret < 0) {
+        return ret;
+    }
+    // A socket has a single name, and a name a single socket.
+    if (!list_head_empty(&sock->name_list) || (sock->state != UNIX_UNCONNECTED)) {
+        return -EINVAL;
+    }
+    if (__unix_find(path)) {
+        return -EADDRINUSE;
+    }
+    sock->addr.sun_family = AF_UNIX;
+    strcpy(sock->addr.sun_path, path);
+    list_head_insert_before(&sock->name_list, &unix_names);
+    return 0;
+}
+
+int sys_listen(int sockfd, int backlog)
+{
+    inet_sock_t *inet = __inet_get(scheduler_get_current_process(), sockfd);
+    if (inet) {
+        return inet_listen(inet, backlog);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(scheduler_get_current_process(), sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    if (sock->type != SOCK_STREAM) {
+        return -EOPNOTSUPP;
+    }
+    if (list_head_empty(&sock->name_list) || (sock->state == UNIX_CONNECTED)) {
+        return -EINVAL;
+    }
+    sock->state       = UNIX_LISTENING;
+    sock->max_backlog = (backlog <= 0) ? 1 : min(backlog, SOMAXCONN);
+    return 0;
+}
+
+int sys_accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    task_struct *task = scheduler_get_current_process();
+    inet_sock_t *inet = __inet_get(task, sockfd);
+    if (inet) {
+        return inet_accept(inet, addr, addrlen, flags);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(task, sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    if (sock->type != SOCK_STREAM) {
+        return -EOPNOTSUPP;
+    }
+    if ((sock->state != UNIX_LISTENING) || (flags & ~SOCK_NONBLOCK)) {
+        return -EINVAL;
+    }
+    while (list_head_empty(&sock->backlog)) {
+        if (__unix_nonblock(sock, 0)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on_exclusive(&sock->read_wait) < 0) {
+            // We might have been woken up for a connection, leave it to another task.
+            if (!list_head_empty(&sock->backlog)) {
+                wake_up_nr(&sock->read_wait, 1);
+            }
+            return -EINTR;
+        }
+    }
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    unix_sock_t *child = list_entry(sock->backlog.next, unix_sock_t, backlog_list);
+    list_head_remove(&child->backlog_list);
+    --sock->backlog_len;
+    child->file->flags |= (flags & SOCK_NONBLOCK);
+    fd_install(task, fd, child->file, child->file->flags);
+    if (child->peer) {
+        __unix_put_name(&child->peer->addr, addr, addrlen);
+    }
+    // Wake up the tasks waiting for room, and pass the wake-up on to another
+    // task, if there are more connections.
+    wake_up(&sock->write_wait);
+    if (!list_head_empty(&sock->backlog)) {
+        wake_up_nr(&sock->read_wait, 1);
+    }
+    return fd;
+}
+
+/// @brief Connects a stream socket to a listening socket, waiting for room in its backlog.
+/// @param sock the socket.
+/// @param path the name of the listening socket.
+/// @return 0 on success, or a negative error code.
+static int __unix_stream_connect(unix_sock_t *sock, const char *path)
+{
+    if (sock->state == UNIX_CONNECTED) {
+        return -EISCONN;
+    }
+    if (sock->state == UNIX_LISTENING) {
+        return -EINVAL;
+    }
+    unix_sock_t *listener;
+    while (1) {
+        // The listening socket might have been closed while we were waiting.
+        listener = __unix_find(path);
+        if (!listener) {
+            return -ENOENT;
+        }
+        if (listener->type != SOCK_STREAM) {
+            return -EPROTOTYPE;
+        }
+        if (listener->state != UNIX_LISTENING) {
+            return -ECONNREFUSED;
+        }
+        if (listener->backlog_len < listener->max_backlog) {
+            break;
+        }
+        if (__unix_nonblock(sock, 0)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(&listener->write_wait) < 0) {
+            return -EINTR;
+        }
+    }
+    // The other end waits inside the backlog, the data can flow before accept().
+    vfs_file_t *file = __unix_alloc(SOCK_STREAM, 0);
+    if (!file) {
+        return -ENOMEM;
+    }
+    unix_sock_t *child = (unix_sock_t *)file->device;
+    int ret            = __unix_stream_link(sock, child);
+    if (ret < 0) {
+        vfs_close(file);
+        return ret;
+    }
+    child->addr = listener->addr;
+    list_head_insert_before(&child->backlog_list, &listener->backlog);
+    ++listener->backlog_len;
+    wake_up_nr(&listener->read_wait, 1);
+    return 0;
+}
+
+int sys_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    inet_sock_t *inet = __inet_get(scheduler_get_current_process(), sockfd);
+    if (inet) {
+        return inet_connect(inet, addr, addrlen);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(scheduler_get_current_process(), sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    // A datagram socket forgets its destination.
+    if ((sock->type == SOCK_DGRAM) && addr && (addrlen >= sizeof(sa_family_t)) && (addr->sa_family == AF_UNSPEC)) {
+        memset(&sock->dest, 0, sizeof(struct sockaddr_un));
+        return 0;
+    }
+    char path[UNIX_PATH_MAX];
+    ret = __unix_get_path(addr, addrlen, path);
+    if (ret < 0) {
+        return ret;
+    }
+    if (sock->type == SOCK_STREAM) {
+        return __unix_stream_connect(sock, path);
+    }
+    // A datagram socket only remembers its destination.
+    unix_sock_t *target = __unix_find(path);
+    if (!target) {
+        return -ENOENT;
+    }
+    if (target->type != SOCK_DGRAM) {
+        return -EPROTOTYPE;
+    }
+    sock->dest.sun_family = AF_UNIX;
+    strcpy(sock->dest.sun_path, path);
+    return 0;
+}
+
+ssize_t sys_sendmsg(int sockfd, const struct msghdr *msg, int flags)
+{
+    task_struct *task = scheduler_get_current_process();
+    inet_sock_t *inet = __inet_get(task, sockfd);
+    if (inet) {
+        return inet_sendmsg(inet, msg, flags);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(task, sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!msg) {
+        return -EFAULT;
+    }
+    return __unix_sendmsg(task, sock, msg, flags);
+}
+
+ssize_t sys_recvmsg(int sockfd, struct msghdr *msg, int flags)
+{
+    task_struct *task = scheduler_get_current_process();
+    inet_sock_t *inet = __inet_get(task, sockfd);
+    if (inet) {
+        return inet_recvmsg(inet, msg, flags);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(task, sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!msg) {
+        return -EFAULT;
+    }
+    return __unix_recvmsg(task, sock, msg, flags);
+}
+
+int sys_shutdown(int sockfd, int how)
+{
+    inet_sock_t *inet = __inet_get(scheduler_get_current_process(), sockfd);
+    if (inet) {
+        return inet_shutdown(inet, how);
+    }
+    unix_sock_t *sock;
+    int ret = __unix_get(scheduler_get_current_process(), sockfd, &sock);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((how != SHUT_RD) && (how != SHUT_WR) && (how != SHUT_RDWR)) {
+        return -EINVAL;
+    }
+    if (sock->state != UNIX_CONNECTED) {
+        return -ENOTCONN;
+    }
+    // Closing our end of a pipe is what the other end notices: the end of
+    // file when we stop writing, EPIPE when we stop reading.
+    if ((how != SHUT_WR) && sock->rx) {
+        vfs_close(sock->rx);
+        sock->rx = NULL;
+    }
+    if ((how != SHUT_RD) && sock->tx) {
+        vfs_close(sock->tx);
+        sock->tx = NULL;
+    }
+    return 0;
+}
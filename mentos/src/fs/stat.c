@@ -4,6 +4,7 @@
 /// See LICENSE.md for details.
 
 #include "errno.h"
+#include "fcntl.h"
 #include "fs/vfs.h"
 #include "io/debug.h"
 #include "limits.h"
@@ -13,18 +14,37 @@
 
 int sys_stat(const char *path, stat_t *buf) { return vfs_stat(path, buf); }
 
+int sys_fstatat(int dirfd, const char *path, stat_t *buf, int flags)
+{
+    if (path[0] == '\0') {
+        return -ENOENT;
+    }
+    // Absolute paths, and paths relative to the working directory, are looked up as usual.
+    if ((dirfd == AT_FDCWD) || (path[0] == '/')) {
+        return vfs_stat(path, buf);
+    }
+    // Get the current task.
+    task_struct *task = scheduler_get_current_process();
+    // Check the directory FD.
+    if ((dirfd < 0) || (dirfd >= task->files->max_fd) || (task->files->fd_list[dirfd].file_struct == NULL)) {
+        return -EBADF;
+    }
+    // The last component is never followed, as for stat().
+    return vfs_fstatat(task->files->fd_list[dirfd].file_struct, path, buf);
+}
+
 int sys_fstat(int fd, stat_t *buf)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &task->files->fd_list[fd];
 
     // Check the permissions.
 #if 0
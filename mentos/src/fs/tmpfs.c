@@ -0,0 +1,844 @@
+/// @file tmpfs.c
+/// @brief Temporary file system, which keeps its files inside memory pages.
+/// @details
+/// The content of each file is an array of pages, allocated zero-filled the
+/// first time they are written, so a file with holes only takes the pages
+/// it uses, and no block device is ever touched. The shared mappings of a
+/// file map those very pages, so the writes through a mapping and through
+/// write() see each other, and surviving the unmapping is just a matter of
+/// holding the pages. A file which is removed while it is open, or mapped,
+/// keeps its pages until the last file and the last mapping go away.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[TMPFS ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "fs/tmpfs.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/vfs.h"
+#include "klib/ida.h"
+#include "libgen.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/vmem.h"
+#include "mem/paging.h"
+#include "process/scheduler.h"
+#include "stdio.h"
+#include "string.h"
+#include "sys/stat.h"
+#include "time.h"
+
+/// Maximum length of the absolute path of a file in TMPFS.
+#define TMPFS_NAME_MAX     255U
+/// Maximum number of files in TMPFS.
+#define TMPFS_MAX_FILES    1024U
+/// The magic number used to check if the tmpfs file is valid.
+#define TMPFS_MAGIC_NUMBER 0x01021994
+
+// ============================================================================
+// Data Structures
+// ============================================================================
+
+/// @brief Information concerning a file.
+typedef struct tmpfs_file {
+    /// Number used as delimiter, it must be set to TMPFS_MAGIC_NUMBER.
+    int magic;
+    /// The file inode.
+    int inode;
+    /// Flags (DT_DIR or DT_REG).
+    unsigned flags;
+    /// The file mask.
+    mode_t mask;
+    /// The absolute path of the file.
+    char name[TMPFS_NAME_MAX];
+    /// User id of the file.
+    uid_t uid;
+    /// Group id of the file.
+    gid_t gid;
+    /// Time of last access.
+    time_t atime;
+    /// Time of last data modification.
+    time_t mtime;
+    /// Time of last status change.
+    time_t ctime;
+    /// The size of the file, in bytes.
+    uint32_t size;
+    /// The number of entries of `pages`.
+    uint32_t npages;
+    /// The pages of the content, NULL for those never written.
+    page_t **pages;
+    /// If the file has been removed, and lives only for those using it.
+    int unlinked;
+    /// The opened files associated with the file.
+    list_head_t files;
+    /// List of tmpfs siblings.
+    list_head_t siblings;
+} tmpfs_file_t;
+
+/// @brief The details regarding the filesystem.
+typedef struct tmpfs {
+    /// Number of files.
+    unsigned int nfiles;
+    /// The files which can be reached through their path.
+    list_head_t files;
+    /// Cache for creating new `tmpfs_file_t`.
+    kmem_cache_t *tmpfs_file_cache;
+    /// Allocates the inodes of the files.
+    ida_t inodes;
+} tmpfs_t;
+
+/// The tmpfs filesystem, shared by all its mount points.
+static tmpfs_t tmpfs;
+/// The bitmap of the inodes of the files.
+static uint32_t tmpfs_inodes[IDA_WORDS(TMPFS_MAX_FILES)];
+
+// ============================================================================
+// Forward Declaration of Functions
+// ============================================================================
+
+static int tmpfs_mkdir(const char *path, mode_t mode);
+static int tmpfs_rmdir(const char *path);
+static int tmpfs_stat(const char *path, stat_t *stat);
+
+static vfs_file_t *tmpfs_open(const char *path, int flags, mode_t mode);
+static int tmpfs_unlink(const char *path);
+static int tmpfs_close(vfs_file_t *file);
+static ssize_t tmpfs_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static ssize_t tmpfs_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static off_t tmpfs_lseek(vfs_file_t *file, off_t offset, int whence);
+static int tmpfs_fstat(vfs_file_t *file, stat_t *stat);
+static ssize_t tmpfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_t count);
+static int tmpfs_truncate(vfs_file_t *file, off_t length);
+static page_t *tmpfs_get_page(vfs_file_t *file, uint32_t offset);
+
+// ============================================================================
+// Virtual FileSystem (VFS) Operaions
+// ============================================================================
+
+/// Filesystem general operations.
+static vfs_sys_operations_t tmpfs_sys_operations = {
+    .mkdir_f   = tmpfs_mkdir,
+    .rmdir_f   = tmpfs_rmdir,
+    .stat_f    = tmpfs_stat,
+    .creat_f   = NULL,
+    .symlink_f = NULL,
+};
+
+/// Filesystem file operations.
+static vfs_file_operations_t tmpfs_fs_operations = {
+    .open_f     = tmpfs_open,
+    .unlink_f   = tmpfs_unlink,
+    .close_f    = tmpfs_close,
+    .read_f     = tmpfs_read,
+    .write_f    = tmpfs_write,
+    .lseek_f    = tmpfs_lseek,
+    .stat_f     = tmpfs_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = NULL,
+    .getdents_f = tmpfs_getdents,
+    .readlink_f = NULL,
+    .poll_f     = NULL,
+    .truncate_f = tmpfs_truncate,
+    .get_page_f = tmpfs_get_page,
+};
+
+// ============================================================================
+// TMPFS Core Functions
+// ============================================================================
+
+/// @brief Returns the TMPFS file associated with the given list entry.
+/// @param entry the entry to transform to TMPFS file.
+/// @return a valid pointer to a TMPFS file, NULL otherwise.
+static inline tmpfs_file_t *tmpfs_get_file(list_head_t *entry)
+{
+    tmpfs_file_t *tmpfs_file = list_entry(entry, tmpfs_file_t, siblings);
+    if (tmpfs_file->magic == TMPFS_MAGIC_NUMBER) {
+        return tmpfs_file;
+    }
+    return NULL;
+}
+
+/// @brief Returns the TMPFS file behind an opened file.
+/// @param file the opened file.
+/// @return a valid pointer to a TMPFS file, NULL otherwise.
+static inline tmpfs_file_t *tmpfs_get_file_struct(vfs_file_t *file)
+{
+    tmpfs_file_t *tmpfs_file = file ? (tmpfs_file_t *)file->device : NULL;
+    if (tmpfs_file && (tmpfs_file->magic == TMPFS_MAGIC_NUMBER)) {
+        return tmpfs_file;
+    }
+    return NULL;
+}
+
+/// @brief Finds the TMPFS file at the given path.
+/// @param path the path to the entry.
+/// @return a pointer to the TMPFS file, NULL otherwise.
+static inline tmpfs_file_t *tmpfs_find_entry_path(const char *path)
+{
+    list_for_each_decl (it, &tmpfs.files) {
+        tmpfs_file_t *tmpfs_file = tmpfs_get_file(it);
+        if (tmpfs_file && !strcmp(tmpfs_file->name, path)) {
+            return tmpfs_file;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Checks that the parent of the given path is a TMPFS directory.
+/// @param path the path to the entry.
+/// @return 0 if it is, -errno otherwise.
+static inline int tmpfs_check_parent(const char *path)
+{
+    char parent_path[PATH_MAX];
+    if (!dirname(path, parent_path, sizeof(parent_path))) {
+        return -ENOENT;
+    }
+    tmpfs_file_t *parent_file = tmpfs_find_entry_path(parent_path);
+    if (parent_file == NULL) {
+        return -ENOENT;
+    }
+    if ((parent_file->flags & DT_DIR) == 0) {
+        return -ENOTDIR;
+    }
+    return 0;
+}
+
+/// @brief Checks if the TMPFS directory at the given path is empty.
+/// @param path the path to the directory.
+/// @return 0 if empty, 1 if not.
+static inline int tmpfs_check_if_empty(const char *path)
+{
+    char filedir[PATH_MAX];
+    list_for_each_decl (it, &tmpfs.files) {
+        tmpfs_file_t *tmpfs_file = tmpfs_get_file(it);
+        // Skip the directory itself.
+        if (!tmpfs_file || !strcmp(path, tmpfs_file->name)) {
+            continue;
+        }
+        if (dirname(tmpfs_file->name, filedir, sizeof(filedir)) && !strcmp(path, filedir)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Creates a new TMPFS file.
+/// @param path where the file resides.
+/// @param flags the type of the file.
+/// @param mask the permissions of the file.
+/// @return a pointer to the new TMPFS file, NULL otherwise.
+static inline tmpfs_file_t *tmpfs_create_file(const char *path, unsigned flags, mode_t mask)
+{
+    if (strlen(path) >= TMPFS_NAME_MAX) {
+        return NULL;
+    }
+    int inode = ida_alloc(&tmpfs.inodes);
+    if (inode < 0) {
+        pr_err("There are no free inodes for `%s`.\n", path);
+        return NULL;
+    }
+    tmpfs_file_t *tmpfs_file = (tmpfs_file_t *)kmem_cache_alloc(tmpfs.tmpfs_file_cache, GFP_KERNEL);
+    if (!tmpfs_file) {
+        pr_err("Failed to allocate the file `%s`.\n", path);
+        ida_free(&tmpfs.inodes, inode);
+        return NULL;
+    }
+    memset(tmpfs_file, 0, sizeof(tmpfs_file_t));
+    tmpfs_file->magic = TMPFS_MAGIC_NUMBER;
+    tmpfs_file->inode = inode;
+    tmpfs_file->flags = flags;
+    tmpfs_file->mask  = mask & (S_IRWXU | S_IRWXG | S_IRWXO | S_ISVTX);
+    strcpy(tmpfs_file->name, path);
+    // The file belongs to whoever creates it.
+    task_struct *task = scheduler_get_current_process();
+    if (task) {
+        tmpfs_file->uid = task->uid;
+        tmpfs_file->gid = task->gid;
+    }
+    tmpfs_file->atime = sys_time(NULL);
+    tmpfs_file->mtime = tmpfs_file->atime;
+    tmpfs_file->ctime = tmpfs_file->atime;
+    list_head_init(&tmpfs_file->files);
+    list_head_insert_before(&tmpfs_file->siblings, &tmpfs.files);
+    ++tmpfs.nfiles;
+    pr_debug("tmpfs_create_file(%p) `%s`\n", tmpfs_file, path);
+    return tmpfs_file;
+}
+
+/// @brief Drops the pages of a file past the given number of pages.
+/// @param tmpfs_file the TMPFS file.
+/// @param npages the number of pages to keep.
+static inline void tmpfs_drop_pages(tmpfs_file_t *tmpfs_file, uint32_t npages)
+{
+    // The processes mapping the pages hold their own references.
+    for (uint32_t index = npages; index < tmpfs_file->npages; ++index) {
+        if (tmpfs_file->pages[index]) {
+            page_cache_put(tmpfs_file->pages[index]);
+            tmpfs_file->pages[index] = NULL;
+        }
+    }
+}
+
+/// @brief Destroys the given TMPFS file, and gives its pages back.
+/// @param tmpfs_file pointer to the TMPFS file to destroy.
+static inline void tmpfs_destroy_file(tmpfs_file_t *tmpfs_file)
+{
+    pr_debug("tmpfs_destroy_file(%p) `%s`\n", tmpfs_file, tmpfs_file->name);
+    if (!tmpfs_file->unlinked) {
+        list_head_remove(&tmpfs_file->siblings);
+        --tmpfs.nfiles;
+    }
+    tmpfs_drop_pages(tmpfs_file, 0);
+    if (tmpfs_file->pages) {
+        kfree(tmpfs_file->pages);
+    }
+    ida_free(&tmpfs.inodes, tmpfs_file->inode);
+    tmpfs_file->magic = 0;
+    kmem_cache_free(tmpfs_file);
+}
+
+/// @brief Returns a page of the content of a file.
+/// @param tmpfs_file the TMPFS file.
+/// @param index the index of the page.
+/// @param alloc if the page must be allocated, when it was never written.
+/// @return the page, NULL if it was never written or cannot be allocated.
+static page_t *tmpfs_find_page(tmpfs_file_t *tmpfs_file, uint32_t index, int alloc)
+{
+    if ((index < tmpfs_file->npages) && tmpfs_file->pages[index]) {
+        return tmpfs_file->pages[index];
+    }
+    if (!alloc) {
+        return NULL;
+    }
+    // Grow the array of pages, doubling it to keep the appends cheap.
+    if (index >= tmpfs_file->npages) {
+        uint32_t npages = max(index + 1, 2 * tmpfs_file->npages);
+        page_t **pages  = kmalloc(npages * sizeof(page_t *));
+        if (!pages) {
+            return NULL;
+        }
+        memset(pages, 0, npages * sizeof(page_t *));
+        if (tmpfs_file->pages) {
+            memcpy(pages, tmpfs_file->pages, tmpfs_file->npages * sizeof(page_t *));
+            kfree(tmpfs_file->pages);
+        }
+        tmpfs_file->pages  = pages;
+        tmpfs_file->npages = npages;
+    }
+    tmpfs_file->pages[index] = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+    if (!tmpfs_file->pages[index]) {
+        pr_err("Failed to allocate a page of `%s`.\n", tmpfs_file->name);
+    }
+    return tmpfs_file->pages[index];
+}
+
+/// @brief Creates a VFS file, from a TMPFS file.
+/// @param tmpfs_file the TMPFS file.
+/// @return a pointer to the newly create VFS file, NULL on failure.
+static inline vfs_file_t *tmpfs_create_file_struct(tmpfs_file_t *tmpfs_file)
+{
+    vfs_file_t *vfs_file = vfs_alloc_file();
+    if (!vfs_file) {
+        pr_err("tmpfs_create_file_struct(%s): Failed to allocate the VFS file!\n", tmpfs_file->name);
+        return NULL;
+    }
+    memset(vfs_file, 0, sizeof(vfs_file_t));
+    strncpy(vfs_file->name, tmpfs_file->name, NAME_MAX - 1);
+    vfs_file->device         = tmpfs_file;
+    vfs_file->ino            = tmpfs_file->inode;
+    vfs_file->uid            = tmpfs_file->uid;
+    vfs_file->gid            = tmpfs_file->gid;
+    vfs_file->mask           = tmpfs_file->mask;
+    vfs_file->length         = tmpfs_file->size;
+    vfs_file->flags          = tmpfs_file->flags;
+    vfs_file->nlink          = 1;
+    vfs_file->atime          = tmpfs_file->atime;
+    vfs_file->mtime          = tmpfs_file->mtime;
+    vfs_file->ctime          = tmpfs_file->ctime;
+    vfs_file->sys_operations = &tmpfs_sys_operations;
+    vfs_file->fs_operations  = &tmpfs_fs_operations;
+    list_head_init(&vfs_file->siblings);
+    // Add the vfs_file to the list of associated files.
+    list_head_insert_before(&vfs_file->siblings, &tmpfs_file->files);
+    tmpfs_file->atime = sys_time(NULL);
+    return vfs_file;
+}
+
+/// @brief Changes the size of a TMPFS file.
+/// @param tmpfs_file the TMPFS file.
+/// @param size the new size.
+static void tmpfs_resize(tmpfs_file_t *tmpfs_file, uint32_t size)
+{
+    if (size < tmpfs_file->size) {
+        uint32_t npages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        tmpfs_drop_pages(tmpfs_file, npages);
+        // The tail of the last page reads as zero, if the file grows again.
+        page_t *page = (size % PAGE_SIZE) ? tmpfs_find_page(tmpfs_file, npages - 1, 0) : NULL;
+        if (page) {
+            char *vaddr = kmap_atomic(page);
+            if (vaddr) {
+                memset(vaddr + (size % PAGE_SIZE), 0, PAGE_SIZE - (size % PAGE_SIZE));
+                kunmap_atomic(vaddr);
+            }
+        }
+    }
+    tmpfs_file->size  = size;
+    tmpfs_file->mtime = sys_time(NULL);
+    tmpfs_file->ctime = tmpfs_file->mtime;
+}
+
+/// @brief Saves the information concerning the file.
+/// @param tmpfs_file The file containing the data.
+/// @param stat The structure where the information are stored.
+/// @return 0 if success.
+static int __tmpfs_stat(tmpfs_file_t *tmpfs_file, stat_t *stat)
+{
+    stat->st_mode    = ((tmpfs_file->flags & DT_DIR) ? S_IFDIR : S_IFREG) | tmpfs_file->mask;
+    stat->st_uid     = tmpfs_file->uid;
+    stat->st_gid     = tmpfs_file->gid;
+    stat->st_dev     = 0;
+    stat->st_ino     = tmpfs_file->inode;
+    stat->st_nlink   = tmpfs_file->unlinked ? 0 : 1;
+    stat->st_size    = tmpfs_file->size;
+    stat->st_blksize = PAGE_SIZE;
+    stat->st_atime   = tmpfs_file->atime;
+    stat->st_mtime   = tmpfs_file->mtime;
+    stat->st_ctime   = tmpfs_file->ctime;
+    // Only the pages which have been written take memory.
+    stat->st_blocks  = 0;
+    for (uint32_t index = 0; index < tmpfs_file->npages; ++index) {
+        if (tmpfs_file->pages[index]) {
+            stat->st_blocks += PAGE_SIZE / 512;
+        }
+    }
+    return 0;
+}
+
+// ============================================================================
+// Virtual FileSystem (VFS) Functions
+// ============================================================================
+
+/// @brief Creates a new directory.
+/// @param path The path to the new directory.
+/// @param mode The file mode.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_mkdir(const char *path, mode_t mode)
+{
+    if (tmpfs_find_entry_path(path) != NULL) {
+        return -EEXIST;
+    }
+    int ret = tmpfs_check_parent(path);
+    if (ret < 0) {
+        return ret;
+    }
+    if (!tmpfs_create_file(path, DT_DIR, mode)) {
+        pr_err("tmpfs_mkdir(%s): Cannot create the tmpfs file.\n", path);
+        return -ENOSPC;
+    }
+    return 0;
+}
+
+/// @brief Removes a directory.
+/// @param path The path to the directory.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_rmdir(const char *path)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_find_entry_path(path);
+    if (tmpfs_file == NULL) {
+        return -ENOENT;
+    }
+    if ((tmpfs_file->flags & DT_DIR) == 0) {
+        return -ENOTDIR;
+    }
+    // The root of the filesystem is held open by its mount point.
+    if (!list_head_empty(&tmpfs_file->files)) {
+        return -EBUSY;
+    }
+    if (tmpfs_check_if_empty(tmpfs_file->name)) {
+        return -ENOTEMPTY;
+    }
+    tmpfs_destroy_file(tmpfs_file);
+    return 0;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param path The path to the file.
+/// @param stat The structure where the information are stored.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_stat(const char *path, stat_t *stat)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_find_entry_path(path);
+    if (tmpfs_file == NULL) {
+        return -ENOENT;
+    }
+    return __tmpfs_stat(tmpfs_file, stat);
+}
+
+/// @brief Open the file at the given path and returns its file descriptor.
+/// @param path  The path to the file.
+/// @param flags The flags used to determine the behavior of the function.
+/// @param mode  The mode with which we create the file.
+/// @return The opened file, NULL on failure and errno is set.
+static vfs_file_t *tmpfs_open(const char *path, int flags, mode_t mode)
+{
+    int writable             = (flags & O_ACCMODE) != O_RDONLY;
+    tmpfs_file_t *tmpfs_file = tmpfs_find_entry_path(path);
+    if (tmpfs_file != NULL) {
+        if (bitmask_check(flags, O_CREAT | O_EXCL)) {
+            errno = EEXIST;
+            return NULL;
+        }
+        if (bitmask_check(flags, O_DIRECTORY) && !(tmpfs_file->flags & DT_DIR)) {
+            errno = ENOTDIR;
+            return NULL;
+        }
+        if ((tmpfs_file->flags & DT_DIR) && writable) {
+            errno = EISDIR;
+            return NULL;
+        }
+        if (bitmask_check(flags, O_TRUNC) && writable && tmpfs_file->size) {
+            tmpfs_resize(tmpfs_file, 0);
+        }
+    } else {
+        if (!bitmask_check(flags, O_CREAT)) {
+            errno = ENOENT;
+            return NULL;
+        }
+        int ret = tmpfs_check_parent(path);
+        if (ret < 0) {
+            errno = -ret;
+            return NULL;
+        }
+        tmpfs_file = tmpfs_create_file(path, DT_REG, mode);
+        if (!tmpfs_file) {
+            errno = ENOSPC;
+            return NULL;
+        }
+    }
+    vfs_file_t *vfs_file = tmpfs_create_file_struct(tmpfs_file);
+    if (!vfs_file) {
+        errno = ENFILE;
+        return NULL;
+    }
+    return vfs_file;
+}
+
+/// @brief Closes the given file.
+/// @param file The file structure.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_close(vfs_file_t *file)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    if (--file->count == 0) {
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+        // A removed file goes away with its last opened file.
+        if (tmpfs_file->unlinked && list_head_empty(&tmpfs_file->files)) {
+            tmpfs_destroy_file(tmpfs_file);
+        }
+    }
+    return 0;
+}
+
+/// @brief Deletes the file at the given path.
+/// @param path The path to the file.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_unlink(const char *path)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_find_entry_path(path);
+    if (tmpfs_file == NULL) {
+        return -ENOENT;
+    }
+    if (tmpfs_file->flags & DT_DIR) {
+        return -EISDIR;
+    }
+    // The path is free at once, the content stays while the file is open.
+    list_head_remove(&tmpfs_file->siblings);
+    --tmpfs.nfiles;
+    tmpfs_file->unlinked = 1;
+    if (list_head_empty(&tmpfs_file->files)) {
+        tmpfs_destroy_file(tmpfs_file);
+    }
+    return 0;
+}
+
+/// @brief Reads from the file identified by the file descriptor.
+/// @param file The file.
+/// @param buffer Buffer where the read content must be placed.
+/// @param offset Offset from which we start reading from the file.
+/// @param nbyte The number of bytes to read.
+/// @return The number of read bytes, -errno on failure.
+static ssize_t tmpfs_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    if (tmpfs_file->flags & DT_DIR) {
+        return -EISDIR;
+    }
+    if ((offset < 0) || ((uint32_t)offset >= tmpfs_file->size)) {
+        return 0;
+    }
+    size_t total = min(nbyte, tmpfs_file->size - (uint32_t)offset);
+    size_t done  = 0;
+    while (done < total) {
+        uint32_t position = (uint32_t)offset + done;
+        uint32_t start    = position % PAGE_SIZE;
+        uint32_t length   = min(PAGE_SIZE - start, total - done);
+        page_t *page      = tmpfs_find_page(tmpfs_file, position / PAGE_SIZE, 0);
+        // The holes read as zero.
+        if (!page) {
+            memset(buffer + done, 0, length);
+        } else {
+            uint32_t vaddr = vmem_map_physical_pages(page, 1);
+            if (!vaddr) {
+                pr_crit("Failed to map the physical page to virtual address.\n");
+                return done ? (ssize_t)done : -ENOMEM;
+            }
+            memcpy(buffer + done, (char *)vaddr + start, length);
+            vmem_unmap_virtual_address(vaddr);
+        }
+        done += length;
+    }
+    tmpfs_file->atime = sys_time(NULL);
+    return (ssize_t)done;
+}
+
+/// @brief Writes the given content inside the file.
+/// @param file The file descriptor of the file.
+/// @param buffer The content to write.
+/// @param offset Offset from which we start writing in the file.
+/// @param nbyte The number of bytes to write.
+/// @return The number of written bytes, -errno on failure.
+static ssize_t tmpfs_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    if (tmpfs_file->flags & DT_DIR) {
+        return -EISDIR;
+    }
+    if ((offset < 0) || ((uint32_t)offset + nbyte < (uint32_t)offset)) {
+        return -EFBIG;
+    }
+    size_t done = 0;
+    while (done < nbyte) {
+        uint32_t position = (uint32_t)offset + done;
+        uint32_t start    = position % PAGE_SIZE;
+        uint32_t length   = min(PAGE_SIZE - start, nbyte - done);
+        page_t *page      = tmpfs_find_page(tmpfs_file, position / PAGE_SIZE, 1);
+        uint32_t vaddr    = page ? vmem_map_physical_pages(page, 1) : 0;
+        if (!vaddr) {
+            break;
+        }
+        memcpy((char *)vaddr + start, (const char *)buffer + done, length);
+        vmem_unmap_virtual_address(vaddr);
+        done += length;
+    }
+    if (!done && nbyte) {
+        return -ENOSPC;
+    }
+    if ((uint32_t)offset + done > tmpfs_file->size) {
+        tmpfs_file->size = (uint32_t)offset + done;
+    }
+    tmpfs_file->mtime = sys_time(NULL);
+    tmpfs_file->ctime = tmpfs_file->mtime;
+    file->length      = tmpfs_file->size;
+    return (ssize_t)done;
+}
+
+/// @brief Repositions the file offset inside a file.
+/// @param file the file we are working with.
+/// @param offset the offest to use for the operation.
+/// @param whence the type of operation.
+/// @return the resulting offset, -errno on failure.
+static off_t tmpfs_lseek(vfs_file_t *file, off_t offset, int whence)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    switch (whence) {
+    case SEEK_END:
+        offset += tmpfs_file->size;
+        break;
+    case SEEK_CUR:
+        offset += file->f_pos;
+        break;
+    case SEEK_SET:
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (offset < 0) {
+        return -EINVAL;
+    }
+    file->f_pos = offset;
+    return offset;
+}
+
+/// @brief Retrieves information concerning the file at the given position.
+/// @param file The file struct.
+/// @param stat The structure where the information are stored.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_fstat(vfs_file_t *file, stat_t *stat)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    return __tmpfs_stat(tmpfs_file, stat);
+}
+
+/// @brief Reads contents of the directories to a dirent buffer.
+/// @param file  The directory handler.
+/// @param dirp  The buffer where the data should be written.
+/// @param doff  The offset inside the directory where the reading starts.
+/// @param count The maximum length of the buffer.
+/// @return The number of written bytes in the buffer, -errno on failure.
+static ssize_t tmpfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t doff, size_t count)
+{
+    tmpfs_file_t *direntry = tmpfs_get_file_struct(file);
+    if ((direntry == NULL) || !dirp || (count < sizeof(dirent_t))) {
+        return -EINVAL;
+    }
+    if ((direntry->flags & DT_DIR) == 0) {
+        return -ENOTDIR;
+    }
+    memset(dirp, 0, count);
+    size_t len           = strlen(direntry->name);
+    ssize_t written_size = 0;
+    off_t iterated_size  = 0;
+    char parent_path[PATH_MAX];
+    list_for_each_decl (it, &tmpfs.files) {
+        tmpfs_file_t *entry = tmpfs_get_file(it);
+        if (!entry || (entry == direntry)) {
+            continue;
+        }
+        // Only the entries whose parent is the directory.
+        if (!dirname(entry->name, parent_path, sizeof(parent_path)) || strcmp(direntry->name, parent_path)) {
+            continue;
+        }
+        iterated_size += sizeof(dirent_t);
+        if (iterated_size <= doff) {
+            continue;
+        }
+        if ((written_size + sizeof(dirent_t)) > count) {
+            break;
+        }
+        dirp->d_ino  = entry->inode;
+        dirp->d_type = entry->flags;
+        strcpy(dirp->d_name, entry->name + len + 1);
+        dirp->d_off    = sizeof(dirent_t);
+        dirp->d_reclen = sizeof(dirent_t);
+        written_size += sizeof(dirent_t);
+        ++dirp;
+    }
+    return written_size;
+}
+
+/// @brief Changes the size of a file.
+/// @param file The file.
+/// @param length The new size.
+/// @return 0 on success, -errno on failure.
+static int tmpfs_truncate(vfs_file_t *file, off_t length)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return -EINVAL;
+    }
+    if (tmpfs_file->flags & DT_DIR) {
+        return -EISDIR;
+    }
+    tmpfs_resize(tmpfs_file, (uint32_t)length);
+    file->length = tmpfs_file->size;
+    return 0;
+}
+
+/// @brief Returns the page holding the content of a file at the given offset.
+/// @param file The file.
+/// @param offset The offset inside the file, aligned to the page size.
+/// @return the page, with a reference taken for the caller, NULL on failure.
+static page_t *tmpfs_get_page(vfs_file_t *file, uint32_t offset)
+{
+    tmpfs_file_t *tmpfs_file = tmpfs_get_file_struct(file);
+    if (tmpfs_file == NULL) {
+        return NULL;
+    }
+    // The mapping and the file share the page, allocated if it was a hole.
+    page_t *page = tmpfs_find_page(tmpfs_file, offset / PAGE_SIZE, 1);
+    if (page) {
+        page_inc(page);
+    }
+    return page;
+}
+
+// ============================================================================
+// Initialization Functions
+// ============================================================================
+
+/// @brief Mounts the filesystem at the given path.
+/// @param path the path where we want to mount a tmpfs.
+/// @param device we expect it to be NULL.
+/// @param options the mount options, unused.
+/// @return a pointer to the root VFS file.
+static vfs_file_t *tmpfs_mount_callback(const char *path, const char *device, const char *options)
+{
+    pr_debug("tmpfs_mount_callback(%s, %s)\n", path, device);
+    // All the mount points share the same files, so when a tmpfs is mounted
+    // inside another one (e.g., the initramfs), the directory is reused.
+    tmpfs_file_t *tmpfs_file = tmpfs_find_entry_path(path);
+    if (tmpfs_file && (tmpfs_file->flags & DT_DIR)) {
+        return tmpfs_create_file_struct(tmpfs_file);
+    }
+    // Everyone can create files inside the root, and remove only their own.
+    tmpfs_file = tmpfs_create_file(path, DT_DIR, S_IRWXU | S_IRWXG | S_IRWXO | S_ISVTX);
+    if (!tmpfs_file) {
+        pr_err("tmpfs_mount_callback(%s): Cannot create the root.\n", path);
+        return NULL;
+    }
+    vfs_file_t *vfs_file = tmpfs_create_file_struct(tmpfs_file);
+    if (!vfs_file) {
+        tmpfs_destroy_file(tmpfs_file);
+        return NULL;
+    }
+    return vfs_file;
+}
+
+/// Filesystem information.
+static file_system_type_t tmpfs_file_system_type = {.name = "tmpfs", .fs_flags = 0, .mount = tmpfs_mount_callback};
+
+int tmpfs_module_init(void)
+{
+    memset(&tmpfs, 0, sizeof(tmpfs_t));
+    tmpfs.tmpfs_file_cache = KMEM_CREATE(tmpfs_file_t);
+    if (!tmpfs.tmpfs_file_cache) {
+        return 1;
+    }
+    list_head_init(&tmpfs.files);
+    // Initialize the inodes, starting from 1.
+    ida_init(&tmpfs.inodes, tmpfs_inodes, TMPFS_MAX_FILES);
+    ida_mark_used(&tmpfs.inodes, 0);
+    vfs_register_filesystem(&tmpfs_file_system_type);
+    return 0;
+}
+
+int tmpfs_cleanup_module(void)
+{
+    kmem_cache_destroy(tmpfs.tmpfs_file_cache);
+    vfs_unregister_filesystem(&tmpfs_file_system_type);
+    return 0;
+}
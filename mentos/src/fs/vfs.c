@@ -13,10 +13,14 @@
 #include "fcntl.h"
 #include "fs/namei.h"
 #include "fs/pipe.h"
+#include "fs/poll.h"
 #include "fs/procfs.h"
+#include "fs/seq_file.h"
 #include "fs/vfs.h"
 #include "klib/spinlock.h"
 #include "libgen.h"
+#include "math.h"
+#include "mem/mm/page_cache.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "strerror.h"
@@ -31,9 +35,28 @@
 static int resource_id = -1;
 #endif
 
-/// The list of superblocks.
+/// @brief A node of the mount tree, there is one for each path component
+/// leading to a mount point.
+typedef struct vfs_mount_node {
+    /// The path component.
+    char name[NAME_MAX];
+    /// The parent node, NULL for the root.
+    struct vfs_mount_node *parent;
+    /// The superblocks mounted on the path of the node, the most recent first.
+    list_head_t superblocks;
+    /// The child nodes.
+    list_head_t children;
+    /// Used to place the node inside the children of its parent.
+    list_head_t siblings;
+    /// Frees the node, once the lookups which might see it have finished.
+    rcu_head_t rcu;
+} vfs_mount_node_t;
+
+/// The list of superblocks, the readers walk it under RCU, the writers hold vfs_spinlock.
 static list_head_t vfs_super_blocks;
-/// The list of filesystems.
+/// The root of the mount tree, corresponding to `/`.
+static vfs_mount_node_t vfs_mount_root;
+/// The list of filesystems, the readers walk it under RCU, the writers hold vfs_spinlock.
 static list_head_t vfs_filesystems;
 /// Lock for refcount field.
 static spinlock_t vfs_spinlock_refcount;
@@ -47,8 +70,11 @@ static kmem_cache_t *vfs_file_cache;
 
 void vfs_init(void)
 {
-    // Initialize the list of superblocks.
+    // Initialize the list of superblocks, and the mount tree.
     list_head_init(&vfs_super_blocks);
+    list_head_init(&vfs_mount_root.superblocks);
+    list_head_init(&vfs_mount_root.children);
+    list_head_init(&vfs_mount_root.siblings);
     // Initialize the list of filesystems.
     list_head_init(&vfs_filesystems);
     // Initialize the caches for superblocks and files.
@@ -82,7 +108,7 @@ vfs_file_t *pr_vfs_alloc_file(const char *file, const char *fun, int line)
 
 #ifdef ENABLE_FILE_TRACE
     // Store trace information for debugging resource usage.
-    store_resource_info(resource_id, file, line, vfs_file);
+    store_resource_info(resource_id, file, line, vfs_file, sizeof(vfs_file_t));
 #endif
 
     // Zero out the allocated structure to ensure clean initialization.
@@ -121,6 +147,19 @@ void pr_vfs_dealloc_file(const char *file, const char *fun, int line, vfs_file_t
     clear_resource_info(vfs_file);
 #endif
 
+    // Free the read-ahead buffer, if any.
+    if (vfs_file->ra.buffer) {
+        kfree(vfs_file->ra.buffer);
+    }
+
+    // Free the path the file was opened with, if any.
+    if (vfs_file->path) {
+        kfree(vfs_file->path);
+    }
+
+    // Free the buffer of the formatted records, if any.
+    seq_release(vfs_file);
+
     // Free the VFS file back to the cache.
     kmem_cache_free(vfs_file);
 
@@ -135,13 +174,17 @@ void pr_vfs_dealloc_file(const char *file, const char *fun, int line, vfs_file_t
 /// @return Pointer to the filesystem type if found, or NULL if not found.
 file_system_type_t *__vfs_find_filesystem(const char *name)
 {
-    list_for_each_decl (it, &vfs_filesystems) {
+    file_system_type_t *found = NULL;
+    rcu_read_lock();
+    list_for_each_rcu (it, &vfs_filesystems) {
         file_system_type_t *fs = list_entry(it, file_system_type_t, list);
         if (strcmp(fs->name, name) == 0) {
-            return fs;
+            found = fs;
+            break;
         }
     }
-    return NULL;
+    rcu_read_unlock();
+    return found;
 }
 
 int vfs_register_filesystem(file_system_type_t *fs)
@@ -151,14 +194,21 @@ int vfs_register_filesystem(file_system_type_t *fs)
     // Initialize the list head for the fs.
     list_head_init(&fs->list);
     // Insert the file system.
-    list_head_insert_before(&fs->list, &vfs_filesystems);
+    spinlock_lock(&vfs_spinlock);
+    list_head_insert_before_rcu(&fs->list, &vfs_filesystems);
+    spinlock_unlock(&vfs_spinlock);
     return 1;
 }
 
 int vfs_unregister_filesystem(file_system_type_t *fs)
 {
     pr_debug("vfs_unregister_filesystem(name: %s)\n", fs->name);
-    list_head_remove(&fs->list);
+    spinlock_lock(&vfs_spinlock);
+    list_head_remove_rcu(&fs->list);
+    spinlock_unlock(&vfs_spinlock);
+    // The type belongs to the caller, which may register it again.
+    synchronize_rcu();
+    list_head_init(&fs->list);
     return 1;
 }
 
@@ -173,9 +223,119 @@ static inline void __vfs_dump_superblock(int log_level, super_block_t *sb)
 
 void vfs_dump_superblocks(int log_level)
 {
-    list_for_each_decl (it, &vfs_super_blocks) {
+    rcu_read_lock();
+    list_for_each_rcu (it, &vfs_super_blocks) {
         __vfs_dump_superblock(log_level, list_entry(it, super_block_t, mounts));
     }
+    rcu_read_unlock();
+}
+
+ssize_t vfs_mounts_dump(char *buffer, size_t bufsize)
+{
+    size_t written = 0;
+    // The superblocks are listed in the order they were registered.
+    rcu_read_lock();
+    list_for_each_rcu (it, &vfs_super_blocks) {
+        super_block_t *sb = list_entry(it, super_block_t, mounts);
+        if (written >= bufsize) {
+            break;
+        }
+        written += snprintf(
+            buffer + written, bufsize - written, "%s %s %s rw 0 0\n", sb->name, sb->path, sb->type->name);
+    }
+    rcu_read_unlock();
+    return min(written, bufsize);
+}
+
+/// @brief Returns the next component of a path, skipping the separators.
+/// @param path the path, upon return it points after the component.
+/// @param length the output variable where we store the length of the component.
+/// @return a pointer to the component, NULL if there are no more components.
+static inline const char *__vfs_next_component(const char **path, size_t *length)
+{
+    const char *start = *path;
+    while (*start == '/') {
+        ++start;
+    }
+    if (*start == '\0') {
+        return NULL;
+    }
+    const char *end = start;
+    while ((*end != '\0') && (*end != '/')) {
+        ++end;
+    }
+    *length = end - start;
+    *path   = end;
+    return start;
+}
+
+/// @brief Searches for a child of a node of the mount tree.
+/// @param node the node.
+/// @param name the name of the child, not necessarily terminated.
+/// @param length the length of the name.
+/// @return a pointer to the child, NULL if there is no such child.
+static inline vfs_mount_node_t *__vfs_mount_child(vfs_mount_node_t *node, const char *name, size_t length)
+{
+    list_for_each_rcu (it, &node->children) {
+        vfs_mount_node_t *child = list_entry(it, vfs_mount_node_t, siblings);
+        if (!strncmp(child->name, name, length) && (child->name[length] == '\0')) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Returns the node of the mount tree for the given path, creating the
+/// missing nodes along the way.
+/// @param path the path.
+/// @return a pointer to the node, NULL on failure.
+static vfs_mount_node_t *__vfs_mount_lookup_create(const char *path)
+{
+    vfs_mount_node_t *node = &vfs_mount_root;
+    const char *name;
+    size_t length;
+    while ((name = __vfs_next_component(&path, &length)) != NULL) {
+        vfs_mount_node_t *child = __vfs_mount_child(node, name, length);
+        if (child == NULL) {
+            if (length >= NAME_MAX) {
+                pr_err("The component of the mount path is too long.\n");
+                return NULL;
+            }
+            child = kmalloc(sizeof(vfs_mount_node_t));
+            if (child == NULL) {
+                pr_crit("Failed to allocate memory for the mount tree.\n");
+                return NULL;
+            }
+            memcpy(child->name, name, length);
+            child->name[length] = '\0';
+            child->parent       = node;
+            list_head_init(&child->superblocks);
+            list_head_init(&child->children);
+            list_head_insert_before_rcu(&child->siblings, &node->children);
+        }
+        node = child;
+    }
+    return node;
+}
+
+/// @brief Frees a node of the mount tree, once the lookups have left it.
+/// @param head the head inside the node.
+static void __vfs_mount_node_free(rcu_head_t *head) { kfree(container_of(head, vfs_mount_node_t, rcu)); }
+
+/// @brief Frees a superblock, once the lookups have left it.
+/// @param head the head inside the superblock.
+static void __vfs_superblock_free(rcu_head_t *head) { kmem_cache_free(container_of(head, super_block_t, rcu)); }
+
+/// @brief Frees the nodes of the mount tree which do not lead to a mount point anymore.
+/// @param node the node from which we start, going up towards the root.
+static void __vfs_mount_prune(vfs_mount_node_t *node)
+{
+    while (node->parent && list_head_empty(&node->superblocks) && list_head_empty(&node->children)) {
+        vfs_mount_node_t *parent = node->parent;
+        list_head_remove_rcu(&node->siblings);
+        call_rcu(&node->rcu, __vfs_mount_node_free);
+        node = parent;
+    }
 }
 
 int vfs_register_superblock(const char *name, const char *path, file_system_type_t *type, vfs_file_t *root)
@@ -223,8 +383,18 @@ int vfs_register_superblock(const char *name, const char *path, file_system_type
     // Initialize the list head for the superblock.
     list_head_init(&sb->mounts);
 
-    // Insert the superblock into the global list of superblocks.
-    list_head_insert_after(&sb->mounts, &vfs_super_blocks);
+    // Place the superblock inside the mount tree, on top of the ones already
+    // mounted on the same path.
+    sb->mountpoint = __vfs_mount_lookup_create(path);
+    if (!sb->mountpoint) {
+        kmem_cache_free(sb);
+        spinlock_unlock(&vfs_spinlock);
+        return 0;
+    }
+    list_head_insert_after_rcu(&sb->stacked, &sb->mountpoint->superblocks);
+
+    // Append the superblock to the global list of superblocks.
+    list_head_insert_before_rcu(&sb->mounts, &vfs_super_blocks);
 
     // Unlock the vfs spinlock.
     spinlock_unlock(&vfs_spinlock);
@@ -235,29 +405,34 @@ int vfs_register_superblock(const char *name, const char *path, file_system_type
 int vfs_unregister_superblock(super_block_t *sb)
 {
     pr_debug("vfs_unregister_superblock(name: %s, path: %s, type: %s)\n", sb->name, sb->path, sb->type->name);
-    list_head_remove(&sb->mounts);
-    kmem_cache_free(sb);
+    spinlock_lock(&vfs_spinlock);
+    list_head_remove_rcu(&sb->mounts);
+    list_head_remove_rcu(&sb->stacked);
+    __vfs_mount_prune(sb->mountpoint);
+    spinlock_unlock(&vfs_spinlock);
+    call_rcu(&sb->rcu, __vfs_superblock_free);
     return 1;
 }
 
 super_block_t *vfs_get_superblock(const char *path)
 {
     pr_debug("vfs_get_superblock(path: %s)\n", path);
-    size_t last_sb_len = 0;
-    size_t len;
-    super_block_t *last_sb = NULL;
+    vfs_mount_node_t *node = &vfs_mount_root;
     super_block_t *sb      = NULL;
-    list_for_each_decl (it, &vfs_super_blocks) {
-        sb  = list_entry(it, super_block_t, mounts);
-        len = strlen(sb->path);
-        if (!strncmp(path, sb->path, len)) {
-            if (len > last_sb_len) {
-                last_sb_len = len;
-                last_sb     = sb;
-            }
+    const char *name;
+    size_t length;
+    // Walk down the mount tree, one component at a time, remembering the
+    // deepest mount point we go through.
+    rcu_read_lock();
+    do {
+        list_head_t *top = rcu_dereference(node->superblocks.next);
+        if (top != &node->superblocks) {
+            sb = list_entry(top, super_block_t, stacked);
         }
-    }
-    return last_sb;
+        name = __vfs_next_component(&path, &length);
+    } while (name && ((node = __vfs_mount_child(node, name, length)) != NULL));
+    rcu_read_unlock();
+    return sb;
 }
 
 vfs_file_t *vfs_open_abspath(const char *absolute_path, int flags, mode_t mode)
@@ -320,7 +495,31 @@ vfs_file_t *vfs_open(const char *path, int flags, mode_t mode)
         return NULL;
     }
     pr_debug("vfs_open(path: %s, flags: %d, mode: %d) -> %s\n", path, flags, mode, absolute_path);
-    return vfs_open_abspath(absolute_path, flags, mode);
+    vfs_file_t *file = vfs_open_abspath(absolute_path, flags, mode);
+    // Remember the path, from which the lookups relative to the file start.
+    if (file && !file->path && (file->path = kmalloc(strlen(absolute_path) + 1))) {
+        strcpy(file->path, absolute_path);
+    }
+    return file;
+}
+
+int vfs_path_at(vfs_file_t *directory, const char *path, char *buffer, size_t buflen)
+{
+    if (path[0] == '/') {
+        if (strlen(path) >= buflen) {
+            return -ENAMETOOLONG;
+        }
+        strcpy(buffer, path);
+        return 0;
+    }
+    if (!directory->path) {
+        return -EBADF;
+    }
+    const char *separator = (directory->path[strlen(directory->path) - 1] == '/') ? "" : "/";
+    if (snprintf(buffer, buflen, "%s%s%s", directory->path, separator, path) >= (int)buflen) {
+        return -ENAMETOOLONG;
+    }
+    return 0;
 }
 
 int vfs_close(vfs_file_t *file)
@@ -386,9 +585,95 @@ ssize_t vfs_write(vfs_file_t *file, const void *buf, size_t offset, size_t nbyte
         pr_err("No WRITE function found for the current filesystem.\n");
         return -ENOSYS;
     }
+    // The processes which are mapping the file keep the old pages.
+    page_cache_invalidate(file);
     return file->fs_operations->write_f(file, buf, offset, nbytes);
 }
 
+ssize_t vfs_readv(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    if (file->fs_operations->readv_f) {
+        return file->fs_operations->readv_f(file, iov, iovcnt, offset);
+    }
+    if (file->fs_operations->read_f == NULL) {
+        pr_err("No READ function found for the current filesystem.\n");
+        return -ENOSYS;
+    }
+    // Read one segment at a time, stopping at the first short read.
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret = file->fs_operations->read_f(file, iov[i].iov_base, offset + total, iov[i].iov_len);
+        if (ret < 0) {
+            return (total > 0) ? total : ret;
+        }
+        total += ret;
+        if ((size_t)ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t vfs_writev(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    // The processes which are mapping the file keep the old pages.
+    page_cache_invalidate(file);
+    if (file->fs_operations->writev_f) {
+        return file->fs_operations->writev_f(file, iov, iovcnt, offset);
+    }
+    if (file->fs_operations->write_f == NULL) {
+        pr_err("No WRITE function found for the current filesystem.\n");
+        return -ENOSYS;
+    }
+    // Write one segment at a time, stopping at the first short write.
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        ssize_t ret = file->fs_operations->write_f(file, iov[i].iov_base, offset + total, iov[i].iov_len);
+        if (ret < 0) {
+            return (total > 0) ? total : ret;
+        }
+        total += ret;
+        if ((size_t)ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t vfs_readv_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    // The other filesystems ignore O_DIRECT.
+    if (file->fs_operations->readv_direct_f == NULL) {
+        return vfs_readv(file, iov, iovcnt, offset);
+    }
+    return file->fs_operations->readv_direct_f(file, iov, iovcnt, offset);
+}
+
+ssize_t vfs_writev_direct(vfs_file_t *file, const struct iovec *iov, int iovcnt, size_t offset)
+{
+    // The other filesystems ignore O_DIRECT.
+    if (file->fs_operations->writev_direct_f == NULL) {
+        return vfs_writev(file, iov, iovcnt, offset);
+    }
+    // The processes which are mapping the file keep the old pages.
+    page_cache_invalidate(file);
+    return file->fs_operations->writev_direct_f(file, iov, iovcnt, offset);
+}
+
+unsigned int vfs_poll(vfs_file_t *file, struct poll_table *table)
+{
+    if (file->fs_operations->poll_f == NULL) {
+        return POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM;
+    }
+    return file->fs_operations->poll_f(file, table);
+}
+
 off_t vfs_lseek(vfs_file_t *file, off_t offset, int whence)
 {
     if (file->fs_operations->lseek_f == NULL) {
@@ -398,6 +683,69 @@ off_t vfs_lseek(vfs_file_t *file, off_t offset, int whence)
     return file->fs_operations->lseek_f(file, offset, whence);
 }
 
+int vfs_fsync(vfs_file_t *file)
+{
+    // Filesystems without buffering have nothing to flush.
+    if (file->fs_operations->fsync_f == NULL) {
+        return 0;
+    }
+    return file->fs_operations->fsync_f(file);
+}
+
+int vfs_fadvise(vfs_file_t *file, off_t offset, off_t len, int advice)
+{
+    if ((offset < 0) || (len < 0)) {
+        return -EINVAL;
+    }
+    switch (advice) {
+    case POSIX_FADV_NORMAL:
+    case POSIX_FADV_RANDOM:
+    case POSIX_FADV_SEQUENTIAL:
+        // The pattern holds for the whole file, as the read-ahead state does.
+        file->ra.advice = advice;
+        break;
+    case POSIX_FADV_WILLNEED:
+    case POSIX_FADV_DONTNEED:
+    case POSIX_FADV_NOREUSE:
+        break;
+    default:
+        return -EINVAL;
+    }
+    // The advice is only a hint, filesystems without caches ignore it.
+    if (file->fs_operations->fadvise_f == NULL) {
+        return 0;
+    }
+    return file->fs_operations->fadvise_f(file, offset, len, advice);
+}
+
+int vfs_truncate(vfs_file_t *file, off_t length)
+{
+    if (length < 0) {
+        return -EINVAL;
+    }
+    if (file->fs_operations->truncate_f == NULL) {
+        pr_err("No TRUNCATE function found for the current filesystem.\n");
+        return -EINVAL;
+    }
+    // The processes which are mapping the file keep the old pages.
+    page_cache_invalidate(file);
+    return file->fs_operations->truncate_f(file, length);
+}
+
+int vfs_sync(void)
+{
+    int ret = 0;
+    list_for_each_decl (it, &vfs_super_blocks) {
+        super_block_t *sb = list_entry(it, super_block_t, mounts);
+        // Flushing the root flushes the whole filesystem.
+        if (sb->root && (vfs_fsync(sb->root) < 0)) {
+            pr_err("Failed to synchronize the filesystem mounted on `%s`.\n", sb->path);
+            ret = -EIO;
+        }
+    }
+    return ret;
+}
+
 ssize_t vfs_getdents(vfs_file_t *file, dirent_t *dirp, off_t off, size_t count)
 {
     if (file->fs_operations->getdents_f == NULL) {
@@ -485,6 +833,36 @@ int vfs_mkdir(const char *path, mode_t mode)
     return sb_root->sys_operations->mkdir_f(absolute_path, mode);
 }
 
+int vfs_mknod(const char *path, mode_t mode, dev_t dev)
+{
+    pr_debug("vfs_mknod(path: %s, mode: %d, dev: %u)\n", path, mode, dev);
+    // Allocate a variable for the path.
+    char absolute_path[PATH_MAX];
+    // If the first character is not the '/' then get the absolute path.
+    int resolve_flags = REMOVE_TRAILING_SLASH | FOLLOW_LINKS | CREAT_LAST_COMPONENT;
+    int ret           = resolve_path(path, absolute_path, PATH_MAX, resolve_flags);
+    if (ret < 0) {
+        pr_err("vfs_mknod(%s): Cannot get the absolute path.\n", path);
+        return ret;
+    }
+    super_block_t *sb = vfs_get_superblock(absolute_path);
+    if (sb == NULL) {
+        pr_err("vfs_mknod(%s): Cannot find the superblock!\n", path);
+        return -ENODEV;
+    }
+    vfs_file_t *sb_root = sb->root;
+    if (sb_root == NULL) {
+        pr_err("vfs_mknod(%s): Cannot find the superblock root.\n", path);
+        return -ENOENT;
+    }
+    // Check if the function is implemented.
+    if (sb_root->sys_operations->mknod_f == NULL) {
+        pr_err("vfs_mknod(%s): Function not supported in current filesystem.\n", path);
+        return -EPERM;
+    }
+    return sb_root->sys_operations->mknod_f(absolute_path, mode, dev);
+}
+
 int vfs_rmdir(const char *path)
 {
     // Allocate a variable for the path.
@@ -614,8 +992,7 @@ int vfs_symlink(const char *linkname, const char *path)
             linkname, path);
         return -ENOSYS;
     }
-    pr_alert("vfs_symlink(%s, %s)", linkname, path);
-    return 0;
+    return sb_root->sys_operations->symlink_f(linkname, absolute_path);
 }
 
 int vfs_stat(const char *path, stat_t *buf)
@@ -650,6 +1027,26 @@ int vfs_stat(const char *path, stat_t *buf)
     return sb_root->sys_operations->stat_f(absolute_path, buf);
 }
 
+int vfs_fstatat(vfs_file_t *directory, const char *path, stat_t *buf)
+{
+    char absolute_path[PATH_MAX];
+    int ret = vfs_path_at(directory, path, absolute_path, PATH_MAX);
+    if (ret < 0) {
+        return ret;
+    }
+    // An entry of the directory itself is looked up starting from its inode,
+    // unless another filesystem is mounted on it.
+    if ((path[0] != '/') && !strchr(path, '/') && strcmp(path, ".") && strcmp(path, "..") &&
+        directory->fs_operations->statat_f) {
+        super_block_t *sb = vfs_get_superblock(absolute_path);
+        if (sb && sb->root && (sb->root->device == directory->device)) {
+            memset(buf, 0, sizeof(stat_t));
+            return directory->fs_operations->statat_f(directory, path, buf);
+        }
+    }
+    return vfs_stat(absolute_path, buf);
+}
+
 int vfs_fstat(vfs_file_t *file, stat_t *buf)
 {
     if (file->fs_operations->stat_f == NULL) {
@@ -669,7 +1066,7 @@ int vfs_fstat(vfs_file_t *file, stat_t *buf)
     return file->fs_operations->stat_f(file, buf);
 }
 
-int vfs_mount(const char *type, const char *path, const char *args)
+int vfs_mount(const char *type, const char *path, const char *args, const char *options)
 {
     file_system_type_t *fst = __vfs_find_filesystem(type);
     if (fst == NULL) {
@@ -693,7 +1090,7 @@ int vfs_mount(const char *type, const char *path, const char *args)
         return ret;
     }
     pr_debug("vfs_mount(type: %s, path: %s, args: %s (%s))\n", fst->name, path, args, absolute_path);
-    vfs_file_t *file = fst->mount(path, absolute_path);
+    vfs_file_t *file = fst->mount(path, absolute_path, options);
     if (file == NULL) {
         pr_err("Mount callback return a null pointer: %s\n", type);
         return -ENODEV;
@@ -714,6 +1111,21 @@ void vfs_lock(vfs_file_t *file)
     spinlock_unlock(&vfs_spinlock_refcount);
 }
 
+/// @brief Returns the number of words of the bitmap for the given number of file descriptors.
+#define FD_BITMAP_WORDS(max_fd) (((max_fd) + 31) / 32)
+
+/// @brief Allocates an empty table of file descriptors, used by one task.
+/// @return the table, NULL on failure.
+static inline files_struct_t *__files_alloc(void)
+{
+    files_struct_t *files = kmalloc(sizeof(files_struct_t));
+    if (files) {
+        memset(files, 0, sizeof(files_struct_t));
+        files->count = 1;
+    }
+    return files;
+}
+
 int vfs_extend_task_fd_list(struct task_struct *task)
 {
     if (!task) {
@@ -722,28 +1134,45 @@ int vfs_extend_task_fd_list(struct task_struct *task)
         return 0;
     }
     // Set the max number of file descriptors.
-    int new_max_fd    = (task->fd_list) ? (task->max_fd * 2) + 1 : MAX_OPEN_FD;
-    // Allocate the memory for the list.
-    void *new_fd_list = kmalloc(new_max_fd * sizeof(vfs_file_descriptor_t));
+    int new_max_fd = (task->files->fd_list) ? min(task->files->max_fd * 2, MAX_TASK_FD) : MAX_OPEN_FD;
+    if (new_max_fd <= task->files->max_fd) {
+        errno = EMFILE;
+        return 0;
+    }
+    // Allocate the memory for the list, and for the bitmap.
+    vfs_file_descriptor_t *new_fd_list = kmalloc(new_max_fd * sizeof(vfs_file_descriptor_t));
+    uint32_t *new_fd_bitmap            = kmalloc(FD_BITMAP_WORDS(new_max_fd) * sizeof(uint32_t));
     // Check the new list.
-    if (!new_fd_list) {
+    if (!new_fd_list || !new_fd_bitmap) {
         pr_err("Failed to allocate memory for `fd_list`.\n");
+        if (new_fd_list) {
+            kfree(new_fd_list);
+        }
+        if (new_fd_bitmap) {
+            kfree(new_fd_bitmap);
+        }
         errno = EMFILE;
         return 0;
     }
-    // Clear the memory of the new list.
-    memset(new_fd_list, 0, task->max_fd * sizeof(vfs_file_descriptor_t));
+    // Clear the memory of the new list, and of the new bitmap.
+    memset(new_fd_list, 0, new_max_fd * sizeof(vfs_file_descriptor_t));
+    memset(new_fd_bitmap, 0, FD_BITMAP_WORDS(new_max_fd) * sizeof(uint32_t));
     // Deal with pre-existing list.
-    if (task->fd_list) {
+    if (task->files->fd_list) {
         // Copy the old entries.
-        memcpy(new_fd_list, task->fd_list, task->max_fd * sizeof(vfs_file_descriptor_t));
+        memcpy(new_fd_list, task->files->fd_list, task->files->max_fd * sizeof(vfs_file_descriptor_t));
+        memcpy(new_fd_bitmap, task->files->fd_bitmap, FD_BITMAP_WORDS(task->files->max_fd) * sizeof(uint32_t));
         // Free the memory of the old list.
-        kfree(task->fd_list);
+        kfree(task->files->fd_list);
+        kfree(task->files->fd_bitmap);
+    } else {
+        task->files->fd_next = 0;
     }
     // Set the new maximum number of file descriptors.
-    task->max_fd  = new_max_fd;
+    task->files->max_fd    = new_max_fd;
     // Set the new list.
-    task->fd_list = new_fd_list;
+    task->files->fd_list   = new_fd_list;
+    task->files->fd_bitmap = new_fd_bitmap;
     return 1;
 }
 
@@ -755,6 +1184,10 @@ int vfs_init_task(task_struct *task)
         return 0;
     }
     // Initialize the file descriptor list.
+    if (!(task->files = __files_alloc())) {
+        pr_err("Failed to allocate the file descriptors of process `%d`.\n", task->pid);
+        return 0;
+    }
     if (!vfs_extend_task_fd_list(task)) {
         pr_err(
             "Error while trying to initialize the `fd_list` for process `%d`: "
@@ -762,35 +1195,36 @@ int vfs_init_task(task_struct *task)
             task->pid, strerror(errno));
         return 0;
     }
-    // Create the proc entry.
-    if (procr_create_entry_pid(task)) {
-        pr_err("Error while trying to create proc entry for process `%d`: %s\n", task->pid, strerror(errno));
-        return 0;
-    }
     return 1;
 }
 
 int vfs_dup_task(task_struct *task, task_struct *old_task)
 {
+    if (!(task->files = __files_alloc())) {
+        pr_err("Failed to allocate the file descriptors of process `%d`.\n", task->pid);
+        return 0;
+    }
     // Copy the maximum number of file descriptors.
-    task->max_fd  = old_task->max_fd;
-    // Allocate the memory for the new list.
-    task->fd_list = kmalloc(task->max_fd * sizeof(vfs_file_descriptor_t));
+    task->files->max_fd    = old_task->files->max_fd;
+    task->files->fd_next   = old_task->files->fd_next;
+    // Allocate the memory for the new list, and for the bitmap.
+    task->files->fd_list   = kmalloc(task->files->max_fd * sizeof(vfs_file_descriptor_t));
+    task->files->fd_bitmap = kmalloc(FD_BITMAP_WORDS(task->files->max_fd) * sizeof(uint32_t));
+    if (!task->files->fd_list || !task->files->fd_bitmap) {
+        pr_err("Failed to allocate memory for `fd_list`.\n");
+        return 0;
+    }
     // Copy the old list.
-    memcpy(task->fd_list, old_task->fd_list, task->max_fd * sizeof(vfs_file_descriptor_t));
+    memcpy(task->files->fd_list, old_task->files->fd_list, task->files->max_fd * sizeof(vfs_file_descriptor_t));
+    memcpy(task->files->fd_bitmap, old_task->files->fd_bitmap, FD_BITMAP_WORDS(task->files->max_fd) * sizeof(uint32_t));
     // Increase the counters to the open files.
-    for (int fd = 0; fd < task->max_fd; fd++) {
+    for (int fd = 0; fd < task->files->max_fd; fd++) {
         // Check if the file descriptor is associated with a file.
-        if (task->fd_list[fd].file_struct) {
+        if (task->files->fd_list[fd].file_struct) {
             // Increase the counter.
-            ++task->fd_list[fd].file_struct->count;
+            ++task->files->fd_list[fd].file_struct->count;
         }
     }
-    // Create the proc entry.
-    if (procr_create_entry_pid(task)) {
-        pr_err("Error while trying to create proc entry for '%d': %s\n", task->pid, strerror(errno));
-        return 0;
-    }
     if (vfs_update_pipe_counts(task, old_task)) {
         pr_err("Error while updating the pipe count for '%d': %s\n", task->pid, strerror(errno));
         return 0;
@@ -798,26 +1232,41 @@ int vfs_dup_task(task_struct *task, task_struct *old_task)
     return 1;
 }
 
+int vfs_share_task(task_struct *task, task_struct *old_task)
+{
+    // The pipes keep the same readers and writers, there are no new descriptors.
+    task->files = old_task->files;
+    ++task->files->count;
+    return 1;
+}
+
 int vfs_destroy_task(task_struct *task)
 {
-    // Decrease the counters to the open files.
-    for (int fd = 0; fd < task->max_fd; fd++) {
-        // Check if the file descriptor is associated with a file.
-        if (task->fd_list[fd].file_struct) {
-            // Decrease the counter.
-            --task->fd_list[fd].file_struct->count;
-            // If counter is zero, close the file.
-            if (task->fd_list[fd].file_struct->count == 0) {
-                task->fd_list[fd].file_struct->fs_operations->close_f(task->fd_list[fd].file_struct);
+    // Stop waiting on the files, before closing them.
+    poll_table_release(task);
+    // The other threads sharing the file descriptors keep them open.
+    if (task->files && (--task->files->count == 0)) {
+        // Decrease the counters to the open files.
+        for (int fd = 0; fd < task->files->max_fd; fd++) {
+            vfs_file_t *file = task->files->fd_list[fd].file_struct;
+            // Check if the file descriptor is associated with a file.
+            if (file) {
+                // Decrease the counter.
+                --file->count;
+                // If counter is zero, close the file.
+                if (file->count == 0) {
+                    file->fs_operations->close_f(file);
+                }
+                // Clear the pointer to the file structure.
+                fd_release(task, fd);
             }
-            // Clear the pointer to the file structure.
-            task->fd_list[fd].file_struct = NULL;
         }
+        // Free the memory of the list.
+        kfree(task->files->fd_list);
+        kfree(task->files->fd_bitmap);
+        kfree(task->files);
     }
-    // Set the maximum file descriptors to 0.
-    task->max_fd = 0;
-    // Free the memory of the list.
-    kfree(task->fd_list);
+    task->files = NULL;
     // Remove the proc entry.
     if (procr_destroy_entry_pid(task)) {
         pr_err("Error while trying to remove proc entry for '%d': %s\n", task->pid, strerror(errno));
@@ -831,43 +1280,75 @@ int get_unused_fd(void)
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
-    // Search for an unused fd.
-    int fd;
-    for (fd = 0; fd < task->max_fd; ++fd) {
-        if (!task->fd_list[fd].file_struct) {
+    // Search for an unused fd, one word of the bitmap at a time, starting
+    // from the word of the lowest fd which might be free.
+    int fd = task->files->max_fd;
+    for (int word = task->files->fd_next / 32; word < FD_BITMAP_WORDS(task->files->max_fd); ++word) {
+        uint32_t used = task->files->fd_bitmap[word];
+        // Ignore the fds below the hint, since they are all open.
+        if (word == task->files->fd_next / 32) {
+            used |= (1U << (task->files->fd_next % 32)) - 1U;
+        }
+        if (used != 0xFFFFFFFFU) {
+            fd = min(word * 32 + __builtin_ctz(~used), task->files->max_fd);
             break;
         }
     }
 
-    // Check if there is not fd available.
-    if (fd >= MAX_OPEN_FD) {
+    // The process cannot open more than RLIMIT_NOFILE files.
+    if ((rlim_t)fd >= task->rlim[RLIMIT_NOFILE].rlim_cur) {
         return -EMFILE;
     }
 
     // If fd limit is reached, try to allocate more
-    if (fd == task->max_fd) {
+    if (fd == task->files->max_fd) {
         if (!vfs_extend_task_fd_list(task)) {
             pr_err("Failed to extend the file descriptor list.\n");
             return -EMFILE;
         }
     }
 
+    // Remember where the search has ended.
+    task->files->fd_next = fd;
+
     return fd;
 }
 
+void fd_install(task_struct *task, int fd, vfs_file_t *file, int flags)
+{
+    assert((fd >= 0) && (fd < task->files->max_fd) && "Invalid file descriptor.");
+    task->files->fd_list[fd].file_struct = file;
+    task->files->fd_list[fd].flags_mask  = flags;
+    task->files->fd_bitmap[fd / 32] |= (1U << (fd % 32));
+    if (fd == task->files->fd_next) {
+        ++task->files->fd_next;
+    }
+}
+
+void fd_release(task_struct *task, int fd)
+{
+    assert((fd >= 0) && (fd < task->files->max_fd) && "Invalid file descriptor.");
+    task->files->fd_list[fd].file_struct = NULL;
+    task->files->fd_bitmap[fd / 32] &= ~(1U << (fd % 32));
+    if (fd < task->files->fd_next) {
+        task->files->fd_next = fd;
+    }
+}
+
 int sys_dup(int fd)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
     // Check the current FD.
-    if (fd < 0 || fd >= task->max_fd) {
+    if (fd < 0 || fd >= task->files->max_fd) {
         return -EMFILE;
     }
 
-    // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &task->fd_list[fd];
-    vfs_file_t *file           = vfd->file_struct;
+    // Get the file descriptor, the list might be reallocated when searching
+    // for an unused fd, so we keep a copy of its content.
+    vfs_file_t *file = task->files->fd_list[fd].file_struct;
+    int flags_mask   = task->files->fd_list[fd].flags_mask;
 
     // Check the file.
     if (file == NULL) {
@@ -883,8 +1364,7 @@ int sys_dup(int fd)
     file->count += 1;
 
     // Install the new fd
-    task->fd_list[fd].file_struct = file;
-    task->fd_list[fd].flags_mask  = vfd->flags_mask;
+    fd_install(task, fd, file, flags_mask);
 
     return fd;
 }
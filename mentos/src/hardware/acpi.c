@@ -0,0 +1,366 @@
+/// @file acpi.c
+/// @brief Discovery of the interrupt controllers through the ACPI tables.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[ACPI  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/acpi.h"
+#include "devices/pci.h"
+#include "hardware/pic8259.h"
+#include "klib/compiler.h"
+#include "mem/mm/vmem.h"
+#include "string.h"
+
+/// Where the BIOS stores the segment of the Extended BIOS Data Area.
+#define ACPI_EBDA_SEGMENT   0x40EU
+/// The area of the BIOS ROM where the RSDP can be.
+#define ACPI_BIOS_ROM_START 0xE0000U
+/// The end of the area of the BIOS ROM.
+#define ACPI_BIOS_ROM_END   0x100000U
+/// The largest table the kernel maps.
+#define ACPI_TABLE_MAX_SIZE 0x10000U
+
+/// @name Types of the entries of the MADT.
+/// @{
+#define MADT_ENTRY_LAPIC    0 ///< A processor, with its local APIC.
+#define MADT_ENTRY_IOAPIC   1 ///< An I/O APIC.
+#define MADT_ENTRY_OVERRIDE 2 ///< An interrupt source override.
+/// @}
+
+/// The processor of a MADT_ENTRY_LAPIC entry can be used.
+#define MADT_LAPIC_ENABLED 0x01U
+
+/// @brief The Root System Description Pointer, it tells where the RSDT is.
+typedef struct acpi_rsdp {
+    /// The signature, "RSD PTR ".
+    char signature[8];
+    /// The first 20 bytes of the structure sum up to zero.
+    uint8_t checksum;
+    /// The manufacturer of the system.
+    char oem_id[6];
+    /// The version of the structure, 0 for ACPI 1.0.
+    uint8_t revision;
+    /// The physical address of the RSDT.
+    uint32_t rsdt_address;
+} __attribute__((packed)) acpi_rsdp_t;
+
+/// @brief The header shared by all the tables.
+typedef struct acpi_sdt_header {
+    /// The signature, which tells the type of the table.
+    char signature[4];
+    /// The length of the table, including the header.
+    uint32_t length;
+    /// The version of the table.
+    uint8_t revision;
+    /// The bytes of the table sum up to zero.
+    uint8_t checksum;
+    /// The manufacturer of the system.
+    char oem_id[6];
+    /// The model of the table of the manufacturer.
+    char oem_table_id[8];
+    /// The version of the table of the manufacturer.
+    uint32_t oem_revision;
+    /// The vendor of the tool which created the table.
+    uint32_t creator_id;
+    /// The version of the tool which created the table.
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+/// @brief The Multiple APIC Description Table, followed by its entries.
+typedef struct acpi_madt {
+    /// The header, with signature "APIC".
+    acpi_sdt_header_t header;
+    /// The physical address of the local APICs.
+    uint32_t lapic_address;
+    /// The flags, the first bit tells that there are also the PICs.
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_t;
+
+/// @brief The header of the entries of the MADT.
+typedef struct madt_entry {
+    /// The type of the entry (MADT_ENTRY_*).
+    uint8_t type;
+    /// The length of the entry.
+    uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+/// @brief A processor, with its local APIC.
+typedef struct madt_lapic {
+    /// The header of the entry.
+    madt_entry_t entry;
+    /// The identifier of the processor inside the ACPI namespace.
+    uint8_t processor_id;
+    /// The identifier of the local APIC.
+    uint8_t apic_id;
+    /// The flags of the processor (MADT_LAPIC_*).
+    uint32_t flags;
+} __attribute__((packed)) madt_lapic_t;
+
+/// @brief An I/O APIC.
+typedef struct madt_ioapic {
+    /// The header of the entry.
+    madt_entry_t entry;
+    /// The identifier of the I/O APIC.
+    uint8_t id;
+    /// Reserved.
+    uint8_t reserved;
+    /// The physical address of the I/O APIC.
+    uint32_t address;
+    /// The Global System Interrupt wired to its first pin.
+    uint32_t gsi_base;
+} __attribute__((packed)) madt_ioapic_t;
+
+/// @brief An interrupt source override, an ISA IRQ which is not wired to
+///        the pin with the same number, or not as the ISA bus would.
+typedef struct madt_override {
+    /// The header of the entry.
+    madt_entry_t entry;
+    /// The bus, 0 for ISA.
+    uint8_t bus;
+    /// The ISA IRQ.
+    uint8_t source;
+    /// The Global System Interrupt the IRQ is wired to.
+    uint32_t gsi;
+    /// The polarity and the trigger mode (ACPI_MPS_*).
+    uint16_t flags;
+} __attribute__((packed)) madt_override_t;
+
+/// @brief The table of the memory-mapped configuration spaces of PCI, followed by its entries.
+typedef struct acpi_mcfg {
+    /// The header, with signature "MCFG".
+    acpi_sdt_header_t header;
+    /// Reserved.
+    uint64_t reserved;
+} __attribute__((packed)) acpi_mcfg_t;
+
+/// @brief A region holding the configuration spaces of a range of buses.
+typedef struct mcfg_entry {
+    /// The physical address of the region.
+    uint64_t base;
+    /// The PCI segment group.
+    uint16_t segment;
+    /// The first bus decoded by the region.
+    uint8_t start_bus;
+    /// The last bus decoded by the region.
+    uint8_t end_bus;
+    /// Reserved.
+    uint32_t reserved;
+} __attribute__((packed)) mcfg_entry_t;
+
+/// @brief How an ISA IRQ is wired to the I/O APIC.
+typedef struct acpi_irq_route {
+    /// The Global System Interrupt.
+    uint32_t gsi;
+    /// The polarity and the trigger mode (ACPI_MPS_*).
+    uint16_t flags;
+} acpi_irq_route_t;
+
+/// The number of enabled CPUs described by the MADT.
+static unsigned int nr_cpus = 0;
+/// The physical address of the local APICs.
+static uint32_t lapic_address = 0;
+/// The physical address of the first I/O APIC.
+static uint32_t ioapic_address = 0;
+/// The first Global System Interrupt of the first I/O APIC.
+static uint32_t ioapic_gsi_base = 0;
+/// How the ISA IRQs are wired, filled in by the overrides.
+static acpi_irq_route_t irq_routes[IRQ_NUM];
+
+/// @brief Sums up the bytes of a structure.
+/// @param ptr the structure.
+/// @param length its length.
+/// @return the sum, zero for a valid structure.
+static inline uint8_t __acpi_checksum(const void *ptr, uint32_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    uint8_t sum          = 0;
+    for (uint32_t i = 0; i < length; ++i) {
+        sum += bytes[i];
+    }
+    return sum;
+}
+
+/// @brief Searches an area for the RSDP, which is aligned to 16 bytes.
+/// @param start the start of the area, inside the first megabyte.
+/// @param length the length of the area.
+/// @return the RSDP, NULL if it is not there.
+static inline acpi_rsdp_t *__acpi_search(uint32_t start, uint32_t length)
+{
+    for (uint32_t addr = start; (addr + sizeof(acpi_rsdp_t)) <= (start + length); addr += 16) {
+        acpi_rsdp_t *rsdp = (acpi_rsdp_t *)addr;
+        if (!memcmp(rsdp->signature, "RSD PTR ", 8) && !__acpi_checksum(rsdp, sizeof(acpi_rsdp_t))) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Reads a word of the BIOS Data Area.
+/// @param addr the address of the word.
+/// @return the value of the word.
+static inline uint16_t __acpi_bios_word(uint32_t addr)
+{
+    // The compiler takes the accesses below 4 Kb for NULL dereferences.
+    OPTIMIZER_HIDE_VAR(addr);
+    return *(volatile uint16_t *)addr;
+}
+
+/// @brief Searches the places the specification allows for the RSDP.
+/// @return the RSDP, NULL if there is none.
+static inline acpi_rsdp_t *__acpi_find_rsdp(void)
+{
+    acpi_rsdp_t *rsdp = NULL;
+    // The first Kb of the Extended BIOS Data Area.
+    uint32_t ebda = (uint32_t)__acpi_bios_word(ACPI_EBDA_SEGMENT) << 4;
+    if (ebda && (rsdp = __acpi_search(ebda, 1024))) {
+        return rsdp;
+    }
+    return __acpi_search(ACPI_BIOS_ROM_START, ACPI_BIOS_ROM_END - ACPI_BIOS_ROM_START);
+}
+
+/// @brief Maps a table, which can be anywhere inside the physical memory.
+/// @param address the physical address of the table.
+/// @return the table, NULL if it cannot be mapped or it is not valid.
+static acpi_sdt_header_t *__acpi_map_table(uint32_t address)
+{
+    // Map the header first, to know how long the table is.
+    acpi_sdt_header_t *header = (acpi_sdt_header_t *)vmem_map_io(address, sizeof(acpi_sdt_header_t));
+    if (!header) {
+        return NULL;
+    }
+    uint32_t length = header->length;
+    vmem_unmap_virtual_address((uint32_t)header);
+    if ((length < sizeof(acpi_sdt_header_t)) || (length > ACPI_TABLE_MAX_SIZE)) {
+        pr_err("The table at 0x%08x has an invalid length of %u bytes.\n", address, length);
+        return NULL;
+    }
+    header = (acpi_sdt_header_t *)vmem_map_io(address, length);
+    if (header && __acpi_checksum(header, length)) {
+        pr_err("The table at 0x%08x is not valid.\n", address);
+        vmem_unmap_virtual_address((uint32_t)header);
+        return NULL;
+    }
+    return header;
+}
+
+/// @brief Reads the entries of the MADT.
+/// @param madt the MADT.
+static void __acpi_parse_madt(acpi_madt_t *madt)
+{
+    lapic_address  = madt->lapic_address;
+    uint8_t *entry = (uint8_t *)(madt + 1);
+    uint8_t *end   = (uint8_t *)madt + madt->header.length;
+    while ((entry + sizeof(madt_entry_t)) <= end) {
+        madt_entry_t *header = (madt_entry_t *)entry;
+        if ((header->length < sizeof(madt_entry_t)) || ((entry + header->length) > end)) {
+            pr_err("The MADT has an invalid entry of type %u.\n", header->type);
+            break;
+        }
+        if ((header->type == MADT_ENTRY_LAPIC) && (header->length >= sizeof(madt_lapic_t))) {
+            if (((madt_lapic_t *)entry)->flags & MADT_LAPIC_ENABLED) {
+                ++nr_cpus;
+            }
+        } else if ((header->type == MADT_ENTRY_IOAPIC) && (header->length >= sizeof(madt_ioapic_t))) {
+            madt_ioapic_t *ioapic = (madt_ioapic_t *)entry;
+            if (!ioapic_address) {
+                ioapic_address  = ioapic->address;
+                ioapic_gsi_base = ioapic->gsi_base;
+            }
+        } else if ((header->type == MADT_ENTRY_OVERRIDE) && (header->length >= sizeof(madt_override_t))) {
+            madt_override_t *override = (madt_override_t *)entry;
+            if ((override->bus == 0) && (override->source < IRQ_NUM)) {
+                irq_routes[override->source].gsi   = override->gsi;
+                irq_routes[override->source].flags = override->flags;
+            }
+        }
+        entry += header->length;
+    }
+}
+
+/// @brief Hands the regions of the MCFG to the PCI driver.
+/// @param mcfg the MCFG.
+static void __acpi_parse_mcfg(acpi_mcfg_t *mcfg)
+{
+    mcfg_entry_t *entry = (mcfg_entry_t *)(mcfg + 1);
+    mcfg_entry_t *end   = (mcfg_entry_t *)((uint8_t *)mcfg + mcfg->header.length);
+    for (; (entry + 1) <= end; ++entry) {
+        // We only have the first segment, and only what is below 4GB.
+        if ((entry->segment != 0) || (entry->base >> 32U) || (entry->start_bus > entry->end_bus)) {
+            continue;
+        }
+        pci_enable_ecam((uint32_t)entry->base, entry->start_bus, entry->end_bus);
+    }
+}
+
+int acpi_initialize(void)
+{
+    // Without overrides, the ISA IRQs are wired to the pins with their number.
+    for (unsigned int irq = 0; irq < IRQ_NUM; ++irq) {
+        irq_routes[irq].gsi   = irq;
+        irq_routes[irq].flags = 0;
+    }
+    acpi_rsdp_t *rsdp = __acpi_find_rsdp();
+    if (!rsdp) {
+        pr_notice("No ACPI tables.\n");
+        return -1;
+    }
+    acpi_sdt_header_t *rsdt = __acpi_map_table(rsdp->rsdt_address);
+    if (!rsdt) {
+        pr_err("Failed to map the RSDT.\n");
+        return -1;
+    }
+    if (memcmp(rsdt->signature, "RSDT", 4)) {
+        pr_err("The RSDT has the wrong signature.\n");
+        vmem_unmap_virtual_address((uint32_t)rsdt);
+        return -1;
+    }
+    // The header is followed by the physical addresses of the other tables.
+    uint32_t *tables = (uint32_t *)(rsdt + 1);
+    uint32_t count   = (rsdt->length - sizeof(acpi_sdt_header_t)) / sizeof(uint32_t);
+    int found        = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        acpi_sdt_header_t *table = __acpi_map_table(tables[i]);
+        if (!table) {
+            continue;
+        }
+        if (!memcmp(table->signature, "APIC", 4) && (table->length >= sizeof(acpi_madt_t)) && !found) {
+            __acpi_parse_madt((acpi_madt_t *)table);
+            found = 1;
+        } else if (!memcmp(table->signature, "MCFG", 4) && (table->length >= sizeof(acpi_mcfg_t))) {
+            __acpi_parse_mcfg((acpi_mcfg_t *)table);
+        }
+        vmem_unmap_virtual_address((uint32_t)table);
+    }
+    vmem_unmap_virtual_address((uint32_t)rsdt);
+    if (!found) {
+        pr_notice("The ACPI tables have no MADT.\n");
+        return -1;
+    }
+    pr_notice(
+        "Found %u CPUs, local APICs at 0x%08x, I/O APIC at 0x%08x (GSI %u).\n", nr_cpus, lapic_address,
+        ioapic_address, ioapic_gsi_base);
+    return 0;
+}
+
+unsigned int acpi_num_cpus(void) { return nr_cpus; }
+
+uint32_t acpi_lapic_address(void) { return lapic_address; }
+
+uint32_t acpi_ioapic_address(void) { return ioapic_address; }
+
+uint32_t acpi_ioapic_gsi_base(void) { return ioapic_gsi_base; }
+
+uint32_t acpi_irq_to_gsi(unsigned int irq, uint16_t *flags)
+{
+    if (irq >= IRQ_NUM) {
+        *flags = 0;
+        return irq;
+    }
+    *flags = irq_routes[irq].flags;
+    return irq_routes[irq].gsi;
+}
@@ -0,0 +1,136 @@
+/// @file apic.c
+/// @brief Local APIC, used for its timer and to receive the external interrupts.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[APIC  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/apic.h"
+#include "descriptor_tables/isr.h"
+#include "hardware/cpuid.h"
+#include "hardware/msr.h"
+#include "hardware/timer.h"
+#include "klib/div64.h"
+#include "mem/mm/vmem.h"
+
+/// The bit of MSR_APIC_BASE enabling the local APIC.
+#define LAPIC_BASE_ENABLE (1U << 11U)
+/// The bits of MSR_APIC_BASE holding the physical address.
+#define LAPIC_BASE_MASK   0xFFFFF000U
+
+/// @name Registers of the local APIC.
+/// @{
+#define LAPIC_ID           0x020U ///< Identifier of the local APIC.
+#define LAPIC_TPR          0x080U ///< Task Priority Register.
+#define LAPIC_EOI          0x0B0U ///< End Of Interrupt.
+#define LAPIC_SVR          0x0F0U ///< Spurious Interrupt Vector Register.
+#define LAPIC_LVT_TIMER    0x320U ///< Local vector of the timer.
+#define LAPIC_LVT_LINT0    0x350U ///< Local vector of the LINT0 pin.
+#define LAPIC_LVT_LINT1    0x360U ///< Local vector of the LINT1 pin.
+#define LAPIC_TIMER_INIT   0x380U ///< Initial count of the timer.
+#define LAPIC_TIMER_COUNT  0x390U ///< Current count of the timer.
+#define LAPIC_TIMER_DIVIDE 0x3E0U ///< Divider of the clock of the timer.
+/// @}
+
+/// @name Values of the registers.
+/// @{
+#define LAPIC_SVR_ENABLE    0x100U   ///< Enables the local APIC.
+#define LAPIC_LVT_MASKED    0x10000U ///< The local vector does not interrupt.
+#define LAPIC_LVT_EXTINT    0x700U   ///< The pin is wired to the PIC.
+#define LAPIC_LVT_NMI       0x400U   ///< The pin delivers NMIs.
+#define LAPIC_TIMER_DIV_16  0x3U     ///< The timer counts once every 16 cycles of the bus.
+#define LAPIC_TIMER_MAX     0xFFFFFFFFU
+/// @}
+
+/// The length of the calibration, in microseconds.
+#define LAPIC_CALIBRATION_US 10000
+
+/// The registers of the local APIC, NULL if there is none.
+static volatile uint32_t *lapic = NULL;
+/// The counts of the timer in a nanosecond, with 32 bits of fraction.
+static uint32_t lapic_timer_mult = 0;
+
+/// @brief Reads a register of the local APIC.
+/// @param reg the offset of the register.
+/// @return its value.
+static inline uint32_t __lapic_read(uint32_t reg) { return lapic[reg / sizeof(uint32_t)]; }
+
+/// @brief Writes a register of the local APIC.
+/// @param reg the offset of the register.
+/// @param value its new value.
+static inline void __lapic_write(uint32_t reg, uint32_t value) { lapic[reg / sizeof(uint32_t)] = value; }
+
+/// @brief Handles the spurious interrupts, which need no end-of-interrupt.
+/// @param f the interrupt stack frame.
+static void __lapic_spurious_handler(pt_regs_t *f) { (void)f; }
+
+int lapic_initialize(void)
+{
+    if (!cpuid_has_feature_edx(CPUID_EDX_APIC) || !cpuid_has_feature_edx(CPUID_EDX_MSR)) {
+        pr_warning("The CPU has no local APIC.\n");
+        return -1;
+    }
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    lapic         = (volatile uint32_t *)vmem_map_io((uint32_t)base & LAPIC_BASE_MASK, PAGE_SIZE);
+    if (!lapic) {
+        pr_err("Failed to map the local APIC.\n");
+        return -1;
+    }
+    wrmsr(MSR_APIC_BASE, base | LAPIC_BASE_ENABLE);
+    isr_install_handler(LAPIC_SPURIOUS_VECTOR, __lapic_spurious_handler, "lapic spurious");
+    // The IRQs of the PIC come through LINT0 (virtual wire mode).
+    __lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_EXTINT);
+    __lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    __lapic_write(LAPIC_TPR, 0);
+    __lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    // Count down from the top for a while, without interrupting.
+    __lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIV_16);
+    __lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    __lapic_write(LAPIC_TIMER_INIT, LAPIC_TIMER_MAX);
+    uint32_t ns     = timer_pit_delay(LAPIC_CALIBRATION_US);
+    uint32_t counts = LAPIC_TIMER_MAX - __lapic_read(LAPIC_TIMER_COUNT);
+    __lapic_write(LAPIC_TIMER_INIT, 0);
+    // The counts in a nanosecond must be a fraction, to fit lapic_timer_mult.
+    if (!counts || (counts >= ns)) {
+        pr_warning("Failed to calibrate the timer of the local APIC: %u counts in %u ns.\n", counts, ns);
+        lapic = NULL;
+        return -1;
+    }
+    lapic_timer_mult = div64_32((uint64_t)counts << 32U, ns, NULL);
+    // From now on, the timer interrupts in one-shot mode.
+    __lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    pr_notice("The timer of the local APIC runs at %u kHz.\n", div64_32((uint64_t)counts * 1000000U, ns, NULL));
+    return 0;
+}
+
+void lapic_timer_oneshot(uint32_t ns)
+{
+    if (!lapic) {
+        return;
+    }
+    // Writing the initial count restarts the timer, a count of zero stops it.
+    uint32_t count = (uint32_t)(((uint64_t)ns * lapic_timer_mult) >> 32U);
+    __lapic_write(LAPIC_TIMER_INIT, (ns && !count) ? 1 : count);
+}
+
+void lapic_send_eoi(void)
+{
+    if (lapic) {
+        __lapic_write(LAPIC_EOI, 0);
+    }
+}
+
+int lapic_is_enabled(void) { return lapic != NULL; }
+
+uint8_t lapic_get_id(void) { return lapic ? (uint8_t)(__lapic_read(LAPIC_ID) >> 24U) : 0; }
+
+void lapic_disable_extint(void)
+{
+    if (lapic) {
+        __lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED | LAPIC_LVT_EXTINT);
+    }
+}
@@ -4,8 +4,30 @@
 /// See LICENSE.md for details.
 
 #include "hardware/cpuid.h"
+#include "math.h"
+#include "stdio.h"
 #include "string.h"
 
+/// The names of the features inside EDX, by CPUID with EAX=1, NULL for the reserved bits.
+static const char *cpuid_edx_names[EDX_FLAGS_SIZE] = {
+    "fpu",     "vme",     "de",      "pse",     "tsc",     "msr",     "pae",     "mce",
+    "cx8",     "apic",    NULL,      "sep",     "mtrr",    "pge",     "mca",     "cmov",
+    "pat",     "pse36",   "pn",      "clflush", NULL,      "dts",     "acpi",    "mmx",
+    "fxsr",    "sse",     "sse2",    "ss",      "ht",      "tm",      "ia64",    "pbe",
+};
+
+/// The names of the features inside ECX, by CPUID with EAX=1, NULL for the reserved bits.
+static const char *cpuid_ecx_names[32] = {
+    "pni",                "pclmulqdq",          "dtes64",             "monitor",
+    "ds_cpl",             "vmx",                "smx",                "est",
+    "tm2",                "ssse3",              "cid",                "sdbg",
+    "fma",                "cx16",               "xtpr",               "pdcm",
+    NULL,                 "pcid",               "dca",                "sse4_1",
+    "sse4_2",             "x2apic",             "movbe",              "popcnt",
+    "tsc_deadline_timer", "aes",                "xsave",              "osxsave",
+    "avx",                "f16c",               "rdrand",             "hypervisor",
+};
+
 void get_cpuid(cpuinfo_t *cpuinfo)
 {
     pt_regs_t ereg;
@@ -18,6 +40,122 @@ void get_cpuid(cpuinfo_t *cpuinfo)
     cpuid_write_proctype(cpuinfo, &ereg);
 }
 
+int cpuid_has_feature_edx(uint32_t bit)
+{
+    pt_regs_t ereg;
+
+    ereg.eax = 1;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    return cpuid_get_byte(ereg.edx, bit, 1);
+}
+
+int cpuid_has_invariant_tsc(void)
+{
+    pt_regs_t ereg;
+
+    // The power management leaf might not exist.
+    ereg.eax = CPUID_EXT_MAX_LEAF;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    if (ereg.eax < CPUID_EXT_POWER_LEAF) {
+        return 0;
+    }
+    ereg.eax = CPUID_EXT_POWER_LEAF;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    return cpuid_get_byte(ereg.edx, CPUID_EXT_EDX_INVARIANT_TSC, 1);
+}
+
+int cpuid_has_sysenter(void)
+{
+    pt_regs_t ereg;
+
+    ereg.eax = 1;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    if (!cpuid_get_byte(ereg.edx, CPUID_EDX_SEP, 1)) {
+        return 0;
+    }
+    // The first Pentium Pro models report the flag, without supporting the instructions.
+    uint32_t family   = (ereg.eax >> 8U) & 0xFU;
+    uint32_t model    = (ereg.eax >> 4U) & 0xFU;
+    uint32_t stepping = ereg.eax & 0xFU;
+    return !((family == 6) && (model < 3) && (stepping < 3));
+}
+
+void cpuid_get_signature(uint32_t *family, uint32_t *model, uint32_t *stepping)
+{
+    pt_regs_t ereg;
+
+    ereg.eax = 1;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    *family   = (ereg.eax >> 8U) & 0xFU;
+    *model    = (ereg.eax >> 4U) & 0xFU;
+    *stepping = ereg.eax & 0xFU;
+    // The extended model is meaningful only for these families, the extended family only for the last one.
+    if ((*family == 0x6) || (*family == 0xF)) {
+        *model += ((ereg.eax >> 16U) & 0xFU) << 4U;
+    }
+    if (*family == 0xF) {
+        *family += (ereg.eax >> 20U) & 0xFFU;
+    }
+}
+
+int cpuid_get_brand_string(char *brand, size_t size)
+{
+    pt_regs_t ereg;
+
+    if (size < CPUID_BRAND_STRING_SIZE) {
+        return -1;
+    }
+    ereg.eax = CPUID_EXT_MAX_LEAF;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    if (ereg.eax < CPUID_EXT_BRAND_LAST_LEAF) {
+        return -1;
+    }
+    // Each leaf holds sixteen characters, inside EAX, EBX, ECX and EDX.
+    char *it = brand;
+    for (uint32_t leaf = CPUID_EXT_BRAND_FIRST_LEAF; leaf <= CPUID_EXT_BRAND_LAST_LEAF; ++leaf, it += 16) {
+        ereg.eax = leaf;
+        ereg.ebx = ereg.ecx = ereg.edx = 0;
+        call_cpuid(&ereg);
+        memcpy(it, &ereg.eax, 4);
+        memcpy(it + 4, &ereg.ebx, 4);
+        memcpy(it + 8, &ereg.ecx, 4);
+        memcpy(it + 12, &ereg.edx, 4);
+    }
+    brand[CPUID_BRAND_STRING_SIZE - 1] = '\0';
+    size_t skip = strspn(brand, " ");
+    memmove(brand, brand + skip, CPUID_BRAND_STRING_SIZE - skip);
+    return 0;
+}
+
+int cpuid_write_flags(char *buffer, size_t bufsize)
+{
+    pt_regs_t ereg;
+
+    ereg.eax = 1;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    int written = 0;
+    if (bufsize) {
+        buffer[0] = '\0';
+    }
+    for (uint32_t i = 0; i < 64; ++i) {
+        const char *name = (i < 32) ? cpuid_edx_names[i] : cpuid_ecx_names[i - 32];
+        uint32_t reg     = (i < 32) ? ereg.edx : ereg.ecx;
+        if (!name || !cpuid_get_byte(reg, i % 32, 1)) {
+            continue;
+        }
+        size_t offset = min((size_t)written, bufsize);
+        written += snprintf(buffer + offset, bufsize - offset, written ? " %s" : "%s", name);
+    }
+    return written;
+}
+
 void call_cpuid(pt_regs_t *registers)
 {
     __asm__("cpuid\n\t"
@@ -155,16 +293,10 @@ char *cpuid_brand_index(pt_regs_t *f)
 
 char *cpuid_brand_string(pt_regs_t *f)
 {
-    char *temp = "";
+    static char brand[CPUID_BRAND_STRING_SIZE];
 
-    for (f->eax = 0x80000002; f->eax <= 0x80000004; (f->eax)++) {
-        f->ebx = f->ecx = f->edx = 0;
-        call_cpuid(f);
-        temp = strncat(temp, (const char *)f->eax, strlen((const char *)f->eax));
-        temp = strncat(temp, (const char *)f->ebx, strlen((const char *)f->ebx));
-        temp = strncat(temp, (const char *)f->ecx, strlen((const char *)f->ecx));
-        temp = strncat(temp, (const char *)f->edx, strlen((const char *)f->edx));
+    if (cpuid_get_brand_string(brand, sizeof(brand)) < 0) {
+        brand[0] = '\0';
     }
-
-    return temp;
+    return brand;
 }
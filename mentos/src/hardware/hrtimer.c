@@ -0,0 +1,256 @@
+/// @file hrtimer.c
+/// @brief High-resolution timers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[HRTIME]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/hrtimer.h"
+#include "descriptor_tables/isr.h"
+#include "hardware/apic.h"
+#include "hardware/timer.h"
+#include "hardware/tsc.h"
+#include "klib/rbtree.h"
+#include "math.h"
+#include "process/scheduler.h"
+#include "system/softirq.h"
+
+/// The nanoseconds of a tick, the clock of the timers without TSC.
+#define NSEC_PER_TICK     (NSEC_PER_SEC / TICKS_PER_SECOND)
+/// The longest the timer of the local APIC is armed for, since its count
+/// has 32 bits.
+#define HRTIMER_MAX_DELTA NSEC_PER_SEC
+
+/// The timers waiting to expire, sorted by hard expiration.
+static rbtree_t *hrtimer_tree = NULL;
+/// The nodes removed from the tree, reused to queue the next timers.
+static rbtree_node_t *hrtimer_free_nodes[MAX_PROCESSES];
+/// The number of nodes inside hrtimer_free_nodes.
+static unsigned int hrtimer_nr_free_nodes = 0;
+/// The first timer to expire.
+static hrtimer_t *hrtimer_first = NULL;
+/// If the time is read from the TSC, instead of the ticks.
+static bool_t hrtimer_tsc = false;
+/// If the timer of the local APIC makes the timers expire, instead of the tick.
+static bool_t hrtimer_lapic = false;
+
+/// @brief Compares two timers by expiration, and by address when it is the same.
+/// @param a the first timer.
+/// @param b the second timer.
+/// @return the result of the comparison.
+static inline int __hrtimer_compare_timers(hrtimer_t *a, hrtimer_t *b)
+{
+    if (a->expires != b->expires) {
+        return (a->expires > b->expires) - (a->expires < b->expires);
+    }
+    return ((uintptr_t)a > (uintptr_t)b) - ((uintptr_t)a < (uintptr_t)b);
+}
+
+/// @brief Compares the timers of two nodes of the tree.
+/// @param tree the tree.
+/// @param a the node of the first timer.
+/// @param b the node of the second timer.
+/// @return the result of the comparison.
+static int __hrtimer_compare(rbtree_t *tree, rbtree_node_t *a, rbtree_node_t *b)
+{
+    return __hrtimer_compare_timers(rbtree_node_get_value(a), rbtree_node_get_value(b));
+}
+
+/// @brief Keeps a node removed from the tree, for the next timer.
+/// @param tree the tree.
+/// @param node the node.
+static void __hrtimer_release_node(rbtree_t *tree, rbtree_node_t *node)
+{
+    if (hrtimer_nr_free_nodes < MAX_PROCESSES) {
+        hrtimer_free_nodes[hrtimer_nr_free_nodes++] = node;
+    } else {
+        rbtree_node_dealloc(node);
+    }
+}
+
+/// @brief Chooses the hard expiration of a timer with some slack: the latest
+///        multiple, inside the slack, of the largest power of two not above
+///        it, so that the timers with similar slacks expiring close to each
+///        other share the same interrupt.
+/// @param expires the soft expiration.
+/// @param slack the slack.
+/// @return the hard expiration.
+static inline uint64_t __hrtimer_round(uint64_t expires, uint32_t slack)
+{
+    if (!slack) {
+        return expires;
+    }
+    uint32_t granularity = 1U << (31U - __builtin_clz(slack));
+    return (expires + slack) & ~(uint64_t)(granularity - 1U);
+}
+
+/// @brief Searches for the first timer to expire inside the tree.
+/// @return the timer, NULL if the tree is empty.
+static inline hrtimer_t *__hrtimer_leftmost(void)
+{
+    rbtree_node_t *node = rbtree_tree_get_root(hrtimer_tree);
+    while (node && rbtree_node_get_child(node, 0)) {
+        node = rbtree_node_get_child(node, 0);
+    }
+    return node ? rbtree_node_get_value(node) : NULL;
+}
+
+/// @brief Removes a timer from the tree.
+/// @param timer the timer, which must be waiting to expire.
+static inline void __hrtimer_dequeue(hrtimer_t *timer)
+{
+    rbtree_tree_remove_with_cb(hrtimer_tree, timer, __hrtimer_release_node);
+    timer->queued = false;
+    if (hrtimer_first == timer) {
+        hrtimer_first = __hrtimer_leftmost();
+    }
+}
+
+/// @brief Arms the timer of the local APIC for the first timer to expire.
+static inline void __hrtimer_reprogram(void)
+{
+    if (!hrtimer_lapic) {
+        return;
+    }
+    if (!hrtimer_first) {
+        lapic_timer_oneshot(0);
+        return;
+    }
+    uint64_t now   = hrtimer_get_ns();
+    uint64_t delta = (hrtimer_first->expires > now) ? (hrtimer_first->expires - now) : 1;
+    lapic_timer_oneshot((uint32_t)min(delta, (uint64_t)HRTIMER_MAX_DELTA));
+}
+
+/// @brief Executes the functions of the expired timers.
+/// @return true if some timer expired, false otherwise.
+static inline bool_t __hrtimer_expire(void)
+{
+    bool_t expired = false;
+    uint64_t now   = hrtimer_get_ns();
+    // The soft expiration of every timer comes before the hard expiration of
+    // the first one, the timers which can already expire join it.
+    while (hrtimer_first && (hrtimer_first->soft_expires <= now)) {
+        hrtimer_t *timer = hrtimer_first;
+        // The timer leaves the tree first, its function can start it again,
+        // or free it.
+        __hrtimer_dequeue(timer);
+        timer->function(timer->data);
+        expired = true;
+    }
+    return expired;
+}
+
+/// @brief The bottom half of the timers, it runs the expired ones.
+static void __hrtimer_softirq(void)
+{
+    // The interrupt might come before the first timer expires, when the timer
+    // of the local APIC was armed for HRTIMER_MAX_DELTA, or for a timer which
+    // was stopped since.
+    __hrtimer_expire();
+    __hrtimer_reprogram();
+}
+
+/// @brief Handles the interrupt of the timer of the local APIC.
+/// @param f the interrupt stack frame.
+static void __hrtimer_interrupt(pt_regs_t *f)
+{
+    lapic_send_eoi();
+    raise_softirq(HRTIMER_SOFTIRQ);
+    do_softirq();
+    // Switch to a process woken up by the timers, if it should preempt the
+    // current one.
+    if (scheduler_need_resched()) {
+        scheduler_run(f);
+    }
+}
+
+void hrtimer_install(void)
+{
+    hrtimer_tree = rbtree_tree_create(__hrtimer_compare);
+    if (!hrtimer_tree) {
+        pr_crit("Failed to allocate the tree of the high-resolution timers.\n");
+        return;
+    }
+    open_softirq(HRTIMER_SOFTIRQ, __hrtimer_softirq);
+    hrtimer_tsc = (tsc_initialize() == 0);
+    // Without the TSC, the time is only as precise as the tick.
+    if (hrtimer_tsc && (lapic_initialize() == 0)) {
+        isr_install_handler(LAPIC_TIMER_VECTOR, __hrtimer_interrupt, "hrtimer");
+        hrtimer_lapic = true;
+    } else {
+        pr_notice("The high-resolution timers expire on the tick.\n");
+    }
+}
+
+uint64_t hrtimer_get_ns(void)
+{
+    if (hrtimer_tsc) {
+        return tsc_get_ns();
+    }
+    return (uint64_t)timer_get_ticks() * NSEC_PER_TICK;
+}
+
+uint32_t hrtimer_get_resolution(void) { return hrtimer_tsc ? 1 : NSEC_PER_TICK; }
+
+void hrtimer_start(hrtimer_t *timer, uint64_t expires) { hrtimer_start_range_ns(timer, expires, 0); }
+
+void hrtimer_start_range_ns(hrtimer_t *timer, uint64_t expires, uint32_t slack)
+{
+    if (timer->queued) {
+        __hrtimer_dequeue(timer);
+    }
+    timer->soft_expires = expires;
+    timer->expires      = __hrtimer_round(expires, slack);
+    rbtree_node_t *node = NULL;
+    if (hrtimer_tree) {
+        node = hrtimer_nr_free_nodes ? hrtimer_free_nodes[--hrtimer_nr_free_nodes] : rbtree_node_alloc();
+    }
+    if (!node) {
+        pr_crit("Failed to queue the high-resolution timer 0x%p.\n", timer);
+        return;
+    }
+    rbtree_tree_insert_node(hrtimer_tree, rbtree_node_init(node, timer));
+    timer->queued = true;
+    if (!hrtimer_first || (__hrtimer_compare_timers(timer, hrtimer_first) < 0)) {
+        hrtimer_first = timer;
+        __hrtimer_reprogram();
+    }
+}
+
+void hrtimer_cancel(hrtimer_t *timer)
+{
+    // The timer of the local APIC is left as it is, it interrupts for nothing.
+    if (timer->queued) {
+        __hrtimer_dequeue(timer);
+    }
+}
+
+void hrtimer_run(void)
+{
+    // Otherwise, the interrupt of the local APIC raises the softirq.
+    if (!hrtimer_lapic) {
+        raise_softirq(HRTIMER_SOFTIRQ);
+    }
+}
+
+unsigned long hrtimer_nohz_next(unsigned long next)
+{
+    // The timer of the local APIC wakes up the CPU by itself.
+    if (hrtimer_lapic || !hrtimer_first) {
+        return next;
+    }
+    uint64_t now = hrtimer_get_ns();
+    if (hrtimer_first->expires <= now) {
+        return 0;
+    }
+    uint64_t delta = hrtimer_first->expires - now;
+    if (delta >= ((uint64_t)next * NSEC_PER_TICK)) {
+        return next;
+    }
+    // Wake up with the tick following the expiration.
+    return div64_32(delta, NSEC_PER_TICK, NULL) + 1;
+}
@@ -0,0 +1,146 @@
+/// @file ioapic.c
+/// @brief I/O APIC, which delivers the IRQs to the local APIC.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[IOAPIC]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/ioapic.h"
+#include "hardware/acpi.h"
+#include "hardware/apic.h"
+#include "hardware/pic8259.h"
+#include "hardware/smp.h"
+#include "klib/irqflags.h"
+#include "mem/mm/vmem.h"
+
+/// @name Registers of the I/O APIC, accessed through the select and the window.
+/// @{
+#define IOAPIC_REGSEL 0x00U ///< Selects the register.
+#define IOAPIC_WINDOW 0x10U ///< Reads and writes the selected register.
+#define IOAPIC_SIZE   0x20U ///< The size of the registers.
+#define IOAPIC_VER    0x01U ///< Version, and number of redirection entries.
+#define IOAPIC_REDTBL 0x10U ///< First redirection entry, two registers each.
+/// @}
+
+/// @name Bits of the low half of the redirection entries.
+/// @{
+#define IOAPIC_RED_ACTIVE_LOW 0x02000U ///< The pin is active low.
+#define IOAPIC_RED_LEVEL      0x08000U ///< The pin is level triggered.
+#define IOAPIC_RED_MASKED     0x10000U ///< The pin does not interrupt.
+/// @}
+
+/// The ISA IRQ is not wired to the I/O APIC.
+#define IOAPIC_NO_PIN 0xFFFFFFFFU
+
+/// The registers of the I/O APIC, NULL if the PIC delivers the IRQs.
+static volatile uint32_t *ioapic = NULL;
+/// The pin each ISA IRQ is wired to.
+static uint32_t irq_pins[IRQ_NUM];
+
+/// @brief Reads a register of the I/O APIC.
+/// @param reg the index of the register.
+/// @return its value.
+static inline uint32_t __ioapic_read(uint32_t reg)
+{
+    ioapic[IOAPIC_REGSEL / sizeof(uint32_t)] = reg;
+    return ioapic[IOAPIC_WINDOW / sizeof(uint32_t)];
+}
+
+/// @brief Writes a register of the I/O APIC.
+/// @param reg the index of the register.
+/// @param value its new value.
+static inline void __ioapic_write(uint32_t reg, uint32_t value)
+{
+    ioapic[IOAPIC_REGSEL / sizeof(uint32_t)] = reg;
+    ioapic[IOAPIC_WINDOW / sizeof(uint32_t)] = value;
+}
+
+/// @brief Masks, or unmasks, the pin of an ISA IRQ.
+/// @param irq the ISA IRQ.
+/// @param masked if the pin must be masked.
+/// @return 0 on success, -1 if the IRQ is not wired to the I/O APIC.
+static int __ioapic_set_masked(unsigned int irq, int masked)
+{
+    if (!ioapic || (irq >= IRQ_NUM) || (irq_pins[irq] == IOAPIC_NO_PIN)) {
+        return -1;
+    }
+    uint32_t reg = IOAPIC_REDTBL + (irq_pins[irq] * 2U);
+    uint32_t low = __ioapic_read(reg);
+    low          = masked ? (low | IOAPIC_RED_MASKED) : (low & ~IOAPIC_RED_MASKED);
+    __ioapic_write(reg, low);
+    return 0;
+}
+
+int ioapic_initialize(void)
+{
+    if (!lapic_is_enabled()) {
+        pr_notice("The local APIC is not enabled, the IRQs keep going through the PIC.\n");
+        return -1;
+    }
+    // Prefer the ACPI tables, which also tell how the ISA IRQs are wired.
+    uint32_t address  = acpi_ioapic_address();
+    uint32_t gsi_base = acpi_ioapic_gsi_base();
+    if (!address) {
+        address  = smp_ioapic_address();
+        gsi_base = 0;
+    }
+    if (!address) {
+        pr_notice("No I/O APIC, the IRQs keep going through the PIC.\n");
+        return -1;
+    }
+    volatile uint32_t *registers = (volatile uint32_t *)vmem_map_io(address, IOAPIC_SIZE);
+    if (!registers) {
+        pr_err("Failed to map the I/O APIC.\n");
+        return -1;
+    }
+    uint8_t flags = irq_disable();
+    ioapic        = registers;
+    uint32_t pins = ((__ioapic_read(IOAPIC_VER) >> 16U) & 0xFFU) + 1U;
+    // Start with all the pins masked.
+    for (uint32_t pin = 0; pin < pins; ++pin) {
+        __ioapic_write(IOAPIC_REDTBL + (pin * 2U), IOAPIC_RED_MASKED);
+    }
+    // Route each ISA IRQ to its vector, towards this CPU.
+    uint32_t destination = (uint32_t)lapic_get_id() << 24U;
+    for (unsigned int irq = 0; irq < IRQ_NUM; ++irq) {
+        uint16_t mps;
+        uint32_t gsi  = acpi_irq_to_gsi(irq, &mps);
+        irq_pins[irq] = IOAPIC_NO_PIN;
+        // The cascade line of the PIC does not exist for the I/O APIC.
+        if ((irq == IRQ_TO_SLAVE_PIC) || (gsi < gsi_base) || ((gsi - gsi_base) >= pins)) {
+            continue;
+        }
+        uint32_t low = IOAPIC_RED_MASKED | (32U + irq);
+        if ((mps & ACPI_MPS_POLARITY_MASK) == ACPI_MPS_ACTIVE_LOW) {
+            low |= IOAPIC_RED_ACTIVE_LOW;
+        }
+        if ((mps & ACPI_MPS_TRIGGER_MASK) == ACPI_MPS_LEVEL) {
+            low |= IOAPIC_RED_LEVEL;
+        }
+        irq_pins[irq] = gsi - gsi_base;
+        __ioapic_write(IOAPIC_REDTBL + (irq_pins[irq] * 2U) + 1U, destination);
+        __ioapic_write(IOAPIC_REDTBL + (irq_pins[irq] * 2U), low);
+    }
+    // Take over the IRQs already enabled on the PIC, then silence it.
+    uint16_t masked = pic8259_get_mask();
+    pic8259_disable();
+    lapic_disable_extint();
+    for (unsigned int irq = 0; irq < IRQ_NUM; ++irq) {
+        if (!(masked & (1U << irq))) {
+            __ioapic_set_masked(irq, 0);
+        }
+    }
+    irq_enable(flags);
+    pr_notice("The I/O APIC at 0x%08x delivers the IRQs, through %u pins.\n", address, pins);
+    return 0;
+}
+
+int ioapic_is_enabled(void) { return ioapic != NULL; }
+
+int ioapic_irq_enable(unsigned int irq) { return __ioapic_set_masked(irq, 0); }
+
+int ioapic_irq_disable(unsigned int irq) { return __ioapic_set_masked(irq, 1); }
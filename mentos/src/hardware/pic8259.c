@@ -145,6 +145,19 @@ void pic8259_send_eoi(uint32_t irq)
     outportb(MASTER_PORT_COMMAND, EOI);
 }
 
+uint16_t pic8259_get_mask(void)
+{
+    return (uint16_t)(inportb(MASTER_PORT_DATA) | (inportb(SLAVE_PORT_DATA) << 8));
+}
+
+void pic8259_disable(void)
+{
+    master_cur_mask = 0xFF;
+    slave_cur_mask  = 0xFF;
+    outportb(MASTER_PORT_DATA, master_cur_mask);
+    outportb(SLAVE_PORT_DATA, slave_cur_mask);
+}
+
 /*
  * int pic8259_irq_get_current()
  * {
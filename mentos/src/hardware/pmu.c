@@ -0,0 +1,424 @@
+/// @file pmu.c
+/// @brief The Performance Monitoring Unit, counting hardware events for each process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[PMU   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/pmu.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/vfs.h"
+#include "hardware/cpuid.h"
+#include "hardware/msr.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/perf_event.h"
+#include "sys/stat.h"
+#include "system/syscall.h"
+#include "time.h"
+
+/// The leaf of CPUID describing the architectural performance monitoring.
+#define CPUID_PMU_LEAF 0x0AU
+
+/// The largest number of general-purpose counters we use.
+#define PMU_MAX_COUNTERS 8U
+
+/// @name Bits of the event select registers
+/// @{
+#define PMU_EVTSEL_USR (1U << 16U) ///< Counts in user mode.
+#define PMU_EVTSEL_OS  (1U << 17U) ///< Counts inside the kernel.
+#define PMU_EVTSEL_EN  (1U << 22U) ///< Enables the counter.
+/// @}
+
+/// @brief An event counted while a process runs.
+typedef struct perf_event {
+    /// The value of the event select register, without the enable bit.
+    uint32_t evtsel;
+    /// The general-purpose counter owned by the event.
+    unsigned int counter;
+    /// What the counter counted, while the process was not running.
+    uint64_t count;
+    /// If the event is counted.
+    bool_t enabled;
+    /// The process, NULL once it exited.
+    task_struct *task;
+    /// The node inside the events of the process.
+    list_head_t siblings;
+} perf_event_t;
+
+/// @brief The events counted while a process runs.
+typedef struct perf_context {
+    /// The events (perf_event_t).
+    list_head_t events;
+    /// The counters owned by the events, one bit each.
+    uint32_t used;
+} perf_context_t;
+
+/// @brief The architectural events, as `event | (umask << 8)`, and the
+///        bits of EBX telling, when set, that they are not available.
+static const struct {
+    uint16_t code;
+    uint8_t bit;
+} pmu_generic_events[PERF_COUNT_HW_MAX] = {
+    [PERF_COUNT_HW_CPU_CYCLES]          = {0x003C, 0},
+    [PERF_COUNT_HW_INSTRUCTIONS]        = {0x00C0, 1},
+    [PERF_COUNT_HW_CACHE_REFERENCES]    = {0x4F2E, 3},
+    [PERF_COUNT_HW_CACHE_MISSES]        = {0x412E, 4},
+    [PERF_COUNT_HW_BRANCH_INSTRUCTIONS] = {0x00C4, 5},
+    [PERF_COUNT_HW_BRANCH_MISSES]       = {0x00C5, 6},
+};
+
+/// @brief The counters of the CPU.
+static struct {
+    /// The version of the architectural performance monitoring, 0 if there is none.
+    unsigned int version;
+    /// The number of general-purpose counters.
+    unsigned int counters;
+    /// The bits the counters count with.
+    uint64_t mask;
+    /// The architectural events which are not available, one bit each.
+    uint32_t unavailable;
+} pmu;
+
+static int perf_file_close(vfs_file_t *file);
+static ssize_t perf_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static long perf_file_ioctl(vfs_file_t *file, unsigned int request, unsigned long data);
+static int perf_file_fstat(vfs_file_t *file, stat_t *stat);
+
+/// Performance event file operations.
+static vfs_file_operations_t perf_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = perf_file_close,
+    .read_f     = perf_file_read,
+    .write_f    = NULL,
+    .lseek_f    = NULL,
+    .stat_f     = perf_file_fstat,
+    .ioctl_f    = perf_file_ioctl,
+    .fcntl_f    = NULL,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = NULL,
+};
+
+/// @brief Checks if the hardware is counting the event right now.
+/// @param event the event.
+/// @return true if its process is running, and the event is enabled.
+static inline bool_t __pmu_is_counting(perf_event_t *event)
+{
+    return event->enabled && event->task && (event->task == scheduler_get_current_process());
+}
+
+/// @brief Programs the counter of an event, from zero.
+/// @param event the event.
+static inline void __pmu_start(perf_event_t *event)
+{
+    wrmsr(MSR_PMC0 + event->counter, 0);
+    wrmsr(MSR_PERFEVTSEL0 + event->counter, event->evtsel | PMU_EVTSEL_EN);
+}
+
+/// @brief Stops the counter of an event, and adds what it counted to the event.
+/// @param event the event.
+static inline void __pmu_stop(perf_event_t *event)
+{
+    wrmsr(MSR_PERFEVTSEL0 + event->counter, event->evtsel);
+    event->count += rdmsr(MSR_PMC0 + event->counter) & pmu.mask;
+}
+
+int pmu_initialize(void)
+{
+    pt_regs_t ereg = { 0 };
+    call_cpuid(&ereg);
+    if (ereg.eax < CPUID_PMU_LEAF) {
+        pr_notice("The CPU has no architectural performance monitoring.\n");
+        return -1;
+    }
+    ereg.eax = CPUID_PMU_LEAF;
+    ereg.ebx = ereg.ecx = ereg.edx = 0;
+    call_cpuid(&ereg);
+    unsigned int version  = ereg.eax & 0xFFU;
+    unsigned int counters = (ereg.eax >> 8U) & 0xFFU;
+    unsigned int width    = (ereg.eax >> 16U) & 0xFFU;
+    unsigned int length   = (ereg.eax >> 24U) & 0xFFU;
+    if (!version || !counters || !width) {
+        pr_notice("The CPU has no architectural performance monitoring.\n");
+        return -1;
+    }
+    pmu.version     = version;
+    pmu.counters    = min(counters, PMU_MAX_COUNTERS);
+    pmu.mask        = (width < 64) ? ((1ULL << width) - 1ULL) : ~0ULL;
+    // The events past those EBX reports on are not available either.
+    pmu.unavailable = ereg.ebx | ((length < 32) ? ~((1U << length) - 1U) : 0U);
+    for (unsigned int i = 0; i < pmu.counters; ++i) {
+        wrmsr(MSR_PERFEVTSEL0 + i, 0);
+    }
+    // From the second version, the counters are also enabled globally.
+    if (pmu.version >= 2) {
+        wrmsr(MSR_PERF_GLOBAL_CTRL, (1ULL << pmu.counters) - 1ULL);
+    }
+    pr_notice("Performance monitoring version %u, %u counters of %u bits.\n", pmu.version, pmu.counters, width);
+    return 0;
+}
+
+void pmu_switch(struct task_struct *prev, struct task_struct *next)
+{
+    if (prev->perf) {
+        list_head_t *events = &prev->perf->events;
+        list_for_each_decl (it, events) {
+            perf_event_t *event = list_entry(it, perf_event_t, siblings);
+            if (event->enabled) {
+                __pmu_stop(event);
+            }
+        }
+    }
+    if (next->perf) {
+        list_head_t *events = &next->perf->events;
+        list_for_each_decl (it, events) {
+            perf_event_t *event = list_entry(it, perf_event_t, siblings);
+            if (event->enabled) {
+                __pmu_start(event);
+            }
+        }
+    }
+}
+
+void pmu_exit_task(struct task_struct *task)
+{
+    if (!task->perf) {
+        return;
+    }
+    uint8_t flags = irq_disable();
+    list_for_each_safe_decl (it, store, &task->perf->events) {
+        perf_event_t *event = list_entry(it, perf_event_t, siblings);
+        if (__pmu_is_counting(event)) {
+            __pmu_stop(event);
+        }
+        event->task = NULL;
+        list_head_remove(&event->siblings);
+    }
+    kfree(task->perf);
+    task->perf = NULL;
+    irq_enable(flags);
+}
+
+/// @brief Closes an event, freeing it with the last reference.
+/// @param file the file of the event.
+/// @return 0 on success.
+static int perf_file_close(vfs_file_t *file)
+{
+    if (--file->count > 0) {
+        return 0;
+    }
+    perf_event_t *event = (perf_event_t *)file->device;
+    uint8_t flags       = irq_disable();
+    task_struct *task   = event->task;
+    if (task) {
+        if (__pmu_is_counting(event)) {
+            __pmu_stop(event);
+        }
+        list_head_remove(&event->siblings);
+        task->perf->used &= ~(1U << event->counter);
+        if (list_head_empty(&task->perf->events)) {
+            kfree(task->perf);
+            task->perf = NULL;
+        }
+    }
+    irq_enable(flags);
+    kfree(event);
+    list_head_remove(&file->siblings);
+    vfs_dealloc_file(file);
+    return 0;
+}
+
+/// @brief Reads the count of an event.
+/// @param file the file of the event.
+/// @param buffer where the count is stored.
+/// @param offset not used.
+/// @param nbyte the size of the buffer, at least the size of the count.
+/// @return the size of the count, or a negative error code.
+static ssize_t perf_file_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    perf_event_t *event = (perf_event_t *)file->device;
+    if (nbyte < sizeof(uint64_t)) {
+        return -EINVAL;
+    }
+    uint8_t flags  = irq_disable();
+    uint64_t value = event->count;
+    if (__pmu_is_counting(event)) {
+        value += rdmsr(MSR_PMC0 + event->counter) & pmu.mask;
+    }
+    irq_enable(flags);
+    memcpy(buffer, &value, sizeof(uint64_t));
+    return sizeof(uint64_t);
+}
+
+/// @brief Enables, disables or resets an event.
+/// @param file the file of the event.
+/// @param request the request (PERF_EVENT_IOC_*).
+/// @param data not used.
+/// @return 0 on success, -EINVAL for other requests.
+static long perf_file_ioctl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    perf_event_t *event = (perf_event_t *)file->device;
+    long ret            = 0;
+    uint8_t flags       = irq_disable();
+    switch (request) {
+    case PERF_EVENT_IOC_ENABLE:
+        if (!event->enabled) {
+            event->enabled = true;
+            if (__pmu_is_counting(event)) {
+                __pmu_start(event);
+            }
+        }
+        break;
+    case PERF_EVENT_IOC_DISABLE:
+        if (__pmu_is_counting(event)) {
+            __pmu_stop(event);
+        }
+        event->enabled = false;
+        break;
+    case PERF_EVENT_IOC_RESET:
+        event->count = 0;
+        if (__pmu_is_counting(event)) {
+            wrmsr(MSR_PMC0 + event->counter, 0);
+        }
+        break;
+    default:
+        ret = -EINVAL;
+        break;
+    }
+    irq_enable(flags);
+    return ret;
+}
+
+/// @brief Retrieves the status of an event.
+/// @param file the file of the event.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int perf_file_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = 0400;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Computes the value of the event select register of an event.
+/// @param attr the description of the event.
+/// @param evtsel where the value is stored.
+/// @return 0 on success, -ENOENT if the event is not available, -EINVAL if it is not valid.
+static inline int __pmu_evtsel(const perf_event_attr_t *attr, uint32_t *evtsel)
+{
+    if (attr->type == PERF_TYPE_HARDWARE) {
+        if ((attr->config >= PERF_COUNT_HW_MAX) || (pmu.unavailable & (1U << pmu_generic_events[attr->config].bit))) {
+            return -ENOENT;
+        }
+        *evtsel = pmu_generic_events[attr->config].code;
+    } else if (attr->type == PERF_TYPE_RAW) {
+        if (attr->config & ~0xFFFFULL) {
+            return -EINVAL;
+        }
+        *evtsel = (uint32_t)attr->config;
+    } else {
+        return -ENOENT;
+    }
+    if (!(attr->flags & PERF_FLAG_EXCLUDE_USER)) {
+        *evtsel |= PMU_EVTSEL_USR;
+    }
+    if (!(attr->flags & PERF_FLAG_EXCLUDE_KERNEL)) {
+        *evtsel |= PMU_EVTSEL_OS;
+    }
+    return 0;
+}
+
+int sys_perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+    if (!pmu.counters) {
+        return -ENODEV;
+    }
+    if (!attr) {
+        return -EFAULT;
+    }
+    uint32_t known = PERF_FLAG_DISABLED | PERF_FLAG_EXCLUDE_USER | PERF_FLAG_EXCLUDE_KERNEL;
+    if ((cpu != -1) || (group_fd != -1) || flags || (pid < 0) || (attr->flags & ~known)) {
+        return -EINVAL;
+    }
+    uint32_t evtsel;
+    int ret = __pmu_evtsel(attr, &evtsel);
+    if (ret < 0) {
+        return ret;
+    }
+    task_struct *current = scheduler_get_current_process();
+    task_struct *task    = pid ? scheduler_get_running_process(pid) : current;
+    if (!task || (task->state == EXIT_ZOMBIE)) {
+        return -ESRCH;
+    }
+    if (current->uid && (current->uid != task->uid)) {
+        return -EACCES;
+    }
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        return fd;
+    }
+    if (!task->perf) {
+        if (!(task->perf = kmalloc(sizeof(perf_context_t)))) {
+            return -ENOMEM;
+        }
+        list_head_init(&task->perf->events);
+        task->perf->used = 0;
+    }
+    unsigned int counter = 0;
+    while ((counter < pmu.counters) && (task->perf->used & (1U << counter))) {
+        ++counter;
+    }
+    perf_event_t *event = (counter < pmu.counters) ? kmalloc(sizeof(perf_event_t)) : NULL;
+    vfs_file_t *file    = event ? vfs_alloc_file() : NULL;
+    if (!file) {
+        if (event) {
+            kfree(event);
+        }
+        if (list_head_empty(&task->perf->events)) {
+            kfree(task->perf);
+            task->perf = NULL;
+        }
+        return (counter < pmu.counters) ? -ENOMEM : -EBUSY;
+    }
+    event->evtsel  = evtsel;
+    event->counter = counter;
+    event->count   = 0;
+    event->enabled = !(attr->flags & PERF_FLAG_DISABLED);
+    event->task    = task;
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, "[perf_event]");
+    file->flags         = O_RDONLY;
+    file->fs_operations = &perf_fs_operations;
+    file->device        = event;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    // The counter starts right away if the process watches itself.
+    uint8_t irqflags = irq_disable();
+    task->perf->used |= 1U << counter;
+    list_head_insert_before(&event->siblings, &task->perf->events);
+    if (__pmu_is_counting(event)) {
+        __pmu_start(event);
+    }
+    irq_enable(irqflags);
+    fd_install(current, fd, file, file->flags);
+    return fd;
+}
@@ -0,0 +1,242 @@
+/// @file smp.c
+/// @brief Discovery of the CPUs through the MultiProcessor Specification tables.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SMP   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/smp.h"
+#include "klib/compiler.h"
+#include "string.h"
+
+/// The tables must be inside the first megabyte, which is mapped one to one.
+#define MP_LOWMEM_END       0x100000U
+/// Where the BIOS stores the segment of the Extended BIOS Data Area.
+#define MP_EBDA_SEGMENT     0x40EU
+/// Where the BIOS stores the size, in Kb, of the base memory.
+#define MP_BASE_MEMORY_SIZE 0x413U
+/// The area of the BIOS ROM.
+#define MP_BIOS_ROM_START   0xF0000U
+/// The end of the area of the BIOS ROM.
+#define MP_BIOS_ROM_END     0x100000U
+
+/// @name Types of the entries of the configuration table.
+/// @{
+#define MP_ENTRY_PROCESSOR 0 ///< A processor, the entry is 20 bytes long.
+#define MP_ENTRY_IOAPIC    2 ///< An I/O APIC, the entry is 8 bytes long.
+/// @}
+
+/// @name Flags of the processor entries.
+/// @{
+#define MP_CPU_ENABLED 0x01U ///< The processor can be used.
+#define MP_CPU_BSP     0x02U ///< The processor booted the system.
+/// @}
+
+/// @brief The floating pointer structure, it tells where the configuration table is.
+typedef struct mp_floating_pointer {
+    /// The signature, "_MP_".
+    char signature[4];
+    /// The physical address of the configuration table.
+    uint32_t config;
+    /// The length of the structure, in units of 16 bytes.
+    uint8_t length;
+    /// The version of the specification.
+    uint8_t spec_rev;
+    /// The bytes of the structure sum up to zero.
+    uint8_t checksum;
+    /// The first byte is non-zero for a default configuration, without table.
+    uint8_t features[5];
+} __attribute__((packed)) mp_floating_pointer_t;
+
+/// @brief The header of the configuration table, followed by its entries.
+typedef struct mp_config_table {
+    /// The signature, "PCMP".
+    char signature[4];
+    /// The length of the header and the entries.
+    uint16_t length;
+    /// The version of the specification.
+    uint8_t spec_rev;
+    /// The bytes of the header and the entries sum up to zero.
+    uint8_t checksum;
+    /// The manufacturer of the system.
+    char oem_id[8];
+    /// The family of the system.
+    char product_id[12];
+    /// The physical address of the table of the manufacturer.
+    uint32_t oem_table;
+    /// The size of the table of the manufacturer.
+    uint16_t oem_table_size;
+    /// The number of entries following the header.
+    uint16_t entry_count;
+    /// The physical address of the local APICs.
+    uint32_t lapic_address;
+    /// The length of the extended entries.
+    uint16_t extended_length;
+    /// The checksum of the extended entries.
+    uint8_t extended_checksum;
+    /// Reserved.
+    uint8_t reserved;
+} __attribute__((packed)) mp_config_table_t;
+
+/// @brief The entry of a processor.
+typedef struct mp_processor_entry {
+    /// The type of the entry, MP_ENTRY_PROCESSOR.
+    uint8_t type;
+    /// The identifier of the local APIC.
+    uint8_t apic_id;
+    /// The version of the local APIC.
+    uint8_t apic_version;
+    /// The flags of the processor (MP_CPU_*).
+    uint8_t flags;
+    /// The stepping, the model and the family of the processor.
+    uint32_t signature;
+    /// The features of the processor, as reported by CPUID.
+    uint32_t features;
+    /// Reserved.
+    uint32_t reserved[2];
+} __attribute__((packed)) mp_processor_entry_t;
+
+/// @brief The entry of an I/O APIC.
+typedef struct mp_ioapic_entry {
+    /// The type of the entry, MP_ENTRY_IOAPIC.
+    uint8_t type;
+    /// The identifier of the I/O APIC.
+    uint8_t id;
+    /// The version of the I/O APIC.
+    uint8_t version;
+    /// The I/O APIC can be used if the first bit is set.
+    uint8_t flags;
+    /// The physical address of the I/O APIC.
+    uint32_t address;
+} __attribute__((packed)) mp_ioapic_entry_t;
+
+/// The data of each CPU, reached through its %fs segment.
+cpu_local_t cpu_locals[NR_CPUS];
+
+/// The CPUs described by the firmware.
+static cpu_t cpus[NR_CPUS] = { { .apic_id = 0, .apic_version = 0, .bsp = true } };
+/// The number of CPUs inside cpus.
+static unsigned int nr_cpus = 1;
+/// The physical address of the local APICs.
+static uint32_t lapic_address = 0;
+/// The physical address of the first I/O APIC.
+static uint32_t ioapic_address = 0;
+
+/// @brief Sums up the bytes of a structure.
+/// @param ptr the structure.
+/// @param length its length.
+/// @return the sum, zero for a valid structure.
+static inline uint8_t __mp_checksum(const void *ptr, uint32_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    uint8_t sum          = 0;
+    for (uint32_t i = 0; i < length; ++i) {
+        sum += bytes[i];
+    }
+    return sum;
+}
+
+/// @brief Reads a word of the BIOS Data Area.
+/// @param addr the address of the word.
+/// @return the value of the word.
+static inline uint16_t __mp_bios_word(uint32_t addr)
+{
+    // The compiler takes the accesses below 4 Kb for NULL dereferences.
+    OPTIMIZER_HIDE_VAR(addr);
+    return *(volatile uint16_t *)addr;
+}
+
+/// @brief Searches an area for the floating pointer structure, which is aligned to 16 bytes.
+/// @param start the start of the area.
+/// @param length the length of the area.
+/// @return the structure, NULL if it is not there.
+static inline mp_floating_pointer_t *__mp_search(uint32_t start, uint32_t length)
+{
+    for (uint32_t addr = start; (addr + sizeof(mp_floating_pointer_t)) <= (start + length); addr += 16) {
+        mp_floating_pointer_t *mpf = (mp_floating_pointer_t *)addr;
+        if (!memcmp(mpf->signature, "_MP_", 4) && !__mp_checksum(mpf, mpf->length * 16U)) {
+            return mpf;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Searches the places the specification allows for the floating pointer structure.
+/// @return the structure, NULL if there is none.
+static inline mp_floating_pointer_t *__mp_find(void)
+{
+    mp_floating_pointer_t *mpf = NULL;
+    // The first Kb of the Extended BIOS Data Area.
+    uint32_t ebda = (uint32_t)__mp_bios_word(MP_EBDA_SEGMENT) << 4;
+    if (ebda && (mpf = __mp_search(ebda, 1024))) {
+        return mpf;
+    }
+    // The last Kb of the base memory.
+    uint32_t base = (uint32_t)__mp_bios_word(MP_BASE_MEMORY_SIZE) * 1024;
+    if (base && (mpf = __mp_search(base - 1024, 1024))) {
+        return mpf;
+    }
+    return __mp_search(MP_BIOS_ROM_START, MP_BIOS_ROM_END - MP_BIOS_ROM_START);
+}
+
+void smp_initialize(void)
+{
+    mp_floating_pointer_t *mpf = __mp_find();
+    if (!mpf) {
+        pr_notice("No MultiProcessor tables, running on a single CPU.\n");
+        return;
+    }
+    if (mpf->features[0] || !mpf->config || ((mpf->config + sizeof(mp_config_table_t)) > MP_LOWMEM_END)) {
+        pr_notice("No usable MultiProcessor configuration table, running on a single CPU.\n");
+        return;
+    }
+    mp_config_table_t *table = (mp_config_table_t *)mpf->config;
+    if (memcmp(table->signature, "PCMP", 4) || ((mpf->config + table->length) > MP_LOWMEM_END) ||
+        __mp_checksum(table, table->length)) {
+        pr_err("The MultiProcessor configuration table is not valid.\n");
+        return;
+    }
+    lapic_address = table->lapic_address;
+    nr_cpus       = 0;
+    // The entries follow the header, each type has its own length.
+    uint8_t *entry = (uint8_t *)(table + 1);
+    uint8_t *end   = (uint8_t *)table + table->length;
+    for (uint16_t i = 0; (i < table->entry_count) && (entry < end); ++i) {
+        if (*entry == MP_ENTRY_PROCESSOR) {
+            mp_processor_entry_t *processor = (mp_processor_entry_t *)entry;
+            if ((processor->flags & MP_CPU_ENABLED) && (nr_cpus < NR_CPUS)) {
+                cpus[nr_cpus].apic_id      = processor->apic_id;
+                cpus[nr_cpus].apic_version = processor->apic_version;
+                cpus[nr_cpus].bsp          = (processor->flags & MP_CPU_BSP) != 0;
+                cpu_locals[nr_cpus].cpu    = nr_cpus;
+                ++nr_cpus;
+            }
+            entry += sizeof(mp_processor_entry_t);
+        } else {
+            mp_ioapic_entry_t *ioapic = (mp_ioapic_entry_t *)entry;
+            if ((*entry == MP_ENTRY_IOAPIC) && (ioapic->flags & 1U) && !ioapic_address) {
+                ioapic_address = ioapic->address;
+            }
+            // All the other entries are 8 bytes long.
+            entry += sizeof(mp_ioapic_entry_t);
+        }
+    }
+    // The table must describe at least the CPU which booted the system.
+    if (!nr_cpus) {
+        cpus[0].bsp = true;
+        nr_cpus     = 1;
+    }
+    pr_notice("Found %u CPUs, local APICs at 0x%08x, I/O APIC at 0x%08x.\n", nr_cpus, lapic_address, ioapic_address);
+}
+
+unsigned int smp_num_cpus(void) { return nr_cpus; }
+
+const cpu_t *smp_get_cpu(unsigned int cpu) { return (cpu < nr_cpus) ? &cpus[cpu] : NULL; }
+
+uint32_t smp_lapic_address(void) { return lapic_address; }
+
+uint32_t smp_ioapic_address(void) { return ioapic_address; }
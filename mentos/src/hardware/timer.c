@@ -11,20 +11,26 @@
 
 #include "assert.h"
 #include "descriptor_tables/isr.h"
-#include "devices/fpu.h"
 #include "drivers/rtc.h"
 #include "errno.h"
+#include "hardware/hrtimer.h"
 #include "hardware/pic8259.h"
+#include "hardware/smp.h"
 #include "hardware/timer.h"
 #include "io/port_io.h"
-#include "io/video.h"
 #include "klib/irqflags.h"
+#include "klib/stdatomic.h"
+#include "math.h"
 #include "process/scheduler.h"
 #include "process/wait.h"
 #include "stdint.h"
 #include "string.h"
+#include "sys/cache.h"
 #include "system/panic.h"
 #include "system/signal.h"
+#include "system/profile.h"
+#include "system/softirq.h"
+#include "system/vdso.h"
 
 /// @defgroup picregs Programmable Interval Timer Registers
 /// @brief The list of registers used to set the PIT.
@@ -70,12 +76,41 @@
 /// Mask used to set the divisor.
 #define PIT_MASK          0xFFu
 
+/// Command which sets channel 0 as a one-shot (00|11|000|0, mode 0).
+#define PIT_ONESHOT_CONFIGURATION 0x30u
+/// Command which latches the count of channel 0 (00|00|000|0).
+#define PIT_LATCH_COUNT0          0x00u
+/// Read-back command which latches the status of channel 0 (11|10|001|0).
+#define PIT_READBACK_STATUS0      0xE2u
+/// Bit of the status telling that the output is high, i.e., the one-shot expired.
+#define PIT_STATUS_OUTPUT         0x80u
+/// Command which sets channel 2 as a one-shot (10|11|000|0, mode 0).
+#define PIT_CHANNEL2_ONESHOT      0xB0u
+/// The port which gates channel 2, and connects it to the speaker.
+#define PIT_CHANNEL2_PORT         0x61u
+/// Bit of PIT_CHANNEL2_PORT which lets channel 2 count.
+#define PIT_CHANNEL2_GATE         0x01u
+/// Bit of PIT_CHANNEL2_PORT which connects channel 2 to the speaker.
+#define PIT_CHANNEL2_SPEAKER      0x02u
+/// Bit of PIT_CHANNEL2_PORT which reports the output of channel 2.
+#define PIT_CHANNEL2_OUTPUT       0x20u
+/// The number of cycles of the PIT inside a tick.
+#define PIT_CYCLES_PER_TICK       (PIT_DIVISOR / TICKS_PER_SECOND)
+/// The longest one-shot, in ticks, the counter has 16 bits.
+#define NOHZ_MAX_TICKS            (0xFFFFu / PIT_CYCLES_PER_TICK)
+
 /// The number of ticks since the system started its execution.
-static __volatile__ unsigned long timer_ticks = 0;
-/// Contains timer for each CPU (for now only one)
-static tvec_base_t cpu_base                   = {0};
-/// Contains all process waiting for a sleep.
-static wait_queue_head_t sleep_queue;
+static __volatile__ unsigned long timer_ticks __cacheline_aligned = 0;
+/// Contains the timers of each CPU.
+static DEFINE_PER_CPU(tvec_base_t, cpu_bases);
+/// The timers of the CPU running the caller.
+#define cpu_base this_cpu(cpu_bases)
+/// The length of the one-shot programmed while idle, 0 if the tick is periodic.
+static unsigned long nohz_ticks               = 0;
+/// The ticks which interrupted user mode, and are not accounted yet.
+static unsigned long pending_user_ticks       = 0;
+/// The ticks which interrupted the kernel, and are not accounted yet.
+static unsigned long pending_system_ticks     = 0;
 
 void timer_phase(const uint32_t hz)
 {
@@ -91,32 +126,152 @@ void timer_phase(const uint32_t hz)
 
 void timer_handler(pt_regs_t *reg)
 {
-    // Save current process fpu state.
-    switch_fpu();
-    // Check if a second has passed.
-    ++timer_ticks;
-    // Update all timers
+    // A tick elapsed, or the one-shot programmed while idle expired.
+    unsigned long ticks = 1;
+    if (nohz_ticks) {
+        ticks      = nohz_ticks;
+        nohz_ticks = 0;
+        timer_phase(TICKS_PER_SECOND);
+    }
+    timer_ticks += ticks;
+    vdso_update_clock();
+    profile_tick(reg);
+    // The ticks are accounted to the mode the CPU was running in, by the
+    // softirq, which also runs the timers.
+    if ((reg->cs & 3) == 3) {
+        pending_user_ticks += ticks;
+    } else {
+        pending_system_ticks += ticks;
+    }
+    raise_softirq(TIMER_SOFTIRQ);
+    hrtimer_run();
+    // The process is rescheduled once irq_handler() sent the ack, and ran the
+    // softirqs. If the tick interrupted the kernel, the current process is
+    // rescheduled once it returns to user mode.
+    scheduler_set_need_resched();
+}
+
+/// @brief The bottom half of the tick, it accounts the ticks and runs the timers.
+static void __timer_softirq(void)
+{
+    // The tick can interrupt us, and account some more.
+    uint8_t flags              = irq_disable();
+    unsigned long user_ticks   = pending_user_ticks;
+    unsigned long system_ticks = pending_system_ticks;
+    pending_user_ticks         = 0;
+    pending_system_ticks       = 0;
+    irq_enable(flags);
+    if (user_ticks) {
+        scheduler_account_ticks(true, user_ticks);
+    }
+    if (system_ticks) {
+        scheduler_account_ticks(false, system_ticks);
+    }
     run_timer_softirq();
-    // Perform the schedule.
-    scheduler_run(reg);
-    // Update graphics.
-    video_update();
-    // Restore fpu state.
-    unswitch_fpu();
-    // The ack is sent to PIC only when all handlers terminated!
-    pic8259_send_eoi(IRQ_TIMER);
 }
 
 void timer_install(void)
 {
     dynamic_timers_install();
+    open_softirq(TIMER_SOFTIRQ, __timer_softirq);
 
     // Set the timer phase.
     timer_phase(TICKS_PER_SECOND);
     // Installs 'timer_handler' to IRQ0.
     irq_install_handler(IRQ_TIMER, timer_handler, "timer");
     // Enable the IRQ of the timer.
-    pic8259_irq_enable(IRQ_TIMER);
+    irq_unmask(IRQ_TIMER);
+    // Set up the high-resolution timers.
+    hrtimer_install();
+}
+
+uint32_t timer_pit_delay(uint32_t us)
+{
+    // The cycles of the PIT, without overflowing 32 bits.
+    uint32_t cycles = ((us * (PIT_DIVISOR / 1000U)) / 1000U) + ((us * (PIT_DIVISOR % 1000U)) / 1000000U);
+    // Let channel 2 count, with the speaker off.
+    outportb(PIT_CHANNEL2_PORT, (inportb(PIT_CHANNEL2_PORT) & ~PIT_CHANNEL2_SPEAKER) | PIT_CHANNEL2_GATE);
+    outportb(PIT_COMREG, PIT_CHANNEL2_ONESHOT);
+    outportb(PIT_DATAREG2, cycles & PIT_MASK);
+    outportb(PIT_DATAREG2, (cycles >> 8U) & PIT_MASK);
+    // The output goes high once the count reaches zero.
+    while (!(inportb(PIT_CHANNEL2_PORT) & PIT_CHANNEL2_OUTPUT)) {
+        cpu_relax();
+    }
+    // A cycle lasts 838.095 nanoseconds.
+    return (cycles * 838U) + ((cycles * 95U) / 1000U);
+}
+
+/// @brief Returns the number of ticks until the first timer of a vector expires.
+/// @param vector the vector of timers.
+/// @param next the value returned if no timer of the vector expires earlier.
+/// @return the number of ticks.
+static inline unsigned long __timer_vector_next_expiry(list_head_t *vector, unsigned long next)
+{
+    list_for_each_decl (it, vector) {
+        struct timer_list *timer = list_entry(it, struct timer_list, entry);
+        if (timer->expires <= timer_ticks) {
+            return 0;
+        }
+        next = min(next, timer->expires - timer_ticks);
+    }
+    return next;
+}
+
+void timer_nohz_enter(void)
+{
+#ifdef ENABLE_TICKLESS_IDLE
+    unsigned long next = NOHZ_MAX_TICKS;
+    // Without queued timers, only the longest one-shot bounds the sleep.
+    if (cpu_base.nr_timers) {
+#ifdef ENABLE_REAL_TIMER_SYSTEM
+        // Timers are not sorted inside the vectors, but most vectors are empty.
+        for (int i = 0; (i < TVR_SIZE) && next; ++i) {
+            next = __timer_vector_next_expiry(&cpu_base.tvr[i], next);
+        }
+        for (int j = 0; j < TVN_COUNT; ++j) {
+            for (int i = 0; (i < TVN_SIZE) && next; ++i) {
+                next = __timer_vector_next_expiry(&cpu_base.tvn[j][i], next);
+            }
+        }
+#else
+        next = __timer_vector_next_expiry(&cpu_base.list, next);
+#endif
+    }
+    next = hrtimer_nohz_next(next);
+    // A timer expires at the next tick anyway.
+    if (next <= 1) {
+        return;
+    }
+    nohz_ticks = next;
+    outportb(PIT_COMREG, PIT_ONESHOT_CONFIGURATION);
+    outportb(PIT_DATAREG0, (next * PIT_CYCLES_PER_TICK) & PIT_MASK);
+    outportb(PIT_DATAREG0, ((next * PIT_CYCLES_PER_TICK) >> 8U) & PIT_MASK);
+#endif
+}
+
+void timer_nohz_exit(void)
+{
+    // The one-shot expired and timer_handler accounted for it.
+    if (!nohz_ticks) {
+        return;
+    }
+    // If the one-shot expired, its interrupt is pending and accounts for the
+    // last tick, otherwise another interrupt woke up the CPU.
+    unsigned long ticks = nohz_ticks - 1;
+    outportb(PIT_COMREG, PIT_READBACK_STATUS0);
+    if (!(inportb(PIT_DATAREG0) & PIT_STATUS_OUTPUT)) {
+        outportb(PIT_COMREG, PIT_LATCH_COUNT0);
+        uint32_t count = inportb(PIT_DATAREG0);
+        count |= (uint32_t)inportb(PIT_DATAREG0) << 8U;
+        // The fraction of the ongoing tick is lost.
+        ticks = ((nohz_ticks * PIT_CYCLES_PER_TICK) - count) / PIT_CYCLES_PER_TICK;
+    }
+    timer_ticks += ticks;
+    vdso_update_clock();
+    scheduler_account_ticks(false, ticks);
+    nohz_ticks = 0;
+    timer_phase(TICKS_PER_SECOND);
 }
 
 uint64_t timer_get_seconds(void) { return timer_ticks / TICKS_PER_SECOND; }
@@ -172,6 +327,7 @@ static inline void __tvec_base_init(tvec_base_t *base)
 {
     spinlock_init(&base->lock);
     base->running_timer = NULL;
+    base->nr_timers     = 0;
 #ifdef ENABLE_REAL_TIMER_SYSTEM
     base->timer_ticks = timer_get_ticks();
     for (int i = 0; i < TVR_SIZE; ++i) {
@@ -183,10 +339,11 @@ static inline void __tvec_base_init(tvec_base_t *base)
         }
     }
 #else
-    list_head_init(&base.list);
+    list_head_init(&base->list);
 #endif
 }
 
+#ifdef ENABLE_REAL_TIMER_SYSTEM
 /// @brief Select correct timer vector and position inside of it for the input
 /// timer index contains the position inside of the tv_index timer vector.
 /// @param base the vector base we use to search the vector.
@@ -232,36 +389,40 @@ static inline void __timer_cascate_vector(tvec_base_t *base, list_head_t *curren
             timer         = list_entry(it, struct timer_list, entry);
             // Get the new vector.
             target_vector = __timer_get_target_vector(base, timer);
-            // If the new vector is different than the current one, move the timer.
+            // If the new vector is different than the current one, move the timer,
+            // which stays queued inside the base.
             if (target_vector != current_vector) {
-                // First, remove the timer from the current list.
                 list_head_remove(it);
-                // Then, re-initialize the timer.
-                init_timer(timer);
-                // Insert the timer inside the vector.
                 list_head_insert_before(it, target_vector);
-                // Since we are moving timers around, print the vector base.
                 pr_debug("Migrate timer (0x%p) 0x%p -> 0x%p\n", it, current_vector, target_vector);
-                __print_vector_base(base);
             }
         }
+        // Since we moved timers around, print the vector base.
+        __print_vector_base(base);
     }
 }
 
 /// @brief Move all timers from tv up one level.
 /// @param base the base for which we move the timers.
 /// @details
-/// Cascading means moving all dynamic timers in the base->tvn list into the
-/// proper lists of base->tvr; then, it returns a positive value, unless all base->tvn
-/// lists are now empty. If so, cascade() is invoked once more to replenish
-/// base->tvn with the timers included in a list of base->tvn, and so on.
+/// Cascading means moving all dynamic timers in the current list of
+/// base->tvn[0] into the proper lists of base->tvr. Once the index of
+/// base->tvn[0] wraps around, the current list of base->tvn[1] replenishes
+/// base->tvn[0], and so on, hence each level is cascaded only once every
+/// TIMER_TICKS(level) ticks.
 static inline void __timer_cascate_base(tvec_base_t *base)
 {
-    for (int i = 3; i >= 0; i--) {
+    for (int i = 0; i < TVN_COUNT; ++i) {
+        unsigned long index = (base->timer_ticks >> TIMER_TICKS_BITS(i)) & TVN_MASK;
         // Cascate the vector.
-        __timer_cascate_vector(base, base->tvn[i] + ((base->timer_ticks >> TIMER_TICKS_BITS((size_t)i)) & TVN_MASK));
+        __timer_cascate_vector(base, base->tvn[i] + index);
+        // The upper levels are still covering the ticks to come.
+        if (index) {
+            break;
+        }
     }
 }
+#endif
 
 // ============================================================================
 // SUPPORT FUNCTIONS (timer_list)
@@ -303,8 +464,8 @@ static inline void __timer_list_dealloc(struct timer_list *timer)
 
 void init_timer(struct timer_list *timer)
 {
-    // Initialize the spinlock and unlock it.
-    spinlock_unlock(&timer->lock);
+    // Initialize the spinlock.
+    spinlock_init(&timer->lock);
     list_head_init(&timer->entry);
     // timer->expires  = 0;
     // timer->function = NULL;
@@ -314,69 +475,30 @@ void init_timer(struct timer_list *timer)
 
 void add_timer(struct timer_list *timer)
 {
+    tvec_base_t *base = &cpu_base;
 #ifdef ENABLE_REAL_TIMER_SYSTEM
     // Get the vector.
-    list_head_t *vector = __timer_get_target_vector(&cpu_base, timer);
+    list_head_t *vector = __timer_get_target_vector(base, timer);
     // Insert the timer inside the vector.
     list_head_insert_before(&timer->entry, vector);
-    // Debug on the output.
-    pr_debug("Add timer     (0x%p) to (0x%p)\n", &timer->entry, vector);
-    __print_vector_base(&cpu_base);
 #else
     list_head_insert_before(&timer->entry, &base->list);
 #endif
+    // The base counts the timers it holds.
+    timer->base = base;
+    ++base->nr_timers;
 }
 
 void remove_timer(struct timer_list *timer)
 {
+    // Only a queued timer belongs to a base.
+    if (timer->base) {
+        --timer->base->nr_timers;
+    }
     // First, remove the timer from the current list.
     list_head_remove(&timer->entry);
     // Then, re-initialize the timer.
     init_timer(timer);
-    // Debug on the output.
-    pr_debug("Remove timer  (0x%p)\n", &timer->entry);
-    __print_vector_base(&cpu_base);
-}
-
-// ============================================================================
-// SUPPORT FUNCTIONS (sleep_data)
-// ============================================================================
-
-/// @brief Contains the entry of a wait queue and timespec which keeps trakc of
-/// the remaining time.
-typedef struct sleep_data {
-    /// POinter to the entry of a wait queue.
-    wait_queue_entry_t *wait_queue_entry;
-    /// Keeps track of the remaining time.
-    struct timespec *remaining;
-} sleep_data_t;
-
-/// @brief Allocates the memory for sleep_data.
-/// @return a pointer to the allocated sleep_data.
-static inline sleep_data_t *__sleep_data_alloc(void)
-{
-    // Allocate the memory.
-    sleep_data_t *sleep_data = (sleep_data_t *)kmalloc(sizeof(sleep_data_t));
-    pr_debug("ALLOCATE SLEEP_DATA 0x%p\n", sleep_data);
-    // Check the allocated memory.
-    assert(sleep_data && "Failed to allocate memory for a sleep_data.");
-    // Clean the memory.
-    memset(sleep_data, 0, sizeof(sleep_data_t));
-    // Initialize the sleep_data.
-    sleep_data->wait_queue_entry = NULL;
-    sleep_data->remaining        = NULL;
-    // Return the sleep_data.
-    return sleep_data;
-}
-
-/// @brief Frees the memory of a sleep_data.
-/// @param sleep_data pointer to the sleep_data.
-static inline void __sleep_data_dealloc(sleep_data_t *sleep_data)
-{
-    assert(sleep_data && "Received a NULL pointer.");
-    pr_debug("FREE     SLEEP_DATA 0x%p\n", sleep_data);
-    // Deallocate the sleep_data memory.
-    kfree(sleep_data);
 }
 
 // ============================================================================
@@ -448,10 +570,6 @@ static void __update_task_itimerval(int which, const struct itimerval *timer)
     __itimerval_to_values(&interval, &value, timer);
     // Sets the values for the task.
     switch (which) {
-    case ITIMER_REAL:
-        task->it_real_incr  = interval;
-        task->it_real_value = value;
-        break;
     case ITIMER_VIRTUAL:
         task->it_virt_incr  = interval;
         task->it_virt_value = value;
@@ -470,22 +588,28 @@ static void __update_task_itimerval(int which, const struct itimerval *timer)
 void dynamic_timers_install(void)
 {
     // Initialize the timer structure for each CPU.
-    __tvec_base_init(&cpu_base);
-    // Initialize wait queue.
-    wait_queue_head_init(&sleep_queue);
+    for (unsigned int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        __tvec_base_init(&per_cpu(cpu_bases, cpu));
+    }
 }
 
 void run_timer_softirq(void)
 {
     struct timer_list *timer;
     uint32_t timer_index;
-    // For now the base is just for the single core.
+    // The timers of the CPU which received the tick.
     tvec_base_t *base = &cpu_base;
     // Lock the base.
     spinlock_lock(&base->lock);
 #ifdef ENABLE_REAL_TIMER_SYSTEM
     // While we are not up to date with current ticks
     while (base->timer_ticks <= timer_get_ticks()) {
+        // If the wheel is empty, there is nothing to cascade or to execute
+        // until now.
+        if (!base->nr_timers) {
+            base->timer_ticks = timer_get_ticks() + 1;
+            break;
+        }
         // Index of the current timer to execute.
         timer_index = base->timer_ticks & TVR_MASK;
         // If the index is zero then all lists in base->tvr have been checked,
@@ -510,9 +634,7 @@ void run_timer_softirq(void)
                 timer->function(timer->data);
                 // Lock the baes again.
                 spinlock_lock(&base->lock);
-                // Removes the timer from the list.
-                remove_timer(timer);
-                // Free the memory of the timer.
+                // Removes the timer from the list, and frees its memory.
                 __timer_list_dealloc(timer);
             }
         }
@@ -520,12 +642,11 @@ void run_timer_softirq(void)
         ++base->timer_ticks;
     }
 #else
-    struct list_head_t *it, *tmp;
-    list_for_each_safe (it, tmp, &base->list) {
-        struct timer_list *timer = list_entry(it, struct timer_list, entry);
+    list_for_each_safe_decl(it, store, &base->list)
+    {
+        timer = list_entry(it, struct timer_list, entry);
         if (timer->expires <= timer_get_ticks()) {
             base->running_timer = timer;
-            timer->base         = NULL;
 
             // Executes timer function
             spinlock_unlock(&base->lock);
@@ -535,7 +656,6 @@ void run_timer_softirq(void)
 
             // Removes timer from list
             pr_debug("Removing dynamic timer...\n");
-            list_head_remove(it);
             __timer_list_dealloc(timer);
         }
     }
@@ -559,36 +679,16 @@ static inline void debug_timeout(unsigned long data)
 }
 
 /// @brief Callback for when a sleep timer expires.
-/// @param data Custom data stored in the timer.
-static inline void sleep_timeout(unsigned long data)
+/// @param task_ptr pointer to the sleeping process.
+static inline void sleep_timeout(unsigned long task_ptr)
 {
-    // Get the sleep data.
-    sleep_data_t *sleep_data             = (sleep_data_t *)data;
-    // Get the wait_queue_entry.
-    wait_queue_entry_t *wait_queue_entry = sleep_data->wait_queue_entry;
-    // Executed entry's wakeup test function
-    if (wait_queue_entry->func(wait_queue_entry, TASK_RUNNING, 0) == 1) {
-        pr_debug("Process (pid: %d) restored from sleep\n", wait_queue_entry->task->pid);
-        // Removes entry from list and memory.
-        remove_wait_queue(&sleep_queue, wait_queue_entry);
-        // Free the memory of the wait queue item.
-        wait_queue_entry_dealloc(wait_queue_entry);
-        // Free the memory of the sleep_data.
-        __sleep_data_dealloc(sleep_data);
-    }
-}
-
-/// @brief Function executed when the real_timer of a process expires, sends
-/// SIGALRM to process.
-/// @param task_ptr pointer to the process whos associated timer has expired.
-static inline void alarm_timeout(unsigned long task_ptr)
-{
-    // Get the task fromt the argument.
+    // Get the task from the argument.
     struct task_struct *task = (struct task_struct *)task_ptr;
-    // Send ALARM.
-    sys_kill(task->pid, SIGALRM);
-    // Remove the timer.
-    task->real_timer = NULL;
+    // The process might have been woken up, or killed, in the meantime.
+    if ((task->state == TASK_INTERRUPTIBLE) || (task->state == TASK_UNINTERRUPTIBLE)) {
+        pr_debug("Process (pid: %d) restored from sleep\n", task->pid);
+        scheduler_wake_up_task(task, TASK_RUNNING);
+    }
 }
 
 /// @brief Function executed when the real_timer of a process expires, sends
@@ -600,82 +700,81 @@ static inline void real_timer_timeout(unsigned long task_ptr)
     struct task_struct *task = (struct task_struct *)task_ptr;
     // Send the signal.
     sys_kill(task->pid, SIGALRM);
-    // If the real incr is not 0 then restart.
+    // If the real incr is not 0 then restart, one period after the previous
+    // expiration, skipping the periods which are already over.
     if (task->it_real_incr != 0) {
-        // Create new timer for process, the old one is going to be deleted.
-        task->real_timer           = __timer_list_alloc();
-        // Setup the timer.
-        task->real_timer->expires  = timer_get_ticks() + task->it_real_incr;
-        task->real_timer->function = &real_timer_timeout;
-        task->real_timer->data     = (unsigned long)task;
-        // Add the timer.
-        add_timer(task->real_timer);
-    } else {
-        // Remove the timer.
-        task->real_timer = NULL;
+        uint64_t now     = hrtimer_get_ns();
+        uint64_t expires = task->real_timer.expires + task->it_real_incr;
+        hrtimer_start(&task->real_timer, (expires > now) ? expires : (now + task->it_real_incr));
     }
 }
 
+/// @brief Starts the real timer of the current process.
+/// @param task the current process.
+/// @param value the nanoseconds before it expires.
+static inline void __start_real_timer(struct task_struct *task, uint64_t value)
+{
+    task->real_timer.function = &real_timer_timeout;
+    task->real_timer.data     = (unsigned long)task;
+    hrtimer_start(&task->real_timer, hrtimer_get_ns() + value);
+}
+
+/// @brief Returns the nanoseconds before the real timer of a process expires.
+/// @param task the process.
+/// @return the nanoseconds, 0 if the timer is not running.
+static inline uint64_t __real_timer_remaining(struct task_struct *task)
+{
+    uint64_t now = hrtimer_get_ns();
+    if (!task->real_timer.queued || (task->real_timer.expires <= now)) {
+        return 0;
+    }
+    return task->real_timer.expires - now;
+}
+
+/// @brief Returns the slack of the sleeps of a process.
+/// @param task the process.
+/// @return the nanoseconds, none for the real-time processes.
+static inline uint32_t __timer_slack(struct task_struct *task)
+{
+    return (task->se.policy == SCHED_OTHER) ? task->timer_slack_ns : 0;
+}
+
 // ============================================================================
 // TIMING FUNCTIONS
 // ============================================================================
 
+void timer_wake_up_at(struct task_struct *task, uint64_t expires)
+{
+    // The timer which wakes up the process is part of it, sleeping allocates
+    // nothing. Its slack lets it expire along with the other timers close to
+    // it, with a single interrupt.
+    task->sleep_timer.function = &sleep_timeout;
+    task->sleep_timer.data     = (unsigned long)task;
+    hrtimer_start_range_ns(&task->sleep_timer, expires, __timer_slack(task));
+}
+
 int sys_nanosleep(const struct timespec *req, struct timespec *rem)
 {
     // We need to store rem somewhere, because it contains how much time left
     // until the timer expires, when the timer is stopped early by a signal.
     pr_debug("sys_nanosleep([s:%d; ns:%d],...)\n", req->tv_sec, req->tv_nsec);
-    // Create a dinamic timer to wake up the process after some time
-    struct timer_list *sleep_timer = __timer_list_alloc();
-    // First, we save the remaining time. Then, we remove the current process
-    // from runqueue and stores it in the waiting queue, this must be done at
-    // the end, because it changes the current active page and invalidates the
-    // req and rem pointers (?)
-    sleep_data_t *sleep_data       = __sleep_data_alloc();
-    sleep_data->remaining          = rem;
-    sleep_data->wait_queue_entry   = sleep_on(&sleep_queue);
-    // Setup the timer.
-    sleep_timer->expires           = timer_get_ticks() + __timespec_to_ticks(req);
-    sleep_timer->function          = &sleep_timeout;
-    sleep_timer->data              = (unsigned long)sleep_data;
-    // Add the timer.
-    add_timer(sleep_timer);
+    struct task_struct *task = scheduler_get_current_process();
+    timer_wake_up_at(task, hrtimer_get_ns() + timespec_to_ns(req));
+    // The process leaves the CPU on its way back from the system call.
+    task->state = TASK_UNINTERRUPTIBLE;
     return 0;
 }
 
 unsigned sys_alarm(int seconds)
 {
     struct task_struct *task = scheduler_get_current_process();
-    // If there is already a timer running.
-    unsigned remaining_time  = 0;
-    if (task->real_timer) {
-        // First, we remove the timer.
-        remove_timer(task->real_timer);
-        // We compute the remaining time.
-        remaining_time = (task->real_timer->expires - timer_get_ticks()) / TICKS_PER_SECOND;
-        // Returns only the amount of seconds remaining.
-        if (seconds == 0) {
-            // Free the memory.
-            __timer_list_dealloc(task->real_timer);
-            // Remove the reference.
-            task->real_timer = NULL;
-            return remaining_time;
-        }
-    } else {
-        if (seconds == 0) {
-            return 0;
-        }
-        // Allocate new timer.
-        task->real_timer = __timer_list_alloc();
+    // The alarm replaces the real timer, we compute the seconds it had left.
+    unsigned remaining_time  = div64_32(__real_timer_remaining(task), NSEC_PER_SEC, NULL);
+    hrtimer_cancel(&task->real_timer);
+    task->it_real_incr = 0;
+    if (seconds > 0) {
+        __start_real_timer(task, (uint64_t)seconds * NSEC_PER_SEC);
     }
-    // Initialize the timer.
-    init_timer(task->real_timer);
-    // Setup the timer.
-    task->real_timer->expires  = timer_get_ticks() + TICKS_PER_SECOND * seconds;
-    task->real_timer->function = &alarm_timeout;
-    task->real_timer->data     = (unsigned long)task;
-    // Add the timer.
-    add_timer(task->real_timer);
     return remaining_time;
 }
 
@@ -684,9 +783,9 @@ int sys_getitimer(int which, struct itimerval *curr_value)
     struct task_struct *task = scheduler_get_current_process();
     // Transform the apropriate interval and store it in the given variable.
     if (which == ITIMER_REAL) {
-        // Extract remaining time in dynamic timer.
-        task->it_real_value = task->real_timer->expires - timer_get_ticks();
-        __values_to_itimerval(task->it_real_incr, task->it_real_value, curr_value);
+        // Extract remaining time in the high-resolution timer.
+        ns_to_timeval(task->it_real_incr, &curr_value->it_interval);
+        ns_to_timeval(__real_timer_remaining(task), &curr_value->it_value);
     } else if (which == ITIMER_VIRTUAL) {
         __values_to_itimerval(task->it_virt_incr, task->it_virt_value, curr_value);
     } else if (which == ITIMER_PROF) {
@@ -700,63 +799,53 @@ int sys_getitimer(int which, struct itimerval *curr_value)
 int sys_setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
 {
     // Invalid time domain
-    if (which < 0 || which > 3) {
+    if ((which < ITIMER_REAL) || (which > ITIMER_PROF)) {
         return -EINVAL;
     }
     // Returns old timer interval
     if (old_value != NULL) {
         sys_getitimer(which, old_value);
     }
-    // Get ticks of interval.
-    time_t new_interval_ticks = __timeval_to_ticks(&new_value->it_interval);
-    // If interval is 0 removes timer
-    struct task_struct *task  = scheduler_get_current_process();
-    if (new_interval_ticks == 0) {
-        // Removes real_timer.
-        if ((which == ITIMER_REAL) && (task->real_timer != NULL)) {
-            __timer_list_dealloc(task->real_timer);
-            task->real_timer = NULL;
+    struct task_struct *task = scheduler_get_current_process();
+    if (which == ITIMER_REAL) {
+        // The real timer uses the high-resolution timers, it is armed with its
+        // value, and reloaded with its interval.
+        uint64_t value     = timeval_to_ns(&new_value->it_value);
+        hrtimer_cancel(&task->real_timer);
+        task->it_real_incr = timeval_to_ns(&new_value->it_interval);
+        if (value != 0) {
+            __start_real_timer(task, value);
         }
-        __update_task_itimerval(which, new_value);
         return 0;
     }
-    switch (which) {
-    // Uses Dynamic Timers
-    case ITIMER_REAL: {
-        // Remove real_timer if already in use.
-        if (task->real_timer) {
-            remove_timer(task->real_timer);
-        } else {
-            // Alloc new timer
-            task->real_timer = __timer_list_alloc();
-        }
-        // Initialize the timer.
-        init_timer(task->real_timer);
-        // Setup the timer.
-        task->real_timer->expires  = timer_get_ticks() + new_interval_ticks;
-        task->real_timer->function = &real_timer_timeout;
-        task->real_timer->data     = (unsigned long)task;
-        // Add the timer.
-        add_timer(task->real_timer);
-    } break;
-
-    case ITIMER_VIRTUAL:
-    case ITIMER_PROF:
-        break;
-    }
-
     __update_task_itimerval(which, new_value);
     return 0;
 }
 
-void update_process_profiling_timer(task_struct *proc)
+/// @brief Counts down an interval timer, and reloads it once it expires.
+/// @param value the ticks left before the timer expires, 0 if it is disarmed.
+/// @param interval the ticks between two expirations, 0 for a one-shot timer.
+/// @param ticks the ticks elapsed.
+/// @return true if the timer has expired, false otherwise.
+static inline bool_t __itimer_count_down(unsigned long *value, unsigned long interval, unsigned long ticks)
 {
-    // If the timer is active
-    if (proc->it_prof_incr != 0) {
-        proc->it_prof_value += proc->se.exec_runtime;
-        if (proc->it_prof_value >= proc->it_prof_incr) {
-            sys_kill(proc->pid, SIGPROF);
-            proc->it_prof_value = 0;
-        }
+    if (*value > ticks) {
+        *value -= ticks;
+        return false;
+    }
+    // Keep the period, the ticks past the expiration count for the next one.
+    *value = interval ? (interval - ((ticks - *value) % interval)) : 0;
+    return true;
+}
+
+void update_process_itimers(task_struct *proc, bool_t user, unsigned long ticks)
+{
+    // The virtual timer only runs while the process runs in user mode.
+    if (user && proc->it_virt_value && __itimer_count_down(&proc->it_virt_value, proc->it_virt_incr, ticks)) {
+        sys_kill(proc->pid, SIGVTALRM);
+    }
+    // The profiling timer runs in both modes.
+    if (proc->it_prof_value && __itimer_count_down(&proc->it_prof_value, proc->it_prof_incr, ticks)) {
+        sys_kill(proc->pid, SIGPROF);
     }
 }
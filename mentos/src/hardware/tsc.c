@@ -0,0 +1,64 @@
+/// @file tsc.c
+/// @brief Time Stamp Counter (TSC), calibrated against the PIT.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[TSC   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "hardware/tsc.h"
+#include "hardware/cpuid.h"
+#include "hardware/timer.h"
+#include "klib/div64.h"
+
+/// The length of the calibration, in microseconds.
+#define TSC_CALIBRATION_US 10000
+
+/// The nanoseconds of a cycle, with TSC_SHIFT bits of fraction, 0 without TSC.
+static uint32_t tsc_mult = 0;
+/// The value of the TSC once it was calibrated.
+static uint64_t tsc_base = 0;
+/// If the TSC counts at a constant rate.
+static bool_t tsc_invariant = false;
+
+int tsc_initialize(void)
+{
+    if (!cpuid_has_feature_edx(CPUID_EDX_TSC)) {
+        pr_warning("The CPU has no Time Stamp Counter.\n");
+        return -1;
+    }
+    uint64_t start  = tsc_read();
+    uint32_t ns     = timer_pit_delay(TSC_CALIBRATION_US);
+    uint64_t cycles = tsc_read() - start;
+    // The nanoseconds of a cycle must fit the 32 bits of tsc_mult.
+    if ((cycles >> 32U) || ((uint32_t)cycles <= (ns >> (32U - TSC_SHIFT)))) {
+        pr_warning("The Time Stamp Counter is too slow: %u cycles in %u ns.\n", (uint32_t)cycles, ns);
+        return -1;
+    }
+    tsc_mult      = div64_32((uint64_t)ns << TSC_SHIFT, (uint32_t)cycles, NULL);
+    tsc_base      = tsc_read();
+    tsc_invariant = cpuid_has_invariant_tsc();
+    pr_notice("The Time Stamp Counter runs at %u kHz.\n", div64_32(cycles * 1000000U, ns, NULL));
+    // The kernel never changes the frequency of the CPU, but the firmware, or
+    // the deep sleep states, might.
+    if (!tsc_invariant) {
+        pr_warning("The Time Stamp Counter is not invariant, the clock might drift.\n");
+    }
+    return 0;
+}
+
+bool_t tsc_is_invariant(void) { return tsc_invariant; }
+
+uint32_t tsc_get_mult(void) { return tsc_mult; }
+
+uint64_t tsc_get_base(void) { return tsc_base; }
+
+uint64_t tsc_get_ns(void)
+{
+    uint64_t cycles = tsc_read() - tsc_base;
+    // The product of 64 and 32 bits, split so that each half fits 64 bits.
+    return (((cycles >> 32U) * tsc_mult) << (32U - TSC_SHIFT)) + (((cycles & 0xFFFFFFFFU) * tsc_mult) >> TSC_SHIFT);
+}
@@ -1,21 +1,129 @@
 /// @file   debug.c
 /// @brief  Debugging primitives.
+/// @details
+/// The messages are not written to the serial port by whoever logs them:
+/// they are appended to a ring of the CPU running the caller, with the
+/// interrupts disabled, and a work item later drains the rings to the
+/// serial port. Until the workqueues run, and for the critical messages,
+/// the rings are drained right away. The rings keep the latest messages,
+/// which are read through `/proc/kmsg`.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #include "io/debug.h"
+#include "errno.h"
+#include "hardware/smp.h"
+#include "drivers/serial.h"
 #include "io/ansi_colors.h"
-#include "io/port_io.h"
 #include "kernel.h"
+#include "klib/irqflags.h"
 #include "math.h"
+#include "process/workqueue.h"
 #include "stdio.h"
+#include "stdlib.h"
 #include "string.h"
 #include "sys/bitops.h"
 
-/// Serial port for QEMU.
-#define SERIAL_COM1 (0x03F8)
+/// The size of the log ring of each CPU, a power of two.
+#define LOG_RING_SIZE   8192
+/// The amount of bytes taken from a ring at a time, by the drainer.
+#define LOG_DRAIN_CHUNK 128
+
+/// @brief The ring where a CPU logs its messages.
+typedef struct log_ring {
+    /// The latest messages.
+    char buffer[LOG_RING_SIZE];
+    /// The amount of bytes ever logged, the next one goes at `head % LOG_RING_SIZE`.
+    unsigned long head;
+    /// The amount of bytes ever written to the serial port.
+    unsigned long tail;
+    /// If the last message did not end its line, so the next one needs no header.
+    short mid_line;
+    /// Where the messages are formatted.
+    char formatted[BUFSIZ];
+    /// Where the headers are formatted.
+    char prefix[BUFSIZ];
+} log_ring_t;
+
+/// The maximum length of a command of the debug points.
+#define DBG_COMMAND_SIZE 256
+
+/// The first debug point, placed by the linker.
+extern dbg_point_t _dbg_points_start[];
+/// The end of the debug points, placed by the linker.
+extern dbg_point_t _dbg_points_end[];
+
 /// Determines the log level.
 static int max_log_level = LOGLEVEL_DEBUG;
+/// The rings of the CPUs.
+static DEFINE_PER_CPU(log_ring_t, log_rings);
+/// The work which drains the rings to the serial port.
+static work_struct_t drain_work;
+/// If the rings are drained by the work, rather than by the callers.
+static int drain_started = 0;
+
+/// @brief Appends the given bytes to a ring, with the interrupts disabled,
+/// dropping the oldest bytes which have not been drained yet, if needed.
+/// @param ring the ring.
+/// @param s the bytes.
+/// @param n the amount of bytes.
+static inline void __log_write(log_ring_t *ring, const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        ring->buffer[(ring->head++) & (LOG_RING_SIZE - 1)] = s[i];
+    }
+    if ((ring->head - ring->tail) > LOG_RING_SIZE) {
+        ring->tail = ring->head - LOG_RING_SIZE;
+    }
+}
+
+/// @brief Appends the given string to a ring, with the interrupts disabled.
+/// @param ring the ring.
+/// @param s the string.
+static inline void __log_puts(log_ring_t *ring, const char *s) { __log_write(ring, s, strlen(s)); }
+
+/// @brief Writes the bytes of every ring, which have not been drained yet,
+/// to the serial port. The bytes are taken from the rings with the
+/// interrupts disabled, and handed to the driver of the serial port with
+/// the interrupts as they were.
+static void __log_drain(void)
+{
+    char chunk[LOG_DRAIN_CHUNK];
+    for (unsigned int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        log_ring_t *ring = &per_cpu(log_rings, cpu);
+        while (1) {
+            unsigned long flags = irq_disable();
+            size_t n            = min(ring->head - ring->tail, (unsigned long)LOG_DRAIN_CHUNK);
+            for (size_t i = 0; i < n; ++i) {
+                chunk[i] = ring->buffer[(ring->tail + i) & (LOG_RING_SIZE - 1)];
+            }
+            ring->tail += n;
+            irq_enable(flags);
+            if (n == 0) {
+                break;
+            }
+            serial_write(chunk, n);
+        }
+    }
+}
+
+/// @brief The work which drains the rings.
+/// @param work the work.
+static void __log_drain_work(work_struct_t *work) { __log_drain(); }
+
+/// @brief Has the rings drained, by the work, or right away for the
+/// critical messages and until the work is started.
+/// @param log_level the log level of the message.
+static inline void __log_kick(short log_level)
+{
+    if (!drain_started || (log_level <= LOGLEVEL_CRIT)) {
+        __log_drain();
+        return;
+    }
+    unsigned long flags = irq_disable();
+    schedule_work(&drain_work);
+    irq_enable(flags);
+}
 
 /// @brief Prints the correct header for the given debug level.
 /// @param file the file origin of the debug message.
@@ -23,7 +131,9 @@ static int max_log_level = LOGLEVEL_DEBUG;
 /// @param line the line in the file where debug message was called.
 /// @param log_level the log level.
 /// @param header the header we want to show.
-static inline void __debug_print_header(const char *file, const char *fun, int line, short log_level, char *header)
+/// @param ring the ring where the header is logged.
+static inline void
+__debug_print_header(const char *file, const char *fun, int line, short log_level, char *header, log_ring_t *ring)
 {
     // "EMERG  ", "ALERT  ", "CRIT   ", "ERR    ", "WARNING", "NOTICE ", "INFO   ", "DEBUG  ", "DEFAULT",
     static const char *log_level_label[] = {" EM ", " AL ", " CR ", " ER ", " WR ", " NT ", " IN ", " DB ", " DF "};
@@ -38,8 +148,7 @@ static inline void __debug_print_header(const char *file, const char *fun, int l
         FG_MAGENTA,         // "DEBUG  "
         FG_RESET            // "DEFAULT"
     };
-    static char tmp_prefix[BUFSIZ];
-    static char final_prefix[BUFSIZ];
+    char tmp_prefix[128];
     // Check the log level.
     if ((log_level < LOGLEVEL_EMERG) || (log_level > LOGLEVEL_DEBUG)) {
         // Set it to default.
@@ -47,29 +156,29 @@ static inline void __debug_print_header(const char *file, const char *fun, int l
     }
     // Set the color.
 #ifndef EMULATOR_OUTPUT_LOG
-    dbg_puts(log_level_color[log_level]);
+    __log_puts(ring, log_level_color[log_level]);
 #endif
-    dbg_putchar('[');
+    __log_puts(ring, "[");
     // Set the label.
-    dbg_puts(log_level_label[log_level]);
-    dbg_putchar('|');
+    __log_puts(ring, log_level_label[log_level]);
+    __log_puts(ring, "|");
     // Print the file and line.
-    sprintf(tmp_prefix, "%s:%d", file, line);
+    snprintf(tmp_prefix, sizeof(tmp_prefix), "%s:%d", file, line);
     // Print the message.
-    sprintf(final_prefix, " %-40s ", tmp_prefix);
+    snprintf(ring->prefix, BUFSIZ, " %-40s ", tmp_prefix);
     // Print the actual message.
-    dbg_puts(final_prefix);
+    __log_puts(ring, ring->prefix);
 #if 0
-    dbg_putchar('|');
-    sprintf(final_prefix, " %-25s ]", fun);
-    dbg_puts(final_prefix);
+    __log_puts(ring, "|");
+    snprintf(ring->prefix, BUFSIZ, " %-25s ]", fun);
+    __log_puts(ring, ring->prefix);
 #else
-    dbg_putchar(']');
+    __log_puts(ring, "]");
 #endif
-    dbg_putchar(' ');
+    __log_puts(ring, " ");
     if (header) {
-        dbg_puts(header);
-        dbg_putchar(' ');
+        __log_puts(ring, header);
+        __log_puts(ring, " ");
     }
 }
 
@@ -112,51 +221,173 @@ const char *dec_to_binary(unsigned long value, unsigned length)
     return buffer;
 }
 
-void dbg_putchar(char c) { outportb(SERIAL_COM1, (uint8_t)c); }
+void dbg_putchar(char c)
+{
+    unsigned long flags = irq_disable();
+    __log_write(&this_cpu(log_rings), &c, 1);
+    irq_enable(flags);
+    __log_kick(LOGLEVEL_DEFAULT);
+}
 
 void dbg_puts(const char *s)
 {
-    while ((*s) != 0) {
-        dbg_putchar(*s++);
+    unsigned long flags = irq_disable();
+    __log_puts(&this_cpu(log_rings), s);
+    irq_enable(flags);
+    __log_kick(LOGLEVEL_DEFAULT);
+}
+
+/// @brief Where a message is logged, along with what its headers need.
+typedef struct log_message {
+    log_ring_t *ring; ///< The ring.
+    const char *file; ///< The file origin of the message.
+    const char *fun;  ///< The function which logs the message.
+    int line;         ///< The line which logs the message.
+    short log_level;  ///< The log level.
+    char *header;     ///< The header of the message.
+} log_message_t;
+
+/// @brief Appends the formatted characters to the ring, with a header at the
+/// start of each line.
+/// @param sink the sink, whose data is the message.
+/// @return 0.
+static int __log_flush(printf_sink_t *sink)
+{
+    log_message_t *message = (log_message_t *)sink->data;
+    log_ring_t *ring       = message->ring;
+    for (size_t start = 0, end; start < sink->length; start = end) {
+        if (!ring->mid_line) {
+            __debug_print_header(message->file, message->fun, message->line, message->log_level, message->header, ring);
+            ring->mid_line = 1;
+        }
+        const char *eol = memchr(sink->buffer + start, '\n', sink->length - start);
+        end             = eol ? (size_t)(eol - sink->buffer) + 1 : sink->length;
+        __log_write(ring, sink->buffer + start, end - start);
+        if (eol) {
+            ring->mid_line = 0;
+        }
     }
+    return 0;
 }
 
 void dbg_printf(const char *file, const char *fun, int line, char *header, short log_level, const char *format, ...)
 {
-    // Define a buffer for the formatted string.
-    static char formatted[BUFSIZ];
-    static short new_line = 1;
+    // The ring, and its buffers, are only used with the interrupts disabled.
+    unsigned long flags = irq_disable();
+    log_ring_t *ring    = &this_cpu(log_rings);
 
-    // Stage 1: FORMAT
-    if (strlen(format) >= BUFSIZ) {
-        return;
-    }
-
-    // Start variabile argument's list.
+    // Format the message straight into the ring, a chunk at a time.
+    log_message_t message = {ring, file, fun, line, log_level, header};
+    printf_sink_t sink    = {ring->formatted, BUFSIZ, 0, 0, 0, __log_flush, &message};
     va_list ap;
     va_start(ap, format);
-    // Format the message.
-    vsnprintf(formatted, sizeof(formatted), format, ap);
-    // End the list of arguments.
+    vprintf_sink(&sink, format, ap);
     va_end(ap);
+    irq_enable(flags);
+
+    // Have the ring sent to the serial port.
+    __log_kick(log_level);
+}
+
+void dbg_start_drain(void)
+{
+    init_work(&drain_work, __log_drain_work);
+    drain_started = 1;
+}
+
+ssize_t dbg_read_log(char *buffer, off_t offset, size_t size)
+{
+    size_t count = 0;
+    if (offset < 0) {
+        return 0;
+    }
+    for (unsigned int cpu = 0; (cpu < NR_CPUS) && (count < size); ++cpu) {
+        log_ring_t *ring    = &per_cpu(log_rings, cpu);
+        unsigned long flags = irq_disable();
+        // The retained bytes of the ring follow those of the previous rings.
+        unsigned long length = min(ring->head, (unsigned long)LOG_RING_SIZE);
+        unsigned long first  = ring->head - length;
+        if ((unsigned long)offset >= length) {
+            offset -= length;
+            irq_enable(flags);
+            continue;
+        }
+        for (unsigned long pos = first + offset; (pos < ring->head) && (count < size); ++pos) {
+            buffer[count++] = ring->buffer[pos & (LOG_RING_SIZE - 1)];
+        }
+        offset = 0;
+        irq_enable(flags);
+    }
+    return count;
+}
 
-    // Stage 2: SEND
-    if (new_line) {
-        __debug_print_header(file, fun, line, log_level, header);
-        new_line = 0;
+ssize_t dbg_points_read(char *buffer, off_t offset, size_t size)
+{
+    char line[BUFSIZ];
+    size_t count = 0;
+    if (offset < 0) {
+        return 0;
     }
-    for (int it = 0; (formatted[it] != 0) && (it < BUFSIZ); ++it) {
-        dbg_putchar(formatted[it]);
-        if (formatted[it] != '\n') {
+    // The list is written again at every read, only the requested part is kept.
+    for (dbg_point_t *point = _dbg_points_start; (point < _dbg_points_end) && (count < size); ++point) {
+        size_t length = snprintf(
+            line, BUFSIZ, "%s:%u [%s] =%c\n", point->file, point->line, point->function, point->enabled ? 'p' : '_');
+        if ((size_t)offset >= length) {
+            offset -= length;
             continue;
         }
-        if ((it + 1) >= BUFSIZ) {
+        length = min(length - offset, size - count);
+        memcpy(buffer + count, line + offset, length);
+        count += length;
+        offset = 0;
+    }
+    return count;
+}
+
+int dbg_points_control(const char *command, size_t size)
+{
+    char copy[DBG_COMMAND_SIZE], *saveptr, *token;
+    const char *file = NULL, *function = NULL;
+    long line = -1;
+    int enable = -1, matched = 0;
+    if (size >= DBG_COMMAND_SIZE) {
+        return -EINVAL;
+    }
+    memcpy(copy, command, size);
+    copy[size] = 0;
+    // Parse the terms, and the flag which ends the command.
+    for (token = strtok_r(copy, " \t\n", &saveptr); token; token = strtok_r(NULL, " \t\n", &saveptr)) {
+        if (enable >= 0) {
+            return -EINVAL;
+        }
+        if (!strcmp(token, "+p") || !strcmp(token, "-p")) {
+            enable = (token[0] == '+');
             continue;
         }
-        if (formatted[it + 1] == 0) {
-            new_line = 1;
+        char *value = strtok_r(NULL, " \t\n", &saveptr);
+        if (!value) {
+            return -EINVAL;
+        }
+        if (!strcmp(token, "file")) {
+            file = value;
+        } else if (!strcmp(token, "func")) {
+            function = value;
+        } else if (!strcmp(token, "line")) {
+            line = strtol(value, NULL, 10);
         } else {
-            __debug_print_header(file, fun, line, log_level, header);
+            return -EINVAL;
+        }
+    }
+    if (enable < 0) {
+        return -EINVAL;
+    }
+    for (dbg_point_t *point = _dbg_points_start; point < _dbg_points_end; ++point) {
+        if ((file && strcmp(point->file, file)) || (function && strcmp(point->function, function)) ||
+            ((line >= 0) && (point->line != line))) {
+            continue;
         }
+        point->enabled = enable;
+        ++matched;
     }
+    return matched;
 }
@@ -8,6 +8,7 @@
 #include "io/debug.h"
 #include "process/process.h"
 #include "string.h"
+#include "sys/initcall.h"
 #include "sys/msg.h"
 #include "sys/sem.h"
 #include "sys/shm.h"
@@ -86,7 +87,12 @@ int procipc_module_init(void)
         return err;
     }
 
-    char *entry_names[] = {"msg", "sem", "shm"};
+    char *entry_names[]                   = {"msg", "sem", "shm"};
+    vfs_file_operations_t *entry_fs_ops[] = {
+        &procipc_msg_fs_operations,
+        &procipc_sem_fs_operations,
+        &procipc_shm_fs_operations,
+    };
     for (int i = 0; i < count_of(entry_names); i++) {
         char *entry_name = entry_names[i];
         // Create the `/proc/ipc/` entry.
@@ -96,7 +102,7 @@ int procipc_module_init(void)
         }
         // Set the specific operations.
         entry->sys_operations = &procipc_sys_operations;
-        entry->fs_operations  = &procipc_msg_fs_operations;
+        entry->fs_operations  = entry_fs_ops[i];
 
         if ((err = proc_entry_set_mask(entry, 0444))) {
             pr_err("Cannot set mask of `/proc/ipc/%s` file.\n", entry_name);
@@ -105,3 +111,5 @@ int procipc_module_init(void)
     }
     return 0;
 }
+
+fs_initcall(procipc_module_init, NULL);
@@ -5,11 +5,14 @@
 
 #include "fs/procfs.h"
 
+#include "ctype.h"
 #include "errno.h"
+#include "fs/seq_file.h"
 #include "io/debug.h"
 #include "libgen.h"
 #include "process/prio.h"
 #include "process/process.h"
+#include "process/scheduler.h"
 #include "stdio.h"
 #include "string.h"
 
@@ -68,6 +71,9 @@ static inline ssize_t __procr_do_cmdline(char *buffer, size_t bufsize, task_stru
 /// @return size of the written data in buffer.
 static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct *task)
 {
+    // Kernel threads have no segments, their fields are zero.
+    static const mm_struct_t no_mm = { 0 };
+    const mm_struct_t *mm          = task->mm ? task->mm : &no_mm;
     //(1) pid  %d
     //     The process ID.
     //
@@ -126,27 +132,27 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //      The format for this field was %lu before Linux 2.6.
     //
     strcat(buffer, " 0");
-    //(10) TODO: minflt  %lu
+    //(10) minflt  %lu
     //      The number of minor faults the process has made which
     //      have not required loading a memory page from disk.
     //
-    strcat(buffer, " 0");
-    //(11) TODO: cminflt  %lu
+    sprintf(buffer, "%s %lu", buffer, task->min_flt);
+    //(11) cminflt  %lu
     //      The number of minor faults that the process's waited-
     //      for children have made.
     //
-    strcat(buffer, " 0");
-    //(12) TODO: majflt  %lu
+    sprintf(buffer, "%s %lu", buffer, task->cmin_flt);
+    //(12) majflt  %lu
     //      The number of major faults the process has made which
     //      have required loading a memory page from disk.
     //
-    strcat(buffer, " 0");
-    //(13) TODO: cmajflt  %lu
+    sprintf(buffer, "%s %lu", buffer, task->maj_flt);
+    //(13) cmajflt  %lu
     //      The number of major faults that the process's waited-
     //      for children have made.
     //
-    strcat(buffer, " 0");
-    //(14) TODO: utime  %lu
+    sprintf(buffer, "%s %lu", buffer, task->cmaj_flt);
+    //(14) utime  %lu
     //      Amount of time that this process has been scheduled in
     //      user mode, measured in clock ticks (divide by
     //      sysconf(_SC_CLK_TCK)).  This includes guest time,
@@ -155,27 +161,27 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //      guest time field do not lose that time from their cal‐
     //      culations.
     //
-    strcat(buffer, " 0");
-    //(15) TODO: stime  %lu
+    sprintf(buffer, "%s %lu", buffer, task->utime);
+    //(15) stime  %lu
     //      Amount of time that this process has been scheduled in
     //      kernel mode, measured in clock ticks (divide by
     //      sysconf(_SC_CLK_TCK)).
     //
-    strcat(buffer, " 0");
-    //(16) TODO: cutime  %ld
+    sprintf(buffer, "%s %lu", buffer, task->stime);
+    //(16) cutime  %ld
     //      Amount of time that this process's waited-for children
     //      have been scheduled in user mode, measured in clock
     //      ticks (divide by sysconf(_SC_CLK_TCK)).  (See also
     //      times(2).)  This includes guest time, cguest_time (time
     //      spent running a virtual CPU, see below).
     //
-    strcat(buffer, " 0");
-    //(17) TODO: cstime  %ld
+    sprintf(buffer, "%s %lu", buffer, task->cutime);
+    //(17) cstime  %ld
     //      Amount of time that this process's waited-for children
     //      have been scheduled in kernel mode, measured in clock
     //      ticks (divide by sysconf(_SC_CLK_TCK)).
     //
-    strcat(buffer, " 0");
+    sprintf(buffer, "%s %lu", buffer, task->cstime);
     //(18) priority  %ld
     //      (Explanation for Linux 2.6) For processes running a
     //      real-time scheduling policy (policy below; see
@@ -196,7 +202,7 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //      The nice value (see setpriority(2)), a value in the
     //      range 19 (low priority) to -20 (high priority).
     //
-    sprintf(buffer, "%s %ld", buffer, PRIO_TO_NICE(task->se.prio));
+    sprintf(buffer, "%s %ld", buffer, PRIO_TO_NICE(task->se.normal_prio));
     //(20) TODO: num_threads  %ld
     //      Number of threads in this process (since Linux 2.6).
     //      Before kernel 2.6, this field was hard coded to 0 as a
@@ -222,7 +228,7 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //(23) vsize  %lu
     //      Virtual memory size in bytes.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->total_vm);
+    sprintf(buffer, "%s %lu", buffer, mm->total_vm);
     //(24) TODO: rss  %ld
     //      Resident Set Size: number of pages the process has in
     //      real memory.  This is just the pages which count toward
@@ -240,24 +246,24 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //(26) startcode  %lu  [PT]
     //      The address above which program text can run.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->start_code);
+    sprintf(buffer, "%s %lu", buffer, mm->start_code);
     //(27) endcode  %lu  [PT]
     //      The address below which program text can run.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->end_code);
+    sprintf(buffer, "%s %lu", buffer, mm->end_code);
     //(28) startstack  %lu  [PT]
     //      The address of the start (i.e., bottom) of the stack.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->start_stack);
+    sprintf(buffer, "%s %lu", buffer, mm->start_stack);
     //(29) kstkesp  %lu  [PT]
     //      The current value of ESP (stack pointer), as found in
     //      the kernel stack page for the process.
     //
-    sprintf(buffer, "%s %lu", buffer, task->thread.regs.useresp);
+    sprintf(buffer, "%s %lu", buffer, scheduler_get_user_regs(task)->useresp);
     //(30) kstkeip  %lu  [PT]
     //      The current EIP (instruction pointer).
     //
-    sprintf(buffer, "%s %lu", buffer, task->thread.regs.eip);
+    sprintf(buffer, "%s %lu", buffer, scheduler_get_user_regs(task)->eip);
     //(31) TODO: signal  %lu
     //      The bitmap of pending signals, displayed as a decimal
     //      number.  Obsolete, because it does not provide informa‐
@@ -346,35 +352,35 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     //      Address above which program initialized and uninitial‐
     //      ized (BSS) data are placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->start_data);
+    sprintf(buffer, "%s %lu", buffer, mm->start_data);
     //(46) end_data  %lu  (since Linux 3.3)  [PT]
     //      Address below which program initialized and uninitial‐
     //      ized (BSS) data are placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->end_data);
+    sprintf(buffer, "%s %lu", buffer, mm->end_data);
     //(47) start_brk  %lu  (since Linux 3.3)  [PT]
     //      Address above which program heap can be expanded with
     //      brk(2).
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->start_brk);
+    sprintf(buffer, "%s %lu", buffer, mm->start_brk);
     //(48) arg_start  %lu  (since Linux 3.5)  [PT]
     //      Address above which program command-line arguments
     //      (argv) are placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->arg_start);
+    sprintf(buffer, "%s %lu", buffer, mm->arg_start);
     //(49) arg_end  %lu  (since Linux 3.5)  [PT]
     //      Address below program command-line arguments (argv) are
     //      placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->arg_end);
+    sprintf(buffer, "%s %lu", buffer, mm->arg_end);
     //(50) env_start  %lu  (since Linux 3.5)  [PT]
     //      Address above which program environment is placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->env_start);
+    sprintf(buffer, "%s %lu", buffer, mm->env_start);
     //(51) env_end  %lu  (since Linux 3.5)  [PT]
     //      Address below which program environment is placed.
     //
-    sprintf(buffer, "%s %lu", buffer, task->mm->env_end);
+    sprintf(buffer, "%s %lu", buffer, mm->env_end);
     //(52) exit_code  %d  (since Linux 3.5)  [PT]
     //      The thread's exit status in the form reported by
     //      waitpid(2).
@@ -382,6 +388,55 @@ static inline ssize_t __procr_do_stat(char *buffer, size_t bufsize, task_struct
     return 1;
 }
 
+/// @brief Returns the data for the `/proc/<PID>/schedstat` file.
+/// @param buffer the buffer where the data should be placed.
+/// @param bufsize the size of the buffer.
+/// @param task the task associated with the `/proc/<PID>` folder.
+/// @return size of the written data in buffer.
+/// @details
+/// The first three fields are those of Linux, in ticks: the time spent on
+/// the CPU, the time spent waiting to run, and the number of times the task
+/// ran. They are followed by the number of voluntary and involuntary context
+/// switches, by the histogram of the wake-up latencies (see
+/// SCHED_LATENCY_BUCKETS), and by the longest one, in microseconds. The scheduler only updates the counters, the file
+/// is formatted when it is read.
+static inline ssize_t __procr_do_schedstat(char *buffer, size_t bufsize, task_struct *task)
+{
+    const sched_statistics_t *stats = &task->se.stats;
+    // A handful of numbers, far less than the size of the buffer.
+    int written = sprintf(buffer, "%lu %lu %lu", stats->cpu_time, stats->run_delay, stats->pcount);
+    written += sprintf(buffer + written, " %lu %lu", stats->nvcsw, stats->nivcsw);
+    for (int i = 0; i < SCHED_LATENCY_BUCKETS; ++i) {
+        written += sprintf(buffer + written, " %lu", stats->wakeup_latency[i]);
+    }
+    sprintf(buffer + written, " %lu\n", stats->wakeup_max);
+    return 1;
+}
+
+/// @brief Formats a file inside the `/proc/<PID>/` folder, in place inside the buffer of the open file.
+/// @param m the streaming state.
+/// @param v the record, unused since the content is a single one.
+/// @return 0.
+static int __procr_show(seq_file_t *m, void *v)
+{
+    proc_dir_entry_t *entry = (proc_dir_entry_t *)m->file->device;
+    task_struct *task       = (task_struct *)entry->data;
+    size_t bufsize;
+    char *buffer = seq_get_buf(m, &bufsize);
+    buffer[0]    = '\0';
+    // Call the specific function.
+    if (strcmp(entry->name, "cmdline") == 0) {
+        __procr_do_cmdline(buffer, bufsize, task);
+    } else if (strcmp(entry->name, "stat") == 0) {
+        __procr_do_stat(buffer, bufsize, task);
+    } else if (strcmp(entry->name, "schedstat") == 0) {
+        __procr_do_schedstat(buffer, bufsize, task);
+    }
+    size_t length = strlen(buffer);
+    seq_commit(m, ((length + 1) < bufsize) ? (int)length : -1);
+    return 0;
+}
+
 /// @brief Performs a read of files inside the `/proc/<PID>/` folder.
 /// @param file is the `/proc/<PID>/` folder, thus, it should be a `proc_dir_entry_t` data.
 /// @param buffer buffer where the read content must be placed.
@@ -395,30 +450,11 @@ static inline ssize_t __procr_read(vfs_file_t *file, char *buffer, off_t offset,
     }
     // Get the entry.
     proc_dir_entry_t *entry = (proc_dir_entry_t *)file->device;
-    if (entry == NULL) {
+    if ((entry == NULL) || (entry->data == NULL)) {
         return -EFAULT;
     }
-    // Get the task.
-    task_struct *task = (task_struct *)entry->data;
-    if (task == NULL) {
-        return -EFAULT;
-    }
-    // Prepare a support buffer.
-    char support[BUFSIZ];
-    memset(support, 0, BUFSIZ);
-    // Call the specific function.
-    if (strcmp(entry->name, "cmdline") == 0) {
-        __procr_do_cmdline(support, BUFSIZ, task);
-    } else if (strcmp(entry->name, "stat") == 0) {
-        __procr_do_stat(support, BUFSIZ, task);
-    }
-    // Copmute the amounts of bytes we want (and can) read.
-    ssize_t bytes_to_read = max(0, min(strlen(support) - offset, nbyte));
-    // Perform the read.
-    if (bytes_to_read > 0) {
-        strcpy(buffer, support + offset);
-    }
-    return bytes_to_read;
+    // The content is formatted once, by the first read of the open file.
+    return seq_read_single(file, __procr_show, buffer, offset, nbyte);
 }
 
 /// Filesystem general operations.
@@ -479,6 +515,16 @@ int procr_create_entry_pid(task_struct *entry)
         proc_entry->fs_operations  = &procr_fs_operations;
         proc_entry->data           = entry;
     }
+    {
+        // Create `/proc/[PID]/schedstat`.
+        if ((proc_entry = proc_create_entry("schedstat", proc_dir)) == NULL) {
+            pr_err("[task: %d] Cannot create proc entry `%s`.\n", entry->pid, path);
+            return -ENOENT;
+        }
+        proc_entry->sys_operations = &procr_sys_operations;
+        proc_entry->fs_operations  = &procr_fs_operations;
+        proc_entry->data           = entry;
+    }
     return 0;
 }
 
@@ -487,11 +533,10 @@ int procr_destroy_entry_pid(task_struct *entry)
     // Turn the pid into string. The maximum pid is 32768, thus entry pid is at most 6 chars.
     char pid_str[6];
     sprintf(pid_str, "%d", entry->pid);
-    // Get the root directory.
+    // Get the root directory, which exists only if someone looked for it.
     proc_dir_entry_t *proc_dir = proc_dir_entry_get(pid_str, NULL);
     if (proc_dir == NULL) {
-        pr_err("[task: %d] Cannot find proc root directory `%s`.\n", entry->pid, pid_str);
-        return -ENOENT;
+        return 0;
     }
     // Destroy `/proc/[PID]/cmdline`.
     if (proc_destroy_entry("cmdline", proc_dir)) {
@@ -503,6 +548,11 @@ int procr_destroy_entry_pid(task_struct *entry)
         pr_err("[task: %d] Cannot destroy proc stat.\n", entry->pid);
         return -ENOENT;
     }
+    // Destroy `/proc/[PID]/schedstat`.
+    if (proc_destroy_entry("schedstat", proc_dir)) {
+        pr_err("[task: %d] Cannot destroy proc schedstat.\n", entry->pid);
+        return -ENOENT;
+    }
     // Destroy `/proc/[PID]`.
     if (proc_rmdir(pid_str, NULL)) {
         pr_err("[task: %d] Cannot remove proc root directory `%s`.\n", entry->pid, pid_str);
@@ -510,3 +560,52 @@ int procr_destroy_entry_pid(task_struct *entry)
     }
     return 0;
 }
+
+/// @brief Returns the process with the given pid, if it can have a `/proc/<PID>` folder.
+/// @param pid the pid of the process.
+/// @return a pointer to the process, NULL otherwise.
+static inline task_struct *__procr_get_task(pid_t pid)
+{
+    task_struct *task = scheduler_get_running_process(pid);
+    // The processes have their folder from when their files are set up, until they are released.
+    return (task && task->files) ? task : NULL;
+}
+
+int procr_create_entry_path(const char *path)
+{
+    // Only the paths inside `/proc/<PID>` are created on demand.
+    if ((strncmp(path, "/proc/", 6) != 0) || !isdigit(path[6])) {
+        return -ENOENT;
+    }
+    pid_t pid = 0;
+    for (path += 6; isdigit(*path); ++path) {
+        if ((pid = (pid * 10) + (*path - '0')) >= MAX_PROCESSES) {
+            return -ENOENT;
+        }
+    }
+    if ((*path != '\0') && (*path != '/')) {
+        return -ENOENT;
+    }
+    char pid_str[6];
+    sprintf(pid_str, "%d", pid);
+    task_struct *task = __procr_get_task(pid);
+    if ((task == NULL) || (proc_dir_entry_get(pid_str, NULL) != NULL)) {
+        return -ENOENT;
+    }
+    return procr_create_entry_pid(task);
+}
+
+void procr_create_entries(void)
+{
+    char pid_str[6];
+    for (pid_t pid = 0; pid < MAX_PROCESSES; ++pid) {
+        task_struct *task = __procr_get_task(pid);
+        if (task == NULL) {
+            continue;
+        }
+        sprintf(pid_str, "%d", pid);
+        if (proc_dir_entry_get(pid_str, NULL) == NULL) {
+            procr_create_entry_pid(task);
+        }
+    }
+}
@@ -3,13 +3,31 @@
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
+#include "descriptor_tables/isr.h"
+#include "drivers/zram.h"
 #include "errno.h"
+#include "fs/blkdev.h"
 #include "fs/procfs.h"
+#include "fs/seq_file.h"
+#include "fs/vfs.h"
+#include "hardware/cpuid.h"
+#include "hardware/pic8259.h"
+#include "hardware/smp.h"
 #include "hardware/timer.h"
 #include "io/debug.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/ksm.h"
+#include "mem/paging.h"
 #include "process/process.h"
+#include "process/scheduler.h"
 #include "stdio.h"
 #include "string.h"
+#include "sys/initcall.h"
+#include "system/profile.h"
+#include "system/trace.h"
+#include "system/syscall.h"
 #include "version.h"
 
 static ssize_t procs_do_uptime(char *buffer, size_t bufsize);
@@ -24,6 +42,55 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize);
 
 static ssize_t procs_do_stat(char *buffer, size_t bufsize);
 
+static ssize_t procs_do_diskstats(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_buddyinfo(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_slabinfo(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_zramstat(char *buffer, size_t bufsize);
+
+static ssize_t procs_do_ksm(char *buffer, size_t bufsize);
+
+/// @brief Formats the content of a file, in place inside the buffer of the open file.
+/// @param m The streaming state.
+/// @param v The record, unused since the content is a single one.
+/// @return 0.
+static int __procs_show(seq_file_t *m, void *v)
+{
+    proc_dir_entry_t *entry = (proc_dir_entry_t *)m->file->device;
+    size_t bufsize;
+    char *buffer = seq_get_buf(m, &bufsize);
+    // Call the specific function.
+    ssize_t ret  = 0;
+    if (strcmp(entry->name, "uptime") == 0) {
+        ret = procs_do_uptime(buffer, bufsize);
+    } else if (strcmp(entry->name, "version") == 0) {
+        ret = procs_do_version(buffer, bufsize);
+    } else if (strcmp(entry->name, "mounts") == 0) {
+        ret = procs_do_mounts(buffer, bufsize);
+    } else if (strcmp(entry->name, "cpuinfo") == 0) {
+        ret = procs_do_cpuinfo(buffer, bufsize);
+    } else if (strcmp(entry->name, "meminfo") == 0) {
+        ret = procs_do_meminfo(buffer, bufsize);
+    } else if (strcmp(entry->name, "stat") == 0) {
+        ret = procs_do_stat(buffer, bufsize);
+    } else if (strcmp(entry->name, "diskstats") == 0) {
+        ret = procs_do_diskstats(buffer, bufsize);
+    } else if (strcmp(entry->name, "buddyinfo") == 0) {
+        ret = procs_do_buddyinfo(buffer, bufsize);
+    } else if (strcmp(entry->name, "slabinfo") == 0) {
+        ret = procs_do_slabinfo(buffer, bufsize);
+    } else if (strcmp(entry->name, "zramstat") == 0) {
+        ret = procs_do_zramstat(buffer, bufsize);
+    } else if (strcmp(entry->name, "ksm") == 0) {
+        ret = procs_do_ksm(buffer, bufsize);
+    }
+    // The functions truncate their output to the buffer, which is then too small.
+    seq_commit(m, ((ret >= 0) && ((size_t)ret + 1 < bufsize)) ? (int)ret : -1);
+    return 0;
+}
+
 /// @brief Read function for the proc system.
 /// @param file The file.
 /// @param buf Buffer where the read content must be placed.
@@ -41,38 +108,53 @@ static ssize_t __procs_read(vfs_file_t *file, char *buf, off_t offset, size_t nb
         pr_err("The file is not a valid proc entry.\n");
         return -EFAULT;
     }
-    // Prepare a buffer.
-    char buffer[BUFSIZ];
-    memset(buffer, 0, BUFSIZ);
-    // Call the specific function.
-    int ret = 0;
-    if (strcmp(entry->name, "uptime") == 0) {
-        ret = procs_do_uptime(buffer, BUFSIZ);
-    } else if (strcmp(entry->name, "version") == 0) {
-        ret = procs_do_version(buffer, BUFSIZ);
-    } else if (strcmp(entry->name, "mounts") == 0) {
-        ret = procs_do_mounts(buffer, BUFSIZ);
-    } else if (strcmp(entry->name, "cpuinfo") == 0) {
-        ret = procs_do_cpuinfo(buffer, BUFSIZ);
-    } else if (strcmp(entry->name, "meminfo") == 0) {
-        ret = procs_do_meminfo(buffer, BUFSIZ);
-    } else if (strcmp(entry->name, "stat") == 0) {
-        ret = procs_do_stat(buffer, BUFSIZ);
-    }
-    // Perform read.
-    ssize_t it = 0;
-    if (ret >= 0) {
-        size_t name_len = strlen(buffer);
-        size_t read_pos = offset;
-        if (read_pos < name_len) {
-            while ((it < nbyte) && (read_pos < name_len)) {
-                *buf++ = buffer[read_pos];
-                ++read_pos;
-                ++it;
-            }
-        }
+    // The kernel log, the list of the debug points, the samples, and the
+    // tracepoints, are read from their own buffers.
+    if (strcmp(entry->name, "kmsg") == 0) {
+        return dbg_read_log(buf, offset, nbyte);
+    }
+    if (strcmp(entry->name, "dyndbg") == 0) {
+        return dbg_points_read(buf, offset, nbyte);
+    }
+    if (strcmp(entry->name, "profile") == 0) {
+        return profile_read(file, buf, offset, nbyte);
+    }
+    if (strcmp(entry->name, "trace") == 0) {
+        return trace_read(file, buf, offset, nbyte);
+    }
+    if (strcmp(entry->name, "trace_events") == 0) {
+        return trace_events_read(buf, offset, nbyte);
+    }
+    // The content is formatted once, by the first read of the open file.
+    return seq_read_single(file, __procs_show, buf, offset, nbyte);
+}
+
+/// @brief Write function for the proc system, only `/proc/dyndbg`, `/proc/profile`, `/proc/trace_events` and
+///        `/proc/ksm` are written.
+/// @param file The file.
+/// @param buf Buffer with the content to write.
+/// @param offset Offset from which we start writing (unused).
+/// @param nbyte The number of bytes to write.
+/// @return The number of written bytes, or a negative error code.
+static ssize_t __procs_write(vfs_file_t *file, const void *buf, off_t offset, size_t nbyte)
+{
+    proc_dir_entry_t *entry = (proc_dir_entry_t *)file->device;
+    if (entry == NULL) {
+        return -EINVAL;
+    }
+    int ret;
+    if (strcmp(entry->name, "dyndbg") == 0) {
+        ret = dbg_points_control(buf, nbyte);
+    } else if (strcmp(entry->name, "profile") == 0) {
+        ret = profile_control(buf, nbyte);
+    } else if (strcmp(entry->name, "trace_events") == 0) {
+        ret = trace_events_control(buf, nbyte);
+    } else if (strcmp(entry->name, "ksm") == 0) {
+        ret = ksm_control(buf, nbyte);
+    } else {
+        return -EINVAL;
     }
-    return it;
+    return (ret < 0) ? ret : (ssize_t)nbyte;
 }
 
 /// Filesystem general operations.
@@ -90,7 +172,7 @@ static vfs_file_operations_t procs_fs_operations = {
     .unlink_f   = NULL,
     .close_f    = NULL,
     .read_f     = __procs_read,
-    .write_f    = NULL,
+    .write_f    = __procs_write,
     .lseek_f    = NULL,
     .stat_f     = NULL,
     .ioctl_f    = NULL,
@@ -101,7 +183,9 @@ static vfs_file_operations_t procs_fs_operations = {
 int procs_module_init(void)
 {
     proc_dir_entry_t *system_entry;
-    char *entry_names[] = {"uptime", "version", "mounts", "cpuinfo", "meminfo", "stat"};
+    char *entry_names[] = {"uptime",    "version",  "mounts",   "cpuinfo", "meminfo", "stat",  "diskstats",
+                           "buddyinfo", "slabinfo", "zramstat", "kmsg",    "dyndbg",  "profile", "trace",
+                           "trace_events", "ksm"};
     for (int i = 0; i < count_of(entry_names); i++) {
         char *entry_name = entry_names[i];
         if ((system_entry = proc_create_entry(entry_name, NULL)) == NULL) {
@@ -112,7 +196,12 @@ int procs_module_init(void)
         // Set the specific operations.
         system_entry->sys_operations = &procs_sys_operations;
         system_entry->fs_operations  = &procs_fs_operations;
-        if (proc_entry_set_mask(system_entry, 0444) < 0) {
+        // Only the debug points, the profiler, the tracepoints, and the merging of the pages, are written, by root.
+        mode_t mask = ((strcmp(entry_name, "dyndbg") == 0) || (strcmp(entry_name, "profile") == 0) ||
+                       (strcmp(entry_name, "trace_events") == 0) || (strcmp(entry_name, "ksm") == 0))
+                          ? 0644
+                          : 0444;
+        if (proc_entry_set_mask(system_entry, mask) < 0) {
             pr_err("Cannot set mask of `/proc/%s`.\n", entry_name);
             return 1;
         }
@@ -121,11 +210,18 @@ int procs_module_init(void)
     return 0;
 }
 
-/// @brief Write the uptime inside the buffer.
+fs_initcall(procs_module_init, NULL);
+
+/// @brief Write the uptime, and the time spent idle, in seconds inside the buffer.
 /// @param buffer the buffer.
 /// @param bufsize the buffer size.
 /// @return the amount we wrote.
-static ssize_t procs_do_uptime(char *buffer, size_t bufsize) { return sprintf(buffer, "%d", timer_get_seconds()); }
+static ssize_t procs_do_uptime(char *buffer, size_t bufsize)
+{
+    unsigned long user, system, idle;
+    scheduler_get_cpu_ticks(&user, &system, &idle);
+    return sprintf(buffer, "%d %lu\n", timer_get_seconds(), idle / TICKS_PER_SECOND);
+}
 
 /// @brief Write the version inside the buffer.
 /// @param buffer the buffer.
@@ -140,13 +236,53 @@ static ssize_t procs_do_version(char *buffer, size_t bufsize)
 /// @param buffer the buffer.
 /// @param bufsize the buffer size.
 /// @return the amount we wrote.
-static ssize_t procs_do_mounts(char *buffer, size_t bufsize) { return 0; }
+static ssize_t procs_do_mounts(char *buffer, size_t bufsize) { return vfs_mounts_dump(buffer, bufsize); }
 
 /// @brief Write the cpu information inside the buffer.
 /// @param buffer the buffer.
 /// @param bufsize the buffer size.
 /// @return the amount we wrote.
-static ssize_t procs_do_cpuinfo(char *buffer, size_t bufsize) { return 0; }
+static ssize_t procs_do_cpuinfo(char *buffer, size_t bufsize)
+{
+    cpuinfo_t info;
+    pt_regs_t registers = { 0 };
+    cpuid_write_vendor(&info, &registers);
+    uint32_t family, model, stepping;
+    cpuid_get_signature(&family, &model, &stepping);
+    char brand[CPUID_BRAND_STRING_SIZE];
+    if (cpuid_get_brand_string(brand, sizeof(brand)) < 0) {
+        strcpy(brand, "unknown");
+    }
+    ssize_t written = 0;
+    // One paragraph for each CPU, the kernel runs on the one which booted it.
+    for (unsigned int i = 0; (i < smp_num_cpus()) && ((size_t)written < bufsize); ++i) {
+        const cpu_t *cpu = smp_get_cpu(i);
+        written += snprintf(
+            buffer + written, bufsize - written,
+            "processor  : %u\n"
+            "vendor_id  : %s\n"
+            "cpu family : %u\n"
+            "model      : %u\n"
+            "model name : %s\n"
+            "stepping   : %u\n"
+            "apicid     : %u\n"
+            "apic ver   : %u\n"
+            "bsp        : %s\n"
+            "online     : %s\n"
+            "flags      : ",
+            i, info.cpu_vendor, family, model, brand, stepping, cpu->apic_id, cpu->apic_version,
+            cpu->bsp ? "yes" : "no", (i == smp_processor_id()) ? "yes" : "no");
+        if ((size_t)written >= bufsize) {
+            break;
+        }
+        written += cpuid_write_flags(buffer + written, bufsize - written);
+        if ((size_t)written >= bufsize) {
+            break;
+        }
+        written += snprintf(buffer + written, bufsize - written, "\n\n");
+    }
+    return written;
+}
 
 /// @brief Write the memory information inside the buffer.
 /// @param buffer the buffer.
@@ -157,12 +293,16 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize)
     double total_space            = get_zone_total_space(GFP_KERNEL) + get_zone_total_space(GFP_HIGHUSER);
     double free_space             = get_zone_free_space(GFP_KERNEL) + get_zone_free_space(GFP_HIGHUSER);
     double cached_space           = get_zone_cached_space(GFP_KERNEL) + get_zone_cached_space(GFP_HIGHUSER);
-    double used_space             = total_space - free_space;
+    double used_space             = total_space - free_space - cached_space;
     // Buddy system status strings.
     char kernel_buddy_status[512] = {0};
     char user_buddy_status[512]   = {0};
     get_zone_buddy_system_status(GFP_KERNEL, kernel_buddy_status, sizeof(kernel_buddy_status));
     get_zone_buddy_system_status(GFP_HIGHUSER, user_buddy_status, sizeof(user_buddy_status));
+    // Allocation counters.
+    unsigned long kernel_allocs = 0, kernel_failures = 0, user_allocs = 0, user_failures = 0;
+    get_zone_alloc_stats(GFP_KERNEL, &kernel_allocs, &kernel_failures);
+    get_zone_alloc_stats(GFP_HIGHUSER, &user_allocs, &user_failures);
     // Format and return the information for the buffer.
     return snprintf(
         buffer, bufsize,
@@ -171,13 +311,101 @@ static ssize_t procs_do_meminfo(char *buffer, size_t bufsize)
         "MemUsed        : %12.2f Kb\n"
         "Cached         : %12.2f Kb\n"
         "Kernel Zone    : %s\n"
-        "User Zone      : %s\n",
+        "User Zone      : %s\n"
+        "Kernel Allocs  : %12lu\n"
+        "Kernel Fails   : %12lu\n"
+        "User Allocs    : %12lu\n"
+        "User Fails     : %12lu\n",
         total_space / (double)K, free_space / (double)K, used_space / (double)K, cached_space / (double)K,
-        kernel_buddy_status, user_buddy_status);
+        kernel_buddy_status, user_buddy_status, kernel_allocs, kernel_failures, user_allocs, user_failures);
+}
+
+/// @brief Write the activity of the system since boot inside the buffer, in
+///        the style of `/proc/stat`: the time spent by all the CPUs, and by
+///        each one, in ticks (user, nice, system, idle, iowait, irq, softirq),
+///        the interrupts of each IRQ line, the context switches, the boot time,
+///        the processes created, and those runnable, or blocked.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_stat(char *buffer, size_t bufsize)
+{
+    cpu_stat_t total = { 0 }, stat;
+    unsigned int ncpus = smp_num_cpus();
+    for (unsigned int cpu = 0; scheduler_get_cpu_stat(cpu, &stat) == 0; ++cpu) {
+        total.user_ticks += stat.user_ticks;
+        total.system_ticks += stat.system_ticks;
+        total.idle_ticks += stat.idle_ticks;
+        total.iowait_ticks += stat.iowait_ticks;
+        total.switches += stat.switches;
+        total.forks += stat.forks;
+    }
+    size_t written = 0;
+    written += snprintf(
+        buffer + written, bufsize - written, "cpu  %lu 0 %lu %lu %lu 0 0\n", total.user_ticks, total.system_ticks,
+        total.idle_ticks, total.iowait_ticks);
+    for (unsigned int cpu = 0; (cpu < ncpus) && (written < bufsize); ++cpu) {
+        scheduler_get_cpu_stat(cpu, &stat);
+        written += snprintf(
+            buffer + written, bufsize - written, "cpu%u %lu 0 %lu %lu %lu 0 0\n", cpu, stat.user_ticks,
+            stat.system_ticks, stat.idle_ticks, stat.iowait_ticks);
+    }
+    // The interrupts received by all the CPUs, the total first.
+    unsigned long irqs[IRQ_NUM] = { 0 }, interrupts = 0;
+    for (unsigned int i = 0; i < IRQ_NUM; ++i) {
+        for (unsigned int cpu = 0; cpu < ncpus; ++cpu) {
+            irqs[i] += irq_get_count(cpu, i);
+        }
+        interrupts += irqs[i];
+    }
+    if (written < bufsize) {
+        written += snprintf(buffer + written, bufsize - written, "intr %lu", interrupts);
+    }
+    for (unsigned int i = 0; (i < IRQ_NUM) && (written < bufsize); ++i) {
+        written += snprintf(buffer + written, bufsize - written, " %lu", irqs[i]);
+    }
+    size_t running, blocked;
+    scheduler_get_task_counts(&running, &blocked);
+    if (written < bufsize) {
+        written += snprintf(
+            buffer + written, bufsize - written,
+            "\nctxt %lu\n"
+            "btime %lu\n"
+            "processes %lu\n"
+            "procs_running %u\n"
+            "procs_blocked %u\n",
+            total.switches, (unsigned long)(sys_time(NULL) - timer_get_seconds()), total.forks,
+            running, blocked);
+    }
+    return min(written, bufsize);
 }
 
-/// @brief Write the process statistics inside the buffer.
+/// @brief Write the I/O statistics of the block devices inside the buffer.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_diskstats(char *buffer, size_t bufsize) { return blk_stats_dump(buffer, bufsize); }
+
+/// @brief Prints the statistics of the compressed RAM disk.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of written characters.
+static ssize_t procs_do_zramstat(char *buffer, size_t bufsize) { return zram_stats_dump(buffer, bufsize); }
+
+/// @brief Prints the state of the merging of the identical pages.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the number of written characters.
+static ssize_t procs_do_ksm(char *buffer, size_t bufsize) { return ksm_stats_dump(buffer, bufsize); }
+
+/// @brief Write the free blocks of the zones, for each order, inside the buffer.
+/// @param buffer the buffer.
+/// @param bufsize the buffer size.
+/// @return the amount we wrote.
+static ssize_t procs_do_buddyinfo(char *buffer, size_t bufsize) { return zone_buddyinfo_dump(buffer, bufsize); }
+
+/// @brief Write the statistics of the slab caches inside the buffer.
 /// @param buffer the buffer.
 /// @param bufsize the buffer size.
 /// @return the amount we wrote.
-static ssize_t procs_do_stat(char *buffer, size_t bufsize) { return 0; }
+static ssize_t procs_do_slabinfo(char *buffer, size_t bufsize) { return kmem_cache_stats_dump(buffer, bufsize); }
@@ -16,11 +16,13 @@
 #include "drivers/keyboard/keymap.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/poll.h"
 #include "fs/procfs.h"
 #include "fs/vfs.h"
 #include "io/video.h"
 #include "process/scheduler.h"
 #include "sys/bitops.h"
+#include "sys/initcall.h"
 
 #define DISPLAY_CHAR(c) (iscntrl(c) ? ' ' : (c))
 #define ERASE_CHAR()      \
@@ -41,19 +43,12 @@ void rb_keybuffer_print(rb_keybuffer_t *rb)
     pr_debug("]\n");
 }
 
-/// @brief Read function for the proc video system.
-/// @param file The file.
-/// @param buf Buffer where the read content must be placed.
-/// @param offset Offset from which we start reading from the file.
-/// @param nbyte The number of bytes to read.
-/// @return The number of red bytes.
-static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+/// @brief Handles the next key pressed, following the settings of the
+/// terminal, the line discipline of the terminal.
+/// @param buf Where the character is placed, when one can be returned.
+/// @return 1 if a character was returned, 0 otherwise.
+static ssize_t __procv_getc(char *buf)
 {
-    // Stop if the buffer is invalid.
-    if (buf == NULL) {
-        return -1;
-    }
-
     // Get the currently running process.
     task_struct *process = scheduler_get_current_process();
     // Get a pointer to its keyboard ring buffer.
@@ -213,7 +208,46 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
     return 1;
 }
 
-/// @brief Writes data to the video output by sending each character from the buffer to the video output.
+/// @brief Read function for the proc video system. It sleeps until there is
+/// a character to return, then returns those which do not need to wait, up
+/// to the end of the line.
+/// @param file The file.
+/// @param buf Buffer where the read content must be placed.
+/// @param offset Offset from which we start reading from the file.
+/// @param nbyte The number of bytes to read.
+/// @return The number of red bytes, or a negative error code.
+static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+{
+    // Stop if the buffer is invalid.
+    if (buf == NULL) {
+        return -1;
+    }
+    size_t count = 0;
+    while (count < nbyte) {
+        if (__procv_getc(buf + count) == 1) {
+            if (buf[count++] == '\n') {
+                break;
+            }
+            continue;
+        }
+        // Nothing to return, until the next key is pressed.
+        if (keyboard_peek_back() >= 0) {
+            continue;
+        }
+        if (count > 0) {
+            break;
+        }
+        if (bitmask_check(file->flags, O_NONBLOCK)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on(keyboard_get_wait_queue()) < 0) {
+            return -EINTR;
+        }
+    }
+    return count;
+}
+
+/// @brief Writes data to the video output, at once.
 ///
 /// @param file Pointer to the file structure (unused).
 /// @param buf Pointer to the buffer containing the data to write.
@@ -222,9 +256,7 @@ static ssize_t procv_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyt
 /// @return ssize_t The number of bytes written.
 static ssize_t procv_write(vfs_file_t *file, const void *buf, off_t offset, size_t nbyte)
 {
-    for (size_t i = 0; i < nbyte; ++i) {
-        video_putc(((char *)buf)[i]);
-    }
+    video_write((const char *)buf, nbyte);
     return nbyte;
 }
 
@@ -250,6 +282,22 @@ static long procv_ioctl(vfs_file_t *file, unsigned int request, unsigned long da
     return 0;
 }
 
+/// @brief Reports the readiness of the terminal.
+/// @param file The file (unused).
+/// @param table The poll table, the caller waits for the next key press.
+/// @return POLLIN if there is something to read, the terminal is always writable.
+static unsigned int procv_poll(vfs_file_t *file, poll_table_t *table)
+{
+    task_struct *process = scheduler_get_current_process();
+    unsigned int mask    = POLLOUT | POLLWRNORM;
+    poll_wait(keyboard_get_wait_queue(), table);
+    // Either characters buffered by the process, or keys not yet consumed.
+    if (!rb_keybuffer_is_empty(&process->keyboard_rb) || (keyboard_peek_back() >= 0)) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    return mask;
+}
+
 /// Filesystem general operations.
 static vfs_sys_operations_t procv_sys_operations = {
     .mkdir_f   = NULL,
@@ -271,6 +319,7 @@ static vfs_file_operations_t procv_fs_operations = {
     .ioctl_f    = procv_ioctl,
     .getdents_f = NULL,
     .readlink_f = NULL,
+    .poll_f     = procv_poll,
 };
 
 int procv_module_init(void)
@@ -292,3 +341,5 @@ int procv_module_init(void)
 
     return 0;
 }
+
+fs_initcall(procv_module_init, NULL);
@@ -0,0 +1,136 @@
+/// @file vbe.c
+/// @brief Linear frame buffer of the Bochs VBE extensions (QEMU -vga std).
+/// @details
+/// The video card is a PCI device, whose first BAR is the frame buffer. The
+/// resolution is set through the display interface (dispi) registers, an index
+/// and a data port, and the frame buffer is mapped write-combining.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[VBE   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "io/vga/vbe.h"
+
+#include "devices/pci.h"
+#include "io/port_io.h"
+#include "mem/mm/vmem.h"
+
+/// @name Display interface ports
+/// @{
+#define VBE_DISPI_IOPORT_INDEX 0x01CE ///< Selects the register.
+#define VBE_DISPI_IOPORT_DATA  0x01CF ///< Reads, or writes, the selected register.
+/// @}
+
+/// @name Display interface registers
+/// @{
+#define VBE_DISPI_INDEX_ID          0x00 ///< Version of the interface.
+#define VBE_DISPI_INDEX_XRES        0x01 ///< Width of the screen.
+#define VBE_DISPI_INDEX_YRES        0x02 ///< Height of the screen.
+#define VBE_DISPI_INDEX_BPP         0x03 ///< Bits per pixel.
+#define VBE_DISPI_INDEX_ENABLE      0x04 ///< Enables the extensions.
+#define VBE_DISPI_INDEX_BANK        0x05 ///< Bank of the legacy window.
+#define VBE_DISPI_INDEX_VIRT_WIDTH  0x06 ///< Width of the frame buffer.
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x07 ///< Height of the frame buffer.
+#define VBE_DISPI_INDEX_X_OFFSET    0x08 ///< Horizontal offset of the screen inside the frame buffer.
+#define VBE_DISPI_INDEX_Y_OFFSET    0x09 ///< Vertical offset of the screen inside the frame buffer.
+/// @}
+
+/// @name Display interface values
+/// @{
+#define VBE_DISPI_ID2         0xB0C2 ///< The first version with 32 bits per pixel.
+#define VBE_DISPI_ID5         0xB0C5 ///< The last known version.
+#define VBE_DISPI_DISABLED    0x00   ///< Back to the legacy VGA.
+#define VBE_DISPI_ENABLED     0x01   ///< Use the resolution of the registers.
+#define VBE_DISPI_LFB_ENABLED 0x40   ///< Use the linear frame buffer, rather than banks.
+/// @}
+
+/// @name PCI identifiers of the cards providing the extensions
+/// @{
+#define VBE_PCI_VENDOR_QEMU  0x1234 ///< QEMU and Bochs.
+#define VBE_PCI_DEVICE_QEMU  0x1111 ///< Standard VGA.
+#define VBE_PCI_VENDOR_VBOX  0x80EE ///< VirtualBox.
+#define VBE_PCI_DEVICE_VBOX  0xBEEF ///< VirtualBox graphics adapter.
+/// @}
+
+/// @brief Writes a display interface register.
+/// @param index the register.
+/// @param value the value.
+static inline void __dispi_write(uint16_t index, uint16_t value)
+{
+    outports(VBE_DISPI_IOPORT_INDEX, index);
+    outports(VBE_DISPI_IOPORT_DATA, value);
+}
+
+/// @brief Reads a display interface register.
+/// @param index the register.
+/// @return the value.
+static inline uint16_t __dispi_read(uint16_t index)
+{
+    outports(VBE_DISPI_IOPORT_INDEX, index);
+    return inports(VBE_DISPI_IOPORT_DATA);
+}
+
+/// The video cards with the Bochs display interface.
+static const pci_device_id_t vbe_pci_ids[] = {
+    {VBE_PCI_VENDOR_QEMU, VBE_PCI_DEVICE_QEMU, PCI_TYPE_VGA},
+    {VBE_PCI_VENDOR_VBOX, VBE_PCI_DEVICE_VBOX, PCI_TYPE_VGA},
+    {0, 0, 0},
+};
+
+int vbe_initialize(unsigned width, unsigned height, vbe_framebuffer_t *fb)
+{
+    uint32_t device, bar;
+    uint16_t command;
+    // Search for the video card, we only drive the first one.
+    const pci_dev_t *pci = pci_find_device(vbe_pci_ids, NULL);
+    if (pci == NULL) {
+        pr_notice("No Bochs VBE video card found.\n");
+        return -1;
+    }
+    device = pci->device;
+    uint16_t id = __dispi_read(VBE_DISPI_INDEX_ID);
+    if ((id < VBE_DISPI_ID2) || (id > VBE_DISPI_ID5)) {
+        pr_err("Unsupported version 0x%04x of the display interface.\n", id);
+        return -1;
+    }
+    // Read the address of the frame buffer, and enable the memory space access.
+    if (pci_read_32(device, PCI_BASE_ADDRESS_0, &bar) || pci_read_16(device, PCI_COMMAND, &command) ||
+        pci_write_16(device, PCI_COMMAND, command | 0x02)) {
+        pr_err("Failed to read the configuration of the video card.\n");
+        return -1;
+    }
+    // The registers are changed while the extensions are disabled.
+    __dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED);
+    __dispi_write(VBE_DISPI_INDEX_XRES, width);
+    __dispi_write(VBE_DISPI_INDEX_YRES, height);
+    __dispi_write(VBE_DISPI_INDEX_BPP, 32);
+    __dispi_write(VBE_DISPI_INDEX_VIRT_WIDTH, width);
+    __dispi_write(VBE_DISPI_INDEX_X_OFFSET, 0);
+    __dispi_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+    __dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_ENABLED | VBE_DISPI_LFB_ENABLED);
+    // The card falls back to a smaller resolution, if it lacks the memory.
+    if ((__dispi_read(VBE_DISPI_INDEX_XRES) != width) || (__dispi_read(VBE_DISPI_INDEX_YRES) != height) ||
+        (__dispi_read(VBE_DISPI_INDEX_BPP) != 32)) {
+        pr_err("The video card refused the resolution %ux%u.\n", width, height);
+        vbe_finalize();
+        return -1;
+    }
+    fb->width   = width;
+    fb->height  = height;
+    fb->bpp     = 32;
+    fb->pitch   = __dispi_read(VBE_DISPI_INDEX_VIRT_WIDTH) * 4U;
+    fb->address = (char *)vmem_map_framebuffer(bar & ~0xFU, fb->pitch * height);
+    if (!fb->address) {
+        pr_err("Failed to map the frame buffer.\n");
+        vbe_finalize();
+        return -1;
+    }
+    pr_debug("Frame buffer of %ux%u at 0x%08x, version 0x%04x.\n", width, height, bar & ~0xFU, id);
+    return 0;
+}
+
+void vbe_finalize(void) { __dispi_write(VBE_DISPI_INDEX_ENABLE, VBE_DISPI_DISABLED); }
@@ -11,13 +11,17 @@
 
 #include "hardware/timer.h"
 #include "io/port_io.h"
+#include "io/vga/vbe.h"
 #include "io/vga/vga.h"
 #include "io/vga/vga_font.h"
 #include "io/vga/vga_mode.h"
 #include "io/vga/vga_palette.h"
 #include "io/video.h"
+#include "klib/irqflags.h"
+#include "mem/alloc/zone_allocator.h"
 #include "math.h"
 #include "stdbool.h"
+#include "stdint.h"
 #include "string.h"
 
 /// Attribute Controller index port.
@@ -53,12 +57,32 @@
 /// By reading this port it'll go to the index state.
 #define INPUT_STATUS_READ 0x03DA
 
+/// The size of the shadow of the screen, one byte per pixel of the mode.
+#if defined(VGA_MODE_320_200_256)
+#define SHADOW_SIZE (320 * 200)
+#elif defined(VGA_MODE_640_480_16)
+#define SHADOW_SIZE (640 * 480)
+#elif defined(VGA_MODE_720_480_16)
+#define SHADOW_SIZE (720 * 480)
+#else
+#define SHADOW_SIZE 1
+#endif
+
+#if defined(VGA_MODE_BOCHS_VBE)
+#ifndef VBE_WIDTH
+/// The width of the screen, with the linear frame buffer.
+#define VBE_WIDTH 1024
+#endif
+#ifndef VBE_HEIGHT
+/// The height of the screen, with the linear frame buffer.
+#define VBE_HEIGHT 768
+#endif
+#endif
+
 /// VGA pointers for drawing operations.
 typedef struct {
-    /// Writes a pixel.
-    void (*write_pixel)(int x, int y, unsigned char c);
-    /// Reads a pixel.
-    unsigned (*read_pixel)(int x, int y);
+    /// Copies a rectangle of the shadow to the video memory.
+    void (*flush)(int x0, int y0, int x1, int y1);
     /// Draws a rectangle.
     void (*draw_rect)(int x, int y, int wd, int ht, unsigned char c);
     /// Fills a rectangle.
@@ -78,6 +102,7 @@ typedef struct {
     int height;       ///< Screen's height.
     int bpp;          ///< Bits per pixel (bpp).
     char *address;    ///< Starting address of the screen.
+    unsigned pitch;   ///< Bytes between two rows of a linear frame buffer.
     vga_ops_t *ops;   ///< Writing operations.
     vga_font_t *font; ///< The current font.
 } vga_driver_t;
@@ -90,6 +115,26 @@ palette_entry_t stored_palette[256];
 char vidmem[262144];
 /// Current driver.
 static vga_driver_t *driver = NULL;
+/// Storage of the shadow, for the legacy modes.
+static unsigned char shadow_buffer[SHADOW_SIZE];
+/// Shadow of the screen, where the pixels are drawn, flushed to the video memory once per frame.
+static unsigned char *shadow = shadow_buffer;
+/// The colors of the pixels of the shadow, for a linear frame buffer.
+static uint32_t lfb_palette[256];
+/// The rectangle of the shadow changed since the last flush, from (x0, y0) included to (x1, y1) excluded.
+static struct {
+    int x0; ///< Left side.
+    int y0; ///< Top side.
+    int x1; ///< Right side.
+    int y1; ///< Bottom side.
+} dirty = {0, 0, 0, 0};
+/// A word of pixels of the shadow, which can alias its bytes.
+typedef uint32_t __attribute__((may_alias)) vga_word_t;
+/// The rows of the glyphs, expanded to one mask byte per pixel, for the current font.
+static struct {
+    const vga_font_t *font;                                 ///< The font the rows are expanded for.
+    unsigned char rows[256][8] __attribute__((aligned(4))); ///< The masks of each row of 8 bits.
+} glyph_cache = {NULL};
 
 // ============================================================================
 // == VGA MODEs ===============================================================
@@ -428,31 +473,6 @@ static inline void __write_pixel_2(int x, int y, unsigned char c)
     __write_byte(off, (__read_byte(off) & ~mask) | (c & mask));
 }
 
-/// @brief Writes a pixel.
-/// @param x x coordinates.
-/// @param y y coordinates.
-/// @param color the color.
-static inline void __write_pixel_4(int x, int y, unsigned char color)
-{
-    unsigned off;
-    unsigned mask;
-    unsigned plane;
-    unsigned pmask;
-    off   = (driver->width / 8) * y + x / 8;
-    x     = (x & 7) * 1;
-    mask  = 0x80 >> x;
-    pmask = 1;
-    for (plane = 0; plane < 4; ++plane) {
-        __set_plane(plane);
-        if (pmask & color) {
-            __write_byte(off, __read_byte(off) | mask);
-        } else {
-            __write_byte(off, __read_byte(off) & ~mask);
-        }
-        pmask <<= 1;
-    }
-}
-
 /// @brief Reads a pixel.
 /// @param x x coordinates.
 /// @param y y coordinates.
@@ -481,35 +501,91 @@ static inline unsigned __read_pixel_2(int x, int y)
     return __read_byte(off) & mask;
 }
 
-/// @brief Reads a pixel.
-/// @param x x coordinates.
-/// @param y y coordinates.
-/// @return the pixel value.
-static inline unsigned __read_pixel_4(int x, int y)
+/// @brief Copies a rectangle of the shadow to the video memory, for the 16
+/// colors modes: each plane holds one bit of the color, of 8 pixels per byte.
+/// @param x0 left side.
+/// @param y0 top side.
+/// @param x1 right side, excluded.
+/// @param y1 bottom side, excluded.
+static void __flush_4(int x0, int y0, int x1, int y1)
 {
-    int off;
-    off = (driver->width / 8) * y + x / 8;
-    return __read_byte(off);
+    static unsigned char line[720 / 8];
+    // Whole bytes are written, so that the video memory is never read.
+    unsigned first  = x0 / 8;
+    unsigned last   = (x1 + 7) / 8;
+    unsigned stride = driver->width / 8;
+    for (unsigned plane = 0; plane < 4; ++plane) {
+        __set_plane(plane);
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char *row = shadow + (y * driver->width) + (first * 8);
+            for (unsigned byte = 0; byte < (last - first); ++byte, row += 8) {
+                unsigned char bits = 0;
+                for (unsigned bit = 0; bit < 8; ++bit) {
+                    bits = (bits << 1U) | ((row[bit] >> plane) & 1U);
+                }
+                line[byte] = bits;
+            }
+            memcpy(driver->address + (y * stride) + first, line, last - first);
+        }
+    }
 }
 
-/// @brief Writes a pixel.
-/// @param x x coordinates.
-/// @param y y coordinates.
-/// @param color the color.
-static inline void __write_pixel_8(int x, int y, unsigned char color)
+/// @brief Copies a rectangle of the shadow to the video memory, for the 256
+/// colors mode: each plane holds one pixel out of four.
+/// @param x0 left side.
+/// @param y0 top side.
+/// @param x1 right side, excluded.
+/// @param y1 bottom side, excluded.
+static void __flush_8(int x0, int y0, int x1, int y1)
 {
-    __set_plane(x);
-    __write_byte(((y * driver->width) + x) / 4, color);
+    static unsigned char line[320 / 4];
+    x0 &= ~3;
+    x1 = (x1 + 3) & ~3;
+    for (unsigned plane = 0; plane < 4; ++plane) {
+        __set_plane(plane);
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char *row = shadow + (y * driver->width);
+            for (int x = x0 + plane, i = 0; x < x1; x += 4, ++i) {
+                line[i] = row[x];
+            }
+            memcpy(driver->address + (((y * driver->width) + x0) / 4), line, (x1 - x0) / 4);
+        }
+    }
 }
 
-/// @brief Reads a pixel.
-/// @param x x coordinates.
-/// @param y y coordinates.
-/// @return the pixel value.
-static inline unsigned __read_pixel_8(int x, int y)
+/// @brief Copies a rectangle of the shadow to a linear frame buffer, with 32
+/// bits per pixel, converting the colors through the palette.
+/// @param x0 left side.
+/// @param y0 top side.
+/// @param x1 right side, excluded.
+/// @param y1 bottom side, excluded.
+static void __flush_32(int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; ++y) {
+        const unsigned char *row = shadow + (y * driver->width);
+        // The stores are sequential, so that the CPU combines them.
+        volatile uint32_t *dst   = (volatile uint32_t *)(driver->address + (y * driver->pitch));
+        for (int x = x0; x < x1; ++x) {
+            dst[x] = lfb_palette[row[x]];
+        }
+    }
+}
+
+/// @brief Marks a rectangle of the shadow as changed.
+/// @param x0 left side.
+/// @param y0 top side.
+/// @param x1 right side, excluded.
+/// @param y1 bottom side, excluded.
+static inline void __mark_dirty(int x0, int y0, int x1, int y1)
 {
-    __set_plane(x);
-    return __read_byte(((y * driver->width) + x) / 4);
+    if ((dirty.x0 >= dirty.x1) || (dirty.y0 >= dirty.y1)) {
+        dirty.x0 = x0, dirty.y0 = y0, dirty.x1 = x1, dirty.y1 = y1;
+    } else {
+        dirty.x0 = min(dirty.x0, x0);
+        dirty.y0 = min(dirty.y0, y0);
+        dirty.x1 = max(dirty.x1, x1);
+        dirty.y1 = max(dirty.y1, y1);
+    }
 }
 
 // ============================================================================
@@ -534,77 +610,164 @@ int vga_height(void)
     return 0;
 }
 
-void vga_draw_pixel(int x, int y, unsigned char color) { driver->ops->write_pixel(x, y, color); }
+void vga_draw_pixel(int x, int y, unsigned char color)
+{
+    if ((x < 0) || (y < 0) || (x >= driver->width) || (y >= driver->height)) {
+        return;
+    }
+    shadow[(y * driver->width) + x] = color;
+    __mark_dirty(x, y, x + 1, y + 1);
+}
+
+unsigned int vga_read_pixel(int x, int y)
+{
+    if ((x < 0) || (y < 0) || (x >= driver->width) || (y >= driver->height)) {
+        return 0;
+    }
+    return shadow[(y * driver->width) + x];
+}
 
-unsigned int vga_read_pixel(int x, int y) { return driver->ops->read_pixel(x, y); }
+/// @brief Rebuilds the cache of the glyph rows, for the current font.
+static void __glyph_cache_update(void)
+{
+    unsigned width = driver->font->width;
+    for (unsigned bits = 0; bits < 256; ++bits) {
+        // The leftmost pixel is the highest bit of the row.
+        for (unsigned cx = 0; cx < 8; ++cx) {
+            glyph_cache.rows[bits][cx] = ((cx < width) && (bits & (1U << (width - 1 - cx)))) ? 0xFF : 0x00;
+        }
+    }
+    glyph_cache.font = driver->font;
+}
 
 void vga_draw_char(int x, int y, unsigned char c, unsigned char color)
 {
-    static unsigned mask[] = {
-        1U << 0U, //            1
-        1U << 1U, //            2
-        1U << 2U, //            4
-        1U << 3U, //            8
-        1U << 4U, //           16
-        1U << 5U, //           32
-        1U << 6U, //           64
-        1U << 7U, //          128
-        1U << 8U, //          256
-    };
-    const unsigned char *glyph = driver->font->font + (c * driver->font->height);
-    for (unsigned cy = 0; cy < driver->font->height; ++cy) {
-        for (unsigned cx = 0; cx < driver->font->width; ++cx) {
-            vga_draw_pixel(x + (driver->font->width - cx), y + cy, glyph[cy] & mask[cx] ? color : 0x00U);
+    const vga_font_t *font     = driver->font;
+    const unsigned char *glyph = font->font + (c * font->height);
+    if (glyph_cache.font != font) {
+        __glyph_cache_update();
+    }
+    // Clip the glyph to the screen.
+    int cx0 = max(0, -x), cx1 = min((int)font->width, driver->width - x);
+    int cy0 = max(0, -y), cy1 = min((int)font->height, driver->height - y);
+    if ((cx0 >= cx1) || (cy0 >= cy1)) {
+        return;
+    }
+    vga_word_t fill    = color * 0x01010101U;
+    unsigned char *row = shadow + ((y + cy0) * driver->width) + x;
+    for (int cy = cy0; cy < cy1; ++cy, row += driver->width) {
+        const unsigned char *mask = glyph_cache.rows[glyph[cy]];
+        if ((cx0 == 0) && (cx1 == 8)) {
+            // Whole rows of the 8 pixels wide fonts are written a word at a time.
+            ((vga_word_t *)row)[0] = ((const vga_word_t *)mask)[0] & fill;
+            ((vga_word_t *)row)[1] = ((const vga_word_t *)mask)[1] & fill;
+        } else {
+            for (int cx = cx0; cx < cx1; ++cx) {
+                row[cx] = mask[cx] & color;
+            }
         }
     }
+    __mark_dirty(x + cx0, y + cy0, x + cx1, y + cy1);
 }
 
 void vga_draw_string(int x, int y, const char *str, unsigned char color)
 {
-    char i = 0;
-    while (*str != '\0') {
-        vga_draw_char(x + (i * 8), y, *str, color);
-        str++;
-        i++;
+    for (int i = 0; *str != '\0'; ++str, ++i) {
+        vga_draw_char(x + (i * driver->font->width), y, *str, color);
     }
 }
 
+/// @brief Fills a rectangle of the shadow, one row at a time.
+/// @param x left side.
+/// @param y top side.
+/// @param wd width of the rectangle.
+/// @param ht height of the rectangle.
+/// @param c the color.
+static void __fill_rect(int x, int y, int wd, int ht, unsigned char c)
+{
+    int x0 = max(x, 0), x1 = min(x + wd, driver->width);
+    int y0 = max(y, 0), y1 = min(y + ht, driver->height);
+    if ((x0 >= x1) || (y0 >= y1)) {
+        return;
+    }
+    unsigned char *row = shadow + (y0 * driver->width) + x0;
+    for (int cy = y0; cy < y1; ++cy, row += driver->width) {
+        memset(row, c, x1 - x0);
+    }
+    __mark_dirty(x0, y0, x1, y1);
+}
+
+/// @brief Draws the outline of a rectangle, as two rows and two columns.
+/// @param x left side.
+/// @param y top side.
+/// @param wd width of the rectangle.
+/// @param ht height of the rectangle.
+/// @param c the color.
+static void __draw_rect(int x, int y, int wd, int ht, unsigned char c)
+{
+    __fill_rect(x, y, wd, 1, c);
+    __fill_rect(x, y + ht - 1, wd, 1, c);
+    __fill_rect(x, y, 1, ht, c);
+    __fill_rect(x + wd - 1, y, 1, ht, c);
+}
+
 void vga_draw_line(int x0, int y0, int x1, int y1, unsigned char color)
 {
+    // Rows and columns are spans.
+    if ((y0 == y1) || (x0 == x1)) {
+        driver->ops->fill_rect(min(x0, x1), min(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1, color);
+        return;
+    }
     int dx  = abs(x1 - x0);
     int sx  = sign(x1 - x0);
-    int dy  = abs(y1 - y0);
+    int dy  = -abs(y1 - y0);
     int sy  = sign(y1 - y0);
-    int err = (dx > dy ? dx : -dy) / 2;
+    int err = dx + dy;
+    // The pixels are written to the shadow directly, then marked all at once.
+    int left = min(x0, x1), top = min(y0, y1), right = max(x0, x1), bottom = max(y0, y1);
     while (true) {
-        vga_draw_pixel(x0, y0, color);
+        if ((x0 >= 0) && (y0 >= 0) && (x0 < driver->width) && (y0 < driver->height)) {
+            shadow[(y0 * driver->width) + x0] = color;
+        }
         if ((x0 == x1) && (y0 == y1)) {
             break;
         }
-        if (dx > dy) {
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
             x0 += sx;
-            err -= dy;
-            if (err < 0) {
-                err += dx;
-            }
-            y0 += sy;
-        } else {
+        }
+        if (e2 <= dx) {
+            err += dx;
             y0 += sy;
-            err -= dx;
-            if (err < 0) {
-                err += dy;
-            }
-            x0 += sx;
         }
     }
+    left = max(left, 0), top = max(top, 0);
+    right = min(right + 1, driver->width), bottom = min(bottom + 1, driver->height);
+    if ((left < right) && (top < bottom)) {
+        __mark_dirty(left, top, right, bottom);
+    }
 }
 
 void vga_draw_rectangle(int sx, int sy, int w, int h, unsigned char color)
 {
-    vga_draw_line(sx, sy, sx + w, sy, color);
-    vga_draw_line(sx, sy, sx, sy + h, color);
-    vga_draw_line(sx, sy + h, sx + w, sy + h, color);
-    vga_draw_line(sx + w, sy, sx + w, sy + h, color);
+    driver->ops->draw_rect(sx, sy, w + 1, h + 1, color);
+}
+
+void vga_fill_rectangle(int sx, int sy, int w, int h, unsigned char color)
+{
+    driver->ops->fill_rect(sx, sy, w, h, color);
+}
+
+/// @brief Writes a pixel of the shadow, without marking it as changed.
+/// @param x the x coordinate.
+/// @param y the y coordinate.
+/// @param color the color.
+static inline void __put_pixel(int x, int y, unsigned char color)
+{
+    if ((x >= 0) && (y >= 0) && (x < driver->width) && (y < driver->height)) {
+        shadow[(y * driver->width) + x] = color;
+    }
 }
 
 void vga_draw_circle(int xc, int yc, int r, unsigned char color)
@@ -612,25 +775,30 @@ void vga_draw_circle(int xc, int yc, int r, unsigned char color)
     int x = 0;
     int y = r;
     int p = 3 - (2 * r);
-    if (!r) {
+    if (r <= 0) {
         return;
     }
     while (y >= x) // only formulate 1/8 of circle
     {
-        vga_draw_pixel(xc - x, yc - y, color); //upper left left
-        vga_draw_pixel(xc - y, yc - x, color); //upper upper left
-        vga_draw_pixel(xc + y, yc - x, color); //upper upper right
-        vga_draw_pixel(xc + x, yc - y, color); //upper right right
-        vga_draw_pixel(xc - x, yc + y, color); //lower left left
-        vga_draw_pixel(xc - y, yc + x, color); //lower lower left
-        vga_draw_pixel(xc + y, yc + x, color); //lower lower right
-        vga_draw_pixel(xc + x, yc + y, color); //lower right right
+        __put_pixel(xc - x, yc - y, color); //upper left left
+        __put_pixel(xc - y, yc - x, color); //upper upper left
+        __put_pixel(xc + y, yc - x, color); //upper upper right
+        __put_pixel(xc + x, yc - y, color); //upper right right
+        __put_pixel(xc - x, yc + y, color); //lower left left
+        __put_pixel(xc - y, yc + x, color); //lower lower left
+        __put_pixel(xc + y, yc + x, color); //lower lower right
+        __put_pixel(xc + x, yc + y, color); //lower right right
         if (p < 0) {
             p += 4 * x++ + 6;
         } else {
             p += 4 * (x++ - y--) + 10;
         }
     }
+    int left = max(xc - r, 0), top = max(yc - r, 0);
+    int right = min(xc + r + 1, driver->width), bottom = min(yc + r + 1, driver->height);
+    if ((left < right) && (top < bottom)) {
+        __mark_dirty(left, top, right, bottom);
+    }
 }
 
 void vga_draw_triangle(int x1, int y1, int x2, int y2, int x3, int y3, unsigned char color)
@@ -666,26 +834,30 @@ void vga_run_test(void)
 
 /// @brief Operations for 720*480, and 16-bit color video.
 static vga_ops_t ops_720_480_16 = {
-    .write_pixel = __write_pixel_4,
-    .read_pixel  = __read_pixel_4,
-    .draw_rect   = NULL,
-    .fill_rect   = NULL,
+    .flush     = __flush_4,
+    .draw_rect = __draw_rect,
+    .fill_rect = __fill_rect,
 };
 
 /// @brief Operations for 640*480, and 16-bit color video.
 static vga_ops_t ops_640_480_16 = {
-    .write_pixel = __write_pixel_4,
-    .read_pixel  = __read_pixel_4,
-    .draw_rect   = NULL,
-    .fill_rect   = NULL,
+    .flush     = __flush_4,
+    .draw_rect = __draw_rect,
+    .fill_rect = __fill_rect,
 };
 
 /// @brief Operations for 320*200, and 256-bit color video.
 static vga_ops_t ops_320_200_256 = {
-    .write_pixel = __write_pixel_8,
-    .read_pixel  = __read_pixel_8,
-    .draw_rect   = NULL,
-    .fill_rect   = NULL,
+    .flush     = __flush_8,
+    .draw_rect = __draw_rect,
+    .fill_rect = __fill_rect,
+};
+
+/// @brief Operations for a linear frame buffer, with 32-bit color video.
+static vga_ops_t ops_lfb_32 = {
+    .flush     = __flush_32,
+    .draw_rect = __draw_rect,
+    .fill_rect = __fill_rect,
 };
 
 /// @brief 4x6 font.
@@ -750,6 +922,15 @@ static vga_driver_t driver_320_200_256 = {
     .ops     = &ops_320_200_256,
 };
 
+/// @brief Drivers for the linear frame buffer, and 32-bit color video.
+static vga_driver_t driver_lfb_32 = {
+    .width   = 0,
+    .height  = 0,
+    .bpp     = 32,
+    .address = (char *)NULL,
+    .ops     = &ops_lfb_32,
+};
+
 // == INITIALIZE and FINALIZE =================================================
 
 void vga_initialize(void)
@@ -788,7 +969,7 @@ void vga_initialize(void)
     __load_palette(ansi_16_palette, 16);
     // Set the font.
     driver->font = &font_8x16;
-#else                              // VGA_TEXT_MODE
+#else                              // VGA_TEXT_MODE, or VGA_MODE_BOCHS_VBE (see vga_initialize_vbe)
     return;
 #endif
     // Set the address.
@@ -801,8 +982,53 @@ void vga_initialize(void)
     vga_enable = true;
 }
 
+int vga_initialize_vbe(void)
+{
+#if defined(VGA_MODE_BOCHS_VBE)
+    vbe_framebuffer_t fb;
+    if (vbe_initialize(VBE_WIDTH, VBE_HEIGHT, &fb) < 0) {
+        pr_err("Failed to set up the linear frame buffer, staying in text mode.\n");
+        return -1;
+    }
+    // The shadow of the whole screen does not fit the static storage.
+    page_t *page = alloc_pages(GFP_KERNEL, find_nearest_order_greater(0, fb.width * fb.height));
+    if (!page) {
+        pr_err("Failed to allocate the shadow of the screen.\n");
+        vbe_finalize();
+        return -1;
+    }
+    shadow = (unsigned char *)get_virtual_address_from_page(page);
+    // Initialize the mode.
+    driver          = &driver_lfb_32;
+    driver->width   = fb.width;
+    driver->height  = fb.height;
+    driver->pitch   = fb.pitch;
+    driver->address = fb.address;
+    // Load the color palette.
+    for (unsigned i = 0; i < 256; ++i) {
+        palette_entry_t *entry = &ansi_256_palette[i];
+        lfb_palette[i]         = (entry->red << 16U) | (entry->green << 8U) | entry->blue;
+    }
+    // Set the font.
+    driver->font = &font_8x16;
+    // Clears the screen.
+    vga_clear_screen();
+    // Set the vga as enabled.
+    vga_enable = true;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
 void vga_finalize(void)
 {
+    if (driver == &driver_lfb_32) {
+        vbe_finalize();
+        __set_mode(&_mode_80_25_text);
+        vga_enable = false;
+        return;
+    }
     memcpy(driver->address, vidmem, 256 * 1024);
     __set_mode(&_mode_80_25_text);
     __load_palette(stored_palette, 256);
@@ -817,22 +1043,14 @@ static int _cursor_state    = 0; ///< Current state of the cursor.
 /// @brief Clears the character at the cursor.
 inline static void __vga_clear_cursor(void)
 {
-    for (unsigned cy = 0; cy < driver->font->height; ++cy) {
-        for (unsigned cx = 0; cx < driver->font->width; ++cx) {
-            vga_draw_pixel(_x + cx, _y + cy, 0);
-        }
-    }
+    driver->ops->fill_rect(_x, _y, driver->font->width, driver->font->height, 0);
 }
 
 /// @brief Draws the cursor.
 inline static void __vga_draw_cursor(void)
 {
     unsigned char color = (_cursor_state = (_cursor_state == 0)) * _color;
-    for (unsigned cy = 0; cy < driver->font->height; ++cy) {
-        for (unsigned cx = 0; cx < driver->font->width; ++cx) {
-            vga_draw_pixel(_x + cx, _y + cy, color);
-        }
-    }
+    driver->ops->fill_rect(_x, _y, driver->font->width, driver->font->height, color);
 }
 
 void vga_putc(int c)
@@ -890,12 +1108,8 @@ void vga_get_screen_size(unsigned int *width, unsigned int *height)
 
 void vga_clear_screen(void)
 {
-    unsigned original_plane = __get_plane();
-    for (unsigned plane = 0; plane < 4; ++plane) {
-        __set_plane(plane);
-        memset(driver->address, 0, 64 * 1024);
-    }
-    __set_plane(original_plane);
+    memset(shadow, 0, driver->width * driver->height);
+    __mark_dirty(0, 0, driver->width, driver->height);
     _x = 0, _y = 0;
 }
 
@@ -913,9 +1127,26 @@ void vga_new_line(void)
 
 void vga_update(void)
 {
-    if ((timer_get_ticks() % (TICKS_PER_SECOND / 2)) == 0) {
+    // The ticks might jump forward while the CPU is idle (see timer_nohz_enter),
+    // so blink once per half second elapsed, rather than on a given tick.
+    static unsigned long last_blink = 0;
+    if ((timer_get_ticks() / (TICKS_PER_SECOND / 2)) != last_blink) {
+        last_blink = timer_get_ticks() / (TICKS_PER_SECOND / 2);
         __vga_draw_cursor();
     }
+    vga_flush();
+}
+
+void vga_flush(void)
+{
+    // Pixels drawn meanwhile mark the shadow again, for the next flush.
+    uint8_t flags = irq_disable();
+    int x0 = dirty.x0, y0 = dirty.y0, x1 = dirty.x1, y1 = dirty.y1;
+    dirty.x1 = dirty.x0, dirty.y1 = dirty.y0;
+    irq_enable(flags);
+    if ((x0 < x1) && (y0 < y1)) {
+        driver->ops->flush(x0, y0, x1, y1);
+    }
 }
 
 void vga_set_color(unsigned int color) { _color = color; }
@@ -10,9 +10,14 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "ctype.h"
+#include "hardware/timer.h"
 #include "io/port_io.h"
 #include "io/vga/vga.h"
 #include "io/video.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "process/workqueue.h"
 #include "stdbool.h"
 #include "stdio.h"
 #include "string.h"
@@ -21,8 +26,12 @@
 #define WIDTH        80                   ///< The width of the
 #define W2           (WIDTH * 2)          ///< The width of the
 #define TOTAL_SIZE   (HEIGHT * WIDTH * 2) ///< The total size of the screen.
-#define ADDR         (char *)0xB8000U     ///< The address of the
+#define ADDR         shadow               ///< The shadow of the video memory, where the writes go.
+#define VIDEO_MEMORY (char *)0xB8000U     ///< The address of the video memory.
 #define STORED_PAGES 10                   ///< The number of stored pages.
+#define STORED_LINES (STORED_PAGES * HEIGHT) ///< The number of stored lines.
+#define REFRESH_HZ   60                   ///< How many times per second the video is refreshed.
+#define MAX_PARAMS   4                    ///< The number of parameters of an escape sequence.
 
 /// @brief Stores the association between ANSI colors and pure VIDEO colors.
 struct ansi_color_map {
@@ -42,16 +51,33 @@ ansi_color_map[] = {{0, 7},
 
                     {100, 8}, {101, 12}, {102, 10}, {103, 14}, {104, 9}, {105, 13}, {106, 11}, {107, 15}};
 
+/// Shadow of the video memory, with room for the line following the screen.
+static char shadow[TOTAL_SIZE + (2 * W2)];
+/// Start of the part of the shadow changed since the last flush.
+static unsigned int dirty_start = TOTAL_SIZE;
+/// End of the part of the shadow changed since the last flush.
+static unsigned int dirty_end   = 0;
+/// Set when the cursor has moved since the last flush.
+static bool_t cursor_dirty      = false;
+/// Set once the video is refreshed from the workqueue, before that the writes are flushed at once.
+static bool_t refresh_started   = false;
+/// Set while a refresh is due.
+static bool_t refresh_armed     = false;
+
 /// Pointer to a position of the screen writer.
 char *pointer       = ADDR;
 /// The current color.
 unsigned char color = 7;
-/// Used to write on the escape_buffer. If -1, we are not parsing an escape sequence.
+/// The parameter of the escape sequence being parsed. If -1, we are not parsing an escape sequence.
 int escape_index    = -1;
-/// Used to store an escape sequence.
-char escape_buffer[256];
-/// Buffer where we store the upper scroll history.
+/// Set once the bracket following the escape character (the CSI) is received.
+bool_t escape_csi   = false;
+/// The numeric parameters of the escape sequence.
+unsigned int escape_params[MAX_PARAMS];
+/// Circular buffer where we store the upper scroll history, one line per slot.
 char upper_buffer[STORED_PAGES * TOTAL_SIZE] = {0};
+/// The slot of the oldest line of the upper buffer, where the next line is stored.
+unsigned int upper_head                      = 0;
 /// Buffer where we store the lower scroll history.
 char original_page[TOTAL_SIZE]               = {0};
 /// Determines the screen is currently scrolled, and by how many lines.
@@ -65,21 +91,45 @@ static inline unsigned __get_x(void) { return ((pointer - ADDR) % (WIDTH * 2)) /
 /// @return The row number.
 static inline unsigned __get_y(void) { return (pointer - ADDR) / (WIDTH * 2); }
 
-/// @brief Draws the given character.
-/// @param c The character to draw.
-static inline void __draw_char(char c)
+static void __video_refresh_request(void);
+
+/// @brief Marks a part of the screen as changed, to be flushed.
+/// @param from The first byte changed.
+/// @param to The byte following the last one changed.
+static inline void __mark_dirty(const char *from, const char *to)
+{
+    unsigned int start = min((unsigned int)(from - ADDR), TOTAL_SIZE);
+    unsigned int end   = min((unsigned int)(to - ADDR), TOTAL_SIZE);
+    dirty_start        = min(dirty_start, start);
+    dirty_end          = max(dirty_end, end);
+    __video_refresh_request();
+}
+
+/// @brief Draws the given characters, which must fit the current line.
+/// @param str The characters to draw.
+/// @param count How many characters.
+static inline void __draw_run(const char *str, size_t count)
 {
     if (scrolled_lines) {
         video_scroll_up(scrolled_lines);
     }
-    for (char *ptr = (ADDR + TOTAL_SIZE + (WIDTH * 2)); ptr > pointer; ptr -= 2) {
-        *(ptr)     = *(ptr - 2);
-        *(ptr + 1) = *(ptr - 1);
+    // The characters following them are moved forward at once, those moved
+    // past the line following the screen are lost.
+    char *end = ADDR + TOTAL_SIZE + W2 + 2;
+    __mark_dirty(pointer, ADDR + TOTAL_SIZE);
+    if ((pointer + (2 * count)) < end) {
+        memmove(pointer + (2 * count), pointer, end - (pointer + (2 * count)));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        *(pointer++) = str[i];
+        *(pointer++) = color;
     }
-    *(pointer++) = c;
-    *(pointer++) = color;
 }
 
+/// @brief Draws the given character.
+/// @param c The character to draw.
+static inline void __draw_char(char c) { __draw_run(&c, 1); }
+
 /// @brief Hides the VGA cursor.
 void __video_hide_cursor(void)
 {
@@ -176,6 +226,7 @@ static inline void __move_cursor_backward(int erase, int amount)
         pointer -= 2;
         if (erase) {
             strcpy(pointer, pointer + 2);
+            __mark_dirty(pointer, ADDR + TOTAL_SIZE);
         }
     }
     video_update_cursor_position();
@@ -233,78 +284,173 @@ void video_init(void)
     __parse_cursor_escape_code(0);
 }
 
+/// @brief Copies the part of the shadow changed since the last flush to the
+/// video memory, in aligned words, and moves the cursor.
+static void __video_flush_text(void)
+{
+    // Writes made meanwhile mark the shadow again, for the next flush.
+    uint8_t flags      = irq_disable();
+    unsigned int start = dirty_start & ~3U;
+    unsigned int end   = (dirty_end + 3U) & ~3U;
+    bool_t cursor      = cursor_dirty;
+    dirty_start        = TOTAL_SIZE;
+    dirty_end          = 0;
+    cursor_dirty       = false;
+    irq_enable(flags);
+    if (start < end) {
+        memcpy(VIDEO_MEMORY + start, ADDR + start, end - start);
+    }
+    if (cursor) {
+        __video_set_cursor_position(((pointer - ADDR) / 2U) % WIDTH, ((pointer - ADDR) / 2U) / WIDTH);
+    }
+}
+
 void video_update(void)
 {
 #ifndef VGA_TEXT_MODE
     if (vga_is_enabled()) {
         vga_update();
+        return;
     }
 #endif
+    __video_flush_text();
 }
 
-void video_putc(int c)
+void video_flush(void)
+{
+#ifndef VGA_TEXT_MODE
+    if (vga_is_enabled()) {
+        vga_flush();
+        return;
+    }
+#endif
+    __video_flush_text();
+}
+
+/// Refreshes the video from the worker.
+static work_struct_t refresh_work;
+
+/// @brief Refreshes the video, outside of interrupt context.
+/// @param work the work.
+static void video_refresh_work(work_struct_t *work) { video_update(); }
+
+static void video_refresh_arm(void);
+
+/// @brief Called periodically by the timer, it asks the worker to refresh the video.
+/// @param data unused.
+static void video_refresh_timeout(unsigned long data)
+{
+    refresh_armed = false;
+    schedule_work(&refresh_work);
+    // The cursor blinks in graphic mode, otherwise the next refresh waits
+    // for the screen to change, so that an idle CPU is not woken up.
+#ifndef VGA_TEXT_MODE
+    if (vga_is_enabled()) {
+        // Restart the timer, the old one is going to be deleted.
+        __video_refresh_request();
+    }
+#endif
+}
+
+/// @brief Starts the timer which periodically asks for a refresh.
+static void video_refresh_arm(void)
+{
+    struct timer_list *timer = kmalloc(sizeof(struct timer_list));
+    if (!timer) {
+        pr_err("Failed to allocate the refresh timer.\n");
+        return;
+    }
+    memset(timer, 0, sizeof(struct timer_list));
+    init_timer(timer);
+    timer->expires  = timer_get_ticks() + (TICKS_PER_SECOND / REFRESH_HZ);
+    timer->function = &video_refresh_timeout;
+    timer->data     = 0;
+    add_timer(timer);
+}
+
+/// @brief Asks for a refresh of the video, unless one is already due.
+static void __video_refresh_request(void)
+{
+    if (refresh_started && !refresh_armed) {
+        refresh_armed = true;
+        video_refresh_arm();
+    }
+}
+
+void video_start_refresh(void)
+{
+    init_work(&refresh_work, video_refresh_work);
+    refresh_started = true;
+    __video_refresh_request();
+}
+
+/// @brief Runs the escape sequence, once its final letter is received.
+/// @param c The final letter of the sequence.
+static inline void __video_escape(int c)
+{
+    // The parameters which were not given are 0.
+    unsigned int param = escape_params[0];
+    // Move cursor forward (e.g., ESC [ <num> C)
+    if (c == 'C') {
+        __move_cursor_forward(false, param);
+    }
+    // Move cursor backward (e.g., ESC [ <num> D)
+    else if (c == 'D') {
+        __move_cursor_backward(false, param);
+    }
+    // Set color (e.g., ESC [ <num> ; <num> m)
+    else if (c == 'm') {
+        for (int i = 0; i <= escape_index; ++i) {
+            __set_color(escape_params[i]);
+        }
+    }
+    // Clear screen (e.g., ESC [ <num> J)
+    else if (c == 'J') {
+        video_clear();
+    }
+    // Move the cursor (e.g., ESC [ <row> ; <column> H)
+    else if (c == 'H') {
+        if (escape_index > 0) {
+            pointer = ADDR + ((escape_params[0] - 1) * WIDTH * 2 + (escape_params[1] - 1) * 2);
+        } else {
+            pointer = ADDR;
+        }
+        video_update_cursor_position();
+    }
+    // Handle cursor shape (e.g., ESC [ <num> q)
+    else if (c == 'q') {
+        __parse_cursor_escape_code(param);
+    }
+    // Custom command for scrolling up.
+    else if (c == 'S') {
+        video_scroll_down(param);
+    }
+    // Custom command for scrolling down.
+    else if (c == 'T') {
+        video_scroll_up(param);
+    }
+}
+
+/// @brief Prints the given character inside the shadow of the screen.
+/// @param c The character to print.
+static void __video_putc(int c)
 {
-    // ESCAPE SEQUENCES
+    // ESCAPE SEQUENCES, whose parameters are accumulated as the digits arrive.
     if (c == '\033') {
+        memset(escape_params, 0, sizeof(escape_params));
         escape_index = 0;
+        escape_csi   = false;
         return;
     }
     if (escape_index >= 0) {
-        if ((escape_index == 0) && (c == '[')) {
-            return;
-        }
-        escape_buffer[escape_index++] = c;
-        escape_buffer[escape_index]   = 0;
-        if (isalpha(c)) {
-            escape_buffer[--escape_index] = 0;
-
-            // Move cursor forward (e.g., ESC [ <num> C)
-            if (c == 'C') {
-                __move_cursor_forward(false, atoi(escape_buffer));
-            }
-            // Move cursor backward (e.g., ESC [ <num> D)
-            else if (c == 'D') {
-                __move_cursor_backward(false, atoi(escape_buffer));
-            }
-            // Set color (e.g., ESC [ <num> m)
-            else if (c == 'm') {
-                __set_color(atoi(escape_buffer));
-            }
-            // Clear screen (e.g., ESC [ <num> J)
-            else if (c == 'J') {
-                video_clear();
-            }
-            // Clear screen (e.g., ESC [ <num> J)
-            else if (c == 'H') {
-                char *semicolon = strchr(escape_buffer, ';');
-                if (semicolon != NULL) {
-                    *semicolon     = '\0';
-                    unsigned int y = atoi(escape_buffer);
-                    unsigned int x = atoi(semicolon + 1);
-                    pointer        = ADDR + ((y - 1) * WIDTH * 2 + (x - 1) * 2);
-                } else {
-                    pointer = ADDR;
-                }
-                video_update_cursor_position();
-            }
-            // Handle cursor shape (e.g., ESC [ <num> q)
-            else if (c == 'q') {
-                __parse_cursor_escape_code(atoi(escape_buffer));
-            }
-            // Custom command for scrolling up.
-            else if (c == 'S') {
-                int lines_to_scroll = atoi(escape_buffer);
-                video_scroll_down(lines_to_scroll);
-                escape_index = -1;
-                return;
-            }
-            // Custom command for scrolling down.
-            else if (c == 'T') {
-                int lines_to_scroll = atoi(escape_buffer);
-                video_scroll_up(lines_to_scroll);
-                escape_index = -1;
-                return;
-            }
+        if ((c == '[') && !escape_csi) {
+            escape_csi = true;
+        } else if (isdigit(c)) {
+            escape_params[escape_index] = (escape_params[escape_index] * 10) + (c - '0');
+        } else if (c == ';') {
+            escape_index = min(escape_index + 1, MAX_PARAMS - 1);
+        } else if (isalpha(c)) {
+            __video_escape(c);
             escape_index = -1;
         }
         return;
@@ -328,6 +474,7 @@ void video_putc(int c)
         video_cartridge_return();
     } else if (c == 127) {
         strcpy(pointer, pointer + 2);
+        __mark_dirty(pointer, ADDR + TOTAL_SIZE);
     } else if ((c >= 0x20) && (c <= 0x7E)) {
         __draw_char(c);
     } else {
@@ -338,16 +485,40 @@ void video_putc(int c)
     video_update_cursor_position();
 }
 
-void video_puts(const char *str)
+void video_putc(int c)
 {
-#ifndef VGA_TEXT_MODE
-    if (vga_is_enabled()) {
-        vga_puts(str);
-        return;
+    __video_putc(c);
+    if (!refresh_started) {
+        video_flush();
     }
-#endif
-    while ((*str) != 0) {
-        video_putc((*str++));
+}
+
+void video_puts(const char *str) { video_write(str, strlen(str)); }
+
+void video_write(const char *buf, size_t size)
+{
+    const char *end = buf + size;
+    while (buf < end) {
+        size_t count = 0;
+        // Runs of printable characters, up to the end of the line, are drawn
+        // at once in text mode.
+        if ((escape_index < 0) && !vga_is_enabled()) {
+            size_t room = (W2 - ((pointer - ADDR) % W2)) / 2;
+            while ((count < room) && (buf + count < end) && (buf[count] >= 0x20) && (buf[count] <= 0x7E)) {
+                ++count;
+            }
+        }
+        if (count > 0) {
+            __draw_run(buf, count);
+            video_shift_one_line_up();
+            video_update_cursor_position();
+            buf += count;
+        } else {
+            __video_putc(*(buf++));
+        }
+    }
+    if (!refresh_started) {
+        video_flush();
     }
 }
 
@@ -358,7 +529,9 @@ void video_update_cursor_position(void)
         return;
     }
 #endif
-    __video_set_cursor_position(((pointer - ADDR) / 2U) % WIDTH, ((pointer - ADDR) / 2U) / WIDTH);
+    // The cursor is moved by the next flush.
+    cursor_dirty = true;
+    __video_refresh_request();
 }
 
 void video_move_cursor(unsigned int x, unsigned int y)
@@ -414,7 +587,9 @@ void video_clear(void)
     }
 #endif
     memset(upper_buffer, 0, STORED_PAGES * TOTAL_SIZE);
+    upper_head = 0;
     memset(ADDR, 0, TOTAL_SIZE);
+    __mark_dirty(ADDR, ADDR + TOTAL_SIZE);
 }
 
 void video_new_line(void)
@@ -464,90 +639,81 @@ static inline void __shift_buffer(char *buffer, int lines, int direction)
     }
 }
 
-/// @brief Shifts the screen content up by one line. When not scrolled, moves
-/// the top line into the `upper_buffer`.
+/// @brief Returns a line of the upper scroll history.
+/// @param back How many lines back, 1 being the last line stored.
+/// @return Pointer to the line inside the `upper_buffer`.
+static inline char *__upper_line(int back)
+{
+    return upper_buffer + (W2 * ((upper_head + STORED_LINES - back) % STORED_LINES));
+}
+
+/// @brief Shifts the screen content up by one line, moving the top line into
+/// the `upper_buffer`, in place of the oldest one.
 static void __shift_screen_up(void)
 {
-    if (scrolled_lines == 0) {
-        // Move the upper buffer up by one line.
-        __shift_buffer(upper_buffer, STORED_PAGES * HEIGHT, +1);
-        // Copy the first line on the screen inside the last line of the upper buffer.
-        memcpy(upper_buffer + (TOTAL_SIZE * STORED_PAGES - W2), ADDR, W2);
-    }
+    memcpy(upper_buffer + (W2 * upper_head), ADDR, W2);
+    upper_head = (upper_head + 1) % STORED_LINES;
     // Move the screen up by one line.
     __shift_buffer(ADDR, HEIGHT + 1, +1);
+    __mark_dirty(ADDR, ADDR + TOTAL_SIZE);
 }
 
-/// @brief Shifts the screen content down by one line. Restores the topmost line
-/// from the `upper_buffer`.
-static void __shift_screen_down(void)
+/// @brief Draws the visible window, `scrolled_lines` back: the lines of the
+/// `upper_buffer` on top, followed by those of the `original_page`.
+static void __draw_window(void)
 {
-    // Move the screen content down by one line.
-    __shift_buffer(ADDR, HEIGHT, -1);
-    // Restore from the `upper_buffer`.
-    memcpy(ADDR, upper_buffer + (W2 * (STORED_PAGES * HEIGHT - scrolled_lines)), W2);
+    for (int row = 0; row < HEIGHT; ++row) {
+        int back = scrolled_lines - row;
+        if (back > 0) {
+            memcpy(ADDR + (W2 * row), __upper_line(back), W2);
+        } else {
+            memcpy(ADDR + (W2 * row), original_page + (W2 * -back), W2);
+        }
+    }
+    __mark_dirty(ADDR, ADDR + TOTAL_SIZE);
 }
 
 void video_shift_one_line_up(void)
 {
     // Push the top screen line into the upper buffer and shift the screen up.
     if (pointer >= ADDR + TOTAL_SIZE) {
-        // Shift the upper buffer up.
+        // The lines are stored from the bottom of the history.
+        video_scroll_up(scrolled_lines);
+        // Store the top line, and shift the screen up.
         __shift_screen_up();
         // Update the pointer.
         pointer = ADDR + ((pointer - ADDR) / W2 - 1) * W2;
     }
-    // Restore the bottom line from the original content or clear it.
+    // Restore the bottom line from the original content.
     else if (scrolled_lines) {
-        // Shift the upper buffer up.
-        __shift_screen_up();
-        // Restore or clear the bottom line.
-        memcpy(ADDR + (W2 * (HEIGHT - 1)), original_page + (W2 * (TOTAL_SIZE / W2 - scrolled_lines)), W2);
-        // Decrement scrolled_lines since we're restoring content.
-        --scrolled_lines;
+        video_scroll_up(1);
     }
 }
 
-void video_shift_one_line_down(void)
-{
-    if (scrolled_lines < (STORED_PAGES * HEIGHT)) {
-        // Save the current screen into `original_page` if starting to scroll.
-        if (scrolled_lines == 0) {
-            memcpy(original_page, ADDR, TOTAL_SIZE);
-        }
-        // Increment scrolled_lines and shift the screen content down.
-        ++scrolled_lines;
-        // Shift the screen content down.
-        __shift_screen_down();
-        // Restore the top line from the scrollback buffer or original content.
-        memcpy(ADDR, upper_buffer + (W2 * (STORED_PAGES * HEIGHT - scrolled_lines)), W2);
-    }
-}
+void video_shift_one_line_down(void) { video_scroll_down(1); }
 
-void video_shift_one_page_up(void)
-{
-    for (int i = 0; i < HEIGHT; ++i) {
-        video_shift_one_line_up();
-    }
-}
+void video_shift_one_page_up(void) { video_scroll_up(HEIGHT); }
 
-void video_shift_one_page_down(void)
-{
-    for (int i = 0; i < HEIGHT; ++i) {
-        video_shift_one_line_down();
-    }
-}
+void video_shift_one_page_down(void) { video_scroll_down(HEIGHT); }
 
 void video_scroll_up(int lines)
 {
-    for (int i = 0; i < lines; ++i) {
-        video_shift_one_line_up();
+    if ((lines <= 0) || (scrolled_lines == 0)) {
+        return;
     }
+    scrolled_lines = (lines < scrolled_lines) ? (scrolled_lines - lines) : 0;
+    __draw_window();
 }
 
 void video_scroll_down(int lines)
 {
-    for (int i = 0; i < lines; ++i) {
-        video_shift_one_line_down();
+    if ((lines <= 0) || (scrolled_lines == STORED_LINES)) {
+        return;
+    }
+    // Save the current screen into `original_page` if starting to scroll.
+    if (scrolled_lines == 0) {
+        memcpy(original_page, ADDR, TOTAL_SIZE);
     }
+    scrolled_lines = (lines < (STORED_LINES - scrolled_lines)) ? (scrolled_lines + lines) : STORED_LINES;
+    __draw_window();
 }
@@ -0,0 +1,349 @@
+/// @file futex.c
+/// @brief Fast user-space locking.
+/// @details
+/// User space takes and releases its locks with atomic operations on a word
+/// of memory, and enters the kernel only to sleep while the lock is busy, or
+/// to wake up the tasks sleeping on it. Words are identified by their
+/// physical address, so that processes attaching the same shared memory
+/// agree on them. The waiters are kept inside a small hash table, each one
+/// on the kernel stack of its task. The priority-inheritance words hold the
+/// thread id of their owner, which inherits the priority of the waiters, and
+/// hands the word over to the one coming first when it unlocks it.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[FUTEX ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "sys/futex.h"
+
+#include "errno.h"
+#include "hardware/timer.h"
+#include "list_head.h"
+#include "mem/alloc/slab.h"
+#include "mem/mm/vm_area.h"
+#include "mem/paging.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "system/signal.h"
+#include "system/syscall.h"
+
+/// The number of buckets of the hash table of the waiters.
+#define FUTEX_HASH_SIZE 64
+
+/// @brief A task sleeping on a futex.
+typedef struct futex_waiter {
+    /// The physical address of the word.
+    uint32_t key;
+    /// The sleeping task.
+    task_struct *task;
+    /// If the task has been woken up by FUTEX_WAKE.
+    bool_t woken;
+    /// If the timeout of the task has expired.
+    bool_t timed_out;
+    /// The timer of the timeout, NULL once it has expired.
+    struct timer_list *timer;
+    /// Used to place the waiter inside its bucket.
+    list_head_t list;
+} futex_waiter_t;
+
+/// The waiters, hashed by the physical address of their word.
+static list_head_t futex_buckets[FUTEX_HASH_SIZE];
+/// If the buckets have been initialized.
+static bool_t futex_initialized = false;
+
+/// @brief Returns the bucket of a word.
+/// @param key the physical address of the word.
+/// @return the bucket.
+static inline list_head_t *__futex_bucket(uint32_t key)
+{
+    if (!futex_initialized) {
+        for (int i = 0; i < FUTEX_HASH_SIZE; ++i) {
+            list_head_init(&futex_buckets[i]);
+        }
+        futex_initialized = true;
+    }
+    return &futex_buckets[(key >> 2) % FUTEX_HASH_SIZE];
+}
+
+/// @brief Computes the physical address of a word of the current task.
+/// @param task the current task.
+/// @param uaddr the word.
+/// @param key where the physical address is stored.
+/// @return 0 on success, -EINVAL if the word is not aligned, -EFAULT if it is not mapped.
+static int __futex_get_key(task_struct *task, int *uaddr, uint32_t *key)
+{
+    uint32_t addr = (uint32_t)uaddr;
+    if (addr & (sizeof(int) - 1)) {
+        return -EINVAL;
+    }
+    if (addr >= PROCAREA_END_ADDR) {
+        return -EFAULT;
+    }
+    // Attached shared memory is mapped straight into the page table, the
+    // other words must belong to one of the memory areas of the task.
+    page_table_entry_t *entry = mem_virtual_to_entry(task->mm->pgd, addr);
+    if (!entry || !entry->present || !entry->user) {
+        vm_area_struct_t *area = vm_area_lookup(task->mm, addr);
+        if (!area || (area->vm_start > addr) || ((addr + sizeof(int)) > area->vm_end)) {
+            return -EFAULT;
+        }
+        // Large pages have no page table entry.
+        if (area->vm_page_prot & MM_HUGE) {
+            *key = get_physical_address_from_page(mem_virtual_to_page(task->mm->pgd, addr, NULL)) +
+                   (addr & (PAGE_SIZE - 1));
+            return 0;
+        }
+        // Fault the page in, areas are populated on demand.
+        (void)READ_ONCE(*uaddr);
+        entry = mem_virtual_to_entry(task->mm->pgd, addr);
+        if (!entry || !entry->present) {
+            return -EFAULT;
+        }
+    }
+    *key = (entry->frame << PAGE_SHIFT) + (addr & (PAGE_SIZE - 1));
+    return 0;
+}
+
+/// @brief Wakes up a waiter whose timeout has expired.
+/// @param data the waiter.
+static void __futex_timeout(unsigned long data)
+{
+    futex_waiter_t *waiter = (futex_waiter_t *)data;
+    // The timer is freed by the timer subsystem, once this function returns.
+    waiter->timer     = NULL;
+    waiter->timed_out = true;
+    if ((waiter->task->state == TASK_INTERRUPTIBLE) || (waiter->task->state == TASK_UNINTERRUPTIBLE)) {
+        scheduler_wake_up_task(waiter->task, TASK_RUNNING);
+    }
+}
+
+/// @brief Converts a timeout to timer ticks, rounding up.
+/// @param timeout the timeout.
+/// @return the number of ticks, at least one.
+static inline unsigned long __futex_timespec_to_ticks(const struct timespec *timeout)
+{
+    unsigned long ticks = (timeout->tv_sec * TICKS_PER_SECOND) +
+                          ((timeout->tv_nsec + (1000000000 / TICKS_PER_SECOND) - 1) / (1000000000 / TICKS_PER_SECOND));
+    return ticks ? ticks : 1;
+}
+
+/// @brief Checks that a timeout is valid.
+/// @param timeout the timeout, NULL to sleep until woken up.
+/// @return 0 if it is valid, -EINVAL otherwise.
+static inline int __futex_check_timeout(const struct timespec *timeout)
+{
+    if (timeout && ((timeout->tv_sec < 0) || (timeout->tv_nsec < 0) || (timeout->tv_nsec >= 1000000000))) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/// @brief Places a waiter inside the bucket of its word, and sleeps until it
+///        is woken up, its timeout expires, or a signal arrives.
+/// @param waiter the waiter, whose key and task are set.
+/// @param timeout the maximum time to sleep, NULL to sleep until woken up.
+/// @return 0 once woken up, or a negative error code.
+static int __futex_sleep(futex_waiter_t *waiter, const struct timespec *timeout)
+{
+    waiter->woken     = false;
+    waiter->timed_out = false;
+    waiter->timer     = NULL;
+    list_head_insert_before(&waiter->list, __futex_bucket(waiter->key));
+    if (timeout) {
+        waiter->timer = kmalloc(sizeof(struct timer_list));
+        if (!waiter->timer) {
+            list_head_remove(&waiter->list);
+            return -ENOMEM;
+        }
+        memset(waiter->timer, 0, sizeof(struct timer_list));
+        init_timer(waiter->timer);
+        waiter->timer->expires  = timer_get_ticks() + __futex_timespec_to_ticks(timeout);
+        waiter->timer->function = &__futex_timeout;
+        waiter->timer->data     = (unsigned long)waiter;
+        add_timer(waiter->timer);
+    }
+    // Give the CPU to the other processes, until we are woken up.
+    waiter->task->state = TASK_INTERRUPTIBLE;
+    schedule();
+    // Waking up removes the waiter from the bucket, signals and timeouts do not.
+    if (!waiter->woken) {
+        list_head_remove(&waiter->list);
+    }
+    if (waiter->timer) {
+        remove_timer(waiter->timer);
+        kfree(waiter->timer);
+    }
+    if (waiter->woken) {
+        return 0;
+    }
+    if (waiter->timed_out) {
+        return -ETIMEDOUT;
+    }
+    return signal_pending(waiter->task) ? -EINTR : 0;
+}
+
+/// @brief Sleeps while a word holds the expected value.
+/// @param task the current task.
+/// @param uaddr the word.
+/// @param val the expected value.
+/// @param timeout the maximum time to sleep, NULL to sleep until woken up.
+/// @return 0 once woken up, or a negative error code.
+static int __futex_wait(task_struct *task, int *uaddr, int val, const struct timespec *timeout)
+{
+    futex_waiter_t waiter;
+    int ret = __futex_check_timeout(timeout);
+    if ((ret < 0) || ((ret = __futex_get_key(task, uaddr, &waiter.key)) < 0)) {
+        return ret;
+    }
+    // The kernel is not preempted: nobody can change the word, and wake us
+    // up, between this check and the moment we are inside the bucket.
+    if (*uaddr != val) {
+        return -EAGAIN;
+    }
+    if (signal_pending(task)) {
+        return -EINTR;
+    }
+    waiter.task = task;
+    return __futex_sleep(&waiter, timeout);
+}
+
+/// @brief Wakes up the tasks sleeping on a word.
+/// @param task the current task.
+/// @param uaddr the word.
+/// @param val the maximum number of tasks to wake up.
+/// @return the number of woken up tasks, or a negative error code.
+static int __futex_wake(task_struct *task, int *uaddr, int val)
+{
+    uint32_t key;
+    int ret = __futex_get_key(task, uaddr, &key);
+    if (ret < 0) {
+        return ret;
+    }
+    int woken = 0;
+    list_for_each_safe_decl(it, store, __futex_bucket(key))
+    {
+        if (woken >= val) {
+            break;
+        }
+        futex_waiter_t *waiter = list_entry(it, futex_waiter_t, list);
+        if (waiter->key != key) {
+            continue;
+        }
+        // The waiters are woken up in the order they went to sleep.
+        list_head_remove(&waiter->list);
+        waiter->woken = true;
+        if ((waiter->task->state == TASK_INTERRUPTIBLE) || (waiter->task->state == TASK_UNINTERRUPTIBLE)) {
+            scheduler_wake_up_task(waiter->task, TASK_RUNNING);
+        }
+        ++woken;
+    }
+    return woken;
+}
+
+/// @brief Locks a priority-inheritance word, holding the thread id of its
+///        owner, sleeping while it is busy: the owner inherits the priority
+///        of the caller meanwhile, and hands the word over when it unlocks it.
+/// @param task the current task.
+/// @param uaddr the word.
+/// @param timeout the maximum time to sleep, NULL to sleep until the word is ours.
+/// @return 0 once the word is ours, or a negative error code.
+static int __futex_lock_pi(task_struct *task, int *uaddr, const struct timespec *timeout)
+{
+    futex_waiter_t waiter;
+    int ret = __futex_check_timeout(timeout);
+    if ((ret < 0) || ((ret = __futex_get_key(task, uaddr, &waiter.key)) < 0)) {
+        return ret;
+    }
+    uint32_t word = (uint32_t)*uaddr;
+    pid_t tid     = (pid_t)(word & FUTEX_TID_MASK);
+    // The word has been released before we entered the kernel.
+    if (tid == 0) {
+        *uaddr = task->pid | (word & FUTEX_WAITERS);
+        return 0;
+    }
+    if (tid == task->pid) {
+        return -EDEADLK;
+    }
+    // The owner must be alive, or nobody would ever hand the word over.
+    task_struct *owner = scheduler_get_running_process(tid);
+    if (!owner || (owner->state == EXIT_ZOMBIE)) {
+        return -ESRCH;
+    }
+    if (signal_pending(task)) {
+        return -EINTR;
+    }
+    // Tell the owner to enter the kernel to unlock the word.
+    *uaddr      = (int)(word | FUTEX_WAITERS);
+    waiter.task = task;
+    scheduler_pi_wait(task, owner, waiter.key);
+    ret = __futex_sleep(&waiter, timeout);
+    // FUTEX_UNLOCK_PI hands the word over, and stops us from waiting.
+    if (!waiter.woken) {
+        scheduler_pi_cancel(task);
+    }
+    return ret;
+}
+
+/// @brief Unlocks a priority-inheritance word, handing it over to the waiter
+///        coming first, if any.
+/// @param task the current task.
+/// @param uaddr the word.
+/// @return 0 on success, or a negative error code.
+static int __futex_unlock_pi(task_struct *task, int *uaddr)
+{
+    uint32_t key;
+    int ret = __futex_get_key(task, uaddr, &key);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((pid_t)((uint32_t)*uaddr & FUTEX_TID_MASK) != task->pid) {
+        return -EPERM;
+    }
+    futex_waiter_t *next = NULL;
+    unsigned waiters     = 0;
+    list_for_each_decl (it, __futex_bucket(key)) {
+        futex_waiter_t *waiter = list_entry(it, futex_waiter_t, list);
+        if (waiter->key != key) {
+            continue;
+        }
+        if (!next || scheduler_pi_precedes(waiter->task, next->task)) {
+            next = waiter;
+        }
+        ++waiters;
+    }
+    if (!next) {
+        *uaddr = 0;
+        scheduler_pi_handover(task, NULL, key);
+        return 0;
+    }
+    // The word passes to the waiter, still telling if others are left.
+    list_head_remove(&next->list);
+    next->woken = true;
+    *uaddr      = (int)((uint32_t)next->task->pid | ((waiters > 1) ? FUTEX_WAITERS : 0));
+    scheduler_pi_handover(task, next->task, key);
+    if ((next->task->state == TASK_INTERRUPTIBLE) || (next->task->state == TASK_UNINTERRUPTIBLE)) {
+        scheduler_wake_up_task(next->task, TASK_RUNNING);
+    }
+    return 0;
+}
+
+long sys_futex(int *uaddr, int futex_op, int val, const struct timespec *timeout)
+{
+    task_struct *task = scheduler_get_current_process();
+    switch (futex_op & ~FUTEX_PRIVATE_FLAG) {
+    case FUTEX_WAIT:
+        return __futex_wait(task, uaddr, val, timeout);
+    case FUTEX_WAKE:
+        return (val < 0) ? -EINVAL : __futex_wake(task, uaddr, val);
+    case FUTEX_LOCK_PI:
+        return __futex_lock_pi(task, uaddr, timeout);
+    case FUTEX_UNLOCK_PI:
+        return __futex_unlock_pi(task, uaddr);
+    default:
+        return -ENOSYS;
+    }
+}
@@ -6,8 +6,10 @@
 #include "ipc/ipc.h"
 
 #include "assert.h"
+#include "errno.h"
 #include "fcntl.h"
 #include "io/debug.h"
+#include "limits.h"
 #include "process/scheduler.h"
 #include "sys/stat.h"
 
@@ -101,3 +103,80 @@ struct ipc_perm register_ipc(key_t key, mode_t mode)
     ip.__seq = 0;
     return ip;
 }
+
+/// @brief Returns the bucket of the hash table of the keys of a namespace.
+/// @param ns The namespace.
+/// @param key The key.
+/// @return The bucket.
+static inline list_head_t *__ipc_key_bucket(ipc_namespace_t *ns, key_t key)
+{
+    return &ns->keys[(unsigned int)key % IPC_KEY_BUCKETS];
+}
+
+void ipc_namespace_init(ipc_namespace_t *ns)
+{
+    for (int i = 0; i < IPC_MAX_OBJECTS; ++i) {
+        ns->objects[i] = NULL;
+    }
+    for (int i = 0; i < IPC_KEY_BUCKETS; ++i) {
+        list_head_init(&ns->keys[i]);
+    }
+    ns->sequence = 0;
+}
+
+int ipc_namespace_add(ipc_namespace_t *ns, ipc_object_t *object, key_t key)
+{
+    for (int slot = 0; slot < IPC_MAX_OBJECTS; ++slot) {
+        if (ns->objects[slot]) {
+            continue;
+        }
+        // The ids start from IPC_MAX_OBJECTS, and stay positive.
+        ns->sequence      = (ns->sequence % ((INT_MAX / IPC_MAX_OBJECTS) - 1)) + 1;
+        object->id        = (ns->sequence * IPC_MAX_OBJECTS) + slot;
+        object->key       = key;
+        ns->objects[slot] = object;
+        list_head_insert_before(&object->key_bucket, __ipc_key_bucket(ns, key));
+        return object->id;
+    }
+    return -ENOSPC;
+}
+
+void ipc_namespace_remove(ipc_namespace_t *ns, ipc_object_t *object)
+{
+    assert(ns->objects[object->id % IPC_MAX_OBJECTS] == object && "The object is not inside the namespace.");
+    ns->objects[object->id % IPC_MAX_OBJECTS] = NULL;
+    list_head_remove(&object->key_bucket);
+}
+
+ipc_object_t *ipc_find_by_id(ipc_namespace_t *ns, int id)
+{
+    if (id < 0) {
+        return NULL;
+    }
+    ipc_object_t *object = ns->objects[id % IPC_MAX_OBJECTS];
+    return (object && (object->id == id)) ? object : NULL;
+}
+
+ipc_object_t *ipc_find_by_key(ipc_namespace_t *ns, key_t key)
+{
+    list_for_each_decl (it, __ipc_key_bucket(ns, key)) {
+        ipc_object_t *object = list_entry(it, ipc_object_t, key_bucket);
+        if (object->key == key) {
+            return object;
+        }
+    }
+    return NULL;
+}
+
+void *ipc_seq_find(ipc_namespace_t *ns, off_t *pos)
+{
+    if (*pos == 0) {
+        return IPC_SEQ_HEADER;
+    }
+    for (; *pos <= IPC_MAX_OBJECTS; ++(*pos)) {
+        if (ns->objects[*pos - 1]) {
+            return ns->objects[*pos - 1];
+        }
+    }
+    return (*pos == (IPC_MAX_OBJECTS + 1)) ? IPC_SEQ_TRAILER : NULL;
+}
@@ -14,35 +14,77 @@
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/seq_file.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/vm_area.h"
+#include "mem/mm/vmem.h"
+#include "mem/paging.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "sys/mman.h"
 #include "sys/msg.h"
 #include "system/panic.h"
 
 #include "ipc/ipc.h"
 
-///@brief A value to compute the message queue ID.
-static int __msq_id = 0;
+/// The number of buckets of the hash table of the types of a queue.
+#define MSQ_TYPE_BUCKETS 16
+/// The largest number of whole pages inside a message.
+#define MSQ_MAX_PAGES (MSGMAX / PAGE_SIZE)
+
+/// @brief The messages of a single type, inside a queue.
+typedef struct msq_type {
+    /// The type of the messages.
+    long type;
+    /// The messages of this type, in the order they were sent.
+    list_head_t messages;
+    /// Reference inside the bucket of the hash table of the types.
+    list_head_t bucket;
+    /// Reference inside the list of the types, sorted by increasing type.
+    list_head_t sorted;
+} msq_type_t;
+
+/// @brief A stored message.
+typedef struct msq_msg {
+    /// The messages of the same type.
+    msq_type_t *type;
+    /// The length of the message.
+    size_t size;
+    /// Reference inside the list of all the messages of the queue.
+    list_head_t queue;
+    /// Reference inside the list of the messages of the same type.
+    list_head_t type_queue;
+    /// The number of whole pages taken from the sender, instead of copied.
+    unsigned int npages;
+    /// The pages which hold the start of the message, copy-on-write.
+    page_t *pages[MSQ_MAX_PAGES];
+    /// The content of the message which follows its pages.
+    char text[];
+} msq_msg_t;
 
 /// @brief Message queue management structure.
 typedef struct {
-    /// @brief ID associated to the message queue.
-    int id;
+    /// @brief The id and the key of the message queue.
+    ipc_object_t ipc;
     /// @brief The message queue data strcutre.
     struct msqid_ds msqid;
-    /// Pointer to the first message in the queue.
-    struct msg *msg_first;
-    /// Pointer to the last message in the queue.
-    struct msg *msg_last;
-    /// Reference inside the list of message queue management structures.
-    list_head_t list;
+    /// All the messages, in the order they were sent.
+    list_head_t messages;
+    /// The types with at least a message, hashed by type.
+    list_head_t type_buckets[MSQ_TYPE_BUCKETS];
+    /// The types with at least a message, sorted by increasing type.
+    list_head_t types;
+    /// The tasks waiting for a message to receive.
+    wait_queue_head_t recv_wait;
+    /// The tasks waiting for room to send a message.
+    wait_queue_head_t send_wait;
 } msq_info_t;
 
-/// @brief List of all current active Message queues.
-list_head_t msq_list;
+/// @brief All the current active message queues.
+static ipc_namespace_t msq_namespace;
 
 // ============================================================================
 // MEMORY MANAGEMENT (Private)
@@ -61,10 +103,13 @@ static inline msq_info_t *__msq_info_alloc(key_t key, int msqflg)
     // Clean the memory.
     memset(msq_info, 0, sizeof(msq_info_t));
     // Initialize it.
-    msq_info->id        = ++__msq_id;
-    msq_info->msg_first = NULL;
-    msq_info->msg_last  = NULL;
-    list_head_init(&msq_info->list);
+    list_head_init(&msq_info->messages);
+    for (int i = 0; i < MSQ_TYPE_BUCKETS; ++i) {
+        list_head_init(&msq_info->type_buckets[i]);
+    }
+    list_head_init(&msq_info->types);
+    wait_queue_head_init(&msq_info->recv_wait);
+    wait_queue_head_init(&msq_info->send_wait);
     // Initialize the internal data structure.
     msq_info->msqid.msg_perm   = register_ipc(key, msqflg & 0x1FF);
     msq_info->msqid.msg_stime  = 0;
@@ -79,131 +124,243 @@ static inline msq_info_t *__msq_info_alloc(key_t key, int msqflg)
     return msq_info;
 }
 
+/// @brief Frees a message, and drops its references to the pages.
+/// @param message the message.
+static inline void __msq_msg_free(msq_msg_t *message)
+{
+    for (unsigned int i = 0; i < message->npages; ++i) {
+        page_cache_put(message->pages[i]);
+    }
+    kfree(message);
+}
+
+/// @brief Counts the whole pages of a buffer of the current process which can
+///        be moved to, or from, a queue instead of being copied.
+/// @param buffer the buffer.
+/// @param size the size of the buffer.
+/// @param write if the pages of the buffer are replaced, when receiving.
+/// @return the number of pages at the start of the buffer, 0 if it must be copied.
+static inline unsigned int __msq_remap_pages(void *buffer, size_t size, int write)
+{
+    uint32_t start = (uint32_t)buffer;
+    uint32_t end   = start + (size & ~(PAGE_SIZE - 1));
+    if ((start & (PAGE_SIZE - 1)) || (start == end)) {
+        return 0;
+    }
+    task_struct *task      = scheduler_get_current_process();
+    vm_area_struct_t *area = vm_area_lookup(task->mm, start);
+    // The shared mappings must see the writes, and large pages are not split.
+    if (!area || (area->vm_start > start) || (end > area->vm_end) || (area->vm_flags & MAP_SHARED) ||
+        (area->vm_page_prot & MM_HUGE) || (write && !(area->vm_page_prot & MM_RW))) {
+        return 0;
+    }
+    return size / PAGE_SIZE;
+}
+
+/// @brief Delivers the content of a message to the buffer of the receiver.
+/// @param message the message, which keeps its references to the pages.
+/// @param buffer the buffer of the receiver.
+/// @param size the number of bytes to deliver.
+/// @return 0 on success, -ENOMEM if a page could not be mapped to be copied.
+static inline int __msq_msg_deliver(msq_msg_t *message, char *buffer, size_t size)
+{
+    task_struct *task  = scheduler_get_current_process();
+    unsigned int remap = __msq_remap_pages(buffer, size, 1);
+    size_t offset      = 0;
+    for (unsigned int i = 0; (i < message->npages) && (offset < size); ++i, offset += PAGE_SIZE) {
+        // The whole pages are mapped inside the receiver, copy-on-write.
+        if ((i < remap) && !mem_put_user_page(task->mm->pgd, (uint32_t)(buffer + offset), message->pages[i])) {
+            continue;
+        }
+        uint32_t page = vmem_map_physical_pages(message->pages[i], 1);
+        if (!page) {
+            return -ENOMEM;
+        }
+        memcpy(buffer + offset, (void *)page, min(PAGE_SIZE, size - offset));
+        vmem_unmap_virtual_address(page);
+    }
+    if (offset < size) {
+        memcpy(buffer + offset, message->text, size - offset);
+    }
+    return 0;
+}
+
 /// @brief Frees the memory of a message queue management structure.
 /// @param msq_info pointer to the message queue management structure.
 static inline void __msq_info_dealloc(msq_info_t *msq_info)
 {
     assert(msq_info && "Received a NULL pointer.");
-    // Free the memory of all the messages.
-    struct msg *message = msq_info->msg_first;
-    struct msg *next    = NULL;
-    while (message) {
-        next = message->msg_next;
-        // Free the memory of the message.
-        kfree(message->msg_ptr);
-        // Fre the memory of the msg structure.
-        kfree(message);
-        // Move to the next.
-        message = next;
+    // Free the memory of all the messages, and of their types.
+    list_for_each_safe_decl(it, store, &msq_info->messages)
+    {
+        __msq_msg_free(list_entry(it, msq_msg_t, queue));
+    }
+    list_for_each_safe_decl(it, store, &msq_info->types)
+    {
+        kfree(list_entry(it, msq_type_t, sorted));
     }
     // Deallocate the memory.
     kfree(msq_info);
 }
 
 // ============================================================================
-// LIST MANAGEMENT/SEARCH FUNCTIONS (Private)
+// NAMESPACE MANAGEMENT/SEARCH FUNCTIONS (Private)
 // ============================================================================
 
 /// @brief Searches for the message queue with the given id.
 /// @param msqid the id we are searching.
 /// @return the message queue with the given id.
-static inline msq_info_t *__list_find_msq_info_by_id(int msqid)
+static inline msq_info_t *__find_msq_info_by_id(int msqid)
 {
-    msq_info_t *msq_info;
-    // Iterate through the list of message queue set.
-    list_for_each_decl (it, &msq_list) {
-        // Get the current entry.
-        msq_info = list_entry(it, msq_info_t, list);
-        // If message queue set is valid, check the id.
-        if (msq_info && (msq_info->id == msqid)) {
-            return msq_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_id(&msq_namespace, msqid);
+    return object ? list_entry(object, msq_info_t, ipc) : NULL;
 }
 
 /// @brief Searches for the message queue with the given key.
 /// @param key the key we are searching.
 /// @return the message queue with the given key.
-static inline msq_info_t *__list_find_msq_info_by_key(key_t key)
+static inline msq_info_t *__find_msq_info_by_key(key_t key)
 {
-    msq_info_t *msq_info;
-    // Iterate through the list of message queue set.
-    list_for_each_decl (it, &msq_list) {
-        // Get the current entry.
-        msq_info = list_entry(it, msq_info_t, list);
-        // If message queue set is valid, check the id.
-        if (msq_info && (msq_info->msqid.msg_perm.key == key)) {
-            return msq_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_key(&msq_namespace, key);
+    return object ? list_entry(object, msq_info_t, ipc) : NULL;
 }
 
-/// @brief Adds the structure to the global list.
+/// @brief Adds the structure to the namespace, which gives it its id.
 /// @param msq_info the structure to add.
-static inline void __list_add_msq_info(msq_info_t *msq_info)
+/// @return 0 on success, -ENOSPC if there are too many message queues.
+static inline int __add_msq_info(msq_info_t *msq_info)
 {
     assert(msq_info && "Received a NULL pointer.");
-    // Add the new msq_info at the end.
-    list_head_insert_before(&msq_info->list, &msq_list);
+    return (ipc_namespace_add(&msq_namespace, &msq_info->ipc, msq_info->msqid.msg_perm.key) < 0) ? -ENOSPC : 0;
 }
 
-/// @brief Removes the structure from the global list.
+/// @brief Removes the structure from the namespace.
 /// @param msq_info the structure to remove.
-static inline void __list_remove_msq_info(msq_info_t *msq_info)
+static inline void __remove_msq_info(msq_info_t *msq_info)
 {
     assert(msq_info && "Received a NULL pointer.");
-    // Delete the msq_info from the list.
-    list_head_remove(&msq_info->list);
+    ipc_namespace_remove(&msq_namespace, &msq_info->ipc);
+}
+
+/// @brief Returns the bucket of the hash table of the types of a queue.
+/// @param msq_info the message queue.
+/// @param type the type.
+/// @return the bucket.
+static inline list_head_t *__msq_type_bucket(msq_info_t *msq_info, long type)
+{
+    return &msq_info->type_buckets[(unsigned long)type % MSQ_TYPE_BUCKETS];
+}
+
+/// @brief Searches for the messages of the given type.
+/// @param msq_info the message queue.
+/// @param type the type.
+/// @return the messages of the type, NULL if there are none.
+static inline msq_type_t *__msq_type_find(msq_info_t *msq_info, long type)
+{
+    list_for_each_decl (it, __msq_type_bucket(msq_info, type)) {
+        msq_type_t *msq_type = list_entry(it, msq_type_t, bucket);
+        if (msq_type->type == type) {
+            return msq_type;
+        }
+    }
+    return NULL;
 }
 
 /// @brief Pushes a messages inside the message queue.
 /// @param msq_info the structure that will contain the message.
 /// @param message the message to push.
-static inline void __msq_info_push_message(msq_info_t *msq_info, struct msg *message)
+/// @param type the type of the message.
+/// @return 0 on success, -ENOMEM if the type could not be allocated.
+static inline int __msq_info_push_message(msq_info_t *msq_info, msq_msg_t *message, long type)
 {
     assert(msq_info && "Received a NULL pointer.");
     assert(message && "Received a NULL pointer.");
-    // If there is no first message set, set it.
-    if (msq_info->msg_first == NULL) {
-        msq_info->msg_first = message;
-    }
-    // If there is no last message set, set it.
-    if (msq_info->msg_last == NULL) {
-        msq_info->msg_last = message;
-    } else { // Otherwise, append after the last.
-        msq_info->msg_last->msg_next = message;
-        msq_info->msg_last           = message;
+    msq_type_t *msq_type = __msq_type_find(msq_info, type);
+    // The first message of a type brings the type inside the queue, in order.
+    if (!msq_type) {
+        msq_type = (msq_type_t *)kmalloc(sizeof(msq_type_t));
+        if (!msq_type) {
+            return -ENOMEM;
+        }
+        msq_type->type = type;
+        list_head_init(&msq_type->messages);
+        list_head_insert_before(&msq_type->bucket, __msq_type_bucket(msq_info, type));
+        list_head_t *next = &msq_info->types;
+        list_for_each_decl (it, &msq_info->types) {
+            if (list_entry(it, msq_type_t, sorted)->type > type) {
+                next = it;
+                break;
+            }
+        }
+        list_head_insert_before(&msq_type->sorted, next);
     }
+    message->type = msq_type;
+    list_head_insert_before(&message->queue, &msq_info->messages);
+    list_head_insert_before(&message->type_queue, &msq_type->messages);
+    return 0;
 }
 
 /// @brief Removes the message from the message queue.
 /// @param msq_info the structure that contains the message.
 /// @param message the message to remove.
-static inline void __msq_info_remove_message(msq_info_t *msq_info, struct msg *message)
+static inline void __msq_info_remove_message(msq_info_t *msq_info, msq_msg_t *message)
 {
     assert(msq_info && "Received a NULL pointer.");
     assert(message && "Received a NULL pointer.");
-    // If the message is the first of the queue, next will become the first.
-    if (msq_info->msg_first == message) {
-        msq_info->msg_first = message->msg_next;
-    } else {
-        // Otherwise, we need to find the element before it, and connect the
-        // previous one with the next one.
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_next == message) {
-                it->msg_next = message->msg_next;
-                break;
-            }
+    list_head_remove(&message->queue);
+    list_head_remove(&message->type_queue);
+    // The type leaves the queue along with its last message.
+    if (list_head_empty(&message->type->messages)) {
+        list_head_remove(&message->type->bucket);
+        list_head_remove(&message->type->sorted);
+        kfree(message->type);
+    }
+    message->type = NULL;
+}
+
+/// @brief Searches the message we should receive from a queue.
+/// @param msq_info the message queue management structure.
+/// @param msgtyp the type of message requested by the receiver.
+/// @return a pointer to the message, NULL if there is none.
+static inline msq_msg_t *__msq_info_find_message(msq_info_t *msq_info, long msgtyp)
+{
+    msq_type_t *msq_type = NULL;
+    // If msgtyp is 0, then the first message in the queue is read.
+    if (msgtyp == 0) {
+        if (list_head_empty(&msq_info->messages)) {
+            return NULL;
         }
+        return list_entry(msq_info->messages.next, msq_msg_t, queue);
     }
-    // If the message is the last of the queue, set the last to NULL.
-    if (msq_info->msg_last == message) {
-        msq_info->msg_last = NULL;
+    // If msgtyp is greater than 0, then the first message in the queue of type
+    // msgtyp is read.
+    if (msgtyp > 0) {
+        msq_type = __msq_type_find(msq_info, msgtyp);
+    }
+    // If msgtyp is less than 0, then the first message in the queue with the
+    // lowest type less than or equal to the absolute value of msgtyp will be
+    // read: the types are sorted, so it is the first of the lowest type. The
+    // types are positive, so adding them to msgtyp cannot overflow.
+    else if (!list_head_empty(&msq_info->types)) {
+        msq_type = list_entry(msq_info->types.next, msq_type_t, sorted);
+        if ((msq_type->type + msgtyp) > 0) {
+            msq_type = NULL;
+        }
+    }
+    return msq_type ? list_entry(msq_type->messages.next, msq_msg_t, type_queue) : NULL;
+}
+
+/// @brief Prints the messages of a queue, for debugging.
+/// @param msq_info the message queue.
+static inline void __msq_info_dump(msq_info_t *msq_info)
+{
+    pr_debug(
+        "[%2d] msg_lspid: %2d, msg_lrpid: %2d, msg_qnum: %2d, msg_cbytes: %4d\n", msq_info->ipc.id,
+        msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_qnum, msq_info->msqid.msg_cbytes);
+    list_for_each_decl (it, &msq_info->messages) {
+        msq_msg_t *message = list_entry(it, msq_msg_t, queue);
+        pr_debug("    type: %3ld, size: %3d\n", message->type->type, message->size);
     }
-    // Clear the pointer in message.
-    message->msg_next = NULL;
 }
 
 // ============================================================================
@@ -214,7 +371,7 @@ static inline void __msq_info_remove_message(msq_info_t *msq_info, struct msg *m
 /// @return 0 on success, 1 on failure.
 int msq_init(void)
 {
-    list_head_init(&msq_list);
+    ipc_namespace_init(&msq_namespace);
     return 0;
 }
 
@@ -226,14 +383,18 @@ int sys_msgget(key_t key, int msgflg)
         // Exit when i find a unique key.
         do {
             key = -rand();
-        } while (__list_find_msq_info_by_key(key));
+        } while (__find_msq_info_by_key(key));
         // We have a unique key, create the message queue.
         msq_info = __msq_info_alloc(key, msgflg);
-        // Add the message queue to the list.
-        __list_add_msq_info(msq_info);
+        // Add the message queue to the namespace, which gives it its id.
+        if (__add_msq_info(msq_info) < 0) {
+            pr_err("There are too many message queues.\n");
+            __msq_info_dealloc(msq_info);
+            return -ENOSPC;
+        }
     } else {
         // Get the message queue if it exists.
-        msq_info = __list_find_msq_info_by_key(key);
+        msq_info = __find_msq_info_by_key(key);
 
         // Check if no message queue exists for the given key and msgflg did not
         // specify IPC_CREAT.
@@ -263,12 +424,16 @@ int sys_msgget(key_t key, int msgflg)
         if (msq_info == NULL) {
             // Create the message queue.
             msq_info = __msq_info_alloc(key, msgflg);
-            // Add the message queue to the list.
-            __list_add_msq_info(msq_info);
+            // Add the message queue to the namespace, which gives it its id.
+            if (__add_msq_info(msq_info) < 0) {
+                pr_err("There are too many message queues.\n");
+                __msq_info_dealloc(msq_info);
+                return -ENOSPC;
+            }
         }
     }
     // Return the id of the message queue.
-    return msq_info->id;
+    return msq_info->ipc.id;
 }
 
 int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
@@ -297,8 +462,13 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
         pr_err("The value of msgsz above the maximum allowed size.\n");
         return -EINVAL;
     }
+    // The type of the message must be positive.
+    if (_msgp->mtype < 1) {
+        pr_err("The type of the message is not positive.\n");
+        return -EINVAL;
+    }
     // Search for the message queue.
-    msq_info = __list_find_msq_info_by_id(msqid);
+    msq_info = __find_msq_info_by_id(msqid);
     // The message queue doesn't exist.
     if (!msq_info) {
         pr_err("The message queue does not exist.\n");
@@ -311,34 +481,59 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
                "calling process does not have permission to access the set.\n");
         return -EACCES;
     }
-    // Check if the message can't be sent due to the msg_qbytes limit for the
-    // queue.
-    if (((msq_info->msqid.msg_cbytes + msgsz) >= msq_info->msqid.msg_qbytes)) {
-        return -EAGAIN;
+    // Wait until the message fits inside the queue, given its msg_qbytes limit.
+    while ((msq_info->msqid.msg_cbytes + msgsz) >= msq_info->msqid.msg_qbytes) {
+        if (msgflg & IPC_NOWAIT) {
+            return -EAGAIN;
+        }
+        int ret = interruptible_sleep_on(&msq_info->send_wait);
+        if (ret < 0) {
+            return ret;
+        }
+        // The message queue might have been removed while we were sleeping.
+        msq_info = __find_msq_info_by_id(msqid);
+        if (!msq_info) {
+            return -EIDRM;
+        }
     }
-    // Allocate the memory for the message.
-    struct msg *message = (struct msg *)kmalloc(sizeof(struct msg));
+    // The whole pages of an aligned message are taken from the sender,
+    // copy-on-write, instead of being copied.
+    task_struct *task   = scheduler_get_current_process();
+    page_t *pages[MSQ_MAX_PAGES];
+    unsigned int npages  = __msq_remap_pages(_msgp->mtext, msgsz, 0);
+    for (unsigned int i = 0; i < npages; ++i) {
+        pages[i] = mem_get_user_page(task->mm->pgd, (uint32_t)_msgp->mtext + (i * PAGE_SIZE));
+        // Copy the whole message, if a page cannot be brought in.
+        if (!pages[i]) {
+            while (i--) {
+                page_cache_put(pages[i]);
+            }
+            npages = 0;
+            break;
+        }
+    }
+    size_t copied = msgsz - (npages * PAGE_SIZE);
+    // Allocate the memory for the message, along with the content not inside the pages.
+    msq_msg_t *message = (msq_msg_t *)kmalloc(sizeof(msq_msg_t) + copied);
     if (message == NULL) {
         pr_err("We failed to allocate the memory for the message.\n");
+        for (unsigned int i = 0; i < npages; ++i) {
+            page_cache_put(pages[i]);
+        }
         return -ENOMEM;
     }
-    // Initialize the pointer to the next.
-    message->msg_next = NULL;
-    // Copy the type of message.
-    message->msg_type = _msgp->mtype;
-    // Allocate the memory for the content of the message.
-    message->msg_ptr  = (char *)kmalloc(msgsz);
-    if (message->msg_ptr == NULL) {
-        pr_err("We failed to allocate the memory for the message.\n");
-        kfree(message);
+    message->npages = npages;
+    memcpy(message->pages, pages, npages * sizeof(page_t *));
+    // Copy the content of the message which follows the pages.
+    memcpy(message->text, _msgp->mtext + (npages * PAGE_SIZE), copied);
+    // The length of the message.
+    message->size = msgsz;
+    // Add the message to the queue, and to the messages of its type.
+    if (__msq_info_push_message(msq_info, message, _msgp->mtype) < 0) {
+        pr_err("We failed to allocate the memory for the type of the message.\n");
+        __msq_msg_free(message);
         return -ENOMEM;
     }
-    // Copy the content of the message.
-    memcpy(message->msg_ptr, _msgp->mtext, msgsz);
-    // The length of the message.
-    message->msg_size = msgsz;
-    // Add the message to the queue.
-    __msq_info_push_message(msq_info, message);
 
     // Update last send time.
     msq_info->msqid.msg_stime = sys_time(NULL);
@@ -348,15 +543,9 @@ int sys_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg)
     msq_info->msqid.msg_cbytes += msgsz;
     // Increment the number of messages in the message queue.
     msq_info->msqid.msg_qnum += 1;
-
-    pr_debug(
-        "[%2d] msg_lspid: %2d, msg_lrpid: %2d, msg_qnum: %2d, msg_cbytes: %4d "
-        "(%s)\n",
-        msq_info->id, msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_qnum,
-        msq_info->msqid.msg_cbytes, message->msg_ptr);
-    for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", it->msg_type, it->msg_size, it->msg_ptr);
-    }
+    // Wake up the receivers.
+    wake_up(&msq_info->recv_wait);
+    __msq_info_dump(msq_info);
     return 0;
 }
 
@@ -387,7 +576,7 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
         return -EINVAL;
     }
     // Search for the message queue.
-    msq_info = __list_find_msq_info_by_id(msqid);
+    msq_info = __find_msq_info_by_id(msqid);
     // The message queue doesn't exist.
     if (!msq_info) {
         pr_err("The message queue does not exist.\n");
@@ -401,46 +590,25 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
                "set.\n");
         return -EACCES;
     }
-    // Prepare a structure for the message.
-    struct msg *message = NULL;
-    // If msgtyp is 0, then the first message in the queue is read.
-    if (msgtyp == 0) {
-        // Get the first message.
-        message = msq_info->msg_first;
-    }
-    // If msgtyp is greater than 0, then the first message in the queue of type
-    // msgtyp is read.
-    else if (msgtyp > 0) {
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_type == msgtyp) {
-                message = it;
-                break;
-            }
+    // Wait until there is a message we can read.
+    msq_msg_t *message = __msq_info_find_message(msq_info, msgtyp);
+    while (message == NULL) {
+        if (msgflg & IPC_NOWAIT) {
+            return -ENOMSG;
         }
-    }
-    // If msgtyp is less than 0, then the first message in the queue with the
-    // lowest type less than or equal to the absolute value of msgtyp will be
-    // read.
-    else {
-        long lowest_type = LONG_MAX;
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if ((it->msg_type < abs(msgtyp)) && (it->msg_type < lowest_type)) {
-                lowest_type = it->msg_type;
-            }
+        int ret = interruptible_sleep_on(&msq_info->recv_wait);
+        if (ret < 0) {
+            return ret;
         }
-        for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-            if (it->msg_type == lowest_type) {
-                message = it;
-                break;
-            }
+        // The message queue might have been removed while we were sleeping.
+        msq_info = __find_msq_info_by_id(msqid);
+        if (!msq_info) {
+            return -EIDRM;
         }
-    }
-    if (message == NULL) {
-        // pr_err("There are no messages to read.\n");
-        return -ENOMSG;
+        message = __msq_info_find_message(msq_info, msgtyp);
     }
     // Check if the message is longer than msgsz.
-    if (message->msg_size > msgsz) {
+    if (message->size > msgsz) {
         // If we have the MSG_NOERROR flag, we return E2BIG and leave the
         // message on the queue.
         if (!(msgflg & MSG_NOERROR)) {
@@ -450,35 +618,31 @@ ssize_t sys_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg)
         // Otherwise, we truncate the message to msgsz.
     }
     // The number of bytes actually copied.
-    ssize_t actual_size = min(message->msg_size, msgsz);
-    // Copy the content of the message (we might truncate).
-    memcpy(_msgp->mtext, message->msg_ptr, actual_size);
+    ssize_t actual_size = min(message->size, msgsz);
+    // Copy the type, and the content of the message (we might truncate).
+    if (__msq_msg_deliver(message, _msgp->mtext, actual_size) < 0) {
+        pr_err("We failed to deliver the message.\n");
+        return -ENOMEM;
+    }
+    _msgp->mtype = message->type->type;
 
     // Update last receive time.
     msq_info->msqid.msg_rtime = sys_time(NULL);
     // Update pid of last process who issued a receive.
     msq_info->msqid.msg_lrpid = sys_getpid();
     // Update the total consumed space of the message queue.
-    msq_info->msqid.msg_cbytes -= message->msg_size;
+    msq_info->msqid.msg_cbytes -= message->size;
     // Decrement the number of messages in the message queue.
     msq_info->msqid.msg_qnum -= 1;
 
     // Remove the message to the queue.
     __msq_info_remove_message(msq_info, message);
+    // Wake up the senders waiting for space.
+    wake_up(&msq_info->send_wait);
+    __msq_info_dump(msq_info);
 
-    pr_debug(
-        "[%2d] msg_lspid: %2d, msg_lrpid: %2d, msg_qnum: %2d, msg_cbytes: %4d "
-        "(%s)\n",
-        msq_info->id, msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_qnum,
-        msq_info->msqid.msg_cbytes, message->msg_ptr);
-    for (struct msg *it = msq_info->msg_first; it; it = it->msg_next) {
-        pr_debug("    type: %3ld, size: %3d, msg: `%s`\n", it->msg_type, it->msg_size, it->msg_ptr);
-    }
-
-    // Free the memory of the message.
-    kfree(message->msg_ptr);
-    // Free the memory of the data structure.
-    kfree(message);
+    // Free the memory of the message, along with its content.
+    __msq_msg_free(message);
 
     return actual_size;
 }
@@ -493,7 +657,7 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
         return -EINVAL;
     }
     // Search for the message queue.
-    msq_info = __list_find_msq_info_by_id(msqid);
+    msq_info = __find_msq_info_by_id(msqid);
     // The message queue doesn't exist.
     if (!msq_info) {
         pr_err("The message queue does not exist.\n");
@@ -513,7 +677,10 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
             return -EPERM;
         }
         // Remove the info from the list.
-        __list_remove_msq_info(msq_info);
+        __remove_msq_info(msq_info);
+        // Wake up the blocked processes, they will find the queue removed.
+        wake_up(&msq_info->recv_wait);
+        wake_up(&msq_info->send_wait);
         // Delete the info.
         __msq_info_dealloc(msq_info);
     } else if (cmd == IPC_STAT) {
@@ -540,6 +707,59 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 // PROCFS FUNCTIONS
 // ============================================================================
 
+/// @brief Returns the record of `/proc/ipc/msg` at the given position.
+/// @param m The streaming state.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_msg_start(seq_file_t *m, off_t *pos) { return ipc_seq_find(&msq_namespace, pos); }
+
+/// @brief Returns the record of `/proc/ipc/msg` which follows the given one.
+/// @param m The streaming state.
+/// @param v The record.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_msg_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return ipc_seq_find(&msq_namespace, pos);
+}
+
+/// @brief Stops listing `/proc/ipc/msg`.
+/// @param m The streaming state.
+/// @param v The record.
+static void __procipc_msg_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats a record of `/proc/ipc/msg`.
+/// @param m The streaming state.
+/// @param v The record.
+/// @return 0.
+static int __procipc_msg_show(seq_file_t *m, void *v)
+{
+    if (v == IPC_SEQ_HEADER) {
+        seq_puts(m, "       key      msqid perms      cbytes       qnum lspid lrpid   uid  "
+                    " gid  cuid  cgid      stime      rtime      ctime\n");
+    } else if (v == IPC_SEQ_TRAILER) {
+        seq_puts(m, "\n");
+    } else {
+        msq_info_t *msq_info = list_entry(v, msq_info_t, ipc);
+        seq_printf(
+            m, "%10d %11d %6d %12d %11d %6d %6d %6d %6d %6d %6d %11d %11d %11d\n", abs(msq_info->msqid.msg_perm.key),
+            msq_info->ipc.id, msq_info->msqid.msg_perm.mode, msq_info->msqid.msg_cbytes, msq_info->msqid.msg_qnum,
+            msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid, msq_info->msqid.msg_perm.uid,
+            msq_info->msqid.msg_perm.gid, msq_info->msqid.msg_perm.cuid, msq_info->msqid.msg_perm.cgid,
+            msq_info->msqid.msg_stime, msq_info->msqid.msg_rtime, msq_info->msqid.msg_ctime);
+    }
+    return 0;
+}
+
+/// The iterator over the message queues, for `/proc/ipc/msg`.
+static const seq_operations_t procipc_msg_seq_operations = {
+    .start = __procipc_msg_start,
+    .stop  = __procipc_msg_stop,
+    .next  = __procipc_msg_next,
+    .show  = __procipc_msg_show,
+};
+
 /// @brief Read function for the proc system.
 /// @param file The file.
 /// @param buf Buffer where the read content must be placed.
@@ -552,43 +772,5 @@ ssize_t procipc_msg_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte
         pr_err("Received a NULL file.\n");
         return -ENOENT;
     }
-    size_t buffer_len    = 0;
-    size_t read_pos      = 0;
-    size_t ret           = 0;
-    ssize_t write_count  = 0;
-    msq_info_t *msq_info = NULL;
-    char buffer[BUFSIZ];
-
-    // Prepare a buffer.
-    memset(buffer, 0, BUFSIZ);
-    // Prepare the header.
-    ret = sprintf(
-        buffer, "       key      msqid perms      cbytes       qnum lspid lrpid   uid  "
-                " gid  cuid  cgid      stime      rtime      ctime\n");
-
-    list_for_each_decl (it, &msq_list) {
-        // Get the current entry.
-        msq_info = list_entry(it, msq_info_t, list);
-        // Add the line.
-        ret += sprintf(
-            buffer + ret, "%10d %11d %6d %12d %11d %6d %6d %6d %6d %6d %6d %11d %11d %11d\n",
-            abs(msq_info->msqid.msg_perm.key), msq_info->id, msq_info->msqid.msg_perm.mode, msq_info->msqid.msg_cbytes,
-            msq_info->msqid.msg_qnum, msq_info->msqid.msg_lspid, msq_info->msqid.msg_lrpid,
-            msq_info->msqid.msg_perm.uid, msq_info->msqid.msg_perm.gid, msq_info->msqid.msg_perm.cuid,
-            msq_info->msqid.msg_perm.cgid, msq_info->msqid.msg_stime, msq_info->msqid.msg_rtime,
-            msq_info->msqid.msg_ctime);
-    }
-    sprintf(buffer + ret, "\n");
-
-    // Perform read.
-    buffer_len = strlen(buffer);
-    read_pos   = offset;
-    if (read_pos < buffer_len) {
-        while ((write_count < nbyte) && (read_pos < buffer_len)) {
-            buf[write_count] = buffer[read_pos];
-            // Move the pointers.
-            ++read_pos, ++write_count;
-        }
-    }
-    return write_count;
+    return seq_read(file, &procipc_msg_seq_operations, buf, offset, nbyte);
 }
@@ -26,6 +26,17 @@
 /// values. If the operation cannot be performed then the user will stay in a
 /// while loop. The cycle ends with a positive return value (the operation has
 /// been taken care of) or in case of errors.
+///
+/// # Blocking operations
+/// The user-side loop is gone: when an operation cannot be performed, the
+/// process sleeps inside the kernel, on the wait queue of the semaphore which
+/// blocked it, until its value changes, the set is removed, a signal
+/// interrupts it, or the timeout of semtimedop() expires.
+///
+/// # Atomic operations
+/// All the operations of a semop() are applied at once, or none of them is:
+/// they are applied in order, and if one of them would block, the ones
+/// before it are undone before the process goes to sleep.
 /// For testing purposes -> you can try the t_semget and the t_sem1 tests. They
 /// both use semaphores and blocking / non blocking operations. t_sem1 is also
 /// an exercise that was assingned by Professor Drago in the OS course.
@@ -44,29 +55,29 @@
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/seq_file.h"
+#include "hardware/hrtimer.h"
+#include "hardware/timer.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
 
-///@brief A value to compute the semid value.
-int __sem_id = 0;
-
 /// @brief Semaphore management structure.
 typedef struct {
-    /// @brief Semaphore ID associated to the semaphore set.
-    int id;
+    /// @brief The id and the key of the semaphore set.
+    ipc_object_t ipc;
     /// @brief The semaphore data strcutre.
     struct semid_ds semid;
     /// @brief List of all the semaphores.
     struct sem *sem_base;
-    /// Reference inside the list of semaphore management structures.
-    list_head_t list;
+    /// The processes waiting for the value of each semaphore to change.
+    wait_queue_head_t *sem_wait;
 } sem_info_t;
 
-/// @brief List of all current active semaphores.
-list_head_t semaphores_list;
+/// @brief All the current active semaphore sets.
+static ipc_namespace_t sem_namespace;
 
 // ============================================================================
 // MEMORY MANAGEMENT (Private)
@@ -91,13 +102,17 @@ static inline sem_info_t *__sem_info_alloc(key_t key, int nsems, int semflg)
     assert(sem_info->sem_base && "Failed to allocate memory for a set of semaphores.");
     // Clean the memory.
     memset(sem_info->sem_base, 0, sizeof(struct sem) * nsems);
+    // Allocate the wait queues of the semaphores.
+    sem_info->sem_wait = (wait_queue_head_t *)kmalloc(sizeof(wait_queue_head_t) * nsems);
+    // Check the allocated memory.
+    assert(sem_info->sem_wait && "Failed to allocate memory for the wait queues of a set of semaphores.");
     // Initialize its values.
-    sem_info->id              = ++__sem_id;
     sem_info->semid.sem_perm  = register_ipc(key, semflg & 0x1FF);
     sem_info->semid.sem_otime = 0;
     sem_info->semid.sem_ctime = 0;
     sem_info->semid.sem_nsems = nsems;
     for (int i = 0; i < nsems; i++) {
+        wait_queue_head_init(&sem_info->sem_wait[i]);
         sem_info->sem_base[i].sem_pid  = sys_getpid();
         sem_info->sem_base[i].sem_val  = 0;
         sem_info->sem_base[i].sem_ncnt = 0;
@@ -112,68 +127,50 @@ static inline sem_info_t *__sem_info_alloc(key_t key, int nsems, int semflg)
 static inline void __sem_info_dealloc(sem_info_t *sem_info)
 {
     assert(sem_info && "Received a NULL pointer.");
-    // Deallocate the array of semaphores.
+    // Deallocate the array of semaphores, and their wait queues.
     kfree(sem_info->sem_base);
+    kfree(sem_info->sem_wait);
     // Deallocate the semid memory.
     kfree(sem_info);
 }
 
 // ============================================================================
-// LIST MANAGEMENT/SEARCH FUNCTIONS (Private)
+// NAMESPACE MANAGEMENT/SEARCH FUNCTIONS (Private)
 // ============================================================================
 
 /// @brief Searches for the semaphore with the given id.
 /// @param semid the id we are searching.
 /// @return the semaphore with the given id.
-static inline sem_info_t *__list_find_sem_info_by_id(int semid)
+static inline sem_info_t *__find_sem_info_by_id(int semid)
 {
-    sem_info_t *sem_info;
-    // Iterate through the list of semaphore set.
-    list_for_each_decl (it, &semaphores_list) {
-        // Get the current entry.
-        sem_info = list_entry(it, sem_info_t, list);
-        // If semaphore set is valid, check the id.
-        if (sem_info && (sem_info->id == semid)) {
-            return sem_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_id(&sem_namespace, semid);
+    return object ? list_entry(object, sem_info_t, ipc) : NULL;
 }
 
 /// @brief Searches for the semaphore with the given key.
 /// @param key the key we are searching.
 /// @return the semaphore with the given key.
-static inline sem_info_t *__list_find_sem_info_by_key(key_t key)
+static inline sem_info_t *__find_sem_info_by_key(key_t key)
 {
-    sem_info_t *sem_info;
-    // Iterate through the list of semaphore set.
-    list_for_each_decl (it, &semaphores_list) {
-        // Get the current entry.
-        sem_info = list_entry(it, sem_info_t, list);
-        // If semaphore set is valid, check the id.
-        if (sem_info && (sem_info->semid.sem_perm.key == key)) {
-            return sem_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_key(&sem_namespace, key);
+    return object ? list_entry(object, sem_info_t, ipc) : NULL;
 }
 
-/// @brief Adds the structure to the global list.
+/// @brief Adds the structure to the namespace, which gives it its id.
 /// @param sem_info the structure to add.
-static inline void __list_add_sem_info(sem_info_t *sem_info)
+/// @return 0 on success, -ENOSPC if there are too many semaphore sets.
+static inline int __add_sem_info(sem_info_t *sem_info)
 {
     assert(sem_info && "Received a NULL pointer.");
-    // Add the new sem_info at the end.
-    list_head_insert_before(&sem_info->list, &semaphores_list);
+    return (ipc_namespace_add(&sem_namespace, &sem_info->ipc, sem_info->semid.sem_perm.key) < 0) ? -ENOSPC : 0;
 }
 
-/// @brief Removes the structure from the global list.
+/// @brief Removes the structure from the namespace.
 /// @param sem_info the structure to remove.
-static inline void __list_remove_sem_info(sem_info_t *sem_info)
+static inline void __remove_sem_info(sem_info_t *sem_info)
 {
     assert(sem_info && "Received a NULL pointer.");
-    // Delete the sem_info from the list.
-    list_head_remove(&sem_info->list);
+    ipc_namespace_remove(&sem_namespace, &sem_info->ipc);
 }
 
 // ============================================================================
@@ -184,7 +181,7 @@ static inline void __list_remove_sem_info(sem_info_t *sem_info)
 /// @return 0 on success, 1 on failure.
 int sem_init(void)
 {
-    list_head_init(&semaphores_list);
+    ipc_namespace_init(&sem_namespace);
     return 0;
 }
 
@@ -202,14 +199,18 @@ long sys_semget(key_t key, int nsems, int semflg)
         // Exit when i find a unique key.
         do {
             key = (-rand());
-        } while (__list_find_sem_info_by_key(key));
+        } while (__find_sem_info_by_key(key));
         // We have a unique key, create the semaphore set.
         sem_info = __sem_info_alloc(key, nsems, semflg);
-        // Add the semaphore set to the list.
-        __list_add_sem_info(sem_info);
+        // Add the semaphore set to the namespace, which gives it its id.
+        if (__add_sem_info(sem_info) < 0) {
+            pr_err("There are too many semaphore sets.\n");
+            __sem_info_dealloc(sem_info);
+            return -ENOSPC;
+        }
     } else {
         // Get the semaphore set if it exists.
-        sem_info = __list_find_sem_info_by_key(key);
+        sem_info = __find_sem_info_by_key(key);
 
         // Check if a semaphore set with the given key already exists, but nsems is
         // larger than the number of semaphores in that set.
@@ -245,15 +246,74 @@ long sys_semget(key_t key, int nsems, int semflg)
         if (sem_info == NULL) {
             // Create the semaphore set.
             sem_info = __sem_info_alloc(key, nsems, semflg);
-            // Add the semaphore set to the list.
-            __list_add_sem_info(sem_info);
+            // Add the semaphore set to the namespace, which gives it its id.
+            if (__add_sem_info(sem_info) < 0) {
+                pr_err("There are too many semaphore sets.\n");
+                __sem_info_dealloc(sem_info);
+                return -ENOSPC;
+            }
         }
     }
     // Return the id of the semaphore set.
-    return sem_info->id;
+    return sem_info->ipc.id;
+}
+
+/// @brief Wakes up the processes waiting on all the semaphores of a set.
+/// @param sem_info the semaphore set.
+static inline void __sem_wake_up_all(sem_info_t *sem_info)
+{
+    for (unsigned i = 0; i < sem_info->semid.sem_nsems; ++i) {
+        wake_up(&sem_info->sem_wait[i]);
+    }
+}
+
+/// @brief Applies all the operations, or none of them.
+/// @param sem_info the semaphore set.
+/// @param sops the operations.
+/// @param nsops the number of operations.
+/// @param blocking where the index of the operation which would block is stored.
+/// @return 0 if they have been applied, 1 if one of them would block, -ERANGE
+///         if a semaphore would exceed its maximum value.
+static int __sem_apply(sem_info_t *sem_info, struct sembuf *sops, unsigned nsops, unsigned *blocking)
+{
+    int ret = 0;
+    unsigned i;
+    for (i = 0; i < nsops; ++i) {
+        struct sem *sem = &sem_info->sem_base[sops[i].sem_num];
+        int value       = (int)sem->sem_val + (int)sops[i].sem_op;
+        // Waiting for zero, or for the value to grow enough.
+        if (((sops[i].sem_op == 0) && (sem->sem_val != 0)) || (value < 0)) {
+            *blocking = i;
+            ret       = 1;
+            break;
+        }
+        if (value > SEMVMX) {
+            ret = -ERANGE;
+            break;
+        }
+        sem->sem_val = (unsigned short)value;
+    }
+    // Undo the operations already applied, in reverse.
+    if (ret) {
+        while (i-- > 0) {
+            sem_info->sem_base[sops[i].sem_num].sem_val -= sops[i].sem_op;
+        }
+        return ret;
+    }
+    // Update the pid of the process that did last op, and wake up the
+    // processes waiting on the semaphores that changed.
+    for (i = 0; i < nsops; ++i) {
+        sem_info->sem_base[sops[i].sem_num].sem_pid = sys_getpid();
+        if (sops[i].sem_op != 0) {
+            wake_up(&sem_info->sem_wait[sops[i].sem_num]);
+        }
+    }
+    // Update the time.
+    sem_info->semid.sem_otime = sys_time(NULL);
+    return 0;
 }
 
-long sys_semop(int semid, struct sembuf *sops, unsigned nsops)
+long sys_semtimedop(int semid, struct sembuf *sops, unsigned nsops, const struct timespec *timeout)
 {
     sem_info_t *sem_info = NULL;
     // The semid is less than zero.
@@ -266,55 +326,97 @@ long sys_semop(int semid, struct sembuf *sops, unsigned nsops)
         pr_err("The pointer to the operation is NULL.\n");
         return -EINVAL;
     }
-    // The value of nsops is negative.
-    if (nsops <= 0) {
-        pr_err("The value of nsops is negative.\n");
+    // The value of nsops is zero.
+    if (nsops == 0) {
+        pr_err("The value of nsops is zero.\n");
+        return -EINVAL;
+    }
+    // The value of nsops is larger than the operations of a single call.
+    if (nsops > SEMOPM) {
+        pr_err("The value of nsops is larger than %d.\n", SEMOPM);
+        return -E2BIG;
+    }
+    // The timeout is not valid.
+    if (timeout && ((timeout->tv_sec < 0) || (timeout->tv_nsec < 0) || (timeout->tv_nsec >= 1000000000))) {
+        pr_err("The timeout is not valid.\n");
         return -EINVAL;
     }
     // Search for the semaphore.
-    sem_info = __list_find_sem_info_by_id(semid);
+    sem_info = __find_sem_info_by_id(semid);
     // The semaphore set doesn't exist.
     if (!sem_info) {
         pr_err("The semaphore set doesn't exist.\n");
         return -EINVAL;
     }
-    // The value of sem_num is less than 0 or greater than or equal to the number of semaphores in the set.
-    if ((sops->sem_num < 0) || (sops->sem_num >= sem_info->semid.sem_nsems)) {
-        pr_err("The value of sem_num is less than 0 or greater than or equal "
-               "to the number of semaphores in the set.\n");
-        return -EFBIG;
+    // The value of sem_num is greater than or equal to the number of semaphores in the set.
+    for (unsigned i = 0; i < nsops; ++i) {
+        if (sops[i].sem_num >= sem_info->semid.sem_nsems) {
+            pr_err("The value of sem_num is greater than or equal to the "
+                   "number of semaphores in the set.\n");
+            return -EFBIG;
+        }
     }
     // Check if the semaphore set exists for the given key, but the calling
     // process does not have permission to access the set.
-    if (sem_info && !ipc_valid_permissions(O_RDWR, &sem_info->semid.sem_perm)) {
+    if (!ipc_valid_permissions(O_RDWR, &sem_info->semid.sem_perm)) {
         pr_err("The semaphore set exists for the given key, but the calling "
                "process does not have permission to access the set.\n");
         return -EACCES;
     }
-    // Update semop time.
-    sem_info->semid.sem_otime = sys_time(NULL);
-    // If the operation is negative then we need to check for possible blocking
-    // operation. If the value of the sem were to become negative then we return
-    // a special value.
-    if (((int)sem_info->sem_base[sops->sem_num].sem_val + (int)sops->sem_op) < 0) {
-        // The value would become negative, we cannot perform the operation.
-        return -EAGAIN;
+    task_struct *task = scheduler_get_current_process();
+    uint64_t deadline = timeout ? (hrtimer_get_ns() + timespec_to_ns(timeout)) : 0;
+    unsigned blocking;
+    int ret;
+    // If one of the operations would block, we wait for the value of its
+    // semaphore to change, unless we have been asked not to, and try again.
+    while ((ret = __sem_apply(sem_info, sops, nsops, &blocking)) > 0) {
+        if (sops[blocking].sem_flg & IPC_NOWAIT) {
+            return -EAGAIN;
+        }
+        if (timeout && (hrtimer_get_ns() >= deadline)) {
+            return -EAGAIN;
+        }
+        // Sleep, counting ourselves among the processes waiting for an
+        // increase, or for zero.
+        unsigned short sem_num = sops[blocking].sem_num;
+        int for_zero           = (sops[blocking].sem_op == 0);
+        if (for_zero) {
+            sem_info->sem_base[sem_num].sem_zcnt += 1;
+        } else {
+            sem_info->sem_base[sem_num].sem_ncnt += 1;
+        }
+        if (timeout) {
+            timer_wake_up_at(task, deadline);
+        }
+        int sleep = interruptible_sleep_on(&sem_info->sem_wait[sem_num]);
+        if (timeout) {
+            hrtimer_cancel(&task->sleep_timer);
+        }
+        // The semaphore set might have been removed while we were sleeping.
+        sem_info = __find_sem_info_by_id(semid);
+        if (!sem_info) {
+            return -EIDRM;
+        }
+        if (for_zero) {
+            sem_info->sem_base[sem_num].sem_zcnt -= 1;
+        } else {
+            sem_info->sem_base[sem_num].sem_ncnt -= 1;
+        }
+        if (sleep < 0) {
+            return sleep;
+        }
     }
-    // Update the semaphore value.
-    sem_info->sem_base[sops->sem_num].sem_val += sops->sem_op;
-    // Update the pid of the process that did last op.
-    sem_info->sem_base[sops->sem_num].sem_pid = sys_getpid();
-    // Update the time.
-    sem_info->semid.sem_ctime                 = sys_time(NULL);
-    return 0;
+    return ret;
 }
 
+long sys_semop(int semid, struct sembuf *sops, unsigned nsops) { return sys_semtimedop(semid, sops, nsops, NULL); }
+
 long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
 {
     sem_info_t *sem_info = NULL;
     task_struct *task    = NULL;
     // Search for the semaphore.
-    sem_info             = __list_find_sem_info_by_id(semid);
+    sem_info             = __find_sem_info_by_id(semid);
     // The semaphore set doesn't exist.
     if (!sem_info) {
         pr_err("The semaphore set doesn't exist.\n");
@@ -334,7 +436,9 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
             return -EPERM;
         }
         // Remove the set from the list.
-        __list_remove_sem_info(sem_info);
+        __remove_sem_info(sem_info);
+        // Wake up the blocked processes, they will find the set removed.
+        __sem_wake_up_all(sem_info);
         // Delete the set.
         __sem_info_dealloc(sem_info);
     } else if (cmd == SETVAL) {
@@ -366,6 +470,8 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
         sem_info->sem_base[semnum].sem_val = arg->val;
         // Update the last change time.
         sem_info->semid.sem_ctime          = sys_time(NULL);
+        // Wake up the processes waiting on the semaphore.
+        wake_up(&sem_info->sem_wait[semnum]);
     } else if (cmd == SETALL) {
         // Initialize all semaphore in the set referred to by semid, using the
         // values supplied in the array pointed to by arg.array.
@@ -392,6 +498,8 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
         }
         // Update the last change time.
         sem_info->semid.sem_ctime = sys_time(NULL);
+        // Wake up the processes waiting on the set.
+        __sem_wake_up_all(sem_info);
     } else if (cmd == IPC_STAT) {
         // Place a copy of the semid_ds data structure in the buffer pointed to by
         // arg.buf.
@@ -511,6 +619,58 @@ long sys_semctl(int semid, int semnum, int cmd, union semun *arg)
 // PROCFS FUNCTIONS
 // ============================================================================
 
+/// @brief Returns the record of `/proc/ipc/sem` at the given position.
+/// @param m The streaming state.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_sem_start(seq_file_t *m, off_t *pos) { return ipc_seq_find(&sem_namespace, pos); }
+
+/// @brief Returns the record of `/proc/ipc/sem` which follows the given one.
+/// @param m The streaming state.
+/// @param v The record.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_sem_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return ipc_seq_find(&sem_namespace, pos);
+}
+
+/// @brief Stops listing `/proc/ipc/sem`.
+/// @param m The streaming state.
+/// @param v The record.
+static void __procipc_sem_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats a record of `/proc/ipc/sem`.
+/// @param m The streaming state.
+/// @param v The record.
+/// @return 0.
+static int __procipc_sem_show(seq_file_t *m, void *v)
+{
+    if (v == IPC_SEQ_HEADER) {
+        seq_puts(m, "key      semid perms      nsems   uid   gid  cuid  cgid      "
+                    "otime      ctime\n");
+    } else if (v == IPC_SEQ_TRAILER) {
+        seq_puts(m, "\n");
+    } else {
+        sem_info_t *sem_info = list_entry(v, sem_info_t, ipc);
+        seq_printf(
+            m, "%8d %5d %10d %7d %5d %4d %5d %9d %10d %d\n", abs(sem_info->semid.sem_perm.key), sem_info->ipc.id,
+            sem_info->semid.sem_perm.mode, sem_info->semid.sem_nsems, sem_info->semid.sem_perm.uid,
+            sem_info->semid.sem_perm.gid, sem_info->semid.sem_perm.cuid, sem_info->semid.sem_perm.cgid,
+            sem_info->semid.sem_otime, sem_info->semid.sem_ctime);
+    }
+    return 0;
+}
+
+/// The iterator over the sets of semaphores, for `/proc/ipc/sem`.
+static const seq_operations_t procipc_sem_seq_operations = {
+    .start = __procipc_sem_start,
+    .stop  = __procipc_sem_stop,
+    .next  = __procipc_sem_next,
+    .show  = __procipc_sem_show,
+};
+
 /// @brief Read function for the proc system.
 /// @param file The file.
 /// @param buf Buffer where the read content must be placed.
@@ -523,42 +683,5 @@ ssize_t procipc_sem_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte
         pr_err("Received a NULL file.\n");
         return -ENOENT;
     }
-    size_t buffer_len    = 0;
-    size_t read_pos      = 0;
-    size_t ret           = 0;
-    ssize_t write_count  = 0;
-    sem_info_t *sem_info = NULL;
-    char buffer[BUFSIZ];
-
-    // Prepare a buffer.
-    memset(buffer, 0, BUFSIZ);
-    // Prepare the header.
-    ret = sprintf(
-        buffer, "key      semid perms      nsems   uid   gid  cuid  cgid      "
-                "otime      ctime\n");
-
-    // Iterate through the list of semaphore set.
-    list_for_each_decl (it, &semaphores_list) {
-        // Get the current entry.
-        sem_info = list_entry(it, sem_info_t, list);
-        // Add the line.
-        ret += sprintf(
-            buffer + ret, "%8d %5d %10d %7d %5d %4d %5d %9d %10d %d\n", abs(sem_info->semid.sem_perm.key), sem_info->id,
-            sem_info->semid.sem_perm.mode, sem_info->semid.sem_nsems, sem_info->semid.sem_perm.uid,
-            sem_info->semid.sem_perm.gid, sem_info->semid.sem_perm.cuid, sem_info->semid.sem_perm.cgid,
-            sem_info->semid.sem_otime, sem_info->semid.sem_ctime);
-    }
-    sprintf(buffer + ret, "\n");
-
-    // Perform read.
-    buffer_len = strlen(buffer);
-    read_pos   = offset;
-    if (read_pos < buffer_len) {
-        while ((write_count < nbyte) && (read_pos < buffer_len)) {
-            buf[write_count] = buffer[read_pos];
-            // Move the pointers.
-            ++read_pos, ++write_count;
-        }
-    }
-    return write_count;
+    return seq_read(file, &procipc_sem_seq_operations, buf, offset, nbyte);
 }
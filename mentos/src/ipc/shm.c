@@ -17,32 +17,36 @@
 #include "assert.h"
 #include "errno.h"
 #include "fcntl.h"
+#include "fs/seq_file.h"
 #include "list_head.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/vm_area.h"
 #include "mem/paging.h"
 #include "process/scheduler.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
+#include "sys/mman.h"
 
 // #include "process/process.h"
 
-///@brief A value to compute the shmid value.
-int __shm_id = 0;
-
 /// @brief Shared memory management structure.
-typedef struct {
-    /// @brief Shared memory ID.
-    int id;
+typedef struct shm_info {
+    /// @brief The id and the key of the shared memory.
+    ipc_object_t ipc;
     /// @brief Shared memory data structure.
     struct shmid_ds shmid;
-    /// @brief Location where shared memory is stored.
-    page_t *shm_location;
-    /// @brief List reference for shared memory structures.
-    list_head_t list;
+    /// @brief The number of pages of the shared memory.
+    uint32_t npages;
+    /// @brief The pages of the shared memory, NULL until they are touched.
+    page_t **pages;
+    /// @brief If the shared memory has been removed, and is freed along with
+    /// its last attachment.
+    int removed;
 } shm_info_t;
 
-/// @brief List of all current active shared memorys.
-list_head_t shm_list;
+/// @brief All the current active shared memories.
+static ipc_namespace_t shm_namespace;
 
 // ============================================================================
 // MEMORY MANAGEMENT (Private)
@@ -55,6 +59,11 @@ list_head_t shm_list;
 /// @return Pointer to the allocated shared memory structure, or NULL on failure.
 static inline shm_info_t *__shm_info_alloc(key_t key, size_t size, int shmflg)
 {
+    // Check if the shared memory is empty.
+    if (!size) {
+        pr_err("Cannot create an empty shared memory.\n");
+        return NULL;
+    }
     // Allocate memory for shm_info_t.
     shm_info_t *shm_info = (shm_info_t *)kmalloc(sizeof(shm_info_t));
     // Check if memory allocation for shm_info failed.
@@ -65,7 +74,6 @@ static inline shm_info_t *__shm_info_alloc(key_t key, size_t size, int shmflg)
     // Initialize the allocated memory to zero.
     memset(shm_info, 0, sizeof(shm_info_t));
     // Initialize shm_info values.
-    shm_info->id               = ++__shm_id;
     shm_info->shmid.shm_perm   = register_ipc(key, shmflg & 0x1FF);
     shm_info->shmid.shm_segsz  = size;
     shm_info->shmid.shm_atime  = 0;
@@ -74,16 +82,16 @@ static inline shm_info_t *__shm_info_alloc(key_t key, size_t size, int shmflg)
     shm_info->shmid.shm_cpid   = 0;
     shm_info->shmid.shm_lpid   = 0;
     shm_info->shmid.shm_nattch = 0;
-    // Determine the order for memory allocation.
-    uint32_t order             = find_nearest_order_greater(0, size);
-    // Allocate the shared memory pages.
-    shm_info->shm_location     = alloc_pages(GFP_KERNEL, order);
-    // Check if memory allocation for shm_location failed.
-    if (!shm_info->shm_location) {
-        pr_err("Failed to allocate shared memory pages.\n");
+    // The pages are allocated the first time they are touched.
+    shm_info->npages           = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    shm_info->pages            = (page_t **)kmalloc(shm_info->npages * sizeof(page_t *));
+    // Check if memory allocation for the pages failed.
+    if (!shm_info->pages) {
+        pr_err("Failed to allocate the pages of the shared memory.\n");
         kfree(shm_info);
         return NULL;
     }
+    memset(shm_info->pages, 0, shm_info->npages * sizeof(page_t *));
     // Return the allocated shared memory structure.
     return shm_info;
 }
@@ -93,88 +101,56 @@ static inline shm_info_t *__shm_info_alloc(key_t key, size_t size, int shmflg)
 static inline void __shm_info_dealloc(shm_info_t *shm_info)
 {
     assert(shm_info && "Received a NULL pointer.");
-    // Free the shared memory.
-    free_pages(shm_info->shm_location);
+    // Drop the references to the pages, the areas still mapping them keep theirs.
+    for (uint32_t i = 0; i < shm_info->npages; ++i) {
+        if (shm_info->pages[i]) {
+            page_cache_put(shm_info->pages[i]);
+        }
+    }
+    kfree(shm_info->pages);
     // Deallocate the shmid memory.
     kfree(shm_info);
 }
 
 // ============================================================================
-// LIST MANAGEMENT/SEARCH FUNCTIONS (Private)
+// NAMESPACE MANAGEMENT/SEARCH FUNCTIONS (Private)
 // ============================================================================
 
 /// @brief Searches for the shared memory with the given id.
 /// @param shmid the id we are searching.
 /// @return the shared memory with the given id.
-static inline shm_info_t *__list_find_shm_info_by_id(int shmid)
+static inline shm_info_t *__find_shm_info_by_id(int shmid)
 {
-    shm_info_t *shm_info;
-    // Iterate through the list of shared memories.
-    list_for_each_decl (it, &shm_list) {
-        // Get the current entry.
-        shm_info = list_entry(it, shm_info_t, list);
-        // If shared memories is valid, check the id.
-        if (shm_info && (shm_info->id == shmid)) {
-            return shm_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_id(&shm_namespace, shmid);
+    return object ? list_entry(object, shm_info_t, ipc) : NULL;
 }
 
 /// @brief Searches for the shared memory with the given key.
 /// @param key the key we are searching.
 /// @return the shared memory with the given key.
-static inline shm_info_t *__list_find_shm_info_by_key(key_t key)
+static inline shm_info_t *__find_shm_info_by_key(key_t key)
 {
-    shm_info_t *shm_info;
-    // Iterate through the list of shared memories.
-    list_for_each_decl (it, &shm_list) {
-        // Get the current entry.
-        shm_info = list_entry(it, shm_info_t, list);
-        // If shared memories is valid, check the id.
-        if (shm_info && (shm_info->shmid.shm_perm.key == key)) {
-            return shm_info;
-        }
-    }
-    return NULL;
+    ipc_object_t *object = ipc_find_by_key(&shm_namespace, key);
+    return object ? list_entry(object, shm_info_t, ipc) : NULL;
 }
 
-/// @brief Searches for the shared memory with the given page.
-/// @param page the page we are searching.
-/// @return the shared memory with the given page.
-static inline shm_info_t *__list_find_shm_info_by_page(page_t *page)
-{
-    shm_info_t *shm_info;
-    // Iterate through the list of shared memories.
-    list_for_each_decl (it, &shm_list) {
-        // Get the current entry.
-        shm_info = list_entry(it, shm_info_t, list);
-        // If shared memories is valid, check the id.
-        if (shm_info && (shm_info->shm_location == page)) {
-            return shm_info;
-        }
-    }
-    return NULL;
-}
-
-/// @brief Adds a shared memory info structure to the list.
+/// @brief Adds a shared memory info structure to the namespace, which gives it its id.
 /// @param shm_info Pointer to the shared memory info structure.
-static inline void __list_add_shm_info(shm_info_t *shm_info)
+/// @return 0 on success, -ENOSPC if there are too many shared memories.
+static inline int __add_shm_info(shm_info_t *shm_info)
 {
     // Check if shm_info is NULL.
     assert(shm_info && "Received a NULL pointer.");
-    // Add the new item at the end.
-    list_head_insert_before(&shm_info->list, &shm_list);
+    return (ipc_namespace_add(&shm_namespace, &shm_info->ipc, shm_info->shmid.shm_perm.key) < 0) ? -ENOSPC : 0;
 }
 
-/// @brief Removes a shared memory info structure from the list.
+/// @brief Removes a shared memory info structure from the namespace.
 /// @param shm_info Pointer to the shared memory info structure.
-static inline void __list_remove_shm_info(shm_info_t *shm_info)
+static inline void __remove_shm_info(shm_info_t *shm_info)
 {
     // Check if shm_info is NULL.
     assert(shm_info && "Received a NULL pointer.");
-    // Delete the item from the list.
-    list_head_remove(&shm_info->list);
+    ipc_namespace_remove(&shm_namespace, &shm_info->ipc);
 }
 
 // ============================================================================
@@ -183,7 +159,7 @@ static inline void __list_remove_shm_info(shm_info_t *shm_info)
 
 int shm_init(void)
 {
-    list_head_init(&shm_list);
+    ipc_namespace_init(&shm_namespace);
     return 0;
 }
 
@@ -195,17 +171,21 @@ long sys_shmget(key_t key, size_t size, int shmflg)
         // Exit when i find a unique key.
         do {
             key = (-rand());
-        } while (__list_find_shm_info_by_key(key));
+        } while (__find_shm_info_by_key(key));
         // We have a unique key, create the shared memory.
         shm_info = __shm_info_alloc(key, size, shmflg);
         if (!shm_info) {
             return -ENOENT;
         }
-        // Add the shared memory to the list.
-        __list_add_shm_info(shm_info);
+        // Add the shared memory to the namespace, which gives it its id.
+        if (__add_shm_info(shm_info) < 0) {
+            pr_err("There are too many shared memories.\n");
+            __shm_info_dealloc(shm_info);
+            return -ENOSPC;
+        }
     } else {
         // Get the shared memory if it exists.
-        shm_info = __list_find_shm_info_by_key(key);
+        shm_info = __find_shm_info_by_key(key);
         // Check if no shared memory exists for the given key and the flags did not specify IPC_CREAT.
         if (!shm_info && !(shmflg & IPC_CREAT)) {
             pr_err("No shared memory exists for the given key and the flags "
@@ -232,12 +212,16 @@ long sys_shmget(key_t key, size_t size, int shmflg)
             if (!shm_info) {
                 return -ENOENT;
             }
-            // Add the shared memory to the list.
-            __list_add_shm_info(shm_info);
+            // Add the shared memory to the namespace, which gives it its id.
+            if (__add_shm_info(shm_info) < 0) {
+                pr_err("There are too many shared memories.\n");
+                __shm_info_dealloc(shm_info);
+                return -ENOSPC;
+            }
         }
     }
     // Return the id of the shared memory.
-    return shm_info->id;
+    return shm_info->ipc.id;
 }
 
 void *sys_shmat(int shmid, const void *shmaddr, int shmflg)
@@ -245,8 +229,8 @@ void *sys_shmat(int shmid, const void *shmaddr, int shmflg)
     shm_info_t *shm_info = NULL;
     task_struct *task    = NULL;
     uint32_t vm_start;
-    uint32_t phy_start;
-    uint32_t flags = MM_RW | MM_PRESENT | MM_USER | MM_UPDADDR;
+    // The pages are not present, they are taken from the shared memory when touched.
+    uint32_t flags = MM_RW | MM_USER | MM_COW;
 
     // The id is less than zero.
     if (shmid < 0) {
@@ -254,7 +238,7 @@ void *sys_shmat(int shmid, const void *shmaddr, int shmflg)
         return (void *)-EINVAL;
     }
     // Get the shared memory if it exists.
-    shm_info = __list_find_shm_info_by_id(shmid);
+    shm_info = __find_shm_info_by_id(shmid);
     // Check if no shared memory exists for the given key and the flags did not specify IPC_CREAT.
     if (!shm_info) {
         pr_err("No shared memory exists for the given id and the flags did not "
@@ -279,45 +263,46 @@ void *sys_shmat(int shmid, const void *shmaddr, int shmflg)
     // Get the calling task.
     task = scheduler_get_current_process();
     assert(task && "Failed to get the current running process.");
-    // Get the phyisical address from the allocated pages.
-    phy_start = get_physical_address_from_page(shm_info->shm_location);
     // Find the virtual address for the new area.
-    if (vm_area_search_free_area(task->mm, shm_info->shmid.shm_segsz, &vm_start)) {
+    size_t size = shm_info->npages * PAGE_SIZE;
+    if (vm_area_search_free_area(task->mm, size, &vm_start)) {
         pr_err("We failed to find space for the new virtual memory area.\n");
-        return (void *)-EACCES;
+        return (void *)-ENOMEM;
     }
-    mem_upd_vm_area(task->mm->pgd, vm_start, phy_start, shm_info->shmid.shm_segsz, flags);
+    vm_area_struct_t *area = vm_area_create(task->mm, vm_start, size, flags, GFP_HIGHUSER);
+    if (!area) {
+        pr_err("We failed to create the new virtual memory area.\n");
+        return (void *)-ENOMEM;
+    }
+    // The writes are seen by all the processes attached to the shared memory.
+    area->vm_flags = MAP_SHARED;
+    area->vm_shm   = shm_info;
+    // Update the attach time, and the number of attachments.
+    shm_info->shmid.shm_atime = sys_time(NULL);
+    shm_info->shmid.shm_lpid  = sys_getpid();
+    ++shm_info->shmid.shm_nattch;
     return (void *)vm_start;
 }
 
 long sys_shmdt(const void *shmaddr)
 {
-    shm_info_t *shm_info = NULL;
-    task_struct *task    = NULL;
-    uint32_t phy_start;
-    size_t size;
-    page_t *page;
+    task_struct *task = NULL;
 
     // Get the calling task.
     task = scheduler_get_current_process();
     assert(task && "Failed to get the current running process.");
-    // Get the page.
-    page = mem_virtual_to_page(task->mm->pgd, (uint32_t)shmaddr, &size);
-    // Check if we can find the page.
-    if (page == NULL) {
-        pr_err("Cannot retrieve the page from the give address.\n");
-        return -ENOENT;
-    }
-    shm_info = __list_find_shm_info_by_page(page);
+    // Search for the area attached at the given address.
+    vm_area_struct_t *area = vm_area_find(task->mm, (uint32_t)shmaddr);
     // Check if no shared memory exists for the given address.
-    if (!shm_info) {
+    if (!area || !area->vm_shm) {
         pr_err("No shared memory exists for the given address.\n");
-        return -ENOENT;
+        return -EINVAL;
+    }
+    // Destroying the area drops its references to the pages, and detaches it.
+    if (vm_area_destroy(task->mm, area) < 0) {
+        pr_err("Failed to destroy the area of the shared memory.\n");
+        return -EINVAL;
     }
-    // Get the phyisical address from the allocated pages.
-    phy_start = get_physical_address_from_page(shm_info->shm_location);
-    // Set all virtual pages as not present.
-    mem_upd_vm_area(task->mm->pgd, (uint32_t)shmaddr, phy_start, shm_info->shmid.shm_segsz, MM_GLOBAL);
     return 0;
 }
 
@@ -327,7 +312,7 @@ long sys_shmctl(int shmid, int cmd, struct shmid_ds *buf)
     task_struct *task    = NULL;
 
     // Search for the shared memory.
-    shm_info = __list_find_shm_info_by_id(shmid);
+    shm_info = __find_shm_info_by_id(shmid);
     // The shared memory doesn't exist.
     if (!shm_info) {
         pr_err("The shared memory doesn't exist.\n");
@@ -345,24 +330,112 @@ long sys_shmctl(int shmid, int cmd, struct shmid_ds *buf)
                    "shared memory.\n");
             return -EPERM;
         }
-        // Remove the set from the list.
-        __list_remove_shm_info(shm_info);
-        // Delete the set.
-        __shm_info_dealloc(shm_info);
+        // Remove the shared memory from the namespace, no one can attach it anymore.
+        __remove_shm_info(shm_info);
+        // Delete the shared memory, now or along with its last attachment.
+        shm_info->removed = 1;
+        if (!shm_info->shmid.shm_nattch) {
+            __shm_info_dealloc(shm_info);
+        }
     }
     return 0;
 }
 
+page_t *shm_get_page(shm_info_t *shm, uint32_t offset)
+{
+    uint32_t index = offset / PAGE_SIZE;
+    if (index >= shm->npages) {
+        return NULL;
+    }
+    // The page is allocated, zero-filled, the first time it is touched.
+    if (!shm->pages[index]) {
+        shm->pages[index] = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+        if (!shm->pages[index]) {
+            pr_err("Failed to allocate a page of the shared memory.\n");
+            return NULL;
+        }
+    }
+    // The reference of the shared memory keeps the page, the caller gets its own.
+    page_inc(shm->pages[index]);
+    return shm->pages[index];
+}
+
+void shm_attach(shm_info_t *shm) { ++shm->shmid.shm_nattch; }
+
+void shm_detach(shm_info_t *shm)
+{
+    shm->shmid.shm_dtime = sys_time(NULL);
+    shm->shmid.shm_lpid  = sys_getpid();
+    --shm->shmid.shm_nattch;
+    // A removed shared memory goes away along with its last attachment.
+    if (shm->removed && !shm->shmid.shm_nattch) {
+        __shm_info_dealloc(shm);
+    }
+}
+
 // ============================================================================
 // PROCFS FUNCTIONS
 // ============================================================================
 
-/// @brief Reads data from a shared memory segment.
+/// @brief Returns the record of `/proc/ipc/shm` at the given position.
+/// @param m The streaming state.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_shm_start(seq_file_t *m, off_t *pos) { return ipc_seq_find(&shm_namespace, pos); }
+
+/// @brief Returns the record of `/proc/ipc/shm` which follows the given one.
+/// @param m The streaming state.
+/// @param v The record.
+/// @param pos The position.
+/// @return The record, NULL past the last one.
+static void *__procipc_shm_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return ipc_seq_find(&shm_namespace, pos);
+}
+
+/// @brief Stops listing `/proc/ipc/shm`.
+/// @param m The streaming state.
+/// @param v The record.
+static void __procipc_shm_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats a record of `/proc/ipc/shm`.
+/// @param m The streaming state.
+/// @param v The record.
+/// @return 0.
+static int __procipc_shm_show(seq_file_t *m, void *v)
+{
+    if (v == IPC_SEQ_HEADER) {
+        seq_puts(m, "key      shmid perms      segsz   uid   gid  cuid  cgid      "
+                    "atime      dtime      ctime   cpid   lpid nattch\n");
+    } else if (v == IPC_SEQ_TRAILER) {
+        seq_puts(m, "\n");
+    } else {
+        shm_info_t *shm_info = list_entry(v, shm_info_t, ipc);
+        seq_printf(
+            m, "%8d %5d %10d %7d %5d %4d %5d %9d %10d %10d %10d %5d %5d %5d\n", abs(shm_info->shmid.shm_perm.key),
+            shm_info->ipc.id, shm_info->shmid.shm_perm.mode, shm_info->shmid.shm_segsz, shm_info->shmid.shm_perm.uid,
+            shm_info->shmid.shm_perm.gid, shm_info->shmid.shm_perm.cuid, shm_info->shmid.shm_perm.cgid,
+            shm_info->shmid.shm_atime, shm_info->shmid.shm_dtime, shm_info->shmid.shm_ctime, shm_info->shmid.shm_cpid,
+            shm_info->shmid.shm_lpid, shm_info->shmid.shm_nattch);
+    }
+    return 0;
+}
+
+/// The iterator over the shared memories, for `/proc/ipc/shm`.
+static const seq_operations_t procipc_shm_seq_operations = {
+    .start = __procipc_shm_start,
+    .stop  = __procipc_shm_stop,
+    .next  = __procipc_shm_next,
+    .show  = __procipc_shm_show,
+};
+
+/// @brief Reads the list of the shared memories.
 /// @param file Pointer to the file structure associated with the shared memory.
 /// @param buf Buffer where the read data will be stored.
 /// @param offset Offset from where to start reading.
 /// @param nbyte Number of bytes to read.
-/// @return Number of bytes read on success, or -1 on error.
+/// @return Number of bytes read on success, or -errno on error.
 ssize_t procipc_shm_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
 {
     // Check if file is NULL.
@@ -370,53 +443,5 @@ ssize_t procipc_shm_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte
         pr_err("Received a NULL file.\n");
         return -ENOENT;
     }
-
-    size_t buffer_len    = 0;
-    size_t read_pos      = 0;
-    size_t ret           = 0;
-    ssize_t write_count  = 0;
-    shm_info_t *shm_info = NULL;
-    char buffer[BUFSIZ];
-
-    // Prepare a buffer and initialize it to zero.
-    memset(buffer, 0, BUFSIZ);
-
-    // Prepare the header.
-    ret = sprintf(
-        buffer, "key      shmid perms      segsz   uid   gid  cuid  cgid      "
-                "atime      dtime      ctime   cpid   lpid nattch\n");
-
-    // Iterate through the list of shared memory.
-    list_for_each_decl (it, &shm_list) {
-        // Get the current entry from the list.
-        shm_info = list_entry(it, shm_info_t, list);
-
-        // Add information about the current shared memory entry to the buffer.
-        ret += sprintf(
-            buffer + ret, "%8d %5d %10d %7d %5d %4d %5d %9d %10d %10d %10d %5d %5d %5d\n",
-            abs(shm_info->shmid.shm_perm.key), shm_info->id, shm_info->shmid.shm_perm.mode, shm_info->shmid.shm_segsz,
-            shm_info->shmid.shm_perm.uid, shm_info->shmid.shm_perm.gid, shm_info->shmid.shm_perm.cuid,
-            shm_info->shmid.shm_perm.cgid, shm_info->shmid.shm_atime, shm_info->shmid.shm_dtime,
-            shm_info->shmid.shm_ctime, shm_info->shmid.shm_cpid, shm_info->shmid.shm_lpid, shm_info->shmid.shm_nattch);
-    }
-
-    // Terminate the buffer with a newline.
-    sprintf(buffer + ret, "\n");
-
-    // Get the length of the buffer.
-    buffer_len = strlen(buffer);
-    read_pos   = offset;
-
-    // Perform the read operation if offset is within bounds.
-    if (read_pos < buffer_len) {
-        while ((write_count < nbyte) && (read_pos < buffer_len)) {
-            buf[write_count] = buffer[read_pos];
-            // Move the pointers.
-            ++read_pos;
-            ++write_count;
-        }
-    }
-
-    // Return the number of bytes read.
-    return write_count;
+    return seq_read(file, &procipc_shm_seq_operations, buf, offset, nbyte);
 }
@@ -19,27 +19,42 @@
 #include "drivers/mem.h"
 #include "drivers/ps2.h"
 #include "drivers/rtc.h"
+#include "drivers/serial.h"
+#include "drivers/virtio_blk.h"
+#include "fs/blkdev.h"
 #include "fs/ext2.h"
+#include "fs/initramfs.h"
 #include "fs/procfs.h"
+#include "fs/tmpfs.h"
 #include "fs/vfs.h"
+#include "hardware/acpi.h"
+#include "hardware/hrtimer.h"
+#include "hardware/ioapic.h"
 #include "hardware/pic8259.h"
+#include "hardware/pmu.h"
+#include "hardware/smp.h"
 #include "hardware/timer.h"
 #include "io/proc_modules.h"
 #include "io/vga/vga.h"
 #include "io/video.h"
 #include "ipc/ipc.h"
+#include "klib/div64.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/mm/vmem.h"
 #include "process/scheduler.h"
 #include "process/scheduler_feedback.h"
+#include "process/workqueue.h"
 #include "resource_tracing.h"
 #include "stdio.h"
 #include "string.h"
+#include "sys/initcall.h"
 #include "sys/module.h"
 #include "sys/msg.h"
 #include "sys/sem.h"
 #include "sys/shm.h"
+#include "system/softirq.h"
 #include "system/syscall.h"
+#include "system/vdso.h"
 #include "version.h"
 
 /// Describe start address of grub multiboot modules.
@@ -83,6 +98,8 @@ boot_info_t boot_info;
 
 /// Flag indicating if we are running tests instead of an interactive session
 int runtests = 0;
+/// Flag indicating if we are running the benchmarks instead of an interactive session
+int runbench = 0;
 
 /// @brief Prints [OK] at the current row and column 60.
 static inline void print_ok(void)
@@ -106,6 +123,49 @@ static inline void print_fail(void)
     video_puts("[FAIL]\n");
 }
 
+/// @brief Scans the block devices, and mounts the EXT2 root on top of whatever
+/// is mounted at `/` already.
+/// @return 0 on success, 1 on failure.
+static int mount_root_disk(void)
+{
+    if (ata_initialize()) {
+        pr_emerg("Failed to initialize ATA devices!\n");
+        return 1;
+    }
+    // The AHCI disks are never the root, they are probed by a deferred initcall.
+    if (virtio_blk_initialize()) {
+        pr_err("Failed to initialize virtio block devices!\n");
+    }
+    // The root is the first IDE drive, or the first virtio one if there is none.
+    const char *root_device = "/dev/hda";
+    super_block_t *root_sb  = vfs_get_superblock(root_device);
+    if (!root_sb || strcmp(root_sb->path, root_device)) {
+        root_device = "/dev/vda";
+    }
+    if (vfs_mount("ext2", "/", root_device, NULL)) {
+        pr_emerg("Failed to mount EXT2 filesystem...\n");
+        return 1;
+    }
+    pr_notice("Mounted `%s` as the root.\n", root_device);
+    return 0;
+}
+
+/// If the root is the initramfs, and the disk is mounted on top of it later on.
+static int root_on_initramfs = 0;
+
+/// @brief Mounts the disk, once init is already running from the initramfs.
+/// @return 0 on success, 1 on failure.
+static int mount_deferred_root_disk(void)
+{
+    if (root_on_initramfs && mount_root_disk()) {
+        pr_err("The system keeps running from the initramfs.\n");
+        return 1;
+    }
+    return 0;
+}
+
+deferred_initcall(mount_deferred_root_disk, NULL);
+
 /// @brief Entry point of the kernel.
 /// @param boot_informations Information concerning the boot.
 /// @return The exit status of the kernel.
@@ -188,6 +248,7 @@ int kmain(boot_info_t *boot_informations)
     pr_notice("Initialize IRQ...\n");
     printf("Initialize IRQ...");
     pic8259_init_irq();
+    softirq_initialize();
     print_ok();
 
     //==========================================================================
@@ -211,12 +272,54 @@ int kmain(boot_info_t *boot_informations)
     }
     print_ok();
 
+#if defined(VGA_MODE_BOCHS_VBE)
+    //==========================================================================
+    pr_notice("Initialize the linear frame buffer.\n");
+    printf("Initialize the linear frame buffer...");
+    // Without the video card, the console stays in text mode.
+    if (vga_initialize_vbe() < 0) {
+        print_fail();
+    } else {
+        print_ok();
+    }
+#endif
+
+    //==========================================================================
+    pr_notice("Discover the CPUs.\n");
+    printf("Discovering the CPUs...");
+    smp_initialize();
+    acpi_initialize();
+    print_ok();
+
     //==========================================================================
     pr_notice("Install the timer.\n");
     printf("Setting up timer...");
     timer_install();
     print_ok();
 
+    //==========================================================================
+    pr_notice("Initialize the performance counters.\n");
+    printf("Setting up the performance counters...");
+    // They are optional, without them perf_event_open() fails with ENODEV.
+    pmu_initialize();
+    print_ok();
+
+    //==========================================================================
+    pr_notice("Initialize the I/O APIC.\n");
+    printf("Setting up the I/O APIC...");
+    // Without an I/O APIC, the IRQs keep going through the PIC.
+    ioapic_initialize();
+    print_ok();
+
+    //==========================================================================
+    pr_notice("Initialize the shared page.\n");
+    printf("Setting up the shared page...");
+    if (vdso_initialize() < 0) {
+        print_fail();
+        return 1;
+    }
+    print_ok();
+
     //==========================================================================
     pr_notice("Install RTC.\n");
     printf("Setting up RTC...");
@@ -230,15 +333,40 @@ int kmain(boot_info_t *boot_informations)
     print_ok();
 
     //==========================================================================
-    // Scan for ata devices.
-    pr_notice("Initialize ATA devices...\n");
-    printf("Initialize ATA devices...");
-    if (ata_initialize()) {
-        pr_emerg("Failed to initialize ATA devices!\n");
+    pr_notice("Initialize the block I/O layer.\n");
+    printf("Initialize the block I/O layer...");
+    if (blkdev_initialize()) {
+        print_fail();
+        return 1;
+    }
+    print_ok();
+
+    //==========================================================================
+    pr_notice("Initialize 'tmpfs'...\n");
+    printf("Initialize 'tmpfs'...");
+    if (tmpfs_module_init()) {
+        print_fail();
+        pr_emerg("Failed to register `tmpfs`!\n");
         return 1;
     }
     print_ok();
 
+    //==========================================================================
+    // An initramfs loaded by the bootloader becomes the root, and the disks are
+    // brought up by a kernel thread, while init already runs from memory.
+    multiboot_module_t *initramfs = initramfs_find();
+    if (initramfs) {
+        pr_notice("Unpack the initramfs...\n");
+        printf("Unpack the initramfs...");
+        if (vfs_mount("tmpfs", "/", NULL, NULL) || initramfs_unpack(initramfs, "/")) {
+            print_fail();
+            pr_emerg("Failed to unpack the initramfs!\n");
+            return 1;
+        }
+        root_on_initramfs = 1;
+        print_ok();
+    }
+
     //==========================================================================
     pr_notice("Initialize EXT2 filesystem...\n");
     printf("Initialize EXT2 filesystem...");
@@ -249,13 +377,15 @@ int kmain(boot_info_t *boot_informations)
     print_ok();
 
     //==========================================================================
-    pr_notice("Mount EXT2 filesystem...\n");
-    printf("Mount EXT2 filesystem...");
-    if (vfs_mount("ext2", "/", "/dev/hda")) {
-        pr_emerg("Failed to mount EXT2 filesystem...\n");
-        return 1;
+    if (!root_on_initramfs) {
+        pr_notice("Mount the root disk...\n");
+        printf("Mount the root disk...");
+        if (mount_root_disk()) {
+            print_fail();
+            return 1;
+        }
+        print_ok();
     }
-    print_ok();
 
     //==========================================================================
     pr_notice("    Initialize memory devices...\n");
@@ -267,6 +397,16 @@ int kmain(boot_info_t *boot_informations)
     }
     print_ok();
 
+    //==========================================================================
+    pr_notice("    Initialize the serial port...\n");
+    printf("    Initialize the serial port...");
+    if (serial_initialize()) {
+        print_fail();
+        pr_emerg("Failed to initialize the serial port!\n");
+        return 1;
+    }
+    print_ok();
+
     //==========================================================================
     pr_notice("    Initialize 'procfs'...\n");
     printf("    Initialize 'procfs'...");
@@ -280,41 +420,43 @@ int kmain(boot_info_t *boot_informations)
     //==========================================================================
     pr_notice("    Mounting 'procfs'...\n");
     printf("    Mounting 'procfs'...");
-    if (vfs_mount("procfs", "/proc", NULL)) {
+    if (vfs_mount("procfs", "/proc", NULL, NULL)) {
         pr_emerg("Failed to mount procfs at `/proc`!\n");
         return 1;
     }
     print_ok();
 
     //==========================================================================
-    pr_notice("Initialize video procfs file...\n");
-    printf("Initialize video procfs file...");
-    if (procv_module_init()) {
-        print_fail();
-        pr_emerg("Failed to initialize `/proc/video`!\n");
+    pr_notice("    Mounting 'tmpfs'...\n");
+    printf("    Mounting 'tmpfs'...");
+    if (vfs_mount("tmpfs", "/dev/shm", NULL, NULL) || vfs_mount("tmpfs", "/tmp", NULL, NULL)) {
+        pr_emerg("Failed to mount tmpfs at `/dev/shm` and `/tmp`!\n");
         return 1;
     }
     print_ok();
 
     //==========================================================================
-    pr_notice("Initialize system procfs file...\n");
-    printf("Initialize system procfs file...");
-    if (procs_module_init()) {
+    // The files of procfs, `/proc/video` among them, which init needs.
+    pr_notice("Run the filesystem initcalls...\n");
+    printf("Run the filesystem initcalls...");
+    if (initcall_run_level(INITCALL_FS)) {
         print_fail();
-        pr_emerg("Failed to initialize proc system entries!\n");
+        pr_emerg("Failed to run the filesystem initcalls!\n");
         return 1;
     }
     print_ok();
 
     //==========================================================================
-    pr_notice("Initialize IPC information system...\n");
-    printf("Initialize IPC information system...");
-    if (procipc_module_init()) {
+    // The devices which do not need probing, like the network stack, which
+    // works without a card through the loopback.
+    pr_notice("Run the device initcalls...\n");
+    printf("Run the device initcalls...");
+    if (initcall_run_level(INITCALL_DEVICE)) {
+        pr_err("Failed to run some of the device initcalls!\n");
         print_fail();
-        pr_emerg("Failed to initialize the IPC information system!\n");
-        return 1;
+    } else {
+        print_ok();
     }
-    print_ok();
 
     //==========================================================================
     pr_notice("Initialize IPC/SEM system...\n");
@@ -426,6 +568,10 @@ int kmain(boot_info_t *boot_informations)
                bitmask_check(boot_info.multiboot_header->flags, MULTIBOOT_FLAG_CMDLINE) &&
                strcmp((char *)boot_info.multiboot_header->cmdline, "runtests") == 0;
 
+    runbench = boot_info.multiboot_header->flags == 0x1a67 &&
+               bitmask_check(boot_info.multiboot_header->flags, MULTIBOOT_FLAG_CMDLINE) &&
+               strcmp((char *)boot_info.multiboot_header->cmdline, "runbench") == 0;
+
     if (runtests) {
         pr_notice("Creating runtests process...\n");
         printf("Creating runtests process...");
@@ -433,6 +579,13 @@ int kmain(boot_info_t *boot_informations)
             print_fail();
             return 1;
         }
+    } else if (runbench) {
+        pr_notice("Creating runbench process...\n");
+        printf("Creating runbench process...");
+        if (process_create_init("/bin/runbench")) {
+            print_fail();
+            return 1;
+        }
     } else {
         pr_notice("Creating init process...\n");
         printf("Creating init process...");
@@ -443,6 +596,30 @@ int kmain(boot_info_t *boot_informations)
     }
     print_ok();
 
+    //==========================================================================
+    pr_notice("Initialize the workqueues...\n");
+    printf("Initialize the workqueues...");
+    if (workqueue_initialize() < 0) {
+        print_fail();
+        return 1;
+    }
+    print_ok();
+    // The video is refreshed, and the kernel log drained, by the worker of
+    // the system, from now on.
+    video_start_refresh();
+    dbg_start_drain();
+
+    //==========================================================================
+    // The slow probing of the devices runs inside kernel threads, while init
+    // starts, each one logs how long it took.
+    pr_notice("Start the deferred initcalls...\n");
+    printf("Start the deferred initcalls...");
+    if (initcall_run_deferred()) {
+        print_fail();
+    } else {
+        print_ok();
+    }
+
     //==========================================================================
     pr_notice("Initialize floating point unit...\n");
     printf("Initialize floating point unit...");
@@ -462,7 +639,7 @@ int kmain(boot_info_t *boot_informations)
     print_ok();
 
     // We have completed the booting procedure.
-    pr_notice("Booting done, jumping into init process.\n");
+    pr_notice("Booting done after %u ms, jumping into init process.\n", div64_32(hrtimer_get_ns(), 1000000, NULL));
     // Switch to the page directory of init.
     paging_switch_pgd(init_process->mm->pgd);
     // Jump into init process.
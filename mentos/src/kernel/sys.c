@@ -4,9 +4,13 @@
 /// See LICENSE.md for details.
 
 #include "errno.h"
+#include "hardware/timer.h"
 #include "klib/mutex.h"
 #include "klib/stdatomic.h"
+#include "limits.h"
+#include "process/scheduler.h"
 #include "stdio.h"
+#include "sys/prctl.h"
 #include "sys/reboot.h"
 
 /// @brief Powers off the machine.
@@ -34,7 +38,7 @@ static void kernel_power_off(void)
 
 int sys_reboot(int magic1, int magic2, unsigned int cmd, void *arg)
 {
-    static mutex_t reboot_mutex;
+    static mutex_t reboot_mutex = MUTEX_INIT(reboot_mutex);
 
     // For safety, we require "magic" arguments.
     if (magic1 != LINUX_REBOOT_MAGIC1 || (magic2 != LINUX_REBOOT_MAGIC2 && magic2 != LINUX_REBOOT_MAGIC2A &&
@@ -42,7 +46,7 @@ int sys_reboot(int magic1, int magic2, unsigned int cmd, void *arg)
         return -EINVAL;
     }
 
-    mutex_lock(&reboot_mutex, 0);
+    mutex_lock(&reboot_mutex);
 
     switch (cmd) {
     case LINUX_REBOOT_CMD_RESTART:
@@ -63,9 +67,29 @@ int sys_reboot(int magic1, int magic2, unsigned int cmd, void *arg)
     case LINUX_REBOOT_CMD_SW_SUSPEND:
         break;
     default:
+        mutex_unlock(&reboot_mutex);
         return -EINVAL;
     }
     mutex_unlock(&reboot_mutex);
 
     return 0;
 }
+
+int sys_prctl(int option, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5)
+{
+    task_struct *task = scheduler_get_current_process();
+    switch (option) {
+    case PR_SET_TIMERSLACK:
+        // Zero goes back to the default slack, which PR_GET_TIMERSLACK must
+        // be able to return.
+        if (arg2 > INT_MAX) {
+            return -EINVAL;
+        }
+        task->timer_slack_ns = arg2 ? (uint32_t)arg2 : TIMER_SLACK_NS;
+        return 0;
+    case PR_GET_TIMERSLACK:
+        return (int)task->timer_slack_ns;
+    default:
+        return -EINVAL;
+    }
+}
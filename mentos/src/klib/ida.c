@@ -0,0 +1,85 @@
+/// @file ida.c
+/// @brief Allocator of small integer identifiers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "klib/ida.h"
+
+#include "math.h"
+#include "string.h"
+#include "sys/bitops.h"
+
+/// @brief Searches for a free identifier, skipping the full words at once.
+/// @param ida the allocator.
+/// @param from the first identifier of the search.
+/// @param to the identifier the search stops at, it is not searched.
+/// @return the identifier, -1 if there is none.
+static inline int __ida_find_free(ida_t *ida, unsigned int from, unsigned int to)
+{
+    while (from < to) {
+        unsigned int word = from / 32;
+        // The bits below the first identifier count as used.
+        uint32_t bits     = ida->bitmap[word] | ((1U << (from % 32)) - 1U);
+        if (bits != UINT32_MAX) {
+            unsigned int id = (word * 32) + find_first_zero(bits);
+            return (id < to) ? (int)id : -1;
+        }
+        from = (word + 1) * 32;
+    }
+    return -1;
+}
+
+void ida_init(ida_t *ida, uint32_t *bitmap, unsigned int size)
+{
+    memset(bitmap, 0, IDA_WORDS(size) * sizeof(uint32_t));
+    ida->bitmap = bitmap;
+    ida->size   = size;
+    ida->used   = 0;
+    ida->hint   = 0;
+}
+
+int ida_alloc(ida_t *ida)
+{
+    if (ida->used >= ida->size) {
+        return -1;
+    }
+    int id = __ida_find_free(ida, ida->hint * 32, ida->size);
+    if (id >= 0) {
+        ida->hint = (unsigned int)id / 32;
+        ida_mark_used(ida, id);
+    }
+    return id;
+}
+
+int ida_alloc_cyclic(ida_t *ida, unsigned int start)
+{
+    if (ida->used >= ida->size) {
+        return -1;
+    }
+    int id = __ida_find_free(ida, max(start, ida->hint * 32), ida->size);
+    // Wrap around, no identifier below the hint is free.
+    if (id < 0) {
+        id = __ida_find_free(ida, ida->hint * 32, min(start, ida->size));
+    }
+    if (id >= 0) {
+        ida_mark_used(ida, id);
+    }
+    return id;
+}
+
+void ida_mark_used(ida_t *ida, unsigned int id)
+{
+    if ((id < ida->size) && !bit_check(ida->bitmap[id / 32], id % 32)) {
+        bit_set_assign(ida->bitmap[id / 32], id % 32);
+        ++ida->used;
+    }
+}
+
+void ida_free(ida_t *ida, unsigned int id)
+{
+    if ((id < ida->size) && bit_check(ida->bitmap[id / 32], id % 32)) {
+        bit_clear_assign(ida->bitmap[id / 32], id % 32);
+        --ida->used;
+        ida->hint = min(ida->hint, id / 32);
+    }
+}
@@ -10,6 +10,7 @@ void list_init(list_t *list, listnode_t *(*alloc_fn)(void), void (*dealloc_fn)(l
     list->size    = 0;
     list->alloc   = alloc_fn;
     list->dealloc = dealloc_fn;
+    list->arena   = NULL;
 }
 
 listnode_t *list_insert_front(list_t *list, void *value)
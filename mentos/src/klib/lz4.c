@@ -0,0 +1,179 @@
+/// @file lz4.c
+/// @brief Compressor and decompressor of the LZ4 block format.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "klib/lz4.h"
+
+#include "string.h"
+
+/// The shortest match.
+#define LZ4_MIN_MATCH     4
+/// The number of bytes at the end of a block which are always literals.
+#define LZ4_LAST_LITERALS 5
+/// The last match starts at least this many bytes before the end of a block.
+#define LZ4_MF_LIMIT      12
+/// The largest value of a length inside the token.
+#define LZ4_TOKEN_MAX     15
+
+/// @brief Reads four bytes, which do not need to be aligned.
+/// @param ptr the address of the bytes.
+/// @return their value.
+static inline uint32_t __lz4_read32(const uint8_t *ptr)
+{
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(uint32_t));
+    return value;
+}
+
+/// @brief Hashes four bytes, with the multiplier of Knuth.
+/// @param value the bytes.
+/// @return the entry of the hash table.
+static inline uint32_t __lz4_hash(uint32_t value) { return (value * 2654435761U) >> (32 - LZ4_HASH_BITS); }
+
+/// @brief Writes the bytes continuing a length which does not fit inside the token.
+/// @param op where the bytes are written, there must be room for length / 255 + 1 of them.
+/// @param length the length, minus LZ4_TOKEN_MAX.
+/// @return the position following the bytes.
+static inline uint8_t *__lz4_put_length(uint8_t *op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+/// @brief Reads the bytes continuing a length which does not fit inside the token.
+/// @param ip the position of the bytes, moved past them.
+/// @param iend the end of the block.
+/// @param length the length, which is increased.
+/// @return 0 on success, -1 if the block ends before the length.
+static inline int __lz4_get_length(const uint8_t **ip, const uint8_t *iend, size_t *length)
+{
+    uint8_t byte;
+    do {
+        if (*ip >= iend) {
+            return -1;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity, uint16_t *table)
+{
+    const uint8_t *ip     = src;
+    const uint8_t *anchor = src;
+    const uint8_t *iend   = src + size;
+    uint8_t *op           = dst;
+    uint8_t *oend         = dst + capacity;
+    if (size > LZ4_MAX_INPUT) {
+        return 0;
+    }
+    memset(table, 0, LZ4_HASH_SIZE * sizeof(uint16_t));
+    // Shorter blocks are made of literals only.
+    if (size >= LZ4_MF_LIMIT) {
+        const uint8_t *mflimit    = iend - LZ4_MF_LIMIT;
+        const uint8_t *matchlimit = iend - LZ4_LAST_LITERALS;
+        while (ip < mflimit) {
+            uint32_t hash      = __lz4_hash(__lz4_read32(ip));
+            const uint8_t *ref = src + table[hash];
+            table[hash]        = (uint16_t)(ip - src);
+            if ((ref >= ip) || (__lz4_read32(ref) != __lz4_read32(ip))) {
+                ++ip;
+                continue;
+            }
+            // Extend the match backwards, over the pending literals, then forwards.
+            while ((ip > anchor) && (ref > src) && (ip[-1] == ref[-1])) {
+                --ip;
+                --ref;
+            }
+            size_t length = LZ4_MIN_MATCH;
+            while ((ip + length < matchlimit) && (ip[length] == ref[length])) {
+                ++length;
+            }
+            size_t literals = ip - anchor;
+            if ((size_t)(oend - op) < literals + (literals / 255) + (length / 255) + 5) {
+                return 0;
+            }
+            uint8_t *token = op++;
+            *token         = (uint8_t)((literals < LZ4_TOKEN_MAX) ? literals : LZ4_TOKEN_MAX) << 4;
+            if (literals >= LZ4_TOKEN_MAX) {
+                op = __lz4_put_length(op, literals - LZ4_TOKEN_MAX);
+            }
+            memcpy(op, anchor, literals);
+            op += literals;
+            *op++ = (uint8_t)(ip - ref);
+            *op++ = (uint8_t)((ip - ref) >> 8);
+            length -= LZ4_MIN_MATCH;
+            *token |= (uint8_t)((length < LZ4_TOKEN_MAX) ? length : LZ4_TOKEN_MAX);
+            if (length >= LZ4_TOKEN_MAX) {
+                op = __lz4_put_length(op, length - LZ4_TOKEN_MAX);
+            }
+            ip += length + LZ4_MIN_MATCH;
+            anchor = ip;
+        }
+    }
+    // The last literals.
+    size_t literals = iend - anchor;
+    if ((size_t)(oend - op) < literals + (literals / 255) + 2) {
+        return 0;
+    }
+    *op++ = (uint8_t)((literals < LZ4_TOKEN_MAX) ? literals : LZ4_TOKEN_MAX) << 4;
+    if (literals >= LZ4_TOKEN_MAX) {
+        op = __lz4_put_length(op, literals - LZ4_TOKEN_MAX);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+    return op - dst;
+}
+
+int lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+{
+    const uint8_t *ip   = src;
+    const uint8_t *iend = src + size;
+    uint8_t *op         = dst;
+    uint8_t *oend       = dst + capacity;
+    while (ip < iend) {
+        uint8_t token   = *ip++;
+        size_t literals = token >> 4;
+        if ((literals == LZ4_TOKEN_MAX) && (__lz4_get_length(&ip, iend, &literals) < 0)) {
+            return -1;
+        }
+        if ((literals > (size_t)(iend - ip)) || (literals > (size_t)(oend - op))) {
+            return -1;
+        }
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        // The last sequence has no match.
+        if (ip == iend) {
+            break;
+        }
+        if ((iend - ip) < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if ((offset == 0) || (offset > (size_t)(op - dst))) {
+            return -1;
+        }
+        size_t length = token & LZ4_TOKEN_MAX;
+        if ((length == LZ4_TOKEN_MAX) && (__lz4_get_length(&ip, iend, &length) < 0)) {
+            return -1;
+        }
+        length += LZ4_MIN_MATCH;
+        if (length > (size_t)(oend - op)) {
+            return -1;
+        }
+        // The match can overlap the bytes it produces, it is copied one byte at a time.
+        const uint8_t *ref = op - offset;
+        while (length--) {
+            *op++ = *ref++;
+        }
+    }
+    return op - dst;
+}
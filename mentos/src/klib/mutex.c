@@ -1,30 +1,77 @@
 /// @file mutex.c
-/// @brief
+/// @brief Sleeping mutexes, with priority inheritance.
+/// @details
+/// The kernel is not preempted, so a mutex can only be busy when its owner
+/// went to sleep while holding it: contenders go to sleep too, instead of
+/// spinning on a lock which cannot be released until they give the CPU up.
+/// The owner hands the mutex over to the waiter coming first when it unlocks
+/// it, a task arriving in the meantime cannot steal it, and waiters of the
+/// same priority are served in arrival order. While a task waits, the owner
+/// runs with its policy and priority, if they come first, so that tasks in
+/// between cannot delay the release of the mutex indefinitely.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #include "klib/mutex.h"
-#include "io/debug.h"
+#include "process/scheduler.h"
 
-void mutex_lock(mutex_t *mutex, uint32_t owner)
+void mutex_init(mutex_t *mutex)
 {
-    pr_debug("[%d] Trying to lock mutex...\n", owner);
-    int failure = 1;
+    mutex->state = 0;
+    mutex->owner = NULL;
+    wait_queue_head_init(&mutex->wait);
+}
 
-    while (mutex->state == 0 || failure || mutex->owner != owner) {
-        failure = 1;
-        if (mutex->state == 0) {
-            __asm__ __volatile__("movl $0x01,%%eax\n\t" // move 1 to eax
-                                 "xchg    %%eax,%0\n\t" // try to set the lock bit
-                                 "mov     %%eax,%1\n\t" // export our result to a test var
-                                 : "=m"(mutex->state), "=r"(failure)
-                                 : "m"(mutex->state)
-                                 : "%eax");
-        }
-        if (failure == 0) {
-            mutex->owner = owner; //test to see if we got the lock bit
+void mutex_lock(mutex_t *mutex)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (mutex_trylock(mutex)) {
+        return;
+    }
+    // The entry lives on the stack, which is preserved while sleeping.
+    wait_queue_entry_t entry;
+    wait_queue_entry_init(&entry, task);
+    add_wait_queue_exclusive(&mutex->wait, &entry);
+    // The owner removes us from the queue, once it hands the mutex over.
+    while (mutex->owner != task) {
+        // Mutexes locked before the first process started have no owner.
+        if (mutex->owner && !task->se.pi_owner) {
+            scheduler_pi_wait(task, mutex->owner, (uint32_t)mutex);
         }
+        task->state = TASK_UNINTERRUPTIBLE;
+        schedule();
+    }
+}
+
+int mutex_trylock(mutex_t *mutex)
+{
+    if (mutex->state) {
+        return 0;
     }
+    mutex->state = 1;
+    mutex->owner = scheduler_get_current_process();
+    return 1;
 }
 
-void mutex_unlock(mutex_t *mutex) { mutex->state = 0; }
+void mutex_unlock(mutex_t *mutex)
+{
+    if (list_head_empty(&mutex->wait.task_list)) {
+        mutex->state = 0;
+        mutex->owner = NULL;
+        return;
+    }
+    // The mutex stays locked, and passes to the waiter coming first.
+    wait_queue_entry_t *entry = NULL;
+    list_for_each_decl (it, &mutex->wait.task_list) {
+        wait_queue_entry_t *waiter = list_entry(it, wait_queue_entry_t, task_list);
+        if (!entry || scheduler_pi_precedes(waiter->task, entry->task)) {
+            entry = waiter;
+        }
+    }
+    list_head_remove(&entry->task_list);
+    if (mutex->owner) {
+        scheduler_pi_handover(mutex->owner, entry->task, (uint32_t)mutex);
+    }
+    mutex->owner = entry->task;
+    entry->func(entry, TASK_RUNNING, 0);
+}
@@ -28,6 +28,7 @@ void ndtree_tree_init(
     tree->compare_node = compare_node;
     tree->alloc_node   = alloc_node;
     tree->free_node    = free_node;
+    tree->arena        = NULL;
 
     // Initialize the orphan list head.
     list_head_init(&tree->orphans);
@@ -25,6 +25,8 @@ struct rbtree {
     rbtree_node_t *root;
     /// Comparison function for insertion.
     rbtree_tree_node_cmp_f cmp;
+    /// Function recomputing the data a node keeps about its subtree, if any.
+    rbtree_tree_node_f augment;
     /// Size of the tree.
     unsigned int size;
 };
@@ -63,6 +65,14 @@ void *rbtree_node_get_value(rbtree_node_t *node)
     return NULL;
 }
 
+rbtree_node_t *rbtree_node_get_child(rbtree_node_t *node, int dir)
+{
+    if (node) {
+        return node->link[dir != 0];
+    }
+    return NULL;
+}
+
 void rbtree_node_dealloc(rbtree_node_t *node)
 {
     if (node) {
@@ -76,10 +86,11 @@ void rbtree_node_dealloc(rbtree_node_t *node)
 static int rbtree_node_is_red(const rbtree_node_t *node) { return node ? node->red : 0; }
 
 /// @brief Performs a node rotation.
+/// @param tree the tree.
 /// @param node the node.
 /// @param dir the direction of the rotation (0: left, 1: right).
 /// @return the result of the rotate operation.
-static rbtree_node_t *rbtree_node_rotate(rbtree_node_t *node, int dir)
+static rbtree_node_t *rbtree_node_rotate(rbtree_t *tree, rbtree_node_t *node, int dir)
 {
     rbtree_node_t *result = NULL;
     if (node) {
@@ -88,26 +99,60 @@ static rbtree_node_t *rbtree_node_rotate(rbtree_node_t *node, int dir)
         result->link[dir] = node;
         node->red         = 1;
         result->red       = 0;
+        // The node is now a child of the result.
+        if (tree->augment) {
+            tree->augment(tree, node);
+            tree->augment(tree, result);
+        }
     }
     return result;
 }
 
 /// @brief Performs a double rotation.
+/// @param tree the tree.
 /// @param node the node.
 /// @param dir the direction of the rotation (0: left, 1: right).
 /// @return the result of the rotate operation.
 /// @details Suppose U has a parent V and a grandparent W. Then two successive
 /// rotations on U will ensure that V and W are descendents of U.
-static rbtree_node_t *rbtree_node_rotate2(rbtree_node_t *node, int dir)
+static rbtree_node_t *rbtree_node_rotate2(rbtree_t *tree, rbtree_node_t *node, int dir)
 {
     rbtree_node_t *result = NULL;
     if (node) {
-        node->link[!dir] = rbtree_node_rotate(node->link[!dir], !dir);
-        result           = rbtree_node_rotate(node, dir);
+        node->link[!dir] = rbtree_node_rotate(tree, node->link[!dir], !dir);
+        result           = rbtree_node_rotate(tree, node, dir);
     }
     return result;
 }
 
+/// @brief Recomputes the data kept by the nodes on the path from the root to
+/// the given value, starting from the bottom.
+/// @param tree the tree.
+/// @param value the value.
+/// @details The rotations fix the nodes they move off the path, the ones left
+/// on it are fixed here, once the tree has been changed.
+static void rbtree_tree_augment_path(rbtree_t *tree, void *value)
+{
+    if (!tree->augment) {
+        return;
+    }
+    rbtree_node_t *path[RBTREE_ITER_MAX_HEIGHT];
+    rbtree_node_t node = {.value = value};
+    rbtree_node_t *it  = tree->root;
+    unsigned int top   = 0;
+    int cmp            = 0;
+    while (it && (top < RBTREE_ITER_MAX_HEIGHT)) {
+        path[top++] = it;
+        if ((cmp = tree->cmp(tree, it, &node)) == 0) {
+            break;
+        }
+        it = it->link[cmp < 0];
+    }
+    while (top > 0) {
+        tree->augment(tree, path[--top]);
+    }
+}
+
 // rbtree_t - default callbacks
 
 /// @brief Peforms a comparison between the pointers of two elements.
@@ -138,13 +183,29 @@ rbtree_t *rbtree_tree_alloc(void) { return kmalloc(sizeof(rbtree_t)); }
 rbtree_t *rbtree_tree_init(rbtree_t *tree, rbtree_tree_node_cmp_f node_cb)
 {
     if (tree) {
-        tree->root = NULL;
-        tree->size = 0;
-        tree->cmp  = node_cb ? node_cb : rbtree_tree_node_cmp_ptr_cb;
+        tree->root    = NULL;
+        tree->size    = 0;
+        tree->cmp     = node_cb ? node_cb : rbtree_tree_node_cmp_ptr_cb;
+        tree->augment = NULL;
     }
     return tree;
 }
 
+void rbtree_tree_set_augment_cb(rbtree_t *tree, rbtree_tree_node_f augment_cb)
+{
+    if (tree) {
+        tree->augment = augment_cb;
+    }
+}
+
+rbtree_node_t *rbtree_tree_get_root(rbtree_t *tree)
+{
+    if (tree) {
+        return tree->root;
+    }
+    return NULL;
+}
+
 rbtree_t *rbtree_tree_create(rbtree_tree_node_cmp_f node_cb) { return rbtree_tree_init(rbtree_tree_alloc(), node_cb); }
 
 void rbtree_tree_dealloc(rbtree_t *tree, rbtree_tree_node_f node_cb)
@@ -223,72 +284,78 @@ int rbtree_tree_insert(rbtree_t *tree, void *value) { return rbtree_tree_insert_
 // Returns 1 on success, 0 otherwise.
 int rbtree_tree_insert_node(rbtree_t *tree, rbtree_node_t *node)
 {
-    if (tree && node) {
-        if (tree->root == NULL) {
-            tree->root = node;
-        } else {
-            rbtree_node_t head = {0}; // False tree root
-            rbtree_node_t *g;
-            rbtree_node_t *t; // Grandparent & parent
-            rbtree_node_t *p;
-            rbtree_node_t *q; // Iterator & parent
-            int dir  = 0;
-            int last = 0;
-
-            // Set up our helpers
-            t = &head;
-            g = p = NULL;
-            q = t->link[1] = tree->root;
-
-            // Search down the tree for a place to insert
-            while (1) {
-                if (q == NULL) {
-                    // Insert node at the first null link.
-                    p->link[dir] = q = node;
-                } else if (rbtree_node_is_red(q->link[0]) && rbtree_node_is_red(q->link[1])) {
-                    // Simple red violation: color flip
-                    q->red          = 1;
-                    q->link[0]->red = 0;
-                    q->link[1]->red = 0;
-                }
+    if (!tree || !node) {
+        return 0;
+    }
+    // The node starts as a leaf.
+    if (tree->augment) {
+        tree->augment(tree, node);
+    }
+    if (tree->root == NULL) {
+        tree->root = node;
+    } else {
+        rbtree_node_t head = {0}; // False tree root
+        rbtree_node_t *g;
+        rbtree_node_t *t; // Grandparent & parent
+        rbtree_node_t *p;
+        rbtree_node_t *q; // Iterator & parent
+        int dir  = 0;
+        int last = 0;
 
-                if (rbtree_node_is_red(q) && rbtree_node_is_red(p)) {
-                    // Hard red violation: rotations necessary
-                    int dir2 = t->link[1] == g;
-                    if (q == p->link[last]) {
-                        t->link[dir2] = rbtree_node_rotate(g, !last);
-                    } else {
-                        t->link[dir2] = rbtree_node_rotate2(g, !last);
-                    }
-                }
+        // Set up our helpers
+        t = &head;
+        g = p = NULL;
+        q = t->link[1] = tree->root;
+
+        // Search down the tree for a place to insert
+        while (1) {
+            if (q == NULL) {
+                // Insert node at the first null link.
+                p->link[dir] = q = node;
+            } else if (rbtree_node_is_red(q->link[0]) && rbtree_node_is_red(q->link[1])) {
+                // Simple red violation: color flip
+                q->red          = 1;
+                q->link[0]->red = 0;
+                q->link[1]->red = 0;
+            }
 
-                // Stop working if we inserted a node. This
-                // check also disallows duplicates in the tree
-                if (tree->cmp(tree, q, node) == 0) {
-                    break;
+            if (rbtree_node_is_red(q) && rbtree_node_is_red(p)) {
+                // Hard red violation: rotations necessary
+                int dir2 = t->link[1] == g;
+                if (q == p->link[last]) {
+                    t->link[dir2] = rbtree_node_rotate(tree, g, !last);
+                } else {
+                    t->link[dir2] = rbtree_node_rotate2(tree, g, !last);
                 }
+            }
 
-                last = dir;
-                dir  = tree->cmp(tree, q, node) < 0;
+            // Stop working if we inserted a node. This
+            // check also disallows duplicates in the tree
+            if (tree->cmp(tree, q, node) == 0) {
+                break;
+            }
 
-                // Move the helpers down
-                if (g != NULL) {
-                    t = g;
-                }
+            last = dir;
+            dir  = tree->cmp(tree, q, node) < 0;
 
-                g = p, p = q;
-                q = q->link[dir];
+            // Move the helpers down
+            if (g != NULL) {
+                t = g;
             }
 
-            // Update the root (it may be different)
-            tree->root = head.link[1];
+            g = p, p = q;
+            q = q->link[dir];
         }
 
-        // Make the root black for simplified logic
-        tree->root->red = 0;
-        ++tree->size;
+        // Update the root (it may be different)
+        tree->root = head.link[1];
     }
 
+    // Make the root black for simplified logic
+    tree->root->red = 0;
+    ++tree->size;
+    rbtree_tree_augment_path(tree, node->value);
+
     return 1;
 }
 
@@ -303,8 +370,9 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
         rbtree_node_t *q;
         rbtree_node_t *p;
         rbtree_node_t *g;        // Helpers
-        rbtree_node_t *f = NULL; // Found item
-        int dir          = 1;
+        rbtree_node_t *f       = NULL; // Found item
+        rbtree_node_t *changed = NULL; // Parent of the removed item
+        int dir                = 1;
 
         // Set up our helpers
         q = &head;
@@ -330,7 +398,7 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
             // Push the red node down with rotations and color flips
             if (!rbtree_node_is_red(q) && !rbtree_node_is_red(q->link[dir])) {
                 if (rbtree_node_is_red(q->link[!dir])) {
-                    p = p->link[last] = rbtree_node_rotate(q, dir);
+                    p = p->link[last] = rbtree_node_rotate(tree, q, dir);
                 } else if (!rbtree_node_is_red(q->link[!dir])) {
                     rbtree_node_t *s = p->link[!last];
                     if (s) {
@@ -342,9 +410,9 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
                         } else {
                             int dir2 = g->link[1] == p;
                             if (rbtree_node_is_red(s->link[last])) {
-                                g->link[dir2] = rbtree_node_rotate2(p, last);
+                                g->link[dir2] = rbtree_node_rotate2(tree, p, last);
                             } else if (rbtree_node_is_red(s->link[!last])) {
-                                g->link[dir2] = rbtree_node_rotate(p, last);
+                                g->link[dir2] = rbtree_node_rotate(tree, p, last);
                             }
 
                             // Ensure correct coloring
@@ -365,6 +433,11 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
 
             p->link[p->link[1] == q] = q->link[q->link[0] == NULL];
 
+            // The parent of the removed node is the deepest one which changed.
+            if (p != &head) {
+                changed = p;
+            }
+
             if (node_cb) {
                 node_cb(tree, q);
             }
@@ -379,7 +452,15 @@ int rbtree_tree_remove_with_cb(rbtree_t *tree, void *value, rbtree_tree_node_f n
             tree->root->red = 0;
         }
 
+        if (f == NULL) {
+            return 0;
+        }
         --tree->size;
+
+        // Fix the nodes above the removed one, its parent leads back to them.
+        if (changed) {
+            rbtree_tree_augment_path(tree, changed->value);
+        }
     }
     return 1;
 }
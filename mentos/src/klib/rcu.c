@@ -0,0 +1,85 @@
+/// @file rcu.c
+/// @brief Read-copy-update.
+/// @details
+/// The callbacks queued by call_rcu() wait inside the pending list; the first
+/// quiescent state after them moves the whole list to the done one, whose
+/// callbacks are then run by a tasklet. Since nobody can be reading when the
+/// quiescent state is noted, the callbacks queued before it can run at any
+/// time after it, even from an interrupt coming in the middle of a reader
+/// which started later.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "klib/rcu.h"
+
+#include "assert.h"
+#include "klib/irqflags.h"
+#include "system/softirq.h"
+
+/// @brief A list of callbacks, in the order they were queued.
+typedef struct rcu_list {
+    /// The first callback, NULL if there are none.
+    rcu_head_t *head;
+    /// Where the next callback is linked.
+    rcu_head_t **tail;
+} rcu_list_t;
+
+volatile unsigned rcu_read_nesting = 0;
+
+/// The callbacks waiting for the next quiescent state.
+static rcu_list_t rcu_pending = { NULL, &rcu_pending.head };
+/// The callbacks whose grace period is over, waiting for the tasklet.
+static rcu_list_t rcu_done = { NULL, &rcu_done.head };
+
+/// @brief Runs the callbacks whose grace period is over.
+/// @param data unused.
+static void __rcu_process_callbacks(unsigned long data);
+
+/// Runs the callbacks whose grace period is over.
+static tasklet_t rcu_tasklet = { NULL, false, __rcu_process_callbacks, 0 };
+
+static void __rcu_process_callbacks(unsigned long data)
+{
+    uint8_t flags    = irq_disable();
+    rcu_head_t *list = rcu_done.head;
+    rcu_done.head    = NULL;
+    rcu_done.tail    = &rcu_done.head;
+    irq_enable(flags);
+    while (list) {
+        rcu_head_t *head = list;
+        list             = list->next;
+        head->func(head);
+    }
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head))
+{
+    head->next        = NULL;
+    head->func        = func;
+    uint8_t flags     = irq_disable();
+    *rcu_pending.tail = head;
+    rcu_pending.tail  = &head->next;
+    irq_enable(flags);
+}
+
+void synchronize_rcu(void)
+{
+    assert(!rcu_read_nesting && "Waiting for a grace period inside a read-side critical section.");
+    barrier();
+}
+
+void rcu_note_quiescent_state(void)
+{
+    assert(!rcu_read_nesting && "Quiescent state inside a read-side critical section.");
+    uint8_t flags = irq_disable();
+    if (rcu_pending.head == NULL) {
+        irq_enable(flags);
+        return;
+    }
+    *rcu_done.tail   = rcu_pending.head;
+    rcu_done.tail    = rcu_pending.tail;
+    rcu_pending.head = NULL;
+    rcu_pending.tail = &rcu_pending.head;
+    irq_enable(flags);
+    tasklet_schedule(&rcu_tasklet);
+}
@@ -0,0 +1,99 @@
+/// @file rwlock.c
+/// @brief Sleeping reader-writer locks.
+/// @details
+/// The lock is handed over to the waiters in arrival order, when it is
+/// released: either to the first writer, or to all the readers which arrived
+/// before the next writer. A new reader waits as soon as a writer is waiting,
+/// so that a stream of readers cannot starve the writers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "klib/rwlock.h"
+#include "process/scheduler.h"
+
+/// @brief Removes a waiter from the queue, and wakes it up with the lock.
+/// @param entry the entry of the waiter.
+static inline void __rwlock_grant(wait_queue_entry_t *entry)
+{
+    list_head_remove(&entry->task_list);
+    // The waiter checks this, to tell the hand-over from other wake-ups.
+    entry->private = entry;
+    entry->func(entry, TASK_RUNNING, 0);
+}
+
+/// @brief Hands the lock over to the waiters which can take it.
+/// @param rwlock the lock.
+static void __rwlock_wake_waiters(rwlock_t *rwlock)
+{
+    while (!list_head_empty(&rwlock->wait.task_list) && !rwlock->writer) {
+        wait_queue_entry_t *entry = list_entry(rwlock->wait.task_list.next, wait_queue_entry_t, task_list);
+        if (entry->flags & WQ_FLAG_EXCLUSIVE) {
+            // A writer waits for the readers holding the lock.
+            if (rwlock->readers == 0) {
+                rwlock->writer = 1;
+                __rwlock_grant(entry);
+            }
+            break;
+        }
+        ++rwlock->readers;
+        __rwlock_grant(entry);
+    }
+}
+
+/// @brief Sleeps until the lock is handed over to the current task.
+/// @param rwlock the lock.
+/// @param writer if the task waits for writing.
+static void __rwlock_wait(rwlock_t *rwlock, int writer)
+{
+    task_struct *task = scheduler_get_current_process();
+    // The entry lives on the stack, which is preserved while sleeping.
+    wait_queue_entry_t entry;
+    wait_queue_entry_init(&entry, task);
+    if (writer) {
+        add_wait_queue_exclusive(&rwlock->wait, &entry);
+    } else {
+        add_wait_queue(&rwlock->wait, &entry);
+    }
+    while (!entry.private) {
+        task->state = TASK_UNINTERRUPTIBLE;
+        schedule();
+    }
+}
+
+void rwlock_init(rwlock_t *rwlock)
+{
+    rwlock->readers = 0;
+    rwlock->writer  = 0;
+    wait_queue_head_init(&rwlock->wait);
+}
+
+void rwlock_read_lock(rwlock_t *rwlock)
+{
+    if (!rwlock->writer && list_head_empty(&rwlock->wait.task_list)) {
+        ++rwlock->readers;
+        return;
+    }
+    __rwlock_wait(rwlock, 0);
+}
+
+void rwlock_read_unlock(rwlock_t *rwlock)
+{
+    if (--rwlock->readers == 0) {
+        __rwlock_wake_waiters(rwlock);
+    }
+}
+
+void rwlock_write_lock(rwlock_t *rwlock)
+{
+    if (!rwlock->writer && (rwlock->readers == 0) && list_head_empty(&rwlock->wait.task_list)) {
+        rwlock->writer = 1;
+        return;
+    }
+    __rwlock_wait(rwlock, 1);
+}
+
+void rwlock_write_unlock(rwlock_t *rwlock)
+{
+    rwlock->writer = 0;
+    __rwlock_wake_waiters(rwlock);
+}
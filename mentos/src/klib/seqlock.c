@@ -0,0 +1,44 @@
+/// @file seqlock.c
+/// @brief Sequence locks.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "klib/seqlock.h"
+#include "klib/stdatomic.h"
+
+void seqlock_init(seqlock_t *seqlock)
+{
+    seqlock->sequence = 0;
+    spinlock_init(&seqlock->lock);
+}
+
+void seqlock_write_lock(seqlock_t *seqlock)
+{
+    spinlock_lock(&seqlock->lock);
+    ++seqlock->sequence;
+    barrier();
+}
+
+void seqlock_write_unlock(seqlock_t *seqlock)
+{
+    barrier();
+    ++seqlock->sequence;
+    spinlock_unlock(&seqlock->lock);
+}
+
+uint32_t seqlock_read_begin(const seqlock_t *seqlock)
+{
+    uint32_t start;
+    // Wait for the update in progress, if any.
+    while ((start = seqlock->sequence) & 1) {
+        cpu_relax();
+    }
+    barrier();
+    return start;
+}
+
+int seqlock_read_retry(const seqlock_t *seqlock, uint32_t start)
+{
+    barrier();
+    return seqlock->sequence != start;
+}
@@ -1,28 +1,72 @@
 /// @file spinlock.c
-/// @brief
+/// @brief Ticket spinlocks.
+/// @details
+/// Each task asking for the lock takes a ticket, and waits until the ticket
+/// is served: the lock is granted in the order it has been asked for, so
+/// that no waiter can be starved by the others.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #include "klib/spinlock.h"
+#include "klib/preempt.h"
 
-void spinlock_init(spinlock_t *spinlock) { (*spinlock) = SPINLOCK_FREE; }
+void spinlock_init(spinlock_t *spinlock)
+{
+    spinlock->next  = 0;
+    spinlock->owner = 0;
+#ifdef ENABLE_SPINLOCK_STATS
+    spinlock->acquisitions = 0;
+    spinlock->contentions  = 0;
+    spinlock->spins        = 0;
+#endif
+}
 
 void spinlock_lock(spinlock_t *spinlock)
 {
-    while (1) {
-        if (atomic_set_and_test(spinlock, SPINLOCK_BUSY) == 0) {
-            break;
-        }
-        while (*spinlock) {
-            cpu_relax();
-        }
+    // The holder must not give up the CPU, the waiters would spin forever.
+    preempt_disable();
+    // Take a ticket, the previous value of the counter.
+    unsigned ticket = (unsigned)atomic_add(&spinlock->next, 1);
+#ifdef ENABLE_SPINLOCK_STATS
+    uint32_t spins = 0;
+    while ((unsigned)atomic_read(&spinlock->owner) != ticket) {
+        cpu_relax();
+        ++spins;
+    }
+    // The counters are updated while holding the lock.
+    ++spinlock->acquisitions;
+    if (spins) {
+        ++spinlock->contentions;
+        spinlock->spins += spins;
     }
+#else
+    while ((unsigned)atomic_read(&spinlock->owner) != ticket) {
+        cpu_relax();
+    }
+#endif
+    barrier();
 }
 
 void spinlock_unlock(spinlock_t *spinlock)
 {
     barrier();
-    atomic_set(spinlock, SPINLOCK_FREE);
+    // Only the holder changes the owner, serve the next ticket.
+    atomic_inc(&spinlock->owner);
+    preempt_enable();
 }
 
-int spinlock_trylock(spinlock_t *spinlock) { return atomic_set_and_test(spinlock, SPINLOCK_BUSY) == 0; }
+int spinlock_trylock(spinlock_t *spinlock)
+{
+    atomic_t owner = (atomic_t)atomic_read(&spinlock->owner);
+    // The lock is free only if nobody holds a ticket.
+    preempt_disable();
+    if (atomic_cmpxchg_and_test(&spinlock->next, owner, owner + 1) != owner) {
+        preempt_enable();
+        return 0;
+    }
+#ifdef ENABLE_SPINLOCK_STATS
+    ++spinlock->acquisitions;
+#endif
+    barrier();
+    return 1;
+}
@@ -5,11 +5,14 @@
 
 #include "time.h"
 #include "drivers/rtc.h"
+#include "errno.h"
+#include "hardware/hrtimer.h"
 #include "hardware/timer.h"
 #include "io/debug.h"
 #include "io/port_io.h"
 #include "stddef.h"
 #include "stdio.h"
+#include "system/vdso.h"
 
 /// @brief List of week days.
 static const char *str_weekdays[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
@@ -44,6 +47,47 @@ time_t sys_time(time_t *time)
     return t;
 }
 
+/// @brief Returns the nanoseconds between the start of the monotonic clock and
+///        the Unix epoch, read from the Real Time Clock the first time.
+/// @return the nanoseconds.
+static inline uint64_t __realtime_offset(void)
+{
+    static uint64_t offset = 0;
+    if (offset == 0) {
+        offset = ((uint64_t)sys_time(NULL) * NSEC_PER_SEC) - hrtimer_get_ns();
+        vdso_set_realtime(offset);
+    }
+    return offset;
+}
+
+int sys_clock_gettime(clockid_t clk_id, struct timespec *tp)
+{
+    uint64_t ns;
+    if (clk_id == CLOCK_MONOTONIC) {
+        ns = hrtimer_get_ns();
+    } else if (clk_id == CLOCK_REALTIME) {
+        ns = __realtime_offset() + hrtimer_get_ns();
+    } else {
+        return -EINVAL;
+    }
+    uint32_t nsec;
+    tp->tv_sec  = div64_32(ns, NSEC_PER_SEC, &nsec);
+    tp->tv_nsec = (long)nsec;
+    return 0;
+}
+
+int sys_clock_getres(clockid_t clk_id, struct timespec *res)
+{
+    if ((clk_id != CLOCK_MONOTONIC) && (clk_id != CLOCK_REALTIME)) {
+        return -EINVAL;
+    }
+    if (res) {
+        res->tv_sec  = 0;
+        res->tv_nsec = (long)hrtimer_get_resolution();
+    }
+    return 0;
+}
+
 time_t difftime(time_t time1, time_t time2) { return time1 - time2; }
 
 /// @brief Computes day of week
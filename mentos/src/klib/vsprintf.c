@@ -8,8 +8,12 @@
 #include "stdarg.h"
 #include "stddef.h"
 #include "stdio.h"
+#include "string.h"
 #include "unistd.h"
 
+/// The size of the chunks in which the output is handed to the screen.
+#define PRINTF_CHUNK 128
+
 #define FLAGS_ZEROPAD   (1U << 0U) ///< Fill zeros before the number.
 #define FLAGS_LEFT      (1U << 1U) ///< Left align the value.
 #define FLAGS_PLUS      (1U << 2U) ///< Print the plus sign.
@@ -18,193 +22,229 @@
 #define FLAGS_SIGN      (1U << 5U) ///< Print the sign.
 #define FLAGS_NEGATIVE  (1U << 6U) ///< Negative number flag.
 
+/// The pairs of decimal digits, from "00" to "99".
+static const char decimal_pairs[201] = "00010203040506070809"
+                                       "10111213141516171819"
+                                       "20212223242526272829"
+                                       "30313233343536373839"
+                                       "40414243444546474849"
+                                       "50515253545556575859"
+                                       "60616263646566676869"
+                                       "70717273747576777879"
+                                       "80818283848586878889"
+                                       "90919293949596979899";
+
+/// @brief Hands the gathered characters to the function of the sink, if it has one.
+/// @param sink The sink.
+static inline void __sink_flush(printf_sink_t *sink)
+{
+    if (sink->flush && sink->length) {
+        if (sink->flush(sink) < 0) {
+            sink->error = 1;
+        }
+        sink->length = 0;
+    }
+}
+
+/// @brief Internal function to emit characters.
+/// @param sink Where the characters go.
+/// @param str The characters to emit.
+/// @param n The number of characters.
+static void __emit_string(printf_sink_t *sink, const char *str, size_t n)
+{
+    sink->count += n;
+    while (n > 0) {
+        // Without a flush function, what does not fit is dropped.
+        if (sink->length == sink->size) {
+            if (!sink->flush) {
+                return;
+            }
+            __sink_flush(sink);
+        }
+        size_t chunk = min(n, sink->size - sink->length);
+        memcpy(sink->buffer + sink->length, str, chunk);
+        sink->length += chunk;
+        str += chunk;
+        n -= chunk;
+    }
+}
+
 /// @brief Internal function to emit a character.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the character goes.
 /// @param c The character to emit.
-static inline void __emit_char(char **buf, char *end, char c)
+static inline void __emit_char(printf_sink_t *sink, char c)
 {
-    if (*buf && *buf < end) {
-        *(*buf)++ = c;
-    } else if (*buf) {
-        (*buf)++;
+    if ((sink->length == sink->size) && sink->flush) {
+        __sink_flush(sink);
     }
+    if (sink->length < sink->size) {
+        sink->buffer[sink->length++] = c;
+    }
+    sink->count++;
 }
 
 /// @brief Internal function to emit padding characters.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the characters go.
 /// @param padding The number of padding characters to emit.
 /// @param padchar The character to use for padding.
-static void __emit_padding(char **buf, char *end, int padding, char padchar)
+static void __emit_padding(printf_sink_t *sink, int padding, char padchar)
 {
     while (padding-- > 0) {
-        __emit_char(buf, end, padchar);
+        __emit_char(sink, padchar);
     }
 }
 
-/// @brief Internal function to emit a number in a specific base.
-/// @param buffer Buffer to store the number.
-/// @param buflen Length of the buffer.
-/// @param num The number to format.
+/// @brief Internal function to convert a number in a specific base.
+/// @details The digits are placed at the end of the buffer: bases 8 and 16
+/// are converted with shifts, base 10 two digits per division.
+/// @param end The end of the buffer, which must hold 32 digits.
+/// @param num The number to convert.
 /// @param base The base to use for formatting (e.g., 10 for decimal, 16 for hexadecimal).
-/// @param precision The minimum number of digits to print.
 /// @param flags Formatting flags.
-/// @return The length of the formatted number.
-static int __emit_number(char *buffer, size_t buflen, unsigned long num, int base, int precision, int flags)
+/// @return The first digit.
+static char *__convert_number(char *end, unsigned long num, int base, int flags)
 {
-    size_t len = 0;
-    // Reserve space for prefix.
-    buflen -= (flags & (FLAGS_NEGATIVE | FLAGS_PLUS | FLAGS_SPACE));
-    // Convert number to string (in reverse).
-    do {
-        buffer[len++] = ((flags & FLAGS_UPPERCASE) ? "0123456789ABCDEF" : "0123456789abcdef")[num % base];
-        num /= base;
-    } while ((num > 0) && (len < buflen));
-    // Apply precision (zero padding).
-    if (precision > 0) {
-        while ((len < precision) && (len < buflen)) {
-            buffer[len++] = '0';
+    char *ptr = end;
+    if (base == 16) {
+        const char *digits = (flags & FLAGS_UPPERCASE) ? "0123456789ABCDEF" : "0123456789abcdef";
+        do {
+            *--ptr = digits[num & 0xFU];
+            num >>= 4U;
+        } while (num);
+    } else if (base == 8) {
+        do {
+            *--ptr = (char)('0' + (num & 7U));
+            num >>= 3U;
+        } while (num);
+    } else {
+        while (num >= 100) {
+            const char *pair = &decimal_pairs[(num % 100) * 2];
+            num /= 100;
+            *--ptr = pair[1];
+            *--ptr = pair[0];
+        }
+        if (num >= 10) {
+            *--ptr = decimal_pairs[num * 2 + 1];
+            *--ptr = decimal_pairs[num * 2];
+        } else {
+            *--ptr = (char)('0' + num);
         }
     }
-    // Handle sign/prefix.
-    if (flags & FLAGS_NEGATIVE) {
-        buffer[len++] = '-';
-    } else if (flags & FLAGS_PLUS) {
-        buffer[len++] = '+';
-    } else if (flags & FLAGS_SPACE) {
-        buffer[len++] = ' ';
-    }
-    return len;
+    return ptr;
 }
 
 /// @brief Internal function to handle string formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the characters go.
 /// @param str The string to format.
 /// @param width The minimum width of the output.
 /// @param precision The maximum number of characters to print.
 /// @param flags Formatting flags.
-static void __format_string(char **buf, char *end, const char *str, int width, int precision, int flags)
+static void __format_string(printf_sink_t *sink, const char *str, int width, int precision, int flags)
 {
-    int len       = 0;
-    const char *s = str;
+    int len = 0;
+    if (!str) {
+        str = "(null)";
+    }
     // If precision is set, limit the length to precision.
-    while (*s && (precision < 0 || len < precision)) {
+    while (str[len] && (precision < 0 || len < precision)) {
         len++;
-        s++;
     }
     // Calculate remaining width.
     int padding = width - len;
     // Apply **right padding** (default behavior, spaces before content)
     if (!(flags & FLAGS_LEFT)) {
-        __emit_padding(buf, end, padding, ' ');
-    }
-    // Copy the string into the buffer.
-    while (*str && (len-- > 0)) {
-        __emit_char(buf, end, *str++);
+        __emit_padding(sink, padding, ' ');
     }
+    // Copy the string.
+    __emit_string(sink, str, len);
     // Apply **left padding** only if FLAGS_LEFT is set.
     if (flags & FLAGS_LEFT) {
-        __emit_padding(buf, end, padding, ' ');
+        __emit_padding(sink, padding, ' ');
     }
 }
 
 /// @brief Internal function to handle character formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the characters go.
 /// @param c The character to format.
 /// @param width The minimum width of the output.
 /// @param flags Formatting flags.
-static void __format_char(char **buf, char *end, char c, int width, int flags)
+static void __format_char(printf_sink_t *sink, char c, int width, int flags)
 {
     // Calculate remaining width.
     int padding = width - 1;
     // Apply right padding before the character if right-aligned.
     if (!(flags & FLAGS_LEFT)) {
-        __emit_padding(buf, end, padding, ' ');
+        __emit_padding(sink, padding, ' ');
     }
     // Insert character.
-    __emit_char(buf, end, c);
+    __emit_char(sink, c);
     // Apply left padding only if FLAGS_LEFT is set.
     if (flags & FLAGS_LEFT) {
-        __emit_padding(buf, end, padding, ' ');
+        __emit_padding(sink, padding, ' ');
     }
 }
 
-/// @brief Internal function to handle integer formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @brief Internal function to handle unsigned integer formatting.
+/// @param sink Where the characters go.
 /// @param num The number to format.
 /// @param base The base to use for formatting (e.g., 10 for decimal, 16 for hexadecimal).
 /// @param width The minimum width of the output.
 /// @param precision The minimum number of digits to print.
-/// @param flags Formatting flags.
-static void __format_integer(char **buf, char *end, long num, int base, int width, int precision, int flags)
+/// @param flags Formatting flags, FLAGS_NEGATIVE prints the minus sign.
+static void __format_unsigned(printf_sink_t *sink, unsigned long num, int base, int width, int precision, int flags)
 {
-    char tmp[32] = {0};
-    unsigned long unum;
-    if (num < 0) {
-        unum = -num;
-        flags |= FLAGS_NEGATIVE;
-    } else {
-        unum = num;
-    }
-    // Convert number to string in reverse.
-    int len     = __emit_number(tmp, sizeof(tmp) - 1, unum, 10, precision, flags);
+    char tmp[32];
+    char *end    = tmp + sizeof(tmp);
+    char *digits = __convert_number(end, num, base, flags);
+    int len      = end - digits;
+    // Apply precision (zero padding).
+    int zeros    = (precision > len) ? (precision - len) : 0;
+    // Handle sign/prefix.
+    char sign    = (flags & FLAGS_NEGATIVE) ? '-' : (flags & FLAGS_PLUS) ? '+' : (flags & FLAGS_SPACE) ? ' ' : 0;
     // Calculate remaining width.
-    int padding = width - len;
-    // Apply right padding before the character if right-aligned.
+    int padding  = width - len - zeros - (sign ? 1 : 0);
+    // Apply right padding before the number if right-aligned, the zeros go after the sign.
     if (!(flags & FLAGS_LEFT)) {
-        __emit_padding(buf, end, padding, (flags & FLAGS_ZEROPAD) ? '0' : ' ');
+        // With a precision, the zeros of the flag are ignored.
+        if ((flags & FLAGS_ZEROPAD) && (precision < 0)) {
+            zeros += (padding > 0) ? padding : 0;
+        } else {
+            __emit_padding(sink, padding, ' ');
+        }
     }
-    // Copy the converted number in correct order.
-    while (len-- > 0) {
-        __emit_char(buf, end, tmp[len]);
+    if (sign) {
+        __emit_char(sink, sign);
     }
+    __emit_padding(sink, zeros, '0');
+    __emit_string(sink, digits, len);
     // Apply left padding only if FLAGS_LEFT is set.
     if (flags & FLAGS_LEFT) {
-        __emit_padding(buf, end, padding, ' ');
+        __emit_padding(sink, padding, ' ');
     }
 }
 
-/// @brief Internal function to handle unsigned integer formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @brief Internal function to handle integer formatting.
+/// @param sink Where the characters go.
 /// @param num The number to format.
-/// @param base The base to use for formatting (e.g., 10 for decimal, 16 for hexadecimal).
 /// @param width The minimum width of the output.
 /// @param precision The minimum number of digits to print.
 /// @param flags Formatting flags.
-static void __format_unsigned(char **buf, char *end, unsigned long num, int base, int width, int precision, int flags)
+static inline void __format_integer(printf_sink_t *sink, long num, int width, int precision, int flags)
 {
-    char tmp[32] = {0};
-    // Convert number to string (reverse order).
-    int len      = __emit_number(tmp, sizeof(tmp) - 1, num, base, precision, flags);
-    // Calculate remaining width.
-    int padding  = width - len;
-    // Apply right padding before the character if right-aligned.
-    if (!(flags & FLAGS_LEFT)) {
-        __emit_padding(buf, end, padding, (flags & FLAGS_ZEROPAD) ? '0' : ' ');
-    }
-    // Copy number to buffer in correct order.
-    while (len-- > 0) {
-        __emit_char(buf, end, tmp[len]);
-    }
-    // Apply left padding only if FLAGS_LEFT is set.
-    if (flags & FLAGS_LEFT) {
-        __emit_padding(buf, end, padding, ' ');
+    if (num < 0) {
+        __format_unsigned(sink, -(unsigned long)num, 10, width, precision, flags | FLAGS_NEGATIVE);
+    } else {
+        __format_unsigned(sink, (unsigned long)num, 10, width, precision, flags);
     }
 }
 
 /// @brief Internal function to handle floating-point formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the characters go.
 /// @param num The floating-point number to format.
 /// @param width The minimum width of the output.
 /// @param precision The number of digits after the decimal point.
 /// @param flags Formatting flags.
-static void __format_float(char **buf, char *end, double num, int width, int precision, int flags)
+static void __format_float(printf_sink_t *sink, double num, int width, int precision, int flags)
 {
     // Default precision for %f.
     if (precision < 0) {
@@ -212,7 +252,7 @@ static void __format_float(char **buf, char *end, double num, int width, int pre
     }
     // Handle sign.
     if (num < 0) {
-        __emit_char(buf, end, '-');
+        __emit_char(sink, '-');
         num = -num;
     }
     // Extract integer and decimal parts.
@@ -220,242 +260,244 @@ static void __format_float(char **buf, char *end, double num, int width, int pre
     double fraction = num - whole;
     fraction        = round(fraction * pow(10, precision));
     // Print whole part.
-    __format_integer(buf, end, whole, 10, 0, 0, flags);
+    __format_integer(sink, whole, 0, 0, flags);
     // Print decimal point and fraction part.
     if (precision > 0) {
-        __emit_char(buf, end, '.');
-        __format_integer(buf, end, (long)fraction, 10, precision, precision, 0);
+        __emit_char(sink, '.');
+        __format_integer(sink, (long)fraction, precision, precision, 0);
     }
 }
 
 /// @brief Internal function to handle pointer formatting.
-/// @param buf Current pointer in the buffer.
-/// @param end Pointer to the end of the buffer.
+/// @param sink Where the characters go.
 /// @param ptr The pointer to format.
 /// @param width The minimum width of the output.
 /// @param flags Formatting flags.
-static void __format_pointer(char **buf, char *end, void *ptr, int width, int flags)
+static void __format_pointer(printf_sink_t *sink, void *ptr, int width, int flags)
 {
     unsigned long addr = (unsigned long)ptr;
     // Prefix `0x` for pointer formatting.
-    __emit_char(buf, end, '0');
-    __emit_char(buf, end, 'x');
-    __format_unsigned(buf, end, addr, 16, width - 2, 0, 0);
+    __emit_string(sink, "0x", 2);
+    __format_unsigned(sink, addr, 16, width - 2, 0, 0);
 }
 
-/// @brief Handles `%n`, storing the number of characters printed so far.
-/// @param count_var Pointer to the integer where the character count is stored.
-/// @param count The number of characters written so far.
-static void __format_count(int *count_var, int count)
+int vprintf_sink(printf_sink_t *sink, const char *format, va_list args)
 {
-    if (count_var) {
-        *count_var = count;
-    }
-}
-
-int vsnprintf(char *buffer, size_t size, const char *format, va_list args)
-{
-    char dummy;
-    char *buf = buffer;
-    char *end = buffer + size - 1;
-
-    // Handle NULL buffer case.
-    if (!buffer && size == 0) {
-        buffer = &dummy;
-        buf    = &dummy;
-        end    = &dummy;
-    }
-
-    // Tracks number of characters written.
-    int count = 0;
-
     while (*format) {
-        if (*format == '%') {
-            format++; // Skip '%'
+        if (*format != '%') {
+            // Copy the text up to the next conversion at once.
+            const char *next = strchr(format, '%');
+            size_t length    = next ? (size_t)(next - format) : strlen(format);
+            __emit_string(sink, format, length);
+            format += length;
+            continue;
+        }
+        format++; // Skip '%'
 
-            int flags     = 0;
-            int width     = 0;
-            int precision = -1; // Default: no precision specified
-            int length    = 0;  // Length modifier (h, l, ll, etc.)
+        int flags     = 0;
+        int width     = 0;
+        int precision = -1; // Default: no precision specified
+        int length    = 0;  // Length modifier (h, l, ll, etc.)
 
-            // Step 1: Parse Flags.
-            while (*format == '-' || *format == '+' || *format == ' ' || *format == '#' || *format == '0') {
-                switch (*format) {
-                case '-':
-                    flags |= FLAGS_LEFT;
-                    break;
-                case '+':
-                    flags |= FLAGS_PLUS;
-                    break;
-                case ' ':
-                    flags |= FLAGS_SPACE;
-                    break;
-                case '0':
-                    flags |= FLAGS_ZEROPAD;
-                    break;
-                }
+        // Step 1: Parse Flags.
+        while (*format == '-' || *format == '+' || *format == ' ' || *format == '#' || *format == '0') {
+            switch (*format) {
+            case '-':
+                flags |= FLAGS_LEFT;
+                break;
+            case '+':
+                flags |= FLAGS_PLUS;
+                break;
+            case ' ':
+                flags |= FLAGS_SPACE;
+                break;
+            case '0':
+                flags |= FLAGS_ZEROPAD;
+                break;
+            }
+            format++;
+        }
+
+        // Step 2: Parse Width.
+        if (*format == '*') {
+            width = va_arg(args, int);
+            format++;
+        } else {
+            while (*format >= '0' && *format <= '9') {
+                width = width * 10 + (*format - '0');
                 format++;
             }
+        }
 
-            // Step 2: Parse Width.
+        // Step 3: Parse Precision.
+        if (*format == '.') {
+            format++;
             if (*format == '*') {
-                width = va_arg(args, int);
+                precision = va_arg(args, int);
                 format++;
             } else {
+                precision = 0;
                 while (*format >= '0' && *format <= '9') {
-                    width = width * 10 + (*format - '0');
+                    precision = precision * 10 + (*format - '0');
                     format++;
                 }
             }
+        }
 
-            // Step 3: Parse Precision.
-            if (*format == '.') {
-                format++;
-                if (*format == '*') {
-                    precision = va_arg(args, int);
-                    format++;
-                } else {
-                    precision = 0;
-                    while (*format >= '0' && *format <= '9') {
-                        precision = precision * 10 + (*format - '0');
-                        format++;
-                    }
-                }
-            }
-
-            // Step 4: Parse Length Modifier.
+        // Step 4: Parse Length Modifier.
+        if (*format == 'h') {
+            format++;
+            // "hh" (char)
             if (*format == 'h') {
+                length = 2;
                 format++;
-                // "hh" (char)
-                if (*format == 'h') {
-                    length = 2;
-                    format++;
-                }
-                // "h" (short)
-                else {
-                    length = 1;
-                }
-            } else if (*format == 'l') {
-                format++;
-                // "ll" (long)
-                if (*format == 'l') {
-                    length = 4;
-                    format++;
-                }
-                // "l" (long)
-                else {
-                    length = 3;
-                }
-            } else if (*format == 'z') {
-                length = 'z';
-                format++;
-            }
-
-            // Enable uppercase flag if necessary.
-            flags |= ((*format == 'X') ? FLAGS_UPPERCASE : 0);
-
-            // Step 5: Parse Specifier and Call Handler.
-            switch (*format) {
-            case 's': {
-                __format_string(&buf, end, va_arg(args, const char *), width, precision, flags);
-                break;
-            }
-            case 'c': {
-                __format_char(&buf, end, (char)va_arg(args, int), width, flags);
-                break;
-            }
-            case 'd':
-            case 'i': {
-                long num;
-                if (length == 0) {
-                    num = va_arg(args, int);
-                } else if (length == 1) {
-                    num = (short)va_arg(args, int);
-                } else if (length == 2) {
-                    num = (char)va_arg(args, int);
-                } else if (length == 'z') {
-                    num = (short)va_arg(args, ssize_t);
-                } else {
-                    num = va_arg(args, long);
-                }
-                __format_integer(&buf, end, num, 10, width, precision, flags);
-                break;
             }
-            case 'u':
-            case 'o':
-            case 'x':
-            case 'X': {
-                unsigned long num;
-                if (length == 0) {
-                    num = va_arg(args, unsigned int);
-                } else if (length == 1) {
-                    num = (unsigned short)va_arg(args, unsigned int);
-                } else if (length == 2) {
-                    num = (unsigned char)va_arg(args, unsigned int);
-                } else if (length == 'z') {
-                    num = (short)va_arg(args, size_t);
-                } else {
-                    num = va_arg(args, unsigned long);
-                }
-                int base;
-                if (*format == 'o') {
-                    base = 8;
-                } else if (*format == 'x' || *format == 'X') {
-                    base = 16;
-                } else {
-                    base = 10;
-                }
-                __format_unsigned(&buf, end, num, base, width, precision, flags);
-                break;
+            // "h" (short)
+            else {
+                length = 1;
             }
-            case 'p': {
-                __format_pointer(&buf, end, va_arg(args, void *), width, flags);
-                break;
+        } else if (*format == 'l') {
+            format++;
+            // "ll" (long)
+            if (*format == 'l') {
+                length = 4;
+                format++;
             }
-            case 'f':
-            case 'F': {
-                __format_float(&buf, end, va_arg(args, double), width, precision, flags);
-                break;
+            // "l" (long)
+            else {
+                length = 3;
             }
-            case 'n': {
-                __format_count(va_arg(args, int *), count);
-                break;
+        } else if (*format == 'z') {
+            length = 'z';
+            format++;
+        }
+
+        // Enable uppercase flag if necessary.
+        flags |= ((*format == 'X') ? FLAGS_UPPERCASE : 0);
+
+        // Step 5: Parse Specifier and Call Handler.
+        switch (*format) {
+        case 's': {
+            __format_string(sink, va_arg(args, const char *), width, precision, flags);
+            break;
+        }
+        case 'c': {
+            __format_char(sink, (char)va_arg(args, int), width, flags);
+            break;
+        }
+        case 'd':
+        case 'i': {
+            long num;
+            if (length == 0) {
+                num = va_arg(args, int);
+            } else if (length == 1) {
+                num = (short)va_arg(args, int);
+            } else if (length == 2) {
+                num = (char)va_arg(args, int);
+            } else if (length == 'z') {
+                num = va_arg(args, ssize_t);
+            } else {
+                num = va_arg(args, long);
             }
-            case '%': {
-                __emit_char(&buf, end, '%');
-                break;
+            __format_integer(sink, num, width, precision, flags);
+            break;
+        }
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': {
+            unsigned long num;
+            if (length == 0) {
+                num = va_arg(args, unsigned int);
+            } else if (length == 1) {
+                num = (unsigned short)va_arg(args, unsigned int);
+            } else if (length == 2) {
+                num = (unsigned char)va_arg(args, unsigned int);
+            } else if (length == 'z') {
+                num = va_arg(args, size_t);
+            } else {
+                num = va_arg(args, unsigned long);
             }
-            default: {
-                __emit_char(&buf, end, '%');
-                __emit_char(&buf, end, *format);
-                break;
+            int base;
+            if (*format == 'o') {
+                base = 8;
+            } else if (*format == 'x' || *format == 'X') {
+                base = 16;
+            } else {
+                base = 10;
             }
+            __format_unsigned(sink, num, base, width, precision, flags & ~(FLAGS_PLUS | FLAGS_SPACE));
+            break;
+        }
+        case 'p': {
+            __format_pointer(sink, va_arg(args, void *), width, flags);
+            break;
+        }
+        case 'f':
+        case 'F': {
+            __format_float(sink, va_arg(args, double), width, precision, flags);
+            break;
+        }
+        case 'n': {
+            // Stores the number of characters printed so far.
+            int *count_var = va_arg(args, int *);
+            if (count_var) {
+                *count_var = (int)sink->count;
             }
-        } else {
-            __emit_char(&buf, end, *format);
+            break;
+        }
+        case '%': {
+            __emit_char(sink, '%');
+            break;
+        }
+        case '\0': {
+            // The format ends with a lone '%'.
+            __emit_char(sink, '%');
+            continue;
+        }
+        default: {
+            __emit_char(sink, '%');
+            __emit_char(sink, *format);
+            break;
+        }
         }
-
         format++;
-        count++;
     }
-    if (buffer)
-        *buf = '\0';
-    return buf - buffer;
+    __sink_flush(sink);
+    return sink->error ? -1 : (int)sink->count;
+}
+
+int vsnprintf(char *buffer, size_t size, const char *format, va_list args)
+{
+    // The last character of the buffer is left for the terminator.
+    printf_sink_t sink = {buffer, (buffer && size) ? (size - 1) : 0, 0, 0, 0, NULL, NULL};
+    vprintf_sink(&sink, format, args);
+    if (buffer && size) {
+        buffer[sink.length] = '\0';
+    }
+    return (int)sink.count;
 }
 
 int vsprintf(char *str, const char *format, va_list args) { return vsnprintf(str, 4096, format, args); }
 
+/// @brief Writes the gathered characters on the screen.
+/// @param sink The sink.
+/// @return 0.
+static int __flush_video(printf_sink_t *sink)
+{
+    video_write(sink->buffer, sink->length);
+    return 0;
+}
+
 int printf(const char *format, ...)
 {
-    char buffer[4096];
+    char chunk[PRINTF_CHUNK];
+    printf_sink_t sink = {chunk, sizeof(chunk), 0, 0, 0, __flush_video, NULL};
     va_list ap;
     int len;
     va_start(ap, format);
-    len = vsnprintf(buffer, sizeof(buffer), format, ap);
+    len = vprintf_sink(&sink, format, ap);
     va_end(ap);
-    if (len > 0) {
-        video_puts(buffer);
-    }
     return len;
 }
 
@@ -219,6 +219,28 @@ block_found:
     return page;
 }
 
+int bb_split_pages(bb_instance_t *instance, bb_page_t *page)
+{
+    if (!instance || !page) {
+        pr_crit("Invalid arguments in bb_split_pages.\n");
+        return 0;
+    }
+    // Only the first page of an allocated block knows its order.
+    if (!__bb_test_flag(page, ROOT_PAGE) || __bb_test_flag(page, FREE_PAGE)) {
+        return 0;
+    }
+    // Each page becomes an allocated block of order zero, which can be freed,
+    // and merged again with its buddies, on its own.
+    for (unsigned int i = 1; i < (1UL << page->order); ++i) {
+        bb_page_t *split = __get_page_from_base(instance, page, i);
+        split->order     = 0;
+        __bb_set_flag(split, ROOT_PAGE);
+        __bb_clear_flag(split, FREE_PAGE);
+    }
+    page->order = 0;
+    return 1;
+}
+
 void bb_free_pages(bb_instance_t *instance, bb_page_t *page)
 {
     if (!instance) {
@@ -405,6 +427,10 @@ int buddy_system_init(
         list_head_init(&area->free_list);
     }
 
+    // Initialize the cache of single pages, which starts empty.
+    list_head_init(&instance->free_pages_cache_list);
+    instance->free_pages_cache_size = 0;
+
     // Current base page descriptor of the zone.
     bb_page_t *page              = instance->base_page;
     // Address of the last page descriptor of the zone.
@@ -486,21 +512,22 @@ unsigned long buddy_system_get_free_space(const bb_instance_t *instance)
 
 unsigned long buddy_system_get_cached_space(const bb_instance_t *instance)
 {
-    unsigned int size = 0;
-    for (int order = 0; order < MAX_BUDDYSYSTEM_GFP_ORDER; ++order) {
-        size += instance->free_pages_cache_size * PAGE_SIZE;
-    }
-    return size;
+    return instance->free_pages_cache_size * PAGE_SIZE;
 }
 
-/// @brief Extenmds the cache of the given amount.
+/// @brief Extends the cache of the given amount.
 /// @param instance the cache instance.
 /// @param count the amount to extend to.
 static void __cache_extend(bb_instance_t *instance, int count)
 {
     for (int i = 0; i < count; i++) {
         bb_page_t *page = bb_alloc_pages(instance, 0);
-        list_head_insert_after(&page->location.cache, &instance->free_pages_cache_list);
+        // Stop once the buddy system is out of memory.
+        if (!page) {
+            break;
+        }
+        // The cold end of the cache, pages freed later are used first.
+        list_head_insert_before(&page->location.cache, &instance->free_pages_cache_list);
         instance->free_pages_cache_size++;
     }
 }
@@ -520,7 +547,7 @@ static void __cache_shrink(bb_instance_t *instance, int count)
 
 /// @brief Allocate memory using the given cache.
 /// @param instance the cache instance.
-/// @return a pointer to the allocated page.
+/// @return a pointer to the allocated page, NULL if there is no memory left.
 static bb_page_t *__cached_alloc(bb_instance_t *instance)
 {
     if (instance->free_pages_cache_size < LOW_WATERMARK_LEVEL) {
@@ -529,7 +556,11 @@ static bb_page_t *__cached_alloc(bb_instance_t *instance)
         __cache_extend(instance, pages_to_request);
     }
     list_head_t *page_list = list_head_pop(&instance->free_pages_cache_list);
-    bb_page_t *page        = list_entry(page_list, bb_page_t, location.cache);
+    if (!page_list) {
+        return NULL;
+    }
+    instance->free_pages_cache_size--;
+    bb_page_t *page = list_entry(page_list, bb_page_t, location.cache);
     return page;
 }
 
@@ -538,7 +569,9 @@ static bb_page_t *__cached_alloc(bb_instance_t *instance)
 /// @param page a pointer to the allocated page.
 static void __cached_free(bb_instance_t *instance, bb_page_t *page)
 {
+    // The hot end of the cache, the page is likely still inside the CPU caches.
     list_head_insert_after(&page->location.cache, &instance->free_pages_cache_list);
+    instance->free_pages_cache_size++;
 
     if (instance->free_pages_cache_size > HIGH_WATERMARK_LEVEL) {
         // Free pages to the buddy system
@@ -550,3 +583,15 @@ static void __cached_free(bb_instance_t *instance, bb_page_t *page)
 bb_page_t *bb_alloc_page_cached(bb_instance_t *instance) { return __cached_alloc(instance); }
 
 void bb_free_page_cached(bb_instance_t *instance, bb_page_t *page) { __cached_free(instance, page); }
+
+void bb_free_page_list_cached(bb_instance_t *instance, list_head_t *pages)
+{
+    list_head_t *entry;
+    while ((entry = list_head_pop(pages)) != NULL) {
+        list_head_insert_after(entry, &instance->free_pages_cache_list);
+        instance->free_pages_cache_size++;
+    }
+    if (instance->free_pages_cache_size > HIGH_WATERMARK_LEVEL) {
+        __cache_shrink(instance, instance->free_pages_cache_size - MID_WATERMARK_LEVEL);
+    }
+}
@@ -2,7 +2,9 @@
 /// @brief Memory slab allocator implementation in kernel. This file provides
 /// functions for managing memory allocation using the slab allocator technique.
 /// Slab allocators are efficient in managing frequent small memory allocations
-/// with minimal fragmentation.
+/// with minimal fragmentation. Each cache keeps its recently freed objects
+/// inside two small magazines, which serve most allocations and frees without
+/// touching the slab lists.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
@@ -16,7 +18,11 @@
 #include "mem/paging.h"
 #include "mem/alloc/slab.h"
 #include "mem/alloc/zone_allocator.h"
+#include "mem/mm/shrinker.h"
 #include "resource_tracing.h"
+#include "stdio.h"
+#include "sys/cache.h"
+#include "system/trace.h"
 
 #ifdef ENABLE_KMEM_TRACE
 /// @brief Tracks the unique ID of the currently registered resource.
@@ -31,10 +37,13 @@ typedef struct kmem_obj {
     list_head_t objlist;
 } kmem_obj_t;
 
-/// @brief Maximum order of kmalloc cache allocations.
-/// @details If a requested memory allocation exceeds this order, a raw page
-/// allocation is done instead of using the slab cache.
-#define MAX_KMALLOC_CACHE_ORDER 12
+/// @brief Number of kmalloc caches.
+/// @details If a requested memory allocation exceeds the largest one, a raw
+/// page allocation is done instead of using the slab cache.
+#define KMALLOC_CACHE_COUNT 14
+
+/// @brief The largest size served by the kmalloc caches.
+#define KMALLOC_MAX_CACHE_SIZE 2048
 
 /// @brief Overhead size for each memory object in the slab cache.
 /// @details This defines the extra space required for managing the object,
@@ -50,6 +59,15 @@ typedef struct kmem_obj {
 /// the slab when it runs out of free objects.
 #define KMEM_MAX_REFILL_OBJ_COUNT 64
 
+/// @brief The order up to which slabs grow to reduce the space wasted at their end.
+#define KMEM_MAX_WASTE_ORDER 3
+
+/// @brief The space wasted at the end of a slab must not exceed 1/KMEM_MAX_WASTE_FRACTION of it.
+#define KMEM_MAX_WASTE_FRACTION 8
+
+/// @brief The step between the colours of the slabs, the size of a cache line.
+#define KMEM_COLOUR_SIZE L1_CACHE_BYTES
+
 /// @brief Macro to convert an address into a kmem_obj pointer.
 /// @param addr Address of the object.
 /// @return Pointer to a kmem_obj structure.
@@ -66,8 +84,43 @@ static list_head_t kmem_caches_list;
 /// @brief Cache used for managing metadata about the memory caches themselves.
 static kmem_cache_t kmem_cache;
 
-/// @brief Array of slab caches for different orders of kmalloc.
-static kmem_cache_t *malloc_blocks[MAX_KMALLOC_CACHE_ORDER];
+/// @brief The sizes of the kmalloc caches: powers of two, and the sizes
+/// halfway between them from 96 bytes on.
+static const unsigned int kmalloc_sizes[KMALLOC_CACHE_COUNT] = {
+    8, 16, 32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, KMALLOC_MAX_CACHE_SIZE,
+};
+
+/// @brief Array of slab caches for the different sizes of kmalloc.
+static kmem_cache_t *malloc_blocks[KMALLOC_CACHE_COUNT] __cacheline_aligned;
+
+/// @brief Returns the logarithm of the smallest power of two not below the given value.
+/// @param value the value, at least 2.
+/// @return the logarithm.
+static inline unsigned int __kmalloc_ceil_log2(unsigned int value) { return 32 - __builtin_clz(value - 1); }
+
+/// @brief Returns the index of the smallest kmalloc cache fitting the given size.
+/// @param size the size, at most KMALLOC_MAX_CACHE_SIZE.
+/// @return the index inside malloc_blocks.
+static inline unsigned int __kmalloc_index(unsigned int size)
+{
+    if (size <= 8) {
+        return 0;
+    }
+    unsigned int order = __kmalloc_ceil_log2(size);
+    if (order <= 6) {
+        return order - 3;
+    }
+    // From 2^7 on, each power of two is preceded by the size at 3/4 of it.
+    return 4 + 2 * (order - 7) + (size > (3U << (order - 2)));
+}
+
+/// @brief Returns the step between the colours of the slabs of a cache.
+/// @param cachep Pointer to the memory cache.
+/// @return A cache line, or the alignment of the objects if larger.
+static inline unsigned int __kmem_colour_size(kmem_cache_t *cachep)
+{
+    return max(KMEM_COLOUR_SIZE, max(8, cachep->align));
+}
 
 /// @brief Allocates and initializes a new slab page for a memory cache.
 /// @param cachep Pointer to the memory cache (`kmem_cache_t`) for which a new
@@ -107,9 +160,13 @@ static inline int __alloc_slab_page(kmem_cache_t *cachep, gfp_t flags)
     // Calculate the total size of the slab (in bytes).
     unsigned slab_size = PAGE_SIZE * (1U << cachep->gfp_order);
 
+    // Shift the objects by the colour of the slab, rotating among the colours.
+    unsigned colour_offset = cachep->colour_next * __kmem_colour_size(cachep);
+    cachep->colour_next    = (cachep->colour_next + 1) % cachep->colour_count;
+
     // Update object counters for the page.
-    page->slab_objcnt  = slab_size / cachep->aligned_object_size; // Total number of objects.
-    page->slab_objfree = page->slab_objcnt;                       // Initially, all objects are free.
+    page->slab_objcnt  = (slab_size - colour_offset) / cachep->aligned_object_size; // Total number of objects.
+    page->slab_objfree = page->slab_objcnt;                                         // Initially, all objects are free.
 
     // Get the starting virtual address of the allocated slab page.
     unsigned pg_addr = get_virtual_address_from_page(page);
@@ -130,7 +187,7 @@ static inline int __alloc_slab_page(kmem_cache_t *cachep, gfp_t flags)
     // Initialize each object in the slab and insert it into the free list.
     for (unsigned i = 0; i < page->slab_objcnt; i++) {
         // Calculate the object's address.
-        kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(pg_addr + cachep->aligned_object_size * i);
+        kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(pg_addr + colour_offset + cachep->aligned_object_size * i);
 
         // Initialize the list head.
         list_head_init(&object->objlist);
@@ -225,15 +282,17 @@ static int __compute_size_and_order(kmem_cache_t *cachep)
 
     // Compute the `gfp_order` based on the total object size and page size.
     // The `gfp_order` determines how many contiguous pages will be allocated
-    // for the slab.
-    unsigned int size = round_up(cachep->aligned_object_size, PAGE_SIZE) / PAGE_SIZE;
-
-    // Reset `gfp_order` to 0 before calculating.
+    // for the slab: the smallest one holding an object, grown while the space
+    // left at the end of the slab exceeds 1/KMEM_MAX_WASTE_FRACTION of it.
     cachep->gfp_order = 0;
-
-    // Calculate the order by determining how many divisions by 2 the size
-    // undergoes until it becomes smaller than or equal to 1.
-    while ((size /= 2) > 0) {
+    while ((PAGE_SIZE << cachep->gfp_order) < cachep->aligned_object_size) {
+        cachep->gfp_order++;
+    }
+    while (cachep->gfp_order < KMEM_MAX_WASTE_ORDER) {
+        unsigned int slab_size = PAGE_SIZE << cachep->gfp_order;
+        if (((slab_size % cachep->aligned_object_size) * KMEM_MAX_WASTE_FRACTION) <= slab_size) {
+            break;
+        }
         cachep->gfp_order++;
     }
 
@@ -254,6 +313,13 @@ static int __compute_size_and_order(kmem_cache_t *cachep)
         return -1;
     }
 
+    // The space left at the end of the slab is used to shift the objects of
+    // each slab by a different number of cache lines (its colour), so that
+    // objects of different slabs do not contend for the same cache sets.
+    unsigned int slab_size = PAGE_SIZE << cachep->gfp_order;
+    cachep->colour_count   = ((slab_size % cachep->aligned_object_size) / __kmem_colour_size(cachep)) + 1;
+    cachep->colour_next    = 0;
+
     pr_debug(
         "Computed aligned object size `%u` and gfp_order `%u` for cache "
         "`%s`.\n",
@@ -307,14 +373,23 @@ static int __kmem_cache_create(
         .align               = align,
         .total_num           = 0,
         .free_num            = 0,
+        .nr_allocs           = 0,
+        .nr_failures         = 0,
         .flags               = flags,
         .gfp_order           = 0,
+        .colour_count        = 1,
+        .colour_next         = 0,
         .ctor                = ctor,
         .dtor                = dtor,
         .slabs_full          = {NULL, NULL},
         .slabs_partial       = {NULL, NULL},
         .slabs_free          = {NULL, NULL},
+        .loaded              = NULL,
+        .previous            = NULL,
+        .magazines           = {{0}, {0}},
     };
+    cachep->loaded   = &cachep->magazines[0];
+    cachep->previous = &cachep->magazines[1];
 
     // Initialize the list heads for free, partial, and full slabs.
     list_head_init(&cachep->slabs_free);
@@ -346,7 +421,6 @@ static int __kmem_cache_create(
 /// @brief Allocates an object from a specified slab page.
 /// @details This function retrieves a free object from the given slab page's free list.
 /// It decrements the count of free objects in both the slab page and the cache.
-/// If the constructor function is defined, it will be called to initialize the object.
 /// @param cachep Pointer to the cache from which the object is being allocated.
 /// @param slab_page Pointer to the slab page from which to allocate the object.
 /// @return Pointer to the allocated object, or NULL if allocation fails.
@@ -392,11 +466,6 @@ static inline void *__kmem_cache_alloc_slab(kmem_cache_t *cachep, page_t *slab_p
     // Get the address of the allocated element from the kmem object.
     void *elem = ADDR_FROM_KMEM_OBJ(object);
 
-    // Call the constructor function if it is defined to initialize the object.
-    if (cachep->ctor) {
-        cachep->ctor(elem);
-    }
-
     pr_debug("Successfully allocated object 0x%p from cache `%s`.\n", elem, cachep->name);
 
     return elem;
@@ -454,13 +523,129 @@ static inline int __kmem_cache_free_slab(kmem_cache_t *cachep, page_t *slab_page
     return 0;
 }
 
+/// @brief Returns the main slab page holding an object.
+/// @param addr Address of the object.
+/// @return Pointer to the slab page, or NULL if it cannot be found.
+static inline page_t *__kmem_cache_get_slab(void *addr)
+{
+    // Get the slab page corresponding to the given pointer.
+    page_t *slab_page = get_page_from_virtual_address((uint32_t)addr);
+
+    // Check if slab_page retrieval was successful
+    if (!slab_page) {
+        pr_crit("Failed to get slab page for pointer 0x%p.\n", addr);
+        return NULL;
+    }
+
+    // If the slab main page is a low memory page, update to the root page.
+    if (is_lowmem_page_struct(slab_page->container.slab_main_page)) {
+        slab_page = slab_page->container.slab_main_page;
+    }
+    return slab_page;
+}
+
+/// @brief Gives an object back to its slab, bypassing the magazines of the cache.
+/// @param cachep Pointer to the cache owning the object.
+/// @param slab_page Pointer to the slab page holding the object.
+/// @param addr Address of the object.
+/// @return 0 on success, 1 on error.
+static int __kmem_cache_free_object(kmem_cache_t *cachep, page_t *slab_page, void *addr)
+{
+    // Get the kmem_obj from the pointer.
+    kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(addr);
+
+    // Check if object retrieval was successful
+    if (!object) {
+        pr_crit("Failed to retrieve kmem object for pointer 0x%p.\n", addr);
+        return 1;
+    }
+
+    // Add object to the free list of the slab.
+    list_head_insert_after(&object->objlist, &slab_page->slab_freelist);
+    slab_page->slab_objfree++;
+    cachep->free_num++;
+
+    // Check if the slab is completely free, move it to the free list.
+    if (slab_page->slab_objfree == slab_page->slab_objcnt) {
+        // Remove the page from the partial list.
+        list_head_remove(&slab_page->slabs);
+        // Add the page to the free list.
+        list_head_insert_after(&slab_page->slabs, &cachep->slabs_free);
+        pr_debug("Slab page 0x%p moved to free list.\n", slab_page);
+    }
+    // If the page is not full, update its list status.
+    else if (slab_page->slab_objfree == 1) {
+        // Remove the page from the full list.
+        list_head_remove(&slab_page->slabs);
+        // Add the page to the partial list.
+        list_head_insert_after(&slab_page->slabs, &cachep->slabs_partial);
+        pr_debug("Slab page 0x%p moved to partial list.\n", slab_page);
+    }
+    return 0;
+}
+
+/// @brief Gives all the objects of a magazine back to their slabs.
+/// @param cachep Pointer to the cache owning the magazine.
+/// @param magazine Pointer to the magazine.
+static void __kmem_magazine_drain(kmem_cache_t *cachep, kmem_magazine_t *magazine)
+{
+    while (magazine->rounds > 0) {
+        void *addr        = magazine->objects[--magazine->rounds];
+        page_t *slab_page = __kmem_cache_get_slab(addr);
+        if (slab_page) {
+            __kmem_cache_free_object(cachep, slab_page, addr);
+        }
+    }
+}
+
+/// @brief Swaps the loaded and the previous magazines of a cache.
+/// @param cachep Pointer to the cache.
+static inline void __kmem_magazine_swap(kmem_cache_t *cachep)
+{
+    kmem_magazine_t *magazine = cachep->loaded;
+    cachep->loaded            = cachep->previous;
+    cachep->previous          = magazine;
+}
+
+/// @brief Gives the empty slabs of the caches back to the page allocator.
+/// @param shrinker the shrinker of the slab allocator.
+/// @param nr_pages the number of pages to free.
+/// @return the number of pages freed.
+static unsigned long __kmem_cache_scan(shrinker_t *shrinker, unsigned long nr_pages)
+{
+    unsigned long freed = 0;
+    list_for_each_decl (it, &kmem_caches_list) {
+        if (freed >= nr_pages) {
+            break;
+        }
+        kmem_cache_t *cachep = list_entry(it, kmem_cache_t, cache_list);
+        // The objects inside the magazines keep their slabs in use.
+        __kmem_magazine_drain(cachep, cachep->loaded);
+        __kmem_magazine_drain(cachep, cachep->previous);
+        while (!list_head_empty(&cachep->slabs_free) && (freed < nr_pages)) {
+            page_t *slab_page = list_entry(list_head_pop(&cachep->slabs_free), page_t, slabs);
+            if (__kmem_cache_free_slab(cachep, slab_page) == 0) {
+                freed += 1U << cachep->gfp_order;
+            }
+        }
+    }
+    return freed;
+}
+
+/// @brief The shrinker of the slab allocator.
+static shrinker_t kmem_shrinker = {
+    .name  = "slab",
+    .scan  = __kmem_cache_scan,
+    .flags = 0,
+};
+
 int kmem_cache_init(void)
 {
     // Initialize the list of caches to keep track of all memory caches.
     list_head_init(&kmem_caches_list);
 
 #ifdef ENABLE_KMEM_TRACE
-    ENABLE_EXT2_TRACE = register_resource("kmem");
+    resource_id = register_resource("kmem");
 #endif
 
     // Create a cache to store metadata about kmem_cache_t structures.
@@ -470,25 +655,25 @@ int kmem_cache_init(void)
         return -1;
     }
 
-    // Create caches for different order sizes for kmalloc allocations.
-    for (unsigned i = 0; i < MAX_KMALLOC_CACHE_ORDER; i++) {
+    // Create caches for the different sizes of kmalloc allocations.
+    for (unsigned i = 0; i < KMALLOC_CACHE_COUNT; i++) {
         malloc_blocks[i] = kmem_cache_create(
             "kmalloc",
-            1U << i, // Size of the allocation (2^i).
-            1U << i, // Alignment of the allocation.
+            kmalloc_sizes[i],                     // Size of the allocation.
+            kmalloc_sizes[i] & -kmalloc_sizes[i], // Alignment, the largest power of two dividing the size.
             GFP_KERNEL,
             NULL,  // Constructor (none).
             NULL); // Destructor (none).
 
         // Check if the cache was created successfully.
         if (!malloc_blocks[i]) {
-            pr_crit("Failed to create kmalloc cache for order %u.\n", i);
+            pr_crit("Failed to create kmalloc cache for size %u.\n", kmalloc_sizes[i]);
 
             // Clean up any previously allocated caches before exiting.
             for (unsigned j = 0; j < i; j++) {
                 if (malloc_blocks[j]) {
                     if (kmem_cache_destroy(malloc_blocks[j]) < 0) {
-                        pr_crit("Failed to destroy kmalloc cache for order %u.\n", j);
+                        pr_crit("Failed to destroy kmalloc cache for size %u.\n", kmalloc_sizes[j]);
                     }
                     malloc_blocks[j] = NULL;
                 }
@@ -501,6 +686,9 @@ int kmem_cache_init(void)
         }
     }
 
+    // Give the empty slabs back once memory runs low.
+    register_shrinker(&kmem_shrinker);
+
     pr_info("kmem_cache system successfully initialized.\n");
 
     return 0;
@@ -560,6 +748,10 @@ int kmem_cache_destroy(kmem_cache_t *cachep)
         return -1;
     }
 
+    // Give the objects held by the magazines back to their slabs.
+    __kmem_magazine_drain(cachep, cachep->loaded);
+    __kmem_magazine_drain(cachep, cachep->previous);
+
     // Free all slabs in the free list.
     while (!list_head_empty(&cachep->slabs_free)) {
         list_head_t *slab_list = list_head_pop(&cachep->slabs_free);
@@ -604,14 +796,12 @@ int kmem_cache_destroy(kmem_cache_t *cachep)
     return 0;
 }
 
-void *pr_kmem_cache_alloc(const char *file, const char *fun, int line, kmem_cache_t *cachep, gfp_t flags)
+/// @brief Allocates an object from the slabs of a cache, bypassing its magazines.
+/// @param cachep Pointer to the cache from which the object is being allocated.
+/// @param flags Allocation flags used if the cache has to be refilled.
+/// @return Pointer to the allocated object, or NULL if allocation fails.
+static void *__kmem_cache_alloc_object(kmem_cache_t *cachep, gfp_t flags)
 {
-    // Check for null cache pointer
-    if (!cachep) {
-        pr_err("Null cache pointer provided.\n");
-        return NULL;
-    }
-
     // Check if there are any partially filled slabs.
     if (list_head_empty(&cachep->slabs_partial)) {
         // If no partial slabs, check for free slabs.
@@ -668,6 +858,47 @@ void *pr_kmem_cache_alloc(const char *file, const char *fun, int line, kmem_cach
         list_head_insert_after(slab_full_elem, &cachep->slabs_full);
     }
 
+    return ptr; // Return pointer to the allocated object.
+}
+
+void *pr_kmem_cache_alloc(const char *file, const char *fun, int line, kmem_cache_t *cachep, gfp_t flags)
+{
+    // Check for null cache pointer
+    if (!cachep) {
+        pr_err("Null cache pointer provided.\n");
+        return NULL;
+    }
+
+    // Objects are taken from the loaded magazine, without touching the slabs.
+    // Once both magazines are empty, half of the loaded one is filled from
+    // the slabs at once.
+    if (cachep->loaded->rounds == 0) {
+        if (cachep->previous->rounds > 0) {
+            __kmem_magazine_swap(cachep);
+        } else {
+            kmem_magazine_t *magazine = cachep->loaded;
+            while (magazine->rounds < (KMEM_MAGAZINE_SIZE / 2)) {
+                void *object = __kmem_cache_alloc_object(cachep, flags);
+                if (!object) {
+                    break;
+                }
+                magazine->objects[magazine->rounds++] = object;
+            }
+            if (magazine->rounds == 0) {
+                pr_crit("Failed to fill the magazine of cache `%s`.\n", cachep->name);
+                cachep->nr_failures++;
+                return NULL;
+            }
+        }
+    }
+    void *ptr = cachep->loaded->objects[--cachep->loaded->rounds];
+    cachep->nr_allocs++;
+
+    // Call the constructor function if it is defined to initialize the object.
+    if (cachep->ctor) {
+        cachep->ctor(ptr);
+    }
+
 #if defined(ENABLE_CACHE_TRACE) || (__DEBUG_LEVEL__ >= LOGLEVEL_DEBUG)
     pr_notice("kmem_cache_alloc 0x%p in %-20s at %s:%d\n", ptr, cachep->name, file, line);
 #endif
@@ -684,19 +915,11 @@ int pr_kmem_cache_free(const char *file, const char *fun, int line, void *addr)
     }
 
     // Get the slab page corresponding to the given pointer.
-    page_t *slab_page = get_page_from_virtual_address((uint32_t)addr);
-
-    // Check if slab_page retrieval was successful
+    page_t *slab_page = __kmem_cache_get_slab(addr);
     if (!slab_page) {
-        pr_crit("Failed to get slab page for pointer 0x%p.\n", addr);
         return 1;
     }
 
-    // If the slab main page is a low memory page, update to the root page.
-    if (is_lowmem_page_struct(slab_page->container.slab_main_page)) {
-        slab_page = slab_page->container.slab_main_page;
-    }
-
     // Retrieve the cache pointer from the slab page.
     kmem_cache_t *cachep = slab_page->container.slab_cache;
 
@@ -715,72 +938,48 @@ int pr_kmem_cache_free(const char *file, const char *fun, int line, void *addr)
         cachep->dtor(addr);
     }
 
-    // Get the kmem_obj from the pointer.
-    kmem_obj_t *object = KMEM_OBJ_FROM_ADDR(addr);
-
-    // Check if object retrieval was successful
-    if (!object) {
-        pr_crit("Failed to retrieve kmem object for pointer 0x%p.\n", addr);
-        return 1;
-    }
-
-    // Add object to the free list of the slab.
-    list_head_insert_after(&object->objlist, &slab_page->slab_freelist);
-    slab_page->slab_objfree++;
-    cachep->free_num++;
-
-    // Check if the slab is completely free, move it to the free list.
-    if (slab_page->slab_objfree == slab_page->slab_objcnt) {
-        // Remove the page from the partial list.
-        list_head_remove(&slab_page->slabs);
-        // Add the page to the free list.
-        list_head_insert_after(&slab_page->slabs, &cachep->slabs_free);
-        pr_debug("Slab page 0x%p moved to free list.\n", slab_page);
-    }
-    // If the page is not full, update its list status.
-    else if (slab_page->slab_objfree == 1) {
-        // Remove the page from the full list.
-        list_head_remove(&slab_page->slabs);
-        // Add the page to the partial list.
-        list_head_insert_after(&slab_page->slabs, &cachep->slabs_partial);
-        pr_debug("Slab page 0x%p moved to partial list.\n", slab_page);
+    // Objects are placed inside the loaded magazine. Once both magazines are
+    // full, the previous one is given back to the slabs.
+    if (cachep->loaded->rounds == KMEM_MAGAZINE_SIZE) {
+        if (cachep->previous->rounds > 0) {
+            __kmem_magazine_drain(cachep, cachep->previous);
+        }
+        __kmem_magazine_swap(cachep);
     }
+    cachep->loaded->objects[cachep->loaded->rounds++] = addr;
     return 0;
 }
 
 void *pr_kmalloc(const char *file, const char *fun, int line, unsigned int size)
 {
-    unsigned int order = 0;
-
-    // Determine the order based on the size requested.
-    while (size != 0) {
-        order++;
-        size /= 2;
-    }
-
-    // Allocate memory. If size exceeds the maximum cache order, allocate raw pages.
+    // Allocate memory. If size exceeds the largest cache, allocate raw pages.
     void *ptr;
-    if (order >= MAX_KMALLOC_CACHE_ORDER) {
-        ptr = (void *)alloc_pages_lowmem(GFP_KERNEL, order - 12);
+    if (size > KMALLOC_MAX_CACHE_SIZE) {
+        unsigned int pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        unsigned int order = (pages > 1) ? __kmalloc_ceil_log2(pages) : 0;
+        ptr                = (void *)alloc_pages_lowmem(GFP_KERNEL, order);
         if (!ptr) {
             pr_crit("Failed to allocate raw pages for order %u at %s:%d\n", order, file, line);
         }
     } else {
-        ptr = kmem_cache_alloc(malloc_blocks[order], GFP_KERNEL);
+        ptr = kmem_cache_alloc(malloc_blocks[__kmalloc_index(size)], GFP_KERNEL);
         if (!ptr) {
             pr_crit(
-                "Failed to allocate from kmalloc cache order %u for size %u at "
+                "Failed to allocate from kmalloc cache of size %u for size %u at "
                 "%s:%d\n",
-                order, size, file, line);
+                kmalloc_sizes[__kmalloc_index(size)], size, file, line);
         }
     }
 
 #ifdef ENABLE_KMEM_TRACE
     if (ptr) {
-        pr_notice("kmalloc 0x%p of order %u at %s:%d\n", ptr, order, file, line);
+        pr_notice("kmalloc 0x%p of size %u at %s:%d\n", ptr, size, file, line);
     }
-    store_resource_info(resource_id, file, line, ptr);
+    store_resource_info(resource_id, file, line, ptr, size);
 #endif
+    if (ptr) {
+        trace_point(TRACE_KMALLOC, ptr, size, 0);
+    }
     return ptr;
 }
 
@@ -790,6 +989,7 @@ void pr_kfree(const char *file, const char *fun, int line, void *ptr)
         pr_warning("Attempt to free NULL pointer at %s:%d\n", file, line);
         return;
     }
+    trace_point(TRACE_KFREE, ptr, 0, 0);
 
     // Get the slab page from the pointer's address.
     page_t *page = get_page_from_virtual_address((uint32_t)ptr);
@@ -818,6 +1018,27 @@ void pr_kfree(const char *file, const char *fun, int line, void *ptr)
 #ifdef ENABLE_KMEM_TRACE
     pr_notice("kfree   0x%p at %s:%d\n", ptr, file, line);
     clear_resource_info(ptr);
-    print_resource_usage(resource_id, NULL);
 #endif
 }
+
+ssize_t kmem_cache_stats_dump(char *buffer, size_t bufsize)
+{
+    size_t written = snprintf(
+        buffer, bufsize, "%-24s %8s %8s %7s %6s %5s : %6s %6s : %8s %6s\n", "# name", "active", "total", "objsize",
+        "objper", "pages", "active", "slabs", "allocs", "fails");
+    list_for_each_decl (it, &kmem_caches_list) {
+        kmem_cache_t *cachep = list_entry(it, kmem_cache_t, cache_list);
+        if (written >= bufsize) {
+            break;
+        }
+        unsigned int cached = cachep->loaded->rounds + cachep->previous->rounds;
+        unsigned int used   = list_head_size(&cachep->slabs_full) + list_head_size(&cachep->slabs_partial);
+        unsigned int slabs  = used + list_head_size(&cachep->slabs_free);
+        unsigned int objper = slabs ? (cachep->total_num / slabs) : 0;
+        written += snprintf(
+            buffer + written, bufsize - written, "%-24s %8u %8u %7u %6u %5u : %6u %6u : %8lu %6lu\n", cachep->name,
+            cachep->total_num - cachep->free_num - cached, cachep->total_num, cachep->aligned_object_size, objper,
+            1U << cachep->gfp_order, used, slabs, cachep->nr_allocs, cachep->nr_failures);
+    }
+    return min(written, bufsize);
+}
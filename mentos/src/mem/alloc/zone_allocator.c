@@ -15,9 +15,34 @@
 #include "mem/alloc/buddy_system.h"
 #include "mem/alloc/zone_allocator.h"
 #include "mem/mm/page.h"
+#include "mem/mm/shrinker.h"
+#include "mem/mm/vmem.h"
 #include "mem/paging.h"
+#include "stdbool.h"
+#include "stdio.h"
 #include "string.h"
 
+/// @brief Maximum number of pages inside the zero-filled pool of a zone.
+#define ZONE_ZERO_PAGES_MAX 64
+
+/// @brief Pages are zeroed in advance only while the zone has more free pages than this.
+#define ZONE_ZERO_PAGES_MIN_FREE (4 * ZONE_ZERO_PAGES_MAX)
+
+/// @brief The caches are shrunk while idle, once the free pages of a zone fall below this fraction of it.
+#define ZONE_WATERMARK_LOW(zone) ((zone)->num_pages / 32)
+
+/// @brief The caches are shrunk while idle, until the free pages of every zone reach this fraction of it.
+#define ZONE_WATERMARK_HIGH(zone) ((zone)->num_pages / 16)
+
+/// @brief Number of pages asked to the caches at each call of the idle reclaim.
+#define ZONE_RECLAIM_BATCH 8
+
+/// @brief Number of times an allocation asks the caches for pages, before failing.
+#define ZONE_RECLAIM_RETRIES 4
+
+/// @brief If a zone fell below its low watermark, and the caches must be shrunk while idle.
+static bool_t zone_reclaim_pending = false;
+
 /// @brief Aligns the given address down to the nearest page boundary.
 /// @param addr The address to align.
 /// @return The aligned address.
@@ -157,7 +182,7 @@ static zone_t *get_zone_from_flags(gfp_t gfp_mask)
     }
 
     // Determine the appropriate zone based on the given GFP mask.
-    switch (gfp_mask) {
+    switch (gfp_mask & ~__GFP_ZERO) {
     case GFP_KERNEL:
     case GFP_ATOMIC:
     case GFP_NOFS:
@@ -189,8 +214,10 @@ static inline int is_memory_clean(gfp_t gfp_mask)
         pr_emerg("Failed to get zone from GFP mask.\n");
         return 0;
     }
-    // Check if the total size of the zone matches the free space in the buddy system.
-    unsigned long free_space = buddy_system_get_free_space(&zone->buddy_system);
+    // Check if the total size of the zone matches the free space in the buddy
+    // system, including the pages waiting inside its cache.
+    unsigned long free_space =
+        buddy_system_get_free_space(&zone->buddy_system) + buddy_system_get_cached_space(&zone->buddy_system);
     if (zone->total_size != free_space) {
         pr_crit("Memory zone check failed for zone '%s'.\n", zone->name);
         pr_crit("Expected free space %lu bytes, but found %lu bytes.\n", zone->total_size, free_space);
@@ -386,6 +413,14 @@ static int zone_init(char *name, int zone_index, uint32_t adr_from, uint32_t adr
     // Clear the page structures in the memory map.
     memset(zone->zone_mem_map, 0, zone->num_pages * sizeof(page_t));
 
+    // The pool of zero-filled pages starts empty.
+    list_head_init(&zone->zero_pages);
+    zone->nr_zero_pages = 0;
+
+    // Clear the allocation counters.
+    memset(zone->nr_allocs, 0, sizeof(zone->nr_allocs));
+    memset(zone->nr_failures, 0, sizeof(zone->nr_failures));
+
     // Initialize the buddy system for the new zone.
     if (!buddy_system_init(
             &zone->buddy_system,             // Buddy system structure for the zone.
@@ -587,6 +622,86 @@ int pmmngr_init(boot_info_t *boot_info)
     return pmm_check();
 }
 
+/// @brief Fills a page with zeros.
+/// @param page The page.
+/// @return 0 on success, -1 if the page could not be mapped.
+static int __zone_clear_page(page_t *page)
+{
+    // Low memory is always mapped, high memory is mapped just for the time needed.
+    void *vaddr = kmap_atomic(page);
+    if (!vaddr) {
+        pr_crit("Failed to map the physical page to virtual address.\n");
+        return -1;
+    }
+    memset(vaddr, 0, PAGE_SIZE);
+    kunmap_atomic(vaddr);
+    return 0;
+}
+
+/// @brief Gives the pages of the zero-filled pool back to the buddy system.
+/// @param zone The zone.
+static void __zone_drain_zero_pages(zone_t *zone)
+{
+    while (!list_head_empty(&zone->zero_pages)) {
+        page_t *page = list_entry(list_head_pop(&zone->zero_pages), page_t, bbpage.location.cache);
+        bb_free_page_cached(&zone->buddy_system, &page->bbpage);
+        zone->nr_zero_pages--;
+        zone->free_pages++;
+    }
+}
+
+int zone_zero_idle_page(void)
+{
+    if (!memory.page_data) {
+        return 0;
+    }
+    // User pages are the ones faulted in zero-filled, fill their pool first.
+    static const int zones[] = { ZONE_HIGHMEM, ZONE_NORMAL };
+    for (unsigned i = 0; i < count_of(zones); ++i) {
+        zone_t *zone = &memory.page_data->node_zones[zones[i]];
+        // Leave the free pages to the buddy system once memory runs low.
+        if ((zone->nr_zero_pages >= ZONE_ZERO_PAGES_MAX) || (zone->free_pages <= ZONE_ZERO_PAGES_MIN_FREE)) {
+            continue;
+        }
+        bb_page_t *bbpage = bb_alloc_page_cached(&zone->buddy_system);
+        if (!bbpage) {
+            continue;
+        }
+        page_t *page = PG_FROM_BBSTRUCT(bbpage, page_t, bbpage);
+        if (__zone_clear_page(page) < 0) {
+            bb_free_page_cached(&zone->buddy_system, bbpage);
+            continue;
+        }
+        // The page is out of the buddy system, and linked as its cache would do.
+        list_head_insert_after(&page->bbpage.location.cache, &zone->zero_pages);
+        zone->nr_zero_pages++;
+        zone->free_pages--;
+        return 1;
+    }
+    return 0;
+}
+
+int zone_reclaim_idle(void)
+{
+    if (!zone_reclaim_pending || !memory.page_data) {
+        return 0;
+    }
+    static const int zones[] = { ZONE_NORMAL, ZONE_HIGHMEM };
+    for (unsigned i = 0; i < count_of(zones); ++i) {
+        zone_t *zone = &memory.page_data->node_zones[zones[i]];
+        if (zone->free_pages >= ZONE_WATERMARK_HIGH(zone)) {
+            continue;
+        }
+        // The caches are not tied to a zone, ask them until they run dry.
+        if (shrink_caches(ZONE_RECLAIM_BATCH, SHRINKER_FS) > 0) {
+            return 1;
+        }
+        break;
+    }
+    zone_reclaim_pending = false;
+    return 0;
+}
+
 page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_mask, uint32_t order)
 {
     // Calculate the block size based on the order.
@@ -601,12 +716,50 @@ page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_m
         return NULL; // Return NULL to indicate failure.
     }
 
-    // Allocate a page from the buddy system of the zone.
-    bb_page_t *bbpage = bb_alloc_pages(&zone->buddy_system, order);
+    // Zero-filled single pages are taken from the pool, when it is not empty.
+    if ((gfp_mask & __GFP_ZERO) && (order == 0) && !list_head_empty(&zone->zero_pages)) {
+        page_t *page = list_entry(list_head_pop(&zone->zero_pages), page_t, bbpage.location.cache);
+        zone->nr_zero_pages--;
+        zone->nr_allocs[0]++;
+        set_page_count(page, 1);
+#ifdef ENABLE_PAGE_TRACE
+        pr_notice("BS-A: (page: %p order: %d)\n", page, order);
+#endif
+        return page;
+    }
+
+    // Allocate a page from the buddy system of the zone. Single pages come
+    // from the cache of the zone, which is refilled and drained in batches.
+    bb_page_t *bbpage;
+    for (int retry = 0;; ++retry) {
+        if (order == 0) {
+            bbpage = bb_alloc_page_cached(&zone->buddy_system);
+        } else {
+            bbpage = bb_alloc_pages(&zone->buddy_system, order);
+        }
+        if (bbpage) {
+            break;
+        }
+        // Once memory runs out, give the zero-filled pool back, then ask the
+        // caches for their pages, then swap out the pages of the processes,
+        // and try again. The shrinkers entering a filesystem are left to the
+        // idle reclaim, as we might be inside one, and those doing I/O are
+        // skipped for the block drivers, which might be writing the swap.
+        if (zone->nr_zero_pages) {
+            __zone_drain_zero_pages(zone);
+        } else if (
+            (retry >= ZONE_RECLAIM_RETRIES) ||
+            (!shrink_caches(block_size, 0) &&
+             (!(gfp_mask & __GFP_IO) || !shrink_caches(block_size, SHRINKER_IO)))) {
+            break;
+        }
+    }
 
     // Ensure the allocation was successful.
     if (!bbpage) {
         pr_crit("Failed to allocate page from buddy system.\n");
+        // Orders past the largest one can never be satisfied, count them with it.
+        zone->nr_failures[min(order, MAX_BUDDYSYSTEM_GFP_ORDER - 1)]++;
         return NULL; // Return NULL to indicate failure.
     }
 
@@ -626,6 +779,22 @@ page_t *pr_alloc_pages(const char *file, const char *func, int line, gfp_t gfp_m
 
     // Decrement the number of free pages in the zone.
     zone->free_pages -= block_size;
+    zone->nr_allocs[order]++;
+
+    // Shrink the caches while idle, before memory runs out.
+    if (zone->free_pages < ZONE_WATERMARK_LOW(zone)) {
+        zone_reclaim_pending = true;
+    }
+
+    // Clear the pages, if requested.
+    if (gfp_mask & __GFP_ZERO) {
+        for (uint32_t i = 0; i < block_size; i++) {
+            if (__zone_clear_page(&page[i]) < 0) {
+                free_pages(page);
+                return NULL;
+            }
+        }
+    }
 
 #ifdef ENABLE_PAGE_TRACE
     pr_notice("BS-A: (page: %p order: %d)\n", page, order);
@@ -660,8 +829,12 @@ int pr_free_pages(const char *file, const char *func, int line, page_t *page)
         set_page_count(&page[i], 0);
     }
 
-    // Free the pages in the buddy system.
-    bb_free_pages(&zone->buddy_system, &page->bbpage);
+    // Free the pages in the buddy system, single pages go back to the cache.
+    if (order == 0) {
+        bb_free_page_cached(&zone->buddy_system, &page->bbpage);
+    } else {
+        bb_free_pages(&zone->buddy_system, &page->bbpage);
+    }
 
     // Increment the number of free pages in the zone.
     zone->free_pages += block_size;
@@ -673,6 +846,69 @@ int pr_free_pages(const char *file, const char *func, int line, page_t *page)
     return 0;
 }
 
+void page_batch_init(page_batch_t *batch)
+{
+    for (int zone_index = 0; zone_index < __MAX_NR_ZONES; zone_index++) {
+        list_head_init(&batch->zones[zone_index]);
+    }
+    batch->count = 0;
+}
+
+void page_batch_add(page_batch_t *batch, page_t *page)
+{
+    zone_t *zone = get_zone_from_page(page);
+    if (!zone) {
+        pr_emerg("Failed to get zone from page. Page is over memory size.\n");
+        return;
+    }
+    // A block reached twice, through a page shared by two areas, is gathered once.
+    if (page_count(page) == 0) {
+        return;
+    }
+    uint32_t block_size = 1UL << page->bbpage.order;
+    for (uint32_t i = 0; i < block_size; i++) {
+        set_page_count(&page[i], 0);
+    }
+    list_head_insert_before(&page->bbpage.location.cache, &batch->zones[zone - memory.page_data->node_zones]);
+    batch->count++;
+}
+
+void page_batch_release(page_batch_t *batch)
+{
+    for (int zone_index = 0; zone_index < memory.page_data->nr_zones; zone_index++) {
+        zone_t *zone       = &memory.page_data->node_zones[zone_index];
+        list_head_t *pages = &batch->zones[zone_index];
+        // Larger blocks go back to the buddy system, leaving the single pages on the list.
+        list_for_each_safe_decl(it, store, pages)
+        {
+            page_t *page = list_entry(it, page_t, bbpage.location.cache);
+            zone->free_pages += 1UL << page->bbpage.order;
+#ifdef ENABLE_PAGE_TRACE
+            pr_notice("BS-F: (page: %p order: %d)\n", page, page->bbpage.order);
+#endif
+            if (page->bbpage.order) {
+                list_head_remove(it);
+                bb_free_pages(&zone->buddy_system, &page->bbpage);
+            }
+        }
+        bb_free_page_list_cached(&zone->buddy_system, pages);
+    }
+    batch->count = 0;
+}
+
+int split_pages(page_t *page)
+{
+    if (page->bbpage.order == 0) {
+        return 0;
+    }
+    zone_t *zone = get_zone_from_page(page);
+    if (!zone) {
+        pr_emerg("Failed to get zone from page. Page is over memory size.\n");
+        return 0;
+    }
+    return bb_split_pages(&zone->buddy_system, &page->bbpage);
+}
+
 uint32_t alloc_pages_lowmem(gfp_t gfp_mask, uint32_t order)
 {
     // Ensure the order is within the valid range.
@@ -779,8 +1015,8 @@ unsigned long get_zone_cached_space(gfp_t gfp_mask)
         return 0; // Return 0 to indicate failure.
     }
 
-    // Return the cached space of the zone.
-    return buddy_system_get_cached_space(&zone->buddy_system);
+    // Return the cached space of the zone, including its zero-filled pool.
+    return buddy_system_get_cached_space(&zone->buddy_system) + zone->nr_zero_pages * PAGE_SIZE;
 }
 
 int get_zone_buddy_system_status(gfp_t gfp_mask, char *buffer, size_t bufsize)
@@ -796,3 +1032,52 @@ int get_zone_buddy_system_status(gfp_t gfp_mask, char *buffer, size_t bufsize)
 
     return buddy_system_to_string(&zone->buddy_system, buffer, bufsize);
 }
+
+int get_zone_alloc_stats(gfp_t gfp_mask, unsigned long *allocs, unsigned long *failures)
+{
+    // Get the zone corresponding to the given GFP mask.
+    zone_t *zone = get_zone_from_flags(gfp_mask);
+
+    // Ensure the zone retrieval was successful.
+    if (!zone) {
+        pr_emerg("Cannot retrieve the correct zone for GFP mask: 0x%x.\n", gfp_mask);
+        return -1;
+    }
+
+    // Sum the counters of all the orders.
+    *allocs   = 0;
+    *failures = 0;
+    for (int order = 0; order < MAX_BUDDYSYSTEM_GFP_ORDER; ++order) {
+        *allocs   += zone->nr_allocs[order];
+        *failures += zone->nr_failures[order];
+    }
+    return 0;
+}
+
+ssize_t zone_buddyinfo_dump(char *buffer, size_t bufsize)
+{
+    // The counters of each zone, one line for each of them.
+    const char *titles[] = { "free", "allocs", "fails" };
+    size_t written       = 0;
+    for (int i = 0; i < memory.page_data->nr_zones; ++i) {
+        zone_t *zone = &memory.page_data->node_zones[i];
+        for (int line = 0; (line < count_of(titles)) && (written < bufsize); ++line) {
+            written += snprintf(buffer + written, bufsize - written, "Node 0, zone %8s %-6s", zone->name, titles[line]);
+            for (int order = 0; (order < MAX_BUDDYSYSTEM_GFP_ORDER) && (written < bufsize); ++order) {
+                unsigned long value;
+                if (line == 0) {
+                    value = zone->buddy_system.free_area[order].nr_free;
+                } else if (line == 1) {
+                    value = zone->nr_allocs[order];
+                } else {
+                    value = zone->nr_failures[order];
+                }
+                written += snprintf(buffer + written, bufsize - written, " %6lu", value);
+            }
+            if (written < bufsize) {
+                written += snprintf(buffer + written, bufsize - written, "\n");
+            }
+        }
+    }
+    return min(written, bufsize);
+}
@@ -0,0 +1,399 @@
+/// @file ksm.c
+/// @brief Merging of the identical private pages of the processes.
+/// @details
+/// The merged pages are the stable ones: each is held by the thread with a
+/// reference of its own, and is mapped read-only and copy-on-write by all the
+/// entries sharing it, so that its content never changes. A stable page is
+/// looked up by the checksum of its content, and freed once the thread holds
+/// the last reference to it. A page which has no stable twin is remembered,
+/// until the end of the pass, inside a table of hints indexed by checksum: a
+/// later page with the same content becomes stable itself, and the page of the
+/// hint is merged with it when it is met again, by the next pass. There is no
+/// reverse mapping from the pages to their entries, hence this second visit.
+/// Pages written since the previous pass, whose dirty bit is set, are likely
+/// to be written again, they are left alone until they settle.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[KSM   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "mem/mm/ksm.h"
+
+#include "ctype.h"
+#include "errno.h"
+#include "hardware/hrtimer.h"
+#include "hardware/timer.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/page.h"
+#include "mem/mm/vm_area.h"
+#include "mem/mm/vmem.h"
+#include "process/process.h"
+#include "process/scheduler.h"
+#include "process/wait.h"
+#include "stdio.h"
+#include "string.h"
+#include "sys/mman.h"
+
+/// The number of lists of the stable pages.
+#define KSM_STABLE_HASH_SIZE 256
+/// The number of hints, a hint replaces the previous one with the same slot.
+#define KSM_HINTS            1024
+/// The number of pages scanned before sleeping.
+#define KSM_PAGES_TO_SCAN    128
+/// The time slept between two batches of pages, in nanoseconds.
+#define KSM_SLEEP_NS         (20U * NSEC_PER_SEC / 1000U)
+
+/// @brief A stable page.
+typedef struct ksm_node {
+    /// The link inside the list of its checksum.
+    list_head_t list;
+    /// The page, on which the thread holds a reference.
+    page_t *page;
+    /// The checksum of its content.
+    uint32_t checksum;
+} ksm_node_t;
+
+/// @brief A page met during the current pass, whose content might be found again.
+typedef struct ksm_hint {
+    /// The page, on which no reference is held, which might be freed meanwhile.
+    page_t *page;
+    /// The checksum of its content, when it was met.
+    uint32_t checksum;
+} ksm_hint_t;
+
+/// @brief The state of the merging.
+typedef struct ksm_state {
+    /// How the pages are merged, one of the KSM_RUN_* values.
+    int run;
+    /// The thread, NULL until the merging is first started.
+    task_struct *thread;
+    /// Where the thread sleeps.
+    wait_queue_head_t wait;
+    /// The cache of the stable pages.
+    kmem_cache_t *node_cache;
+    /// A stable page allocated in advance, so that merging never allocates.
+    ksm_node_t *spare;
+    /// The stable pages, by checksum.
+    list_head_t stable[KSM_STABLE_HASH_SIZE];
+    /// The hints of the current pass.
+    ksm_hint_t hints[KSM_HINTS];
+    /// The process the scan resumes from, NULL to start a new pass.
+    mm_struct_t *scan_mm;
+    /// The address the scan of the process resumes from.
+    uint32_t scan_addr;
+    /// The number of passes completed.
+    unsigned long full_scans;
+} ksm_state_t;
+
+/// The state of the merging.
+static ksm_state_t ksm;
+
+/// @brief Computes the checksum of the content of a page, with FNV-1a over 32-bit words.
+/// @param page the page.
+/// @param checksum where the checksum is stored.
+/// @return 0 on success, -1 if the page cannot be mapped.
+static int __ksm_checksum(page_t *page, uint32_t *checksum)
+{
+    const uint32_t *words = kmap_atomic(page);
+    if (!words) {
+        return -1;
+    }
+    uint32_t hash = 2166136261U;
+    for (uint32_t i = 0; i < PAGE_SIZE / sizeof(uint32_t); ++i) {
+        hash = (hash ^ words[i]) * 16777619U;
+    }
+    kunmap_atomic((void *)words);
+    *checksum = hash;
+    return 0;
+}
+
+/// @brief Checks if two pages have the same content.
+/// @param first the first page.
+/// @param second the second page.
+/// @return 1 if they are the same, 0 otherwise.
+static int __ksm_same(page_t *first, page_t *second)
+{
+    void *first_addr = kmap_atomic(first);
+    if (!first_addr) {
+        return 0;
+    }
+    void *second_addr = kmap_atomic(second);
+    if (!second_addr) {
+        kunmap_atomic(first_addr);
+        return 0;
+    }
+    int same = (memcmp(first_addr, second_addr, PAGE_SIZE) == 0);
+    kunmap_atomic(second_addr);
+    kunmap_atomic(first_addr);
+    return same;
+}
+
+/// @brief Checks if a page is a stable one.
+/// @param page the page.
+/// @param checksum the checksum of its content.
+/// @return 1 if it is stable, 0 otherwise.
+static inline int __ksm_is_stable(page_t *page, uint32_t checksum)
+{
+    list_for_each_decl (it, &ksm.stable[checksum % KSM_STABLE_HASH_SIZE]) {
+        if (list_entry(it, ksm_node_t, list)->page == page) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Looks for a stable page with the same content of the given one.
+/// @param page the page.
+/// @param checksum the checksum of its content.
+/// @return the stable page, NULL if there is none.
+static ksm_node_t *__ksm_stable_find(page_t *page, uint32_t checksum)
+{
+    list_for_each_decl (it, &ksm.stable[checksum % KSM_STABLE_HASH_SIZE]) {
+        ksm_node_t *node = list_entry(it, ksm_node_t, list);
+        if ((node->checksum == checksum) && __ksm_same(node->page, page)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Frees the stable pages which are not mapped anymore.
+static void __ksm_prune(void)
+{
+    for (unsigned int i = 0; i < KSM_STABLE_HASH_SIZE; ++i) {
+        list_for_each_safe_decl(it, store, &ksm.stable[i])
+        {
+            ksm_node_t *node = list_entry(it, ksm_node_t, list);
+            if (page_count(node->page) == 1) {
+                list_head_remove(&node->list);
+                free_pages(node->page);
+                kmem_cache_free(node);
+            }
+        }
+    }
+}
+
+/// @brief Makes an entry map its page read-only, and copy-on-write.
+/// @param mm the memory descriptor.
+/// @param addr the address of the page.
+/// @param entry the page table entry.
+static inline void __ksm_write_protect(mm_struct_t *mm, uint32_t addr, page_table_entry_t *entry)
+{
+    entry->rw         = 0;
+    entry->kernel_cow = 1;
+    if (is_current_pgd(mm->pgd)) {
+        paging_flush_tlb_single(addr);
+    }
+}
+
+/// @brief Merges a page with a stable one holding the same content, or
+///        makes it stable if a page with the same content was met before.
+/// @param mm the memory descriptor.
+/// @param addr the address of the page.
+/// @param entry the page table entry, which is present.
+static void __ksm_merge_page(mm_struct_t *mm, uint32_t addr, page_table_entry_t *entry)
+{
+    page_t *page = get_page_from_physical_address(entry->frame << 12U);
+    // Only single pages are merged, blocks are freed whole.
+    if (!page || page->bbpage.order || (!entry->rw && !entry->kernel_cow)) {
+        return;
+    }
+    // The page has been written since the previous pass.
+    if (entry->dirty) {
+        entry->dirty = 0;
+        if (is_current_pgd(mm->pgd)) {
+            paging_flush_tlb_single(addr);
+        }
+        return;
+    }
+    uint32_t checksum;
+    if ((__ksm_checksum(page, &checksum) < 0) || __ksm_is_stable(page, checksum)) {
+        return;
+    }
+    // Share the stable page, dropping our reference to the page.
+    ksm_node_t *node = __ksm_stable_find(page, checksum);
+    if (node) {
+        page_inc(node->page);
+        entry->frame = get_physical_address_from_page(node->page) >> 12U;
+        __ksm_write_protect(mm, addr, entry);
+        if (page_count(page) > 1) {
+            page_dec(page);
+        } else {
+            free_pages(page);
+        }
+        return;
+    }
+    // The page becomes stable, if its content has been met before.
+    ksm_hint_t *hint = &ksm.hints[checksum % KSM_HINTS];
+    if (ksm.spare && hint->page && (hint->page != page) && (hint->checksum == checksum) &&
+        __ksm_same(hint->page, page)) {
+        node           = ksm.spare;
+        ksm.spare      = NULL;
+        node->page     = page;
+        node->checksum = checksum;
+        list_head_insert_before(&node->list, &ksm.stable[checksum % KSM_STABLE_HASH_SIZE]);
+        page_inc(page);
+        __ksm_write_protect(mm, addr, entry);
+        hint->page = NULL;
+        return;
+    }
+    hint->page     = page;
+    hint->checksum = checksum;
+}
+
+/// @brief Checks if the pages of an area can be merged.
+/// @param area the area.
+/// @return 1 if they can, 0 otherwise.
+static inline int __ksm_mergeable(vm_area_struct_t *area)
+{
+    // Only the private pages which can be written, filled on demand one at a time, are merged.
+    if ((area->vm_flags & MAP_SHARED) || area->vm_shm || (area->vm_page_prot & MM_HUGE) ||
+        !(area->vm_page_prot & MM_COW) || !(area->vm_page_prot & MM_RW)) {
+        return 0;
+    }
+    return (ksm.run == KSM_RUN_ALL) || (area->vm_flags & VM_MERGEABLE);
+}
+
+/// @brief Scans the pages of a process, from the address the scan resumes from.
+/// @param mm the memory descriptor.
+/// @param budget the number of pages which can still be scanned, decreased.
+/// @return 1 if the process has been scanned entirely, 0 otherwise.
+static int __ksm_scan_mm(mm_struct_t *mm, unsigned int *budget)
+{
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *area = list_entry(it, vm_area_struct_t, vm_list);
+        if ((area->vm_end <= ksm.scan_addr) || !__ksm_mergeable(area)) {
+            continue;
+        }
+        uint32_t addr = max(area->vm_start & ~(PAGE_SIZE - 1), ksm.scan_addr);
+        while (addr < area->vm_end) {
+            // Skip the regions without a page table.
+            page_dir_entry_t *dir_entry = &mm->pgd->entries[addr >> HPAGE_SHIFT];
+            if (!dir_entry->present || dir_entry->page_size) {
+                addr = (addr & ~(HPAGE_SIZE - 1)) + HPAGE_SIZE;
+                continue;
+            }
+            page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+            if (entry && entry->present && entry->user && !entry->global) {
+                __ksm_merge_page(mm, addr, entry);
+                if (--(*budget) == 0) {
+                    ksm.scan_addr = addr + PAGE_SIZE;
+                    return 0;
+                }
+            }
+            addr += PAGE_SIZE;
+        }
+    }
+    return 1;
+}
+
+/// @brief Scans a batch of pages, resuming from where the previous batch stopped.
+static void __ksm_scan(void)
+{
+    list_head_t *mm_list = mm_get_list();
+    // The process we stopped at might be gone.
+    list_head_t *cursor  = NULL;
+    list_for_each_decl (it, mm_list) {
+        if (list_entry(it, mm_struct_t, mm_list) == ksm.scan_mm) {
+            cursor = it;
+            break;
+        }
+    }
+    // Start a new pass, forgetting the pages met by the previous one.
+    if (!cursor) {
+        __ksm_prune();
+        memset(ksm.hints, 0, sizeof(ksm.hints));
+        ksm.scan_addr = 0;
+        cursor        = mm_list->next;
+    }
+    if (!ksm.spare) {
+        ksm.spare = kmem_cache_alloc(ksm.node_cache, GFP_KERNEL);
+    }
+    unsigned int budget = KSM_PAGES_TO_SCAN;
+    for (; cursor != mm_list; cursor = cursor->next, ksm.scan_addr = 0) {
+        if (!__ksm_scan_mm(list_entry(cursor, mm_struct_t, mm_list), &budget)) {
+            ksm.scan_mm = list_entry(cursor, mm_struct_t, mm_list);
+            return;
+        }
+    }
+    ksm.scan_mm = NULL;
+    ksm.full_scans++;
+}
+
+/// @brief The thread merging the pages.
+/// @param data unused.
+/// @return never returns.
+static int __ksm_thread(void *data)
+{
+    (void)data;
+    task_struct *task = scheduler_get_current_process();
+    while (1) {
+        // Once stopped, the pages already merged stay so, until they are written.
+        if (ksm.run == KSM_RUN_STOP) {
+            __ksm_prune();
+            ksm.scan_mm = NULL;
+            interruptible_sleep_on(&ksm.wait);
+            continue;
+        }
+        __ksm_scan();
+        timer_wake_up_at(task, hrtimer_get_ns() + KSM_SLEEP_NS);
+        interruptible_sleep_on(&ksm.wait);
+        hrtimer_cancel(&task->sleep_timer);
+    }
+    return 0;
+}
+
+int ksm_control(const char *command, size_t size)
+{
+    size_t i = 0;
+    while ((i < size) && isspace(command[i])) {
+        ++i;
+    }
+    if ((i == size) || (command[i] < '0') || (command[i] > '0' + KSM_RUN_ALL)) {
+        return -EINVAL;
+    }
+    int run = command[i] - '0';
+    if ((run != KSM_RUN_STOP) && !ksm.thread) {
+        if (!ksm.node_cache) {
+            if ((ksm.node_cache = KMEM_CREATE(ksm_node_t)) == NULL) {
+                return -ENOMEM;
+            }
+            wait_queue_head_init(&ksm.wait);
+            for (unsigned int it = 0; it < KSM_STABLE_HASH_SIZE; ++it) {
+                list_head_init(&ksm.stable[it]);
+            }
+        }
+        if ((ksm.thread = kthread_create(__ksm_thread, NULL, "ksmd")) == NULL) {
+            return -ENOMEM;
+        }
+    }
+    ksm.run = run;
+    if (ksm.thread) {
+        wake_up(&ksm.wait);
+    }
+    return 0;
+}
+
+ssize_t ksm_stats_dump(char *buffer, size_t bufsize)
+{
+    unsigned long shared  = 0;
+    unsigned long sharing = 0;
+    for (unsigned int i = 0; ksm.node_cache && (i < KSM_STABLE_HASH_SIZE); ++i) {
+        list_for_each_decl (it, &ksm.stable[i]) {
+            // The thread holds a reference, the first entry mapping the page saves nothing.
+            int count = page_count(list_entry(it, ksm_node_t, list)->page);
+            shared++;
+            sharing += (count > 2) ? (count - 2) : 0;
+        }
+    }
+    return snprintf(
+        buffer, bufsize, "run: %d\npages_shared: %lu\npages_sharing: %lu\nfull_scans: %lu\n", ksm.run, shared,
+        sharing, ksm.full_scans);
+}
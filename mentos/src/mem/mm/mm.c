@@ -9,15 +9,19 @@
 #define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
 #include "io/debug.h"                    // Include debugging functions.
 
+#include "klib/rbtree.h"
 #include "mem/alloc/slab.h"
 #include "mem/mm/mm.h"
 #include "mem/paging.h"
 #include "string.h"
+#include "system/vdso.h"
 
 /// Cache for storing mm_struct.
 static kmem_cache_t *mm_cache;
 /// The mm_struct of the kernel.
 static mm_struct_t main_mm;
+/// The mm_structs of the processes.
+static list_head_t mm_list;
 
 int mm_init(void)
 {
@@ -31,11 +35,16 @@ int mm_init(void)
     // Clean the memory management structure for the kernel.
     memset(&main_mm, 0, sizeof(mm_struct_t));
 
+    // Initialize the list of the mm_structs of the processes.
+    list_head_init(&mm_list);
+
     return 0;
 }
 
 mm_struct_t *mm_get_main(void) { return &main_mm; }
 
+list_head_t *mm_get_list(void) { return &mm_list; }
+
 mm_struct_t *mm_create_blank(size_t stack_size)
 {
     // Allocate the mm_struct for the new process image.
@@ -47,9 +56,10 @@ mm_struct_t *mm_create_blank(size_t stack_size)
 
     // Initialize the allocated mm_struct to zero.
     memset(mm, 0, sizeof(mm_struct_t));
+    // The task creating it is its only user.
+    mm->users = 1;
 
-    // Initialize the list for memory management (mm) structures.
-    // TODO(enrico): Use this field for process memory management.
+    // Initialize the link to the list of the mm_structs, it is added once complete.
     list_head_init(&mm->mm_list);
 
     // Get the main page directory.
@@ -75,14 +85,21 @@ mm_struct_t *mm_create_blank(size_t stack_size)
     // Assign the copied page directory to the mm_struct.
     mm->pgd = pdir_cpy;
 
-    // Initialize the virtual memory areas list for the new process.
+    // Initialize the virtual memory areas list, and index, for the new process.
     list_head_init(&mm->mmap_list);
+    if (vm_area_index_init(mm) < 0) {
+        kmem_cache_free(pdir_cpy);
+        kmem_cache_free(mm);
+        return NULL;
+    }
 
     // Allocate the stack segment.
     vm_area_struct_t *segment = vm_area_create(
         mm, PROCAREA_END_ADDR - stack_size, stack_size, MM_PRESENT | MM_RW | MM_USER | MM_COW, GFP_HIGHUSER);
     if (!segment) {
         pr_crit("Failed to create stack segment for new process\n");
+        // Free the index of the areas.
+        rbtree_tree_dealloc(mm->mm_rb, NULL);
         // Free page directory if allocation fails.
         kmem_cache_free(pdir_cpy);
         // Free mm_struct as well.
@@ -93,6 +110,15 @@ mm_struct_t *mm_create_blank(size_t stack_size)
     // Update the start of the stack in the mm_struct.
     mm->start_stack = segment->vm_start;
 
+    // Add the mm_struct to the list of the processes.
+    list_head_insert_before(&mm->mm_list, &mm_list);
+
+    // Map the page shared with the kernel, fork keeps it.
+    if (vdso_map(mm) < 0) {
+        mm_destroy(mm);
+        return NULL;
+    }
+
     return mm;
 }
 
@@ -113,6 +139,8 @@ mm_struct_t *mm_clone(mm_struct_t *mmp)
 
     // Copy the contents of the source mm_struct to the new one.
     memcpy(mm, mmp, sizeof(mm_struct_t));
+    // The copy is used only by the new task.
+    mm->users = 1;
 
     // Get the main page directory.
     page_directory_t *main_pgd = paging_get_main_pgd();
@@ -139,16 +167,24 @@ mm_struct_t *mm_clone(mm_struct_t *mmp)
 
     vm_area_struct_t *vm_area = NULL;
 
-    // Reset the memory area list to prepare for cloning.
+    // Reset the memory area list, and index, to prepare for cloning.
+    list_head_init(&mm->mm_list);
     list_head_init(&mm->mmap_list);
     mm->map_count = 0;
     mm->total_vm  = 0;
+    if (vm_area_index_init(mm) < 0) {
+        kmem_cache_free(pdir_cpy);
+        kmem_cache_free(mm);
+        return NULL;
+    }
 
     // Clone each memory area from the source process to the new process.
     list_for_each_decl (it, &mmp->mmap_list) {
         vm_area = list_entry(it, vm_area_struct_t, vm_list);
 
-        if (vm_area_clone(mm, vm_area, 0, GFP_HIGHUSER) < 0) {
+        // Share the pages copy-on-write, a child which calls execve() right
+        // away never copies them.
+        if (vm_area_clone(mm, vm_area, 1, GFP_HIGHUSER) < 0) {
             pr_crit("Failed to clone vm_area from source process.\n");
             // Free the previously allocated mm_struct.
             kmem_cache_free(mm);
@@ -158,6 +194,9 @@ mm_struct_t *mm_clone(mm_struct_t *mmp)
         }
     }
 
+    // Add the mm_struct to the list of the processes.
+    list_head_insert_before(&mm->mm_list, &mm_list);
+
     // Return the newly cloned mm_struct.
     return mm;
 }
@@ -208,33 +247,20 @@ int mm_destroy(mm_struct_t *mm)
         }
     }
 
-    // Free each segment inside mm.
-    vm_area_struct_t *segment = NULL;
-    // Iterate through the list of memory areas.
-    list_head_t *it           = mm->mmap_list.next;
-    list_head_t *next;
+    // Remove the mm_struct from the list of the processes.
+    list_head_remove(&mm->mm_list);
 
-    while (!list_head_empty(it)) {
-        segment = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Save the pointer to the next element in the list.
-        next = segment->vm_list.next;
-
-        // Destroy the current virtual memory area. Return -1 on failure.
-        if (vm_area_destroy(mm, segment) < 0) {
-            pr_err("We failed to destroy the virtual memory area.");
-            return -1; // Failed to destroy the virtual memory area.
-        }
-
-        // Move to the next element.
-        it = next;
-    }
+    // Free each segment inside mm. The page directory is not in use anymore,
+    // so its entries are not cleared one by one, nor flushed from the TLB, and
+    // the page tables are freed whole right after.
+    vm_area_destroy_all(mm);
 
     // Free all the page tables.
     for (int i = 0; i < 1024; i++) {
         page_dir_entry_t *entry = &mm->pgd->entries[i];
-        // Check if the page table entry is present and not global.
-        if (entry->present && !entry->global) {
+        // Check if the page table entry is present and not global, large
+        // pages have no page table.
+        if (entry->present && !entry->global && !entry->page_size) {
             // Get the physical page for the page table.
             page_t *pgt_page = get_page_from_physical_address(entry->frame * PAGE_SIZE);
             if (!pgt_page) {
@@ -259,8 +285,25 @@ int mm_destroy(mm_struct_t *mm)
     // Free the page directory structure.
     kmem_cache_free((void *)mm->pgd);
 
+    // Free the index of the areas, which is empty by now.
+    rbtree_tree_dealloc(mm->mm_rb, NULL);
+
     // Free the memory structure representing the process image.
     kmem_cache_free(mm);
 
     return 0; // Success.
 }
+
+int mm_put(mm_struct_t *mm)
+{
+    // Check if the input mm_struct pointer is valid.
+    if (!mm) {
+        pr_crit("Invalid source mm_struct pointer.\n");
+        return -1;
+    }
+    // The other threads still run on it.
+    if (--mm->users > 0) {
+        return 0;
+    }
+    return mm_destroy(mm);
+}
@@ -0,0 +1,264 @@
+/// @file page_cache.c
+/// @brief Pages of files shared by the processes mapping them.
+/// @details
+/// Each page is identified by the device and the inode of its file, and by
+/// its offset inside the file, so that it outlives the opened files. The
+/// cache holds one reference to each page, the processes mapping it hold the
+/// others. Pages enter an inactive list, and move to an active one once they
+/// are used again, so that pages read just once are evicted before the ones
+/// in use. Pages are evicted in least recently used order, and those of a
+/// file are dropped as soon as the file is written. Once memory runs low, the
+/// pages which are mapped by no process are given back.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[PGCACH]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "mem/mm/page_cache.h"
+
+#include "fs/vfs.h"
+#include "list_head.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/shrinker.h"
+#include "mem/mm/vmem.h"
+#include "mem/paging.h"
+#include "stdbool.h"
+#include "string.h"
+
+/// The number of buckets of the hash table of the pages.
+#define PAGE_CACHE_HASH_SIZE 64
+/// The maximum number of pages inside the cache.
+#define PAGE_CACHE_MAX       256
+
+/// @brief A page of a file.
+typedef struct page_cache_entry {
+    /// The device of the file.
+    void *device;
+    /// The inode of the file.
+    ino_t ino;
+    /// The offset of the page inside the file.
+    uint32_t offset;
+    /// The page.
+    page_t *page;
+    /// Used to place the entry inside its bucket.
+    list_head_t hash;
+    /// Used to place the entry inside its list of the least recently used.
+    list_head_t lru;
+    /// If the entry is inside the active list.
+    bool_t active;
+} page_cache_entry_t;
+
+/// The pages, hashed by their file, so that those of a file share a bucket.
+static list_head_t page_cache_buckets[PAGE_CACHE_HASH_SIZE];
+/// The pages used more than once, from the most recently used to the least recently used.
+static list_head_t page_cache_active;
+/// The pages used once, from the most recently used to the least recently used.
+static list_head_t page_cache_inactive;
+/// The number of pages inside the cache.
+static unsigned int page_cache_count = 0;
+/// The number of pages inside the active list.
+static unsigned int page_cache_nr_active = 0;
+/// If the lists have been initialized.
+static bool_t page_cache_initialized = false;
+
+/// @brief Returns the bucket of the pages of a file.
+/// @param device the device of the file.
+/// @param ino the inode of the file.
+/// @return the bucket.
+static inline list_head_t *__page_cache_bucket(void *device, ino_t ino)
+{
+    if (!page_cache_initialized) {
+        for (int i = 0; i < PAGE_CACHE_HASH_SIZE; ++i) {
+            list_head_init(&page_cache_buckets[i]);
+        }
+        list_head_init(&page_cache_active);
+        list_head_init(&page_cache_inactive);
+        page_cache_initialized = true;
+    }
+    return &page_cache_buckets[(((uint32_t)device >> 4) ^ ino) % PAGE_CACHE_HASH_SIZE];
+}
+
+/// @brief Searches for a page of a file.
+/// @param file the file.
+/// @param offset the offset of the page inside the file.
+/// @return the entry of the page, NULL if it is not cached.
+static inline page_cache_entry_t *__page_cache_find(vfs_file_t *file, uint32_t offset)
+{
+    list_for_each_decl (it, __page_cache_bucket(file->device, file->ino)) {
+        page_cache_entry_t *entry = list_entry(it, page_cache_entry_t, hash);
+        if ((entry->device == file->device) && (entry->ino == file->ino) && (entry->offset == offset)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Removes a page from the cache, dropping the reference of the cache.
+/// @param entry the entry of the page.
+static inline void __page_cache_remove(page_cache_entry_t *entry)
+{
+    list_head_remove(&entry->hash);
+    list_head_remove(&entry->lru);
+    if (entry->active) {
+        --page_cache_nr_active;
+    }
+    page_cache_put(entry->page);
+    kfree(entry);
+    --page_cache_count;
+}
+
+/// @brief Marks a page as used, moving it in front of its list, or to the
+///        active list if it was inactive.
+/// @param entry the entry of the page.
+static inline void __page_cache_touch(page_cache_entry_t *entry)
+{
+    list_head_remove(&entry->lru);
+    if (!entry->active) {
+        entry->active = true;
+        ++page_cache_nr_active;
+    }
+    list_head_insert_after(&entry->lru, &page_cache_active);
+    // Keep at most half of the pages active, the least recently used ones
+    // go back to the inactive list.
+    while (page_cache_nr_active > (page_cache_count / 2)) {
+        page_cache_entry_t *oldest = list_entry(page_cache_active.prev, page_cache_entry_t, lru);
+        list_head_remove(&oldest->lru);
+        list_head_insert_after(&oldest->lru, &page_cache_inactive);
+        oldest->active = false;
+        --page_cache_nr_active;
+    }
+}
+
+/// @brief Gives back the pages mapped by no process, inactive ones first.
+/// @param shrinker the shrinker of the page cache.
+/// @param nr_pages the number of pages to free.
+/// @return the number of pages freed.
+static unsigned long __page_cache_scan(shrinker_t *shrinker, unsigned long nr_pages)
+{
+    unsigned long freed   = 0;
+    list_head_t *lists[2] = { &page_cache_inactive, &page_cache_active };
+    for (int i = 0; (i < 2) && (freed < nr_pages) && page_cache_initialized; ++i) {
+        for (list_head_t *it = lists[i]->prev, *prev = it->prev; (it != lists[i]) && (freed < nr_pages);
+             it = prev, prev = it->prev) {
+            page_cache_entry_t *entry = list_entry(it, page_cache_entry_t, lru);
+            // The pages mapped by a process stay allocated anyway.
+            if (page_count(entry->page) == 1) {
+                __page_cache_remove(entry);
+                ++freed;
+            }
+        }
+    }
+    return freed;
+}
+
+/// @brief The shrinker of the page cache.
+static shrinker_t page_cache_shrinker = {
+    .name  = "page_cache",
+    .scan  = __page_cache_scan,
+    .flags = 0,
+};
+
+/// @brief Reads a page of a file into a new page.
+/// @param file the file.
+/// @param offset the offset of the page inside the file.
+/// @return the page, NULL on failure.
+static page_t *__page_cache_read(vfs_file_t *file, uint32_t offset)
+{
+    // The part of the last page past the end of the file is zero-filled.
+    page_t *page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+    if (!page) {
+        pr_crit("Failed to allocate a new page.\n");
+        return NULL;
+    }
+    uint32_t vaddr = vmem_map_physical_pages(page, 1);
+    if (!vaddr) {
+        pr_crit("Failed to map the physical page to virtual address.\n");
+        free_pages(page);
+        return NULL;
+    }
+    ssize_t ret = vfs_read(file, (void *)vaddr, offset, PAGE_SIZE);
+    vmem_unmap_virtual_address(vaddr);
+    if (ret < 0) {
+        pr_err("Failed to read the page at offset %u of `%s`.\n", offset, file->name);
+        free_pages(page);
+        return NULL;
+    }
+    return page;
+}
+
+page_t *page_cache_get(vfs_file_t *file, uint32_t offset, bool_t *read)
+{
+    page_cache_entry_t *entry = __page_cache_find(file, offset);
+    if (read) {
+        *read = (entry == NULL);
+    }
+    if (!entry) {
+        page_t *page = __page_cache_read(file, offset);
+        if (!page) {
+            return NULL;
+        }
+        // Reading may sleep, and another process may have read the same page meanwhile.
+        entry = __page_cache_find(file, offset);
+        if (entry) {
+            free_pages(page);
+        } else {
+            entry = kmalloc(sizeof(page_cache_entry_t));
+            if (!entry) {
+                pr_crit("Failed to allocate the entry of a page.\n");
+                free_pages(page);
+                return NULL;
+            }
+            // Make room for the page, evicting inactive pages first.
+            if (page_cache_count >= PAGE_CACHE_MAX) {
+                list_head_t *list = list_head_empty(&page_cache_inactive) ? &page_cache_active : &page_cache_inactive;
+                __page_cache_remove(list_entry(list->prev, page_cache_entry_t, lru));
+            }
+            // Give the pages back once memory runs low.
+            if (!page_cache_shrinker.list.next) {
+                register_shrinker(&page_cache_shrinker);
+            }
+            entry->device = file->device;
+            entry->ino    = file->ino;
+            entry->offset = offset;
+            entry->page   = page;
+            entry->active = false;
+            list_head_insert_after(&entry->hash, __page_cache_bucket(file->device, file->ino));
+            list_head_insert_after(&entry->lru, &page_cache_inactive);
+            ++page_cache_count;
+            page_inc(entry->page);
+            return entry->page;
+        }
+    }
+    // The page is used again.
+    __page_cache_touch(entry);
+    page_inc(entry->page);
+    return entry->page;
+}
+
+void page_cache_put(page_t *page)
+{
+    if (page_count(page) > 1) {
+        page_dec(page);
+    } else {
+        free_pages(page);
+    }
+}
+
+void page_cache_invalidate(vfs_file_t *file)
+{
+    if (page_cache_count == 0) {
+        return;
+    }
+    list_for_each_safe_decl(it, store, __page_cache_bucket(file->device, file->ino))
+    {
+        page_cache_entry_t *entry = list_entry(it, page_cache_entry_t, hash);
+        if ((entry->device == file->device) && (entry->ino == file->ino)) {
+            __page_cache_remove(entry);
+        }
+    }
+}
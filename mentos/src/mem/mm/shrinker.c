@@ -0,0 +1,71 @@
+/// @file shrinker.c
+/// @brief Caches giving their memory back when it runs low.
+/// @details
+/// The caches register a shrinker, which the page allocator asks for pages
+/// either when an allocation fails, or while the CPU is idle once the free
+/// pages of a zone fall below its low watermark. The shrinkers are asked in
+/// turn, so that the same cache is not always the first one to be emptied.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SHRINK]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "mem/mm/shrinker.h"
+
+#include "stdbool.h"
+
+/// The registered shrinkers, the next one to ask first.
+static list_head_t shrinker_list;
+/// If the list has been initialized.
+static bool_t shrinker_initialized = false;
+
+/// @brief Returns the list of the registered shrinkers.
+/// @return the list.
+static inline list_head_t *__shrinker_list(void)
+{
+    if (!shrinker_initialized) {
+        list_head_init(&shrinker_list);
+        shrinker_initialized = true;
+    }
+    return &shrinker_list;
+}
+
+void register_shrinker(shrinker_t *shrinker)
+{
+    list_head_insert_before(&shrinker->list, __shrinker_list());
+    pr_debug("Registered shrinker `%s`.\n", shrinker->name);
+}
+
+void unregister_shrinker(shrinker_t *shrinker)
+{
+    list_head_remove(&shrinker->list);
+    pr_debug("Unregistered shrinker `%s`.\n", shrinker->name);
+}
+
+unsigned long shrink_caches(unsigned long nr_pages, unsigned int flags)
+{
+    list_head_t *head = __shrinker_list();
+    if (list_head_empty(head)) {
+        return 0;
+    }
+    unsigned long freed = 0;
+    list_for_each_decl (it, head) {
+        if (freed >= nr_pages) {
+            break;
+        }
+        shrinker_t *shrinker = list_entry(it, shrinker_t, list);
+        if (shrinker->flags & ~flags) {
+            continue;
+        }
+        freed += shrinker->scan(shrinker, nr_pages - freed);
+    }
+    // The first shrinker becomes the last one to be asked next time.
+    list_head_t *first = list_head_pop(head);
+    list_head_insert_before(first, head);
+    pr_debug("Shrinkers freed %lu of %lu pages.\n", freed, nr_pages);
+    return freed;
+}
@@ -0,0 +1,494 @@
+/// @file swap.c
+/// @brief Eviction of the pages of the processes to a swap area.
+/// @details
+/// Once memory runs out, the private pages of the processes are written to a
+/// block device prepared by mkswap, and their page table entries keep the slot
+/// of the page inside the area, so that the page fault handler can read them
+/// back. There is no reverse mapping from the pages to their entries, so the
+/// victims are found by walking the page tables of the processes, one after
+/// the other, giving a second chance to the recently accessed pages. The
+/// victims are written with a single request, to consecutive slots.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SWAP  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "mem/mm/swap.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/blkdev.h"
+#include "fs/vfs.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/page.h"
+#include "mem/mm/shrinker.h"
+#include "mem/mm/vm_area.h"
+#include "mem/mm/vmem.h"
+#include "process/scheduler.h"
+#include "stdbool.h"
+#include "string.h"
+#include "sys/mman.h"
+#include "system/syscall.h"
+
+/// The maximum number of pages written with a single request.
+#define SWAP_CLUSTER       16
+/// The order of the buffer holding a cluster of pages.
+#define SWAP_CLUSTER_ORDER 4
+/// The maximum number of slots of the swap area.
+#define SWAP_MAX_SLOTS     65536
+/// The maximum number of references to a slot, a slot reaching it is never freed.
+#define SWAP_MAP_MAX       0xFE
+/// The value of the map for a slot which cannot be used.
+#define SWAP_MAP_BAD       0xFF
+/// The number of sectors of a page.
+#define SWAP_PAGE_SECTORS  (PAGE_SIZE / BLK_SECTOR_SIZE)
+
+/// @brief A page chosen to be swapped out.
+typedef struct swap_victim {
+    /// The memory descriptor mapping the page.
+    mm_struct_t *mm;
+    /// The address of the page.
+    uint32_t addr;
+    /// The page table entry mapping the page.
+    page_table_entry_t *entry;
+    /// The page.
+    page_t *page;
+} swap_victim_t;
+
+/// @brief The swap area.
+typedef struct swap_area {
+    /// The block device, NULL while swapping is off.
+    vfs_file_t *file;
+    /// The request queue of the block device.
+    request_queue_t *queue;
+    /// The number of references to each slot, the first one holds the header.
+    uint8_t *map;
+    /// The number of slots.
+    uint32_t nslots;
+    /// The number of free slots.
+    uint32_t nfree;
+    /// The slot the search for free ones starts from.
+    uint32_t next;
+    /// The maximum number of pages written with a single request.
+    uint32_t cluster;
+    /// The buffer, inside the low memory, the pages are transferred through.
+    uint8_t *buffer;
+    /// If the buffer is in use.
+    bool_t busy;
+    /// The address the scan of the first process resumes from.
+    uint32_t scan_addr;
+} swap_area_t;
+
+/// The swap area, there is at most one.
+static swap_area_t swap_area;
+
+/// @brief Transfers consecutive slots from, or to, the buffer.
+/// @param slot the first slot.
+/// @param count the number of slots.
+/// @param write if the slots are written (1) or read (0).
+/// @return 0 on success, a negative errno on failure.
+static int __swap_io(uint32_t slot, uint32_t count, int write)
+{
+    bio_t *bio = bio_alloc(slot * SWAP_PAGE_SECTORS, count * SWAP_PAGE_SECTORS, swap_area.buffer, write);
+    if (!bio) {
+        return -ENOMEM;
+    }
+    int ret = blk_submit_bio(swap_area.queue, bio);
+    if (ret == 0) {
+        blk_run_queue(swap_area.queue);
+        ret = bio->status;
+    }
+    bio_free(bio);
+    return ret;
+}
+
+/// @brief Copies a page from, or to, a page of the buffer.
+/// @param page the page.
+/// @param buffer the page of the buffer.
+/// @param to_page if the buffer is copied to the page (1), or the page to the buffer (0).
+/// @return 0 on success, -1 if the page could not be mapped.
+static int __swap_copy_page(page_t *page, uint8_t *buffer, int to_page)
+{
+    void *vaddr = kmap_atomic(page);
+    if (!vaddr) {
+        pr_crit("Failed to map the physical page to virtual address.\n");
+        return -1;
+    }
+    if (to_page) {
+        memcpy(vaddr, buffer, PAGE_SIZE);
+    } else {
+        memcpy(buffer, vaddr, PAGE_SIZE);
+    }
+    kunmap_atomic(vaddr);
+    return 0;
+}
+
+/// @brief Checks if an entry refers to a slot in use of the swap area.
+/// @param entry the page table entry.
+/// @return 1 if the slot is in use, 0 otherwise.
+static inline int __swap_slot_valid(const page_table_entry_t *entry)
+{
+    uint32_t slot = entry->frame;
+    if (!swap_area.map || (slot == 0) || (slot >= swap_area.nslots) || (swap_area.map[slot] == 0) ||
+        (swap_area.map[slot] == SWAP_MAP_BAD)) {
+        pr_err("Invalid swap slot %u.\n", slot);
+        return 0;
+    }
+    return 1;
+}
+
+/// @brief Reserves consecutive free slots.
+/// @param count the number of slots.
+/// @return the first slot, 0 if there is no run of free slots long enough.
+static uint32_t __swap_alloc_slots(uint32_t count)
+{
+    uint32_t run  = 0;
+    uint32_t slot = swap_area.next;
+    for (uint32_t scanned = 0; scanned < swap_area.nslots; ++scanned, ++slot) {
+        // The run cannot wrap around the end of the area.
+        if (slot >= swap_area.nslots) {
+            slot = 1;
+            run  = 0;
+        }
+        if (swap_area.map[slot]) {
+            run = 0;
+            continue;
+        }
+        if (++run == count) {
+            uint32_t first = slot + 1 - count;
+            for (uint32_t i = first; i <= slot; ++i) {
+                swap_area.map[i] = 1;
+            }
+            swap_area.nfree -= count;
+            swap_area.next  = slot + 1;
+            return first;
+        }
+    }
+    return 0;
+}
+
+void swap_duplicate(const page_table_entry_t *entry)
+{
+    if (__swap_slot_valid(entry) && (swap_area.map[entry->frame] < SWAP_MAP_MAX)) {
+        ++swap_area.map[entry->frame];
+    }
+}
+
+void swap_free(const page_table_entry_t *entry)
+{
+    if (!__swap_slot_valid(entry) || (swap_area.map[entry->frame] == SWAP_MAP_MAX)) {
+        return;
+    }
+    if (--swap_area.map[entry->frame] == 0) {
+        ++swap_area.nfree;
+        // A device backed by memory can give back the space of the slot.
+        blk_discard(swap_area.queue, entry->frame * SWAP_PAGE_SECTORS, SWAP_PAGE_SECTORS);
+    }
+}
+
+int swap_in(page_table_entry_t *entry)
+{
+    uint32_t slot = entry->frame;
+    if (!__swap_slot_valid(entry)) {
+        return -1;
+    }
+    page_t *page = alloc_pages(GFP_HIGHUSER, 0);
+    if (!page) {
+        pr_crit("Failed to allocate a new page.\n");
+        return -1;
+    }
+    // Allocating may have swapped out other pages through the buffer, before we use it.
+    swap_area.busy = true;
+    int ret        = __swap_io(slot, 1, 0);
+    if (ret == 0) {
+        ret = __swap_copy_page(page, swap_area.buffer, 1);
+    }
+    swap_area.busy = false;
+    if (ret < 0) {
+        pr_err("Failed to read the swap slot %u.\n", slot);
+        free_pages(page);
+        return -1;
+    }
+    // Reading may sleep, and a task sharing the address space may have
+    // faulted the page in meanwhile.
+    if (!is_swap_entry(entry) || (entry->frame != slot)) {
+        free_pages(page);
+        return 0;
+    }
+    swap_free(entry);
+    entry->frame      = get_physical_address_from_page(page) >> 12U;
+    entry->available  = 1;
+    entry->kernel_cow = 0;
+    entry->present    = 1;
+    return 0;
+}
+
+/// @brief Picks the pages of a process which can be swapped out, clearing
+/// the accessed bit of the others, so that they are picked the next time.
+/// @param mm the memory descriptor of the process.
+/// @param victims where the pages are stored.
+/// @param max the maximum number of pages.
+/// @return the number of pages picked, if it is max the scan stopped before
+/// the end of the process, and resumes from there the next time.
+static uint32_t __swap_scan_mm(mm_struct_t *mm, swap_victim_t *victims, uint32_t max)
+{
+    uint32_t count = 0;
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *area = list_entry(it, vm_area_struct_t, vm_list);
+        // Large pages, the areas advised to behave like them, and shared mappings stay in memory.
+        if ((area->vm_page_prot & MM_HUGE) || (area->vm_flags & (MAP_SHARED | VM_HUGEPAGE)) ||
+            (area->vm_end <= swap_area.scan_addr)) {
+            continue;
+        }
+        uint32_t addr = max(area->vm_start & ~(PAGE_SIZE - 1), swap_area.scan_addr);
+        while (addr < area->vm_end) {
+            // Skip the regions without a page table.
+            page_dir_entry_t *dir_entry = &mm->pgd->entries[addr >> HPAGE_SHIFT];
+            if (!dir_entry->present || dir_entry->page_size) {
+                addr = (addr & ~(HPAGE_SIZE - 1)) + HPAGE_SIZE;
+                continue;
+            }
+            page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+            if (entry && entry->present && entry->user && !entry->global) {
+                // The pages of the areas read sequentially are not used
+                // again, so they get no second chance.
+                if (entry->accessed && !(area->vm_flags & VM_SEQ_READ)) {
+                    entry->accessed = 0;
+                    if (is_current_pgd(mm->pgd)) {
+                        paging_flush_tlb_single(addr);
+                    }
+                } else {
+                    // Pages shared copy-on-write, or with the page cache, stay in memory.
+                    page_t *page = get_page_from_physical_address(entry->frame << 12U);
+                    if (page && (page_count(page) == 1)) {
+                        victims[count++] = (swap_victim_t){ mm, addr, entry, page };
+                        if (count == max) {
+                            swap_area.scan_addr = addr + PAGE_SIZE;
+                            return count;
+                        }
+                    }
+                }
+            }
+            addr += PAGE_SIZE;
+        }
+    }
+    return count;
+}
+
+/// @brief Picks the pages to swap out, going through the processes in turn.
+/// @param victims where the pages are stored.
+/// @param max the maximum number of pages.
+/// @return the number of pages picked.
+static uint32_t __swap_find_victims(swap_victim_t *victims, uint32_t max)
+{
+    list_head_t *mm_list = mm_get_list();
+    uint32_t number      = 0;
+    list_for_each_decl (it, mm_list) {
+        ++number;
+    }
+    // The first visit of a process may just clear its accessed bits.
+    uint32_t count = 0;
+    for (uint32_t i = 0; (i < 2 * number) && (count < max); ++i) {
+        mm_struct_t *mm = list_entry(mm_list->next, mm_struct_t, mm_list);
+        count += __swap_scan_mm(mm, victims + count, max - count);
+        // Once the whole process has been scanned, move on to the next one.
+        if (count < max) {
+            list_head_remove(&mm->mm_list);
+            list_head_insert_before(&mm->mm_list, mm_list);
+            swap_area.scan_addr = 0;
+        }
+    }
+    return count;
+}
+
+/// @brief Writes a cluster of pages to the swap area, and frees them.
+/// @param shrinker the shrinker of the swap area.
+/// @param nr_pages the number of pages to free, a whole cluster is written anyway.
+/// @return the number of pages freed.
+static unsigned long __swap_scan(shrinker_t *shrinker, unsigned long nr_pages)
+{
+    if (!swap_area.file || swap_area.busy || !swap_area.nfree) {
+        return 0;
+    }
+    swap_area.busy = true;
+    swap_victim_t victims[SWAP_CLUSTER];
+    uint32_t count = __swap_find_victims(victims, min(swap_area.cluster, swap_area.nfree));
+    for (uint32_t i = 0; i < count; ++i) {
+        if (__swap_copy_page(victims[i].page, swap_area.buffer + i * PAGE_SIZE, 0) < 0) {
+            count = i;
+        }
+    }
+    // Fall back to smaller clusters, once the free slots are scattered.
+    uint32_t slot = 0;
+    while (count && ((slot = __swap_alloc_slots(count)) == 0)) {
+        count /= 2;
+    }
+    if (count && (__swap_io(slot, count, 1) < 0)) {
+        pr_err("Failed to write %u pages to the swap slot %u.\n", count, slot);
+        for (uint32_t i = 0; i < count; ++i) {
+            swap_area.map[slot + i] = 0;
+        }
+        swap_area.nfree += count;
+        blk_discard(swap_area.queue, slot * SWAP_PAGE_SECTORS, count * SWAP_PAGE_SECTORS);
+        count = 0;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        // The entry is left copy-on-write, so that a fault reaches the handler.
+        page_table_entry_t *entry = victims[i].entry;
+        entry->present            = 0;
+        entry->kernel_cow         = 1;
+        entry->available          = SWAP_ENTRY_MARK;
+        entry->frame              = slot + i;
+        if (is_current_pgd(victims[i].mm->pgd)) {
+            paging_flush_tlb_single(victims[i].addr);
+        }
+        free_pages(victims[i].page);
+    }
+    swap_area.busy = false;
+    pr_debug("Swapped out %u pages at slot %u, %u slots are free.\n", count, slot, swap_area.nfree);
+    return count;
+}
+
+/// @brief The shrinker of the swap area, it writes to the block device.
+static shrinker_t swap_shrinker = {
+    .name  = "swap",
+    .scan  = __swap_scan,
+    .flags = SHRINKER_IO,
+};
+
+/// @brief Reads the header of the swap area, and marks its bad pages.
+/// @return the number of slots, 0 if the device has not been prepared by mkswap.
+static uint32_t __swap_read_header(void)
+{
+    if (__swap_io(0, 1, 0) < 0) {
+        return 0;
+    }
+    if (memcmp(swap_area.buffer + PAGE_SIZE - strlen(SWAP_SIGNATURE), SWAP_SIGNATURE, strlen(SWAP_SIGNATURE))) {
+        return 0;
+    }
+    swap_header_t *header = (swap_header_t *)(swap_area.buffer + SWAP_HEADER_OFFSET);
+    uint32_t nslots       = min(min(header->last_page + 1, swap_area.file->length / PAGE_SIZE), SWAP_MAX_SLOTS);
+    if ((header->version != SWAP_HEADER_VERSION) || (nslots < 2)) {
+        return 0;
+    }
+    return nslots;
+}
+
+/// @brief Swaps in all the pages of the processes which are inside the swap area.
+/// @return 0 on success, -ENOMEM if memory ran out.
+static int __swap_in_all(void)
+{
+    list_for_each_decl (it, mm_get_list()) {
+        mm_struct_t *mm = list_entry(it, mm_struct_t, mm_list);
+        list_for_each_decl (area_it, &mm->mmap_list) {
+            vm_area_struct_t *area = list_entry(area_it, vm_area_struct_t, vm_list);
+            for (uint32_t addr = area->vm_start & ~(PAGE_SIZE - 1); addr < area->vm_end; addr += PAGE_SIZE) {
+                page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+                if (entry && is_swap_entry(entry)) {
+                    if (swap_in(entry) < 0) {
+                        return -ENOMEM;
+                    }
+                    if (is_current_pgd(mm->pgd)) {
+                        paging_flush_tlb_single(addr);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int sys_swapon(const char *path, int flags)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (task->uid != 0) {
+        return -EPERM;
+    }
+    // A single swap area is supported.
+    if (swap_area.file) {
+        return -EBUSY;
+    }
+    vfs_file_t *file = vfs_open(path, O_RDWR, 0);
+    if (!file) {
+        return -ENOENT;
+    }
+    request_queue_t *queue = blk_get_queue(file);
+    if (!queue || (queue->max_sectors < SWAP_PAGE_SECTORS)) {
+        vfs_close(file);
+        return -EINVAL;
+    }
+    swap_area.file    = file;
+    swap_area.queue   = queue;
+    swap_area.cluster = min(SWAP_CLUSTER, queue->max_sectors / SWAP_PAGE_SECTORS);
+    swap_area.buffer  = (uint8_t *)alloc_pages_lowmem(GFP_KERNEL, SWAP_CLUSTER_ORDER);
+    if (!swap_area.buffer) {
+        swap_area.file = NULL;
+        vfs_close(file);
+        return -ENOMEM;
+    }
+    // The area must have been prepared by mkswap, so that a filesystem is
+    // not overwritten by mistake.
+    swap_area.nslots = __swap_read_header();
+    swap_area.map    = swap_area.nslots ? kmalloc(swap_area.nslots) : NULL;
+    if (!swap_area.map) {
+        int ret = swap_area.nslots ? -ENOMEM : -EINVAL;
+        free_pages_lowmem((uint32_t)swap_area.buffer);
+        swap_area.file = NULL;
+        vfs_close(file);
+        return ret;
+    }
+    memset(swap_area.map, 0, swap_area.nslots);
+    swap_area.map[0] = SWAP_MAP_BAD;
+    swap_area.nfree  = swap_area.nslots - 1;
+    // The bad pages are listed right after the header.
+    swap_header_t *header = (swap_header_t *)(swap_area.buffer + SWAP_HEADER_OFFSET);
+    uint32_t *bad_pages   = (uint32_t *)(header + 1);
+    for (uint32_t i = 0; (i < header->nr_badpages) && ((uint8_t *)(bad_pages + i) < swap_area.buffer + PAGE_SIZE);
+         ++i) {
+        if ((bad_pages[i] > 0) && (bad_pages[i] < swap_area.nslots) && !swap_area.map[bad_pages[i]]) {
+            swap_area.map[bad_pages[i]] = SWAP_MAP_BAD;
+            --swap_area.nfree;
+        }
+    }
+    swap_area.next      = 1;
+    swap_area.busy      = false;
+    swap_area.scan_addr = 0;
+    register_shrinker(&swap_shrinker);
+    pr_notice("Adding %u KiB of swap on `%s`.\n", swap_area.nfree * (PAGE_SIZE / 1024), path);
+    return 0;
+}
+
+int sys_swapoff(const char *path)
+{
+    task_struct *task = scheduler_get_current_process();
+    if (task->uid != 0) {
+        return -EPERM;
+    }
+    vfs_file_t *file = vfs_open(path, O_RDONLY, 0);
+    if (!file) {
+        return -ENOENT;
+    }
+    vfs_close(file);
+    if (!swap_area.file || (file != swap_area.file)) {
+        return -EINVAL;
+    }
+    // Stop swapping out, and bring back all the pages.
+    unregister_shrinker(&swap_shrinker);
+    if (__swap_in_all() < 0) {
+        register_shrinker(&swap_shrinker);
+        return -ENOMEM;
+    }
+    kfree(swap_area.map);
+    free_pages_lowmem((uint32_t)swap_area.buffer);
+    vfs_close(swap_area.file);
+    swap_area = (swap_area_t){ 0 };
+    pr_notice("Removed the swap on `%s`.\n", path);
+    return 0;
+}
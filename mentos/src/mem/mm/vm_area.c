@@ -11,12 +11,22 @@
 
 #include "mem/mm/vm_area.h"
 
-#include "list_head_algorithm.h"
+#include "errno.h"
+#include "fs/vfs.h"
+#include "ipc/ipc.h"
+#include "klib/rbtree.h"
+#include "math.h"
 #include "mem/alloc/slab.h"
+#include "mem/alloc/zone_allocator.h"
 #include "mem/mm/mm.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/swap.h"
 #include "mem/paging.h"
 #include "mem/mm/vmem.h"
+#include "process/scheduler.h"
+#include "stdbool.h"
 #include "string.h"
+#include "sys/mman.h"
 
 /// Cache for storing vm_area_struct.
 static kmem_cache_t *vm_area_cache;
@@ -31,6 +41,238 @@ int vm_area_init(void)
     return 0;
 }
 
+/// @brief Compares two areas of the index by their start address.
+/// @param tree the index.
+/// @param a the node of the first area.
+/// @param b the node of the second area.
+/// @return the result of the comparison.
+static int __vm_area_index_compare(rbtree_t *tree, rbtree_node_t *a, rbtree_node_t *b)
+{
+    uint32_t start_a = ((vm_area_struct_t *)rbtree_node_get_value(a))->vm_start;
+    uint32_t start_b = ((vm_area_struct_t *)rbtree_node_get_value(b))->vm_start;
+    return (start_a > start_b) - (start_a < start_b);
+}
+
+/// @brief Recomputes the bounds, and the largest gap, of the subtree of an
+/// area of the index, from the ones of its children.
+/// @param tree the index.
+/// @param node the node of the area.
+static void __vm_area_index_augment(rbtree_t *tree, rbtree_node_t *node)
+{
+    vm_area_struct_t *area  = rbtree_node_get_value(node);
+    vm_area_struct_t *left  = rbtree_node_get_value(rbtree_node_get_child(node, 0));
+    vm_area_struct_t *right = rbtree_node_get_value(rbtree_node_get_child(node, 1));
+    area->vm_subtree_start  = left ? left->vm_subtree_start : area->vm_start;
+    area->vm_subtree_end    = right ? right->vm_subtree_end : area->vm_end;
+    area->vm_subtree_gap    = 0;
+    if (left) {
+        area->vm_subtree_gap = max(left->vm_subtree_gap, area->vm_start - left->vm_subtree_end);
+    }
+    if (right) {
+        area->vm_subtree_gap = max(area->vm_subtree_gap, right->vm_subtree_gap);
+        area->vm_subtree_gap = max(area->vm_subtree_gap, right->vm_subtree_start - area->vm_end);
+    }
+}
+
+int vm_area_index_init(mm_struct_t *mm)
+{
+    mm->mm_rb = rbtree_tree_create(__vm_area_index_compare);
+    if (!mm->mm_rb) {
+        pr_crit("Failed to allocate the index of the memory areas.\n");
+        return -1;
+    }
+    rbtree_tree_set_augment_cb(mm->mm_rb, __vm_area_index_augment);
+    mm->mmap_cache = NULL;
+    return 0;
+}
+
+/// @brief Adds an area to the list, and to the index, of a memory descriptor.
+/// @param mm the memory descriptor.
+/// @param area the area, which does not overlap the other ones.
+/// @param node the node of the index holding the area.
+static void __vm_area_link(mm_struct_t *mm, vm_area_struct_t *area, rbtree_node_t *node)
+{
+    // The list is kept sorted, the area goes before the first one after it.
+    vm_area_struct_t *next = vm_area_lookup(mm, area->vm_start);
+    list_head_insert_before(&area->vm_list, next ? &next->vm_list : &mm->mmap_list);
+    rbtree_tree_insert_node(mm->mm_rb, node);
+    mm->mmap_cache = area;
+    mm->map_count++;
+}
+
+/// @brief Removes an area from the list, and from the index, of a memory descriptor.
+/// @param mm the memory descriptor.
+/// @param area the area.
+static void __vm_area_unlink(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    rbtree_tree_remove(mm->mm_rb, area);
+    list_head_remove(&area->vm_list);
+    if (mm->mmap_cache == area) {
+        mm->mmap_cache = NULL;
+    }
+    --mm->map_count;
+}
+
+/// @brief Returns the area which follows the given one.
+/// @param mm the memory descriptor.
+/// @param area the area.
+/// @return the next area, or NULL if it is the last one.
+static inline vm_area_struct_t *__vm_area_next(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    if (area->vm_list.next == &mm->mmap_list) {
+        return NULL;
+    }
+    return list_entry(area->vm_list.next, vm_area_struct_t, vm_list);
+}
+
+/// @brief Drops a reference to a block of pages, freeing it with the last one.
+/// @param page the first page of the block.
+/// @param batch the batch gathering the blocks to free, NULL to free them right away.
+static void __vm_area_put_pages(page_t *page, page_batch_t *batch)
+{
+    // If the pages are still shared, just drop our reference.
+    if (page_count(page) > 1) {
+        uint32_t block_size = 1UL << page->bbpage.order;
+        // Decrement the reference count for each page in the block.
+        for (uint32_t i = 0; i < block_size; i++) {
+            page_dec(page + i);
+        }
+    } else if (batch) {
+        page_batch_add(batch, page);
+    } else {
+        free_pages(page);
+    }
+}
+
+/// @brief Fills a large page, one page at a time, through kmap_atomic().
+/// @param dst the first page of the large page.
+/// @param src the first page of the large page to copy, NULL to zero-fill it.
+/// @return 0 on success, -1 on failure.
+static int __vm_area_fill_huge(page_t *dst, page_t *src)
+{
+    for (uint32_t i = 0; i < (1U << HPAGE_ORDER); ++i) {
+        void *dst_addr = kmap_atomic(dst + i);
+        if (!dst_addr) {
+            pr_crit("Failed to map the physical page to virtual address.\n");
+            return -1;
+        }
+        if (src) {
+            void *src_addr = kmap_atomic(src + i);
+            if (!src_addr) {
+                pr_crit("Failed to map the physical page to virtual address.\n");
+                kunmap_atomic(dst_addr);
+                return -1;
+            }
+            memcpy(dst_addr, src_addr, PAGE_SIZE);
+            kunmap_atomic(src_addr);
+        } else {
+            memset(dst_addr, 0, PAGE_SIZE);
+        }
+        kunmap_atomic(dst_addr);
+    }
+    return 0;
+}
+
+/// @brief Frees the large pages mapped on the given range.
+/// @param pgd the page directory.
+/// @param vm_start the starting address of the range, aligned to a large page.
+/// @param size the size of the range, a multiple of a large page.
+static void __vm_area_free_huge(page_directory_t *pgd, uint32_t vm_start, size_t size)
+{
+    for (uint32_t addr = vm_start; addr < (vm_start + size); addr += HPAGE_SIZE) {
+        page_dir_entry_t *entry = &pgd->entries[addr >> HPAGE_SHIFT];
+        if (entry->present && entry->page_size) {
+            __vm_area_put_pages(get_page_from_physical_address(entry->frame << 12U), NULL);
+        }
+    }
+    mem_clear_vm_area(pgd, vm_start, size);
+}
+
+/// @brief Allocates, fills, and maps the large pages of an area, at once.
+/// @param pgd the page directory.
+/// @param vm_start the starting address of the area, aligned to a large page.
+/// @param size the size of the area, a multiple of a large page.
+/// @param pgflags the flags of the mapping.
+/// @param gfpflags the flags for the allocation of the pages.
+/// @param src_pgd the page directory whose large pages are copied, NULL to zero-fill them.
+/// @return 0 on success, -1 on failure.
+static int __vm_area_alloc_huge(
+    page_directory_t *pgd, uint32_t vm_start, size_t size, uint32_t pgflags, uint32_t gfpflags,
+    page_directory_t *src_pgd)
+{
+    for (uint32_t offset = 0; offset < size; offset += HPAGE_SIZE) {
+        page_t *src = NULL;
+        if (src_pgd) {
+            src = get_page_from_physical_address(src_pgd->entries[(vm_start + offset) >> HPAGE_SHIFT].frame << 12U);
+        }
+        page_t *page = alloc_pages(gfpflags, HPAGE_ORDER);
+        if (!page) {
+            pr_crit("Failed to allocate a large page for vm_area at %p.\n", (void *)(vm_start + offset));
+            __vm_area_free_huge(pgd, vm_start, offset);
+            return -1;
+        }
+        // The buddy system aligns the blocks to the start of their zone,
+        // which is not always aligned to a large page.
+        uint32_t phy_start = get_physical_address_from_page(page);
+        if ((phy_start & (HPAGE_SIZE - 1)) || (__vm_area_fill_huge(page, src) < 0) ||
+            (mem_map_huge_pages(pgd, vm_start + offset, phy_start, HPAGE_SIZE, pgflags) < 0)) {
+            pr_crit("Failed to map a large page for vm_area at %p.\n", (void *)(vm_start + offset));
+            free_pages(page);
+            __vm_area_free_huge(pgd, vm_start, offset);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Maps the large pages of an area on the same range of another page
+///        directory, taking a reference to them.
+/// @param src_pgd the page directory of the area.
+/// @param dst_pgd the page directory where the pages are mapped.
+/// @param vm_start the starting address of the area, aligned to a large page.
+/// @param size the size of the area, a multiple of a large page.
+/// @param pgflags the flags of the mapping.
+/// @return 0 on success, -1 on failure.
+static int __vm_area_share_huge(
+    page_directory_t *src_pgd, page_directory_t *dst_pgd, uint32_t vm_start, size_t size, uint32_t pgflags)
+{
+    for (uint32_t offset = 0; offset < size; offset += HPAGE_SIZE) {
+        uint32_t phy_start = src_pgd->entries[(vm_start + offset) >> HPAGE_SHIFT].frame << 12U;
+        page_t *page       = get_page_from_physical_address(phy_start);
+        if (mem_map_huge_pages(dst_pgd, vm_start + offset, phy_start, HPAGE_SIZE, pgflags) < 0) {
+            __vm_area_free_huge(dst_pgd, vm_start, offset);
+            return -1;
+        }
+        for (uint32_t i = 0; i < (1U << HPAGE_ORDER); ++i) {
+            page_inc(page + i);
+        }
+    }
+    return 0;
+}
+
+/// @brief Checks if an address space can grow, without exceeding the RLIMIT_AS
+///        of the current process.
+/// @param mm the address space.
+/// @param size how much it grows.
+/// @return 1 if it can grow, 0 otherwise.
+static inline int __vm_area_may_expand(mm_struct_t *mm, size_t size)
+{
+    task_struct *task = scheduler_get_current_process();
+    // Only the address space of the caller is limited, e.g., not the one
+    // which exec() is still building.
+    if (!task || (task->mm != mm) || (task->rlim[RLIMIT_AS].rlim_cur == RLIM_INFINITY)) {
+        return 1;
+    }
+    // The areas of a process are few, summing them is cheaper than keeping
+    // the total up to date while they are split and merged.
+    unsigned long total = size;
+    list_for_each_decl (it, &mm->mmap_list) {
+        vm_area_struct_t *area = list_entry(it, vm_area_struct_t, vm_list);
+        total += area->vm_end - area->vm_start;
+    }
+    return total <= task->rlim[RLIMIT_AS].rlim_cur;
+}
+
 vm_area_struct_t *
 vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pgflags, uint32_t gfpflags)
 {
@@ -62,6 +304,12 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
         return NULL;
     }
 
+    // Check if the process is allowed to grow that much.
+    if (!__vm_area_may_expand(mm, size)) {
+        pr_debug("The virtual memory area [%p, %p] exceeds the address space limit.\n", vm_start, vm_end);
+        return NULL;
+    }
+
     // Allocate on kernel space the structure for the segment.
     segment = kmem_cache_alloc(vm_area_cache, GFP_KERNEL);
     if (!segment) {
@@ -69,10 +317,32 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
         return NULL;
     }
 
+    // Allocate the node of the index, which holds the segment.
+    rbtree_node_t *node = rbtree_node_create(segment);
+    if (!node) {
+        pr_crit("Failed to allocate the node of the index for vm_area_struct\n");
+        kmem_cache_free(segment);
+        return NULL;
+    }
+
     // Find the nearest order for the given memory size.
     order = find_nearest_order_greater(vm_start, size);
 
-    if (pgflags & MM_COW) {
+    if (pgflags & MM_HUGE) {
+        // Large pages are allocated, and mapped, at once.
+        if ((vm_start | size) & (HPAGE_SIZE - 1)) {
+            pr_crit("The virtual memory area [%p, %p] is not aligned to large pages.\n", vm_start, vm_end);
+            rbtree_node_dealloc(node);
+            kmem_cache_free(segment);
+            return NULL;
+        }
+        if (__vm_area_alloc_huge(mm->pgd, vm_start, size, pgflags, gfpflags, NULL) < 0) {
+            rbtree_node_dealloc(node);
+            kmem_cache_free(segment);
+            return NULL;
+        }
+        phy_start = 0;
+    } else if (pgflags & MM_COW) {
         // If the area is copy-on-write, clear the present and update address
         // flags.
         pgflags   = pgflags & ~(MM_PRESENT | MM_UPDADDR);
@@ -84,6 +354,7 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
         page_t *page = alloc_pages(gfpflags, order);
         if (!page) {
             pr_crit("Failed to allocate physical pages for vm_area at [%p, %p].\n", vm_start, vm_end);
+            rbtree_node_dealloc(node);
             kmem_cache_free(segment);
             return NULL;
         }
@@ -92,32 +363,35 @@ vm_area_create(struct mm_struct *mm, uint32_t vm_start, size_t size, uint32_t pg
         phy_start = get_physical_address_from_page(page);
         if (!phy_start) {
             pr_crit("Failed to retrieve physical address for allocated page.\n");
+            rbtree_node_dealloc(node);
             kmem_cache_free(segment);
             return NULL;
         }
     }
 
     // Update the virtual memory area in the page directory.
-    if (mem_upd_vm_area(mm->pgd, vm_start, phy_start, size, pgflags) != 0) {
+    if (!(pgflags & MM_HUGE) && (mem_upd_vm_area(mm->pgd, vm_start, phy_start, size, pgflags) != 0)) {
         pr_crit("Failed to update vm_area in page directory\n");
+        rbtree_node_dealloc(node);
         kmem_cache_free(segment);
         return NULL;
     }
 
     // Update vm_area_struct info.
-    segment->vm_start = vm_start;
-    segment->vm_end   = vm_end;
-    segment->vm_mm    = mm;
-
-    // Insert the new segment into the memory descriptor's list of vm_area_structs.
-    list_head_insert_after(&segment->vm_list, &mm->mmap_list);
-    mm->mmap_cache = segment;
-
-    // Sort the mmap_list to maintain order.
-    list_head_sort(&mm->mmap_list, vm_area_compare);
+    segment->vm_start       = vm_start;
+    segment->vm_end         = vm_end;
+    segment->vm_mm          = mm;
+    segment->vm_page_prot   = pgflags & (MM_USER | MM_RW | MM_HUGE);
+    segment->vm_flags       = 0;
+    segment->vm_file        = NULL;
+    segment->vm_file_offset = 0;
+    segment->vm_file_size   = 0;
+    segment->vm_shm         = NULL;
+
+    // Insert the new segment into the memory descriptor's list, and index, of vm_area_structs.
+    __vm_area_link(mm, segment, node);
 
     // Update memory descriptor info.
-    mm->map_count++;
     mm->total_vm += (1U << order);
 
     // Return the created vm_area_struct.
@@ -143,6 +417,14 @@ uint32_t vm_area_clone(mm_struct_t *mm, vm_area_struct_t *area, int cow, uint32_
         return -1;
     }
 
+    // Allocate the node of the index, which holds the new segment.
+    rbtree_node_t *node = rbtree_node_create(new_segment);
+    if (!node) {
+        pr_crit("Failed to allocate the node of the index for the new vm_area_struct\n");
+        kmem_cache_free(new_segment);
+        return -1;
+    }
+
     // Copy the content of the existing vm_area_struct to the new segment.
     memcpy(new_segment, area, sizeof(vm_area_struct_t));
 
@@ -153,12 +435,29 @@ uint32_t vm_area_clone(mm_struct_t *mm, vm_area_struct_t *area, int cow, uint32_
     uint32_t size  = new_segment->vm_end - new_segment->vm_start;
     uint32_t order = find_nearest_order_greater(area->vm_start, size);
 
-    if (!cow) {
+    if (area->vm_page_prot & MM_HUGE) {
+        // Large pages are not copy-on-write: the ones of shared mappings are
+        // shared, the private ones are copied at once.
+        uint32_t pgflags = area->vm_page_prot | MM_PRESENT;
+        int ret;
+        if (area->vm_flags & MAP_SHARED) {
+            ret = __vm_area_share_huge(area->vm_mm->pgd, mm->pgd, area->vm_start, size, pgflags);
+        } else {
+            ret = __vm_area_alloc_huge(mm->pgd, area->vm_start, size, pgflags, gfpflags, area->vm_mm->pgd);
+        }
+        if (ret < 0) {
+            pr_crit("Failed to clone the large pages of the virtual memory area\n");
+            rbtree_node_dealloc(node);
+            kmem_cache_free(new_segment);
+            return -1;
+        }
+    } else if (!cow) {
         // If not copy-on-write, allocate directly the physical pages
         page_t *dst_page = alloc_pages(gfpflags, order);
         if (!dst_page) {
             pr_crit("Failed to allocate physical pages for the new vm_area\n");
             // Free the newly allocated segment on failure.
+            rbtree_node_dealloc(node);
             kmem_cache_free(new_segment);
             return -1;
         }
@@ -172,6 +471,7 @@ uint32_t vm_area_clone(mm_struct_t *mm, vm_area_struct_t *area, int cow, uint32_
             // Free the allocated pages on failure.
             free_pages(dst_page);
             // Free the newly allocated segment.
+            rbtree_node_dealloc(node);
             kmem_cache_free(new_segment);
             return -1;
         }
@@ -179,92 +479,338 @@ uint32_t vm_area_clone(mm_struct_t *mm, vm_area_struct_t *area, int cow, uint32_
         // Copy virtual memory from source area into destination area using a virtual mapping.
         vmem_memcpy(mm, area->vm_start, area->vm_mm, area->vm_start, size);
     } else {
-        // If copy-on-write, set the original pages as read-only.
-        if (mem_upd_vm_area(area->vm_mm->pgd, area->vm_start, 0, size, MM_COW | MM_PRESENT | MM_USER) < 0) {
-            pr_crit("Failed to mark original pages as copy-on-write\n");
+        // If copy-on-write, share the pages read-only, the page fault handler
+        // copies them on the first write. Only the page tables are allocated.
+        // The pages of shared mappings stay shared, and writable.
+        if (mem_share_vm_area(area->vm_mm->pgd, mm->pgd, area->vm_start, size, !(area->vm_flags & MAP_SHARED)) < 0) {
+            pr_crit("Failed to share virtual memory area\n");
             // Free the newly allocated segment.
+            rbtree_node_dealloc(node);
             kmem_cache_free(new_segment);
             return -1;
         }
+    }
 
-        // Perform a COW of the whole virtual memory area, handling fragmented physical memory.
-        if (mem_clone_vm_area(
-                area->vm_mm->pgd, mm->pgd, area->vm_start, new_segment->vm_start, size,
-                MM_COW | MM_PRESENT | MM_UPDADDR | MM_USER) < 0) {
-            pr_crit("Failed to clone virtual memory area\n");
-            // Free the newly allocated segment.
-            kmem_cache_free(new_segment);
-            return -1;
-        }
+    // The pages not read yet are read from the same file.
+    if (new_segment->vm_file) {
+        new_segment->vm_file->count += 1;
+    }
+    // The pages not touched yet are taken from the same shared memory.
+    if (new_segment->vm_shm) {
+        shm_attach(new_segment->vm_shm);
     }
 
-    // Update memory descriptor list of vm_area_struct.
-    list_head_insert_after(&new_segment->vm_list, &mm->mmap_list);
-    mm->mmap_cache = new_segment;
+    // Update memory descriptor list, and index, of vm_area_struct.
+    __vm_area_link(mm, new_segment, node);
 
     // Update memory descriptor info.
-    mm->map_count++;
     mm->total_vm += (1U << order);
 
     return 0;
 }
 
-int vm_area_destroy(mm_struct_t *mm, vm_area_struct_t *area)
+/// @brief Drops the references of an area to its pages, and releases the
+/// ones it holds inside the swap. Each page table is looked up once, and its
+/// entries are left untouched.
+/// @param mm the memory descriptor.
+/// @param area the area, which is not made of large pages.
+/// @param batch the batch gathering the blocks to free.
+static void __vm_area_put_range(mm_struct_t *mm, vm_area_struct_t *area, page_batch_t *batch)
 {
-    size_t area_total_size;
-    size_t area_size;
-    size_t area_start;
-    uint32_t order;
-    uint32_t block_size;
-    page_t *phy_page;
+    uint32_t addr = area->vm_start & ~(PAGE_SIZE - 1);
+    while (addr < area->vm_end) {
+        uint32_t table_end          = min((addr & ~(HPAGE_SIZE - 1)) + HPAGE_SIZE, area->vm_end);
+        page_dir_entry_t *dir_entry = &mm->pgd->entries[addr >> HPAGE_SHIFT];
+        page_table_t *table         = NULL;
+        // Skip the regions which have no page table, no page was ever touched there.
+        if (dir_entry->present && !dir_entry->page_size) {
+            table = (page_table_t *)get_virtual_address_from_page(memory.mem_map + dir_entry->frame);
+        }
+        while (table && (addr < table_end)) {
+            page_table_entry_t *entry = &table->pages[(addr / PAGE_SIZE) % MAX_PAGE_TABLE_ENTRIES];
+            if (entry->present) {
+                // Blocks of pages are released whole.
+                page_t *page = memory.mem_map + entry->frame;
+                addr += PAGE_SIZE << page->bbpage.order;
+                __vm_area_put_pages(page, batch);
+                continue;
+            }
+            // The pages not allocated on demand yet have nothing to release.
+            if (is_swap_entry(entry)) {
+                swap_free(entry);
+                entry->available = 1;
+            }
+            addr += PAGE_SIZE;
+        }
+        addr = max(addr, table_end);
+    }
+}
+
+/// @brief Releases the file and the shared memory of an area, and removes it from its memory descriptor.
+/// @param mm the memory descriptor.
+/// @param area the area, which is freed.
+static void __vm_area_release(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    // Write back the changes of a shared mapping, and release the mapped file.
+    if (area->vm_file) {
+        if (vm_area_sync(mm, area, area->vm_start, area->vm_end) < 0) {
+            pr_err("Failed to write back the pages of `%s`.\n", area->vm_file->name);
+        }
+        vfs_close(area->vm_file);
+    }
+    // Detach the shared memory, which may have been waiting to be freed.
+    if (area->vm_shm) {
+        shm_detach(area->vm_shm);
+    }
 
-    // Get the total size of the virtual memory area.
-    area_total_size = area->vm_end - area->vm_start;
+    // Remove the segment from the memory map list, and index, and decrement
+    // the counter for the number of memory-mapped areas.
+    __vm_area_unlink(mm, area);
 
-    // Get the starting address of the area.
-    area_start = area->vm_start;
+    // Free the memory allocated for the vm_area_struct.
+    kmem_cache_free(area);
+}
 
-    // Free all the memory associated with the virtual memory area.
-    while (area_total_size > 0) {
-        area_size = area_total_size;
+int vm_area_destroy(mm_struct_t *mm, vm_area_struct_t *area)
+{
+    page_batch_t batch;
+    page_batch_init(&batch);
 
-        // Translate the virtual address to the physical page.
-        phy_page = mem_virtual_to_page(mm->pgd, area_start, &area_size);
+    // Large pages are freed whole, the other ones once they are out of the TLB.
+    if (area->vm_page_prot & MM_HUGE) {
+        __vm_area_free_huge(mm->pgd, area->vm_start, area->vm_end - area->vm_start);
+    } else {
+        __vm_area_put_range(mm, area, &batch);
+    }
 
-        // Check if the page was successfully retrieved.
-        if (!phy_page) {
-            pr_crit("Failed to retrieve physical page for virtual address %p\n", (void *)area_start);
-            return -1;
-        }
+    // Unmap the pages, so that the range cannot reach them once freed. The
+    // pages the area shares with its neighbours are left to them, and the
+    // page tables the area covers entirely are freed whole.
+    uint32_t unmap_start = (area->vm_start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t unmap_end   = area->vm_end & ~(PAGE_SIZE - 1);
+    __vm_area_release(mm, area);
+    if (unmap_start < unmap_end) {
+        mem_free_page_tables(mm->pgd, unmap_start, unmap_end - unmap_start);
+        mem_clear_vm_area(mm->pgd, unmap_start, unmap_end - unmap_start);
+    }
+    page_batch_release(&batch);
 
-        // If the pages are marked as copy-on-write, do not deallocate them.
-        if (page_count(phy_page) > 1) {
-            order      = phy_page->bbpage.order;
-            block_size = 1UL << order;
+    return 0;
+}
 
-            // Decrement the reference count for each page in the block.
-            for (int i = 0; i < block_size; i++) {
-                page_dec(phy_page + i);
-            }
+void vm_area_destroy_all(mm_struct_t *mm)
+{
+    page_batch_t batch;
+    page_batch_init(&batch);
+    while (!list_head_empty(&mm->mmap_list)) {
+        vm_area_struct_t *area = list_entry(mm->mmap_list.next, vm_area_struct_t, vm_list);
+        if (area->vm_page_prot & MM_HUGE) {
+            __vm_area_free_huge(mm->pgd, area->vm_start, area->vm_end - area->vm_start);
         } else {
-            // If not copy-on-write, free the allocated pages.
-            free_pages(phy_page);
+            __vm_area_put_range(mm, area, &batch);
         }
+        __vm_area_release(mm, area);
+    }
+    page_batch_release(&batch);
+}
 
-        // Update the remaining size and starting address for the next iteration.
-        area_total_size -= area_size;
-        area_start += area_size;
+int vm_area_map_file(vm_area_struct_t *area, vfs_file_t *file, uint32_t offset, size_t size)
+{
+    if (size > (area->vm_end - area->vm_start)) {
+        pr_crit(
+            "Cannot map %u bytes of `%s` on an area of %u bytes.\n", size, file->name, area->vm_end - area->vm_start);
+        return -1;
     }
+    file->count += 1;
+    area->vm_file        = file;
+    area->vm_file_offset = offset;
+    area->vm_file_size   = size;
+    return 0;
+}
 
-    // Remove the segment from the memory map list.
-    list_head_remove(&area->vm_list);
+int vm_area_read_page(mm_struct_t *mm, uint32_t addr, page_t *page)
+{
+    uint32_t page_start = addr & ~(PAGE_SIZE - 1);
+    uint32_t page_end   = page_start + PAGE_SIZE;
+    // The page is mapped only if some file content lies on it.
+    uint32_t buffer     = 0;
+    int ret             = 0;
+    // The page may be shared by two areas, when the first one does not end
+    // on a page boundary, so all the areas overlapping it are read.
+    vm_area_struct_t *area = vm_area_lookup(mm, page_start);
+    for (; area && (area->vm_start < page_end); area = __vm_area_next(mm, area)) {
+        if (!area->vm_file) {
+            continue;
+        }
+        uint32_t start = max(page_start, area->vm_start);
+        uint32_t end   = min(page_end, area->vm_start + area->vm_file_size);
+        if (start >= end) {
+            continue;
+        }
+        if (!buffer) {
+            buffer = vmem_map_physical_pages(page, 1);
+            if (!buffer) {
+                pr_crit("Failed to map the physical page to virtual address.\n");
+                return -1;
+            }
+        }
+        // A file which has been truncated meanwhile leaves the rest of the page zero-filled.
+        uint32_t offset = area->vm_file_offset + (start - area->vm_start);
+        if (vfs_read(area->vm_file, (char *)buffer + (start - page_start), offset, end - start) < 0) {
+            pr_err("Failed to read the page at %p from `%s`.\n", (void *)page_start, area->vm_file->name);
+            ret = -1;
+            break;
+        }
+        ret = 1;
+    }
+    if (buffer) {
+        vmem_unmap_virtual_address(buffer);
+    }
+    return ret;
+}
 
-    // Free the memory allocated for the vm_area_struct.
-    kmem_cache_free(area);
+page_t *vm_area_get_shared_page(mm_struct_t *mm, uint32_t addr, bool_t *read)
+{
+    if (read) {
+        *read = false;
+    }
+    uint32_t page_start    = addr & ~(PAGE_SIZE - 1);
+    vm_area_struct_t *area = vm_area_lookup(mm, addr);
+    if (area && (area->vm_start <= addr)) {
+        // The pages of a shared memory belong to it.
+        if (area->vm_shm) {
+            return shm_get_page(area->vm_shm, page_start - area->vm_start);
+        }
+        // Private pages which can be written are copied, instead.
+        bool_t shared = (area->vm_flags & MAP_SHARED) != 0;
+        if (!area->vm_file || (!shared && (area->vm_page_prot & MM_RW))) {
+            return NULL;
+        }
+        // The page must start at a page boundary of the file. Unless the
+        // area is a shared mapping, which is aligned, the whole page must lie
+        // inside the content of the file, so that no other area shares it.
+        uint32_t file_end = area->vm_start + area->vm_file_size;
+        if ((page_start < area->vm_start) || (page_start >= file_end) ||
+            (!shared && ((page_start + PAGE_SIZE) > file_end))) {
+            return NULL;
+        }
+        uint32_t offset = area->vm_file_offset + (page_start - area->vm_start);
+        if (offset & (PAGE_SIZE - 1)) {
+            return NULL;
+        }
+        // The files which live in memory give their own pages.
+        if (area->vm_file->fs_operations->get_page_f) {
+            return area->vm_file->fs_operations->get_page_f(area->vm_file, offset);
+        }
+        return page_cache_get(area->vm_file, offset, read);
+    }
+    return NULL;
+}
 
-    // Decrement the counter for the number of memory-mapped areas.
-    --mm->map_count;
+int vm_area_sync(mm_struct_t *mm, vm_area_struct_t *area, uint32_t start, uint32_t end)
+{
+    // The pages of the files which live in memory are the content of the file.
+    if (!area->vm_file || !(area->vm_flags & MAP_SHARED) || area->vm_file->fs_operations->get_page_f) {
+        return 0;
+    }
+    if (!area->vm_file->fs_operations->write_f) {
+        return -ENOSYS;
+    }
+    uint32_t file_end = area->vm_start + area->vm_file_size;
+    start             = max(start, area->vm_start) & ~(PAGE_SIZE - 1);
+    end               = min(end, file_end);
+    // The entries whose dirty bit is cleared are invalidated at once, at the end.
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, mm->pgd);
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+        if (!entry || !entry->present || !entry->dirty) {
+            continue;
+        }
+        page_t *page   = get_page_from_physical_address(entry->frame << 12U);
+        uint32_t vaddr = vmem_map_physical_pages(page, 1);
+        if (!vaddr) {
+            pr_crit("Failed to map the physical page to virtual address.\n");
+            tlb_gather_flush(&tlb);
+            return -ENOMEM;
+        }
+        // The page is the one inside the page cache, which stays valid, so
+        // the file is written without going through vfs_write().
+        ssize_t ret = area->vm_file->fs_operations->write_f(
+            area->vm_file, (void *)vaddr, area->vm_file_offset + (addr - area->vm_start),
+            min(PAGE_SIZE, file_end - addr));
+        vmem_unmap_virtual_address(vaddr);
+        if (ret < 0) {
+            tlb_gather_flush(&tlb);
+            return ret;
+        }
+        entry->dirty = 0;
+        tlb_gather_add(&tlb, addr);
+    }
+    tlb_gather_flush(&tlb);
+    return 0;
+}
+
+void vm_area_willneed(mm_struct_t *mm, vm_area_struct_t *area, uint32_t start, uint32_t end)
+{
+    uint32_t file_end = area->vm_start + area->vm_file_size;
+    start             = max(start, area->vm_start) & ~(PAGE_SIZE - 1);
+    end               = min(end, area->vm_end);
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+        if (!entry || entry->present) {
+            continue;
+        }
+        // Zero-filled pages cost nothing to fault in later, the others are
+        // faulted in now, by touching them.
+        if (is_swap_entry(entry) || (area->vm_file && (addr < file_end))) {
+            (void)READ_ONCE(*(char *)max(addr, area->vm_start));
+        }
+    }
+}
 
+int vm_area_dontneed(mm_struct_t *mm, vm_area_struct_t *area, uint32_t start, uint32_t end)
+{
+    // Large pages are allocated at once, nothing would fill them again.
+    if (area->vm_page_prot & MM_HUGE) {
+        return -EINVAL;
+    }
+    if (area->vm_shm || ((area->vm_flags & MAP_SHARED) && !area->vm_file)) {
+        return 0;
+    }
+    // The pages the area shares with its neighbours are left to them.
+    start = max(start, (area->vm_start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    end   = min(end, area->vm_end & ~(PAGE_SIZE - 1));
+    if (start >= end) {
+        return 0;
+    }
+    int ret = vm_area_sync(mm, area, start, end);
+    if (ret < 0) {
+        return ret;
+    }
+    // The entries go back to be filled on demand, as when the area was created.
+    uint32_t pgflags = MM_USER | MM_COW | (area->vm_page_prot & MM_RW);
+    for (uint32_t addr = start; addr < end; addr += PAGE_SIZE) {
+        page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, addr);
+        page_t *page              = NULL;
+        if (!entry) {
+            continue;
+        }
+        if (entry->present) {
+            page = get_page_from_physical_address(entry->frame << 12U);
+        } else if (is_swap_entry(entry)) {
+            swap_free(entry);
+        } else {
+            continue;
+        }
+        if (mem_upd_vm_area(mm->pgd, addr, 0, PAGE_SIZE, pgflags) < 0) {
+            return -ENOMEM;
+        }
+        // The page can be dropped only once it is out of the TLB.
+        if (page) {
+            __vm_area_put_pages(page, NULL);
+        }
+    }
     return 0;
 }
 
@@ -280,40 +826,13 @@ int vm_area_is_valid(mm_struct_t *mm, uintptr_t vm_start, uintptr_t vm_end)
         return -1;
     }
 
-    // Iterate through the list of memory areas to check for overlaps.
-    vm_area_struct_t *area;
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current area from the list entry.
-        area = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Check if the area is NULL.
-        if (!area) {
-            pr_crit("Encountered a NULL area in the list.");
-            return -1;
-        }
-
-        // Check if the new area overlaps with the current area.
-        if ((vm_start > area->vm_start) && (vm_start < area->vm_end)) {
-            pr_crit(
-                "Overlap detected at start: %p <= %p <= %p", (void *)area->vm_start, (void *)vm_start,
-                (void *)area->vm_end);
-            return 0;
-        }
-
-        if ((vm_end > area->vm_start) && (vm_end < area->vm_end)) {
-            pr_crit(
-                "Overlap detected at end: %p <= %p <= %p", (void *)area->vm_start, (void *)vm_end,
-                (void *)area->vm_end);
-            return 0;
-        }
-
-        if ((vm_start < area->vm_start) && (vm_end > area->vm_end)) {
-            pr_crit(
-                "Wrap-around detected: %p <= (%p, %p) <= %p", (void *)vm_start, (void *)area->vm_start,
-                (void *)area->vm_end, (void *)vm_end);
-            return 0;
-        }
+    // The only area which can overlap the range is the first one ending after its start.
+    vm_area_struct_t *area = vm_area_lookup(mm, vm_start);
+    if (area && (area->vm_start < vm_end)) {
+        pr_debug(
+            "Overlap detected: [%p, %p] overlaps [%p, %p]\n", (void *)vm_start, (void *)vm_end,
+            (void *)area->vm_start, (void *)area->vm_end);
+        return 0;
     }
 
     // If no overlaps were found, return 1 to indicate the area is valid.
@@ -322,26 +841,45 @@ int vm_area_is_valid(mm_struct_t *mm, uintptr_t vm_start, uintptr_t vm_end)
 
 vm_area_struct_t *vm_area_find(mm_struct_t *mm, uint32_t vm_start)
 {
-    vm_area_struct_t *segment;
+    vm_area_struct_t *segment = vm_area_lookup(mm, vm_start);
 
-    // Iterate through the memory map list in reverse order to find the area.
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current segment from the list entry.
-        segment = list_entry(it, vm_area_struct_t, vm_list);
+    // Check if the starting address matches the requested vm_start.
+    if (segment && (segment->vm_start == vm_start)) {
+        return segment;
+    }
 
-        // Assert that the segment is not NULL.
-        assert(segment && "There is a NULL area in the list.");
+    // If the area is not found, return NULL.
+    return NULL;
+}
+
+vm_area_struct_t *vm_area_lookup(mm_struct_t *mm, uint32_t addr)
+{
+    // The last area which has been found is tried first.
+    vm_area_struct_t *area = mm->mmap_cache;
+    if (area && (area->vm_start <= addr) && (addr < area->vm_end)) {
+        return area;
+    }
 
-        // Check if the starting address matches the requested vm_start.
-        if (segment->vm_start == vm_start) {
-            // Return the found segment.
-            return segment;
+    // The areas do not overlap, so they are sorted by their end address too.
+    area                = NULL;
+    rbtree_node_t *node = rbtree_tree_get_root(mm->mm_rb);
+    while (node) {
+        vm_area_struct_t *current = rbtree_node_get_value(node);
+        if (current->vm_end > addr) {
+            area = current;
+            if (current->vm_start <= addr) {
+                break;
+            }
+            node = rbtree_node_get_child(node, 0);
+        } else {
+            node = rbtree_node_get_child(node, 1);
         }
     }
 
-    // If the area is not found, return NULL.
-    return NULL;
+    if (area && (area->vm_start <= addr)) {
+        mm->mmap_cache = area;
+    }
+    return area;
 }
 
 int vm_area_search_free_area(mm_struct_t *mm, size_t length, uintptr_t *vm_start)
@@ -352,53 +890,34 @@ int vm_area_search_free_area(mm_struct_t *mm, size_t length, uintptr_t *vm_start
         return -1;
     }
 
-    vm_area_struct_t *area;
-    vm_area_struct_t *prev_area;
-
-    // Iterate through the list of memory areas in reverse order.
-    list_for_each_prev_decl(it, &mm->mmap_list)
-    {
-        // Get the current area from the list entry.
-        area = list_entry(it, vm_area_struct_t, vm_list);
-
-        // Check if the current area is NULL.
-        if (!area) {
-            pr_crit("Encountered a NULL area in the list.");
-            return -1;
-        }
-
-        // Check the previous segment if it exists.
-        if (area->vm_list.prev != &mm->mmap_list) {
-            prev_area = list_entry(area->vm_list.prev, vm_area_struct_t, vm_list);
-
-            // Check if the previous area is NULL.
-            if (!prev_area) {
-                pr_crit("Encountered a NULL previous area in the list.");
-                return -1;
-            }
-
-            // Compute the available space between the current area and the previous area.
-            unsigned available_space = area->vm_start - prev_area->vm_end;
+    // Check if there is a gap large enough at all.
+    rbtree_node_t *node = rbtree_tree_get_root(mm->mm_rb);
+    if (!node || (((vm_area_struct_t *)rbtree_node_get_value(node))->vm_subtree_gap < length)) {
+        return 1;
+    }
 
-            // If the available space is sufficient for the requested length,
-            // return the starting address.
-            if (available_space >= length) {
-                *vm_start = area->vm_start - length;
-                return 0;
-            }
+    // Go down towards the highest gap which is large enough, looking at the
+    // gaps from the highest addresses to the lowest ones: the ones of the
+    // right subtree, the one between the right subtree and the area, the one
+    // between the area and the left subtree, and the ones of the left subtree.
+    while (node) {
+        vm_area_struct_t *area  = rbtree_node_get_value(node);
+        vm_area_struct_t *left  = rbtree_node_get_value(rbtree_node_get_child(node, 0));
+        vm_area_struct_t *right = rbtree_node_get_value(rbtree_node_get_child(node, 1));
+        if (right && (right->vm_subtree_gap >= length)) {
+            node = rbtree_node_get_child(node, 1);
+        } else if (right && ((right->vm_subtree_start - area->vm_end) >= length)) {
+            *vm_start = right->vm_subtree_start - length;
+            return 0;
+        } else if (left && ((area->vm_start - left->vm_subtree_end) >= length)) {
+            *vm_start = area->vm_start - length;
+            return 0;
+        } else {
+            node = rbtree_node_get_child(node, 0);
         }
     }
 
-    // If no suitable area was found, return 1 to indicate failure.
-    return 1;
-}
-
-int vm_area_compare(const list_head_t *vma0, const list_head_t *vma1)
-{
-    // Retrieve the vm_area_struct from the list_head_t for vma0.
-    vm_area_struct_t *_vma0 = list_entry(vma0, vm_area_struct_t, vm_list);
-    // Retrieve the vm_area_struct from the list_head_t for vma1.
-    vm_area_struct_t *_vma1 = list_entry(vma1, vm_area_struct_t, vm_list);
-    // Compare the start address of vma0 with the end address of vma1.
-    return _vma0->vm_start > _vma1->vm_end;
+    // The gaps kept by the index are not consistent with the areas.
+    pr_crit("Failed to find the gap of %u bytes inside the index of the areas.\n", length);
+    return -1;
 }
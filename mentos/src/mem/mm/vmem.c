@@ -10,21 +10,19 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "mem/mm/vmem.h"
+#include "assert.h"
+#include "klib/irqflags.h"
+#include "mem/mm/swap.h"
+#include "process/scheduler.h"
 #include "string.h"
 #include "system/panic.h"
 
 /// Virtual addresses manager.
 static virt_map_page_manager_t virt_default_mapping;
 
-/// Size of the virtual memory.
-#define VIRTUAL_MEMORY_SIZE (128 * M)
-
 /// Number of virtual memory pages.
 #define VIRTUAL_MEMORY_PAGES_COUNT (VIRTUAL_MEMORY_SIZE / PAGE_SIZE)
 
-/// Base address for virtual memory mapping.
-#define VIRTUAL_MAPPING_BASE (PROCAREA_END_ADDR + 0x28000000UL)
-
 /// Converts a virtual page to its address.
 #define VIRT_PAGE_TO_ADDRESS(page) ((((page) - virt_pages) * PAGE_SIZE) + VIRTUAL_MAPPING_BASE)
 
@@ -34,6 +32,17 @@ static virt_map_page_manager_t virt_default_mapping;
 /// Array of virtual pages.
 virt_map_page_t virt_pages[VIRTUAL_MEMORY_PAGES_COUNT];
 
+/// The address of the first slot of kmap_atomic().
+static uint32_t kmap_base = 0;
+/// The entries of the page tables mapping the slots, shared by all the processes.
+static page_table_entry_t *kmap_entries[KMAP_ATOMIC_SLOTS];
+/// If the interrupts were enabled before each mapping.
+static uint8_t kmap_irq_flags[KMAP_ATOMIC_SLOTS];
+/// The number of slots in use.
+static unsigned int kmap_depth = 0;
+
+static virt_map_page_t *_alloc_virt_pages(uint32_t pfn_count);
+
 int vmem_init(void)
 {
     // Initialize the buddy system for virtual memory management.
@@ -80,9 +89,11 @@ int vmem_init(void)
         // Get the page directory entry for the current page table index.
         entry = main_pgd->entries + i;
 
-        // Set up the page directory entry.
+        // Set up the page directory entry, writable since the kernel honours
+        // the read-only bit of the directory too (CR0.WP), the page table
+        // entries decide which mappings are writable.
         entry->present   = 1; // Mark the entry as present
-        entry->rw        = 0; // Read-only
+        entry->rw        = 1; // Read-write
         entry->global    = 1; // Global page
         entry->user      = 0; // Kernel mode
         entry->accessed  = 0; // Not accessed
@@ -124,6 +135,17 @@ int vmem_init(void)
         entry->frame = phy_addr >> 12U;
     }
 
+    // Reserve the slots of kmap_atomic(), with their page table entries.
+    virt_map_page_t *slots = _alloc_virt_pages(KMAP_ATOMIC_SLOTS);
+    if (!slots) {
+        pr_crit("Failed to reserve the slots of kmap_atomic\n");
+        return -1;
+    }
+    kmap_base = VIRT_PAGE_TO_ADDRESS(slots);
+    for (uint32_t i = 0; i < KMAP_ATOMIC_SLOTS; ++i) {
+        kmap_entries[i] = mem_virtual_to_entry(main_pgd, kmap_base + (i * PAGE_SIZE));
+    }
+
     return 0;
 }
 
@@ -156,6 +178,11 @@ static virt_map_page_t *_alloc_virt_pages(uint32_t pfn_count)
 
 uint32_t vmem_map_physical_pages(page_t *page, int pfn_count)
 {
+    // Low memory is already mapped.
+    if (is_lowmem_page_struct(page) && is_lowmem_page_struct(page + pfn_count - 1)) {
+        return get_virtual_address_from_page(page);
+    }
+
     // Allocate virtual pages for the given page frame count.
     virt_map_page_t *vpage = _alloc_virt_pages(pfn_count);
     // Error handling: failed to allocate virtual pages.
@@ -192,6 +219,57 @@ uint32_t vmem_map_physical_pages(page_t *page, int pfn_count)
     return vaddr;
 }
 
+/// @brief Maps the memory of a device to virtual memory.
+/// @param phy_address The physical address of the memory.
+/// @param size The size of the memory.
+/// @param cache_flags How the memory is cached (MM_CACHE_DISABLE or MM_WRITE_COMBINE).
+/// @return The virtual address of the memory, or 0 on failure.
+static uint32_t __vmem_map_device(uint32_t phy_address, uint32_t size, uint32_t cache_flags)
+{
+    // Compute the offset of the registers inside the first page.
+    uint32_t offset = phy_address & (PAGE_SIZE - 1);
+    // Calculate the number of pages required to cover the registers.
+    int pfn_count   = (int)((offset + size + PAGE_SIZE - 1) / PAGE_SIZE);
+
+    // Allocate virtual pages for the given page frame count.
+    virt_map_page_t *vpage = _alloc_virt_pages(pfn_count);
+    // Error handling: failed to allocate virtual pages.
+    if (!vpage) {
+        pr_crit("Failed to allocate virtual pages\n");
+        return 0;
+    }
+
+    // Convert the virtual page to its corresponding virtual address.
+    uint32_t vaddr = VIRT_PAGE_TO_ADDRESS(vpage);
+
+    // Get the main page directory.
+    page_directory_t *main_pgd = paging_get_main_pgd();
+    // Error handling: Failed to get the main page directory.
+    if (!main_pgd) {
+        pr_crit("Failed to get the main page directory\n");
+        return 0;
+    }
+
+    // Update the virtual memory area with the new mapping.
+    mem_upd_vm_area(
+        main_pgd, vaddr, phy_address - offset, pfn_count * PAGE_SIZE,
+        MM_PRESENT | MM_RW | MM_GLOBAL | MM_UPDADDR | cache_flags);
+
+    return vaddr + offset;
+}
+
+uint32_t vmem_map_io(uint32_t phy_address, uint32_t size)
+{
+    // Device registers must never be cached.
+    return __vmem_map_device(phy_address, size, MM_CACHE_DISABLE);
+}
+
+uint32_t vmem_map_framebuffer(uint32_t phy_address, uint32_t size)
+{
+    // The pixels are only written, in bursts the CPU can combine.
+    return __vmem_map_device(phy_address, size, MM_WRITE_COMBINE);
+}
+
 virt_map_page_t *vmem_map_alloc_virtual(uint32_t size)
 {
     // Calculate the number of pages required to cover the given size.
@@ -247,6 +325,11 @@ uint32_t vmem_map_virtual_address(mm_struct_t *mm, virt_map_page_t *vpage, uint3
 
 int vmem_unmap_virtual_address(uint32_t addr)
 {
+    // Low memory, returned by vmem_map_physical_pages(), stays mapped.
+    if ((addr >= PROCAREA_END_ADDR) && (addr < VIRTUAL_MAPPING_BASE)) {
+        return 0;
+    }
+
     // Ensure it is a valid virtual address.
     if (!is_valid_virtual_address(addr)) {
         pr_crit("The provided address 0x%p is not a valid virtual address.\n", addr);
@@ -296,49 +379,78 @@ int vmem_unmap_virtual_address_page(virt_map_page_t *page)
     return 0;
 }
 
-// FIXME: Check if this function should support unaligned page-boundaries copy
-void vmem_memcpy(mm_struct_t *dst_mm, uint32_t dst_vaddr, mm_struct_t *src_mm, uint32_t src_vaddr, uint32_t size)
+void *kmap_atomic(page_t *page)
 {
-    // Buffer size for copying.
-    const uint32_t VMEM_BUFFER_SIZE = 65536;
-
-    // Determine the buffer size to use for copying.
-    uint32_t buffer_size = min(VMEM_BUFFER_SIZE, size);
-
-    // Allocate virtual pages for the source and destination.
-    virt_map_page_t *src_vpage = vmem_map_alloc_virtual(size);
-    virt_map_page_t *dst_vpage = vmem_map_alloc_virtual(size);
-
-    // Error handling: ensure both source and destination virtual pages are allocated.
-    if (!src_vpage || !dst_vpage) {
-        kernel_panic("Cannot copy virtual memory address, unable to reserve vmem!");
+    uint8_t flags = irq_disable();
+    if (kmap_depth == KMAP_ATOMIC_SLOTS) {
+        irq_enable(flags);
+        pr_crit("All the slots of kmap_atomic are taken\n");
+        return NULL;
     }
+    unsigned int slot    = kmap_depth++;
+    kmap_irq_flags[slot] = flags;
+    if (is_lowmem_page_struct(page)) {
+        return (void *)get_virtual_address_from_page(page);
+    }
+    // Only the entry of the slot changes, and only its translation is flushed.
+    uint32_t addr             = kmap_base + (slot * PAGE_SIZE);
+    page_table_entry_t *entry = kmap_entries[slot];
+    entry->frame              = get_physical_address_from_page(page) >> 12U;
+    entry->rw                 = 1;
+    entry->present            = 1;
+    paging_flush_tlb_single(addr);
+    return (void *)addr;
+}
 
-    // Loop to copy memory in chunks.
-    for (;;) {
-        // Map the source and destination virtual addresses to the allocated
-        // virtual pages.
-        uint32_t src_map = vmem_map_virtual_address(src_mm, src_vpage, src_vaddr, buffer_size);
-        uint32_t dst_map = vmem_map_virtual_address(dst_mm, dst_vpage, dst_vaddr, buffer_size);
-
-        // Determine the size to copy in this iteration.
-        uint32_t cpy_size = min(buffer_size, size);
-
-        // Perform the memory copy.
-        memcpy((void *)dst_map, (void *)src_map, cpy_size);
+void kunmap_atomic(void *addr)
+{
+    assert(kmap_depth && "There is no mapping to release.");
+    unsigned int slot = --kmap_depth;
+    if ((uint32_t)addr == (kmap_base + (slot * PAGE_SIZE))) {
+        kmap_entries[slot]->present = 0;
+        paging_flush_tlb_single((uint32_t)addr);
+    }
+    irq_enable(kmap_irq_flags[slot]);
+}
 
-        // Check if the entire size has been copied.
-        if (size <= buffer_size) {
-            break;
+void vmem_memcpy(mm_struct_t *dst_mm, uint32_t dst_vaddr, mm_struct_t *src_mm, uint32_t src_vaddr, uint32_t size)
+{
+    while (size > 0) {
+        // Copy up to the end of the page of either side.
+        uint32_t cpy_size = min(PAGE_SIZE - (src_vaddr % PAGE_SIZE), PAGE_SIZE - (dst_vaddr % PAGE_SIZE));
+        cpy_size          = min(cpy_size, size);
+
+        page_table_entry_t *dst_entry = mem_virtual_to_entry(dst_mm->pgd, dst_vaddr);
+        page_table_entry_t *src_entry = mem_virtual_to_entry(src_mm->pgd, src_vaddr);
+        if (!dst_entry || !dst_entry->present) {
+            kernel_panic("Cannot copy virtual memory address, the destination is not mapped!");
+        }
+        // Reading from the swap area sleeps, it is done before mapping.
+        if (src_entry && is_swap_entry(src_entry) && (swap_in(src_entry) < 0)) {
+            kernel_panic("Cannot copy virtual memory address, unable to swap the source in!");
         }
+        char *dst = kmap_atomic(get_page_from_physical_address(dst_entry->frame << 12U));
+        if (!dst) {
+            kernel_panic("Cannot copy virtual memory address, unable to map the destination!");
+        }
+        dst += dst_vaddr % PAGE_SIZE;
+        if (src_entry && src_entry->present) {
+            char *src = kmap_atomic(get_page_from_physical_address(src_entry->frame << 12U));
+            if (!src) {
+                kernel_panic("Cannot copy virtual memory address, unable to map the source!");
+            }
+            memcpy(dst, src + (src_vaddr % PAGE_SIZE), cpy_size);
+            kunmap_atomic(src);
+        } else {
+            // The source page has never been touched.
+            memset(dst, 0, cpy_size);
+        }
+        kunmap_atomic(dst - (dst_vaddr % PAGE_SIZE));
 
-        // Update the remaining size and addresses for the next iteration.
         size -= cpy_size;
         src_vaddr += cpy_size;
         dst_vaddr += cpy_size;
+        // Copying a large area takes a while, let the others run in between.
+        cond_resched();
     }
-
-    // Unmap the allocated virtual pages.
-    vmem_unmap_virtual_address_page(src_vpage);
-    vmem_unmap_virtual_address_page(dst_vpage);
 }
@@ -13,11 +13,14 @@
 
 #include "descriptor_tables/isr.h"
 #include "mem/mm/page.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/swap.h"
 #include "mem/mm/vm_area.h"
 #include "mem/mm/vmem.h"
 #include "process/scheduler.h"
 #include "string.h"
 #include "system/panic.h"
+#include "system/trace.h"
 
 // Error code interpretation.
 #define ERR_PRESENT  0x01 ///< Page not present.
@@ -26,6 +29,9 @@
 #define ERR_RESERVED 0x08 ///< Overwrote reserved bit.
 #define ERR_INST     0x10 ///< Instruction fetch.
 
+/// The number of pages faulted in ahead of a fault, inside the file mappings advised as sequential.
+#define PF_FAULT_AHEAD 16
+
 /// @brief Sets the given page table flags.
 /// @param table the page table.
 /// @param flags the flags to set.
@@ -93,61 +99,201 @@ static void __page_fault_panic(pt_regs_t *f, uint32_t addr)
     __asm__ __volatile__("cli");
 }
 
-/// @brief Handles the Copy-On-Write (COW) mechanism for a page table entry.
-///        If the page is marked as COW, it allocates a new page and updates the entry.
+/// @brief The kinds of page faults, told apart by the page table entry alone.
+typedef enum {
+    PF_INVALID, ///< The access is not allowed.
+    PF_COW,     ///< The page is shared read-only after a fork, and is written.
+    PF_SWAP,    ///< The page has been swapped out.
+    PF_DEMAND,  ///< The page has never been touched.
+} page_fault_kind_t;
+
+/// @brief Classifies a page fault, before handling it.
+/// @param entry The page table entry of the faulting address.
+/// @return The kind of the page fault.
+static inline page_fault_kind_t __page_fault_classify(page_table_entry_t *entry)
+{
+    // Only the pages marked as Copy-On-Write (COW) are filled on demand.
+    if (!entry->kernel_cow) {
+        return PF_INVALID;
+    }
+    if (entry->present) {
+        return entry->rw ? PF_INVALID : PF_COW;
+    }
+    return is_swap_entry(entry) ? PF_SWAP : PF_DEMAND;
+}
+
+/// @brief Allocates a private page, zero-filled, holding the content of the
+///        files mapped on it.
+/// @param mm The memory descriptor of the faulting address, NULL if it is not known.
+/// @param addr The faulting address.
+/// @param major Set to true if some content has been read from a file.
+/// @return The page, NULL on failure.
+static page_t *__page_alloc_private(mm_struct_t *mm, uint32_t addr, bool_t *major)
+{
+    // Allocate a new zero-filled physical page using high user memory flag,
+    // usually zeroed in advance while the CPU was idle.
+    page_t *page = alloc_pages(GFP_HIGHUSER | __GFP_ZERO, 0);
+    if (!page) {
+        pr_crit("Failed to allocate a new page.\n");
+        return NULL;
+    }
+
+    // Read the content of the files mapped on the page, if any.
+    int ret = mm ? vm_area_read_page(mm, addr, page) : 0;
+    if (ret < 0) {
+        free_pages(page);
+        return NULL;
+    }
+    *major = (ret > 0);
+    return page;
+}
+
+/// @brief Handles a write to a page shared read-only after a fork: the last
+///        owner takes it back as writable, the others get a private copy.
 /// @param entry The page table entry to manage.
 /// @return 0 on success, 1 on error.
-static int __page_handle_cow(page_table_entry_t *entry)
+static int __page_fault_cow(page_table_entry_t *entry)
 {
-    // Check if the entry pointer is valid.
-    if (!entry) {
-        pr_crit("Invalid page table entry provided.\n");
+    // Get the shared physical page.
+    page_t *old_page = get_page_from_physical_address(entry->frame << 12U);
+    if (!old_page) {
+        pr_crit("Failed to get the shared page.\n");
         return 1;
     }
 
-    // Check if the page is Copy On Write (COW).
-    if (entry->kernel_cow) {
-        // Mark the page as no longer Copy-On-Write.
-        entry->kernel_cow = 0;
-
-        // If the page is not currently present (not allocated in physical memory).
-        if (!entry->present) {
-            // Allocate a new physical page using high user memory flag.
-            page_t *page = alloc_pages(GFP_HIGHUSER, 0);
-            if (!page) {
-                pr_crit("Failed to allocate a new page.\n");
-                return 1;
-            }
+    // If nobody else is using the page, just make it writable again.
+    if (page_count(old_page) > 1) {
+        // Allocate a new physical page using high user memory flag.
+        page_t *new_page = alloc_pages(GFP_HIGHUSER, 0);
+        if (!new_page) {
+            pr_crit("Failed to allocate a new page.\n");
+            return 1;
+        }
 
-            // Map the allocated physical page to a virtual address.
-            uint32_t vaddr = vmem_map_physical_pages(page, 1);
-            if (!vaddr) {
-                pr_crit("Failed to map the physical page to virtual address.\n");
-                return 1;
+        // Map both pages, and copy the content of the shared one.
+        void *src = kmap_atomic(old_page);
+        void *dst = src ? kmap_atomic(new_page) : NULL;
+        if (!dst) {
+            pr_crit("Failed to map the physical pages to virtual addresses.\n");
+            if (src) {
+                kunmap_atomic(src);
             }
+            free_pages(new_page);
+            return 1;
+        }
+        memcpy(dst, src, PAGE_SIZE);
+        kunmap_atomic(dst);
+        kunmap_atomic(src);
+
+        // Drop our reference to the shared page, and use the copy.
+        page_dec(old_page);
+        entry->frame = get_physical_address_from_page(new_page) >> 12U;
+    }
 
-            // Clear the new page by setting all its bytes to 0.
-            memset((void *)vaddr, 0, PAGE_SIZE);
+    // The page is now private, and writable.
+    entry->rw         = 1;
+    entry->kernel_cow = 0;
+    return 0;
+}
 
-            // Unmap the virtual address after clearing the page.
-            vmem_unmap_virtual_address(vaddr);
+/// @brief Fills a page on its first access: maps the shared page of the
+///        file mapped there, or allocates a private one.
+/// @param entry The page table entry to manage.
+/// @param mm The memory descriptor of the address, NULL if it is not known.
+/// @param addr The address of the page.
+/// @param major Set to true if the page had to be read from a file.
+/// @return 0 on success, 1 on error.
+static int __page_fault_fill(page_table_entry_t *entry, mm_struct_t *mm, uint32_t addr, bool_t *major)
+{
+    // Read-only pages of a file are shared, the others are private.
+    page_t *page = mm ? vm_area_get_shared_page(mm, addr, major) : NULL;
+    if (!page) {
+        page = __page_alloc_private(mm, addr, major);
+        if (!page) {
+            return 1;
+        }
+    }
 
-            // Set the physical frame address of the allocated page into the entry.
-            entry->frame = get_physical_address_from_page(page) >> 12U; // Shift to get page frame number.
+    // Reading may sleep, and a task sharing the address space may
+    // have faulted the page in meanwhile.
+    if (entry->present) {
+        page_cache_put(page);
+        return 0;
+    }
 
-            // Mark the page as present in memory.
-            entry->present = 1;
+    // Map the page, which is no longer Copy-On-Write.
+    entry->kernel_cow = 0;
+    entry->frame      = get_physical_address_from_page(page) >> 12U;
+    entry->present    = 1;
+    return 0;
+}
 
-            // Success, COW handled and page allocated.
-            return 0;
+/// @brief Fills the pages following a fault inside a file mapping advised as
+///        sequential, up to the first one which has already been filled.
+/// @param mm The memory descriptor of the faulting address.
+/// @param addr The faulting address.
+static void __page_fault_around(mm_struct_t *mm, uint32_t addr)
+{
+    vm_area_struct_t *area = vm_area_lookup(mm, addr);
+    if (!area || (area->vm_start > addr) || !area->vm_file || !(area->vm_flags & VM_SEQ_READ)) {
+        return;
+    }
+    // The pages past the content of the file are just zero-filled.
+    uint32_t end  = min(area->vm_start + area->vm_file_size, area->vm_end);
+    uint32_t next = (addr & ~(PAGE_SIZE - 1)) + PAGE_SIZE;
+    bool_t major;
+    for (unsigned i = 0; (i < PF_FAULT_AHEAD) && (next < end); ++i, next += PAGE_SIZE) {
+        page_table_entry_t *entry = mem_virtual_to_entry(mm->pgd, next);
+        if (!entry || (__page_fault_classify(entry) != PF_DEMAND) || __page_fault_fill(entry, mm, next, &major)) {
+            break;
         }
     }
+}
 
-    // If the page is not marked as COW, print an error.
-    pr_err("Page not marked as copy-on-write (COW)!\n");
+/// @brief Handles the first access to a page: maps the shared page of the
+///        file mapped there, or allocates a private one.
+/// @param entry The page table entry to manage.
+/// @param addr The faulting address inside the current address space, or 0
+///        if it is not known; the page is then just zero-filled.
+/// @param major Set to true if the page had to be read from a file.
+/// @return 0 on success, 1 on error.
+static int __page_fault_demand(page_table_entry_t *entry, uint32_t addr, bool_t *major)
+{
+    // The kernel may be filling the memory of another process, like
+    // the stack of a new one, and then the areas are not known.
+    task_struct *task = scheduler_get_current_process();
+    mm_struct_t *mm   = (addr && task && task->mm && is_current_pgd(task->mm->pgd)) ? task->mm : NULL;
+    if (__page_fault_fill(entry, mm, addr, major)) {
+        return 1;
+    }
+    if (mm) {
+        __page_fault_around(mm, addr);
+    }
+    return 0;
+}
 
-    // Return error as the page is not COW.
-    return 1;
+/// @brief Handles the page faults on the pages marked as Copy-On-Write (COW),
+///        which are filled on demand.
+/// @param entry The page table entry to manage.
+/// @param addr The faulting address inside the current address space, or 0
+///        if it is not known; the page is then just zero-filled.
+/// @param major Set to true if the page had to be read from the swap area or
+///        from a file, false otherwise.
+/// @return 0 on success, 1 on error.
+static int __page_handle_cow(page_table_entry_t *entry, uint32_t addr, bool_t *major)
+{
+    *major = false;
+    switch (__page_fault_classify(entry)) {
+    case PF_COW:
+        return __page_fault_cow(entry);
+    case PF_SWAP:
+        *major = true;
+        return (swap_in(entry) < 0) ? 1 : 0;
+    case PF_DEMAND:
+        return __page_fault_demand(entry, addr, major);
+    default:
+        return 1;
+    }
 }
 
 int init_page_fault(void)
@@ -187,6 +333,7 @@ void page_fault_handler(pt_regs_t *f)
 
     // Extract the address that caused the page fault from the CR2 register.
     uint32_t faulting_addr = get_cr2();
+    trace_point(TRACE_PAGE_FAULT, faulting_addr, f->err_code, f->eip);
 
     // Retrieve the current page directory's physical address.
     uint32_t phy_dir = (uint32_t)paging_get_current_pgd();
@@ -214,7 +361,7 @@ void page_fault_handler(pt_regs_t *f)
 
     // Panic only if page is in kernel memory, else abort process with SIGSEGV.
     if (!direntry->present) {
-        pr_crit("ERR(0): Page directory entry not present (%d%d%d)\n", err_user, err_rw, err_present);
+        pr_debug("ERR(0): Page directory entry not present (%d%d%d)\n", err_user, err_rw, err_present);
 
         // If the fault was caused by a user process, send a SIGSEGV signal.
         if (err_user) {
@@ -234,6 +381,21 @@ void page_fault_handler(pt_regs_t *f)
         __page_fault_panic(f, faulting_addr);
     }
 
+    // Large pages are mapped at once, and are never copy-on-write, so the
+    // fault is a violation of their protection.
+    if (direntry->page_size) {
+        pr_debug("ERR(0): Protection violation on a large page (%d%d%d)\n", err_user, err_rw, err_present);
+        if (err_user) {
+            task_struct *task = scheduler_get_current_process();
+            if (task) {
+                sys_kill(task->pid, SIGSEGV);
+                scheduler_run(f);
+                return;
+            }
+        }
+        __page_fault_panic(f, faulting_addr);
+    }
+
     // Retrieve the physical address of the page table.
     uint32_t phy_table = direntry->frame << 12U;
 
@@ -261,6 +423,9 @@ void page_fault_handler(pt_regs_t *f)
         __page_fault_panic(f, faulting_addr);
     }
 
+    // Set when the page had to be read from the swap area or from a file.
+    bool_t major;
+
     // There was a page fault on a virtual mapped address, so we must first
     // update the original mapped page
     if (is_valid_virtual_address(faulting_addr)) {
@@ -272,7 +437,9 @@ void page_fault_handler(pt_regs_t *f)
         }
 
         // Check if the page is Copy on Write (CoW).
-        if (__page_handle_cow(orig_entry)) {
+        // The user address of the page is not known here, a page of a
+        // file-backed area is only read by a fault on its own address.
+        if (__page_handle_cow(orig_entry, 0, &major)) {
             pr_crit("ERR(1): %d%d%d\n", err_user, err_rw, err_present);
             __page_fault_panic(f, faulting_addr);
         }
@@ -284,15 +451,12 @@ void page_fault_handler(pt_regs_t *f)
         __set_pg_table_flags(entry, MM_PRESENT | MM_RW | MM_GLOBAL | MM_COW | MM_UPDADDR);
     } else {
         // Check if the page is Copy on Write (CoW).
-        if (__page_handle_cow(entry)) {
-            pr_crit(
-                "Page fault caused by Copy on Write (CoW). Flags: user=%d, "
-                "rw=%d, present=%d\n",
-                err_user, err_rw, err_present);
+        task_struct *task = scheduler_get_current_process();
+        if (__page_handle_cow(entry, faulting_addr, &major)) {
+            pr_debug("Invalid access at %p. Flags: user=%d, rw=%d, present=%d\n", (void *)faulting_addr, err_user,
+                     err_rw, err_present);
             // If the fault was caused by a user process, send a SIGSEGV signal.
             if (err_user && err_rw && err_present) {
-                // Get the current process.
-                task_struct *task = scheduler_get_current_process();
                 if (task) {
                     // Notifies current process.
                     sys_kill(task->pid, SIGSEGV);
@@ -311,6 +475,15 @@ void page_fault_handler(pt_regs_t *f)
             pr_crit("Continuing with page fault handling, triggering panic.\n");
             __page_fault_panic(f, faulting_addr);
         }
+
+        // Account the fault to the process.
+        if (task) {
+            if (major) {
+                task->maj_flt++;
+            } else {
+                task->min_flt++;
+            }
+        }
     }
 
     // Invalidate the TLB entry for the faulting address.
@@ -10,10 +10,17 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "assert.h"
+#include "errno.h"
+#include "fcntl.h"
 #include "fs/vfs.h"
+#include "hardware/cpuid.h"
+#include "hardware/msr.h"
 #include "list_head.h"
 #include "list_head_algorithm.h"
+#include "math.h"
 #include "mem/alloc/zone_allocator.h"
+#include "mem/mm/page_cache.h"
+#include "mem/mm/swap.h"
 #include "mem/mm/vmem.h"
 #include "mem/page_fault.h"
 #include "mem/paging.h"
@@ -29,6 +36,20 @@ kmem_cache_t *pgdir_cache;
 /// Cache for storing page tables.
 kmem_cache_t *pgtbl_cache;
 
+/// If the processor supports large pages, which are then used.
+static int huge_pages_enabled = 0;
+
+/// If the processor supports global pages, whose TLB entries survive the
+/// switches of page directory: the kernel mappings are marked as such.
+static int global_pages_enabled = 0;
+
+/// If the processor supports the Page Attribute Table, whose entry 4 (the
+/// only one with the PAT bit set) is programmed as write-combining.
+static int write_combining_enabled = 0;
+
+/// The memory type of the write-combining entries of the Page Attribute Table.
+#define PAT_TYPE_WC 0x01ULL
+
 /// @brief Structure for iterating page directory entries.
 typedef struct page_iterator_s {
     /// Pointer to the entry.
@@ -59,6 +80,38 @@ static void __init_pagedir(page_directory_t *pdir) { *pdir = (page_directory_t){
 /// @param ptable the page table to initialize.
 static void __init_pagetable(page_table_t *ptable) { *ptable = (page_table_t){{0}}; }
 
+/// @brief Maps the kernel memory region, with large pages for the parts
+/// which cover a whole page directory entry, unless they are inside the
+/// window of vmem, whose pages are mapped and unmapped one by one.
+/// @param pgd the page directory.
+/// @param virt_start the starting virtual address.
+/// @param phy_start the starting physical address.
+/// @param size the size of the region.
+/// @return 0 on success, -1 on failure.
+static int __paging_map_kernel(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_start, size_t size)
+{
+    uint32_t flags    = MM_RW | MM_PRESENT | MM_GLOBAL | MM_UPDADDR;
+    uint32_t virt_end = virt_start + size;
+    while (virt_start < virt_end) {
+        // The part of the region inside the current page directory entry.
+        uint32_t chunk = min(virt_end, (virt_start & ~(HPAGE_SIZE - 1)) + HPAGE_SIZE) - virt_start;
+        int in_vmem    = (virt_start < (VIRTUAL_MAPPING_BASE + VIRTUAL_MEMORY_SIZE)) &&
+                      ((virt_start + chunk) > VIRTUAL_MAPPING_BASE);
+        int ret;
+        if (huge_pages_enabled && (chunk == HPAGE_SIZE) && !(phy_start & (HPAGE_SIZE - 1)) && !in_vmem) {
+            ret = mem_map_huge_pages(pgd, virt_start, phy_start, chunk, flags);
+        } else {
+            ret = mem_upd_vm_area(pgd, virt_start, phy_start, chunk, flags);
+        }
+        if (ret < 0) {
+            return -1;
+        }
+        virt_start += chunk;
+        phy_start += chunk;
+    }
+    return 0;
+}
+
 int paging_init(boot_info_t *info)
 {
     // Check if the info pointer is valid.
@@ -82,6 +135,12 @@ int paging_init(boot_info_t *info)
         return -1;
     }
 
+    // Large pages, and global pages, are used once paging is enabled, if supported.
+    huge_pages_enabled   = cpuid_has_feature_edx(CPUID_EDX_PSE);
+    global_pages_enabled = cpuid_has_feature_edx(CPUID_EDX_PGE);
+    // Write-combining needs the Page Attribute Table.
+    write_combining_enabled = cpuid_has_feature_edx(CPUID_EDX_PAT) && cpuid_has_feature_edx(CPUID_EDX_MSR);
+
     // Create cache for page directory with custom constructor function.
     pgdir_cache = KMEM_CREATE_CTOR(page_directory_t, __init_pagedir);
     if (!pgdir_cache) {
@@ -115,10 +174,9 @@ int paging_init(boot_info_t *info)
         return -1;
     }
 
-    // Map the kernel memory region into the virtual memory space.
-    if (mem_upd_vm_area(
-            main_mm->pgd, info->kernel_start, info->kernel_phy_start, lowkmem_size,
-            MM_RW | MM_PRESENT | MM_GLOBAL | MM_UPDADDR) < 0) {
+    // Map the kernel memory region into the virtual memory space, with large
+    // pages where possible, which take fewer TLB entries and no page tables.
+    if (__paging_map_kernel(main_mm->pgd, info->kernel_start, info->kernel_phy_start, lowkmem_size) < 0) {
         pr_crit("Failed to map kernel memory region.\n");
         return -1;
     }
@@ -134,14 +192,32 @@ int paging_init(boot_info_t *info)
 
 void paging_enable(void)
 {
-    // Clear the PSE bit from cr4.
-    set_cr4(bitmask_clear(get_cr4(), CR4_PSE));
-    // Set the PG bit in cr0.
-    set_cr0(bitmask_set(get_cr0(), CR0_PG));
+    // Turn the entry 4 of the Page Attribute Table, unused until now, into
+    // write-combining. The other entries keep their power-on types.
+    if (write_combining_enabled) {
+        wrmsr(MSR_PAT, (rdmsr(MSR_PAT) & ~(0xFFULL << 32U)) | (PAT_TYPE_WC << 32U));
+    }
+    // Set the PSE bit in cr4 if large pages are used, clear it otherwise.
+    if (huge_pages_enabled) {
+        set_cr4(bitmask_set(get_cr4(), CR4_PSE));
+    } else {
+        set_cr4(bitmask_clear(get_cr4(), CR4_PSE));
+    }
+    // Set the PG bit in cr0, and the WP bit, so that kernel writes to the
+    // pages shared copy-on-write fault as well.
+    set_cr0(bitmask_set(get_cr0(), CR0_PG | CR0_WP));
+    // Set the PGE bit in cr4, once paging is enabled, so that the kernel
+    // mappings stay inside the TLB when cr3 is reloaded. The changes to them
+    // must then be flushed one page at a time.
+    if (global_pages_enabled) {
+        set_cr4(bitmask_set(get_cr4(), CR4_PGE));
+    }
 }
 
 int paging_is_enabled(void) { return bitmask_check(get_cr0(), CR0_PG); }
 
+int paging_has_huge_pages(void) { return huge_pages_enabled; }
+
 page_directory_t *paging_get_main_pgd(void)
 {
     // Ensure the main_mm structure is initialized.
@@ -188,12 +264,72 @@ int is_current_pgd(page_directory_t *pgd)
     if (pgd == NULL) {
         return 0;
     }
+    // The current page directory is the physical address inside cr3.
+    uintptr_t phys_addr = (uintptr_t)pgd;
+    if (is_valid_virtual_address((uintptr_t)pgd)) {
+        page_t *page = get_page_from_virtual_address((uintptr_t)pgd);
+        if (!page) {
+            return 0;
+        }
+        phys_addr = get_physical_address_from_page(page);
+    }
     // Compare the given pgd with the current page directory
-    return pgd == paging_get_current_pgd();
+    return phys_addr == (uintptr_t)paging_get_current_pgd();
 }
 
 void paging_flush_tlb_single(unsigned long addr) { __asm__ __volatile__("invlpg (%0)" ::"r"(addr) : "memory"); }
 
+void paging_flush_tlb_all(int global)
+{
+    uintptr_t cr4 = get_cr4();
+    // Toggling PGE flushes the global entries too, reloading cr3 does not.
+    if (global && bitmask_check(cr4, CR4_PGE)) {
+        set_cr4(bitmask_clear(cr4, CR4_PGE));
+        set_cr4(cr4);
+    } else {
+        set_cr3(get_cr3());
+    }
+}
+
+void tlb_gather_init(tlb_gather_t *tlb, page_directory_t *pgd)
+{
+    tlb->pgd     = pgd;
+    tlb->current = is_current_pgd(pgd);
+    tlb->global  = 0;
+    tlb->count   = 0;
+}
+
+void tlb_gather_add(tlb_gather_t *tlb, uint32_t addr)
+{
+    // The kernel pages are shared by all the page directories, the user
+    // pages of the others have been flushed when switching away from them.
+    if (addr >= PROCAREA_END_ADDR) {
+        tlb->global = 1;
+    } else if (!tlb->current) {
+        return;
+    }
+    if (tlb->count < TLB_GATHER_MAX_PAGES) {
+        tlb->pages[tlb->count] = addr & ~(PAGE_SIZE - 1);
+    }
+    // Past the limit, only the count grows.
+    if (tlb->count <= TLB_GATHER_MAX_PAGES) {
+        tlb->count++;
+    }
+}
+
+void tlb_gather_flush(tlb_gather_t *tlb)
+{
+    if (tlb->count > TLB_GATHER_MAX_PAGES) {
+        paging_flush_tlb_all(tlb->global);
+    } else {
+        for (unsigned int i = 0; i < tlb->count; ++i) {
+            paging_flush_tlb_single(tlb->pages[i]);
+        }
+    }
+    tlb->global = 0;
+    tlb->count  = 0;
+}
+
 /// @brief Sets the given page table flags.
 /// @param table the page table.
 /// @param flags the flags to set.
@@ -217,6 +353,17 @@ static inline void __set_pg_table_flags(page_table_entry_t *table, uint32_t flag
     table->global     = (flags & MM_GLOBAL) != 0;
     // Set the User flag: 1 if the MM_USER flag is set, 0 otherwise.
     table->user       = (flags & MM_USER) != 0;
+    // Set the Cache Disable flag: 1 if the MM_CACHE_DISABLE flag is set, 0 otherwise.
+    table->cache      = (flags & MM_CACHE_DISABLE) != 0;
+    // Set the Write-Through flag: 1 if the MM_WRITE_THROUGH flag is set, 0 otherwise.
+    table->w_through  = (flags & MM_WRITE_THROUGH) != 0;
+    // Set the PAT flag for write-combining, or fall back to uncached memory.
+    if (flags & MM_WRITE_COMBINE) {
+        table->pat   = write_combining_enabled;
+        table->cache = !write_combining_enabled;
+    } else {
+        table->pat = 0;
+    }
 }
 
 /// @brief Allocates memory for a page table entry.
@@ -234,6 +381,12 @@ static page_table_t *__mem_pg_entry_alloc(page_dir_entry_t *entry, uint32_t flag
         return NULL;
     }
 
+    // The range is mapped by a large page, which has no page table.
+    if (entry->present && entry->page_size) {
+        pr_crit("The page directory entry maps a large page.\n");
+        return NULL;
+    }
+
     // If the page table is not present, allocate a new one.
     if (!entry->present) {
         // Mark the page table as present and set read/write and global/user flags.
@@ -443,6 +596,14 @@ page_t *mem_virtual_to_page(page_directory_t *pgd, uint32_t virt_start, size_t *
     uint32_t virt_pgt        = virt_pfn / 1024; // Page table index.
     uint32_t virt_pgt_offset = virt_pfn % 1024; // Offset within the page table.
 
+    // Large pages are mapped straight by the page directory entry.
+    if (pgd->entries[virt_pgt].page_size) {
+        if (size) {
+            *size = min(*size, (MAX_PAGE_TABLE_ENTRIES - virt_pgt_offset) * PAGE_SIZE);
+        }
+        return memory.mem_map + pgd->entries[virt_pgt].frame + virt_pgt_offset;
+    }
+
     // Get the physical page for the page directory entry.
     page_t *pgd_page = memory.mem_map + pgd->entries[virt_pgt].frame;
 
@@ -472,6 +633,114 @@ page_t *mem_virtual_to_page(page_directory_t *pgd, uint32_t virt_start, size_t *
     return page;
 }
 
+page_table_entry_t *mem_virtual_to_entry(page_directory_t *pgd, uint32_t virt_addr)
+{
+    page_dir_entry_t *dir_entry = &pgd->entries[virt_addr / (MAX_PAGE_TABLE_ENTRIES * PAGE_SIZE)];
+    // The whole 4 MB region is unmapped, or mapped by a large page.
+    if (!dir_entry->present || dir_entry->page_size) {
+        return NULL;
+    }
+    page_table_t *table = (page_table_t *)get_virtual_address_from_page(memory.mem_map + dir_entry->frame);
+    if (!table) {
+        return NULL;
+    }
+    return &table->pages[(virt_addr / PAGE_SIZE) % MAX_PAGE_TABLE_ENTRIES];
+}
+
+int mem_map_huge_pages(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_start, size_t size, uint32_t flags)
+{
+    // Check for null pointer to the page directory to avoid dereferencing.
+    if (!pgd) {
+        pr_crit("The page directory is null.\n");
+        return -1;
+    }
+    if (!huge_pages_enabled || ((virt_start | phy_start | size) & (HPAGE_SIZE - 1))) {
+        pr_crit("Cannot map [%p, +%u] with large pages.\n", (void *)virt_start, size);
+        return -1;
+    }
+
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, pgd);
+    for (uint32_t offset = 0; offset < size; offset += HPAGE_SIZE) {
+        page_dir_entry_t *entry = &pgd->entries[(virt_start + offset) >> HPAGE_SHIFT];
+        // The page table left by the areas which used the range before is
+        // freed, as long as none of its pages is still mapped.
+        if (entry->present && !entry->page_size) {
+            page_table_t *table = (page_table_t *)get_virtual_address_from_page(memory.mem_map + entry->frame);
+            for (int i = 0; i < MAX_PAGE_TABLE_ENTRIES; ++i) {
+                if (entry->global || table->pages[i].present || table->pages[i].kernel_cow) {
+                    pr_crit("The range [%p, +%u] is still mapped by a page table.\n", (void *)virt_start, size);
+                    tlb_gather_flush(&tlb);
+                    return -1;
+                }
+            }
+            kmem_cache_free(table);
+        }
+        *entry = (page_dir_entry_t){
+            .present   = 1,
+            .rw        = (flags & MM_RW) != 0,
+            .user      = (flags & MM_USER) != 0,
+            .page_size = 1,
+            .global    = (flags & MM_GLOBAL) != 0,
+            .frame     = (phy_start + offset) >> 12U,
+        };
+        tlb_gather_add(&tlb, virt_start + offset);
+    }
+    tlb_gather_flush(&tlb);
+    return 0;
+}
+
+void mem_clear_vm_area(page_directory_t *pgd, uint32_t virt_start, size_t size)
+{
+    uint32_t virt_end = virt_start + size;
+    uint32_t addr     = virt_start & ~(PAGE_SIZE - 1);
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, pgd);
+    while (addr < virt_end) {
+        page_dir_entry_t *dir_entry = &pgd->entries[addr >> HPAGE_SHIFT];
+        if (!dir_entry->present || dir_entry->page_size) {
+            // Large pages are removed whole.
+            if (dir_entry->present) {
+                *dir_entry = (page_dir_entry_t){ 0 };
+                tlb_gather_add(&tlb, addr);
+            }
+            addr = (addr & ~(HPAGE_SIZE - 1)) + HPAGE_SIZE;
+            continue;
+        }
+        page_table_entry_t *entry = mem_virtual_to_entry(pgd, addr);
+        // Only the pages which were present can be inside the TLB.
+        if (entry && entry->present) {
+            tlb_gather_add(&tlb, addr);
+        }
+        if (entry) {
+            *entry = (page_table_entry_t){ 0 };
+        }
+        addr += PAGE_SIZE;
+    }
+    tlb_gather_flush(&tlb);
+}
+
+void mem_free_page_tables(page_directory_t *pgd, uint32_t virt_start, size_t size)
+{
+    uint32_t virt_end = virt_start + size;
+    int freed         = 0;
+    for (uint32_t addr = round_up(virt_start, HPAGE_SIZE); (addr >= virt_start) && (addr + HPAGE_SIZE <= virt_end);
+         addr += HPAGE_SIZE) {
+        page_dir_entry_t *entry = &pgd->entries[addr >> HPAGE_SHIFT];
+        // The page tables of the kernel are shared by all the page directories.
+        if (!entry->present || entry->page_size || entry->global) {
+            continue;
+        }
+        kmem_cache_free((void *)get_virtual_address_from_page(memory.mem_map + entry->frame));
+        *entry = (page_dir_entry_t){ 0 };
+        freed  = 1;
+    }
+    // The entries of the freed tables can be anywhere inside the TLB.
+    if (freed && is_current_pgd(pgd)) {
+        paging_flush_tlb_all(0);
+    }
+}
+
 int mem_upd_vm_area(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_start, size_t size, uint32_t flags)
 {
     // Check for null pointer to the page directory to avoid dereferencing.
@@ -490,26 +759,36 @@ int mem_upd_vm_area(page_directory_t *pgd, uint32_t virt_start, uint32_t phy_sta
     // Calculate the starting page frame number for the physical address.
     uint32_t phy_pfn = phy_start / PAGE_SIZE;
 
+    // The changed entries are invalidated at once, at the end.
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, pgd);
+
     // Iterate through the virtual memory area.
     while (__pg_iter_has_next(&virt_iter)) {
         pg_iter_entry_t it = __pg_iter_next(&virt_iter);
 
+        // Only the pages which were present can be inside the TLB, but both
+        // a new frame and new flags make their entry stale.
+        if (it.entry->present) {
+            tlb_gather_add(&tlb, it.pfn * PAGE_SIZE);
+        }
+
         // If the MM_UPDADDR flag is set, update the frame address.
         if (flags & MM_UPDADDR) {
             // Ensure the physical frame number is valid before assignment.
             if (phy_pfn >= MAX_PHY_PFN) {
                 pr_crit("Physical frame number exceeds maximum limit.\n");
+                tlb_gather_flush(&tlb);
                 return -1;
             }
             it.entry->frame = phy_pfn++;
-            // Flush the TLB only if the page directory is the current one.
-            paging_flush_tlb_single(it.pfn * PAGE_SIZE);
         }
 
         // Set the page table flags.
         __set_pg_table_flags(it.entry, flags);
     }
 
+    tlb_gather_flush(&tlb);
     return 0;
 }
 
@@ -549,11 +828,20 @@ int mem_clone_vm_area(
         return -1;
     }
 
+    // The changed entries are invalidated at once, at the end.
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, dst_pgd);
+
     // Iterate over the pages in the source and destination page directories.
     while (__pg_iter_has_next(&src_iter) && __pg_iter_has_next(&dst_iter)) {
         pg_iter_entry_t src_it = __pg_iter_next(&src_iter);
         pg_iter_entry_t dst_it = __pg_iter_next(&dst_iter);
 
+        // Only the pages which were present can be inside the TLB.
+        if (dst_it.entry->present) {
+            tlb_gather_add(&tlb, dst_it.pfn * PAGE_SIZE);
+        }
+
         // Check if the source page is marked as copy-on-write (COW).
         if (src_it.entry->kernel_cow) {
             // Clone the page by assigning the address of the source entry to the destination.
@@ -566,121 +854,362 @@ int mem_clone_vm_area(
             // Set the page table flags for the destination entry.
             __set_pg_table_flags(dst_it.entry, flags);
         }
+    }
+
+    tlb_gather_flush(&tlb);
+    return 0;
+}
+
+int mem_share_vm_area(page_directory_t *src_pgd, page_directory_t *dst_pgd, uint32_t start, size_t size, int cow)
+{
+    if (!src_pgd || !dst_pgd) {
+        pr_crit("The page directory is null.\n");
+        return -1;
+    }
+
+    // The flags are used for the page tables, which stay writable.
+    page_iterator_t src_iter;
+    page_iterator_t dst_iter;
+    if (__pg_iter_init(&src_iter, src_pgd, start, size, MM_PRESENT | MM_RW | MM_USER) < 0) {
+        pr_crit("Failed to initialize source page iterator\n");
+        return -1;
+    }
+    if (__pg_iter_init(&dst_iter, dst_pgd, start, size, MM_PRESENT | MM_RW | MM_USER) < 0) {
+        pr_crit("Failed to initialize destination page iterator\n");
+        return -1;
+    }
+
+    // The source entries made read-only are invalidated at once, at the end,
+    // the destination directory is not the current one.
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb, src_pgd);
+
+    while (__pg_iter_has_next(&src_iter) && __pg_iter_has_next(&dst_iter)) {
+        pg_iter_entry_t src_it = __pg_iter_next(&src_iter);
+        pg_iter_entry_t dst_it = __pg_iter_next(&dst_iter);
+
+        // The pages still to be allocated on demand are simply not present in
+        // both directories.
+        if (src_it.entry->present) {
+            page_t *page = memory.mem_map + src_it.entry->frame;
+            // The pages of a shared block are copied, and freed, one at a
+            // time, so the block is split into single pages.
+            split_pages(page);
+            page_inc(page);
+            // Both copies become read-only, the first write copies the page.
+            if (cow && src_it.entry->rw) {
+                src_it.entry->rw         = 0;
+                src_it.entry->kernel_cow = 1;
+                tlb_gather_add(&tlb, src_it.pfn * PAGE_SIZE);
+            }
+        } else if (is_swap_entry(src_it.entry)) {
+            // Both copies refer to the slot, the first fault reads a private copy.
+            swap_duplicate(src_it.entry);
+        }
+        *dst_it.entry = *src_it.entry;
+    }
+
+    tlb_gather_flush(&tlb);
+    return 0;
+}
 
-        // Flush the TLB entry for the destination page to ensure the address is
-        // updated. It's essential to verify whether this is required in every
-        // case.
-        paging_flush_tlb_single(dst_it.pfn * PAGE_SIZE);
+/// @brief Returns the entry of a user page of the current directory, faulting it in if needed.
+/// @param pgd The current page directory.
+/// @param addr The address of the page.
+/// @return The entry, or NULL if the page cannot be brought in.
+static inline page_table_entry_t *__mem_user_entry(page_directory_t *pgd, uint32_t addr)
+{
+    page_table_entry_t *entry = mem_virtual_to_entry(pgd, addr);
+    if (!entry || !entry->present) {
+        // The fault allocates the page, or reads it back from the swap.
+        (void)READ_ONCE(*(char *)addr);
+        entry = mem_virtual_to_entry(pgd, addr);
     }
+    if (!entry || !entry->present || !entry->user) {
+        return NULL;
+    }
+    return entry;
+}
+
+page_t *mem_get_user_page(page_directory_t *pgd, uint32_t addr)
+{
+    if (!pgd || !is_current_pgd(pgd) || (addr & (PAGE_SIZE - 1))) {
+        pr_crit("Cannot take the page at %p.\n", (void *)addr);
+        return NULL;
+    }
+    page_table_entry_t *entry = __mem_user_entry(pgd, addr);
+    if (!entry) {
+        return NULL;
+    }
+    page_t *page = memory.mem_map + entry->frame;
+    // The page is freed on its own, when the last reference goes.
+    split_pages(page);
+    page_inc(page);
+    // The first write of the owner copies the page.
+    if (entry->rw) {
+        entry->rw         = 0;
+        entry->kernel_cow = 1;
+        paging_flush_tlb_single(addr);
+    }
+    return page;
+}
 
+int mem_put_user_page(page_directory_t *pgd, uint32_t addr, page_t *page)
+{
+    if (!pgd || !is_current_pgd(pgd) || (addr & (PAGE_SIZE - 1))) {
+        pr_crit("Cannot install a page at %p.\n", (void *)addr);
+        return -1;
+    }
+    page_table_entry_t *entry = __mem_user_entry(pgd, addr);
+    if (!entry) {
+        return -1;
+    }
+    page_t *old_page = memory.mem_map + entry->frame;
+    if (old_page == page) {
+        return 0;
+    }
+    // The page replaces the old one, which loses the reference of the entry.
+    split_pages(old_page);
+    page_inc(page);
+    entry->frame      = get_physical_address_from_page(page) >> 12U;
+    entry->rw         = 0;
+    entry->kernel_cow = 1;
+    paging_flush_tlb_single(addr);
+    page_cache_put(old_page);
     return 0;
 }
 
 void *sys_mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
 {
     uintptr_t vm_start;
+    vfs_file_t *file = NULL;
+    uint32_t file_size = 0;
 
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
-    // Get the file descriptor.
-    vfs_file_descriptor_t *file_descriptor = fget(fd);
-    if (!file_descriptor) {
-        pr_err("Invalid file descriptor.\n");
-        return NULL;
+    // The mapping must be either shared or private, and start at a page of the file.
+    if (!length || (offset & (PAGE_SIZE - 1)) || (!(flags & MAP_SHARED) == !(flags & MAP_PRIVATE))) {
+        return (void *)-EINVAL;
     }
-
-    // Get the actual file.
-    vfs_file_t *file = file_descriptor->file_struct;
-    if (!file) {
-        pr_err("Invalid file.\n");
-        return NULL;
+    // Large pages are allocated at once, so they back only anonymous memory.
+    if ((flags & MAP_HUGETLB) && (!(flags & MAP_ANONYMOUS) || !huge_pages_enabled)) {
+        return (void *)-EINVAL;
     }
+    // Mappings span whole pages, of the size in use.
+    uint32_t align = (flags & MAP_HUGETLB) ? HPAGE_SIZE : PAGE_SIZE;
+    length         = round_up(length, align);
+
+    if (!(flags & MAP_ANONYMOUS)) {
+        // Get the file descriptor.
+        vfs_file_descriptor_t *file_descriptor = fget(fd);
+        if (!file_descriptor || !file_descriptor->file_struct) {
+            pr_err("Invalid file descriptor.\n");
+            return (void *)-EBADF;
+        }
+        file = file_descriptor->file_struct;
 
-    stat_t file_stat;
-    if (vfs_fstat(file, &file_stat) < 0) {
-        pr_err("Failed to get file stat.\n");
-        return NULL;
-    }
+        // The file must be readable, and writable to write through a shared mapping.
+        int mode = file_descriptor->flags_mask & O_ACCMODE;
+        if ((mode == O_WRONLY) || ((flags & MAP_SHARED) && (prot & PROT_WRITE) && (mode != O_RDWR))) {
+            return (void *)-EACCES;
+        }
 
-    // Ensure the file size is large enough to map
-    if ((offset + length) > file_stat.st_size) {
-        pr_err("File is too small for the requested mapping.\n");
-        return NULL;
+        stat_t file_stat;
+        if (vfs_fstat(file, &file_stat) < 0) {
+            pr_err("Failed to get file stat.\n");
+            return (void *)-EACCES;
+        }
+
+        // The pages past the end of the file are zero-filled.
+        if (offset < file_stat.st_size) {
+            file_size = min(length, (uint32_t)(file_stat.st_size - offset));
+        }
     }
 
     // Check if a specific address was requested for the memory mapping.
-    if (addr && vm_area_is_valid(task->mm, (uintptr_t)addr, (uintptr_t)addr + length)) {
+    if (addr && !((uintptr_t)addr & (align - 1)) &&
+        (vm_area_is_valid(task->mm, (uintptr_t)addr, (uintptr_t)addr + length) > 0)) {
         // If the requested address is valid, use it as the starting address.
         vm_start = (uintptr_t)addr;
     } else {
-        // Find an empty spot if no specific address was provided or the provided one is invalid.
-        if (vm_area_search_free_area(task->mm, length, &vm_start)) {
+        // Find an empty spot if no specific address was provided or the
+        // provided one is invalid, with room to align it.
+        if (vm_area_search_free_area(task->mm, length + align - PAGE_SIZE, &vm_start)) {
             pr_err("Failed to find a suitable spot for a new virtual memory "
                    "area.\n");
-            return NULL;
+            return (void *)-ENOMEM;
         }
+        // Keep to the top of the spot.
+        vm_start = (vm_start + align - PAGE_SIZE) & ~(align - 1);
     }
 
-    // Allocate the virtual memory area segment.
-    vm_area_struct_t *segment =
-        vm_area_create(task->mm, vm_start, length, MM_PRESENT | MM_RW | MM_COW | MM_USER, GFP_HIGHUSER);
+    // Allocate the virtual memory area segment, whose pages are read from the
+    // file, or zero-filled, on demand. Large pages are allocated at once.
+    uint32_t pgflags = MM_USER | ((flags & MAP_HUGETLB) ? MM_HUGE : MM_COW);
+    if (prot & PROT_WRITE) {
+        pgflags |= MM_RW;
+    }
+    vm_area_struct_t *segment = vm_area_create(task->mm, vm_start, length, pgflags, GFP_HIGHUSER);
     if (!segment) {
         pr_err("Failed to allocate virtual memory area segment.\n");
-        return NULL;
+        return (void *)-ENOMEM;
     }
 
     // Set the memory flags for the mapping.
-    task->mm->mmap_cache->vm_flags = flags;
+    segment->vm_flags = flags;
+
+    // Map the file, the pages of shared mappings are those inside the page cache.
+    if (file_size && (vm_area_map_file(segment, file, offset, file_size) < 0)) {
+        vm_area_destroy(task->mm, segment);
+        return (void *)-ENOMEM;
+    }
+
+    // The pages of shared anonymous mappings are allocated at once, so that
+    // the processes forked later share all of them.
+    if ((flags & MAP_SHARED) && !file && !(flags & MAP_HUGETLB)) {
+        for (uint32_t page = vm_start; page < (vm_start + length); page += PAGE_SIZE) {
+            (void)READ_ONCE(*(char *)page);
+        }
+    }
 
     // Return the starting address of the newly created memory segment.
     return (void *)segment->vm_start;
 }
 
+void *sys_old_mmap(mmap_arg_struct_t *arg)
+{
+    return sys_mmap((void *)arg->addr, arg->len, arg->prot, arg->flags, arg->fd, arg->offset);
+}
+
 int sys_munmap(void *addr, size_t length)
 {
     // Get the current task.
     task_struct *task = scheduler_get_current_process();
 
-    // Initialize variables.
-    vm_area_struct_t *segment;           // The virtual memory area segment.
-    unsigned vm_start = (uintptr_t)addr; // Starting address of the memory area to unmap.
-    unsigned size;                       // Size of the segment.
+    // Search for the area starting at the given address.
+    vm_area_struct_t *segment = vm_area_find(task->mm, (uintptr_t)addr);
 
-    // Iterate through the list of memory mapped areas in reverse order.
-    list_for_each_prev_decl(it, &task->mm->mmap_list)
-    {
-        segment = list_entry(it, vm_area_struct_t, vm_list);
+    // Check if the requested length matches the segment, whose pages may be large ones.
+    uint32_t align = (segment && (segment->vm_page_prot & MM_HUGE)) ? HPAGE_SIZE : PAGE_SIZE;
+    if (segment && (round_up(length, align) == (segment->vm_end - segment->vm_start))) {
+        pr_debug("[0x%p:0x%p] Found it, destroying it.\n", (void *)segment->vm_start, (void *)segment->vm_end);
 
-        // Check if the segment is valid.
-        if (!segment) {
-            pr_crit("Found a NULL area in the mmap list.\n");
+        // Destroy the found virtual memory area.
+        if (vm_area_destroy(task->mm, segment) < 0) {
+            pr_err(
+                "Failed to destroy the virtual memory area at "
+                "[0x%p:0x%p].\n",
+                (void *)segment->vm_start, (void *)segment->vm_end);
             return -1;
         }
 
-        // Compute the size of the current segment.
-        size = segment->vm_end - segment->vm_start;
-
-        // Check if the requested address and length match the current segment.
-        if ((vm_start == segment->vm_start) && (length == size)) {
-            pr_debug("[0x%p:0x%p] Found it, destroying it.\n", (void *)segment->vm_start, (void *)segment->vm_end);
-
-            // Step 6: Destroy the found virtual memory area.
-            if (vm_area_destroy(task->mm, segment) < 0) {
-                pr_err(
-                    "Failed to destroy the virtual memory area at "
-                    "[0x%p:0x%p].\n",
-                    (void *)segment->vm_start, (void *)segment->vm_end);
-                return -1;
-            }
-
-            return 0;
-        }
+        return 0;
     }
 
     pr_err(
         "No matching memory area found for unmapping at address 0x%p with "
         "length %zu.\n",
         addr, length);
-    return 1;
+    return -EINVAL;
+}
+
+int sys_msync(void *addr, size_t length, int flags)
+{
+    task_struct *task = scheduler_get_current_process();
+    uint32_t start    = (uintptr_t)addr;
+    uint32_t end      = start + length;
+
+    if ((start & (PAGE_SIZE - 1)) || (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) ||
+        ((flags & MS_ASYNC) && (flags & MS_SYNC))) {
+        return -EINVAL;
+    }
+    // There is no write back in the background, so the pages are always
+    // written at once, and only MS_SYNC waits for them to reach the disk.
+    list_for_each_decl (it, &task->mm->mmap_list) {
+        vm_area_struct_t *segment = list_entry(it, vm_area_struct_t, vm_list);
+        if ((segment->vm_end <= start) || (segment->vm_start >= end)) {
+            continue;
+        }
+        int ret = vm_area_sync(task->mm, segment, start, end);
+        if (ret < 0) {
+            return ret;
+        }
+        if ((flags & MS_SYNC) && segment->vm_file && (segment->vm_flags & MAP_SHARED)) {
+            vfs_fsync(segment->vm_file);
+        }
+    }
+    return 0;
+}
+
+int sys_madvise(void *addr, size_t length, int advice)
+{
+    task_struct *task = scheduler_get_current_process();
+    uint32_t start    = (uintptr_t)addr;
+    uint32_t end      = start + round_up(length, PAGE_SIZE);
+    int mapped        = 0;
+
+    if ((start & (PAGE_SIZE - 1)) || (end < start)) {
+        return -EINVAL;
+    }
+    switch (advice) {
+    case MADV_NORMAL:
+    case MADV_RANDOM:
+    case MADV_SEQUENTIAL:
+    case MADV_WILLNEED:
+    case MADV_DONTNEED:
+    case MADV_MERGEABLE:
+    case MADV_UNMERGEABLE:
+    case MADV_HUGEPAGE:
+    case MADV_NOHUGEPAGE:
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (start == end) {
+        return 0;
+    }
+    // The access patterns are kept per area, thus they apply to the whole
+    // areas overlapping the range, while the pages are handled one by one.
+    list_for_each_decl (it, &task->mm->mmap_list) {
+        vm_area_struct_t *segment = list_entry(it, vm_area_struct_t, vm_list);
+        if ((segment->vm_end <= start) || (segment->vm_start >= end)) {
+            continue;
+        }
+        mapped = 1;
+        switch (advice) {
+        case MADV_NORMAL:
+            segment->vm_flags &= ~(VM_SEQ_READ | VM_RAND_READ);
+            break;
+        case MADV_RANDOM:
+            segment->vm_flags = (segment->vm_flags & ~VM_SEQ_READ) | VM_RAND_READ;
+            break;
+        case MADV_SEQUENTIAL:
+            segment->vm_flags = (segment->vm_flags & ~VM_RAND_READ) | VM_SEQ_READ;
+            break;
+        case MADV_WILLNEED:
+            vm_area_willneed(task->mm, segment, start, end);
+            break;
+        case MADV_DONTNEED: {
+            int ret = vm_area_dontneed(task->mm, segment, start, end);
+            if (ret < 0) {
+                return ret;
+            }
+            break;
+        }
+        case MADV_MERGEABLE:
+            segment->vm_flags |= VM_MERGEABLE;
+            break;
+        case MADV_UNMERGEABLE:
+            segment->vm_flags &= ~VM_MERGEABLE;
+            break;
+        case MADV_HUGEPAGE:
+            segment->vm_flags |= VM_HUGEPAGE;
+            break;
+        case MADV_NOHUGEPAGE:
+            segment->vm_flags &= ~VM_HUGEPAGE;
+            break;
+        }
+    }
+    return mapped ? 0 : -ENOMEM;
 }
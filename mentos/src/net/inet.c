@@ -0,0 +1,818 @@
+/// @file inet.c
+/// @brief Internet (AF_INET) sockets, and UDP.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[INET  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "net/inet.h"
+
+#include "errno.h"
+#include "fcntl.h"
+#include "fs/vfs.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "string.h"
+#include "sys/bitops.h"
+#include "sys/stat.h"
+#include "sys/uio.h"
+#include "system/syscall.h"
+#include "time.h"
+
+#define INET_PORT_FIRST 49152                          ///< The first ephemeral port.
+#define INET_PORT_LAST  65535                          ///< The last ephemeral port.
+#define INET_MAX_IOV    64                             ///< The maximum number of buffers of a message.
+#define UDP_RCVBUF      65536                          ///< The bytes a UDP socket queues, at most.
+#define UDP_MAX_BUFS    64                             ///< The datagrams a UDP socket queues, at most.
+#define UDP_HLEN        8                              ///< The size of the UDP header.
+#define UDP_MAX_PAYLOAD (ETH_MTU - IP_HLEN - UDP_HLEN) ///< The largest datagram, we do not fragment.
+
+/// @brief A UDP header.
+typedef struct udphdr {
+    uint16_t source; ///< The source port.
+    uint16_t dest;   ///< The destination port.
+    uint16_t len;    ///< The length of the datagram, header included.
+    uint16_t check;  ///< The checksum, 0 if there is none.
+} __attribute__((packed)) udphdr_t;
+
+static int inet_close(vfs_file_t *file);
+static ssize_t inet_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte);
+static ssize_t inet_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte);
+static int inet_fstat(vfs_file_t *file, stat_t *stat);
+static long inet_fcntl(vfs_file_t *file, unsigned int request, unsigned long data);
+static unsigned int inet_poll(vfs_file_t *file, poll_table_t *table);
+
+/// Socket file operations.
+static vfs_file_operations_t inet_fs_operations = {
+    .open_f     = NULL,
+    .unlink_f   = NULL,
+    .close_f    = inet_close,
+    .read_f     = inet_read,
+    .write_f    = inet_write,
+    .lseek_f    = NULL,
+    .stat_f     = inet_fstat,
+    .ioctl_f    = NULL,
+    .fcntl_f    = inet_fcntl,
+    .getdents_f = NULL,
+    .readlink_f = NULL,
+    .poll_f     = inet_poll,
+};
+
+/// The UDP sockets which have a port (inet_sock_t).
+static list_head_t udp_socks = { .prev = &udp_socks, .next = &udp_socks };
+/// The TCP sockets which have a port (inet_sock_t).
+static list_head_t tcp_socks = { .prev = &tcp_socks, .next = &tcp_socks };
+/// The next ephemeral port we try.
+static uint16_t inet_next_port = INET_PORT_FIRST;
+
+// == SOCKETS =================================================================
+
+list_head_t *inet_socks(uint8_t protocol)
+{
+    return (protocol == IPPROTO_TCP) ? &tcp_socks : &udp_socks;
+}
+
+inet_sock_t *inet_sock_alloc(int type, uint8_t protocol)
+{
+    inet_sock_t *sock = kmalloc(sizeof(inet_sock_t));
+    if (!sock) {
+        return NULL;
+    }
+    memset(sock, 0, sizeof(inet_sock_t));
+    sock->type     = type;
+    sock->protocol = protocol;
+    sock->state    = TCP_CLOSED;
+    list_head_init(&sock->list);
+    list_head_init(&sock->rx_queue);
+    list_head_init(&sock->accept_queue);
+    list_head_init(&sock->accept_list);
+    wait_queue_head_init(&sock->read_wait);
+    wait_queue_head_init(&sock->write_wait);
+    return sock;
+}
+
+void inet_sock_free(inet_sock_t *sock)
+{
+    list_head_remove(&sock->list);
+    list_head_remove(&sock->accept_list);
+    list_for_each_safe_decl(it, store, &sock->rx_queue)
+    {
+        net_buf_free(list_entry(it, net_buf_t, list));
+    }
+    if (sock->snd_buf) {
+        kfree(sock->snd_buf);
+    }
+    // Wake up whoever still waits on the socket, the queues go away with it.
+    wake_up(&sock->read_wait);
+    wake_up(&sock->write_wait);
+    kfree(sock);
+}
+
+void inet_hash(inet_sock_t *sock)
+{
+    if (list_head_empty(&sock->list)) {
+        list_head_insert_before(&sock->list, inet_socks(sock->protocol));
+    }
+}
+
+inet_sock_t *inet_lookup(uint8_t protocol, uint32_t daddr, uint16_t dport, uint32_t saddr, uint16_t sport)
+{
+    inet_sock_t *unconnected = NULL;
+    list_for_each_decl (it, inet_socks(protocol)) {
+        inet_sock_t *sock = list_entry(it, inet_sock_t, list);
+        if ((sock->lport != dport) || ((sock->laddr != INADDR_ANY) && (sock->laddr != daddr))) {
+            continue;
+        }
+        if (sock->raddr == INADDR_ANY) {
+            unconnected = unconnected ? unconnected : sock;
+        } else if ((sock->raddr == saddr) && (sock->rport == sport)) {
+            return sock;
+        }
+    }
+    return unconnected;
+}
+
+bool_t inet_nonblock(inet_sock_t *sock, int flags)
+{
+    return (sock->file && bitmask_check(sock->file->flags, O_NONBLOCK)) || bitmask_check(flags, MSG_DONTWAIT);
+}
+
+/// @brief Checks if a port is taken, on an address.
+/// @param protocol the protocol.
+/// @param addr the local address.
+/// @param port the port.
+/// @return true if another socket uses the port on the same address.
+static bool_t __inet_port_taken(uint8_t protocol, uint32_t addr, uint16_t port)
+{
+    list_for_each_decl (it, inet_socks(protocol)) {
+        inet_sock_t *sock = list_entry(it, inet_sock_t, list);
+        if ((sock->lport == port) && ((sock->laddr == INADDR_ANY) || (addr == INADDR_ANY) || (sock->laddr == addr))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Gives a port to a socket, and places it inside the list of its protocol.
+/// @param sock the socket.
+/// @param addr the local address.
+/// @param port the port in network byte order, 0 for an ephemeral one.
+/// @return 0 on success, -EADDRINUSE if the port is taken, or there are no ports left.
+static int __inet_get_port(inet_sock_t *sock, uint32_t addr, uint16_t port)
+{
+    if (port == 0) {
+        for (unsigned tries = 0; tries <= INET_PORT_LAST - INET_PORT_FIRST; ++tries) {
+            uint16_t candidate = htons(inet_next_port);
+            inet_next_port     = (inet_next_port == INET_PORT_LAST) ? INET_PORT_FIRST : inet_next_port + 1;
+            if (!__inet_port_taken(sock->protocol, addr, candidate)) {
+                port = candidate;
+                break;
+            }
+        }
+        if (port == 0) {
+            return -EADDRINUSE;
+        }
+    } else if (__inet_port_taken(sock->protocol, addr, port)) {
+        return -EADDRINUSE;
+    }
+    sock->laddr = addr;
+    sock->lport = port;
+    inet_hash(sock);
+    return 0;
+}
+
+/// @brief Copies an Internet name from user space.
+/// @param addr the name.
+/// @param addrlen the size of the name.
+/// @param in where the name is stored.
+/// @return 0 on success, -EFAULT if there is no name, -EINVAL if it is too short,
+/// -EAFNOSUPPORT if it is not an Internet name.
+static inline int __inet_get_name(const struct sockaddr *addr, socklen_t addrlen, struct sockaddr_in *in)
+{
+    if (!addr) {
+        return -EFAULT;
+    }
+    if (addrlen < sizeof(struct sockaddr_in)) {
+        return -EINVAL;
+    }
+    memcpy(in, addr, sizeof(struct sockaddr_in));
+    return (in->sin_family == AF_INET) ? 0 : -EAFNOSUPPORT;
+}
+
+/// @brief Copies an Internet name to user space.
+/// @param address the address.
+/// @param port the port.
+/// @param addr where the name is stored (can be NULL).
+/// @param addrlen the size of `addr`, updated with the size of the name.
+static inline void __inet_put_name(uint32_t address, uint16_t port, struct sockaddr *addr, socklen_t *addrlen)
+{
+    if (!addr || !addrlen) {
+        return;
+    }
+    struct sockaddr_in in;
+    memset(&in, 0, sizeof(struct sockaddr_in));
+    in.sin_family      = AF_INET;
+    in.sin_port        = port;
+    in.sin_addr.s_addr = address;
+    memcpy(addr, &in, min(*addrlen, sizeof(struct sockaddr_in)));
+    *addrlen = sizeof(struct sockaddr_in);
+}
+
+/// @brief Creates the file of a socket.
+/// @param sock the socket.
+/// @param flags the flags of the file (O_NONBLOCK).
+/// @return the file, NULL on failure.
+static vfs_file_t *__inet_file_alloc(inet_sock_t *sock, int flags)
+{
+    vfs_file_t *file = vfs_alloc_file();
+    if (!file) {
+        return NULL;
+    }
+    memset(file, 0, sizeof(vfs_file_t));
+    strcpy(file->name, (sock->protocol == IPPROTO_TCP) ? "[tcp]" : "[udp]");
+    file->flags         = O_RDWR | (flags & O_NONBLOCK);
+    file->fs_operations = &inet_fs_operations;
+    file->device        = sock;
+    file->refcount      = 1;
+    file->count         = 1;
+    file->atime         = sys_time(NULL);
+    file->mtime         = file->atime;
+    file->ctime         = file->atime;
+    list_head_init(&file->siblings);
+    sock->file = file;
+    return file;
+}
+
+/// @brief Installs the file of a socket on a file descriptor.
+/// @param task the current task.
+/// @param file the file, which is closed on failure.
+/// @return the file descriptor, or a negative error code.
+static inline int __inet_install(task_struct *task, vfs_file_t *file)
+{
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        vfs_close(file);
+        return fd;
+    }
+    fd_install(task, fd, file, file->flags);
+    return fd;
+}
+
+/// @brief Takes the error of a socket, which is reported once.
+/// @param sock the socket.
+/// @return the negative error code, 0 if there is none.
+static inline int __inet_take_error(inet_sock_t *sock)
+{
+    int error   = sock->error;
+    sock->error = 0;
+    return -error;
+}
+
+/// @brief Checks the buffers of a message.
+/// @param msg the message.
+/// @return 0 if they are valid, -EINVAL otherwise.
+static inline int __inet_check_iov(const struct msghdr *msg)
+{
+    if ((msg->msg_iovlen > INET_MAX_IOV) || (msg->msg_iovlen && !msg->msg_iov)) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// == UDP =====================================================================
+
+void udp_receive(net_buf_t *buf, iphdr_t *ip)
+{
+    udphdr_t *udp = (udphdr_t *)buf->data;
+    size_t len    = (buf->len >= UDP_HLEN) ? ntohs(udp->len) : 0;
+    if ((len < UDP_HLEN) || (len > buf->len) ||
+        (udp->check && net_checksum(udp, len, net_pseudo_sum(ip->saddr, ip->daddr, IPPROTO_UDP, len)))) {
+        net_buf_free(buf);
+        return;
+    }
+    inet_sock_t *sock = inet_lookup(IPPROTO_UDP, ip->daddr, udp->dest, ip->saddr, udp->source);
+    if (!sock || sock->shut_rd || (sock->rx_bufs >= UDP_MAX_BUFS) || (sock->rx_bytes + len > UDP_RCVBUF)) {
+        net_buf_free(buf);
+        return;
+    }
+    // Queue the payload where it lies, the reader copies it.
+    buf->sport = udp->source;
+    buf->len   = len;
+    net_buf_pull(buf, UDP_HLEN);
+    list_head_insert_before(&buf->list, &sock->rx_queue);
+    sock->rx_bytes += buf->len;
+    ++sock->rx_bufs;
+    wake_up_nr(&sock->read_wait, 1);
+}
+
+/// @brief Sends a datagram.
+/// @param sock the socket.
+/// @param msg the message.
+/// @return the number of bytes sent, or a negative error code.
+static ssize_t __udp_sendmsg(inet_sock_t *sock, const struct msghdr *msg)
+{
+    struct sockaddr_in dest;
+    uint32_t daddr = sock->raddr;
+    uint16_t dport = sock->rport;
+    if (msg->msg_name) {
+        int ret = __inet_get_name(msg->msg_name, msg->msg_namelen, &dest);
+        if (ret < 0) {
+            return ret;
+        }
+        daddr = dest.sin_addr.s_addr;
+        dport = dest.sin_port;
+    } else if (daddr == INADDR_ANY) {
+        return -EDESTADDRREQ;
+    }
+    if (dport == 0) {
+        return -EINVAL;
+    }
+    size_t len = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        len += msg->msg_iov[i].iov_len;
+    }
+    if (len > UDP_MAX_PAYLOAD) {
+        return -EMSGSIZE;
+    }
+    uint32_t saddr = (sock->laddr != INADDR_ANY) ? sock->laddr : net_source_address(daddr);
+    if (saddr == INADDR_ANY) {
+        return -ENETUNREACH;
+    }
+    if (!sock->lport) {
+        int ret = __inet_get_port(sock, INADDR_ANY, 0);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    net_buf_t *buf = net_buf_alloc();
+    if (!buf) {
+        return -ENOBUFS;
+    }
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        memcpy(buf->data + buf->len, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+        buf->len += msg->msg_iov[i].iov_len;
+    }
+    udphdr_t *udp = net_buf_push(buf, UDP_HLEN);
+    udp->source   = sock->lport;
+    udp->dest     = dport;
+    udp->len      = htons(buf->len);
+    udp->check    = 0;
+    udp->check    = net_checksum(udp, buf->len, net_pseudo_sum(saddr, daddr, IPPROTO_UDP, buf->len));
+    // A checksum of zero means no checksum, it is sent as all ones.
+    if (udp->check == 0) {
+        udp->check = 0xFFFF;
+    }
+    int ret = ip_send(buf, saddr, daddr, IPPROTO_UDP);
+    return (ret < 0) ? ret : (ssize_t)len;
+}
+
+/// @brief Receives a datagram, the part which does not fit the buffers is discarded.
+/// @param sock the socket.
+/// @param msg the message.
+/// @return the number of bytes received.
+static ssize_t __udp_recvmsg(inet_sock_t *sock, struct msghdr *msg)
+{
+    net_buf_t *buf = list_entry(sock->rx_queue.next, net_buf_t, list);
+    size_t copied  = 0;
+    for (size_t i = 0; (i < msg->msg_iovlen) && (copied < buf->len); ++i) {
+        size_t len = min(msg->msg_iov[i].iov_len, buf->len - copied);
+        memcpy(msg->msg_iov[i].iov_base, buf->data + copied, len);
+        copied += len;
+    }
+    if (copied < buf->len) {
+        msg->msg_flags |= MSG_TRUNC;
+    }
+    if (msg->msg_name) {
+        __inet_put_name(buf->saddr, buf->sport, msg->msg_name, &msg->msg_namelen);
+    }
+    sock->rx_bytes -= buf->len;
+    --sock->rx_bufs;
+    net_buf_free(buf);
+    return copied;
+}
+
+// == TCP STREAMS =============================================================
+
+/// @brief Copies the data queued on a connection, freeing the buffers which are emptied.
+/// @param sock the socket.
+/// @param msg the message.
+/// @return the number of bytes received.
+static ssize_t __tcp_recvmsg(inet_sock_t *sock, struct msghdr *msg)
+{
+    size_t copied = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        size_t done = 0;
+        while ((done < msg->msg_iov[i].iov_len) && !list_head_empty(&sock->rx_queue)) {
+            net_buf_t *buf = list_entry(sock->rx_queue.next, net_buf_t, list);
+            size_t len     = min(msg->msg_iov[i].iov_len - done, buf->len);
+            memcpy((char *)msg->msg_iov[i].iov_base + done, buf->data, len);
+            net_buf_pull(buf, len);
+            sock->rx_bytes -= len;
+            done += len;
+            if (buf->len == 0) {
+                --sock->rx_bufs;
+                net_buf_free(buf);
+            }
+        }
+        copied += done;
+    }
+    if (copied) {
+        tcp_read_done(sock);
+    }
+    return copied;
+}
+
+/// @brief Checks if a connection has nothing more to deliver.
+/// @param sock the socket.
+/// @return true once the peer is done sending, or the connection is gone.
+static inline bool_t __tcp_eof(inet_sock_t *sock)
+{
+    return sock->fin_received || sock->shut_rd || (sock->state == TCP_CLOSED);
+}
+
+// == SYSTEM CALLS ============================================================
+
+int inet_socket(int type, int protocol)
+{
+    int kind = type & ~SOCK_NONBLOCK;
+    if ((kind != SOCK_STREAM) && (kind != SOCK_DGRAM)) {
+        return -EINVAL;
+    }
+    if ((protocol != 0) && (protocol != ((kind == SOCK_STREAM) ? IPPROTO_TCP : IPPROTO_UDP))) {
+        return -EPROTONOSUPPORT;
+    }
+    inet_sock_t *sock = inet_sock_alloc(kind, (kind == SOCK_STREAM) ? IPPROTO_TCP : IPPROTO_UDP);
+    if (!sock) {
+        return -ENOMEM;
+    }
+    vfs_file_t *file = __inet_file_alloc(sock, type & SOCK_NONBLOCK);
+    if (!file) {
+        inet_sock_free(sock);
+        return -ENOMEM;
+    }
+    return __inet_install(scheduler_get_current_process(), file);
+}
+
+inet_sock_t *inet_get(vfs_file_t *file)
+{
+    return (file && (file->fs_operations == &inet_fs_operations)) ? (inet_sock_t *)file->device : NULL;
+}
+
+int inet_bind(inet_sock_t *sock, const struct sockaddr *addr, socklen_t addrlen)
+{
+    struct sockaddr_in in;
+    int ret = __inet_get_name(addr, addrlen, &in);
+    if (ret < 0) {
+        return ret;
+    }
+    if (sock->lport || (sock->state != TCP_CLOSED)) {
+        return -EINVAL;
+    }
+    if ((in.sin_addr.s_addr != INADDR_ANY) && !net_is_local(in.sin_addr.s_addr)) {
+        return -EADDRNOTAVAIL;
+    }
+    return __inet_get_port(sock, in.sin_addr.s_addr, in.sin_port);
+}
+
+int inet_listen(inet_sock_t *sock, int backlog)
+{
+    if (sock->type != SOCK_STREAM) {
+        return -EOPNOTSUPP;
+    }
+    if ((sock->state != TCP_CLOSED) && (sock->state != TCP_LISTEN)) {
+        return -EINVAL;
+    }
+    // Listening on a socket which is not bound takes an ephemeral port.
+    if (!sock->lport) {
+        int ret = __inet_get_port(sock, INADDR_ANY, 0);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    sock->state       = TCP_LISTEN;
+    sock->max_backlog = (backlog <= 0) ? 1 : min(backlog, SOMAXCONN);
+    return 0;
+}
+
+int inet_accept(inet_sock_t *sock, struct sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    if (sock->type != SOCK_STREAM) {
+        return -EOPNOTSUPP;
+    }
+    if ((sock->state != TCP_LISTEN) || (flags & ~SOCK_NONBLOCK)) {
+        return -EINVAL;
+    }
+    while (list_head_empty(&sock->accept_queue)) {
+        if (inet_nonblock(sock, 0)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on_exclusive(&sock->read_wait) < 0) {
+            // We might have been woken up for a connection, leave it to another task.
+            if (!list_head_empty(&sock->accept_queue)) {
+                wake_up_nr(&sock->read_wait, 1);
+            }
+            return -EINTR;
+        }
+        // Closed by another task while we were sleeping.
+        if (sock->state != TCP_LISTEN) {
+            return -EINVAL;
+        }
+    }
+    inet_sock_t *child = list_entry(sock->accept_queue.next, inet_sock_t, accept_list);
+    vfs_file_t *file   = __inet_file_alloc(child, flags & SOCK_NONBLOCK);
+    if (!file) {
+        return -ENOMEM;
+    }
+    int fd = get_unused_fd();
+    if (fd < 0) {
+        // The connection stays queued.
+        child->file = NULL;
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+        return fd;
+    }
+    list_head_remove(&child->accept_list);
+    child->parent = NULL;
+    --sock->backlog_len;
+    fd_install(scheduler_get_current_process(), fd, file, file->flags);
+    __inet_put_name(child->raddr, child->rport, addr, addrlen);
+    if (!list_head_empty(&sock->accept_queue)) {
+        wake_up_nr(&sock->read_wait, 1);
+    }
+    return fd;
+}
+
+int inet_connect(inet_sock_t *sock, const struct sockaddr *addr, socklen_t addrlen)
+{
+    struct sockaddr_in in;
+    // A datagram socket forgets its destination.
+    if ((sock->type == SOCK_DGRAM) && addr && (addrlen >= sizeof(sa_family_t)) && (addr->sa_family == AF_UNSPEC)) {
+        sock->raddr = INADDR_ANY;
+        sock->rport = 0;
+        return 0;
+    }
+    int ret = __inet_get_name(addr, addrlen, &in);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((in.sin_addr.s_addr == INADDR_ANY) || (in.sin_port == 0)) {
+        return -EINVAL;
+    }
+    if (sock->type == SOCK_STREAM) {
+        switch (sock->state) {
+        case TCP_CLOSED:
+            break;
+        case TCP_SYN_SENT:
+            return -EALREADY;
+        case TCP_LISTEN:
+            return -EINVAL;
+        default:
+            return -EISCONN;
+        }
+        // A connection which failed cannot be started again, it reports why once.
+        if (sock->raddr != INADDR_ANY) {
+            return sock->error ? __inet_take_error(sock) : -EINVAL;
+        }
+    }
+    uint32_t saddr = (sock->laddr != INADDR_ANY) ? sock->laddr : net_source_address(in.sin_addr.s_addr);
+    if (saddr == INADDR_ANY) {
+        return -ENETUNREACH;
+    }
+    if (!sock->lport) {
+        ret = __inet_get_port(sock, INADDR_ANY, 0);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    sock->raddr = in.sin_addr.s_addr;
+    sock->rport = in.sin_port;
+    if (sock->type == SOCK_DGRAM) {
+        return 0;
+    }
+    // The connection is bound to the address it leaves from.
+    sock->laddr = saddr;
+    return tcp_connect(sock);
+}
+
+ssize_t inet_sendmsg(inet_sock_t *sock, const struct msghdr *msg, int flags)
+{
+    if (!msg) {
+        return -EFAULT;
+    }
+    int ret = __inet_check_iov(msg);
+    if (ret < 0) {
+        return ret;
+    }
+    if (sock->type == SOCK_STREAM) {
+        return tcp_sendmsg(sock, msg, flags);
+    }
+    if (sock->shut_wr) {
+        return -EPIPE;
+    }
+    return __udp_sendmsg(sock, msg);
+}
+
+ssize_t inet_recvmsg(inet_sock_t *sock, struct msghdr *msg, int flags)
+{
+    if (!msg) {
+        return -EFAULT;
+    }
+    int ret = __inet_check_iov(msg);
+    if (ret < 0) {
+        return ret;
+    }
+    msg->msg_flags      = 0;
+    msg->msg_controllen = 0;
+    if (sock->type == SOCK_STREAM) {
+        msg->msg_namelen = 0;
+        if ((sock->state == TCP_CLOSED) && !sock->raddr) {
+            return -ENOTCONN;
+        }
+        if ((sock->state == TCP_LISTEN) || (sock->state == TCP_SYN_SENT)) {
+            return -ENOTCONN;
+        }
+    }
+    while (list_head_empty(&sock->rx_queue)) {
+        if (sock->error) {
+            return __inet_take_error(sock);
+        }
+        if ((sock->type == SOCK_STREAM) ? __tcp_eof(sock) : sock->shut_rd) {
+            return 0;
+        }
+        if (inet_nonblock(sock, flags)) {
+            return -EAGAIN;
+        }
+        if (interruptible_sleep_on_exclusive(&sock->read_wait) < 0) {
+            // We might have been woken up for some data, leave it to another reader.
+            if (!list_head_empty(&sock->rx_queue)) {
+                wake_up_nr(&sock->read_wait, 1);
+            }
+            return -EINTR;
+        }
+    }
+    ssize_t copied = (sock->type == SOCK_STREAM) ? __tcp_recvmsg(sock, msg) : __udp_recvmsg(sock, msg);
+    // Pass the wake-up on to another reader, if we left something behind.
+    if (!list_head_empty(&sock->rx_queue)) {
+        wake_up_nr(&sock->read_wait, 1);
+    }
+    return copied;
+}
+
+int inet_shutdown(inet_sock_t *sock, int how)
+{
+    if ((how != SHUT_RD) && (how != SHUT_WR) && (how != SHUT_RDWR)) {
+        return -EINVAL;
+    }
+    if ((sock->type == SOCK_STREAM) && (sock->state < TCP_SYN_RECEIVED)) {
+        return -ENOTCONN;
+    }
+    if (how != SHUT_WR) {
+        // What has been queued is dropped, what comes next is discarded.
+        sock->shut_rd = true;
+        list_for_each_safe_decl(it, store, &sock->rx_queue)
+        {
+            net_buf_free(list_entry(it, net_buf_t, list));
+        }
+        sock->rx_bytes = 0;
+        sock->rx_bufs  = 0;
+        wake_up(&sock->read_wait);
+    }
+    if ((how != SHUT_RD) && !sock->shut_wr) {
+        sock->shut_wr = true;
+        if (sock->type == SOCK_STREAM) {
+            tcp_shutdown_write(sock);
+        }
+        wake_up(&sock->write_wait);
+    }
+    return 0;
+}
+
+// == FILE OPERATIONS =========================================================
+
+/// @brief Closes a socket, with the last reference to its file.
+/// @param file the file of the socket.
+/// @return 0 on success.
+static int inet_close(vfs_file_t *file)
+{
+    if (--file->count == 0) {
+        inet_sock_t *sock = (inet_sock_t *)file->device;
+        sock->file        = NULL;
+        list_head_remove(&file->siblings);
+        vfs_dealloc_file(file);
+        // A connection lives on, until the peer knows it is over.
+        if (sock->type == SOCK_STREAM) {
+            tcp_close(sock);
+        } else {
+            inet_sock_free(sock);
+        }
+    }
+    return 0;
+}
+
+/// @brief Receives data from a socket, as recv() without flags.
+/// @param file the file of the socket.
+/// @param buffer where the data is stored.
+/// @param offset not used.
+/// @param nbyte the size of the buffer.
+/// @return the number of bytes received, or a negative error code.
+static ssize_t inet_read(vfs_file_t *file, char *buffer, off_t offset, size_t nbyte)
+{
+    struct iovec iov  = { .iov_base = buffer, .iov_len = nbyte };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    return inet_recvmsg((inet_sock_t *)file->device, &msg, 0);
+}
+
+/// @brief Sends data through a socket, as send() without flags.
+/// @param file the file of the socket.
+/// @param buffer the data.
+/// @param offset not used.
+/// @param nbyte the size of the data.
+/// @return the number of bytes sent, or a negative error code.
+static ssize_t inet_write(vfs_file_t *file, const void *buffer, off_t offset, size_t nbyte)
+{
+    struct iovec iov  = { .iov_base = (void *)buffer, .iov_len = nbyte };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    return inet_sendmsg((inet_sock_t *)file->device, &msg, 0);
+}
+
+/// @brief Retrieves the status of a socket.
+/// @param file the file of the socket.
+/// @param stat where the status is stored.
+/// @return 0 on success.
+static int inet_fstat(vfs_file_t *file, stat_t *stat)
+{
+    memset(stat, 0, sizeof(stat_t));
+    stat->st_mode  = S_IFSOCK | 0777;
+    stat->st_nlink = 1;
+    stat->st_atime = file->atime;
+    stat->st_mtime = file->mtime;
+    stat->st_ctime = file->ctime;
+    return 0;
+}
+
+/// @brief Gets, or sets, the flags of a socket.
+/// @param file the file of the socket.
+/// @param request the request (F_GETFL or F_SETFL).
+/// @param data the new flags, only O_NONBLOCK can be changed.
+/// @return the flags for F_GETFL, 0 for F_SETFL, -EINVAL for other requests.
+static long inet_fcntl(vfs_file_t *file, unsigned int request, unsigned long data)
+{
+    switch (request) {
+    case F_GETFL:
+        return file->flags;
+    case F_SETFL:
+        file->flags = (file->flags & ~O_NONBLOCK) | (data & O_NONBLOCK);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+/// @brief Reports the readiness of a socket.
+/// @param file the file of the socket.
+/// @param table the poll table.
+/// @return POLLIN when there is data, or connections, to take, POLLOUT when
+/// there is room for sending, POLLHUP once a connection is over.
+static unsigned int inet_poll(vfs_file_t *file, poll_table_t *table)
+{
+    inet_sock_t *sock = (inet_sock_t *)file->device;
+    unsigned int mask = 0;
+    poll_wait(&sock->read_wait, table);
+    poll_wait(&sock->write_wait, table);
+    if (sock->error) {
+        mask |= POLLERR;
+    }
+    if (sock->type == SOCK_DGRAM) {
+        mask |= POLLOUT | POLLWRNORM;
+        if (!list_head_empty(&sock->rx_queue)) {
+            mask |= POLLIN | POLLRDNORM;
+        }
+        return mask;
+    }
+    switch (sock->state) {
+    case TCP_LISTEN:
+        return list_head_empty(&sock->accept_queue) ? mask : (mask | POLLIN | POLLRDNORM);
+    case TCP_SYN_SENT:
+        return mask;
+    case TCP_CLOSED:
+        // A socket which is not connected yet is just not ready.
+        return sock->raddr ? (mask | POLLIN | POLLRDNORM | POLLHUP) : mask;
+    default:
+        break;
+    }
+    if (!list_head_empty(&sock->rx_queue) || __tcp_eof(sock)) {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if (!sock->shut_wr && !sock->fin_pending && sock->snd_buf && (sock->snd_len < TCP_SNDBUF)) {
+        mask |= POLLOUT | POLLWRNORM;
+    }
+    if (sock->fin_received && sock->shut_wr) {
+        mask |= POLLHUP;
+    }
+    return mask;
+}
@@ -0,0 +1,477 @@
+/// @file net.c
+/// @brief The core of the network stack: buffers, devices, Ethernet, ARP and IPv4.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[NET   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "net/net.h"
+
+#include "errno.h"
+#include "hardware/timer.h"
+#include "klib/irqflags.h"
+#include "mem/alloc/zone_allocator.h"
+#include "net/inet.h"
+#include "stdbool.h"
+#include "string.h"
+#include "sys/initcall.h"
+#include "system/softirq.h"
+
+#define ARP_CACHE_SIZE  16     ///< The number of neighbours we remember.
+#define ARP_MAX_PENDING 8      ///< The packets waiting for the address of a neighbour.
+#define ARP_HRD_ETHER   1      ///< The hardware type of Ethernet.
+#define ARP_REQUEST     1      ///< An ARP request.
+#define ARP_REPLY       2      ///< An ARP reply.
+#define IP_DF           0x4000 ///< The packet must not be fragmented.
+#define IP_FRAGMENT     0x3FFF ///< The more-fragments flag, and the offset of a fragment.
+#define ICMP_ECHOREPLY  0      ///< An echo reply.
+#define ICMP_ECHO       8      ///< An echo request.
+
+/// @brief An ARP packet, for IPv4 over Ethernet.
+typedef struct arphdr {
+    uint16_t htype;        ///< The hardware type (ARP_HRD_ETHER).
+    uint16_t ptype;        ///< The protocol type (ETH_P_IP).
+    uint8_t hlen;          ///< The size of a hardware address.
+    uint8_t plen;          ///< The size of a protocol address.
+    uint16_t oper;         ///< The operation (ARP_REQUEST or ARP_REPLY).
+    uint8_t sha[ETH_ALEN]; ///< The hardware address of the sender.
+    uint32_t spa;          ///< The protocol address of the sender.
+    uint8_t tha[ETH_ALEN]; ///< The hardware address of the target.
+    uint32_t tpa;          ///< The protocol address of the target.
+} __attribute__((packed)) arphdr_t;
+
+/// @brief The header of an ICMP echo message.
+typedef struct icmphdr {
+    uint8_t type;      ///< The type of the message.
+    uint8_t code;      ///< The code of the message.
+    uint16_t checksum; ///< The checksum of the message.
+    uint16_t id;       ///< The identifier of the echo.
+    uint16_t sequence; ///< The sequence number of the echo.
+} __attribute__((packed)) icmphdr_t;
+
+/// @brief A neighbour on the local network.
+typedef struct arp_entry {
+    /// The address of the neighbour, INADDR_ANY if the entry is free.
+    uint32_t addr;
+    /// The Ethernet address of the neighbour.
+    uint8_t mac[ETH_ALEN];
+    /// If the Ethernet address is known.
+    bool_t resolved;
+    /// When the entry has been used last, in ticks.
+    unsigned long time;
+    /// The packets waiting for the Ethernet address (net_buf_t).
+    list_head_t pending;
+    /// The number of packets waiting.
+    size_t npending;
+} arp_entry_t;
+
+/// The broadcast Ethernet address.
+static const uint8_t eth_broadcast[ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+/// The unknown Ethernet address, of the target of a request.
+static const uint8_t eth_unknown[ETH_ALEN] = { 0 };
+/// The network device, NULL if there is none (the loopback always works).
+static netdev_t *net_device = NULL;
+/// The neighbours, entries are replaced once they are all taken.
+static arp_entry_t arp_cache[ARP_CACHE_SIZE];
+/// The identifier of the next packet we send.
+static uint16_t ip_next_id = 0;
+/// The packets sent through the loopback, delivered by its tasklet (net_buf_t).
+static list_head_t net_loopback_queue;
+/// Delivers the packets sent through the loopback, as a device would.
+static tasklet_t net_loopback_tasklet;
+
+static void __ip_receive(net_buf_t *buf);
+
+// == BUFFERS AND CHECKSUMS ===================================================
+
+net_buf_t *net_buf_alloc(void)
+{
+    page_t *page = alloc_pages(GFP_KERNEL, 0);
+    if (!page) {
+        return NULL;
+    }
+    net_buf_t *buf = (net_buf_t *)get_virtual_address_from_page(page);
+    if (!buf) {
+        free_pages(page);
+        return NULL;
+    }
+    memset(buf, 0, sizeof(net_buf_t));
+    list_head_init(&buf->list);
+    buf->page = page;
+    buf->phys = get_physical_address_from_page(page);
+    buf->data = net_buf_room(buf) + NET_HEADROOM;
+    return buf;
+}
+
+void net_buf_free(net_buf_t *buf)
+{
+    if (buf) {
+        list_head_remove(&buf->list);
+        free_pages(buf->page);
+    }
+}
+
+uint16_t net_checksum(const void *data, size_t len, uint32_t sum)
+{
+    const uint16_t *word = (const uint16_t *)data;
+    for (; len > 1; len -= 2) {
+        sum += *word++;
+    }
+    // The last byte is padded with zeros.
+    if (len) {
+        sum += *(const uint8_t *)word;
+    }
+    while (sum >> 16U) {
+        sum = (sum & 0xFFFF) + (sum >> 16U);
+    }
+    return (uint16_t)~sum;
+}
+
+uint32_t net_pseudo_sum(uint32_t saddr, uint32_t daddr, uint8_t protocol, uint16_t len)
+{
+    // The words are summed as they lie in memory, like net_checksum() does.
+    return (saddr & 0xFFFF) + (saddr >> 16U) + (daddr & 0xFFFF) + (daddr >> 16U) + htons(protocol) + htons(len);
+}
+
+// == ADDRESSES ===============================================================
+
+int net_is_local(uint32_t addr)
+{
+    return ((ntohl(addr) >> 24U) == 127) || (net_device && (addr == net_device->addr));
+}
+
+uint32_t net_source_address(uint32_t daddr)
+{
+    if ((ntohl(daddr) >> 24U) == 127) {
+        return htonl(INADDR_LOOPBACK);
+    }
+    return net_device ? net_device->addr : INADDR_ANY;
+}
+
+/// @brief Checks if an address is a broadcast address of the local network.
+/// @param dev the device.
+/// @param addr the address.
+/// @return true if it is.
+static inline bool_t __net_is_broadcast(netdev_t *dev, uint32_t addr)
+{
+    return (addr == INADDR_BROADCAST) || (dev && (addr == (dev->addr | ~dev->netmask)));
+}
+
+// == ETHERNET ================================================================
+
+/// @brief Sends a frame.
+/// @param dev the device.
+/// @param buf the buffer, whose data is the payload.
+/// @param dest the destination.
+/// @param proto the type of the payload.
+/// @return 0 on success, or a negative error code.
+static int __eth_send(netdev_t *dev, net_buf_t *buf, const uint8_t *dest, uint16_t proto)
+{
+    ethhdr_t *eth = net_buf_push(buf, ETH_HLEN);
+    if (!eth) {
+        net_buf_free(buf);
+        return -ENOBUFS;
+    }
+    memcpy(eth->dest, dest, ETH_ALEN);
+    memcpy(eth->source, dev->mac, ETH_ALEN);
+    eth->proto = htons(proto);
+    return dev->xmit(dev, buf);
+}
+
+// == ARP =====================================================================
+
+/// @brief Searches a neighbour.
+/// @param addr the address of the neighbour.
+/// @return the entry, NULL if it is not known.
+static arp_entry_t *__arp_find(uint32_t addr)
+{
+    for (unsigned i = 0; i < ARP_CACHE_SIZE; ++i) {
+        if (arp_cache[i].addr && (arp_cache[i].addr == addr)) {
+            return &arp_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/// @brief Takes an entry for a new neighbour, replacing the one used least recently.
+/// @param addr the address of the neighbour.
+/// @return the entry, whose address is not resolved.
+static arp_entry_t *__arp_create(uint32_t addr)
+{
+    arp_entry_t *entry = &arp_cache[0];
+    for (unsigned i = 0; (i < ARP_CACHE_SIZE) && entry->addr; ++i) {
+        if (!arp_cache[i].addr || (arp_cache[i].time < entry->time)) {
+            entry = &arp_cache[i];
+        }
+    }
+    // Drop the packets waiting for the old neighbour.
+    list_for_each_safe_decl(it, store, &entry->pending)
+    {
+        net_buf_free(list_entry(it, net_buf_t, list));
+    }
+    entry->addr     = addr;
+    entry->resolved = false;
+    entry->time     = timer_get_ticks();
+    entry->npending = 0;
+    return entry;
+}
+
+/// @brief Sends an ARP packet.
+/// @param dev the device.
+/// @param oper the operation.
+/// @param tha the hardware address of the target, and the destination of the frame.
+/// @param tpa the protocol address of the target.
+static void __arp_send(netdev_t *dev, uint16_t oper, const uint8_t *tha, uint32_t tpa)
+{
+    net_buf_t *buf = net_buf_alloc();
+    if (!buf) {
+        return;
+    }
+    arphdr_t *arp = (arphdr_t *)buf->data;
+    buf->len      = sizeof(arphdr_t);
+    arp->htype    = htons(ARP_HRD_ETHER);
+    arp->ptype    = htons(ETH_P_IP);
+    arp->hlen     = ETH_ALEN;
+    arp->plen     = sizeof(uint32_t);
+    arp->oper     = htons(oper);
+    memcpy(arp->sha, dev->mac, ETH_ALEN);
+    arp->spa = dev->addr;
+    // A request does not know the hardware address of the target.
+    memcpy(arp->tha, (oper == ARP_REQUEST) ? eth_unknown : tha, ETH_ALEN);
+    arp->tpa = tpa;
+    __eth_send(dev, buf, tha, ETH_P_ARP);
+}
+
+/// @brief Sends a packet to a neighbour, resolving its address first if needed.
+/// @param dev the device.
+/// @param buf the buffer, whose data starts at the IPv4 header.
+/// @param next_hop the address of the neighbour.
+/// @return 0 on success, or a negative error code.
+static int __arp_output(netdev_t *dev, net_buf_t *buf, uint32_t next_hop)
+{
+    arp_entry_t *entry = __arp_find(next_hop);
+    if (entry && entry->resolved) {
+        entry->time = timer_get_ticks();
+        return __eth_send(dev, buf, entry->mac, ETH_P_IP);
+    }
+    if (!entry) {
+        entry = __arp_create(next_hop);
+    }
+    // Keep the packet until the reply comes, TCP sends it again otherwise.
+    if (entry->npending < ARP_MAX_PENDING) {
+        list_head_insert_before(&buf->list, &entry->pending);
+        ++entry->npending;
+    } else {
+        net_buf_free(buf);
+    }
+    __arp_send(dev, ARP_REQUEST, eth_broadcast, next_hop);
+    return 0;
+}
+
+/// @brief Handles an ARP packet, learning the address of the sender.
+/// @param dev the device.
+/// @param buf the buffer, whose data starts at the ARP header.
+static void __arp_receive(netdev_t *dev, net_buf_t *buf)
+{
+    arphdr_t *arp = (arphdr_t *)buf->data;
+    if ((buf->len < sizeof(arphdr_t)) || (arp->htype != htons(ARP_HRD_ETHER)) || (arp->ptype != htons(ETH_P_IP)) ||
+        (arp->hlen != ETH_ALEN) || (arp->plen != sizeof(uint32_t)) || (arp->spa == INADDR_ANY)) {
+        net_buf_free(buf);
+        return;
+    }
+    bool_t for_us      = (arp->tpa == dev->addr);
+    arp_entry_t *entry = __arp_find(arp->spa);
+    // Only the ones talking to us get a new entry.
+    if (!entry && for_us) {
+        entry = __arp_create(arp->spa);
+    }
+    if (entry) {
+        memcpy(entry->mac, arp->sha, ETH_ALEN);
+        entry->resolved = true;
+        entry->time     = timer_get_ticks();
+        list_for_each_safe_decl(it, store, &entry->pending)
+        {
+            net_buf_t *pending = list_entry(it, net_buf_t, list);
+            list_head_remove(&pending->list);
+            __eth_send(dev, pending, entry->mac, ETH_P_IP);
+        }
+        entry->npending = 0;
+    }
+    if (for_us && (arp->oper == htons(ARP_REQUEST))) {
+        __arp_send(dev, ARP_REPLY, arp->sha, arp->spa);
+    }
+    net_buf_free(buf);
+}
+
+// == ICMP ====================================================================
+
+/// @brief Handles an ICMP message, answering to the echo requests.
+/// @param buf the buffer, whose data starts at the ICMP header.
+/// @param ip the IPv4 header of the message.
+static void __icmp_receive(net_buf_t *buf, iphdr_t *ip)
+{
+    icmphdr_t *icmp = (icmphdr_t *)buf->data;
+    if ((buf->len < sizeof(icmphdr_t)) || net_checksum(buf->data, buf->len, 0) || (icmp->type != ICMP_ECHO)) {
+        net_buf_free(buf);
+        return;
+    }
+    // The request becomes the reply, inside the same buffer.
+    uint32_t saddr = net_source_address(ip->saddr);
+    uint32_t daddr = ip->saddr;
+    icmp->type     = ICMP_ECHOREPLY;
+    icmp->checksum = 0;
+    icmp->checksum = net_checksum(buf->data, buf->len, 0);
+    ip_send(buf, saddr, daddr, IPPROTO_ICMP);
+}
+
+// == IPV4 ====================================================================
+
+/// @brief Sends a packet through the loopback, its tasklet then delivers it.
+/// @param buf the buffer, whose data starts at the IPv4 header.
+static inline void __net_loopback(net_buf_t *buf)
+{
+    buf->dev = NULL;
+    list_head_insert_before(&buf->list, &net_loopback_queue);
+    tasklet_schedule(&net_loopback_tasklet);
+}
+
+/// @brief Delivers the packets sent through the loopback.
+/// @param data not used.
+static void __net_loopback_run(unsigned long data)
+{
+    uint8_t flags = irq_disable();
+    list_head_t *it;
+    // The answers to the packets are delivered in the same run.
+    while ((it = list_head_pop(&net_loopback_queue))) {
+        __ip_receive(list_entry(it, net_buf_t, list));
+    }
+    irq_enable(flags);
+}
+
+int ip_send(net_buf_t *buf, uint32_t saddr, uint32_t daddr, uint8_t protocol)
+{
+    iphdr_t *ip = net_buf_push(buf, IP_HLEN);
+    if (!ip) {
+        net_buf_free(buf);
+        return -ENOBUFS;
+    }
+    ip->version_ihl = 0x45;
+    ip->tos         = 0;
+    ip->tot_len     = htons(buf->len);
+    ip->id          = htons(ip_next_id++);
+    ip->frag_off    = htons(IP_DF);
+    ip->ttl         = IP_TTL;
+    ip->protocol    = protocol;
+    ip->check       = 0;
+    ip->saddr       = saddr;
+    ip->daddr       = daddr;
+    ip->check       = net_checksum(ip, IP_HLEN, 0);
+    if (net_is_local(daddr)) {
+        __net_loopback(buf);
+        return 0;
+    }
+    netdev_t *dev = net_device;
+    if (!dev) {
+        net_buf_free(buf);
+        return -ENETUNREACH;
+    }
+    if (__net_is_broadcast(dev, daddr)) {
+        return __eth_send(dev, buf, eth_broadcast, ETH_P_IP);
+    }
+    // The neighbours are reached directly, everything else through the gateway.
+    return __arp_output(dev, buf, ((daddr ^ dev->addr) & dev->netmask) ? dev->gateway : daddr);
+}
+
+/// @brief Handles an IPv4 packet, fragments are dropped.
+/// @param buf the buffer, whose data starts at the IPv4 header.
+static void __ip_receive(net_buf_t *buf)
+{
+    iphdr_t *ip = (iphdr_t *)buf->data;
+    if ((buf->len < IP_HLEN) || ((ip->version_ihl >> 4U) != 4)) {
+        net_buf_free(buf);
+        return;
+    }
+    size_t hlen    = (ip->version_ihl & 0xF) * 4U;
+    size_t tot_len = ntohs(ip->tot_len);
+    if ((hlen < IP_HLEN) || (tot_len < hlen) || (tot_len > buf->len) || net_checksum(ip, hlen, 0) ||
+        (ntohs(ip->frag_off) & IP_FRAGMENT)) {
+        net_buf_free(buf);
+        return;
+    }
+    // We do not forward packets.
+    if (!net_is_local(ip->daddr) && !__net_is_broadcast(buf->dev, ip->daddr)) {
+        net_buf_free(buf);
+        return;
+    }
+    // Drop the padding of short frames, then the header.
+    buf->len   = tot_len;
+    buf->saddr = ip->saddr;
+    net_buf_pull(buf, hlen);
+    switch (ip->protocol) {
+    case IPPROTO_ICMP:
+        __icmp_receive(buf, ip);
+        break;
+    case IPPROTO_UDP:
+        udp_receive(buf, ip);
+        break;
+    case IPPROTO_TCP:
+        tcp_receive(buf, ip);
+        break;
+    default:
+        net_buf_free(buf);
+        break;
+    }
+}
+
+// == DEVICES =================================================================
+
+void net_receive(netdev_t *dev, net_buf_t *buf)
+{
+    ethhdr_t *eth = net_buf_pull(buf, ETH_HLEN);
+    if (!eth || (memcmp(eth->dest, dev->mac, ETH_ALEN) && memcmp(eth->dest, eth_broadcast, ETH_ALEN))) {
+        net_buf_free(buf);
+        return;
+    }
+    buf->dev = dev;
+    if (eth->proto == htons(ETH_P_IP)) {
+        __ip_receive(buf);
+    } else if (eth->proto == htons(ETH_P_ARP)) {
+        __arp_receive(dev, buf);
+    } else {
+        net_buf_free(buf);
+    }
+}
+
+int net_register_device(netdev_t *dev)
+{
+    if (net_device) {
+        return -EBUSY;
+    }
+    strcpy(dev->name, "eth0");
+    // The configuration of the user networking of QEMU.
+    dev->addr    = htonl(0x0A00020F);
+    dev->netmask = htonl(0xFFFFFF00);
+    dev->gateway = htonl(0x0A000202);
+    net_device   = dev;
+    pr_notice(
+        "%s: %02x:%02x:%02x:%02x:%02x:%02x, 10.0.2.15/24 via 10.0.2.2\n", dev->name, dev->mac[0], dev->mac[1],
+        dev->mac[2], dev->mac[3], dev->mac[4], dev->mac[5]);
+    return 0;
+}
+
+int net_initialize(void)
+{
+    for (unsigned i = 0; i < ARP_CACHE_SIZE; ++i) {
+        memset(&arp_cache[i], 0, sizeof(arp_entry_t));
+        list_head_init(&arp_cache[i].pending);
+    }
+    list_head_init(&net_loopback_queue);
+    tasklet_init(&net_loopback_tasklet, __net_loopback_run, 0);
+    return 0;
+}
+
+device_initcall(net_initialize, NULL);
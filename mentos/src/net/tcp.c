@@ -0,0 +1,797 @@
+/// @file tcp.c
+/// @brief The Transmission Control Protocol.
+/// @details
+/// The connections keep what they send inside a ring, and send it again from
+/// the oldest byte not acknowledged once the retransmission timeout expires;
+/// the timeout is fixed, and doubled on each retransmission. The segments are
+/// accepted in order only, the ones coming too early are acknowledged for
+/// what we have, and dropped. There is no congestion control, and no
+/// TIME_WAIT: a connection is over as soon as both FINs are acknowledged.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[TCP   ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "errno.h"
+#include "hardware/timer.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "net/inet.h"
+#include "string.h"
+#include "sys/uio.h"
+
+#define TCP_FIN 0x01 ///< No more data from the sender.
+#define TCP_SYN 0x02 ///< Synchronize the sequence numbers.
+#define TCP_RST 0x04 ///< Reset the connection.
+#define TCP_PSH 0x08 ///< Push the data to the receiver.
+#define TCP_ACK 0x10 ///< The acknowledgment number is valid.
+
+#define TCP_HLEN         20                             ///< The size of the TCP header without options.
+#define TCP_MSS          (ETH_MTU - IP_HLEN - TCP_HLEN) ///< The largest segment we accept.
+#define TCP_MSS_DEFAULT  536                            ///< The largest segment of a peer which does not tell.
+#define TCP_RCVBUF       32768                          ///< The bytes a connection queues, at most.
+#define TCP_MAX_BUFS     64                             ///< The segments a connection queues, at most.
+#define TCP_RTO_INIT     TICKS_PER_SECOND               ///< The first retransmission timeout.
+#define TCP_RTO_MAX      (60 * TICKS_PER_SECOND)        ///< The longest retransmission timeout.
+#define TCP_MAX_RETRIES  8                              ///< The retransmissions before giving up.
+#define TCP_FIN_TIMEOUT  (60 * TICKS_PER_SECOND)        ///< How long an orphan waits for the FIN of the peer.
+#define TCP_TIMER_PERIOD (TICKS_PER_SECOND / 5)         ///< How often the timeouts are checked.
+
+/// @brief Checks if a sequence number comes before another one.
+#define SEQ_LT(a, b) ((int32_t)((a) - (b)) < 0)
+/// @brief Checks if a sequence number comes after another one.
+#define SEQ_GT(a, b) ((int32_t)((a) - (b)) > 0)
+
+/// @brief A TCP header, the multi-byte fields are in network byte order.
+typedef struct tcphdr {
+    uint16_t source;  ///< The source port.
+    uint16_t dest;    ///< The destination port.
+    uint32_t seq;     ///< The sequence number of the first byte.
+    uint32_t ack_seq; ///< The next sequence number expected from the other side.
+    uint8_t doff;     ///< The length of the header in words, in the upper four bits.
+    uint8_t flags;    ///< The flags (TCP_*).
+    uint16_t window;  ///< The room left for receiving.
+    uint16_t check;   ///< The checksum, with the pseudo-header.
+    uint16_t urg_ptr; ///< The urgent pointer, not used.
+} __attribute__((packed)) tcphdr_t;
+
+/// If the timer checking the timeouts is running.
+static bool_t tcp_timer_running = false;
+/// Makes each initial sequence number different from the previous one.
+static uint32_t tcp_iss_seed;
+
+static void __tcp_timer_start(void);
+
+// == OUTPUT ==================================================================
+
+/// @brief Returns a new initial sequence number.
+/// @return the sequence number.
+static inline uint32_t __tcp_iss(void)
+{
+    tcp_iss_seed += 0x10000;
+    return (timer_get_ticks() * 64000U) + tcp_iss_seed;
+}
+
+/// @brief Returns the room left for receiving.
+/// @param sock the socket.
+/// @return the window, in bytes.
+static inline uint32_t __tcp_window(inet_sock_t *sock)
+{
+    if ((sock->rx_bytes >= TCP_RCVBUF) || (sock->rx_bufs >= TCP_MAX_BUFS)) {
+        return 0;
+    }
+    // Each segment takes a buffer of its own, however short it is.
+    return min(TCP_RCVBUF - sock->rx_bytes, (TCP_MAX_BUFS - sock->rx_bufs) * TCP_MSS);
+}
+
+/// @brief Places the TCP header in front of the data of a buffer, and sends it.
+/// @param buf the buffer, which is consumed.
+/// @param saddr the source address.
+/// @param daddr the destination address.
+/// @param sport the source port.
+/// @param dport the destination port.
+/// @param seq the sequence number.
+/// @param ack the acknowledgment number.
+/// @param flags the flags, a SYN carries our MSS.
+/// @param window the window.
+static void __tcp_transmit(net_buf_t *buf, uint32_t saddr, uint32_t daddr, uint16_t sport, uint16_t dport,
+                           uint32_t seq, uint32_t ack, uint8_t flags, uint16_t window)
+{
+    size_t hlen = TCP_HLEN;
+    if (flags & TCP_SYN) {
+        uint8_t *option = net_buf_push(buf, 4);
+        option[0]       = 2;
+        option[1]       = 4;
+        option[2]       = TCP_MSS >> 8;
+        option[3]       = TCP_MSS & 0xFF;
+        hlen += 4;
+    }
+    tcphdr_t *tcp = net_buf_push(buf, TCP_HLEN);
+    tcp->source   = sport;
+    tcp->dest     = dport;
+    tcp->seq      = htonl(seq);
+    tcp->ack_seq  = (flags & TCP_ACK) ? htonl(ack) : 0;
+    tcp->doff     = (hlen / 4) << 4;
+    tcp->flags    = flags;
+    tcp->window   = htons(window);
+    tcp->check    = 0;
+    tcp->urg_ptr  = 0;
+    tcp->check    = net_checksum(tcp, buf->len, net_pseudo_sum(saddr, daddr, IPPROTO_TCP, buf->len));
+    ip_send(buf, saddr, daddr, IPPROTO_TCP);
+}
+
+/// @brief Sends a segment of a connection, with the data of the ring.
+/// @param sock the socket.
+/// @param seq the sequence number of the segment.
+/// @param len the size of the data, which starts at `seq` inside the ring.
+/// @param flags the flags, the acknowledgment is added once we know the peer.
+static void __tcp_send(inet_sock_t *sock, uint32_t seq, size_t len, uint8_t flags)
+{
+    net_buf_t *buf = net_buf_alloc();
+    if (!buf) {
+        // As if it was lost, it is sent again.
+        return;
+    }
+    if (len) {
+        size_t start = (sock->snd_head + (seq - sock->snd_una)) % TCP_SNDBUF;
+        size_t first = min(len, TCP_SNDBUF - start);
+        memcpy(buf->data, sock->snd_buf + start, first);
+        memcpy(buf->data + first, sock->snd_buf, len - first);
+        buf->len = len;
+    }
+    if (sock->state != TCP_SYN_SENT) {
+        flags |= TCP_ACK;
+    }
+    uint32_t window = __tcp_window(sock);
+    sock->rcv_adv   = sock->rcv_nxt + window;
+    __tcp_transmit(buf, sock->laddr, sock->raddr, sock->lport, sock->rport, seq, sock->rcv_nxt, flags, window);
+}
+
+/// @brief Acknowledges what we have received, and tells the window.
+/// @param sock the socket.
+static inline void __tcp_send_ack(inet_sock_t *sock)
+{
+    __tcp_send(sock, sock->snd_nxt, 0, 0);
+}
+
+/// @brief Answers a segment which does not belong to any connection with a reset.
+/// @param ip the IPv4 header of the segment.
+/// @param tcp the TCP header of the segment.
+/// @param seglen the sequence numbers taken by the segment.
+static void __tcp_send_reset(iphdr_t *ip, tcphdr_t *tcp, size_t seglen)
+{
+    net_buf_t *buf = net_buf_alloc();
+    if (!buf) {
+        return;
+    }
+    if (tcp->flags & TCP_ACK) {
+        __tcp_transmit(buf, ip->daddr, ip->saddr, tcp->dest, tcp->source, ntohl(tcp->ack_seq), 0, TCP_RST, 0);
+    } else {
+        __tcp_transmit(buf, ip->daddr, ip->saddr, tcp->dest, tcp->source, 0, ntohl(tcp->seq) + seglen,
+                       TCP_RST | TCP_ACK, 0);
+    }
+}
+
+/// @brief Starts the retransmission timeout, if it is not running.
+/// @param sock the socket.
+static inline void __tcp_arm(inet_sock_t *sock)
+{
+    if (!sock->rto_expires) {
+        sock->rto_expires = timer_get_ticks() + sock->rto;
+        __tcp_timer_start();
+    }
+}
+
+/// @brief Checks if a connection can send data.
+/// @param sock the socket.
+/// @return true in the states which follow an acknowledged SYN, and come before an acknowledged FIN.
+static inline bool_t __tcp_synchronized(inet_sock_t *sock)
+{
+    return (sock->state == TCP_ESTABLISHED) || (sock->state == TCP_CLOSE_WAIT) || (sock->state == TCP_FIN_WAIT_1) ||
+           (sock->state == TCP_CLOSING) || (sock->state == TCP_LAST_ACK);
+}
+
+/// @brief Sends what the window of the peer allows, and then the FIN, if any.
+/// @param sock the socket.
+static void __tcp_output(inet_sock_t *sock)
+{
+    if (!__tcp_synchronized(sock)) {
+        return;
+    }
+    while (1) {
+        // The offset is recomputed each time, the ring moves with the acknowledgments.
+        size_t offset = sock->snd_nxt - sock->snd_una;
+        if (offset >= sock->snd_len) {
+            break;
+        }
+        size_t window = (sock->snd_wnd > offset) ? (sock->snd_wnd - offset) : 0;
+        size_t len    = min(min(sock->snd_len - offset, (size_t)sock->mss), window);
+        if (!len) {
+            // The peer has no room, the timeout probes it.
+            __tcp_arm(sock);
+            return;
+        }
+        __tcp_send(sock, sock->snd_nxt, len, TCP_PSH);
+        sock->snd_nxt += len;
+        __tcp_arm(sock);
+    }
+    if (sock->fin_pending && (sock->snd_nxt == sock->snd_una + sock->snd_len)) {
+        __tcp_send(sock, sock->snd_nxt, 0, TCP_FIN);
+        ++sock->snd_nxt;
+        __tcp_arm(sock);
+    }
+    if (SEQ_GT(sock->snd_nxt, sock->snd_max)) {
+        sock->snd_max = sock->snd_nxt;
+    }
+}
+
+// == STATE ===================================================================
+
+/// @brief Ends a connection: the socket is freed if nobody holds it anymore,
+/// otherwise it keeps what has been received.
+/// @param sock the socket, which must not be used afterwards.
+static void __tcp_done(inet_sock_t *sock)
+{
+    sock->state       = TCP_CLOSED;
+    sock->rto_expires = 0;
+    list_head_remove(&sock->list);
+    wake_up(&sock->read_wait);
+    wake_up(&sock->write_wait);
+    if (sock->parent) {
+        --sock->parent->backlog_len;
+        sock->parent = NULL;
+        inet_sock_free(sock);
+    } else if (!sock->file) {
+        inet_sock_free(sock);
+    }
+}
+
+/// @brief Aborts a connection.
+/// @param sock the socket, which must not be used afterwards.
+/// @param error the error reported to the user.
+/// @param reset if the peer has to be told with a reset.
+static void __tcp_abort(inet_sock_t *sock, int error, bool_t reset)
+{
+    if (reset && (sock->state != TCP_SYN_SENT)) {
+        __tcp_send(sock, sock->snd_nxt, 0, TCP_RST);
+    }
+    sock->error = error;
+    __tcp_done(sock);
+}
+
+/// @brief Moves to the state which follows the acknowledgment of our FIN.
+/// @param sock the socket, which must not be used afterwards if it returns true.
+/// @return true if the connection is over.
+static bool_t __tcp_fin_acked(inet_sock_t *sock)
+{
+    if (sock->state == TCP_FIN_WAIT_1) {
+        sock->state = TCP_FIN_WAIT_2;
+        // Nobody will read what the peer sends, do not wait for it forever.
+        if (!sock->file) {
+            sock->rto_expires = timer_get_ticks() + TCP_FIN_TIMEOUT;
+            __tcp_timer_start();
+        }
+        return false;
+    }
+    if ((sock->state == TCP_CLOSING) || (sock->state == TCP_LAST_ACK)) {
+        __tcp_done(sock);
+        return true;
+    }
+    return false;
+}
+
+// == TIMER ===================================================================
+
+/// @brief Sends again what has not been acknowledged.
+/// @param sock the socket, which must not be used afterwards.
+static void __tcp_retransmit(inet_sock_t *sock)
+{
+    if (sock->state == TCP_FIN_WAIT_2) {
+        __tcp_done(sock);
+        return;
+    }
+    if (++sock->retries > TCP_MAX_RETRIES) {
+        pr_debug("Connection to port %u timed out.\n", ntohs(sock->rport));
+        __tcp_abort(sock, ETIMEDOUT, true);
+        return;
+    }
+    sock->rto         = min(sock->rto * 2, TCP_RTO_MAX);
+    sock->rto_expires = timer_get_ticks() + sock->rto;
+    if ((sock->state == TCP_SYN_SENT) || (sock->state == TCP_SYN_RECEIVED)) {
+        __tcp_send(sock, sock->iss, 0, TCP_SYN);
+        return;
+    }
+    // Go back to the oldest byte not acknowledged.
+    sock->snd_nxt = sock->snd_una;
+    if (!sock->snd_wnd && sock->snd_len) {
+        // A byte past the window, whose acknowledgment tells when it opens.
+        __tcp_send(sock, sock->snd_una, 1, TCP_PSH);
+        sock->snd_nxt = sock->snd_una + 1;
+        return;
+    }
+    sock->rto_expires = 0;
+    __tcp_output(sock);
+    if (!sock->rto_expires) {
+        sock->rto_expires = timer_get_ticks() + sock->rto;
+    }
+}
+
+/// @brief Checks the timeouts of the connections.
+/// @param data not used.
+static void __tcp_timer(unsigned long data)
+{
+    uint8_t flags     = irq_disable();
+    unsigned long now = timer_get_ticks();
+    tcp_timer_running = false;
+    list_for_each_safe_decl(it, store, inet_socks(IPPROTO_TCP))
+    {
+        inet_sock_t *sock = list_entry(it, inet_sock_t, list);
+        if (sock->rto_expires && ((long)(now - sock->rto_expires) >= 0)) {
+            __tcp_retransmit(sock);
+        }
+    }
+    // The timer goes on while there are connections, a new one each time.
+    if (!list_head_empty(inet_socks(IPPROTO_TCP))) {
+        __tcp_timer_start();
+    }
+    irq_enable(flags);
+}
+
+/// @brief Starts the timer checking the timeouts, if it is not running.
+static void __tcp_timer_start(void)
+{
+    if (tcp_timer_running) {
+        return;
+    }
+    struct timer_list *timer = kmalloc(sizeof(struct timer_list));
+    if (!timer) {
+        pr_err("Failed to allocate the TCP timer.\n");
+        return;
+    }
+    memset(timer, 0, sizeof(struct timer_list));
+    init_timer(timer);
+    timer->expires  = timer_get_ticks() + TCP_TIMER_PERIOD;
+    timer->function = &__tcp_timer;
+    timer->data     = 0;
+    add_timer(timer);
+    tcp_timer_running = true;
+}
+
+// == INPUT ===================================================================
+
+/// @brief Reads the MSS option of a SYN.
+/// @param tcp the TCP header.
+/// @param hlen the size of the header, options included.
+/// @return the MSS of the peer, TCP_MSS_DEFAULT if it does not tell.
+static uint16_t __tcp_parse_mss(tcphdr_t *tcp, size_t hlen)
+{
+    uint8_t *option = (uint8_t *)tcp + TCP_HLEN;
+    uint8_t *end    = (uint8_t *)tcp + hlen;
+    while (option < end) {
+        if (option[0] == 0) {
+            break;
+        }
+        if (option[0] == 1) {
+            ++option;
+            continue;
+        }
+        if ((option + 1 >= end) || (option[1] < 2) || (option + option[1] > end)) {
+            break;
+        }
+        if ((option[0] == 2) && (option[1] == 4)) {
+            uint16_t mss = (option[2] << 8) | option[3];
+            return mss ? min(mss, TCP_MSS) : TCP_MSS_DEFAULT;
+        }
+        option += option[1];
+    }
+    return TCP_MSS_DEFAULT;
+}
+
+/// @brief Handles a SYN sent to a listening socket, the connection waits for
+/// the acknowledgment of our SYN before it can be accepted.
+/// @param sock the listening socket.
+/// @param ip the IPv4 header.
+/// @param tcp the TCP header.
+/// @param hlen the size of the TCP header.
+static void __tcp_listen_input(inet_sock_t *sock, iphdr_t *ip, tcphdr_t *tcp, size_t hlen)
+{
+    if (sock->backlog_len >= sock->max_backlog) {
+        // The peer tries again.
+        return;
+    }
+    inet_sock_t *child = inet_sock_alloc(SOCK_STREAM, IPPROTO_TCP);
+    if (!child) {
+        return;
+    }
+    child->snd_buf = kmalloc(TCP_SNDBUF);
+    if (!child->snd_buf) {
+        inet_sock_free(child);
+        return;
+    }
+    child->laddr   = ip->daddr;
+    child->lport   = tcp->dest;
+    child->raddr   = ip->saddr;
+    child->rport   = tcp->source;
+    child->parent  = sock;
+    child->rcv_nxt = ntohl(tcp->seq) + 1;
+    child->mss     = __tcp_parse_mss(tcp, hlen);
+    child->snd_wnd = ntohs(tcp->window);
+    child->iss     = __tcp_iss();
+    child->snd_una = child->iss;
+    child->snd_nxt = child->iss + 1;
+    child->snd_max = child->snd_nxt;
+    child->rto     = TCP_RTO_INIT;
+    child->state   = TCP_SYN_RECEIVED;
+    ++sock->backlog_len;
+    inet_hash(child);
+    __tcp_send(child, child->iss, 0, TCP_SYN);
+    __tcp_arm(child);
+}
+
+/// @brief Handles a segment answering our SYN.
+/// @param sock the socket.
+/// @param ip the IPv4 header.
+/// @param tcp the TCP header.
+/// @param hlen the size of the TCP header.
+static void __tcp_syn_sent_input(inet_sock_t *sock, iphdr_t *ip, tcphdr_t *tcp, size_t hlen)
+{
+    bool_t acked = false;
+    if (tcp->flags & TCP_ACK) {
+        if (ntohl(tcp->ack_seq) != sock->snd_nxt) {
+            if (!(tcp->flags & TCP_RST)) {
+                __tcp_send_reset(ip, tcp, 0);
+            }
+            return;
+        }
+        acked = true;
+    }
+    if (tcp->flags & TCP_RST) {
+        if (acked) {
+            __tcp_abort(sock, ECONNREFUSED, false);
+        }
+        return;
+    }
+    // We do not support simultaneous opens, the peer has to answer our SYN.
+    if (!(tcp->flags & TCP_SYN) || !acked) {
+        return;
+    }
+    sock->rcv_nxt     = ntohl(tcp->seq) + 1;
+    sock->mss         = __tcp_parse_mss(tcp, hlen);
+    sock->snd_una     = sock->snd_nxt;
+    sock->snd_wnd     = ntohs(tcp->window);
+    sock->rto         = TCP_RTO_INIT;
+    sock->rto_expires = 0;
+    sock->retries     = 0;
+    sock->state       = TCP_ESTABLISHED;
+    __tcp_send_ack(sock);
+    wake_up(&sock->write_wait);
+}
+
+/// @brief Handles the acknowledgment of a segment.
+/// @param sock the socket.
+/// @param tcp the TCP header.
+/// @return false if the segment must be dropped, or the connection is over
+/// (and the socket must not be used anymore).
+static bool_t __tcp_ack_input(inet_sock_t *sock, tcphdr_t *tcp)
+{
+    uint32_t ack = ntohl(tcp->ack_seq);
+    if (sock->state == TCP_SYN_RECEIVED) {
+        if (ack != sock->snd_nxt) {
+            return false;
+        }
+        // The connection can be accepted.
+        sock->snd_una     = ack;
+        sock->rto_expires = 0;
+        sock->retries     = 0;
+        sock->state       = TCP_ESTABLISHED;
+        list_head_insert_before(&sock->accept_list, &sock->parent->accept_queue);
+        wake_up_nr(&sock->parent->read_wait, 1);
+    }
+    if (SEQ_GT(ack, sock->snd_max)) {
+        // It acknowledges something we did not send.
+        __tcp_send_ack(sock);
+        return false;
+    }
+    if (!SEQ_LT(ack, sock->snd_una)) {
+        sock->snd_wnd = ntohs(tcp->window);
+        // A peer which answers the probes of its closed window is alive.
+        if (!sock->snd_wnd) {
+            sock->retries = 0;
+        }
+    }
+    if (SEQ_GT(ack, sock->snd_una)) {
+        size_t acked = ack - sock->snd_una;
+        size_t data  = min(acked, sock->snd_len);
+        // The ring loses what has been acknowledged.
+        sock->snd_head = (sock->snd_head + data) % TCP_SNDBUF;
+        sock->snd_len -= data;
+        sock->snd_una = ack;
+        if (SEQ_LT(sock->snd_nxt, ack)) {
+            sock->snd_nxt = ack;
+        }
+        sock->retries     = 0;
+        sock->rto         = TCP_RTO_INIT;
+        sock->rto_expires = (sock->snd_una == sock->snd_max) ? 0 : (timer_get_ticks() + sock->rto);
+        wake_up(&sock->write_wait);
+        // Past the data, there is only our FIN.
+        if ((acked > data) && __tcp_fin_acked(sock)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Handles a segment of a connection.
+/// @param sock the socket.
+/// @param buf the buffer, whose data starts at the payload.
+/// @param tcp the TCP header.
+/// @return true if the buffer has been queued on the socket.
+static bool_t __tcp_input(inet_sock_t *sock, net_buf_t *buf, tcphdr_t *tcp)
+{
+    uint32_t seq  = ntohl(tcp->seq);
+    uint8_t flags = tcp->flags;
+    // The SYN of a SYN|ACK sent again.
+    if ((flags & TCP_SYN) && SEQ_LT(seq, sock->rcv_nxt)) {
+        flags &= ~TCP_SYN;
+        ++seq;
+    }
+    if (SEQ_LT(seq, sock->rcv_nxt)) {
+        size_t skip = sock->rcv_nxt - seq;
+        if ((skip > buf->len) || ((skip == buf->len) && !(flags & TCP_FIN))) {
+            // A duplicate, the peer missed our acknowledgment.
+            if (!(flags & TCP_RST)) {
+                __tcp_send_ack(sock);
+            }
+            return false;
+        }
+        net_buf_pull(buf, skip);
+        seq = sock->rcv_nxt;
+    }
+    if (seq != sock->rcv_nxt) {
+        // Too early, tell the peer what we are waiting for.
+        if (!(flags & TCP_RST)) {
+            __tcp_send_ack(sock);
+        }
+        return false;
+    }
+    if (flags & TCP_RST) {
+        __tcp_abort(sock, ECONNRESET, false);
+        return false;
+    }
+    if (flags & TCP_SYN) {
+        __tcp_abort(sock, ECONNRESET, true);
+        return false;
+    }
+    if (!(flags & TCP_ACK) || !__tcp_ack_input(sock, tcp)) {
+        return false;
+    }
+    // Keep what fits inside the window, the FIN comes after the data we drop.
+    bool_t answer   = buf->len || (flags & TCP_FIN);
+    uint32_t window = __tcp_window(sock);
+    if (buf->len > window) {
+        buf->len = window;
+        flags &= ~TCP_FIN;
+    }
+    bool_t queued = false;
+    bool_t open   = (sock->state == TCP_ESTABLISHED) || (sock->state == TCP_FIN_WAIT_1) ||
+                  (sock->state == TCP_FIN_WAIT_2);
+    if (buf->len && open) {
+        sock->rcv_nxt += buf->len;
+        if (!sock->shut_rd) {
+            list_head_insert_before(&buf->list, &sock->rx_queue);
+            sock->rx_bytes += buf->len;
+            ++sock->rx_bufs;
+            wake_up_nr(&sock->read_wait, 1);
+            queued = true;
+        }
+    }
+    if ((flags & TCP_FIN) && !sock->fin_received) {
+        ++sock->rcv_nxt;
+        sock->fin_received = true;
+        wake_up(&sock->read_wait);
+        if (sock->state == TCP_ESTABLISHED) {
+            sock->state = TCP_CLOSE_WAIT;
+        } else if (sock->state == TCP_FIN_WAIT_1) {
+            sock->state = TCP_CLOSING;
+        } else if (sock->state == TCP_FIN_WAIT_2) {
+            __tcp_send_ack(sock);
+            __tcp_done(sock);
+            return queued;
+        }
+    }
+    if (answer) {
+        __tcp_send_ack(sock);
+    }
+    // The acknowledgment might have opened the window.
+    __tcp_output(sock);
+    return queued;
+}
+
+void tcp_receive(net_buf_t *buf, iphdr_t *ip)
+{
+    tcphdr_t *tcp = (tcphdr_t *)buf->data;
+    size_t hlen   = (buf->len >= TCP_HLEN) ? ((tcp->doff >> 4) * 4U) : 0;
+    if ((hlen < TCP_HLEN) || (hlen > buf->len) ||
+        net_checksum(tcp, buf->len, net_pseudo_sum(ip->saddr, ip->daddr, IPPROTO_TCP, buf->len))) {
+        net_buf_free(buf);
+        return;
+    }
+    net_buf_pull(buf, hlen);
+    inet_sock_t *sock = inet_lookup(IPPROTO_TCP, ip->daddr, tcp->dest, ip->saddr, tcp->source);
+    if (!sock || (sock->state == TCP_CLOSED)) {
+        if (!(tcp->flags & TCP_RST)) {
+            __tcp_send_reset(ip, tcp, buf->len + !!(tcp->flags & TCP_SYN) + !!(tcp->flags & TCP_FIN));
+        }
+        net_buf_free(buf);
+        return;
+    }
+    bool_t queued = false;
+    if (sock->state == TCP_LISTEN) {
+        if (tcp->flags & TCP_RST) {
+            // Nothing to reset.
+        } else if (tcp->flags & TCP_ACK) {
+            __tcp_send_reset(ip, tcp, 0);
+        } else if (tcp->flags & TCP_SYN) {
+            __tcp_listen_input(sock, ip, tcp, hlen);
+        }
+    } else if (sock->state == TCP_SYN_SENT) {
+        __tcp_syn_sent_input(sock, ip, tcp, hlen);
+    } else {
+        queued = __tcp_input(sock, buf, tcp);
+    }
+    if (!queued) {
+        net_buf_free(buf);
+    }
+}
+
+// == SOCKETS =================================================================
+
+int tcp_connect(inet_sock_t *sock)
+{
+    if (!sock->snd_buf) {
+        sock->snd_buf = kmalloc(TCP_SNDBUF);
+        if (!sock->snd_buf) {
+            return -ENOMEM;
+        }
+    }
+    sock->iss     = __tcp_iss();
+    sock->snd_una = sock->iss;
+    sock->snd_nxt = sock->iss + 1;
+    sock->snd_max = sock->snd_nxt;
+    sock->mss     = TCP_MSS_DEFAULT;
+    sock->rto     = TCP_RTO_INIT;
+    sock->retries = 0;
+    sock->state   = TCP_SYN_SENT;
+    __tcp_send(sock, sock->iss, 0, TCP_SYN);
+    __tcp_arm(sock);
+    if (inet_nonblock(sock, 0)) {
+        return -EINPROGRESS;
+    }
+    while (sock->state == TCP_SYN_SENT) {
+        if (interruptible_sleep_on(&sock->write_wait) < 0) {
+            return -EINTR;
+        }
+    }
+    if (sock->state == TCP_CLOSED) {
+        int error   = sock->error ? sock->error : ECONNREFUSED;
+        sock->error = 0;
+        return -error;
+    }
+    return 0;
+}
+
+ssize_t tcp_sendmsg(inet_sock_t *sock, const struct msghdr *msg, int flags)
+{
+    if ((sock->state == TCP_LISTEN) || (sock->state == TCP_SYN_SENT) ||
+        ((sock->state == TCP_CLOSED) && !sock->raddr)) {
+        return -ENOTCONN;
+    }
+    size_t copied = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; ++i) {
+        const uint8_t *data = msg->msg_iov[i].iov_base;
+        size_t done         = 0;
+        while (done < msg->msg_iov[i].iov_len) {
+            // The connection might have gone while we were sleeping.
+            if (sock->error) {
+                if (copied) {
+                    return copied;
+                }
+                int error   = sock->error;
+                sock->error = 0;
+                return -error;
+            }
+            if (sock->shut_wr || ((sock->state != TCP_ESTABLISHED) && (sock->state != TCP_CLOSE_WAIT))) {
+                return copied ? (ssize_t)copied : -EPIPE;
+            }
+            size_t room = TCP_SNDBUF - sock->snd_len;
+            if (!room) {
+                if (inet_nonblock(sock, flags)) {
+                    return copied ? (ssize_t)copied : -EAGAIN;
+                }
+                if (interruptible_sleep_on(&sock->write_wait) < 0) {
+                    return copied ? (ssize_t)copied : -EINTR;
+                }
+                continue;
+            }
+            size_t len   = min(room, msg->msg_iov[i].iov_len - done);
+            size_t tail  = (sock->snd_head + sock->snd_len) % TCP_SNDBUF;
+            size_t first = min(len, TCP_SNDBUF - tail);
+            memcpy(sock->snd_buf + tail, data + done, first);
+            memcpy(sock->snd_buf, data + done + first, len - first);
+            sock->snd_len += len;
+            done += len;
+            copied += len;
+            __tcp_output(sock);
+        }
+    }
+    return copied;
+}
+
+void tcp_read_done(inet_sock_t *sock)
+{
+    if ((sock->state != TCP_ESTABLISHED) && (sock->state != TCP_FIN_WAIT_1) && (sock->state != TCP_FIN_WAIT_2)) {
+        return;
+    }
+    // The peer thinks there is less than a segment left, and there is more now.
+    if (((sock->rcv_adv - sock->rcv_nxt) < TCP_MSS) && (__tcp_window(sock) >= TCP_MSS)) {
+        __tcp_send_ack(sock);
+    }
+}
+
+void tcp_shutdown_write(inet_sock_t *sock)
+{
+    if (sock->fin_pending) {
+        return;
+    }
+    if (sock->state == TCP_ESTABLISHED) {
+        sock->state = TCP_FIN_WAIT_1;
+    } else if (sock->state == TCP_CLOSE_WAIT) {
+        sock->state = TCP_LAST_ACK;
+    } else {
+        return;
+    }
+    sock->fin_pending = true;
+    __tcp_output(sock);
+}
+
+void tcp_close(inet_sock_t *sock)
+{
+    switch (sock->state) {
+    case TCP_LISTEN:
+        // The connections nobody accepted are reset.
+        list_for_each_safe_decl(it, store, inet_socks(IPPROTO_TCP))
+        {
+            inet_sock_t *child = list_entry(it, inet_sock_t, list);
+            if (child->parent == sock) {
+                child->parent = NULL;
+                __tcp_abort(child, ECONNABORTED, true);
+            }
+        }
+        inet_sock_free(sock);
+        return;
+    case TCP_CLOSED:
+    case TCP_SYN_SENT:
+        inet_sock_free(sock);
+        return;
+    default:
+        break;
+    }
+    sock->shut_wr = true;
+    // Data the user will never read means the connection did not end well.
+    if (!list_head_empty(&sock->rx_queue) && (sock->state == TCP_ESTABLISHED || sock->state == TCP_CLOSE_WAIT)) {
+        __tcp_abort(sock, ECONNRESET, true);
+        return;
+    }
+    inet_shutdown(sock, SHUT_RD);
+    if ((sock->state == TCP_ESTABLISHED) || (sock->state == TCP_CLOSE_WAIT)) {
+        tcp_shutdown_write(sock);
+    } else if ((sock->state == TCP_FIN_WAIT_2) && !sock->rto_expires) {
+        sock->rto_expires = timer_get_ticks() + TCP_FIN_TIMEOUT;
+        __tcp_timer_start();
+    }
+}
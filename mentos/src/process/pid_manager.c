@@ -4,52 +4,39 @@
 /// See LICENSE.md for details.
 
 #include "process/pid_manager.h"
+#include "klib/ida.h"
 #include "process/scheduler.h"
 #include "stdint.h"
-#include "string.h"
-
-/// Defines the size of the bitmap that keeps track of used PIDs.
-#define BITMAP_SIZE (MAX_PROCESSES / 32)
 
 /// Bitmap for tracking used PIDs.
-static uint32_t pid_bitmap[BITMAP_SIZE] = {0};
+static uint32_t pid_bitmap[IDA_WORDS(MAX_PROCESSES)];
+
+/// Allocates the PIDs from the bitmap.
+static ida_t pid_ida;
 
 /// Keeps track of the last allocated PID.
 static pid_t last_pid = 1;
 
-void pid_manager_init(void) { memset(pid_bitmap, 0, sizeof(pid_bitmap)); }
+void pid_manager_init(void)
+{
+    ida_init(&pid_ida, pid_bitmap, MAX_PROCESSES);
+    // PID 0 belongs to the idle task.
+    ida_mark_used(&pid_ida, 0);
+}
 
-void pid_manager_mark_used(pid_t pid) { pid_bitmap[pid / 32] |= (1 << (pid % 32)); }
+void pid_manager_mark_used(pid_t pid) { ida_mark_used(&pid_ida, pid); }
 
-void pid_manager_mark_free(pid_t pid) { pid_bitmap[pid / 32] &= ~(1 << (pid % 32)); }
+void pid_manager_mark_free(pid_t pid) { ida_free(&pid_ida, pid); }
 
 pid_t pid_manager_get_free_pid(void)
 {
-    // Start searching from the next PID after the last allocated one.
-    for (size_t offset = 0; offset < BITMAP_SIZE * 32; offset++) {
-        // Calculate the current PID index with wrap-around.
-        pid_t current_pid = (last_pid + offset) % (BITMAP_SIZE * 32);
-
-        // Ensure PID 0 is skipped.
-        if (current_pid == 0) {
-            continue;
-        }
-
-        // Check the bitmap for availability.
-        size_t i = current_pid / 32; // Index in the bitmap array.
-        size_t j = current_pid % 32; // Bit position in the bitmap element.
-
-        if ((pid_bitmap[i] & (1 << j)) == 0) {
-            // Mark the PID as used.
-            pid_manager_mark_used(current_pid);
-
-            // Update the last allocated PID.
-            last_pid = current_pid + 1;
-
-            // Return the allocated PID.
-            return current_pid;
-        }
+    // Start searching from the next PID after the last allocated one, so
+    // that the PIDs of the processes which just exited are not reused at once.
+    pid_t pid = ida_alloc_cyclic(&pid_ida, last_pid);
+    if (pid >= 0) {
+        // Update the last allocated PID.
+        last_pid = pid + 1;
     }
-    // No free PID found.
-    return -1;
+    // Return the allocated PID, or -1 if no PID is free.
+    return pid;
 }
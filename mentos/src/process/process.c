@@ -10,27 +10,51 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "assert.h"
+#include "bits/clone.h"
+#include "descriptor_tables/gdt.h"
 #include "elf/elf.h"
 #include "errno.h"
 #include "fcntl.h"
 #include "fs/namei.h"
 #include "fs/vfs.h"
+#include "hardware/pmu.h"
 #include "hardware/timer.h"
+#include "hardware/tsc.h"
 #include "klib/stack_helper.h"
 #include "libgen.h"
+#include "math.h"
 #include "process/pid_manager.h"
 #include "process/prio.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "process/wait.h"
+#include "spawn.h"
 #include "string.h"
+#include "sys/auxv.h"
 #include "sys/stat.h"
 #include "system/panic.h"
+#include "system/vdso.h"
 #include "unistd.h"
 
 /// Cache for creating the task structs.
 static kmem_cache_t *task_struct_cache;
 
+/// The limits of the resources of the tasks created by the kernel, the others
+/// inherit those of their parent.
+static const struct rlimit default_rlimits[RLIM_NLIMITS] = {
+    [RLIMIT_CPU]        = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_FSIZE]      = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_DATA]       = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_STACK]      = { DEFAULT_STACK_SIZE, RLIM_INFINITY },
+    [RLIMIT_CORE]       = { 0, RLIM_INFINITY },
+    [RLIMIT_RSS]        = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_NPROC]      = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_NOFILE]     = { MAX_TASK_FD, MAX_TASK_FD },
+    [RLIMIT_MEMLOCK]    = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_AS]         = { RLIM_INFINITY, RLIM_INFINITY },
+    [RLIMIT_SIGPENDING] = { SIGQUEUE_MAX, SIGQUEUE_MAX },
+};
+
 /// @brief Counts the number of arguments.
 /// @param args the array of arguments, it must be NULL terminated.
 /// @return the number of arguments.
@@ -43,44 +67,142 @@ static inline int __count_args(char **args)
     return argc;
 }
 
-/// @brief Counts the bytes occupied by the arguments.
-/// @param args the array of arguments, it must be NULL terminated.
-/// @return the bytes occupied by the arguments.
-static inline int __count_args_bytes(char **args)
-{
-    // Count the number of arguments.
-    int argc  = __count_args(args);
-    // Count the number of characters.
-    int nchar = 0;
-    for (int i = 0; i < argc; i++) {
-        nchar += strlen(args[i]) + 1;
-    }
-    return nchar + ((argc + 1 /* The NULL terminator */) * sizeof(char *));
-}
-
-/// @brief Pushes the arguments on the stack.
-/// @param stack pointer to the stack location.
-/// @param args the list of arguments.
-/// @return the final position of the stack, where the list of pushed arguments is stored.
-static inline char **__push_args_on_stack(uintptr_t *stack, char *args[])
-{
-    // Count the number of arguments.
-    int argc = __count_args(args);
-    // Prepare args with space for the terminating NULL.
-    char *args_location[256];
-    for (int i = argc - 1; i >= 0; --i) {
-        for (int j = strlen(args[i]); j >= 0; --j) {
-            PUSH_VALUE_ON_STACK(*stack, args[i][j]);
+/// @brief The arguments and the environment of a new image, copied inside
+///        the kernel while the old image is discarded.
+typedef struct exec_args {
+    /// The arguments, NULL, the environment, NULL, and then the strings, in one block.
+    char **vector;
+    /// The number of arguments.
+    int argc;
+    /// The number of environment variables.
+    int envc;
+    /// The strings, the arguments first.
+    char *strings;
+    /// The bytes of the strings of the arguments.
+    size_t argv_size;
+    /// The bytes of all the strings.
+    size_t size;
+} exec_args_t;
+
+/// @brief Copies the strings of an array one after the other, and fills the
+///        array of pointers to the copies.
+/// @param args the array of strings, it must be NULL terminated.
+/// @param count the number of strings.
+/// @param vector where the pointers are written, followed by NULL.
+/// @param strings where the strings are written.
+/// @return the end of the copied strings.
+static inline char *__copy_args(char **args, int count, char **vector, char *strings)
+{
+    for (int i = 0; i < count; ++i) {
+        size_t len = strlen(args[i]) + 1;
+        memcpy(strings, args[i], len);
+        vector[i] = strings;
+        strings += len;
+    }
+    vector[count] = NULL;
+    return strings;
+}
+
+/// @brief Copies the arguments and the environment inside the kernel.
+/// @param args where the copy is described.
+/// @param argv the arguments, it must be NULL terminated.
+/// @param envp the environment, it must be NULL terminated.
+/// @return 0 on success, -E2BIG if they exceed ARG_MAX, -ENOMEM if they cannot be copied.
+static int __exec_args_copy(exec_args_t *args, char **argv, char **envp)
+{
+    args->argc      = __count_args(argv);
+    args->envc      = __count_args(envp);
+    args->argv_size = 0;
+    for (int i = 0; i < args->argc; ++i) {
+        args->argv_size += strlen(argv[i]) + 1;
+    }
+    args->size = args->argv_size;
+    for (int i = 0; i < args->envc; ++i) {
+        args->size += strlen(envp[i]) + 1;
+    }
+    size_t vector_size = (args->argc + args->envc + 2) * sizeof(char *);
+    if ((args->size + vector_size) > ARG_MAX) {
+        return -E2BIG;
+    }
+    args->vector = kmalloc(vector_size + args->size);
+    if (!args->vector) {
+        return -ENOMEM;
+    }
+    args->strings = (char *)args->vector + vector_size;
+    char *end     = __copy_args(argv, args->argc, args->vector, args->strings);
+    __copy_args(envp, args->envc, args->vector + args->argc + 1, end);
+    return 0;
+}
+
+/// @brief Fills bytes which the program can use as a seed.
+/// @details There is no entropy pool, the counter of the cycles is mixed with the
+/// time and with the previous values, which is enough to make them differ.
+/// @param buffer the buffer.
+/// @param size the number of bytes.
+static inline void __exec_random_bytes(uint8_t *buffer, size_t size)
+{
+    static uint32_t state = 0x9E3779B9U;
+    for (size_t i = 0; i < size; ++i) {
+        if ((i % sizeof(uint32_t)) == 0) {
+            state ^= (uint32_t)tsc_read() ^ (uint32_t)timer_get_ticks();
+            state = (state * 1103515245U) + 12345U;
+            state ^= state >> 16U;
         }
-        args_location[i] = (char *)(*stack);
+        buffer[i] = (uint8_t)(state >> ((i % sizeof(uint32_t)) * 8U));
     }
-    // Push terminating NULL.
-    PUSH_VALUE_ON_STACK(*stack, (char *)NULL);
-    // Push array of pointers to the arguments.
-    for (int i = argc - 1; i >= 0; --i) {
-        PUSH_VALUE_ON_STACK(*stack, args_location[i]);
+}
+
+/// @brief Places the arguments, the environment, and the auxiliary vector on
+///        the stack of the new image, whose page directory must be the current one.
+/// @details From the top of the stack down: the strings, 16 random bytes, the
+/// auxiliary vector, the environment, the arguments, and the three parameters
+/// of `__libc_start_main` (argc, argv, envp).
+/// @param task the task.
+/// @param args the arguments and the environment, copied inside the kernel.
+static void __exec_args_push(task_struct *task, exec_args_t *args)
+{
+    uint32_t sp = task->thread.regs.useresp;
+    // All the strings are moved at once, the pointers are moved with them.
+    sp -= args->size;
+    memcpy((void *)sp, args->strings, args->size);
+    uint32_t delta      = sp - (uint32_t)args->strings;
+    task->mm->arg_start = sp;
+    task->mm->arg_end = task->mm->env_start = sp + args->argv_size;
+    task->mm->env_end                       = sp + args->size;
+    // The seed of the program.
+    sp -= 16;
+    __exec_random_bytes((uint8_t *)sp, 16);
+    uint32_t random = sp;
+    sp &= ~0xFU;
+    // The auxiliary vector.
+    auxv_t auxv[] = {
+        {AT_PHDR, task->mm->phdr},
+        {AT_PHENT, sizeof(elf_program_header_t)},
+        {AT_PHNUM, task->mm->phnum},
+        {AT_PAGESZ, PAGE_SIZE},
+        {AT_ENTRY, task->thread.regs.eip},
+        {AT_UID, task->ruid},
+        {AT_EUID, task->uid},
+        {AT_GID, task->rgid},
+        {AT_EGID, task->gid},
+        {AT_RANDOM, random},
+        {AT_SYSINFO, VDSO_SYSCALL_ADDR},
+        {AT_SYSINFO_EHDR, VDSO_ADDR},
+        {AT_NULL, 0},
+    };
+    sp -= sizeof(auxv);
+    memcpy((void *)sp, auxv, sizeof(auxv));
+    // The arguments and the environment, with their terminators.
+    int count = args->argc + args->envc + 2;
+    sp -= count * sizeof(char *);
+    char **vector = (char **)sp;
+    for (int i = 0; i < count; ++i) {
+        vector[i] = args->vector[i] ? (args->vector[i] + delta) : NULL;
     }
-    return (char **)(*stack);
+    PUSH_VALUE_ON_STACK(sp, vector + args->argc + 1);
+    PUSH_VALUE_ON_STACK(sp, vector);
+    PUSH_VALUE_ON_STACK(sp, args->argc);
+    task->thread.regs.useresp = sp;
 }
 
 /// @brief Resets the process.
@@ -89,29 +211,25 @@ static inline char **__push_args_on_stack(uintptr_t *stack, char *args[])
 static int __reset_process(task_struct *task)
 {
     pr_debug("__reset_process(%p `%s`)\n", task, task->name);
+    // The stack is as large as RLIMIT_STACK allows, within reason.
+    size_t stack_size = min(task->rlim[RLIMIT_STACK].rlim_cur, (rlim_t)MAX_STACK_SIZE);
+    stack_size        = max(stack_size, (size_t)MIN_STACK_SIZE) & ~(PAGE_SIZE - 1);
     // Create a new stack segment.
-    task->mm = mm_create_blank(DEFAULT_STACK_SIZE);
+    task->mm          = mm_create_blank(stack_size);
     if (task->mm == NULL) {
         pr_err("Failed to initialize process mm structure.\n");
         return 0;
     }
 
-    // Save the current page directory.
-    page_directory_t *crtdir = paging_get_current_pgd();
-    // FIXME: Now to clear the stack a pgdir switch is made, it should be a kernel mmapping.
-    paging_switch_pgd(task->mm->pgd);
-
-    // Clean stack space.
-    memset((char *)task->mm->start_stack, 0, DEFAULT_STACK_SIZE);
+    // The pages of the stack are zero-filled the first time they are touched.
     // Set the base address of the stack.
-    task->thread.regs.ebp     = (uintptr_t)(task->mm->start_stack + DEFAULT_STACK_SIZE);
+    task->thread.regs.ebp     = (uintptr_t)(task->mm->start_stack + stack_size);
     // Set the top address of the stack.
     task->thread.regs.useresp = task->thread.regs.ebp;
     // Enable the interrupts.
     task->thread.regs.eflags  = task->thread.regs.eflags | EFLAG_IF;
-
-    // Restore previous pgdir
-    paging_switch_pgd(crtdir);
+    // The new image sets up its own thread-local storage.
+    task->thread.tls_base     = 0;
 
     return 1;
 }
@@ -163,12 +281,13 @@ start:
     if (bitmask_check(file->mask, S_ISGID)) {
         task->gid = file->gid;
     }
-    // FIXME: When threads will be implemented
-    // they should share the mm, so the destroy_process_image must be called
-    // only when all the threads are terminated. This can be accomplished by using
-    // an internal counter on the mm.
-    if (task->mm) {
-        mm_destroy(task->mm);
+    // The other threads are killed, they keep the old image until they exit.
+    zap_other_threads(task);
+    if (task->vfork_parent) {
+        // The segments belong to the parent, which can run again.
+        process_vfork_release(task);
+    } else if (task->mm) {
+        mm_put(task->mm);
     }
     // Recreate the memory of the process.
     if (!__reset_process(task)) {
@@ -223,12 +342,43 @@ close_and_return:
     return ret;
 }
 
+/// @brief Allocates new signal handlers, with the default action for every signal.
+/// @return the signal handlers, used by one task.
+static inline sighand_t *__sighand_alloc(void)
+{
+    sighand_t *sighand = kmalloc(sizeof(sighand_t));
+    assert(sighand && "Failed to allocate the signal handlers.");
+    memset(sighand, 0x00, sizeof(sighand_t));
+    spinlock_init(&sighand->siglock);
+    wait_queue_head_init(&sighand->signal_wait);
+    atomic_set(&sighand->count, 1);
+    for (int i = 0; i < NSIG; ++i) {
+        sighand->action[i].sa_handler = SIG_DFL;
+        sigemptyset(&sighand->action[i].sa_mask);
+        sighand->action[i].sa_flags = 0;
+    }
+    return sighand;
+}
+
+/// @brief Drops a reference to signal handlers, and frees them once no task uses them.
+/// @param sighand the signal handlers.
+static inline void __sighand_put(sighand_t *sighand)
+{
+    int count = atomic_read(&sighand->count) - 1;
+    atomic_set(&sighand->count, count);
+    if (count == 0) {
+        kfree(sighand);
+    }
+}
+
 /// @brief Allocates the memory for a task.
 /// @param source the source task we use for the copy.
 /// @param parent the parent process.
+/// @param clone_flags what the task shares with the source (CLONE_*, see clone()).
 /// @param name the name of the new process.
 /// @return pointer to the newly allocated task.
-static inline task_struct *__alloc_task(task_struct *source, task_struct *parent, const char *name)
+static inline task_struct *__alloc_task(
+    task_struct *source, task_struct *parent, unsigned long clone_flags, const char *name)
 {
     // Create a new task_struct.
     task_struct *proc = kmem_cache_alloc(task_struct_cache, GFP_KERNEL);
@@ -238,8 +388,14 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     proc->pid   = pid_manager_get_free_pid();
     // Set the state of the process as running.
     proc->state = TASK_RUNNING;
-    // Set the current opened file descriptors and the maximum number of file descriptors.
+    // Only the processes created by the running ones count as forks.
     if (source) {
+        scheduler_account_fork();
+    }
+    // Set the current opened file descriptors and the maximum number of file descriptors.
+    if (source && bitmask_check(clone_flags, CLONE_FILES)) {
+        vfs_share_task(proc, source);
+    } else if (source) {
         vfs_dup_task(proc, source);
     } else {
         vfs_init_task(proc);
@@ -248,18 +404,44 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     proc->parent = parent;
     // Initialize the list_head.
     list_head_init(&proc->run_list);
+    list_head_init(&proc->tasks);
+    for (int type = 0; type < PIDTYPE_MAX; ++type) {
+        list_head_init(&proc->pid_links[type]);
+    }
+    list_head_init(&proc->se.prio_list);
+    list_head_init(&proc->se.periodic_list);
+    list_head_init(&proc->se.pi_waiters);
+    list_head_init(&proc->se.pi_list);
     // Initialize the children list_head.
     list_head_init(&proc->children);
     // Initialize the sibling list_head.
     list_head_init(&proc->sibling);
+    // Initialize the queue used to wait for the children.
+    wait_queue_head_init(&proc->wait_chldexit);
+    // Threads join the group of the source, the other tasks start their own.
+    list_head_init(&proc->thread_group);
+    if (source && bitmask_check(clone_flags, CLONE_THREAD)) {
+        proc->tgid         = source->tgid;
+        proc->group_leader = source->group_leader;
+        list_head_insert_before(&proc->thread_group, &source->thread_group);
+    } else {
+        proc->tgid         = proc->pid;
+        proc->group_leader = proc;
+    }
     // If we have a parent, set the sibling child relation.
     if (parent) {
         // Set the new_process as child of current.
         list_head_insert_before(&proc->sibling, &parent->children);
     }
     if (source) {
+        // The registers of the FPU of the source might still be inside the FPU.
+        fpu_save(source);
         memcpy(&proc->thread, &source->thread, sizeof(thread_struct_t));
     }
+    // Allocate the kernel stack, the task starts from its registers.
+    proc->thread.kernel_stack = kmalloc(KERNEL_THREAD_STACK_SIZE);
+    assert(proc->thread.kernel_stack && "Failed to allocate the kernel stack.");
+    proc->thread.kernel_esp = 0;
     // Set the statistics of the process.
     proc->uid                   = 0;
     proc->ruid                  = 0;
@@ -268,6 +450,12 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     proc->sid                   = 0;
     proc->pgid                  = 0;
     proc->se.prio               = DEFAULT_PRIO;
+    proc->se.policy             = SCHED_OTHER;
+    proc->se.normal_prio        = DEFAULT_PRIO;
+    proc->se.normal_policy      = SCHED_OTHER;
+    proc->se.pi_donor           = NULL;
+    proc->se.pi_owner           = NULL;
+    proc->se.pi_key             = 0;
     proc->se.start_runtime      = timer_get_ticks();
     proc->se.exec_start         = timer_get_ticks();
     proc->se.exec_runtime       = 0;
@@ -284,6 +472,7 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     proc->se.utilization_factor = 0;
     // Initialize the exit code of the process.
     proc->exit_code             = 0;
+    proc->exit_signal           = SIGCHLD;
     // Copy the name.
     if (name) {
         strcpy(proc->name, name);
@@ -292,31 +481,30 @@ static inline task_struct *__alloc_task(task_struct *source, task_struct *parent
     proc->mm       = NULL;
     // Initialize the error number.
     proc->error_no = 0;
-    // Initialize the current working directory.
+    // Initialize the current working directory, and the limits of the resources.
     if (source) {
         strcpy(proc->cwd, source->cwd);
+        memcpy(proc->rlim, source->rlim, sizeof(proc->rlim));
     } else {
         strcpy(proc->cwd, "/");
+        memcpy(proc->rlim, default_rlimits, sizeof(proc->rlim));
     }
-    // Clear the signal handler.
-    memset(&proc->sighand, 0x00, sizeof(sighand_t));
-    spinlock_init(&proc->sighand.siglock);
-    atomic_set(&proc->sighand.count, 0);
-    for (int i = 0; i < NSIG; ++i) {
-        proc->sighand.action[i].sa_handler = SIG_DFL;
-        sigemptyset(&proc->sighand.action[i].sa_mask);
-        proc->sighand.action[i].sa_flags = 0;
+    // The slack of the timers is inherited.
+    proc->timer_slack_ns = source ? source->timer_slack_ns : TIMER_SLACK_NS;
+    // Share the signal handlers, or start from the default ones.
+    if (source && bitmask_check(clone_flags, CLONE_SIGHAND)) {
+        proc->sighand        = source->sighand;
+        proc->sigreturn_addr = source->sigreturn_addr;
+        atomic_set(&proc->sighand->count, atomic_read(&proc->sighand->count) + 1);
+    } else {
+        proc->sighand = __sighand_alloc();
     }
     // Clear the masks.
     sigemptyset(&proc->blocked);
     sigemptyset(&proc->real_blocked);
     sigemptyset(&proc->saved_sigmask);
     // Initialzie the data structure storing the pending signals.
-    list_head_init(&proc->pending.list);
-    sigemptyset(&proc->pending.signal);
-
-    // Initalize real_timer for intervals
-    proc->real_timer = NULL;
+    signal_init_task(proc);
 
     // Set the default terminal options.
     proc->termios = (termios_t){
@@ -339,40 +527,71 @@ int init_tasking(void)
     return 1;
 }
 
+/// @brief The first function run by a kernel thread, it exits once the body returns.
+/// @param threadfn the body of the thread.
+/// @param data the argument of the body.
+static void __kthread_start(int (*threadfn)(void *data), void *data)
+{
+    do_exit(threadfn(data) << 8);
+    // The zombie is not runnable anymore, the thread never resumes.
+    schedule();
+}
+
+task_struct *kthread_create(int (*threadfn)(void *data), void *data, const char *name)
+{
+    task_struct *task = __alloc_task(NULL, init_process, 0, name);
+    if (!task) {
+        pr_err("Failed to allocate the kernel thread `%s`.\n", name);
+        return NULL;
+    }
+    // What switch_kernel_stack pops: edi, esi, ebx, ebp, and the return
+    // address, above which the return address of __kthread_start, which
+    // never returns, and its arguments.
+    uintptr_t *esp = (uintptr_t *)((uintptr_t)task->thread.kernel_stack + KERNEL_THREAD_STACK_SIZE);
+    *(--esp)       = (uintptr_t)data;
+    *(--esp)       = (uintptr_t)threadfn;
+    *(--esp)       = 0;
+    *(--esp)       = (uintptr_t)__kthread_start;
+    for (int i = 0; i < 4; ++i) {
+        *(--esp) = 0;
+    }
+    task->thread.kernel_esp = (uintptr_t)esp;
+    // The thread starts running once the scheduler picks it.
+    scheduler_enqueue_task(task);
+    return task;
+}
+
 int process_create_init(const char *path)
 {
     pr_debug("Building init process...\n");
 
     // Allocate the memory for the process.
-    init_process = __alloc_task(NULL, NULL, "init");
+    init_process = __alloc_task(NULL, NULL, 0, "init");
 
     // Active the current process.
     scheduler_enqueue_task(init_process);
 
     // == INITIALIZE `/proc/video` ============================================
     // Check that the fd_list is initialized.
-    assert(init_process->fd_list && "File descriptor list not initialized.");
-    assert((init_process->max_fd > 3) && "File descriptor list cannot contain the standard IOs.");
+    assert(init_process->files->fd_list && "File descriptor list not initialized.");
+    assert((init_process->files->max_fd > 3) && "File descriptor list cannot contain the standard IOs.");
 
     // Create STDIN descriptor.
     vfs_file_t *vfs_stdin = vfs_open("/proc/video", O_RDONLY, 0);
     vfs_stdin->count++;
-    init_process->fd_list[STDIN_FILENO].file_struct = vfs_stdin;
-    init_process->fd_list[STDIN_FILENO].flags_mask  = O_RDONLY;
+    fd_install(init_process, STDIN_FILENO, vfs_stdin, O_RDONLY);
     pr_debug("`/proc/video` stdin  : %p\n", vfs_stdin);
 
     // Create STDOUT descriptor.
     vfs_file_t *vfs_stdout = vfs_open("/proc/video", O_WRONLY, 0);
     vfs_stdout->count++;
-    init_process->fd_list[STDOUT_FILENO].file_struct = vfs_stdout;
-    init_process->fd_list[STDOUT_FILENO].flags_mask  = O_WRONLY;
+    fd_install(init_process, STDOUT_FILENO, vfs_stdout, O_WRONLY);
     pr_debug("`/proc/video` stdout : %p\n", vfs_stdout);
 
     // Create STDERR descriptor.
     vfs_file_t *vfs_stderr = vfs_open("/proc/video", O_WRONLY, 0);
     vfs_stderr->count++;
-    init_process->fd_list[STDERR_FILENO].file_struct = vfs_stderr;
-    init_process->fd_list[STDERR_FILENO].flags_mask  = O_WRONLY;
+    fd_install(init_process, STDERR_FILENO, vfs_stderr, O_WRONLY);
     pr_debug("`/proc/video` stderr : %p\n", vfs_stderr);
     // ------------------------------------------------------------------------
 
@@ -391,27 +610,17 @@ int process_create_init(const char *path)
     paging_switch_pgd(init_process->mm->pgd);
 
     // Prepare argv and envp for the init process.
-    char **argv_ptr;
-    char **envp_ptr;
-    int argc                    = 1;
-    static char *argv[]         = {"/bin/init", (char *)NULL};
-    static char *envp[]         = {(char *)NULL};
-    // Save where the arguments start.
-    init_process->mm->arg_start = init_process->thread.regs.useresp;
-    // Push the arguments on the stack.
-    argv_ptr                    = __push_args_on_stack(&init_process->thread.regs.useresp, argv);
-    // Save where the arguments end.
-    init_process->mm->arg_end   = init_process->thread.regs.useresp;
-    // Save where the environmental variables start.
-    init_process->mm->env_start = init_process->thread.regs.useresp;
-    // Push the environment on the stack.
-    envp_ptr                    = __push_args_on_stack(&init_process->thread.regs.useresp, envp);
-    // Save where the environmental variables end.
-    init_process->mm->env_end   = init_process->thread.regs.useresp;
-    // Push the `main` arguments on the stack (argc, argv, envp).
-    PUSH_VALUE_ON_STACK(init_process->thread.regs.useresp, envp_ptr);
-    PUSH_VALUE_ON_STACK(init_process->thread.regs.useresp, argv_ptr);
-    PUSH_VALUE_ON_STACK(init_process->thread.regs.useresp, argc);
+    static char *argv[] = {"/bin/init", (char *)NULL};
+    static char *envp[] = {(char *)NULL};
+    exec_args_t args;
+    if (__exec_args_copy(&args, argv, envp) < 0) {
+        pr_err("Failed to copy the arguments of init.\n");
+        paging_switch_pgd(crtdir);
+        return 1;
+    }
+    // Push the arguments, the environment, and the auxiliary vector on the stack.
+    __exec_args_push(init_process, &args);
+    kfree(args.vector);
 
     // Restore previous pgdir
     paging_switch_pgd(crtdir);
@@ -427,11 +636,11 @@ vfs_file_descriptor_t *fget(int fd)
     task_struct *current = scheduler_get_current_process();
     assert(current && "There is no current task running.");
     // Check the current FD.
-    if (fd < 0 || fd >= current->max_fd) {
+    if (fd < 0 || fd >= current->files->max_fd) {
         return NULL;
     }
     // Retrieve the file structure from the table.
-    return current->fd_list + fd;
+    return current->files->fd_list + fd;
 }
 
 char *sys_getcwd(char *buf, size_t size)
@@ -472,11 +681,11 @@ int sys_fchdir(int fd)
     task_struct *current = scheduler_get_current_process();
     assert(current && "There is no running process.");
     // Check if it is a valid file descriptor.
-    if ((fd < 0) || (fd >= current->max_fd)) {
+    if ((fd < 0) || (fd >= current->files->max_fd)) {
         return -EBADF;
     }
     // Get the file descriptor.
-    vfs_file_descriptor_t *vfd = &current->fd_list[fd];
+    vfs_file_descriptor_t *vfd = &current->files->fd_list[fd];
     // Check if the file descriptor file is set.
     if (vfd->file_struct == NULL) {
         return -ENOENT;
@@ -495,6 +704,116 @@ int sys_fchdir(int fd)
     return 0;
 }
 
+/// @brief Replaces the image of a task with an executable, and places the
+///        arguments and the environment on its new stack.
+/// @param task the task, either the current one or a new one.
+/// @param filename the path of the executable.
+/// @param origin_argv the arguments, inside the memory of the current task.
+/// @param origin_envp the environment, inside the memory of the current task.
+/// @return 0 on success, a negative errno on failure.
+static int __exec_image(task_struct *task, const char *filename, char **origin_argv, char **origin_envp)
+{
+    exec_args_t args;
+    char name_buffer[NAME_MAX];
+    char saved_filename[PATH_MAX];
+
+    // Save the name of the process.
+    strcpy(name_buffer, origin_argv[0]);
+    // Save the filename.
+    strcpy(saved_filename, filename);
+
+    // == COPY PROGRAM ARGUMENTS ==============================================
+    // Copy argv and envp to kernel memory, because all the old process memory will be discarded.
+    int ret = __exec_args_copy(&args, origin_argv, origin_envp);
+    if (ret < 0) {
+        pr_err("Failed to copy the arguments and the environment: %d.\n", ret);
+        return ret;
+    }
+    // ------------------------------------------------------------------------
+
+    // == INITIALIZE TASK MEMORY ==============================================
+    ret = __load_executable(saved_filename, task, &task->thread.regs.eip);
+    if (ret <= 0) {
+        // Free the temporary args memory.
+        kfree(args.vector);
+        return (ret < 0) ? ret : -ENOEXEC;
+    }
+    if (ret == 2) { // An interpreter was loaded.
+        // We need to modify the argv array passed to the interpreter process.
+        // The original file name must be passed as second argument and the rest
+        // is shifted to the right.
+        // Prepare a new argv array.
+        char **int_argv = kmalloc((args.argc + 2) * sizeof(char *));
+        if (!int_argv) {
+            pr_err("Failed to allocate memory for interpreter argv array.\n");
+            kfree(args.vector);
+            return -ENOMEM;
+        }
+        int_argv[0] = args.vector[0]; // TODO: pass the path to the interpreter.
+        int_argv[1] = saved_filename;
+        for (int i = 1; i <= args.argc; i++) {
+            int_argv[i + 1] = args.vector[i];
+        }
+        // Rebuild the copy, with the new arguments.
+        exec_args_t int_args;
+        ret = __exec_args_copy(&int_args, int_argv, args.vector + args.argc + 1);
+        kfree(int_argv);
+        kfree(args.vector);
+        if (ret < 0) {
+            pr_err("Failed to copy the arguments of the interpreter: %d.\n", ret);
+            return ret;
+        }
+        args = int_args;
+    }
+    // ------------------------------------------------------------------------
+
+    // == INITIALIZE PROGRAM ARGUMENTS ========================================
+    // Save the current page directory.
+    page_directory_t *crtdir = paging_get_current_pgd();
+
+    // Change the page directory to point to the newly created process
+    paging_switch_pgd(task->mm->pgd);
+
+    // Push the arguments, the environment, and the auxiliary vector on the stack.
+    __exec_args_push(task, &args);
+
+    // Restore previous pgdir
+    paging_switch_pgd(crtdir);
+    // ------------------------------------------------------------------------
+
+    // Change the name of the process.
+    strcpy(task->name, name_buffer);
+    // The new image starts with initialized FPU registers.
+    fpu_release(task);
+
+    // Free the temporary args memory.
+    kfree(args.vector);
+    return 0;
+}
+
+/// @brief Copies the session, the group, and the user and group ids of a process.
+/// @param proc the new process.
+/// @param parent the process it is copied from.
+static inline void __inherit_ids(task_struct *proc, task_struct *parent)
+{
+    proc->sid  = parent->sid;
+    proc->pgid = parent->pgid;
+    proc->uid  = parent->uid;
+    proc->ruid = parent->ruid;
+    proc->gid  = parent->gid;
+    proc->rgid = parent->rgid;
+}
+
+/// @brief Frees a new process which has never run.
+/// @param proc the process.
+static void __free_task(task_struct *proc)
+{
+    if (proc->mm) {
+        mm_put(proc->mm);
+    }
+    process_release(proc);
+}
+
 pid_t sys_fork(pt_regs_t *f)
 {
     task_struct *current = scheduler_get_current_process();
@@ -508,7 +827,7 @@ pid_t sys_fork(pt_regs_t *f)
     // to the ones of the child process, except for eax.
     scheduler_store_context(f, current);
     // Allocate the memory for the process.
-    task_struct *proc        = __alloc_task(current, current, current->name);
+    task_struct *proc        = __alloc_task(current, current, 0, current->name);
     // Copy the father's stack, memory, heap etc... to the child process
     proc->mm                 = mm_clone(current->mm);
     // Set the eax as 0, to indicate the child process
@@ -517,12 +836,7 @@ pid_t sys_fork(pt_regs_t *f)
     proc->thread.regs.eflags = proc->thread.regs.eflags | EFLAG_IF;
 
     // Copy session and group id of the parent into the child
-    proc->sid  = current->sid;
-    proc->pgid = current->pgid;
-    proc->uid  = current->uid;
-    proc->ruid = current->ruid;
-    proc->gid  = current->gid;
-    proc->rgid = current->rgid;
+    __inherit_ids(proc, current);
 
     // Active the new process.
     scheduler_enqueue_task(proc);
@@ -535,6 +849,353 @@ pid_t sys_fork(pt_regs_t *f)
     return proc->pid;
 }
 
+pid_t sys_vfork(pt_regs_t *f)
+{
+    task_struct *current = scheduler_get_current_process();
+    if (current == NULL) {
+        kernel_panic("There is no current process!");
+    }
+
+    pr_debug("VForking  '%s' (pid: %d)...\n", current->name, current->pid);
+
+    // Update current process registers, they should be equal
+    // to the ones of the child process, except for eax.
+    scheduler_store_context(f, current);
+    // Allocate the memory for the process.
+    task_struct *proc        = __alloc_task(current, current, 0, current->name);
+    // Borrow the father's segments, instead of copying them.
+    proc->mm                 = current->mm;
+    proc->vfork_parent       = current;
+    // Set the eax as 0, to indicate the child process
+    proc->thread.regs.eax    = 0;
+    // Enable the interrupts.
+    proc->thread.regs.eflags = proc->thread.regs.eflags | EFLAG_IF;
+
+    // Copy session and group id of the parent into the child
+    __inherit_ids(proc, current);
+
+    // Active the new process.
+    scheduler_enqueue_task(proc);
+
+    // The child runs on our memory, and on our stack: sleep until it replaces
+    // its image, or exits. It cannot be reaped meanwhile, since we are its parent.
+    pid_t pid = proc->pid;
+    while (proc->vfork_parent) {
+        current->state = TASK_UNINTERRUPTIBLE;
+        schedule();
+    }
+
+    // Return PID of child process to parent.
+    return pid;
+}
+
+pid_t sys_clone(pt_regs_t *f)
+{
+    task_struct *current = scheduler_get_current_process();
+    if (current == NULL) {
+        kernel_panic("There is no current process!");
+    }
+    // Get the arguments, in the order of the Linux system call.
+    unsigned long flags   = f->ebx;
+    uintptr_t stack       = f->ecx;
+    pid_t *ptid           = (pid_t *)f->edx;
+    struct user_desc *tls = (struct user_desc *)f->esi;
+    pid_t *ctid           = (pid_t *)f->edi;
+    // Signal handlers only make sense with the memory they point to, and the
+    // threads of a group share their handlers.
+    if ((bitmask_check(flags, CLONE_SIGHAND) && !bitmask_check(flags, CLONE_VM)) ||
+        (bitmask_check(flags, CLONE_THREAD) && !bitmask_check(flags, CLONE_SIGHAND))) {
+        return -EINVAL;
+    }
+    // The memory of a vfork() child belongs to its parent. The id of a child
+    // with its own memory would have to be written inside its own copy.
+    if (bitmask_check(flags, CLONE_VM) ? (current->vfork_parent != NULL) : bitmask_check(flags, CLONE_CHILD_SETTID)) {
+        return -EINVAL;
+    }
+    if (bitmask_check(flags, CLONE_SETTLS)) {
+        if (!tls) {
+            return -EFAULT;
+        }
+        if ((tls->entry_number != (unsigned int)-1) && (tls->entry_number != GDT_TLS_ENTRY)) {
+            return -EINVAL;
+        }
+    }
+
+    pr_debug("Cloning   '%s' (pid: %d, flags: 0x%08lx)...\n", current->name, current->pid, flags);
+
+    // Update current process registers, they should be equal
+    // to the ones of the child process, except for eax.
+    scheduler_store_context(f, current);
+    // Threads are not children of the caller, they have the same parent.
+    bool_t thread     = bitmask_check(flags, CLONE_THREAD);
+    task_struct *proc = __alloc_task(current, thread ? NULL : current, flags, current->name);
+    if (thread) {
+        proc->parent = current->parent;
+    }
+    // Share the memory, or copy it.
+    if (bitmask_check(flags, CLONE_VM)) {
+        proc->mm = current->mm;
+        ++proc->mm->users;
+    } else if (!(proc->mm = mm_clone(current->mm))) {
+        __free_task(proc);
+        return -ENOMEM;
+    }
+    // Set the eax as 0, to indicate the child process
+    proc->thread.regs.eax    = 0;
+    // Enable the interrupts.
+    proc->thread.regs.eflags = proc->thread.regs.eflags | EFLAG_IF;
+    // The child might start on its own stack.
+    if (stack) {
+        proc->thread.regs.useresp = stack;
+    }
+    if (bitmask_check(flags, CLONE_SETTLS)) {
+        proc->thread.tls_base = tls->base_addr;
+    }
+    // Nobody waits for the threads, they are released once they exit.
+    proc->exit_signal = thread ? 0 : (int)(flags & CSIGNAL);
+    if (bitmask_check(flags, CLONE_CHILD_CLEARTID)) {
+        proc->clear_child_tid = ctid;
+    }
+    if (bitmask_check(flags, CLONE_PARENT_SETTID) && ptid) {
+        *ptid = proc->pid;
+    }
+    if (bitmask_check(flags, CLONE_CHILD_SETTID) && ctid) {
+        *ctid = proc->pid;
+    }
+
+    // Copy session and group id of the parent into the child, and the mask of blocked signals.
+    __inherit_ids(proc, current);
+    proc->blocked = current->blocked;
+
+    // Active the new process.
+    scheduler_enqueue_task(proc);
+
+    pr_debug("Cloned    '%s' (pid: %d, tgid: %d)...\n", proc->name, proc->pid, proc->tgid);
+
+    // Return PID of child process to parent.
+    return proc->pid;
+}
+
+int sys_set_thread_area(struct user_desc *u_info)
+{
+    task_struct *current = scheduler_get_current_process();
+    if (current == NULL) {
+        kernel_panic("There is no current process!");
+    }
+    if (!u_info) {
+        return -EFAULT;
+    }
+    // There is a single entry for the thread-local storage.
+    if ((u_info->entry_number != (unsigned int)-1) && (u_info->entry_number != GDT_TLS_ENTRY)) {
+        return -EINVAL;
+    }
+    u_info->entry_number     = GDT_TLS_ENTRY;
+    current->thread.tls_base = u_info->base_addr;
+    // The selector of the caller might already point at the entry.
+    gdt_set_tls(current->thread.tls_base);
+    return 0;
+}
+
+void zap_other_threads(task_struct *task)
+{
+    list_for_each_decl (it, &task->thread_group) {
+        task_struct *thread = list_entry(it, task_struct, thread_group);
+        if (thread->state != EXIT_ZOMBIE) {
+            sys_kill(thread->pid, SIGKILL);
+        }
+    }
+}
+
+void process_release(task_struct *task)
+{
+    task_struct *leader = task->group_leader;
+    // The times, and the page faults, of the threads are those of their process.
+    if (leader != task) {
+        leader->utime += task->utime;
+        leader->stime += task->stime;
+        leader->min_flt += task->min_flt;
+        leader->maj_flt += task->maj_flt;
+    }
+    pid_manager_mark_free(task->pid);      // Free the PID.
+    vfs_destroy_task(task);                // Finalize VFS structures.
+    list_head_remove(&task->sibling);      // Remove from parent's child list.
+    list_head_remove(&task->thread_group); // Leave the thread group.
+    scheduler_dequeue_task(task);          // Remove from the scheduler.
+    fpu_release(task);                     // Forget it owned the FPU.
+    pmu_exit_task(task);                   // Detach its hardware events.
+    hrtimer_cancel(&task->real_timer);     // Stop the real timer.
+    hrtimer_cancel(&task->sleep_timer);    // Stop the sleep timer.
+    signal_flush_task(task);               // Free the queued signals.
+    __sighand_put(task->sighand);          // Drop the signal handlers.
+    kfree(task->thread.kernel_stack);      // Free the kernel stack.
+    kmem_cache_free(task);                 // Free the `task_struct`.
+    // The group leader can be reaped once its last thread is gone.
+    if ((leader != task) && list_head_empty(&leader->thread_group) && (leader->state == EXIT_ZOMBIE) &&
+        leader->parent) {
+        wake_up(&leader->parent->wait_chldexit);
+    }
+}
+
+void process_vfork_release(task_struct *task)
+{
+    task_struct *parent = task->vfork_parent;
+    if (parent) {
+        task->vfork_parent = NULL;
+        if (parent->state == TASK_UNINTERRUPTIBLE) {
+            scheduler_wake_up_task(parent, TASK_RUNNING);
+        }
+    }
+}
+
+/// @brief Makes a file descriptor of a new process available, closing it if it is open.
+/// @param proc the new process.
+/// @param fd the file descriptor.
+/// @return 0 on success, a negative errno on failure.
+static int __spawn_reserve_fd(task_struct *proc, int fd)
+{
+    if ((fd < 0) || (fd >= MAX_TASK_FD)) {
+        return -EBADF;
+    }
+    while (fd >= proc->files->max_fd) {
+        if (!vfs_extend_task_fd_list(proc)) {
+            return -EMFILE;
+        }
+    }
+    vfs_file_t *file = proc->files->fd_list[fd].file_struct;
+    if (file) {
+        fd_release(proc, fd);
+        vfs_close(file);
+    }
+    return 0;
+}
+
+/// @brief Performs, in order, the file actions of posix_spawn() on a new process.
+/// @param proc the new process.
+/// @param file_actions the file actions, inside the memory of the current task.
+/// @return 0 on success, a negative errno on failure.
+static int __spawn_file_actions(task_struct *proc, const posix_spawn_file_actions_t *file_actions)
+{
+    for (int i = 0; i < file_actions->count; ++i) {
+        const posix_spawn_file_action_t *action = &file_actions->actions[i];
+        vfs_file_t *file;
+        int ret;
+        switch (action->type) {
+        case POSIX_SPAWN_OPEN:
+            if ((ret = __spawn_reserve_fd(proc, action->fd)) < 0) {
+                return ret;
+            }
+            if (!(file = vfs_open(action->path, action->oflag, action->mode))) {
+                return -errno;
+            }
+            fd_install(proc, action->fd, file, action->oflag);
+            // Point at the last character, when appending.
+            file->f_pos = 0;
+            if (bitmask_check(action->oflag, O_APPEND)) {
+                stat_t stat;
+                file->fs_operations->stat_f(file, &stat);
+                file->f_pos = stat.st_size;
+            }
+            break;
+        case POSIX_SPAWN_CLOSE:
+            if ((action->fd < 0) || (action->fd >= proc->files->max_fd) ||
+                !proc->files->fd_list[action->fd].file_struct) {
+                return -EBADF;
+            }
+            __spawn_reserve_fd(proc, action->fd);
+            break;
+        case POSIX_SPAWN_DUP2:
+            if ((action->fd < 0) || (action->fd >= proc->files->max_fd) ||
+                !proc->files->fd_list[action->fd].file_struct) {
+                return -EBADF;
+            }
+            if (action->fd == action->newfd) {
+                break;
+            }
+            // The list might be reallocated, so we keep a copy of the descriptor.
+            file      = proc->files->fd_list[action->fd].file_struct;
+            int flags = proc->files->fd_list[action->fd].flags_mask;
+            if ((ret = __spawn_reserve_fd(proc, action->newfd)) < 0) {
+                return ret;
+            }
+            file->count += 1;
+            fd_install(proc, action->newfd, file, flags);
+            break;
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/// @brief Applies the attributes of posix_spawn() to a new process.
+/// @param proc the new process.
+/// @param attr the attributes, inside the memory of the current task.
+/// @return 0 on success, a negative errno on failure.
+static int __spawn_attributes(task_struct *proc, const posix_spawnattr_t *attr)
+{
+    if (attr->flags & ~(POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK)) {
+        return -EINVAL;
+    }
+    if (bitmask_check(attr->flags, POSIX_SPAWN_SETPGROUP)) {
+        if (attr->pgroup < 0) {
+            return -EINVAL;
+        }
+        proc->pgid = attr->pgroup ? attr->pgroup : proc->pid;
+    }
+    if (bitmask_check(attr->flags, POSIX_SPAWN_SETSIGMASK)) {
+        proc->blocked = attr->sigmask;
+        sigdelset(&proc->blocked, SIGKILL);
+        sigdelset(&proc->blocked, SIGSTOP);
+    }
+    // The signal handlers of a new process are always the default ones, so
+    // POSIX_SPAWN_SETSIGDEF is already satisfied.
+    return 0;
+}
+
+pid_t sys_posix_spawn(
+    const char *path, const posix_spawn_file_actions_t *file_actions, const posix_spawnattr_t *attrp,
+    char *const argv[], char *const envp[])
+{
+    task_struct *current = scheduler_get_current_process();
+    if (current == NULL) {
+        kernel_panic("There is no current process!");
+    }
+    if (!path || !argv || !argv[0] || !envp) {
+        return -EINVAL;
+    }
+
+    pr_debug("Spawning  '%s' from '%s' (pid: %d)...\n", path, current->name, current->pid);
+
+    // Allocate the memory for the process, which inherits our files, and our signal mask.
+    task_struct *proc = __alloc_task(current, current, 0, current->name);
+    __inherit_ids(proc, current);
+    proc->blocked = current->blocked;
+
+    // Apply the attributes, and the file actions, then build the new image
+    // straight away: our memory is only read, to copy the arguments.
+    int ret = 0;
+    if (attrp) {
+        ret = __spawn_attributes(proc, attrp);
+    }
+    if ((ret == 0) && file_actions) {
+        ret = __spawn_file_actions(proc, file_actions);
+    }
+    if (ret == 0) {
+        ret = __exec_image(proc, path, (char **)argv, (char **)envp);
+    }
+    if (ret < 0) {
+        __free_task(proc);
+        return ret;
+    }
+
+    // Active the new process.
+    scheduler_enqueue_task(proc);
+
+    pr_debug("Spawned   '%s' (pid: %d, pgid: %d)...\n", proc->name, proc->pid, proc->pgid);
+
+    return proc->pid;
+}
+
 int sys_execve(pt_regs_t *f)
 {
     // Check the current process.
@@ -543,15 +1204,6 @@ int sys_execve(pt_regs_t *f)
         kernel_panic("There is no current process!");
     }
 
-    char **origin_argv;
-    char **saved_argv;
-    char **final_argv;
-    char **origin_envp;
-    char **saved_envp;
-    char **final_envp;
-    char name_buffer[NAME_MAX];
-    char saved_filename[PATH_MAX];
-
     // Get the filename.
     char *filename = (char *)f->ebx;
     if (filename == NULL) {
@@ -559,9 +1211,9 @@ int sys_execve(pt_regs_t *f)
         return -1;
     }
     // Get the arguments
-    origin_argv = (char **)f->ecx;
+    char **origin_argv = (char **)f->ecx;
     // Get the environment.
-    origin_envp = (char **)f->edx;
+    char **origin_envp = (char **)f->edx;
     // Check the argument, the environment, and that at least the name is provided.
     if (origin_argv == NULL) {
         pr_err("sys_execve failed: must provide argv.\n");
@@ -576,118 +1228,12 @@ int sys_execve(pt_regs_t *f)
         return -1;
     }
 
-    // Save the name of the process.
-    strcpy(name_buffer, origin_argv[0]);
-    // Save the filename.
-    strcpy(saved_filename, filename);
-
-    // == COPY PROGRAM ARGUMENTS ==============================================
-    // Copy argv and envp to kernel memory, because all the old process memory will be discarded.
-    int argc       = __count_args(origin_argv);
-    int argv_bytes = __count_args_bytes(origin_argv);
-    int envc       = __count_args(origin_envp);
-    int envp_bytes = __count_args_bytes(origin_envp);
-    if ((argv_bytes < 0) || (envp_bytes < 0)) {
-        pr_err(
-            "Failed to count required memory to store arguments and "
-            "environment (%d + %d).\n",
-            argv_bytes, envp_bytes);
-        return -1;
-    }
-    void *args_mem = kmalloc(argv_bytes + envp_bytes);
-    if (!args_mem) {
-        pr_err(
-            "Failed to allocate memory for arguments and environment %d (%d + "
-            "%d).\n",
-            argv_bytes + envp_bytes, argv_bytes, envp_bytes);
-        return -1;
-    }
-    // Copy the arguments.
-    uint32_t args_mem_ptr = (uint32_t)args_mem + (argv_bytes + envp_bytes);
-    saved_argv            = __push_args_on_stack(&args_mem_ptr, origin_argv);
-    saved_envp            = __push_args_on_stack(&args_mem_ptr, origin_envp);
-    // Check the memory pointer.
-    assert(args_mem_ptr == (uint32_t)args_mem);
-    // ------------------------------------------------------------------------
-
-    // == INITIALIZE TASK MEMORY ==============================================
-    int ret = __load_executable(filename, current, &current->thread.regs.eip);
-    if (ret <= 0) {
+    // Load the executable, with its arguments.
+    int ret = __exec_image(current, filename, origin_argv, origin_envp);
+    if (ret < 0) {
         pr_err("Failed to load executable!\n");
-        // Free the temporary args memory.
-        kfree(args_mem);
         return ret;
     }
-    if (ret == 2) { // An interpreter was loaded.
-        // We need to modify the argv array passed to the interpreter process.
-        // The original file name must be passed as second argument and the rest
-        // is shifted to the right.
-        // Prepare a new argv array.
-        char **int_argv = kmalloc((argc + 2) * sizeof(char *));
-        if (!int_argv) {
-            pr_err("Failed to allocate memory for interpreter argv array.\n");
-            return -1;
-        }
-        int_argv[0] = saved_argv[0]; // TODO: pass the path to the interpreter.
-        int_argv[1] = saved_filename;
-        for (int i = 1; i <= argc; i++) {
-            int_argv[i + 1] = saved_argv[i];
-        }
-        argc++;
-
-        // Rebuild the saved argv and envp pointers.
-        int int_argv_bytes = __count_args_bytes(int_argv);
-        void *int_args_mem = kmalloc(int_argv_bytes);
-        if (!int_args_mem) {
-            pr_err(
-                "Failed to allocate memory for interpreter arguments and "
-                "environment %d (%d + %d).\n",
-                int_argv_bytes + envp_bytes, int_argv_bytes, envp_bytes);
-            return -1;
-        }
-        // Copy the arguments.
-        uint32_t int_args_mem_ptr = (uint32_t)int_args_mem + (int_argv_bytes + envp_bytes);
-        saved_argv                = __push_args_on_stack(&int_args_mem_ptr, int_argv);
-        saved_envp                = __push_args_on_stack(&int_args_mem_ptr, saved_envp);
-        // Check the memory pointer.
-        assert(int_args_mem_ptr == (uint32_t)int_args_mem);
-        // Free the old argument and environ memory block.
-        kfree(args_mem);
-        args_mem = int_args_mem;
-    }
-    // ------------------------------------------------------------------------
-
-    // == INITIALIZE PROGRAM ARGUMENTS ========================================
-    // Save the current page directory.
-    page_directory_t *crtdir = paging_get_current_pgd();
-
-    // Change the page directory to point to the newly created process
-    paging_switch_pgd(current->mm->pgd);
-
-    // Save where the arguments start.
-    current->mm->arg_start = current->thread.regs.useresp;
-    // Push the arguments on the stack.
-    final_argv             = __push_args_on_stack(&current->thread.regs.useresp, saved_argv);
-    // Save where the arguments end, and the env starts.
-    current->mm->env_start = current->mm->arg_end = current->thread.regs.useresp;
-    // Push the environment on the stack.
-    final_envp                                    = __push_args_on_stack(&current->thread.regs.useresp, saved_envp);
-    // Save where the environmental variables end.
-    current->mm->env_end                          = current->thread.regs.useresp;
-    // Push the `main` arguments on the stack (argc, argv, envp).
-    PUSH_VALUE_ON_STACK(current->thread.regs.useresp, final_envp);
-    PUSH_VALUE_ON_STACK(current->thread.regs.useresp, final_argv);
-    PUSH_VALUE_ON_STACK(current->thread.regs.useresp, argc);
-
-    // Restore previous pgdir
-    paging_switch_pgd(crtdir);
-    // ------------------------------------------------------------------------
-
-    // Change the name of the process.
-    strcpy(current->name, name_buffer);
-
-    // Free the temporary args memory.
-    kfree(args_mem);
 
     // Perform the switch to the new process.
     scheduler_restore_context(current, f);
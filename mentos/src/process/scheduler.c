@@ -10,17 +10,31 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "assert.h"
+#include "descriptor_tables/gdt.h"
 #include "descriptor_tables/tss.h"
 #include "errno.h"
 #include "fs/vfs.h"
+#include "hardware/hrtimer.h"
+#include "hardware/pmu.h"
+#include "hardware/smp.h"
 #include "hardware/timer.h"
+#include "klib/div64.h"
+#include "klib/rcu.h"
+#include "math.h"
+#include "mem/alloc/zone_allocator.h"
 #include "process/pid_manager.h"
 #include "process/prio.h"
 #include "process/scheduler.h"
 #include "process/scheduler_feedback.h"
 #include "process/wait.h"
+#include "process/workqueue.h"
 #include "strerror.h"
+#include "sys/futex.h"
+#include "sys/resource.h"
+#include "sys/times.h"
 #include "system/panic.h"
+#include "system/trace.h"
+#include "system/vdso.h"
 
 /// @brief          Assembly function setting the kernel stack to jump into
 ///                 location in Ring 3 mode (USER mode).
@@ -28,22 +42,118 @@
 /// @param stack    The stack to use.
 extern void enter_userspace(uintptr_t location, uintptr_t stack);
 
-/// The list of processes.
-runqueue_t runqueue;
+/// @brief          Assembly function switching to the kernel stack of another
+///                 process.
+/// @param prev_esp Where the stack pointer of the current process is saved.
+/// @param next_esp The stack pointer saved by the next process.
+extern void switch_kernel_stack(uintptr_t *prev_esp, uintptr_t next_esp);
+
+/// @brief Assembly function returning to user mode, with the registers
+///        stored on the stack.
+extern void return_to_userspace(void);
+
+/// The list of processes of each CPU.
+static DEFINE_PER_CPU(runqueue_t, runqueues);
+/// The list of processes of the CPU running the caller.
+#define runqueue this_cpu(runqueues)
+
+/// The number of buckets of the hash tables of the processes.
+#define PID_HASH_SIZE 64
+/// The longest chain of lock owners the priority inheritance goes through,
+/// a longer one is most likely a deadlock.
+#define PI_MAX_CHAIN  16
+
+volatile unsigned int __preempt_count = 0;
+
+/// The processes, hashed by pid, by process group and by session.
+static list_head_t pid_hash[PIDTYPE_MAX][PID_HASH_SIZE];
 
 // Definition of the global init process pointer
 task_struct *init_process = NULL;
 
+/// The threads which have terminated, linked through their sibling field.
+static list_head_t dead_threads;
+/// Releases the terminated threads, once they are not running anymore.
+static work_struct_t dead_threads_work;
+
+/// @brief The body of the idle task.
+static void __scheduler_idle(void);
+
+/// @brief The task running while no process can, with pid 0. It belongs to
+///        no list of processes, and it is picked only when the queue is empty.
+static task_struct idle_task;
+/// The kernel stack of the idle task.
+static uint8_t idle_stack[KERNEL_THREAD_STACK_SIZE];
+
+/// @brief Prepares the idle task, so that switching to it starts __scheduler_idle.
+static inline void __scheduler_idle_init(void)
+{
+    memset(&idle_task, 0, sizeof(task_struct));
+    strcpy(idle_task.name, "idle");
+    idle_task.pid              = 0;
+    idle_task.state            = TASK_RUNNING;
+    idle_task.se.policy        = SCHED_IDLE;
+    idle_task.se.prio          = MAX_PRIO - 1;
+    idle_task.se.normal_policy = SCHED_IDLE;
+    idle_task.se.normal_prio   = MAX_PRIO - 1;
+    list_head_init(&idle_task.run_list);
+    list_head_init(&idle_task.tasks);
+    list_head_init(&idle_task.se.prio_list);
+    list_head_init(&idle_task.se.pi_waiters);
+    list_head_init(&idle_task.se.pi_list);
+    list_head_init(&idle_task.children);
+    list_head_init(&idle_task.sibling);
+    list_head_init(&idle_task.thread_group);
+    signal_init_task(&idle_task);
+    idle_task.group_leader        = &idle_task;
+    idle_task.thread.kernel_stack = idle_stack;
+    // What switch_kernel_stack pops: edi, esi, ebx, ebp, and the return
+    // address, above which the return address of __scheduler_idle, which
+    // never returns.
+    uintptr_t *esp = (uintptr_t *)(idle_stack + KERNEL_THREAD_STACK_SIZE);
+    *(--esp)       = 0;
+    *(--esp)       = (uintptr_t)__scheduler_idle;
+    for (int i = 0; i < 4; ++i) {
+        *(--esp) = 0;
+    }
+    idle_task.thread.kernel_esp = (uintptr_t)esp;
+}
+
+/// @brief Releases the threads which have terminated, the first time the
+///        worker runs after them.
+/// @param work the work.
+static void __scheduler_release_threads(work_struct_t *work)
+{
+    while (!list_head_empty(&dead_threads)) {
+        process_release(list_entry(list_head_pop(&dead_threads), task_struct, sibling));
+    }
+}
+
 void scheduler_initialize(void)
 {
     // Initialize the runqueue list of tasks.
     list_head_init(&runqueue.queue);
+    list_head_init(&runqueue.tasks);
+    list_head_init(&runqueue.periodic);
+    // Initialize the hash tables of the processes.
+    for (int type = 0; type < PIDTYPE_MAX; ++type) {
+        for (int i = 0; i < PID_HASH_SIZE; ++i) {
+            list_head_init(&pid_hash[type][i]);
+        }
+    }
     // Initialize the PID manager.
     pid_manager_init();
     // Reset the current task.
-    runqueue.curr       = NULL;
+    runqueue.curr         = NULL;
     // Reset the number of active tasks.
-    runqueue.num_active = 0;
+    runqueue.num_active   = 0;
+    runqueue.num_running  = 0;
+    runqueue.need_resched = false;
+    // Prepare the task running while no process can.
+    __scheduler_idle_init();
+    // Nobody waits for the threads.
+    list_head_init(&dead_threads);
+    init_work(&dead_threads_work, __scheduler_release_threads);
 }
 
 task_struct *scheduler_get_current_process(void) { return runqueue.curr; }
@@ -74,18 +184,258 @@ time_t scheduler_get_maximum_vruntime(void)
 
 size_t scheduler_get_active_processes(void) { return runqueue.num_active; }
 
-task_struct *scheduler_get_running_process(pid_t pid)
+/// @brief Returns one of the identifiers of a process.
+/// @param process The process.
+/// @param type The identifier.
+/// @return The value of the identifier.
+static inline pid_t __pid_of(task_struct *process, pid_type_t type)
 {
-    task_struct *entry;
-    list_for_each_decl (it, &runqueue.queue) {
-        entry = list_entry(it, task_struct, run_list);
-        if (entry->pid == pid) {
+    if (type == PIDTYPE_PGID) {
+        return process->pgid;
+    }
+    if (type == PIDTYPE_SID) {
+        return process->sid;
+    }
+    return process->pid;
+}
+
+/// @brief Returns the bucket of the processes with the given identifier.
+/// @param type The identifier.
+/// @param id The value of the identifier.
+/// @return The bucket.
+static inline list_head_t *__pid_bucket(pid_type_t type, pid_t id)
+{
+    return &pid_hash[type][(uint32_t)id % PID_HASH_SIZE];
+}
+
+/// @brief Searches for the processes with the given identifier.
+/// @param type The identifier.
+/// @param id The value of the identifier.
+/// @param prev The process found by the previous call, NULL to start from the first one.
+/// @return The next process with the identifier, NULL if there are no more processes.
+static inline task_struct *__pid_hash_find(pid_type_t type, pid_t id, task_struct *prev)
+{
+    list_head_t *bucket = __pid_bucket(type, id);
+    for (list_head_t *it = prev ? prev->pid_links[type].next : bucket->next; it != bucket; it = it->next) {
+        task_struct *entry = list_entry(it, task_struct, pid_links[type]);
+        if (__pid_of(entry, type) == id) {
             return entry;
         }
     }
     return NULL;
 }
 
+/// @brief Changes one of the identifiers of a process, moving it inside the
+///        hash table of the identifier.
+/// @param process The process.
+/// @param type The identifier.
+/// @param id The new value of the identifier.
+static inline void __pid_hash_change(task_struct *process, pid_type_t type, pid_t id)
+{
+    if (type == PIDTYPE_PGID) {
+        process->pgid = id;
+    } else if (type == PIDTYPE_SID) {
+        process->sid = id;
+    }
+    // A process is hashed once the scheduler knows it.
+    if (!list_head_empty(&process->pid_links[type])) {
+        list_head_remove(&process->pid_links[type]);
+        list_head_insert_before(&process->pid_links[type], __pid_bucket(type, id));
+    }
+}
+
+task_struct *scheduler_get_running_process(pid_t pid) { return __pid_hash_find(PIDTYPE_PID, pid, NULL); }
+
+task_struct *scheduler_get_pgrp_process(pid_t pgid, task_struct *prev)
+{
+    return __pid_hash_find(PIDTYPE_PGID, pgid, prev);
+}
+
+/// @brief Places a process on the queue of the runnable processes.
+/// @param process The process.
+static inline void __scheduler_activate(task_struct *process)
+{
+    process->se.stats.last_queued = timer_get_ticks();
+    process->se.stats.woken       = true;
+    process->se.stats.woken_ns    = hrtimer_get_ns();
+    list_head_insert_before(&process->run_list, &runqueue.queue);
+    ++runqueue.num_running;
+    scheduler_algorithm_enqueue(process);
+    // Switch to the process on the way back to user mode if it should run
+    // before the current one, the others wait for the next tick.
+    task_struct *curr = runqueue.curr;
+    if (!curr || (curr == &idle_task) || (curr->state != TASK_RUNNING) ||
+        scheduler_algorithm_check_preempt(curr, process)) {
+        runqueue.need_resched = true;
+    }
+}
+
+/// @brief Removes a process from the queue of the runnable processes.
+/// @param process The process.
+static inline void __scheduler_deactivate(task_struct *process)
+{
+    list_head_remove(&process->run_list);
+    --runqueue.num_running;
+    scheduler_algorithm_dequeue(process);
+}
+
+/// @brief Changes the policy and the priority a process runs with, moving it
+///        inside the structures of the scheduling algorithm if it is runnable.
+/// @param process The process.
+/// @param policy The new policy.
+/// @param prio The new priority.
+static inline void __scheduler_requeue(task_struct *process, int policy, int prio)
+{
+    bool_t queued = !list_head_empty(&process->run_list);
+    if (queued) {
+        scheduler_algorithm_dequeue(process);
+    }
+    process->se.policy = policy;
+    process->se.prio   = prio;
+    if (queued) {
+        scheduler_algorithm_enqueue(process);
+    }
+    runqueue.need_resched = true;
+}
+
+/// @brief Returns the task a process takes its policy and priority from.
+/// @param process The process.
+/// @return its donor, or the process itself if it has none.
+static inline task_struct *__scheduler_pi_top(task_struct *process)
+{
+    return process->se.pi_donor ? process->se.pi_donor : process;
+}
+
+/// @brief Recomputes what a process inherits from the tasks waiting for its
+///        locks, then does the same for the owner of the lock it waits for,
+///        and so on along the chain.
+/// @param process The process.
+static void __scheduler_pi_adjust(task_struct *process)
+{
+    for (int depth = 0; process && (depth < PI_MAX_CHAIN); ++depth) {
+        task_struct *donor = NULL;
+        list_for_each_decl (it, &process->se.pi_waiters) {
+            task_struct *top = __scheduler_pi_top(list_entry(it, task_struct, se.pi_list));
+            if (scheduler_algorithm_precedes(top, donor ? donor : process)) {
+                donor = top;
+            }
+        }
+        process->se.pi_donor = donor;
+        __scheduler_requeue(process, __scheduler_pi_top(process)->se.normal_policy,
+                            __scheduler_pi_top(process)->se.normal_prio);
+        process = process->se.pi_owner;
+    }
+}
+
+/// @brief Changes the policy and the priority of a process, set through the
+///        system calls, it keeps what it inherits if that comes first.
+/// @param process The process.
+/// @param policy The new policy.
+/// @param prio The new priority.
+static inline void __scheduler_set_policy(task_struct *process, int policy, int prio)
+{
+    process->se.normal_policy = policy;
+    process->se.normal_prio   = prio;
+    // The owners of the lock it waits for might inherit the new values.
+    __scheduler_pi_adjust(process);
+}
+
+/// @brief Changes the priority of a process, set through the system calls.
+/// @param process The process.
+/// @param prio The new priority.
+static inline void __scheduler_set_prio(task_struct *process, int prio)
+{
+    __scheduler_set_policy(process, process->se.normal_policy, prio);
+}
+
+void scheduler_pi_wait(task_struct *task, task_struct *owner, uint32_t key)
+{
+    assert(!task->se.pi_owner && "The task already waits for a lock.");
+    task->se.pi_owner = owner;
+    task->se.pi_key   = key;
+    list_head_insert_before(&task->se.pi_list, &owner->se.pi_waiters);
+    __scheduler_pi_adjust(owner);
+}
+
+void scheduler_pi_cancel(task_struct *task)
+{
+    task_struct *owner = task->se.pi_owner;
+    if (owner) {
+        list_head_remove(&task->se.pi_list);
+        task->se.pi_owner = NULL;
+        __scheduler_pi_adjust(owner);
+    }
+}
+
+void scheduler_pi_handover(task_struct *owner, task_struct *next, uint32_t key)
+{
+    list_for_each_safe_decl(it, store, &owner->se.pi_waiters)
+    {
+        task_struct *waiter = list_entry(it, task_struct, se.pi_list);
+        if (waiter->se.pi_key != key) {
+            continue;
+        }
+        list_head_remove(&waiter->se.pi_list);
+        // The new owner stops waiting, the others now wait for it.
+        if ((waiter == next) || !next) {
+            waiter->se.pi_owner = NULL;
+        } else {
+            waiter->se.pi_owner = next;
+            list_head_insert_before(&waiter->se.pi_list, &next->se.pi_waiters);
+        }
+    }
+    __scheduler_pi_adjust(owner);
+    if (next) {
+        __scheduler_pi_adjust(next);
+    }
+}
+
+bool_t scheduler_pi_precedes(task_struct *task, task_struct *other)
+{
+    return scheduler_algorithm_precedes(__scheduler_pi_top(task), __scheduler_pi_top(other));
+}
+
+/// @brief Adds a process to the periodic ones, keeping them sorted by
+///        period, and adds its utilization factor to the total one.
+/// @param process The process.
+static inline void __scheduler_periodic_insert(task_struct *process)
+{
+    process->se.utilization_factor =
+        process->se.period ? ((double)process->se.worst_case_exec / (double)process->se.period) : 0;
+    // The processes with the same period keep the order they came in.
+    list_head_t *it = runqueue.periodic.next;
+    for (; it != &runqueue.periodic; it = it->next) {
+        if (list_entry(it, task_struct, se.periodic_list)->se.period > process->se.period) {
+            break;
+        }
+    }
+    list_head_insert_before(&process->se.periodic_list, it);
+    runqueue.utilization += process->se.utilization_factor;
+    runqueue.num_periodic++;
+}
+
+/// @brief Removes a process from the periodic ones, and its utilization
+///        factor from the total one.
+/// @param process The process.
+static inline void __scheduler_periodic_remove(task_struct *process)
+{
+    list_head_remove(&process->se.periodic_list);
+    runqueue.utilization -= process->se.utilization_factor;
+    // Do not let the rounding errors pile up.
+    if (--runqueue.num_periodic == 0) {
+        runqueue.utilization = 0;
+    }
+}
+
+/// @brief Changes the utilization factor of a periodic process.
+/// @param process The process.
+/// @param utilization_factor The new utilization factor.
+static inline void __scheduler_set_utilization(task_struct *process, double utilization_factor)
+{
+    runqueue.utilization += utilization_factor - process->se.utilization_factor;
+    process->se.utilization_factor = utilization_factor;
+}
+
 void scheduler_enqueue_task(task_struct *process)
 {
     assert(process && "Received a NULL process.");
@@ -94,9 +444,16 @@ void scheduler_enqueue_task(task_struct *process)
         runqueue.curr = process;
     }
     // Add the new process at the end.
-    list_head_insert_before(&process->run_list, &runqueue.queue);
+    list_head_insert_before(&process->tasks, &runqueue.tasks);
+    for (int type = 0; type < PIDTYPE_MAX; ++type) {
+        list_head_insert_before(&process->pid_links[type], __pid_bucket(type, __pid_of(process, type)));
+    }
     // Increment the number of active processes.
     ++runqueue.num_active;
+    // New processes are runnable.
+    if (process->state == TASK_RUNNING) {
+        __scheduler_activate(process);
+    }
 
 #ifdef ENABLE_SCHEDULER_FEEDBACK
     scheduler_feedback_task_add(process);
@@ -106,12 +463,30 @@ void scheduler_enqueue_task(task_struct *process)
 void scheduler_dequeue_task(task_struct *process)
 {
     assert(process && "Received a NULL process.");
+    // The process might have already been removed, e.g., as a zombie.
+    if (list_head_empty(&process->tasks)) {
+        return;
+    }
     // Delete the process from the list of running processes.
-    list_head_remove(&process->run_list);
+    if (!list_head_empty(&process->run_list)) {
+        __scheduler_deactivate(process);
+    }
+    list_head_remove(&process->tasks);
+    for (int type = 0; type < PIDTYPE_MAX; ++type) {
+        list_head_remove(&process->pid_links[type]);
+    }
     // Decrement the number of active processes.
     --runqueue.num_active;
+    // Nobody inherits from, or passes anything to, a process which is gone.
+    scheduler_pi_cancel(process);
+    list_for_each_safe_decl(it, store, &process->se.pi_waiters)
+    {
+        task_struct *waiter = list_entry(it, task_struct, se.pi_list);
+        list_head_remove(&waiter->se.pi_list);
+        waiter->se.pi_owner = NULL;
+    }
     if (process->se.is_periodic) {
-        runqueue.num_periodic--;
+        __scheduler_periodic_remove(process);
     }
 
 #ifdef ENABLE_SCHEDULER_FEEDBACK
@@ -119,6 +494,310 @@ void scheduler_dequeue_task(task_struct *process)
 #endif
 }
 
+void scheduler_wake_up_task(task_struct *process, unsigned state)
+{
+    assert(process && "Received a NULL process.");
+    trace_point(TRACE_SCHED_WAKEUP, process->pid, state, 0);
+    process->state = state;
+    // The current process might not have left the queue yet.
+    if ((state == TASK_RUNNING) && list_head_empty(&process->run_list)) {
+        __scheduler_activate(process);
+    }
+}
+
+/// @brief Returns the top of the kernel stack of the given process.
+/// @param process The process.
+/// @return The address right after the end of the stack.
+static inline uintptr_t __scheduler_kernel_stack_top(task_struct *process)
+{
+    return (uintptr_t)process->thread.kernel_stack + KERNEL_THREAD_STACK_SIZE;
+}
+
+/// @brief Checks if a process, other than the current one, is ready to run.
+/// @return true if there is another runnable process, false otherwise.
+static inline bool_t __scheduler_has_other_runnable(void)
+{
+    // Only the current process can be inside the queue without being runnable.
+    return runqueue.num_running > (list_head_empty(&runqueue.curr->run_list) ? 0U : 1U);
+}
+
+/// @brief Picks the next process.
+/// @return The next process, the current one if no other process can run,
+///         or the idle task if the current one cannot run either.
+static inline task_struct *__scheduler_next(void)
+{
+    task_struct *curr     = runqueue.curr;
+    task_struct *next     = NULL;
+    runqueue.need_resched = false;
+    if (__scheduler_has_other_runnable()) {
+        next = scheduler_pick_next_task(&runqueue);
+    } else {
+        next = (curr->state == TASK_RUNNING) ? curr : &idle_task;
+    }
+    // The current process leaves the queue once it stops running, the
+    // algorithms start their search from it.
+    if ((curr->state != TASK_RUNNING) && !list_head_empty(&curr->run_list)) {
+        __scheduler_deactivate(curr);
+    }
+    return next;
+}
+
+/// @brief Prepares the kernel stack of a process which stopped in user mode,
+///        so that switching to it returns to user mode.
+/// @param process The process.
+/// @return The stack pointer to switch to.
+static inline uintptr_t __scheduler_prepare_user_return(task_struct *process)
+{
+    // Copy the registers at the top of the stack, as the interrupt entry does.
+    pt_regs_t *regs = (pt_regs_t *)__scheduler_kernel_stack_top(process) - 1;
+    *regs           = process->thread.regs;
+    // Below them, what switch_kernel_stack pops: ebp, ebx, esi, edi, and the
+    // return address.
+    uintptr_t *esp = (uintptr_t *)regs;
+    *(--esp)       = (uintptr_t)return_to_userspace;
+    for (int i = 0; i < 4; ++i) {
+        *(--esp) = 0;
+    }
+    return (uintptr_t)esp;
+}
+
+/// @brief Updates the statistics of the scheduling of the two processes of a
+///        context switch, the idle task keeps none.
+/// @param prev The process giving up the CPU.
+/// @param next The process about to run.
+static inline void __scheduler_account_switch(task_struct *prev, task_struct *next)
+{
+    unsigned long now = timer_get_ticks();
+    if (prev != &idle_task) {
+        sched_statistics_t *stats = &prev->se.stats;
+        stats->cpu_time += now - stats->last_arrival;
+        // A runnable process stays inside the queue, it waits to run again from now.
+        if (prev->state == TASK_RUNNING) {
+            ++stats->nivcsw;
+            stats->last_queued = now;
+        } else {
+            ++stats->nvcsw;
+        }
+    }
+    if (next != &idle_task) {
+        sched_statistics_t *stats = &next->se.stats;
+        unsigned long delay       = now - stats->last_queued;
+        stats->run_delay += delay;
+        stats->last_arrival = now;
+        ++stats->pcount;
+        if (stats->woken) {
+            unsigned int bucket = delay ? min(32U - __builtin_clzl(delay), SCHED_LATENCY_BUCKETS - 1U) : 0U;
+            ++stats->wakeup_latency[bucket];
+            stats->woken = false;
+            // The ticks are too coarse to tell how long the kernel kept the CPU.
+            unsigned long latency = div64_32(hrtimer_get_ns() - stats->woken_ns, 1000, NULL);
+            stats->wakeup_max     = max(stats->wakeup_max, latency);
+            trace_point(TRACE_SCHED_LATENCY, next->pid, latency, stats->wakeup_max);
+        }
+    }
+}
+
+/// @brief Switches to the kernel stack of the next process. The current
+///        process resumes from here, once it is selected again.
+/// @param next The next process.
+static void __scheduler_switch(task_struct *next)
+{
+    task_struct *prev = runqueue.curr;
+    uintptr_t esp     = next->thread.kernel_esp;
+    __scheduler_account_switch(prev, next);
+    ++runqueue.stat.switches;
+    trace_point(TRACE_SCHED_SWITCH, prev->pid, prev->state, next->pid);
+    // The hardware counters follow the processes which have events.
+    if (prev->perf || next->perf) {
+        pmu_switch(prev, next);
+    }
+    // Nobody can be reading inside the kernel while we switch.
+    rcu_note_quiescent_state();
+    // Each task finds its own sections which cannot give up the CPU.
+    prev->thread.preempt_count = __preempt_count;
+    __preempt_count            = next->thread.preempt_count;
+    // Switch to the next process.
+    runqueue.curr           = next;
+    next->thread.kernel_esp = 0;
+    vdso_switch(next);
+    // The next process enters the kernel on its own stack.
+    tss_set_stack(0x10, __scheduler_kernel_stack_top(next));
+    // Switch to process page directory, the idle task has only the kernel.
+    // Reloading the one in use would only flush the TLB, e.g., when the
+    // idle task switches back to the process it interrupted.
+    page_directory_t *pgd = next->mm ? next->mm->pgd : paging_get_main_pgd();
+    if (!is_current_pgd(pgd)) {
+        paging_switch_pgd(pgd);
+    }
+    if (!esp) {
+        esp = __scheduler_prepare_user_return(next);
+    }
+    // The FPU registers are moved only once the next process uses them.
+    switch_fpu(next);
+    // The segment of the thread-local storage is reloaded when returning to user mode.
+    gdt_set_tls(next->thread.tls_base);
+    switch_kernel_stack(&prev->thread.kernel_esp, esp);
+}
+
+static void __scheduler_idle(void)
+{
+    // Started, and resumed, by __scheduler_switch with the interrupts disabled.
+    while (true) {
+        rcu_note_quiescent_state();
+        // Give the CPU to the processes woken up by the interrupts.
+        if (__scheduler_has_other_runnable()) {
+            __scheduler_switch(__scheduler_next());
+            continue;
+        }
+        // Use the idle time to give the pages of the caches back once memory
+        // runs low, and to zero free pages, a bit at a time, letting the
+        // pending IRQs in between. Halt once there is nothing left to do.
+        if (zone_reclaim_idle() || zone_zero_idle_page()) {
+            __asm__ __volatile__("sti; nop; cli" ::: "memory");
+            continue;
+        }
+        // The `sti` takes effect after `hlt`, so the IRQ cannot be lost. The
+        // periodic tick stops until the next timer, or until another IRQ.
+        timer_nohz_enter();
+        __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+        timer_nohz_exit();
+    }
+}
+
+void schedule(void)
+{
+    task_struct *prev = runqueue.curr;
+    assert(prev && "There is no currently running process.");
+    // We might be resumed before being woken up (e.g., after a zombie).
+    while (prev->state != TASK_RUNNING) {
+        task_struct *next = __scheduler_next();
+        if (next != prev) {
+            __scheduler_switch(next);
+        }
+    }
+}
+
+void scheduler_yield(void)
+{
+    task_struct *next = __scheduler_next();
+    if (next != runqueue.curr) {
+        __scheduler_switch(next);
+    }
+}
+
+int cond_resched(void)
+{
+    task_struct *curr = runqueue.curr;
+    if (!runqueue.need_resched || preempt_count() || !curr || (curr == &idle_task) || (curr->state != TASK_RUNNING)) {
+        return 0;
+    }
+    task_struct *next = __scheduler_next();
+    if (next == curr) {
+        return 0;
+    }
+    __scheduler_switch(next);
+    return 1;
+}
+
+/// @brief Enforces the RLIMIT_CPU of the current process: past the soft limit
+///        it receives SIGXCPU, once per second, past the hard one SIGKILL.
+/// @param process The current process.
+static inline void __scheduler_check_cpu_limit(task_struct *process)
+{
+    struct rlimit *limit = &process->rlim[RLIMIT_CPU];
+    rlim_t seconds       = (process->utime + process->stime) / TICKS_PER_SECOND;
+    if (seconds >= limit->rlim_max) {
+        sys_kill(process->pid, SIGKILL);
+    } else if (seconds >= limit->rlim_cur) {
+        sys_kill(process->pid, SIGXCPU);
+        // As Linux does, the soft limit moves forward, so that the signal is
+        // sent again after another second.
+        limit->rlim_cur = seconds + 1;
+    }
+}
+
+/// @brief Checks if a process of the runqueue waits uninterruptibly, e.g., for I/O.
+/// @return true if there is one, false otherwise.
+static inline bool_t __scheduler_has_blocked(void)
+{
+    list_head_t *tasks = &runqueue.tasks;
+    list_for_each_decl (it, tasks) {
+        if (list_entry(it, task_struct, tasks)->state == TASK_UNINTERRUPTIBLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void scheduler_account_ticks(bool_t user, unsigned long ticks)
+{
+    cpu_stat_t *stat = &runqueue.stat;
+    if (runqueue.curr == &idle_task) {
+        stat->idle_ticks += ticks;
+        // The processes are walked only while the CPU has nothing else to do.
+        if (__scheduler_has_blocked()) {
+            stat->iowait_ticks += ticks;
+        }
+    } else if (user) {
+        stat->user_ticks += ticks;
+        runqueue.curr->utime += ticks;
+    } else {
+        stat->system_ticks += ticks;
+        runqueue.curr->stime += ticks;
+    }
+    if (runqueue.curr == &idle_task) {
+        return;
+    }
+    // The interval timers measuring the CPU time of the process.
+    update_process_itimers(runqueue.curr, user, ticks);
+    // Most processes have no limit, checking it costs a comparison.
+    if (runqueue.curr->rlim[RLIMIT_CPU].rlim_cur != RLIM_INFINITY) {
+        __scheduler_check_cpu_limit(runqueue.curr);
+    }
+}
+
+void scheduler_get_cpu_ticks(unsigned long *user, unsigned long *system, unsigned long *idle)
+{
+    *user   = runqueue.stat.user_ticks;
+    *system = runqueue.stat.system_ticks;
+    *idle   = runqueue.stat.idle_ticks;
+}
+
+int scheduler_get_cpu_stat(unsigned int cpu, cpu_stat_t *stat)
+{
+    if (cpu >= smp_num_cpus()) {
+        return -1;
+    }
+    *stat = per_cpu(runqueues, cpu).stat;
+    return 0;
+}
+
+void scheduler_get_task_counts(size_t *running, size_t *blocked)
+{
+    *running           = runqueue.num_running;
+    *blocked           = 0;
+    list_head_t *tasks = &runqueue.tasks;
+    list_for_each_decl (it, tasks) {
+        if (list_entry(it, task_struct, tasks)->state == TASK_UNINTERRUPTIBLE) {
+            ++(*blocked);
+        }
+    }
+}
+
+void scheduler_account_fork(void) { ++runqueue.stat.forks; }
+
+void scheduler_set_need_resched(void)
+{
+    runqueue.need_resched = true;
+}
+
+bool_t scheduler_need_resched(void)
+{
+    task_struct *curr = runqueue.curr;
+    // The masks say if a signal can be delivered, do_signal checks the handlers.
+    return runqueue.need_resched || (curr->state != TASK_RUNNING) || signal_unblocked(curr);
+}
+
 void scheduler_run(pt_regs_t *f)
 {
     // Check if there is a running process.
@@ -126,10 +805,20 @@ void scheduler_run(pt_regs_t *f)
         return;
     }
 
+    // We do not preempt kernel code, the interrupt might have been
+    // triggered while a task was waiting inside the kernel (e.g., for the
+    // completion of a disk request). Processes running inside the kernel
+    // give up the CPU only through schedule().
+    if ((f->cs & 3) != 3) {
+        return;
+    }
+    // Neither is anyone reading, when the interrupt comes from user mode.
+    rcu_note_quiescent_state();
+
     task_struct *next = NULL;
 
-    // Update the context of the current process.
-    scheduler_store_context(f, runqueue.curr);
+    // The registers of the current process stay at the top of its kernel
+    // stack, where the interrupt entry pushed them, while it is switched out.
 
     // We check the existence of pending signals every time we finish
     // handling an interrupt or an exception.
@@ -138,16 +827,11 @@ void scheduler_run(pt_regs_t *f)
         if (runqueue.curr->state == EXIT_ZOMBIE) {
             //==== Handle Zombies =================================================
             //pr_debug("Handle zombie %d\n", runqueue.curr->pid);
-            // get the next process after the current one
-            list_head_t *nNode = runqueue.curr->run_list.next;
-            // check if we reached the head of list_head_t
-            if (nNode == &runqueue.queue) {
-                nNode = nNode->next;
-            }
-            // get the task_struct
-            next = list_entry(nNode, task_struct, run_list);
+            task_struct *zombie = runqueue.curr;
+            // Pick the next process, the zombie is not runnable anymore.
+            next = __scheduler_next();
             // Remove the zombie task.
-            scheduler_dequeue_task(runqueue.curr);
+            scheduler_dequeue_task(zombie);
             assert(next && "No valid task selected after removing ZOMBIE.");
             //=====================================================================
         } else {
@@ -161,13 +845,14 @@ void scheduler_run(pt_regs_t *f)
                     return;
 #endif
             // Pointer to the next process to be executed.
-            next = scheduler_pick_next_task(&runqueue);
+            next = __scheduler_next();
             //=====================================================================
         }
-        // Check if the next and current processes are different.
+        // Check if the next and current processes are different. The current
+        // process resumes from here, and returns to user mode through the
+        // frame on its own stack.
         if (next != runqueue.curr) {
-            // Copy into Kernel stack the next process's context.
-            scheduler_restore_context(next, f);
+            __scheduler_switch(next);
         }
     }
     //==========================================================================
@@ -183,17 +868,31 @@ void scheduler_restore_context(task_struct *process, pt_regs_t *f)
 {
     // Switch to the next process.
     runqueue.curr = process;
+    vdso_switch(process);
     // Restore the registers.
     *f            = process->thread.regs;
+    // The process enters the kernel on its own stack.
+    tss_set_stack(0x10, __scheduler_kernel_stack_top(process));
     // TODO(enrico): Explain paging switch (ring 0 doesn't need page switching)
     // Switch to process page directory
     paging_switch_pgd(process->mm->pgd);
 }
 
+pt_regs_t *scheduler_get_user_regs(task_struct *process)
+{
+    // A process which has not run yet has its registers inside the
+    // task_struct, the others left them on their kernel stack, entering it
+    // from user mode.
+    if ((process == runqueue.curr) || process->thread.kernel_esp) {
+        return (pt_regs_t *)__scheduler_kernel_stack_top(process) - 1;
+    }
+    return &process->thread.regs;
+}
+
 void scheduler_enter_user_jmp(uintptr_t location, uintptr_t stack)
 {
     // Reset stack pointer for kernel.
-    tss_set_stack(0x10, initial_esp);
+    tss_set_stack(0x10, __scheduler_kernel_stack_top(runqueue.curr));
 
     // update start execution time.
     runqueue.curr->se.start_runtime = timer_get_ticks();
@@ -201,29 +900,23 @@ void scheduler_enter_user_jmp(uintptr_t location, uintptr_t stack)
     // last context switch time.
     runqueue.curr->se.exec_start = timer_get_ticks();
 
+    // The first process starts running without a context switch.
+    runqueue.curr->se.stats.last_arrival = runqueue.curr->se.exec_start;
+    runqueue.curr->se.stats.woken        = false;
+
     // Jump in location.
     enter_userspace(location, stack);
 }
 
 int is_orphaned_pgrp(pid_t pgid)
 {
-    pid_t sid = 0;
-
     // Obtain SID of the group from a member
-    list_for_each_decl (it, &runqueue.queue) {
-        task_struct *task = list_entry(it, task_struct, run_list);
-        if (task->pgid == pgid) {
-            sid = task->sid;
-            break;
-        }
-    }
+    task_struct *member = __pid_hash_find(PIDTYPE_PGID, pgid, NULL);
+    pid_t sid           = member ? member->sid : 0;
 
     // Check if the process leader of the session is alive
-    list_for_each_decl (it, &runqueue.queue) {
-        task_struct *task = list_entry(it, task_struct, run_list);
-        if (task->pid == sid) {
-            return 0;
-        }
+    if (__pid_hash_find(PIDTYPE_PID, sid, NULL)) {
+        return 0;
     }
 
     return 1;
@@ -234,7 +927,16 @@ pid_t sys_getpid(void)
     // Ensure there is a running process in the runqueue.
     assert(runqueue.curr && "There is no currently running process.");
 
-    // Return the process identifer of the process.
+    // Return the process identifer of the process, shared by its threads.
+    return runqueue.curr->tgid;
+}
+
+pid_t sys_gettid(void)
+{
+    // Ensure there is a running process in the runqueue.
+    assert(runqueue.curr && "There is no currently running process.");
+
+    // Return the identifier of the thread.
     return runqueue.curr->pid;
 }
 
@@ -249,20 +951,18 @@ pid_t sys_getsid(pid_t pid)
     }
 
     // If pid != 0, search for the process with the specified PID.
-    list_for_each_decl (it, &runqueue.queue) {
-        task_struct *task = list_entry(it, task_struct, run_list);
-        if (task->pid == pid) {
-            // Check if the current process belongs to the same session.
-            if (runqueue.curr->sid != task->sid) {
-                pr_debug(
-                    "Access denied: Process %d is not in the same session as "
-                    "the caller.",
-                    pid);
-                return -EPERM;
-            }
-            // Return the session ID of the target process.
-            return task->sid;
+    task_struct *task = scheduler_get_running_process(pid);
+    if (task) {
+        // Check if the current process belongs to the same session.
+        if (runqueue.curr->sid != task->sid) {
+            pr_debug(
+                "Access denied: Process %d is not in the same session as "
+                "the caller.",
+                pid);
+            return -EPERM;
         }
+        // Return the session ID of the target process.
+        return task->sid;
     }
 
     // If no matching process was found, return -ESRCH (No such process)
@@ -284,8 +984,8 @@ pid_t sys_setsid(void)
     }
 
     // Assign the session ID and process group ID to the current process's PID.
-    runqueue.curr->sid  = current_pid;
-    runqueue.curr->pgid = current_pid;
+    __pid_hash_change(runqueue.curr, PIDTYPE_SID, current_pid);
+    __pid_hash_change(runqueue.curr, PIDTYPE_PGID, current_pid);
 
     // Return the new session ID.
     return runqueue.curr->sid;
@@ -343,7 +1043,7 @@ int sys_setpgid(pid_t pid, pid_t pgid)
     }
 
     // Set the new process group ID.
-    task->pgid = pgid;
+    __pid_hash_change(task, PIDTYPE_PGID, pgid);
 
     pr_debug("Process %d assigned to process group %d.", task->pid, pgid);
 
@@ -460,6 +1160,42 @@ int sys_setregid(gid_t rgid, gid_t egid)
     return 0;
 }
 
+int sys_getrlimit(int resource, struct rlimit *rlim)
+{
+    if ((resource < 0) || (resource >= RLIM_NLIMITS)) {
+        return -EINVAL;
+    }
+    if (!rlim) {
+        return -EFAULT;
+    }
+    *rlim = runqueue.curr->rlim[resource];
+    return 0;
+}
+
+int sys_setrlimit(int resource, const struct rlimit *rlim)
+{
+    if ((resource < 0) || (resource >= RLIM_NLIMITS)) {
+        return -EINVAL;
+    }
+    if (!rlim) {
+        return -EFAULT;
+    }
+    if (rlim->rlim_cur > rlim->rlim_max) {
+        return -EINVAL;
+    }
+    // Only a privileged process can raise the hard limit.
+    struct rlimit *old = &runqueue.curr->rlim[resource];
+    if ((rlim->rlim_max > old->rlim_max) && (runqueue.curr->uid != 0)) {
+        return -EPERM;
+    }
+    // The table of the file descriptors cannot grow beyond its maximum.
+    if ((resource == RLIMIT_NOFILE) && (rlim->rlim_max > MAX_TASK_FD)) {
+        return -EPERM;
+    }
+    *old = *rlim;
+    return 0;
+}
+
 pid_t sys_getppid(void)
 {
     // Get the current task.
@@ -483,7 +1219,7 @@ int sys_nice(int increment)
         increment = 40;
     }
 
-    int newNice = PRIO_TO_NICE(runqueue.curr->se.prio) + increment;
+    int newNice = PRIO_TO_NICE(runqueue.curr->se.normal_prio) + increment;
     pr_debug("New nice value would be : %d\n", newNice);
 
     if (newNice < MIN_NICE) {
@@ -493,17 +1229,137 @@ int sys_nice(int increment)
         newNice = MAX_NICE;
     }
 
-    if (PRIO_TO_NICE(runqueue.curr->se.prio) != newNice && newNice >= MIN_NICE && newNice <= MAX_NICE) {
-        runqueue.curr->se.prio = NICE_TO_PRIO(newNice);
+    if (PRIO_TO_NICE(runqueue.curr->se.normal_prio) != newNice && newNice >= MIN_NICE && newNice <= MAX_NICE) {
+        __scheduler_set_prio(runqueue.curr, NICE_TO_PRIO(newNice));
     }
-    int actualNice = PRIO_TO_NICE(runqueue.curr->se.prio);
+    int actualNice = PRIO_TO_NICE(runqueue.curr->se.normal_prio);
 
     pr_debug("Actual new nice value is: %d\n", actualNice);
 
     return actualNice;
 }
 
-pid_t sys_waitpid(pid_t pid, int *status, int options)
+/// @brief Converts a number of ticks into a time value.
+/// @param ticks the ticks.
+/// @param tv where the time is stored.
+static inline void __ticks_to_timeval(unsigned long ticks, struct timeval *tv)
+{
+    tv->tv_sec  = ticks / TICKS_PER_SECOND;
+    tv->tv_usec = ((ticks % TICKS_PER_SECOND) * 1000000UL) / TICKS_PER_SECOND;
+}
+
+/// @brief Accounts the times, and the page faults, of a terminated child to
+///        its parent, and returns the resources it used.
+/// @param child the child, about to be released.
+/// @param rusage where the resources used by the child are stored, if not NULL.
+static inline void __scheduler_collect_child(task_struct *child, struct rusage *rusage)
+{
+    unsigned long utime = child->utime + child->cutime;
+    unsigned long stime = child->stime + child->cstime;
+    unsigned long minflt = child->min_flt + child->cmin_flt;
+    unsigned long majflt = child->maj_flt + child->cmaj_flt;
+    // The children of a thread are those of its process.
+    runqueue.curr->group_leader->cutime += utime;
+    runqueue.curr->group_leader->cstime += stime;
+    runqueue.curr->group_leader->cmin_flt += minflt;
+    runqueue.curr->group_leader->cmaj_flt += majflt;
+    if (rusage) {
+        memset(rusage, 0, sizeof(struct rusage));
+        __ticks_to_timeval(utime, &rusage->ru_utime);
+        __ticks_to_timeval(stime, &rusage->ru_stime);
+        rusage->ru_minflt = (long)minflt;
+        rusage->ru_majflt = (long)majflt;
+        rusage->ru_nvcsw  = (long)child->se.stats.nvcsw;
+        rusage->ru_nivcsw = (long)child->se.stats.nivcsw;
+    }
+}
+
+/// @brief Converts a number of ticks into the clock ticks of times().
+/// @param ticks the ticks.
+/// @return the clock ticks (see CLK_TCK).
+static inline clock_t __ticks_to_clock(unsigned long ticks)
+{
+    return (clock_t)(((ticks / TICKS_PER_SECOND) * CLK_TCK) +
+                     (((ticks % TICKS_PER_SECOND) * CLK_TCK) / TICKS_PER_SECOND));
+}
+
+/// @brief Sums the resources used by the threads of a process.
+/// @param leader the first thread of the process.
+/// @param utime where the ticks spent in user mode are stored.
+/// @param stime where the ticks spent inside the kernel are stored.
+/// @param usage where the page faults and the context switches are added, if not NULL.
+static inline void
+__scheduler_group_usage(task_struct *leader, unsigned long *utime, unsigned long *stime, struct rusage *usage)
+{
+    // The leader also holds the times of the threads already released.
+    *utime = leader->utime;
+    *stime = leader->stime;
+    if (usage) {
+        usage->ru_minflt += (long)leader->min_flt;
+        usage->ru_majflt += (long)leader->maj_flt;
+        usage->ru_nvcsw += (long)leader->se.stats.nvcsw;
+        usage->ru_nivcsw += (long)leader->se.stats.nivcsw;
+    }
+    list_for_each_decl (it, &leader->thread_group) {
+        task_struct *thread = list_entry(it, task_struct, thread_group);
+        *utime += thread->utime;
+        *stime += thread->stime;
+        if (usage) {
+            usage->ru_minflt += (long)thread->min_flt;
+            usage->ru_majflt += (long)thread->maj_flt;
+            usage->ru_nvcsw += (long)thread->se.stats.nvcsw;
+            usage->ru_nivcsw += (long)thread->se.stats.nivcsw;
+        }
+    }
+}
+
+clock_t sys_times(struct tms *buf)
+{
+    if (buf) {
+        task_struct *leader = runqueue.curr->group_leader;
+        unsigned long utime, stime;
+        __scheduler_group_usage(leader, &utime, &stime, NULL);
+        buf->tms_utime  = __ticks_to_clock(utime);
+        buf->tms_stime  = __ticks_to_clock(stime);
+        buf->tms_cutime = __ticks_to_clock(leader->cutime);
+        buf->tms_cstime = __ticks_to_clock(leader->cstime);
+    }
+    return __ticks_to_clock(timer_get_ticks());
+}
+
+int sys_getrusage(int who, struct rusage *usage)
+{
+    if (!usage) {
+        return -EFAULT;
+    }
+    task_struct *leader = runqueue.curr->group_leader;
+    unsigned long utime, stime;
+    memset(usage, 0, sizeof(struct rusage));
+    if (who == RUSAGE_SELF) {
+        __scheduler_group_usage(leader, &utime, &stime, usage);
+    } else if (who == RUSAGE_CHILDREN) {
+        utime            = leader->cutime;
+        stime            = leader->cstime;
+        usage->ru_minflt = (long)leader->cmin_flt;
+        usage->ru_majflt = (long)leader->cmaj_flt;
+    } else if (who == RUSAGE_THREAD) {
+        utime            = runqueue.curr->utime;
+        stime            = runqueue.curr->stime;
+        usage->ru_minflt = (long)runqueue.curr->min_flt;
+        usage->ru_majflt = (long)runqueue.curr->maj_flt;
+        usage->ru_nvcsw  = (long)runqueue.curr->se.stats.nvcsw;
+        usage->ru_nivcsw = (long)runqueue.curr->se.stats.nivcsw;
+    } else {
+        return -EINVAL;
+    }
+    __ticks_to_timeval(utime, &usage->ru_utime);
+    __ticks_to_timeval(stime, &usage->ru_stime);
+    return 0;
+}
+
+pid_t sys_waitpid(pid_t pid, int *status, int options) { return sys_wait4(pid, status, options, NULL); }
+
+pid_t sys_wait4(pid_t pid, int *status, int options, struct rusage *rusage)
 {
     // Ensure there is a running process in the runqueue.
     assert(runqueue.curr && "There is no currently running process.");
@@ -521,7 +1377,7 @@ pid_t sys_waitpid(pid_t pid, int *status, int options)
 
     // Validate the `options` argument.
     // Supported options are WNOHANG and WUNTRACED; any other value is invalid
-    if ((options != 0) && !bit_check(options, WNOHANG) && !bit_check(options, WUNTRACED)) {
+    if (options & ~(WNOHANG | WUNTRACED)) {
         return -EINVAL;
     }
 
@@ -530,46 +1386,60 @@ pid_t sys_waitpid(pid_t pid, int *status, int options)
         return -ECHILD;
     }
 
-    // Iterate through the children of the current process.
-    list_for_each_safe_decl(it, store, &runqueue.curr->children)
-    {
-        // Get the task_struct for the current child.
-        task_struct *child = list_entry(it, task_struct, sibling);
-        if (child == NULL) {
-            continue;
-        }
+    while (true) {
+        // If there is a child we can wait for.
+        bool_t found = false;
+        // Iterate through the children of the current process.
+        list_for_each_safe_decl(it, store, &runqueue.curr->children)
+        {
+            // Get the task_struct for the current child.
+            task_struct *child = list_entry(it, task_struct, sibling);
+            if (child == NULL) {
+                continue;
+            }
 
-        // If the child is not in a zombie state, keep searching.
-        if (child->state != EXIT_ZOMBIE) {
-            continue;
-        }
+            // If a specific PID is provided, skip children with different PIDs.
+            if ((pid > 0) && (child->pid != pid)) {
+                continue;
+            }
+            found = true;
 
-        // If a specific PID is provided, skip children with different PIDs.
-        if ((pid > 1) && (child->pid != pid)) {
-            continue;
-        }
+            // If the child is not in a zombie state, or if its threads are
+            // still running, keep searching.
+            if ((child->state != EXIT_ZOMBIE) || !list_head_empty(&child->thread_group)) {
+                continue;
+            }
 
-        // Prepare to return the child's PID and status
-        pid_t child_pid = child->pid;
-        if (status != NULL) {
-            *status = child->exit_code;
-        }
+            // Prepare to return the child's PID and status
+            pid_t child_pid = child->pid;
+            if (status != NULL) {
+                *status = child->exit_code;
+            }
+            __scheduler_collect_child(child, rusage);
 
-        // Clean up the child process's resources.
-        pid_manager_mark_free(child->pid); // Free the PID.
-        vfs_destroy_task(child);           // Finalize VFS structures.
-        list_head_remove(&child->sibling); // Remove from parent's child list.
-        scheduler_dequeue_task(child);     // Remove from the scheduler.
-        kmem_cache_free(child);            // Free the `task_struct`.
+            // Clean up the child process's resources.
+            process_release(child);
 
-        pr_debug("Process %d cleaned up child process %d.\n", runqueue.curr->pid, child_pid);
+            pr_debug("Process %d cleaned up child process %d.\n", runqueue.curr->pid, child_pid);
 
-        // Return the PID of the cleaned-up child.
-        return child_pid;
-    }
+            // Return the PID of the cleaned-up child.
+            return child_pid;
+        }
 
-    // No eligible child process was found.
-    return 0;
+        // The process we are waiting for is not one of our children.
+        if (!found) {
+            return -ECHILD;
+        }
+        // No eligible child process was found.
+        if (options & WNOHANG) {
+            return 0;
+        }
+        // Sleep until one of the children terminates.
+        int ret = interruptible_sleep_on(&runqueue.curr->wait_chldexit);
+        if (ret < 0) {
+            return ret;
+        }
+    }
 }
 
 void do_exit(int exit_code)
@@ -586,13 +1456,24 @@ void do_exit(int exit_code)
     runqueue.curr->exit_code = exit_code;
     // Set the state of the process to zombie.
     runqueue.curr->state     = EXIT_ZOMBIE;
-    // Send a SIGCHLD to the parent process.
-    if (runqueue.curr->parent) {
-        int ret = sys_kill(runqueue.curr->parent->pid, SIGCHLD);
+    // Stop counting its hardware events, their counts remain readable.
+    pmu_exit_task(runqueue.curr);
+    // Wake up the thread joining us, through the futex on its id.
+    if (runqueue.curr->clear_child_tid && runqueue.curr->mm) {
+        *runqueue.curr->clear_child_tid = 0;
+        sys_futex(runqueue.curr->clear_child_tid, FUTEX_WAKE, 1, NULL);
+    }
+    // Threads are released by the kernel, the others are reaped by their parent.
+    bool_t thread = runqueue.curr->group_leader != runqueue.curr;
+    if (!thread && runqueue.curr->parent) {
+        // Send the exit signal, usually SIGCHLD, to the parent process.
+        int sig = runqueue.curr->exit_signal;
+        int ret = sig ? sys_kill(runqueue.curr->parent->pid, sig) : 0;
         if (ret == -1) {
-            pr_err(
-                "[%d] %5d failed sending signal %d : %s\n", ret, runqueue.curr->parent->pid, SIGCHLD, strerror(errno));
+            pr_err("[%d] %5d failed sending signal %d : %s\n", ret, runqueue.curr->parent->pid, sig, strerror(errno));
         }
+        // Wake up the parent, if it is waiting for its children.
+        wake_up(&runqueue.curr->parent->wait_chldexit);
     }
 
     // If it has children, then init process has to take care of them.
@@ -605,10 +1486,16 @@ void do_exit(int exit_code)
             task_struct *entry = list_entry(it, task_struct, sibling);
             pr_debug("    [%d] %s\n", entry->pid, entry->name);
             entry->parent = init_process;
+            // The threads of the child have the same parent.
+            list_for_each_decl (thread_it, &entry->thread_group) {
+                list_entry(thread_it, task_struct, thread_group)->parent = init_process;
+            }
         }
         pr_debug("}\n");
         // Plug the list of children.
         list_head_append(&init_process->children, &runqueue.curr->children);
+        // Some of them might have already terminated.
+        wake_up(&init_process->wait_chldexit);
         // Print the list of children.
         pr_debug("New list of init children (%d): {\n", init_process->pid);
         list_for_each_decl (it, &init_process->children) {
@@ -617,99 +1504,160 @@ void do_exit(int exit_code)
         }
         pr_debug("}\n");
     }
-    // Free the space occupied by the stack.
-    mm_destroy(runqueue.curr->mm);
+    // The FPU registers of the process are not needed anymore.
+    fpu_release(runqueue.curr);
+    // Free the space occupied by the stack, unless it is borrowed from the parent.
+    if (runqueue.curr->vfork_parent) {
+        process_vfork_release(runqueue.curr);
+    } else if (runqueue.curr->mm) {
+        mm_put(runqueue.curr->mm);
+    }
+    // The worker releases the thread once it has switched to another task.
+    if (thread) {
+        list_head_insert_before(&runqueue.curr->sibling, &dead_threads);
+        schedule_work(&dead_threads_work);
+    }
     // Debugging message.
     pr_debug("Process %d exited with value %d\n", runqueue.curr->pid, exit_code);
 }
 
 void sys_exit(int exit_code) { do_exit(exit_code << 8); }
 
+void sys_exit_group(int exit_code)
+{
+    // Ensure there is a running process in the runqueue.
+    assert(runqueue.curr && "There is no currently running process.");
+    // The other threads exit once they see the signal.
+    zap_other_threads(runqueue.curr);
+    do_exit(exit_code << 8);
+}
+
+/// @brief Sets the periodic parameters of a process, which starts a new period.
+/// @param entry The process.
+/// @param param The parameters.
+/// @param is_periodic If the process becomes periodic.
+static inline void __scheduler_set_periodic(task_struct *entry, const sched_param_t *param, bool_t is_periodic)
+{
+    // The new period might move the process inside the list.
+    if (entry->se.is_periodic) {
+        __scheduler_periodic_remove(entry);
+    }
+    entry->se.period      = param->period;
+    entry->se.arrivaltime = param->arrivaltime;
+    entry->se.is_periodic = is_periodic;
+    entry->se.deadline    = timer_get_ticks() + param->deadline;
+    entry->se.next_period = timer_get_ticks();
+
+    entry->se.is_under_analysis = true;
+    entry->se.executed          = false;
+    if (is_periodic) {
+        __scheduler_periodic_insert(entry);
+    }
+}
+
 int sys_sched_setparam(pid_t pid, const sched_param_t *param)
 {
-    // Iter over the runqueue to find the task
-    list_for_each_decl (it, &runqueue.queue) {
-        task_struct *entry = list_entry(it, task_struct, run_list);
-        if (entry->pid == pid) {
-            if (!entry->se.is_periodic && param->is_periodic) {
-                runqueue.num_periodic++;
-            } else if (entry->se.is_periodic && !param->is_periodic) {
-                runqueue.num_periodic--;
-            }
-            // Sets the parameters from param to the "se" struct parameters.
-            entry->se.prio        = param->sched_priority;
-            entry->se.period      = param->period;
-            entry->se.arrivaltime = param->arrivaltime;
-            entry->se.is_periodic = param->is_periodic;
-            entry->se.deadline    = timer_get_ticks() + param->deadline;
-            entry->se.next_period = timer_get_ticks();
-
-            entry->se.is_under_analysis = true;
-            entry->se.executed          = false;
-            return 1;
-        }
+    task_struct *entry = scheduler_get_running_process(pid);
+    if (entry) {
+        // Sets the parameters from param to the "se" struct parameters.
+        __scheduler_set_prio(entry, param->sched_priority);
+        __scheduler_set_periodic(entry, param, param->is_periodic);
+        return 1;
     }
     return -1;
 }
 
-int sys_sched_getparam(pid_t pid, sched_param_t *param)
+int sys_sched_setscheduler(pid_t pid, int policy, const sched_param_t *param)
 {
-    // Iter over the runqueue to find the task
-    list_for_each_decl (it, &runqueue.queue) {
-        task_struct *entry = list_entry(it, task_struct, run_list);
-        if (entry->pid == pid) {
-            //Sets the parameters from the "se" struct to param
-            param->sched_priority = entry->se.prio;
-            param->period         = entry->se.period;
-            param->deadline       = entry->se.deadline;
-            param->arrivaltime    = entry->se.arrivaltime;
-            return 1;
+    task_struct *entry = pid ? scheduler_get_running_process(pid) : runqueue.curr;
+    if (!entry) {
+        return -ESRCH;
+    }
+    if (!param) {
+        return -EFAULT;
+    }
+    // Real-time processes have the priorities below MAX_RT_PRIO, the others
+    // the ones above it. Deadline processes need a period.
+    int prio = param->sched_priority;
+    if ((policy == SCHED_FIFO) || (policy == SCHED_RR)) {
+        if ((prio < 0) || (prio >= MAX_RT_PRIO)) {
+            return -EINVAL;
+        }
+    } else if ((policy == SCHED_OTHER) || (policy == SCHED_IDLE)) {
+        if ((prio < MAX_RT_PRIO) || (prio >= MAX_PRIO)) {
+            return -EINVAL;
         }
+    } else if (policy == SCHED_DEADLINE) {
+        if (!param->period || !param->deadline || (param->deadline > param->period)) {
+            return -EINVAL;
+        }
+        prio = entry->se.normal_prio;
+    } else {
+        return -EINVAL;
+    }
+    __scheduler_set_policy(entry, policy, prio);
+    // Deadline processes are periodic, the others stop being so.
+    if ((policy == SCHED_DEADLINE) || entry->se.is_periodic) {
+        __scheduler_set_periodic(entry, param, policy == SCHED_DEADLINE);
+    }
+    return 0;
+}
+
+int sys_sched_getscheduler(pid_t pid)
+{
+    task_struct *entry = pid ? scheduler_get_running_process(pid) : runqueue.curr;
+    if (!entry) {
+        return -ESRCH;
+    }
+    return entry->se.normal_policy;
+}
+
+int sys_sched_getparam(pid_t pid, sched_param_t *param)
+{
+    task_struct *entry = scheduler_get_running_process(pid);
+    if (entry) {
+        //Sets the parameters from the "se" struct to param
+        param->sched_priority = entry->se.normal_prio;
+        param->period         = entry->se.period;
+        param->deadline       = entry->se.deadline;
+        param->arrivaltime    = entry->se.arrivaltime;
+        return 1;
     }
     return -1;
 }
 
-/// @brief Performs the response time analysis for the current list of periodic
-/// processes.
-/// @return 1 if scheduling periodic processes is feasible, 0 otherwise.
-static int __response_time_analysis(void)
+/// @brief Performs the response time analysis of the periodic processes
+///        which can be delayed by the one being admitted.
+/// @details The periodic processes are sorted by period, thus by priority
+///          under rate monotonic: a process is delayed only by the ones with
+///          a shorter period, before it inside the list, and the admitted one
+///          cannot delay those coming before it.
+/// @param task The process being admitted.
+/// @return 1 if one of the processes misses its deadline, 0 otherwise.
+static int __response_time_analysis(task_struct *task)
 {
-    task_struct *entry;
-    task_struct *previous;
-    time_t r;
-    time_t previous_r = 0;
-    list_for_each_decl (it, &runqueue.queue) {
-        // Get the curent entry in the list.
-        entry = list_entry(it, task_struct, run_list);
-        // If the process is not periodic we skip it.
-        if (!entry->se.is_periodic) {
-            continue;
-        }
+    for (list_head_t *it = &task->se.periodic_list; it != &runqueue.periodic; it = it->next) {
+        task_struct *entry = list_entry(it, task_struct, se.periodic_list);
         // Put r equal to worst case exec because is the first point in time
         // that the task could possibly complete.
-        r = entry->se.worst_case_exec, previous_r = 0;
+        time_t r = entry->se.worst_case_exec, previous_r = 0;
         // The analysis can be completed either missing the deadline or reaching
         // a fixed point.
         while ((r < entry->se.deadline) && (r != previous_r)) {
-            // Save the previous response time.
             previous_r = r;
-            // Initialize response time.
             r          = entry->se.worst_case_exec;
-            list_for_each_decl (it2, &runqueue.queue) {
-                previous = list_entry(it2, task_struct, run_list);
-                // Check the interferences of higher priority processes.
-                if (previous->se.is_periodic && (previous->se.period < entry->se.period)) {
-                    pr_debug(
-                        "%d += (%.2f / %.2f) * %d\n", r, (double)previous_r, (double)previous->se.period,
-                        previous->se.worst_case_exec);
-
-                    // Update the response time.
-                    r += (int)ceil((double)previous_r / (double)previous->se.period) * previous->se.worst_case_exec;
-
-                    pr_debug("Response Time Analysis -> [%s] vs [%s] R = %d\n\n", entry->name, previous->name, r);
+            // Add the interference of the processes with a shorter period.
+            list_for_each_decl (it2, &runqueue.periodic) {
+                task_struct *previous = list_entry(it2, task_struct, se.periodic_list);
+                if (previous->se.period >= entry->se.period) {
+                    break;
+                }
+                if (previous->se.period) {
+                    r += ((previous_r + previous->se.period - 1) / previous->se.period) * previous->se.worst_case_exec;
                 }
             }
         }
+        pr_debug("Response Time Analysis -> [%s] R = %u, deadline = %u\n", entry->name, r, entry->se.deadline);
         // Feasibility of scheduler is guaranteed if and only if response time
         // analysis is lower than deadline.
         if (r > entry->se.deadline) {
@@ -719,21 +1667,10 @@ static int __response_time_analysis(void)
     return 0;
 }
 
-/// @brief Computes the total utilization factor.
-/// @return the utilization factor.
-static inline double __compute_utilization_factor(void)
+int sys_sched_yield(void)
 {
-    task_struct *entry;
-    double U = 0;
-    list_for_each_decl (it, &runqueue.queue) {
-        // Get the entry.
-        entry = list_entry(it, task_struct, run_list);
-        // Sum the utilization factor of all periodic tasks.
-        if (entry->se.is_periodic) {
-            U += entry->se.utilization_factor;
-        }
-    }
-    return U;
+    runqueue.need_resched = true;
+    return 0;
 }
 
 int sys_waitperiod(void)
@@ -759,7 +1696,7 @@ int sys_waitperiod(void)
         current->se.worst_case_exec = wcet;
     }
     // Update the utilization factor.
-    current->se.utilization_factor = ((double)current->se.worst_case_exec / (double)current->se.period);
+    __scheduler_set_utilization(current, (double)current->se.worst_case_exec / (double)current->se.period);
     // If the task is under analysis, we need to test if the process can be
     // placed with the other periodic tasks.
     if (current->se.is_under_analysis) {
@@ -768,8 +1705,8 @@ int sys_waitperiod(void)
         // This will keep track if the process can be scheduled.
         bool_t is_not_schedulable   = false;
 #if defined(SCHEDULER_EDF)
-        // Compute the total utilization factor.
-        double u = __compute_utilization_factor();
+        // The total utilization factor is kept by the runqueue.
+        double u = runqueue.utilization;
         // If the utilization factor is above 1, the process cannot be placed
         // with the other periodic processes.
         if (u > 1) {
@@ -777,8 +1714,8 @@ int sys_waitperiod(void)
         }
         pr_warning("Utilization factor is : %.2f\n", u);
 #elif defined(SCHEDULER_RM)
-        // Compute the total utilization factor.
-        double u    = __compute_utilization_factor();
+        // The total utilization factor is kept by the runqueue.
+        double u    = runqueue.utilization;
         // Calculating Least Upper Bound of utilization factor. For large amount
         // of processes ulub asymptotically should reach ln(2).
         double ulub = (runqueue.num_periodic * (pow(2, (1.0 / runqueue.num_periodic)) - 1));
@@ -789,7 +1726,7 @@ int sys_waitperiod(void)
         } else if (u <= ulub) {
             is_not_schedulable = false;
         } else {
-            is_not_schedulable = __response_time_analysis();
+            is_not_schedulable = __response_time_analysis(current);
         }
         pr_warning("Utilization factor is : %.2f, Least Upper Bound: %.2f\n", u, ulub);
 #endif
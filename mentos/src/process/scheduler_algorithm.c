@@ -11,16 +11,211 @@
 
 #include "assert.h"
 #include "hardware/timer.h"
+#include "klib/rbtree.h"
 #include "list_head.h"
 #include "process/prio.h"
 #include "process/scheduler.h"
 #include "process/scheduler_feedback.h"
 #include "process/wait.h"
+#include "sys/bitops.h"
+
+/// @brief Number of words of the bitmap of the priority queues.
+#define PRIO_BITMAP_WORDS ((MAX_PRIO + 31) / 32)
+
+/// @brief The runnable processes, grouped by priority.
+typedef struct prio_array {
+    /// Bitmap of the priorities which have at least one runnable process.
+    uint32_t bitmap[PRIO_BITMAP_WORDS];
+    /// The queues of the runnable processes, one for each priority.
+    list_head_t queues[MAX_PRIO];
+    /// If the queues have been initialized.
+    bool_t initialized;
+} prio_array_t;
+
+/// @brief A scheduling class, with the structures holding its runnable
+///        processes. The processes of a class run only when no process of the
+///        classes before it can run.
+typedef struct sched_class {
+    /// Places a runnable process inside the structures of the class.
+    void (*enqueue)(task_struct *process);
+    /// Removes a process from the structures of the class.
+    void (*dequeue)(task_struct *process);
+    /// Picks the next process of the class, NULL if none of them can run.
+    task_struct *(*pick_next)(runqueue_t *runqueue);
+} sched_class_t;
+
+/// The runnable real-time processes (SCHED_FIFO and SCHED_RR).
+static prio_array_t rt_array;
+/// The runnable deadline processes (SCHED_DEADLINE).
+static list_head_t dl_queue = { .prev = &dl_queue, .next = &dl_queue };
+/// The runnable processes which run only when no other one can (SCHED_IDLE).
+static list_head_t idle_queue = { .prev = &idle_queue, .next = &idle_queue };
+
+#ifdef SCHEDULER_O1
+/// The runnable processes of the O(1) scheduler.
+static prio_array_t prio_array;
+#endif
+
+/// @brief Returns the queue of a process, the priorities outside the valid
+///        range are clamped to it.
+/// @param task the process.
+/// @return the index of the queue.
+static inline int __prio_array_index(task_struct *task)
+{
+    return max(0, min(task->se.prio, MAX_PRIO - 1));
+}
+
+/// @brief Places a process behind the others of its priority.
+/// @param array the queues of the processes.
+/// @param task the process.
+static inline void __prio_array_enqueue(prio_array_t *array, task_struct *task)
+{
+    if (!array->initialized) {
+        for (int prio = 0; prio < MAX_PRIO; ++prio) {
+            list_head_init(&array->queues[prio]);
+        }
+        array->initialized = true;
+    }
+    int prio = __prio_array_index(task);
+    list_head_insert_before(&task->se.prio_list, &array->queues[prio]);
+    bit_set_assign(array->bitmap[prio / 32], prio % 32);
+}
+
+/// @brief Removes a process from the queue of its priority.
+/// @param array the queues of the processes.
+/// @param task the process.
+static inline void __prio_array_dequeue(prio_array_t *array, task_struct *task)
+{
+    int prio = __prio_array_index(task);
+    list_head_remove(&task->se.prio_list);
+    if (list_head_empty(&array->queues[prio])) {
+        bit_clear_assign(array->bitmap[prio / 32], prio % 32);
+    }
+}
+
+/// @brief Moves a process behind the others of its priority.
+/// @param array the queues of the processes.
+/// @param task the process.
+static inline void __prio_array_requeue(prio_array_t *array, task_struct *task)
+{
+    list_head_remove(&task->se.prio_list);
+    list_head_insert_before(&task->se.prio_list, &array->queues[__prio_array_index(task)]);
+}
+
+/// @brief Returns the first runnable process with the highest priority: a
+///        bitmap tells which priorities have a process, and the first bit set
+///        gives the queue to take the process from.
+/// @param array the queues of the processes.
+/// @return the process, NULL if none of them can run.
+static inline task_struct *__prio_array_first(prio_array_t *array)
+{
+    for (int word = 0; word < PRIO_BITMAP_WORDS; ++word) {
+        for (uint32_t bits = array->bitmap[word]; bits; bits &= bits - 1) {
+            list_head_t *queue = &array->queues[word * 32 + __builtin_ctz(bits)];
+            list_for_each_decl (it, queue) {
+                task_struct *entry = list_entry(it, task_struct, se.prio_list);
+                // Only the current process might be queued without being runnable.
+                if (entry->state == TASK_RUNNING) {
+                    return entry;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/// @brief Weights the runtime of a process by NICE_0_LOAD / weight, in
+///        fixed-point arithmetic: the inverse of the weight is scaled by 2^32.
+/// @param runtime the runtime.
+/// @param prio the priority of the process.
+/// @return the weighted runtime.
+static inline time_t __weighted_runtime(time_t runtime, int prio)
+{
+    // Real-time priorities have no weight, compute it only if it is different
+    // from the default load.
+    if ((prio < MAX_RT_PRIO) || (GET_WEIGHT(prio) == NICE_0_LOAD)) {
+        return runtime;
+    }
+    uint64_t delta = (uint64_t)runtime * NICE_0_LOAD;
+    return (time_t)((delta * GET_WMULT(prio)) >> 32);
+}
+
+#ifdef SCHEDULER_CFS
+/// The vruntime, in ticks, a woken process must be behind the current one
+/// to preempt it, so that processes waking up often do not switch every time.
+#define CFS_WAKEUP_GRANULARITY (TICKS_PER_SECOND / 1000)
+
+/// The runnable processes of the CFS, ordered by vruntime.
+static rbtree_t *cfs_tree = NULL;
+/// The process with the smallest vruntime inside the tree.
+static task_struct *cfs_leftmost = NULL;
+/// The smallest vruntime of the runnable processes at the last pick. It
+/// never decreases, and the processes which wake up start from it.
+static time_t cfs_min_vruntime = 0;
+/// The nodes removed from the tree, reused to insert the next processes.
+static rbtree_node_t *cfs_free_nodes[MAX_PROCESSES];
+/// The number of nodes inside cfs_free_nodes.
+static unsigned int cfs_nr_free_nodes = 0;
+
+/// @brief Compares two processes by vruntime, and by pid when it is the same.
+/// @param a the first process.
+/// @param b the second process.
+/// @return the result of the comparison.
+static inline int __cfs_compare_tasks(task_struct *a, task_struct *b)
+{
+    if (a->se.vruntime != b->se.vruntime) {
+        return (a->se.vruntime > b->se.vruntime) - (a->se.vruntime < b->se.vruntime);
+    }
+    return (a->pid > b->pid) - (a->pid < b->pid);
+}
+
+/// @brief Compares the processes of two nodes of the tree.
+/// @param tree the tree.
+/// @param a the node of the first process.
+/// @param b the node of the second process.
+/// @return the result of the comparison.
+static int __cfs_compare(rbtree_t *tree, rbtree_node_t *a, rbtree_node_t *b)
+{
+    return __cfs_compare_tasks(rbtree_node_get_value(a), rbtree_node_get_value(b));
+}
+
+/// @brief Keeps a node removed from the tree, for the next insertion.
+/// @param tree the tree.
+/// @param node the node.
+static void __cfs_release_node(rbtree_t *tree, rbtree_node_t *node)
+{
+    if (cfs_nr_free_nodes < MAX_PROCESSES) {
+        cfs_free_nodes[cfs_nr_free_nodes++] = node;
+    } else {
+        rbtree_node_dealloc(node);
+    }
+}
+
+/// @brief Searches for the process with the smallest vruntime inside the tree.
+/// @return the process, NULL if the tree is empty.
+static inline task_struct *__cfs_first(void)
+{
+    rbtree_node_t *node = rbtree_tree_get_root(cfs_tree);
+    while (node && rbtree_node_get_child(node, 0)) {
+        node = rbtree_node_get_child(node, 0);
+    }
+    return node ? rbtree_node_get_value(node) : NULL;
+}
+#endif
 
 /// @brief Updates task execution statistics.
 /// @param task the task to update.
 static void __update_task_statistics(task_struct *task);
 
+/// @brief Checks if a process is runnable, and handled by the algorithm
+///        chosen at build time, which searches the whole queue.
+/// @param task the task to check.
+/// @return true if the task is a runnable SCHED_OTHER one, false otherwise.
+static inline bool_t __is_fair_runnable(task_struct *task)
+{
+    return (task->state == TASK_RUNNING) && (task->se.policy == SCHED_OTHER);
+}
+
 /// @brief Checks if the given task is actually a periodic task.
 /// @param task the task to check.
 /// @return true if the task is periodic, false otherwise.
@@ -33,28 +228,32 @@ static inline bool_t __is_periodic_task(task_struct *task)
 /// @brief Employs time-sharing, giving each job a time-slot, and is also
 /// preemptive since the scheduler forces the task out of the CPU once
 /// the time-slot expires.
-/// @param runqueue list of all processes.
+/// @param runqueue queue of the runnable processes.
 /// @param skip_periodic tells the algorithm that periodic processes in the list
 /// should be skipped.
 /// @return the next task on success, NULL on failure.
 static inline task_struct *__scheduler_rr(runqueue_t *runqueue, bool_t skip_periodic)
 {
-    // If there is just one task, return it; no need to do anything.
-    if (list_head_size(&runqueue->curr->run_list) <= 1) {
+    // The idle task is not inside the queue, start from the head then.
+    list_head_t *start = &runqueue->curr->run_list;
+    if (list_head_empty(start)) {
+        start = &runqueue->queue;
+    } else if (list_head_size(start) <= 1) {
+        // If there is just one task, return it; no need to do anything.
         return runqueue->curr;
     }
     // This will hold a given entry, while iterating the list of tasks.
     task_struct *entry = NULL;
     // Search for the next task (we do not start from the head, so INSIDE, skip the head).
-    list_for_each_decl (it, &runqueue->curr->run_list) {
+    list_for_each_decl (it, start) {
         // Check if we reached the head of list_head, and skip it.
         if (it == &runqueue->queue) {
             continue;
         }
         // Get the current entry.
         entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes.
-        if (entry->state != TASK_RUNNING) {
+        // We consider only runnable processes, of the default class.
+        if (!__is_fair_runnable(entry)) {
             continue;
         }
         // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
@@ -73,7 +272,7 @@ static inline task_struct *__scheduler_rr(runqueue_t *runqueue, bool_t skip_peri
 /// processes with same priority are executed on first-come/first-served basis.
 /// Priority can be decided based on memory requirements, time requirements or
 /// any other resource requirement.
-/// @param runqueue list of all processes.
+/// @param runqueue queue of the runnable processes.
 /// @param skip_periodic tells the algorithm if there are periodic processes in
 /// the list, and in that case it needs to skip them.
 /// @return the next task on success, NULL on failure.
@@ -111,8 +310,8 @@ static inline task_struct *__scheduler_priority(runqueue_t *runqueue, bool_t ski
             continue;
         // Get the current entry.
         entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes
-        if (entry->state != TASK_RUNNING)
+        // We consider only runnable processes, of the default class.
+        if (!__is_fair_runnable(entry))
             continue;
         // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
         if (__is_periodic_task(entry) && skip_periodic)
@@ -129,43 +328,89 @@ static inline task_struct *__scheduler_priority(runqueue_t *runqueue, bool_t ski
 #endif
 }
 
+/// @brief Picks the process with the highest priority in constant time: a
+/// bitmap tells which priorities have a runnable process, and the first bit
+/// set gives the queue to take the process from. Processes with a real-time
+/// priority (below MAX_RT_PRIO) run until they stop (FIFO), while the others
+/// take turns with those of the same priority (RR).
+/// @param runqueue queue of the runnable processes.
+/// @return the next task on success, NULL on failure.
+static inline task_struct *__scheduler_o1(runqueue_t *runqueue)
+{
+#ifdef SCHEDULER_O1
+    task_struct *curr = runqueue->curr;
+    // The current process goes behind the others of its priority.
+    if ((curr->se.policy == SCHED_OTHER) && !list_head_empty(&curr->se.prio_list) &&
+        (__prio_array_index(curr) >= MAX_RT_PRIO)) {
+        __prio_array_requeue(&prio_array, curr);
+    }
+    return __prio_array_first(&prio_array);
+#else
+    return __scheduler_rr(runqueue, false);
+#endif
+}
+
+/// @brief Places a process inside the structures of the algorithm chosen at build time.
+/// @param process the process.
+static void __fair_enqueue(task_struct *process)
+{
+#ifdef SCHEDULER_O1
+    __prio_array_enqueue(&prio_array, process);
+#elif defined(SCHEDULER_CFS)
+    if (!cfs_tree && !(cfs_tree = rbtree_tree_create(__cfs_compare))) {
+        pr_crit("Failed to allocate the tree of the runnable processes.\n");
+        return;
+    }
+    // The processes which wake up do not catch up for the time they slept.
+    process->se.vruntime = max(process->se.vruntime, cfs_min_vruntime);
+    rbtree_node_t *node  = cfs_nr_free_nodes ? cfs_free_nodes[--cfs_nr_free_nodes] : rbtree_node_alloc();
+    if (!node) {
+        pr_crit("Failed to allocate the node of process %d.\n", process->pid);
+        return;
+    }
+    rbtree_tree_insert_node(cfs_tree, rbtree_node_init(node, process));
+    if (!cfs_leftmost || (__cfs_compare_tasks(process, cfs_leftmost) < 0)) {
+        cfs_leftmost = process;
+    }
+#endif
+}
+
+/// @brief Removes a process from the structures of the algorithm chosen at build time.
+/// @param process the process.
+static void __fair_dequeue(task_struct *process)
+{
+#ifdef SCHEDULER_O1
+    __prio_array_dequeue(&prio_array, process);
+#elif defined(SCHEDULER_CFS)
+    // The process might have already left the tree (see scheduler_pick_next_task).
+    if (cfs_tree && rbtree_tree_remove_with_cb(cfs_tree, process, __cfs_release_node) && (cfs_leftmost == process)) {
+        cfs_leftmost = __cfs_first();
+    }
+#endif
+}
+
 /// @brief It aims at giving a fair share of CPU time to processes, and achieves
 /// that by associating a virtual runtime to each of them. It always tries to
 /// run the task with the smallest vruntime (i.e., the task which executed least
 /// so far). It always tries to split up CPU time between runnable tasks as
 /// close to "ideal multitasking hardware" as possible.
-/// @param runqueue list of all processes.
-/// @param skip_periodic tells the algorithm if there are periodic processes in
-/// the list, and in that case it needs to skip them.
+/// @param runqueue queue of the runnable processes.
+/// @param skip_periodic not used, periodic processes are ordered by vruntime
+/// with the others.
 /// @return the next task on success, NULL on failure.
+/// @details
+/// The runnable processes are kept inside a red/black tree ordered by
+/// vruntime, with its leftmost process cached, so that picking it takes
+/// constant time and placing a process inside the tree logarithmic time.
 static inline task_struct *__scheduler_cfs(runqueue_t *runqueue, bool_t skip_periodic)
 {
 #ifdef SCHEDULER_CFS
-    // Get the first element of the list.
-    task_struct *next  = list_entry(runqueue->queue.next, struct task_struct, run_list);
-    // This will hold a given entry, while iterating the list of tasks.
-    task_struct *entry = NULL;
-    // Get the virtual runtime of the first element of the list we just extracted.
-    time_t min         = /*...*/;
-
-    // Search for the task with the smallest vruntime value.
-    list_for_each_decl (it, &runqueue->queue) {
-        // Check if we reached the head of list_head, and skip it.
-        if (it == &runqueue->queue)
-            continue;
-        // Get the current entry.
-        entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes
-        if (entry->state != TASK_RUNNING)
-            continue;
-        // If entry is a periodic task, and we were asked to skip periodic tasks, skip it.
-        if (__is_periodic_task(entry) && skip_periodic)
-            continue;
-
-        // Check if the element in the list has a smaller vruntime value.
-        /* ... */
+    // The leftmost process has the smallest vruntime, the tree holds only
+    // runnable processes.
+    task_struct *next = cfs_leftmost;
+    if (next) {
+        cfs_min_vruntime = max(cfs_min_vruntime, next->se.vruntime);
     }
-
     return next;
 #else
     return __scheduler_rr(runqueue, skip_periodic);
@@ -174,7 +419,7 @@ static inline task_struct *__scheduler_cfs(runqueue_t *runqueue, bool_t skip_per
 
 /// @brief Executes the task with the earliest absolute deadline among all the
 /// ready tasks.
-/// @param runqueue list of all processes.
+/// @param runqueue queue of the runnable processes.
 /// @return the next task on success, NULL on failure.
 static inline task_struct *__scheduler_aedf(runqueue_t *runqueue)
 {
@@ -193,8 +438,8 @@ static inline task_struct *__scheduler_aedf(runqueue_t *runqueue)
             continue;
         // Get the current entry.
         entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes
-        if (entry->state != TASK_RUNNING)
+        // We consider only runnable processes, of the default class.
+        if (!__is_fair_runnable(entry))
             continue;
         // If entry is not a periodic task, skip it.
         if (!__is_periodic_task(entry))
@@ -231,7 +476,7 @@ static inline task_struct *__scheduler_aedf(runqueue_t *runqueue)
 /// ready tasks. When a task was executed, and its period is starting again, it
 /// must be set as 'executable again', and its deadline and next_period must be
 /// updated.
-/// @param runqueue list of all processes.
+/// @param runqueue queue of the runnable processes.
 /// @return the next task on success, NULL on failure.
 static inline task_struct *__scheduler_edf(runqueue_t *runqueue)
 {
@@ -250,8 +495,8 @@ static inline task_struct *__scheduler_edf(runqueue_t *runqueue)
             continue;
         // Get the current entry.
         entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes
-        if (entry->state != TASK_RUNNING)
+        // We consider only runnable processes, of the default class.
+        if (!__is_fair_runnable(entry))
             continue;
         // If entry is not a periodic task, skip it.
         if (!__is_periodic_task(entry))
@@ -297,7 +542,7 @@ static inline task_struct *__scheduler_edf(runqueue_t *runqueue)
 /// @details When a task was executed, and its period is starting again, it must
 /// be set as 'executable again', and its deadline and next_period must be
 /// updated.
-/// @param runqueue list of all processes.
+/// @param runqueue queue of the runnable processes.
 /// @return the next task on success, NULL on failure.
 static inline task_struct *__scheduler_rm(runqueue_t *runqueue)
 {
@@ -316,8 +561,8 @@ static inline task_struct *__scheduler_rm(runqueue_t *runqueue)
             continue;
         // Get the current entry.
         entry = list_entry(it, task_struct, run_list);
-        // We consider only runnable processes
-        if (entry->state != TASK_RUNNING)
+        // We consider only runnable processes, of the default class.
+        if (!__is_fair_runnable(entry))
             continue;
         // If entry is not a periodic task, skip it.
         if (!__is_periodic_task(entry))
@@ -358,28 +603,294 @@ static inline task_struct *__scheduler_rm(runqueue_t *runqueue)
     return __scheduler_rr(runqueue, false);
 }
 
-task_struct *scheduler_pick_next_task(runqueue_t *runqueue)
+/// @brief Picks the next process of the default class (SCHED_OTHER), with
+/// the algorithm chosen at build time.
+/// @param runqueue queue of the runnable processes.
+/// @return the next task on success, NULL on failure.
+static task_struct *__fair_pick_next(runqueue_t *runqueue)
 {
-    // Update task statistics.
-    __update_task_statistics(runqueue->curr);
-
-    // Pointer to the next task to schedule.
-    task_struct *next = NULL;
 #if defined(SCHEDULER_RR)
-    next = __scheduler_rr(runqueue, false);
+    return __scheduler_rr(runqueue, false);
 #elif defined(SCHEDULER_PRIORITY)
-    next = __scheduler_priority(runqueue, false);
+    return __scheduler_priority(runqueue, false);
+#elif defined(SCHEDULER_O1)
+    return __scheduler_o1(runqueue);
 #elif defined(SCHEDULER_CFS)
-    next = __scheduler_cfs(runqueue, false);
+    return __scheduler_cfs(runqueue, false);
 #elif defined(SCHEDULER_EDF)
-    next = __scheduler_edf(runqueue);
+    return __scheduler_edf(runqueue);
 #elif defined(SCHEDULER_RM)
-    next = __scheduler_rm(runqueue);
+    return __scheduler_rm(runqueue);
 #elif defined(SCHEDULER_AEDF)
-    next = __scheduler_aedf(runqueue);
+    return __scheduler_aedf(runqueue);
 #else
 #error "You should enable a scheduling algorithm!"
 #endif
+}
+
+/// @brief Checks if a woken process of the default policy should preempt the
+///        current one, of the same policy.
+/// @param curr the current process.
+/// @param woken the woken process.
+/// @return true if the woken process should run first, false otherwise.
+static inline bool_t __fair_check_preempt(task_struct *curr, task_struct *woken)
+{
+#if defined(SCHEDULER_CFS)
+    // The vruntime of the current process is updated only when the next one
+    // is picked, add what it has run since then.
+    time_t runtime = __weighted_runtime(timer_get_ticks() - curr->se.exec_start, curr->se.prio);
+    return (woken->se.vruntime + CFS_WAKEUP_GRANULARITY) < (curr->se.vruntime + runtime);
+#elif defined(SCHEDULER_PRIORITY) || defined(SCHEDULER_O1)
+    return woken->se.prio < curr->se.prio;
+#else
+    // The other algorithms wait for the next tick.
+    return false;
+#endif
+}
+
+/// @brief Places a real-time process behind the others of its priority.
+/// @param process the process.
+static void __rt_enqueue(task_struct *process)
+{
+    __prio_array_enqueue(&rt_array, process);
+}
+
+/// @brief Removes a real-time process from the queue of its priority.
+/// @param process the process.
+static void __rt_dequeue(task_struct *process)
+{
+    __prio_array_dequeue(&rt_array, process);
+}
+
+/// @brief Picks the real-time process with the highest priority. SCHED_FIFO
+/// processes run until they stop, while SCHED_RR ones take turns with those of
+/// the same priority.
+/// @param runqueue queue of the runnable processes.
+/// @return the next task on success, NULL on failure.
+static task_struct *__rt_pick_next(runqueue_t *runqueue)
+{
+    task_struct *curr = runqueue->curr;
+    if ((curr->se.policy == SCHED_RR) && !list_head_empty(&curr->se.prio_list)) {
+        __prio_array_requeue(&rt_array, curr);
+    }
+    return __prio_array_first(&rt_array);
+}
+
+/// @brief Places a process at the end of the queue of its class.
+/// @param process the process.
+static void __list_enqueue(task_struct *process)
+{
+    list_head_insert_before(&process->se.prio_list, process->se.policy == SCHED_DEADLINE ? &dl_queue : &idle_queue);
+}
+
+/// @brief Removes a process from the queue of its class.
+/// @param process the process.
+static void __list_dequeue(task_struct *process)
+{
+    list_head_remove(&process->se.prio_list);
+}
+
+/// @brief Returns the absolute deadline of a deadline process, the one of
+///        its donor while it holds a lock wanted by a deadline process.
+/// @param task the process.
+/// @return the deadline.
+static inline time_t __dl_deadline(task_struct *task)
+{
+    return task->se.pi_donor ? task->se.pi_donor->se.deadline : task->se.deadline;
+}
+
+/// @brief Picks the deadline process with the earliest absolute deadline,
+/// among those which did not run yet in their period. Once their next period
+/// starts, their deadline moves forward by one period. The processes running
+/// with the deadline of a donor keep running until they release its lock.
+/// @param runqueue queue of the runnable processes.
+/// @return the next task on success, NULL on failure.
+static task_struct *__dl_pick_next(runqueue_t *runqueue)
+{
+    task_struct *next = NULL;
+    time_t now        = timer_get_ticks();
+    list_for_each_decl (it, &dl_queue) {
+        task_struct *entry = list_entry(it, task_struct, se.prio_list);
+        if (entry->state != TASK_RUNNING) {
+            continue;
+        }
+        if (entry->se.pi_donor) {
+            if (!next || (__dl_deadline(entry) < __dl_deadline(next))) {
+                next = entry;
+            }
+            continue;
+        }
+        if (entry->se.executed && ((entry->se.next_period + entry->se.period) <= now)) {
+            entry->se.executed = false;
+            entry->se.next_period += entry->se.period;
+            entry->se.deadline += entry->se.period;
+        }
+        if (!entry->se.executed && (!next || (entry->se.deadline < __dl_deadline(next)))) {
+            next = entry;
+        }
+    }
+    return next;
+}
+
+/// @brief Picks the processes which run only when no other one can, in turns.
+/// @param runqueue queue of the runnable processes.
+/// @return the next task on success, NULL on failure.
+static task_struct *__idle_pick_next(runqueue_t *runqueue)
+{
+    task_struct *curr = runqueue->curr;
+    if ((curr->se.policy == SCHED_IDLE) && !list_head_empty(&curr->se.prio_list)) {
+        list_head_remove(&curr->se.prio_list);
+        list_head_insert_before(&curr->se.prio_list, &idle_queue);
+    }
+    list_for_each_decl (it, &idle_queue) {
+        task_struct *entry = list_entry(it, task_struct, se.prio_list);
+        if (entry->state == TASK_RUNNING) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/// The deadline processes.
+static const sched_class_t dl_sched_class = { __list_enqueue, __list_dequeue, __dl_pick_next };
+/// The real-time processes.
+static const sched_class_t rt_sched_class = { __rt_enqueue, __rt_dequeue, __rt_pick_next };
+/// The processes of the default policy, handled by the algorithm chosen at build time.
+static const sched_class_t fair_sched_class = { __fair_enqueue, __fair_dequeue, __fair_pick_next };
+/// The processes which run only when no other one can.
+static const sched_class_t idle_sched_class = { __list_enqueue, __list_dequeue, __idle_pick_next };
+
+/// The scheduling classes, from the one whose processes run first.
+static const sched_class_t *sched_classes[] = {
+    &dl_sched_class, &rt_sched_class, &fair_sched_class, &idle_sched_class };
+
+/// @brief Returns the scheduling class of a policy.
+/// @param policy the policy.
+/// @return the class of the policy.
+static inline const sched_class_t *__sched_class_of_policy(int policy)
+{
+    switch (policy) {
+    case SCHED_DEADLINE:
+        return &dl_sched_class;
+    case SCHED_FIFO:
+    case SCHED_RR:
+        return &rt_sched_class;
+    case SCHED_IDLE:
+        return &idle_sched_class;
+    default:
+        return &fair_sched_class;
+    }
+}
+
+/// @brief Returns the scheduling class of a process.
+/// @param process the process.
+/// @return the class of its policy.
+static inline const sched_class_t *__sched_class_of(task_struct *process)
+{
+    return __sched_class_of_policy(process->se.policy);
+}
+
+/// @brief Tells if a class runs its processes before another one.
+/// @param class the class.
+/// @param other the other class.
+/// @return true if the class comes first, false otherwise.
+static inline bool_t __sched_class_before(const sched_class_t *class, const sched_class_t *other)
+{
+    // The classes are in order, the one found first runs first.
+    for (unsigned i = 0; (i < count_of(sched_classes)) && (class != other); ++i) {
+        if (sched_classes[i] == class) {
+            return true;
+        }
+        if (sched_classes[i] == other) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void scheduler_algorithm_enqueue(task_struct *process)
+{
+    __sched_class_of(process)->enqueue(process);
+}
+
+void scheduler_algorithm_dequeue(task_struct *process)
+{
+    __sched_class_of(process)->dequeue(process);
+}
+
+bool_t scheduler_algorithm_check_preempt(task_struct *curr, task_struct *woken)
+{
+    const sched_class_t *curr_class  = __sched_class_of(curr);
+    const sched_class_t *woken_class = __sched_class_of(woken);
+    if (curr_class != woken_class) {
+        return __sched_class_before(woken_class, curr_class);
+    }
+    if (woken_class == &dl_sched_class) {
+        return __dl_deadline(woken) < __dl_deadline(curr);
+    }
+    if (woken_class == &rt_sched_class) {
+        return woken->se.prio < curr->se.prio;
+    }
+    if (woken_class == &fair_sched_class) {
+        return __fair_check_preempt(curr, woken);
+    }
+    return false;
+}
+
+bool_t scheduler_algorithm_precedes(task_struct *process, task_struct *other)
+{
+    const sched_class_t *class       = __sched_class_of_policy(process->se.normal_policy);
+    const sched_class_t *other_class = __sched_class_of_policy(other->se.normal_policy);
+    if (class != other_class) {
+        return __sched_class_before(class, other_class);
+    }
+    if (class == &dl_sched_class) {
+        return process->se.deadline < other->se.deadline;
+    }
+    if (class == &idle_sched_class) {
+        return false;
+    }
+    // Both the real-time and the default policies have a priority.
+    return process->se.normal_prio < other->se.normal_prio;
+}
+
+task_struct *scheduler_pick_next_task(runqueue_t *runqueue)
+{
+    task_struct *curr = runqueue->curr;
+#ifdef SCHEDULER_CFS
+    // The tree is ordered by vruntime: the current process leaves it while its
+    // vruntime is updated, and goes back only if it is still runnable.
+    if (curr->se.policy == SCHED_OTHER) {
+        __fair_dequeue(curr);
+        __update_task_statistics(curr);
+        if ((curr->state == TASK_RUNNING) && !list_head_empty(&curr->run_list)) {
+            __fair_enqueue(curr);
+        }
+    } else {
+        __update_task_statistics(curr);
+    }
+#else
+    // Update task statistics.
+    __update_task_statistics(curr);
+#endif
+
+    // Pointer to the next task to schedule.
+    task_struct *next = NULL;
+    // Ask the classes in order, the first one with a runnable process wins.
+    for (unsigned i = 0; !next && (i < count_of(sched_classes)); ++i) {
+        next = sched_classes[i]->pick_next(runqueue);
+    }
+    // Only the deadline processes which already ran in their period are left,
+    // they keep running until one of them starts a new period.
+    if (!next) {
+        list_for_each_decl (it, &runqueue->queue) {
+            task_struct *entry = list_entry(it, task_struct, run_list);
+            if (entry->state == TASK_RUNNING) {
+                next = entry;
+                break;
+            }
+        }
+    }
 
     assert(next && "No valid task selected by the scheduling algorithm.");
 
@@ -408,25 +919,13 @@ static void __update_task_statistics(task_struct *task)
     // Update the delta exec.
     task->se.exec_runtime = timer_get_ticks() - task->se.exec_start;
 
-    // Perform timer-related checks.
-    update_process_profiling_timer(task);
-
     // Set the sum_exec_runtime.
     task->se.sum_exec_runtime += task->se.exec_runtime;
 
     // If the task is not a periodic task we have to update the virtual runtime.
     if (!task->se.is_periodic) {
-        // Get the weight of the current task.
-        time_t weight = GET_WEIGHT((task)->se.prio); /* ... */
-        ;
-        // If the weight is different from the default load, compute it.
-        if (weight != NICE_0_LOAD) {
-            // Get the multiplicative factor for its delta_exec.
-            double factor = ((double)NICE_0_LOAD / (double)weight); /* ... */
-            ;
-            // Weight the delta_exec with the multiplicative factor.
-            task->se.exec_runtime = ((int)(((double)task->se.exec_runtime) * factor)); /* ... */
-        }
+        // Weight the delta_exec by the priority of the task.
+        task->se.exec_runtime = __weighted_runtime(task->se.exec_runtime, task->se.prio);
         // Update vruntime of the current task.
         task->se.vruntime += task->se.exec_runtime;
     }
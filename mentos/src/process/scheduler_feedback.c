@@ -28,6 +28,8 @@
 #define POLICY_NAME "RR   "
 #elif defined(SCHEDULER_PRIORITY)
 #define POLICY_NAME "PRIO "
+#elif defined(SCHEDULER_O1)
+#define POLICY_NAME "O1   "
 #elif defined(SCHEDULER_CFS)
 #define POLICY_NAME "CFS  "
 #elif defined(SCHEDULER_EDF)
@@ -12,9 +12,11 @@
 #include "process/wait.h"
 
 #include "assert.h"
+#include "errno.h"
 #include "mem/alloc/slab.h"
 #include "process/scheduler.h"
 #include "string.h"
+#include "system/signal.h"
 
 /// @brief Adds the entry to the wait queue.
 /// @param head the wait queue.
@@ -64,7 +66,7 @@ int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
     // Only wake up tasks in TASK_INTERRUPTIBLE or TASK_UNINTERRUPTIBLE states.
     if ((entry->task->state == TASK_INTERRUPTIBLE) || (entry->task->state == TASK_UNINTERRUPTIBLE)) {
         // Set the task state to the specified mode.
-        entry->task->state = mode;
+        scheduler_wake_up_task(entry->task, mode);
 
         // Optionally handle sync-specific operations here if needed.
         // For now, sync is unused.
@@ -76,6 +78,21 @@ int default_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
     return 0;
 }
 
+/// @brief The wake function of the entries placed on the stack of the
+///        sleeping process, by interruptible_sleep_on().
+/// @param entry The entry of the sleeping process.
+/// @param mode The state the task is set to.
+/// @param sync Specifies if the wakeup should be synchronous.
+/// @return always 0, the entry must not be freed by whoever wakes it up.
+static int __autoremove_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
+{
+    default_wake_function(entry, mode, sync);
+    // Remove the entry, the queue might be freed before the task runs again
+    // (e.g., when an IPC object is removed).
+    list_head_remove(&entry->task_list);
+    return 0;
+}
+
 void wait_queue_head_init(wait_queue_head_t *head)
 {
     // Validate the input.
@@ -152,6 +169,23 @@ void add_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *entry)
     spinlock_unlock(&head->lock);
 }
 
+void add_wait_queue_exclusive(wait_queue_head_t *head, wait_queue_entry_t *entry)
+{
+    // Validate the input.
+    if (!head) {
+        pr_err("Variable head is NULL.\n");
+        return;
+    }
+    if (!entry) {
+        pr_err("Variable entry is NULL.\n");
+        return;
+    }
+    entry->flags |= WQ_FLAG_EXCLUSIVE;
+    spinlock_lock(&head->lock);
+    __add_wait_queue(head, entry);
+    spinlock_unlock(&head->lock);
+}
+
 void remove_wait_queue(wait_queue_head_t *head, wait_queue_entry_t *entry)
 {
     // Validate the input.
@@ -203,3 +237,87 @@ wait_queue_entry_t *sleep_on(wait_queue_head_t *head)
 
     return entry;
 }
+
+/// @brief Puts the current process to sleep on the specified wait queue.
+/// @param head Waitqueue where to sleep.
+/// @param exclusive If the process sleeps as an exclusive waiter.
+/// @return 0 once woken up, -EINTR if a signal is pending.
+static int __interruptible_sleep_on(wait_queue_head_t *head, int exclusive)
+{
+    // Validate input parameters.
+    if (!head) {
+        pr_err("Wait queue head is NULL.\n");
+        return -EINVAL;
+    }
+
+    // Retrieve the current process/task.
+    task_struct *sleeping_task = scheduler_get_current_process();
+    if (!sleeping_task) {
+        pr_err("Failed to retrieve the current process.\n");
+        return -EINVAL;
+    }
+
+    // Do not sleep if there is a signal to handle.
+    if (signal_pending(sleeping_task)) {
+        return -EINTR;
+    }
+
+    // The entry lives on the kernel stack, which is preserved while sleeping.
+    wait_queue_entry_t entry;
+    wait_queue_entry_init(&entry, sleeping_task);
+    entry.func = __autoremove_wake_function;
+    if (exclusive) {
+        add_wait_queue_exclusive(head, &entry);
+    } else {
+        add_wait_queue(head, &entry);
+    }
+
+    // Give the CPU to the other processes, until we are woken up.
+    sleeping_task->state = TASK_INTERRUPTIBLE;
+    schedule();
+
+    // We might have been woken up by a signal, while still inside the queue.
+    if (!list_head_empty(&entry.task_list)) {
+        remove_wait_queue(head, &entry);
+    }
+
+    return signal_pending(sleeping_task) ? -EINTR : 0;
+}
+
+int interruptible_sleep_on(wait_queue_head_t *head) { return __interruptible_sleep_on(head, 0); }
+
+int interruptible_sleep_on_exclusive(wait_queue_head_t *head) { return __interruptible_sleep_on(head, 1); }
+
+void wake_up_nr(wait_queue_head_t *head, unsigned int nr_exclusive)
+{
+    // Validate input parameters.
+    if (!head) {
+        pr_err("Wait queue head is NULL.\n");
+        return;
+    }
+
+    // With no limit, every exclusive waiter is woken up.
+    int limited = (nr_exclusive > 0);
+
+    list_for_each_safe_decl(it, store, &head->task_list)
+    {
+        wait_queue_entry_t *entry = list_entry(it, wait_queue_entry_t, task_list);
+        // The entry might be freed by the wake function.
+        int exclusive = (entry->flags & WQ_FLAG_EXCLUSIVE) != 0;
+        if (exclusive && limited && (nr_exclusive == 0)) {
+            continue;
+        }
+        // Only the waiters which are actually asleep count against the limit.
+        int asleep = (entry->task->state == TASK_INTERRUPTIBLE) || (entry->task->state == TASK_UNINTERRUPTIBLE);
+        // Run the wake function, and free the entries of the woken up tasks.
+        if (entry->func(entry, TASK_RUNNING, 0)) {
+            remove_wait_queue(head, entry);
+            wait_queue_entry_dealloc(entry);
+        }
+        if (exclusive && limited && asleep) {
+            --nr_exclusive;
+        }
+    }
+}
+
+void wake_up(wait_queue_head_t *head) { wake_up_nr(head, 0); }
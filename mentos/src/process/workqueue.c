@@ -0,0 +1,101 @@
+/// @file workqueue.c
+/// @brief Work deferred to kernel threads.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[WORKQ ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "process/workqueue.h"
+
+#include "mem/alloc/slab.h"
+#include "process/process.h"
+#include "process/scheduler.h"
+#include "stdio.h"
+#include "string.h"
+
+/// The workqueue of the system, for the work which does not need its own.
+static workqueue_t *system_wq = NULL;
+
+/// @brief The body of the workers, it runs the work of a CPU, one at a time.
+/// @param data the work of the CPU.
+/// @return never returns.
+static int __worker_thread(void *data)
+{
+    cpu_workqueue_t *cwq = (cpu_workqueue_t *)data;
+    while (true) {
+        // Kernel threads ignore the signals, only queue_work wakes us up.
+        while (list_head_empty(&cwq->worklist)) {
+            interruptible_sleep_on(&cwq->more_work);
+        }
+        work_struct_t *work = list_entry(list_head_pop(&cwq->worklist), work_struct_t, entry);
+        // The work can queue itself again, while it runs.
+        work->pending       = false;
+        work->func(work);
+        // Workers are not preempted, let the others run between two works.
+        cond_resched();
+    }
+    return 0;
+}
+
+int workqueue_initialize(void)
+{
+    system_wq = create_workqueue("events");
+    if (!system_wq) {
+        pr_crit("Failed to create the workqueue of the system.\n");
+        return -1;
+    }
+    return 0;
+}
+
+workqueue_t *create_workqueue(const char *name)
+{
+    workqueue_t *wq = kmalloc(sizeof(workqueue_t));
+    if (!wq) {
+        pr_crit("Failed to allocate the workqueue `%s`.\n", name);
+        return NULL;
+    }
+    wq->name = name;
+    for (unsigned int cpu = 0; cpu < NR_CPUS; ++cpu) {
+        cpu_workqueue_t *cwq = &per_cpu(wq->cpu_wq, cpu);
+        list_head_init(&cwq->worklist);
+        wait_queue_head_init(&cwq->more_work);
+        cwq->worker = NULL;
+    }
+    // Only the CPU which booted the system runs, the others would get their
+    // worker once they are started.
+    unsigned int cpu     = smp_processor_id();
+    cpu_workqueue_t *cwq = &per_cpu(wq->cpu_wq, cpu);
+    char worker_name[TASK_NAME_MAX_LENGTH];
+    snprintf(worker_name, TASK_NAME_MAX_LENGTH, "%s/%u", name, cpu);
+    cwq->worker = kthread_create(__worker_thread, cwq, worker_name);
+    if (!cwq->worker) {
+        pr_crit("Failed to start the worker `%s`.\n", worker_name);
+        kfree(wq);
+        return NULL;
+    }
+    return wq;
+}
+
+bool_t queue_work(workqueue_t *wq, work_struct_t *work)
+{
+    if (work->pending) {
+        return false;
+    }
+    cpu_workqueue_t *cwq = &this_cpu(wq->cpu_wq);
+    work->pending        = true;
+    list_head_insert_before(&work->entry, &cwq->worklist);
+    wake_up(&cwq->more_work);
+    return true;
+}
+
+bool_t schedule_work(work_struct_t *work)
+{
+    if (!system_wq) {
+        return false;
+    }
+    return queue_work(system_wq, work);
+}
@@ -11,14 +11,23 @@
 #define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
 #include "io/debug.h"                    // Include debugging functions.
 
-#define MAX_TRACKED_RESOURCES    1024 ///< Maximum number of tracked resources.
-#define MAX_REGISTERED_RESOURCES 128  ///< Maximum number of registered resources.
+#include "klib/irqflags.h"
+#include "stdint.h"
+
+#define MAX_TRACKED_RESOURCES    4096                       ///< Maximum number of tracked resources.
+#define MAX_REGISTERED_RESOURCES 128                        ///< Maximum number of registered resources.
+#define RESOURCE_HASH_BITS       10                         ///< The bits of the hash of the tracked resources.
+#define RESOURCE_HASH_SIZE       (1U << RESOURCE_HASH_BITS) ///< The number of buckets of the tracker.
 
 static struct {
-    int id;           ///< The id of the resource.
-    const char *name; ///< The name of the resource.
+    int id;             ///< The id of the resource.
+    const char *name;   ///< The name of the resource.
+    unsigned long live; ///< The objects currently allocated.
+    unsigned long peak; ///< The largest number of objects allocated at once.
+    size_t bytes;       ///< The bytes currently allocated.
+    unsigned long lost; ///< The objects which were not tracked, because the tracker was full.
 }
-/// @brief The resource registry.
+/// @brief The resource registry, indexed by the id of the resources.
 resource_registry[MAX_REGISTERED_RESOURCES];
 
 static struct {
@@ -26,30 +35,66 @@ static struct {
     const char *file; ///< The file where the resource was registered.
     int line;         ///< The line where the resource was registered.
     void *ptr;        ///< The pointer to the resource.
+    size_t size;      ///< The size of the resource.
+    int next;         ///< The next entry of the same bucket, or of the free entries, -1 at the end.
 }
 /// @brief The resource tracker.
 resource_tracker[MAX_TRACKED_RESOURCES];
 
+/// @brief The first entry of each bucket of the tracker, -1 if it is empty.
+static int resource_buckets[RESOURCE_HASH_SIZE];
+
+/// @brief The first free entry of the tracker, -1 if it is full.
+static int resource_free = -1;
+
+/// @brief Hashes the pointer to a resource.
+/// @param ptr the pointer.
+/// @return the bucket of the resource.
+static inline unsigned __resource_hash(void *ptr)
+{
+    // The low bits are mostly zero, because of the alignment of the objects.
+    return ((uint32_t)((uintptr_t)ptr >> 4U) * 2654435761U) >> (32U - RESOURCE_HASH_BITS);
+}
+
+/// @brief Checks if an id belongs to a registered resource.
+/// @param id the id.
+/// @return 1 if it does, 0 otherwise.
+static inline int __resource_valid(int id)
+{
+    return (id >= 0) && (id < MAX_REGISTERED_RESOURCES) && (resource_registry[id].id == id);
+}
+
 void resource_register_init(void)
 {
     for (unsigned i = 0; i < MAX_REGISTERED_RESOURCES; ++i) {
         resource_registry[i].id   = -1;
         resource_registry[i].name = 0;
     }
+    for (unsigned i = 0; i < RESOURCE_HASH_SIZE; ++i) {
+        resource_buckets[i] = -1;
+    }
+    // Chain all the entries of the tracker in the free list.
     for (unsigned i = 0; i < MAX_TRACKED_RESOURCES; ++i) {
         resource_tracker[i].resource_id = 0;
         resource_tracker[i].file        = 0;
         resource_tracker[i].line        = 0;
         resource_tracker[i].ptr         = 0;
+        resource_tracker[i].size        = 0;
+        resource_tracker[i].next        = (i + 1 < MAX_TRACKED_RESOURCES) ? (int)(i + 1) : -1;
     }
+    resource_free = 0;
 }
 
 int register_resource(const char *name)
 {
     for (unsigned i = 0; i < MAX_REGISTERED_RESOURCES; ++i) {
         if (resource_registry[i].id == -1) {
-            resource_registry[i].id   = i;
-            resource_registry[i].name = name;
+            resource_registry[i].id    = i;
+            resource_registry[i].name  = name;
+            resource_registry[i].live  = 0;
+            resource_registry[i].peak  = 0;
+            resource_registry[i].bytes = 0;
+            resource_registry[i].lost  = 0;
             return i;
         }
     }
@@ -58,26 +103,15 @@ int register_resource(const char *name)
 
 const char *get_resource_name(int id)
 {
-    if (id >= 0) {
-        for (unsigned i = 0; i < MAX_REGISTERED_RESOURCES; ++i) {
-            if (resource_registry[i].id == id) {
-                return resource_registry[i].name;
-            }
-        }
-    }
-    return 0;
+    return __resource_valid(id) ? resource_registry[id].name : 0;
 }
 
 int unregister_resource(int id)
 {
-    if (id >= 0) {
-        for (int i = 0; i < MAX_REGISTERED_RESOURCES; ++i) {
-            if (resource_registry[i].id == id) {
-                resource_registry[i].id   = -1;
-                resource_registry[i].name = 0;
-                return 0;
-            }
-        }
+    if (__resource_valid(id)) {
+        resource_registry[id].id   = -1;
+        resource_registry[id].name = 0;
+        return 0;
     }
     return -1;
 }
@@ -87,40 +121,80 @@ void print_resource_registry(void)
     pr_notice("Resource Registry:\n");
     for (int i = 0; i < MAX_REGISTERED_RESOURCES; ++i) {
         if (resource_registry[i].id >= 0) {
-            pr_notice("    ID=%2d, Name=%s\n", resource_registry[i].id, resource_registry[i].name);
+            pr_notice(
+                "    ID=%2d, Name=%s, live=%lu, peak=%lu, bytes=%u, lost=%lu\n", resource_registry[i].id,
+                resource_registry[i].name, resource_registry[i].live, resource_registry[i].peak,
+                resource_registry[i].bytes, resource_registry[i].lost);
         }
     }
 }
 
-void store_resource_info(int resource_id, const char *file, int line, void *ptr)
+void store_resource_info(int resource_id, const char *file, int line, void *ptr, size_t size)
 {
-    for (unsigned i = 0; i < MAX_TRACKED_RESOURCES; ++i) {
-        if (resource_tracker[i].ptr == 0) {
-            resource_tracker[i].resource_id = resource_id;
-            resource_tracker[i].file        = file;
-            resource_tracker[i].line        = line;
-            resource_tracker[i].ptr         = ptr;
-            return;
+    uint8_t flags = irq_disable();
+    int entry     = resource_free;
+    if (entry < 0) {
+        // The tracker is full, the object is only counted.
+        if (__resource_valid(resource_id)) {
+            ++resource_registry[resource_id].lost;
         }
+        irq_enable(flags);
+        return;
     }
+    unsigned bucket                     = __resource_hash(ptr);
+    resource_free                       = resource_tracker[entry].next;
+    resource_tracker[entry].resource_id = resource_id;
+    resource_tracker[entry].file        = file;
+    resource_tracker[entry].line        = line;
+    resource_tracker[entry].ptr         = ptr;
+    resource_tracker[entry].size        = size;
+    resource_tracker[entry].next        = resource_buckets[bucket];
+    resource_buckets[bucket]            = entry;
+    if (__resource_valid(resource_id)) {
+        resource_registry[resource_id].bytes += size;
+        if (++resource_registry[resource_id].live > resource_registry[resource_id].peak) {
+            resource_registry[resource_id].peak = resource_registry[resource_id].live;
+        }
+    }
+    irq_enable(flags);
 }
 
 void clear_resource_info(void *ptr)
 {
-    for (unsigned i = 0; i < MAX_TRACKED_RESOURCES; ++i) {
-        if (resource_tracker[i].ptr == ptr) {
-            resource_tracker[i].resource_id = -1;
-            resource_tracker[i].file        = 0;
-            resource_tracker[i].line        = -1;
-            resource_tracker[i].ptr         = 0;
-            return;
+    uint8_t flags = irq_disable();
+    // Walk the bucket, keeping the link which points to the current entry.
+    int *link     = &resource_buckets[__resource_hash(ptr)];
+    while ((*link >= 0) && (resource_tracker[*link].ptr != ptr)) {
+        link = &resource_tracker[*link].next;
+    }
+    int entry = *link;
+    if (entry >= 0) {
+        int id = resource_tracker[entry].resource_id;
+        if (__resource_valid(id)) {
+            --resource_registry[id].live;
+            resource_registry[id].bytes -= resource_tracker[entry].size;
         }
+        *link                               = resource_tracker[entry].next;
+        resource_tracker[entry].resource_id = -1;
+        resource_tracker[entry].file        = 0;
+        resource_tracker[entry].line        = -1;
+        resource_tracker[entry].ptr         = 0;
+        resource_tracker[entry].size        = 0;
+        resource_tracker[entry].next        = resource_free;
+        resource_free                       = entry;
     }
+    irq_enable(flags);
 }
 
 void print_resource_usage(int resource_id, const char *(*printer)(void *ptr))
 {
     pr_notice("Checking resource usage (resource_id=%d, name: %s):\n", resource_id, get_resource_name(resource_id));
+    if (__resource_valid(resource_id)) {
+        pr_notice(
+            "    live=%lu, peak=%lu, bytes=%u, lost=%lu\n", resource_registry[resource_id].live,
+            resource_registry[resource_id].peak, resource_registry[resource_id].bytes,
+            resource_registry[resource_id].lost);
+    }
     for (unsigned i = 0; i < MAX_TRACKED_RESOURCES; ++i) {
         if (resource_tracker[i].ptr && (resource_id == -1 || (resource_tracker[i].resource_id == resource_id))) {
             if (printer) {
@@ -129,8 +203,8 @@ void print_resource_usage(int resource_id, const char *(*printer)(void *ptr))
                     printer(resource_tracker[i].ptr));
             } else {
                 pr_notice(
-                    "    ptr=0x%p, consumed at %s:%d\n", resource_tracker[i].ptr, resource_tracker[i].file,
-                    resource_tracker[i].line);
+                    "    ptr=0x%p, size=%u, consumed at %s:%d\n", resource_tracker[i].ptr, resource_tracker[i].size,
+                    resource_tracker[i].file, resource_tracker[i].line);
             }
         }
     }
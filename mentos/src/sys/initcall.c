@@ -0,0 +1,163 @@
+/// @file initcall.c
+/// @brief Initialization functions registered by the subsystems, and run by
+///        the kernel at the right moment of the boot.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[INITCL]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "sys/initcall.h"
+
+#include "hardware/hrtimer.h"
+#include "klib/div64.h"
+#include "klib/spinlock.h"
+#include "process/process.h"
+#include "string.h"
+
+/// Defined in kernel.lds, the first initialization function.
+extern initcall_t _initcalls_start[];
+/// Defined in kernel.lds, past the last initialization function.
+extern initcall_t _initcalls_end[];
+
+/// Protects the states of the deferred functions, whose threads start the ones depending on them.
+static spinlock_t initcall_lock = SPINLOCK_INIT;
+
+/// @brief Searches an initialization function by name.
+/// @param name the name of the function.
+/// @return the function, NULL if there is none with that name.
+static inline initcall_t *__initcall_find(const char *name)
+{
+    for (initcall_t *call = _initcalls_start; call < _initcalls_end; ++call) {
+        if (!strcmp(call->name, name)) {
+            return call;
+        }
+    }
+    return NULL;
+}
+
+/// @brief Tells if the dependency of a function allows it to run.
+/// @param call the function.
+/// @return 1 if it can run, 0 if it has to wait, -1 if it never will.
+static inline int __initcall_ready(initcall_t *call)
+{
+    if (call->depends == NULL) {
+        return 1;
+    }
+    initcall_t *dependency = __initcall_find(call->depends);
+    if (dependency == NULL) {
+        pr_err("`%s` depends on `%s`, which does not exist.\n", call->name, call->depends);
+        return -1;
+    }
+    if (dependency->state == INITCALL_DONE) {
+        return 1;
+    }
+    if (dependency->state == INITCALL_FAILED) {
+        return -1;
+    }
+    // A function cannot wait for one which runs at a later level.
+    return (dependency->level > call->level) ? -1 : 0;
+}
+
+/// @brief Runs a function, and logs how long it took.
+/// @param call the function.
+static void __initcall_do(initcall_t *call)
+{
+    uint64_t start = hrtimer_get_ns();
+    int ret        = call->fn();
+    call->duration = div64_32(hrtimer_get_ns() - start, 1000, NULL);
+    spinlock_lock(&initcall_lock);
+    call->state = ret ? INITCALL_FAILED : INITCALL_DONE;
+    spinlock_unlock(&initcall_lock);
+    pr_notice("%s returned %d after %u us.\n", call->name, ret, call->duration);
+}
+
+int initcall_run_level(initcall_level_t level)
+{
+    int failed = 0, progress;
+    // Each pass runs the functions whose dependency has been satisfied by
+    // the previous one, until nothing changes.
+    do {
+        progress = 0;
+        for (initcall_t *call = _initcalls_start; call < _initcalls_end; ++call) {
+            if ((call->level != level) || (call->state != INITCALL_PENDING)) {
+                continue;
+            }
+            int ready = __initcall_ready(call);
+            if (ready == 0) {
+                continue;
+            }
+            if (ready < 0) {
+                pr_err("Skipping `%s`, `%s` did not succeed.\n", call->name, call->depends);
+                call->state = INITCALL_FAILED;
+            } else {
+                call->state = INITCALL_RUNNING;
+                __initcall_do(call);
+            }
+            failed += (call->state == INITCALL_FAILED);
+            progress = 1;
+        }
+    } while (progress);
+    // Whatever is left waits for itself, through a cycle of dependencies.
+    for (initcall_t *call = _initcalls_start; call < _initcalls_end; ++call) {
+        if ((call->level == level) && (call->state == INITCALL_PENDING)) {
+            pr_err("Skipping `%s`, its dependencies form a cycle.\n", call->name);
+            call->state = INITCALL_FAILED;
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+static int __initcall_thread(void *data);
+
+/// @brief Starts a thread for each deferred function which can run, and
+///        marks as failed those which never will.
+/// @return the number of threads which could not be created.
+static int __initcall_start_ready(void)
+{
+    int errors = 0, progress;
+    do {
+        progress = 0;
+        for (initcall_t *call = _initcalls_start; call < _initcalls_end; ++call) {
+            if (call->level != INITCALL_DEFERRED) {
+                continue;
+            }
+            // Two threads finishing together both try to start the functions
+            // depending on them, only one of them does.
+            spinlock_lock(&initcall_lock);
+            int ready = (call->state == INITCALL_PENDING) ? __initcall_ready(call) : 0;
+            if (ready) {
+                call->state = (ready > 0) ? INITCALL_RUNNING : INITCALL_FAILED;
+            }
+            spinlock_unlock(&initcall_lock);
+            if (ready < 0) {
+                pr_err("Skipping `%s`, `%s` did not succeed.\n", call->name, call->depends);
+                progress = 1;
+            } else if ((ready > 0) && !kthread_create(__initcall_thread, call, call->name)) {
+                pr_err("Failed to create the thread of `%s`.\n", call->name);
+                call->state = INITCALL_FAILED;
+                progress    = 1;
+                ++errors;
+            }
+        }
+    } while (progress);
+    return errors;
+}
+
+/// @brief The body of the thread of a deferred function.
+/// @param data the function.
+/// @return 0 if the function succeeded, 1 otherwise.
+static int __initcall_thread(void *data)
+{
+    initcall_t *call = (initcall_t *)data;
+    __initcall_do(call);
+    // The functions waiting for this one can start now, or never will.
+    __initcall_start_ready();
+    return (call->state == INITCALL_DONE) ? 0 : 1;
+}
+
+int initcall_run_deferred(void) { return __initcall_start_ready(); }
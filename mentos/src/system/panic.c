@@ -6,17 +6,20 @@
 #include "system/panic.h"
 #include "io/debug.h"
 #include "io/port_io.h"
+#include "io/video.h"
 
 /// Shutdown port for qemu.
 #define SHUTDOWN_PORT 0x604
 extern int runtests;
+extern int runbench;
 
 void kernel_panic(const char *msg)
 {
     pr_emerg("\nPANIC:\n%s\n\nWelcome to Kernel Debugging Land...\n\n", msg);
     pr_emerg("\n");
     __asm__ __volatile__("cli"); // Disable interrupts
-    if (runtests) {
+    video_flush();               // Nothing refreshes the screen anymore
+    if (runtests || runbench) {
         outports(SHUTDOWN_PORT, 0x2000);
     } // Terminate qemu running the tests
     for (;;) {
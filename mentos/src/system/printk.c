@@ -8,5 +8,6 @@
 
 void sys_syslog(const char *file, const char *fun, int line, short log_level, const char *format)
 {
-    dbg_printf(file, fun, line, "[SYSLOG]", log_level, format);
+    // The message is already formatted by the caller.
+    dbg_printf(file, fun, line, "[SYSLOG]", log_level, "%s", format);
 }
@@ -0,0 +1,163 @@
+/// @file profile.c
+/// @brief Sampling profiler, driven by the timer interrupt.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[PROFIL]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "system/profile.h"
+
+#include "ctype.h"
+#include "errno.h"
+#include "fs/seq_file.h"
+#include "hardware/smp.h"
+#include "hardware/timer.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+
+/// @brief Where a tick interrupted the CPU.
+typedef struct profile_sample {
+    /// The interrupted instruction.
+    uint32_t eip;
+    /// The process running on the CPU.
+    pid_t pid;
+    /// The privilege level of the interrupted code, 0 for the kernel and 3 for user mode.
+    uint8_t cpl;
+} profile_sample_t;
+
+/// @brief The most recent samples of a CPU.
+typedef struct profile_ring {
+    /// The samples, allocated the first time the profiler is enabled.
+    profile_sample_t *samples;
+    /// The number of samples recorded, the next one goes at this index modulo the size.
+    unsigned long head;
+} profile_ring_t;
+
+/// The samples of each CPU.
+static DEFINE_PER_CPU(profile_ring_t, profile_rings);
+/// If the ticks are sampled.
+static volatile bool_t profile_enabled = false;
+
+void profile_tick(pt_regs_t *f)
+{
+    if (!profile_enabled) {
+        return;
+    }
+    profile_ring_t *ring     = &this_cpu(profile_rings);
+    profile_sample_t *sample = &ring->samples[ring->head++ % PROFILE_RING_SIZE];
+    task_struct *current     = scheduler_get_current_process();
+    sample->eip              = f->eip;
+    sample->cpl              = f->cs & 3U;
+    sample->pid              = current ? current->pid : 0;
+}
+
+/// @brief Returns the number of samples a CPU still keeps.
+/// @param ring the ring of the CPU.
+/// @return the number of samples.
+static inline unsigned long __profile_count(profile_ring_t *ring)
+{
+    return ring->samples ? min(ring->head, (unsigned long)PROFILE_RING_SIZE) : 0;
+}
+
+/// @brief Returns the sample at a position, the samples of each CPU follow those of the previous one.
+/// @param m the streaming state.
+/// @param pos the position.
+/// @return the sample, NULL past the last one.
+static void *__profile_seq_start(seq_file_t *m, off_t *pos)
+{
+    unsigned long index = (unsigned long)*pos;
+    for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+        profile_ring_t *ring = &per_cpu(profile_rings, cpu);
+        unsigned long count  = __profile_count(ring);
+        if (index < count) {
+            // The oldest sample comes first.
+            return &ring->samples[(ring->head - count + index) % PROFILE_RING_SIZE];
+        }
+        index -= count;
+    }
+    return NULL;
+}
+
+/// @brief Returns the sample which follows the given one.
+/// @param m the streaming state.
+/// @param v the sample.
+/// @param pos the position, which is advanced.
+/// @return the next sample, NULL past the last one.
+static void *__profile_seq_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return __profile_seq_start(m, pos);
+}
+
+/// @brief Stops the iteration over the samples.
+/// @param m the streaming state.
+/// @param v the sample it stopped at.
+static void __profile_seq_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats a sample.
+/// @param m the streaming state.
+/// @param v the sample.
+/// @return 0.
+static int __profile_seq_show(seq_file_t *m, void *v)
+{
+    profile_sample_t *sample = (profile_sample_t *)v;
+    unsigned int cpu         = 0;
+    // Find the CPU whose ring holds the sample.
+    while ((cpu < smp_num_cpus()) && ((sample < per_cpu(profile_rings, cpu).samples) ||
+                                      (sample >= (per_cpu(profile_rings, cpu).samples + PROFILE_RING_SIZE)))) {
+        ++cpu;
+    }
+    seq_printf(m, "%u %u %08x %d\n", cpu, sample->cpl, sample->eip, sample->pid);
+    return 0;
+}
+
+/// The iterator over the samples.
+static const seq_operations_t profile_seq_operations = {
+    .start = __profile_seq_start,
+    .stop  = __profile_seq_stop,
+    .next  = __profile_seq_next,
+    .show  = __profile_seq_show,
+};
+
+ssize_t profile_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+{
+    return seq_read(file, &profile_seq_operations, buf, offset, nbyte);
+}
+
+int profile_control(const char *command, size_t size)
+{
+    size_t i = 0;
+    while ((i < size) && isspace(command[i])) {
+        ++i;
+    }
+    if ((i == size) || ((command[i] != '0') && (command[i] != '1'))) {
+        return -EINVAL;
+    }
+    if (command[i] == '0') {
+        profile_enabled = false;
+        return 0;
+    }
+    for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+        profile_ring_t *ring = &per_cpu(profile_rings, cpu);
+        if (!ring->samples && !(ring->samples = kmalloc(PROFILE_RING_SIZE * sizeof(profile_sample_t)))) {
+            pr_err("Failed to allocate the samples of CPU %u.\n", cpu);
+            return -ENOMEM;
+        }
+    }
+    // The tick must not record a sample while the rings are cleared.
+    uint8_t flags   = irq_disable();
+    profile_enabled = false;
+    for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+        per_cpu(profile_rings, cpu).head = 0;
+    }
+    profile_enabled = true;
+    irq_enable(flags);
+    pr_notice("Sampling %u ticks per second.\n", TICKS_PER_SECOND);
+    return 0;
+}
@@ -13,8 +13,11 @@
 
 #include "assert.h"
 #include "errno.h"
+#include "fs/poll.h"
 #include "klib/irqflags.h"
 #include "klib/stack_helper.h"
+#include "limits.h"
+#include "mem/alloc/slab.h"
 #include "process/process.h"
 #include "process/scheduler.h"
 #include "process/wait.h"
@@ -23,11 +26,10 @@
 /// @brief Extracts the exit status.
 #define GET_EXIT_STATUS(status) (((status) & 0x00FF) << 8)
 
-/// SLAB caches for signal bits.
-static kmem_cache_t *sigqueue_cachep;
-
 /// Contains all stopped process waiting for a continue signal
 static wait_queue_head_t stopped_queue;
+/// The cache of the queued signals which do not fit inside the pool of their task.
+static kmem_cache_t *sigqueue_cachep;
 
 /// @brief The list of signal names.
 static const char *sys_siglist[] = {
@@ -60,7 +62,7 @@ static inline void __clear_siginfo(siginfo_t *info) { memset(info, 0, sizeof(sig
 static inline void __lock_task_sighand(struct task_struct *t)
 {
     assert(t && "Null task struct.");
-    spinlock_lock(&t->sighand.siglock);
+    spinlock_lock(&t->sighand->siglock);
 }
 
 /// @brief Unlocks the signal handling of a given task.
@@ -68,7 +70,7 @@ static inline void __lock_task_sighand(struct task_struct *t)
 static inline void __unlock_task_sighand(struct task_struct *t)
 {
     assert(t && "Null task struct.");
-    spinlock_unlock(&t->sighand.siglock);
+    spinlock_unlock(&t->sighand->siglock);
 }
 
 /// @brief Returns the handler for a given signal, for a given task.
@@ -78,7 +80,7 @@ static inline void __unlock_task_sighand(struct task_struct *t)
 static sighandler_t __get_handler(struct task_struct *t, int sig)
 {
     assert(t && "Null task struct.");
-    return t->sighand.action[sig - 1].sa_handler;
+    return t->sighand->action[sig - 1].sa_handler;
 }
 
 /// @brief Checks if the given signal is ignored.
@@ -103,27 +105,87 @@ static int __sig_is_ignored(struct task_struct *t, int sig)
 }
 
 /// @brief Allocate a new signal queue record.
-/// @param t     The task to which the signal belongs.
-/// @param sig   The signal to set.
-/// @param flags Flags identifying from where we are going to take the memory.
-/// @return a pointer to the newly allocated signal queue.
-static inline sigqueue_t *__sigqueue_alloc(struct task_struct *t, int sig, gfp_t flags)
+/// @param t     The task/// @brief Returns the pending signals of a task a signal sent to it goes to:
+/// those of the thread group, when it is the leader of a group with threads.
+/// @param t the task.
+/// @return the pending signals.
+static inline sigpending_t *__target_pending(struct task_struct *t)
+{
+    if ((t->group_leader == t) && !list_head_empty(&t->thread_group)) {
+        return &t->shared_pending;
+    }
+    return &t->pending;
+}
+
+/// @brief Returns a word of the signals of a task, private or shared with its
+/// group, which are pending and not blocked.
+/// @param t the task.
+/// @param word the word of the signal sets.
+/// @return the signals, a bit for each one.
+static inline unsigned long __unblocked_word(struct task_struct *t, int word)
+{
+    unsigned long pending = t->pending.signal.sig[word] | t->group_leader->shared_pending.signal.sig[word];
+    return bitmask_clear(pending, t->blocked.sig[word]);
+}
+
+/// @brief Wakes up the task which is going to take a signal, if it sleeps
+/// inside the kernel: a signal of the group goes to the first thread which
+/// does not block it.
+/// @param t the task the signal was sent to.
+/// @param pending where the signal has been added.
+/// @param sig the signal.
+static inline void __signal_wake_up(struct task_struct *t, sigpending_t *pending, int sig)
+{
+    task_struct *target = t;
+    if ((pending == &t->shared_pending) && sigismember(&t->blocked, sig)) {
+        list_for_each_decl (it, &t->thread_group) {
+            task_struct *thread = list_entry(it, task_struct, thread_group);
+            if (!sigismember(&thread->blocked, sig)) {
+                target = thread;
+                break;
+            }
+        }
+    }
+    // Interrupt the sleep of the task, if it is waiting inside the kernel.
+    if ((target->state == TASK_INTERRUPTIBLE) && signal_pending(target)) {
+        scheduler_wake_up_task(target, TASK_RUNNING);
+    }
+}
+
+/// @brief Allocates an entry of the signal queue of a task, from its pool if
+/// possible, and from the slab otherwise.
+/// @param t the task owning the pending signals the entry is queued to.
+/// @return the entry, NULL if the task has too many queued signals.
+static inline sigqueue_t *__sigqueue_alloc(struct task_struct *t)
 {
-    sigqueue_t *sigqueue = kmem_cache_alloc(sigqueue_cachep, flags);
-    // If we successfully allocated the signal queue, initiliaze the values.
-    if (sigqueue) {
-        sigqueue->flags = 0;
-        list_head_init(&sigqueue->list);
+    if (t->sigqueue_count >= t->rlim[RLIMIT_SIGPENDING].rlim_cur) {
+        return NULL;
+    }
+    sigqueue_t *q;
+    if (!list_head_empty(&t->sigqueue_free)) {
+        q = list_entry(list_head_pop(&t->sigqueue_free), sigqueue_t, list);
+    } else {
+        q = kmem_cache_alloc(sigqueue_cachep, GFP_ATOMIC);
+        if (!q) {
+            return NULL;
+        }
+        q->flags = 0;
     }
-    return sigqueue;
+    list_head_init(&q->list);
+    ++t->sigqueue_count;
+    return q;
 }
 
-/// @brief Freest the memory of a signal queue.
-/// @param sigqueue the signal queue to free.
-static inline void __sigqueue_dealloc(sigqueue_t *sigqueue)
+/// @brief Frees an entry of the signal queue of a task, already dequeued.
+/// @param t the task owning the pending signals the entry was queued to.
+/// @param q the entry.
+static inline void __sigqueue_free(struct task_struct *t, sigqueue_t *q)
 {
-    if (sigqueue) {
-        kmem_cache_free(sigqueue);
+    --t->sigqueue_count;
+    if (q->flags & SIGQUEUE_PREALLOC) {
+        list_head_insert_before(&q->list, &t->sigqueue_free);
+    } else {
+        kmem_cache_free(q);
     }
 }
 
@@ -155,20 +217,44 @@ static int __send_signal(int sig, siginfo_t *info, struct task_struct *t)
         __unlock_task_sighand(t);
         return -EINVAL;
     }
-    sigqueue_t *q = __sigqueue_alloc(t, sig, GFP_KERNEL);
-    if (q == NULL) {
+    sigpending_t *pending = __target_pending(t);
+    siginfo_t *slot;
+    if (sig >= SIGRTMIN) {
+        // A real-time signal is queued, even if it is already pending.
+        sigqueue_t *q = __sigqueue_alloc(t);
+        if (!q) {
+            __unlock_task_sighand(t);
+            return -EAGAIN;
+        }
+        list_head_insert_before(&q->list, &pending->queue);
+        slot = &q->info;
+    } else if (sigismember(&pending->signal, sig)) {
+        // A standard signal which is already pending is merged with it.
         __unlock_task_sighand(t);
-        return -EAGAIN;
+        return 0;
+    } else {
+        slot = &pending->info[sig - 1];
     }
-    list_head_insert_before(&q->list, &t->pending.list);
     if (info != SEND_SIG_NOINFO) {
-        __copy_siginfo(&q->info, info);
+        __copy_siginfo(slot, info);
+        slot->si_signo = sig;
+    } else {
+        // Without information, the signal comes from the current process.
+        task_struct *sender = scheduler_get_current_process();
+        __clear_siginfo(slot);
+        slot->si_signo = sig;
+        slot->si_code  = SI_USER;
+        slot->si_pid   = sender ? sender->pid : 0;
+        slot->si_uid   = sender ? sender->uid : 0;
     }
     // Set that there is a signal pending.
-    sigaddset(&t->pending.signal, sig);
+    sigaddset(&pending->signal, sig);
+    __signal_wake_up(t, pending, sig);
+    // The signal might be waited for, even if it is blocked.
+    wake_up(&t->sighand->signal_wait);
     pr_debug(
         "Added pending signal (%2d:%s) to task (%2d:%s), pending `%d, %d`.\n", sig, strsignal(sig), t->pid, t->name,
-        t->pending.signal.sig[0], t->pending.signal.sig[1]);
+        pending->signal.sig[0], pending->signal.sig[1]);
     __unlock_task_sighand(t);
     return 0;
 }
@@ -194,99 +280,59 @@ static inline int __next_signal(sigpending_t *pending, sigset_t *mask)
     return 0;
 }
 
-/// @brief Collects the signals from the list.
+/// @brief Dequeues the oldest occurrence of a real-time signal, which stays
+/// pending if it has been queued more than once.
+/// @param pending the pending signals.
+/// @param owner the task owning the pending signals.
 /// @param sig the signal.
-/// @param list the list of pending signals.
-/// @param info the where we store the signal information.
-static inline void __collect_signal(int sig, sigpending_t *list, siginfo_t *info)
-{
-    pr_debug("__collect_signal(%2d:%s, %p, %p)\n", sig, strsignal(sig), list, info);
-    assert(list && "Null `list` structure.");
-    assert(info && "Null `info` structure.");
-
-    sigqueue_t *queue_entry = NULL;
-    bool_t still_pending    = false;
-    // Collect the siginfo appropriate to this signal. Check if
-    // there is another siginfo for the same signal.
-    list_for_each_decl (it, &list->list) {
+/// @param info where the information of the signal is stored.
+static inline void __dequeue_queued_signal(sigpending_t *pending, struct task_struct *owner, int sig, siginfo_t *info)
+{
+    sigqueue_t *found = NULL;
+    list_for_each_decl (it, &pending->queue) {
         sigqueue_t *q = list_entry(it, sigqueue_t, list);
-        pr_debug(
-            "__collect_signal(%2d:%s, %p, %p) : Signal in queue : %p(%d : "
-            "%s).\n",
-            sig, strsignal(sig), list, info, q, q->info.si_signo, strsignal(q->info.si_signo));
-        if (q->info.si_signo == sig) {
-            // If the entry is already set, this means that there are several handlers
-            // pending for this particular signal.
-            if (queue_entry) {
-                pr_debug(
-                    "__collect_signal(%2d:%s, %p, %p) : Still pending, do not "
-                    "remove from set.\n",
-                    sig, strsignal(sig), list, info);
-                still_pending = true;
-                break;
-            }
-            // Store the entry we encounter.
-            queue_entry = q;
+        if (q->info.si_signo != sig) {
+            continue;
+        }
+        if (found) {
+            // Another occurrence follows, the signal stays pending.
+            list_head_remove(&found->list);
+            __sigqueue_free(owner, found);
+            return;
         }
+        found = q;
+        __copy_siginfo(info, &q->info);
     }
-    // If there are no other signals pending of the same type,
-    // remove the signal from the set.
-    if (!still_pending) {
-        sigdelset(&list->signal, sig);
-        pr_debug(
-            "__collect_signal(%2d:%s, %p, %p) : Remove signal from set: %d.\n", sig, strsignal(sig), list, info,
-            list->signal.sig[0]);
+    if (found) {
+        list_head_remove(&found->list);
+        __sigqueue_free(owner, found);
     }
-    // If we have found an entry.
-    if (queue_entry) {
-        pr_debug(
-            "__collect_signal(%2d:%s, %p, %p) : Remove and delete sigqueue "
-            "entry : %p.\n",
-            sig, strsignal(sig), list, info, queue_entry);
-        // Remove the entry from the queue.
-        list_head_remove(&queue_entry->list);
-        // Copy the details about the entry inside the info structure.
-        __copy_siginfo(info, &queue_entry->info);
-        // Free the memory for the queue entry.
-        __sigqueue_dealloc(queue_entry);
-    } else {
-        pr_debug(
-            "__collect_signal(%2d:%s, %p, %p) : Cannot find the signal in the "
-            "queue.\n",
-            sig, strsignal(sig), list, info);
-        // Ok, it wasn't in the queue, zero out the info.
-        __clear_siginfo(info);
-        // Get the current process.
-        task_struct *current_process = scheduler_get_current_process();
-        // Check the current task.
-        assert(current_process && "There is no current process!");
-        // Initialize the info.
-        info->si_signo           = sig;
-        info->si_code            = SI_USER;
-        info->si_value.sival_int = 0;
-        info->si_errno           = 0;
-        info->si_pid             = current_process->pid;
-        info->si_uid             = current_process->uid;
-        info->si_addr            = NULL;
-        info->si_status          = 0;
-        info->si_band            = 0;
-    }
-}
-
-/// @brief Dequeues a signal that abides by the mask.
-/// @param pending the list of pending signals.
-/// @param mask the mask used to select the signals.
+    sigdelset(&pending->signal, sig);
+}
+
+/// @brief Dequeues a signal that abides by the mask, the private signals of
+/// the task first, then those of its thread group.
+/// @param t the task.
+/// @param mask the signals which must not be dequeued.
 /// @param info the signal information, where we store the information of the dequeued signal.
-/// @return the signal index on success, a negative value on failure.
-static inline int __dequeue_signal(sigpending_t *pending, sigset_t *mask, siginfo_t *info)
+/// @return the signal index on success, 0 if there is none.
+static inline int __dequeue_signal(struct task_struct *t, sigset_t *mask, siginfo_t *info)
 {
-    pr_debug("__dequeue_signal(%p, %p, %p)\n", pending, mask, info);
+    pr_debug("__dequeue_signal(%p, %p, %p)\n", t, mask, info);
     // The dequeue_signal( ) always considers the lowest-numbered pending signal.
     // It updates the data structures to indicate that the signal is no longer
     // pending and returns its number.
-    int sig = __next_signal(pending, mask);
-    if ((sig > 0) && (sig < NSIG)) {
-        __collect_signal(sig, pending, info);
+    sigpending_t *pending = &t->pending;
+    int sig               = __next_signal(pending, mask);
+    if (sig == 0) {
+        pending = &t->group_leader->shared_pending;
+        sig     = __next_signal(pending, mask);
+    }
+    if ((sig > 0) && (sig < SIGRTMIN)) {
+        __copy_siginfo(info, &pending->info[sig - 1]);
+        sigdelset(&pending->signal, sig);
+    } else if ((sig >= SIGRTMIN) && (sig < NSIG)) {
+        __dequeue_queued_signal(pending, (pending == &t->pending) ? t : t->group_leader, sig, info);
     }
     return sig;
 }
@@ -318,12 +364,13 @@ static inline int __handle_signal(int signr, siginfo_t *info, sigaction_t *ka, s
     // Store the registers before setting the ones required by the signal handling.
     current_process->thread.signal_regs = *regs;
 
-    // Restore the registers for the process that has set the signal.
-    *regs = current_process->thread.regs;
-
     // Set the instruction pointer.
     regs->eip = (uintptr_t)ka->sa_handler;
 
+    // The handler may have interrupted a backward copy (see memmove), while
+    // functions expect the direction flag to be clear.
+    regs->eflags &= ~EFLAG_DF;
+
     // If the user is also asking for the signal info, push it into the stack.
     if (bitmask_check(ka->sa_flags, SA_SIGINFO)) {
         // Move the stack so that we have space for storing the siginfo.
@@ -381,22 +428,21 @@ static int __notify_parent(struct task_struct *current, int signr)
     return __send_signal(signr, &info, current->parent);
 }
 
-/// @brief Removes from the pending signal queue q the pending signals
-/// corresponding to the bit mask mask.
+/// @brief Removes the signals of the mask from the pending signals of a
+/// thread group: the shared ones, and the private ones of each thread.
 /// @param mask the mask we use to guide signals removal.
-/// @param q pensing signals.
-static void __rm_from_queue(sigset_t *mask, sigpending_t *q)
-{
-    sigqueue_t *entry;
-    list_for_each_safe_decl(it, tmp, &q->list)
-    {
-        // Get the entry.
-        entry = list_entry(it, sigqueue_t, list);
-        // Remove the signal.
-        if (sigismember(mask, entry->info.si_signo)) {
-            list_head_remove(it);
-            kfree(entry);
-        }
+/// @param p a task of the group.
+static void __rm_from_group(sigset_t *mask, struct task_struct *p)
+{
+    task_struct *leader = p->group_leader;
+    bitmask_clear_assign(leader->shared_pending.signal.sig[0], mask->sig[0]);
+    bitmask_clear_assign(leader->shared_pending.signal.sig[1], mask->sig[1]);
+    bitmask_clear_assign(leader->pending.signal.sig[0], mask->sig[0]);
+    bitmask_clear_assign(leader->pending.signal.sig[1], mask->sig[1]);
+    list_for_each_decl (it, &leader->thread_group) {
+        task_struct *thread = list_entry(it, task_struct, thread_group);
+        bitmask_clear_assign(thread->pending.signal.sig[0], mask->sig[0]);
+        bitmask_clear_assign(thread->pending.signal.sig[1], mask->sig[1]);
     }
 }
 
@@ -419,7 +465,7 @@ int stop_wake_function(wait_queue_entry_t *entry, unsigned mode, int sync)
     // Only wake up tasks in TASK_STOPPED state.
     if (entry->task->state == TASK_STOPPED) {
         // Set the task state to the specified mode.
-        entry->task->state = mode;
+        scheduler_wake_up_task(entry->task, mode);
 
         // Optionally handle sync-specific operations here if needed.
         // For now, sync is unused.
@@ -440,7 +486,7 @@ static void __do_signal_stop(struct task_struct *current, struct pt_regs *f, int
     // The do_signal( ) function also sends a SIGCHLD signal to
     // the parent process of current, unless the parent has set
     // the SA_NOCLDSTOP flag of SIGCHLD.
-    if (!(SA_NOCLDSTOP & current->parent->sighand.action[SIGCHLD - 1].sa_flags)) {
+    if (!(SA_NOCLDSTOP & current->parent->sighand->action[SIGCHLD - 1].sa_flags)) {
         if (__notify_parent(current, SIGCHLD) != 0) {
             pr_warning("Failed to notify parent with signal: %d", signr);
         }
@@ -452,8 +498,8 @@ static void __do_signal_stop(struct task_struct *current, struct pt_regs *f, int
     entry->task->exit_code    = signr;
     entry->func               = stop_wake_function;
 
-    // Call the scheduler.
-    scheduler_run(f);
+    // Sleep inside the kernel, until SIGCONT wakes us up.
+    schedule();
 }
 
 int do_signal(struct pt_regs *f)
@@ -471,6 +517,10 @@ int do_signal(struct pt_regs *f)
     if ((f->cs & 3) != 3) {
         return 0;
     }
+    // Most of the times there is nothing to deliver, which the masks tell.
+    if (!signal_unblocked(current_process)) {
+        return 0;
+    }
 
     // Create a siginfo.
     siginfo_t info;
@@ -484,9 +534,9 @@ int do_signal(struct pt_regs *f)
     // The heart of the do_signal( ) function consists of a loop that
     // repeatedly invokes the __dequeue_signal( ) function until no
     // non-blocked pending signals are left.
-    while (!list_head_empty(&current_process->pending.list)) {
+    for (;;) {
         // Get the signal to deliver.
-        signr = exit_code = __dequeue_signal(&current_process->pending, &current_process->blocked, &info);
+        signr = exit_code = __dequeue_signal(current_process, &current_process->blocked, &info);
 
         // Check the signal that we want to send.
         if ((signr < 0) || (signr >= NSIG)) {
@@ -503,7 +553,7 @@ int do_signal(struct pt_regs *f)
         }
 
         // Get the associated signal action.
-        sigaction_t *ka = &current_process->sighand.action[signr - 1];
+        sigaction_t *ka = &current_process->sighand->action[signr - 1];
 
         // The only exception comes when the receiving process is init, in
         // which case the signal is discarded.
@@ -605,6 +655,102 @@ int do_signal(struct pt_regs *f)
     return 0;
 }
 
+int signal_pending(struct task_struct *t)
+{
+    // Signals sent to init are discarded.
+    if (t->pid == 1) {
+        return 0;
+    }
+    // Only the signals which are pending, and not blocked, are checked.
+    for (int word = 0; word < 2; ++word) {
+        unsigned long x = __unblocked_word(t, word);
+        while (x) {
+            int bit = find_first_non_zero(x);
+            int sig = 1 + (word * 32) + bit;
+            bitmask_clear_assign(x, 1UL << bit);
+            sighandler_t handler = __get_handler(t, sig);
+            if (handler == SIG_IGN) {
+                continue;
+            }
+            // The signals whose default action is "ignore" (see do_signal).
+            if ((handler == SIG_DFL) &&
+                ((sig == SIGCONT) || (sig == SIGCHLD) || (sig == SIGURG) || (sig == SIGWINCH))) {
+                continue;
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int signal_unblocked(struct task_struct *t) { return (__unblocked_word(t, 0) | __unblocked_word(t, 1)) != 0; }
+
+/// @brief Returns the mask which dequeues only the given signals, which can
+/// be waited for: all of them but SIGKILL and SIGSTOP.
+/// @param set the signals.
+/// @param mask where the mask is stored.
+static inline void __waitable_mask(const sigset_t *set, sigset_t *mask)
+{
+    mask->sig[0] = ~set->sig[0];
+    mask->sig[1] = ~set->sig[1];
+    sigaddset(mask, SIGKILL);
+    sigaddset(mask, SIGSTOP);
+}
+
+int signal_pending_in(struct task_struct *t, const sigset_t *set)
+{
+    sigset_t mask;
+    __waitable_mask(set, &mask);
+    return (__next_signal(&t->pending, &mask) != 0) || (__next_signal(&t->group_leader->shared_pending, &mask) != 0);
+}
+
+int signal_dequeue(struct task_struct *t, const sigset_t *set, siginfo_t *info)
+{
+    sigset_t mask;
+    __waitable_mask(set, &mask);
+    __lock_task_sighand(t);
+    int sig = __dequeue_signal(t, &mask, info);
+    __unlock_task_sighand(t);
+    return sig;
+}
+
+/// @brief Initializes the pending signals of a process, with none pending.
+/// @param pending the pending signals.
+static inline void __init_pending(sigpending_t *pending)
+{
+    memset(pending, 0, sizeof(sigpending_t));
+    list_head_init(&pending->queue);
+}
+
+/// @brief Frees the queued signals of a set of pending signals.
+/// @param pending the pending signals.
+/// @param owner the task owning the pending signals.
+static inline void __flush_pending(sigpending_t *pending, struct task_struct *owner)
+{
+    while (!list_head_empty(&pending->queue)) {
+        __sigqueue_free(owner, list_entry(list_head_pop(&pending->queue), sigqueue_t, list));
+    }
+    sigemptyset(&pending->signal);
+}
+
+void signal_init_task(struct task_struct *t)
+{
+    __init_pending(&t->pending);
+    __init_pending(&t->shared_pending);
+    list_head_init(&t->sigqueue_free);
+    for (int i = 0; i < SIGQUEUE_POOL_SIZE; ++i) {
+        t->sigqueue_pool[i].flags = SIGQUEUE_PREALLOC;
+        list_head_insert_before(&t->sigqueue_pool[i].list, &t->sigqueue_free);
+    }
+    t->sigqueue_count = 0;
+}
+
+void signal_flush_task(struct task_struct *t)
+{
+    __flush_pending(&t->pending, t);
+    __flush_pending(&t->shared_pending, t);
+}
+
 int signals_init(void)
 {
     sigqueue_cachep = KMEM_CREATE(sigqueue_t);
@@ -628,13 +774,11 @@ void handle_stop_signal(int sig, siginfo_t *info, struct task_struct *p)
     // pending signal queue p->signal->shared_pending and from the private
     // queues of all members of the thread group.
     if (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU) {
-        // TODO(enrico): shared and thread group.
-
         sigset_t mask;
         sigemptyset(&mask);
         sigaddset(&mask, SIGCONT);
 
-        __rm_from_queue(&mask, &p->pending);
+        __rm_from_group(&mask, p);
     }
 
     // remove any SIGSTOP, SIGTSTP, SIGTTIN, and SIGTTOU signal from the shared pending signal queue p->signal->shared_pending;
@@ -649,7 +793,7 @@ void handle_stop_signal(int sig, siginfo_t *info, struct task_struct *p)
         sigaddset(&mask, SIGTTIN);
         sigaddset(&mask, SIGTTOU);
 
-        __rm_from_queue(&mask, &p->pending);
+        __rm_from_group(&mask, p);
 
         list_for_each_safe_decl(it, store, &stopped_queue.task_list)
         {
@@ -710,35 +854,94 @@ int __send_sig_info(int sig, siginfo_t *info, struct task_struct *p)
 #endif
 
     __unlock_task_sighand(p);
-    __send_signal(sig, info, p);
-    return 0;
+    // Only a full signal queue is reported to the sender.
+    int ret = __send_signal(sig, info, p);
+    return (ret == -EAGAIN) ? ret : 0;
 }
 
-int sys_kill(pid_t pid, int sig)
+/// @brief Sends a signal on behalf of a user process.
+/// @param process the process receiving the signal.
+/// @param sig the signal.
+/// @return 0 on success, a negative errno on failure.
+static inline int __kill_process(task_struct *process, int sig)
 {
-    pr_debug("sys_kill(%d, %2d:%s)\n", pid, sig, strsignal(sig));
-    struct task_struct *process = scheduler_get_running_process(pid);
-    // Check the task associated with the pid.
-    if (!process) {
-        return -ESRCH;
-    }
-    // Check the signal that we want to send.
-    if ((sig < 0) || (sig >= NSIG)) {
-        return -EINVAL;
+    // Kernel threads, the tasks without segments, never check their signals.
+    if (!process->mm) {
+        return 0;
     }
+    // The information tells who sent the signal.
+    task_struct *sender = scheduler_get_current_process();
     siginfo_t info;
     info.si_signo           = sig;
     info.si_code            = SI_USER;
     info.si_value.sival_int = 0;
     info.si_errno           = 0;
-    info.si_pid             = process->pid;
-    info.si_uid             = process->uid;
+    info.si_pid             = sender ? sender->pid : 0;
+    info.si_uid             = sender ? sender->uid : 0;
     info.si_addr            = NULL;
     info.si_status          = 0;
     info.si_band            = 0;
     return __send_sig_info(sig, &info, process);
 }
 
+int sys_kill(pid_t pid, int sig)
+{
+    pr_debug("sys_kill(%d, %2d:%s)\n", pid, sig, strsignal(sig));
+    // Check the signal that we want to send.
+    if ((sig < 0) || (sig >= NSIG)) {
+        return -EINVAL;
+    }
+    // Send the signal to every process of a group, the one of the caller for 0.
+    if ((pid == 0) || (pid < -1)) {
+        pid_t pgid           = pid ? -pid : scheduler_get_current_process()->pgid;
+        task_struct *process = scheduler_get_pgrp_process(pgid, NULL);
+        int ret              = -ESRCH;
+        while (process) {
+            ret     = __kill_process(process, sig);
+            process = scheduler_get_pgrp_process(pgid, process);
+        }
+        return ret;
+    }
+    struct task_struct *process = scheduler_get_running_process(pid);
+    // Check the task associated with the pid.
+    if (!process) {
+        return -ESRCH;
+    }
+    return __kill_process(process, sig);
+}
+
+int sys_rt_sigqueueinfo(pid_t pid, int sig, siginfo_t *info)
+{
+    if ((sig < 0) || (sig >= NSIG)) {
+        return -EINVAL;
+    }
+    if (info == NULL) {
+        return -EFAULT;
+    }
+    task_struct *sender  = scheduler_get_current_process();
+    task_struct *process = scheduler_get_running_process(pid);
+    if (!process) {
+        return -ESRCH;
+    }
+    // Other processes cannot be made to believe the signal comes from
+    // somewhere else than sigqueue().
+    siginfo_t kinfo;
+    __copy_siginfo(&kinfo, info);
+    if (process != sender) {
+        if (kinfo.si_code != SI_QUEUE) {
+            return -EPERM;
+        }
+        kinfo.si_pid = sender->pid;
+        kinfo.si_uid = sender->uid;
+    }
+    kinfo.si_signo = sig;
+    // Kernel threads, the tasks without segments, never check their signals.
+    if (!process->mm) {
+        return 0;
+    }
+    return __send_sig_info(sig, &kinfo, process);
+}
+
 sighandler_t sys_signal(int signum, sighandler_t handler, uint32_t sigreturn_addr)
 {
     pr_debug("sys_signal(%d, %p, %p)\n", signum, handler, sigreturn_addr);
@@ -769,9 +972,9 @@ sighandler_t sys_signal(int signum, sighandler_t handler, uint32_t sigreturn_add
     // Set the address of the sigreturn.
     current_process->sigreturn_addr = sigreturn_addr;
     // Get the old sigaction.
-    sigaction_t *old_sigaction      = &current_process->sighand.action[signum - 1];
+    sigaction_t *old_sigaction      = &current_process->sighand->action[signum - 1];
     // Get the old handler (to return).
-    sighandler_t old_handler        = current_process->sighand.action[signum - 1].sa_handler;
+    sighandler_t old_handler        = current_process->sighand->action[signum - 1].sa_handler;
     // Set the new action.
     __copy_sigaction(old_sigaction, &new_sigaction);
     // Unlock the signal handling for the given task.
@@ -802,7 +1005,7 @@ int sys_sigaction(int signum, const sigaction_t *act, sigaction_t *oldact, uint3
     // Set the address of the sigreturn.
     current_process->sigreturn_addr        = sigreturn_addr;
     // Get a pointer to the entry in the sighand.action array.
-    sigaction_t *current_process_sigaction = &current_process->sighand.action[signum - 1];
+    sigaction_t *current_process_sigaction = &current_process->sighand->action[signum - 1];
     pr_debug("sys_sigaction(%d, %p, %p): : Signal old action ptr %p\n", signum, act, oldact, current_process_sigaction);
     // If requested, get the old sigaction.
     if (oldact) {
@@ -871,16 +1074,58 @@ int sys_sigpending(sigset_t *set)
     if (set == NULL) {
         return -EFAULT;
     }
-    // Copy the pending set.
-    __copy_sigset(set, &current_process->pending.signal);
+    // Copy the pending set, the signals of the thread group included.
+    sigpending_t *shared = &current_process->group_leader->shared_pending;
+    set->sig[0]          = current_process->pending.signal.sig[0] | shared->signal.sig[0];
+    set->sig[1]          = current_process->pending.signal.sig[1] | shared->signal.sig[1];
     return 0;
 }
 
+int sys_rt_sigtimedwait(const sigset_t *set, siginfo_t *info, const struct timespec *timeout)
+{
+    if (set == NULL) {
+        return -EFAULT;
+    }
+    // Convert the timeout to milliseconds, rounding up.
+    int timeout_ms = -1;
+    if (timeout) {
+        if ((timeout->tv_sec < 0) || (timeout->tv_nsec < 0) || (timeout->tv_nsec >= 1000000000)) {
+            return -EINVAL;
+        }
+        if (timeout->tv_sec < (INT_MAX / 1000) - 1) {
+            timeout_ms = (timeout->tv_sec * 1000) + ((timeout->tv_nsec + 999999) / 1000000);
+        }
+    }
+    task_struct *current_process = scheduler_get_current_process();
+    siginfo_t kinfo;
+    int ret;
+    // The wait queue of the signals is polled, like a file, so that the
+    // signals which are not waited for still interrupt the wait.
+    do {
+        poll_table_t *table = poll_table_begin(timeout_ms);
+        if (!table) {
+            return -ENOMEM;
+        }
+        poll_wait(&current_process->sighand->signal_wait, table);
+        ret = poll_table_end(table, signal_dequeue(current_process, set, &kinfo), timeout_ms);
+    } while (ret == -EAGAIN);
+    if (ret == 0) {
+        return -EAGAIN;
+    }
+    if ((ret > 0) && info) {
+        __copy_siginfo(info, &kinfo);
+    }
+    return ret;
+}
+
 const char *strsignal(int sig)
 {
-    if ((sig >= SIGHUP) && (sig < NSIG)) {
+    if ((sig >= SIGHUP) && (sig < SIGRTMIN)) {
         return sys_siglist[sig - 1];
     }
+    if ((sig >= SIGRTMIN) && (sig <= SIGRTMAX)) {
+        return "RT";
+    }
     return NULL;
 }
 
@@ -888,6 +1133,7 @@ int sigemptyset(sigset_t *set)
 {
     if (set) {
         set->sig[0] = 0;
+        set->sig[1] = 0;
         return 0;
     }
     return -1;
@@ -897,6 +1143,7 @@ int sigfillset(sigset_t *set)
 {
     if (set) {
         set->sig[0] = ~0UL;
+        set->sig[1] = ~0UL;
         return 0;
     }
     return -1;
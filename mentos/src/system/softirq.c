@@ -0,0 +1,130 @@
+/// @file softirq.c
+/// @brief The bottom halves of the interrupt handlers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[SOFIRQ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "system/softirq.h"
+#include "klib/irqflags.h"
+#include "klib/preempt.h"
+#include "process/workqueue.h"
+
+/// The rounds of softirqs run when an interrupt returns, before leaving the
+/// rest to the workqueue.
+#define SOFTIRQ_MAX_RESTART 10
+
+/// The functions run by the softirqs.
+static softirq_action_t softirq_vec[NR_SOFTIRQS];
+/// The pending softirqs, one bit each.
+static volatile uint32_t softirq_pending = 0;
+/// If the softirqs are running, the interrupts coming meanwhile do not run them.
+static volatile bool_t softirq_running = false;
+/// Runs the softirqs left pending by do_softirq().
+static work_struct_t softirq_work;
+
+/// @brief The first and the last queued tasklets.
+static struct {
+    /// The first tasklet, NULL if there are none.
+    tasklet_t *head;
+    /// The last tasklet.
+    tasklet_t *tail;
+} tasklet_list = { NULL, NULL };
+
+/// @brief Runs the queued tasklets.
+static void __tasklet_action(void)
+{
+    // Take the whole list, the tasklets queued meanwhile raise the softirq again.
+    uint8_t flags     = irq_disable();
+    tasklet_t *list   = tasklet_list.head;
+    tasklet_list.head = NULL;
+    tasklet_list.tail = NULL;
+    irq_enable(flags);
+    while (list) {
+        tasklet_t *tasklet = list;
+        list               = list->next;
+        // The tasklet can schedule itself again, while it runs.
+        tasklet->next      = NULL;
+        tasklet->scheduled = false;
+        tasklet->func(tasklet->data);
+    }
+}
+
+/// @brief Runs the softirqs from the worker of the system.
+/// @param work the work.
+static void __softirq_work(work_struct_t *work) { do_softirq(); }
+
+void softirq_initialize(void)
+{
+    init_work(&softirq_work, __softirq_work);
+    open_softirq(TASKLET_SOFTIRQ, __tasklet_action);
+}
+
+void open_softirq(unsigned int nr, softirq_action_t action)
+{
+    if (nr < NR_SOFTIRQS) {
+        softirq_vec[nr] = action;
+    }
+}
+
+void raise_softirq(unsigned int nr)
+{
+    uint8_t flags = irq_disable();
+    softirq_pending |= (1U << nr);
+    irq_enable(flags);
+}
+
+void do_softirq(void)
+{
+    uint8_t flags = irq_disable();
+    // We interrupted the softirqs, they run what we raised before returning.
+    if (softirq_running || !softirq_pending) {
+        irq_enable(flags);
+        return;
+    }
+    softirq_running = true;
+    // The bottom halves run on the stack of whoever they interrupted.
+    preempt_disable();
+    for (int restart = SOFTIRQ_MAX_RESTART; restart && softirq_pending; --restart) {
+        uint32_t pending = softirq_pending;
+        softirq_pending  = 0;
+        sti();
+        for (unsigned int nr = 0; pending; ++nr, pending >>= 1U) {
+            if ((pending & 1U) && softirq_vec[nr]) {
+                softirq_vec[nr]();
+            }
+        }
+        cli();
+    }
+    preempt_enable();
+    softirq_running = false;
+    // The interrupts keep raising softirqs, let the interrupted code go on.
+    if (softirq_pending) {
+        schedule_work(&softirq_work);
+    }
+    irq_enable(flags);
+}
+
+bool_t tasklet_schedule(tasklet_t *tasklet)
+{
+    uint8_t flags = irq_disable();
+    if (tasklet->scheduled) {
+        irq_enable(flags);
+        return false;
+    }
+    tasklet->scheduled = true;
+    tasklet->next      = NULL;
+    if (tasklet_list.tail) {
+        tasklet_list.tail->next = tasklet;
+    } else {
+        tasklet_list.head = tasklet;
+    }
+    tasklet_list.tail = tasklet;
+    softirq_pending |= (1U << TASKLET_SOFTIRQ);
+    irq_enable(flags);
+    return true;
+}
@@ -12,10 +12,12 @@
 #include "io/debug.h"                    // Include debugging functions.
 
 #include "descriptor_tables/isr.h"
-#include "devices/fpu.h"
+#include "descriptor_tables/tss.h"
 #include "errno.h"
 #include "fs/attr.h"
 #include "fs/vfs.h"
+#include "hardware/cpuid.h"
+#include "hardware/msr.h"
 #include "hardware/timer.h"
 #include "kernel.h"
 #include "process/process.h"
@@ -27,6 +29,7 @@
 #include "sys/utsname.h"
 #include "system/printk.h"
 #include "system/syscall.h"
+#include "system/trace.h"
 
 /// The signature of a function call.
 typedef int (*SystemCall)(void);
@@ -36,6 +39,12 @@ typedef int (*SystemCall5)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
 /// The list of function call.
 SystemCall sys_call_table[SYSCALL_NUMBER];
 
+/// If the system calls can enter through sysenter.
+static int sysenter_enabled = 0;
+
+/// The entry point of sysenter, defined inside `sysenter.S`.
+extern void sysenter_entry(void);
+
 /// @brief A Not Implemented (NI) system-call.
 /// @return Always returns -ENOSYS.
 /// @details
@@ -48,90 +57,167 @@ static inline int sys_ni_syscall(void) { return -ENOSYS; }
 void syscall_init(void)
 {
     // Initialize the list of system calls.
-    sys_call_table[__NR_exit]           = (SystemCall)sys_exit;
-    sys_call_table[__NR_fork]           = (SystemCall)sys_fork;
-    sys_call_table[__NR_read]           = (SystemCall)sys_read;
-    sys_call_table[__NR_write]          = (SystemCall)sys_write;
-    sys_call_table[__NR_open]           = (SystemCall)sys_open;
-    sys_call_table[__NR_close]          = (SystemCall)sys_close;
-    sys_call_table[__NR_waitpid]        = (SystemCall)sys_waitpid;
-    sys_call_table[__NR_creat]          = (SystemCall)sys_creat;
-    sys_call_table[__NR_unlink]         = (SystemCall)sys_unlink;
-    sys_call_table[__NR_execve]         = (SystemCall)sys_execve;
-    sys_call_table[__NR_chdir]          = (SystemCall)sys_chdir;
-    sys_call_table[__NR_time]           = (SystemCall)sys_time;
-    sys_call_table[__NR_chmod]          = (SystemCall)sys_chmod;
-    sys_call_table[__NR_lchown]         = (SystemCall)sys_lchown;
-    sys_call_table[__NR_stat]           = (SystemCall)sys_stat;
-    sys_call_table[__NR_lseek]          = (SystemCall)sys_lseek;
-    sys_call_table[__NR_getpid]         = (SystemCall)sys_getpid;
-    sys_call_table[__NR_setuid]         = (SystemCall)sys_setuid;
-    sys_call_table[__NR_getuid]         = (SystemCall)sys_getuid;
-    sys_call_table[__NR_alarm]          = (SystemCall)sys_alarm;
-    sys_call_table[__NR_fstat]          = (SystemCall)sys_fstat;
-    sys_call_table[__NR_nice]           = (SystemCall)sys_nice;
-    sys_call_table[__NR_kill]           = (SystemCall)sys_kill;
-    sys_call_table[__NR_mkdir]          = (SystemCall)sys_mkdir;
-    sys_call_table[__NR_rmdir]          = (SystemCall)sys_rmdir;
-    sys_call_table[__NR_dup]            = (SystemCall)sys_dup;
-    sys_call_table[__NR_pipe]           = (SystemCall)sys_pipe;
-    sys_call_table[__NR_brk]            = (SystemCall)sys_brk;
-    sys_call_table[__NR_setgid]         = (SystemCall)sys_setgid;
-    sys_call_table[__NR_getgid]         = (SystemCall)sys_getgid;
-    sys_call_table[__NR_signal]         = (SystemCall)sys_signal;
-    sys_call_table[__NR_geteuid]        = (SystemCall)sys_geteuid;
-    sys_call_table[__NR_getegid]        = (SystemCall)sys_getegid;
-    sys_call_table[__NR_ioctl]          = (SystemCall)sys_ioctl;
-    sys_call_table[__NR_fcntl]          = (SystemCall)sys_fcntl;
-    sys_call_table[__NR_setpgid]        = (SystemCall)sys_setpgid;
-    sys_call_table[__NR_getppid]        = (SystemCall)sys_getppid;
-    sys_call_table[__NR_setsid]         = (SystemCall)sys_setsid;
-    sys_call_table[__NR_sigaction]      = (SystemCall)sys_sigaction;
-    sys_call_table[__NR_setreuid]       = (SystemCall)sys_setreuid;
-    sys_call_table[__NR_setregid]       = (SystemCall)sys_setregid;
-    sys_call_table[__NR_symlink]        = (SystemCall)sys_symlink;
-    sys_call_table[__NR_readlink]       = (SystemCall)sys_readlink;
-    sys_call_table[__NR_reboot]         = (SystemCall)sys_reboot;
-    sys_call_table[__NR_mmap]           = (SystemCall)sys_mmap;
-    sys_call_table[__NR_munmap]         = (SystemCall)sys_munmap;
-    sys_call_table[__NR_syslog]         = (SystemCall)sys_syslog;
-    sys_call_table[__NR_fchmod]         = (SystemCall)sys_fchmod;
-    sys_call_table[__NR_fchown]         = (SystemCall)sys_fchown;
-    sys_call_table[__NR_setitimer]      = (SystemCall)sys_setitimer;
-    sys_call_table[__NR_getitimer]      = (SystemCall)sys_getitimer;
-    sys_call_table[__NR_uname]          = (SystemCall)sys_uname;
-    sys_call_table[__NR_sigreturn]      = (SystemCall)sys_sigreturn;
-    sys_call_table[__NR_sigprocmask]    = (SystemCall)sys_sigprocmask;
-    sys_call_table[__NR_getpgid]        = (SystemCall)sys_getpgid;
-    sys_call_table[__NR_fchdir]         = (SystemCall)sys_fchdir;
-    sys_call_table[__NR_getdents]       = (SystemCall)sys_getdents;
-    sys_call_table[__NR_getsid]         = (SystemCall)sys_getsid;
-    sys_call_table[__NR_sched_setparam] = (SystemCall)sys_sched_setparam;
-    sys_call_table[__NR_sched_getparam] = (SystemCall)sys_sched_getparam;
-    sys_call_table[__NR_nanosleep]      = (SystemCall)sys_nanosleep;
-    sys_call_table[__NR_chown]          = (SystemCall)sys_chown;
-    sys_call_table[__NR_getcwd]         = (SystemCall)sys_getcwd;
-    sys_call_table[__NR_waitperiod]     = (SystemCall)sys_waitperiod;
-    sys_call_table[__NR_msgctl]         = (SystemCall)sys_msgctl;
-    sys_call_table[__NR_msgget]         = (SystemCall)sys_msgget;
-    sys_call_table[__NR_msgrcv]         = (SystemCall)sys_msgrcv;
-    sys_call_table[__NR_msgsnd]         = (SystemCall)sys_msgsnd;
-    sys_call_table[__NR_semctl]         = (SystemCall)sys_semctl;
-    sys_call_table[__NR_semget]         = (SystemCall)sys_semget;
-    sys_call_table[__NR_semop]          = (SystemCall)sys_semop;
-    sys_call_table[__NR_shmat]          = (SystemCall)sys_shmat;
-    sys_call_table[__NR_shmctl]         = (SystemCall)sys_shmctl;
-    sys_call_table[__NR_shmdt]          = (SystemCall)sys_shmdt;
-    sys_call_table[__NR_shmget]         = (SystemCall)sys_shmget;
+    sys_call_table[__NR_exit]               = (SystemCall)sys_exit;
+    sys_call_table[__NR_fork]               = (SystemCall)sys_fork;
+    sys_call_table[__NR_vfork]              = (SystemCall)sys_vfork;
+    sys_call_table[__NR_clone]              = (SystemCall)sys_clone;
+    sys_call_table[__NR_exit_group]         = (SystemCall)sys_exit_group;
+    sys_call_table[__NR_gettid]             = (SystemCall)sys_gettid;
+    sys_call_table[__NR_set_thread_area]    = (SystemCall)sys_set_thread_area;
+    sys_call_table[__NR_read]               = (SystemCall)sys_read;
+    sys_call_table[__NR_write]              = (SystemCall)sys_write;
+    sys_call_table[__NR_open]               = (SystemCall)sys_open;
+    sys_call_table[__NR_openat]             = (SystemCall)sys_openat;
+    sys_call_table[__NR_close]              = (SystemCall)sys_close;
+    sys_call_table[__NR_waitpid]            = (SystemCall)sys_waitpid;
+    sys_call_table[__NR_wait4]              = (SystemCall)sys_wait4;
+    sys_call_table[__NR_getrlimit]          = (SystemCall)sys_getrlimit;
+    sys_call_table[__NR_setrlimit]          = (SystemCall)sys_setrlimit;
+    sys_call_table[__NR_getrusage]          = (SystemCall)sys_getrusage;
+    sys_call_table[__NR_times]              = (SystemCall)sys_times;
+    sys_call_table[__NR_creat]              = (SystemCall)sys_creat;
+    sys_call_table[__NR_unlink]             = (SystemCall)sys_unlink;
+    sys_call_table[__NR_execve]             = (SystemCall)sys_execve;
+    sys_call_table[__NR_posix_spawn]        = (SystemCall)sys_posix_spawn;
+    sys_call_table[__NR_chdir]              = (SystemCall)sys_chdir;
+    sys_call_table[__NR_time]               = (SystemCall)sys_time;
+    sys_call_table[__NR_clock_gettime]      = (SystemCall)sys_clock_gettime;
+    sys_call_table[__NR_clock_getres]       = (SystemCall)sys_clock_getres;
+    sys_call_table[__NR_chmod]              = (SystemCall)sys_chmod;
+    sys_call_table[__NR_lchown]             = (SystemCall)sys_lchown;
+    sys_call_table[__NR_stat]               = (SystemCall)sys_stat;
+    sys_call_table[__NR_fstatat64]          = (SystemCall)sys_fstatat;
+    sys_call_table[__NR_lseek]              = (SystemCall)sys_lseek;
+    sys_call_table[__NR_sync]               = (SystemCall)sys_sync;
+    sys_call_table[__NR_fsync]              = (SystemCall)sys_fsync;
+    sys_call_table[__NR_ftruncate]          = (SystemCall)sys_ftruncate;
+    sys_call_table[__NR_fadvise64]          = (SystemCall)sys_fadvise64;
+    sys_call_table[__NR_getpid]             = (SystemCall)sys_getpid;
+    sys_call_table[__NR_setuid]             = (SystemCall)sys_setuid;
+    sys_call_table[__NR_getuid]             = (SystemCall)sys_getuid;
+    sys_call_table[__NR_alarm]              = (SystemCall)sys_alarm;
+    sys_call_table[__NR_fstat]              = (SystemCall)sys_fstat;
+    sys_call_table[__NR_nice]               = (SystemCall)sys_nice;
+    sys_call_table[__NR_kill]               = (SystemCall)sys_kill;
+    sys_call_table[__NR_mkdir]              = (SystemCall)sys_mkdir;
+    sys_call_table[__NR_mknod]              = (SystemCall)sys_mknod;
+    sys_call_table[__NR_rmdir]              = (SystemCall)sys_rmdir;
+    sys_call_table[__NR_dup]                = (SystemCall)sys_dup;
+    sys_call_table[__NR_pipe]               = (SystemCall)sys_pipe;
+    sys_call_table[__NR_brk]                = (SystemCall)sys_brk;
+    sys_call_table[__NR_setgid]             = (SystemCall)sys_setgid;
+    sys_call_table[__NR_getgid]             = (SystemCall)sys_getgid;
+    sys_call_table[__NR_signal]             = (SystemCall)sys_signal;
+    sys_call_table[__NR_geteuid]            = (SystemCall)sys_geteuid;
+    sys_call_table[__NR_getegid]            = (SystemCall)sys_getegid;
+    sys_call_table[__NR_ioctl]              = (SystemCall)sys_ioctl;
+    sys_call_table[__NR_fcntl]              = (SystemCall)sys_fcntl;
+    sys_call_table[__NR_setpgid]            = (SystemCall)sys_setpgid;
+    sys_call_table[__NR_getppid]            = (SystemCall)sys_getppid;
+    sys_call_table[__NR_setsid]             = (SystemCall)sys_setsid;
+    sys_call_table[__NR_sigaction]          = (SystemCall)sys_sigaction;
+    sys_call_table[__NR_setreuid]           = (SystemCall)sys_setreuid;
+    sys_call_table[__NR_setregid]           = (SystemCall)sys_setregid;
+    sys_call_table[__NR_symlink]            = (SystemCall)sys_symlink;
+    sys_call_table[__NR_readlink]           = (SystemCall)sys_readlink;
+    sys_call_table[__NR_reboot]             = (SystemCall)sys_reboot;
+    sys_call_table[__NR_prctl]              = (SystemCall)sys_prctl;
+    sys_call_table[__NR_mmap]               = (SystemCall)sys_old_mmap;
+    sys_call_table[__NR_munmap]             = (SystemCall)sys_munmap;
+    sys_call_table[__NR_msync]              = (SystemCall)sys_msync;
+    sys_call_table[__NR_madvise]            = (SystemCall)sys_madvise;
+    sys_call_table[__NR_swapon]             = (SystemCall)sys_swapon;
+    sys_call_table[__NR_swapoff]            = (SystemCall)sys_swapoff;
+    sys_call_table[__NR_syslog]             = (SystemCall)sys_syslog;
+    sys_call_table[__NR_fchmod]             = (SystemCall)sys_fchmod;
+    sys_call_table[__NR_fchown]             = (SystemCall)sys_fchown;
+    sys_call_table[__NR_setitimer]          = (SystemCall)sys_setitimer;
+    sys_call_table[__NR_getitimer]          = (SystemCall)sys_getitimer;
+    sys_call_table[__NR_uname]              = (SystemCall)sys_uname;
+    sys_call_table[__NR_sigreturn]          = (SystemCall)sys_sigreturn;
+    sys_call_table[__NR_sigprocmask]        = (SystemCall)sys_sigprocmask;
+    sys_call_table[__NR_rt_sigtimedwait]    = (SystemCall)sys_rt_sigtimedwait;
+    sys_call_table[__NR_rt_sigqueueinfo]    = (SystemCall)sys_rt_sigqueueinfo;
+    sys_call_table[__NR_getpgid]            = (SystemCall)sys_getpgid;
+    sys_call_table[__NR_fchdir]             = (SystemCall)sys_fchdir;
+    sys_call_table[__NR_getdents]           = (SystemCall)sys_getdents;
+    sys_call_table[__NR_select]             = (SystemCall)sys_select;
+    sys_call_table[__NR_readv]              = (SystemCall)sys_readv;
+    sys_call_table[__NR_writev]             = (SystemCall)sys_writev;
+    sys_call_table[__NR_getsid]             = (SystemCall)sys_getsid;
+    sys_call_table[__NR_sched_setparam]     = (SystemCall)sys_sched_setparam;
+    sys_call_table[__NR_sched_getparam]     = (SystemCall)sys_sched_getparam;
+    sys_call_table[__NR_sched_setscheduler] = (SystemCall)sys_sched_setscheduler;
+    sys_call_table[__NR_sched_getscheduler] = (SystemCall)sys_sched_getscheduler;
+    sys_call_table[__NR_sched_yield]        = (SystemCall)sys_sched_yield;
+    sys_call_table[__NR_nanosleep]          = (SystemCall)sys_nanosleep;
+    sys_call_table[__NR_poll]               = (SystemCall)sys_poll;
+    sys_call_table[__NR_chown]              = (SystemCall)sys_chown;
+    sys_call_table[__NR_pread64]            = (SystemCall)sys_pread;
+    sys_call_table[__NR_pwrite64]           = (SystemCall)sys_pwrite;
+    sys_call_table[__NR_getcwd]             = (SystemCall)sys_getcwd;
+    sys_call_table[__NR_sendfile]           = (SystemCall)sys_sendfile;
+    sys_call_table[__NR_epoll_create]       = (SystemCall)sys_epoll_create;
+    sys_call_table[__NR_epoll_ctl]          = (SystemCall)sys_epoll_ctl;
+    sys_call_table[__NR_epoll_wait]         = (SystemCall)sys_epoll_wait;
+    sys_call_table[__NR_waitperiod]         = (SystemCall)sys_waitperiod;
+    sys_call_table[__NR_msgctl]             = (SystemCall)sys_msgctl;
+    sys_call_table[__NR_msgget]             = (SystemCall)sys_msgget;
+    sys_call_table[__NR_msgrcv]             = (SystemCall)sys_msgrcv;
+    sys_call_table[__NR_msgsnd]             = (SystemCall)sys_msgsnd;
+    sys_call_table[__NR_semctl]             = (SystemCall)sys_semctl;
+    sys_call_table[__NR_semget]             = (SystemCall)sys_semget;
+    sys_call_table[__NR_semop]              = (SystemCall)sys_semop;
+    sys_call_table[__NR_semtimedop]         = (SystemCall)sys_semtimedop;
+    sys_call_table[__NR_shmat]              = (SystemCall)sys_shmat;
+    sys_call_table[__NR_shmctl]             = (SystemCall)sys_shmctl;
+    sys_call_table[__NR_shmdt]              = (SystemCall)sys_shmdt;
+    sys_call_table[__NR_shmget]             = (SystemCall)sys_shmget;
+    sys_call_table[__NR_preadv]             = (SystemCall)sys_preadv;
+    sys_call_table[__NR_pwritev]            = (SystemCall)sys_pwritev;
+    sys_call_table[__NR_copy_file_range]    = (SystemCall)sys_copy_file_range;
+    sys_call_table[__NR_splice]             = (SystemCall)sys_splice;
+    sys_call_table[__NR_tee]                = (SystemCall)sys_tee;
+    sys_call_table[__NR_vmsplice]           = (SystemCall)sys_vmsplice;
+    sys_call_table[__NR_socket]             = (SystemCall)sys_socket;
+    sys_call_table[__NR_socketpair]         = (SystemCall)sys_socketpair;
+    sys_call_table[__NR_bind]               = (SystemCall)sys_bind;
+    sys_call_table[__NR_listen]             = (SystemCall)sys_listen;
+    sys_call_table[__NR_accept4]            = (SystemCall)sys_accept4;
+    sys_call_table[__NR_connect]            = (SystemCall)sys_connect;
+    sys_call_table[__NR_sendmsg]            = (SystemCall)sys_sendmsg;
+    sys_call_table[__NR_recvmsg]            = (SystemCall)sys_recvmsg;
+    sys_call_table[__NR_shutdown]           = (SystemCall)sys_shutdown;
+    sys_call_table[__NR_futex]              = (SystemCall)sys_futex;
+    sys_call_table[__NR_eventfd]            = (SystemCall)sys_eventfd;
+    sys_call_table[__NR_eventfd2]           = (SystemCall)sys_eventfd2;
+    sys_call_table[__NR_signalfd]           = (SystemCall)sys_signalfd;
+    sys_call_table[__NR_signalfd4]          = (SystemCall)sys_signalfd4;
+    sys_call_table[__NR_io_uring_setup]     = (SystemCall)sys_io_uring_setup;
+    sys_call_table[__NR_io_uring_enter]     = (SystemCall)sys_io_uring_enter;
+    sys_call_table[__NR_perf_event_open]    = (SystemCall)sys_perf_event_open;
 
     isr_install_handler(SYSTEM_CALL, &syscall_handler, "syscall_handler");
+
+    // The programs enter through sysenter when possible, `int 0x80` keeps
+    // working either way.
+    if (cpuid_has_sysenter()) {
+        wrmsr(MSR_SYSENTER_CS, 0x08);
+        wrmsr(MSR_SYSENTER_ESP, (uintptr_t)tss_get_stack_pointer());
+        wrmsr(MSR_SYSENTER_EIP, (uintptr_t)sysenter_entry);
+        sysenter_enabled = 1;
+        pr_notice("System calls enter through sysenter.\n");
+    } else {
+        pr_notice("The CPU lacks sysenter, system calls enter through int 0x80.\n");
+    }
 }
 
+int syscall_has_sysenter(void) { return sysenter_enabled; }
+
 void syscall_handler(pt_regs_t *f)
 {
-    // Save current process fpu state.
-    switch_fpu();
-
+    unsigned nr = f->eax;
+    trace_point(TRACE_SYS_ENTER, nr, f->ebx, f->ecx);
     // The result of the system call.
     if (f->eax >= SYSCALL_NUMBER) {
         f->eax = ENOSYS;
@@ -143,7 +229,8 @@ void syscall_handler(pt_regs_t *f)
         unsigned args[5] = {0};
 
         // Special handling for specific system calls that do not follow the standard argument convention.
-        if ((f->eax == __NR_fork) || (f->eax == __NR_clone) || (f->eax == __NR_execve) || (f->eax == __NR_sigreturn)) {
+        if ((f->eax == __NR_fork) || (f->eax == __NR_vfork) || (f->eax == __NR_clone) || (f->eax == __NR_execve) ||
+            (f->eax == __NR_sigreturn)) {
             args[0] = (uintptr_t)f;
         }
         // Otherwise, populate arguments from the CPU register state.
@@ -158,10 +245,11 @@ void syscall_handler(pt_regs_t *f)
         // Invoke the system call with the prepared arguments and store the return value in the EAX register.
         f->eax = fun(args[0], args[1], args[2], args[3], args[4]);
     }
+    trace_point(TRACE_SYS_EXIT, nr, f->eax, 0);
 
-    // Schedule next process.
-    scheduler_run(f);
-
-    // Restore fpu state.
-    unswitch_fpu();
+    // Schedule next process, only if the tick, a wake-up or the system call
+    // asked for it, or if there are signals to deliver.
+    if (scheduler_need_resched()) {
+        scheduler_run(f);
+    }
 }
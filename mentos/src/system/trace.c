@@ -0,0 +1,252 @@
+/// @file trace.c
+/// @brief Static tracepoints, recording binary events inside per-CPU rings.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[TRACE ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "system/trace.h"
+
+#include "errno.h"
+#include "fs/seq_file.h"
+#include "hardware/hrtimer.h"
+#include "hardware/smp.h"
+#include "klib/div64.h"
+#include "klib/irqflags.h"
+#include "math.h"
+#include "mem/alloc/slab.h"
+#include "process/scheduler.h"
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+
+/// The largest command accepted by trace_events_control().
+#define TRACE_COMMAND_SIZE 256
+
+/// @brief An event recorded by a tracepoint.
+typedef struct trace_record {
+    /// When the event happened, in nanoseconds (see hrtimer_get_ns()).
+    uint64_t time;
+    /// The event (trace_event_id_t).
+    uint16_t event;
+    /// The CPU.
+    uint16_t cpu;
+    /// The process running on the CPU.
+    pid_t pid;
+    /// The arguments of the event.
+    uint32_t args[3];
+} trace_record_t;
+
+/// @brief The most recent records of a CPU.
+typedef struct trace_ring {
+    /// The records, allocated the first time an event is enabled.
+    trace_record_t *records;
+    /// The number of records written, the next one goes at this index modulo the size.
+    unsigned long head;
+} trace_ring_t;
+
+/// @brief How an event is listed.
+typedef struct trace_event_desc {
+    /// The name of the event.
+    const char *name;
+    /// The format of its arguments.
+    const char *format;
+} trace_event_desc_t;
+
+/// The events, by identifier.
+static const trace_event_desc_t trace_events[TRACE_EVENT_MAX] = {
+    [TRACE_SCHED_SWITCH]   = {"sched_switch", "prev=%d prev_state=%d next=%d"},
+    [TRACE_SCHED_WAKEUP]   = {"sched_wakeup", "pid=%d state=%d"},
+    [TRACE_SCHED_LATENCY]  = {"sched_latency", "pid=%d latency_us=%u max_us=%u"},
+    [TRACE_SYS_ENTER]      = {"sys_enter", "nr=%u arg0=%x arg1=%x"},
+    [TRACE_SYS_EXIT]       = {"sys_exit", "nr=%u ret=%d"},
+    [TRACE_PAGE_FAULT]     = {"page_fault", "addr=%08x err=%x eip=%08x"},
+    [TRACE_BLOCK_ISSUE]    = {"block_issue", "sector=%u count=%u write=%u"},
+    [TRACE_BLOCK_COMPLETE] = {"block_complete", "sector=%u count=%u status=%d"},
+    [TRACE_KMALLOC]        = {"kmalloc", "ptr=%08x size=%u"},
+    [TRACE_KFREE]          = {"kfree", "ptr=%08x"},
+};
+
+/// The records of each CPU.
+static DEFINE_PER_CPU(trace_ring_t, trace_rings);
+
+volatile uint32_t trace_events_mask = 0;
+
+void __trace_record(trace_event_id_t event, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    uint8_t flags        = irq_disable();
+    trace_ring_t *ring   = &this_cpu(trace_rings);
+    task_struct *current = scheduler_get_current_process();
+    // The event could have been enabled before the ring was allocated, on another CPU.
+    if (ring->records) {
+        trace_record_t *record = &ring->records[ring->head++ % TRACE_RING_SIZE];
+        record->time           = hrtimer_get_ns();
+        record->event          = event;
+        record->cpu            = smp_processor_id();
+        record->pid            = current ? current->pid : 0;
+        record->args[0]        = arg0;
+        record->args[1]        = arg1;
+        record->args[2]        = arg2;
+    }
+    irq_enable(flags);
+}
+
+/// @brief Returns the number of records a CPU still keeps.
+/// @param ring the ring of the CPU.
+/// @return the number of records.
+static inline unsigned long __trace_count(trace_ring_t *ring)
+{
+    return ring->records ? min(ring->head, (unsigned long)TRACE_RING_SIZE) : 0;
+}
+
+/// @brief Returns the record at a position, the records of each CPU follow those of the previous one.
+/// @param m the streaming state.
+/// @param pos the position.
+/// @return the record, NULL past the last one.
+static void *__trace_seq_start(seq_file_t *m, off_t *pos)
+{
+    unsigned long index = (unsigned long)*pos;
+    for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+        trace_ring_t *ring  = &per_cpu(trace_rings, cpu);
+        unsigned long count = __trace_count(ring);
+        if (index < count) {
+            // The oldest record comes first.
+            return &ring->records[(ring->head - count + index) % TRACE_RING_SIZE];
+        }
+        index -= count;
+    }
+    return NULL;
+}
+
+/// @brief Returns the record which follows the given one.
+/// @param m the streaming state.
+/// @param v the record.
+/// @param pos the position, which is advanced.
+/// @return the next record, NULL past the last one.
+static void *__trace_seq_next(seq_file_t *m, void *v, off_t *pos)
+{
+    ++(*pos);
+    return __trace_seq_start(m, pos);
+}
+
+/// @brief Stops the iteration over the records.
+/// @param m the streaming state.
+/// @param v the record it stopped at.
+static void __trace_seq_stop(seq_file_t *m, void *v) {}
+
+/// @brief Formats a record.
+/// @param m the streaming state.
+/// @param v the record.
+/// @return 0.
+static int __trace_seq_show(seq_file_t *m, void *v)
+{
+    trace_record_t *record = (trace_record_t *)v;
+    uint32_t nsec;
+    uint32_t sec = div64_32(record->time, NSEC_PER_SEC, &nsec);
+    seq_printf(m, "%u %u.%06u %d %s ", record->cpu, sec, nsec / 1000, record->pid, trace_events[record->event].name);
+    seq_printf(m, trace_events[record->event].format, record->args[0], record->args[1], record->args[2]);
+    seq_printf(m, "\n");
+    return 0;
+}
+
+/// The iterator over the records.
+static const seq_operations_t trace_seq_operations = {
+    .start = __trace_seq_start,
+    .stop  = __trace_seq_stop,
+    .next  = __trace_seq_next,
+    .show  = __trace_seq_show,
+};
+
+ssize_t trace_read(vfs_file_t *file, char *buf, off_t offset, size_t nbyte)
+{
+    return seq_read(file, &trace_seq_operations, buf, offset, nbyte);
+}
+
+ssize_t trace_events_read(char *buffer, off_t offset, size_t size)
+{
+    char line[64];
+    size_t count = 0;
+    if (offset < 0) {
+        return 0;
+    }
+    // The list is written again at every read, only the requested part is kept.
+    for (unsigned int event = 0; (event < TRACE_EVENT_MAX) && (count < size); ++event) {
+        size_t length = snprintf(
+            line, sizeof(line), "%s %u\n", trace_events[event].name, (trace_events_mask >> event) & 1U);
+        if ((size_t)offset >= length) {
+            offset -= length;
+            continue;
+        }
+        length = min(length - offset, size - count);
+        memcpy(buffer + count, line + offset, length);
+        count += length;
+        offset = 0;
+    }
+    return count;
+}
+
+/// @brief Allocates the rings which are still missing.
+/// @return 0 on success, -ENOMEM on failure.
+static inline int __trace_alloc_rings(void)
+{
+    for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+        trace_ring_t *ring = &per_cpu(trace_rings, cpu);
+        if (!ring->records && !(ring->records = kmalloc(TRACE_RING_SIZE * sizeof(trace_record_t)))) {
+            pr_err("Failed to allocate the records of CPU %u.\n", cpu);
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+int trace_events_control(const char *command, size_t size)
+{
+    char copy[TRACE_COMMAND_SIZE], *saveptr, *token;
+    uint32_t mask = trace_events_mask;
+    bool_t clear  = false;
+    if (size >= TRACE_COMMAND_SIZE) {
+        return -EINVAL;
+    }
+    memcpy(copy, command, size);
+    copy[size] = 0;
+    // Parse all the commands, before applying any of them.
+    for (token = strtok_r(copy, " \t\n", &saveptr); token; token = strtok_r(NULL, " \t\n", &saveptr)) {
+        if (!strcmp(token, "clear")) {
+            clear = true;
+            continue;
+        }
+        if ((token[0] != '+') && (token[0] != '-')) {
+            return -EINVAL;
+        }
+        uint32_t bits = 0;
+        if (!strcmp(token + 1, "all")) {
+            bits = (1U << TRACE_EVENT_MAX) - 1U;
+        }
+        for (unsigned int event = 0; !bits && (event < TRACE_EVENT_MAX); ++event) {
+            if (!strcmp(token + 1, trace_events[event].name)) {
+                bits = 1U << event;
+            }
+        }
+        if (!bits) {
+            return -EINVAL;
+        }
+        mask = (token[0] == '+') ? (mask | bits) : (mask & ~bits);
+    }
+    if (mask && (__trace_alloc_rings() < 0)) {
+        return -ENOMEM;
+    }
+    // A tracepoint must not record while the rings are emptied.
+    uint8_t flags = irq_disable();
+    if (clear) {
+        for (unsigned int cpu = 0; cpu < smp_num_cpus(); ++cpu) {
+            per_cpu(trace_rings, cpu).head = 0;
+        }
+    }
+    trace_events_mask = mask;
+    irq_enable(flags);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/// @file vdso.c
+/// @brief The page shared, read-only, with every process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+// Setup the logging for this file (do this before any other include).
+#include "sys/kernel_levels.h"           // Include kernel log levels.
+#define __DEBUG_HEADER__ "[VDSO  ]"      ///< Change header.
+#define __DEBUG_LEVEL__  LOGLEVEL_NOTICE ///< Set log level.
+#include "io/debug.h"                    // Include debugging functions.
+
+#include "system/vdso.h"
+#include "hardware/hrtimer.h"
+#include "hardware/tsc.h"
+#include "mem/alloc/zone_allocator.h"
+#include "mem/mm/mm.h"
+#include "mem/mm/vm_area.h"
+#include "mem/paging.h"
+#include "process/process.h"
+#include "string.h"
+#include "sys/mman.h"
+#include "system/syscall.h"
+
+/// The physical page shared with the processes.
+static page_t *vdso_page = NULL;
+/// The content of the page, as seen by the kernel.
+static vdso_data_t *vdso_data = NULL;
+
+/// @name Trampolines of the system calls, defined inside `sysenter.S`
+/// @{
+extern char vdso_sysenter_start[], vdso_sysenter_end[];
+extern char vdso_int80_start[], vdso_int80_end[];
+/// @}
+
+/// @brief Starts an update of the clocks, the readers retry until it ends.
+static inline void __vdso_write_begin(void)
+{
+    vdso_data->seq++;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+/// @brief Ends an update of the clocks.
+static inline void __vdso_write_end(void)
+{
+    __asm__ __volatile__("" ::: "memory");
+    vdso_data->seq++;
+}
+
+int vdso_initialize(void)
+{
+    // The kernel keeps its own reference, the page is never freed.
+    vdso_page = alloc_pages(GFP_KERNEL, 0);
+    if (!vdso_page) {
+        pr_crit("Failed to allocate the shared page.\n");
+        return -1;
+    }
+    vdso_data = (vdso_data_t *)get_virtual_address_from_page(vdso_page);
+    memset(vdso_data, 0, PAGE_SIZE);
+    if (tsc_get_mult()) {
+        vdso_data->clock_mode = VDSO_CLOCK_TSC;
+        vdso_data->tsc_base   = tsc_get_base();
+        vdso_data->tsc_mult   = tsc_get_mult();
+        vdso_data->tsc_shift  = TSC_SHIFT;
+    } else {
+        vdso_data->clock_mode = VDSO_CLOCK_TICK;
+        vdso_data->mono_ns    = hrtimer_get_ns();
+    }
+    // The C library calls the trampoline to enter the system calls.
+    char *trampoline = (char *)vdso_data + VDSO_SYSCALL_OFFSET;
+    if (syscall_has_sysenter()) {
+        memcpy(trampoline, vdso_sysenter_start, vdso_sysenter_end - vdso_sysenter_start);
+    } else {
+        memcpy(trampoline, vdso_int80_start, vdso_int80_end - vdso_int80_start);
+    }
+    return 0;
+}
+
+int vdso_map(mm_struct_t *mm)
+{
+    if (!vdso_page) {
+        return 0;
+    }
+    // The area is created without pages, then the shared one is mapped
+    // read-only. Being shared, it is neither copied on fork nor swapped out.
+    vm_area_struct_t *area = vm_area_create(mm, VDSO_ADDR, PAGE_SIZE, MM_USER | MM_COW, GFP_HIGHUSER);
+    if (!area) {
+        pr_crit("Failed to create the area of the shared page.\n");
+        return -1;
+    }
+    uint32_t phy_addr = get_physical_address_from_page(vdso_page);
+    if (mem_upd_vm_area(mm->pgd, VDSO_ADDR, phy_addr, PAGE_SIZE, MM_PRESENT | MM_USER | MM_UPDADDR) < 0) {
+        pr_crit("Failed to map the shared page.\n");
+        vm_area_destroy(mm, area);
+        return -1;
+    }
+    area->vm_flags = MAP_SHARED;
+    page_inc(vdso_page);
+    return 0;
+}
+
+void vdso_update_clock(void)
+{
+    if (vdso_data && (vdso_data->clock_mode == VDSO_CLOCK_TICK)) {
+        __vdso_write_begin();
+        vdso_data->mono_ns = hrtimer_get_ns();
+        __vdso_write_end();
+    }
+}
+
+void vdso_set_realtime(uint64_t offset)
+{
+    if (vdso_data) {
+        __vdso_write_begin();
+        vdso_data->realtime_offset = offset;
+        __vdso_write_end();
+    }
+}
+
+void vdso_switch(task_struct *next)
+{
+    // There is a single CPU, only the running process reads its identifiers.
+    if (vdso_data) {
+        vdso_data->pid = next->tgid;
+        vdso_data->tid = next->pid;
+    }
+}
@@ -0,0 +1,38 @@
+/// @file b_console.c
+/// @brief Measures the output to the console.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The lines written to the console, commented out for the parsers of the results.
+#define CONSOLE_LINE "# The quick brown fox jumps over the lazy dog.\n"
+
+/// The samples of the lines, and of the single characters.
+static bench_t lines, chars;
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    // The samples are reported once the writes are done, so that the results
+    // are not mixed with what is written.
+    bench_begin(&lines, "console_write_line");
+    for (unsigned i = 0; i < 100; ++i) {
+        bench_start(&lines);
+        write(STDOUT_FILENO, CONSOLE_LINE, sizeof(CONSOLE_LINE) - 1);
+        bench_stop(&lines);
+    }
+    bench_begin(&chars, "console_write_char");
+    write(STDOUT_FILENO, "#", 1);
+    for (unsigned i = 0; i < 100; ++i) {
+        bench_start(&chars);
+        write(STDOUT_FILENO, ".", 1);
+        bench_stop(&chars);
+    }
+    write(STDOUT_FILENO, "\n", 1);
+    bench_report(&lines);
+    bench_report(&chars);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+/// @file b_fault.c
+/// @brief Measures the page faults, of a page allocated on demand and of a page copied on write.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The size of a page.
+#define FAULT_PAGE_SIZE 4096U
+/// The pages touched by each benchmark.
+#define FAULT_PAGES 1024U
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief Maps private anonymous memory.
+/// @return the memory.
+static char *__map(void)
+{
+    char *area = mmap(NULL, FAULT_PAGES * FAULT_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+    return area;
+}
+
+/// @brief Times the first write to each page.
+/// @param name the name of the benchmark.
+/// @param area the memory.
+static void __touch(const char *name, char *area)
+{
+    bench_begin(&b, name);
+    for (unsigned i = 0; i < FAULT_PAGES; ++i) {
+        bench_start(&b);
+        area[i * FAULT_PAGE_SIZE] = 1;
+        bench_stop(&b);
+    }
+    bench_report(&b);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    // The pages are allocated, and zeroed, by the first write.
+    char *area = __map();
+    __touch("fault_demand_zero", area);
+    // Once the pages are present, a write does not fault.
+    __touch("fault_none", area);
+    // The pages are now shared with the child, which copies them by writing.
+    pid_t pid = fork();
+    if (pid == 0) {
+        __touch("fault_cow", area);
+        exit(EXIT_SUCCESS);
+    }
+    waitpid(pid, NULL, 0);
+    munmap(area, FAULT_PAGES * FAULT_PAGE_SIZE);
+    return EXIT_SUCCESS;
+}
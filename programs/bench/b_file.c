@@ -0,0 +1,138 @@
+/// @file b_file.c
+/// @brief Measures the reads and writes of files, and the lookup of paths.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The file written, and read back.
+#define FILE_PATH "/home/user/bench_file.dat"
+/// The folder whose files are read cold.
+#define FILE_COLD_DIR "/bin/tests"
+/// The size of each read and write.
+#define FILE_CHUNK 4096U
+/// The number of chunks of the file.
+#define FILE_CHUNKS 256U
+
+/// The samples, too many for the stack.
+static bench_t b;
+/// The content of the file.
+static char buffer[FILE_CHUNK];
+
+/// @brief Writes the file, timing each chunk.
+static void __bench_write(void)
+{
+    int fd = open(FILE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(FILE_PATH);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t start = bench_rdtsc();
+    bench_begin(&b, "file_write_4k");
+    for (unsigned i = 0; i < FILE_CHUNKS; ++i) {
+        bench_start(&b);
+        write(fd, buffer, FILE_CHUNK);
+        bench_stop(&b);
+    }
+    uint64_t cycles = bench_rdtsc() - start;
+    close(fd);
+    bench_report(&b);
+    bench_report_rate("file_write", (uint64_t)FILE_CHUNKS * FILE_CHUNK, cycles);
+}
+
+/// @brief Reads back the file, which was just written and is cached, timing each chunk.
+static void __bench_read_cached(void)
+{
+    int fd = open(FILE_PATH, O_RDONLY, 0);
+    if (fd < 0) {
+        perror(FILE_PATH);
+        exit(EXIT_FAILURE);
+    }
+    uint64_t start = bench_rdtsc();
+    bench_begin(&b, "file_read_cached_4k");
+    for (unsigned i = 0; i < FILE_CHUNKS; ++i) {
+        bench_start(&b);
+        read(fd, buffer, FILE_CHUNK);
+        bench_stop(&b);
+    }
+    uint64_t cycles = bench_rdtsc() - start;
+    close(fd);
+    bench_report(&b);
+    bench_report_rate("file_read_cached", (uint64_t)FILE_CHUNKS * FILE_CHUNK, cycles);
+}
+
+/// @brief Reads whole files, returning the bytes read.
+/// @param path the file.
+/// @return the bytes read.
+static uint64_t __read_all(const char *path)
+{
+    uint64_t bytes = 0;
+    ssize_t ret;
+    int fd = open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    while ((ret = read(fd, buffer, FILE_CHUNK)) > 0) {
+        bytes += ret;
+    }
+    close(fd);
+    return bytes;
+}
+
+/// @brief Reads the programs of the tests twice: the first time they come from
+///        the disk (if no one read them since the boot), then from the cache.
+static void __bench_read_cold(void)
+{
+    static dirent_t dents[32];
+    static char paths[BENCH_MAX_SAMPLES / 16][NAME_MAX];
+    unsigned count = 0;
+    ssize_t bytes_read;
+    int fd = open(FILE_COLD_DIR, O_RDONLY | O_DIRECTORY, 0);
+    if (fd < 0) {
+        perror(FILE_COLD_DIR);
+        return;
+    }
+    while ((bytes_read = getdents(fd, dents, sizeof(dents))) > 0) {
+        for (size_t i = 0; i < bytes_read / sizeof(dirent_t); ++i) {
+            if ((dents[i].d_type == DT_REG) && (count < sizeof(paths) / sizeof(paths[0]))) {
+                snprintf(paths[count++], NAME_MAX, "%s/%s", FILE_COLD_DIR, dents[i].d_name);
+            }
+        }
+    }
+    close(fd);
+    const char *names[] = {"file_read_cold", "file_read_warm"};
+    for (unsigned pass = 0; pass < 2; ++pass) {
+        uint64_t bytes = 0, start = bench_rdtsc();
+        for (unsigned i = 0; i < count; ++i) {
+            bytes += __read_all(paths[i]);
+        }
+        bench_report_rate(names[pass], bytes, bench_rdtsc() - start);
+    }
+}
+
+/// @brief Looks up a path.
+/// @param arg the path.
+static void __stat(void *arg)
+{
+    stat_t st;
+    stat((const char *)arg, &st);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    memset(buffer, 'x', sizeof(buffer));
+    __bench_write();
+    __bench_read_cached();
+    __bench_read_cold();
+    bench_run(&b, "lookup_shallow", 1000, __stat, FILE_PATH);
+    bench_run(&b, "lookup_deep", 1000, __stat, "/usr/share/man/kprof.man");
+    bench_run(&b, "lookup_missing", 1000, __stat, "/usr/share/man/missing.man");
+    unlink(FILE_PATH);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+/// @file b_fork.c
+/// @brief Measures the creation of processes, with fork() alone and followed by exec().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief Creates a process which exits right away, and waits for it.
+/// @param arg not used.
+static void __fork_exit(void *arg)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit(0);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/// @brief Creates a process which runs a program, and waits for it.
+/// @param arg the program.
+static void __fork_exec(void *arg)
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        char *argv[] = {(char *)arg, NULL};
+        execv((const char *)arg, argv);
+        exit(127);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    bench_run(&b, "fork_exit", 200, __fork_exit, NULL);
+    bench_run(&b, "fork_exec", 100, __fork_exec, "/bin/false");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/// @file b_ipc.c
+/// @brief Measures the operations of the System V message queues, semaphores and shared memory.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+
+#include "bench.h"
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief A message.
+typedef struct {
+    long mtype;     ///< The type of the message.
+    char mtext[64]; ///< The content of the message.
+} bench_msg_t;
+
+/// @brief Sends a message to a queue, and takes it back.
+/// @param arg the queue.
+static void __msg(void *arg)
+{
+    int msqid       = *(int *)arg;
+    bench_msg_t msg = {.mtype = 1};
+    msgsnd(msqid, &msg, sizeof(msg.mtext), 0);
+    msgrcv(msqid, &msg, sizeof(msg.mtext), 1, 0);
+}
+
+/// @brief Releases a semaphore, and takes it back.
+/// @param arg the semaphores.
+static void __sem(void *arg)
+{
+    int semid          = *(int *)arg;
+    struct sembuf up   = {.sem_num = 0, .sem_op = 1, .sem_flg = 0};
+    struct sembuf down = {.sem_num = 0, .sem_op = -1, .sem_flg = 0};
+    semop(semid, &up, 1);
+    semop(semid, &down, 1);
+}
+
+/// @brief Attaches a shared memory segment, writes it, and detaches it.
+/// @param arg the segment.
+static void __shm(void *arg)
+{
+    int shmid = *(int *)arg;
+    char *ptr = shmat(shmid, NULL, 0);
+    if (ptr != (char *)-1) {
+        *ptr = 1;
+        shmdt(ptr);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    int msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msqid < 0) {
+        perror("msgget");
+        return EXIT_FAILURE;
+    }
+    bench_run(&b, "msg_send_receive", 1000, __msg, &msqid);
+    msgctl(msqid, IPC_RMID, NULL);
+    int semid = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600);
+    if (semid < 0) {
+        perror("semget");
+        return EXIT_FAILURE;
+    }
+    bench_run(&b, "sem_up_down", 1000, __sem, &semid);
+    semctl(semid, 0, IPC_RMID, NULL);
+    int shmid = shmget(IPC_PRIVATE, 4096, IPC_CREAT | 0600);
+    if (shmid < 0) {
+        perror("shmget");
+        return EXIT_FAILURE;
+    }
+    bench_run(&b, "shm_attach_detach", 1000, __shm, &shmid);
+    shmctl(shmid, IPC_RMID, NULL);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,37 @@
+/// @file b_malloc.c
+/// @brief Measures an allocation followed by its free, for a few sizes.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include "bench.h"
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief Allocates and frees a block.
+/// @param arg the size of the block.
+static void __malloc_free(void *arg)
+{
+    void *ptr = malloc((size_t)arg);
+    // Touch the block, so that the allocation is not optimized away.
+    *(volatile char *)ptr = 0;
+    free(ptr);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        const char *name;
+        size_t size;
+    } sizes[] = {
+        {"malloc_free_16", 16},
+        {"malloc_free_256", 256},
+        {"malloc_free_4k", 4096},
+        {"malloc_free_64k", 65536},
+    };
+    bench_init();
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        bench_run(&b, sizes[i].name, 2000, __malloc_free, (void *)sizes[i].size);
+    }
+    return EXIT_SUCCESS;
+}
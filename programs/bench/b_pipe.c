@@ -0,0 +1,91 @@
+/// @file b_pipe.c
+/// @brief Measures the latency of a pipe ping-pong between two processes, and the throughput of a pipe.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The bytes moved by the throughput benchmark.
+#define PIPE_BYTES (8U * 1024U * 1024U)
+/// The size of each write of the throughput benchmark.
+#define PIPE_CHUNK 4096U
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// The pipes of the ping-pong, towards the child and back.
+static int ping[2], pong[2];
+
+/// @brief Sends a byte to the child, and waits for it to come back.
+/// @param arg not used.
+static void __pingpong(void *arg)
+{
+    char c = 'x';
+    write(ping[1], &c, 1);
+    read(pong[0], &c, 1);
+}
+
+/// @brief Measures the round trip of a byte, which takes two context switches.
+static void __bench_latency(void)
+{
+    if ((pipe(ping) < 0) || (pipe(pong) < 0)) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        char c;
+        // Echo the bytes, until the pipe is closed.
+        while (read(ping[0], &c, 1) == 1) {
+            write(pong[1], &c, 1);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    bench_run(&b, "pipe_pingpong", 1000, __pingpong, NULL);
+    close(ping[1]);
+    waitpid(pid, NULL, 0);
+    close(ping[0]);
+    close(pong[0]);
+    close(pong[1]);
+}
+
+/// @brief Measures the bytes a child moves to its parent through a pipe.
+static void __bench_throughput(void)
+{
+    static char buffer[PIPE_CHUNK];
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t start = bench_rdtsc();
+    pid_t pid      = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        for (unsigned sent = 0; sent < PIPE_BYTES; sent += PIPE_CHUNK) {
+            write(fds[1], buffer, PIPE_CHUNK);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    close(fds[1]);
+    uint64_t received = 0;
+    ssize_t ret;
+    while ((ret = read(fds[0], buffer, PIPE_CHUNK)) > 0) {
+        received += ret;
+    }
+    uint64_t cycles = bench_rdtsc() - start;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    bench_report_rate("pipe_throughput", received, cycles);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    __bench_latency();
+    __bench_throughput();
+    return EXIT_SUCCESS;
+}
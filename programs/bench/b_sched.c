@@ -0,0 +1,36 @@
+/// @file b_sched.c
+/// @brief Measures a context switch, as two processes yielding the CPU to each other.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief Yields the CPU, which goes to the other process and then back.
+/// @param arg not used.
+static void __yield(void *arg) { sched_yield(); }
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    // Without another process, the yield does not switch.
+    bench_run(&b, "sched_yield_alone", 1000, __yield, NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        while (1) {
+            sched_yield();
+        }
+    }
+    // A sample is two context switches, to the child and back.
+    bench_run(&b, "sched_yield_pingpong", 1000, __yield, NULL);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return EXIT_SUCCESS;
+}
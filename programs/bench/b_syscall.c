@@ -0,0 +1,27 @@
+/// @file b_syscall.c
+/// @brief Measures the round trip of a system call.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <unistd.h>
+
+#include "bench.h"
+
+/// The samples, too many for the stack.
+static bench_t b;
+
+/// @brief Enters the kernel, with the cheapest system call.
+/// @param arg not used.
+static void __getppid(void *arg) { getppid(); }
+
+/// @brief Reads the process identifier from the shared page, without entering the kernel.
+/// @param arg not used.
+static void __getpid(void *arg) { getpid(); }
+
+int main(int argc, char *argv[])
+{
+    bench_init();
+    bench_run(&b, "syscall_getppid", 2000, __getppid, NULL);
+    bench_run(&b, "vdso_getpid", 2000, __getpid, NULL);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/// @file bench.h
+/// @brief The harness of the microbenchmarks, timing with the TSC.
+/// @details
+/// A benchmark runs an operation a number of times, after a few rounds of
+/// warm-up, and times each run with the time-stamp counter; the cost of
+/// reading it is measured once, and taken off every sample. The samples are
+/// then sorted, and reported as a single line of `key=value` pairs:
+///
+///     bench=syscall_getpid unit=cycles n=1000 min=510 p50=540 p90=610 p99=900 max=4800 mean=560 p50_ns=180
+///
+/// Throughputs are reported as `bench=NAME unit=bytes bytes=B cycles=C mb_per_s=M`.
+/// The first line of each program is `# tsc_khz=K`, the frequency of the TSC.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// The largest number of samples of a benchmark.
+#define BENCH_MAX_SAMPLES 4096
+
+/// @brief The samples of a benchmark.
+typedef struct bench {
+    const char *name;                    ///< The name of the benchmark.
+    unsigned count;                      ///< The number of samples.
+    uint64_t start;                      ///< When the current sample started.
+    uint64_t samples[BENCH_MAX_SAMPLES]; ///< The samples, in cycles.
+} bench_t;
+
+/// The frequency of the TSC, in kHz.
+static uint32_t bench_tsc_khz;
+/// The cycles taken by reading the TSC twice.
+static uint64_t bench_overhead;
+
+/// @brief Reads the time-stamp counter, once the previous instructions are done.
+/// @return the cycles since the CPU started.
+static inline uint64_t bench_rdtsc(void)
+{
+    uint32_t low, high;
+    __asm__ __volatile__("lfence; rdtsc" : "=a"(low), "=d"(high)::"memory");
+    return ((uint64_t)high << 32U) | low;
+}
+
+/// @brief Divides two 64-bit values, without libgcc.
+/// @param n the dividend.
+/// @param d the divisor, not zero.
+/// @return the quotient, approximated once the divisor does not fit 32 bits.
+static inline uint64_t bench_div(uint64_t n, uint64_t d)
+{
+    // Keep the most significant bits of the divisor.
+    while (d >> 32U) {
+        n >>= 1U;
+        d >>= 1U;
+    }
+    uint32_t high = (uint32_t)(n >> 32U), low = (uint32_t)n, rem;
+    // The high half first, its remainder then comes above the low half.
+    __asm__("divl %4" : "=a"(high), "=d"(rem) : "a"(high), "d"(0), "rm"((uint32_t)d));
+    __asm__("divl %4" : "=a"(low), "=d"(rem) : "a"(low), "d"(rem), "rm"((uint32_t)d));
+    return ((uint64_t)high << 32U) | low;
+}
+
+/// @brief Formats a 64-bit value, which printf() does not support.
+/// @param value the value.
+/// @return the value, in a buffer which is reused every 8 calls.
+static inline const char *bench_u64(uint64_t value)
+{
+    static char buffers[8][24];
+    static unsigned next = 0;
+    char *buffer         = buffers[next++ % 8];
+    char *ptr            = buffer + sizeof(buffers[0]) - 1;
+    *ptr                 = 0;
+    do {
+        uint64_t quotient = bench_div(value, 10);
+        *--ptr            = (char)('0' + (value - quotient * 10));
+        value             = quotient;
+    } while (value);
+    return ptr;
+}
+
+/// @brief Turns cycles into nanoseconds.
+/// @param cycles the cycles.
+/// @return the nanoseconds.
+static inline uint64_t bench_ns(uint64_t cycles)
+{
+    return bench_tsc_khz ? bench_div(cycles * 1000000ULL, bench_tsc_khz) : 0;
+}
+
+/// @brief Measures the frequency of the TSC, and the cost of reading it.
+/// @details Must be called before any benchmark, it prints the frequency.
+static inline void bench_init(void)
+{
+    struct timespec start, end;
+    // Count the cycles of about 50 milliseconds.
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t tsc = bench_rdtsc(), ns;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+    } while (ns < 50000000ULL);
+    bench_tsc_khz  = (uint32_t)bench_div((bench_rdtsc() - tsc) * 1000000ULL, ns);
+    // The smallest of a few readings, which is the best case.
+    bench_overhead = ~0ULL;
+    for (unsigned i = 0; i < 100; ++i) {
+        uint64_t first = bench_rdtsc(), elapsed = bench_rdtsc() - first;
+        if (elapsed < bench_overhead) {
+            bench_overhead = elapsed;
+        }
+    }
+    printf("# tsc_khz=%u overhead=%s\n", bench_tsc_khz, bench_u64(bench_overhead));
+}
+
+/// @brief Starts a benchmark.
+/// @param b the benchmark.
+/// @param name its name.
+static inline void bench_begin(bench_t *b, const char *name)
+{
+    b->name  = name;
+    b->count = 0;
+}
+
+/// @brief Starts timing a sample.
+/// @param b the benchmark.
+static inline void bench_start(bench_t *b) { b->start = bench_rdtsc(); }
+
+/// @brief Stops timing a sample, and records it.
+/// @param b the benchmark.
+static inline void bench_stop(bench_t *b)
+{
+    uint64_t elapsed = bench_rdtsc() - b->start;
+    if (b->count < BENCH_MAX_SAMPLES) {
+        b->samples[b->count++] = (elapsed > bench_overhead) ? elapsed - bench_overhead : 0;
+    }
+}
+
+/// @brief Sorts the samples (a shell sort, the samples are few).
+/// @param samples the samples.
+/// @param count the number of samples.
+static inline void bench_sort(uint64_t *samples, unsigned count)
+{
+    for (unsigned gap = count / 2; gap > 0; gap /= 2) {
+        for (unsigned i = gap; i < count; ++i) {
+            uint64_t value = samples[i];
+            unsigned j     = i;
+            while ((j >= gap) && (samples[j - gap] > value)) {
+                samples[j] = samples[j - gap];
+                j -= gap;
+            }
+            samples[j] = value;
+        }
+    }
+}
+
+/// @brief Returns a percentile of the sorted samples.
+/// @param b the benchmark.
+/// @param percent the percentile.
+/// @return the sample.
+static inline uint64_t bench_percentile(bench_t *b, unsigned percent)
+{
+    return b->samples[((b->count - 1) * percent) / 100];
+}
+
+/// @brief Reports the samples of a benchmark.
+/// @param b the benchmark.
+static inline void bench_report(bench_t *b)
+{
+    if (!b->count) {
+        printf("bench=%s unit=cycles n=0\n", b->name);
+        return;
+    }
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < b->count; ++i) {
+        sum += b->samples[i];
+    }
+    bench_sort(b->samples, b->count);
+    printf(
+        "bench=%s unit=cycles n=%u min=%s p50=%s p90=%s p99=%s max=%s mean=%s p50_ns=%s\n", b->name, b->count,
+        bench_u64(b->samples[0]), bench_u64(bench_percentile(b, 50)), bench_u64(bench_percentile(b, 90)),
+        bench_u64(bench_percentile(b, 99)), bench_u64(b->samples[b->count - 1]), bench_u64(bench_div(sum, b->count)),
+        bench_u64(bench_ns(bench_percentile(b, 50))));
+}
+
+/// @brief Runs an operation, after a tenth of the iterations as warm-up, and reports it.
+/// @param b the benchmark.
+/// @param name the name of the benchmark.
+/// @param iterations the number of samples, at most BENCH_MAX_SAMPLES.
+/// @param fn the operation.
+/// @param arg the argument of the operation.
+static inline void bench_run(bench_t *b, const char *name, unsigned iterations, void (*fn)(void *), void *arg)
+{
+    for (unsigned i = 0; i < (iterations / 10) + 1; ++i) {
+        fn(arg);
+    }
+    bench_begin(b, name);
+    for (unsigned i = 0; i < iterations; ++i) {
+        bench_start(b);
+        fn(arg);
+        bench_stop(b);
+    }
+    bench_report(b);
+}
+
+/// @brief Reports a throughput.
+/// @param name the name of the benchmark.
+/// @param bytes the bytes moved.
+/// @param cycles the cycles it took.
+static inline void bench_report_rate(const char *name, uint64_t bytes, uint64_t cycles)
+{
+    // Bytes per microsecond are megabytes per second.
+    uint64_t ns = bench_ns(cycles);
+    printf(
+        "bench=%s unit=bytes bytes=%s cycles=%s mb_per_s=%s\n", name, bench_u64(bytes), bench_u64(cycles),
+        bench_u64(ns ? bench_div(bytes * 1000ULL, ns) : 0));
+}
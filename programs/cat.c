@@ -9,9 +9,13 @@
 #include <stdlib.h>
 #include <strerror.h>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+/// Number of bytes we ask the kernel to send with each call.
+#define SEND_CHUNK (1024 * 1024)
+
 int main(int argc, char **argv)
 {
     if (argc < 2) {
@@ -30,8 +34,6 @@ int main(int argc, char **argv)
     }
     int ret = 0;
     int fd;
-    // Prepare the buffer for reading.
-    char buffer[BUFSIZ];
     // Iterate the arguments.
     for (int i = 1; i < argc; ++i) {
         // Initialize the file path.
@@ -43,13 +45,12 @@ int main(int argc, char **argv)
             ret = EXIT_FAILURE;
             continue;
         }
-        ssize_t bytes_read = 0;
-        // Put on the standard output the characters.
-        while ((bytes_read = read(fd, buffer, BUFSIZ)) > 0) {
-            write(STDOUT_FILENO, buffer, bytes_read);
+        ssize_t bytes_sent = 0;
+        // Let the kernel put the characters on the standard output.
+        while ((bytes_sent = sendfile(STDOUT_FILENO, fd, NULL, SEND_CHUNK)) > 0) {
         }
         close(fd);
-        if (bytes_read < 0) {
+        if (bytes_sent < 0) {
             printf("%s: %s: %s\n", argv[0], filepath, strerror(errno));
             ret = EXIT_FAILURE;
         }
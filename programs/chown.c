@@ -23,7 +23,7 @@ int main(int argc, char *argv[])
     group_t *grp;
 
     if (argc != 3) {
-        fprintf(STDERR_FILENO, "%s: [OWNER][:[GROUP]] FILE\n", argv[0]);
+        fprintf(stderr, "%s: [OWNER][:[GROUP]] FILE\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
@@ -33,7 +33,7 @@ int main(int argc, char *argv[])
         if (*endptr != '\0') {            /* Was not pure numeric string */
             pwd = getpwnam(idptr);        /* Try getting UID for username */
             if (pwd == NULL) {
-                fprintf(STDERR_FILENO, "%s: invalid user: %s\n", argv[0], idptr);
+                fprintf(stderr, "%s: invalid user: %s\n", argv[0], idptr);
                 exit(EXIT_FAILURE);
             }
 
@@ -47,7 +47,7 @@ int main(int argc, char *argv[])
         if (*endptr != '\0') {            /* Was not pure numeric string */
             grp = getgrnam(idptr);        /* Try getting GID for groupname */
             if (grp == NULL) {
-                fprintf(STDERR_FILENO, "%s: invalid group: %s\n", argv[0], idptr);
+                fprintf(stderr, "%s: invalid group: %s\n", argv[0], idptr);
                 exit(EXIT_FAILURE);
             }
 
@@ -56,7 +56,7 @@ int main(int argc, char *argv[])
     }
 
     if (chown(argv[2], uid, gid) == -1) {
-        fprintf(STDERR_FILENO, "%s: changing ownership of %s: %s\n", argv[0], argv[2], strerror(errno));
+        fprintf(stderr, "%s: changing ownership of %s: %s\n", argv[0], argv[2], strerror(errno));
         exit(EXIT_FAILURE);
     }
 
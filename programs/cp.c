@@ -13,6 +13,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+/// Number of bytes we ask the kernel to copy with each call.
+#define COPY_CHUNK (1024 * 1024)
+
 int main(int argc, char **argv)
 {
     if (argc < 3) {
@@ -28,11 +31,9 @@ int main(int argc, char **argv)
             return EXIT_SUCCESS;
         }
     }
-    // Prepare the buffer for reading.
-    ssize_t bytes_read = 0;
-    char buffer[BUFSIZ];
-    char *src  = argv[1];
-    char *dest = argv[2];
+    ssize_t bytes_copied = 0;
+    char *src            = argv[1];
+    char *dest           = argv[2];
 
     int srcfd = open(src, O_RDONLY, 0);
     if (srcfd < 0) {
@@ -44,11 +45,11 @@ int main(int argc, char **argv)
         err(EXIT_FAILURE, "%s: %s", argv[0], dest);
     }
 
-    // Write the content read from srcfd to destfd
-    while ((bytes_read = read(srcfd, buffer, sizeof(buffer))) > 0) {
-        if (write(destfd, buffer, bytes_read) != bytes_read) {
-            err(EXIT_FAILURE, "%s: %s", argv[0], dest);
-        }
+    // Let the kernel move the content from srcfd to destfd.
+    while ((bytes_copied = copy_file_range(srcfd, NULL, destfd, NULL, COPY_CHUNK, 0)) > 0) {
+    }
+    if (bytes_copied < 0) {
+        err(EXIT_FAILURE, "%s: %s", argv[0], dest);
     }
     // Close the file descriptors.
     close(srcfd);
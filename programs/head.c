@@ -27,7 +27,7 @@ static int head(int fd, const char *fname, size_t n)
         char *lineend;
         while (i < n && (lineend = memchr(line, '\n', sizeof(buffer) - (line - buffer)))) {
             lineend++; // Include the newline
-            write(STDOUT_FILENO, line, lineend - line);
+            fwrite(line, 1, lineend - line, stdout);
             line = lineend;
             i++;
         }
@@ -43,7 +43,7 @@ static int head(int fd, const char *fname, size_t n)
 
     close(fd);
     if (bytes_read < 0) {
-        fprintf(STDERR_FILENO, "head: %s: %s\n", fname, strerror(errno));
+        fprintf(stderr, "head: %s: %s\n", fname, strerror(errno));
         return EXIT_FAILURE;
     }
 
@@ -96,7 +96,7 @@ int main(int argc, char **argv)
         } else {
             fd = open(fname, O_RDONLY, 0);
             if (fd < 0) {
-                fprintf(STDERR_FILENO, "head: %s: %s\n", fname, strerror(errno));
+                fprintf(stderr, "head: %s: %s\n", fname, strerror(errno));
                 ret = EXIT_FAILURE;
                 continue;
             }
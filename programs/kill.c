@@ -23,7 +23,7 @@ static inline int is_number(char *s)
 
 static inline void print_signal_list(void)
 {
-    for (int it = 1; it < (NSIG - 1); ++it) {
+    for (int it = 1; it < SIGRTMIN; ++it) {
         printf("%6s ", strsignal(it));
         if ((it % 8) == 0) {
             putchar('\n');
@@ -38,7 +38,7 @@ static inline int get_signal(char *s)
         signr = atoi(s);
     } else {
         ++s;
-        for (int it = 1; it < (NSIG - 1); ++it) {
+        for (int it = 1; it < SIGRTMIN; ++it) {
             if (strcmp(s, strsignal(it)) == 0) {
                 signr = it;
                 break;
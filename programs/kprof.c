@@ -0,0 +1,469 @@
+/// @file kprof.c
+/// @brief Controls the sampling profiler of the kernel, and symbolizes its samples.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <unistd.h>
+
+/// The file which controls the profiler, and lists its samples.
+#define PROFILE_PATH "/proc/profile"
+/// The number of lines of each table, by default.
+#define DEFAULT_ROWS 20
+/// The type of the section holding the symbol table.
+#define SHT_SYMTAB 2
+/// The type of the symbols of the functions.
+#define STT_FUNC 2
+
+/// @brief The header of an ELF file, only the fields we use are named.
+typedef struct elf_header {
+    uint8_t ident[16];  ///< The magic number, and the class of the file.
+    uint16_t type;      ///< The type of the object.
+    uint16_t machine;   ///< The architecture.
+    uint32_t version;   ///< The version of the format.
+    uint32_t entry;     ///< The entry point.
+    uint32_t phoff;     ///< The offset of the program headers.
+    uint32_t shoff;     ///< The offset of the section headers.
+    uint32_t flags;     ///< The flags of the architecture.
+    uint16_t ehsize;    ///< The size of this header.
+    uint16_t phentsize; ///< The size of a program header.
+    uint16_t phnum;     ///< The number of program headers.
+    uint16_t shentsize; ///< The size of a section header.
+    uint16_t shnum;     ///< The number of section headers.
+    uint16_t shstrndx;  ///< The section holding the names of the sections.
+} elf_header_t;
+
+/// @brief A section header of an ELF file.
+typedef struct elf_section_header {
+    uint32_t name;      ///< The offset of the name, inside the names of the sections.
+    uint32_t type;      ///< The type of the section.
+    uint32_t flags;     ///< The flags of the section.
+    uint32_t addr;      ///< The address of the section in memory.
+    uint32_t offset;    ///< The offset of the section inside the file.
+    uint32_t size;      ///< The size of the section.
+    uint32_t link;      ///< For a symbol table, the section holding the names of the symbols.
+    uint32_t info;      ///< Extra information, which depends on the type.
+    uint32_t addralign; ///< The alignment of the section.
+    uint32_t entsize;   ///< The size of the entries of the section.
+} elf_section_header_t;
+
+/// @brief A symbol of an ELF file.
+typedef struct elf_symbol {
+    uint32_t name;  ///< The offset of the name, inside the names of the symbols.
+    uint32_t value; ///< The address of the symbol.
+    uint32_t size;  ///< The size of the symbol.
+    uint8_t info;   ///< The type of the symbol, in the low four bits, and its binding.
+    uint8_t other;  ///< The visibility of the symbol.
+    uint16_t shndx; ///< The section of the symbol.
+} elf_symbol_t;
+
+/// @brief A function of the kernel, with the samples which fell inside it.
+typedef struct function {
+    uint32_t addr;         ///< The address of the function.
+    uint32_t size;         ///< The size of the function, 0 if it is not known.
+    const char *name;      ///< The name of the function.
+    unsigned long samples; ///< The samples which fell inside the function.
+} function_t;
+
+/// @brief An instruction of the kernel, with the samples which interrupted it.
+typedef struct site {
+    uint32_t eip;          ///< The address of the instruction.
+    unsigned long samples; ///< The samples which interrupted it.
+} site_t;
+
+/// @brief Sorts an array, with a shell sort.
+/// @param base the array.
+/// @param count the number of elements.
+/// @param size the size of an element.
+/// @param compare returns a negative value if the first element goes before the second one.
+static void __sort(void *base, size_t count, size_t size, int (*compare)(const void *, const void *))
+{
+    // The elements are at most as large as a function.
+    char *array = (char *)base, tmp[sizeof(function_t)];
+    for (size_t gap = count / 2; gap > 0; gap /= 2) {
+        for (size_t i = gap; i < count; ++i) {
+            memcpy(tmp, array + (i * size), size);
+            size_t j = i;
+            for (; (j >= gap) && (compare(array + ((j - gap) * size), tmp) > 0); j -= gap) {
+                memcpy(array + (j * size), array + ((j - gap) * size), size);
+            }
+            memcpy(array + (j * size), tmp, size);
+        }
+    }
+}
+
+/// @brief Orders the functions by address.
+/// @param a the first function.
+/// @param b the second function.
+/// @return a negative value if the first goes before the second one, a positive value if it goes after.
+static int __compare_function_addr(const void *a, const void *b)
+{
+    const function_t *fa = a, *fb = b;
+    return (fa->addr > fb->addr) - (fa->addr < fb->addr);
+}
+
+/// @brief Orders the functions by samples, the most sampled first.
+/// @param a the first function.
+/// @param b the second function.
+/// @return a negative value if the first goes before the second one, a positive value if it goes after.
+static int __compare_function_samples(const void *a, const void *b)
+{
+    const function_t *fa = a, *fb = b;
+    return (fa->samples < fb->samples) - (fa->samples > fb->samples);
+}
+
+/// @brief Orders the addresses.
+/// @param a the first address.
+/// @param b the second address.
+/// @return a negative value if the first goes before the second one, a positive value if it goes after.
+static int __compare_eip(const void *a, const void *b)
+{
+    uint32_t ea = *(const uint32_t *)a, eb = *(const uint32_t *)b;
+    return (ea > eb) - (ea < eb);
+}
+
+/// @brief Orders the sites by samples, the most sampled first.
+/// @param a the first site.
+/// @param b the second site.
+/// @return a negative value if the first goes before the second one, a positive value if it goes after.
+static int __compare_site_samples(const void *a, const void *b)
+{
+    const site_t *sa = a, *sb = b;
+    return (sa->samples < sb->samples) - (sa->samples > sb->samples);
+}
+
+/// @brief Reads a part of a file.
+/// @param fd the file descriptor.
+/// @param offset where the part starts.
+/// @param size the size of the part.
+/// @return the part, allocated with malloc, NULL on failure.
+static void *__read_at(int fd, uint32_t offset, uint32_t size)
+{
+    char *buffer = malloc(size + 1);
+    if (!buffer || (lseek(fd, offset, SEEK_SET) != (off_t)offset)) {
+        free(buffer);
+        return NULL;
+    }
+    size_t done = 0;
+    for (ssize_t ret; done < size; done += ret) {
+        if ((ret = read(fd, buffer + done, size - done)) <= 0) {
+            free(buffer);
+            return NULL;
+        }
+    }
+    buffer[size] = '\0';
+    return buffer;
+}
+
+/// @brief Loads the functions of the kernel, from the symbol table of its ELF file.
+/// @param path the path of the ELF file.
+/// @param count where the number of functions is stored.
+/// @param strtab where the names of the functions are stored, to free them along with the functions.
+/// @return the functions ordered by address, NULL on failure.
+static function_t *__load_functions(const char *path, size_t *count, char **strtab)
+{
+    int fd = open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("kprof: cannot open '%s': %s\n", path, strerror(errno));
+        return NULL;
+    }
+    elf_header_t *header           = __read_at(fd, 0, sizeof(elf_header_t));
+    elf_section_header_t *sections = NULL;
+    elf_symbol_t *symbols          = NULL;
+    char *names                    = NULL;
+    function_t *functions          = NULL;
+    *count                         = 0;
+    if (!header || memcmp(header->ident, "\x7f" "ELF", 4) || (header->shentsize != sizeof(elf_section_header_t))) {
+        printf("kprof: '%s' is not an ELF file.\n", path);
+    } else if (!(sections = __read_at(fd, header->shoff, header->shnum * sizeof(elf_section_header_t)))) {
+        printf("kprof: cannot read the sections of '%s'.\n", path);
+    } else {
+        for (unsigned i = 0; i < header->shnum; ++i) {
+            elf_section_header_t *symtab = &sections[i];
+            if ((symtab->type != SHT_SYMTAB) || (symtab->link >= header->shnum)) {
+                continue;
+            }
+            size_t nsymbols = symtab->size / sizeof(elf_symbol_t);
+            symbols         = __read_at(fd, symtab->offset, symtab->size);
+            names           = __read_at(fd, sections[symtab->link].offset, sections[symtab->link].size);
+            functions       = malloc((nsymbols + 1) * sizeof(function_t));
+            if (!symbols || !names || !functions) {
+                break;
+            }
+            for (size_t j = 0; j < nsymbols; ++j) {
+                elf_symbol_t *symbol = &symbols[j];
+                if (((symbol->info & 0xF) != STT_FUNC) || !symbol->value ||
+                    (symbol->name >= sections[symtab->link].size)) {
+                    continue;
+                }
+                functions[(*count)++] = (function_t){symbol->value, symbol->size, names + symbol->name, 0};
+            }
+            break;
+        }
+        if (!functions || !*count) {
+            printf("kprof: '%s' has no symbol table.\n", path);
+        }
+    }
+    close(fd);
+    free(header);
+    free(sections);
+    free(symbols);
+    if (!functions || !*count) {
+        free(names);
+        free(functions);
+        return NULL;
+    }
+    // The functions point inside the names.
+    *strtab = names;
+    __sort(functions, *count, sizeof(function_t), __compare_function_addr);
+    return functions;
+}
+
+/// @brief Finds the function holding an address.
+/// @param functions the functions, ordered by address.
+/// @param count the number of functions.
+/// @param eip the address.
+/// @return the function, NULL if the address is outside all of them.
+static function_t *__find_function(function_t *functions, size_t count, uint32_t eip)
+{
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + ((high - low) / 2);
+        if (functions[mid].addr <= eip) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return NULL;
+    }
+    function_t *function = &functions[low - 1];
+    // Without a size, the function is assumed to last until the next one.
+    if (function->size && (eip >= (function->addr + function->size))) {
+        return NULL;
+    }
+    return function;
+}
+
+/// @brief Parses an hexadecimal number.
+/// @param it the text, upon return it points after the number.
+/// @return the number.
+static uint32_t __parse_hex(const char **it)
+{
+    uint32_t value = 0;
+    for (;; ++(*it)) {
+        char c = **it;
+        if ((c >= '0') && (c <= '9')) {
+            value = (value << 4U) | (uint32_t)(c - '0');
+        } else if ((c >= 'a') && (c <= 'f')) {
+            value = (value << 4U) | (uint32_t)(c - 'a' + 10);
+        } else {
+            return value;
+        }
+    }
+}
+
+/// @brief Reads the samples which interrupted the kernel.
+/// @param count where the number of kernel samples is stored.
+/// @param user where the number of user samples is stored.
+/// @return the addresses of the kernel samples, NULL on failure.
+static uint32_t *__load_samples(size_t *count, size_t *user)
+{
+    int fd = open(PROFILE_PATH, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("kprof: cannot open '%s': %s\n", PROFILE_PATH, strerror(errno));
+        return NULL;
+    }
+    size_t capacity = 4096, length = 0;
+    char *text      = malloc(capacity);
+    while (text) {
+        // The buffer doubles when it is almost full.
+        if ((capacity - length) < 512) {
+            char *larger = realloc(text, capacity * 2);
+            if (!larger) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = larger;
+            capacity *= 2;
+        }
+        ssize_t ret = read(fd, text + length, capacity - length - 1);
+        if (ret <= 0) {
+            if (ret < 0) {
+                free(text);
+                text = NULL;
+            }
+            break;
+        }
+        length += ret;
+    }
+    close(fd);
+    if (!text) {
+        printf("kprof: cannot read '%s'.\n", PROFILE_PATH);
+        return NULL;
+    }
+    text[length] = '\0';
+    // Each line is `cpu cpl eip pid`.
+    uint32_t *eips = malloc(((length / 8) + 1) * sizeof(uint32_t));
+    *count = *user = 0;
+    for (const char *line = text; eips && *line;) {
+        const char *cpl = strchr(line, ' ');
+        const char *eip = cpl ? strchr(cpl + 1, ' ') : NULL;
+        if (!eip) {
+            break;
+        }
+        ++eip;
+        if (cpl[1] == '0') {
+            eips[(*count)++] = __parse_hex(&eip);
+        } else {
+            ++(*user);
+        }
+        const char *next = strchr(eip, '\n');
+        line             = next ? next + 1 : eip + strlen(eip);
+    }
+    free(text);
+    return eips;
+}
+
+/// @brief Prints the functions which were sampled the most.
+/// @param functions the functions.
+/// @param count the number of functions.
+/// @param total the number of samples.
+/// @param rows the number of functions to print.
+static void __print_flat(function_t *functions, size_t count, size_t total, size_t rows)
+{
+    printf("Flat profile:\n");
+    printf("%8s %7s  %s\n", "samples", "%", "function");
+    __sort(functions, count, sizeof(function_t), __compare_function_samples);
+    for (size_t i = 0; (i < count) && (i < rows) && functions[i].samples; ++i) {
+        printf("%8lu %6.2f%%  %s\n", functions[i].samples, (100.0 * functions[i].samples) / total, functions[i].name);
+    }
+    __sort(functions, count, sizeof(function_t), __compare_function_addr);
+}
+
+/// @brief Prints the instructions which were sampled the most, as function+offset.
+/// @param functions the functions, ordered by address.
+/// @param count the number of functions.
+/// @param eips the kernel samples, ordered by address.
+/// @param neips the number of kernel samples.
+/// @param total the number of samples.
+/// @param rows the number of instructions to print.
+static void __print_sites(function_t *functions, size_t count, uint32_t *eips, size_t neips, size_t total, size_t rows)
+{
+    site_t *sites = malloc((neips + 1) * sizeof(site_t));
+    size_t nsites = 0;
+    if (!sites) {
+        return;
+    }
+    for (size_t i = 0; i < neips; ++i) {
+        if (nsites && (sites[nsites - 1].eip == eips[i])) {
+            ++sites[nsites - 1].samples;
+        } else {
+            sites[nsites++] = (site_t){eips[i], 1};
+        }
+    }
+    __sort(sites, nsites, sizeof(site_t), __compare_site_samples);
+    printf("\nHottest instructions:\n");
+    printf("%8s %7s  %-8s  %s\n", "samples", "%", "address", "site");
+    for (size_t i = 0; (i < nsites) && (i < rows); ++i) {
+        function_t *function = __find_function(functions, count, sites[i].eip);
+        printf("%8lu %6.2f%%  %08x  ", sites[i].samples, (100.0 * sites[i].samples) / total, sites[i].eip);
+        if (function) {
+            printf("%s+0x%x\n", function->name, sites[i].eip - function->addr);
+        } else {
+            printf("[unknown]\n");
+        }
+    }
+    free(sites);
+}
+
+/// @brief Starts, or stops, the profiler.
+/// @param command `1` to start, `0` to stop.
+/// @return 0 on success, 1 on failure.
+static int __control(const char *command)
+{
+    int fd = open(PROFILE_PATH, O_WRONLY, 0);
+    if ((fd < 0) || (write(fd, command, strlen(command)) < 0)) {
+        printf("kprof: cannot write '%s': %s\n", PROFILE_PATH, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc == 2) && (strcmp(argv[1], "--help") == 0)) {
+        printf("Controls the sampling profiler of the kernel, and reports where the kernel spends its time.\n");
+        printf("Usage:\n");
+        printf("    kprof start\n");
+        printf("    kprof stop\n");
+        printf("    kprof [-n ROWS] KERNEL\n");
+        return 0;
+    }
+    if ((argc == 2) && (strcmp(argv[1], "start") == 0)) {
+        return __control("1");
+    }
+    if ((argc == 2) && (strcmp(argv[1], "stop") == 0)) {
+        return __control("0");
+    }
+    size_t rows = DEFAULT_ROWS;
+    if ((argc == 4) && (strcmp(argv[1], "-n") == 0) && (atoi(argv[2]) > 0)) {
+        rows = atoi(argv[2]);
+    } else if (argc != 2) {
+        printf("Bad usage.\n");
+        printf("Try 'kprof --help' for more information.\n");
+        return 1;
+    }
+    size_t nfunctions;
+    char *strtab;
+    function_t *functions = __load_functions(argv[argc - 1], &nfunctions, &strtab);
+    if (!functions) {
+        return 1;
+    }
+    size_t neips, user;
+    uint32_t *eips = __load_samples(&neips, &user);
+    if (!eips) {
+        free(functions);
+        free(strtab);
+        return 1;
+    }
+    size_t total = neips + user;
+    printf("%u samples, %u inside the kernel, %u in user mode.\n", total, neips, user);
+    if (!neips) {
+        free(eips);
+        free(functions);
+        free(strtab);
+        return 0;
+    }
+    size_t unknown = 0;
+    for (size_t i = 0; i < neips; ++i) {
+        function_t *function = __find_function(functions, nfunctions, eips[i]);
+        if (function) {
+            ++function->samples;
+        } else {
+            ++unknown;
+        }
+    }
+    printf("\n");
+    __print_flat(functions, nfunctions, total, rows);
+    if (unknown) {
+        printf("%8u %6.2f%%  [unknown]\n", unknown, (100.0 * unknown) / total);
+    }
+    __sort(eips, neips, sizeof(uint32_t), __compare_eip);
+    __print_sites(functions, nfunctions, eips, neips, total, rows);
+    free(eips);
+    free(functions);
+    free(strtab);
+    return 0;
+}
@@ -44,7 +44,7 @@ static inline void __print_message_file(const char *file)
     while ((nbytes = read(fd, buffer, sizeof(buffer) - 1)) > 0) {
         buffer[nbytes] = '\0'; // Null-terminate the string
         // TODO: Parsing message files for special characters (such as `\t` for time).
-        write(STDOUT_FILENO, buffer, nbytes); // Write to standard output.
+        fwrite(buffer, 1, nbytes, stdout); // Write to standard output.
     }
 
     // Close the file descriptor
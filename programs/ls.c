@@ -21,7 +21,8 @@
 #define FLAG_I (1U << 2U)
 #define FLAG_1 (1U << 3U)
 
-#define DENTS_NUM 12
+/// The number of entries read by each getdents() call.
+#define DENTS_NUM 128
 
 static inline const char *to_human_size(unsigned long bytes)
 {
@@ -64,7 +65,8 @@ static inline void print_dir_entry_name(const char *name, mode_t st_mode)
     }
 }
 
-static inline void print_dir_entry(dirent_t *dirent, const char *path, unsigned int flags, size_t *total_size)
+static inline void
+print_dir_entry(dirent_t *dirent, int dirfd, const char *path, unsigned int flags, size_t *total_size)
 {
     static char relative_path[PATH_MAX];
     tm_t *timeinfo;
@@ -76,17 +78,9 @@ static inline void print_dir_entry(dirent_t *dirent, const char *path, unsigned
         return;
     }
 
-    // Prepare the relative path.
-    strncpy(relative_path, path, PATH_MAX - 1);
-    relative_path[PATH_MAX - 1] = '\0';
-    if (path[strnlen(path, PATH_MAX) - 1] != '/') {
-        strncat(relative_path, "/", PATH_MAX);
-    }
-    strncat(relative_path, dirent->d_name, PATH_MAX);
-
-    // Stat the file.
-    if (stat(relative_path, &dstat) < 0) {
-        printf("ls: failed to stat `%s`\n", relative_path);
+    // Stat the file, looking it up from the open directory.
+    if (fstatat(dirfd, dirent->d_name, &dstat, AT_SYMLINK_NOFOLLOW) < 0) {
+        printf("ls: failed to stat `%s`\n", dirent->d_name);
         return;
     }
 
@@ -120,6 +114,13 @@ static inline void print_dir_entry(dirent_t *dirent, const char *path, unsigned
         print_dir_entry_name(dirent->d_name, dstat.st_mode);
 
         if (S_ISLNK(dstat.st_mode)) {
+            // Prepare the relative path.
+            strncpy(relative_path, path, PATH_MAX - 1);
+            relative_path[PATH_MAX - 1] = '\0';
+            if (path[strnlen(path, PATH_MAX) - 1] != '/') {
+                strncat(relative_path, "/", PATH_MAX);
+            }
+            strncat(relative_path, dirent->d_name, PATH_MAX);
             char link_buffer[PATH_MAX];
             ssize_t len = readlink(relative_path, link_buffer, sizeof(link_buffer));
             if (len > 0) {
@@ -153,14 +154,14 @@ static void print_ls(const char *path, unsigned int flags)
         return;
     }
 
-    // Clear the directory entry buffer.
-    dirent_t dents[DENTS_NUM];
+    // Clear the directory entry buffer, which is too large for the stack.
+    static dirent_t dents[DENTS_NUM];
     memset(&dents, 0, DENTS_NUM * sizeof(dirent_t));
     size_t total_size  = 0;
     ssize_t bytes_read = 0;
     while ((bytes_read = getdents(fd, dents, sizeof(dents))) > 0) {
         for (size_t i = 0; i < bytes_read / sizeof(dirent_t); ++i) {
-            print_dir_entry(&dents[i], path, flags, &total_size);
+            print_dir_entry(&dents[i], fd, path, flags, &total_size);
         }
     }
     if (bytes_read < 0) {
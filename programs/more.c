@@ -27,12 +27,12 @@ static void erase_backwards(int n)
     }
 }
 
-static void page_content(int fd)
+static void page_content(FILE *file)
 {
     int lines = 0;
     char line[WIDTH + 2];
     char *lineend;
-    while ((lineend = fgets(line, WIDTH, fd))) {
+    while ((lineend = fgets(line, WIDTH, file))) {
         if (lineend - line == WIDTH && line[WIDTH - 1] != '\n') {
             line[WIDTH - 1] = '+';
             line[WIDTH]     = '\n';
@@ -87,17 +87,17 @@ int main(int argc, char **argv)
     _termios.c_lflag &= ~(ICANON | ECHO);
     tcsetattr(STDIN_FILENO, 0, &_termios);
 
-    int fd = STDOUT_FILENO;
+    FILE *file = stdin;
     if (argc > 1) {
-        fd = open(filepath, O_RDONLY, 0);
-        if (fd < 0) {
+        file = fopen(filepath, "r");
+        if (file == NULL) {
             printf("more: %s: %s\n", filepath, strerror(errno));
             exit(EXIT_FAILURE);
         }
     }
 
     errno = 0;
-    page_content(fd);
+    page_content(file);
     if (errno) {
         printf("%s: %s: %s\n", argv[0], argc > 1 ? filepath : "stdin", strerror(errno));
         exit(EXIT_FAILURE);
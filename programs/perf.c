@@ -0,0 +1,266 @@
+/// @file perf.c
+/// @brief Counts the hardware events of a command, with the performance counters.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/perf_event.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The largest number of events counted at once.
+#define PERF_MAX_EVENTS 8
+
+/// @brief A named event.
+typedef struct {
+    const char *name; ///< The name of the event.
+    uint64_t config;  ///< The generic event (PERF_COUNT_HW_*).
+} perf_name_t;
+
+/// The generic events, by name.
+static const perf_name_t perf_names[] = {
+    { "cycles", PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-references", PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses", PERF_COUNT_HW_CACHE_MISSES },
+    { "branches", PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+    { "branch-misses", PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+/// The events counted when none is given.
+static const char *perf_default_events = "cycles,instructions,cache-misses,branch-misses";
+
+/// @brief An event counted for the command.
+typedef struct {
+    char name[32];          ///< The name of the event, as given.
+    perf_event_attr_t attr; ///< The description of the event.
+    int fd;                 ///< The file descriptor of the event, -1 if it could not be opened.
+    int error;              ///< Why it could not be opened.
+    uint64_t count;         ///< What it counted.
+} perf_counter_t;
+
+/// @brief Divides a 64-bit value, without libgcc.
+/// @param n the value, which is replaced by the quotient.
+/// @param d the divisor.
+/// @return the remainder.
+static inline uint32_t __div32(uint64_t *n, uint32_t d)
+{
+    uint32_t high = (uint32_t)(*n >> 32U), low = (uint32_t)*n, rem;
+    // The high half first, its remainder then comes above the low half.
+    __asm__("divl %4" : "=a"(high), "=d"(rem) : "a"(high), "d"(0), "rm"(d));
+    __asm__("divl %4" : "=a"(low), "=d"(rem) : "a"(low), "d"(rem), "rm"(d));
+    *n = ((uint64_t)high << 32U) | low;
+    return rem;
+}
+
+/// @brief Writes a count, with its thousands separated by commas.
+/// @param buffer where the count is written, at least 27 characters.
+/// @param n the count.
+static void __format_count(char *buffer, uint64_t n)
+{
+    uint32_t groups[7];
+    int count = 0;
+    do {
+        groups[count++] = __div32(&n, 1000);
+    } while (n);
+    buffer += sprintf(buffer, "%u", groups[--count]);
+    while (count > 0) {
+        buffer += sprintf(buffer, ",%03u", groups[--count]);
+    }
+}
+
+/// @brief Parses an event, a generic one by name or a raw one as rXXXX.
+/// @param name the name of the event.
+/// @param attr where the description of the event is stored.
+/// @return 0 on success, -1 if the event is not known.
+static int __parse_event(const char *name, perf_event_attr_t *attr)
+{
+    memset(attr, 0, sizeof(perf_event_attr_t));
+    attr->size = sizeof(perf_event_attr_t);
+    for (size_t i = 0; i < sizeof(perf_names) / sizeof(perf_names[0]); ++i) {
+        if (!strcmp(name, perf_names[i].name)) {
+            attr->type   = PERF_TYPE_HARDWARE;
+            attr->config = perf_names[i].config;
+            return 0;
+        }
+    }
+    if ((name[0] == 'r') && name[1]) {
+        char *endptr;
+        long code = strtol(name + 1, &endptr, 16);
+        if (!*endptr && (code >= 0) && (code <= 0xFFFF)) {
+            attr->type   = PERF_TYPE_RAW;
+            attr->config = code;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/// @brief Parses a list of events, separated by commas.
+/// @param list the list.
+/// @param counters where the events are stored.
+/// @return the number of events, -1 on failure.
+static int __parse_events(const char *list, perf_counter_t *counters)
+{
+    int count = 0;
+    while (*list) {
+        const char *end = strchr(list, ',');
+        size_t length   = end ? (size_t)(end - list) : strlen(list);
+        if (count == PERF_MAX_EVENTS) {
+            fprintf(stderr, "perf: at most %d events can be counted.\n", PERF_MAX_EVENTS);
+            return -1;
+        }
+        if (!length || (length >= sizeof(counters[count].name))) {
+            fprintf(stderr, "perf: invalid event list '%s'.\n", list);
+            return -1;
+        }
+        strncpy(counters[count].name, list, length);
+        counters[count].name[length] = 0;
+        if (__parse_event(counters[count].name, &counters[count].attr) < 0) {
+            fprintf(stderr, "perf: unknown event '%s'.\n", counters[count].name);
+            return -1;
+        }
+        ++count;
+        list += end ? length + 1 : length;
+    }
+    return count;
+}
+
+/// @brief Returns the count of a generic event, if it was counted.
+/// @param counters the events.
+/// @param count the number of events.
+/// @param config the generic event.
+/// @return the event, NULL if it was not counted.
+static perf_counter_t *__find_generic(perf_counter_t *counters, int count, uint64_t config)
+{
+    for (int i = 0; i < count; ++i) {
+        if ((counters[i].fd >= 0) && (counters[i].attr.type == PERF_TYPE_HARDWARE) &&
+            (counters[i].attr.config == config)) {
+            return &counters[i];
+        }
+    }
+    return NULL;
+}
+
+/// @brief Prints what the events counted.
+/// @param command the command.
+/// @param counters the events.
+/// @param count the number of events.
+/// @param elapsed_ns the nanoseconds the command ran for.
+static void __print_counts(const char *command, perf_counter_t *counters, int count, uint64_t elapsed_ns)
+{
+    perf_counter_t *cycles = __find_generic(counters, count, PERF_COUNT_HW_CPU_CYCLES);
+    char buffer[32];
+    printf("\n Performance counter stats for '%s':\n\n", command);
+    for (int i = 0; i < count; ++i) {
+        if (counters[i].fd < 0) {
+            printf("  %18s  %-18s (%s)\n", "<not supported>", counters[i].name, strerror(counters[i].error));
+            continue;
+        }
+        __format_count(buffer, counters[i].count);
+        printf("  %18s  %-18s", buffer, counters[i].name);
+        // The instructions per cycle, with two decimals.
+        if ((counters[i].attr.type == PERF_TYPE_HARDWARE) &&
+            (counters[i].attr.config == PERF_COUNT_HW_INSTRUCTIONS) && cycles && cycles->count) {
+            double ipc = (double)counters[i].count / (double)cycles->count;
+            printf(" # %.2f insn per cycle", ipc);
+        }
+        putchar('\n');
+    }
+    // The milliseconds, which fit 32 bits.
+    __div32(&elapsed_ns, 1000000);
+    uint32_t ms = (uint32_t)elapsed_ns;
+    printf("\n  %14u.%03u seconds time elapsed\n\n", ms / 1000, ms % 1000);
+}
+
+/// @brief Runs a command, counting its events.
+/// @param argv the command, and its arguments.
+/// @param counters the events.
+/// @param count the number of events.
+/// @return the exit status of the command.
+static int __stat(char **argv, perf_counter_t *counters, int count)
+{
+    int fds[2];
+    if (pipe(fds) < 0) {
+        fprintf(stderr, "perf: pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        fprintf(stderr, "perf: fork: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (child == 0) {
+        // Wait for the events to be opened, so that the command is counted from its start.
+        char go;
+        close(fds[1]);
+        if (read(fds[0], &go, 1) != 1) {
+            exit(EXIT_FAILURE);
+        }
+        close(fds[0]);
+        execvp(argv[0], argv);
+        fprintf(stderr, "perf: %s: %s\n", argv[0], strerror(errno));
+        exit(127);
+    }
+    close(fds[0]);
+    for (int i = 0; i < count; ++i) {
+        counters[i].fd    = perf_event_open(&counters[i].attr, child, -1, -1, 0);
+        counters[i].error = (counters[i].fd < 0) ? errno : 0;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    write(fds[1], "x", 1);
+    close(fds[1]);
+    int status;
+    waitpid(child, &status, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for (int i = 0; i < count; ++i) {
+        if (counters[i].fd >= 0) {
+            if (read(counters[i].fd, &counters[i].count, sizeof(uint64_t)) != sizeof(uint64_t)) {
+                counters[i].count = 0;
+            }
+            close(counters[i].fd);
+        }
+    }
+    uint64_t elapsed_ns = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec;
+    elapsed_ns -= start.tv_nsec;
+    __print_counts(argv[0], counters, count, elapsed_ns);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
+{
+    if ((argc > 1) && !strcmp(argv[1], "--help")) {
+        printf("Usage: %s stat [-e EVENT[,EVENT...]] COMMAND [ARGS...]\n", argv[0]);
+        printf("Events: cycles, instructions, cache-references, cache-misses, branches,\n");
+        printf("        branch-misses, and rXXXX for a raw event (event | umask << 8).\n");
+        return EXIT_SUCCESS;
+    }
+    if ((argc < 3) || strcmp(argv[1], "stat")) {
+        printf("%s: missing operand.\n", argv[0]);
+        printf("Try '%s --help' for more information.\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *events = perf_default_events;
+    int first          = 2;
+    if (!strcmp(argv[first], "-e")) {
+        if (argc < 5) {
+            printf("%s: missing operand.\n", argv[0]);
+            printf("Try '%s --help' for more information.\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        events = argv[first + 1];
+        first += 2;
+    }
+    perf_counter_t counters[PERF_MAX_EVENTS];
+    int count = __parse_events(events, counters);
+    if (count <= 0) {
+        return EXIT_FAILURE;
+    }
+    return __stat(&argv[first], counters, count);
+}
@@ -0,0 +1,278 @@
+/// @file runbench.c
+/// @brief Runs the microbenchmarks, whose results are printed one per line.
+/// @details
+/// With `--json`, the results are gathered into a single JSON object:
+///
+///     {"results":[{"bench":"syscall_getpid","unit":"cycles","n":1000,...}],"tsc_khz":2400000,"failed":[]}
+///
+/// When started as init (i.e., the kernel was booted with `runbench`), the
+/// JSON is written on the second serial port, and QEMU is then stopped through
+/// the `isa-debug-exit` device, with a status telling if any benchmark failed.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <io/port_io.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The folder of the benchmarks.
+#define BENCH_DIR       "/bin/bench"
+/// Shutdown port for QEMU, used if the debug-exit device is missing.
+#define SHUTDOWN_PORT   0x604
+/// The port of the `isa-debug-exit` device of QEMU, which exits with (value << 1) | 1.
+#define DEBUG_EXIT_PORT 0x501
+/// Second serial port for QEMU.
+#define SERIAL_COM2     0x02F8
+
+/// If the results are gathered into JSON.
+static int json;
+/// If we are the init process.
+static int init;
+/// The number of results written so far.
+static int results;
+/// The frequency of the TSC, as reported by the first benchmark.
+static char tsc_khz[16];
+
+/// @brief Writes the output, on the serial port when running as init.
+/// @param format the format of the output.
+static void bench_out(const char *format, ...)
+{
+    char buffer[512];
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+    if (!init) {
+        fputs(buffer, stdout);
+        return;
+    }
+    for (char *s = buffer; *s; ++s) {
+        outportb(SERIAL_COM2, *s);
+    }
+}
+
+/// @brief Checks if a value is a number, which is written without quotes.
+/// @param value the value.
+/// @return 1 if it is, 0 otherwise.
+static int is_number(const char *value)
+{
+    if (!*value) {
+        return 0;
+    }
+    for (; *value; ++value) {
+        if ((*value < '0') || (*value > '9')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/// @brief Turns a line of `key=value` pairs of a benchmark into a JSON object.
+/// @param line the line, which is modified.
+static void parse_line(char *line)
+{
+    char *saveptr, *token, *value;
+    if (line[0] == '#') {
+        // Comments only carry the frequency of the TSC.
+        if (!tsc_khz[0] && (value = strstr(line, "tsc_khz="))) {
+            strncpy(tsc_khz, value + 8, sizeof(tsc_khz) - 1);
+            tsc_khz[strcspn(tsc_khz, " ")] = 0;
+        }
+        return;
+    }
+    if (strncmp(line, "bench=", 6)) {
+        return;
+    }
+    bench_out("%s{", results++ ? "," : "");
+    int first = 1;
+    for (token = strtok_r(line, " ", &saveptr); token; token = strtok_r(NULL, " ", &saveptr)) {
+        if (!(value = strchr(token, '='))) {
+            continue;
+        }
+        *value++ = 0;
+        bench_out(is_number(value) ? "%s\"%s\":%s" : "%s\"%s\":\"%s\"", first ? "" : ",", token, value);
+        first = 0;
+    }
+    bench_out("}");
+}
+
+/// @brief Reads the output of a benchmark, one line at a time.
+/// @param fd the pipe the benchmark writes to.
+static void read_output(int fd)
+{
+    char buffer[1024];
+    size_t length = 0;
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, buffer + length, sizeof(buffer) - length - 1)) > 0) {
+        length += bytes_read;
+        buffer[length] = 0;
+        char *line     = buffer, *end;
+        while ((end = strchr(line, '\n'))) {
+            *end = 0;
+            parse_line(line);
+            line = end + 1;
+        }
+        // Keep the incomplete line, dropping it if it fills the whole buffer.
+        length = (line == buffer && length == sizeof(buffer) - 1) ? 0 : strlen(line);
+        memmove(buffer, line, length);
+    }
+    if (length) {
+        buffer[length] = 0;
+        parse_line(buffer);
+    }
+}
+
+/// @brief Runs a benchmark, and waits for it.
+/// @param name the name of the benchmark (e.g., b_pipe).
+/// @return 0 on success, 1 on failure.
+static int run_bench(const char *name)
+{
+    char path[PATH_MAX];
+    int status, fds[2];
+    snprintf(path, PATH_MAX, "%s/%s", BENCH_DIR, name);
+    if (!json) {
+        printf("# run=%s\n", name);
+    }
+    if (json && (pipe(fds) < 0)) {
+        fprintf(stderr, "pipe: %s\n", strerror(errno));
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "fork: %s\n", strerror(errno));
+        return 1;
+    }
+    if (pid == 0) {
+        char *argv[] = {path, NULL};
+        if (json) {
+            // The results go to the pipe.
+            close(STDOUT_FILENO);
+            dup(fds[1]);
+            close(fds[0]);
+            close(fds[1]);
+        }
+        execv(path, argv);
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        exit(127);
+    }
+    if (json) {
+        close(fds[1]);
+        read_output(fds[0]);
+        close(fds[0]);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+        if (!json) {
+            printf("# failed=%s\n", name);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief Runs the given benchmarks, or all the ones inside BENCH_DIR.
+/// @param names the names of the benchmarks, NULL for all of them.
+/// @param count the number of names.
+/// @param failed the names of the ones which failed, separated by spaces.
+/// @param size the size of the buffer of the failed ones.
+/// @return the number of benchmarks which failed, -1 if they cannot be listed.
+static int run_all(char **names, int count, char *failed, size_t size)
+{
+    dirent_t dents[16];
+    ssize_t bytes_read;
+    int failures = 0;
+    for (int i = 0; names && (i < count); ++i) {
+        if (run_bench(names[i])) {
+            if (strlen(failed) + strlen(names[i]) + 2 < size) {
+                strcat(strcat(failed, " "), names[i]);
+            }
+            ++failures;
+        }
+    }
+    if (names) {
+        return failures;
+    }
+    int fd = open(BENCH_DIR, O_RDONLY | O_DIRECTORY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", BENCH_DIR, strerror(errno));
+        return -1;
+    }
+    while ((bytes_read = getdents(fd, dents, sizeof(dents))) > 0) {
+        for (size_t i = 0; i < bytes_read / sizeof(dirent_t); ++i) {
+            if ((dents[i].d_type == DT_REG) && run_bench(dents[i].d_name)) {
+                if (strlen(failed) + strlen(dents[i].d_name) + 2 < size) {
+                    strcat(strcat(failed, " "), dents[i].d_name);
+                }
+                ++failures;
+            }
+        }
+    }
+    close(fd);
+    return failures;
+}
+
+/// @brief Runs the benchmarks.
+/// @param argc the number of arguments.
+/// @param argv the arguments.
+/// @return the number of benchmarks which failed, -1 on error.
+static int runbench_main(int argc, char *argv[])
+{
+    char failed[256] = {0};
+    int first        = 1;
+    if ((argc > 1) && !strcmp(argv[1], "--help")) {
+        printf("Usage: %s [--json] [BENCHMARK...]\n", argv[0]);
+        printf("Runs the given benchmarks (e.g., b_pipe), or all the ones inside %s.\n", BENCH_DIR);
+        printf("      --json   gather the results into a single JSON object\n");
+        exit(EXIT_SUCCESS);
+    }
+    if ((argc > 1) && !strcmp(argv[1], "--json")) {
+        json = 1;
+        --argc, ++argv;
+        bench_out("{\"results\":[");
+    }
+    int failures = run_all((argc > 1) ? argv + 1 : NULL, argc - 1, failed, sizeof(failed));
+    if (!json) {
+        return failures;
+    }
+    // The frequency is printed once all the benchmarks are done.
+    bench_out("],\"tsc_khz\":%s,\"failed\":[", tsc_khz[0] ? tsc_khz : "0");
+    for (char *saveptr, *name = strtok_r(failed, " ", &saveptr); name; name = strtok_r(NULL, " ", &saveptr)) {
+        bench_out("%s\"%s\"", first ? "" : ",", name);
+        first = 0;
+    }
+    bench_out("]}\n");
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    // Are we the init process.
+    init = getpid() == 1;
+    if (init) {
+        pid_t runbench = fork();
+        if (runbench) {
+            while (1) {
+                wait(NULL);
+            }
+        }
+        // The kernel starts us without arguments.
+        static char *json_argv[] = {"runbench", "--json", NULL};
+        argc = 2, argv = json_argv;
+    }
+    int failures = runbench_main(argc, argv);
+    if (init) {
+        // QEMU exits with 1 if all the benchmarks succeeded, 3 otherwise.
+        outportb(DEBUG_EXIT_PORT, failures ? 1 : 0);
+        outports(SHUTDOWN_PORT, 0x2000);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
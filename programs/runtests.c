@@ -23,48 +23,96 @@
 static char *all_tests[] = {
     "t_abort",
     "t_alarm",
+    "t_arena",
+    "t_atime",
+    "t_auxv",
     // "t_big_write",
+    "t_bigdir",
     "t_chdir",
+    "t_clock",
+    "t_cow",
     "t_creat",
+    "t_demand",
     "t_dup",
     "t_environ",
     "t_exit",
     "t_exec",
     "t_fork",
+    "t_fstatat",
+    "t_fsync",
+    "t_futex",
     "t_gid",
     "t_grp",
     "t_groups",
     "t_hashmap",
+    "t_hrtimer",
+    "t_inet",
+    "t_io_uring",
     "t_itimer",
     "t_kill",
+    "t_killpg",
+    "t_kmsg",
+    "t_ksm",
     "t_list",
+    "t_madvise",
     "t_mem",
     "t_mkdir",
+    "t_mkfifo",
+    "t_mmap",
     "t_msgget",
+    "t_msgpages",
+    "t_msgrcv",
     "t_ndtree",
+    "t_odirect",
     // "t_periodic1",
     // "t_periodic2",
     // "t_periodic3",
+    "t_pgfault",
+    "t_pi_mutex",
     "t_pipe_blocking",
     "t_pipe_non_blocking",
+    "t_pipe_readers",
+    "t_pipe_size",
+    "t_poll",
+    "t_profil",
+    "t_pthread",
     "t_pwd",
+    "t_readline",
+    "t_rlimit",
     "t_schedfb",
+    "t_schedstat",
     "t_semflg",
     "t_semget",
     "t_semop",
+    "t_semtimedop",
+    "t_serial",
+    "t_setscheduler",
     "t_shm",
+    "t_shmfork",
     "t_shmget",
+    "t_shmopen",
     "t_sigaction",
     "t_sigfpe",
     "t_siginfo",
     "t_sigmask",
+    "t_sigqueue",
     "t_sigusr",
+    "t_sigwait",
     "t_sleep",
+    "t_socket",
+    "t_spawn",
+    "t_splice",
     "t_spwd",
     "t_stopcont",
+    "t_string",
     "t_syslog",
     "t_time",
+    "t_timerslack",
+    "t_uio",
+    "t_vdso",
+    "t_wait4",
     "t_write_read",
+    "t_zram",
 };
 
 static char **tests = &all_tests[0];
@@ -175,7 +223,7 @@ static void run_test(int n, char *test_cmd_line)
     }
 
     if (child < 0) {
-        fprintf(STDERR_FILENO, "fork: %s\n", strerror(errno));
+        fprintf(stderr, "fork: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
 
@@ -208,7 +256,7 @@ int runtests_main(int argc, char **argv)
     // TODO: capture test output
     int devnull = open("/dev/null", O_RDONLY, 0);
     if (devnull < 0) {
-        fprintf(STDERR_FILENO, "open: /dev/null: %s\n", strerror(errno));
+        fprintf(stderr, "open: /dev/null: %s\n", strerror(errno));
         exit(EXIT_FAILURE);
     }
     test_out_fd = test_err_fd = devnull;
@@ -5,11 +5,13 @@
 
 #include <ctype.h>
 #include <fcntl.h>
+#include <hashmap.h>
 #include <io/ansi_colors.h>
 #include <libgen.h>
 #include <limits.h>
 #include <ring_buffer.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -48,6 +50,23 @@ static int status         = 0;
 static char status_buf[4] = {0};
 
 static sigset_t oldmask;
+// The cached paths of the commands, by name.
+static hashmap_t command_paths;
+// The value of PATH when the paths were cached.
+static char *command_paths_var = NULL;
+
+/// @brief A command executed by the shell itself.
+typedef struct builtin {
+    /// The name of the command.
+    const char *name;
+    /// The function executing it, which returns the exit status.
+    int (*function)(int argc, char *argv[]);
+    /// If a program with the same name executes it, when its output is
+    /// redirected, or it runs in background.
+    bool_t has_program;
+} builtin_t;
+
+extern char **environ;
 
 static void __block_sigchld(void)
 {
@@ -511,6 +530,300 @@ static int __cd(int argc, char *argv[])
     return 0;
 }
 
+/// @brief Prints the arguments, as the `echo` program does.
+/// @param argc The number of arguments passed.
+/// @param argv The array of arguments, `-n` omits the final newline, `-e` expands the `\n` escapes.
+/// @return Returns 0.
+static int __echo(int argc, char *argv[])
+{
+    bool_t newline = true, escapes = false;
+    int i;
+    for (i = 1; (i < argc) && (argv[i][0] == '-') && argv[i][1]; ++i) {
+        const char *option = argv[i] + 1;
+        while ((*option == 'n') || (*option == 'e')) {
+            if (*option++ == 'n') {
+                newline = false;
+            } else {
+                escapes = true;
+            }
+        }
+        // An argument which is not made only of options is printed.
+        if (*option) {
+            break;
+        }
+    }
+    for (; i < argc; ++i) {
+        for (const char *it = argv[i]; *it; ++it) {
+            if (escapes && (it[0] == '\\') && (it[1] == 'n')) {
+                putchar('\n');
+                ++it;
+            } else {
+                putchar(*it);
+            }
+        }
+        if (i + 1 < argc) {
+            putchar(' ');
+        }
+    }
+    if (newline) {
+        putchar('\n');
+    }
+    return 0;
+}
+
+/// @brief Prints the current working directory.
+/// @param argc The number of arguments passed.
+/// @param argv The array of arguments.
+/// @return Returns 0 on success, 1 on failure.
+static int __pwd(int argc, char *argv[])
+{
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        printf("pwd: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("%s\n", cwd);
+    return 0;
+}
+
+/// @brief Evaluates a unary expression of `test`.
+/// @param op The operator (e.g., `-f`).
+/// @param arg The operand.
+/// @return Returns 0 if true, 1 if false, 2 if the operator is unknown.
+static int __test_unary(const char *op, const char *arg)
+{
+    stat_t st;
+    if (!strcmp(op, "-n")) {
+        return arg[0] == '\0';
+    }
+    if (!strcmp(op, "-z")) {
+        return arg[0] != '\0';
+    }
+    if (!op[0] || !strchr("efdrwx", op[1]) || op[2]) {
+        return 2;
+    }
+    if (stat(arg, &st) < 0) {
+        return 1;
+    }
+    switch (op[1]) {
+    case 'f':
+        return !S_ISREG(st.st_mode);
+    case 'd':
+        return !S_ISDIR(st.st_mode);
+    case 'r':
+        return !(st.st_mode & (S_IRUSR | S_IRGRP | S_IROTH));
+    case 'w':
+        return !(st.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH));
+    case 'x':
+        return !(st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH));
+    default:
+        return 0;
+    }
+}
+
+/// @brief Evaluates a binary expression of `test`.
+/// @param left The left operand.
+/// @param op The operator (e.g., `=`, or `-lt`).
+/// @param right The right operand.
+/// @return Returns 0 if true, 1 if false, 2 if the operator is unknown.
+static int __test_binary(const char *left, const char *op, const char *right)
+{
+    static const char *comparisons[] = {"-eq", "-ne", "-lt", "-le", "-gt", "-ge"};
+    if (!strcmp(op, "=")) {
+        return strcmp(left, right) != 0;
+    }
+    if (!strcmp(op, "!=")) {
+        return strcmp(left, right) == 0;
+    }
+    long a = strtol(left, NULL, 10), b = strtol(right, NULL, 10);
+    bool_t results[] = {a == b, a != b, a < b, a <= b, a > b, a >= b};
+    for (size_t i = 0; i < sizeof(comparisons) / sizeof(*comparisons); ++i) {
+        if (!strcmp(op, comparisons[i])) {
+            return !results[i];
+        }
+    }
+    return 2;
+}
+
+/// @brief Evaluates a conditional expression, as `test` and `[` do.
+/// @param argc The number of arguments passed.
+/// @param argv The array of arguments, which must end with `]` for `[`.
+/// @return Returns 0 if the expression is true, 1 if it is false, 2 on error.
+static int __test(int argc, char *argv[])
+{
+    if (!strcmp(argv[0], "[")) {
+        if (strcmp(argv[argc - 1], "]")) {
+            printf("[: missing `]'\n");
+            return 2;
+        }
+        --argc;
+    }
+    char **args = argv + 1;
+    int count = argc - 1, negate = 0, result;
+    // A leading `!` negates the expression which follows.
+    if ((count > 1) && !strcmp(args[0], "!")) {
+        negate = 1;
+        ++args;
+        --count;
+    }
+    if (count == 0) {
+        result = 1;
+    } else if (count == 1) {
+        result = args[0][0] == '\0';
+    } else if (count == 2) {
+        result = __test_unary(args[0], args[1]);
+    } else if (count == 3) {
+        result = __test_binary(args[0], args[1], args[2]);
+    } else {
+        result = 2;
+    }
+    if (result == 2) {
+        printf("%s: unsupported expression\n", argv[0]);
+        return 2;
+    }
+    return result ^ negate;
+}
+
+/// @brief Removes all the cached paths of the commands.
+static void __command_paths_clear(void)
+{
+    size_t index = 0;
+    hashmap_entry_t *entry;
+    while ((entry = hashmap_next(&command_paths, &index))) {
+        free(entry->value);
+    }
+    hashmap_destroy(&command_paths);
+    free(command_paths_var);
+    command_paths_var = NULL;
+}
+
+/// @brief Finds the program executed by a command, searching the PATH only the first time.
+/// @param name The name of the command.
+/// @return The path of the program, which must not be freed, or NULL if it is not found.
+static const char *__command_path(const char *name)
+{
+    // Commands with a slash are not searched.
+    if (strchr(name, '/')) {
+        return name;
+    }
+    const char *path_var = getenv("PATH");
+    if (path_var == NULL) {
+        path_var = "/bin:/usr/bin";
+    }
+    // The cached paths are discarded as soon as the PATH changes.
+    if (command_paths_var && strcmp(command_paths_var, path_var)) {
+        __command_paths_clear();
+    }
+    if (!command_paths_var && !(command_paths_var = strdup(path_var))) {
+        return NULL;
+    }
+    char *cached = hashmap_get(&command_paths, name);
+    if (cached) {
+        return cached + strlen(cached) + 1;
+    }
+    char folder[PATH_MAX], path[PATH_MAX];
+    size_t offset = 0;
+    stat_t st;
+    while (tokenize(path_var, ":", &offset, folder, PATH_MAX)) {
+        if ((snprintf(path, PATH_MAX, "%s/%s", folder, name) >= PATH_MAX) || (stat(path, &st) < 0) ||
+            !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        // The value holds the name, which is the key, followed by the path.
+        size_t name_len = strlen(name) + 1, path_len = strlen(path) + 1;
+        if (!(cached = malloc(name_len + path_len))) {
+            return NULL;
+        }
+        memcpy(cached, name, name_len);
+        memcpy(cached + name_len, path, path_len);
+        if (hashmap_insert(&command_paths, cached, cached) < 0) {
+            free(cached);
+            return NULL;
+        }
+        return cached + name_len;
+    }
+    return NULL;
+}
+
+/// @brief Forgets the cached path of a command, whose program is gone.
+/// @param name The name of the command.
+static void __command_path_forget(const char *name) { free(hashmap_remove(&command_paths, name)); }
+
+/// @brief Manages the cached paths of the commands, as bash's `hash` does.
+/// @param argc The number of arguments passed.
+/// @param argv The array of arguments, `-r` forgets all the paths, the names are searched and cached.
+/// @return Returns 0 on success, 1 if a command is not found.
+static int __hash(int argc, char *argv[])
+{
+    if (argc == 1) {
+        size_t index = 0;
+        hashmap_entry_t *entry;
+        while ((entry = hashmap_next(&command_paths, &index))) {
+            const char *cached = entry->value;
+            printf("%s\n", cached + strlen(cached) + 1);
+        }
+        return 0;
+    }
+    int result = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-r")) {
+            __command_paths_clear();
+        } else if (!__command_path(argv[i])) {
+            printf("hash: %s: not found\n", argv[i]);
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/// @brief Shortcut for `cd ..`.
+/// @param argc The number of arguments passed.
+/// @param argv The array of arguments.
+/// @return Returns 0 on success, 1 on failure.
+static int __cd_parent(int argc, char *argv[])
+{
+    const char *__argv[] = {"cd", "..", NULL};
+    return __cd(2, (char **)__argv);
+}
+
+/// @brief The commands executed by the shell itself, without starting a process.
+static const builtin_t builtins[] = {
+    {"cd", __cd, false},
+    {"..", __cd_parent, false},
+    {"export", __export, false},
+    {"echo", __echo, true},
+    {"pwd", __pwd, true},
+    {"test", __test, false},
+    {"[", __test, false},
+    {"hash", __hash, false},
+};
+
+/// @brief Finds the built-in command which executes the given arguments.
+/// @param argc The number of arguments.
+/// @param argv The array of arguments.
+/// @return The built-in command, or NULL if a program must execute them.
+static const builtin_t *__find_builtin(int argc, char *argv[])
+{
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); ++i) {
+        if (strcmp(builtins[i].name, argv[0])) {
+            continue;
+        }
+        if (builtins[i].has_program) {
+            // The program handles the redirections, and the background.
+            if (!strcmp(argv[argc - 1], "&")) {
+                return NULL;
+            }
+            for (int j = 1; j < argc; ++j) {
+                if (strchr(argv[j], '>')) {
+                    return NULL;
+                }
+            }
+        }
+        return &builtins[i];
+    }
+    return NULL;
+}
+
 /// @brief Push the command inside the history.
 /// @param entry The history entry to be added.
 /// @return Returns 1 if the entry was successfully added, 0 if it was a duplicate.
@@ -1112,7 +1425,9 @@ static inline void __free_argv(int argc, char **argv)
 /// @brief Sets up file redirections based on arguments.
 /// @param argcp Pointer to the argument count (to be updated if redirects are removed).
 /// @param argvp Pointer to the argument list (to be updated if redirects are removed).
-static void __setup_redirects(int *argcp, char ***argvp)
+/// @param actions The file actions of the new process, where the redirections are added.
+/// @return 0 on success, -1 on failure.
+static int __setup_redirects(int *argcp, char ***argvp, posix_spawn_file_actions_t *actions)
 {
     char **argv = *argvp;
     int argc    = *argcp;
@@ -1133,7 +1448,7 @@ static void __setup_redirects(int *argcp, char ***argvp)
         // Check if the next argument (i + 1) is within bounds.
         if (i + 1 >= argc || argv[i + 1] == NULL) {
             printf("Error: Missing path for redirection after '%s'.\n", argv[i]);
-            exit(1); // Exit if no path is provided for redirection.
+            return -1; // Fail if no path is provided for redirection.
         }
         path = argv[i + 1]; // Set the path for redirection.
         // Determine the stream to redirect based on the first character of the argument.
@@ -1156,39 +1471,26 @@ static void __setup_redirects(int *argcp, char ***argvp)
         } else {
             flags |= O_TRUNC;
         }
+        // Open the file on the first redirected stream, and duplicate it on
+        // the other one. The new process opens it, the path is copied.
+        int fd = rd_stdout ? STDOUT_FILENO : STDERR_FILENO;
+        if (posix_spawn_file_actions_addopen(actions, fd, path, flags, mode) ||
+            (rd_stdout && rd_stderr && posix_spawn_file_actions_adddup2(actions, STDOUT_FILENO, STDERR_FILENO))) {
+            printf("Error: Failed to redirect to file '%s'.\n", path);
+            return -1;
+        }
         // Remove redirection arguments from argv.
         *argcp -= 2;
         free(argv[i]);
         (*argvp)[i] = NULL;
         free(argv[i + 1]);
         (*argvp)[i + 1] = NULL;
-        // Open the file for redirection.
-        int fd          = open(path, flags, mode);
-        if (fd < 0) {
-            printf("Error: Failed to open file '%s' for redirection.\n", path);
-            exit(1);
-        }
-        // Redirect stdout if necessary.
-        if (rd_stdout) {
-            close(STDOUT_FILENO);
-            if (dup(fd) < 0) {
-                printf("Error: Failed to redirect stdout to file '%s'.\n", path);
-                close(fd);
-                exit(1);
-            }
-        }
-        if (rd_stderr) {
-            close(STDERR_FILENO);
-            if (dup(fd) < 0) {
-                printf("Error: Failed to redirect stderr to file '%s'.\n", path);
-                close(fd);
-                exit(1);
-            }
-        }
-        close(fd); // Close the file descriptor after redirection.
-        break;     // Stop after handling one redirection.
+        break; // Stop after handling one redirection.
     }
-} /// @brief Executes the command stored in the history entry.
+    return 0;
+}
+
+/// @brief Executes the command stored in the history entry.
 /// @param entry The history entry containing the command.
 /// @return Returns the exit status of the command.
 static int __execute_command(rb_history_entry_t *entry)
@@ -1207,18 +1509,12 @@ static int __execute_command(rb_history_entry_t *entry)
     }
 
     // Handle built-in commands.
+    const builtin_t *builtin = __find_builtin(_argc, _argv);
     if (!strcmp(_argv[0], "init")) {
         // Placeholder for the 'init' command.
-    } else if (!strcmp(_argv[0], "cd")) {
-        // Execute the 'cd' command.
-        __cd(_argc, _argv);
-    } else if (!strcmp(_argv[0], "..")) {
-        // Shortcut for 'cd ..'.
-        const char *__argv[] = {"cd", "..", NULL};
-        __cd(2, (char **)__argv);
-    } else if (!strcmp(_argv[0], "export")) {
-        // Execute the 'export' command.
-        __export(_argc, _argv);
+    } else if (builtin) {
+        // Execute the command inside the shell, its status is the exit status.
+        _status = (builtin->function(_argc, _argv) & 0xFF) << 8;
     } else {
         // Handle external commands (executed as child processes).
         bool_t blocking = true;
@@ -1231,21 +1527,39 @@ static int __execute_command(rb_history_entry_t *entry)
         }
         // Block SIGCHLD signal to prevent interference with child processes.
         __block_sigchld();
-        // Fork the current process to create a child process.
-        pid_t cpid = fork();
-        if (cpid == 0) {
-            // Child process: Execute the command.
-            pid_t pid = getpid();
-            setpgid(cpid, pid);  // Make the new process a group leader.
-            __unblock_sigchld(); // Unblock SIGCHLD signals in the child process.
-            // Handle redirections (e.g., stdout, stderr).
-            __setup_redirects(&_argc, &_argv);
-            // Attempt to execute the command using execvp.
-            if (execvp(_argv[0], _argv) == -1) {
+        // The child process is a group leader, with SIGCHLD unblocked.
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK);
+        posix_spawnattr_setpgroup(&attr, 0);
+        posix_spawnattr_setsigmask(&attr, &oldmask);
+        // Handle redirections (e.g., stdout, stderr).
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        int error = EINVAL;
+        // Spawn the command, the kernel builds the new process without
+        // copying our memory.
+        pid_t cpid;
+        if (__setup_redirects(&_argc, &_argv, &actions) == 0) {
+            // The PATH is searched once per command, then its path is cached.
+            const char *path = __command_path(_argv[0]);
+            error            = path ? posix_spawn(&cpid, path, &actions, &attr, _argv, environ) : ENOENT;
+            if ((error == ENOENT) && path) {
+                __command_path_forget(_argv[0]);
+            }
+            if (error == ENOENT) {
                 printf("\nUnknown command: %s\n", _argv[0]);
-                exit(127); // Exit with status 127 if the command is not found.
+            } else if (error) {
+                printf("\n%s: %s\n", _argv[0], strerror(error));
             }
         }
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+        if (error) {
+            // Exit with status 127 if the command cannot be executed.
+            _status  = 127 << 8;
+            blocking = false;
+        }
         if (blocking) {
             // Parent process: Wait for the child process to finish.
             waitpid(cpid, &_status, 0);
@@ -1274,12 +1588,12 @@ static int __execute_file(char *path)
 {
     rb_history_entry_t entry;
     rb_history_init_entry(&entry);
-    int fd;
-    if ((fd = open(path, O_RDONLY, 0)) == -1) {
+    FILE *file;
+    if ((file = fopen(path, "r")) == NULL) {
         printf("%s: %s\n", path, strerror(errno));
         return -errno;
     }
-    while (fgets(entry.buffer, entry.size, fd)) {
+    while (fgets(entry.buffer, entry.size, file)) {
         if (entry.buffer[0] == '#') {
             continue;
         }
@@ -1289,7 +1603,7 @@ static int __execute_file(char *path)
         }
     }
 
-    close(fd);
+    fclose(file);
     return status;
 }
 
@@ -1350,6 +1664,8 @@ int main(int argc, char *argv[])
     setsid();
     // Initialize the history.
     rb_history_init(&history, rb_history_entry_copy);
+    // Initialize the cache of the paths of the commands.
+    hashmap_init(&command_paths, HASHMAP_KEY_STRING, malloc, free);
 
     char *USER = getenv("USER");
     if (USER == NULL) {
@@ -0,0 +1,38 @@
+/// @file swapon.c
+/// @brief Starts, or stops, swapping to a block device.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <stdio.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/swap.h>
+
+int main(int argc, char *argv[])
+{
+    if ((argc == 2) && (strcmp(argv[1], "--help") == 0)) {
+        printf("Starts, or stops, swapping to a block device prepared by mkswap.\n");
+        printf("Usage:\n");
+        printf("    swapon <device>\n");
+        printf("    swapon -d <device>\n");
+        return 0;
+    }
+    // Check the number of arguments.
+    if ((argc != 2) && ((argc != 3) || (strcmp(argv[1], "-d") != 0))) {
+        printf("Bad usage.\n");
+        printf("Try 'swapon --help' for more information.\n");
+        return 1;
+    }
+    if (argc == 3) {
+        if (swapoff(argv[2]) == -1) {
+            printf("%s: failed to stop swapping to '%s': %s\n", argv[0], argv[2], strerror(errno));
+            return 1;
+        }
+        return 0;
+    }
+    if (swapon(argv[1], 0) == -1) {
+        printf("%s: failed to swap to '%s': %s\n", argv[0], argv[1], strerror(errno));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+/// @file t_arena.c
+/// @brief Test the region allocator, on its own and behind lists and trees.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <arena.h>
+#include <list.h>
+#include <ndtree.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// The number of allocations, which need many chunks.
+#define COUNT 4096
+
+/// @brief Compares the integer values of two nodes.
+/// @param lhs the left value.
+/// @param rhs the right value.
+/// @return the difference.
+static int compare_node(void *lhs, void *rhs) { return (*(int *)lhs) - (*(int *)rhs); }
+
+/// @brief Checks that the allocations are aligned, do not overlap, and survive a reset.
+/// @param arena the arena.
+/// @return 0 on success, -1 on failure.
+static int test_alloc(arena_t *arena)
+{
+    static unsigned char *blocks[COUNT];
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < COUNT; ++i) {
+            // Mostly small blocks, with a large one every now and then.
+            size_t size = (i % 512 == 0) ? (64 * 1024) : (1 + (i % 61));
+            if (!(blocks[i] = arena_alloc(arena, size)) || ((uintptr_t)blocks[i] % ARENA_ALIGNMENT)) {
+                printf("Allocation %d of %u bytes failed, or is not aligned.\n", i, size);
+                return -1;
+            }
+            memset(blocks[i], i & 0xFF, size);
+        }
+        for (int i = 0; i < COUNT; ++i) {
+            size_t size = (i % 512 == 0) ? (64 * 1024) : (1 + (i % 61));
+            for (size_t j = 0; j < size; ++j) {
+                if (blocks[i][j] != (unsigned char)(i & 0xFF)) {
+                    printf("Allocation %d was overwritten.\n", i);
+                    return -1;
+                }
+            }
+        }
+        arena_reset(arena);
+    }
+    unsigned char *zeroed = arena_calloc(arena, 100);
+    for (int i = 0; i < 100; ++i) {
+        if (!zeroed || zeroed[i]) {
+            printf("arena_calloc() did not zero the memory.\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Fills a list and a tree, whose nodes come from the arena.
+/// @param arena the arena.
+/// @return 0 on success, -1 on failure.
+static int test_containers(arena_t *arena)
+{
+    static int values[COUNT];
+    list_t list;
+    list_init_arena(&list, arena);
+    ndtree_t tree;
+    ndtree_tree_init_arena(&tree, compare_node, arena);
+    ndtree_node_t *root = ndtree_create_root(&tree, &values[0]);
+    for (int i = 0; i < COUNT; ++i) {
+        values[i] = i;
+        list_insert_back(&list, &values[i]);
+        if ((i > 0) && !ndtree_create_child_of_node(&tree, root, &values[i])) {
+            printf("Failed to create the child %d.\n", i);
+            return -1;
+        }
+    }
+    if ((list_size(&list) != COUNT) || (tree.size != COUNT) || (ndtree_node_count_children(root) != COUNT - 1)) {
+        printf("The list holds %u values, the tree %u.\n", list_size(&list), tree.size);
+        return -1;
+    }
+    for (int i = 0; i < COUNT; ++i) {
+        if (list_remove_front(&list) != &values[i]) {
+            printf("The list returned the wrong value %d.\n", i);
+            return -1;
+        }
+    }
+    ndtree_tree_dealloc(&tree, NULL);
+    list_destroy(&list);
+    arena_reset(arena);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    arena_t *arena = arena_create(0);
+    if (!arena) {
+        printf("Failed to create the arena.\n");
+        return EXIT_FAILURE;
+    }
+    int ret = ((test_alloc(arena) < 0) || (test_containers(arena) < 0)) ? EXIT_FAILURE : EXIT_SUCCESS;
+    arena_destroy(arena);
+    return ret;
+}
@@ -0,0 +1,55 @@
+/// @file t_atime.c
+/// @brief Test the timestamps updated by reading and writing a file.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_atime.txt";
+    char buffer[8];
+    struct stat st;
+
+    time_t start = time(NULL);
+    int fd       = creat(filename, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((write(fd, "fusrodah", 8) != 8) || (fstat(fd, &st) < 0)) {
+        printf("Failed to write on file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    if (st.st_mtime < start) {
+        printf("The modification time %ld is older than the write, at %ld.\n", (long)st.st_mtime, (long)start);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    // The times are in seconds, let one go by before reading.
+    sleep(1);
+    time_t before_read = time(NULL);
+    fd                 = open(filename, O_RDONLY, 0);
+    if ((fd < 0) || (read(fd, buffer, sizeof(buffer)) != 8) || (fstat(fd, &st) < 0)) {
+        printf("Failed to read file %s: %s\n", filename, strerror(errno));
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    unlink(filename);
+    // The file has been modified since its last access, even relatime updates it.
+    if (st.st_atime < before_read) {
+        printf("The access time %ld is older than the read, at %ld.\n", (long)st.st_atime, (long)before_read);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/// @file t_auxv.c
+/// @brief Test the auxiliary vector, and an exec with more arguments than the old limit of 256.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <bits/vdso.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The number of arguments passed to the new image.
+#define NUM_ARGS 400
+
+/// @brief Checks the entries of the auxiliary vector.
+/// @return 0 on success, -1 on failure.
+static int test_auxv(void)
+{
+    if (getauxval(AT_PAGESZ) != 4096) {
+        printf("AT_PAGESZ is %lu.\n", getauxval(AT_PAGESZ));
+        return -1;
+    }
+    if ((getauxval(AT_SYSINFO_EHDR) != VDSO_ADDR) || (getauxval(AT_SYSINFO) != VDSO_SYSCALL_ADDR)) {
+        printf("The shared page is not at 0x%08x.\n", VDSO_ADDR);
+        return -1;
+    }
+    // The first program header of the executable is usually PT_PHDR, or PT_LOAD.
+    const uint32_t *phdr = (const uint32_t *)getauxval(AT_PHDR);
+    if (!phdr || (getauxval(AT_PHNUM) == 0) || (getauxval(AT_PHENT) != 32) || (phdr[0] == 0)) {
+        printf("The program headers are not where AT_PHDR says.\n");
+        return -1;
+    }
+    if (getauxval(AT_EUID) != geteuid()) {
+        printf("AT_EUID is %lu.\n", getauxval(AT_EUID));
+        return -1;
+    }
+    const unsigned char *random = (const unsigned char *)getauxval(AT_RANDOM);
+    if (!random) {
+        printf("There are no random bytes.\n");
+        return -1;
+    }
+    unsigned sum = 0;
+    for (int i = 0; i < 16; ++i) {
+        sum += random[i];
+    }
+    if (sum == 0) {
+        printf("The random bytes are all zero.\n");
+        return -1;
+    }
+    errno = 0;
+    if ((getauxval(0x7FFF) != 0) || (errno != ENOENT)) {
+        printf("A missing entry did not fail with ENOENT.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks the arguments received from the parent.
+/// @param argc the number of arguments.
+/// @param argv the arguments.
+/// @return 0 on success, -1 on failure.
+static int check_args(int argc, char *argv[])
+{
+    char expected[16];
+    if (argc != NUM_ARGS) {
+        printf("Received %d arguments out of %d.\n", argc, NUM_ARGS);
+        return -1;
+    }
+    for (int i = 2; i < argc; ++i) {
+        snprintf(expected, sizeof(expected), "arg%d", i);
+        if (strcmp(argv[i], expected)) {
+            printf("Argument %d is `%s`.\n", i, argv[i]);
+            return -1;
+        }
+    }
+    return test_auxv();
+}
+
+int main(int argc, char *argv[])
+{
+    static char *args[NUM_ARGS + 1];
+    static char strings[NUM_ARGS][16];
+    if ((argc > 1) && !strcmp(argv[1], "-child")) {
+        return check_args(argc, argv) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (test_auxv() < 0) {
+        return EXIT_FAILURE;
+    }
+    args[0] = "t_auxv";
+    args[1] = "-child";
+    for (int i = 2; i < NUM_ARGS; ++i) {
+        snprintf(strings[i], sizeof(strings[i]), "arg%d", i);
+        args[i] = strings[i];
+    }
+    args[NUM_ARGS] = NULL;
+    pid_t pid      = fork();
+    if (pid < 0) {
+        perror("fork");
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        execv("/bin/tests/t_auxv", args);
+        perror("execv");
+        exit(EXIT_FAILURE);
+    }
+    int status;
+    if ((waitpid(pid, &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The new image failed.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
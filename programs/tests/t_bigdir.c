@@ -0,0 +1,119 @@
+/// @file t_bigdir.c
+/// @brief Test creating, finding, and removing many entries inside a directory.
+/// @details The directory grows beyond a single block, so that filesystems
+/// supporting it switch to an indexed directory. The directory is also listed
+/// a few entries at a time, to check that getdents resumes where it stopped.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The directory containing the entries.
+#define DIRECTORY   "/home/user/t_bigdir"
+/// The number of entries.
+#define NUM_ENTRIES 256
+
+/// @brief Removes the first entries, and the directory.
+/// @param count the number of entries to remove.
+static void cleanup(int count)
+{
+    char path[64];
+    for (int i = 0; i < count; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%04d", i);
+        unlink(path);
+    }
+    rmdir(DIRECTORY);
+}
+
+/// @brief Counts the entries of the directory, reading a few at a time.
+/// @return the number of entries, -1 on failure.
+static int count_entries(void)
+{
+    dirent_t dents[3];
+    ssize_t bytes_read;
+    int count = 0;
+    int fd    = open(DIRECTORY, O_RDONLY | O_DIRECTORY, 0);
+    if (fd < 0) {
+        printf("Failed to open directory %s: %s\n", DIRECTORY, strerror(errno));
+        return -1;
+    }
+    while ((bytes_read = getdents(fd, dents, sizeof(dents))) > 0) {
+        count += bytes_read / sizeof(dirent_t);
+    }
+    close(fd);
+    if (bytes_read < 0) {
+        printf("Failed to list directory %s: %s\n", DIRECTORY, strerror(errno));
+        return -1;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    char path[64];
+    stat_t st;
+
+    if (mkdir(DIRECTORY, S_IRWXU) < 0) {
+        printf("Failed to create directory %s: %s\n", DIRECTORY, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Create the entries.
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%04d", i);
+        int fd = creat(path, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            printf("Failed to create file %s: %s\n", path, strerror(errno));
+            cleanup(i);
+            return EXIT_FAILURE;
+        }
+        close(fd);
+    }
+    // Find all of them.
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%04d", i);
+        if (stat(path, &st) < 0) {
+            printf("Failed to find file %s: %s\n", path, strerror(errno));
+            cleanup(NUM_ENTRIES);
+            return EXIT_FAILURE;
+        }
+    }
+    // List all of them, together with `.` and `..`.
+    int count = count_entries();
+    if (count != NUM_ENTRIES + 2) {
+        printf("Listed %d entries instead of %d.\n", count, NUM_ENTRIES + 2);
+        cleanup(NUM_ENTRIES);
+        return EXIT_FAILURE;
+    }
+    // Look for an entry which does not exist.
+    if (stat(DIRECTORY "/entry_missing", &st) == 0) {
+        printf("Found a file which was never created.\n");
+        cleanup(NUM_ENTRIES);
+        return EXIT_FAILURE;
+    }
+    // Remove the entries.
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%04d", i);
+        if (unlink(path) < 0) {
+            printf("Failed to remove file %s: %s\n", path, strerror(errno));
+            cleanup(NUM_ENTRIES);
+            return EXIT_FAILURE;
+        }
+        if (stat(path, &st) == 0) {
+            printf("Found file %s after removing it.\n", path);
+            cleanup(NUM_ENTRIES);
+            return EXIT_FAILURE;
+        }
+    }
+    if (rmdir(DIRECTORY) < 0) {
+        printf("Failed to remove directory %s: %s\n", DIRECTORY, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+/// @file t_clock.c
+/// @brief Test the monotonic and the real-time clocks of clock_gettime().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <time.h>
+
+/// The number of consecutive readings of the monotonic clock.
+#define NUM_READINGS 1000
+
+/// @brief Converts a time to nanoseconds.
+/// @param ts the time.
+/// @return the nanoseconds.
+static inline unsigned long long to_ns(const struct timespec *ts)
+{
+    return ((unsigned long long)ts->tv_sec * 1000000000ULL) + (unsigned long long)ts->tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    struct timespec res, prev, curr;
+    if (clock_getres(CLOCK_MONOTONIC, &res) < 0) {
+        printf("clock_getres: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Even without a Time Stamp Counter, the clock follows the tick.
+    if ((res.tv_sec != 0) || (res.tv_nsec <= 0) || (res.tv_nsec > 1000000)) {
+        printf("The resolution is %ld.%09ld s.\n", (long)res.tv_sec, res.tv_nsec);
+        return EXIT_FAILURE;
+    }
+    // The monotonic clock never goes backwards.
+    if (clock_gettime(CLOCK_MONOTONIC, &prev) < 0) {
+        printf("clock_gettime: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < NUM_READINGS; ++i) {
+        clock_gettime(CLOCK_MONOTONIC, &curr);
+        if ((curr.tv_nsec < 0) || (curr.tv_nsec >= 1000000000L) || (to_ns(&curr) < to_ns(&prev))) {
+            printf("The clock went from %lu.%09ld to %lu.%09ld s.\n", (unsigned long)prev.tv_sec, prev.tv_nsec,
+                   (unsigned long)curr.tv_sec, curr.tv_nsec);
+            return EXIT_FAILURE;
+        }
+        prev = curr;
+    }
+    // A sleep of 10 ms takes at least 10 ms.
+    struct timespec req = { 0, 10000000 };
+    clock_gettime(CLOCK_MONOTONIC, &prev);
+    nanosleep(&req, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &curr);
+    if ((to_ns(&curr) - to_ns(&prev)) < 10000000ULL) {
+        printf("A sleep of 10 ms lasted %lu ns.\n", (unsigned long)(to_ns(&curr) - to_ns(&prev)));
+        return EXIT_FAILURE;
+    }
+    // The real-time clock agrees with time().
+    time_t now = time(NULL);
+    if (clock_gettime(CLOCK_REALTIME, &curr) < 0) {
+        printf("clock_gettime: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((curr.tv_sec + 2 < now) || (curr.tv_sec > now + 2)) {
+        printf("The real-time clock says %lu s, time() says %lu s.\n", (unsigned long)curr.tv_sec,
+               (unsigned long)now);
+        return EXIT_FAILURE;
+    }
+    if ((clock_gettime(-1, &curr) == 0) || (errno != EINVAL)) {
+        printf("clock_gettime accepted an invalid clock.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
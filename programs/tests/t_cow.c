@@ -0,0 +1,84 @@
+/// @file t_cow.c
+/// @brief Test that forked processes do not see each other's writes.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of the buffer, spanning more than one page.
+#define BUFFER_SIZE 12288
+
+/// A buffer in the data segment.
+static char data_buffer[BUFFER_SIZE] = { 'd' };
+
+/// @brief Checks that a buffer is filled with the given character.
+/// @param buffer the buffer.
+/// @param c the character.
+/// @return 1 if it is, 0 otherwise.
+static int is_filled(const char *buffer, char c)
+{
+    for (int i = 0; i < BUFFER_SIZE; ++i) {
+        if (buffer[i] != c) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int fds[2];
+    char *heap_buffer = malloc(BUFFER_SIZE);
+    if (!heap_buffer || (pipe(fds) < 0)) {
+        printf("Failed to set up the buffers: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memset(heap_buffer, 'p', BUFFER_SIZE);
+    memset(data_buffer, 'p', BUFFER_SIZE);
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        // The child sees the memory of the parent, and changes its own copy,
+        // both directly and through the kernel.
+        if (!is_filled(heap_buffer, 'p') || !is_filled(data_buffer, 'p')) {
+            exit(EXIT_FAILURE);
+        }
+        memset(heap_buffer, 'c', BUFFER_SIZE);
+        if (read(fds[0], data_buffer, 1) != 1) {
+            exit(EXIT_FAILURE);
+        }
+        exit(EXIT_SUCCESS);
+    }
+    if (write(fds[1], "c", 1) != 1) {
+        printf("Failed to write to the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int status;
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The child failed to change its copy of the memory.\n");
+        return EXIT_FAILURE;
+    }
+    if (!is_filled(heap_buffer, 'p') || !is_filled(data_buffer, 'p')) {
+        printf("The writes of the child reached the memory of the parent.\n");
+        return EXIT_FAILURE;
+    }
+    // The child is gone, the parent owns the pages again.
+    memset(heap_buffer, 'q', BUFFER_SIZE);
+    if (!is_filled(heap_buffer, 'q')) {
+        printf("Failed to write to the memory after the child exited.\n");
+        return EXIT_FAILURE;
+    }
+    close(fds[0]);
+    close(fds[1]);
+    free(heap_buffer);
+    return EXIT_SUCCESS;
+}
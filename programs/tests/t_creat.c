@@ -23,21 +23,21 @@ int main(int argc, char *argv[])
     int fd = creat(filename, 0660);
     if (fd < 0) {
         // Error handling for file creation failure.
-        fprintf(STDERR_FILENO, "creat: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "creat: %s: %s\n", filename, strerror(errno));
         exit(EXIT_FAILURE);
     }
 
     // Write the string to the file.
     if (write(fd, content, content_size) != content_size) {
         // Error handling for write failure.
-        fprintf(STDERR_FILENO, "write: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "write: %s: %s\n", filename, strerror(errno));
         // Close the file descriptor.
         if (close(fd) < 0) {
-            fprintf(STDERR_FILENO, "close: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close: %s: %s\n", filename, strerror(errno));
         }
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -45,10 +45,10 @@ int main(int argc, char *argv[])
     // Close the file descriptor.
     if (close(fd) < 0) {
         // Error handling for close failure.
-        fprintf(STDERR_FILENO, "close: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "close: %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -58,20 +58,20 @@ int main(int argc, char *argv[])
     // Get the status of the file filename.
     if (stat(filename, &st) < 0) {
         // Error handling for stat failure.
-        fprintf(STDERR_FILENO, "stat: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "stat: %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
 
     // Check if the file size is correct.
     if (st.st_size != content_size) {
-        fprintf(STDERR_FILENO, "Wrong file size. (expected: %ld, is: %ld)\n", content_size, st.st_size);
+        fprintf(stderr, "Wrong file size. (expected: %ld, is: %ld)\n", content_size, st.st_size);
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -79,7 +79,7 @@ int main(int argc, char *argv[])
     // Remove the file.
     if (unlink(filename) < 0) {
         // Error handling for unlink failure.
-        fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         exit(EXIT_FAILURE);
     }
 
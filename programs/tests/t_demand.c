@@ -0,0 +1,105 @@
+/// @file t_demand.c
+/// @brief Test the loading on demand of the segments of the executable, and
+///        the protection of its read-only ones.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The number of words of the arrays, which span several pages.
+#define WORDS (4 * 1024)
+/// Repeats a value four times.
+#define FOUR(x) x, x, x, x
+
+/// Initialized data, read from the executable.
+static unsigned int data[WORDS] = { FOUR(FOUR(FOUR(FOUR(FOUR(FOUR(0xCAFEBABE)))))) };
+/// Uninitialized data, zero-filled.
+static unsigned int bss[WORDS];
+
+/// @brief Checks the content of the arrays, from the last page to the first one.
+/// @param what who is checking.
+/// @return 0 on success, -1 on failure.
+static int check_arrays(const char *what)
+{
+    for (int i = WORDS - 1; i >= 0; --i) {
+        if ((data[i] != 0xCAFEBABE) || (bss[i] != 0)) {
+            printf("The %s found a wrong value at index %d: 0x%08x, 0x%08x.\n", what, i, data[i], bss[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Waits for a child, and checks how it terminated.
+/// @param signum the signal which should kill the child, 0 if it should succeed.
+/// @return 0 on success, -1 on failure.
+static int wait_child(int signum)
+{
+    int status;
+    if (wait(&status) < 0) {
+        printf("Failed to wait for the child: %s\n", strerror(errno));
+        return -1;
+    }
+    if (signum ? (!WIFSIGNALED(status) || (WTERMSIG(status) != signum))
+               : (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS))) {
+        printf("The child terminated with status 0x%x.\n", status);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Reads the data segment, and the BSS, from two processes.
+/// @return 0 on success, -1 on failure.
+static int test_data(void)
+{
+    // Touch one page of each array, the child reads the others for the first time.
+    data[0] = 0xCAFEBABE;
+    bss[0]  = 0;
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        exit((check_arrays("child") < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if (wait_child(0) < 0) {
+        return -1;
+    }
+    return check_arrays("parent");
+}
+
+/// @brief Writes to the text segment, which is shared and read-only.
+/// @return 0 on success, -1 on failure.
+static int test_text(void)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        *(volatile unsigned char *)(uintptr_t)&check_arrays = 0xCC;
+        exit(EXIT_SUCCESS);
+    }
+    if (wait_child(SIGSEGV) < 0) {
+        return -1;
+    }
+    // The text of the parent is untouched.
+    return check_arrays("parent");
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_data() < 0) || (test_text() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
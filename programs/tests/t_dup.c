@@ -25,34 +25,34 @@ int main(int argc, char *argv[])
     // Open the file with specified flags and mode.
     fd1 = open(filename, flags, mode);
     if (fd1 < 0) {
-        fprintf(STDERR_FILENO, "Failed to open file %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "Failed to open file %s: %s\n", filename, strerror(errno));
         exit(EXIT_FAILURE);
     }
 
     // Duplicate the file descriptor.
     fd2 = dup(fd1);
     if (fd2 < 0) {
-        fprintf(STDERR_FILENO, "Failed to dup fd %d: %s\n", fd1, strerror(errno));
+        fprintf(stderr, "Failed to dup fd %d: %s\n", fd1, strerror(errno));
         // Close the file descriptor.
         if (close(fd1) < 0) {
-            fprintf(STDERR_FILENO, "close fd1: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close fd1: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
 
     // Write "foo" to the first file descriptor.
     if (write(fd1, "foo", 3) != 3) {
-        fprintf(STDERR_FILENO, "Writing to fd %d failed: %s\n", fd1, strerror(errno));
+        fprintf(stderr, "Writing to fd %d failed: %s\n", fd1, strerror(errno));
         // Close the file descriptor.
         if (close(fd1) < 0) {
-            fprintf(STDERR_FILENO, "close fd1: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close fd1: %s: %s\n", filename, strerror(errno));
         }
         if (close(fd2) < 0) {
-            fprintf(STDERR_FILENO, "close fd2: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close fd2: %s: %s\n", filename, strerror(errno));
         }
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -60,10 +60,10 @@ int main(int argc, char *argv[])
     // Close the file descriptor.
     if (close(fd1) < 0) {
         // Error handling for close failure.
-        fprintf(STDERR_FILENO, "close fd1: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "close fd1: %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -71,14 +71,14 @@ int main(int argc, char *argv[])
     // Write "bar" to the duplicated file descriptor.
     if (write(fd2, "bar", 3) != 3) {
         // Error handling for write failure.
-        fprintf(STDERR_FILENO, "Writing to fd %d failed: %s\n", fd2, strerror(errno));
+        fprintf(stderr, "Writing to fd %d failed: %s\n", fd2, strerror(errno));
         // Close the file descriptor.
         if (close(fd2) < 0) {
-            fprintf(STDERR_FILENO, "close fd2: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close fd2: %s: %s\n", filename, strerror(errno));
         }
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -86,10 +86,10 @@ int main(int argc, char *argv[])
     // Close the file descriptor.
     if (close(fd2) < 0) {
         // Error handling for close failure.
-        fprintf(STDERR_FILENO, "close fd2: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "close fd2: %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -98,10 +98,10 @@ int main(int argc, char *argv[])
     fd1 = open(filename, O_RDONLY, mode);
     if (fd1 < 0) {
         // Error handling for file open failure.
-        fprintf(STDERR_FILENO, "Failed to open file %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "Failed to open file %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -112,14 +112,14 @@ int main(int argc, char *argv[])
     // Read the content of the file.
     if (read(fd1, buf, 6) < 0) {
         // Error handling for read failure.
-        fprintf(STDERR_FILENO, "Reading from fd %d failed: %s\n", fd1, strerror(errno));
+        fprintf(stderr, "Reading from fd %d failed: %s\n", fd1, strerror(errno));
         // Close the file descriptor.
         if (close(fd1) < 0) {
-            fprintf(STDERR_FILENO, "close fd1: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "close fd1: %s: %s\n", filename, strerror(errno));
         }
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -127,20 +127,20 @@ int main(int argc, char *argv[])
     // Close the file descriptor.
     if (close(fd1) < 0) {
         // Error handling for close failure.
-        fprintf(STDERR_FILENO, "close fd1: %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "close fd1: %s: %s\n", filename, strerror(errno));
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
 
     // Check if the file content is as expected.
     if (strcmp(buf, "foobar") != 0) {
-        fprintf(STDERR_FILENO, "Unexpected file content: %s\n", buf);
+        fprintf(stderr, "Unexpected file content: %s\n", buf);
         // Remove the file.
         if (unlink(filename) < 0) {
-            fprintf(STDERR_FILENO, "unlink: %s: %s\n", filename, strerror(errno));
+            fprintf(stderr, "unlink: %s: %s\n", filename, strerror(errno));
         }
         exit(EXIT_FAILURE);
     }
@@ -148,7 +148,7 @@ int main(int argc, char *argv[])
     // Remove the file.
     if (unlink(filename) < 0) {
         // Error handling for unlink failure.
-        fprintf(STDERR_FILENO, "Failed to delete file %s: %s\n", filename, strerror(errno));
+        fprintf(stderr, "Failed to delete file %s: %s\n", filename, strerror(errno));
         exit(EXIT_FAILURE);
     }
 
@@ -56,6 +56,34 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // Set many variables, so that the index grows, then remove half of them
+    char name[32], expected[32];
+    for (int i = 0; i < 200; ++i) {
+        sprintf(name, "TEST_ENV_%d", i);
+        sprintf(expected, "%d", i * 3);
+        if (setenv(name, expected, 1) != 0) {
+            perror("setenv failed (many)");
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < 200; i += 2) {
+        sprintf(name, "TEST_ENV_%d", i);
+        unsetenv(name);
+    }
+    for (int i = 0; i < 200; ++i) {
+        sprintf(name, "TEST_ENV_%d", i);
+        sprintf(expected, "%d", i * 3);
+        value = getenv(name);
+        if ((i % 2) ? (!value || strcmp(value, expected)) : (value != NULL)) {
+            fprintf(stderr, "Mismatch for %s: got '%s'.\n", name, value ? value : "(null)");
+            return EXIT_FAILURE;
+        }
+    }
+    if (!getenv(env_var) || (setenv("TEST_ENV_ADDED", "Added", 0) != 0) || !getenv("TEST_ENV_ADDED")) {
+        fprintf(stderr, "getenv failed after removing variables.\n");
+        return EXIT_FAILURE;
+    }
+
     // Print success message
     printf("Environment variable %s tested successfully.\n", env_var);
 
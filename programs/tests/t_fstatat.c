@@ -0,0 +1,113 @@
+/// @file t_fstatat.c
+/// @brief Test the lookups which start from an open directory, with fstatat()
+/// and openat(), against the ones which start from the root.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The directory containing the entries.
+#define DIRECTORY   "/home/user/t_fstatat"
+/// The number of entries.
+#define NUM_ENTRIES 16
+
+/// @brief Removes the entries, and the directory.
+static void cleanup(void)
+{
+    char path[64];
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%02d", i);
+        unlink(path);
+    }
+    rmdir(DIRECTORY);
+}
+
+/// @brief Creates the entries, each holding its own name.
+/// @return 0 on success, -1 on failure.
+static int create_entries(void)
+{
+    char path[64];
+    if (mkdir(DIRECTORY, S_IRWXU) < 0) {
+        printf("Failed to create directory %s: %s\n", DIRECTORY, strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(path, sizeof(path), DIRECTORY "/entry_%02d", i);
+        int fd = creat(path, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            printf("Failed to create %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        write(fd, path, strlen(path));
+        close(fd);
+    }
+    return 0;
+}
+
+/// @brief Compares the lookups from the directory with the ones from the root.
+/// @param dirfd the open directory.
+/// @return 0 on success, -1 on failure.
+static int check_entries(int dirfd)
+{
+    char name[32], path[64], content[64];
+    stat_t relative, absolute;
+    for (int i = 0; i < NUM_ENTRIES; ++i) {
+        snprintf(name, sizeof(name), "entry_%02d", i);
+        snprintf(path, sizeof(path), DIRECTORY "/%s", name);
+        if ((fstatat(dirfd, name, &relative, 0) < 0) || (stat(path, &absolute) < 0)) {
+            printf("Failed to stat %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+        if ((relative.st_ino != absolute.st_ino) || (relative.st_size != absolute.st_size) ||
+            (relative.st_size != (off_t)strlen(path))) {
+            printf("The two stats of %s differ.\n", path);
+            return -1;
+        }
+        int fd = openat(dirfd, name, O_RDONLY, 0);
+        if (fd < 0) {
+            printf("Failed to open %s from the directory: %s\n", name, strerror(errno));
+            return -1;
+        }
+        ssize_t length = read(fd, content, sizeof(content) - 1);
+        close(fd);
+        if ((length != (ssize_t)strlen(path)) || strncmp(content, path, length)) {
+            printf("Read the wrong content from %s.\n", name);
+            return -1;
+        }
+    }
+    // Missing entries, and the parent directory, are looked up as usual.
+    if ((fstatat(dirfd, "missing", &relative, 0) == 0) || (fstatat(dirfd, "..", &relative, 0) < 0) ||
+        (stat("/home/user", &absolute) < 0) || (relative.st_ino != absolute.st_ino)) {
+        printf("The lookups of a missing entry, or of the parent, failed.\n");
+        return -1;
+    }
+    if ((fstatat(AT_FDCWD, "/home/user", &relative, 0) < 0) || (relative.st_ino != absolute.st_ino)) {
+        printf("The lookup of an absolute path failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (create_entries() < 0) {
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    int dirfd = open(DIRECTORY, O_RDONLY | O_DIRECTORY, 0);
+    if (dirfd < 0) {
+        printf("Failed to open directory %s: %s\n", DIRECTORY, strerror(errno));
+        cleanup();
+        return EXIT_FAILURE;
+    }
+    int ret = check_entries(dirfd);
+    close(dirfd);
+    cleanup();
+    return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
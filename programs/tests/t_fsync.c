@@ -0,0 +1,68 @@
+/// @file t_fsync.c
+/// @brief Test that buffered writes survive fsync and sync.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_fsync.txt";
+    char buffer[16];
+
+    // Create the file.
+    int fd = creat(filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Write some content, and flush it.
+    if (write(fd, "fusrodah", 8) != 8) {
+        printf("Writing on file %s failed: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    if (fsync(fd) < 0) {
+        printf("Failed to fsync file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    // Flush everything.
+    sync();
+    // Check that fsync rejects invalid descriptors.
+    if ((fsync(-1) == 0) || (errno != EBADF)) {
+        printf("fsync on an invalid descriptor should fail with EBADF.\n");
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    // Read the content back.
+    fd = open(filename, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open file %s: %s\n", filename, strerror(errno));
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    memset(buffer, 0, sizeof(buffer));
+    if (read(fd, buffer, 8) != 8) {
+        printf("Reading from file %s failed: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    unlink(filename);
+    if (strcmp(buffer, "fusrodah") != 0) {
+        printf("Unexpected file content `%s`, expecting `fusrodah`.\n", buffer);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/// @file t_futex.c
+/// @brief Test futexes on shared memory, and eventfd counters.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/eventfd.h>
+#include <sys/futex.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Waits for a child, and checks that it succeeded.
+/// @param what what the child was doing.
+/// @return 0 if the child succeeded, -1 otherwise.
+static int wait_child(const char *what)
+{
+    int status;
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The child failed %s.\n", what);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Makes a child sleep on a word of shared memory, until we change it and wake it up.
+/// @return 0 on success, -1 on failure.
+static int test_futex(void)
+{
+    int shmid = shmget(IPC_PRIVATE, sizeof(int), IPC_CREAT | 0600);
+    if (shmid < 0) {
+        printf("Failed to create the shared memory: %s\n", strerror(errno));
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    // Both processes attach the segment, on different addresses maybe, but
+    // on the same physical word.
+    int *word = (int *)shmat(shmid, NULL, 0);
+    if (word == (int *)-1) {
+        printf("Failed to attach the shared memory: %s\n", strerror(errno));
+        if (pid == 0) {
+            exit(EXIT_FAILURE);
+        }
+        return -1;
+    }
+    if (pid == 0) {
+        // Sleep while the word is zero, a wake-up which comes first makes the wait fail with EAGAIN.
+        while (*word == 0) {
+            if ((futex(word, FUTEX_WAIT, 0, NULL) < 0) && (errno != EAGAIN)) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        shmdt(word);
+        exit(EXIT_SUCCESS);
+    }
+    timespec_t req = { 0, 100000000 };
+    nanosleep(&req, NULL);
+    *word = 1;
+    if (futex(word, FUTEX_WAKE, 1, NULL) < 0) {
+        printf("Failed to wake up the child: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = wait_child("to wait on the futex");
+    // The word does not hold the value, and nobody wakes us up.
+    if ((futex(word, FUTEX_WAIT, 0, NULL) >= 0) || (errno != EAGAIN)) {
+        printf("Waiting on a changed word did not fail with EAGAIN.\n");
+        ret = -1;
+    }
+    timespec_t timeout = { 0, 50000000 };
+    if ((futex(word, FUTEX_WAIT, 1, &timeout) >= 0) || (errno != ETIMEDOUT)) {
+        printf("Waiting with a timeout did not fail with ETIMEDOUT.\n");
+        ret = -1;
+    }
+    shmdt(word);
+    shmctl(shmid, IPC_RMID, NULL);
+    return ret;
+}
+
+/// @brief Adds to, and takes from, eventfd counters.
+/// @return 0 on success, -1 on failure.
+static int test_eventfd(void)
+{
+    eventfd_t value;
+    int efd = eventfd(0, 0);
+    if (efd < 0) {
+        printf("Failed to create the eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+    // The child blocks on the empty counter, until we add to it.
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        exit(((eventfd_read(efd, &value) == 0) && (value == 5)) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    timespec_t req = { 0, 100000000 };
+    nanosleep(&req, NULL);
+    if (eventfd_write(efd, 5) < 0) {
+        printf("Failed to write to the eventfd: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = wait_child("to read the eventfd");
+    close(efd);
+    // Writes add to the initial value, a semaphore is taken one unit at a
+    // time, and does not block once empty.
+    efd = eventfd(1, EFD_SEMAPHORE | EFD_NONBLOCK);
+    if ((efd < 0) || (eventfd_write(efd, 1) < 0)) {
+        printf("Failed to set up the semaphore: %s\n", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < 2; ++i) {
+        if ((eventfd_read(efd, &value) < 0) || (value != 1)) {
+            printf("Failed to take the semaphore.\n");
+            ret = -1;
+        }
+    }
+    if ((eventfd_read(efd, &value) >= 0) || (errno != EAGAIN)) {
+        printf("Reading an empty eventfd did not fail with EAGAIN.\n");
+        ret = -1;
+    }
+    close(efd);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_futex() < 0) || (test_eventfd() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
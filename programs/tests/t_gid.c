@@ -48,22 +48,22 @@ int main(int argc, char **argv)
     // Get the group information for the group with GID 0.
     struct group *root_group = getgrgid(0);
     if (root_group == NULL) {
-        fprintf(STDERR_FILENO, "Error in getgrgid function: %s\n", strerror(errno));
+        fprintf(stderr, "Error in getgrgid function: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
     if (strcmp(root_group->gr_name, "root") != 0) {
-        fprintf(STDERR_FILENO, "Error: Expected group name 'root', got '%s'\n", root_group->gr_name);
+        fprintf(stderr, "Error: Expected group name 'root', got '%s'\n", root_group->gr_name);
         return EXIT_FAILURE;
     }
 
     // Get the group information for the group named "root".
     root_group = getgrnam("root");
     if (root_group == NULL) {
-        fprintf(STDERR_FILENO, "Error in getgrnam function: %s\n", strerror(errno));
+        fprintf(stderr, "Error in getgrnam function: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
     if (root_group->gr_gid != 0) {
-        fprintf(STDERR_FILENO, "Error: Expected GID 0, got %d\n", root_group->gr_gid);
+        fprintf(stderr, "Error: Expected GID 0, got %d\n", root_group->gr_gid);
         return EXIT_FAILURE;
     }
 
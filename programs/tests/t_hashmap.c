@@ -11,25 +11,52 @@
 
 #include "hashmap.h"
 
-// Custom allocation function for hashmap entries
-hashmap_entry_t *alloc_entry(void)
-{
-    hashmap_entry_t *entry = (hashmap_entry_t *)malloc(sizeof(hashmap_entry_t));
-    assert(entry && "Failed to allocate hashmap entry.");
-    return entry;
-}
+/// The number of integer keys inserted, enough for the map to grow several times.
+#define INT_KEYS 1000
 
-// Custom deallocation function for hashmap entries
-void dealloc_entry(hashmap_entry_t *entry)
+/// @brief Tests a map with integer keys, which grows, and from which half of
+/// the keys are removed.
+/// @return 0 on success, 1 on failure.
+static int test_int_keys(void)
 {
-    assert(entry && "Invalid entry pointer.");
-    free(entry); // Free the entry itself
+    hashmap_t map;
+    hashmap_init(&map, HASHMAP_KEY_INT, malloc, free);
+    for (unsigned long key = 0; key < INT_KEYS; ++key) {
+        if (hashmap_insert_int(&map, key * 7, (void *)(key + 1)) < 0) {
+            fprintf(stderr, "Error: Failed to insert the key %lu\n", key * 7);
+            return 1;
+        }
+    }
+    for (unsigned long key = 0; key < INT_KEYS; key += 2) {
+        if (hashmap_remove_int(&map, key * 7) != (void *)(key + 1)) {
+            fprintf(stderr, "Error: Failed to remove the key %lu\n", key * 7);
+            return 1;
+        }
+    }
+    for (unsigned long key = 0; key < INT_KEYS; ++key) {
+        void *expected = (key % 2) ? (void *)(key + 1) : NULL;
+        if (hashmap_get_int(&map, key * 7) != expected) {
+            fprintf(stderr, "Error: Wrong value for the key %lu\n", key * 7);
+            return 1;
+        }
+    }
+    // Iterate over the entries which are left.
+    size_t index = 0, count = 0;
+    while (hashmap_next(&map, &index)) {
+        ++count;
+    }
+    if ((count != (INT_KEYS / 2)) || (map.count != (INT_KEYS / 2))) {
+        fprintf(stderr, "Error: Found %u entries instead of %u\n", count, INT_KEYS / 2);
+        return 1;
+    }
+    hashmap_destroy(&map);
+    return 0;
 }
 
 int main(void)
 {
     hashmap_t map;
-    hashmap_init(&map, alloc_entry, dealloc_entry);
+    hashmap_init(&map, HASHMAP_KEY_STRING, malloc, free);
 
     // Test inserting and retrieving values
     hashmap_insert(&map, "apple", "A sweet red fruit");
@@ -79,6 +106,18 @@ int main(void)
         return 1;
     }
 
+    // Test that keys are compared, and not only their hashes.
+    char key[16];
+    strcpy(key, "apple");
+    if (strcmp(hashmap_get(&map, key), "A popular fruit often red or green") != 0) {
+        fprintf(stderr, "Error: Failed to retrieve 'apple' through another string\n");
+        return 1;
+    }
+    if (hashmap_get(&map, "appel") != NULL) {
+        fprintf(stderr, "Error: Retrieved value for non-existent key 'appel'\n");
+        return 1;
+    }
+
     // Test the removal of all items and final cleanup
     hashmap_destroy(&map);
     if (hashmap_get(&map, "apple") != NULL) {
@@ -94,5 +133,5 @@ int main(void)
         return 1;
     }
 
-    return 0;
+    return test_int_keys();
 }
@@ -0,0 +1,98 @@
+/// @file t_hrtimer.c
+/// @brief Test the high-resolution timers, through ITIMER_REAL and nanosleep().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/times.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The period of the real timer, shorter than a tick of the scheduler.
+#define PERIOD_US 1500
+/// The number of expirations we wait for.
+#define NUM_ALARMS 5
+/// The number of short sleeps.
+#define NUM_SLEEPS 20
+
+/// The number of SIGALRM received.
+static volatile int alarms = 0;
+
+/// @brief Counts the expirations of the real timer.
+/// @param signum the signal number.
+static void alarm_handler(int signum) { alarms++; }
+
+/// @brief Arms the real timer.
+/// @param value_us the microseconds before the first expiration.
+/// @param interval_us the microseconds between two expirations.
+/// @return 0 on success, -1 on failure.
+static int arm_timer(long value_us, long interval_us)
+{
+    struct itimerval timer;
+    timer.it_value.tv_sec     = value_us / 1000000;
+    timer.it_value.tv_usec    = value_us % 1000000;
+    timer.it_interval.tv_sec  = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    if (setitimer(ITIMER_REAL, &timer, NULL) < 0) {
+        printf("setitimer: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = alarm_handler;
+    if (sigaction(SIGALRM, &action, NULL) < 0) {
+        printf("sigaction: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (arm_timer(20000, PERIOD_US) < 0) {
+        return EXIT_FAILURE;
+    }
+    // The interval is kept with the precision of a microsecond.
+    struct itimerval current;
+    if (getitimer(ITIMER_REAL, &current) < 0) {
+        printf("getitimer: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((current.it_interval.tv_sec != 0) || (current.it_interval.tv_usec != PERIOD_US)) {
+        printf("The interval is %ld.%06ld s instead of %d us.\n", (long)current.it_interval.tv_sec,
+               (long)current.it_interval.tv_usec, PERIOD_US);
+        return EXIT_FAILURE;
+    }
+    if ((current.it_value.tv_sec != 0) || (current.it_value.tv_usec <= 0) || (current.it_value.tv_usec > 20000)) {
+        printf("The value is %ld.%06ld s instead of at most 20 ms.\n", (long)current.it_value.tv_sec,
+               (long)current.it_value.tv_usec);
+        return EXIT_FAILURE;
+    }
+    // The expirations come much faster than a second.
+    struct tms tms;
+    clock_t start = times(&tms);
+    while (alarms < NUM_ALARMS) {
+        if ((times(&tms) - start) > CLK_TCK) {
+            printf("Only %d alarms out of %d in a second.\n", alarms, NUM_ALARMS);
+            return EXIT_FAILURE;
+        }
+    }
+    if (arm_timer(0, 0) < 0) {
+        return EXIT_FAILURE;
+    }
+    // Short sleeps are not rounded up to a long period.
+    struct timespec req = { 0, 1000000 };
+    start               = times(&tms);
+    for (int i = 0; i < NUM_SLEEPS; ++i) {
+        nanosleep(&req, NULL);
+    }
+    if ((times(&tms) - start) > CLK_TCK) {
+        printf("%d sleeps of 1 ms took %ld ticks.\n", NUM_SLEEPS, (long)(times(&tms) - start));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/// @file t_inet.c
+/// @brief Test Internet sockets over the loopback: datagrams, connections, and refused connections.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The port of the datagram socket.
+#define UDP_PORT 7000
+/// The port of the listening socket.
+#define TCP_PORT 7001
+/// A port nobody listens on.
+#define CLOSED_PORT 7002
+/// The bytes sent through the connection, more than the windows hold.
+#define STREAM_SIZE (96 * 1024)
+
+/// @brief Fills an Internet name on the loopback.
+/// @param addr the name.
+/// @param port the port.
+static void set_name(struct sockaddr_in *addr, in_port_t port)
+{
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family      = AF_INET;
+    addr->sin_port        = htons(port);
+    addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+}
+
+/// @brief Sends a datagram to a bound socket, and checks the name of the sender.
+/// @return 0 on success, -1 on failure.
+static int test_udp(void)
+{
+    struct sockaddr_in addr, from;
+    socklen_t fromlen = sizeof(from);
+    char buffer[16];
+    set_name(&addr, UDP_PORT);
+    int server = socket(AF_INET, SOCK_DGRAM, 0);
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((server < 0) || (client < 0) || (bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+        printf("Failed to create the datagram sockets: %s\n", strerror(errno));
+        return -1;
+    }
+    if (sendto(client, "datagram", 8, 0, (struct sockaddr *)&addr, sizeof(addr)) != 8) {
+        printf("Failed to send the datagram: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((recvfrom(server, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromlen) != 8) ||
+        memcmp(buffer, "datagram", 8)) {
+        printf("Failed to receive the datagram.\n");
+        return -1;
+    }
+    if ((from.sin_family != AF_INET) || (from.sin_addr.s_addr != inet_addr("127.0.0.1")) || !from.sin_port) {
+        printf("The datagram came from %s:%u.\n", inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+        return -1;
+    }
+    // Answer the sender, which got an ephemeral port.
+    if ((sendto(server, "reply", 5, 0, (struct sockaddr *)&from, fromlen) != 5) ||
+        (recv(client, buffer, sizeof(buffer), 0) != 5) || memcmp(buffer, "reply", 5)) {
+        printf("Failed to answer the datagram.\n");
+        return -1;
+    }
+    // The port is taken.
+    int other = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((bind(other, (struct sockaddr *)&addr, sizeof(addr)) >= 0) || (errno != EADDRINUSE)) {
+        printf("Binding a port twice did not fail with EADDRINUSE.\n");
+        return -1;
+    }
+    close(other);
+    close(client);
+    close(server);
+    return 0;
+}
+
+/// @brief Streams data from a child through a connection, more than the
+/// buffers of either side hold, and checks that it arrives in order.
+/// @return 0 on success, -1 on failure.
+static int test_tcp(void)
+{
+    struct sockaddr_in addr;
+    static char buffer[4096];
+    set_name(&addr, TCP_PORT);
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0) {
+        printf("Failed to create the socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(server, 4) < 0)) {
+        printf("Failed to listen on port %d: %s\n", TCP_PORT, strerror(errno));
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        close(server);
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        if ((client < 0) || (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+            exit(EXIT_FAILURE);
+        }
+        for (size_t sent = 0; sent < STREAM_SIZE;) {
+            size_t len = (STREAM_SIZE - sent < sizeof(buffer)) ? STREAM_SIZE - sent : sizeof(buffer);
+            for (size_t i = 0; i < len; ++i) {
+                buffer[i] = (char)((sent + i) % 251);
+            }
+            ssize_t ret = write(client, buffer, len);
+            if (ret <= 0) {
+                exit(EXIT_FAILURE);
+            }
+            sent += ret;
+        }
+        // Wait for the server to tell it got everything.
+        if ((shutdown(client, SHUT_WR) < 0) || (read(client, buffer, sizeof(buffer)) != 4) ||
+            memcmp(buffer, "done", 4)) {
+            exit(EXIT_FAILURE);
+        }
+        close(client);
+        exit(EXIT_SUCCESS);
+    }
+    struct sockaddr_in peer;
+    socklen_t peerlen = sizeof(peer);
+    int conn          = accept(server, (struct sockaddr *)&peer, &peerlen);
+    if (conn < 0) {
+        printf("Failed to accept the connection: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret         = 0;
+    size_t received = 0;
+    while (1) {
+        ssize_t len = read(conn, buffer, sizeof(buffer));
+        if (len <= 0) {
+            if (len < 0) {
+                printf("Failed to read from the connection: %s\n", strerror(errno));
+                ret = -1;
+            }
+            break;
+        }
+        for (ssize_t i = 0; (i < len) && (ret == 0); ++i) {
+            if (buffer[i] != (char)((received + i) % 251)) {
+                printf("Byte %u of the stream is wrong.\n", (unsigned)(received + i));
+                ret = -1;
+            }
+        }
+        received += len;
+    }
+    if ((ret == 0) && (received != STREAM_SIZE)) {
+        printf("Received %u bytes out of %u.\n", (unsigned)received, STREAM_SIZE);
+        ret = -1;
+    }
+    if (write(conn, "done", 4) != 4) {
+        printf("Failed to answer the client: %s\n", strerror(errno));
+        ret = -1;
+    }
+    int status;
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The client failed.\n");
+        ret = -1;
+    }
+    close(conn);
+    close(server);
+    return ret;
+}
+
+/// @brief Connects to a port nobody listens on.
+/// @return 0 on success, -1 on failure.
+static int test_refused(void)
+{
+    struct sockaddr_in addr;
+    set_name(&addr, CLOSED_PORT);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client < 0) {
+        printf("Failed to create the socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((connect(client, (struct sockaddr *)&addr, sizeof(addr)) >= 0) || (errno != ECONNREFUSED)) {
+        printf("Connecting to a closed port did not fail with ECONNREFUSED.\n");
+        return -1;
+    }
+    close(client);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_udp() < 0) || (test_tcp() < 0) || (test_refused() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/// @file t_io_uring.c
+/// @brief Test the batched submission of system calls through io_uring.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/io_uring.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The content written, and read back, through the ring.
+#define CONTENT "Many system calls, a single entry into the kernel.\n"
+
+/// @brief Collects the completions of a batch, indexed by their user data.
+/// @param ring the ring.
+/// @param results where the results are stored.
+/// @param count the number of completions.
+/// @return 0 on success, -1 if a completion is missing or unexpected.
+static int collect(struct io_uring *ring, int *results, int count)
+{
+    struct io_uring_cqe *cqe;
+    for (int i = 0; i < count; ++i) {
+        if (io_uring_peek_cqe(ring, &cqe) < 0) {
+            printf("Missing completion %d of %d.\n", i, count);
+            return -1;
+        }
+        if (cqe->user_data >= (uint64_t)count) {
+            printf("Unexpected user data %lu.\n", (unsigned long)cqe->user_data);
+            return -1;
+        }
+        results[cqe->user_data] = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+    }
+    if (io_uring_peek_cqe(ring, &cqe) == 0) {
+        printf("More completions than the submitted entries.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_io_uring.txt";
+    char buffer[sizeof(CONTENT)];
+    struct io_uring ring;
+    struct io_uring_sqe *sqe;
+    struct stat st;
+    int results[6];
+
+    if (io_uring_queue_init(8, &ring) < 0) {
+        printf("Failed to setup the ring: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // The file descriptor is needed by the next batch.
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_open(sqe, filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    sqe->user_data = 0;
+    if ((io_uring_submit(&ring) != 1) || (collect(&ring, results, 1) < 0) || (results[0] < 0)) {
+        printf("Failed to open `%s` through the ring.\n", filename);
+        io_uring_queue_exit(&ring);
+        return EXIT_FAILURE;
+    }
+    int fd = results[0];
+    // Write, flush, check the size, read it back and close, with a single system call.
+    memset(buffer, 0, sizeof(buffer));
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_write(sqe, fd, CONTENT, strlen(CONTENT), -1);
+    sqe->user_data = 0;
+    sqe            = io_uring_get_sqe(&ring);
+    io_uring_prep_fsync(sqe, fd);
+    sqe->user_data = 1;
+    sqe            = io_uring_get_sqe(&ring);
+    io_uring_prep_stat(sqe, filename, &st);
+    sqe->user_data = 2;
+    sqe            = io_uring_get_sqe(&ring);
+    io_uring_prep_read(sqe, fd, buffer, strlen(CONTENT), 0);
+    sqe->user_data = 3;
+    sqe            = io_uring_get_sqe(&ring);
+    io_uring_prep_close(sqe, fd);
+    sqe->user_data = 4;
+    // An unknown operation fails on its own, without stopping the batch.
+    sqe            = io_uring_get_sqe(&ring);
+    sqe->opcode    = IORING_OP_LAST;
+    sqe->user_data = 5;
+    int submitted  = io_uring_submit(&ring);
+    int ret        = EXIT_FAILURE;
+    if (submitted != 6) {
+        printf("Submitted %d entries instead of 6: %s\n", submitted, strerror(errno));
+    } else if (collect(&ring, results, 6) < 0) {
+        // The message has been printed.
+    } else if ((results[0] != (int)strlen(CONTENT)) || (results[1] != 0) || (results[4] != 0)) {
+        printf("Write %d, fsync %d, close %d.\n", results[0], results[1], results[4]);
+    } else if ((results[2] != 0) || (st.st_size != (off_t)strlen(CONTENT))) {
+        printf("Stat %d, size %ld instead of %u.\n", results[2], (long)st.st_size, strlen(CONTENT));
+    } else if ((results[3] != (int)strlen(CONTENT)) || strcmp(buffer, CONTENT)) {
+        printf("Read %d bytes: `%s`\n", results[3], buffer);
+    } else if (results[5] != -EINVAL) {
+        printf("The unknown operation completed with %d.\n", results[5]);
+    } else {
+        ret = EXIT_SUCCESS;
+    }
+    io_uring_queue_exit(&ring);
+    unlink(filename);
+    return ret;
+}
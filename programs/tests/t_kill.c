@@ -44,7 +44,7 @@ int main(int argc, char *argv[])
 
         // Check if setting up the signal handler fails
         if (sigaction(SIGUSR1, &action, NULL) == -1) {
-            fprintf(STDERR_FILENO, "Failed to set signal handler for SIGUSR1: %s\n", strerror(errno));
+            fprintf(stderr, "Failed to set signal handler for SIGUSR1: %s\n", strerror(errno));
             return EXIT_FAILURE; // Return failure if handler setup fails
         }
 
@@ -70,7 +70,7 @@ int main(int argc, char *argv[])
 
         // Send SIGUSR1 to the child process
         if (kill(cpid, SIGUSR1) == -1) {
-            fprintf(STDERR_FILENO, "Failed to send SIGUSR1 to child: %s\n", strerror(errno));
+            fprintf(stderr, "Failed to send SIGUSR1 to child: %s\n", strerror(errno));
             return EXIT_FAILURE; // Return failure if signal sending fails
         }
 
@@ -79,20 +79,20 @@ int main(int argc, char *argv[])
 
         // Send SIGTERM to the child process to terminate it
         if (kill(cpid, SIGTERM) == -1) {
-            fprintf(STDERR_FILENO, "Failed to send SIGTERM to child: %s\n", strerror(errno));
+            fprintf(stderr, "Failed to send SIGTERM to child: %s\n", strerror(errno));
             return EXIT_FAILURE; // Return failure if termination fails
         }
 
         // Wait for the child process to terminate
         if (wait(NULL) == -1) {
-            fprintf(STDERR_FILENO, "Failed to wait for child process: %s\n", strerror(errno));
+            fprintf(stderr, "Failed to wait for child process: %s\n", strerror(errno));
             return EXIT_FAILURE; // Return failure if wait fails
         }
         printf("main : Child has terminated. End of parent process.\n");
 
     } else {
         // Fork failed
-        fprintf(STDERR_FILENO, "Failed to fork: %s\n", strerror(errno));
+        fprintf(stderr, "Failed to fork: %s\n", strerror(errno));
         return EXIT_FAILURE; // Return failure if fork fails
     }
 
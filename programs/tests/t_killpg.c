@@ -0,0 +1,63 @@
+/// @file t_killpg.c
+/// @brief Tests sending a signal to all the processes of a process group.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The number of children inside the group.
+#define NUM_CHILDREN 3
+
+int main(int argc, char *argv[])
+{
+    pid_t cpids[NUM_CHILDREN];
+    int status;
+
+    // The children wait to be killed, inside the group of the first one.
+    for (int i = 0; i < NUM_CHILDREN; ++i) {
+        cpids[i] = fork();
+        if (cpids[i] == 0) {
+            struct timespec req = { 0, 100000000 };
+            while (1) {
+                nanosleep(&req, NULL);
+            }
+        }
+        if (cpids[i] < 0) {
+            fprintf(stderr, "Failed to fork: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if (setpgid(cpids[i], cpids[0]) == -1) {
+            fprintf(stderr, "Failed to move child %d to group %d: %s\n", cpids[i], cpids[0], strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    if (getpgid(cpids[NUM_CHILDREN - 1]) != cpids[0]) {
+        fprintf(stderr, "The last child should be inside group %d.\n", cpids[0]);
+        return EXIT_FAILURE;
+    }
+
+    // A single kill reaches all of them.
+    if (kill(-cpids[0], SIGTERM) == -1) {
+        fprintf(stderr, "Failed to signal group %d: %s\n", cpids[0], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < NUM_CHILDREN; ++i) {
+        if ((waitpid(cpids[i], &status, 0) != cpids[i]) || !WIFSIGNALED(status) || (WTERMSIG(status) != SIGTERM)) {
+            fprintf(stderr, "Child %d was not terminated by SIGTERM.\n", cpids[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The group is empty now.
+    if ((kill(-cpids[0], SIGTERM) != -1) || (errno != ESRCH)) {
+        fprintf(stderr, "Signaling an empty group should fail with ESRCH.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/// @file t_kmsg.c
+/// @brief Test the kernel log, which keeps the messages sent by syslog(), and
+/// is read through `/proc/kmsg`.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+
+/// The size of the buffer the kernel log is read into, larger than the log.
+#define LOG_SIZE (8 * 8192)
+
+/// The content of the kernel log.
+static char klog[LOG_SIZE + 1];
+
+/// @brief Reads the whole kernel log.
+/// @return the size of the log, -1 on failure.
+static ssize_t read_log(void)
+{
+    int fd = open("/proc/kmsg", O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open `/proc/kmsg`: %s\n", strerror(errno));
+        return -1;
+    }
+    ssize_t size = 0, ret = 0;
+    while ((size < LOG_SIZE) && ((ret = read(fd, klog + size, LOG_SIZE - size)) > 0)) {
+        size += ret;
+    }
+    close(fd);
+    if (ret < 0) {
+        printf("Failed to read `/proc/kmsg`: %s\n", strerror(errno));
+        return -1;
+    }
+    klog[size] = 0;
+    return size;
+}
+
+int main(int argc, char *argv[])
+{
+    char message[64];
+    // The message is printed verbatim, not used as a format.
+    snprintf(message, sizeof(message), "t_kmsg %d %%s", getpid());
+    syslog(LOG_NOTICE, "%s\n", message);
+    if (read_log() < 0) {
+        return EXIT_FAILURE;
+    }
+    if (!strstr(klog, message)) {
+        printf("The message `%s` is not inside the kernel log.\n", message);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
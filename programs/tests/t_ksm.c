@@ -0,0 +1,98 @@
+/// @file t_ksm.c
+/// @brief Test the merging of the identical pages, which must stay private to
+/// each mapping once written.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strerror.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// The size of each mapping.
+#define MAP_SIZE (8 * 4096)
+
+/// @brief Writes a command to `/proc/ksm`.
+/// @param command the command.
+/// @return 0 on success, -1 on failure.
+static int ksm_write(const char *command)
+{
+    int fd = open("/proc/ksm", O_WRONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open `/proc/ksm`: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = (write(fd, command, strlen(command)) == (ssize_t)strlen(command)) ? 0 : -1;
+    if (ret < 0) {
+        printf("Failed to write `%s` to `/proc/ksm`: %s\n", command, strerror(errno));
+    }
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int status   = EXIT_FAILURE;
+    char *first  = mmap(NULL, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char *second = mmap(NULL, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((first == MAP_FAILED) || (second == MAP_FAILED)) {
+        printf("Failed to map anonymous memory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < MAP_SIZE; ++i) {
+        first[i] = second[i] = "same page merging "[i % 18];
+    }
+    if ((madvise(first, MAP_SIZE, MADV_MERGEABLE) < 0) || (madvise(second, MAP_SIZE, MADV_MERGEABLE) < 0)) {
+        printf("Failed to mark the pages as mergeable: %s\n", strerror(errno));
+        goto cleanup;
+    }
+    if (ksm_write("1") < 0) {
+        goto cleanup;
+    }
+    // Let the thread go through the pages, the first pass only finds them.
+    sleep(1);
+    char buffer[256];
+    int fd = open("/proc/ksm", O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open `/proc/ksm`: %s\n", strerror(errno));
+        goto stop;
+    }
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        printf("Failed to read `/proc/ksm`.\n");
+        goto stop;
+    }
+    buffer[length] = '\0';
+    if (strstr(buffer, "pages_shared") == NULL) {
+        printf("The statistics of the merging are missing.\n");
+        goto stop;
+    }
+    // Writing a page, merged or not, only changes the mapping it belongs to.
+    first[0]             = 'x';
+    second[MAP_SIZE - 1] = 'y';
+    for (int i = 0; i < MAP_SIZE; ++i) {
+        char expected = "same page merging "[i % 18];
+        if ((first[i] != ((i == 0) ? 'x' : expected)) || (second[i] != ((i == MAP_SIZE - 1) ? 'y' : expected))) {
+            printf("The pages differ from what was written, at offset %d.\n", i);
+            goto stop;
+        }
+    }
+    if ((madvise(first, MAP_SIZE, MADV_UNMERGEABLE) < 0) || (madvise(second, MAP_SIZE, MADV_UNMERGEABLE) < 0)) {
+        printf("Failed to mark the pages as unmergeable: %s\n", strerror(errno));
+        goto stop;
+    }
+    status = EXIT_SUCCESS;
+stop:
+    if (ksm_write("0") < 0) {
+        status = EXIT_FAILURE;
+    }
+cleanup:
+    munmap(first, MAP_SIZE);
+    munmap(second, MAP_SIZE);
+    return status;
+}
@@ -0,0 +1,109 @@
+/// @file t_madvise.c
+/// @brief Test the access advice given through madvise() and posix_fadvise().
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The size of the mapped file, and of the anonymous mapping.
+#define MAP_SIZE (4 * 4096)
+
+/// @brief Releases the pages of an anonymous mapping, which read back as zero.
+/// @return 0 on success, -1 on failure.
+static int test_dontneed(void)
+{
+    char *map = mmap(NULL, MAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to map anonymous memory: %s\n", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < MAP_SIZE; ++i) {
+        map[i] = 'x';
+    }
+    int ret = madvise(map, MAP_SIZE, MADV_DONTNEED);
+    if (ret < 0) {
+        printf("Failed to release the pages: %s\n", strerror(errno));
+    }
+    for (int i = 0; (ret == 0) && (i < MAP_SIZE); ++i) {
+        if (map[i] != 0) {
+            printf("The released page holds '%c' at offset %d.\n", map[i], i);
+            ret = -1;
+        }
+    }
+    munmap(map, MAP_SIZE);
+    return ret;
+}
+
+/// @brief Reads a file mapped sequentially, and advises its reads.
+/// @param fd the file, holding MAP_SIZE bytes.
+/// @return 0 on success, -1 on failure.
+static int test_file(int fd)
+{
+    if ((posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL) != 0) ||
+        (posix_fadvise(fd, 0, MAP_SIZE, POSIX_FADV_WILLNEED) != 0) ||
+        (posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0)) {
+        printf("Failed to advise the reads of the file.\n");
+        return -1;
+    }
+    if (posix_fadvise(fd, 0, 0, 42) != EINVAL) {
+        printf("An unknown advice did not fail with EINVAL.\n");
+        return -1;
+    }
+    char *map = mmap(NULL, MAP_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to map the file: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    if ((madvise(map, MAP_SIZE, MADV_SEQUENTIAL) < 0) || (madvise(map, MAP_SIZE, MADV_WILLNEED) < 0)) {
+        printf("Failed to advise the mapping: %s\n", strerror(errno));
+        ret = -1;
+    }
+    for (int i = 0; (ret == 0) && (i < MAP_SIZE); ++i) {
+        if (map[i] != (char)('a' + (i % 26))) {
+            printf("The mapping holds '%c' at offset %d.\n", map[i], i);
+            ret = -1;
+        }
+    }
+    // Released pages of a file mapping are read again from the file.
+    if ((ret == 0) &&
+        ((madvise(map, MAP_SIZE, MADV_DONTNEED) < 0) || (map[MAP_SIZE - 1] != (char)('a' + ((MAP_SIZE - 1) % 26))))) {
+        printf("The released pages were not read again from the file.\n");
+        ret = -1;
+    }
+    munmap(map, MAP_SIZE);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_madvise.txt";
+    static char buffer[MAP_SIZE];
+
+    if (test_dontneed() < 0) {
+        return EXIT_FAILURE;
+    }
+    if ((madvise((void *)1, 4096, MADV_NORMAL) != -1) || (errno != EINVAL)) {
+        printf("An address which is not aligned did not fail with EINVAL.\n");
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < MAP_SIZE; ++i) {
+        buffer[i] = (char)('a' + (i % 26));
+    }
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = (write(fd, buffer, MAP_SIZE) == MAP_SIZE) ? test_file(fd) : -1;
+    close(fd);
+    unlink(filename);
+    return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -2,16 +2,52 @@
 /// @brief Memory allocation, writing, and deallocation example.
 /// @details This program allocates memory for a 2D array, writes to it, and
 /// then frees the memory. It demonstrates basic dynamic memory management in C,
-/// including error handling for memory allocation failures.
+/// including error handling for memory allocation failures. It then checks
+/// that freed blocks are reused, that realloc() keeps the content, and that
+/// large blocks work too.
 /// @copyright (c) 2014-2024 This file is distributed under the MIT License.
 /// See LICENSE.md for details.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+/// @brief Checks the reuse of freed blocks, realloc(), and large blocks.
+/// @return 0 on success, -1 on failure.
+static int test_allocator(void)
+{
+    // A block of the same size takes the place of the freed one.
+    char *first = malloc(24);
+    free(first);
+    char *second = malloc(24);
+    if (second != first) {
+        fprintf(stderr, "The freed block was not reused.\n");
+        return -1;
+    }
+    // Growing the block keeps its content, and zero-fills the rest.
+    memset(second, 'x', 24);
+    char *grown = realloc(second, 4000);
+    if (!grown || (grown[23] != 'x') || (grown[3999] != 0) || (malloc_usable_size(grown) < 4000)) {
+        fprintf(stderr, "Failed to grow the block.\n");
+        return -1;
+    }
+    free(grown);
+    // Blocks larger than the heap are mapped on their own.
+    size_t size = 8 * 1024 * 1024;
+    char *large = malloc(size);
+    if (!large) {
+        fprintf(stderr, "Failed to allocate a large block.\n");
+        return -1;
+    }
+    large[0]        = 1;
+    large[size - 1] = 2;
+    free(large);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     // Define dimensions for the 2D array (can be modified for testing).
@@ -67,5 +103,5 @@ int main(int argc, char *argv[])
     free(M);
     M = NULL; // Nullify pointer after freeing.
 
-    return EXIT_SUCCESS;
+    return (test_allocator() < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,93 @@
+/// @file t_mkfifo.c
+/// @brief Test named pipes, created with mkfifo and shared by unrelated opens.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The message sent through the named pipe.
+static const char message[] = "Through the named pipe.";
+
+/// @brief Reads the message from the named pipe, until the writer closes it.
+/// @param filename the path of the named pipe.
+/// @return 0 if the message is correct, -1 otherwise.
+static int read_message(const char *filename)
+{
+    char buffer[sizeof(message)];
+    ssize_t length = sizeof(message), total = 0, ret;
+
+    // Blocks until the writer opens the other end.
+    int fd = open(filename, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open the read end of %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    while ((total < length) && ((ret = read(fd, buffer + total, length - total)) > 0)) {
+        total += ret;
+    }
+    // Once the writer is gone, the pipe reports the end of file.
+    if ((total != length) || memcmp(buffer, message, length) || (read(fd, buffer, 1) != 0)) {
+        printf("The data read from %s is wrong (%d bytes).\n", filename, total);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_mkfifo";
+    stat_t st;
+
+    if (mkfifo(filename, S_IRUSR | S_IWUSR) < 0) {
+        printf("Failed to create %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((mkfifo(filename, S_IRUSR | S_IWUSR) >= 0) || (errno != EEXIST)) {
+        printf("Creating %s twice did not fail with EEXIST.\n", filename);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    if ((stat(filename, &st) < 0) || !S_ISFIFO(st.st_mode)) {
+        printf("The file %s is not a named pipe.\n", filename);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    // Nobody reads from the named pipe yet.
+    if ((open(filename, O_WRONLY | O_NONBLOCK, 0) >= 0) || (errno != ENXIO)) {
+        printf("A non-blocking open of the write end did not fail with ENXIO.\n");
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        // Blocks until the reader opens the other end.
+        int fd = open(filename, O_WRONLY, 0);
+        if ((fd < 0) || (write(fd, message, sizeof(message)) != (ssize_t)sizeof(message))) {
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+        exit(EXIT_SUCCESS);
+    }
+    int status, ret = read_message(filename);
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The writer failed to send the message.\n");
+        ret = -1;
+    }
+    unlink(filename);
+    return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/// @file t_mmap.c
+/// @brief Test private, shared, anonymous, and large page memory mappings.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of the mapped file, which spans a page and a half.
+#define FILE_SIZE 6144
+
+/// @brief Returns the byte of the file at the given offset.
+/// @param offset the offset.
+/// @return the byte.
+static inline char file_byte(int offset) { return 'a' + (offset % 26); }
+
+/// @brief Checks the content of the file, read with read().
+/// @param filename the file.
+/// @param offset the offset of a byte which has been changed.
+/// @param value the value of the changed byte.
+/// @return 0 on success, -1 on failure.
+static int check_file(const char *filename, int offset, char value)
+{
+    static char buffer[FILE_SIZE];
+    int fd = open(filename, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open file %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    ssize_t ret = read(fd, buffer, FILE_SIZE);
+    close(fd);
+    if (ret != FILE_SIZE) {
+        printf("Failed to read file %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < FILE_SIZE; ++i) {
+        if (buffer[i] != ((i == offset) ? value : file_byte(i))) {
+            printf("File %s holds '%c' at offset %d.\n", filename, buffer[i], i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Maps the file privately, and writes to the mapping.
+/// @param fd the file.
+/// @param filename the name of the file.
+/// @return 0 on success, -1 on failure.
+static int test_private(int fd, const char *filename)
+{
+    char *map = mmap(NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to map file %s privately: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    for (int i = 0; i < FILE_SIZE; ++i) {
+        if (map[i] != file_byte(i)) {
+            printf("The private mapping holds '%c' at offset %d.\n", map[i], i);
+            ret = -1;
+            break;
+        }
+    }
+    // The rest of the last page is zero-filled.
+    if (map[FILE_SIZE] != 0) {
+        printf("The private mapping is not zero-filled past the end of the file.\n");
+        ret = -1;
+    }
+    // The changes are not written back.
+    map[10] = '#';
+    if ((munmap(map, FILE_SIZE) < 0) || (check_file(filename, -1, 0) < 0)) {
+        printf("The private mapping changed the file.\n");
+        ret = -1;
+    }
+    return ret;
+}
+
+/// @brief Maps the file shared between two processes, and writes it back.
+/// @param fd the file.
+/// @param filename the name of the file.
+/// @return 0 on success, -1 on failure.
+static int test_shared(int fd, const char *filename)
+{
+    char *map = mmap(NULL, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to map file %s shared: %s\n", filename, strerror(errno));
+        return -1;
+    }
+    // The change of the child is seen by the parent, on the second page.
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        map[5000] = '#';
+        exit(EXIT_SUCCESS);
+    }
+    int status;
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The child failed to write to the shared mapping.\n");
+        return -1;
+    }
+    if (map[5000] != '#') {
+        printf("The shared mapping holds '%c' instead of the change of the child.\n", map[5000]);
+        return -1;
+    }
+    if ((msync(map, FILE_SIZE, MS_SYNC) < 0) || (check_file(filename, 5000, '#') < 0)) {
+        printf("Failed to write back the shared mapping: %s\n", strerror(errno));
+        return -1;
+    }
+    // Unmapping writes back the last changes.
+    map[5000] = file_byte(5000);
+    if ((munmap(map, FILE_SIZE) < 0) || (check_file(filename, -1, 0) < 0)) {
+        printf("Failed to unmap the shared mapping: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Shares an anonymous mapping with a child.
+/// @return 0 on success, -1 on failure.
+static int test_anonymous(void)
+{
+    int *map = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        printf("Failed to create an anonymous mapping: %s\n", strerror(errno));
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        *map = 42;
+        exit(EXIT_SUCCESS);
+    }
+    int status;
+    wait(&status);
+    int ret = (*map == 42) ? 0 : -1;
+    if (ret < 0) {
+        printf("The anonymous mapping holds %d instead of the value of the child.\n", *map);
+    }
+    munmap(map, sizeof(int));
+    return ret;
+}
+
+/// @brief Copies a private mapping of large pages into a child.
+/// @return 0 on success, or when large pages are not supported, -1 on failure.
+static int test_hugetlb(void)
+{
+    size_t size = 4 * 1024 * 1024;
+    int *map    = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (map == MAP_FAILED) {
+        // The processor, or the memory, may not provide large pages.
+        return ((errno == EINVAL) || (errno == ENOMEM)) ? 0 : -1;
+    }
+    if (((unsigned long)map & (size - 1)) || (map[0] != 0) || (map[(size / sizeof(int)) - 1] != 0)) {
+        printf("The large page mapping is not aligned, or not zero-filled.\n");
+        munmap(map, size);
+        return -1;
+    }
+    map[0] = 42;
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        munmap(map, size);
+        return -1;
+    }
+    if (pid == 0) {
+        int value = map[0];
+        map[0]    = 7;
+        exit((value == 42) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    int status;
+    wait(&status);
+    int ret = (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_SUCCESS) && (map[0] == 42)) ? 0 : -1;
+    if (ret < 0) {
+        printf("The large page mapping was not copied into the child.\n");
+    }
+    munmap(map, size);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_mmap.txt";
+    static char buffer[FILE_SIZE];
+
+    for (int i = 0; i < FILE_SIZE; ++i) {
+        buffer[i] = file_byte(i);
+    }
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (write(fd, buffer, FILE_SIZE) != FILE_SIZE) {
+        printf("Failed to write file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    int ret = ((test_private(fd, filename) < 0) || (test_shared(fd, filename) < 0) || (test_anonymous() < 0) ||
+               (test_hugetlb() < 0));
+    close(fd);
+    unlink(filename);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
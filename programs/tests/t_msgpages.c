@@ -0,0 +1,167 @@
+/// @file t_msgpages.c
+/// @brief Test the messages whose whole pages move through the queue, instead
+/// of being copied.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of a page.
+#define PAGE 4096
+/// The size of the messages: a whole page, and a piece of the next one.
+#define TEXT_SIZE (PAGE + 100)
+
+/// @brief Returns a message inside a new mapping, with the text aligned to a page.
+/// @return the message, NULL on failure.
+static struct msgbuf *map_message(void)
+{
+    char *memory = mmap(NULL, 3 * PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        printf("Failed to map the message: %s\n", strerror(errno));
+        return NULL;
+    }
+    return (struct msgbuf *)(memory + PAGE - sizeof(long));
+}
+
+/// @brief Fills the text of a message.
+/// @param text the text.
+/// @param seed the first byte.
+static void fill(char *text, int seed)
+{
+    for (int i = 0; i < TEXT_SIZE; ++i) {
+        text[i] = (char)(seed + i);
+    }
+}
+
+/// @brief Checks the text of a message.
+/// @param text the text.
+/// @param size the bytes to check.
+/// @param seed the first byte.
+/// @return 0 if it matches, -1 otherwise.
+static int check(const char *text, int size, int seed)
+{
+    for (int i = 0; i < size; ++i) {
+        if (text[i] != (char)(seed + i)) {
+            printf("The byte %d is %d, instead of %d.\n", i, text[i], (char)(seed + i));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Sends a message, and overwrites it once sent.
+/// @param msqid the message queue.
+/// @param message the message.
+/// @param seed the first byte of the text.
+/// @return 0 on success, -1 on failure.
+static int send_message(int msqid, struct msgbuf *message, int seed)
+{
+    message->mtype = 1;
+    fill(message->mtext, seed);
+    if (msgsnd(msqid, message, TEXT_SIZE, 0) < 0) {
+        printf("Failed to send the message: %s\n", strerror(errno));
+        return -1;
+    }
+    // The queue keeps the text it was given.
+    fill(message->mtext, seed + 1);
+    return 0;
+}
+
+/// @brief Receives a message, checks it, and overwrites it once received.
+/// @param msqid the message queue.
+/// @param message where the message is stored.
+/// @param size the bytes to receive.
+/// @param seed the expected first byte of the text.
+/// @return 0 on success, -1 on failure.
+static int receive_message(int msqid, struct msgbuf *message, int size, int seed)
+{
+    ssize_t ret = msgrcv(msqid, message, size, 0, IPC_NOWAIT | MSG_NOERROR);
+    if (ret != size) {
+        printf("Received %d bytes, instead of %d: %s\n", (int)ret, size, strerror(errno));
+        return -1;
+    }
+    if ((message->mtype != 1) || (check(message->mtext, size, seed) < 0)) {
+        return -1;
+    }
+    // The writes of the receiver are its own.
+    fill(message->mtext, seed + 2);
+    return 0;
+}
+
+/// @brief Sends the messages from aligned buffers, and receives them inside
+/// aligned, unaligned, and too small buffers.
+/// @param msqid the message queue.
+/// @return 0 on success, -1 on failure.
+static int test_buffers(int msqid)
+{
+    struct msgbuf *sent     = map_message();
+    struct msgbuf *received = map_message();
+    char *unaligned         = malloc(sizeof(long) + TEXT_SIZE);
+    if (!sent || !received || !unaligned) {
+        return -1;
+    }
+    if ((send_message(msqid, sent, 1) < 0) || (send_message(msqid, sent, 2) < 0) ||
+        (send_message(msqid, sent, 3) < 0)) {
+        return -1;
+    }
+    if ((receive_message(msqid, received, TEXT_SIZE, 1) < 0) ||
+        (receive_message(msqid, (struct msgbuf *)unaligned, TEXT_SIZE, 2) < 0) ||
+        (receive_message(msqid, received, 100, 3) < 0)) {
+        return -1;
+    }
+    // Neither the sender, nor the other messages, see the writes of the receiver.
+    if (check(sent->mtext, TEXT_SIZE, 4) < 0) {
+        return -1;
+    }
+    free(unaligned);
+    return 0;
+}
+
+/// @brief Sends a message to another process.
+/// @param msqid the message queue.
+/// @return 0 on success, -1 on failure.
+static int test_fork(int msqid)
+{
+    struct msgbuf *message = map_message();
+    int status;
+    if (!message) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (msgrcv(msqid, message, TEXT_SIZE, 0, 0) != TEXT_SIZE) {
+            exit(EXIT_FAILURE);
+        }
+        exit(check(message->mtext, TEXT_SIZE, 5) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if (send_message(msqid, message, 5) < 0) {
+        return -1;
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child did not receive the message.\n");
+        return -1;
+    }
+    return check(message->mtext, TEXT_SIZE, 6);
+}
+
+int main(int argc, char *argv[])
+{
+    int msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+    if (msqid < 0) {
+        printf("Failed to create the message queue: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = ((test_buffers(msqid) < 0) || (test_fork(msqid) < 0));
+    msgctl(msqid, IPC_RMID, NULL);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
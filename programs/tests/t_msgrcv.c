@@ -0,0 +1,124 @@
+/// @file t_msgrcv.c
+/// @brief Test how msgrcv() selects the messages by type, and waits for them.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief A message, with a short text.
+typedef struct {
+    long mtype;    ///< Message type.
+    char mtext[8]; ///< Message text.
+} message_t;
+
+/// @brief Sends a message.
+/// @param msqid the message queue.
+/// @param type the type of the message.
+/// @param text the text of the message.
+/// @return 0 on success, -1 on failure.
+static int send_message(int msqid, long type, const char *text)
+{
+    message_t message;
+    message.mtype = type;
+    strcpy(message.mtext, text);
+    if (msgsnd(msqid, &message, strlen(text) + 1, 0) < 0) {
+        printf("Failed to send `%s`: %s\n", text, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Receives a message, and checks it is the expected one.
+/// @param msqid the message queue.
+/// @param msgtyp the types to receive.
+/// @param type the expected type.
+/// @param text the expected text.
+/// @return 0 on success, -1 on failure.
+static int receive_message(int msqid, long msgtyp, long type, const char *text)
+{
+    message_t message;
+    if (msgrcv(msqid, &message, sizeof(message.mtext), msgtyp, IPC_NOWAIT) < 0) {
+        printf("Failed to receive type %ld: %s\n", msgtyp, strerror(errno));
+        return -1;
+    }
+    if ((message.mtype != type) || strcmp(message.mtext, text)) {
+        printf("Received `%s` of type %ld, instead of `%s` of type %ld.\n", message.mtext, message.mtype, text, type);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Receives the messages by type, without waiting.
+/// @param msqid the message queue.
+/// @return 0 on success, -1 on failure.
+static int test_types(int msqid)
+{
+    message_t message;
+    if ((send_message(msqid, 3, "a") < 0) || (send_message(msqid, 1, "b") < 0) || (send_message(msqid, 2, "c") < 0) ||
+        (send_message(msqid, 1, "d") < 0)) {
+        return -1;
+    }
+    // The oldest message, the oldest of a type, then the oldest of the lowest type.
+    if ((receive_message(msqid, 0, 3, "a") < 0) || (receive_message(msqid, 2, 2, "c") < 0) ||
+        (receive_message(msqid, -2, 1, "b") < 0) || (receive_message(msqid, -3, 1, "d") < 0)) {
+        return -1;
+    }
+    if ((msgrcv(msqid, &message, sizeof(message.mtext), 0, IPC_NOWAIT) != -1) || (errno != ENOMSG)) {
+        printf("The queue is not empty.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Waits for a message of a given type, while others arrive.
+/// @param msqid the message queue.
+/// @return 0 on success, -1 on failure.
+static int test_blocking(int msqid)
+{
+    struct timespec delay = { 0, 20000000 };
+    message_t message;
+    int status;
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (msgrcv(msqid, &message, sizeof(message.mtext), 5, 0) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        exit(((message.mtype == 5) && !strcmp(message.mtext, "f")) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    // The message of another type does not wake up the child for good.
+    nanosleep(&delay, NULL);
+    if (send_message(msqid, 4, "e") < 0) {
+        return -1;
+    }
+    nanosleep(&delay, NULL);
+    if (send_message(msqid, 5, "f") < 0) {
+        return -1;
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child did not receive its message.\n");
+        return -1;
+    }
+    return receive_message(msqid, 0, 4, "e");
+}
+
+int main(int argc, char *argv[])
+{
+    int msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+    if (msqid < 0) {
+        printf("Failed to create the message queue: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = ((test_types(msqid) < 0) || (test_blocking(msqid) < 0));
+    msgctl(msqid, IPC_RMID, NULL);
+    return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/// @file t_odirect.c
+/// @brief Test the aligned transfers of a file opened with O_DIRECT.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strerror.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The size of the transfers, a multiple of any block size.
+#define BLOCK 4096
+
+/// The buffers, aligned on the blocks.
+static char wbuffer[2 * BLOCK] __attribute__((aligned(BLOCK)));
+static char rbuffer[2 * BLOCK] __attribute__((aligned(BLOCK)));
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_odirect.txt";
+    int status     = EXIT_FAILURE;
+
+    for (int i = 0; i < sizeof(wbuffer); ++i) {
+        wbuffer[i] = (char)('a' + (i % 26));
+    }
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (write(fd, wbuffer, sizeof(wbuffer)) != sizeof(wbuffer)) {
+        printf("Failed to write on file %s: %s\n", filename, strerror(errno));
+        goto cleanup;
+    }
+    if ((lseek(fd, 0, SEEK_SET) != 0) || (read(fd, rbuffer, sizeof(rbuffer)) != sizeof(rbuffer))) {
+        printf("Failed to read file %s: %s\n", filename, strerror(errno));
+        goto cleanup;
+    }
+    if (memcmp(wbuffer, rbuffer, sizeof(wbuffer))) {
+        printf("The data read back differs from the data written.\n");
+        goto cleanup;
+    }
+    // Transfers which are not aligned are refused.
+    if ((lseek(fd, 1, SEEK_SET) != 1) || (read(fd, rbuffer, BLOCK) != -1) || (errno != EINVAL)) {
+        printf("A read which is not aligned did not fail with EINVAL.\n");
+        goto cleanup;
+    }
+    if ((lseek(fd, 0, SEEK_SET) != 0) || (write(fd, wbuffer + 1, BLOCK) != -1) || (errno != EINVAL)) {
+        printf("A write from a buffer which is not aligned did not fail with EINVAL.\n");
+        goto cleanup;
+    }
+    status = EXIT_SUCCESS;
+cleanup:
+    close(fd);
+    unlink(filename);
+    return status;
+}
@@ -20,7 +20,7 @@ int main(int argc, char *argv[])
 
     // Get current scheduling parameters.
     if (sched_getparam(cpid, &param) == -1) {
-        fprintf(STDERR_FILENO, "Failed to get scheduling parameters: %s\n", strerror(errno));
+        fprintf(stderr, "Failed to get scheduling parameters: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
 
@@ -32,7 +32,7 @@ int main(int argc, char *argv[])
 
     // Set modified scheduling parameters.
     if (sched_setparam(cpid, &param) == -1) {
-        fprintf(STDERR_FILENO, "Failed to set scheduling parameters: %s\n", strerror(errno));
+        fprintf(stderr, "Failed to set scheduling parameters: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
 
@@ -42,7 +42,7 @@ int main(int argc, char *argv[])
     if (fork() == 0) {
         char *_argv[] = {"/bin/tests/t_periodic2", NULL};
         execv(_argv[0], _argv);
-        fprintf(STDERR_FILENO, "Failed to execute %s: %s\n", _argv[0], strerror(errno));
+        fprintf(stderr, "Failed to execute %s: %s\n", _argv[0], strerror(errno));
         return EXIT_FAILURE;
     }
 
@@ -50,7 +50,7 @@ int main(int argc, char *argv[])
     if (fork() == 0) {
         char *_argv[] = {"/bin/tests/t_periodic3", NULL};
         execv(_argv[0], _argv);
-        fprintf(STDERR_FILENO, "Failed to execute %s: %s\n", _argv[0], strerror(errno));
+        fprintf(stderr, "Failed to execute %s: %s\n", _argv[0], strerror(errno));
         return EXIT_FAILURE;
     }
 
@@ -63,7 +63,7 @@ int main(int argc, char *argv[])
 
         // Wait for the next period.
         if (waitperiod() == -1) {
-            fprintf(STDERR_FILENO, "[%s] Error in waitperiod: %s\n", argv[0], strerror(errno));
+            fprintf(stderr, "[%s] Error in waitperiod: %s\n", argv[0], strerror(errno));
             break;
         }
     }
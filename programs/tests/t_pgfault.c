@@ -0,0 +1,89 @@
+/// @file t_pgfault.c
+/// @brief Test the accounting of the page faults, for the process and for the
+/// children it waited for.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of a page.
+#define PAGE  4096
+/// The number of pages touched.
+#define PAGES 8
+
+/// @brief Touches fresh anonymous pages, each one faulting once.
+/// @return 0 on success, -1 on failure.
+static int touch_pages(void)
+{
+    char *memory = mmap(NULL, PAGES * PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        printf("Failed to map the memory: %s\n", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < PAGES; ++i) {
+        memory[i * PAGE] = (char)i;
+    }
+    munmap(memory, PAGES * PAGE);
+    return 0;
+}
+
+/// @brief Checks that the pages touched by the process are minor faults.
+/// @return 0 on success, -1 on failure.
+static int test_self(void)
+{
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    if (touch_pages() < 0) {
+        return -1;
+    }
+    getrusage(RUSAGE_SELF, &after);
+    if ((after.ru_minflt - before.ru_minflt) < PAGES) {
+        printf("Counted %ld minor faults, instead of %d.\n", after.ru_minflt - before.ru_minflt, PAGES);
+        return -1;
+    }
+    if (after.ru_majflt != before.ru_majflt) {
+        printf("Zero-filled pages were counted as major faults.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks that the faults of a child are given to the parent, once it
+/// has waited for it.
+/// @return 0 on success, -1 on failure.
+static int test_children(void)
+{
+    struct rusage before, after, child;
+    int status;
+    getrusage(RUSAGE_CHILDREN, &before);
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit((touch_pages() < 0) ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    if ((wait4(pid, &status, 0, &child) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child failed to touch its pages.\n");
+        return -1;
+    }
+    getrusage(RUSAGE_CHILDREN, &after);
+    if ((child.ru_minflt < PAGES) || ((after.ru_minflt - before.ru_minflt) != child.ru_minflt)) {
+        printf("The child made %ld minor faults, the parent counted %ld.\n", child.ru_minflt,
+               after.ru_minflt - before.ru_minflt);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_self() < 0) || (test_children() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/// @file t_pi_mutex.c
+/// @brief Test the mutexes whose owner inherits the priority of the waiters.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <unistd.h>
+
+/// The number of threads.
+#define NUM_THREADS    4
+/// The number of increments of each thread.
+#define NUM_INCREMENTS 10000
+
+/// The counter incremented by the threads.
+static int counter = 0;
+/// The mutex protecting the counter, with priority inheritance.
+static pthread_mutex_t counter_lock;
+
+/// @brief Increments the counter, holding the lock, yielding the CPU from time to time.
+/// @param arg unused.
+/// @return NULL on success, the thread itself on failure.
+static void *increment(void *arg)
+{
+    for (int i = 0; i < NUM_INCREMENTS; ++i) {
+        if (pthread_mutex_lock(&counter_lock)) {
+            return pthread_self();
+        }
+        // Another thread running in between would lose an increment, the
+        // ones waiting for the lock go through the kernel.
+        int value = counter;
+        if ((i % 100) == 0) {
+            sched_yield();
+        }
+        counter = value + 1;
+        if (pthread_mutex_unlock(&counter_lock)) {
+            return pthread_self();
+        }
+    }
+    return NULL;
+}
+
+/// @brief Tries to take, and to release, the lock held by the first thread.
+/// @param arg unused.
+/// @return NULL if both fail, the thread itself otherwise.
+static void *steal(void *arg)
+{
+    if ((pthread_mutex_trylock(&counter_lock) != EBUSY) || (pthread_mutex_unlock(&counter_lock) != EPERM)) {
+        return pthread_self();
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT) || pthread_mutex_init(&counter_lock, &attr)) {
+        printf("Failed to create a priority-inheritance mutex.\n");
+        return EXIT_FAILURE;
+    }
+    pthread_mutexattr_destroy(&attr);
+    // Only the owner can release the lock.
+    pthread_t thread;
+    void *retval = NULL;
+    pthread_mutex_lock(&counter_lock);
+    if (pthread_create(&thread, NULL, steal, NULL) || pthread_join(thread, &retval) || retval) {
+        printf("Another thread could take, or release, the lock we hold.\n");
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_unlock(&counter_lock);
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        int ret = pthread_create(&threads[i], NULL, increment, NULL);
+        if (ret) {
+            printf("Failed to create thread %d: %s\n", i, strerror(ret));
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        if (pthread_join(threads[i], &retval) || retval) {
+            printf("Thread %d failed to lock, or to unlock, the mutex.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    if (counter != (NUM_THREADS * NUM_INCREMENTS)) {
+        printf("The counter is %d instead of %d.\n", counter, NUM_THREADS * NUM_INCREMENTS);
+        return EXIT_FAILURE;
+    }
+    if (pthread_mutex_destroy(&counter_lock)) {
+        printf("The mutex is still locked.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/// @file t_pipe_readers.c
+/// @brief Test several readers blocked on the same pipe, which are woken up one at a time.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The number of readers.
+#define READERS 4
+/// The number of bytes each reader consumes.
+#define BYTES_PER_READER 64
+
+int main(int argc, char *argv[])
+{
+    int fds[2];
+    char c = 'x';
+
+    if (pipe(fds) < 0) {
+        printf("Failed to create the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Each reader blocks on the empty pipe, until it gets its share of bytes.
+    for (int i = 0; i < READERS; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            printf("Failed to fork: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        if (pid == 0) {
+            close(fds[1]);
+            for (int j = 0; j < BYTES_PER_READER; ++j) {
+                if (read(fds[0], &c, 1) != 1) {
+                    exit(EXIT_FAILURE);
+                }
+            }
+            exit(EXIT_SUCCESS);
+        }
+    }
+    close(fds[0]);
+    // Let the readers block, then feed them one byte at a time: a lost wake-up
+    // leaves one of them blocked forever.
+    timespec_t req = { 0, 100000000 };
+    nanosleep(&req, NULL);
+    for (int i = 0; i < (READERS * BYTES_PER_READER); ++i) {
+        if (write(fds[1], &c, 1) != 1) {
+            printf("Failed to write into the pipe: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+    int status, ret = EXIT_SUCCESS;
+    for (int i = 0; i < READERS; ++i) {
+        if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+            printf("A reader did not get its share of the data.\n");
+            ret = EXIT_FAILURE;
+        }
+    }
+    close(fds[1]);
+    return ret;
+}
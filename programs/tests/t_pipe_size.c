@@ -0,0 +1,87 @@
+/// @file t_pipe_size.c
+/// @brief Test the capacity of pipes, and how it is changed through fcntl.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <unistd.h>
+
+/// The default capacity of a pipe.
+#define DEFAULT_SIZE (64 * 1024)
+
+/// A chunk of data written into the pipe.
+static char chunk[4096];
+
+int main(int argc, char *argv[])
+{
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        printf("Failed to create the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (fcntl(fds[1], F_GETPIPE_SZ, 0) != DEFAULT_SIZE) {
+        printf("The pipe does not have the default capacity.\n");
+        return EXIT_FAILURE;
+    }
+    // Fill the pipe without blocking, it must hold exactly its capacity.
+    if (fcntl(fds[1], F_SETFL, O_NONBLOCK) < 0) {
+        printf("Failed to set the pipe to non-blocking mode: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memset(chunk, 'x', sizeof(chunk));
+    ssize_t total = 0, ret;
+    while ((ret = write(fds[1], chunk, sizeof(chunk))) > 0) {
+        total += ret;
+    }
+    if ((total != DEFAULT_SIZE) || (errno != EAGAIN)) {
+        printf("The pipe held %d bytes instead of %d.\n", total, DEFAULT_SIZE);
+        return EXIT_FAILURE;
+    }
+    // The data does not fit inside a smaller pipe.
+    if ((fcntl(fds[1], F_SETPIPE_SZ, 4096) >= 0) || (errno != EBUSY)) {
+        printf("Shrinking a full pipe did not fail with EBUSY.\n");
+        return EXIT_FAILURE;
+    }
+    // Growing the pipe keeps its data, and makes room for more.
+    if (fcntl(fds[1], F_SETPIPE_SZ, 2 * DEFAULT_SIZE) != 2 * DEFAULT_SIZE) {
+        printf("Failed to grow the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (write(fds[1], "y", 1) != 1) {
+        printf("Failed to write into the grown pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    total = 0;
+    while (total < DEFAULT_SIZE) {
+        ret = read(fds[0], chunk, sizeof(chunk));
+        if (ret <= 0) {
+            printf("Failed to read the pipe back: %s\n", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        for (ssize_t i = 0; i < ret; ++i) {
+            if (chunk[i] != 'x') {
+                printf("The pipe returned corrupted data.\n");
+                return EXIT_FAILURE;
+            }
+        }
+        total += ret;
+    }
+    if ((read(fds[0], chunk, sizeof(chunk)) != 1) || (chunk[0] != 'y')) {
+        printf("The data written after growing the pipe is missing.\n");
+        return EXIT_FAILURE;
+    }
+    // Once empty, the pipe can shrink, rounded up to a whole page.
+    if (fcntl(fds[1], F_SETPIPE_SZ, 100) != 4096) {
+        printf("Failed to shrink the empty pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return EXIT_SUCCESS;
+}
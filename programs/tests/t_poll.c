@@ -0,0 +1,85 @@
+/// @file t_poll.c
+/// @brief Test poll, select and epoll on pipes.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/poll.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    int fds[2];
+    struct pollfd pfd;
+    char c;
+
+    if (pipe(fds) < 0) {
+        printf("Failed to create the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Nothing to read yet, and the timeout must expire.
+    pfd.fd     = fds[0];
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) != 0) {
+        printf("poll reported an empty pipe as readable.\n");
+        return EXIT_FAILURE;
+    }
+    if (poll(&pfd, 1, 100) != 0) {
+        printf("poll did not time out on an empty pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // The write end is writable.
+    fd_set wset;
+    FD_ZERO(&wset);
+    FD_SET(fds[1], &wset);
+    struct timeval tv = { 0, 0 };
+    if ((select(fds[1] + 1, NULL, &wset, NULL, &tv) != 1) || !FD_ISSET(fds[1], &wset)) {
+        printf("select did not report the write end as writable.\n");
+        return EXIT_FAILURE;
+    }
+    // Wake up a sleeping poll from another process.
+    pid_t pid = fork();
+    if (pid == 0) {
+        sleep(1);
+        write(fds[1], "x", 1);
+        exit(0);
+    }
+    if ((poll(&pfd, 1, -1) != 1) || !(pfd.revents & POLLIN)) {
+        printf("poll did not report the pipe as readable.\n");
+        return EXIT_FAILURE;
+    }
+    // The same readiness must be reported through an epoll instance.
+    int epfd = epoll_create(1);
+    if (epfd < 0) {
+        printf("Failed to create the epoll instance: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fds[0] };
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event) < 0) {
+        printf("Failed to add the pipe to the epoll instance: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memset(&event, 0, sizeof(event));
+    if ((epoll_wait(epfd, &event, 1, 1000) != 1) || (event.data.fd != fds[0]) || !(event.events & EPOLLIN)) {
+        printf("epoll_wait did not report the pipe as readable.\n");
+        return EXIT_FAILURE;
+    }
+    // Once the data has been consumed, nothing is ready anymore.
+    read(fds[0], &c, 1);
+    if (epoll_wait(epfd, &event, 1, 0) != 0) {
+        printf("epoll_wait reported an empty pipe as readable.\n");
+        return EXIT_FAILURE;
+    }
+    wait(NULL);
+    close(epfd);
+    close(fds[0]);
+    close(fds[1]);
+    return EXIT_SUCCESS;
+}
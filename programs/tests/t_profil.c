@@ -0,0 +1,92 @@
+/// @file t_profil.c
+/// @brief Test the timers measuring the CPU time (ITIMER_VIRTUAL, ITIMER_PROF),
+///        and the CPU times returned by times() and getrusage().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/times.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The number of expirations we wait for, from each timer.
+#define EXPIRATIONS 10
+
+/// How many times SIGVTALRM has been received.
+static volatile int virt_count = 0;
+/// How many times SIGPROF has been received.
+static volatile int prof_count = 0;
+
+/// @brief Counts the expirations of the timers.
+/// @param signum the signal.
+static void handler(int signum)
+{
+    if (signum == SIGVTALRM) {
+        ++virt_count;
+    } else if (signum == SIGPROF) {
+        ++prof_count;
+    }
+}
+
+/// @brief Starts a periodic timer, expiring every 10 ms of CPU time.
+/// @param which the timer.
+/// @return 0 on success, -1 on failure.
+static int start_timer(int which)
+{
+    struct itimerval timer;
+    timer.it_value.tv_sec     = 0;
+    timer.it_value.tv_usec    = 10000;
+    timer.it_interval.tv_sec  = 0;
+    timer.it_interval.tv_usec = 10000;
+    if (setitimer(which, &timer, NULL) == -1) {
+        printf("Failed to start the timer %d: %s\n", which, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    signal(SIGVTALRM, handler);
+    signal(SIGPROF, handler);
+    if (start_timer(ITIMER_VIRTUAL) || start_timer(ITIMER_PROF)) {
+        return EXIT_FAILURE;
+    }
+    // Spin, the timers only run while we use the CPU. Give up after 10 seconds.
+    struct tms start, end;
+    clock_t started = times(&start);
+    while ((virt_count < EXPIRATIONS) || (prof_count < EXPIRATIONS)) {
+        if ((times(NULL) - started) > (10 * CLK_TCK)) {
+            printf("The timers expired %d and %d times, in 10 seconds.\n", virt_count, prof_count);
+            return EXIT_FAILURE;
+        }
+    }
+    // Stop the timers.
+    struct itimerval stop;
+    memset(&stop, 0, sizeof(stop));
+    setitimer(ITIMER_VIRTUAL, &stop, NULL);
+    setitimer(ITIMER_PROF, &stop, NULL);
+    // The spinning is accounted as user time.
+    times(&end);
+    if (end.tms_utime <= start.tms_utime) {
+        printf("The user time did not grow: %ld, then %ld.\n", start.tms_utime, end.tms_utime);
+        return EXIT_FAILURE;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0) {
+        printf("Failed to get the resources used: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // At least 10 ms of user time elapsed for each expiration.
+    long usec = (usage.ru_utime.tv_sec * 1000000L) + usage.ru_utime.tv_usec;
+    if (usec < ((EXPIRATIONS - 1) * 10000L)) {
+        printf("Only %ld us of user time, after %d expirations.\n", usec, virt_count);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/// @file t_pthread.c
+/// @brief Test threads sharing memory, file descriptors and thread-local storage.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <unistd.h>
+
+/// The number of threads.
+#define NUM_THREADS 4
+/// The number of increments of each thread.
+#define NUM_INCREMENTS 10000
+
+/// The counter incremented by the threads.
+static int counter = 0;
+/// The mutex protecting the counter.
+static pthread_mutex_t counter_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief Increments the counter, holding the lock, yielding the CPU from time to time.
+/// @param arg unused.
+/// @return the thread itself, as seen through its thread-local storage.
+static void *increment(void *arg)
+{
+    for (int i = 0; i < NUM_INCREMENTS; ++i) {
+        pthread_mutex_lock(&counter_lock);
+        // Another thread running in between would lose an increment.
+        int value = counter;
+        if ((i % 1000) == 0) {
+            sched_yield();
+        }
+        counter = value + 1;
+        pthread_mutex_unlock(&counter_lock);
+    }
+    // The threads belong to the process which created them, with their own id.
+    return (getpid() != gettid()) ? pthread_self() : NULL;
+}
+
+/// @brief Opens a file descriptor, which the creating thread then closes.
+/// @param arg where the file descriptor is stored.
+/// @return NULL.
+static void *open_file(void *arg)
+{
+    *(int *)arg = open("/proc/video", O_WRONLY, 0);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t threads[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        int ret = pthread_create(&threads[i], NULL, increment, NULL);
+        if (ret) {
+            printf("Failed to create thread %d: %s\n", i, strerror(ret));
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        void *retval     = NULL;
+        pthread_t thread = threads[i];
+        if (pthread_join(thread, &retval)) {
+            printf("Failed to join thread %d.\n", i);
+            return EXIT_FAILURE;
+        }
+        // Each thread has its own thread-local storage, and its own id.
+        if (retval != thread) {
+            printf("Thread %d did not find itself inside its thread-local storage.\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    if (counter != (NUM_THREADS * NUM_INCREMENTS)) {
+        printf("The counter is %d instead of %d.\n", counter, NUM_THREADS * NUM_INCREMENTS);
+        return EXIT_FAILURE;
+    }
+    // The threads share the file descriptors.
+    int fd = -1;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, open_file, &fd) || pthread_join(thread, NULL)) {
+        printf("Failed to run the thread opening a file.\n");
+        return EXIT_FAILURE;
+    }
+    if ((fd < 0) || (close(fd) < 0)) {
+        printf("The file opened by the thread is not open: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
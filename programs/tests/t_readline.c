@@ -0,0 +1,92 @@
+/// @file t_readline.c
+/// @brief Test the reading of lines from a pipe, which cannot be sought, with
+/// readline(), and from a file with getline().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <readline.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <unistd.h>
+
+/// The lines which are written, the last one without newline.
+static const char *lines[] = {"first", "", "third line", "last"};
+
+/// @brief Reads the lines back from a pipe.
+/// @return 0 on success, -1 on failure.
+static int test_pipe(void)
+{
+    char buffer[64];
+    ssize_t length;
+    int fds[2];
+    if (pipe(fds) < 0) {
+        printf("Failed to create the pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    const char *content = "first\n\nthird line\nlast";
+    write(fds[1], content, strlen(content));
+    close(fds[1]);
+    int ret = 0;
+    for (int i = 0; (ret == 0) && (i < 4); ++i) {
+        int expected = (i < 3) ? 1 : -1;
+        if ((readline(fds[0], buffer, sizeof(buffer), &length) != expected) || strcmp(buffer, lines[i]) ||
+            (length != (ssize_t)strlen(lines[i]))) {
+            printf("Read `%s` instead of `%s`.\n", buffer, lines[i]);
+            ret = -1;
+        }
+    }
+    if ((ret == 0) && (readline(fds[0], buffer, sizeof(buffer), &length) != 0)) {
+        printf("Did not read the end of the pipe.\n");
+        ret = -1;
+    }
+    close(fds[0]);
+    return ret;
+}
+
+/// @brief Reads the lines back from a file, with getline().
+/// @return 0 on success, -1 on failure.
+static int test_getline(void)
+{
+    const char *path = "/home/user/t_readline.txt";
+    FILE *file       = fopen(path, "w");
+    if (!file) {
+        printf("Failed to create `%s`: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fputs("first\n\nthird line\nlast", file);
+    fclose(file);
+    if (!(file = fopen(path, "r"))) {
+        printf("Failed to open `%s`: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char *line  = NULL;
+    size_t size = 0;
+    int ret     = 0;
+    for (int i = 0; (ret == 0) && (i < 4); ++i) {
+        ssize_t length  = getline(&line, &size, file);
+        size_t expected = strlen(lines[i]) + ((i < 3) ? 1 : 0);
+        if ((length != (ssize_t)expected) || strncmp(line, lines[i], strlen(lines[i]))) {
+            printf("Read `%s` instead of `%s`.\n", line, lines[i]);
+            ret = -1;
+        }
+    }
+    if ((ret == 0) && (getline(&line, &size, file) != -1)) {
+        printf("Did not read the end of the file.\n");
+        ret = -1;
+    }
+    free(line);
+    fclose(file);
+    unlink(path);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_pipe() < 0) || (test_getline() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/// @file t_rlimit.c
+/// @brief Test the limits of the resources set through setrlimit().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// @brief Checks that the file descriptors stop at RLIMIT_NOFILE.
+/// @return 0 on success, -1 on failure.
+static int test_nofile(void)
+{
+    struct rlimit old, limit;
+    if (getrlimit(RLIMIT_NOFILE, &old) < 0) {
+        printf("Failed to get RLIMIT_NOFILE: %s\n", strerror(errno));
+        return -1;
+    }
+    // The standard streams are open, only fds 3 and 4 are left.
+    limit.rlim_cur = 5;
+    limit.rlim_max = old.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) < 0) {
+        printf("Failed to set RLIMIT_NOFILE: %s\n", strerror(errno));
+        return -1;
+    }
+    int fds[3], opened = 0;
+    for (; opened < 3; ++opened) {
+        if ((fds[opened] = open("/proc/video", O_WRONLY, 0)) < 0) {
+            break;
+        }
+    }
+    int error = errno;
+    for (int i = 0; i < opened; ++i) {
+        close(fds[i]);
+    }
+    setrlimit(RLIMIT_NOFILE, &old);
+    if ((opened != 2) || (error != EMFILE)) {
+        printf("Opened %d files before failing with `%s`.\n", opened, strerror(error));
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks that the address space cannot grow beyond RLIMIT_AS.
+/// @return 0 on success, -1 on failure.
+static int test_as(void)
+{
+    struct rlimit old, limit;
+    getrlimit(RLIMIT_AS, &old);
+    limit.rlim_cur = 256 * 1024 * 1024;
+    limit.rlim_max = old.rlim_max;
+    if (setrlimit(RLIMIT_AS, &limit) < 0) {
+        printf("Failed to set RLIMIT_AS: %s\n", strerror(errno));
+        return -1;
+    }
+    void *area = mmap(NULL, 512 * 1024 * 1024, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    setrlimit(RLIMIT_AS, &old);
+    if (area != MAP_FAILED) {
+        printf("Mapped an area larger than the address space limit.\n");
+        munmap(area, 512 * 1024 * 1024);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks that a process spinning past its RLIMIT_CPU gets SIGXCPU.
+/// @return 0 on success, -1 on failure.
+static int test_cpu(void)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        struct rlimit limit = { 1, 3 };
+        if (setrlimit(RLIMIT_CPU, &limit) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        while (1) {
+        }
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid) {
+        printf("Failed to wait for the child: %s\n", strerror(errno));
+        return -1;
+    }
+    if (!WIFSIGNALED(status) || (WTERMSIG(status) != SIGXCPU)) {
+        printf("The child terminated with status %d instead of SIGXCPU.\n", status);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    // The soft limit cannot exceed the hard one.
+    struct rlimit limit = { 2, 1 };
+    if ((setrlimit(RLIMIT_CPU, &limit) != -1) || (errno != EINVAL)) {
+        printf("Set a soft limit above the hard one.\n");
+        return EXIT_FAILURE;
+    }
+    if (test_nofile() || test_as() || test_cpu()) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/// @file t_schedstat.c
+/// @brief Test the scheduling statistics of `/proc/<pid>/schedstat`.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The number of buckets of the histogram of the wake-up latencies.
+#define LATENCY_BUCKETS 8
+
+/// @brief The statistics of the scheduling of a process.
+typedef struct schedstat {
+    unsigned long cpu_time;                        ///< Time spent running.
+    unsigned long run_delay;                       ///< Time spent waiting to run.
+    unsigned long pcount;                          ///< Times the process ran.
+    unsigned long nvcsw;                           ///< Voluntary context switches.
+    unsigned long nivcsw;                          ///< Involuntary context switches.
+    unsigned long wakeup_latency[LATENCY_BUCKETS]; ///< Histogram of the wake-up latencies.
+    unsigned long wakeup_max;                      ///< Longest wake-up latency, in microseconds.
+} schedstat_t;
+
+/// @brief Reads the scheduling statistics of the calling process.
+/// @param stats where the statistics are stored.
+/// @return 0 on success, -1 on failure.
+static int read_schedstat(schedstat_t *stats)
+{
+    char path[64], buffer[256];
+    sprintf(path, "/proc/%d/schedstat", getpid());
+    int fd = open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open `%s`: %s\n", path, strerror(errno));
+        return -1;
+    }
+    memset(buffer, 0, sizeof(buffer));
+    ssize_t bytes = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (bytes <= 0) {
+        printf("Failed to read `%s`: %s\n", path, strerror(errno));
+        return -1;
+    }
+    unsigned long *h = stats->wakeup_latency;
+    int fields       = sscanf(
+        buffer, "%lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu", &stats->cpu_time, &stats->run_delay,
+        &stats->pcount, &stats->nvcsw, &stats->nivcsw, &h[0], &h[1], &h[2], &h[3], &h[4], &h[5], &h[6], &h[7],
+        &stats->wakeup_max);
+    if (fields != 6 + LATENCY_BUCKETS) {
+        printf("Malformed statistics: `%s`\n", buffer);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Sums the wake-ups counted by the histogram.
+/// @param stats the statistics.
+/// @return the number of wake-ups.
+static unsigned long count_wakeups(const schedstat_t *stats)
+{
+    unsigned long wakeups = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        wakeups += stats->wakeup_latency[i];
+    }
+    return wakeups;
+}
+
+int main(int argc, char *argv[])
+{
+    schedstat_t before, after;
+    if (read_schedstat(&before) < 0) {
+        return EXIT_FAILURE;
+    }
+    // Sleeping gives up the CPU, and waking up puts us back inside the queue.
+    struct timespec req = { 0, 50000000 };
+    for (int i = 0; i < 4; ++i) {
+        nanosleep(&req, NULL);
+    }
+    if (read_schedstat(&after) < 0) {
+        return EXIT_FAILURE;
+    }
+    if (after.nvcsw < before.nvcsw + 4) {
+        printf("Voluntary context switches: %lu before, %lu after sleeping.\n", before.nvcsw, after.nvcsw);
+        return EXIT_FAILURE;
+    }
+    if (after.pcount < before.pcount + 4) {
+        printf("Times scheduled: %lu before, %lu after sleeping.\n", before.pcount, after.pcount);
+        return EXIT_FAILURE;
+    }
+    if (count_wakeups(&after) < count_wakeups(&before) + 4) {
+        printf("Wake-ups: %lu before, %lu after sleeping.\n", count_wakeups(&before), count_wakeups(&after));
+        return EXIT_FAILURE;
+    }
+    // The worst latency only grows.
+    if (after.wakeup_max < before.wakeup_max) {
+        printf("Longest wake-up latency: %lu us before, %lu us after.\n", before.wakeup_max, after.wakeup_max);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/// @file t_semtimedop.c
+/// @brief Test the atomic operations of semop(), and the timeout of semtimedop().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Checks the values of the two semaphores of the set.
+/// @param semid the semaphore set.
+/// @param first the expected value of the first semaphore.
+/// @param second the expected value of the second semaphore.
+/// @return 0 if they match, -1 otherwise.
+static int check_values(int semid, int first, int second)
+{
+    int values[2] = { semctl(semid, 0, GETVAL, NULL), semctl(semid, 1, GETVAL, NULL) };
+    if ((values[0] != first) || (values[1] != second)) {
+        printf("The values are {%d, %d} instead of {%d, %d}.\n", values[0], values[1], first, second);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Takes two semaphores at once, with and without waiting.
+/// @param semid the semaphore set, with two semaphores.
+/// @return 0 on success, -1 on failure.
+static int test_take_both(int semid)
+{
+    // Both semaphores are taken at once.
+    struct sembuf take[2]    = { { 0, -1, 0 }, { 1, -1, 0 } };
+    struct sembuf give       = { 1, 1, 0 };
+    struct timespec timeout  = { 0, 50000000 };
+    unsigned short values[2] = { 1, 0 };
+    struct timespec start, end;
+    union semun arg;
+    int status;
+
+    arg.array = values;
+    if (semctl(semid, 0, SETALL, &arg) < 0) {
+        printf("Failed to set the values: %s\n", strerror(errno));
+        return -1;
+    }
+    // The second operation would block, so the first one is not applied either.
+    take[0].sem_flg = take[1].sem_flg = IPC_NOWAIT;
+    if ((semop(semid, take, 2) != -1) || (errno != EAGAIN) || (check_values(semid, 1, 0) < 0)) {
+        printf("The operations were not applied atomically.\n");
+        return -1;
+    }
+    take[0].sem_flg = take[1].sem_flg = 0;
+    // Waiting gives up once the time has expired.
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if ((semtimedop(semid, take, 2, &timeout) != -1) || (errno != EAGAIN)) {
+        printf("The timeout did not expire: %s\n", strerror(errno));
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long elapsed = ((end.tv_sec - start.tv_sec) * 1000L) + ((end.tv_nsec - start.tv_nsec) / 1000000L);
+    if ((elapsed < 40) || (check_values(semid, 1, 0) < 0)) {
+        printf("The timeout expired after %ld ms.\n", elapsed);
+        return -1;
+    }
+    // The child sleeps until both semaphores can be taken.
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit((semop(semid, take, 2) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    nanosleep(&timeout, NULL);
+    if (check_values(semid, 1, 0) < 0) {
+        return -1;
+    }
+    if (semop(semid, &give, 1) < 0) {
+        printf("Failed to give the semaphore: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child failed to take both semaphores.\n");
+        return -1;
+    }
+    return check_values(semid, 0, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int semid = semget(IPC_PRIVATE, 2, IPC_CREAT | S_IRUSR | S_IWUSR);
+    if (semid < 0) {
+        printf("Failed to create the semaphore set: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = test_take_both(semid);
+    semctl(semid, 0, IPC_RMID, NULL);
+    return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/// @file t_serial.c
+/// @brief Test the first serial port, exposed as `/dev/ttyS0`, which is a
+/// terminal always ready to be written.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+/// @brief Checks the serial port, once opened.
+/// @param fd the serial port.
+/// @return 0 on success, -1 on failure.
+static int test_serial(int fd)
+{
+    const char *message = "t_serial: hello from /dev/ttyS0\n";
+    struct stat st;
+    termios_t tio;
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    if ((fstat(fd, &st) < 0) || !S_ISCHR(st.st_mode)) {
+        printf("The serial port is not a character device.\n");
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) < 0) {
+        printf("Failed to get the settings of the serial port: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((poll(&pfd, 1, 1000) != 1) || !(pfd.revents & POLLOUT)) {
+        printf("The serial port is not writable.\n");
+        return -1;
+    }
+    if (write(fd, message, strlen(message)) != (ssize_t)strlen(message)) {
+        printf("Failed to write the serial port: %s\n", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = open("/dev/ttyS0", O_RDWR, 0);
+    if (fd < 0) {
+        printf("Failed to open `/dev/ttyS0`: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = test_serial(fd);
+    close(fd);
+    return (ret < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+/// @file t_setscheduler.c
+/// @brief Tests changing the scheduling policy of a process at runtime.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    sched_param_t param;
+    int status;
+
+    if (sched_getscheduler(0) != SCHED_OTHER) {
+        fprintf(stderr, "A new process should have the default policy.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Real-time policies take the priorities below 100.
+    param.sched_priority = 120;
+    if ((sched_setscheduler(0, SCHED_FIFO, &param) != -1) || (errno != EINVAL)) {
+        fprintf(stderr, "SCHED_FIFO should not accept priority %d.\n", param.sched_priority);
+        return EXIT_FAILURE;
+    }
+    param.sched_priority = 50;
+    if (sched_setscheduler(0, SCHED_RR, &param) == -1) {
+        fprintf(stderr, "Failed to set SCHED_RR: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (sched_getscheduler(0) != SCHED_RR) {
+        fprintf(stderr, "The policy should be SCHED_RR.\n");
+        return EXIT_FAILURE;
+    }
+
+    // The child starts with the default policy, and runs while we wait.
+    pid_t cpid = fork();
+    if (cpid == 0) {
+        return (sched_getscheduler(0) == SCHED_OTHER) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if ((cpid < 0) || (waitpid(cpid, &status, 0) != cpid) || !WIFEXITED(status) ||
+        (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        fprintf(stderr, "The child did not start with the default policy.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Go back to the default policy.
+    param.sched_priority = 120;
+    if (sched_setscheduler(0, SCHED_OTHER, &param) == -1) {
+        fprintf(stderr, "Failed to set SCHED_OTHER: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (sched_getscheduler(0) != SCHED_OTHER) {
+        fprintf(stderr, "The policy should be SCHED_OTHER.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/// @file t_shmfork.c
+/// @brief Test a large shared memory, whose pages are allocated when touched,
+/// inherited by fork(), and kept alive by its attachments once removed.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of the shared memory, of which only a few pages are touched.
+#define SHM_SIZE  (1024 * 1024)
+/// The index of the last word of the shared memory.
+#define LAST_WORD ((SHM_SIZE / sizeof(int)) - 1)
+
+/// @brief Writes the first and the last word of the shared memory inside a
+/// child, through the attachment inherited from the parent.
+/// @param memory the shared memory.
+/// @return 0 on success, -1 on failure.
+static int test_fork(int *memory)
+{
+    int status;
+    pid_t pid = fork();
+    if (pid == 0) {
+        // The pages not touched yet read as zero.
+        if (memory[0] || memory[LAST_WORD]) {
+            exit(EXIT_FAILURE);
+        }
+        memory[0]         = 42;
+        memory[LAST_WORD] = 43;
+        exit(EXIT_SUCCESS);
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child failed to write the shared memory.\n");
+        return -1;
+    }
+    if ((memory[0] != 42) || (memory[LAST_WORD] != 43)) {
+        printf("The parent does not see the writes of the child: %d, %d.\n", memory[0], memory[LAST_WORD]);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Removes the shared memory while it is attached.
+/// @param shmid the shared memory.
+/// @param memory the shared memory, attached.
+/// @return 0 on success, -1 on failure.
+static int test_remove(int shmid, int *memory)
+{
+    if (shmctl(shmid, IPC_RMID, NULL) < 0) {
+        printf("Failed to remove the shared memory: %s\n", strerror(errno));
+        return -1;
+    }
+    // The attachment keeps the memory, which cannot be attached anymore.
+    memory[1] = 44;
+    if ((memory[0] != 42) || (memory[1] != 44)) {
+        printf("The shared memory changed once removed.\n");
+        return -1;
+    }
+    if (shmat(shmid, NULL, 0) != (void *)-1) {
+        printf("The removed shared memory can still be attached.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int shmid = shmget(IPC_PRIVATE, SHM_SIZE, IPC_CREAT | 0600);
+    if (shmid < 0) {
+        printf("Failed to create the shared memory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int *memory = (int *)shmat(shmid, NULL, 0);
+    if (memory == (int *)-1) {
+        printf("Failed to attach the shared memory: %s\n", strerror(errno));
+        shmctl(shmid, IPC_RMID, NULL);
+        return EXIT_FAILURE;
+    }
+    if ((test_fork(memory) < 0) || (test_remove(shmid, memory) < 0)) {
+        shmdt(memory);
+        shmctl(shmid, IPC_RMID, NULL);
+        return EXIT_FAILURE;
+    }
+    if (shmdt(memory) < 0) {
+        printf("Failed to detach the shared memory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/// @file t_shmopen.c
+/// @brief Test the shared memory objects of shm_open(), and the files of the
+/// memory filesystem, whose pages are shared by the mappings and by read()
+/// and write().
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The size of a page.
+#define PAGE     4096
+/// The size of the shared memory object.
+#define SHM_SIZE (3 * PAGE)
+/// The name of the shared memory object.
+#define SHM_NAME "/t_shmopen"
+
+/// @brief Writes the shared memory inside a child, through its own mapping.
+/// @param memory the mapping of the parent, inherited by the child.
+/// @return 0 on success, -1 on failure.
+static int test_fork(char *memory)
+{
+    int status;
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = shm_open(SHM_NAME, O_RDWR, 0);
+        if (fd < 0) {
+            exit(EXIT_FAILURE);
+        }
+        char *other = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (other == MAP_FAILED) {
+            exit(EXIT_FAILURE);
+        }
+        other[0]             = 'a';
+        memory[SHM_SIZE - 1] = 'b';
+        exit(EXIT_SUCCESS);
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child failed to write the shared memory.\n");
+        return -1;
+    }
+    if ((memory[0] != 'a') || (memory[SHM_SIZE - 1] != 'b')) {
+        printf("The parent does not see the writes of the child.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks that read() and write() see the same pages as the mapping.
+/// @param fd the shared memory object.
+/// @param memory the mapping.
+/// @return 0 on success, -1 on failure.
+static int test_read_write(int fd, char *memory)
+{
+    char buffer[2];
+    if ((pread(fd, buffer, 1, 0) != 1) || (buffer[0] != 'a')) {
+        printf("The file does not see the writes of the mapping.\n");
+        return -1;
+    }
+    if ((pwrite(fd, "c", 1, PAGE) != 1) || (memory[PAGE] != 'c')) {
+        printf("The mapping does not see the writes of the file.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Removes the shared memory object while it is mapped.
+/// @param memory the mapping.
+/// @return 0 on success, -1 on failure.
+static int test_unlink(char *memory)
+{
+    if (shm_unlink(SHM_NAME) < 0) {
+        printf("Failed to remove the shared memory: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((shm_open(SHM_NAME, O_RDWR, 0) >= 0) || (errno != ENOENT)) {
+        printf("The removed shared memory can still be opened.\n");
+        return -1;
+    }
+    memory[1] = 'd';
+    if ((memory[0] != 'a') || (memory[1] != 'd')) {
+        printf("The shared memory changed once removed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Writes, truncates and reads back a scratch file inside /tmp.
+/// @return 0 on success, -1 on failure.
+static int test_tmp(void)
+{
+    char buffer[8] = {0};
+    struct stat st;
+    int fd = open("/tmp/t_shmopen", O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        printf("Failed to create the scratch file: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    // The hole before the data reads as zero.
+    if ((pwrite(fd, "hello", 5, 2 * PAGE) != 5) || (pread(fd, buffer, 4, PAGE) != 4) || buffer[0]) {
+        printf("Failed to write the scratch file.\n");
+        ret = -1;
+    } else if ((ftruncate(fd, 2 * PAGE + 2) < 0) || (fstat(fd, &st) < 0) || (st.st_size != 2 * PAGE + 2)) {
+        printf("Failed to truncate the scratch file: %s\n", strerror(errno));
+        ret = -1;
+    } else if ((pread(fd, buffer, sizeof(buffer), 2 * PAGE) != 2) || strncmp(buffer, "he", 2)) {
+        printf("The truncated scratch file reads wrong.\n");
+        ret = -1;
+    }
+    close(fd);
+    unlink("/tmp/t_shmopen");
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = shm_open(SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        printf("Failed to create the shared memory: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (ftruncate(fd, SHM_SIZE) < 0) {
+        printf("Failed to size the shared memory: %s\n", strerror(errno));
+        shm_unlink(SHM_NAME);
+        return EXIT_FAILURE;
+    }
+    char *memory = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        printf("Failed to map the shared memory: %s\n", strerror(errno));
+        shm_unlink(SHM_NAME);
+        return EXIT_FAILURE;
+    }
+    if ((test_fork(memory) < 0) || (test_read_write(fd, memory) < 0) || (test_unlink(memory) < 0)) {
+        shm_unlink(SHM_NAME);
+        return EXIT_FAILURE;
+    }
+    munmap(memory, SHM_SIZE);
+    close(fd);
+    return (test_tmp() < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
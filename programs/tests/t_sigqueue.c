@@ -0,0 +1,139 @@
+/// @file t_sigqueue.c
+/// @brief Test the queueing of real-time signals, along with their values, and
+/// the limit of the signals queued to a process.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The number of signals queued by the child.
+#define CHILD_SIGNALS 12
+/// The limit of the signals queued to the process, while testing it.
+#define QUEUE_LIMIT   4
+
+/// @brief Takes a pending signal, without waiting.
+/// @param set the blocked signals.
+/// @param sig the expected signal.
+/// @param value the expected value.
+/// @return 0 on success, -1 on failure.
+static int take(sigset_t *set, int sig, int value)
+{
+    struct timespec timeout = {0, 0};
+    siginfo_t info;
+    int ret = sigtimedwait(set, &info, &timeout);
+    if ((ret != sig) || (info.si_code != SI_QUEUE) || (info.si_value.sival_int != value)) {
+        printf("Took the signal %d with value %d, instead of %d with %d.\n", ret, info.si_value.sival_int, sig, value);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Queues several occurrences of two signals, which are taken lowest
+/// signal first, and in the order they were sent.
+/// @param set the blocked signals.
+/// @return 0 on success, -1 on failure.
+static int test_order(sigset_t *set)
+{
+    for (int i = 0; i < 3; ++i) {
+        if ((sigqueue(getpid(), SIGRTMIN + 1, (union sigval){.sival_int = 10 + i}) < 0) ||
+            (sigqueue(getpid(), SIGRTMIN, (union sigval){.sival_int = i}) < 0)) {
+            printf("Failed to queue the signals: %s\n", strerror(errno));
+            return -1;
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (take(set, SIGRTMIN, i) < 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (take(set, SIGRTMIN + 1, 10 + i) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Receives the signals queued by a child, none of which is lost.
+/// @param set the blocked signals.
+/// @return 0 on success, -1 on failure.
+static int test_child(sigset_t *set)
+{
+    siginfo_t info;
+    int status;
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < CHILD_SIGNALS; ++i) {
+            if (sigqueue(getppid(), SIGRTMIN, (union sigval){.sival_int = i}) < 0) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        exit(EXIT_SUCCESS);
+    }
+    for (int i = 0; i < CHILD_SIGNALS; ++i) {
+        if ((sigwaitinfo(set, &info) != SIGRTMIN) || (info.si_pid != pid) || (info.si_value.sival_int != i)) {
+            printf("Failed to receive the signal %d of the child.\n", i);
+            return -1;
+        }
+    }
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child failed to queue the signals.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Queues signals until the limit is reached.
+/// @param set the blocked signals.
+/// @return 0 on success, -1 on failure.
+static int test_limit(sigset_t *set)
+{
+    struct rlimit old, limit;
+    getrlimit(RLIMIT_SIGPENDING, &old);
+    limit.rlim_cur = QUEUE_LIMIT;
+    limit.rlim_max = old.rlim_max;
+    if (setrlimit(RLIMIT_SIGPENDING, &limit) < 0) {
+        printf("Failed to set RLIMIT_SIGPENDING: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    for (int i = 0; i < QUEUE_LIMIT; ++i) {
+        if (sigqueue(getpid(), SIGRTMIN, (union sigval){.sival_int = i}) < 0) {
+            printf("Failed to queue the signal %d: %s\n", i, strerror(errno));
+            ret = -1;
+        }
+    }
+    if ((sigqueue(getpid(), SIGRTMIN, (union sigval){.sival_int = QUEUE_LIMIT}) >= 0) || (errno != EAGAIN)) {
+        printf("Queueing beyond the limit did not fail with EAGAIN.\n");
+        ret = -1;
+    }
+    for (int i = 0; (ret == 0) && (i < QUEUE_LIMIT); ++i) {
+        ret = take(set, SIGRTMIN, i);
+    }
+    setrlimit(RLIMIT_SIGPENDING, &old);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGRTMIN);
+    sigaddset(&set, SIGRTMIN + 1);
+    if (sigprocmask(SIG_BLOCK, &set, NULL) < 0) {
+        printf("Failed to block the signals: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((test_order(&set) < 0) || (test_child(&set) < 0) || (test_limit(&set) < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
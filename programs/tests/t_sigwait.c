@@ -0,0 +1,97 @@
+/// @file t_sigwait.c
+/// @brief Test the synchronous reception of blocked signals, through
+/// sigtimedwait() and through a signalfd, without running their handlers.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/poll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Takes the signals with sigtimedwait(): a signal which is already
+/// pending, the SIGCHLD of a child, and a timeout.
+/// @param set the blocked signals.
+/// @return 0 on success, -1 on failure.
+static int test_sigtimedwait(sigset_t *set)
+{
+    struct timespec timeout = {0, 0};
+    siginfo_t info;
+    kill(getpid(), SIGUSR1);
+    if ((sigtimedwait(set, &info, &timeout) != SIGUSR1) || (info.si_pid != getpid())) {
+        printf("Failed to take the pending signal: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((sigtimedwait(set, &info, &timeout) >= 0) || (errno != EAGAIN)) {
+        printf("Taking a signal which is not pending did not fail with EAGAIN.\n");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit(EXIT_SUCCESS);
+    }
+    // The child might have exited already, or not.
+    if ((sigwaitinfo(set, &info) != SIGCHLD) || (info.si_pid != pid)) {
+        printf("Failed to wait for the child: %s\n", strerror(errno));
+        return -1;
+    }
+    waitpid(pid, NULL, 0);
+    return 0;
+}
+
+/// @brief Reads the signals from a signalfd, after polling it.
+/// @param set the blocked signals.
+/// @return 0 on success, -1 on failure.
+static int test_signalfd(sigset_t *set)
+{
+    signalfd_siginfo_t ssi[4];
+    int fd = signalfd(-1, set, SFD_NONBLOCK);
+    if (fd < 0) {
+        printf("Failed to create the signalfd: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    // A signal sent twice while pending is taken once.
+    kill(getpid(), SIGUSR2);
+    kill(getpid(), SIGUSR2);
+    kill(getpid(), SIGUSR1);
+    if ((poll(&pfd, 1, 1000) != 1) || !(pfd.revents & POLLIN)) {
+        printf("The signalfd is not readable.\n");
+        ret = -1;
+    } else if (read(fd, ssi, sizeof(ssi)) != 2 * sizeof(signalfd_siginfo_t)) {
+        printf("Failed to read the signals from the signalfd.\n");
+        ret = -1;
+    } else if ((ssi[0].ssi_signo != SIGUSR1) || (ssi[1].ssi_signo != SIGUSR2)) {
+        printf("Read the signals %u and %u.\n", ssi[0].ssi_signo, ssi[1].ssi_signo);
+        ret = -1;
+    } else if ((read(fd, ssi, sizeof(ssi)) >= 0) || (errno != EAGAIN)) {
+        printf("Reading an empty signalfd did not fail with EAGAIN.\n");
+        ret = -1;
+    }
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    sigaddset(&set, SIGUSR2);
+    sigaddset(&set, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &set, NULL) < 0) {
+        printf("Failed to block the signals: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((test_sigtimedwait(&set) < 0) || (test_signalfd(&set) < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
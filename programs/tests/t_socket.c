@@ -0,0 +1,215 @@
+/// @file t_socket.c
+/// @brief Test local sockets: pairs, connections, datagrams and descriptor passing.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The name of the listening socket.
+#define STREAM_PATH "/tmp/t_socket.stream"
+/// The name of the datagram socket.
+#define DGRAM_PATH "/tmp/t_socket.dgram"
+
+/// @brief Fills a local name.
+/// @param addr the name.
+/// @param path the path of the name.
+static void set_name(struct sockaddr_un *addr, const char *path)
+{
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+}
+
+/// @brief Sends data both ways through a pair of stream sockets, then shuts one direction down.
+/// @return 0 on success, -1 on failure.
+static int test_socketpair(void)
+{
+    int sv[2];
+    char buffer[16];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        printf("Failed to create the socket pair: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((write(sv[0], "ping", 4) != 4) || (read(sv[1], buffer, sizeof(buffer)) != 4) || memcmp(buffer, "ping", 4)) {
+        printf("Failed to send data from the first socket of the pair.\n");
+        return -1;
+    }
+    if ((send(sv[1], "pong", 4, 0) != 4) || (recv(sv[0], buffer, sizeof(buffer), 0) != 4) ||
+        memcmp(buffer, "pong", 4)) {
+        printf("Failed to send data from the second socket of the pair.\n");
+        return -1;
+    }
+    // Nothing to read, without blocking.
+    if ((recv(sv[0], buffer, sizeof(buffer), MSG_DONTWAIT) >= 0) || (errno != EAGAIN)) {
+        printf("Receiving from an empty socket did not fail with EAGAIN.\n");
+        return -1;
+    }
+    // The other end reads the end of file.
+    if ((shutdown(sv[0], SHUT_WR) < 0) || (read(sv[1], buffer, sizeof(buffer)) != 0)) {
+        printf("Shutting down the socket did not end the stream.\n");
+        return -1;
+    }
+    close(sv[0]);
+    close(sv[1]);
+    return 0;
+}
+
+/// @brief Connects a child to a listening socket, and exchanges data with it.
+/// @return 0 on success, -1 on failure.
+static int test_stream(void)
+{
+    struct sockaddr_un addr;
+    char buffer[16];
+    set_name(&addr, STREAM_PATH);
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        printf("Failed to create the socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(server, 4) < 0)) {
+        printf("Failed to listen on %s: %s\n", STREAM_PATH, strerror(errno));
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        close(server);
+        int client = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((client < 0) || (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+            exit(EXIT_FAILURE);
+        }
+        if ((write(client, "hello", 5) != 5) || (read(client, buffer, sizeof(buffer)) != 5) ||
+            memcmp(buffer, "world", 5)) {
+            exit(EXIT_FAILURE);
+        }
+        close(client);
+        exit(EXIT_SUCCESS);
+    }
+    int conn = accept(server, NULL, NULL);
+    if (conn < 0) {
+        printf("Failed to accept the connection: %s\n", strerror(errno));
+        return -1;
+    }
+    int ret = 0;
+    if ((read(conn, buffer, sizeof(buffer)) != 5) || memcmp(buffer, "hello", 5) || (write(conn, "world", 5) != 5)) {
+        printf("Failed to exchange data through the connection.\n");
+        ret = -1;
+    }
+    int status;
+    if ((wait(&status) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        printf("The client failed.\n");
+        ret = -1;
+    }
+    // The client is gone, the stream ends.
+    if ((ret == 0) && (read(conn, buffer, sizeof(buffer)) != 0)) {
+        printf("The connection did not end with the client.\n");
+        ret = -1;
+    }
+    close(conn);
+    close(server);
+    return ret;
+}
+
+/// @brief Sends a datagram to a named socket, and checks that it is truncated to the buffer.
+/// @return 0 on success, -1 on failure.
+static int test_dgram(void)
+{
+    struct sockaddr_un addr, from;
+    socklen_t fromlen = sizeof(from);
+    char buffer[4];
+    set_name(&addr, DGRAM_PATH);
+    int server = socket(AF_UNIX, SOCK_DGRAM, 0);
+    int client = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if ((server < 0) || (client < 0) || (bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0)) {
+        printf("Failed to create the datagram sockets: %s\n", strerror(errno));
+        return -1;
+    }
+    if (sendto(client, "datagram", 8, 0, (struct sockaddr *)&addr, sizeof(addr)) != 8) {
+        printf("Failed to send the datagram: %s\n", strerror(errno));
+        return -1;
+    }
+    if ((recvfrom(server, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &fromlen) != 4) ||
+        memcmp(buffer, "data", 4) || (from.sun_family != AF_UNIX)) {
+        printf("Failed to receive the datagram.\n");
+        return -1;
+    }
+    // The rest of the datagram has been discarded.
+    if ((recv(server, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0) || (errno != EAGAIN)) {
+        printf("The datagram was not discarded after being truncated.\n");
+        return -1;
+    }
+    close(client);
+    close(server);
+    return 0;
+}
+
+/// @brief Passes the read end of a pipe through a pair of sockets, and reads from it.
+/// @return 0 on success, -1 on failure.
+static int test_rights(void)
+{
+    int sv[2], fds[2];
+    char byte = 'x', buffer[8];
+    if ((socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) || (pipe(fds) < 0)) {
+        printf("Failed to create the sockets and the pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    // Send the read end, and close it.
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov   = { .iov_base = &byte, .iov_len = 1 };
+    struct msghdr msg  = { 0 };
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.space;
+    msg.msg_controllen = sizeof(control.space);
+    // The descriptor travels as an SCM_RIGHTS item.
+    struct cmsghdr *cmsg    = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level        = SOL_SOCKET;
+    cmsg->cmsg_type         = SCM_RIGHTS;
+    cmsg->cmsg_len          = CMSG_LEN(sizeof(int));
+    *(int *)CMSG_DATA(cmsg) = fds[0];
+    if (sendmsg(sv[0], &msg, 0) != 1) {
+        printf("Failed to send the descriptor: %s\n", strerror(errno));
+        return -1;
+    }
+    close(fds[0]);
+    // Receive it, under a new number.
+    memset(&control, 0, sizeof(control));
+    msg.msg_controllen = sizeof(control.space);
+    if ((recvmsg(sv[1], &msg, 0) != 1) || !(cmsg = CMSG_FIRSTHDR(&msg)) || (cmsg->cmsg_type != SCM_RIGHTS)) {
+        printf("Failed to receive the descriptor.\n");
+        return -1;
+    }
+    int fd = *(int *)CMSG_DATA(cmsg);
+    if ((write(fds[1], "rights", 6) != 6) || (read(fd, buffer, sizeof(buffer)) != 6) || memcmp(buffer, "rights", 6)) {
+        printf("Failed to read from the received descriptor.\n");
+        return -1;
+    }
+    close(fd);
+    close(fds[1]);
+    close(sv[0]);
+    close(sv[1]);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_socketpair() < 0) || (test_stream() < 0) || (test_dgram() < 0) || (test_rights() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
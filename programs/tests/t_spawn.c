@@ -0,0 +1,114 @@
+/// @file t_spawn.c
+/// @brief Test vfork, and the creation of processes with posix_spawn.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// The file the output of the spawned process is redirected to.
+#define OUTPUT_PATH "/tmp/t_spawn.out"
+
+extern char **environ;
+
+/// @brief Waits for a child, and checks its exit status.
+/// @param pid the child.
+/// @param expected the expected exit status.
+/// @return 0 if the child exited with the expected status, -1 otherwise.
+static int wait_child(pid_t pid, int expected)
+{
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != expected)) {
+        printf("The child %d did not exit with status %d.\n", pid, expected);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Checks that the child of vfork() borrows our memory, and runs before we return.
+/// @return 0 on success, -1 on failure.
+static int test_vfork(void)
+{
+    static volatile int shared = 0;
+    pid_t pid                  = vfork();
+    if (pid < 0) {
+        printf("Failed to vfork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        shared = 1;
+        exit(EXIT_SUCCESS);
+    }
+    if (shared != 1) {
+        printf("The child of vfork did not write to the memory of the parent.\n");
+        return -1;
+    }
+    if (wait_child(pid, EXIT_SUCCESS) < 0) {
+        return -1;
+    }
+    // A child which replaces its image gives the memory back.
+    pid = vfork();
+    if (pid < 0) {
+        printf("Failed to vfork: %s\n", strerror(errno));
+        return -1;
+    }
+    if (pid == 0) {
+        execl("/bin/false", "false", NULL);
+        exit(EXIT_SUCCESS);
+    }
+    return wait_child(pid, EXIT_FAILURE);
+}
+
+/// @brief Spawns a process with its output redirected to a file, and checks what it wrote.
+/// @return 0 on success, -1 on failure.
+static int test_posix_spawn(void)
+{
+    char *argv[] = { "echo", "spawned", NULL };
+    char buffer[16];
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, OUTPUT_PATH, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+    pid_t pid;
+    int error = posix_spawn(&pid, "/bin/echo", &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error) {
+        printf("Failed to spawn echo: %s\n", strerror(error));
+        return -1;
+    }
+    if (wait_child(pid, EXIT_SUCCESS) < 0) {
+        return -1;
+    }
+    int fd = open(OUTPUT_PATH, O_RDONLY, 0);
+    if ((fd < 0) || (read(fd, buffer, sizeof(buffer)) < 7) || strncmp(buffer, "spawned", 7)) {
+        printf("The output of the spawned process was not redirected.\n");
+        return -1;
+    }
+    close(fd);
+    unlink(OUTPUT_PATH);
+    // Programs are searched inside the PATH, and missing ones are reported.
+    char *false_argv[] = { "false", NULL };
+    if ((posix_spawnp(&pid, "false", NULL, NULL, false_argv, environ) != 0) || (wait_child(pid, EXIT_FAILURE) < 0)) {
+        printf("Failed to spawn false from the PATH.\n");
+        return -1;
+    }
+    if (posix_spawn(&pid, "/bin/t_spawn_missing", NULL, NULL, false_argv, environ) != ENOENT) {
+        printf("Spawning a missing program did not fail with ENOENT.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_vfork() < 0) || (test_posix_spawn() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
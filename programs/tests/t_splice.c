@@ -0,0 +1,147 @@
+/// @file t_splice.c
+/// @brief Test splice, tee and vmsplice between pipes and files.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/// Two whole pages, and part of a third one.
+#define DATA_SIZE (2 * 4096 + 100)
+
+/// The data moved around.
+static char data[DATA_SIZE];
+/// The data read back.
+static char buffer[DATA_SIZE];
+/// The data written to refill a pipe.
+static char chunk[64 * 1024];
+
+/// @brief Reads the whole data back from a descriptor, and checks it.
+/// @param fd the file descriptor.
+/// @param what what we are checking.
+/// @return 0 if the data is correct, -1 otherwise.
+static int check_data(int fd, const char *what)
+{
+    ssize_t total = 0, ret;
+    while ((total < DATA_SIZE) && ((ret = read(fd, buffer + total, DATA_SIZE - total)) > 0)) {
+        total += ret;
+    }
+    if ((total != DATA_SIZE) || memcmp(buffer, data, DATA_SIZE)) {
+        printf("The data read from %s is wrong (%d bytes).\n", what, total);
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Moves the data through a file, and through the pipes.
+/// @param fd the file.
+/// @param p2 the pipe holding the data.
+/// @param p3 an empty pipe.
+/// @return 0 on success, -1 on failure.
+static int splice_through_file(int fd, int p2[2], int p3[2])
+{
+    // Move the data into the file.
+    if (splice(p2[0], NULL, fd, NULL, DATA_SIZE, 0) != DATA_SIZE) {
+        printf("Failed to splice the pipe into the file: %s\n", strerror(errno));
+        return -1;
+    }
+    if (lseek(fd, 0, SEEK_CUR) != DATA_SIZE) {
+        printf("Splicing into the file did not move its offset.\n");
+        return -1;
+    }
+    if ((lseek(fd, 0, SEEK_SET) != 0) || (check_data(fd, "the file") < 0)) {
+        return -1;
+    }
+    // Move the file back into a pipe, from an explicit offset.
+    off_t offset = 0;
+    if ((splice(fd, &offset, p3[1], NULL, DATA_SIZE, SPLICE_F_MOVE) != DATA_SIZE) || (offset != DATA_SIZE)) {
+        printf("Failed to splice the file into the pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    // Move the data from pipe to pipe, and check it at the end of the line.
+    if (splice(p3[0], NULL, p2[1], NULL, DATA_SIZE, 0) != DATA_SIZE) {
+        printf("Failed to splice the pipe into the pipe: %s\n", strerror(errno));
+        return -1;
+    }
+    if (check_data(p2[0], "the spliced pipe") < 0) {
+        return -1;
+    }
+    // Pipes have no offset, and one of the ends must be a pipe.
+    if ((splice(p2[0], &offset, fd, NULL, 1, 0) >= 0) || (errno != ESPIPE)) {
+        printf("Splicing from a pipe with an offset did not fail with ESPIPE.\n");
+        return -1;
+    }
+    if ((splice(fd, NULL, fd, NULL, 1, 0) >= 0) || (errno != EINVAL)) {
+        printf("Splicing between two files did not fail with EINVAL.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_splice.txt";
+    int p1[2], p2[2], p3[2];
+
+    for (int i = 0; i < DATA_SIZE; ++i) {
+        data[i] = (char)('a' + (i % 26));
+    }
+    if ((pipe(p1) < 0) || (pipe(p2) < 0) || (pipe(p3) < 0)) {
+        printf("Failed to create the pipes: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Duplicate the data into the second pipe, without consuming it.
+    if (write(p1[1], data, DATA_SIZE) != DATA_SIZE) {
+        printf("Failed to write into the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (tee(p1[0], p2[1], DATA_SIZE, SPLICE_F_NONBLOCK) != DATA_SIZE) {
+        printf("Failed to tee the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (check_data(p1[0], "the source of tee") < 0) {
+        return EXIT_FAILURE;
+    }
+    // Refill the first pipe, its writes must not reach the pages it shares.
+    if (fcntl(p1[1], F_SETFL, O_NONBLOCK) < 0) {
+        printf("Failed to set the pipe to non-blocking mode: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    memset(chunk, 'x', sizeof(chunk));
+    if (write(p1[1], chunk, sizeof(chunk)) <= 0) {
+        printf("Failed to refill the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Move the duplicate through a file, and back through the pipes.
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int ret = splice_through_file(fd, p2, p3);
+    close(fd);
+    unlink(filename);
+    if (ret < 0) {
+        return EXIT_FAILURE;
+    }
+    // Write the data into a pipe in two pieces.
+    struct iovec iov[2] = {
+        { .iov_base = data, .iov_len = 4096 },
+        { .iov_base = data + 4096, .iov_len = DATA_SIZE - 4096 },
+    };
+    if (vmsplice(p3[1], iov, 2, 0) != DATA_SIZE) {
+        printf("Failed to vmsplice into the pipe: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (check_data(p3[0], "the vmspliced pipe") < 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
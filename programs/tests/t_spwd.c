@@ -59,6 +59,42 @@ int test_generate(void)
     return EXIT_SUCCESS;
 }
 
+/// @brief Hashes the same data in one piece, and in pieces of varying sizes.
+/// @return int EXIT_SUCCESS on success, EXIT_FAILURE on error.
+int test_stream(void)
+{
+    // The data spans many blocks, and is not a multiple of the block size.
+    static uint8_t data[10000];
+    for (unsigned i = 0; i < sizeof(data); ++i) {
+        data[i] = (uint8_t)(i * 131 + 7);
+    }
+
+    unsigned char whole[SHA256_BLOCK_SIZE]  = {0};
+    unsigned char pieces[SHA256_BLOCK_SIZE] = {0};
+    SHA256_ctx_t ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, sizeof(data));
+    sha256_final(&ctx, whole);
+
+    // The pieces end both inside, and at the boundaries of, the blocks.
+    sha256_init(&ctx);
+    for (size_t offset = 0, length = 1; offset < sizeof(data); offset += length, length = (length * 7) % 200 + 1) {
+        if (length > sizeof(data) - offset) {
+            length = sizeof(data) - offset;
+        }
+        sha256_update(&ctx, data + offset, length);
+    }
+    sha256_final(&ctx, pieces);
+
+    if (memcmp(whole, pieces, SHA256_BLOCK_SIZE) != 0) {
+        fprintf(stderr, "Hashing the data in pieces gives a different hash.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int test_getspnam(void)
 {
     const char *username = "root";
@@ -80,6 +116,9 @@ int main(int argc, char *argv[])
     if (test_generate() == EXIT_FAILURE) {
         return EXIT_FAILURE;
     }
+    if (test_stream() == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
     if (test_getspnam() == EXIT_FAILURE) {
         return EXIT_FAILURE;
     }
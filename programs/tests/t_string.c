@@ -0,0 +1,272 @@
+/// @file t_string.c
+/// @brief Test the copies, fills and searches of the string routines, at every
+/// alignment, the conversion of numbers, and compare the speed of the copies
+/// with a loop over the bytes.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/// The size of the buffers.
+#define SIZE       4096
+/// The size of the copies which are timed.
+#define BENCH_SIZE (64 * 1024)
+/// How many times the copies are timed.
+#define BENCH_RUNS 64
+
+/// The sizes which are tested, around the word, the block and the page.
+static const size_t sizes[]       = {0, 1, 3, 4, 7, 16, 63, 64, 65, 511, 512, 513, 1000, 2048};
+/// The source buffer.
+static unsigned char src[SIZE];
+/// The destination buffer.
+static unsigned char dst[SIZE];
+/// The expected content of the destination buffer.
+static unsigned char expected[SIZE];
+
+/// @brief Fills the buffer with printable, non-zero, characters.
+/// @param buffer the buffer.
+/// @param seed where the sequence starts.
+static void fill_buffer(unsigned char *buffer, unsigned seed)
+{
+    for (size_t i = 0; i < SIZE; ++i) {
+        buffer[i] = 'A' + ((seed + i * 7) % 26);
+    }
+}
+
+/// @brief Checks memcpy(), memset() and memmove() against a loop over the bytes.
+/// @return 0 on success, -1 on failure.
+static int test_copy(void)
+{
+    for (size_t it = 0; it < sizeof(sizes) / sizeof(*sizes); ++it) {
+        size_t n = sizes[it];
+        for (size_t d = 0; d < 16; ++d) {
+            for (size_t s = 0; s < 16; ++s) {
+                fill_buffer(src, s);
+                fill_buffer(dst, d);
+                fill_buffer(expected, d);
+                memcpy(dst + d, src + s, n);
+                for (size_t i = 0; i < n; ++i) {
+                    expected[d + i] = src[s + i];
+                }
+                if (memcmp(dst, expected, SIZE)) {
+                    printf("memcpy() of %u bytes, at %u from %u, failed.\n", n, d, s);
+                    return -1;
+                }
+                memset(dst + d, (int)s, n);
+                for (size_t i = 0; i < n; ++i) {
+                    expected[d + i] = (unsigned char)s;
+                }
+                if (memcmp(dst, expected, SIZE)) {
+                    printf("memset() of %u bytes, at %u, failed.\n", n, d);
+                    return -1;
+                }
+                // Overlapping, with the destination after the source.
+                fill_buffer(dst, d);
+                fill_buffer(expected, d);
+                memmove(dst + d + s, dst + d, n);
+                for (size_t i = n; i > 0; --i) {
+                    expected[d + s + i - 1] = expected[d + i - 1];
+                }
+                if (memcmp(dst, expected, SIZE)) {
+                    printf("memmove() of %u bytes, from %u to %u, failed.\n", n, d, d + s);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/// @brief Checks strlen(), memchr() and strcmp(), at every alignment.
+/// @return 0 on success, -1 on failure.
+static int test_search(void)
+{
+    for (size_t it = 0; it < sizeof(sizes) / sizeof(*sizes); ++it) {
+        size_t n = sizes[it];
+        for (size_t a = 0; a < 8; ++a) {
+            fill_buffer(src, 0);
+            src[a + n] = '\0';
+            if (strlen((char *)src + a) != n) {
+                printf("strlen() of %u characters, at %u, failed.\n", n, a);
+                return -1;
+            }
+            src[a + n] = '#';
+            if ((memchr(src + a, '#', n + 1) != src + a + n) || (memchr(src + a, '#', n) != NULL)) {
+                printf("memchr() of %u bytes, at %u, failed.\n", n, a);
+                return -1;
+            }
+            for (size_t b = 0; b < 8; ++b) {
+                fill_buffer(src, 0);
+                src[a + n] = '\0';
+                memcpy(dst + b, src + a, n + 1);
+                if (strcmp((char *)src + a, (char *)dst + b) != 0) {
+                    printf("strcmp() of equal strings of %u characters, at %u and %u, failed.\n", n, a, b);
+                    return -1;
+                }
+                if (n == 0) {
+                    continue;
+                }
+                // The copy is now greater, by its last character.
+                dst[b + n - 1] = 'z';
+                if (strcmp((char *)src + a, (char *)dst + b) >= 0) {
+                    printf("strcmp() of different strings of %u characters, at %u and %u, failed.\n", n, a, b);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/// @brief Checks strchr() and strrchr(), at every alignment.
+/// @return 0 on success, -1 on failure.
+static int test_strchr(void)
+{
+    for (size_t it = 0; it < sizeof(sizes) / sizeof(*sizes); ++it) {
+        size_t n = sizes[it];
+        for (size_t a = 0; a < 8; ++a) {
+            fill_buffer(src, 0);
+            char *s = (char *)src + a;
+            s[n]    = '\0';
+            if ((strchr(s, '\0') != s + n) || (strrchr(s, '\0') != s + n) || strchr(s, '#') || strrchr(s, '#')) {
+                printf("strchr() of %u characters, at %u, found what is not there.\n", n, a);
+                return -1;
+            }
+            if (n == 0) {
+                continue;
+            }
+            s[n / 2] = s[n - 1] = '#';
+            if ((strchr(s, '#') != s + (n / 2)) || (strrchr(s, '#') != s + n - 1)) {
+                printf("strchr() of %u characters, at %u, failed.\n", n, a);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/// @brief Looks for a needle one position after the other.
+/// @param haystack the string which is searched.
+/// @param needle the string which is looked for.
+/// @return the first occurrence, or NULL.
+static char *naive_strstr(const char *haystack, const char *needle)
+{
+    size_t length = strlen(needle);
+    for (; *haystack; ++haystack) {
+        if (strncmp(haystack, needle, length) == 0) {
+            return (char *)haystack;
+        }
+    }
+    return (length == 0) ? (char *)haystack : NULL;
+}
+
+/// @brief Checks strstr() against a naive search, with periodic needles over a small alphabet.
+/// @return 0 on success, -1 on failure.
+static int test_strstr(void)
+{
+    static const char *needles[] = {"",      "a",    "ab",    "aab",        "abab",
+                                    "ababa", "aaaa", "aaaab", "abaababaab", "bbbbbbbbbbbbbbbba"};
+    unsigned seed                = 1;
+    for (int round = 0; round < 64; ++round) {
+        // A haystack of a's and b's, long enough for the needles to appear by chance.
+        size_t n = 1 + (round * 37) % 700;
+        for (size_t i = 0; i < n; ++i) {
+            seed   = seed * 1103515245U + 12345U;
+            src[i] = ((seed >> 16) % 3) ? 'a' : 'b';
+        }
+        src[n] = '\0';
+        for (size_t i = 0; i < sizeof(needles) / sizeof(*needles); ++i) {
+            if (strstr((char *)src, needles[i]) != naive_strstr((char *)src, needles[i])) {
+                printf("strstr() of `%s`, in %u characters, failed.\n", needles[i], n);
+                return -1;
+            }
+        }
+        // A needle taken from the end of the haystack is always found.
+        const char *tail = (char *)src + n - ((n < 40) ? n : 40);
+        if (strstr((char *)src, tail) != naive_strstr((char *)src, tail)) {
+            printf("strstr() of the tail, in %u characters, failed.\n", n);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/// @brief Checks the conversion of numbers by atoi() and strtol().
+/// @return 0 on success, -1 on failure.
+static int test_numbers(void)
+{
+    char *end;
+    if ((atoi("  42") != 42) || (atoi("+7x") != 7) || (atoi("-2147483648") != -2147483647 - 1) || (atoi("z") != 0)) {
+        printf("atoi() failed.\n");
+        return -1;
+    }
+    if ((strtol(" -123abc", &end, 10) != -123) || strcmp(end, "abc") || (strtol("0x1Fg", &end, 0) != 31) ||
+        strcmp(end, "g") || (strtol("0777", NULL, 0) != 511) || (strtol("zZ", NULL, 36) != 35 * 36 + 35) ||
+        (strtol("19", &end, 8) != 1) || strcmp(end, "9")) {
+        printf("strtol() failed.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/// @brief Returns the time elapsed since the given one.
+/// @param start the start time.
+/// @return the microseconds elapsed.
+static unsigned long elapsed_us(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((now.tv_sec - start->tv_sec) * 1000000UL) + ((now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+/// @brief Compares the speed of memcpy() and memset() with a loop over the bytes.
+/// @return 0 on success, -1 on failure.
+static int bench(void)
+{
+    unsigned char *a = malloc(BENCH_SIZE);
+    unsigned char *b = malloc(BENCH_SIZE);
+    if (!a || !b) {
+        printf("Failed to allocate the buffers.\n");
+        free(a);
+        free(b);
+        return -1;
+    }
+    struct timespec start;
+    unsigned long copy, fill, loop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        memcpy(b, a, BENCH_SIZE);
+    }
+    copy = elapsed_us(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        memset(b, run, BENCH_SIZE);
+    }
+    fill = elapsed_us(&start);
+    // The stores must not be optimized away.
+    volatile unsigned char *vb = b;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        for (size_t i = 0; i < BENCH_SIZE; ++i) {
+            vb[i] = a[i];
+        }
+    }
+    loop = elapsed_us(&start);
+    printf("Copying %d times %d bytes: memcpy() %lu us, memset() %lu us, byte loop %lu us.\n", BENCH_RUNS,
+           BENCH_SIZE, copy, fill, loop);
+    free(a);
+    free(b);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if ((test_copy() < 0) || (test_search() < 0) || (test_strchr() < 0) || (test_strstr() < 0) ||
+        (test_numbers() < 0) || (bench() < 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+/// @file t_timerslack.c
+/// @brief Test the slack of the timers, set with prctl(PR_SET_TIMERSLACK).
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// The default slack, in nanoseconds.
+#define DEFAULT_SLACK 50000
+/// The slack set by the test, in nanoseconds.
+#define TEST_SLACK 1000000
+/// The length of each sleep, in nanoseconds.
+#define SLEEP_NS 2000000
+/// The number of sleeps.
+#define NUM_SLEEPS 10
+
+/// @brief Converts a time to nanoseconds.
+/// @param ts the time.
+/// @return the nanoseconds.
+static inline unsigned long long to_ns(const struct timespec *ts)
+{
+    return ((unsigned long long)ts->tv_sec * 1000000000ULL) + (unsigned long long)ts->tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    int slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+    if (slack != DEFAULT_SLACK) {
+        printf("The default slack is %d ns instead of %d ns.\n", slack, DEFAULT_SLACK);
+        return EXIT_FAILURE;
+    }
+    if ((prctl(PR_SET_TIMERSLACK, TEST_SLACK, 0, 0, 0) < 0) || (prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0) != TEST_SLACK)) {
+        printf("Failed to set the slack: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // The children inherit the slack.
+    pid_t pid = fork();
+    if (pid == 0) {
+        exit((prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0) == TEST_SLACK) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    int status;
+    if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        printf("The child did not inherit the slack.\n");
+        return EXIT_FAILURE;
+    }
+    // The slack can only delay the sleeps, never shorten them.
+    struct timespec res, start, end, req = { 0, SLEEP_NS };
+    clock_getres(CLOCK_MONOTONIC, &res);
+    for (int i = 0; i < NUM_SLEEPS; ++i) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        nanosleep(&req, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if ((to_ns(&end) - to_ns(&start) + to_ns(&res)) < SLEEP_NS) {
+            printf("A sleep of %d ns lasted %lu ns.\n", SLEEP_NS, (unsigned long)(to_ns(&end) - to_ns(&start)));
+            return EXIT_FAILURE;
+        }
+    }
+    // Zero goes back to the default slack.
+    if ((prctl(PR_SET_TIMERSLACK, 0, 0, 0, 0) < 0) || (prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0) != DEFAULT_SLACK)) {
+        printf("Failed to reset the slack: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((prctl(-1, 0, 0, 0, 0) != -1) || (errno != EINVAL)) {
+        printf("An unknown operation did not fail with EINVAL.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+/// @file t_uio.c
+/// @brief Test the vectored and positional I/O system calls.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    char *filename = "/home/user/t_uio.txt";
+    char header[4], payload[8], buffer[16];
+    struct iovec iov[2];
+
+    // Create the file.
+    int fd = creat(filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    if (fd < 0) {
+        printf("Failed to create file %s: %s\n", filename, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    // Write a header and a payload with a single call.
+    iov[0].iov_base = "HEAD";
+    iov[0].iov_len  = 4;
+    iov[1].iov_base = "fusrodah";
+    iov[1].iov_len  = 8;
+    if (writev(fd, iov, 2) != 12) {
+        printf("Failed to writev on file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    // Overwrite part of the payload, without moving the offset.
+    if (pwrite(fd, "FUS", 3, 4) != 3) {
+        printf("Failed to pwrite on file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    // Read the header and the payload back with a single call.
+    fd = open(filename, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Failed to open file %s: %s\n", filename, strerror(errno));
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    iov[0].iov_base = header;
+    iov[0].iov_len  = sizeof(header);
+    iov[1].iov_base = payload;
+    iov[1].iov_len  = sizeof(payload);
+    if (readv(fd, iov, 2) != 12) {
+        printf("Failed to readv from file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    // Read the payload again, from its offset.
+    memset(buffer, 0, sizeof(buffer));
+    if (pread(fd, buffer, sizeof(buffer), 4) != 8) {
+        printf("Failed to pread from file %s: %s\n", filename, strerror(errno));
+        close(fd);
+        unlink(filename);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    unlink(filename);
+    if (memcmp(header, "HEAD", 4) || memcmp(payload, "FUSrodah", 8) || strcmp(buffer, "FUSrodah")) {
+        printf("Unexpected file content.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/// @file t_vdso.c
+/// @brief Test the page shared with the kernel, which getpid() and clock_gettime() read.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <bits/vdso.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Waits for a child, which exits with the lowest byte of its pid.
+/// @param pid the child.
+/// @param name the function which created it.
+/// @return 0 on success, -1 on failure.
+static int check_child(pid_t pid, const char *name)
+{
+    int status;
+    if (pid < 0) {
+        printf("%s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    if (waitpid(pid, &status, 0) != pid) {
+        printf("waitpid: %s\n", strerror(errno));
+        return -1;
+    }
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != (pid & 0xFF))) {
+        printf("The child created by %s did not see its own pid %d (status 0x%x).\n", name, pid, status);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    pid_t parent = getpid();
+    // Each process sees its own identifiers, even though the page is shared.
+    pid_t pid    = fork();
+    if (pid == 0) {
+        exit(getpid() & 0xFF);
+    }
+    if (check_child(pid, "fork") < 0) {
+        return EXIT_FAILURE;
+    }
+    // The child of vfork() runs on the memory of its parent.
+    pid = vfork();
+    if (pid == 0) {
+        exit(getpid() & 0xFF);
+    }
+    if (check_child(pid, "vfork") < 0) {
+        return EXIT_FAILURE;
+    }
+    if (getpid() != parent) {
+        printf("The pid changed from %d to %d.\n", parent, getpid());
+        return EXIT_FAILURE;
+    }
+    // The page cannot be written.
+    pid = fork();
+    if (pid == 0) {
+        ((vdso_data_t *)VDSO_ADDR)->pid = 0;
+        exit(0);
+    }
+    int status;
+    if ((waitpid(pid, &status, 0) != pid) || !WIFSIGNALED(status) || (WTERMSIG(status) != SIGSEGV)) {
+        printf("Writing the shared page did not raise SIGSEGV (status 0x%x).\n", status);
+        return EXIT_FAILURE;
+    }
+    // The clock read from the page keeps up with a sleep.
+    struct timespec start, end, req = { 0, 20000000 };
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    nanosleep(&req, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long elapsed_ms = (long)(end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+    if ((elapsed_ms < 20) || (elapsed_ms > 1000)) {
+        printf("A sleep of 20 ms lasted %ld ms.\n", elapsed_ms);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/// @file t_wait4.c
+/// @brief Test waiting for a child with wait4, which returns the resources it used.
+/// @copyright (c) 2014-2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strerror.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        printf("Failed to fork: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pid == 0) {
+        // Keep the CPU busy for a few ticks, then sleep for a while.
+        volatile unsigned long counter = 0;
+        for (unsigned long i = 0; i < 20000000UL; ++i) {
+            ++counter;
+        }
+        sleep(1);
+        exit(42);
+    }
+    // The child is still running.
+    int status = 0;
+    if (wait4(pid, &status, WNOHANG, NULL) != 0) {
+        printf("The child should still be running.\n");
+        return EXIT_FAILURE;
+    }
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        printf("Failed to wait for the child: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (!WIFEXITED(status) || (WEXITSTATUS(status) != 42)) {
+        printf("The child exited with status %d.\n", status);
+        return EXIT_FAILURE;
+    }
+    if ((usage.ru_utime.tv_sec == 0) && (usage.ru_utime.tv_usec == 0)) {
+        printf("The child did not spend any time in user mode.\n");
+        return EXIT_FAILURE;
+    }
+    if (usage.ru_nvcsw == 0) {
+        printf("The child never gave up the CPU, although it slept.\n");
+        return EXIT_FAILURE;
+    }
+    // There are no more children.
+    if (wait4(-1, &status, 0, &usage) != -1) {
+        printf("Waited for a child which does not exist.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
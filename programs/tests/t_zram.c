@@ -0,0 +1,95 @@
+/// @file t_zram.c
+/// @brief Test the compressed RAM disk, through the pages at its end, which
+/// the swap is the last to use.
+/// @copyright (c) 2024 This file is distributed under the MIT License.
+/// See LICENSE.md for details.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strerror.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// The size of a page of the device.
+#define PAGE 4096
+
+/// The content of the pages before the test, written back at the end.
+static char saved[3 * PAGE];
+/// The pages we write.
+static char wbuffer[3 * PAGE];
+/// The pages we read back.
+static char rbuffer[3 * PAGE];
+
+int main(int argc, char *argv[])
+{
+    int status = EXIT_FAILURE;
+    struct stat st;
+
+    int fd = open("/dev/zram0", O_RDWR, 0);
+    if (fd < 0) {
+        printf("Failed to open `/dev/zram0`: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if ((fstat(fd, &st) < 0) || (st.st_size < 4 * PAGE)) {
+        printf("The device is too small.\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    off_t offset = st.st_size - sizeof(saved);
+    if ((lseek(fd, offset, SEEK_SET) != offset) || (read(fd, saved, sizeof(saved)) != sizeof(saved))) {
+        printf("Failed to read the device: %s\n", strerror(errno));
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    // A page which compresses well, one which does not, and one filled with a single word.
+    unsigned seed = 1;
+    for (int i = 0; i < PAGE; ++i) {
+        seed                  = seed * 1103515245U + 12345U;
+        wbuffer[i]            = "compressed ram disk "[i % 20];
+        wbuffer[PAGE + i]     = (char)(seed >> 16);
+        wbuffer[2 * PAGE + i] = (char)((i % 4) ? 0 : 0x5a);
+    }
+    if ((lseek(fd, offset, SEEK_SET) != offset) || (write(fd, wbuffer, sizeof(wbuffer)) != sizeof(wbuffer))) {
+        printf("Failed to write the device: %s\n", strerror(errno));
+        goto cleanup;
+    }
+    if ((lseek(fd, offset, SEEK_SET) != offset) || (read(fd, rbuffer, sizeof(rbuffer)) != sizeof(rbuffer)) ||
+        memcmp(wbuffer, rbuffer, sizeof(wbuffer))) {
+        printf("The pages read back differ from the pages written.\n");
+        goto cleanup;
+    }
+    // A write across two pages only changes the bytes it covers.
+    memset(wbuffer + PAGE - 100, 'x', 200);
+    if ((lseek(fd, offset + PAGE - 100, SEEK_SET) != offset + PAGE - 100) ||
+        (write(fd, wbuffer + PAGE - 100, 200) != 200) || (lseek(fd, offset, SEEK_SET) != offset) ||
+        (read(fd, rbuffer, sizeof(rbuffer)) != sizeof(rbuffer)) || memcmp(wbuffer, rbuffer, sizeof(wbuffer))) {
+        printf("A partial write did not update the pages correctly.\n");
+        goto cleanup;
+    }
+    int stats = open("/proc/zramstat", O_RDONLY, 0);
+    if (stats < 0) {
+        printf("Failed to open `/proc/zramstat`: %s\n", strerror(errno));
+        goto cleanup;
+    }
+    ssize_t length = read(stats, rbuffer, sizeof(rbuffer) - 1);
+    close(stats);
+    if (length <= 0) {
+        printf("Failed to read `/proc/zramstat`.\n");
+        goto cleanup;
+    }
+    rbuffer[length] = '\0';
+    if (strstr(rbuffer, "zram0") == NULL) {
+        printf("The statistics of the device are missing.\n");
+        goto cleanup;
+    }
+    status = EXIT_SUCCESS;
+cleanup:
+    if ((lseek(fd, offset, SEEK_SET) != offset) || (write(fd, saved, sizeof(saved)) != sizeof(saved))) {
+        printf("Failed to restore the device: %s\n", strerror(errno));
+        status = EXIT_FAILURE;
+    }
+    close(fd);
+    return status;
+}